@@ -50,6 +50,14 @@ public:
 		return __atomic_fetch_sub(&m_val, val, (int) order);
 	}
 
+	inline T bit_or(T val, MemoryOrder order = default_order) volatile noexcept {
+		return __atomic_fetch_or(&m_val, val, (int) order);
+	}
+
+	inline T bit_and(T val, MemoryOrder order = default_order) volatile noexcept {
+		return __atomic_fetch_and(&m_val, val, (int) order);
+	}
+
 	inline bool compare_exchange_strong(T& expected, T desired, MemoryOrder order = default_order) volatile noexcept {
 		if (order == MemoryOrder::AcqRel || order == MemoryOrder::Release)
 			return __atomic_compare_exchange(&m_val, &expected, &desired, false, (int) MemoryOrder::Release, (int) MemoryOrder::Acquire);
@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "BootTimeline.h"
+#include <kernel/time/TimeManager.h>
+
+namespace BootTimeline {
+	struct Phase {
+		const char* name;
+		uint64_t tsc;
+	};
+
+	// The TSC is used since the clock isn't set up until partway through booting
+	static Phase s_phases[BOOT_TIMELINE_MAX_PHASES];
+	static size_t s_num_phases = 0;
+
+	void mark(const char* phase) {
+		if(s_num_phases >= BOOT_TIMELINE_MAX_PHASES)
+			return;
+		uint32_t low, high;
+		asm volatile("rdtsc" : "=a"(low), "=d"(high));
+		s_phases[s_num_phases++] = {phase, ((uint64_t) high << 32) | low};
+	}
+
+	kstd::string to_string() {
+		kstd::string str;
+		for(size_t i = 0; i < s_num_phases; i++) {
+			int64_t time = TimeManager::tsc_to_uptime_us(s_phases[i].tsc);
+			uint64_t magnitude = time < 0 ? -time : time;
+			char buf[22];
+			char* p = buf + sizeof(buf) - 1;
+			*p = '\0';
+			do {
+				*--p = '0' + (magnitude % 10);
+				magnitude /= 10;
+			} while(magnitude);
+			if(time < 0)
+				*--p = '-';
+			str += p;
+			str += " ";
+			str += s_phases[i].name;
+			str += "\n";
+		}
+		return str;
+	}
+}
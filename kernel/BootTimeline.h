@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+#include <kernel/kstd/string.h>
+
+// The most phases of booting that can be recorded
+#define BOOT_TIMELINE_MAX_PHASES 32
+
+/**
+ * Records when each phase of booting the kernel finished, so init can show where the time before it started went.
+ * Phases are recorded by the boot processor before anything else runs, so this doesn't need any locking.
+ */
+namespace BootTimeline {
+	/// Records that a phase of booting finished. The name must stay around forever, so it should be a string literal.
+	void mark(const char* phase);
+	/**
+	 * Formats each phase as a line with the number of microseconds on the monotonic clock when it finished, and its
+	 * name. Phases that finished before the clock started are negative.
+	 */
+	kstd::string to_string();
+}
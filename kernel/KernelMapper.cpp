@@ -24,11 +24,19 @@
 #include <kernel/memory/PageDirectory.h>
 #include <kernel/memory/MemoryManager.h>
 #include <kernel/kstd/KLog.h>
+#include <kernel/kstd/kstdlib.h>
+#include <kernel/memory/SafePointer.h>
 
-kstd::vector<KernelMapper::Symbol>* symbols = nullptr;
+KernelMapper::Symbol* symbols = nullptr;
+size_t* symbol_offsets = nullptr; ///< Where each symbol's line starts in the text read from /proc/kallsyms
+size_t num_symbols = 0;
+size_t symbols_text_size = 0;
 size_t lowest_addr = 0xFFFFFFFF;
 size_t highest_addr = 0x0;
 
+// Each line of the map is the address in hex, a space, the type, a space, and the name
+#define SYMBOL_LINE_LENGTH(name_len) (8 + 3 + (name_len) + 1)
+
 void KernelMapper::load_map() {
 #ifdef DUCKOS_KERNEL_DEBUG_SYMBOLS
 	KLog::dbg("KernelMapper", "Loading map...");
@@ -40,62 +48,137 @@ void KernelMapper::load_map() {
 		return;
 	}
 
-	//Read the map
+	//Read the map. It's kept around after, since the symbols' names point into it.
 	auto& fd = res.value();
 	ASSERT(fd->file()->is_inode());
 	size_t file_size = fd->metadata().size;
-	auto* filebuf = new uint8_t[file_size];
-	fd->read(KernelPointer<uint8_t>(filebuf), file_size);
-
-	symbols = new kstd::vector<Symbol>();
+	auto* filebuf = new char[file_size + 1];
+	fd->read(KernelPointer<uint8_t>((uint8_t*) filebuf), file_size);
+	filebuf[file_size] = '\n';
+
+	//Count the lines first, so the symbols can go in an array that's just the right size
+	size_t num_lines = 0;
+	for(size_t i = 0; i <= file_size; i++) {
+		if(filebuf[i] == '\n')
+			num_lines++;
+	}
+	symbols = new Symbol[num_lines];
 
 	//Interpret the map
 	size_t current_byte = 0;
-	while(current_byte < file_size) {
-		Symbol symbol = {nullptr, 0};
+	while(current_byte + SYMBOL_LINE_LENGTH(0) <= file_size && num_symbols < num_lines) {
+		Symbol symbol = {nullptr, 0, '?'};
 
-		//Parse the address of the symbol
+		//Parse the address and type of the symbol
 		for(int i = 0; i < 8; i++)
 			symbol.location |= parse_hex_char(filebuf[current_byte++]) << ((7 - i) * 4);
-
-		//Skip the three characters in the middle
+		symbol.type = filebuf[current_byte + 1];
 		current_byte += 3;
 
-		//Figure out how long the name is and copy it to the symbol
-		size_t name_len = 0;
-		while(filebuf[current_byte + name_len] != '\n')
-			name_len++;
-		symbol.name = new char[name_len + 1];
-		memcpy(symbol.name, &filebuf[current_byte], name_len);
-		symbol.name[name_len] = '\0';
-		current_byte += name_len + 1;
-
-		//Finally, add the symbol to the vector
-		symbols->push_back(symbol);
-		if(symbol.location > highest_addr)
-			highest_addr = symbol.location;
-		if(symbol.location < lowest_addr)
-			lowest_addr = symbol.location;
+		//The name runs to the end of the line, which gets terminated in place
+		symbol.name = &filebuf[current_byte];
+		while(filebuf[current_byte] != '\n')
+			current_byte++;
+		filebuf[current_byte++] = '\0';
+
+		symbols[num_symbols++] = symbol;
+	}
+
+	//nm sorts the map by address already, but make sure of it since lookups are a binary search
+	for(size_t i = 1; i < num_symbols; i++) {
+		auto symbol = symbols[i];
+		size_t j = i;
+		for(; j > 0 && symbols[j - 1].location > symbol.location; j--)
+			symbols[j] = symbols[j - 1];
+		symbols[j] = symbol;
 	}
 
-	//Optimize the size of the symbol list and free the buffer
-	delete[] filebuf;
-	symbols->shrink_to_fit();
+	symbol_offsets = new size_t[num_symbols];
+	for(size_t i = 0; i < num_symbols; i++) {
+		symbol_offsets[i] = symbols_text_size;
+		symbols_text_size += SYMBOL_LINE_LENGTH(strlen(symbols[i].name));
+	}
 
-	KLog::dbg("KernelMapper", "Map loaded with %d symbols between 0x%x and 0x%x", symbols->size(), lowest_addr, highest_addr);
+	if(num_symbols) {
+		lowest_addr = symbols[0].location;
+		highest_addr = symbols[num_symbols - 1].location;
+	}
+	KLog::dbg("KernelMapper", "Map loaded with %d symbols between 0x%x and 0x%x", num_symbols, lowest_addr, highest_addr);
 #endif
 }
 
 KernelMapper::Symbol* KernelMapper::get_symbol(size_t location) {
 #ifdef DUCKOS_KERNEL_DEBUG_SYMBOLS
-	if(!symbols || location > highest_addr || location < lowest_addr)
+	if(!symbols || location >= highest_addr || location < lowest_addr)
 		return nullptr;
-	for(int i = 0; i < symbols->size() - 1; i++) {
-		if(location < symbols->at(i+1).location)
-			return &symbols->at(i);
+
+	//Find the last symbol that starts at or before the location
+	size_t low = 0, high = num_symbols;
+	while(high - low > 1) {
+		size_t mid = low + (high - low) / 2;
+		if(symbols[mid].location <= location)
+			low = mid;
+		else
+			high = mid;
 	}
-#endif
+	return &symbols[low];
+#else
 	return nullptr;
+#endif
+}
+
+ssize_t KernelMapper::read_symbols(size_t start, size_t length, SafePointer<uint8_t> buffer) {
+#ifdef DUCKOS_KERNEL_DEBUG_SYMBOLS
+	if(!symbols || start >= symbols_text_size)
+		return 0;
+
+	//Find the line that the read starts in, and then format lines until the buffer is full
+	size_t low = 0, high = num_symbols;
+	while(high - low > 1) {
+		size_t mid = low + (high - low) / 2;
+		if(symbol_offsets[mid] <= start)
+			low = mid;
+		else
+			high = mid;
+	}
+
+	size_t nread = 0;
+	for(size_t i = low; i < num_symbols && nread < length; i++) {
+		auto& symbol = symbols[i];
+
+		//Write the address and type, and then the name straight from the map
+		char prefix[11];
+		for(int nibble = 0; nibble < 8; nibble++)
+			prefix[nibble] = nibble_to_hex((symbol.location >> ((7 - nibble) * 4)) & 0xF);
+		prefix[8] = ' ';
+		prefix[9] = symbol.type;
+		prefix[10] = ' ';
+
+		size_t name_len = strlen(symbol.name);
+		size_t pos = (i == low) ? start - symbol_offsets[i] : 0;
+		while(pos < SYMBOL_LINE_LENGTH(name_len) && nread < length) {
+			const char* part;
+			size_t part_len;
+			if(pos < 11) {
+				part = prefix + pos;
+				part_len = 11 - pos;
+			} else if(pos < 11 + name_len) {
+				part = symbol.name + (pos - 11);
+				part_len = 11 + name_len - pos;
+			} else {
+				part = "\n";
+				part_len = 1;
+			}
+			size_t count = min(part_len, length - nread);
+			buffer.write((const uint8_t*) part, nread, count);
+			nread += count;
+			pos += count;
+		}
+	}
+	return nread;
+#else
+	return 0;
+#endif
 }
 
 #define SYMBOLS_NOT_ENABLED_MESSAGE \
@@ -21,15 +21,26 @@
 
 #include <kernel/kstd/types.h>
 
+template<typename T>
+class SafePointer;
+
 class KernelMapper {
 public:
 	struct Symbol {
 		char* name;
 		size_t location;
+		char type; ///< The type of the symbol, as nm reports it (T for text, D for data, etc.)
 	};
 
+	/**
+	 * Loads the kernel's symbols from /boot/kernel.map into an array sorted by address. The names point into the map,
+	 * which is kept around instead of copying each of them.
+	 */
 	static void load_map();
+	/// Finds the symbol that an address is in with a binary search, or returns nullptr if it isn't in one.
 	static Symbol* get_symbol(size_t location);
+	/// Reads the symbols in the same format as the map they were loaded from. Used for /proc/kallsyms.
+	static ssize_t read_symbols(size_t start, size_t length, SafePointer<uint8_t> buffer);
 	static void print_stacktrace();
 	static void print_userspace_stacktrace();
 };
@@ -27,7 +27,7 @@
         auto res = (expr); \
         if (res.is_error()) \
             return res.result(); \
-        res.value(); \
+        kstd::move(res.value()); \
     })
 
 class Result {
@@ -47,7 +47,7 @@ template<typename T>
 class ResultRet {
 public:
 	ResultRet(Result error): _result(error) {};
-	ResultRet(T ret): _ret(ret), _result(0) {};
+	ResultRet(T ret): _ret(kstd::move(ret)), _result(0) {};
 	bool is_error() const {return _result.is_error();}
 	int code() const {return _result.code();}
 	Result result() const {return _result;}
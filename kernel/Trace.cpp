@@ -0,0 +1,178 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Trace.h"
+#include "CommandLine.h"
+#include <kernel/Atomic.h>
+#include <kernel/tasking/TaskManager.h>
+#include <kernel/tasking/Processor.h>
+#include <kernel/tasking/Thread.h>
+#include <kernel/tasking/Process.h>
+#include <kernel/time/TimeManager.h>
+#include <kernel/kstd/KLog.h>
+
+namespace Trace {
+	uint32_t g_enabled_mask = 0;
+
+	/*
+	 * The writer reserves a slot by bumping head, fills it in, and then bumps committed. The reader only takes events
+	 * below committed, and after copying one it checks that head hasn't lapped it, since that means it was overwritten
+	 * while being copied.
+	 */
+	struct Buffer {
+		trace_event* events = nullptr;
+		Atomic<uint32_t, MemoryOrder::SeqCst> head = 0;
+		Atomic<uint32_t, MemoryOrder::SeqCst> committed = 0;
+		uint32_t tail = 0; // Only touched by the reader
+	};
+
+	static Buffer s_buffers[MAX_PROCESSORS];
+	static SpinLock s_read_lock;
+
+	void init() {
+		if(!CommandLine::inst().has_option("trace"))
+			return;
+		auto& value = CommandLine::inst().get_option_value("trace");
+		uint32_t mask;
+		if(!parse_mask(value.c_str(), value.length(), mask)) {
+			KLog::warn("Trace", "Invalid tracepoint mask %s", value.c_str());
+			return;
+		}
+		set_enabled_mask(mask);
+	}
+
+	void set_enabled_mask(uint32_t mask) {
+		// The buffers are allocated the first time they're needed and kept around, so recording never has to allocate
+		for(int i = 0; mask && i < Processor::count(); i++) {
+			if(s_buffers[i].events)
+				continue;
+			auto* events = new trace_event[TRACE_BUFFER_SIZE];
+			TaskManager::ScopedCritical critical;
+			if(!s_buffers[i].events)
+				s_buffers[i].events = events;
+			else
+				delete[] events;
+		}
+		g_enabled_mask = mask;
+		KLog::info("Trace", "Tracepoint mask set to 0x%x", mask);
+	}
+
+	void record(uint16_t type, uint32_t a, uint32_t b, uint32_t c) {
+		uint32_t low, high;
+		asm volatile("rdtsc" : "=a"(low), "=d"(high));
+
+		TaskManager::ScopedCritical critical;
+		auto& cpu = Processor::current();
+		auto& buffer = s_buffers[cpu.id()];
+		if(!buffer.events)
+			return;
+
+		auto index = buffer.head.add(1);
+		auto& event = buffer.events[index % TRACE_BUFFER_SIZE];
+		// Keep the raw TSC for now, it's converted to nanoseconds when it's read
+		event.time = ((uint64_t) high << 32) | low;
+		event.type = type;
+		event.cpu = cpu.id();
+		auto* thread = cpu.current_thread.get();
+		event.pid = thread ? thread->process()->pid() : 0;
+		event.tid = thread ? thread->tid() : 0;
+		event.args[0] = a;
+		event.args[1] = b;
+		event.args[2] = c;
+		buffer.committed.store(index + 1);
+	}
+
+	/// Copies the oldest event out of a buffer without consuming it, unless it's a TRACE_LOST event. Returns false if the buffer is empty.
+	static bool peek(Buffer& buffer, trace_event& event) {
+		while(true) {
+			auto committed = buffer.committed.load();
+			if((int32_t) (committed - buffer.tail) <= 0)
+				return false;
+
+			// Skip over anything that's been overwritten, and tell the reader about it
+			auto head = buffer.head.load();
+			if(head - buffer.tail > TRACE_BUFFER_SIZE) {
+				auto lost = head - buffer.tail - TRACE_BUFFER_SIZE;
+				buffer.tail += lost;
+				event = {};
+				event.type = TRACE_LOST;
+				event.args[0] = lost;
+				return true;
+			}
+
+			event = buffer.events[buffer.tail % TRACE_BUFFER_SIZE];
+			if(buffer.head.load() - buffer.tail <= TRACE_BUFFER_SIZE)
+				return true;
+			// It got overwritten while we were copying it, so try again
+		}
+	}
+
+	ssize_t read(size_t length, SafePointer<uint8_t> buffer) {
+		LOCK(s_read_lock);
+		size_t count = length / sizeof(trace_event);
+		size_t nread = 0;
+		while(nread < count) {
+			// Take whichever processor's oldest event is the oldest
+			trace_event event;
+			int oldest_cpu = -1;
+			for(int i = 0; i < MAX_PROCESSORS; i++) {
+				if(!s_buffers[i].events)
+					continue;
+				trace_event candidate;
+				bool found;
+				{
+					TaskManager::ScopedCritical critical;
+					found = peek(s_buffers[i], candidate);
+				}
+				if(!found)
+					continue;
+				candidate.cpu = i;
+				if(oldest_cpu == -1 || candidate.type == TRACE_LOST || candidate.time < event.time) {
+					event = candidate;
+					oldest_cpu = i;
+					if(candidate.type == TRACE_LOST)
+						break;
+				}
+			}
+			if(oldest_cpu == -1)
+				break;
+
+			if(event.type != TRACE_LOST) {
+				s_buffers[oldest_cpu].tail++;
+				event.time = TimeManager::tsc_to_uptime_ns(event.time);
+			}
+			buffer.write((uint8_t*) &event, nread * sizeof(trace_event), sizeof(trace_event));
+			nread++;
+		}
+		return nread * sizeof(trace_event);
+	}
+
+	bool parse_mask(const char* str, size_t length, uint32_t& mask) {
+		while(length && (str[length - 1] == '\n' || str[length - 1] == ' '))
+			length--;
+		if(length == 3 && str[0] == 'a' && str[1] == 'l' && str[2] == 'l') {
+			mask = (1u << TRACE_NUM_TRACEPOINTS) - 1;
+			return true;
+		}
+
+		bool hex = length > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X');
+		size_t i = hex ? 2 : 0;
+		if(i == length)
+			return false;
+		mask = 0;
+		for(; i < length; i++) {
+			char c = str[i];
+			uint32_t digit;
+			if(c >= '0' && c <= '9')
+				digit = c - '0';
+			else if(hex && c >= 'a' && c <= 'f')
+				digit = c - 'a' + 10;
+			else if(hex && c >= 'A' && c <= 'F')
+				digit = c - 'A' + 10;
+			else
+				return false;
+			mask = mask * (hex ? 16 : 10) + digit;
+		}
+		return true;
+	}
+}
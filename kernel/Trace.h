@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+#include <kernel/api/trace.h>
+#include <kernel/memory/SafePointer.h>
+
+// The number of events in each processor's trace buffer
+#define TRACE_BUFFER_SIZE 1024
+
+/**
+ * Records a tracepoint if it's enabled. When it isn't, this costs a load and a branch, so it's fine for hot paths.
+ * The type must be one of the TRACE_ constants in api/trace.h.
+ */
+#define TRACE(type, ...) \
+	do { \
+		static_assert((type) < TRACE_NUM_TRACEPOINTS, "Unknown tracepoint"); \
+		if(__builtin_expect(Trace::g_enabled_mask & (1u << (type)), 0)) \
+			Trace::record((type), ##__VA_ARGS__); \
+	} while(0)
+
+/**
+ * A binary trace of kernel events. Each processor records into its own ring buffer with interrupts disabled, so
+ * recording never takes a lock or allocates. When a buffer fills up, the oldest events are overwritten and the reader
+ * is told how many it missed.
+ */
+namespace Trace {
+	extern uint32_t g_enabled_mask;
+
+	/// Enables the tracepoints given by the trace= kernel option, if any.
+	void init();
+	/// Sets which tracepoints are enabled, with one bit per TRACE_ constant.
+	void set_enabled_mask(uint32_t mask);
+	void record(uint16_t type, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0);
+	/// Reads and consumes as many whole events as fit into the buffer.
+	ssize_t read(size_t length, SafePointer<uint8_t> buffer);
+	/// Parses a tracepoint mask written by the user: a decimal or 0x-prefixed hex number, or "all".
+	bool parse_mask(const char* str, size_t length, uint32_t& mask);
+}
@@ -52,5 +52,12 @@
 #define F_GETLK 6
 #define F_SETLK 7
 #define F_SETLKW 8
+#define F_SETPIPE_SZ 1031
+#define F_GETPIPE_SZ 1032
+#define F_SETSOCK_SZ 1033
+#define F_GETSOCK_SZ 1034
 
-#define FD_CLOEXEC 1
\ No newline at end of file
+#define FD_CLOEXEC 1
+
+#define AT_FDCWD -100
+#define AT_SYMLINK_NOFOLLOW 0x100
\ No newline at end of file
@@ -0,0 +1,21 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "types.h"
+#include "time.h"
+
+__DECL_BEGIN
+
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+
+struct futex_args {
+	int* addr;
+	int op;
+	int val;
+	const struct timespec* timeout; ///< How long FUTEX_WAIT waits for, or NULL to wait forever.
+};
+
+__DECL_END
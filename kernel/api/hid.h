@@ -22,9 +22,31 @@ struct keyboard_event {
 	uint8_t modifiers;
 };
 
+// The types of event read from /dev/input/events
+#define INPUT_EVENT_MOUSE 1
+#define INPUT_EVENT_KEYBOARD 2
+
+// ioctl for /dev/input/events. With a nonzero argument, runs of mouse movement that pile up because the reader has fallen
+// behind are read as one event (with the time of the first one). Off by default.
+#define INPUT_SET_COALESCE 0x9101
+
+/**
+ * An event from /dev/input/events, which has the events from every input device in the order they happened. Each read
+ * returns as many whole events as fit in the buffer.
+ */
+struct input_event {
+	uint64_t time; // When the event came in, in microseconds since boot (the same clock as CLOCK_MONOTONIC)
+	int type;
+	union {
+		struct mouse_event mouse;
+		struct keyboard_event keyboard;
+	};
+};
+
 #ifdef __cplusplus
 typedef struct mouse_event MouseEvent;
 typedef struct keyboard_event KeyboardEvent;
+typedef struct input_event InputEvent;
 #endif
 
 __DECL_END
\ No newline at end of file
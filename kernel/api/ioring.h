@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "types.h"
+
+__DECL_BEGIN
+
+/*
+ * A ring is a block of memory shared between a process and the kernel. It starts with a struct ioring_header, which is
+ * followed by the submission queue (entries struct ioring_sqes) and then the completion queue (IORING_CQ_ENTRIES(entries)
+ * struct ioring_cqes). The process fills in submissions and moves sq_tail forward, and the kernel consumes them and
+ * moves sq_head forward when ioring_enter() is called. Completions are posted the other way around.
+ *
+ * The head and tail indices only ever count up, and are masked with the size of their queue to get a slot.
+ */
+
+#define IORING_MAX_ENTRIES 4096
+#define IORING_CQ_ENTRIES(entries) ((entries) * 2)
+#define IORING_SIZE(entries) (sizeof(struct ioring_header) + (entries) * sizeof(struct ioring_sqe) + IORING_CQ_ENTRIES(entries) * sizeof(struct ioring_cqe))
+#define IORING_SQES(header) ((struct ioring_sqe*) ((header) + 1))
+#define IORING_CQES(header) ((struct ioring_cqe*) (IORING_SQES(header) + (header)->entries))
+
+#define IORING_OP_NOP 0
+#define IORING_OP_READ 1     ///< Reads len bytes into addr, at off or at the file's offset if off is -1.
+#define IORING_OP_WRITE 2    ///< Writes len bytes from addr, at off or at the file's offset if off is -1.
+#define IORING_OP_POLL 3     ///< Completes with the events that happened once one of op_flags (POLLIN/POLLOUT) does.
+#define IORING_OP_READDIR 4  ///< Reads directory entries into addr, like readdir().
+#define IORING_OP_OPENAT 5   ///< Opens the path at addr relative to the directory fd (or AT_FDCWD). op_flags are the open options and off is the mode.
+#define IORING_OP_CLOSE 6
+#define IORING_OP_SEND 7     ///< Sends the SocketFS packet at addr.
+#define IORING_OP_RECV 8     ///< Receives a SocketFS packet into addr.
+
+/// Set in an ioring_cqe's flags if completions were dropped before it because the completion queue was full.
+#define IORING_CQE_F_OVERFLOW 0x1
+
+/// Wait for at least min_complete completions to be posted before ioring_enter() returns.
+#define IORING_ENTER_GETEVENTS 0x1
+
+struct ioring_sqe {
+	uint8_t opcode;
+	uint8_t reserved[3];
+	int fd;
+	int64_t off;
+	void* addr;
+	uint32_t len;
+	uint32_t op_flags;
+	uint64_t user_data; ///< Passed back unchanged in the completion.
+};
+
+struct ioring_cqe {
+	uint64_t user_data;
+	int32_t res; ///< What the equivalent syscall would have returned, with errors as negative error codes.
+	uint32_t flags;
+};
+
+struct ioring_header {
+	uint32_t sq_head; ///< Moved by the kernel.
+	uint32_t sq_tail; ///< Moved by the process.
+	uint32_t cq_head; ///< Moved by the process.
+	uint32_t cq_tail; ///< Moved by the kernel.
+	uint32_t entries; ///< The number of submission slots. Filled in by ioring_setup().
+	uint32_t cq_overflow; ///< The number of completions dropped because the completion queue was full.
+};
+
+struct ioring_params {
+	void* ring; ///< Memory of at least IORING_SIZE(entries) bytes to use for the ring.
+	uint32_t entries; ///< A power of two no bigger than IORING_MAX_ENTRIES.
+};
+
+__DECL_END
@@ -19,9 +19,15 @@
 #define MAP_FILE		0x0
 #define MAP_FIXED		0x4
 #define MAP_GROWSDOWN	0x8
+#define MAP_NORESERVE	0x10
+#define MAP_POPULATE	0x20
 
 #define MAP_FAILED ((void*) -1)
 
+#define MADV_NORMAL		0
+#define MADV_WILLNEED	3
+#define MADV_DONTNEED	4
+
 __DECL_BEGIN
 
 struct mmap_args {
@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "types.h"
+
+__DECL_BEGIN
+
+// ioctls for /dev/prefetch
+#define PREFETCH_RECORD_START 0x9101 // Starts recording. The argument is the pid to record (along with the processes it
+                                     // starts from then on), or zero to record every process.
+#define PREFETCH_RECORD_STOP 0x9102
+
+// The most pages recorded at once. Pages accessed after that are left out.
+#define PREFETCH_MAX_ENTRIES 32768
+
+/**
+ * A page of a file on the root filesystem that was accessed while recording. Reading /dev/prefetch gives the pages
+ * recorded since recording last started in the order they were first accessed, and writing a list of these to it
+ * reads them into the page cache in the background.
+ */
+struct prefetch_entry {
+	ino_t ino;
+	uint32_t page;
+};
+
+__DECL_END
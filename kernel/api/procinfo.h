@@ -0,0 +1,32 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "types.h"
+
+__DECL_BEGIN
+
+#define PROC_INFO_NAME_MAX 64
+
+/**
+ * A snapshot of a process, as listed in /proc/procs. Reading /proc/procs gives one of these for each process, so the
+ * whole process table can be read at once instead of going through /proc/<pid>/status for each process.
+ */
+struct proc_info {
+	pid_t pid;
+	pid_t ppid;
+	uid_t uid;
+	gid_t gid;
+	int state; // The same as the state in /proc/<pid>/status
+	int nice;
+	size_t pmem; // Private anonymous memory that's mapped in, in bytes
+	size_t vmem; // All of the address space that's in use
+	size_t shmem; // Shared anonymous memory that's mapped in
+	size_t file_mem; // Memory mapped in from files
+	size_t rss; // All memory that's mapped in, including the above
+	uint64_t cpu_time; // Microseconds all of its threads have spent running, so usage can be worked out between reads
+	char name[PROC_INFO_NAME_MAX]; // Cut off (but still null-terminated) if it's too long
+};
+
+__DECL_END
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "types.h"
+
+__DECL_BEGIN
+
+// ioctls for /dev/profile
+#define PROFILE_START 0x9001 // Starts sampling. The argument is the pid to sample, or zero to sample everything.
+#define PROFILE_STOP 0x9002
+
+// The most return addresses recorded in each sample, including the address that was interrupted
+#define PROFILE_MAX_FRAMES 16
+
+// Flags for profile_sample
+#define PROFILE_SAMPLE_LOST 0x1 // The sample with this sequence number was overwritten before it was read
+#define PROFILE_SAMPLE_KERNEL 0x2 // The processor was running kernel code
+
+/**
+ * A sample taken by the profiler on a timer interrupt. /dev/profile is a stream of these, where the sample at offset
+ * n * sizeof(struct profile_sample) is the sample with sequence number n. Reads return nothing once they catch up to
+ * the newest sample. frames[0] is the address that was interrupted, followed by the return addresses found by
+ * following the frame pointers.
+ */
+struct profile_sample {
+	uint64_t seq;
+	uint64_t time; // Microseconds since boot
+	pid_t pid;
+	tid_t tid;
+	uint32_t flags;
+	uint32_t num_frames;
+	uint32_t frames[PROFILE_MAX_FRAMES];
+};
+
+__DECL_END
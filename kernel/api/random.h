@@ -0,0 +1,9 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+// Flags for getrandom(). The kernel's generator never blocks, so these are accepted for compatibility but don't change
+// anything.
+#define GRND_NONBLOCK 0x1
+#define GRND_RANDOM 0x2
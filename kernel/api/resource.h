@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "types.h"
+#include "time.h"
+
+__DECL_BEGIN
+
+// Values for the which argument of getpriority() / setpriority()
+#define PRIO_PROCESS 0
+#define PRIO_PGRP 1
+#define PRIO_USER 2
+
+// Nice values range from PRIO_MIN up to (but not including) PRIO_MAX. Lower values mean a higher priority.
+#define PRIO_MIN (-20)
+#define PRIO_MAX 20
+
+// Values for the who argument of getrusage()
+#define RUSAGE_SELF 0
+#define RUSAGE_CHILDREN (-1)
+
+struct rusage {
+	struct timeval ru_utime; // Time spent running in userspace
+	struct timeval ru_stime; // Time spent running in the kernel
+};
+
+__DECL_END
@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "types.h"
+
+__DECL_BEGIN
+
+// A processor affinity mask, with one bit per processor
+#define CPU_SETSIZE 32
+typedef struct {
+	uint32_t mask;
+} cpu_set_t;
+
+#define CPU_ZERO(set) ((set)->mask = 0)
+#define CPU_SET(cpu, set) ((set)->mask |= (1u << (cpu)))
+#define CPU_CLR(cpu, set) ((set)->mask &= ~(1u << (cpu)))
+#define CPU_ISSET(cpu, set) (((set)->mask >> (cpu)) & 1u)
+
+// The types of events in /proc/schedtrace
+#define SCHED_TRACE_LOST 0 // The event with this sequence number was overwritten before it was read
+#define SCHED_TRACE_SWITCH 1 // The processor switched from pid/tid to next_pid/next_tid
+#define SCHED_TRACE_WAKEUP 2 // pid/tid became runnable and was queued
+#define SCHED_TRACE_BLOCK 3 // pid/tid blocked
+
+/**
+ * An event in the scheduler trace. /proc/schedtrace is a stream of these, where the event at offset
+ * n * sizeof(struct sched_trace_event) is the event with sequence number n. Reads return nothing once they catch up to
+ * the newest event.
+ */
+struct sched_trace_event {
+	uint64_t seq;
+	uint64_t time; // Microseconds since boot
+	uint32_t type;
+	pid_t pid;
+	tid_t tid;
+	pid_t next_pid;
+	tid_t next_tid;
+	int priority;
+};
+
+__DECL_END
@@ -8,6 +8,7 @@
 #define SHM_READ 0x1u
 #define SHM_WRITE 0x2u
 #define SHM_SHARE 0x4u
+#define SHM_TRANSFER 0x8u
 
 __DECL_BEGIN
 
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "types.h"
+
+__DECL_BEGIN
+
+// ioctls for sound devices
+#define SOUND_SET_BUFFERS 0x9101 // Sets how many writes can be queued before more block. The argument is the number of buffers.
+#define SOUND_GET_STATUS 0x9102 // Fills in the sound_status pointed to by the argument.
+
+/**
+ * The state of a sound device's output. Each write is queued as its own buffer (of up to a page), so the latency of
+ * the output is about max_buffers writes' worth of samples, and queued_samples / sample_rate exactly.
+ */
+struct sound_status {
+	uint64_t played_samples; // How many samples have been played since boot, including the one playing now
+	uint32_t queued_samples; // How many samples have been written but not played yet
+	uint32_t sample_rate;
+	uint32_t max_buffers; // How many buffers can be queued at once, set with SOUND_SET_BUFFERS
+	uint32_t underruns; // How many times the output ran out of samples to play and stopped
+	uint32_t fifo_errors;
+};
+
+__DECL_END
@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "types.h"
+
+//Flags for posix_spawnattr_setflags
+#define POSIX_SPAWN_SETPGROUP 0x1
+
+//The types of file action a spawned process has done to it before it starts
+#define SPAWN_ACTION_DUP2 1
+#define SPAWN_ACTION_CLOSE 2
+#define SPAWN_ACTION_CHDIR 3
+
+__DECL_BEGIN
+
+struct spawn_file_action {
+	int type;
+	int fd;
+	int new_fd;
+	const char* path;
+};
+
+struct spawn_args {
+	const char* path;
+	char* const* argv;
+	char* const* envp;
+	const struct spawn_file_action* actions;
+	int num_actions;
+	int flags;
+	pid_t pgroup;
+};
+
+__DECL_END
@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "types.h"
+
+// Accepted for compatibility. Pages are always moved when they can be, and splice() always blocks unless the pipe is
+// non-blocking.
+#define SPLICE_F_MOVE		0x1
+#define SPLICE_F_NONBLOCK	0x2
+#define SPLICE_F_MORE		0x4
+#define SPLICE_F_GIFT		0x8
+
+__DECL_BEGIN
+
+struct splice_args {
+	int fd_in;
+	off_t* off_in;
+	int fd_out;
+	off_t* off_out;
+	size_t len;
+	unsigned int flags;
+};
+
+__DECL_END
@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "stdint.h"
+
+__DECL_BEGIN
+
+// The kernel maps the time page read-only at this address in every userspace process (the top page of userspace).
+#define TIME_PAGE_ADDR 0xBFFFF000
+
+/*
+ * What userspace needs to tell the time without a syscall. The current time in microseconds since the epoch is
+ * boot_epoch * 1000000 + (rdtsc - tsc_base) * 1000000 / tsc_hz.
+ *
+ * The kernel makes seq odd while it's updating the page, so readers should read seq, read the rest of the page, and
+ * then start over if seq was odd or has changed since.
+ */
+struct time_page {
+	volatile uint32_t seq;
+	uint32_t reserved;
+	uint64_t tsc_hz; // Zero if the kernel hasn't measured the TSC, in which case the syscall has to be used.
+	uint64_t tsc_base; // The TSC at uptime zero.
+	int64_t boot_epoch; // The time since the epoch at boot, in seconds.
+};
+
+__DECL_END
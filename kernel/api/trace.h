@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "types.h"
+
+__DECL_BEGIN
+
+/*
+ * The kernel's tracepoints. Each one can be enabled by setting its bit in the mask written to /proc/trace (or passed
+ * with the trace= kernel option). The meanings of each event's arguments are listed next to it.
+ */
+#define TRACE_SCHED_SWITCH 0 // The processor switched to another thread. a = next pid, b = next tid
+#define TRACE_PAGE_FAULT 1 // a = faulting address, b = error code, c = eip
+#define TRACE_BLOCK_IO_START 2 // a = 0 for a read or 1 for a write, b = first block, c = number of blocks
+#define TRACE_BLOCK_IO_DONE 3 // a = 0 for a read or 1 for a write, b = first block, c = result
+#define TRACE_SOCKET_SEND 4 // A socketfs packet was queued. a = recipient id, b = packet type, c = length
+#define TRACE_SOCKET_RECV 5 // A socketfs client read from its queue. a = reader id, c = bytes read
+#define TRACE_SYSCALL_ENTER 6 // a = syscall number, b = first argument, c = second argument
+#define TRACE_SYSCALL_EXIT 7 // a = syscall number, b = return value
+#define TRACE_NUM_TRACEPOINTS 8
+
+// Not a tracepoint, but an event saying that the processor's buffer filled up and a events were dropped
+#define TRACE_LOST 0xFFFF
+
+/**
+ * An event read from /proc/trace. Reading the file consumes events from every processor's buffer, oldest first.
+ */
+struct trace_event {
+	uint64_t time; // Nanoseconds since boot
+	uint16_t type;
+	uint16_t cpu;
+	pid_t pid;
+	tid_t tid;
+	uint32_t args[3];
+};
+
+__DECL_END
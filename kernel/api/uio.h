@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "types.h"
+
+__DECL_BEGIN
+
+#define IOV_MAX 1024
+
+struct iovec {
+	void* iov_base;
+	size_t iov_len;
+};
+
+struct iov_args {
+	int fd;
+	const struct iovec* iov;
+	int iovcnt;
+	off_t offset;
+};
+
+__DECL_END
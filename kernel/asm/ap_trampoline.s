@@ -0,0 +1,85 @@
+; The code that application processors start running in real mode after the startup IPI. It's copied to
+; AP_TRAMPOLINE_ADDR, so everything in it is addressed relative to there instead of where it's linked.
+; The boot processor fills in the parameters at the end before starting each processor.
+
+[global ap_trampoline_start]
+[global ap_trampoline_params]
+[global ap_trampoline_end]
+[extern ap_main]
+
+AP_TRAMPOLINE_ADDR equ 0x1000
+%define TRAMPOLINE(label) (AP_TRAMPOLINE_ADDR + (label - ap_trampoline_start))
+
+section .text
+[bits 16]
+ap_trampoline_start:
+    cli
+    cld
+    xor ax, ax
+    mov ds, ax
+
+    ;Load the temporary GDT and switch to protected mode
+    lgdt [TRAMPOLINE(ap_gdt_pointer)]
+    mov eax, cr0
+    or eax, 1
+    mov cr0, eax
+    jmp dword 0x08:TRAMPOLINE(ap_protected_mode)
+
+[bits 32]
+ap_protected_mode:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    ;Turn on 4MiB pages, then paging with the page directory we were given, which maps this page and the kernel
+    mov eax, cr4
+    or eax, 1 << 4
+    mov cr4, eax
+    mov eax, [TRAMPOLINE(ap_page_directory)]
+    mov cr3, eax
+    mov eax, cr0
+    or eax, 0x80010000
+    mov cr0, eax
+
+    ;Turn on SSE, the same way the boot processor did in startup.s
+    mov eax, 0x1
+    cpuid
+    test edx, 1<<25
+    jz ap_no_sse
+    mov eax, cr0
+    and ax, 0xFFFB
+    or ax, 0x2
+    mov cr0, eax
+    mov eax, cr4
+    or ax, 3 << 9
+    mov cr4, eax
+ap_no_sse:
+
+    ;Jump up to the kernel, which is mapped in the higher half
+    mov esp, [TRAMPOLINE(ap_stack)]
+    push dword [TRAMPOLINE(ap_processor)]
+    mov eax, ap_main
+    call eax
+    jmp $
+
+align 8
+ap_gdt:
+    dq 0                    ;Null
+    dq 0x00CF9A000000FFFF   ;Code
+    dq 0x00CF92000000FFFF   ;Data
+ap_gdt_pointer:
+    dw ap_gdt_pointer - ap_gdt - 1
+    dd TRAMPOLINE(ap_gdt)
+
+align 4
+ap_trampoline_params:
+ap_page_directory:
+    dd 0
+ap_stack:
+    dd 0
+ap_processor:
+    dd 0
+ap_trampoline_end:
@@ -150,6 +150,74 @@ irq 12
 irq 13
 irq 14
 irq 15
+irq 16
+irq 17
+irq 18
+irq 19
+irq 20
+irq 21
+irq 22
+irq 23
+irq 24
+irq 25
+irq 26
+irq 27
+irq 28
+irq 29
+irq 30
+irq 31
+irq 32
+irq 33
+irq 34
+irq 35
+irq 36
+irq 37
+irq 38
+irq 39
+irq 40
+irq 41
+irq 42
+irq 43
+irq 44
+irq 45
+irq 46
+irq 47
+
+; The stubs for the IRQs that are given out to message-signaled interrupts, in order
+global msi_irq_stubs
+msi_irq_stubs:
+	dd irq16
+	dd irq17
+	dd irq18
+	dd irq19
+	dd irq20
+	dd irq21
+	dd irq22
+	dd irq23
+	dd irq24
+	dd irq25
+	dd irq26
+	dd irq27
+	dd irq28
+	dd irq29
+	dd irq30
+	dd irq31
+	dd irq32
+	dd irq33
+	dd irq34
+	dd irq35
+	dd irq36
+	dd irq37
+	dd irq38
+	dd irq39
+	dd irq40
+	dd irq41
+	dd irq42
+	dd irq43
+	dd irq44
+	dd irq45
+	dd irq46
+	dd irq47
 
 [extern irq_handler]
 
@@ -24,3 +24,47 @@ asm_syscall_handler:
     popa
     add esp, 8
     iret
+
+;Entered with sysenter, with esp pointing to the esp0 field of the processor's TSS. Userspace passes its stack pointer in
+;ebp and the address to return to in esi; we build the same Registers struct as the interrupt path so the rest of the
+;kernel can't tell the difference, and return with sysexit, which clobbers ecx and edx.
+global asm_sysenter_handler
+asm_sysenter_handler:
+    mov esp, [esp]
+    push 0x23 ;ss
+    push ebp ;useresp
+    pushf
+    or dword [esp], 0x200 ;sysenter cleared IF, but userspace had it set
+    push 0x1B ;cs
+    push esi ;eip
+    push 0
+    push 0
+    pusha
+    push ds
+    push es
+    push fs
+    push gs
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    sti
+    push esp
+    call syscall_handler
+    add esp, 4
+    cli
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    popa
+    add esp, 8
+    mov edx, [esp] ;eip
+    mov ecx, [esp + 12] ;useresp
+    and dword [esp + 8], ~0x200 ;keep interrupts off until sysexit
+    add esp, 8
+    popf
+    add esp, 8
+    sti ;takes effect after the next instruction, so we can't be interrupted before sysexit
+    sysexit
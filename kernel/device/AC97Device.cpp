@@ -41,7 +41,7 @@ ResultRet<kstd::Arc<AC97Device>> AC97Device::detect() {
 }
 
 AC97Device::AC97Device(PCI::Address address):
-	CharacterDevice(69, 2),
+	CharacterDevice(AC97_MAJOR, AC97_MINOR),
 	IRQHandler(PCI::read_byte(address, PCI_INTERRUPT_LINE)),
 	m_address(address),
 	m_mixer_address(PCI::read_word(address, PCI_BAR0) & ~1),
@@ -51,8 +51,9 @@ AC97Device::AC97Device(PCI::Address address):
 	m_output_buffer_descriptor_region(MM.alloc_dma_region(sizeof(BufferDescriptor) * AC97_NUM_BUFFER_DESCRIPTORS)),
 	m_output_buffer_descriptors((BufferDescriptor*) m_output_buffer_descriptor_region->start())
 {
-	//Enable bus mastering and interrupts
-	PCI::enable_interrupt(m_address);
+	//Enable bus mastering and interrupts, preferring a message-signaled interrupt to the shared line
+	if(!use_msi(m_address))
+		PCI::enable_interrupt(m_address);
 	PCI::enable_bus_mastering(m_address);
 
 	//Initialize the card with cold reset of bus and mixer, enable interrupts
@@ -82,16 +83,8 @@ ssize_t AC97Device::write(FileDescriptor& fd, size_t, SafePointer<uint8_t> buffe
 	while(count) {
 		//Wait until we have a free buffer to write to
 		do {
-			//Read the status, current index, and last valid index
 			TaskManager::ScopedCritical critical;
-			auto status_byte = IO::inw(m_output_channel + ChannelRegisters::STATUS);
-			BufferStatus status = {.value = status_byte};
-			auto current_index = IO::inb(m_output_channel + ChannelRegisters::CURRENT_INDEX);
-			auto last_valid_index = IO::inb(m_output_channel + ChannelRegisters::LAST_VALID_INDEX);
-			auto num_buffers_left = last_valid_index >= current_index ? last_valid_index - current_index : AC97_NUM_BUFFER_DESCRIPTORS - (current_index - last_valid_index);
-			if(!status.is_halted)
-				num_buffers_left++;
-			if(num_buffers_left < AC97_NUM_BUFFER_DESCRIPTORS)
+			if(num_buffers_queued() < m_max_buffers)
 				break;
 			critical.exit();
 			m_blocker.set_ready(false);
@@ -110,6 +103,7 @@ ssize_t AC97Device::write(FileDescriptor& fd, size_t, SafePointer<uint8_t> buffe
 		buffer.read((uint8_t*) output_buffer, n_written, num_bytes);
 		count -= num_bytes;
 		n_written += num_bytes;
+		m_written_samples += num_bytes / sizeof(uint32_t);
 
 		//Create the buffer descriptor
 		auto* descriptor = &m_output_buffer_descriptors[m_current_buffer_descriptor];
@@ -139,13 +133,64 @@ ssize_t AC97Device::write(FileDescriptor& fd, size_t, SafePointer<uint8_t> buffe
 	return n_written;
 }
 
+bool AC97Device::can_write(const FileDescriptor& fd) {
+	//A write won't block as long as there's a buffer descriptor free, which handle_irq lets pollers know about
+	return !m_output_dma_enabled || num_buffers_queued() < m_max_buffers;
+}
+
+int AC97Device::ioctl(unsigned request, SafePointer<void*> argp) {
+	switch(request) {
+		case SOUND_SET_BUFFERS: {
+			auto num_buffers = (size_t) argp.raw();
+			if(num_buffers < 1 || num_buffers > AC97_NUM_BUFFER_DESCRIPTORS)
+				return -EINVAL;
+			m_max_buffers = num_buffers;
+			m_poll_queue.wake();
+			m_blocker.set_ready(true);
+			return SUCCESS;
+		}
+		case SOUND_GET_STATUS:
+			SafePointer<sound_status>(argp).set(status());
+			return SUCCESS;
+		default:
+			return -EINVAL;
+	}
+}
+
+sound_status AC97Device::status() {
+	TaskManager::ScopedCritical critical;
+	uint32_t queued = 0;
+	if(m_output_dma_enabled) {
+		BufferStatus buffer_status = {.value = IO::inw(m_output_channel + ChannelRegisters::STATUS)};
+		if(!buffer_status.is_halted) {
+			//The position register counts down the 16-bit samples left in the current buffer, and everything up to the last valid one is still to come
+			auto current_index = IO::inb(m_output_channel + ChannelRegisters::CURRENT_INDEX);
+			auto last_valid_index = IO::inb(m_output_channel + ChannelRegisters::LAST_VALID_INDEX);
+			queued = IO::inw(m_output_channel + ChannelRegisters::BUFFER_POSITION);
+			for(auto i = (current_index + 1) % AC97_NUM_BUFFER_DESCRIPTORS; i != (last_valid_index + 1) % AC97_NUM_BUFFER_DESCRIPTORS; i = (i + 1) % AC97_NUM_BUFFER_DESCRIPTORS)
+				queued += m_output_buffer_descriptors[i].num_samples;
+			queued /= 2;
+		}
+	}
+	return {
+		.played_samples = m_written_samples - queued,
+		.queued_samples = queued,
+		.sample_rate = m_sample_rate,
+		.max_buffers = m_max_buffers,
+		.underruns = m_underruns,
+		.fifo_errors = m_fifo_errors
+	};
+}
+
 void AC97Device::handle_irq(Registers *regs) {
 	//Read the status
 	auto status_byte = IO::inw(m_output_channel + ChannelRegisters::STATUS);
 	BufferStatus status = {.value = status_byte};
 
-	if(status.fifo_error)
+	if(status.fifo_error) {
 		KLog::err("AC97", "Encountered FIFO error!");
+		m_fifo_errors++;
+	}
 
 	//If we're not done, don't do anything
 	if(!status.completion_interrupt_status)
@@ -160,9 +205,24 @@ void AC97Device::handle_irq(Registers *regs) {
 	auto current_index = IO::inb(m_output_channel + ChannelRegisters::CURRENT_INDEX);
 	auto last_valid_index = IO::inb(m_output_channel + ChannelRegisters::LAST_VALID_INDEX);
 	if(last_valid_index == current_index) {
+		//We ran out of buffers to play, so the output stops until the next write
 		reset_output();
+		m_underruns++;
 	}
 	m_blocker.set_ready(true);
+	m_poll_queue.wake();
+}
+
+size_t AC97Device::num_buffers_queued() {
+	//Read the status, current index, and last valid index
+	auto status_byte = IO::inw(m_output_channel + ChannelRegisters::STATUS);
+	BufferStatus status = {.value = status_byte};
+	auto current_index = IO::inb(m_output_channel + ChannelRegisters::CURRENT_INDEX);
+	auto last_valid_index = IO::inb(m_output_channel + ChannelRegisters::LAST_VALID_INDEX);
+	size_t num_buffers_left = last_valid_index >= current_index ? last_valid_index - current_index : AC97_NUM_BUFFER_DESCRIPTORS - (current_index - last_valid_index);
+	if(!status.is_halted)
+		num_buffers_left++;
+	return num_buffers_left;
 }
 
 //Channel
@@ -23,11 +23,14 @@
 #include <kernel/Result.hpp>
 #include <kernel/pci/PCI.h>
 #include <kernel/interrupt/IRQHandler.h>
+#include <kernel/api/sound.h>
 
 #define AC97_PCI_CLASS 0x4u
 #define AC97_PCI_SUBCLASS 0x1u
 #define AC97_OUTPUT_BUFFER_PAGES 32
 #define AC97_NUM_BUFFER_DESCRIPTORS 32
+#define AC97_MAJOR 69
+#define AC97_MINOR 2
 
 class AC97Device: public CharacterDevice, public IRQHandler {
 public:
@@ -100,6 +103,11 @@ public:
 	//File
 	ssize_t read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
 	ssize_t write(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
+	bool can_write(const FileDescriptor& fd) override;
+	int ioctl(unsigned request, SafePointer<void*> argp) override;
+
+	/** Gets the state of the output, which is also what SOUND_GET_STATUS gives. **/
+	sound_status status();
 
 	//IRQHandler
 	void handle_irq(Registers* regs) override;
@@ -112,6 +120,8 @@ private:
 	}
 
 	void reset_output();
+	/** How many buffer descriptors the card hasn't finished playing yet. **/
+	size_t num_buffers_queued();
 	void set_sample_rate(uint32_t sample_rate);
 
 	PCI::Address m_address;
@@ -121,9 +131,13 @@ private:
 	BufferDescriptor* m_output_buffer_descriptors;
 	uint32_t m_current_output_buffer_page = 0;
 	uint32_t m_current_buffer_descriptor = 0;
+	uint32_t m_max_buffers = AC97_NUM_BUFFER_DESCRIPTORS;
 	bool m_output_dma_enabled = false;
 	BooleanBlocker m_blocker;
 	uint32_t m_sample_rate;
+	uint64_t m_written_samples = 0;
+	uint32_t m_underruns = 0;
+	uint32_t m_fifo_errors = 0;
 };
 
 
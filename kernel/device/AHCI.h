@@ -0,0 +1,149 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+#include <kernel/api/page_size.h>
+
+//PCI
+#define PCI_TYPE_SATA_CONTROLLER 0x0106
+#define PCI_PROG_IF_AHCI 0x1
+#define AHCI_ABAR PCI_BAR5
+
+//Generic host control registers
+#define AHCI_CAP  0x00
+#define AHCI_GHC  0x04
+#define AHCI_IS   0x08
+#define AHCI_PI   0x0C
+#define AHCI_VS   0x10
+#define AHCI_CAP2 0x24
+#define AHCI_BOHC 0x28
+
+#define AHCI_CAP_NP(cap)  ((cap) & 0x1Fu)
+#define AHCI_CAP_NCS(cap) (((cap) >> 8u) & 0x1Fu)
+#define AHCI_CAP_SNCQ     (1u << 30u)
+#define AHCI_GHC_HR       (1u << 0u)
+#define AHCI_GHC_IE       (1u << 1u)
+#define AHCI_GHC_AE       (1u << 31u)
+#define AHCI_CAP2_BOH     (1u << 0u)
+#define AHCI_BOHC_BOS     (1u << 0u)
+#define AHCI_BOHC_OOS     (1u << 1u)
+#define AHCI_BOHC_BB      (1u << 4u)
+
+//Port registers
+#define AHCI_PORTS_OFFSET 0x100
+#define AHCI_PORT_SIZE    0x80
+#define AHCI_MAX_PORTS    32
+#define AHCI_PxCLB  0x00
+#define AHCI_PxCLBU 0x04
+#define AHCI_PxFB   0x08
+#define AHCI_PxFBU  0x0C
+#define AHCI_PxIS   0x10
+#define AHCI_PxIE   0x14
+#define AHCI_PxCMD  0x18
+#define AHCI_PxTFD  0x20
+#define AHCI_PxSIG  0x24
+#define AHCI_PxSSTS 0x28
+#define AHCI_PxSCTL 0x2C
+#define AHCI_PxSERR 0x30
+#define AHCI_PxSACT 0x34
+#define AHCI_PxCI   0x38
+
+#define AHCI_PxCMD_ST  (1u << 0u)
+#define AHCI_PxCMD_SUD (1u << 1u)
+#define AHCI_PxCMD_POD (1u << 2u)
+#define AHCI_PxCMD_FRE (1u << 4u)
+#define AHCI_PxCMD_FR  (1u << 14u)
+#define AHCI_PxCMD_CR  (1u << 15u)
+
+#define AHCI_PxIS_DHRS (1u << 0u)
+#define AHCI_PxIS_PSS  (1u << 1u)
+#define AHCI_PxIS_DSS  (1u << 2u)
+#define AHCI_PxIS_SDBS (1u << 3u)
+#define AHCI_PxIS_IFS  (1u << 27u)
+#define AHCI_PxIS_HBDS (1u << 28u)
+#define AHCI_PxIS_HBFS (1u << 29u)
+#define AHCI_PxIS_TFES (1u << 30u)
+#define AHCI_PxIS_ERRORS (AHCI_PxIS_IFS | AHCI_PxIS_HBDS | AHCI_PxIS_HBFS | AHCI_PxIS_TFES)
+
+#define AHCI_PxSSTS_DET(ssts) ((ssts) & 0xFu)
+#define AHCI_PxSSTS_IPM(ssts) (((ssts) >> 8u) & 0xFu)
+#define AHCI_DET_PRESENT 3
+#define AHCI_IPM_ACTIVE  1
+#define AHCI_SIG_ATA     0x00000101
+
+//FIS types
+#define FIS_TYPE_REG_H2D 0x27
+#define FIS_REG_H2D_COMMAND 0x80
+#define FIS_DEVICE_LBA 0x40
+
+//Commands
+#define ATA_READ_FPDMA_QUEUED  0x60
+#define ATA_WRITE_FPDMA_QUEUED 0x61
+
+//Identify words
+#define ATA_IDENTITY_QUEUE_DEPTH 75
+#define ATA_IDENTITY_SATA_CAPABILITIES 76
+#define ATA_IDENTITY_COMMAND_SET_2 83
+#define ATA_IDENTITY_LBA48_SECTORS 100
+#define ATA_IDENTITY_SATA_NCQ (1u << 8u)
+#define ATA_IDENTITY_LBA48 (1u << 10u)
+
+//Sizes
+#define AHCI_CMD_LIST_SIZE 1024
+#define AHCI_RECEIVED_FIS_SIZE 256
+// The most sectors transferred with one command, and the most PRDT entries that transfer can need (one per page, plus
+// one for a buffer that doesn't start on a page boundary).
+#define AHCI_MAX_SECTORS 128
+#define AHCI_PRDT_ENTRIES (AHCI_MAX_SECTORS * 512 / PAGE_SIZE + 1)
+#define AHCI_PRD_MAX_BYTES (4 * 1024 * 1024)
+
+typedef struct __attribute__((packed)) FISRegH2D {
+	uint8_t fis_type;
+	uint8_t flags; //Port multiplier (bits 0-3) and command bit (bit 7)
+	uint8_t command;
+	uint8_t feature_low;
+	uint8_t lba0;
+	uint8_t lba1;
+	uint8_t lba2;
+	uint8_t device;
+	uint8_t lba3;
+	uint8_t lba4;
+	uint8_t lba5;
+	uint8_t feature_high;
+	uint8_t count_low;
+	uint8_t count_high;
+	uint8_t icc;
+	uint8_t control;
+	uint8_t reserved[4];
+} FISRegH2D;
+
+typedef struct __attribute__((packed)) AHCICommandHeader {
+	uint16_t flags; //Command FIS length in dwords (bits 0-4), ATAPI (5), write (6), prefetchable (7), clear busy (10)
+	uint16_t prdt_length;
+	volatile uint32_t prd_byte_count;
+	uint32_t table_addr;
+	uint32_t table_addr_upper;
+	uint32_t reserved[4];
+} AHCICommandHeader;
+
+#define AHCI_HEADER_WRITE (1u << 6u)
+#define AHCI_HEADER_PREFETCH (1u << 7u)
+
+typedef struct __attribute__((packed)) AHCIPRD {
+	uint32_t addr;
+	uint32_t addr_upper;
+	uint32_t reserved;
+	uint32_t byte_count; //Byte count minus one (bits 0-21) and interrupt on completion (bit 31)
+} AHCIPRD;
+
+typedef struct __attribute__((packed)) AHCICommandTable {
+	uint8_t command_fis[64];
+	uint8_t atapi_command[16];
+	uint8_t reserved[48];
+	AHCIPRD prdt[AHCI_PRDT_ENTRIES];
+} AHCICommandTable;
+
+// Command tables have to be 128-byte aligned, so each one takes up a multiple of 128 bytes.
+#define AHCI_CMD_TABLE_SIZE ((sizeof(AHCICommandTable) + 127) & ~127u)
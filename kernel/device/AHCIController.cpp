@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "AHCIController.h"
+#include "AHCIDevice.h"
+#include <kernel/IO.h>
+#include <kernel/kstd/KLog.h>
+#include <kernel/memory/MemoryManager.h>
+#include <kernel/tasking/TaskManager.h>
+
+AHCIController* AHCIController::find() {
+	PCI::Address addr = {0, 0, 0};
+	PCI::enumerate_devices([](PCI::Address addr, PCI::ID id, uint16_t type, void* data) {
+		if(type == PCI_TYPE_SATA_CONTROLLER && PCI::read_byte(addr, PCI_PROG_IF) == PCI_PROG_IF_AHCI)
+			*((PCI::Address*) data) = addr;
+	}, &addr);
+	if(addr.is_zero())
+		return nullptr;
+	return new AHCIController(addr);
+}
+
+AHCIController::AHCIController(PCI::Address addr): IRQHandler(), m_pci_addr(addr) {
+	//Map the HBA's registers
+	PhysicalAddress abar = PCI::read_dword(addr, AHCI_ABAR) & ~0xFu;
+	m_regs = MM.alloc_mapped_region(abar, AHCI_PORTS_OFFSET + AHCI_MAX_PORTS * AHCI_PORT_SIZE);
+	PCI::enable_bus_mastering(addr);
+
+	take_ownership();
+	write_reg(AHCI_GHC, read_reg(AHCI_GHC) | AHCI_GHC_AE);
+	m_cap = read_reg(AHCI_CAP);
+
+	uint32_t version = read_reg(AHCI_VS);
+	KLog::info("AHCI", "Found AHCI %d.%d controller with %d ports and %d command slots%s", version >> 16, version & 0xFFFF,
+			   AHCI_CAP_NP(m_cap) + 1, num_command_slots(), supports_ncq() ? " (NCQ supported)" : "");
+
+	//Set up a disk for each implemented port that has one attached
+	uint32_t implemented_ports = read_reg(AHCI_PI);
+	for(uint32_t port = 0; port < AHCI_MAX_PORTS; port++) {
+		if(!(implemented_ports & (1u << port)) || !port_has_disk(port))
+			continue;
+		auto* disk = new AHCIDevice(*this, port, m_disks.size());
+		m_ports[port] = disk;
+		m_disks.push_back(disk);
+	}
+
+	//Then start taking interrupts. The controller doesn't have any way of doing MSIs that we can use, so it uses the
+	//legacy interrupt line.
+	set_irq(PCI::read_byte(addr, PCI_INTERRUPT_LINE));
+	write_reg(AHCI_IS, 0xFFFFFFFF);
+	reinstall_irq();
+	PCI::enable_interrupt(addr);
+	write_reg(AHCI_GHC, read_reg(AHCI_GHC) | AHCI_GHC_IE);
+}
+
+void AHCIController::take_ownership() {
+	if(!(read_reg(AHCI_CAP2) & AHCI_CAP2_BOH))
+		return;
+
+	write_reg(AHCI_BOHC, read_reg(AHCI_BOHC) | AHCI_BOHC_OOS);
+	while(read_reg(AHCI_BOHC) & AHCI_BOHC_BOS);
+
+	//The firmware gets two seconds to finish what it's doing if it says it's busy
+	IO::wait(25000);
+	if(read_reg(AHCI_BOHC) & AHCI_BOHC_BB) {
+		for(int i = 0; i < 80 && (read_reg(AHCI_BOHC) & AHCI_BOHC_BB); i++)
+			IO::wait(25000);
+	}
+}
+
+bool AHCIController::port_has_disk(uint32_t port) {
+	size_t port_base = AHCI_PORTS_OFFSET + port * AHCI_PORT_SIZE;
+	uint32_t status = read_reg(port_base + AHCI_PxSSTS);
+	if(AHCI_PxSSTS_DET(status) != AHCI_DET_PRESENT || AHCI_PxSSTS_IPM(status) != AHCI_IPM_ACTIVE)
+		return false;
+	return read_reg(port_base + AHCI_PxSIG) == AHCI_SIG_ATA;
+}
+
+void AHCIController::handle_irq(Registers* regs) {
+	uint32_t status = read_reg(AHCI_IS);
+	if(!status)
+		return; //Interrupt wasn't for this
+
+	for(uint32_t port = 0; port < AHCI_MAX_PORTS; port++) {
+		if((status & (1u << port)) && m_ports[port])
+			m_ports[port]->handle_port_irq();
+	}
+
+	//The ports have to be cleared before the controller's status, or the controller will just raise it again
+	write_reg(AHCI_IS, status);
+	TaskManager::yield_if_idle();
+}
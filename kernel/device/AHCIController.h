@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/pci/PCI.h>
+#include <kernel/interrupt/IRQHandler.h>
+#include <kernel/memory/VMRegion.h>
+#include <kernel/kstd/vector.hpp>
+#include "AHCI.h"
+
+class AHCIDevice;
+
+/**
+ * An AHCI SATA host bus adapter. The controller owns the HBA's registers and its interrupt, and sets up an AHCIDevice for
+ * each port that has a SATA disk attached to it.
+ */
+class AHCIController: public IRQHandler {
+public:
+	/** Finds the first AHCI controller on the PCI bus and sets up its disks. Returns nullptr if there isn't one. **/
+	static AHCIController* find();
+
+	/** The disks attached to the controller, in port order. **/
+	const kstd::vector<AHCIDevice*>& disks() const { return m_disks; }
+
+	uint32_t read_reg(size_t reg) const { return *((volatile uint32_t*) (m_regs->start() + reg)); }
+	void write_reg(size_t reg, uint32_t value) { *((volatile uint32_t*) (m_regs->start() + reg)) = value; }
+	/** The number of command slots each port has. **/
+	uint32_t num_command_slots() const { return AHCI_CAP_NCS(m_cap) + 1; }
+	bool supports_ncq() const { return m_cap & AHCI_CAP_SNCQ; }
+
+	//IRQHandler
+	void handle_irq(Registers* regs) override;
+
+private:
+	explicit AHCIController(PCI::Address addr);
+
+	/** Asks the firmware to hand the controller over to us, if it supports that. **/
+	void take_ownership();
+	/** Whether a port has a SATA disk attached to it that's ready to talk to. **/
+	bool port_has_disk(uint32_t port);
+
+	PCI::Address m_pci_addr;
+	kstd::Arc<VMRegion> m_regs;
+	uint32_t m_cap;
+	AHCIDevice* m_ports[AHCI_MAX_PORTS] = {nullptr};
+	kstd::vector<AHCIDevice*> m_disks;
+};
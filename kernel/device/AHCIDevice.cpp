@@ -0,0 +1,301 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "AHCIDevice.h"
+#include "AHCIController.h"
+#include "ATA.h"
+#include <kernel/kstd/KLog.h>
+#include <kernel/kstd/cstring.h>
+#include <kernel/memory/MemoryManager.h>
+#include <kernel/tasking/TaskManager.h>
+#include <kernel/tasking/Thread.h>
+
+AHCIDevice::AHCIDevice(AHCIController& controller, uint32_t port, unsigned minor):
+	DiskDevice(8, minor),
+	m_controller(controller),
+	m_port(port),
+	m_port_base(AHCI_PORTS_OFFSET + port * AHCI_PORT_SIZE),
+	m_num_slots(min(controller.num_command_slots(), (uint32_t) 32))
+{
+	stop();
+
+	//Set up the command list and received FIS area, which share a page
+	m_port_region = MM.alloc_dma_region(AHCI_CMD_LIST_SIZE + AHCI_RECEIVED_FIS_SIZE);
+	memset((void*) m_port_region->start(), 0, AHCI_CMD_LIST_SIZE + AHCI_RECEIVED_FIS_SIZE);
+	m_command_list = (AHCICommandHeader*) m_port_region->start();
+	PhysicalAddress port_paddr = m_port_region->object()->physical_page(0).paddr();
+	write_reg(AHCI_PxCLB, port_paddr);
+	write_reg(AHCI_PxCLBU, 0);
+	write_reg(AHCI_PxFB, port_paddr + AHCI_CMD_LIST_SIZE);
+	write_reg(AHCI_PxFBU, 0);
+
+	//And a command table for each slot
+	m_tables_region = MM.alloc_dma_region(AHCI_CMD_TABLE_SIZE * m_num_slots);
+	memset((void*) m_tables_region->start(), 0, AHCI_CMD_TABLE_SIZE * m_num_slots);
+	PhysicalAddress tables_paddr = m_tables_region->object()->physical_page(0).paddr();
+	for(uint32_t slot = 0; slot < m_num_slots; slot++) {
+		m_command_list[slot].table_addr = tables_paddr + slot * AHCI_CMD_TABLE_SIZE;
+		m_command_list[slot].table_addr_upper = 0;
+	}
+
+	//Clear any errors and interrupts left over from before, then start the port up
+	write_reg(AHCI_PxSERR, 0xFFFFFFFF);
+	write_reg(AHCI_PxIS, 0xFFFFFFFF);
+	start();
+
+	auto res = identify();
+	if(res.is_error()) {
+		KLog::err("AHCI", "Couldn't identify disk on port %d: %d", port, res.code());
+		return;
+	}
+
+	//Commands are waited on with interrupts from here on out
+	write_reg(AHCI_PxIE, AHCI_PxIS_DHRS | AHCI_PxIS_SDBS | AHCI_PxIS_DSS | AHCI_PxIS_PSS | AHCI_PxIS_ERRORS);
+	m_ready = true;
+
+	KLog::info("AHCI", "Setup disk %s on port %d (%d blocks, %s)", m_model_number, port, (int) m_num_sectors,
+			   m_use_ncq ? "NCQ" : "no NCQ");
+}
+
+AHCIDevice::~AHCIDevice() = default;
+
+uint32_t AHCIDevice::read_reg(size_t reg) const {
+	return m_controller.read_reg(m_port_base + reg);
+}
+
+void AHCIDevice::write_reg(size_t reg, uint32_t value) {
+	m_controller.write_reg(m_port_base + reg, value);
+}
+
+void AHCIDevice::stop() {
+	write_reg(AHCI_PxCMD, read_reg(AHCI_PxCMD) & ~AHCI_PxCMD_ST);
+	while(read_reg(AHCI_PxCMD) & AHCI_PxCMD_CR);
+	write_reg(AHCI_PxCMD, read_reg(AHCI_PxCMD) & ~AHCI_PxCMD_FRE);
+	while(read_reg(AHCI_PxCMD) & AHCI_PxCMD_FR);
+}
+
+void AHCIDevice::start() {
+	while(read_reg(AHCI_PxTFD) & (ATA_STATUS_BSY | ATA_STATUS_DRQ));
+	write_reg(AHCI_PxCMD, read_reg(AHCI_PxCMD) | AHCI_PxCMD_FRE);
+	write_reg(AHCI_PxCMD, read_reg(AHCI_PxCMD) | AHCI_PxCMD_ST);
+}
+
+Result AHCIDevice::identify() {
+	auto identity_region = MM.alloc_kernel_region(PAGE_SIZE);
+	auto* identity = (uint16_t*) identity_region->start();
+
+	//Interrupts aren't set up yet, so poll for the command to finish
+	int slot = reserve_slot();
+	prepare_command(slot, ATA_IDENTIFY, 0, 1, (uint8_t*) identity, false);
+	write_reg(AHCI_PxCI, 1u << slot);
+	while(read_reg(AHCI_PxCI) & (1u << slot)) {
+		if(read_reg(AHCI_PxIS) & AHCI_PxIS_TFES)
+			break;
+	}
+	release_slot(slot);
+	uint32_t status = read_reg(AHCI_PxIS);
+	write_reg(AHCI_PxIS, status);
+	if(status & AHCI_PxIS_ERRORS)
+		return Result(-EIO);
+
+	//The model number is made of big-endian words and padded with spaces
+	for(int i = 0; i < ATA_IDENTITY_MODEL_NUMBER_LENGTH / 2; i++) {
+		uint16_t word = identity[ATA_IDENTITY_MODEL_NUMBER_START + i];
+		m_model_number[i * 2] = (char) (word >> 8);
+		m_model_number[i * 2 + 1] = (char) (word & 0xFF);
+	}
+	for(int i = ATA_IDENTITY_MODEL_NUMBER_LENGTH - 1; i >= 0 && m_model_number[i] == ' '; i--)
+		m_model_number[i] = '\0';
+
+	if(!(identity[ATA_IDENTITY_COMMAND_SET_2] & ATA_IDENTITY_LBA48)) {
+		KLog::err("AHCI", "Disk %s doesn't support 48-bit LBA!", m_model_number);
+		return Result(-ENOTSUP);
+	}
+	m_num_sectors = identity[ATA_IDENTITY_LBA48_SECTORS]
+			| ((uint64_t) identity[ATA_IDENTITY_LBA48_SECTORS + 1] << 16)
+			| ((uint64_t) identity[ATA_IDENTITY_LBA48_SECTORS + 2] << 32)
+			| ((uint64_t) identity[ATA_IDENTITY_LBA48_SECTORS + 3] << 48);
+
+	//Use NCQ if both the controller and disk support it. The disk may not be able to take as many commands as the
+	//controller has slots for.
+	if(m_controller.supports_ncq() && (identity[ATA_IDENTITY_SATA_CAPABILITIES] & ATA_IDENTITY_SATA_NCQ)) {
+		m_use_ncq = true;
+		m_num_slots = min(m_num_slots, (uint32_t) (identity[ATA_IDENTITY_QUEUE_DEPTH] & 0x1F) + 1);
+	}
+
+	return Result(SUCCESS);
+}
+
+int AHCIDevice::reserve_slot() {
+	auto all_slots = (uint32_t) ((1ull << m_num_slots) - 1);
+	while(true) {
+		uint32_t reserved = m_reserved_slots.load();
+		for(uint32_t slot = 0; slot < m_num_slots; slot++) {
+			if(reserved & (1u << slot))
+				continue;
+			if(m_reserved_slots.compare_exchange_strong(reserved, reserved | (1u << slot)))
+				return slot;
+			break;
+		}
+		//Either every slot is in use, or someone else took the one we wanted
+		if((reserved & all_slots) == all_slots)
+			TaskManager::yield();
+	}
+}
+
+void AHCIDevice::release_slot(int slot) {
+	m_reserved_slots.bit_and(~(1u << slot));
+}
+
+void AHCIDevice::prepare_command(int slot, uint8_t command, uint64_t lba, uint16_t count, const uint8_t* buffer, bool write) {
+	auto& header = m_command_list[slot];
+	auto* table = (AHCICommandTable*) (m_tables_region->start() + slot * AHCI_CMD_TABLE_SIZE);
+
+	//Give each physically contiguous piece of the buffer its own PRD
+	ASSERT(!((VirtualAddress) buffer & 1));
+	size_t bytes_left = count * 512;
+	auto vaddr = (VirtualAddress) buffer;
+	size_t num_prds = 0;
+	while(bytes_left) {
+		size_t chunk_size = min(bytes_left, PAGE_SIZE - (vaddr % PAGE_SIZE));
+		PhysicalAddress paddr = MM.kernel_page_directory.get_physaddr(vaddr);
+		auto* prev = num_prds ? &table->prdt[num_prds - 1] : nullptr;
+		size_t prev_size = prev ? prev->byte_count + 1 : 0;
+		if(prev && prev->addr + prev_size == paddr && prev_size + chunk_size <= AHCI_PRD_MAX_BYTES) {
+			prev->byte_count = prev_size + chunk_size - 1;
+		} else {
+			ASSERT(num_prds < AHCI_PRDT_ENTRIES);
+			table->prdt[num_prds].addr = paddr;
+			table->prdt[num_prds].addr_upper = 0;
+			table->prdt[num_prds].byte_count = chunk_size - 1;
+			num_prds++;
+		}
+		vaddr += chunk_size;
+		bytes_left -= chunk_size;
+	}
+
+	//Then build the command FIS. Queued commands take their sector count in the features register and the slot's tag in
+	//the count register.
+	auto* fis = (FISRegH2D*) table->command_fis;
+	memset(fis, 0, sizeof(FISRegH2D));
+	fis->fis_type = FIS_TYPE_REG_H2D;
+	fis->flags = FIS_REG_H2D_COMMAND;
+	fis->command = command;
+	fis->device = command == ATA_IDENTIFY ? 0 : FIS_DEVICE_LBA;
+	fis->lba0 = lba & 0xFF;
+	fis->lba1 = (lba >> 8) & 0xFF;
+	fis->lba2 = (lba >> 16) & 0xFF;
+	fis->lba3 = (lba >> 24) & 0xFF;
+	fis->lba4 = (lba >> 32) & 0xFF;
+	fis->lba5 = (lba >> 40) & 0xFF;
+	if(command == ATA_READ_FPDMA_QUEUED || command == ATA_WRITE_FPDMA_QUEUED) {
+		fis->feature_low = count & 0xFF;
+		fis->feature_high = count >> 8;
+		fis->count_low = slot << 3;
+	} else if(command != ATA_IDENTIFY) {
+		fis->count_low = count & 0xFF;
+		fis->count_high = count >> 8;
+	}
+
+	header.flags = (sizeof(FISRegH2D) / sizeof(uint32_t)) | (write ? AHCI_HEADER_WRITE : AHCI_HEADER_PREFETCH);
+	header.prdt_length = num_prds;
+	header.prd_byte_count = 0;
+}
+
+Result AHCIDevice::transfer(uint64_t lba, uint16_t count, const uint8_t* buffer, bool write) {
+	ASSERT(count <= AHCI_MAX_SECTORS);
+	if(!m_ready)
+		return Result(-EIO);
+	if(lba + count > m_num_sectors)
+		return Result(-EINVAL);
+
+	uint8_t command;
+	if(m_use_ncq)
+		command = write ? ATA_WRITE_FPDMA_QUEUED : ATA_READ_FPDMA_QUEUED;
+	else
+		command = write ? ATA_WRITE_DMA_EXT : ATA_READ_DMA_EXT;
+
+	int slot = reserve_slot();
+	prepare_command(slot, command, lba, count, buffer, write);
+
+	//Issue the command and sleep until the interrupt handler says it's done. The interrupt can't come in between marking
+	//the slot as issued and actually issuing it, or the handler would think the command was already done.
+	auto& cmd_slot = m_slots[slot];
+	cmd_slot.failed = false;
+	cmd_slot.blocker.set_ready(false);
+	{
+		TaskManager::ScopedCritical critical;
+		m_issued_slots.bit_or(1u << slot);
+		if(m_use_ncq)
+			write_reg(AHCI_PxSACT, 1u << slot);
+		write_reg(AHCI_PxCI, 1u << slot);
+	}
+	TaskManager::current_thread()->block(cmd_slot.blocker);
+
+	bool failed = cmd_slot.failed;
+	release_slot(slot);
+	return failed ? Result(-EIO) : Result(SUCCESS);
+}
+
+Result AHCIDevice::read_uncached_blocks(uint32_t block, uint32_t count, uint8_t* buffer) {
+	while(count) {
+		uint16_t num_sectors = min(count, (uint32_t) AHCI_MAX_SECTORS);
+		auto res = transfer(block, num_sectors, buffer, false);
+		if(res.is_error())
+			return res;
+		block += num_sectors;
+		buffer += num_sectors * 512;
+		count -= num_sectors;
+	}
+	return Result(SUCCESS);
+}
+
+Result AHCIDevice::write_uncached_blocks(uint32_t block, uint32_t count, const uint8_t* buffer) {
+	while(count) {
+		uint16_t num_sectors = min(count, (uint32_t) AHCI_MAX_SECTORS);
+		auto res = transfer(block, num_sectors, buffer, true);
+		if(res.is_error())
+			return res;
+		block += num_sectors;
+		buffer += num_sectors * 512;
+		count -= num_sectors;
+	}
+	return Result(SUCCESS);
+}
+
+size_t AHCIDevice::num_blocks() {
+	return m_num_sectors;
+}
+
+size_t AHCIDevice::block_size() {
+	return 512;
+}
+
+void AHCIDevice::handle_port_irq() {
+	uint32_t status = read_reg(AHCI_PxIS);
+	write_reg(AHCI_PxIS, status);
+
+	uint32_t done;
+	bool failed = status & AHCI_PxIS_ERRORS;
+	if(failed) {
+		//We can't tell which queued command failed without reading the disk's error log, so fail everything that's in
+		//flight and restart the port
+		KLog::err("AHCI", "Error on port %d with status 0x%x and task file 0x%x", m_port, status, read_reg(AHCI_PxTFD));
+		done = m_issued_slots.load();
+		stop();
+		write_reg(AHCI_PxSERR, 0xFFFFFFFF);
+		write_reg(AHCI_PxIS, 0xFFFFFFFF);
+		start();
+	} else {
+		//Commands are finished once the disk has cleared their bits in both the issue and active registers
+		done = m_issued_slots.load() & ~(read_reg(AHCI_PxCI) | read_reg(AHCI_PxSACT));
+	}
+
+	m_issued_slots.bit_and(~done);
+	for(uint32_t slot = 0; slot < m_num_slots; slot++) {
+		if(!(done & (1u << slot)))
+			continue;
+		m_slots[slot].failed = failed;
+		m_slots[slot].blocker.set_ready(true);
+	}
+}
@@ -0,0 +1,81 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "DiskDevice.h"
+#include "AHCI.h"
+#include <kernel/tasking/BooleanBlocker.h>
+#include <kernel/Atomic.h>
+
+class AHCIController;
+
+/**
+ * A SATA disk attached to a port of an AHCI controller. Every thread that reads or writes the disk gets a command slot
+ * of its own, so with native command queueing as many commands as the disk supports (up to 32) can be in flight at once
+ * and the disk decides what order to service them in.
+ */
+class AHCIDevice: public DiskDevice {
+public:
+	~AHCIDevice() override;
+
+	//DiskDevice
+	Result read_uncached_blocks(uint32_t block, uint32_t count, uint8_t* buffer) override;
+	Result write_uncached_blocks(uint32_t block, uint32_t count, const uint8_t* buffer) override;
+	size_t num_blocks() override;
+	bool queues_requests() override { return m_use_ncq; }
+
+	//BlockDevice
+	size_t block_size() override;
+
+private:
+	friend class AHCIController;
+
+	struct CommandSlot {
+		UninterruptibleBooleanBlocker blocker;
+		volatile bool failed = false;
+	};
+
+	AHCIDevice(AHCIController& controller, uint32_t port, unsigned minor);
+
+	uint32_t read_reg(size_t reg) const;
+	void write_reg(size_t reg, uint32_t value);
+	/** Stops the port's command engine. **/
+	void stop();
+	/** Starts the port's command engine. **/
+	void start();
+	/** Identifies the disk and figures out how to talk to it. **/
+	Result identify();
+
+	/** Reserves a command slot for the current thread, waiting for one to free up if they're all in use. **/
+	int reserve_slot();
+	void release_slot(int slot);
+	/** Fills in the command header and table for a command in a slot. The buffer must be in kernel space. **/
+	void prepare_command(int slot, uint8_t command, uint64_t lba, uint16_t count, const uint8_t* buffer, bool write);
+	/** Reads or writes up to AHCI_MAX_SECTORS sectors, and sleeps until the disk's done. **/
+	Result transfer(uint64_t lba, uint16_t count, const uint8_t* buffer, bool write);
+
+	/** Called by the controller when the port raises an interrupt. **/
+	void handle_port_irq();
+
+	AHCIController& m_controller;
+	uint32_t m_port;
+	size_t m_port_base;
+
+	//Drive info
+	char m_model_number[41] = {0};
+	uint64_t m_num_sectors = 0;
+	bool m_ready = false;
+	bool m_use_ncq = false;
+
+	//Command list, received FISes, and command tables
+	kstd::Arc<VMRegion> m_port_region;
+	kstd::Arc<VMRegion> m_tables_region;
+	AHCICommandHeader* m_command_list;
+
+	//Command slots
+	uint32_t m_num_slots;
+	CommandSlot m_slots[32];
+	Atomic<uint32_t, MemoryOrder::SeqCst> m_reserved_slots = 0; ///< Slots that are being used by a thread.
+	Atomic<uint32_t, MemoryOrder::SeqCst> m_issued_slots = 0; ///< Slots whose commands the disk hasn't finished yet.
+};
@@ -69,6 +69,7 @@
 
 //Busmaster register values and stuff
 #define ATA_BM_READ 0x8
+#define ATA_PRDT_EOT 0x8000
 
 //Other
 #define ATA_IDENTITY_MODEL_NUMBER_START 27 //Words
@@ -43,6 +43,14 @@ size_t BlockDevice::block_size() {
 	return 0;
 }
 
+size_t BlockDevice::num_blocks() {
+	return 0;
+}
+
+void BlockDevice::discard_blocks(uint32_t block, uint32_t count) {
+
+}
+
 bool BlockDevice::is_block_device() {
 	return true;
 }
@@ -31,6 +31,10 @@ public:
 	virtual Result read_blocks(uint32_t block, uint32_t count, uint8_t *buffer);
 	virtual Result write_blocks(uint32_t block, uint32_t count, const uint8_t *buffer);
 	virtual size_t block_size();
+	/** The number of blocks on the device, or 0 if it isn't known. **/
+	virtual size_t num_blocks();
+	/** Tells the device that the contents of some blocks aren't needed anymore. Does nothing by default. **/
+	virtual void discard_blocks(uint32_t block, uint32_t count);
 
 	bool is_block_device() override;
 };
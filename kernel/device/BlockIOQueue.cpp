@@ -0,0 +1,226 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "BlockIOQueue.h"
+#include "DiskDevice.h"
+#include <kernel/kstd/cstring.h>
+#include <kernel/memory/MemoryManager.h>
+#include <kernel/tasking/TaskManager.h>
+#include <kernel/tasking/Thread.h>
+#include <kernel/Trace.h>
+
+SpinLock BlockIOQueue::s_queues_lock;
+BlockIOQueue* BlockIOQueue::s_queues = nullptr;
+BooleanBlocker BlockIOQueue::s_blocker;
+bool BlockIOQueue::s_thread_running = false;
+static Thread* s_io_thread = nullptr;
+
+void kblockio_entry() {
+	BlockIOQueue::io_thread();
+}
+
+BlockRequest::BlockRequest(Type type, uint32_t block, uint32_t count, uint8_t* buffer):
+	type(type), block(block), count(count), buffer(buffer) {}
+
+Result BlockRequest::wait() {
+	TaskManager::current_thread()->block(m_blocker);
+	return m_result;
+}
+
+void BlockRequest::complete(Result result) {
+	m_result = result;
+	TRACE(TRACE_BLOCK_IO_DONE, type, block, result.code());
+	if(m_callback)
+		m_callback(*this, m_callback_data);
+	// Nothing can touch the request after this, since whoever is waiting on it may get rid of it
+	m_blocker.set_ready(true);
+}
+
+BlockIOQueue::BlockIOQueue(DiskDevice& device):
+	m_device(device),
+	m_merge_buffer(MM.alloc_kernel_region(BLOCK_IO_MAX_MERGE_BYTES))
+{
+	LOCK(s_queues_lock);
+	m_next_queue = s_queues;
+	s_queues = this;
+}
+
+BlockIOQueue::~BlockIOQueue() {
+	LOCK(s_queues_lock);
+	for(auto* queue = &s_queues; *queue; queue = &(*queue)->m_next_queue) {
+		if(*queue == this) {
+			*queue = m_next_queue;
+			break;
+		}
+	}
+}
+
+void BlockIOQueue::submit(BlockRequest& request) {
+	request.m_submitted = Time::now();
+	request.m_next = nullptr;
+	TRACE(TRACE_BLOCK_IO_START, request.type, request.block, request.count);
+
+	// If the I/O thread isn't around to service the request or the disk schedules requests itself, do it now
+	if(!s_thread_running || m_device.queues_requests()) {
+		if(request.type == BlockRequest::Read)
+			request.complete(m_device.read_uncached_blocks(request.block, request.count, request.buffer));
+		else
+			request.complete(m_device.write_uncached_blocks(request.block, request.count, request.buffer));
+		return;
+	}
+
+	bool plugged;
+	{
+		LOCK(m_lock);
+		// Keep the list sorted by block
+		auto** insert_at = &m_requests;
+		while(*insert_at && (*insert_at)->block <= request.block)
+			insert_at = &(*insert_at)->m_next;
+		request.m_next = *insert_at;
+		*insert_at = &request;
+		plugged = m_plug_count;
+	}
+
+	if(!plugged)
+		s_blocker.set_ready(true);
+}
+
+Result BlockIOQueue::submit_and_wait(BlockRequest::Type type, uint32_t block, uint32_t count, uint8_t* buffer) {
+	// The I/O thread can't wait on itself, so it does its own I/O directly
+	if(TaskManager::current_thread().get() == s_io_thread) {
+		if(type == BlockRequest::Read)
+			return m_device.read_uncached_blocks(block, count, buffer);
+		return m_device.write_uncached_blocks(block, count, buffer);
+	}
+
+	BlockRequest request(type, block, count, buffer);
+	submit(request);
+	return request.wait();
+}
+
+void BlockIOQueue::plug() {
+	LOCK(m_lock);
+	m_plug_count++;
+}
+
+void BlockIOQueue::unplug() {
+	{
+		LOCK(m_lock);
+		ASSERT(m_plug_count);
+		if(--m_plug_count || !m_requests)
+			return;
+	}
+	s_blocker.set_ready(true);
+}
+
+void BlockIOQueue::io_thread() {
+	s_io_thread = TaskManager::current_thread().get();
+	s_thread_running = true;
+
+	while(1) {
+		// Clear the blocker before checking the queues so that a request submitted while we're working isn't missed
+		s_blocker.set_ready(false);
+		bool did_work;
+		do {
+			did_work = false;
+			LOCK(s_queues_lock);
+			for(auto* queue = s_queues; queue; queue = queue->m_next_queue) {
+				if(queue->dispatch())
+					did_work = true;
+			}
+		} while(did_work);
+		TaskManager::current_thread()->block(s_blocker);
+	}
+}
+
+bool BlockIOQueue::dispatch() {
+	BlockRequest* batch;
+	BlockRequest* batch_tail;
+	uint32_t end_block;
+	{
+		LOCK(m_lock);
+		if(m_plug_count || !m_requests)
+			return false;
+
+		batch = pick_next();
+		remove(batch);
+		batch_tail = batch;
+		end_block = batch->block + batch->count;
+
+		// Merge in any requests of the same type that start where the batch ends
+		size_t max_blocks = BLOCK_IO_MAX_MERGE_BYTES / m_device.block_size();
+		size_t num_blocks = batch->count;
+		auto* request = m_requests;
+		while(request && request->block <= end_block) {
+			auto* next = request->m_next;
+			if(request->block == end_block && request->type == batch->type && num_blocks + request->count <= max_blocks) {
+				remove(request);
+				batch_tail->m_next = request;
+				batch_tail = request;
+				end_block += request->count;
+				num_blocks += request->count;
+			}
+			request = next;
+		}
+		m_head_block = end_block;
+	}
+
+	// Requests on their own go straight to (or from) their buffer; merged ones go through the merge buffer
+	Result result = Result(SUCCESS);
+	auto type = batch->type;
+	if(batch == batch_tail) {
+		if(type == BlockRequest::Read)
+			result = m_device.read_uncached_blocks(batch->block, batch->count, batch->buffer);
+		else
+			result = m_device.write_uncached_blocks(batch->block, batch->count, batch->buffer);
+	} else {
+		auto* buffer = (uint8_t*) m_merge_buffer->start();
+		size_t block_size = m_device.block_size();
+		if(type == BlockRequest::Write) {
+			for(auto* request = batch; request; request = request->m_next)
+				memcpy(buffer + (request->block - batch->block) * block_size, request->buffer, request->count * block_size);
+			result = m_device.write_uncached_blocks(batch->block, end_block - batch->block, buffer);
+		} else {
+			result = m_device.read_uncached_blocks(batch->block, end_block - batch->block, buffer);
+			if(!result.is_error()) {
+				for(auto* request = batch; request; request = request->m_next)
+					memcpy(request->buffer, buffer + (request->block - batch->block) * block_size, request->count * block_size);
+			}
+		}
+	}
+
+	while(batch) {
+		auto* next = batch->m_next;
+		batch->complete(result);
+		batch = next;
+	}
+	return true;
+}
+
+BlockRequest* BlockIOQueue::pick_next() {
+	// If something has been waiting too long, it goes first
+	auto* oldest = m_requests;
+	for(auto* request = m_requests; request; request = request->m_next) {
+		if(request->m_submitted < oldest->m_submitted)
+			oldest = request;
+	}
+	if(oldest->m_submitted + Time(BLOCK_IO_DEADLINE_MS / 1000, (BLOCK_IO_DEADLINE_MS % 1000) * 1000) <= Time::now())
+		return oldest;
+
+	// Otherwise, keep going up the disk from where we left off, and go back to the start once we reach the end
+	for(auto* request = m_requests; request; request = request->m_next) {
+		if(request->block >= m_head_block)
+			return request;
+	}
+	return m_requests;
+}
+
+void BlockIOQueue::remove(BlockRequest* request) {
+	for(auto** cur = &m_requests; *cur; cur = &(*cur)->m_next) {
+		if(*cur == request) {
+			*cur = request->m_next;
+			request->m_next = nullptr;
+			return;
+		}
+	}
+}
@@ -0,0 +1,104 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/Result.hpp>
+#include <kernel/time/Time.h>
+#include <kernel/tasking/BooleanBlocker.h>
+#include <kernel/tasking/SpinLock.h>
+#include <kernel/memory/VMRegion.h>
+
+// How long (in milliseconds) a request can be passed over by the elevator before it's serviced ahead of everything else.
+#define BLOCK_IO_DEADLINE_MS 500
+// The most bytes of adjacent requests that are merged into one transfer.
+#define BLOCK_IO_MAX_MERGE_BYTES (64 * 1024)
+
+class DiskDevice;
+class BlockIOQueue;
+
+void kblockio_entry();
+
+/**
+ * A request to read or write a run of blocks on a disk. Requests are submitted to a disk's BlockIOQueue, and must stay
+ * alive until they complete.
+ */
+class BlockRequest {
+public:
+	enum Type { Read, Write };
+	typedef void (*Callback)(BlockRequest& request, void* data);
+
+	BlockRequest(Type type, uint32_t block, uint32_t count, uint8_t* buffer);
+	BlockRequest(const BlockRequest& other) = delete;
+
+	/// Sets a function that's called on the I/O thread when the request completes.
+	void set_callback(Callback callback, void* data) { m_callback = callback; m_callback_data = data; }
+	/// Blocks until the request completes, and returns its result.
+	Result wait();
+	bool is_complete() { return m_blocker.is_ready(); }
+	Result result() const { return m_result; }
+
+	const Type type;
+	const uint32_t block;
+	const uint32_t count;
+	uint8_t* const buffer;
+
+private:
+	friend class BlockIOQueue;
+
+	void complete(Result result);
+
+	Callback m_callback = nullptr;
+	void* m_callback_data = nullptr;
+	Result m_result = Result(SUCCESS);
+	UninterruptibleBooleanBlocker m_blocker;
+	Time m_submitted;
+	BlockRequest* m_next = nullptr;
+};
+
+/**
+ * A queue of requests to a disk. Requests are kept sorted by block and serviced in one direction across the disk at a
+ * time (C-LOOK), unless one has been waiting longer than BLOCK_IO_DEADLINE_MS. Adjacent requests of the same type are
+ * merged into one transfer. Requests are serviced by the block I/O thread.
+ *
+ * While the queue is plugged, requests are queued up but not serviced, so that a burst of small requests can be merged
+ * into bigger ones once it's unplugged.
+ */
+class BlockIOQueue {
+public:
+	explicit BlockIOQueue(DiskDevice& device);
+	~BlockIOQueue();
+
+	/// Queues a request. Returns immediately; use BlockRequest::wait() or a callback to find out when it completes.
+	void submit(BlockRequest& request);
+	/// Submits a request and waits for it to complete.
+	Result submit_and_wait(BlockRequest::Type type, uint32_t block, uint32_t count, uint8_t* buffer);
+
+	/// Stops servicing requests until a matching unplug(). Plugs nest.
+	void plug();
+	void unplug();
+
+protected:
+	friend void kblockio_entry();
+	static void io_thread();
+
+private:
+	/// Takes the next batch of requests off the queue and services it. Returns false if there was nothing to do.
+	bool dispatch();
+	/// Picks the request to service next. Should be called with the lock held.
+	BlockRequest* pick_next();
+	void remove(BlockRequest* request);
+
+	static SpinLock s_queues_lock;
+	static BlockIOQueue* s_queues;
+	static BooleanBlocker s_blocker;
+	static bool s_thread_running;
+
+	DiskDevice& m_device;
+	SpinLock m_lock;
+	BlockRequest* m_requests = nullptr; ///< Pending requests, sorted by block.
+	uint32_t m_head_block = 0; ///< The block after the end of the last request that was serviced.
+	int m_plug_count = 0;
+	kstd::Arc<VMRegion> m_merge_buffer;
+	BlockIOQueue* m_next_queue = nullptr;
+};
@@ -54,8 +54,8 @@ bool BochsVGADevice::detect() {
 	}
 
 	framebuffer_paddr = PCI::read_dword(address, PCI_BAR0) & 0xfffffff0;
-	set_resolution(VBE_DEFAULT_WIDTH, VBE_DEFAULT_HEIGHT);
-	framebuffer_region = MM.alloc_mapped_region(framebuffer_paddr, framebuffer_size() * 2);
+	set_resolution(VBE_DEFAULT_WIDTH, VBE_DEFAULT_HEIGHT, VBE_DEFAULT_HEIGHT * 2);
+	framebuffer_region = MM.alloc_mapped_region(framebuffer_paddr, framebuffer_size());
 	framebuffer = (uint32_t*) framebuffer_region->start();
 	KLog::info("VGA", "Found a bochs-compatible VGA device at %x:%x.%x", address.bus, address.slot, address.function);
 	KLog::dbg("VGA", "virtual framebuffer mapped from 0x%x to 0x%x", framebuffer_paddr, framebuffer_region->start());
@@ -72,43 +72,59 @@ uint16_t BochsVGADevice::read_register(uint16_t index) {
 	return IO::inw(VBE_DISPI_IOPORT_DATA);
 }
 
-bool BochsVGADevice::set_resolution(uint16_t width, uint16_t height) {
+bool BochsVGADevice::set_resolution(uint16_t width, uint16_t height, uint16_t virt_height) {
+	uint16_t stride = (width + VBE_STRIDE_ALIGN - 1) & ~(VBE_STRIDE_ALIGN - 1);
+	virt_height = max(virt_height, (uint16_t) (height * 2));
+	if((size_t) stride * virt_height * sizeof(uint32_t) > video_memory_size())
+		return false;
+
 	//Write registers
 	write_register(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_DISABLED);
 	write_register(VBE_DISPI_INDEX_XRES, width);
 	write_register(VBE_DISPI_INDEX_YRES, height);
-	write_register(VBE_DISPI_INDEX_VIRT_WIDTH, width);
-	write_register(VBE_DISPI_INDEX_VIRT_HEIGHT, height * 2);
+	write_register(VBE_DISPI_INDEX_VIRT_WIDTH, stride);
+	write_register(VBE_DISPI_INDEX_VIRT_HEIGHT, virt_height);
 	write_register(VBE_DISPI_INDEX_BPP, VBE_DISPI_BPP_32);
 	write_register(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_ENABLED | VBE_DISPI_LFB_ENABLED);
 	write_register(VBE_DISPI_INDEX_BANK, 0);
 
 	//Test if display resolution set was successful and revert if not
-	if(read_register(VBE_DISPI_INDEX_XRES) != width || read_register(VBE_DISPI_INDEX_YRES) != height) {
-		set_resolution(display_width, display_height);
+	if(read_register(VBE_DISPI_INDEX_XRES) != width || read_register(VBE_DISPI_INDEX_YRES) != height ||
+	   read_register(VBE_DISPI_INDEX_VIRT_WIDTH) != stride || read_register(VBE_DISPI_INDEX_VIRT_HEIGHT) < virt_height)
+	{
+		set_resolution(display_width, display_height, virtual_height);
 		return false;
 	}
 
 	display_width = width;
 	display_height = height;
+	display_stride = stride;
+	virtual_height = virt_height;
+	display_offset = 0;
 	return true;
 }
 
+size_t BochsVGADevice::video_memory_size() {
+	//Older versions of the interface don't say how much video memory there is, but they all have at least 4MiB
+	size_t size = read_register(VBE_DISPI_INDEX_VIDEO_MEMORY_64K) * 64 * 1024;
+	return size ? size : 4 * 1024 * 1024;
+}
+
 size_t BochsVGADevice::framebuffer_size() {
-	return display_height * display_width * sizeof(uint32_t);
+	return (size_t) virtual_height * display_stride * sizeof(uint32_t);
 }
 
 ssize_t BochsVGADevice::write(FileDescriptor &fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
 	LOCK(_lock);
 	if(!framebuffer) return -ENOSPC;
-	if(offset + count > framebuffer_size()) return -ENOSPC;
+	if(offset + count > display_height * get_display_pitch()) return -ENOSPC;
 	buffer.read(((uint8_t*)framebuffer + offset), count);
 	return count;
 }
 
 void BochsVGADevice::set_pixel(size_t x, size_t y, uint32_t value) {
 	if(x >= display_width || y >= display_height) return;
-	framebuffer[x + y * display_width] = value;
+	framebuffer[x + y * display_stride] = value;
 }
 
 uint32_t *BochsVGADevice::get_framebuffer() {
@@ -123,16 +139,65 @@ size_t BochsVGADevice::get_display_height() {
 	return display_height;
 }
 
+size_t BochsVGADevice::get_display_pitch() {
+	return display_stride * sizeof(uint32_t);
+}
+
+size_t BochsVGADevice::get_virtual_height() {
+	return virtual_height;
+}
+
+Result BochsVGADevice::set_mode(int width, int height, int virt_height) {
+	if(width <= 0 || height <= 0 || width > VBE_MAX_WIDTH || height > VBE_MAX_HEIGHT || virt_height > 0xFFFF)
+		return Result(-EINVAL);
+
+	LOCK(_lock);
+	if(!set_resolution(width, height, max(virt_height, 0)))
+		return Result(-EINVAL);
+
+	//Map the framebuffer again at its new size. Processes that already mapped it keep the old mapping.
+	framebuffer_region = MM.alloc_mapped_region(framebuffer_paddr, framebuffer_size());
+	framebuffer = (uint32_t*) framebuffer_region->start();
+	KLog::info("VGA", "Set mode to %dx%d (%d rows of video memory, %d byte pitch)", display_width, display_height,
+			   virtual_height, get_display_pitch());
+	return Result(SUCCESS);
+}
+
 void BochsVGADevice::scroll(size_t pixels) {
 	if(pixels >= display_height) return;
-	memcpy(framebuffer, framebuffer + pixels * display_width, (display_height - pixels) * display_width * sizeof(uint32_t));
-	memset(framebuffer + (display_height - pixels) * display_width, 0, display_width * pixels * sizeof(uint32_t));
+
+	//Instead of copying the whole display up, pan down through the second half of the framebuffer. Once we get to the
+	//end of it, copy what's still visible back to the top and start over, which only happens once a screen's worth.
+	auto* base = (uint32_t*) framebuffer_region->start();
+	size_t new_offset = display_offset + pixels;
+	if(new_offset > virtual_height - display_height) {
+		memcpy(base, base + new_offset * display_stride, (display_height - pixels) * display_stride * sizeof(uint32_t));
+		new_offset = 0;
+	}
+	set_offset(new_offset);
+	memset(framebuffer + (display_height - pixels) * display_stride, 0, display_stride * pixels * sizeof(uint32_t));
+}
+
+void BochsVGADevice::reset_scroll() {
+	if(!display_offset)
+		return;
+	//Copy a line at a time from the top, since what's visible probably overlaps the top of the framebuffer
+	auto* base = (uint32_t*) framebuffer_region->start();
+	for(size_t y = 0; y < display_height; y++)
+		memcpy(base + y * display_stride, framebuffer + y * display_stride, display_width * sizeof(uint32_t));
+	set_offset(0);
+}
+
+void BochsVGADevice::set_offset(uint16_t offset) {
+	write_register(VBE_DISPI_INDEX_Y_OFFSET, offset);
+	display_offset = offset;
+	framebuffer = (uint32_t*) framebuffer_region->start() + (offset * display_stride);
 }
 
 void BochsVGADevice::clear(uint32_t color) {
-	size_t size = display_height * display_width;
-	for(size_t i = 0; i < size; i++) {
-		framebuffer[i] = color;
+	for(size_t y = 0; y < display_height; y++) {
+		for(size_t x = 0; x < display_width; x++)
+			framebuffer[x + y * display_stride] = color;
 	}
 }
 
@@ -146,10 +211,9 @@ void* BochsVGADevice::map_framebuffer(Process* proc) {
 int BochsVGADevice::ioctl(unsigned int request, SafePointer<void*> argp) {
 	switch(request) {
 		case IO_VIDEO_OFFSET:
-			if((int)argp.raw() < 0 || (int)argp.raw() > display_height)
+			if((int)argp.raw() < 0 || (int)argp.raw() > virtual_height - display_height)
 				return -EINVAL;
-			write_register(VBE_DISPI_INDEX_Y_OFFSET, (int) argp.raw());
-			framebuffer = (uint32_t*) framebuffer_region->start() + ((uint16_t) (int) argp.raw() * display_width);
+			set_offset((int) argp.raw());
 			return SUCCESS;
 		default:
 			return VGADevice::ioctl(request, argp);
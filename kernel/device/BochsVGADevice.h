@@ -33,6 +33,7 @@
 #define VBE_DISPI_INDEX_VIRT_HEIGHT 7
 #define VBE_DISPI_INDEX_X_OFFSET 8
 #define VBE_DISPI_INDEX_Y_OFFSET 9
+#define VBE_DISPI_INDEX_VIDEO_MEMORY_64K 0xA
 
 #define VBE_DISPI_BPP_4  0x04
 #define VBE_DISPI_BPP_8  0x08
@@ -50,6 +51,10 @@
 
 #define VBE_DEFAULT_WIDTH 1080
 #define VBE_DEFAULT_HEIGHT 720
+#define VBE_MAX_WIDTH 2560
+#define VBE_MAX_HEIGHT 1600
+// Rows are padded to a multiple of this many pixels (64 bytes), so that each row starts on a cache line.
+#define VBE_STRIDE_ALIGN 16
 
 class Process;
 class BochsVGADevice: public VGADevice {
@@ -62,7 +67,11 @@ public:
 	uint32_t* get_framebuffer();
 	size_t get_display_width() override;
 	size_t get_display_height() override;
+	size_t get_display_pitch() override;
+	size_t get_virtual_height() override;
+	Result set_mode(int width, int height, int virtual_height) override;
 	void scroll(size_t pixels) override;
+	void reset_scroll() override;
 	void clear(uint32_t color) override;
 	void* map_framebuffer(Process* proc) override;
 
@@ -73,7 +82,10 @@ private:
 	void write_register(uint16_t index, uint16_t value);
 	uint16_t read_register(uint16_t index);
 	size_t framebuffer_size();
-	bool set_resolution(uint16_t width, uint16_t height);
+	void set_offset(uint16_t offset);
+	/// Sets the resolution. The virtual height is at least twice the height, since scrolling pans through the second half.
+	bool set_resolution(uint16_t width, uint16_t height, uint16_t virtual_height);
+	size_t video_memory_size();
 
 	virtual int ioctl(unsigned request, SafePointer<void*> argp) override;
 
@@ -83,6 +95,9 @@ private:
 	uint32_t* framebuffer = nullptr; /// < The address of the framebuffer with the current offset applied.
 	uint16_t display_width = VBE_DEFAULT_WIDTH;
 	uint16_t display_height = VBE_DEFAULT_HEIGHT;
+	uint16_t display_stride = VBE_DEFAULT_WIDTH; ///< The number of pixels from the start of one row to the next.
+	uint16_t virtual_height = VBE_DEFAULT_HEIGHT * 2;
+	uint16_t display_offset = 0; ///< The line of the framebuffer at the top of the display.
 
 	SpinLock _lock;
 };
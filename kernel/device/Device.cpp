@@ -26,7 +26,11 @@
 #include "KeyboardDevice.h"
 #include "MouseDevice.h"
 #include "KernelLogDevice.h"
+#include "ProfileDevice.h"
+#include "PrefetchDevice.h"
+#include "InputDevice.h"
 #include "I8042.h"
+#include "ZRAMDevice.h"
 #include <kernel/kstd/unix_types.h>
 #include <kernel/kstd/KLog.h>
 
@@ -37,9 +41,13 @@ void Device::init() {
 	new ZeroDevice();
 	new RandomDevice();
 	new NullDevice();
+	new InputDevice();
 	I8042::init();
 	new PTYMuxDevice();
 	new KernelLogDevice();
+	new ProfileDevice();
+	new PrefetchDevice();
+	ZRAMDevice::init();
 }
 
 Device::Device(unsigned major, unsigned minor): _major(major), _minor(minor) {
@@ -22,12 +22,43 @@
 #include <kernel/memory/MemoryManager.h>
 #include "DiskDevice.h"
 #include "kernel/kstd/KLog.h"
+#include <kernel/CommandLine.h>
+#include <kernel/tasking/TaskManager.h>
+#include <kernel/tasking/Thread.h>
+#include <kernel/tasking/SleepBlocker.h>
+#include <kernel/filesystem/FileDescriptor.h>
+#include <kernel/filesystem/FileBasedFilesystem.h>
 
 size_t DiskDevice::s_used_cache_memory = 0;
 kstd::vector<DiskDevice*> DiskDevice::s_disk_devices;
 SpinLock DiskDevice::s_disk_devices_lock;
+DiskDevice::CacheShrinker DiskDevice::s_cache_shrinker;
+Atomic<size_t, MemoryOrder::Relaxed> DiskDevice::s_dirty_pages = 0;
+Mutex DiskDevice::s_flush_lock;
+kstd::Arc<VMRegion> DiskDevice::s_flush_buffer;
+Time DiskDevice::s_dirty_expire = Time(BLOCK_CACHE_DIRTY_EXPIRE_MS_DEFAULT / 1000, (BLOCK_CACHE_DIRTY_EXPIRE_MS_DEFAULT % 1000) * 1000);
+size_t DiskDevice::s_dirty_ratio = BLOCK_CACHE_DIRTY_RATIO_DEFAULT;
+size_t DiskDevice::s_cache_bypass_bytes = BLOCK_CACHE_BYPASS_KIB_DEFAULT * 1024;
+
+void kflush_entry() {
+	DiskDevice::flusher_thread();
+}
 
 DiskDevice::DiskDevice(unsigned int major, unsigned int minor): BlockDevice(major, minor) {
+	// The shrinker covers every disk's cache, so it only needs to be registered once. It's left registered since it
+	// won't find anything to free once there are no disks. The flush buffer and options are shared by every disk too.
+	static bool registered_shrinker = false;
+	if(!registered_shrinker) {
+		MM.register_shrinker(&s_cache_shrinker);
+		registered_shrinker = true;
+		s_flush_buffer = MM.alloc_kernel_region(BLOCK_CACHE_MAX_FLUSH_PAGES * PAGE_SIZE);
+
+		auto& bypass_opt = CommandLine::inst().get_option_value("cache_bypass");
+		if(bypass_opt.length())
+			s_cache_bypass_bytes = atoi(bypass_opt.c_str()) * 1024;
+	}
+
+	LOCK(s_disk_devices_lock);
 	s_disk_devices.push_back(this);
 }
 
@@ -42,38 +73,313 @@ DiskDevice::~DiskDevice() {
 };
 
 Result DiskDevice::read_blocks(uint32_t start_block, uint32_t count, uint8_t* buffer) {
-	kstd::Arc<BlockCacheRegion> cache_region;
-	for(size_t i = 0; i < count; i++) {
-		size_t block = start_block + i;
-		if(!cache_region || !cache_region->has_block(block))
-			cache_region = get_cache_region(block);
-		LOCK(cache_region->lock);
-		cache_region->last_used = Time::now();
-		memcpy(buffer + i * block_size(), cache_region->block_data(block), block_size());
+	if(s_cache_bypass_bytes && count * block_size() >= s_cache_bypass_bytes)
+		return read_bypassing_cache(start_block, count, buffer);
+
+	Time now = Time::now();
+	size_t end_block = start_block + count;
+	size_t region_blocks = blocks_per_cache_region();
+	for(size_t region_start = block_cache_region_start(start_block); region_start < end_block;) {
+		size_t num_regions = min(kstd::ceil_div(end_block - region_start, region_blocks), (size_t) BLOCK_CACHE_MAX_REQUEST_PAGES);
+		auto regions = TRY(get_cache_regions(region_start, num_regions));
+		for(auto& region : regions) {
+			size_t copy_start = max((size_t) start_block, region->start_block);
+			size_t copy_end = min(end_block, region->start_block + region_blocks);
+			LOCK(region->lock);
+			region->last_used = now;
+			memcpy(buffer + (copy_start - start_block) * block_size(), region->block_data(copy_start), (copy_end - copy_start) * block_size());
+		}
+		region_start += num_regions * region_blocks;
 	}
 	return Result(SUCCESS);
 }
 
 Result DiskDevice::write_blocks(uint32_t start_block, uint32_t count, const uint8_t* buffer) {
-	kstd::Arc<BlockCacheRegion> cache_region;
-	for(size_t i = 0; i < count; i++) {
-		size_t block = start_block + i;
-		if(!cache_region || !cache_region->has_block(block))
-			cache_region = get_cache_region(block);
-		LOCK(cache_region->lock);
-		cache_region->last_used = Time::now();
-		cache_region->dirty = true;
-		memcpy(cache_region->block_data(block), buffer + i * block_size(), block_size());
+	Time now = Time::now();
+	size_t end_block = start_block + count;
+	size_t region_blocks = blocks_per_cache_region();
+	for(size_t region_start = block_cache_region_start(start_block); region_start < end_block;) {
+		size_t num_regions = min(kstd::ceil_div(end_block - region_start, region_blocks), (size_t) BLOCK_CACHE_MAX_REQUEST_PAGES);
+		auto regions = TRY(get_cache_regions(region_start, num_regions));
+		for(auto& region : regions) {
+			size_t copy_start = max((size_t) start_block, region->start_block);
+			size_t copy_end = min(end_block, region->start_block + region_blocks);
+			LOCK(region->lock);
+			region->last_used = now;
+			memcpy(region->block_data(copy_start), buffer + (copy_start - start_block) * block_size(), (copy_end - copy_start) * block_size());
+			mark_dirty(region);
+		}
+		region_start += num_regions * region_blocks;
+	}
+
+	// The flusher writes everything out in the background, but if it can't keep up, make the writer do it
+	if(s_dirty_pages.load() > dirty_limit_pages() * 2)
+		return flush();
+
+	return Result(SUCCESS);
+}
+
+Result DiskDevice::read_bypassing_cache(uint32_t start_block, uint32_t count, uint8_t* buffer) {
+	auto res = _io_queue.submit_and_wait(BlockRequest::Read, start_block, count, buffer);
+	if(res.is_error())
+		return res;
+
+	// Cached regions that haven't been written out yet are newer than what's on disk, so copy those over what we read.
+	// They're copied even if they've been written out since, since that might have happened after we read them.
+	size_t end_block = start_block + count;
+	size_t region_blocks = blocks_per_cache_region();
+	kstd::vector<kstd::Arc<BlockCacheRegion>> dirty_regions;
+	{
+		LOCK(_cache_lock);
+		for(auto& pair : _dirty_regions) {
+			if(pair.first + region_blocks > start_block && pair.first < end_block)
+				dirty_regions.push_back(pair.second);
+		}
+	}
+
+	for(auto& region : dirty_regions) {
+		size_t copy_start = max((size_t) start_block, region->start_block);
+		size_t copy_end = min(end_block, region->start_block + region_blocks);
+		LOCK(region->lock);
+		memcpy(buffer + (copy_start - start_block) * block_size(), region->block_data(copy_start), (copy_end - copy_start) * block_size());
+	}
+
+	return Result(SUCCESS);
+}
+
+Result DiskDevice::read_cached(size_t offset, size_t count, SafePointer<uint8_t> buffer) {
+	//Whole blocks going into the kernel can just be read normally, which may skip the cache
+	if(!buffer.is_user() && !(offset % block_size()) && !(count % block_size()))
+		return read_blocks(offset / block_size(), count / block_size(), buffer.raw());
+
+	Time now = Time::now();
+	size_t end = offset + count;
+	size_t start_block = offset / block_size();
+	size_t end_block = kstd::ceil_div(end, block_size());
+	size_t region_blocks = blocks_per_cache_region();
+	for(size_t region_start = block_cache_region_start(start_block); region_start < end_block;) {
+		size_t num_regions = min(kstd::ceil_div(end_block - region_start, region_blocks), (size_t) BLOCK_CACHE_MAX_REQUEST_PAGES);
+		auto regions = TRY(get_cache_regions(region_start, num_regions));
+		for(auto& region : regions) {
+			size_t region_offset = region->start_block * block_size();
+			size_t copy_start = max(offset, region_offset);
+			size_t copy_end = min(end, region_offset + PAGE_SIZE);
+			auto* data = (uint8_t*) region->region->start() + (copy_start - region_offset);
+			region->last_used = now;
+
+			//Copies into userspace are done without holding the region's lock, since faulting in the destination may
+			//need to reclaim cache memory. Holding onto the region keeps its page around in the meantime.
+			if(buffer.is_user()) {
+				buffer.write(data, copy_start - offset, copy_end - copy_start);
+			} else {
+				LOCK(region->lock);
+				buffer.write(data, copy_start - offset, copy_end - copy_start);
+			}
+		}
+		region_start += num_regions * region_blocks;
 	}
+	return Result(SUCCESS);
+}
+
+ssize_t DiskDevice::read(FileDescriptor &fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
+	//Don't read past the end of the disk
+	size_t disk_size = num_blocks() * block_size();
+	if(offset >= disk_size)
+		return 0;
+	if(count > disk_size - offset)
+		count = disk_size - offset;
 
-	//TODO: Flush cached writes to disk periodically instead of on every write
-	return write_uncached_blocks(start_block, count, buffer);
+	Result res = read_cached(offset, count, buffer);
+	if(res.is_error())
+		return res.code();
+	return count;
+}
+
+ssize_t DiskDevice::write(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
+	size_t first_block = offset / block_size();
+	size_t last_block = (offset + count) / block_size();
+	size_t first_block_start = offset % block_size();
+	size_t bytes_left = count;
+	size_t block = first_block;
+
+	if(last_block >= num_blocks())
+		return -ENOSPC;
+
+	uint8_t block_buf[block_size()];
+	while(bytes_left) {
+		//Read the block into a buffer
+		Result res = read_block(block, block_buf);
+		if(res.is_error()) {
+			return res.code();
+		}
+
+		//Copy the appropriate portion of the buffer into the appropriate portion of the block buffer
+		if(block == first_block) {
+			if(count < block_size() - first_block_start) {
+				buffer.read(block_buf + first_block_start, count);
+				bytes_left = 0;
+			} else {
+				buffer.read(block_buf + first_block_start, block_size() - first_block_start);
+				bytes_left -= block_size() - first_block_start;
+			}
+		} else {
+			if(bytes_left < block_size()) {
+				buffer.read(block_buf, count - bytes_left, bytes_left);
+				bytes_left = 0;
+			} else {
+				buffer.read(block_buf, count - bytes_left, block_size());
+				bytes_left -= block_size();
+			}
+		}
+
+		res = write_block(block, block_buf);
+		if(res.is_error()) {
+			return res.code();
+		}
+		block++;
+	}
+
+	return count;
+}
+
+Result DiskDevice::flush() {
+	return flush_regions(false);
+}
+
+Result DiskDevice::flush_all() {
+	Result result = Result(SUCCESS);
+	for(auto device : disk_devices()) {
+		auto res = device->flush();
+		if(res.is_error())
+			result = res;
+	}
+	return result;
+}
+
+Result DiskDevice::sync() {
+	return flush();
 }
 
 size_t DiskDevice::used_cache_memory() {
 	return s_used_cache_memory;
 }
 
+size_t DiskDevice::dirty_cache_memory() {
+	return s_dirty_pages.load() * PAGE_SIZE;
+}
+
+void DiskDevice::flusher_thread() {
+	auto& expire_opt = CommandLine::inst().get_option_value("dirty_expire");
+	if(expire_opt.length()) {
+		int expire_ms = atoi(expire_opt.c_str());
+		s_dirty_expire = Time(expire_ms / 1000, (expire_ms % 1000) * 1000);
+	}
+	auto& ratio_opt = CommandLine::inst().get_option_value("dirty_ratio");
+	if(ratio_opt.length())
+		s_dirty_ratio = atoi(ratio_opt.c_str());
+
+	while(1) {
+		SleepBlocker blocker(Time(BLOCK_CACHE_FLUSH_INTERVAL_MS / 1000, (BLOCK_CACHE_FLUSH_INTERVAL_MS % 1000) * 1000));
+		TaskManager::current_thread()->block(blocker);
+
+		// Filesystems keep some metadata in memory until now, so it can go out with everything else
+		FileBasedFilesystem::write_all_metadata();
+
+		// Write out everything if there's too much that hasn't been written out yet, otherwise just the old stuff
+		bool expired_only = s_dirty_pages.load() <= dirty_limit_pages();
+		for(auto device : disk_devices())
+			device->flush_regions(expired_only);
+	}
+}
+
+Result DiskDevice::flush_regions(bool expired_only) {
+	// Take a snapshot of the written regions so we don't hold the cache lock while writing
+	kstd::vector<kstd::Arc<BlockCacheRegion>> regions;
+	{
+		LOCK(_cache_lock);
+		if(_dirty_regions.empty())
+			return Result(SUCCESS);
+		regions.reserve(_dirty_regions.size());
+		for(auto& pair : _dirty_regions)
+			regions.push_back(pair.second);
+	}
+
+	LOCK(s_flush_lock);
+	Time now = Time::now();
+	Result result = Result(SUCCESS);
+	size_t run_start = 0;
+	while(run_start < regions.size()) {
+		// Find the run of adjacent regions starting here, and whether any of them have been sitting around for too long
+		size_t run_end = run_start + 1;
+		bool expired = regions[run_start]->dirtied_at + s_dirty_expire <= now;
+		while(run_end < regions.size() && run_end - run_start < BLOCK_CACHE_MAX_FLUSH_PAGES &&
+			  regions[run_end]->start_block == regions[run_end - 1]->start_block + blocks_per_cache_region())
+		{
+			expired |= regions[run_end]->dirtied_at + s_dirty_expire <= now;
+			run_end++;
+		}
+
+		if(expired || !expired_only) {
+			auto res = write_back(regions, run_start, run_end);
+			if(res.is_error())
+				result = res;
+		}
+		run_start = run_end;
+	}
+
+	return result;
+}
+
+Result DiskDevice::write_back(kstd::vector<kstd::Arc<BlockCacheRegion>>& regions, size_t start, size_t end) {
+	// Copy the regions into the flush buffer and mark them clean. If they're written to again while we're writing
+	// them out, they'll just be marked dirty again.
+	auto buffer = (uint8_t*) s_flush_buffer->start();
+	for(size_t i = start; i < end; i++) {
+		auto& region = regions[i];
+		LOCK(region->lock);
+		memcpy(buffer + (i - start) * PAGE_SIZE, (void*) region->region->start(), PAGE_SIZE);
+		mark_clean(region);
+	}
+
+	auto res = _io_queue.submit_and_wait(BlockRequest::Write, regions[start]->start_block, (end - start) * blocks_per_cache_region(), buffer);
+	if(res.is_error()) {
+		KLog::err("DiskDevice", "Error %d writing back cached blocks at block %d!", res.code(), (int) regions[start]->start_block);
+		for(size_t i = start; i < end; i++) {
+			LOCK(regions[i]->lock);
+			mark_dirty(regions[i]);
+		}
+	}
+	return res;
+}
+
+void DiskDevice::mark_dirty(const kstd::Arc<BlockCacheRegion>& region) {
+	if(region->dirty)
+		return;
+	region->dirty = true;
+	region->dirtied_at = Time::now();
+	s_dirty_pages.add(1);
+	LOCK(_cache_lock);
+	_dirty_regions.insert({region->start_block, region});
+}
+
+void DiskDevice::mark_clean(const kstd::Arc<BlockCacheRegion>& region) {
+	if(!region->dirty)
+		return;
+	region->dirty = false;
+	s_dirty_pages.sub(1);
+	LOCK(_cache_lock);
+	_dirty_regions.erase(region->start_block);
+}
+
+size_t DiskDevice::dirty_limit_pages() {
+	return MM.usable_mem() / PAGE_SIZE * s_dirty_ratio / 100;
+}
+
+kstd::vector<DiskDevice*> DiskDevice::disk_devices() {
+	LOCK(s_disk_devices_lock);
+	return s_disk_devices;
+}
+
 size_t DiskDevice::free_pages(size_t num_pages) {
 	size_t num_freed = 0;
 	LOCK(s_disk_devices_lock);
@@ -91,7 +397,7 @@ size_t DiskDevice::free_pages(size_t num_pages) {
 				continue;
 			auto device_lru = device->_cache_regions.lru_unsafe();
 			auto time = device_lru.second->last_used;
-			if(time < lru_time) {
+			if(time < lru_time && device_lru.second->loaded) {
 				lru_time = time;
 				lru_device = device;
 				lru_region = device_lru.second;
@@ -101,49 +407,153 @@ size_t DiskDevice::free_pages(size_t num_pages) {
 		if(!lru_region)
 			break;
 
-		// Flush it if necessary
-		if(lru_region->dirty)
-			lru_device->write_uncached_blocks(lru_region->start_block, lru_region->num_blocks(), (uint8_t*) lru_region->region->start());
+		// Flush it if necessary. This goes straight to the disk rather than through the I/O queue, since we may be
+		// freeing memory for the I/O thread itself.
+		{
+			LOCK_N(lru_region->lock, region_lock);
+			if(lru_region->dirty) {
+				lru_device->write_uncached_blocks(lru_region->start_block, lru_region->num_blocks(), (uint8_t*) lru_region->region->start());
+				lru_device->mark_clean(lru_region);
+			}
+		}
 
-		// Free it
+		// Free it. It's erased by its start block rather than pruned since the LRU order may have changed by now.
 		num_freed += lru_region->region->size() / PAGE_SIZE;
 		s_used_cache_memory -= lru_region->region->size();
+		LOCK_N(lru_device->_cache_lock, device_lock);
+		lru_device->_cache_regions.erase(lru_region->start_block);
 		lru_region.reset();
-		lru_device->_cache_regions.prune(1);
 	}
 
-	if(num_freed != num_pages)
-		KLog::warn("DiskDevice", "Was asked to free %d pages, could only free %d...", num_pages, num_freed);
-
 	return num_freed;
 }
 
-kstd::Arc<DiskDevice::BlockCacheRegion> DiskDevice::get_cache_region(size_t block) {
-	_cache_lock.acquire();
+ResultRet<kstd::small_vector<kstd::Arc<DiskDevice::BlockCacheRegion>, BLOCK_CACHE_MAX_REQUEST_PAGES>> DiskDevice::get_cache_regions(size_t start_block, size_t num_regions) {
+	ASSERT(num_regions <= BLOCK_CACHE_MAX_REQUEST_PAGES);
+	ASSERT(block_cache_region_start(start_block) == start_block);
+	size_t region_blocks = blocks_per_cache_region();
+	kstd::small_vector<kstd::Arc<BlockCacheRegion>, BLOCK_CACHE_MAX_REQUEST_PAGES> regions;
+	regions.resize(num_regions);
 
-	//See if we already have the block
-	auto reg_opt = _cache_regions.get(block_cache_region_start(block));
-	if(reg_opt) {
-		_cache_lock.release();
-		return reg_opt.value();
+	//See which regions we already have
+	size_t num_missing = 0;
+	{
+		LOCK(_cache_lock);
+		for(size_t i = 0; i < num_regions; i++) {
+			auto reg_opt = _cache_regions.get(start_block + i * region_blocks);
+			if(reg_opt)
+				regions[i] = reg_opt.value();
+			else
+				num_missing++;
+		}
 	}
 
-	//Create a new cache region
-	auto reg = kstd::Arc<BlockCacheRegion>::make(block_cache_region_start(block), block_size());
-	s_used_cache_memory += PAGE_SIZE;
-	reg->lock.acquire();
-	_cache_regions.insert(block_cache_region_start(block), reg);
+	//Allocate new regions for the missing ones (and a buffer to read them into all at once) without holding the cache
+	//lock, since allocating may have to free memory first
+	bool loading[BLOCK_CACHE_MAX_REQUEST_PAGES] = {false};
+	kstd::Arc<VMRegion> read_buffer;
+	if(num_missing) {
+		kstd::small_vector<kstd::Arc<BlockCacheRegion>, BLOCK_CACHE_MAX_REQUEST_PAGES> new_regions;
+		new_regions.resize(num_regions);
+		for(size_t i = 0; i < num_regions; i++) {
+			if(!regions[i])
+				new_regions[i] = kstd::Arc<BlockCacheRegion>::make(start_block + i * region_blocks, block_size());
+		}
+		if(num_missing > 1)
+			read_buffer = MM.alloc_kernel_region(num_regions * PAGE_SIZE);
+
+		LOCK(_cache_lock);
+		for(size_t i = 0; i < num_regions; i++) {
+			if(regions[i])
+				continue;
+			//Someone else may have started loading the region in the meantime
+			auto reg_opt = _cache_regions.get(start_block + i * region_blocks);
+			if(reg_opt) {
+				regions[i] = reg_opt.value();
+				continue;
+			}
+			//Hold the new region's lock while it's loading so that anyone else who finds it waits for it to be filled
+			regions[i] = new_regions[i];
+			regions[i]->lock.acquire();
+			s_used_cache_memory += PAGE_SIZE;
+			_cache_regions.insert(regions[i]->start_block, regions[i]);
+			loading[i] = true;
+		}
+	}
 
-	//Read the blocks into it
-	read_uncached_blocks(reg->start_block, blocks_per_cache_region(), (uint8_t*) reg->region->start());
+	//Submit a read for each run of regions we're loading. The queue is plugged until they're all submitted so that the
+	//I/O thread sees them together. Other regions can be used and loaded in the meantime.
+	BlockRequest* requests[BLOCK_CACHE_MAX_REQUEST_PAGES] = {nullptr};
+	size_t run_ends[BLOCK_CACHE_MAX_REQUEST_PAGES];
+	_io_queue.plug();
+	for(size_t run_start = 0; run_start < num_regions;) {
+		if(!loading[run_start]) {
+			run_start++;
+			continue;
+		}
+		size_t run_end = run_start + 1;
+		while(run_end < num_regions && loading[run_end])
+			run_end++;
+
+		auto buffer = run_end - run_start == 1
+				? (uint8_t*) regions[run_start]->region->start()
+				: (uint8_t*) read_buffer->start() + run_start * PAGE_SIZE;
+		requests[run_start] = new BlockRequest(BlockRequest::Read, regions[run_start]->start_block, (run_end - run_start) * region_blocks, buffer);
+		run_ends[run_start] = run_end;
+		_io_queue.submit(*requests[run_start]);
+		run_start = run_end;
+	}
+	_io_queue.unplug();
+
+	//Wait for the reads to finish and fill in the regions
+	Result result = Result(SUCCESS);
+	for(size_t run_start = 0; run_start < num_regions;) {
+		if(!requests[run_start]) {
+			run_start++;
+			continue;
+		}
+		size_t run_end = run_ends[run_start];
+		auto res = requests[run_start]->wait();
+		delete requests[run_start];
+		if(res.is_error())
+			result = res;
+
+		for(size_t i = run_start; i < run_end; i++) {
+			if(!res.is_error() && run_end - run_start > 1)
+				memcpy((void*) regions[i]->region->start(), (uint8_t*) read_buffer->start() + i * PAGE_SIZE, PAGE_SIZE);
+			if(res.is_error()) {
+				//Take it back out of the cache so the next access tries again
+				LOCK(_cache_lock);
+				_cache_regions.erase(regions[i]->start_block);
+				s_used_cache_memory -= PAGE_SIZE;
+			} else {
+				regions[i]->loaded = true;
+			}
+			regions[i]->lock.release();
+		}
+		run_start = run_end;
+	}
+	if(result.is_error())
+		return result;
+
+	//Wait for any regions that someone else is loading
+	for(size_t i = 0; i < num_regions; i++) {
+		if(!loading[i])
+			TRY(wait_for_region(regions[i]));
+	}
+
+	return regions;
+}
 
-	//TODO: Figure out how to read the block after releasing the cache lock so that other blocks can be used in the meantime
-	//(We cannot do this currently as that would result in acquiring / releasing locks in the wrong order)
-	reg->lock.release();
-	_cache_lock.release();
+ResultRet<kstd::Arc<DiskDevice::BlockCacheRegion>> DiskDevice::wait_for_region(const kstd::Arc<BlockCacheRegion>& region) {
+	if(region->loaded)
+		return region;
 
-	//Return the requested region
-	return reg;
+	//The region is still being loaded, so wait for whoever is loading it to let go of it
+	LOCK(region->lock);
+	if(!region->loaded)
+		return Result(-EIO);
+	return region;
 }
 
 DiskDevice::BlockCacheRegion::BlockCacheRegion(size_t start_block, size_t block_size):
@@ -22,7 +22,31 @@
 #include <kernel/time/Time.h>
 #include <kernel/memory/MemoryManager.h>
 #include "BlockDevice.h"
+#include "BlockIOQueue.h"
 #include "../kstd/LRUCache.h"
+#include "../kstd/map.hpp"
+#include "../kstd/small_vector.hpp"
+#include <kernel/tasking/Mutex.h>
+#include <kernel/Atomic.h>
+
+// How long (in milliseconds) written blocks can stay in the cache before the flusher writes them out to disk.
+// Can be changed with the `dirty_expire=<ms>` command line option.
+#define BLOCK_CACHE_DIRTY_EXPIRE_MS_DEFAULT 5000
+// The percentage of usable memory that written blocks can take up before the flusher starts writing them all out
+// regardless of how old they are. Writers are made to flush the cache themselves at twice this amount.
+// Can be changed with the `dirty_ratio=<percent>` command line option.
+#define BLOCK_CACHE_DIRTY_RATIO_DEFAULT 10
+// How often (in milliseconds) the flusher checks for written blocks to write out.
+#define BLOCK_CACHE_FLUSH_INTERVAL_MS 1000
+// The maximum number of adjacent cache regions that are written out to disk in one go.
+#define BLOCK_CACHE_MAX_FLUSH_PAGES 16
+// The maximum number of adjacent cache regions that are looked up and read in from disk in one go.
+#define BLOCK_CACHE_MAX_REQUEST_PAGES 16
+// Reads at least this big (in KiB) skip the cache and are read straight from the disk. 0 means reads never skip it.
+// Can be changed with the `cache_bypass=<KiB>` command line option.
+#define BLOCK_CACHE_BYPASS_KIB_DEFAULT 0
+
+void kflush_entry();
 
 class DiskDevice: public BlockDevice {
 public:
@@ -34,11 +58,35 @@ public:
 
 	virtual Result read_uncached_blocks(uint32_t block, uint32_t count, uint8_t *buffer) = 0;
 	virtual Result write_uncached_blocks(uint32_t block, uint32_t count, const uint8_t *buffer) = 0;
+	/** The number of blocks on the disk. **/
+	size_t num_blocks() override = 0;
+	/** Whether the disk can keep several requests in flight and schedule them itself, in which case requests skip the
+	 *  I/O queue's elevator and go straight to the disk. **/
+	virtual bool queues_requests() { return false; }
+
+	/** Reads bytes from the disk, copying them straight out of the cache into the buffer. **/
+	Result read_cached(size_t offset, size_t count, SafePointer<uint8_t> buffer);
+
+	/** Writes every written block in the cache out to disk. **/
+	Result flush();
+	/** Writes every written block in every disk's cache out to disk. **/
+	static Result flush_all();
+
+	// File
+	ssize_t read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
+	ssize_t write(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
+	Result sync() override;
 
 	static size_t used_cache_memory();
+	static size_t dirty_cache_memory();
 	/** Tries to free a number of pages from the cache. Returns the number of pages that could be freed. **/
 	static size_t free_pages(size_t num_pages);
 
+protected:
+	friend void kflush_entry();
+	/** Runs the flusher thread. Called by kflush_entry(). **/
+	static void flusher_thread();
+
 private:
 	class BlockCacheRegion {
 	public:
@@ -53,19 +101,57 @@ private:
 		size_t block_size;
 		size_t start_block;
 		Time last_used = Time::now();
+		Time dirtied_at; ///< When the region was first written to since it was last flushed.
 		bool dirty = false;
-		SpinLock lock;
+		bool loaded = false; ///< Whether the region has been read in from disk. Its lock is held until it is.
+		Mutex lock;
+	};
+
+	class CacheShrinker: public Shrinker {
+	public:
+		const char* name() const override { return "block cache"; }
+		size_t reclaimable_pages() override { return used_cache_memory() / PAGE_SIZE; }
+		size_t shrink(size_t num_pages) override { return free_pages(num_pages); }
 	};
 
 	// Static
+	static CacheShrinker s_cache_shrinker;
 	static SpinLock s_disk_devices_lock;
 	static size_t s_used_cache_memory;
 	static kstd::vector<DiskDevice*> s_disk_devices;
+	static Atomic<size_t, MemoryOrder::Relaxed> s_dirty_pages;
+	static Mutex s_flush_lock;
+	static kstd::Arc<VMRegion> s_flush_buffer; ///< Where adjacent regions are copied to to be written out together.
+	static Time s_dirty_expire;
+	static size_t s_dirty_ratio;
+	static size_t s_cache_bypass_bytes;
+
+	/** Reads blocks straight from the disk, and then copies over any blocks that were written to in the cache. **/
+	Result read_bypassing_cache(uint32_t start_block, uint32_t count, uint8_t* buffer);
+	/** Writes out written regions. If expired_only is true, only runs of regions with an expired region are written. **/
+	Result flush_regions(bool expired_only);
+	/** Writes a run of adjacent regions out to disk. **/
+	Result write_back(kstd::vector<kstd::Arc<BlockCacheRegion>>& regions, size_t start, size_t end);
+	/** Marks a region as written or not written. Should be called with the region's lock held. **/
+	void mark_dirty(const kstd::Arc<BlockCacheRegion>& region);
+	void mark_clean(const kstd::Arc<BlockCacheRegion>& region);
+	static size_t dirty_limit_pages();
+	static kstd::vector<DiskDevice*> disk_devices();
 
 	kstd::LRUCache<size_t, kstd::Arc<BlockCacheRegion>> _cache_regions;
-	kstd::Arc<BlockCacheRegion> get_cache_region(size_t block);
+	kstd::map<size_t, kstd::Arc<BlockCacheRegion>> _dirty_regions; ///< Written regions, by start block. Uses _cache_lock.
+	/**
+	 * Gets a run of adjacent cache regions, reading the ones that aren't in the cache in from disk. Runs of missing
+	 * regions are read in with one request each.
+	 * @param start_block The first block of the first region. Must be at the start of a region.
+	 * @param num_regions The number of regions to get. At most BLOCK_CACHE_MAX_REQUEST_PAGES.
+	 */
+	ResultRet<kstd::small_vector<kstd::Arc<BlockCacheRegion>, BLOCK_CACHE_MAX_REQUEST_PAGES>> get_cache_regions(size_t start_block, size_t num_regions);
+	/** Waits for a region that may still be loading to be loaded. **/
+	ResultRet<kstd::Arc<BlockCacheRegion>> wait_for_region(const kstd::Arc<BlockCacheRegion>& region);
 	inline size_t blocks_per_cache_region() { return PAGE_SIZE / block_size(); }
 	inline size_t block_cache_region_start(size_t block) { return block - (block % blocks_per_cache_region()); }
-	SpinLock _cache_lock;
+	Mutex _cache_lock;
+	BlockIOQueue _io_queue {*this};
 };
 
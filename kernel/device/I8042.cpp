@@ -136,18 +136,30 @@ void I8042::handle_irq() {
 	controller_command(I8042_CMD_ENABLE_PORT1);
 	controller_command(I8042_CMD_ENABLE_PORT2);
 
-	if((status & I8042_STATUS_WHICH_BUFFER) == I8042_KEYBOARD_BUFFER) {
-		if(!_keyboard) {
-			KLog::warn("I8042", "Received keyboard buffer data, but no keyboard device is present!");
-			return;
-		}
-		_keyboard->handle_byte(byte);
-	} else {
-		if(!_mouse) {
-			KLog::warn("I8042", "Received mouse buffer data, but no mouse device is present!");
-			return;
+	//Handling the byte can mean redrawing a terminal, so leave that to the work queue
+	auto device = (status & I8042_STATUS_WHICH_BUFFER) == I8042_KEYBOARD_BUFFER ? KEYBOARD : MOUSE;
+	if(!_pending.push({byte, device}))
+		return;
+	WorkQueue::system().queue(_work);
+}
+
+void I8042::handle_pending(void* data) {
+	auto& i8042 = *((I8042*) data);
+	PendingByte pending;
+	while(i8042._pending.pop(pending)) {
+		if(pending.device == KEYBOARD) {
+			if(!i8042._keyboard) {
+				KLog::warn("I8042", "Received keyboard buffer data, but no keyboard device is present!");
+				continue;
+			}
+			i8042._keyboard->handle_byte(pending.byte);
+		} else {
+			if(!i8042._mouse) {
+				KLog::warn("I8042", "Received mouse buffer data, but no mouse device is present!");
+				continue;
+			}
+			i8042._mouse->handle_byte(pending.byte);
 		}
-		_mouse->handle_byte(byte);
 	}
 }
 
@@ -20,6 +20,9 @@
 #pragma once
 
 #include <kernel/kstd/types.h>
+#include <kernel/tasking/SpinLock.h>
+#include <kernel/tasking/WorkQueue.h>
+#include <kernel/kstd/lockfree_queue.hpp>
 
 //Ports
 #define I8042_BUFFER 0x60u
@@ -64,6 +67,7 @@
 #define I8042_SELF_TEST_SUCCESSFUL 0x55u
 #define I8042_RESET_SUCCESSFUL 0xAAu
 #define I8042_ACK 0xFAu
+#define I8042_PENDING_BYTES 64
 
 class KeyboardDevice;
 class MouseDevice;
@@ -77,15 +81,23 @@ public:
 	static I8042& inst();
 	static bool init();
 
+	/// Reads a byte from the controller and queues it to be handled by the keyboard or mouse on the work queue.
 	void handle_irq();
 
 private:
 	friend class KeyboardDevice;
 	friend class MouseDevice;
 
+	struct PendingByte {
+		uint8_t byte;
+		DeviceType device;
+	};
+
 	I8042() = default;
 	static I8042* _inst;
 
+	static void handle_pending(void* data);
+
 	static void controller_command(uint8_t command);
 	static uint8_t controller_command_read(uint8_t command);
 	static void write_config(uint8_t config);
@@ -99,6 +111,9 @@ private:
 
 	KeyboardDevice* _keyboard;
 	MouseDevice* _mouse;
+
+	kstd::mpsc_queue<PendingByte, I8042_PENDING_BYTES> _pending; ///< Pushed to by both the keyboard and mouse IRQs.
+	WorkQueue::Work _work {handle_pending, this};
 };
 
 
@@ -0,0 +1,104 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "InputDevice.h"
+#include <kernel/time/TimeManager.h>
+#include <kernel/api/errno.h>
+
+InputDevice* InputDevice::s_inst = nullptr;
+
+InputDevice* InputDevice::inst() {
+	return s_inst;
+}
+
+InputDevice::InputDevice(): CharacterDevice(13, 2) {
+	s_inst = this;
+}
+
+void InputDevice::push_mouse(const MouseEvent& event) {
+	InputEvent evt = {TimeManager::uptime_us(), INPUT_EVENT_MOUSE};
+	evt.mouse = event;
+	push(evt);
+}
+
+void InputDevice::push_keyboard(const KeyboardEvent& event) {
+	InputEvent evt = {TimeManager::uptime_us(), INPUT_EVENT_KEYBOARD};
+	evt.keyboard = event;
+	push(evt);
+}
+
+void InputDevice::push(const InputEvent& event) {
+	// If nobody's reading, drop the event
+	m_events.push(event);
+	m_poll_queue.wake();
+}
+
+ssize_t InputDevice::read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
+	SafePointer<InputEvent> events = buffer;
+	size_t max_events = count / sizeof(InputEvent);
+	size_t num_events = 0;
+	LOCK(m_read_lock);
+	while(num_events < max_events) {
+		InputEvent event;
+		if(m_has_pending) {
+			event = m_pending;
+			m_has_pending = false;
+		} else if(!m_events.pop(event)) {
+			break;
+		}
+
+		// Anything still in the queue came in while the reader was busy, so it can be folded into this event
+		if(m_coalesce) {
+			InputEvent next;
+			while(m_events.pop(next)) {
+				if(!coalesce(event, next)) {
+					m_pending = next;
+					m_has_pending = true;
+					break;
+				}
+			}
+		}
+
+		events.set(num_events++, event);
+	}
+	return num_events * sizeof(InputEvent);
+}
+
+ssize_t InputDevice::write(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
+	return 0;
+}
+
+bool InputDevice::can_read(const FileDescriptor& fd) {
+	return m_has_pending || !m_events.empty();
+}
+
+bool InputDevice::can_write(const FileDescriptor& fd) {
+	return false;
+}
+
+int InputDevice::ioctl(unsigned request, SafePointer<void*> argp) {
+	switch(request) {
+		case INPUT_SET_COALESCE:
+			m_coalesce = argp.raw() != nullptr;
+			return SUCCESS;
+		default:
+			return -EINVAL;
+	}
+}
+
+bool InputDevice::coalesce(InputEvent& into, const InputEvent& event) {
+	if(into.type != INPUT_EVENT_MOUSE || event.type != INPUT_EVENT_MOUSE)
+		return false;
+	auto& into_mouse = into.mouse;
+	auto& mouse = event.mouse;
+	if(into_mouse.z || mouse.z || into_mouse.buttons != mouse.buttons || into_mouse.absolute != mouse.absolute)
+		return false;
+	if(mouse.absolute) {
+		into_mouse.x = mouse.x;
+		into_mouse.y = mouse.y;
+	} else {
+		into_mouse.x += mouse.x;
+		into_mouse.y += mouse.y;
+	}
+	return true;
+}
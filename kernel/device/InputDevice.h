@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "CharacterDevice.h"
+#include <kernel/kstd/lockfree_queue.hpp>
+#include <kernel/tasking/SpinLock.h>
+#include <kernel/api/hid.h>
+
+/**
+ * /dev/input/events, which merges the events of the mouse and keyboard into one timestamped stream so that they can be
+ * handled with a single read. The devices push their events here as well as to their own queues.
+ */
+class InputDevice: public CharacterDevice {
+public:
+	static InputDevice* inst();
+
+	InputDevice();
+
+	/// Adds an event to the stream, timestamped with the current time. Safe to call from an interrupt.
+	void push_mouse(const MouseEvent& event);
+	void push_keyboard(const KeyboardEvent& event);
+
+	//File
+	ssize_t read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
+	ssize_t write(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
+	bool can_read(const FileDescriptor& fd) override;
+	bool can_write(const FileDescriptor& fd) override;
+	int ioctl(unsigned request, SafePointer<void*> argp) override;
+
+private:
+	void push(const InputEvent& event);
+	/// Folds event into into if they're both plain mouse movement with the same buttons held. Returns whether it did.
+	static bool coalesce(InputEvent& into, const InputEvent& event);
+
+	static InputDevice* s_inst;
+	kstd::mpsc_queue<InputEvent, 1024> m_events;
+	SpinLock m_read_lock; ///< Only one reader can pop from the event queue at a time.
+	InputEvent m_pending; ///< An event that was popped while coalescing, but couldn't be folded in.
+	bool m_has_pending = false;
+	bool m_coalesce = false;
+};
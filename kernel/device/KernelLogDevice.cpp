@@ -20,6 +20,7 @@
 #include "KernelLogDevice.h"
 #include <kernel/tasking/TaskManager.h>
 #include <kernel/kstd/KLog.h>
+#include <kernel/kstd/kstdlib.h>
 #include <kernel/time/TimeManager.h>
 
 KernelLogDevice* KernelLogDevice::_inst = nullptr;
@@ -59,22 +60,31 @@ ssize_t KernelLogDevice::write(FileDescriptor& fd, size_t offset, SafePointer<ui
 	//Only print debug messages #ifdef DEBUG
 	if(log_level != 6 || do_debug) {
 		auto time = TimeManager::uptime();
-		char* usec_buf = "0000000";
+		char usec_buf[8] = "0000000";
 		for(int i = 0; i < 7; i++) {
 			usec_buf[6 - i] = (unsigned char) (time.tv_usec % 10) + '0';
 			time.tv_usec /= 10;
 		}
 
+		//The message goes into the kernel log a record at a time, so that writing it doesn't wait on the serial port
+		char buf[KLOG_RECORD_SIZE];
 		auto* cur_proc = TaskManager::current_process();
-		printf("%s[%d.%s] %s(%d) [%s] ", log_colors[log_level], (int)time.tv_sec, usec_buf, cur_proc->name().c_str(), cur_proc->pid(), log_names[log_level]);
-
-		while(count--) {
-			//If the last character is a newline, ignore it. We're going to print that ourselves.
-			if(count || buffer.get(off) != '\n')
-				putch(buffer.get(off++));
+		size_t len = min(snprintf(buf, sizeof(buf), "%s[%d.%s] %s(%d) [%s] ", log_colors[log_level], (int)time.tv_sec, usec_buf, cur_proc->name().c_str(), cur_proc->pid(), log_names[log_level]), sizeof(buf) - 1);
+
+		//If the last character is a newline, ignore it. We're going to print that ourselves.
+		if(count && buffer.get(off + count - 1) == '\n')
+			count--;
+		while(count) {
+			size_t chunk = min(count, sizeof(buf) - len);
+			buffer.read((uint8_t*) buf + len, off, chunk);
+			KLog::write(buf, len + chunk);
+			off += chunk;
+			count -= chunk;
+			len = 0;
 		}
-
-		printf("\033[39;49m\n");
+		if(len)
+			KLog::write(buf, len);
+		KLog::write("\033[39;49m\n", 9);
 	}
 
 	return ret;
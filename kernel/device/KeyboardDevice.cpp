@@ -21,6 +21,7 @@
 #include <kernel/IO.h>
 #include "KeyboardDevice.h"
 #include "I8042.h"
+#include "InputDevice.h"
 #include <kernel/kstd/cstring.h>
 #include <kernel/kstd/KLog.h>
 
@@ -34,7 +35,7 @@ KeyboardDevice* KeyboardDevice::_instance;
 
 KeyboardDevice* KeyboardDevice::inst() { return _instance;}
 
-KeyboardDevice::KeyboardDevice(): CharacterDevice(13, 0), IRQHandler(1), _event_buffer(1024) {
+KeyboardDevice::KeyboardDevice(): CharacterDevice(13, 0), IRQHandler(1) {
 	_instance = this;
 }
 
@@ -42,14 +43,11 @@ ssize_t KeyboardDevice::read(FileDescriptor &fd, size_t offset, SafePointer<uint
 	size_t ret = 0;
 	SafePointer<KeyEvent> key_buffer = buffer;
 	int event_idx = 0;
-	while(ret < count) {
-		TaskManager::ScopedCritical critical;
-		if(_event_buffer.empty())
+	LOCK(_read_lock);
+	while(count - ret >= sizeof(KeyEvent)) {
+		KeyEvent evt;
+		if(!_event_buffer.pop(evt))
 			break;
-		if((count - ret) < sizeof(KeyEvent))
-			break;
-		auto evt = _event_buffer.pop_front();
-		critical.exit();
 		key_buffer.set(event_idx, evt);
 		ret += sizeof(KeyEvent);
 		event_idx++;
@@ -78,7 +76,6 @@ void KeyboardDevice::handle_irq(Registers *regs) {
 }
 
 void KeyboardDevice::handle_byte(uint8_t byte) {
-	send_eoi();
 	auto scancode = byte;
 	auto key = scancode & 0x7fu;
 	bool key_pressed = !(scancode & KBD_IS_PRESSED);
@@ -133,7 +130,8 @@ void KeyboardDevice::set_key_state(uint8_t scancode, bool pressed) {
 	if (_handler != nullptr)
 		_handler->handle_key(event);
 	_e0_flag = false;
-	if(_event_buffer.size() == _event_buffer.capacity())
-		_event_buffer.pop_front();
-	_event_buffer.push_back(event);
+	//The work queue is the only producer, so this doesn't need to lock out readers. If nobody's reading, drop the event.
+	_event_buffer.push(event);
+	InputDevice::inst()->push_keyboard({event.scancode, event.key, event.character, event.modifiers});
+	m_poll_queue.wake();
 }
\ No newline at end of file
@@ -21,7 +21,8 @@
 
 #include "CharacterDevice.h"
 #include <kernel/keyboard.h>
-#include <kernel/kstd/circular_queue.hpp>
+#include <kernel/kstd/lockfree_queue.hpp>
+#include <kernel/tasking/SpinLock.h>
 #include <kernel/interrupt/IRQHandler.h>
 
 class KeyEvent {
@@ -63,7 +64,8 @@ private:
 	void set_mod(uint8_t mod, bool state);
 	void set_key_state(uint8_t key, bool pressed);
 
-	kstd::circular_queue<KeyEvent> _event_buffer;
+	kstd::spsc_queue<KeyEvent, 1024> _event_buffer;
+	SpinLock _read_lock; ///< Only one reader can pop from the event buffer at a time.
 	KeyboardHandler* _handler = nullptr;
 	uint8_t _modifiers = 0;
 	bool _e0_flag = false;
@@ -23,6 +23,7 @@
 #include "MouseDevice.h"
 #include "I8042.h"
 #include "../VMWare.h"
+#include "InputDevice.h"
 #include <kernel/kstd/cstring.h>
 #include <kernel/kstd/KLog.h>
 
@@ -32,7 +33,7 @@ MouseDevice *MouseDevice::inst() {
 	return instance;
 }
 
-MouseDevice::MouseDevice(): CharacterDevice(13, 1), event_buffer(128), IRQHandler(12)  {
+MouseDevice::MouseDevice(): CharacterDevice(13, 1), IRQHandler(12)  {
 	instance = this;
 	KLog::dbg("I8042/Mouse", "Initializing mouse...");
 	I8042::read(I8042::MOUSE); // Drain buffer
@@ -82,12 +83,11 @@ MouseDevice::MouseDevice(): CharacterDevice(13, 1), event_buffer(128), IRQHandle
 
 ssize_t MouseDevice::read(FileDescriptor &fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
 	size_t ret = 0;
-	while(ret < count) {
-		TaskManager::ScopedCritical critical;
-		if(event_buffer.empty()) break;
-		if((count - ret) < sizeof(MouseEvent)) break;
-		auto evt = event_buffer.pop_front();
-		critical.exit();
+	LOCK(read_lock);
+	while(count - ret >= sizeof(MouseEvent)) {
+		MouseEvent evt;
+		if(!event_buffer.pop(evt))
+			break;
 		buffer.write((uint8_t*) &evt, ret, sizeof(MouseEvent));
 		ret += sizeof(MouseEvent);
 	}
@@ -134,10 +134,11 @@ void MouseDevice::handle_byte(uint8_t byte) {
 
 void MouseDevice::handle_vmware_bytes() {
 	while(VMWare::inst().mouse_queue_size() >= 4) {
-		if(event_buffer.size() == event_buffer.capacity())
-			event_buffer.pop_front();
-		event_buffer.push_back(VMWare::inst().read_mouse_event());
+		auto event = VMWare::inst().read_mouse_event();
+		event_buffer.push(event);
+		InputDevice::inst()->push_mouse(event);
 	}
+	m_poll_queue.wake();
 }
 
 bool MouseDevice::can_read(const FileDescriptor& fd) {
@@ -171,7 +172,8 @@ void MouseDevice::handle_packet() {
 		y = 0;
 	}
 
-	if(event_buffer.size() == event_buffer.capacity())
-		event_buffer.pop_front();
-	event_buffer.push_back({x, y, z, (uint8_t) (packet_data[0] & 0x7u), false});
+	MouseEvent event = {x, y, z, (uint8_t) (packet_data[0] & 0x7u), false};
+	event_buffer.push(event);
+	InputDevice::inst()->push_mouse(event);
+	m_poll_queue.wake();
 }
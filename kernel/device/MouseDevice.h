@@ -21,7 +21,8 @@
 
 #include <kernel/interrupt/IRQHandler.h>
 #include <kernel/device/CharacterDevice.h>
-#include <kernel/kstd/circular_queue.hpp>
+#include <kernel/kstd/lockfree_queue.hpp>
+#include <kernel/tasking/SpinLock.h>
 #include <kernel/api/hid.h>
 
 #define I8042_BUFFER 0x60u
@@ -73,7 +74,8 @@ private:
 	bool has_scroll_wheel = false;
 	uint8_t packet_data[4];
 	uint8_t packet_state = 0;
-	kstd::circular_queue<MouseEvent> event_buffer;
+	kstd::spsc_queue<MouseEvent, 128> event_buffer;
+	SpinLock read_lock; ///< Only one reader can pop from the event buffer at a time.
 };
 
 
@@ -90,6 +90,10 @@ size_t MultibootVGADevice::get_display_height() {
 	return framebuffer_height;
 }
 
+size_t MultibootVGADevice::get_display_pitch() {
+	return framebuffer_pitch;
+}
+
 uint32_t *MultibootVGADevice::get_framebuffer() {
 	return framebuffer;
 }
@@ -33,6 +33,7 @@ public:
 	bool is_textmode();
 	size_t get_display_width() override;
 	size_t get_display_height() override;
+	size_t get_display_pitch() override;
 	uint32_t* get_framebuffer();
 	size_t framebuffer_size();
 	void scroll(size_t pixels) override;
@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+#include <kernel/api/page_size.h>
+
+//PCI
+#define PCI_TYPE_NVM_CONTROLLER 0x0108
+#define PCI_PROG_IF_NVME 0x2
+
+//Controller registers
+#define NVME_CAP   0x00 //64
+#define NVME_VS    0x08
+#define NVME_INTMS 0x0C
+#define NVME_INTMC 0x10
+#define NVME_CC    0x14
+#define NVME_CSTS  0x1C
+#define NVME_AQA   0x24
+#define NVME_ASQ   0x28 //64
+#define NVME_ACQ   0x30 //64
+#define NVME_DOORBELLS 0x1000
+
+#define NVME_CAP_MQES(cap)   ((cap) & 0xFFFFu)
+#define NVME_CAP_TO(cap)     (((cap) >> 24u) & 0xFFu) //In units of 500ms
+#define NVME_CAP_DSTRD(cap)  (((cap) >> 32u) & 0xFu)
+#define NVME_CAP_MPSMIN(cap) (((cap) >> 48u) & 0xFu)
+#define NVME_CC_EN           (1u << 0u)
+#define NVME_CC_IOSQES(n)    ((n) << 16u)
+#define NVME_CC_IOCQES(n)    ((n) << 20u)
+#define NVME_CSTS_RDY        (1u << 0u)
+#define NVME_CSTS_CFS        (1u << 1u)
+
+//Admin commands
+#define NVME_ADMIN_CREATE_SQ 0x01
+#define NVME_ADMIN_CREATE_CQ 0x05
+#define NVME_ADMIN_IDENTIFY 0x06
+#define NVME_ADMIN_SET_FEATURES 0x09
+
+#define NVME_IDENTIFY_NAMESPACE 0x0
+#define NVME_IDENTIFY_CONTROLLER 0x1
+#define NVME_FEATURE_NUM_QUEUES 0x07
+#define NVME_QUEUE_CONTIGUOUS (1u << 0u)
+#define NVME_QUEUE_IRQ_ENABLED (1u << 1u)
+
+//I/O commands
+#define NVME_IO_WRITE 0x01
+#define NVME_IO_READ 0x02
+
+//Identify controller fields
+#define NVME_IDENTITY_MODEL_NUMBER 24
+#define NVME_IDENTITY_MODEL_NUMBER_LENGTH 40
+#define NVME_IDENTITY_MDTS 77
+#define NVME_IDENTITY_NN 516
+
+//Identify namespace fields
+#define NVME_NS_IDENTITY_NSZE 0
+#define NVME_NS_IDENTITY_FLBAS 26
+#define NVME_NS_IDENTITY_LBAF 128
+
+//Sizes
+#define NVME_SQ_ENTRY_SIZE_SHIFT 6
+#define NVME_CQ_ENTRY_SIZE_SHIFT 4
+#define NVME_QUEUE_ENTRIES 64
+// The most commands each queue has in flight at once. A queue can only hold one less than its number of entries.
+#define NVME_QUEUE_SLOTS 32
+#define NVME_MAX_IO_QUEUES 8
+#define NVME_MAX_NAMESPACES 16
+// The most pages transferred with one command. A PRP list big enough for that is set aside for each slot.
+#define NVME_MAX_TRANSFER_PAGES 32
+#define NVME_PRP_LIST_SIZE 512
+
+typedef struct __attribute__((packed)) NVMeCommand {
+	uint8_t opcode;
+	uint8_t flags;
+	uint16_t command_id;
+	uint32_t nsid;
+	uint32_t reserved[2];
+	uint64_t metadata;
+	uint64_t prp1;
+	uint64_t prp2;
+	uint32_t cdw10;
+	uint32_t cdw11;
+	uint32_t cdw12;
+	uint32_t cdw13;
+	uint32_t cdw14;
+	uint32_t cdw15;
+} NVMeCommand;
+
+typedef struct __attribute__((packed)) NVMeCompletion {
+	uint32_t result;
+	uint32_t reserved;
+	uint16_t sq_head;
+	uint16_t sq_id;
+	uint16_t command_id;
+	uint16_t status; //Phase tag (bit 0) and status field (bits 1-15)
+} NVMeCompletion;
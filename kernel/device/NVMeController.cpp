@@ -0,0 +1,234 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "NVMeController.h"
+#include "NVMeDevice.h"
+#include <kernel/IO.h>
+#include <kernel/CommandLine.h>
+#include <kernel/kstd/KLog.h>
+#include <kernel/kstd/cstring.h>
+#include <kernel/memory/MemoryManager.h>
+#include <kernel/tasking/Processor.h>
+
+NVMeController* NVMeController::find() {
+	PCI::Address addr = {0, 0, 0};
+	PCI::enumerate_devices([](PCI::Address addr, PCI::ID id, uint16_t type, void* data) {
+		if(type == PCI_TYPE_NVM_CONTROLLER && PCI::read_byte(addr, PCI_PROG_IF) == PCI_PROG_IF_NVME)
+			*((PCI::Address*) data) = addr;
+	}, &addr);
+	if(addr.is_zero())
+		return nullptr;
+
+	auto* controller = new NVMeController(addr);
+	if(!controller->m_admin_queue) {
+		delete controller;
+		return nullptr;
+	}
+	return controller;
+}
+
+NVMeController::NVMeController(PCI::Address addr): m_pci_addr(addr) {
+	//Map the controller's registers and doorbells. The BAR is 64 bits, but we can only get at it if it's below 4GiB.
+	uint32_t bar_low = PCI::read_dword(addr, PCI_BAR0);
+	uint32_t bar_high = PCI::read_dword(addr, PCI_BAR1);
+	if((bar_low & 0x6) == 0x4 && bar_high) {
+		KLog::err("NVMe", "Controller's registers are above 4GiB!");
+		return;
+	}
+	m_regs = MM.alloc_mapped_region(bar_low & ~0xFu, NVME_DOORBELLS + PAGE_SIZE);
+	PCI::enable_bus_mastering(addr);
+	PCI::disable_interrupt(addr);
+
+	m_cap = read_reg(NVME_CAP) | ((uint64_t) read_reg(NVME_CAP + 4) << 32);
+	m_doorbell_stride = 4 << NVME_CAP_DSTRD(m_cap);
+	if(NVME_CAP_MPSMIN(m_cap) != 0) {
+		KLog::err("NVMe", "Controller doesn't support %d-byte pages!", PAGE_SIZE);
+		return;
+	}
+
+	//Reset the controller and give it the admin queue. Its commands are always polled for.
+	if(set_enabled(false).is_error())
+		return;
+	auto* admin_queue = new NVMeQueue(*this, 0);
+	uint32_t entries = admin_queue->num_entries();
+	write_reg(NVME_AQA, ((entries - 1) << 16) | (entries - 1));
+	write_reg(NVME_ASQ, admin_queue->submission_paddr());
+	write_reg(NVME_ASQ + 4, 0);
+	write_reg(NVME_ACQ, admin_queue->completion_paddr());
+	write_reg(NVME_ACQ + 4, 0);
+	write_reg(NVME_CC, NVME_CC_IOSQES(NVME_SQ_ENTRY_SIZE_SHIFT) | NVME_CC_IOCQES(NVME_CQ_ENTRY_SIZE_SHIFT));
+	if(set_enabled(true).is_error()) {
+		delete admin_queue;
+		return;
+	}
+	m_admin_queue = admin_queue;
+
+	uint32_t version = read_reg(NVME_VS);
+	KLog::info("NVMe", "Found NVMe %d.%d controller at %x:%x.%x", version >> 16, (version >> 8) & 0xFF,
+			   addr.bus, addr.slot, addr.function);
+
+	auto res = create_io_queues();
+	if(res.is_error()) {
+		KLog::err("NVMe", "Couldn't create I/O queues: %d", res.code());
+		return;
+	}
+
+	res = identify();
+	if(res.is_error())
+		KLog::err("NVMe", "Couldn't identify controller: %d", res.code());
+}
+
+NVMeQueue& NVMeController::io_queue() {
+	return *m_io_queues[Processor::current().id() % m_io_queues.size()];
+}
+
+void NVMeController::ring_doorbell(uint16_t queue, bool completion, uint16_t value) {
+	write_reg(NVME_DOORBELLS + (2 * queue + (completion ? 1 : 0)) * m_doorbell_stride, value);
+}
+
+Result NVMeController::set_enabled(bool enabled) {
+	if(enabled)
+		write_reg(NVME_CC, read_reg(NVME_CC) | NVME_CC_EN);
+	else
+		write_reg(NVME_CC, read_reg(NVME_CC) & ~NVME_CC_EN);
+
+	//The controller says how long it might take to become ready, in units of 500ms
+	size_t timeout_ms = max(NVME_CAP_TO(m_cap), (uint64_t) 1) * 500;
+	for(size_t waited = 0; waited < timeout_ms; waited++) {
+		uint32_t status = read_reg(NVME_CSTS);
+		if(enabled && (status & NVME_CSTS_CFS)) {
+			KLog::err("NVMe", "Controller had a fatal error while starting up!");
+			return Result(-EIO);
+		}
+		if(!!(status & NVME_CSTS_RDY) == enabled)
+			return Result(SUCCESS);
+		IO::wait(1000);
+	}
+
+	KLog::err("NVMe", "Timed out waiting for controller to %s", enabled ? "start up" : "shut down");
+	return Result(-ETIMEDOUT);
+}
+
+ResultRet<uint32_t> NVMeController::admin_command(NVMeCommand& command, const uint8_t* buffer, size_t length) {
+	return m_admin_queue->submit_and_wait(command, buffer, length);
+}
+
+Result NVMeController::create_io_queues() {
+	//Ask for a queue for each processor. The controller may give us fewer.
+	uint32_t wanted = min(Processor::count_detected(), NVME_MAX_IO_QUEUES);
+	NVMeCommand command;
+	memset(&command, 0, sizeof(NVMeCommand));
+	command.opcode = NVME_ADMIN_SET_FEATURES;
+	command.cdw10 = NVME_FEATURE_NUM_QUEUES;
+	command.cdw11 = ((wanted - 1) << 16) | (wanted - 1);
+	auto granted_res = admin_command(command);
+	if(granted_res.is_error())
+		return granted_res.result();
+	uint32_t granted = min(granted_res.value() & 0xFFFF, granted_res.value() >> 16) + 1;
+	uint32_t num_queues = min(wanted, granted);
+
+	//Each queue can only have its own interrupt with MSI-X. Otherwise, there's just the one queue.
+	bool polled = CommandLine::inst().has_option("nvme_poll");
+	uint16_t msix_vectors = PCI::msix_vectors(m_pci_addr);
+	if(msix_vectors < 2)
+		num_queues = 1;
+	else
+		num_queues = min(num_queues, (uint32_t) msix_vectors - 1);
+
+	for(uint16_t id = 1; id <= num_queues; id++) {
+		auto* queue = new NVMeQueue(*this, id);
+
+		//Set up the queue's interrupt. If we run out of vectors, make do with the queues we already have.
+		uint16_t vector = msix_vectors >= 2 ? id : 0;
+		if(!polled) {
+			if(queue->use_msi_entry(m_pci_addr, vector)) {
+				queue->set_polled(false);
+			} else if(id == 1) {
+				uint8_t line = PCI::read_byte(m_pci_addr, PCI_INTERRUPT_LINE);
+				vector = 0;
+				if(line != 0xFF) {
+					queue->use_irq_line(line);
+					queue->set_polled(false);
+					PCI::enable_interrupt(m_pci_addr);
+				}
+			} else {
+				delete queue;
+				break;
+			}
+		}
+
+		memset(&command, 0, sizeof(NVMeCommand));
+		command.opcode = NVME_ADMIN_CREATE_CQ;
+		command.prp1 = queue->completion_paddr();
+		command.cdw10 = ((queue->num_entries() - 1) << 16) | id;
+		command.cdw11 = (vector << 16) | (queue->is_polled() ? 0 : NVME_QUEUE_IRQ_ENABLED) | NVME_QUEUE_CONTIGUOUS;
+		auto res = admin_command(command);
+		if(res.is_error())
+			return res.result();
+
+		memset(&command, 0, sizeof(NVMeCommand));
+		command.opcode = NVME_ADMIN_CREATE_SQ;
+		command.prp1 = queue->submission_paddr();
+		command.cdw10 = ((queue->num_entries() - 1) << 16) | id;
+		command.cdw11 = (id << 16) | NVME_QUEUE_CONTIGUOUS;
+		res = admin_command(command);
+		if(res.is_error())
+			return res.result();
+
+		m_io_queues.push_back(queue);
+	}
+
+	KLog::dbg("NVMe", "Created %d I/O queue(s) (%s)", m_io_queues.size(),
+			  m_io_queues[0]->is_polled() ? "polled" : (msix_vectors >= 2 ? "MSI-X" : "interrupt"));
+	return Result(SUCCESS);
+}
+
+Result NVMeController::identify() {
+	auto identity_region = MM.alloc_kernel_region(PAGE_SIZE);
+	auto* identity = (uint8_t*) identity_region->start();
+
+	NVMeCommand command;
+	memset(&command, 0, sizeof(NVMeCommand));
+	command.opcode = NVME_ADMIN_IDENTIFY;
+	command.cdw10 = NVME_IDENTIFY_CONTROLLER;
+	auto res = admin_command(command, identity, PAGE_SIZE);
+	if(res.is_error())
+		return res.result();
+
+	//The model number is padded with spaces
+	memcpy(m_model_number, identity + NVME_IDENTITY_MODEL_NUMBER, NVME_IDENTITY_MODEL_NUMBER_LENGTH);
+	for(int i = NVME_IDENTITY_MODEL_NUMBER_LENGTH - 1; i >= 0 && m_model_number[i] == ' '; i--)
+		m_model_number[i] = '\0';
+
+	//The maximum transfer size is a power of two multiple of the minimum page size, or 0 if there isn't one
+	uint8_t mdts = identity[NVME_IDENTITY_MDTS];
+	if(mdts && mdts < 16 && ((size_t) PAGE_SIZE << mdts) < m_max_transfer_size)
+		m_max_transfer_size = PAGE_SIZE << mdts;
+
+	//Then set up a disk for each namespace that's there
+	uint32_t num_namespaces = min(*((uint32_t*) (identity + NVME_IDENTITY_NN)), (uint32_t) NVME_MAX_NAMESPACES);
+	for(uint32_t nsid = 1; nsid <= num_namespaces; nsid++) {
+		memset(&command, 0, sizeof(NVMeCommand));
+		command.opcode = NVME_ADMIN_IDENTIFY;
+		command.nsid = nsid;
+		command.cdw10 = NVME_IDENTIFY_NAMESPACE;
+		if(admin_command(command, identity, PAGE_SIZE).is_error())
+			continue;
+
+		uint64_t num_blocks = *((uint64_t*) (identity + NVME_NS_IDENTITY_NSZE));
+		uint8_t format = identity[NVME_NS_IDENTITY_FLBAS] & 0xF;
+		uint8_t block_shift = identity[NVME_NS_IDENTITY_LBAF + format * 4 + 2];
+		if(!num_blocks)
+			continue;
+		if(block_shift < 9 || (1u << block_shift) > PAGE_SIZE) {
+			KLog::warn("NVMe", "Namespace %d has unsupported block size %d", nsid, 1 << block_shift);
+			continue;
+		}
+
+		m_disks.push_back(new NVMeDevice(*this, nsid, num_blocks, 1u << block_shift, m_disks.size()));
+		KLog::info("NVMe", "Setup namespace %d of %s (%d blocks of %d bytes)", nsid, m_model_number, (int) num_blocks,
+				   1 << block_shift);
+	}
+
+	return Result(SUCCESS);
+}
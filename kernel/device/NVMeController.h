@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/pci/PCI.h>
+#include <kernel/memory/VMRegion.h>
+#include <kernel/kstd/vector.hpp>
+#include "NVMeQueue.h"
+
+class NVMeDevice;
+
+/**
+ * An NVMe controller. The controller owns the admin queue, which is only used while it's being set up, and an I/O queue
+ * for each processor (as many as it and its MSI-X table allow). Each I/O queue gets an interrupt vector of its own if
+ * the controller supports MSI-X. A NVMeDevice is set up for each namespace, and all of them share the I/O queues.
+ */
+class NVMeController {
+public:
+	/** Finds the first NVMe controller on the PCI bus and sets up its namespaces. Returns nullptr if there isn't one. **/
+	static NVMeController* find();
+
+	/** The namespaces on the controller, in order. **/
+	const kstd::vector<NVMeDevice*>& disks() const { return m_disks; }
+	/** The I/O queue that the current processor should submit commands to. **/
+	NVMeQueue& io_queue();
+	/** The most bytes that can be transferred with one command. **/
+	size_t max_transfer_size() const { return m_max_transfer_size; }
+	/** The most entries a queue can have. **/
+	uint32_t max_queue_entries() const { return NVME_CAP_MQES(m_cap) + 1; }
+
+	uint32_t read_reg(size_t reg) const { return *((volatile uint32_t*) (m_regs->start() + reg)); }
+	void write_reg(size_t reg, uint32_t value) { *((volatile uint32_t*) (m_regs->start() + reg)) = value; }
+	/** Tells the controller about a new submission queue tail or completion queue head. **/
+	void ring_doorbell(uint16_t queue, bool completion, uint16_t value);
+
+private:
+	explicit NVMeController(PCI::Address addr);
+
+	/** Turns the controller off or on and waits for it to notice. **/
+	Result set_enabled(bool enabled);
+	/** Identifies the controller, and sets up a disk for each namespace. **/
+	Result identify();
+	/** Creates the I/O queues, and sets up their interrupts. **/
+	Result create_io_queues();
+	ResultRet<uint32_t> admin_command(NVMeCommand& command, const uint8_t* buffer = nullptr, size_t length = 0);
+
+	PCI::Address m_pci_addr;
+	kstd::Arc<VMRegion> m_regs;
+	uint64_t m_cap;
+	size_t m_doorbell_stride;
+	size_t m_max_transfer_size = NVME_MAX_TRANSFER_PAGES * PAGE_SIZE;
+	char m_model_number[NVME_IDENTITY_MODEL_NUMBER_LENGTH + 1] = {0};
+	NVMeQueue* m_admin_queue = nullptr;
+	kstd::vector<NVMeQueue*> m_io_queues;
+	kstd::vector<NVMeDevice*> m_disks;
+};
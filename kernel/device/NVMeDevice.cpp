@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "NVMeDevice.h"
+#include "NVMeController.h"
+#include <kernel/kstd/cstring.h>
+
+NVMeDevice::NVMeDevice(NVMeController& controller, uint32_t nsid, uint64_t num_blocks, size_t block_size, unsigned minor):
+	DiskDevice(259, minor),
+	m_controller(controller),
+	m_nsid(nsid),
+	m_num_blocks(num_blocks),
+	m_block_size(block_size)
+{}
+
+NVMeDevice::~NVMeDevice() = default;
+
+Result NVMeDevice::transfer(uint64_t lba, uint32_t count, const uint8_t* buffer, bool write) {
+	if(lba + count > m_num_blocks)
+		return Result(-EINVAL);
+
+	NVMeCommand command;
+	memset(&command, 0, sizeof(NVMeCommand));
+	command.opcode = write ? NVME_IO_WRITE : NVME_IO_READ;
+	command.nsid = m_nsid;
+	command.cdw10 = lba & 0xFFFFFFFF;
+	command.cdw11 = lba >> 32;
+	command.cdw12 = count - 1;
+	auto res = m_controller.io_queue().submit_and_wait(command, buffer, count * m_block_size);
+	return res.is_error() ? res.result() : Result(SUCCESS);
+}
+
+Result NVMeDevice::transfer_all(uint64_t lba, uint32_t count, const uint8_t* buffer, bool write) {
+	uint32_t max_blocks = m_controller.max_transfer_size() / m_block_size;
+	while(count) {
+		uint32_t num_blocks = min(count, max_blocks);
+		auto res = transfer(lba, num_blocks, buffer, write);
+		if(res.is_error())
+			return res;
+		lba += num_blocks;
+		buffer += num_blocks * m_block_size;
+		count -= num_blocks;
+	}
+	return Result(SUCCESS);
+}
+
+Result NVMeDevice::read_uncached_blocks(uint32_t block, uint32_t count, uint8_t* buffer) {
+	return transfer_all(block, count, buffer, false);
+}
+
+Result NVMeDevice::write_uncached_blocks(uint32_t block, uint32_t count, const uint8_t* buffer) {
+	return transfer_all(block, count, buffer, true);
+}
+
+size_t NVMeDevice::num_blocks() {
+	return m_num_blocks;
+}
+
+size_t NVMeDevice::block_size() {
+	return m_block_size;
+}
@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "DiskDevice.h"
+
+class NVMeController;
+
+/**
+ * A namespace of an NVMe controller. Requests are submitted to the I/O queue of the processor they're made on, and the
+ * controller keeps many of them in flight at once and decides what order to service them in.
+ */
+class NVMeDevice: public DiskDevice {
+public:
+	~NVMeDevice() override;
+
+	//DiskDevice
+	Result read_uncached_blocks(uint32_t block, uint32_t count, uint8_t* buffer) override;
+	Result write_uncached_blocks(uint32_t block, uint32_t count, const uint8_t* buffer) override;
+	size_t num_blocks() override;
+	bool queues_requests() override { return true; }
+
+	//BlockDevice
+	size_t block_size() override;
+
+private:
+	friend class NVMeController;
+
+	NVMeDevice(NVMeController& controller, uint32_t nsid, uint64_t num_blocks, size_t block_size, unsigned minor);
+
+	/** Reads or writes up to the controller's maximum transfer size, and sleeps until it's done. **/
+	Result transfer(uint64_t lba, uint32_t count, const uint8_t* buffer, bool write);
+	/** Reads or writes any number of blocks, split up into as few commands as possible. **/
+	Result transfer_all(uint64_t lba, uint32_t count, const uint8_t* buffer, bool write);
+
+	NVMeController& m_controller;
+	uint32_t m_nsid;
+	uint64_t m_num_blocks;
+	size_t m_block_size;
+};
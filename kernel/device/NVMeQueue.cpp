@@ -0,0 +1,156 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "NVMeQueue.h"
+#include "NVMeController.h"
+#include <kernel/kstd/KLog.h>
+#include <kernel/kstd/cstring.h>
+#include <kernel/memory/MemoryManager.h>
+#include <kernel/tasking/TaskManager.h>
+#include <kernel/tasking/Thread.h>
+
+#define SUBMISSIONS_SIZE (NVME_QUEUE_ENTRIES << NVME_SQ_ENTRY_SIZE_SHIFT)
+#define COMPLETIONS_SIZE (NVME_QUEUE_ENTRIES << NVME_CQ_ENTRY_SIZE_SHIFT)
+#define COMPLETIONS_OFFSET ((SUBMISSIONS_SIZE + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1))
+
+NVMeQueue::NVMeQueue(NVMeController& controller, uint16_t id):
+	IRQHandler(),
+	m_controller(controller),
+	m_id(id),
+	m_num_entries(min(controller.max_queue_entries(), (uint32_t) NVME_QUEUE_ENTRIES)),
+	m_num_slots(min((uint32_t) m_num_entries - 1, (uint32_t) NVME_QUEUE_SLOTS))
+{
+	//Both queues have to start on a page boundary, so they get a page (or more) each
+	m_queue_region = MM.alloc_dma_region(COMPLETIONS_OFFSET + COMPLETIONS_SIZE);
+	memset((void*) m_queue_region->start(), 0, COMPLETIONS_OFFSET + COMPLETIONS_SIZE);
+	m_submissions = (NVMeCommand*) m_queue_region->start();
+	m_completions = (volatile NVMeCompletion*) (m_queue_region->start() + COMPLETIONS_OFFSET);
+	m_prp_region = MM.alloc_dma_region(NVME_PRP_LIST_SIZE * m_num_slots);
+}
+
+PhysicalAddress NVMeQueue::submission_paddr() const {
+	return m_queue_region->object()->physical_page(0).paddr();
+}
+
+PhysicalAddress NVMeQueue::completion_paddr() const {
+	return m_queue_region->object()->physical_page(COMPLETIONS_OFFSET / PAGE_SIZE).paddr();
+}
+
+void NVMeQueue::use_irq_line(int irq) {
+	set_irq(irq);
+	reinstall_irq();
+}
+
+int NVMeQueue::reserve_slot() {
+	auto all_slots = (uint32_t) ((1ull << m_num_slots) - 1);
+	while(true) {
+		uint32_t reserved = m_reserved_slots.load();
+		for(uint32_t slot = 0; slot < m_num_slots; slot++) {
+			if(reserved & (1u << slot))
+				continue;
+			if(m_reserved_slots.compare_exchange_strong(reserved, reserved | (1u << slot)))
+				return slot;
+			break;
+		}
+		//Either every slot is in use, or someone else took the one we wanted
+		if((reserved & all_slots) == all_slots)
+			TaskManager::yield();
+	}
+}
+
+void NVMeQueue::release_slot(int slot) {
+	m_reserved_slots.bit_and(~(1u << slot));
+}
+
+void NVMeQueue::prepare_prps(int slot, NVMeCommand& command, const uint8_t* buffer, size_t length) {
+	command.prp1 = 0;
+	command.prp2 = 0;
+	if(!buffer || !length)
+		return;
+
+	//The first PRP can start anywhere in a page, but every page after that is whole
+	ASSERT(!((VirtualAddress) buffer & 3));
+	auto vaddr = (VirtualAddress) buffer;
+	size_t first_size = min(length, PAGE_SIZE - (vaddr % PAGE_SIZE));
+	command.prp1 = MM.kernel_page_directory.get_physaddr(vaddr);
+	vaddr += first_size;
+	length -= first_size;
+	if(!length)
+		return;
+
+	//If it only takes one more page, that goes in the second PRP. Otherwise, the second PRP points to a list of them.
+	size_t num_pages = (length + PAGE_SIZE - 1) / PAGE_SIZE;
+	ASSERT(num_pages <= NVME_MAX_TRANSFER_PAGES);
+	if(num_pages == 1) {
+		command.prp2 = MM.kernel_page_directory.get_physaddr(vaddr);
+		return;
+	}
+	auto* list = (uint64_t*) (m_prp_region->start() + slot * NVME_PRP_LIST_SIZE);
+	for(size_t i = 0; i < num_pages; i++)
+		list[i] = MM.kernel_page_directory.get_physaddr(vaddr + i * PAGE_SIZE);
+	command.prp2 = m_prp_region->object()->physical_page(slot * NVME_PRP_LIST_SIZE / PAGE_SIZE).paddr()
+			+ (slot * NVME_PRP_LIST_SIZE) % PAGE_SIZE;
+}
+
+ResultRet<uint32_t> NVMeQueue::submit_and_wait(NVMeCommand& command, const uint8_t* buffer, size_t length) {
+	int slot = reserve_slot();
+	command.command_id = slot;
+	prepare_prps(slot, command, buffer, length);
+
+	auto& cmd_slot = m_slots[slot];
+	cmd_slot.status = 0;
+	cmd_slot.blocker.set_ready(false);
+	{
+		LOCK(m_submission_lock);
+		memcpy(&m_submissions[m_submission_tail], &command, sizeof(NVMeCommand));
+		m_submission_tail = (m_submission_tail + 1) % m_num_entries;
+		m_controller.ring_doorbell(m_id, false, m_submission_tail);
+	}
+
+	if(m_polled) {
+		while(!cmd_slot.blocker.is_ready()) {
+			if(!process_completions())
+				TaskManager::yield();
+		}
+	} else {
+		TaskManager::current_thread()->block(cmd_slot.blocker);
+	}
+
+	uint16_t status = cmd_slot.status;
+	uint32_t result = cmd_slot.result;
+	release_slot(slot);
+	if(status) {
+		KLog::err("NVMe", "Command 0x%x on queue %d failed with status 0x%x", command.opcode, m_id, status);
+		return Result(-EIO);
+	}
+	return result;
+}
+
+bool NVMeQueue::process_completions() {
+	LOCK(m_completion_lock);
+	bool handled = false;
+	while((m_completions[m_completion_head].status & 1) == m_phase) {
+		auto& completion = m_completions[m_completion_head];
+		uint16_t slot = completion.command_id;
+		if(slot < m_num_slots) {
+			m_slots[slot].result = completion.result;
+			m_slots[slot].status = completion.status >> 1;
+			m_slots[slot].blocker.set_ready(true);
+		}
+
+		//The phase tag flips every time the controller wraps around the queue
+		if(++m_completion_head == m_num_entries) {
+			m_completion_head = 0;
+			m_phase ^= 1;
+		}
+		handled = true;
+	}
+	if(handled)
+		m_controller.ring_doorbell(m_id, true, m_completion_head);
+	return handled;
+}
+
+void NVMeQueue::handle_irq(Registers* regs) {
+	if(process_completions())
+		TaskManager::yield_if_idle();
+}
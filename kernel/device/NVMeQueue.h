@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "NVMe.h"
+#include <kernel/Result.hpp>
+#include <kernel/interrupt/IRQHandler.h>
+#include <kernel/memory/VMRegion.h>
+#include <kernel/tasking/BooleanBlocker.h>
+#include <kernel/tasking/SpinLock.h>
+#include <kernel/Atomic.h>
+
+class NVMeController;
+
+/**
+ * A submission queue and the completion queue it posts to. Like with AHCI, every thread with a command in flight gets a
+ * slot of its own, and the slot's index is used as the command's ID so that completions can be matched up with it.
+ *
+ * Completions are either handled by the queue's interrupt, or polled for by the threads waiting on them.
+ */
+class NVMeQueue: public IRQHandler {
+public:
+	NVMeQueue(NVMeController& controller, uint16_t id);
+
+	uint16_t id() const { return m_id; }
+	uint16_t num_entries() const { return m_num_entries; }
+	PhysicalAddress submission_paddr() const;
+	PhysicalAddress completion_paddr() const;
+
+	/**
+	 * Submits a command and waits for it to complete.
+	 * @param command The command. Its ID and data pointers are filled in by the queue.
+	 * @param buffer The kernel buffer to transfer to or from, or nullptr. Must be dword aligned.
+	 * @param length The length of the buffer. At most NVME_MAX_TRANSFER_PAGES pages.
+	 * @return The result dword of the completion, or -EIO if the command failed.
+	 */
+	ResultRet<uint32_t> submit_and_wait(NVMeCommand& command, const uint8_t* buffer, size_t length);
+
+	/** Makes the queue take completions from a message-signaled interrupt using an entry of the controller's MSI-X table. **/
+	bool use_msi_entry(PCI::Address address, uint16_t entry) { return use_msi(address, entry); }
+	/** Makes the queue take completions from the controller's (possibly shared) legacy interrupt line. **/
+	void use_irq_line(int irq);
+	/** Makes the threads waiting on commands poll for completions instead of waiting for an interrupt. **/
+	void set_polled(bool polled) { m_polled = polled; }
+	bool is_polled() const { return m_polled; }
+
+	//IRQHandler
+	void handle_irq(Registers* regs) override;
+
+private:
+	struct CommandSlot {
+		UninterruptibleBooleanBlocker blocker;
+		volatile uint16_t status = 0;
+		volatile uint32_t result = 0;
+	};
+
+	int reserve_slot();
+	void release_slot(int slot);
+	/** Points the command's PRPs at the buffer, using the slot's PRP list if it needs more than two pages. **/
+	void prepare_prps(int slot, NVMeCommand& command, const uint8_t* buffer, size_t length);
+	/** Handles the completions that have been posted. Returns whether there were any. **/
+	bool process_completions();
+
+	NVMeController& m_controller;
+	uint16_t m_id;
+	uint16_t m_num_entries;
+	uint32_t m_num_slots;
+	bool m_polled = true;
+
+	kstd::Arc<VMRegion> m_queue_region;
+	kstd::Arc<VMRegion> m_prp_region;
+	NVMeCommand* m_submissions;
+	volatile NVMeCompletion* m_completions;
+
+	SpinLock m_submission_lock;
+	uint16_t m_submission_tail = 0;
+	SpinLock m_completion_lock;
+	uint16_t m_completion_head = 0;
+	uint16_t m_phase = 1;
+
+	CommandSlot m_slots[NVME_QUEUE_SLOTS];
+	Atomic<uint32_t, MemoryOrder::SeqCst> m_reserved_slots = 0;
+};
@@ -20,7 +20,6 @@
 #include "PATADevice.h"
 #include <kernel/IO.h>
 #include <kernel/kstd/KLog.h>
-#include <kernel/filesystem/FileDescriptor.h>
 
 PATADevice *PATADevice::find(PATADevice::Channel channel, PATADevice::DriveType drive, bool use_pio) {
 	PCI::Address addr = {0,0,0};
@@ -102,9 +101,9 @@ PATADevice::PATADevice(PCI::Address addr, PATADevice::Channel channel, PATADevic
 	PCI::enable_interrupt(addr);
 	if(!use_pio) {
 		PCI::enable_bus_mastering(addr);
-		_prdt_region = MM.alloc_kernel_region(sizeof(PRDT));
+		_prdt_region = MM.alloc_dma_region(sizeof(PRDT) * ATA_DMA_PRDT_ENTRIES);
 		_prdt = (PRDT*) _prdt_region->start();
-		_dma_region = MM.alloc_dma_region(ATA_MAX_SECTORS_AT_ONCE * 512);
+		_dma_region = MM.alloc_kernel_region(ATA_DMA_MAX_SECTORS * 512);
 
 		//Reset bus master status register
 		IO::outb(_bus_master_base + ATA_BM_STATUS, IO::inb(_bus_master_base + ATA_BM_STATUS) | 0x4u);
@@ -128,92 +127,70 @@ void PATADevice::wait_ready() {
 }
 
 Result PATADevice::read_sectors_dma(size_t lba, uint8_t num_sectors, uint8_t *buf) {
-	ASSERT(num_sectors <= ATA_MAX_SECTORS_AT_ONCE);
+	ASSERT(num_sectors <= ATA_DMA_MAX_SECTORS);
 	LOCK(_lock);
 
-	if(num_sectors * 512 > _dma_region->object()->physical_page(0).paddr())
-		return Result(-EINVAL);
-	_prdt->addr = _dma_region->object()->physical_page(0).paddr();
-	_prdt->size = num_sectors * 512;
-	_prdt->eot = 0x8000;
-
-	//Select drive and wait 10us
-	IO::outb(_io_base + ATA_DRIVESEL, 0xA0u | (_drive == SLAVE ? 0x8u : 0x0u));
-	IO::wait(10);
-
-	//Stop bus master, write PRDT, clear flags, and set direction to read
-	IO::outb(_bus_master_base, 0);
-	IO::outl(_bus_master_base + ATA_BM_PRDT, _prdt_region->object()->physical_page(0).paddr());
-	IO::outb(_bus_master_base, ATA_BM_READ);
-	IO::outb(_bus_master_base + ATA_BM_STATUS, IO::inb(_bus_master_base + ATA_BM_STATUS) | 0x6u);
-
-	//Access the drive
-	access_drive(ATA_READ_DMA, lba, num_sectors);
-
-	//Wait for DRQ bit and start bus master
-	while(!(IO::inb(_control_base) & ATA_STATUS_DRQ));
-	IO::outb(_bus_master_base, 0x9);
-
-	//Wait for irq
-	TaskManager::current_thread()->block(_blocker);
-	_blocker.set_ready(false);
-	uninstall_irq();
-
-	if(_post_irq_status & ATA_STATUS_ERR) {
-		KLog::err("PATA", "DMA read fail with status 0x%x and busmaster status 0x%x", _post_irq_status, _post_irq_bm_status);
-		return Result(-EIO);
-	}
+	auto res = transfer_dma(lba, num_sectors, false);
+	if(res.is_error())
+		return res;
 
 	//Copy to buffer
 	memcpy((void *) buf, (void*) _dma_region->start(), 512 * num_sectors);
-
-	//Tell bus master we're done
-	IO::outb(_bus_master_base + ATA_BM_STATUS, IO::inb(_bus_master_base + ATA_BM_STATUS) | 0x6u);
-
 	return Result(SUCCESS);
 }
 
 Result PATADevice::write_sectors_dma(size_t lba, uint8_t num_sectors, const uint8_t *buf) {
-	ASSERT(num_sectors <= ATA_MAX_SECTORS_AT_ONCE);
+	ASSERT(num_sectors <= ATA_DMA_MAX_SECTORS);
 	LOCK(_lock);
 
-	if(num_sectors * 512 > _dma_region->size())
-		return Result(-EINVAL);
-	_prdt->addr = _dma_region->object()->physical_page(0).paddr();
-	_prdt->size = num_sectors * 512;
-	_prdt->eot = 0x8000;
-
-	//Copy to buffer
+	//Copy from buffer
 	memcpy((void*) _dma_region->start(), buf, 512 * num_sectors);
+	return transfer_dma(lba, num_sectors, true);
+}
+
+Result PATADevice::transfer_dma(uint32_t lba, uint8_t num_sectors, bool write) {
+	//Give each page of the transfer its own PRDT entry
+	size_t bytes_left = num_sectors * 512;
+	size_t num_entries = 0;
+	while(bytes_left) {
+		size_t entry_size = min(bytes_left, (size_t) PAGE_SIZE);
+		_prdt[num_entries].addr = _dma_region->object()->physical_page(num_entries).paddr();
+		_prdt[num_entries].size = entry_size;
+		_prdt[num_entries].eot = 0;
+		bytes_left -= entry_size;
+		num_entries++;
+	}
+	_prdt[num_entries - 1].eot = ATA_PRDT_EOT;
 
 	//Select drive and wait 10us
 	IO::outb(_io_base + ATA_DRIVESEL, 0xA0u | (_drive == SLAVE ? 0x8u : 0x0u));
 	IO::wait(10);
 
-	//Stop bus master, write PRDT, and clear flags
+	//Stop bus master, write PRDT, set direction, and clear flags
 	IO::outb(_bus_master_base, 0);
 	IO::outl(_bus_master_base + ATA_BM_PRDT, _prdt_region->object()->physical_page(0).paddr());
+	IO::outb(_bus_master_base, write ? 0 : ATA_BM_READ);
 	IO::outb(_bus_master_base + ATA_BM_STATUS, IO::inb(_bus_master_base + ATA_BM_STATUS) | 0x6u);
 
-	access_drive(ATA_WRITE_DMA, lba, num_sectors);
+	//Access the drive and start the bus master. The drive doesn't need to be polled for DRQ since the bus master
+	//handles the actual transfer.
+	access_drive(write ? ATA_WRITE_DMA : ATA_READ_DMA, lba, num_sectors);
+	IO::outb(_bus_master_base, (write ? 0 : ATA_BM_READ) | 0x1u);
 
-	//Wait for DRQ / not busy and start bus master
-	while(IO::inb(_control_base) & ATA_STATUS_BSY || !(IO::inb(_control_base) & ATA_STATUS_DRQ));
-	IO::outb(_bus_master_base, 0x1);
-
-	//Wait for irq
+	//Sleep until the irq says we're done
 	TaskManager::current_thread()->block(_blocker);
 	_blocker.set_ready(false);
 	uninstall_irq();
 
+	//Tell bus master we're done
+	IO::outb(_bus_master_base, 0);
+	IO::outb(_bus_master_base + ATA_BM_STATUS, IO::inb(_bus_master_base + ATA_BM_STATUS) | 0x6u);
+
 	if(_post_irq_status & ATA_STATUS_ERR) {
-		KLog::err("PATA", "DMA write fail with status 0x%x and busmaster status 0x%x", _post_irq_status, _post_irq_bm_status);
+		KLog::err("PATA", "DMA %s fail with status 0x%x and busmaster status 0x%x", write ? "write" : "read", _post_irq_status, _post_irq_bm_status);
 		return Result(-EIO);
 	}
 
-	//Tell bus master we're done
-	IO::outb(_bus_master_base + ATA_BM_STATUS, IO::inb(_bus_master_base + ATA_BM_STATUS) | 0x6u);
-
 	return Result(SUCCESS);
 }
 
@@ -282,10 +259,10 @@ void PATADevice::access_drive(uint8_t command, uint32_t lba, uint8_t num_sectors
 Result PATADevice::read_uncached_blocks(uint32_t block, uint32_t count, uint8_t *buffer) {
 	if(!_use_pio) {
 		//DMA mode
-		size_t num_chunks = (count + ATA_MAX_SECTORS_AT_ONCE - 1) / ATA_MAX_SECTORS_AT_ONCE;
+		size_t num_chunks = (count + ATA_DMA_MAX_SECTORS - 1) / ATA_DMA_MAX_SECTORS;
 		for (size_t i = 0; i < num_chunks; i++) {
-			uint32_t num_sectors = min((size_t) ATA_MAX_SECTORS_AT_ONCE, count);
-			Result res = read_sectors_dma(block + i * ATA_MAX_SECTORS_AT_ONCE, num_sectors, buffer + (512 * i * ATA_MAX_SECTORS_AT_ONCE));
+			uint32_t num_sectors = min((size_t) ATA_DMA_MAX_SECTORS, count);
+			Result res = read_sectors_dma(block + i * ATA_DMA_MAX_SECTORS, num_sectors, buffer + (512 * i * ATA_DMA_MAX_SECTORS));
 			if (res.is_error()) return res;
 			count -= num_sectors;
 		}
@@ -305,10 +282,10 @@ Result PATADevice::read_uncached_blocks(uint32_t block, uint32_t count, uint8_t
 Result PATADevice::write_uncached_blocks(uint32_t block, uint32_t count, const uint8_t *buffer) {
 	if(!_use_pio) {
 		//DMA mode
-		size_t num_chunks = (count + ATA_MAX_SECTORS_AT_ONCE - 1) / ATA_MAX_SECTORS_AT_ONCE;
+		size_t num_chunks = (count + ATA_DMA_MAX_SECTORS - 1) / ATA_DMA_MAX_SECTORS;
 		for (size_t i = 0; i < num_chunks; i++) {
-			uint32_t num_sectors = min((size_t) ATA_MAX_SECTORS_AT_ONCE, count);
-			Result res = write_sectors_dma(block + i * ATA_MAX_SECTORS_AT_ONCE, num_sectors, buffer + (512 * i * ATA_MAX_SECTORS_AT_ONCE));
+			uint32_t num_sectors = min((size_t) ATA_DMA_MAX_SECTORS, count);
+			Result res = write_sectors_dma(block + i * ATA_DMA_MAX_SECTORS, num_sectors, buffer + (512 * i * ATA_DMA_MAX_SECTORS));
 			if(res.is_error())
 				return res;
 			count -= num_sectors;
@@ -330,94 +307,8 @@ size_t PATADevice::block_size() {
 	return 512;
 }
 
-ssize_t PATADevice::read(FileDescriptor &fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
-	size_t first_block = offset / block_size();
-	size_t first_block_start = offset % block_size();
-	size_t bytes_left = count;
-	size_t block = first_block;
-	ssize_t nread = 0;
-
-	uint8_t block_buf[block_size()];
-	while(bytes_left) {
-		if(block > _max_addressable_block)
-			break;
-
-		Result res = read_block(block, block_buf);
-		if(res.is_error())
-			return res.code();
-
-		if(block == first_block) {
-			if(count < block_size() - first_block_start) {
-				buffer.write(block_buf + first_block_start, count);
-				nread += count;
-				bytes_left = 0;
-			} else {
-				buffer.write(block_buf + first_block_start, block_size() - first_block_start);
-				nread += block_size() - first_block_start;
-				bytes_left -= block_size() - first_block_start;
-			}
-		} else {
-			if(bytes_left < block_size()) {
-				buffer.write(block_buf, count - bytes_left, bytes_left);
-				nread += bytes_left;
-				bytes_left = 0;
-			} else {
-				buffer.write(block_buf, count - bytes_left, block_size());
-				nread += block_size();
-				bytes_left -= block_size();
-			}
-		}
-		block++;
-	}
-
-	return nread;
-}
-
-ssize_t PATADevice::write(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
-	size_t first_block = offset / block_size();
-	size_t last_block = (offset + count) / block_size();
-	size_t first_block_start = offset % block_size();
-	size_t bytes_left = count;
-	size_t block = first_block;
-
-	if(last_block > _max_addressable_block)
-		return -ENOSPC;
-
-	uint8_t block_buf[block_size()];
-	while(bytes_left) {
-		//Read the block into a buffer
-		Result res = read_block(block, block_buf);
-		if(res.is_error()) {
-			return res.code();
-		}
-
-		//Copy the appropriate portion of the buffer into the appropriate portion of the block buffer
-		if(block == first_block) {
-			if(count < block_size() - first_block_start) {
-				buffer.read(block_buf + first_block_start, count);
-				bytes_left = 0;
-			} else {
-				buffer.read(block_buf + first_block_start, block_size() - first_block_start);
-				bytes_left -= block_size() - first_block_start;
-			}
-		} else {
-			if(bytes_left < block_size()) {
-				buffer.read(block_buf, count - bytes_left, bytes_left);
-				bytes_left = 0;
-			} else {
-				buffer.read(block_buf, count - bytes_left, block_size());
-				bytes_left -= block_size();
-			}
-		}
-
-		res = write_block(block, block_buf);
-		if(res.is_error()) {
-			return res.code();
-		}
-		block++;
-	}
-
-	return count;
+size_t PATADevice::num_blocks() {
+	return _max_addressable_block + 1;
 }
 
 void PATADevice::handle_irq(Registers *regs) {
@@ -25,10 +25,13 @@
 #include <kernel/interrupt/IRQHandler.h>
 #include "ATA.h"
 #include "DiskDevice.h"
-#include <kernel/tasking/SpinLock.h>
+#include <kernel/tasking/Mutex.h>
 #include <kernel/memory/MemoryManager.h>
 
-#define ATA_MAX_SECTORS_AT_ONCE (PAGE_SIZE / 512)
+// The most sectors that are transferred with one DMA command. Each page of the transfer gets its own PRDT entry, so the
+// DMA buffer doesn't have to be physically contiguous.
+#define ATA_DMA_MAX_SECTORS 128
+#define ATA_DMA_PRDT_ENTRIES (ATA_DMA_MAX_SECTORS * 512 / PAGE_SIZE)
 
 class PATADevice: public IRQHandler, public DiskDevice {
 public:
@@ -43,6 +46,8 @@ public:
 	void wait_ready();
 	Result read_sectors_dma(uint32_t sector, uint8_t num_sectors, uint8_t* buf);
 	Result write_sectors_dma(uint32_t sector, uint8_t num_sectors, const uint8_t* buf);
+	/** Runs a DMA transfer to or from the DMA buffer and waits for the interrupt. Should be called with the lock held. **/
+	Result transfer_dma(uint32_t sector, uint8_t num_sectors, bool write);
 	void read_sectors_pio(uint32_t sector, uint8_t sectors, uint8_t *buffer);
 	void write_sectors_pio(uint32_t sector, uint8_t sectors, const uint8_t *buffer);
 	void access_drive(uint8_t command, uint32_t lba, uint8_t num_sectors);
@@ -53,9 +58,8 @@ public:
 	Result write_uncached_blocks(uint32_t block, uint32_t count, const uint8_t *buffer) override;
 	size_t block_size() override;
 
-	//File
-	ssize_t read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
-	ssize_t write(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
+	//DiskDevice
+	size_t num_blocks() override;
 
 	//IRQHandler
 	void handle_irq(Registers* regs) override;
@@ -86,8 +90,8 @@ private:
 	uint8_t _post_irq_status, _post_irq_bm_status;
 	volatile bool _got_irq = false;
 
-	//Lock
-	SpinLock _lock;
+	//Lock. Threads waiting for their turn to use the disk sleep on this while a transfer is in progress.
+	Mutex _lock;
 };
 
 
@@ -45,6 +45,10 @@ size_t PartitionDevice::block_size() {
 	return _parent->block_size();
 }
 
+Result PartitionDevice::sync() {
+	return _parent->sync();
+}
+
 size_t PartitionDevice::part_offset() {
 	return _offset;
 }
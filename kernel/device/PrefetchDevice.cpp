@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "PrefetchDevice.h"
+#include <kernel/memory/Prefetch.h>
+#include <kernel/tasking/TaskManager.h>
+#include <kernel/tasking/Process.h>
+
+PrefetchDevice::PrefetchDevice(): CharacterDevice(1, 18) {}
+
+ssize_t PrefetchDevice::read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
+	// The recorded pages show which files processes have been using, so only root gets to see them
+	if(!TaskManager::current_process()->user().can_override_permissions())
+		return -EPERM;
+	return Prefetch::read(offset, count, buffer);
+}
+
+ssize_t PrefetchDevice::write(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
+	if(!TaskManager::current_process()->user().can_override_permissions())
+		return -EPERM;
+	return Prefetch::replay(buffer, count);
+}
+
+int PrefetchDevice::ioctl(unsigned request, SafePointer<void*> argp) {
+	if(!TaskManager::current_process()->user().can_override_permissions())
+		return -EPERM;
+
+	switch(request) {
+		case PREFETCH_RECORD_START:
+			return Prefetch::start_recording((pid_t) (size_t) argp.raw());
+		case PREFETCH_RECORD_STOP:
+			Prefetch::stop_recording();
+			return SUCCESS;
+		default:
+			return -EINVAL;
+	}
+}
@@ -0,0 +1,19 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "CharacterDevice.h"
+
+/**
+ * /dev/prefetch, which records the pages of files that processes use with the ioctls in api/prefetch.h. Reading it
+ * gives the recorded pages, and writing a list of them back reads them into the page cache in the background.
+ */
+class PrefetchDevice: public CharacterDevice {
+public:
+	PrefetchDevice();
+
+	ssize_t read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
+	ssize_t write(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
+	int ioctl(unsigned request, SafePointer<void*> argp) override;
+};
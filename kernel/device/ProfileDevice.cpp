@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "ProfileDevice.h"
+#include <kernel/tasking/Profiler.h>
+#include <kernel/tasking/TaskManager.h>
+#include <kernel/tasking/Process.h>
+
+ProfileDevice::ProfileDevice(): CharacterDevice(1, 17) {}
+
+ssize_t ProfileDevice::read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
+	return Profiler::read(offset, count, buffer);
+}
+
+int ProfileDevice::ioctl(unsigned request, SafePointer<void*> argp) {
+	// Samples show where any process is running, so only root gets to take them
+	if(!TaskManager::current_process()->user().can_override_permissions())
+		return -EPERM;
+
+	switch(request) {
+		case PROFILE_START:
+			Profiler::start((pid_t) (size_t) argp.raw());
+			return SUCCESS;
+		case PROFILE_STOP:
+			Profiler::stop();
+			return SUCCESS;
+		default:
+			return -EINVAL;
+	}
+}
@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "CharacterDevice.h"
+
+/**
+ * /dev/profile, which controls the sampling profiler with the ioctls in api/profile.h and reads the samples it takes.
+ */
+class ProfileDevice: public CharacterDevice {
+public:
+	ProfileDevice();
+
+	ssize_t read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
+	int ioctl(unsigned request, SafePointer<void*> argp) override;
+};
@@ -26,9 +26,8 @@ RandomDevice::RandomDevice(): CharacterDevice(1, 8) {
 }
 
 ssize_t RandomDevice::read(FileDescriptor &fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
-	size_t amount = min(count, 512);
-	get_random_bytes(buffer, amount);
-	return amount;
+	get_random_bytes(buffer, count);
+	return count;
 }
 
 ssize_t RandomDevice::write(FileDescriptor &fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
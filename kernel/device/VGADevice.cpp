@@ -38,9 +38,27 @@ int VGADevice::ioctl(unsigned request, SafePointer<void*> argp) {
 		case IO_VIDEO_HEIGHT:
 			SafePointer<int>(argp).set(get_display_height());
 			return 0;
+		case IO_VIDEO_PITCH:
+			SafePointer<int>(argp).set(get_display_pitch());
+			return 0;
 		case IO_VIDEO_MAP:
 			argp.set(map_framebuffer(proc));
 			return 0;
+		case IO_VIDEO_SET_MODE: {
+			auto mode = SafePointer<video_mode>(argp).get();
+			auto res = set_mode(mode.width, mode.height, mode.virtual_height);
+			if(res.is_error())
+				return res.code();
+		}
+		//Fall through to tell the caller what mode they actually got
+		case IO_VIDEO_GET_MODE:
+			SafePointer<video_mode>(argp).set({
+				(int) get_display_width(),
+				(int) get_display_height(),
+				(int) get_virtual_height(),
+				(int) get_display_pitch()
+			});
+			return 0;
 		default:
 			return -EINVAL;
 	}
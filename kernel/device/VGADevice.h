@@ -24,6 +24,39 @@
 #define IO_VIDEO_HEIGHT	0x8003
 #define IO_VIDEO_PITCH	0x8004
 #define IO_VIDEO_OFFSET	0x8005
+#define IO_VIDEO_SET_CURSOR	0x8006
+#define IO_VIDEO_MOVE_CURSOR	0x8007
+#define IO_VIDEO_SET_MODE	0x8008
+#define IO_VIDEO_GET_MODE	0x8009
+
+/**
+ * What IO_VIDEO_SET_CURSOR takes: an image (32-bit premultiplied ARGB pixels) for the device to draw the mouse cursor
+ * with on top of the framebuffer. Devices without a hardware cursor fail it with EINVAL, like any other unknown ioctl.
+ */
+struct video_cursor {
+	const void* image;
+	int width;
+	int height;
+};
+
+/** What IO_VIDEO_MOVE_CURSOR takes: where the top left of the hardware cursor goes on the display. **/
+struct video_cursor_position {
+	int x;
+	int y;
+};
+
+/**
+ * What IO_VIDEO_SET_MODE takes and IO_VIDEO_GET_MODE fills in. The virtual height is how many rows of video memory can
+ * be panned through with IO_VIDEO_OFFSET, so a virtual height of three times the height allows triple buffering. The
+ * pitch is the number of bytes from the start of one row to the next, which may be padded past the width. It's filled in
+ * by the device, and ignored when setting the mode. Devices that can't change modes fail IO_VIDEO_SET_MODE with EINVAL.
+ */
+struct video_mode {
+	int width;
+	int height;
+	int virtual_height;
+	int pitch;
+};
 
 #ifdef DUCKOS_KERNEL
 
@@ -35,9 +68,17 @@ public:
 	VGADevice();
 	static VGADevice& inst() {return *_inst;};
 	virtual void scroll(size_t pixels) = 0;
+	/// Undoes any scrolling done by panning the display, so that it shows the start of the framebuffer again.
+	virtual void reset_scroll() {}
 	virtual void set_pixel(size_t x, size_t y, uint32_t value) = 0;
 	virtual size_t get_display_width() = 0;
 	virtual size_t get_display_height() = 0;
+	/// The number of bytes from the start of one row of the framebuffer to the next.
+	virtual size_t get_display_pitch() { return get_display_width() * sizeof(uint32_t); }
+	/// The number of rows of the framebuffer that the display can be panned through.
+	virtual size_t get_virtual_height() { return get_display_height(); }
+	/// Changes the resolution of the display, and how many rows of video memory can be panned through.
+	virtual Result set_mode(int width, int height, int virtual_height) { return Result(-EINVAL); }
 	virtual void clear(uint32_t color) = 0;
 	virtual void* map_framebuffer(Process* proc) = 0;
 
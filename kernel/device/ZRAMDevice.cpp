@@ -0,0 +1,156 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "ZRAMDevice.h"
+#include <kernel/CommandLine.h>
+#include <kernel/memory/MemoryManager.h>
+#include <kernel/kstd/LZ4.h>
+#include <kernel/kstd/KLog.h>
+#include <kernel/kstd/cstring.h>
+#include <kernel/kstd/kstdlib.h>
+
+void ZRAMDevice::init() {
+	if(!CommandLine::inst().has_option("zram"))
+		return;
+	size_t num_pages = MM.usable_mem() / PAGE_SIZE / 4;
+	auto& size_opt = CommandLine::inst().get_option_value("zram");
+	if(size_opt.length() && atoi(size_opt.c_str()) > 0)
+		num_pages = (size_t) atoi(size_opt.c_str()) * 1024 * 1024 / PAGE_SIZE;
+	new ZRAMDevice(num_pages);
+	KLog::dbg("ZRAM", "Created a %dKiB compressed RAM device", (int) (num_pages * PAGE_SIZE / 1024));
+}
+
+ZRAMDevice::ZRAMDevice(size_t num_pages): BlockDevice(ZRAM_MAJOR, ZRAM_MINOR), m_scratch((uint8_t*) kmalloc(PAGE_SIZE)) {
+	m_pages.resize(num_pages);
+	for(auto& page : m_pages) {
+		page.data = nullptr;
+		page.size = 0;
+		page.type = PageType::Empty;
+	}
+	m_stats.num_pages = num_pages;
+}
+
+Result ZRAMDevice::read_blocks(uint32_t block, uint32_t count, uint8_t* buffer) {
+	if(block + count > m_pages.size() || block + count < block)
+		return Result(-EINVAL);
+	LOCK(m_lock);
+	for(uint32_t i = 0; i < count; i++) {
+		auto res = load_page(block + i, buffer + i * PAGE_SIZE);
+		if(res.is_error())
+			return res;
+	}
+	m_stats.num_reads += count;
+	return Result(SUCCESS);
+}
+
+Result ZRAMDevice::write_blocks(uint32_t block, uint32_t count, const uint8_t* buffer) {
+	if(block + count > m_pages.size() || block + count < block)
+		return Result(-EINVAL);
+	LOCK(m_lock);
+	for(uint32_t i = 0; i < count; i++) {
+		auto res = store_page(block + i, buffer + i * PAGE_SIZE);
+		if(res.is_error())
+			return res;
+	}
+	m_stats.num_writes += count;
+	return Result(SUCCESS);
+}
+
+void ZRAMDevice::discard_blocks(uint32_t block, uint32_t count) {
+	LOCK(m_lock);
+	for(uint32_t i = block; i < block + count && i < m_pages.size(); i++)
+		free_page(i);
+}
+
+size_t ZRAMDevice::block_size() {
+	return PAGE_SIZE;
+}
+
+size_t ZRAMDevice::num_blocks() {
+	return m_pages.size();
+}
+
+ZRAMDevice::Stats ZRAMDevice::stats() {
+	LOCK(m_lock);
+	return m_stats;
+}
+
+Result ZRAMDevice::store_page(size_t index, const uint8_t* data) {
+	free_page(index);
+	auto& page = m_pages[index];
+
+	auto* words = (const uint32_t*) data;
+	bool same_filled = true;
+	for(size_t i = 1; i < PAGE_SIZE / sizeof(uint32_t) && same_filled; i++)
+		same_filled = words[i] == words[0];
+	if(same_filled) {
+		page.fill = words[0];
+		page.type = PageType::SameFilled;
+		m_stats.stored_pages++;
+		m_stats.same_filled_pages++;
+		return Result(SUCCESS);
+	}
+
+	size_t size = kstd::LZ4::compress(data, PAGE_SIZE, m_scratch, ZRAM_MAX_COMPRESSED_SIZE);
+	auto type = size ? PageType::Compressed : PageType::Raw;
+	if(!size)
+		size = PAGE_SIZE;
+	auto* storage = (uint8_t*) kmalloc(size);
+	if(!storage)
+		return Result(-ENOMEM);
+	memcpy(storage, type == PageType::Compressed ? m_scratch : data, size);
+
+	page.data = storage;
+	page.size = (uint16_t) size;
+	page.type = type;
+	m_stats.stored_pages++;
+	m_stats.compressed_bytes += size;
+	if(type == PageType::Raw)
+		m_stats.incompressible_pages++;
+	return Result(SUCCESS);
+}
+
+Result ZRAMDevice::load_page(size_t index, uint8_t* data) {
+	auto& page = m_pages[index];
+	switch(page.type) {
+		case PageType::Empty:
+			memset(data, 0, PAGE_SIZE);
+			break;
+		case PageType::SameFilled: {
+			auto* words = (uint32_t*) data;
+			for(size_t i = 0; i < PAGE_SIZE / sizeof(uint32_t); i++)
+				words[i] = page.fill;
+			break;
+		}
+		case PageType::Compressed:
+			if(kstd::LZ4::decompress(page.data, page.size, data, PAGE_SIZE) != PAGE_SIZE)
+				return Result(-EIO);
+			break;
+		case PageType::Raw:
+			memcpy(data, page.data, PAGE_SIZE);
+			break;
+	}
+	return Result(SUCCESS);
+}
+
+void ZRAMDevice::free_page(size_t index) {
+	auto& page = m_pages[index];
+	switch(page.type) {
+		case PageType::Empty:
+			return;
+		case PageType::SameFilled:
+			m_stats.same_filled_pages--;
+			break;
+		case PageType::Raw:
+			m_stats.incompressible_pages--;
+			// fallthrough
+		case PageType::Compressed:
+			m_stats.compressed_bytes -= page.size;
+			kfree(page.data);
+			break;
+	}
+	m_stats.stored_pages--;
+	page.data = nullptr;
+	page.size = 0;
+	page.type = PageType::Empty;
+}
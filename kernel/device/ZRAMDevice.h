@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "BlockDevice.h"
+#include <kernel/memory/Memory.h>
+#include <kernel/tasking/Mutex.h>
+#include <kernel/kstd/vector.hpp>
+
+#define ZRAM_MAJOR 252
+#define ZRAM_MINOR 0
+// Pages that don't compress down to this size are stored as they are, since compressing them isn't worth decompressing
+#define ZRAM_MAX_COMPRESSED_SIZE (PAGE_SIZE * 3 / 4)
+
+/**
+ * A block device that keeps its contents compressed in kernel memory, so that it can be swapped to without a disk. Each
+ * block is a page, and is compressed with LZ4 when written. Pages filled with the same word over and over (usually
+ * zeroes) are remembered by that word alone, and blocks that are discarded don't take up any memory.
+ *
+ * It's turned on with the `zram=<MiB>` command line option. Without a size, it can hold a quarter of usable memory.
+ */
+class ZRAMDevice: public BlockDevice {
+public:
+	struct Stats {
+		size_t num_pages; ///< How many pages the device can hold.
+		size_t stored_pages; ///< How many pages are stored, including same-filled ones.
+		size_t same_filled_pages;
+		size_t incompressible_pages; ///< How many pages are stored uncompressed.
+		size_t compressed_bytes; ///< How much memory the stored pages take up.
+		uint64_t num_reads;
+		uint64_t num_writes;
+	};
+
+	static void init();
+
+	Result read_blocks(uint32_t block, uint32_t count, uint8_t* buffer) override;
+	Result write_blocks(uint32_t block, uint32_t count, const uint8_t* buffer) override;
+	void discard_blocks(uint32_t block, uint32_t count) override;
+	size_t block_size() override;
+	size_t num_blocks() override;
+
+	Stats stats();
+
+private:
+	enum class PageType: uint8_t {
+		Empty,
+		SameFilled,
+		Compressed,
+		Raw
+	};
+
+	struct Page {
+		union {
+			uint8_t* data; ///< For compressed and raw pages.
+			uint32_t fill; ///< For same-filled pages.
+		};
+		uint16_t size;
+		PageType type;
+	};
+
+	explicit ZRAMDevice(size_t num_pages);
+
+	Result store_page(size_t index, const uint8_t* data);
+	Result load_page(size_t index, uint8_t* data);
+	void free_page(size_t index);
+
+	Mutex m_lock;
+	kstd::vector<Page> m_pages;
+	uint8_t* m_scratch; ///< Where pages are compressed to before we know how big they are.
+	Stats m_stats = {};
+};
@@ -20,6 +20,7 @@
 #include <kernel/kstd/kstdlib.h>
 #include "ZeroDevice.h"
 #include <kernel/kstd/cstring.h>
+#include <kernel/memory/AnonymousVMObject.h>
 
 ZeroDevice::ZeroDevice(): CharacterDevice(1, 5) {
 
@@ -34,3 +35,14 @@ ssize_t ZeroDevice::read(FileDescriptor &fd, size_t offset, SafePointer<uint8_t>
 ssize_t ZeroDevice::write(FileDescriptor &fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
 	return count;
 }
+
+ResultRet<kstd::Arc<VMObject>> ZeroDevice::object_for_mapping(size_t size, bool shared) {
+	// Mapping /dev/zero is the same as an anonymous mapping, except that shared mappings stay shared across forks
+	auto object = AnonymousVMObject::alloc_lazy(size);
+	auto res = object->make_swappable();
+	if(res.is_error())
+		return res;
+	if(shared)
+		object->set_fork_action(VMObject::ForkAction::Share);
+	return kstd::static_pointer_cast<VMObject>(object);
+}
@@ -26,6 +26,7 @@ public:
 	ZeroDevice();
 	ssize_t read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
 	ssize_t write(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
+	ResultRet<kstd::Arc<VMObject>> object_for_mapping(size_t size, bool shared) override;
 };
 
 
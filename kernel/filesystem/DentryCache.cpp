@@ -0,0 +1,217 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "DentryCache.h"
+#include "Inode.h"
+#include <kernel/memory/MemoryManager.h>
+
+//A rough guess at how many entries (and their names) fit in a page, for the shrinker
+#define DENTRIES_PER_PAGE (PAGE_SIZE / 64)
+
+DentryCache::Dentry::Dentry(Inode& dir, kstd::string_view name, uint32_t hash, Filesystem* fs, ino_t id):
+	dir_fs(&dir.fs), dir_id(dir.id), name(name), hash(hash), fs(fs), id(id) {}
+
+DentryCache::DentryCache() {
+	MM.register_shrinker(&m_shrinker);
+}
+
+DentryCache::~DentryCache() {
+	MM.unregister_shrinker(&m_shrinker);
+	invalidate_all();
+}
+
+bool DentryCache::lookup(Inode& dir, kstd::string_view name, Filesystem*& fs, ino_t& id, uint32_t& generation) {
+	uint32_t hash = hash_for(dir, name);
+	LOCK(m_lock);
+	generation = m_generation;
+	auto* entry = *find(dir, name, hash);
+	if(!entry) {
+		m_misses++;
+		return false;
+	}
+
+	//Move the entry to the front of the LRU list
+	if(entry != m_lru_head) {
+		entry->lru_prev->lru_next = entry->lru_next;
+		if(entry->lru_next)
+			entry->lru_next->lru_prev = entry->lru_prev;
+		else
+			m_lru_tail = entry->lru_prev;
+		entry->lru_prev = nullptr;
+		entry->lru_next = m_lru_head;
+		m_lru_head->lru_prev = entry;
+		m_lru_head = entry;
+	}
+
+	m_hits++;
+	fs = entry->fs;
+	id = entry->id;
+	return true;
+}
+
+void DentryCache::insert(Inode& dir, kstd::string_view name, Filesystem* fs, ino_t id, uint32_t generation) {
+	//Allocate the entry before taking the lock, since allocating could end up calling our shrinker
+	uint32_t hash = hash_for(dir, name);
+	auto* new_entry = new Dentry(dir, name, hash, fs, id);
+	Dentry* evicted = nullptr;
+
+	{
+		LOCK(m_lock);
+		if(generation != m_generation || *find(dir, name, hash)) {
+			//Something changed since the lookup, or someone beat us to it
+			evicted = new_entry;
+		} else {
+			auto& bucket = m_buckets[hash % DENTRY_CACHE_BUCKETS];
+			new_entry->hash_next = bucket;
+			bucket = new_entry;
+			new_entry->lru_next = m_lru_head;
+			if(m_lru_head)
+				m_lru_head->lru_prev = new_entry;
+			m_lru_head = new_entry;
+			if(!m_lru_tail)
+				m_lru_tail = new_entry;
+			m_num_entries++;
+			if(!id)
+				m_num_negative++;
+
+			if(m_num_entries > DENTRY_CACHE_MAX_ENTRIES)
+				evicted = evict(m_num_entries - DENTRY_CACHE_MAX_ENTRIES);
+		}
+	}
+
+	free_list(evicted);
+}
+
+void DentryCache::invalidate(Inode& dir, kstd::string_view name) {
+	uint32_t hash = hash_for(dir, name);
+	Dentry* entry;
+	{
+		LOCK(m_lock);
+		m_generation++;
+		auto** link = find(dir, name, hash);
+		entry = *link;
+		if(entry)
+			unlink(link);
+	}
+	free_list(entry);
+}
+
+void DentryCache::invalidate_dir(Inode& dir) {
+	Dentry* removed = nullptr;
+	{
+		LOCK(m_lock);
+		m_generation++;
+		for(auto& bucket : m_buckets) {
+			auto** link = &bucket;
+			while(*link) {
+				auto* entry = *link;
+				if(entry->dir_fs == &dir.fs && entry->dir_id == dir.id) {
+					unlink(link);
+					entry->hash_next = removed;
+					removed = entry;
+				} else {
+					link = &entry->hash_next;
+				}
+			}
+		}
+	}
+	free_list(removed);
+}
+
+void DentryCache::invalidate_all() {
+	Dentry* removed;
+	{
+		LOCK(m_lock);
+		m_generation++;
+		removed = evict(m_num_entries);
+	}
+	free_list(removed);
+}
+
+DentryCache::Stats DentryCache::stats() {
+	LOCK(m_lock);
+	return {m_num_entries, m_num_negative, m_hits, m_misses};
+}
+
+uint32_t DentryCache::hash_for(Inode& dir, kstd::string_view name) {
+	//FNV-1a of the name, mixed with the directory
+	uint32_t hash = 2166136261u ^ (uint32_t) dir.id ^ ((uint32_t) (size_t) &dir.fs << 16);
+	for(size_t i = 0; i < name.length(); i++) {
+		hash ^= (uint8_t) name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+DentryCache::Dentry** DentryCache::find(Inode& dir, kstd::string_view name, uint32_t hash) {
+	auto** link = &m_buckets[hash % DENTRY_CACHE_BUCKETS];
+	for(; *link; link = &(*link)->hash_next) {
+		auto* entry = *link;
+		if(entry->hash == hash && entry->dir_id == dir.id && entry->dir_fs == &dir.fs && entry->name == name)
+			break;
+	}
+	return link;
+}
+
+DentryCache::Dentry** DentryCache::link_to(Dentry* entry) {
+	auto** link = &m_buckets[entry->hash % DENTRY_CACHE_BUCKETS];
+	while(*link != entry)
+		link = &(*link)->hash_next;
+	return link;
+}
+
+void DentryCache::unlink(Dentry** link) {
+	auto* entry = *link;
+	*link = entry->hash_next;
+	entry->hash_next = nullptr;
+
+	if(entry->lru_prev)
+		entry->lru_prev->lru_next = entry->lru_next;
+	else
+		m_lru_head = entry->lru_next;
+	if(entry->lru_next)
+		entry->lru_next->lru_prev = entry->lru_prev;
+	else
+		m_lru_tail = entry->lru_prev;
+
+	m_num_entries--;
+	if(!entry->id)
+		m_num_negative--;
+}
+
+DentryCache::Dentry* DentryCache::evict(size_t count) {
+	Dentry* removed = nullptr;
+	while(count-- && m_lru_tail) {
+		auto* entry = m_lru_tail;
+		unlink(link_to(entry));
+		entry->hash_next = removed;
+		removed = entry;
+	}
+	return removed;
+}
+
+void DentryCache::free_list(Dentry* list) {
+	while(list) {
+		auto* next = list->hash_next;
+		delete list;
+		list = next;
+	}
+}
+
+size_t DentryCache::DentryShrinker::reclaimable_pages() {
+	return m_cache.m_num_entries / DENTRIES_PER_PAGE;
+}
+
+size_t DentryCache::DentryShrinker::shrink(size_t num_pages) {
+	//We could be called while an allocation is in progress with the lock held, so don't wait for it
+	if(!m_cache.m_lock.try_acquire())
+		return 0;
+	auto* evicted = m_cache.evict(num_pages * DENTRIES_PER_PAGE);
+	m_cache.m_lock.release();
+
+	size_t num_evicted = 0;
+	for(auto* entry = evicted; entry; entry = entry->hash_next)
+		num_evicted++;
+	free_list(evicted);
+	return num_evicted / DENTRIES_PER_PAGE;
+}
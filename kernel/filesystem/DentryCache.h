@@ -0,0 +1,106 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/string.h>
+#include <kernel/kstd/unix_types.h>
+#include <kernel/memory/Shrinker.h>
+#include <kernel/memory/SlabCache.h>
+#include <kernel/tasking/SpinLock.h>
+
+#define DENTRY_CACHE_BUCKETS 1024
+#define DENTRY_CACHE_MAX_ENTRIES 8192
+
+class Filesystem;
+class Inode;
+
+/**
+ * Caches the results of looking up names in directories, so that resolving paths doesn't search through the same
+ * directories over and over. Names that weren't found are cached too, and names with a filesystem mounted on top of them
+ * are cached as the root of that filesystem.
+ *
+ * Only directories on filesystems that can_cache_lookups() are cached, since the VFS has to invalidate an entry
+ * whenever it changes. Entries are evicted in least-recently-used order when the cache is full or memory is low.
+ */
+class DentryCache {
+public:
+	struct Stats {
+		size_t num_entries;
+		size_t num_negative;
+		size_t hits;
+		size_t misses;
+	};
+
+	DentryCache();
+	~DentryCache();
+
+	/**
+	 * Looks up a name in a directory.
+	 * @param fs Set to the filesystem of the inode with the name.
+	 * @param id Set to the ID of the inode with the name, or 0 if the name doesn't exist.
+	 * @param generation Set to the generation of the cache, which should be passed to insert() if there's a miss.
+	 * @return Whether the cache knew about the name.
+	 */
+	bool lookup(Inode& dir, kstd::string_view name, Filesystem*& fs, ino_t& id, uint32_t& generation);
+	/**
+	 * Caches the result of looking up a name. If the cache was invalidated at all since the generation from lookup(), the
+	 * result might be stale and is dropped.
+	 */
+	void insert(Inode& dir, kstd::string_view name, Filesystem* fs, ino_t id, uint32_t generation);
+	/** Forgets the result of looking up a name in a directory. **/
+	void invalidate(Inode& dir, kstd::string_view name);
+	/** Forgets everything about the names in a directory, for when it's removed. **/
+	void invalidate_dir(Inode& dir);
+	/** Forgets everything. **/
+	void invalidate_all();
+	Stats stats();
+
+private:
+	class Dentry {
+		SLAB_ALLOCATED(Dentry)
+	public:
+		Dentry(Inode& dir, kstd::string_view name, uint32_t hash, Filesystem* fs, ino_t id);
+
+		Filesystem* dir_fs;
+		ino_t dir_id;
+		kstd::string name;
+		uint32_t hash;
+		Filesystem* fs;
+		ino_t id;
+		Dentry* hash_next = nullptr;
+		Dentry* lru_prev = nullptr;
+		Dentry* lru_next = nullptr;
+	};
+
+	class DentryShrinker: public Shrinker {
+	public:
+		explicit DentryShrinker(DentryCache& cache): m_cache(cache) {}
+		const char* name() const override { return "dentry cache"; }
+		size_t reclaimable_pages() override;
+		size_t shrink(size_t num_pages) override;
+
+	private:
+		DentryCache& m_cache;
+	};
+
+	static uint32_t hash_for(Inode& dir, kstd::string_view name);
+	Dentry** find(Inode& dir, kstd::string_view name, uint32_t hash);
+	Dentry** link_to(Dentry* entry);
+	/** Takes an entry out of the hash table and LRU list. The lock must be held, and the entry deleted after releasing it. **/
+	void unlink(Dentry** link);
+	/** Unlinks the least recently used entries, and returns them as a list chained through hash_next. **/
+	Dentry* evict(size_t count);
+	static void free_list(Dentry* list);
+
+	Dentry* m_buckets[DENTRY_CACHE_BUCKETS] = {nullptr};
+	Dentry* m_lru_head = nullptr; ///< The most recently used entry.
+	Dentry* m_lru_tail = nullptr;
+	size_t m_num_entries = 0;
+	size_t m_num_negative = 0;
+	size_t m_hits = 0;
+	size_t m_misses = 0;
+	uint32_t m_generation = 0;
+	SpinLock m_lock;
+	DentryShrinker m_shrinker {*this};
+};
@@ -0,0 +1,225 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "EventPoll.h"
+#include "FileDescriptor.h"
+#include <kernel/tasking/TaskManager.h>
+#include <kernel/tasking/Thread.h>
+
+EventPoll::EventPoll() = default;
+
+EventPoll::~EventPoll() {
+	for(auto* watch : m_watches)
+		destroy(watch);
+}
+
+Result EventPoll::add(int fd_num, const kstd::Arc<FileDescriptor>& fd, const epoll_event& event) {
+	//Watching ourselves (or another epoll) could make wakeups go around in circles
+	if(fd->file()->is_epoll())
+		return Result(EINVAL);
+
+	LOCK(m_lock);
+	if(find(fd_num))
+		return Result(EEXIST);
+
+	auto* watch = new Watch {this, fd_num, fd, event.events, event.data};
+	watch->entry.set_callback(watch_woken, watch);
+	fd->file()->poll_queue().add(watch->entry);
+	m_watches.push_back(watch);
+
+	//It might already be ready, so have the next wait check it
+	TaskManager::ScopedCritical critical;
+	make_ready(watch);
+	m_poll_queue.wake();
+	return Result(SUCCESS);
+}
+
+Result EventPoll::modify(int fd_num, const epoll_event& event) {
+	LOCK(m_lock);
+	auto* watch = find(fd_num);
+	if(!watch)
+		return Result(ENOENT);
+
+	TaskManager::ScopedCritical critical;
+	watch->events = event.events;
+	watch->data = event.data;
+	watch->disabled = false;
+	make_ready(watch);
+	m_poll_queue.wake();
+	return Result(SUCCESS);
+}
+
+Result EventPoll::remove(int fd_num) {
+	LOCK(m_lock);
+	for(size_t i = 0; i < m_watches.size(); i++) {
+		if(m_watches[i]->fd_num == fd_num) {
+			destroy(m_watches[i]);
+			m_watches.erase(i);
+			return Result(SUCCESS);
+		}
+	}
+	return Result(ENOENT);
+}
+
+int EventPoll::wait(SafePointer<epoll_event> events, int max_events, Time timeout) {
+	if(max_events <= 0)
+		return -EINVAL;
+
+	bool has_timeout = timeout >= Time();
+	Time end_time = Time::now() + timeout;
+	while(true) {
+		int num_events = collect_events(events, max_events);
+		if(num_events || (has_timeout && Time::now() >= end_time))
+			return num_events;
+
+		WaitBlocker blocker(*this, has_timeout, end_time);
+		TaskManager::current_thread()->block(blocker);
+		if(blocker.was_interrupted())
+			return -EINTR;
+	}
+}
+
+bool EventPoll::is_epoll() {
+	return true;
+}
+
+bool EventPoll::can_read(const FileDescriptor& fd) {
+	//This could be a false positive if none of the watches on the ready list turn out to be ready, like with poll()
+	TaskManager::ScopedCritical critical;
+	return m_ready_head;
+}
+
+bool EventPoll::can_write(const FileDescriptor& fd) {
+	return false;
+}
+
+void EventPoll::watch_woken(void* data) {
+	auto* watch = (Watch*) data;
+	if(watch->disabled)
+		return;
+	watch->epoll->make_ready(watch);
+	watch->epoll->m_poll_queue.wake();
+}
+
+void EventPoll::make_ready(Watch* watch) {
+	if(watch->ready)
+		return;
+	watch->ready = true;
+	watch->next_ready = nullptr;
+	if(m_ready_tail)
+		m_ready_tail->next_ready = watch;
+	else
+		m_ready_head = watch;
+	m_ready_tail = watch;
+}
+
+int EventPoll::collect_events(SafePointer<epoll_event> events, int max_events) {
+	LOCK(m_lock);
+
+	//Take the whole ready list, so that watches which are still ready and get put back on it aren't checked twice
+	Watch* list;
+	{
+		TaskManager::ScopedCritical critical;
+		list = m_ready_head;
+		m_ready_head = nullptr;
+		m_ready_tail = nullptr;
+	}
+
+	int num_events = 0;
+	while(list && num_events < max_events) {
+		auto* watch = list;
+		list = watch->next_ready;
+		{
+			TaskManager::ScopedCritical critical;
+			watch->ready = false;
+		}
+
+		auto fd = watch->fd.lock();
+		if(!fd) {
+			//The file descriptor was closed, so there's nothing left to watch
+			for(size_t i = 0; i < m_watches.size(); i++) {
+				if(m_watches[i] == watch) {
+					m_watches.erase(i);
+					break;
+				}
+			}
+			destroy(watch);
+			continue;
+		}
+
+		uint32_t revents = 0;
+		if((watch->events & EPOLLIN) && fd->file()->can_read(*fd))
+			revents |= EPOLLIN;
+		if((watch->events & EPOLLOUT) && fd->file()->can_write(*fd))
+			revents |= EPOLLOUT;
+		if(!revents || watch->disabled)
+			continue;
+
+		events.set(num_events++, {revents, watch->data});
+		TaskManager::ScopedCritical critical;
+		if(watch->events & EPOLLONESHOT)
+			watch->disabled = true;
+		else if(!(watch->events & EPOLLET))
+			make_ready(watch); //Level-triggered watches get checked again next time, since they could still be ready
+	}
+
+	//Put back the watches we didn't get to in front of the rest, so they're first in line next time
+	if(list) {
+		TaskManager::ScopedCritical critical;
+		auto* tail = list;
+		while(tail->next_ready)
+			tail = tail->next_ready;
+		tail->next_ready = m_ready_head;
+		m_ready_head = list;
+		if(!m_ready_tail)
+			m_ready_tail = tail;
+	}
+
+	return num_events;
+}
+
+EventPoll::Watch* EventPoll::find(int fd_num) {
+	for(auto* watch : m_watches)
+		if(watch->fd_num == fd_num)
+			return watch;
+	return nullptr;
+}
+
+void EventPoll::destroy(Watch* watch) {
+	{
+		TaskManager::ScopedCritical critical;
+		if(watch->ready) {
+			Watch* prev = nullptr;
+			for(auto* cur = m_ready_head; cur; prev = cur, cur = cur->next_ready) {
+				if(cur != watch)
+					continue;
+				if(prev)
+					prev->next_ready = cur->next_ready;
+				else
+					m_ready_head = cur->next_ready;
+				if(m_ready_tail == cur)
+					m_ready_tail = prev;
+				break;
+			}
+		}
+	}
+
+	//Deleting the watch takes its entry out of the file's poll queue
+	delete watch;
+}
+
+EventPoll::WaitBlocker::WaitBlocker(EventPoll& epoll, bool has_timeout, Time end_time):
+	m_epoll(epoll), m_entry(this), m_has_timeout(has_timeout), m_end_time(end_time)
+{
+	m_epoll.m_poll_queue.add(m_entry);
+	if(m_has_timeout)
+		set_timeout(m_end_time);
+}
+
+EventPoll::WaitBlocker::~WaitBlocker() {
+	m_epoll.m_poll_queue.remove(m_entry);
+}
+
+bool EventPoll::WaitBlocker::is_ready() {
+	return m_epoll.m_ready_head || (m_has_timeout && Time::now() >= m_end_time);
+}
@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/filesystem/File.h>
+#include <kernel/kstd/vector.hpp>
+#include <kernel/tasking/Blocker.h>
+#include <kernel/tasking/SpinLock.h>
+#include <kernel/api/epoll.h>
+
+/**
+ * A set of file descriptors to wait for events on, created by epoll_create(). Unlike poll(), the set is kept between
+ * waits, and each file descriptor stays in its file's poll queue the whole time. When a file wakes its queue up, the
+ * file descriptor is put on a ready list, so waiting only has to look at the file descriptors that might be ready
+ * instead of all of the ones being watched.
+ */
+class EventPoll: public File {
+public:
+	EventPoll();
+	~EventPoll() override;
+
+	/** Starts watching a file descriptor. Fails with EEXIST if it's already being watched. **/
+	Result add(int fd_num, const kstd::Arc<FileDescriptor>& fd, const epoll_event& event);
+	/** Changes the events and data of a file descriptor being watched. **/
+	Result modify(int fd_num, const epoll_event& event);
+	/** Stops watching a file descriptor. **/
+	Result remove(int fd_num);
+	/**
+	 * Waits until some of the file descriptors being watched have events, or the timeout passes if it isn't negative.
+	 * @return The number of events written to the buffer, or a negative error code.
+	 */
+	int wait(SafePointer<epoll_event> events, int max_events, Time timeout);
+
+	//File
+	bool is_epoll() override;
+	bool can_read(const FileDescriptor& fd) override;
+	bool can_write(const FileDescriptor& fd) override;
+
+private:
+	struct Watch {
+		EventPoll* epoll;
+		int fd_num;
+		kstd::Weak<FileDescriptor> fd;
+		uint32_t events;
+		epoll_data_t data;
+		WaitQueue::Entry entry;
+		bool ready = false; ///< Whether the watch is on the ready list, or is being checked by wait().
+		bool disabled = false; ///< Set when an EPOLLONESHOT watch fires, until it's modified.
+		Watch* next_ready = nullptr;
+	};
+
+	class WaitBlocker: public Blocker {
+	public:
+		WaitBlocker(EventPoll& epoll, bool has_timeout, Time end_time);
+		~WaitBlocker() override;
+		bool is_ready() override;
+
+	private:
+		EventPoll& m_epoll;
+		WaitQueue::Entry m_entry;
+		bool m_has_timeout;
+		Time m_end_time;
+	};
+
+	/** Called when the poll queue of a file being watched is woken up. **/
+	static void watch_woken(void* watch);
+	/** Puts a watch at the end of the ready list. Must be called in a critical section. **/
+	void make_ready(Watch* watch);
+	/** Goes through the ready list and writes out the events of the watches that are actually ready. **/
+	int collect_events(SafePointer<epoll_event> events, int max_events);
+	Watch* find(int fd_num);
+	void destroy(Watch* watch);
+
+	kstd::vector<Watch*> m_watches;
+	SpinLock m_lock; ///< Held while changing the watches, or going through them in wait().
+	//The ready list can be added to from interrupt context, so it's only touched in a critical section
+	Watch* m_ready_head = nullptr;
+	Watch* m_ready_tail = nullptr;
+};
@@ -19,6 +19,7 @@
 
 #include "File.h"
 #include <kernel/kstd/unix_types.h>
+#include <kernel/memory/VMObject.h>
 
 File::File() {
 
@@ -52,6 +53,10 @@ bool File::is_fifo() {
 	return false;
 }
 
+bool File::is_epoll() {
+	return false;
+}
+
 ssize_t File::read(FileDescriptor &fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
 	return 0;
 }
@@ -81,7 +86,19 @@ bool File::can_read(const FileDescriptor& fd) {
 	return true;
 }
 
+WaitQueue& File::poll_queue() {
+	return m_poll_queue;
+}
+
 bool File::can_write(const FileDescriptor& fd) {
 	return true;
 }
 
+Result File::sync() {
+	return Result(SUCCESS);
+}
+
+ResultRet<kstd::Arc<VMObject>> File::object_for_mapping(size_t size, bool shared) {
+	return Result(ENODEV);
+}
+
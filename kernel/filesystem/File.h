@@ -22,9 +22,11 @@
 #include <kernel/kstd/Arc.h>
 #include <kernel/Result.hpp>
 #include <kernel/memory/SafePointer.h>
+#include <kernel/tasking/WaitQueue.h>
 
 class FileDescriptor;
 class DirectoryEntry;
+class VMObject;
 class File {
 public:
 	virtual ~File();
@@ -37,13 +39,22 @@ public:
 	virtual bool is_pty_mux();
 	virtual bool is_pty();
 	virtual bool is_fifo();
+	virtual bool is_epoll();
 	virtual int ioctl(unsigned request, SafePointer<void*> argp);
 	virtual void open(FileDescriptor& fd, int options);
 	virtual void close(FileDescriptor& fd);
 	virtual bool can_read(const FileDescriptor& fd);
 	virtual bool can_write(const FileDescriptor& fd);
+	/// The queue that is woken up whenever the file may have become readable or writable.
+	virtual WaitQueue& poll_queue();
+	/// Writes any changes to the file that are only in memory out to the underlying storage.
+	virtual Result sync();
+	/// Gets an object to mmap() the file with, which must be at least size bytes long. Returns ENODEV if the file can't be mapped.
+	virtual ResultRet<kstd::Arc<VMObject>> object_for_mapping(size_t size, bool shared);
 protected:
 	File();
+
+	WaitQueue m_poll_queue;
 };
 
 
@@ -22,13 +22,43 @@
 #include <kernel/time/Time.h>
 #include "Inode.h"
 #include "FileDescriptor.h"
+#include <kernel/memory/MemoryManager.h>
+#include <kernel/CommandLine.h>
+#include <kernel/kstd/KLog.h>
+
+kstd::vector<FileBasedFilesystem*> FileBasedFilesystem::s_filesystems;
+SpinLock FileBasedFilesystem::s_filesystems_lock;
+
+FileBasedFilesystem::FileBasedFilesystem(const kstd::Arc<FileDescriptor>& file):
+	_file(file),
+	m_inode_cache_max_inodes(INODE_CACHE_MAX_INODES_DEFAULT),
+	m_inode_cache_max_bytes(INODE_CACHE_MAX_BYTES_DEFAULT)
+{
+	auto& max_inodes = CommandLine::inst().get_option_value("icache_inodes");
+	if(max_inodes.length())
+		m_inode_cache_max_inodes = atoi(max_inodes.c_str());
+	auto& max_bytes = CommandLine::inst().get_option_value("icache_bytes");
+	if(max_bytes.length())
+		m_inode_cache_max_bytes = atoi(max_bytes.c_str());
+
+	MM.register_shrinker(&m_inode_cache_shrinker);
+
+	LOCK(s_filesystems_lock);
+	s_filesystems.push_back(this);
+}
 
-FileBasedFilesystem::FileBasedFilesystem(const kstd::Arc<FileDescriptor>& file): _file(file) {
+FileBasedFilesystem::~FileBasedFilesystem() {
+	MM.unregister_shrinker(&m_inode_cache_shrinker);
 
+	LOCK(s_filesystems_lock);
+	for(size_t i = 0; i < s_filesystems.size(); i++) {
+		if(s_filesystems[i] == this) {
+			s_filesystems.erase(i);
+			break;
+		}
+	}
 }
 
-FileBasedFilesystem::~FileBasedFilesystem() = default;
-
 Result FileBasedFilesystem::read_logical_block(size_t block, uint8_t *buffer) {
 	return read_logical_blocks(block, 1, buffer);
 }
@@ -51,6 +81,26 @@ Result FileBasedFilesystem::write_logical_blocks(size_t block, size_t count, con
 	return Result(SUCCESS);
 }
 
+Result FileBasedFilesystem::write_metadata() {
+	return Result(SUCCESS);
+}
+
+void FileBasedFilesystem::write_all_metadata() {
+	LOCK(s_filesystems_lock);
+	for(auto fs : s_filesystems) {
+		auto res = fs->write_metadata();
+		if(res.is_error())
+			KLog::err("Filesystem", "Error %d writing out filesystem metadata", res.code());
+	}
+}
+
+Result FileBasedFilesystem::sync() {
+	auto res = write_metadata();
+	if(res.is_error())
+		return res;
+	return _file->file()->sync();
+}
+
 size_t FileBasedFilesystem::logical_block_size() {
 	return _logical_block_size;
 }
@@ -74,12 +124,15 @@ Result FileBasedFilesystem::read_block(size_t block, uint8_t *buffer) {
 }
 
 Result FileBasedFilesystem::read_blocks(size_t block, size_t count, uint8_t *buffer) {
-	Result res = Result(SUCCESS);
-	for(size_t i = 0; i < count; i++) {
-		res = read_block(block + i, buffer + block_size() * i);
-		if(res.is_error())
-			return res;
-	}
+	return read_block_data(block, 0, count * block_size(), KernelPointer<uint8_t>(buffer));
+}
+
+Result FileBasedFilesystem::read_block_data(size_t block, size_t offset, size_t count, SafePointer<uint8_t> buffer) {
+	ssize_t nread = _file->file()->read(*_file, block * block_size() + offset, buffer, count);
+	if(nread < 0)
+		return Result(nread);
+	if((size_t) nread != count)
+		return Result(-EIO);
 	return Result(SUCCESS);
 }
 
@@ -137,37 +190,148 @@ Result FileBasedFilesystem::truncate_block(size_t block, size_t new_size) {
 
 ResultRet<kstd::Arc<Inode>> FileBasedFilesystem::get_cached_inode(ino_t id) {
 	LOCK(m_inode_cache_lock);
-	auto inode = m_inode_cache.get(id);
-	if(inode)
-		return inode.value();
+	auto cached = m_inode_cache.get(id);
+	if(cached) {
+		m_inode_cache_hits++;
+		return cached.value().inode;
+	}
+	m_inode_cache_misses++;
 	return Result(-ENOENT);
 }
 
 void FileBasedFilesystem::add_cached_inode(const kstd::Arc<Inode> &inode) {
-	LOCK(m_inode_cache_lock);
-	m_inode_cache.insert(inode->id, inode);
+	{
+		LOCK(m_inode_cache_lock);
+		insert_cached_inode(inode);
+	}
+	trim_inode_cache();
 }
 
 void FileBasedFilesystem::remove_cached_inode(ino_t id) {
 	LOCK(m_inode_cache_lock);
+	auto cached = m_inode_cache.get(id);
+	if(!cached)
+		return;
+	m_inode_cache_bytes -= cached.value().footprint;
 	m_inode_cache.erase(id);
 }
 
+FileBasedFilesystem::InodeCacheStats FileBasedFilesystem::inode_cache_stats() {
+	LOCK(m_inode_cache_lock);
+	return {
+		m_inode_cache.size(),
+		m_inode_cache_bytes,
+		m_inode_cache_max_inodes,
+		m_inode_cache_max_bytes,
+		m_inode_cache_hits,
+		m_inode_cache_misses,
+		m_inode_cache_evictions,
+		m_inode_cache_prefetches
+	};
+}
+
+void FileBasedFilesystem::set_inode_cache_limits(size_t max_inodes, size_t max_bytes) {
+	{
+		LOCK(m_inode_cache_lock);
+		m_inode_cache_max_inodes = max_inodes;
+		m_inode_cache_max_bytes = max_bytes;
+	}
+	trim_inode_cache();
+}
+
+bool FileBasedFilesystem::is_inode_cached(ino_t id) {
+	return m_inode_cache.contains(id);
+}
+
+void FileBasedFilesystem::cache_prefetched_inode(const kstd::Arc<Inode>& inode) {
+	insert_cached_inode(inode);
+	m_inode_cache_prefetches++;
+}
+
 Inode* FileBasedFilesystem::get_inode_rawptr(ino_t id) {
 	return nullptr;
 }
 
 ResultRet<kstd::Arc<Inode>> FileBasedFilesystem::get_inode(ino_t id) {
-	LOCK(m_inode_cache_lock);
-	auto inode_perhaps = get_cached_inode(id);
-	if(inode_perhaps.is_error()) {
+	kstd::Arc<Inode> inode;
+	{
+		// Hold the lock while reading the inode so that nobody else reads and caches it at the same time
+		LOCK(m_inode_cache_lock);
+		auto inode_perhaps = get_cached_inode(id);
+		if(!inode_perhaps.is_error())
+			return inode_perhaps.value();
 		Inode* in = get_inode_rawptr(id);
-		if(in) {
-			auto ins = kstd::Arc<Inode>(in);
-			add_cached_inode(ins);
-			return ins;
-		} else return Result(-ENOENT);
-	} else {
-		return inode_perhaps.value();
+		if(!in)
+			return Result(-ENOENT);
+		inode = kstd::Arc<Inode>(in);
+		insert_cached_inode(inode);
+	}
+	trim_inode_cache();
+	return inode;
+}
+
+void FileBasedFilesystem::insert_cached_inode(const kstd::Arc<Inode>& inode) {
+	auto existing = m_inode_cache.get(inode->id);
+	if(existing)
+		m_inode_cache_bytes -= existing.value().footprint;
+	size_t footprint = inode->cache_footprint();
+	m_inode_cache.insert(inode->id, {inode, footprint});
+	m_inode_cache_bytes += footprint;
+}
+
+size_t FileBasedFilesystem::evict_cached_inodes(size_t max_inodes, size_t max_bytes, kstd::Arc<Inode>* batch) {
+	size_t batch_count = 0;
+	m_inode_cache.prune_if(INODE_CACHE_EVICT_BATCH, [&](ino_t, CachedInode& cached) {
+		// Items are only taken out of the cache after we return, so count the ones we've already picked
+		if(m_inode_cache.size() - batch_count <= max_inodes && m_inode_cache_bytes <= max_bytes)
+			return false;
+		// Only evict inodes that nothing but the cache is holding onto
+		if(cached.inode.ref_count()->strong_count() != 1)
+			return false;
+		m_inode_cache_bytes -= cached.footprint;
+		batch[batch_count++] = kstd::move(cached.inode);
+		return true;
+	});
+	m_inode_cache_evictions += batch_count;
+	return batch_count;
+}
+
+void FileBasedFilesystem::trim_inode_cache() {
+	// Evicted inodes may write themselves back to disk when they're destroyed, so they're let go of in batches once the
+	// cache lock is released.
+	size_t batch_count = INODE_CACHE_EVICT_BATCH;
+	while(batch_count == INODE_CACHE_EVICT_BATCH) {
+		kstd::Arc<Inode> batch[INODE_CACHE_EVICT_BATCH];
+		LOCK(m_inode_cache_lock);
+		if(m_inode_cache.size() <= m_inode_cache_max_inodes && m_inode_cache_bytes <= m_inode_cache_max_bytes)
+			break;
+		batch_count = evict_cached_inodes(m_inode_cache_max_inodes, m_inode_cache_max_bytes, batch);
+	}
+}
+
+size_t FileBasedFilesystem::InodeCacheShrinker::reclaimable_pages() {
+	return m_fs.m_inode_cache_bytes / PAGE_SIZE;
+}
+
+size_t FileBasedFilesystem::InodeCacheShrinker::shrink(size_t num_pages) {
+	// If we were called by an allocation made while changing the cache, pruning it would pull it out from under us
+	if(m_fs.m_inode_cache_lock.held_by_current_thread())
+		return 0;
+
+	size_t num_bytes = num_pages * PAGE_SIZE;
+	size_t freed_bytes = 0;
+	while(freed_bytes < num_bytes) {
+		kstd::Arc<Inode> batch[INODE_CACHE_EVICT_BATCH];
+		size_t batch_count;
+		if(!m_fs.m_inode_cache_lock.try_acquire())
+			break;
+		size_t bytes_before = m_fs.m_inode_cache_bytes;
+		size_t target_bytes = bytes_before > num_bytes - freed_bytes ? bytes_before - (num_bytes - freed_bytes) : 0;
+		batch_count = m_fs.evict_cached_inodes(0, target_bytes, batch);
+		freed_bytes += bytes_before - m_fs.m_inode_cache_bytes;
+		m_fs.m_inode_cache_lock.release();
+		if(!batch_count)
+			break;
 	}
+	return freed_bytes / PAGE_SIZE;
 }
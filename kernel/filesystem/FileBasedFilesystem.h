@@ -24,9 +24,28 @@
 #include <kernel/time/Time.h>
 #include <kernel/tasking/SpinLock.h>
 #include <kernel/kstd/vector.hpp>
+#include <kernel/memory/Shrinker.h>
+
+// How many inodes and how much memory each filesystem's inode cache holds onto by default. They can be changed with the
+// icache_inodes and icache_bytes kernel options, or with set_inode_cache_limits().
+#define INODE_CACHE_MAX_INODES_DEFAULT 4096
+#define INODE_CACHE_MAX_BYTES_DEFAULT (2 * 1024 * 1024)
+// How many unused inodes are evicted at once, since they can only be let go of once the cache lock is released.
+#define INODE_CACHE_EVICT_BATCH 32
 
 class FileBasedFilesystem: public Filesystem {
 public:
+	struct InodeCacheStats {
+		size_t num_inodes;
+		size_t num_bytes;
+		size_t max_inodes;
+		size_t max_bytes;
+		size_t hits;
+		size_t misses;
+		size_t evictions;
+		size_t prefetches; ///< How many inodes were cached because they were next to one that was read in.
+	};
+
 	explicit FileBasedFilesystem(const kstd::Arc<FileDescriptor>& file);
 	~FileBasedFilesystem();
 
@@ -40,6 +59,8 @@ public:
 	
 	Result read_block(size_t block, uint8_t* buffer);
 	Result read_blocks(size_t block, size_t count, uint8_t* buffer);
+	/** Reads count bytes starting offset bytes into a block straight into a buffer. They can span several blocks. **/
+	Result read_block_data(size_t block, size_t offset, size_t count, SafePointer<uint8_t> buffer);
 	Result write_block(size_t block, const uint8_t* buffer);
 	Result write_blocks(size_t block, size_t count, const uint8_t* buffer);
 	Result zero_block(size_t block);
@@ -48,20 +69,84 @@ public:
 	ResultRet<kstd::Arc<Inode>> get_cached_inode(ino_t id);
 	void add_cached_inode(const kstd::Arc<Inode>& inode);
 	void remove_cached_inode(ino_t id);
-
+	InodeCacheStats inode_cache_stats();
+	/**
+	 * Changes how many inodes and how many bytes of them the inode cache can hold. Inodes that are still in use aren't
+	 * evicted, so the cache can go over the limits while they're being used.
+	 */
+	void set_inode_cache_limits(size_t max_inodes, size_t max_bytes);
+
+	/** Reads in an inode that isn't in the cache. Called with the inode cache lock held. **/
 	virtual Inode* get_inode_rawptr(ino_t id);
 	virtual ResultRet<kstd::Arc<Inode>> get_inode(ino_t id);
+	/**
+	 * Writes metadata that's only been changed in memory, like free block counts, into the block cache. The disk's
+	 * flusher writes it out from there along with everything else.
+	 */
+	virtual Result write_metadata();
+	/** Calls write_metadata() on every file-based filesystem. Called periodically by the block cache's flusher. **/
+	static void write_all_metadata();
+
+	// Filesystem
+	Result sync() override;
+	bool can_cache_lookups() override { return true; }
+	bool can_cache_pages() override { return true; }
+	bool has_unique_inodes() override { return true; }
+	bool is_file_based() override { return true; }
 
 protected:
 	void set_block_size(size_t block_size);
+	/** Whether an inode is in the cache, without counting it as a use. Called from get_inode_rawptr(). **/
+	bool is_inode_cached(ino_t id);
+	/** Caches an inode that get_inode_rawptr() read in along with the one it was asked for. **/
+	void cache_prefetched_inode(const kstd::Arc<Inode>& inode);
 
 	size_t _logical_block_size {512};
 	kstd::Arc<FileDescriptor> _file;
 	size_t _block_size;
 
 private:
-	kstd::LRUCache<ino_t, kstd::Arc<Inode>> m_inode_cache;
+	/// Evicts inodes that nothing outside of the cache is using when memory is low.
+	class InodeCacheShrinker: public Shrinker {
+	public:
+		explicit InodeCacheShrinker(FileBasedFilesystem& fs): m_fs(fs) {}
+		const char* name() const override { return "inode cache"; }
+		size_t reclaimable_pages() override;
+		size_t shrink(size_t num_pages) override;
+
+	private:
+		FileBasedFilesystem& m_fs;
+	};
+
+	struct CachedInode {
+		kstd::Arc<Inode> inode;
+		size_t footprint = 0; ///< The inode's cache_footprint() when it was cached.
+	};
+
+	/** Caches an inode. The cache lock must be held. **/
+	void insert_cached_inode(const kstd::Arc<Inode>& inode);
+	/**
+	 * Takes up to INODE_CACHE_EVICT_BATCH unused inodes out of the cache, least recently used first, while there are more
+	 * than max_inodes or max_bytes of them. They're moved into batch, and the number moved is returned. The cache lock
+	 * must be held, and the batch should be let go of after releasing it.
+	 */
+	size_t evict_cached_inodes(size_t max_inodes, size_t max_bytes, kstd::Arc<Inode>* batch);
+	/** Evicts unused inodes until the cache is within its limits. The cache lock must not be held. **/
+	void trim_inode_cache();
+
+	kstd::LRUCache<ino_t, CachedInode> m_inode_cache;
 	SpinLock m_inode_cache_lock;
+	size_t m_inode_cache_bytes = 0;
+	size_t m_inode_cache_max_inodes;
+	size_t m_inode_cache_max_bytes;
+	size_t m_inode_cache_hits = 0;
+	size_t m_inode_cache_misses = 0;
+	size_t m_inode_cache_evictions = 0;
+	size_t m_inode_cache_prefetches = 0;
+	InodeCacheShrinker m_inode_cache_shrinker {*this};
+
+	static kstd::vector<FileBasedFilesystem*> s_filesystems;
+	static SpinLock s_filesystems_lock;
 };
 
 
@@ -22,12 +22,14 @@
 #include "DirectoryEntry.h"
 #include "InodeMetadata.h"
 #include "Inode.h"
+#include "LinkedInode.h"
 #include "Pipe.h"
 #include <kernel/kstd/cstring.h>
 #include <kernel/terminal/PTYMuxDevice.h>
 #include <kernel/terminal/PTYDevice.h>
 #include <kernel/terminal/PTYControllerDevice.h>
 #include <kernel/tasking/Process.h>
+#include <kernel/api/uio.h>
 
 FileDescriptor::FileDescriptor(const kstd::Arc<File>& file, Process* owner): _file(file), _owner(owner ? owner->pid() : -1) {
 	if(file->is_inode())
@@ -48,6 +50,7 @@ FileDescriptor::FileDescriptor(FileDescriptor& other, Process* new_owner) {
 	_append = other._append;
 	_can_seek = other._can_seek;
 	_inode = other._inode;
+	_linked_inode = other._linked_inode;
 	_readable = other._readable;
 	_writable = other._writable;
 	_seek = other._seek;
@@ -183,6 +186,14 @@ void FileDescriptor::set_path(const kstd::string& path) {
 	_path = path;
 }
 
+void FileDescriptor::set_linked_inode(const kstd::Arc<LinkedInode>& linked_inode) {
+	_linked_inode = linked_inode;
+}
+
+kstd::Arc<LinkedInode> FileDescriptor::linked_inode() {
+	return _linked_inode;
+}
+
 kstd::string FileDescriptor::path() {
 	return _path;
 }
@@ -229,9 +240,11 @@ ssize_t FileDescriptor::read_dir_entries(SafePointer<char> buffer, size_t len) {
 	while(true) {
 		ssize_t read = _file->read_dir_entry(*this, offset(), KernelPointer<DirectoryEntry>(&dirbuf));
 		if(read > 0) {
-			if(_can_seek) _seek += read;
-			if(read + nbytes > len) break;
+			//Leave an entry that doesn't fit for the next call, unless it wouldn't fit in an empty buffer either
 			size_t entry_len = dirbuf.entry_length();
+			if(entry_len + nbytes > len)
+				return nbytes ? nbytes : -EINVAL;
+			if(_can_seek) _seek += read;
 			buffer.write((const char*) &dirbuf, nbytes, entry_len);
 			nbytes += entry_len;
 		} else if(read == 0) {
@@ -253,6 +266,86 @@ ssize_t FileDescriptor::write(SafePointer<uint8_t> buffer, size_t count) {
 	return ret;
 }
 
+ssize_t FileDescriptor::read_at(SafePointer<uint8_t> buffer, size_t count, off_t offset) {
+	if(!_readable) return -EBADF;
+	if(offset < 0 || count > INT32_MAX) return -EINVAL;
+	if(!_can_seek) return -ESPIPE;
+	if(offset + (off_t) count < 0) return -EOVERFLOW;
+	return _file->read(*this, offset, buffer, count);
+}
+
+ssize_t FileDescriptor::write_at(SafePointer<uint8_t> buffer, size_t count, off_t offset) {
+	if(!_writable) return -EBADF;
+	if(offset < 0 || count > INT32_MAX) return -EINVAL;
+	if(!_can_seek) return -ESPIPE;
+	if(offset + (off_t) count < 0) return -EOVERFLOW;
+	return _file->write(*this, offset, buffer, count);
+}
+
+ssize_t FileDescriptor::readv(SafePointer<struct iovec> iov, int iovcnt, off_t offset) {
+	if(!_readable) return -EBADF;
+	ssize_t total = check_iovecs(iov, iovcnt);
+	if(total < 0) return total;
+
+	//Reads at a given offset don't need the lock, since they don't touch ours
+	if(offset >= 0) {
+		if(!_can_seek) return -ESPIPE;
+		if(offset + total < 0) return -EOVERFLOW;
+		return transfer_iovecs(false, iov, iovcnt, offset);
+	}
+
+	LOCK(lock);
+	if(_seek + total < 0) return -EOVERFLOW;
+	ssize_t ret = transfer_iovecs(false, iov, iovcnt, _seek);
+	if(_can_seek && ret > 0) _seek += ret;
+	return ret;
+}
+
+ssize_t FileDescriptor::writev(SafePointer<struct iovec> iov, int iovcnt, off_t offset) {
+	if(!_writable) return -EBADF;
+	ssize_t total = check_iovecs(iov, iovcnt);
+	if(total < 0) return total;
+
+	if(offset >= 0) {
+		if(!_can_seek) return -ESPIPE;
+		if(offset + total < 0) return -EOVERFLOW;
+		return transfer_iovecs(true, iov, iovcnt, offset);
+	}
+
+	LOCK(lock);
+	if(_append && _can_seek && metadata().exists()) _seek = metadata().size;
+	if(_seek + total < 0) return -EOVERFLOW;
+	ssize_t ret = transfer_iovecs(true, iov, iovcnt, _seek);
+	if(_can_seek && ret > 0) _seek += ret;
+	return ret;
+}
+
+ssize_t FileDescriptor::check_iovecs(SafePointer<struct iovec> iov, int iovcnt) {
+	if(iovcnt < 0 || iovcnt > IOV_MAX) return -EINVAL;
+	size_t total = 0;
+	for(int i = 0; i < iovcnt; i++) {
+		size_t len = iov.get(i).iov_len;
+		if(len > (size_t) INT32_MAX - total) return -EINVAL;
+		total += len;
+	}
+	return (ssize_t) total;
+}
+
+ssize_t FileDescriptor::transfer_iovecs(bool write, SafePointer<struct iovec> iov, int iovcnt, size_t offset) {
+	size_t done = 0;
+	for(int i = 0; i < iovcnt; i++) {
+		auto vec = iov.get(i);
+		if(!vec.iov_len) continue;
+		SafePointer<uint8_t> buffer((uint8_t*) vec.iov_base, iov.is_user());
+		ssize_t ret = write ? _file->write(*this, offset + done, buffer, vec.iov_len) : _file->read(*this, offset + done, buffer, vec.iov_len);
+		//If some of the buffers were already done, report that instead of the error
+		if(ret < 0) return done ? (ssize_t) done : ret;
+		done += ret;
+		if((size_t) ret < vec.iov_len) break;
+	}
+	return (ssize_t) done;
+}
+
 int FileDescriptor::ioctl(unsigned request, SafePointer<void*> argp) {
 	return _file->ioctl(request, argp);
 }
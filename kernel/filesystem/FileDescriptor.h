@@ -25,12 +25,15 @@
 #include <kernel/kstd/unix_types.h>
 #include "File.h"
 #include <kernel/memory/SafePointer.h>
+#include <kernel/memory/SlabCache.h>
 
 class DirectoryEntry;
 class Device;
 class InodeMetadata;
 class Inode;
+class LinkedInode;
 class FileDescriptor {
+	SLAB_ALLOCATED(FileDescriptor)
 public:
 	explicit FileDescriptor(const kstd::Arc<File>& file, Process* owner = nullptr);
 	FileDescriptor(FileDescriptor& other, Process* new_owner = nullptr);
@@ -51,6 +54,9 @@ public:
 	void set_owner(pid_t owner);
 	void set_path(const kstd::string& path);
 	kstd::string path();
+	/** The inode the file descriptor was opened from along with where it is in the tree, if it was opened from a path. **/
+	void set_linked_inode(const kstd::Arc<LinkedInode>& linked_inode);
+	kstd::Arc<LinkedInode> linked_inode();
 	void set_id(int id);
 	int id();
 
@@ -59,6 +65,17 @@ public:
 	ssize_t read_dir_entry(SafePointer<DirectoryEntry> buffer);
 	ssize_t read_dir_entries(SafePointer<char> buffer, size_t len);
 	ssize_t write(SafePointer<uint8_t> buffer, size_t count);
+	/** Reads at an offset without touching the file descriptor's offset, like pread(). **/
+	ssize_t read_at(SafePointer<uint8_t> buffer, size_t count, off_t offset);
+	/** Writes at an offset without touching the file descriptor's offset, like pwrite(). **/
+	ssize_t write_at(SafePointer<uint8_t> buffer, size_t count, off_t offset);
+	/**
+	 * Reads into each buffer in turn, stopping early if a read comes up short. If the offset is negative, the file
+	 * descriptor's offset is used and moved forward, otherwise the read happens at the offset and doesn't touch it.
+	 */
+	ssize_t readv(SafePointer<struct iovec> iov, int iovcnt, off_t offset = -1);
+	/** Writes from each buffer in turn, like readv(). **/
+	ssize_t writev(SafePointer<struct iovec> iov, int iovcnt, off_t offset = -1);
 	size_t offset() const;
 	int ioctl(unsigned request, SafePointer<void*> argp);
 
@@ -67,8 +84,13 @@ public:
 	bool is_fifo_writer() const;
 
 private:
+	/** Checks that there's a sensible number of buffers, and that their total size fits in an ssize_t. **/
+	static ssize_t check_iovecs(SafePointer<struct iovec> iov, int iovcnt);
+	ssize_t transfer_iovecs(bool write, SafePointer<struct iovec> iov, int iovcnt, size_t offset);
+
 	kstd::Arc<File> _file;
 	kstd::Arc<Inode> _inode;
+	kstd::Arc<LinkedInode> _linked_inode;
 	pid_t _owner = -1;
 	kstd::string _path = "";
 	int _id = -1;
@@ -37,4 +37,26 @@ ino_t Filesystem::root_inode_id() {
 
 uint8_t Filesystem::fsid() {
 	return _fsid;
+}
+
+Result Filesystem::sync() {
+	return Result(SUCCESS);
+}
+
+bool Filesystem::can_cache_lookups() {
+	//Directories on filesystems like procfs change on their own, so by default they can't be cached
+	return false;
+}
+
+bool Filesystem::can_cache_pages() {
+	return false;
+}
+
+bool Filesystem::has_unique_inodes() {
+	//Filesystems like procfs make a new Inode every time one is looked up
+	return false;
+}
+
+bool Filesystem::is_file_based() {
+	return false;
 }
\ No newline at end of file
@@ -32,6 +32,19 @@ public:
 	virtual ResultRet<kstd::Arc<Inode>> get_inode(ino_t id);
 	virtual ino_t root_inode_id();
 	virtual uint8_t fsid();
+	/** Writes any changes to the filesystem that are only in memory out to disk. **/
+	virtual Result sync();
+	/** Whether the results of looking up names in this filesystem's directories can be cached by the VFS. **/
+	virtual bool can_cache_lookups();
+	/** Whether reads and writes of this filesystem's files can go through their page caches. **/
+	virtual bool can_cache_pages();
+	/**
+	 * Whether there's only ever one Inode object for an inode while it's in use, so that state kept on it (like whether
+	 * it's a mountpoint) is seen by everyone who gets it.
+	 */
+	virtual bool has_unique_inodes();
+	/** Whether this is a FileBasedFilesystem. **/
+	virtual bool is_file_based();
 
 protected:
 	uint8_t _fsid;
@@ -30,7 +30,7 @@ Inode::~Inode() {
 
 }
 
-ResultRet<kstd::Arc<Inode>> Inode::find(const kstd::string& name) {
+ResultRet<kstd::Arc<Inode>> Inode::find(kstd::string_view name) {
 	if(metadata().exists() && !metadata().is_directory())
 		return Result(-EISDIR);
 	ino_t id  = find_id(name);
@@ -62,6 +62,10 @@ InodeMetadata Inode::metadata() {
 	return _metadata;
 }
 
+size_t Inode::cache_footprint() {
+	return sizeof(Inode);
+}
+
 bool Inode::exists() {
 	return _exists;
 }
@@ -70,6 +74,14 @@ void Inode::mark_deleted() {
 	_exists = false;
 }
 
+bool Inode::is_mountpoint() {
+	return _is_mountpoint;
+}
+
+void Inode::mark_mountpoint() {
+	_is_mountpoint = true;
+}
+
 bool Inode::can_read(const FileDescriptor& fd) {
 	return true;
 }
@@ -78,16 +90,68 @@ bool Inode::can_write(const FileDescriptor& fd) {
 	return true;
 }
 
-kstd::Arc<InodeVMObject> Inode::shared_vm_object() {
-	LOCK(m_vmobject_lock);
+WaitQueue& Inode::poll_queue() {
+	return m_poll_queue;
+}
+
+ssize_t Inode::read_cached(size_t start, size_t length, SafePointer<uint8_t> buffer, FileDescriptor* fd) {
+	auto meta = metadata();
+	if(!meta.is_simple_file() || !fs.can_cache_pages())
+		return read(start, length, buffer, fd);
+
+	if(start >= meta.size)
+		return 0;
+	if(start + length > meta.size)
+		length = meta.size - start;
+
+	// The file may have been written to without going through the cache
+	auto cache = page_cache();
+	cache->resize(meta.size);
+	return cache->read(start, length, buffer);
+}
+
+ssize_t Inode::write_cached(size_t start, size_t length, SafePointer<uint8_t> buffer, FileDescriptor* fd) {
+	ssize_t nwritten = write(start, length, buffer, fd);
+	if(nwritten <= 0)
+		return nwritten;
 
-	kstd::Arc<InodeVMObject> ret;
-	if(!m_shared_vm_object) {
-		ret = InodeVMObject::make_for_inode(self(), InodeVMObject::Type::Shared);
-		m_shared_vm_object = ret;
-	} else {
-		ret = m_shared_vm_object.lock();
+	// Writes go straight through to the inode, so the cache only needs updating if it has any of the pages
+	kstd::Arc<InodeVMObject> cache;
+	{
+		LOCK(m_vmobject_lock);
+		cache = m_page_cache;
+	}
+	if(cache) {
+		cache->resize(metadata().size);
+		cache->update(start, nwritten, buffer);
 	}
+	return nwritten;
+}
+
+Result Inode::truncate_cached(off_t length) {
+	auto res = truncate(length);
+	if(res.is_error())
+		return res;
 
-	return ret;
+	kstd::Arc<InodeVMObject> cache;
+	{
+		LOCK(m_vmobject_lock);
+		cache = m_page_cache;
+	}
+	if(cache)
+		cache->resize(metadata().size);
+	return res;
+}
+
+ResultRet<kstd::Arc<VMObject>> Inode::object_for_mapping(bool shared) {
+	if(shared)
+		return kstd::static_pointer_cast<VMObject>(page_cache());
+	return kstd::static_pointer_cast<VMObject>(InodeVMObject::make_for_inode(self(), InodeVMObject::Type::Private));
+}
+
+kstd::Arc<InodeVMObject> Inode::page_cache() {
+	LOCK(m_vmobject_lock);
+	if(!m_page_cache)
+		m_page_cache = InodeVMObject::make_for_inode(self(), InodeVMObject::Type::Shared);
+	return m_page_cache;
 }
@@ -23,6 +23,8 @@
 #include <kernel/kstd/Arc.h>
 #include <kernel/Result.hpp>
 #include <kernel/tasking/SpinLock.h>
+#include <kernel/tasking/RWLock.h>
+#include <kernel/tasking/WaitQueue.h>
 #include "InodeMetadata.h"
 #include <kernel/memory/SafePointer.h>
 #include <kernel/kstd/string.h>
@@ -32,6 +34,7 @@ class Filesystem;
 class LinkedInode;
 class FileDescriptor;
 class InodeVMObject;
+class VMObject;
 
 class Inode: public kstd::ArcSelf<Inode> {
 public:
@@ -41,10 +44,13 @@ public:
 	Inode(Filesystem& fs, ino_t id);
 	bool exists();
 	void mark_deleted();
+	/** Whether a filesystem is mounted on this inode. Only meaningful if the filesystem has_unique_inodes(). **/
+	bool is_mountpoint();
+	void mark_mountpoint();
 	virtual ~Inode();
 
-	virtual ResultRet<kstd::Arc<Inode>> find(const kstd::string& name);
-	virtual ino_t find_id(const kstd::string& name) = 0;
+	virtual ResultRet<kstd::Arc<Inode>> find(kstd::string_view name);
+	virtual ino_t find_id(kstd::string_view name) = 0;
 	virtual ssize_t read(size_t start, size_t length, SafePointer<uint8_t> buffer, FileDescriptor* fd) = 0;
 	virtual ssize_t read_dir_entry(size_t start, SafePointer<DirectoryEntry> buffer, FileDescriptor* fd) = 0;
 	virtual ssize_t write(size_t start, size_t length, SafePointer<uint8_t> buffer, FileDescriptor* fd) = 0;
@@ -59,16 +65,37 @@ public:
 	virtual void close(FileDescriptor& fd) = 0;
 	virtual bool can_read(const FileDescriptor& fd);
 	virtual bool can_write(const FileDescriptor& fd);
+	virtual WaitQueue& poll_queue();
 
 	virtual InodeMetadata metadata();
+	/** Roughly how much kernel memory the inode takes up, for keeping the inode cache within its limits. **/
+	virtual size_t cache_footprint();
 
-	kstd::Arc<InodeVMObject> shared_vm_object();
+	/**
+	 * Reads from, writes to, or truncates the inode through its page cache. Only regular files on filesystems that
+	 * can_cache_pages() have one, and anything else goes straight to read(), write() or truncate().
+	 */
+	ssize_t read_cached(size_t start, size_t length, SafePointer<uint8_t> buffer, FileDescriptor* fd);
+	ssize_t write_cached(size_t start, size_t length, SafePointer<uint8_t> buffer, FileDescriptor* fd);
+	Result truncate_cached(off_t length);
+
+	/** Gets the page cache of the inode, which shared mappings of it map too. **/
+	kstd::Arc<InodeVMObject> page_cache();
+
+	/**
+	 * Gets an object to map the inode with. Shared mappings map the page cache by default, and private mappings get an
+	 * object with copy-on-write references to it.
+	 */
+	virtual ResultRet<kstd::Arc<VMObject>> object_for_mapping(bool shared);
 
 protected:
 	InodeMetadata _metadata;
-	SpinLock lock, m_vmobject_lock;
-	kstd::Weak<InodeVMObject> m_shared_vm_object;
+	RWLock lock;
+	SpinLock m_vmobject_lock;
+	kstd::Arc<InodeVMObject> m_page_cache;
+	WaitQueue m_poll_queue;
 	bool _exists = true;
+	bool _is_mountpoint = false;
 };
 
 
@@ -19,6 +19,9 @@
 
 #include "InodeFile.h"
 #include "Inode.h"
+#include "Filesystem.h"
+#include <kernel/memory/InodeVMObject.h>
+#include <kernel/memory/MemoryManager.h>
 
 InodeFile::InodeFile(kstd::Arc<Inode> inode): _inode(inode) {
 }
@@ -33,7 +36,7 @@ kstd::Arc<Inode> InodeFile::inode() {
 
 ssize_t InodeFile::read(FileDescriptor &fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
 	if(_inode->metadata().exists() && _inode->metadata().is_directory()) return -EISDIR;
-	return _inode->read(offset, count, buffer, &fd);;
+	return _inode->read_cached(offset, count, buffer, &fd);
 }
 
 ssize_t InodeFile::read_dir_entry(FileDescriptor &fd, size_t offset, SafePointer<DirectoryEntry> buffer) {
@@ -43,7 +46,7 @@ ssize_t InodeFile::read_dir_entry(FileDescriptor &fd, size_t offset, SafePointer
 
 ssize_t InodeFile::write(FileDescriptor &fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
 	if(_inode->metadata().exists() && _inode->metadata().is_directory()) return -EISDIR;
-	return _inode->write(offset, count, buffer, &fd);
+	return _inode->write_cached(offset, count, buffer, &fd);
 }
 
 void InodeFile::open(FileDescriptor& fd, int options) {
@@ -62,3 +65,91 @@ bool InodeFile::can_write(const FileDescriptor& fd) {
 	return _inode->can_write(fd);
 }
 
+WaitQueue& InodeFile::poll_queue() {
+	return _inode->poll_queue();
+}
+
+Result InodeFile::sync() {
+	return _inode->fs.sync();
+}
+
+ResultRet<kstd::Arc<VMObject>> InodeFile::object_for_mapping(size_t size, bool shared) {
+	return _inode->object_for_mapping(shared);
+}
+
+ssize_t InodeFile::copy_to(FileDescriptor& fd, size_t offset, File& out, FileDescriptor& out_fd, size_t out_offset, size_t count) {
+	auto meta = _inode->metadata();
+	if(offset >= meta.size)
+		return 0;
+	count = min(count, meta.size - offset);
+
+	size_t ncopied = 0;
+	ssize_t error = 0;
+	bool done = false;
+
+	//Write the pages of the page cache straight out, a batch at a time so we don't have to take the lock for every page
+	if(meta.is_simple_file() && _inode->fs.can_cache_pages()) {
+		auto cache = _inode->page_cache();
+		cache->resize(meta.size);
+		PageIndex pages[INODE_COPY_BATCH_PAGES];
+		while(ncopied < count && !done) {
+			size_t pos = offset + ncopied;
+			size_t num_pages = min(kstd::ceil_div(pos % PAGE_SIZE + count - ncopied, PAGE_SIZE), (size_t) INODE_COPY_BATCH_PAGES);
+			auto ref_res = cache->ref_pages(pos / PAGE_SIZE, num_pages, true, pages);
+			if(ref_res.is_error()) {
+				error = -ref_res.code();
+				break;
+			}
+			if(!ref_res.value())
+				break;
+
+			for(size_t i = 0; i < ref_res.value(); i++) {
+				if(!done && ncopied < count) {
+					pos = offset + ncopied;
+					size_t chunk = min(count - ncopied, PAGE_SIZE - pos % PAGE_SIZE);
+					ssize_t nwritten;
+					MM.with_quickmapped(pages[i], [&](void* ptr) {
+						nwritten = out.write(out_fd, out_offset + ncopied, KernelPointer<uint8_t>((uint8_t*) ptr + pos % PAGE_SIZE), chunk);
+					});
+					if(nwritten <= 0) {
+						error = nwritten;
+						done = true;
+					} else {
+						ncopied += nwritten;
+						done = (size_t) nwritten < chunk;
+					}
+				}
+				MM.get_physical_page(pages[i]).unref();
+			}
+		}
+		return ncopied ? (ssize_t) ncopied : error;
+	}
+
+	//Otherwise, read the file into a page and write it out from there
+	auto page_res = MM.alloc_physical_page();
+	if(page_res.is_error())
+		return -ENOMEM;
+	auto page = page_res.value();
+	while(ncopied < count && !done) {
+		size_t chunk = min(count - ncopied, PAGE_SIZE);
+		MM.with_quickmapped(page, [&](void* ptr) {
+			ssize_t nread = read(fd, offset + ncopied, KernelPointer<uint8_t>((uint8_t*) ptr), chunk);
+			if(nread <= 0) {
+				error = nread;
+				done = true;
+				return;
+			}
+			ssize_t nwritten = out.write(out_fd, out_offset + ncopied, KernelPointer<uint8_t>((uint8_t*) ptr), nread);
+			if(nwritten <= 0) {
+				error = nwritten;
+				done = true;
+				return;
+			}
+			ncopied += nwritten;
+			done = nwritten < nread;
+		});
+	}
+	MM.get_physical_page(page).unref();
+	return ncopied ? (ssize_t) ncopied : error;
+}
+
@@ -21,6 +21,9 @@
 
 #include "File.h"
 
+//How many pages of the page cache copy_to() takes references to at once
+#define INODE_COPY_BATCH_PAGES 16
+
 class Inode;
 class InodeFile: public File {
 public:
@@ -35,6 +38,16 @@ public:
 	void close(FileDescriptor& fd) override;
 	virtual bool can_read(const FileDescriptor& fd) override;
 	virtual bool can_write(const FileDescriptor& fd) override;
+	WaitQueue& poll_queue() override;
+	Result sync() override;
+	ResultRet<kstd::Arc<VMObject>> object_for_mapping(size_t size, bool shared) override;
+
+	/**
+	 * Copies part of this file into another file without going through userspace. Pages in the page cache are written
+	 * to the other file as they are, and anything else goes through a page of kernel memory.
+	 * @return The number of bytes copied, which is 0 at the end of the file, or an error.
+	 */
+	ssize_t copy_to(FileDescriptor& fd, size_t offset, File& out, FileDescriptor& out_fd, size_t out_offset, size_t count);
 
 private:
 	kstd::Arc<Inode> _inode;
@@ -21,8 +21,10 @@
 
 #include <kernel/kstd/string.h>
 #include "Inode.h"
+#include <kernel/memory/SlabCache.h>
 
 class LinkedInode {
+	SLAB_ALLOCATED(LinkedInode)
 public:
 	LinkedInode(const kstd::Arc<Inode>& inode, const kstd::string& name, const kstd::Arc<LinkedInode>& parent);
 	~LinkedInode();
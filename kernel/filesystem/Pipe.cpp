@@ -18,13 +18,22 @@
 */
 
 #include "Pipe.h"
+#include "InodeFile.h"
+#include "Inode.h"
+#include "Filesystem.h"
+#include <kernel/memory/InodeVMObject.h>
 #include <kernel/tasking/Signal.h>
 #include <kernel/tasking/TaskManager.h>
 #include <kernel/filesystem/FileDescriptor.h>
 
-Pipe::Pipe(): _queue(PIPE_SIZE) {}
+Pipe::Pipe() {
+	_ring.resize(_capacity / PAGE_SIZE);
+}
 
-Pipe::~Pipe() = default;
+Pipe::~Pipe() {
+	while(_num_buffers)
+		MM.get_physical_page(take_buffer().page).unref();
+}
 
 void Pipe::add_reader() {
 	_readers++;
@@ -36,51 +45,259 @@ void Pipe::add_writer() {
 
 void Pipe::remove_reader() {
 	_readers--;
+	if(!_readers) {
+		_write_blocker.set_ready(true);
+		m_poll_queue.wake();
+	}
 }
 
 void Pipe::remove_writer() {
 	_writers--;
 	if(!_writers) {
 		_blocker.set_ready(true);
+		m_poll_queue.wake();
 	}
 }
 
-ssize_t Pipe::read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
-	if(!_writers && _queue.empty()) return 0;
-	if(!_blocker.is_ready())
-		TaskManager::current_thread()->block(_blocker);
-	if(_blocker.was_interrupted())
-		return -EINTR;
+size_t Pipe::capacity() {
+	return _capacity;
+}
+
+ResultRet<size_t> Pipe::set_capacity(size_t capacity) {
+	capacity = kstd::ceil_div(max(capacity, (size_t) PAGE_SIZE), PAGE_SIZE) * PAGE_SIZE;
+	if(capacity > PIPE_MAX_SIZE)
+		return Result(EINVAL);
+
 	LOCK(_lock);
-	if(count > _queue.size())
-		count = _queue.size();
-	for(size_t i = 0; i < count; i++)
-		buffer.set(i, _queue.pop_front());
-	if(_queue.empty() && _writers)
-		_blocker.set_ready(false);
-	return count;
+	size_t num_buffers = capacity / PAGE_SIZE;
+	if(_size > capacity || _num_buffers > num_buffers)
+		return Result(EBUSY);
+
+	kstd::vector<Buffer> ring;
+	ring.resize(num_buffers);
+	for(size_t i = 0; i < _num_buffers; i++)
+		ring[i] = buffer_at(i);
+	_ring = kstd::move(ring);
+	_head = 0;
+	_capacity = capacity;
+	update_blockers();
+	return capacity;
 }
 
-ssize_t Pipe::write(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
-	//TODO: Block writes bigger than available space
-	if(_readers == 0) {
-		TaskManager::current_process()->kill(SIGPIPE);
-		return -EPIPE;
+ssize_t Pipe::splice_to(FileDescriptor& fd, Pipe& other, FileDescriptor& other_fd, size_t count, bool keep) {
+	if(&other == this)
+		return -EINVAL;
+
+	while(true) {
+		ssize_t wait_res = wait_for_data(fd);
+		if(wait_res <= 0)
+			return wait_res;
+		wait_res = other.wait_for_room(other_fd, true);
+		if(wait_res < 0)
+			return wait_res;
+
+		//Always lock the two pipes in the same order, so splicing both ways at once can't deadlock
+		LOCK_N(this < &other ? _lock : other._lock, first_locker);
+		LOCK_N(this < &other ? other._lock : _lock, second_locker);
+
+		//Whole buffers are moved as they are. If only part of one is wanted, or the data is kept here too, the page is
+		//shared between the pipes instead.
+		size_t nmoved = 0;
+		size_t index = 0;
+		while(nmoved < count && index < _num_buffers && other.has_room(true)) {
+			auto& buffer = buffer_at(keep ? index : 0);
+			size_t chunk = min(min(count - nmoved, buffer.length), other._capacity - other._size);
+			if(keep || chunk < buffer.length) {
+				MM.get_physical_page(buffer.page).ref();
+				other.push_buffer({buffer.page, buffer.offset, chunk});
+				if(keep) {
+					index++;
+				} else {
+					buffer.offset += chunk;
+					buffer.length -= chunk;
+					_size -= chunk;
+				}
+			} else {
+				other.push_buffer(take_buffer());
+			}
+			nmoved += chunk;
+		}
+
+		//Someone else got to one of the pipes first, so wait again
+		if(!nmoved)
+			continue;
+
+		update_blockers();
+		other.update_blockers();
+		return nmoved;
+	}
+}
+
+ssize_t Pipe::splice_from_file(FileDescriptor& fd, File& file, FileDescriptor& file_fd, size_t offset, size_t count) {
+	ssize_t wait_res = wait_for_room(fd, true);
+	if(wait_res < 0)
+		return wait_res;
+
+	//Pages in the file's page cache can go into the pipe as they are. Anything else is read into new pages.
+	kstd::Arc<InodeVMObject> cache;
+	if(file.is_inode()) {
+		auto inode = ((InodeFile&) file).inode();
+		auto meta = inode->metadata();
+		if(meta.is_simple_file() && inode->fs.can_cache_pages()) {
+			if(offset >= meta.size)
+				return 0;
+			count = min(count, meta.size - offset);
+			cache = inode->page_cache();
+			cache->resize(meta.size);
+		}
 	}
 
 	LOCK(_lock);
+	size_t nread = 0;
+	ssize_t error = 0;
+	while(nread < count && has_room(true)) {
+		size_t pos = offset + nread;
+		size_t chunk = min(min(count - nread, PAGE_SIZE - pos % PAGE_SIZE), _capacity - _size);
+		PageIndex page;
+		if(cache) {
+			auto ref_res = cache->ref_pages(pos / PAGE_SIZE, 1, true, &page);
+			if(ref_res.is_error()) {
+				error = -ref_res.code();
+				break;
+			}
+			if(!ref_res.value())
+				break;
+		} else {
+			auto page_res = MM.alloc_physical_page();
+			if(page_res.is_error()) {
+				error = -ENOMEM;
+				break;
+			}
+			page = page_res.value();
+			ssize_t nread_page;
+			MM.with_quickmapped(page, [&](void* ptr) {
+				nread_page = file.read(file_fd, pos, KernelPointer<uint8_t>((uint8_t*) ptr + pos % PAGE_SIZE), chunk);
+			});
+			if(nread_page <= 0) {
+				MM.get_physical_page(page).unref();
+				error = nread_page;
+				break;
+			}
+			chunk = nread_page;
+		}
+
+		push_buffer({page, pos % PAGE_SIZE, chunk});
+		nread += chunk;
 
-	size_t nwrote = 0;
-	bool flag = true;
-	while(nwrote < count && flag) {
-		flag = _queue.push_back(buffer.get(nwrote));
-		nwrote++;
+		//Files without a page cache may not have any more data ready yet, so don't wait on them for more
+		if(!cache && pos % PAGE_SIZE + chunk < PAGE_SIZE)
+			break;
 	}
 
-	if(nwrote)
-		_blocker.set_ready(true);
+	update_blockers();
+	return nread ? (ssize_t) nread : error;
+}
+
+ssize_t Pipe::splice_to_file(FileDescriptor& fd, File& file, FileDescriptor& file_fd, size_t offset, size_t count) {
+	ssize_t wait_res = wait_for_data(fd);
+	if(wait_res <= 0)
+		return wait_res;
+
+	LOCK(_lock);
+	size_t nwritten = 0;
+	ssize_t error = 0;
+	while(nwritten < count && _num_buffers) {
+		auto& buffer = buffer_at(0);
+		size_t chunk = min(count - nwritten, buffer.length);
+		ssize_t nwritten_page;
+		MM.with_quickmapped(buffer.page, [&](void* ptr) {
+			nwritten_page = file.write(file_fd, offset + nwritten, KernelPointer<uint8_t>((uint8_t*) ptr + buffer.offset), chunk);
+		});
+		if(nwritten_page <= 0) {
+			error = nwritten_page;
+			break;
+		}
+
+		buffer.offset += nwritten_page;
+		buffer.length -= nwritten_page;
+		_size -= nwritten_page;
+		nwritten += nwritten_page;
+		if(!buffer.length)
+			MM.get_physical_page(take_buffer().page).unref();
+		if((size_t) nwritten_page < chunk)
+			break;
+	}
 
-	return nwrote;
+	update_blockers();
+	return nwritten ? (ssize_t) nwritten : error;
+}
+
+ssize_t Pipe::read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
+	while(true) {
+		ssize_t wait_res = wait_for_data(fd);
+		if(wait_res <= 0)
+			return wait_res;
+
+		LOCK(_lock);
+		//Someone else got to the data first, so wait again
+		if(!_size)
+			continue;
+
+		size_t nread = 0;
+		while(nread < count && _num_buffers) {
+			auto& buf = buffer_at(0);
+			size_t chunk = min(count - nread, buf.length);
+			MM.with_quickmapped(buf.page, [&](void* ptr) {
+				buffer.write((uint8_t*) ptr + buf.offset, nread, chunk);
+			});
+			buf.offset += chunk;
+			buf.length -= chunk;
+			_size -= chunk;
+			nread += chunk;
+			if(!buf.length)
+				MM.get_physical_page(take_buffer().page).unref();
+		}
+
+		update_blockers();
+		return nread;
+	}
+}
+
+ssize_t Pipe::write(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
+	size_t nwritten = 0;
+	while(nwritten < count) {
+		ssize_t wait_res = wait_for_room(fd, false);
+		if(wait_res < 0)
+			return nwritten ? (ssize_t) nwritten : wait_res;
+
+		LOCK(_lock);
+		while(nwritten < count && _size < _capacity) {
+			//Fill up the last page before starting a new one
+			auto* tail = writable_tail();
+			if(!tail) {
+				if(_num_buffers == _ring.size())
+					break;
+				auto page_res = MM.alloc_physical_page();
+				if(page_res.is_error()) {
+					update_blockers();
+					return nwritten ? (ssize_t) nwritten : -ENOMEM;
+				}
+				push_buffer({page_res.value(), 0, 0});
+				tail = &buffer_at(_num_buffers - 1);
+			}
+
+			size_t chunk = min(min(count - nwritten, PAGE_SIZE - tail->offset - tail->length), _capacity - _size);
+			MM.with_quickmapped(tail->page, [&](void* ptr) {
+				buffer.read((uint8_t*) ptr + tail->offset + tail->length, nwritten, chunk);
+			});
+			tail->length += chunk;
+			_size += chunk;
+			nwritten += chunk;
+		}
+		update_blockers();
+	}
+
+	return nwritten;
 }
 
 bool Pipe::is_fifo() {
@@ -88,5 +305,92 @@ bool Pipe::is_fifo() {
 }
 
 bool Pipe::can_read(const FileDescriptor& fd) {
-	return !_queue.empty() && !fd.is_fifo_writer();
+	return _size && !fd.is_fifo_writer();
+}
+
+bool Pipe::can_write(const FileDescriptor& fd) {
+	LOCK(_lock);
+	return has_room(false);
+}
+
+ssize_t Pipe::wait_for_data(FileDescriptor& fd) {
+	while(true) {
+		{
+			LOCK(_lock);
+			if(_size)
+				return 1;
+			if(!_writers)
+				return 0;
+			if(fd.nonblock())
+				return -EAGAIN;
+			_blocker.set_ready(false);
+		}
+		TaskManager::current_thread()->block(_blocker);
+		if(_blocker.was_interrupted())
+			return -EINTR;
+	}
+}
+
+ssize_t Pipe::wait_for_room(FileDescriptor& fd, bool whole_buffer) {
+	while(true) {
+		{
+			LOCK(_lock);
+			if(!_readers) {
+				TaskManager::current_process()->kill(SIGPIPE);
+				return -EPIPE;
+			}
+			if(has_room(whole_buffer))
+				return 1;
+			if(fd.nonblock())
+				return -EAGAIN;
+			_write_blocker.set_ready(false);
+		}
+		TaskManager::current_thread()->block(_write_blocker);
+		if(_write_blocker.was_interrupted())
+			return -EINTR;
+	}
+}
+
+bool Pipe::has_room(bool whole_buffer) {
+	if(_size >= _capacity)
+		return false;
+	return _num_buffers < _ring.size() || (!whole_buffer && writable_tail());
+}
+
+Pipe::Buffer& Pipe::buffer_at(size_t index) {
+	return _ring[(_head + index) % _ring.size()];
+}
+
+void Pipe::push_buffer(const Buffer& buffer) {
+	ASSERT(_num_buffers < _ring.size());
+	_ring[(_head + _num_buffers) % _ring.size()] = buffer;
+	_num_buffers++;
+	_size += buffer.length;
+}
+
+Pipe::Buffer Pipe::take_buffer() {
+	ASSERT(_num_buffers);
+	auto buffer = _ring[_head];
+	_head = (_head + 1) % _ring.size();
+	_num_buffers--;
+	_size -= buffer.length;
+	return buffer;
+}
+
+Pipe::Buffer* Pipe::writable_tail() {
+	if(!_num_buffers)
+		return nullptr;
+	auto& tail = buffer_at(_num_buffers - 1);
+	if(tail.offset + tail.length == PAGE_SIZE)
+		return nullptr;
+	//Pages shared with another pipe or a page cache can't be written to
+	if(MM.get_physical_page(tail.page).allocated.ref_count.load(MemoryOrder::Relaxed) != 1)
+		return nullptr;
+	return &tail;
+}
+
+void Pipe::update_blockers() {
+	_blocker.set_ready(_size || !_writers);
+	_write_blocker.set_ready(has_room(false) || !_readers);
+	m_poll_queue.wake();
 }
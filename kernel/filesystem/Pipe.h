@@ -21,11 +21,16 @@
 
 #include <kernel/memory/MemoryManager.h>
 #include <kernel/filesystem/File.h>
-#include <kernel/kstd/circular_queue.hpp>
+#include <kernel/kstd/vector.hpp>
 #include <kernel/tasking/SpinLock.h>
 
-#define PIPE_SIZE PAGE_SIZE
+#define PIPE_DEFAULT_SIZE (PAGE_SIZE * 16)
+#define PIPE_MAX_SIZE (PAGE_SIZE * 256)
 
+/**
+ * A pipe keeps its data in a ring of page-sized buffers. Buffers can be passed between pipes, or taken straight from a
+ * file's page cache, by splice() and tee() without copying the data in them.
+ */
 class Pipe: public File {
 public:
 	//Pipe
@@ -37,17 +42,64 @@ public:
 	void remove_reader();
 	void remove_writer();
 
+	/** The number of bytes the pipe can hold. **/
+	size_t capacity();
+	/**
+	 * Changes the number of bytes the pipe can hold, rounded up to a whole number of pages. Fails with EBUSY if there's
+	 * more data in the pipe than that.
+	 */
+	ResultRet<size_t> set_capacity(size_t capacity);
+
+	/**
+	 * Moves data from this pipe to another without copying it. If keep is set, the data stays in this pipe too.
+	 * @return The number of bytes moved, or a negative error code.
+	 */
+	ssize_t splice_to(FileDescriptor& fd, Pipe& other, FileDescriptor& other_fd, size_t count, bool keep);
+	/** Reads data from a file into the pipe. Pages in the file's page cache are added to the pipe without copying them. **/
+	ssize_t splice_from_file(FileDescriptor& fd, File& file, FileDescriptor& file_fd, size_t offset, size_t count);
+	/** Writes data from the pipe to a file without copying it through userspace. **/
+	ssize_t splice_to_file(FileDescriptor& fd, File& file, FileDescriptor& file_fd, size_t offset, size_t count);
+
 	//File
 	ssize_t read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
 	ssize_t write(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
 	bool is_fifo() override;
 	bool can_read(const FileDescriptor& fd) override;
+	bool can_write(const FileDescriptor& fd) override;
 
 private:
-	kstd::circular_queue<uint8_t> _queue;
+	/** A page with some of the data in the pipe. The page may be shared with other pipes or a page cache. **/
+	struct Buffer {
+		PageIndex page;
+		size_t offset;
+		size_t length;
+	};
+
+	/** Waits until there's data to read. Returns 0 if there are no writers left and the pipe is empty. **/
+	ssize_t wait_for_data(FileDescriptor& fd);
+	/** Waits until there's room to write. **/
+	ssize_t wait_for_room(FileDescriptor& fd, bool whole_buffer);
+	/** Whether there's room for more data, or for another buffer if whole_buffer is set. **/
+	bool has_room(bool whole_buffer);
+	Buffer& buffer_at(size_t index);
+	/** Adds a buffer to the end of the pipe, taking over a reference to its page. **/
+	void push_buffer(const Buffer& buffer);
+	/** Removes the first buffer from the pipe, handing over the reference to its page. **/
+	Buffer take_buffer();
+	/** Gets the last buffer if more data can be written into it. **/
+	Buffer* writable_tail();
+	/** Updates the blockers and wakes anyone polling after data is added or removed. **/
+	void update_blockers();
+
+	kstd::vector<Buffer> _ring;
+	size_t _head = 0;
+	size_t _num_buffers = 0;
+	size_t _size = 0;
+	size_t _capacity = PIPE_DEFAULT_SIZE;
 	size_t _readers = 0;
 	size_t _writers = 0;
 	BooleanBlocker _blocker;
+	BooleanBlocker _write_blocker;
 	SpinLock _lock;
 };
 
@@ -59,16 +59,18 @@ bool VFS::mount_root(Filesystem* fs) {
 	return true;
 }
 
-ResultRet<kstd::Arc<LinkedInode>> VFS::resolve_path(kstd::string path, const kstd::Arc<LinkedInode>& _base, const User& user, kstd::Arc<LinkedInode>* parent_storage, int options, int recursion_level) {
+ResultRet<kstd::Arc<LinkedInode>> VFS::resolve_path(kstd::string_view path, const kstd::Arc<LinkedInode>& _base, const User& user, kstd::Arc<LinkedInode>* parent_storage, int options, int recursion_level) {
 	if(recursion_level > VFS_RECURSION_LIMIT) return Result(-ELOOP);
 	if(path == "/") return _root_ref;
 
-	auto current_inode = path[0] == '/' ? _root_ref : _base;
-	kstd::string part;
-	if(path[0] == '/')
-		path = path.substr(1, path.length() - 1);
+	//The components of the path are views into it, so walking it doesn't allocate any strings
+	bool absolute = !path.empty() && path[0] == '/';
+	auto current_inode = absolute ? _root_ref : _base;
+	kstd::string_view part;
+	if(absolute)
+		path = path.substr(1);
 
-	while(path[0] != '\0') {
+	while(!path.empty()) {
 		auto parent = current_inode;
 		if(!parent->inode()->metadata().is_directory()) return Result(-ENOTDIR);
 		if(!parent->inode()->metadata().can_execute(user)) return Result(-EACCES);
@@ -76,10 +78,10 @@ ResultRet<kstd::Arc<LinkedInode>> VFS::resolve_path(kstd::string path, const kst
 		size_t slash_index = path.find('/');
 		if(slash_index != -1) {
 			part = path.substr(0, slash_index);
-			path = path.substr(slash_index + 1, path.length() - slash_index - 1);
+			path = path.substr(slash_index + 1);
 		} else {
 			part = path;
-			path = "";
+			path = {};
 		}
 
 		if(part == "..") {
@@ -91,7 +93,7 @@ ResultRet<kstd::Arc<LinkedInode>> VFS::resolve_path(kstd::string path, const kst
 			continue;
 		}
 
-		auto child_inode_or_err = current_inode->inode()->find(part);
+		auto child_inode_or_err = lookup(*current_inode->inode(), part);
 
 		if(!child_inode_or_err.is_error()) {
 			if(child_inode_or_err.value()->metadata().is_symlink()) {
@@ -99,7 +101,7 @@ ResultRet<kstd::Arc<LinkedInode>> VFS::resolve_path(kstd::string path, const kst
 					if (options & O_NOFOLLOW)
 						return Result(-ELOOP);
 					if (options & O_INTERNAL_RETLINK) {
-						current_inode = kstd::Arc<LinkedInode>(new LinkedInode(child_inode_or_err.value(), part, parent));
+						current_inode = kstd::Arc<LinkedInode>(new LinkedInode(child_inode_or_err.value(), kstd::string(part), parent));
 						break;
 					}
 				}
@@ -110,15 +112,7 @@ ResultRet<kstd::Arc<LinkedInode>> VFS::resolve_path(kstd::string path, const kst
 				return resolve_path(path, link_or_err.value(), user, parent_storage, options, recursion_level + 1);
 			}
 
-			current_inode = kstd::Arc<LinkedInode>(new LinkedInode(child_inode_or_err.value(), part, parent));
-
-			//Check if there's a mount at this inode and follow it if there is
-			auto mount_or_err = get_mount(current_inode);
-			if(!mount_or_err.is_error()) {
-				auto guest_fs = mount_or_err.value().guest_fs();
-				auto guest_inode = TRY(guest_fs->get_inode(guest_fs->root_inode_id()));
-				current_inode = kstd::make_shared<LinkedInode>(guest_inode, part, parent);
-			}
+			current_inode = kstd::Arc<LinkedInode>(new LinkedInode(child_inode_or_err.value(), kstd::string(part), parent));
 		} else {
 			if(parent_storage && path.find('/') == -1) {
 				*parent_storage = current_inode;
@@ -131,6 +125,37 @@ ResultRet<kstd::Arc<LinkedInode>> VFS::resolve_path(kstd::string path, const kst
 	return current_inode;
 }
 
+ResultRet<kstd::Arc<Inode>> VFS::lookup(Inode& dir, kstd::string_view name) {
+	bool cacheable = dir.fs.can_cache_lookups();
+	Filesystem* fs;
+	ino_t id;
+	uint32_t generation = 0;
+	if(cacheable && m_dentry_cache.lookup(dir, name, fs, id, generation)) {
+		if(!id)
+			return Result(-ENOENT);
+		return fs->get_inode(id);
+	}
+
+	auto child_or_err = dir.find(name);
+	if(child_or_err.is_error()) {
+		if(cacheable && child_or_err.code() == -ENOENT)
+			m_dentry_cache.insert(dir, name, nullptr, 0, generation);
+		return child_or_err;
+	}
+
+	//Check if there's a mount at this inode and follow it if there is
+	auto child = child_or_err.value();
+	auto mount_or_err = get_mount(*child);
+	if(!mount_or_err.is_error()) {
+		auto guest_fs = mount_or_err.value().guest_fs();
+		child = TRY(guest_fs->get_inode(guest_fs->root_inode_id()));
+	}
+
+	if(cacheable)
+		m_dentry_cache.insert(dir, name, &child->fs, child->id, generation);
+	return child;
+}
+
 ResultRet<kstd::Arc<FileDescriptor>> VFS::open(const kstd::string& path, int options, mode_t mode, const User& user, const kstd::Arc<LinkedInode>& base) {
 	//Check path length & options for validity
 	if(path.length() == 0) return Result(-ENOENT);
@@ -180,10 +205,11 @@ ResultRet<kstd::Arc<FileDescriptor>> VFS::open(const kstd::string& path, int opt
 	}
 
 	//Make the InodeFile and FileDescriptor
-	if(options & O_TRUNC) inode->inode()->truncate(0);
+	if(options & O_TRUNC) inode->inode()->truncate_cached(0);
 	auto file = kstd::make_shared<InodeFile>(inode->inode());
 	auto ret = kstd::make_shared<FileDescriptor>(file, TaskManager::current_process());
 	ret->set_options(options);
+	ret->set_linked_inode(inode);
 	ret->open();
 
 	return ret;
@@ -199,6 +225,7 @@ ResultRet<kstd::Arc<FileDescriptor>> VFS::create(const kstd::string& path, int o
 
 	//Create the entry
 	auto child_or_err = parent->inode()->create_entry(path_base(path), mode, user.euid, user.egid);
+	m_dentry_cache.invalidate(*parent->inode(), path_base(path));
 	if(child_or_err.is_error()) return child_or_err.result();
 
 	//Return a file descriptor to the new file
@@ -221,7 +248,9 @@ Result VFS::unlink(const kstd::string &path, const User& user, const kstd::Arc<L
 
 	//Unlink
 	if(resolv.value()->inode()->metadata().is_directory()) return Result(-EISDIR);
-	return parent->inode()->remove_entry(path_base(path));
+	auto res = parent->inode()->remove_entry(path_base(path));
+	m_dentry_cache.invalidate(*parent->inode(), path_base(path));
+	return res;
 }
 
 Result VFS::link(const kstd::string& file, const kstd::string& link_name, const User& user, const kstd::Arc<LinkedInode>& base) {
@@ -245,7 +274,9 @@ Result VFS::link(const kstd::string& file, const kstd::string& link_name, const
 	if(old_file->inode()->fs.fsid() != new_file_parent->inode()->fs.fsid()) return Result(-EXDEV);
 
 	//Add the entry and return the result
-	return new_file_parent->inode()->add_entry(path_base(link_name), *old_file->inode());
+	auto res = new_file_parent->inode()->add_entry(path_base(link_name), *old_file->inode());
+	m_dentry_cache.invalidate(*new_file_parent->inode(), path_base(link_name));
+	return res;
 }
 
 Result VFS::symlink(const kstd::string& file, const kstd::string& link_name, const User& user, const kstd::Arc<LinkedInode>& base) {
@@ -266,6 +297,7 @@ Result VFS::symlink(const kstd::string& file, const kstd::string& link_name, con
 
 	//Create the symlink file
 	auto symlink_res = new_file_parent->inode()->create_entry(path_base(link_name), MODE_SYMLINK | 0777u, user.euid, user.egid);
+	m_dentry_cache.invalidate(*new_file_parent->inode(), path_base(link_name));
 	if(symlink_res.is_error()) return symlink_res.result();
 
 	//Write the symlink data
@@ -311,7 +343,11 @@ Result VFS::rmdir(kstd::string path, const User& user, const kstd::Arc<LinkedIno
 	if(!resolv.value()->inode()->metadata().is_directory()) return Result(-ENOTDIR);
 	if(!resolv.value()->inode()->metadata().can_write(user)) return Result(-EACCES);
 
-	return parent->inode()->remove_entry(path_base(path));
+	auto res = parent->inode()->remove_entry(path_base(path));
+	m_dentry_cache.invalidate(*parent->inode(), path_base(path));
+	if(!res.is_error())
+		m_dentry_cache.invalidate_dir(*resolv.value()->inode());
+	return res;
 }
 
 Result VFS::mkdir(kstd::string path, mode_t mode, const User& user, const kstd::Arc<LinkedInode> &base) {
@@ -332,6 +368,7 @@ Result VFS::mkdir(kstd::string path, mode_t mode, const User& user, const kstd::
 	//Make the directory
 	mode |= (unsigned) MODE_DIRECTORY;
 	auto res = parent->inode()->create_entry(path_base(path), mode, user.euid, user.egid);
+	m_dentry_cache.invalidate(*parent->inode(), path_base(path));
 	if(res.is_error()) return res.result();
 
 	return Result(SUCCESS);
@@ -343,7 +380,7 @@ Result VFS::truncate(const kstd::string& path, off_t length, const User& user, c
 	if(ino_or_err.is_error()) return ino_or_err.result();
 	if(ino_or_err.value()->inode()->metadata().is_directory()) return Result(-EISDIR);
 	if(!ino_or_err.value()->inode()->metadata().can_write(user)) return Result(-EACCES);
-	return ino_or_err.value()->inode()->truncate(length);
+	return ino_or_err.value()->inode()->truncate_cached(length);
 }
 
 Result VFS::chmod(const kstd::string& path, mode_t mode, const User& user, const kstd::Arc<LinkedInode>& base) {
@@ -384,42 +421,60 @@ kstd::Arc<LinkedInode> VFS::root_ref() {
 	return _root_ref;
 }
 
-kstd::string VFS::path_base(const kstd::string& path) {
-	size_t slash_index = path.find_last_of('/');
-	if(slash_index == -1) return path;
-	else if(slash_index == path.length() - 1) return "";
-	else return path.substr(slash_index, path.length() - slash_index);
+kstd::string VFS::path_base(kstd::string_view path) {
+	size_t slash_index = path.rfind('/');
+	if(slash_index == -1) return kstd::string(path);
+	return kstd::string(path.substr(slash_index + 1));
 }
 
-kstd::string VFS::path_minus_base(const kstd::string &path) {
-	size_t slash_index = path.find_last_of('/');
+kstd::string VFS::path_minus_base(kstd::string_view path) {
+	//Keep the slash, so that the base of "/file" is still "/"
+	size_t slash_index = path.rfind('/');
 	if(slash_index == -1) return "";
-	else return path.substr(0, slash_index);
+	return kstd::string(path.substr(0, slash_index + 1));
+}
+
+static inline uint64_t mount_key(Filesystem& fs, ino_t id) {
+	return ((uint64_t) fs.fsid() << 32) | id;
 }
 
 Result VFS::mount(Filesystem* fs, const kstd::Arc<LinkedInode>& mountpoint) {
 	if(!mountpoint->inode()->metadata().is_directory()) return Result(-ENOTDIR);
 
-	for(size_t i = 0; i < mounts.size(); i++) {
-		if(mounts[i].guest_fs()->fsid() == fs->fsid())
+	auto host_inode = mountpoint->inode();
+	WRITE_LOCK(m_mounts_lock);
+	if(!find_mount(host_inode->fs, host_inode->id).is_error())
+		return Result(-EBUSY); //Directory already used as mount point
+	for(auto& pair : m_mounts) {
+		if(pair.second.guest_fs()->fsid() == fs->fsid())
 			return Result(-EBUSY); //Filesystem already mounted
-		auto host_inode = mounts[i].host_inode()->inode();
-		if(host_inode->fs.fsid() == mountpoint->inode()->fs.fsid() && host_inode->id == mountpoint->inode()->id)
-			return Result(-EBUSY); //Directory already used as mount point
 	}
 
-	mounts.push_back(Mount(fs, mountpoint));
+	m_mounts[mount_key(host_inode->fs, host_inode->id)] = Mount(fs, mountpoint);
+	host_inode->mark_mountpoint();
+
+	//Lookups of the mountpoint were cached as the directory underneath it
+	m_dentry_cache.invalidate_all();
 	return Result(SUCCESS);
 }
 
 ResultRet<VFS::Mount> VFS::get_mount(const kstd::Arc<LinkedInode>& inode) {
-	for(size_t i = 0; i < mounts.size(); i++) {
-		auto m_inode = mounts[i].host_inode()->inode();
-		if(m_inode->fs.fsid() == inode->inode()->fs.fsid() && m_inode->id == inode->inode()->id)
-			return mounts[i];
-	}
+	return get_mount(*inode->inode());
+}
 
-	return Result(-ENOENT);
+ResultRet<VFS::Mount> VFS::get_mount(Inode& inode) {
+	//This is called for every name looked up, and almost nothing is a mountpoint
+	if(inode.fs.has_unique_inodes() && !inode.is_mountpoint())
+		return Result(-ENOENT);
+	READ_LOCK(m_mounts_lock);
+	return find_mount(inode.fs, inode.id);
+}
+
+ResultRet<VFS::Mount> VFS::find_mount(Filesystem& fs, ino_t id) {
+	auto mount = m_mounts.get(mount_key(fs, id));
+	if(!mount)
+		return Result(-ENOENT);
+	return *mount;
 }
 
 Result VFS::access(kstd::string pathname, int mode, const User& user, const kstd::Arc<LinkedInode>& base) {
@@ -444,6 +499,13 @@ Result VFS::access(kstd::string pathname, int mode, const User& user, const kstd
 	return Result(SUCCESS);
 }
 
+kstd::vector<VFS::Mount> VFS::get_mounts() {
+	READ_LOCK(m_mounts_lock);
+	kstd::vector<Mount> ret;
+	for(auto& pair : m_mounts)
+		ret.push_back(pair.second);
+	return ret;
+}
 
 /* * * * * * * *
  * Mount Class *
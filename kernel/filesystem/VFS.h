@@ -22,12 +22,15 @@
 #include <kernel/kstd/Arc.h>
 #include <kernel/kstd/unix_types.h>
 #include <kernel/kstd/vector.hpp>
+#include <kernel/kstd/unordered_map.hpp>
 #include <kernel/Result.hpp>
 #include <kernel/kstd/string.h>
 #include <kernel/User.h>
 #include "FileDescriptor.h"
 #include "LinkedInode.h"
 #include "Inode.h"
+#include <kernel/tasking/RWLock.h>
+#include "DentryCache.h"
 
 #define O_INTERNAL_RETLINK 0x1000000
 #define VFS_RECURSION_LIMIT 5
@@ -51,7 +54,7 @@ public:
 	~VFS();
 	static VFS& inst();
 
-	ResultRet<kstd::Arc<LinkedInode>> resolve_path(kstd::string path, const kstd::Arc<LinkedInode>& base, const User& user, kstd::Arc<LinkedInode>* parent_storage = nullptr, int options = 0, int recursion_level = 0);
+	ResultRet<kstd::Arc<LinkedInode>> resolve_path(kstd::string_view path, const kstd::Arc<LinkedInode>& base, const User& user, kstd::Arc<LinkedInode>* parent_storage = nullptr, int options = 0, int recursion_level = 0);
 	ResultRet<kstd::Arc<FileDescriptor>> open(const kstd::string& path, int options, mode_t mode, const User& user, const kstd::Arc<LinkedInode>& base);
 	ResultRet<kstd::Arc<FileDescriptor>> create(const kstd::string& path, int options, mode_t mode, const User& user, const kstd::Arc<LinkedInode>& parent);
 	Result unlink(const kstd::string& path, const User& user, const kstd::Arc<LinkedInode>& base);
@@ -69,14 +72,26 @@ public:
 	bool mount_root(Filesystem* fs);
 	kstd::Arc<LinkedInode> root_ref();
 	ResultRet<Mount> get_mount(const kstd::Arc<LinkedInode>& inode);
+	ResultRet<Mount> get_mount(Inode& inode);
+	kstd::vector<Mount> get_mounts();
+	DentryCache& dentry_cache() { return m_dentry_cache; }
 
-	static kstd::string path_base(const kstd::string& path);
-	static kstd::string path_minus_base(const kstd::string& path);
+	static kstd::string path_base(kstd::string_view path);
+	static kstd::string path_minus_base(kstd::string_view path);
 
 private:
+	/** Finds an entry in a directory and follows any mount on top of it, using the dentry cache if possible. **/
+	ResultRet<kstd::Arc<Inode>> lookup(Inode& dir, kstd::string_view name);
+
 	kstd::Arc<Inode> _root_inode;
 	kstd::Arc<LinkedInode> _root_ref;
-	kstd::vector<Mount> mounts;
+	/** Finds the mount on an inode, if there is one. Called with m_mounts_lock held. **/
+	ResultRet<Mount> find_mount(Filesystem& fs, ino_t id);
+
+	/** The mounts, by the fsid and inode id of their mountpoints. **/
+	kstd::unordered_map<uint64_t, Mount> m_mounts;
+	RWLock m_mounts_lock;
+	DentryCache m_dentry_cache;
 	static VFS* instance;
 };
 
@@ -36,13 +36,35 @@
 #define EXT2_SYMLINK 0xA000
 #define EXT2_SOCKET 0xC000
 
+//The number of blocks allocated past the end of a regular file when it grows, so that later writes stay contiguous
+#define EXT2_PREALLOC_BLOCKS 8
+
 //inode flags
 #define EXT2_SYNCHRONOUS 0x8
 #define EXT2_IMMUTABLE 0x10
 #define EXT2_APPEND_ONLY 0x20
 #define EXT2_DUMP_EXCLUDE 0x40
+#define EXT2_INDEX 0x1000
 #define EXT2_JOURNAL_FILE 0x40000
 
+//Optional features
+#define EXT2_FEATURE_HAS_JOURNAL 0x4
+#define EXT2_FEATURE_DIR_INDEX 0x20
+
+//Required features
+#define EXT2_FEATURE_RECOVER 0x4 //The journal may need to be replayed before the filesystem is used
+
+//Superblock flags
+#define EXT2_FLAGS_UNSIGNED_HASH 0x2
+
+//Directory index hash versions
+#define EXT2_HASH_LEGACY 0
+#define EXT2_HASH_HALF_MD4 1
+#define EXT2_HASH_TEA 2
+#define EXT2_HASH_LEGACY_UNSIGNED 3
+#define EXT2_HASH_HALF_MD4_UNSIGNED 4
+#define EXT2_HASH_TEA_UNSIGNED 5
+
 #define EXT2_FT_UNKNOWN	0
 #define EXT2_FT_REG_FILE 1
 #define EXT2_FT_DIR	2
@@ -97,7 +119,11 @@ typedef struct __attribute__((packed)) ext2_superblock {
 	uint32_t journal_inode;
 	uint32_t journal_device;
 	uint32_t orphan_inode_head;
-	uint8_t extra[276];
+	uint32_t hash_seed[4];
+	uint8_t default_hash_version;
+	uint8_t extra[99];
+	uint32_t flags;
+	uint8_t extra2[156];
 } ext2_superblock;
 
 typedef struct __attribute__((packed)) ext2_block_group_descriptor {
@@ -116,3 +142,78 @@ typedef struct __attribute__((packed)) ext2_directory {
 	uint8_t name_length;
 	uint8_t type;
 } ext2_directory;
+
+//The size a directory entry with a name of a given length takes up on disk, since they're 4-byte aligned
+#define EXT2_DIRENT_SIZE(name_length) ((sizeof(ext2_directory) + (name_length) + 3) & ~3u)
+
+typedef struct __attribute__((packed)) ext2_dx_root_info {
+	uint32_t reserved;
+	uint8_t hash_version;
+	uint8_t info_length;
+	uint8_t indirect_levels;
+	uint8_t flags;
+} ext2_dx_root_info;
+
+typedef struct __attribute__((packed)) ext2_dx_countlimit {
+	uint16_t limit;
+	uint16_t count;
+} ext2_dx_countlimit;
+
+//The first entry of an index node has its countlimit where the hash would be
+typedef struct __attribute__((packed)) ext2_dx_entry {
+	uint32_t hash;
+	uint32_t block;
+} ext2_dx_entry;
+
+/*
+ * Journal (ext3/JBD format). Everything in the journal is big-endian.
+ */
+
+#define JBD_MAGIC 0xC03B3998
+
+//Journal block types
+#define JBD_DESCRIPTOR_BLOCK 1
+#define JBD_COMMIT_BLOCK 2
+#define JBD_SUPERBLOCK_V1 3
+#define JBD_SUPERBLOCK_V2 4
+#define JBD_REVOKE_BLOCK 5
+
+//Descriptor block tag flags
+#define JBD_FLAG_ESCAPE 0x1 //The block started with JBD_MAGIC, which was zeroed out in the journal
+#define JBD_FLAG_SAME_UUID 0x2 //The tag isn't followed by a UUID
+#define JBD_FLAG_DELETED 0x4
+#define JBD_FLAG_LAST_TAG 0x8
+
+//Journal features
+#define JBD_FEATURE_INCOMPAT_REVOKE 0x1
+
+typedef struct __attribute__((packed)) jbd_header {
+	uint32_t magic;
+	uint32_t type;
+	uint32_t sequence;
+} jbd_header;
+
+typedef struct __attribute__((packed)) jbd_superblock {
+	jbd_header header;
+	uint32_t block_size;
+	uint32_t max_length; //The number of blocks in the journal
+	uint32_t first; //The first block of the log
+	uint32_t sequence; //The transaction expected at start
+	uint32_t start; //Where the log starts, or 0 if there's nothing to replay
+	int32_t error;
+	//Version 2 fields
+	uint32_t feature_compat;
+	uint32_t feature_incompat;
+	uint32_t feature_ro_compat;
+	uint8_t uuid[16];
+} jbd_superblock;
+
+typedef struct __attribute__((packed)) jbd_block_tag {
+	uint32_t block;
+	uint32_t flags;
+} jbd_block_tag;
+
+typedef struct __attribute__((packed)) jbd_revoke_header {
+	jbd_header header;
+	uint32_t count; //The number of bytes of the block that are used, including the header
+} jbd_revoke_header;
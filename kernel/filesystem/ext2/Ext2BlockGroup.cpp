@@ -32,15 +32,13 @@ Ext2BlockGroup::Ext2BlockGroup(Ext2Filesystem* fs, uint32_t num): fs(fs), num(nu
 	num_directories = buf.num_directories;
 }
 
-void Ext2BlockGroup::write() {
-	ext2_block_group_descriptor buf;
-	buf.block_usage_bitmap = block_bitmap_block;
-	buf.inode_usage_bitmap = inode_bitmap_block;
-	buf.inode_table = inode_table_block;
-	buf.free_blocks = free_blocks;
-	buf.free_inodes = free_inodes;
-	buf.num_directories = num_directories;
-	fs->write_block_group_raw(num, &buf);
+void Ext2BlockGroup::fill_descriptor(ext2_block_group_descriptor& descriptor) {
+	descriptor.block_usage_bitmap = block_bitmap_block;
+	descriptor.inode_usage_bitmap = inode_bitmap_block;
+	descriptor.inode_table = inode_table_block;
+	descriptor.free_blocks = free_blocks;
+	descriptor.free_inodes = free_inodes;
+	descriptor.num_directories = num_directories;
 }
 
 uint32_t Ext2BlockGroup::first_block() {
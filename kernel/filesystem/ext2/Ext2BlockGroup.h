@@ -22,10 +22,12 @@
 #include <kernel/kstd/unix_types.h>
 
 class Ext2Filesystem;
+struct ext2_block_group_descriptor;
 class Ext2BlockGroup {
 public:
 	Ext2BlockGroup(Ext2Filesystem* fs, uint32_t num);
-	void write();
+	/** Copies the group's counts into its descriptor, to be written out with the rest of the descriptor table. **/
+	void fill_descriptor(ext2_block_group_descriptor& descriptor);
 	uint32_t first_block();
 
 	Ext2Filesystem* fs;
@@ -36,6 +38,12 @@ public:
 	uint16_t free_blocks;
 	uint16_t free_inodes;
 	uint16_t num_directories;
+	//Whether the counts have changed since the descriptor was last written out by Ext2Filesystem::write_metadata()
+	bool dirty = false;
+
+	//Nothing in the bitmaps before these is free, so searches for a free block or inode can start at them
+	uint32_t first_free_block = 0;
+	uint32_t first_free_inode = 0;
 };
 
 
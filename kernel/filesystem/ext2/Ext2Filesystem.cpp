@@ -20,6 +20,7 @@
 #include "Ext2Filesystem.h"
 #include "Ext2Inode.h"
 #include "Ext2BlockGroup.h"
+#include "Ext2Journal.h"
 #include <kernel/filesystem/FileDescriptor.h>
 #include <kernel/kstd/cstring.h>
 #include <kernel/kstd/KLog.h>
@@ -29,6 +30,7 @@ Ext2Filesystem::Ext2Filesystem(const kstd::Arc<FileDescriptor>& file) : FileBase
 }
 
 Ext2Filesystem::~Ext2Filesystem() {
+	delete _journal;
 	if(block_groups) {
 		for(uint32_t i = 0; i < num_block_groups; i++) {
 			if (block_groups[i]) delete block_groups[i];
@@ -48,6 +50,14 @@ void Ext2Filesystem::init() {
 	inodes_per_block = block_size()/superblock.inode_size;
 	block_pointers_per_block = block_size() / sizeof(uint32_t);
 	block_groups = new Ext2BlockGroup*[num_block_groups] {nullptr};
+
+	//The journal has to be replayed before anything else is read in, since what's on disk may be out of date until then
+	if(superblock.optional_features & EXT2_FEATURE_HAS_JOURNAL)
+		load_journal();
+
+	//Read every block group descriptor up front, so allocations can skip full groups without going to the disk
+	for(uint32_t i = 0; i < num_block_groups; i++)
+		get_block_group(i);
 }
 
 bool Ext2Filesystem::probe(FileDescriptor& file){
@@ -57,6 +67,36 @@ bool Ext2Filesystem::probe(FileDescriptor& file){
 	return ((ext2_superblock *)buf)->signature == EXT2_SIGNATURE;
 }
 
+void Ext2Filesystem::load_journal() {
+	auto journal_res = Ext2Journal::load(*this);
+	if(journal_res.is_error()) {
+		KLog::err("ext2", "Couldn't load the journal (%d), metadata changes won't be journaled", journal_res.code());
+		return;
+	}
+	auto* journal = journal_res.value();
+
+	auto replay_res = journal->recover();
+	if(replay_res.is_error()) {
+		KLog::err("ext2", "Error %d replaying the journal, metadata changes won't be journaled", replay_res.code());
+		delete journal;
+		return;
+	}
+	if(replay_res.value())
+		KLog::info("ext2", "Replayed %d blocks from the journal", replay_res.value());
+
+	//Reading the journal in needed a block group, which may have changed since
+	for(uint32_t i = 0; i < num_block_groups; i++) {
+		delete block_groups[i];
+		block_groups[i] = nullptr;
+	}
+	read_superblock(&superblock);
+
+	//Other implementations will replay the journal if we don't get to unmount cleanly
+	superblock.required_features |= EXT2_FEATURE_RECOVER;
+	write_superblock();
+	_journal = journal;
+}
+
 void Ext2Filesystem::read_superblock(ext2_superblock *sb){
 	read_logical_block(2, (uint8_t*)sb);
 	if(sb->version_major < 1){ //If major version is less than 1, then use defaults for stuff
@@ -66,21 +106,57 @@ void Ext2Filesystem::read_superblock(ext2_superblock *sb){
 }
 
 void Ext2Filesystem::write_superblock() {
-	write_logical_block(2, (uint8_t*)&superblock);
+	if(!_journal) {
+		write_logical_block(2, (uint8_t*)&superblock);
+		return;
+	}
+
+	//The journal logs whole blocks, so patch the superblock into the block it's in. Only the part of it that we read in
+	//is written back.
+	uint8_t block_buf[block_size()];
+	uint32_t block = 1024 / block_size();
+	if(read_metadata_block(block, block_buf).is_error())
+		return;
+	memcpy(block_buf + 1024 % block_size(), &superblock, logical_block_size());
+	write_metadata_block(block, block_buf);
 }
 
 Inode* Ext2Filesystem::get_inode_rawptr(ino_t id) {
-	return static_cast<Inode *>(new Ext2Inode(*this, id));
+	if(!id || id > superblock.total_inodes)
+		return nullptr;
+
+	//Read the block of the inode table that the inode is in
+	uint32_t index = (id - 1) % superblock.inodes_per_group;
+	Ext2BlockGroup* bg = get_block_group((id - 1) / superblock.inodes_per_group);
+	uint8_t block_buf[block_size()];
+	if(read_metadata_block(bg->inode_table_block + index / inodes_per_block, block_buf).is_error())
+		return nullptr;
+
+	//The entries in a directory were usually made around the same time and sit next to each other in the table, so
+	//cache the rest of the inodes in the block too. Listing a directory will then only read each block of it once.
+	ino_t first_id = id - index % inodes_per_block;
+	for(uint32_t i = 0; i < inodes_per_block; i++) {
+		ino_t sibling_id = first_id + i;
+		auto& raw = *(Ext2Inode::Raw*) (block_buf + i * superblock.inode_size);
+		if(sibling_id == id || sibling_id > superblock.total_inodes || !raw.mode || !raw.hard_links)
+			continue;
+		if(!is_inode_cached(sibling_id))
+			cache_prefetched_inode(kstd::Arc<Inode>(new Ext2Inode(*this, sibling_id, raw)));
+	}
+
+	return new Ext2Inode(*this, id, *(Ext2Inode::Raw*) (block_buf + (index % inodes_per_block) * superblock.inode_size));
 }
 
 ResultRet<kstd::Arc<Ext2Inode>> Ext2Filesystem::allocate_inode(mode_t mode, uid_t uid, gid_t gid, size_t size, ino_t parent) {
+	EXT2_JOURNAL_HANDLE(*this);
 	ext2lock.acquire();
 
-	//Find a block group to house the inode
+	//Find a block group to house the inode, starting with the parent's so that the inode ends up near it
+	uint32_t parent_bg = parent ? ((parent - 1) / superblock.inodes_per_group) % num_block_groups : 0;
 	uint32_t bg = -1;
 	for(size_t i = 0; i < num_block_groups; i++) {
-		if(get_block_group(i)->free_inodes > 0) {
-			bg = i;
+		if(get_block_group((parent_bg + i) % num_block_groups)->free_inodes > 0) {
+			bg = (parent_bg + i) % num_block_groups;
 			break;
 		}
 	}
@@ -94,7 +170,7 @@ ResultRet<kstd::Arc<Ext2Inode>> Ext2Filesystem::allocate_inode(mode_t mode, uid_
 	//Read the inode bitmap
 	Ext2BlockGroup& group = *get_block_group(bg);
 	uint8_t inode_bitmap[block_size()];
-	Result rb_res = read_block(group.inode_bitmap_block, inode_bitmap);
+	Result rb_res = read_metadata_block(group.inode_bitmap_block, inode_bitmap);
 	if(rb_res.is_error()) {
 		KLog::err("ext2", "I/O error reading inode bitmap block for block group %d!", bg);
 		ext2lock.release();
@@ -103,21 +179,22 @@ ResultRet<kstd::Arc<Ext2Inode>> Ext2Filesystem::allocate_inode(mode_t mode, uid_
 
 	//Find a free inode
 	uint32_t inode_index = 0;
-	for(uint32_t i = 0; i < superblock.inodes_per_group; i++) {
+	for(uint32_t i = group.first_free_inode; i < superblock.inodes_per_group; i++) {
 		if(!get_bitmap_bit(inode_bitmap, i)) {
 			inode_index = i + 1; //Inodes start at 1
 			set_bitmap_bit(inode_bitmap, i, true);
+			group.first_free_inode = i + 1;
 			break;
 		}
 	}
 
 	//Write the inode bitmap
-	write_block(group.inode_bitmap_block, inode_bitmap);
+	write_metadata_block(group.inode_bitmap_block, inode_bitmap);
 
 	//Didn't find a free inode, so the free inode count was wrong
 	if(inode_index == 0) {
 		group.free_inodes = 0;
-		group.write();
+		group.dirty = true;
 		KLog::warn("ext2", "Free inode count inconsistency in block group %d!", bg);
 		ext2lock.release();
 		return Result(-ENOSPC);
@@ -126,13 +203,13 @@ ResultRet<kstd::Arc<Ext2Inode>> Ext2Filesystem::allocate_inode(mode_t mode, uid_
 	//Update the blockgroup
 	group.free_inodes--;
 	if(IS_DIR(mode)) group.num_directories++;
-	group.write();
+	group.dirty = true;
 
 	//Allocate the needed blocks for storage
 	uint32_t num_blocks = (size + block_size() - 1) / block_size();
 	kstd::vector<uint32_t> blocks(0);
 	if(num_blocks) {
-		auto blocks_or_err = allocate_blocks(num_blocks);
+		auto blocks_or_err = allocate_blocks(num_blocks, true, group.first_block());
 		if (blocks_or_err.is_error()) return blocks_or_err.result();
 		blocks = blocks_or_err.value();
 	}
@@ -150,7 +227,7 @@ ResultRet<kstd::Arc<Ext2Inode>> Ext2Filesystem::allocate_inode(mode_t mode, uid_
 
 	//Update the superblock
 	superblock.free_inodes--;
-	write_superblock();
+	superblock_dirty = true;
 
 	//Add it to the cache and return!
 	add_cached_inode(inode);
@@ -159,12 +236,13 @@ ResultRet<kstd::Arc<Ext2Inode>> Ext2Filesystem::allocate_inode(mode_t mode, uid_
 }
 
 Result Ext2Filesystem::free_inode(Ext2Inode& ino) {
+	EXT2_JOURNAL_HANDLE(*this);
 	ext2lock.acquire();
 
 	//Update the inode bitmap and free inodes in the block group
 	Ext2BlockGroup* bg = get_block_group(ino.block_group());
 	uint8_t block_buf[block_size()];
-	Result res = read_block(bg->inode_bitmap_block, block_buf);
+	Result res = read_metadata_block(bg->inode_bitmap_block, block_buf);
 	if(res.is_error()) {
 		KLog::err("ext2", "Error while reading bitmap for block group %d!", ino.block_group());
 		ext2lock.release();
@@ -172,7 +250,9 @@ Result Ext2Filesystem::free_inode(Ext2Inode& ino) {
 	}
 
 	set_bitmap_bit(block_buf, ino.index(), false);
-	res = write_block(bg->inode_bitmap_block, block_buf);
+	if(ino.index() < bg->first_free_inode)
+		bg->first_free_inode = ino.index();
+	res = write_metadata_block(bg->inode_bitmap_block, block_buf);
 	if(res.is_error()) {
 		KLog::err("ext2", "Error while writing bitmap for block group %d!", ino.block_group());
 		ext2lock.release();
@@ -185,19 +265,19 @@ Result Ext2Filesystem::free_inode(Ext2Inode& ino) {
 	//Update blockgroup
 	bg->free_inodes++;
 	if(ino.metadata().is_directory()) bg->num_directories--;
-	bg->write();
+	bg->dirty = true;
 
 	//Set (fake) inode dtime
 	//TODO: Real inode dtime
-	read_block(bg->inode_table_block + ino.block(), block_buf);
+	read_metadata_block(bg->inode_table_block + ino.block(), block_buf);
 	auto* inodeRaw = (Ext2Inode::Raw*) block_buf;
 	inodeRaw += ino.index() % inodes_per_block;
 	inodeRaw->dtime = 0x42069;
-	write_block(bg->inode_table_block + ino.block(), block_buf);
+	write_metadata_block(bg->inode_table_block + ino.block(), block_buf);
 
 	//Update superblock
 	superblock.free_inodes++;
-	write_superblock();
+	superblock_dirty = true;
 
 	ino.mark_deleted();
 	ext2lock.release();
@@ -215,48 +295,109 @@ ino_t Ext2Filesystem::root_inode_id() {
 
 Result Ext2Filesystem::read_block_group_raw(uint32_t block_group, ext2_block_group_descriptor* buffer) {
 	uint8_t block_buf[block_size()];
-	auto ret = read_block(2 + (block_group * sizeof(ext2_block_group_descriptor)) / block_size(), block_buf);
+	auto ret = read_metadata_block(2 + (block_group * sizeof(ext2_block_group_descriptor)) / block_size(), block_buf);
 	auto* d = (ext2_block_group_descriptor*) block_buf;
 	d += block_group % (block_size() / sizeof(ext2_block_group_descriptor));
 	memcpy((void*) buffer, d, sizeof(ext2_block_group_descriptor));
 	return ret;
 }
 
-Result Ext2Filesystem::write_block_group_raw(uint32_t block_group, const ext2_block_group_descriptor *buffer) {
+Result Ext2Filesystem::read_metadata_block(uint32_t block, uint8_t* buffer) {
+	if(_journal && _journal->read_block(block, buffer))
+		return Result(SUCCESS);
+	return read_block(block, buffer);
+}
+
+Result Ext2Filesystem::write_metadata_block(uint32_t block, const uint8_t* buffer) {
+	if(!_journal)
+		return write_block(block, buffer);
+	_journal->write_block(block, buffer);
+	return Result(SUCCESS);
+}
+
+Result Ext2Filesystem::write_metadata() {
+	//With a journal, the free counts are written as part of each commit so they always match the bitmaps in it
+	if(_journal)
+		return _journal->commit();
+	return write_free_counts();
+}
+
+Result Ext2Filesystem::write_free_counts() {
+	LOCK(ext2lock);
+	if(!block_groups)
+		return Result(SUCCESS); //Not initialized yet
+
+	//The free counts are only kept up to date in memory while blocks and inodes are allocated and freed, and written
+	//out here. Several descriptors share each block of the descriptor table, so each block is only written once.
+	size_t descriptors_per_block = block_size() / sizeof(ext2_block_group_descriptor);
 	uint8_t block_buf[block_size()];
-	auto res = read_block(2 + (block_group * sizeof(ext2_block_group_descriptor)) / block_size(), block_buf);
-	if(res.is_error())
-		return res;
+	Result result = Result(SUCCESS);
+	for(uint32_t first_group = 0; first_group < num_block_groups; first_group += descriptors_per_block) {
+		uint32_t end_group = min(first_group + descriptors_per_block, num_block_groups);
+		bool dirty = false;
+		for(uint32_t group = first_group; group < end_group; group++)
+			dirty |= block_groups[group] && block_groups[group]->dirty;
+		if(!dirty)
+			continue;
+
+		size_t table_block = 2 + first_group / descriptors_per_block;
+		auto res = read_metadata_block(table_block, block_buf);
+		if(res.is_error()) {
+			result = res;
+			continue;
+		}
+		auto* descriptors = (ext2_block_group_descriptor*) block_buf;
+		for(uint32_t group = first_group; group < end_group; group++) {
+			if(!block_groups[group] || !block_groups[group]->dirty)
+				continue;
+			block_groups[group]->fill_descriptor(descriptors[group - first_group]);
+			block_groups[group]->dirty = false;
+		}
+		res = write_metadata_block(table_block, block_buf);
+		if(res.is_error())
+			result = res;
+	}
 
-	auto* d = (ext2_block_group_descriptor*) block_buf;
-	d += block_group % (block_size() / sizeof(ext2_block_group_descriptor));
-	memcpy(d, buffer, sizeof(ext2_block_group_descriptor));
-	auto write_successful = write_block(2 + (block_group * sizeof(ext2_block_group_descriptor)) / block_size(), block_buf);
+	if(superblock_dirty) {
+		superblock_dirty = false;
+		write_superblock();
+	}
 
-	return write_successful;
+	return result;
 }
 
-ResultRet<kstd::vector<uint32_t>> Ext2Filesystem::allocate_blocks_in_group(Ext2BlockGroup* group, uint32_t num_blocks, bool zero_out) {
+ResultRet<kstd::vector<uint32_t>> Ext2Filesystem::allocate_blocks_in_group(Ext2BlockGroup* group, uint32_t num_blocks, bool zero_out, uint32_t goal) {
 	if(group->free_blocks < num_blocks) return Result(-ENOSPC);
 	if(num_blocks == 0) return kstd::vector<uint32_t>(0);
 
 	LOCK(ext2lock);
 	uint8_t block_buf[block_size()];
 
-	Result res = read_block(group->block_bitmap_block, block_buf);
+	Result res = read_metadata_block(group->block_bitmap_block, block_buf);
 	if(res.is_error()) {
 		KLog::err("ext2", "Error %d reading block bitmap for group %d", res.code(), group->num);
 		return res;
 	}
 
-
 	uint32_t num_allocated = 0;
 	kstd::vector<uint32_t> ret;
 	ret.reserve(num_blocks);
 
-	for(size_t bi = 0; bi < superblock.blocks_per_group; bi++) {
+	//Start looking at the goal if it's in this group, and wrap around to the first possibly free block afterwards
+	uint32_t wrap_start = group->first_free_block;
+	uint32_t search_start = wrap_start;
+	if(goal >= group->first_block() && goal - group->first_block() < superblock.blocks_per_group)
+		search_start = max(goal - group->first_block(), wrap_start);
+
+	for(size_t i = 0; i < superblock.blocks_per_group; i++) {
+		size_t bi = search_start + i;
+		if(bi >= superblock.blocks_per_group) {
+			bi = wrap_start + (bi - superblock.blocks_per_group);
+			if(bi >= search_start) break;
+		}
 		if(!get_bitmap_bit(block_buf, bi)) {
 			set_bitmap_bit(block_buf, bi, true);
+			if(bi == group->first_free_block) group->first_free_block = bi + 1;
 			ret.push_back(bi + group->first_block());
 			if(zero_out) zero_block(bi + group->first_block());
 			group->free_blocks--;
@@ -270,9 +411,9 @@ ResultRet<kstd::vector<uint32_t>> Ext2Filesystem::allocate_blocks_in_group(Ext2B
 		group->free_blocks = 0;
 	}
 
-	write_superblock();
-	group->write();
-	res = write_block(group->block_bitmap_block, block_buf);
+	superblock_dirty = true;
+	group->dirty = true;
+	res = write_metadata_block(group->block_bitmap_block, block_buf);
 	if(res.is_error()) {
 		KLog::err("ext2", "Error writing block bitmap for block group %d!", group->num);
 		return res;
@@ -281,69 +422,65 @@ ResultRet<kstd::vector<uint32_t>> Ext2Filesystem::allocate_blocks_in_group(Ext2B
 	return kstd::move(ret);
 }
 
-ResultRet<kstd::vector<uint32_t>> Ext2Filesystem::allocate_blocks(uint32_t num_blocks, bool zero_out) {
+ResultRet<kstd::vector<uint32_t>> Ext2Filesystem::allocate_blocks(uint32_t num_blocks, bool zero_out, uint32_t goal) {
+	EXT2_JOURNAL_HANDLE(*this);
 	LOCK(ext2lock);
 	if(num_blocks == 0) {
 		KLog::warn("ext2", "Tried to allocate zero ext2 blocks!");
 		return Result(-EINVAL);
 	}
 
-	//First, find a block group that can fit all the blocks, or at least the most spacious block group
-	Ext2BlockGroup* target_bg = nullptr;
-	Ext2BlockGroup* most_spacious_bg = nullptr;
+	//Groups are searched starting at the one the goal is in. Full groups are skipped based on their free block counts.
+	uint32_t goal_bg = goal ? block_group_of(goal) % num_block_groups : 0;
 
-	for(uint32_t bgi = 0; bgi < num_block_groups; bgi++) {
-		Ext2BlockGroup *bg = get_block_group(bgi);
-		if (!bg) {
-			KLog::err("ext2", "Error getting block group %d!", bgi);
-			break;
+	//First, try to find a block group that can fit all of the blocks
+	for(uint32_t i = 0; i < num_block_groups; i++) {
+		Ext2BlockGroup* bg = get_block_group((goal_bg + i) % num_block_groups);
+		if(!bg) {
+			KLog::err("ext2", "Error getting block group %d!", (goal_bg + i) % num_block_groups);
+			return Result(-EIO);
 		}
-		if (bg->free_blocks >= num_blocks) {
-			target_bg = bg;
-			break;
-		}
-		if (!most_spacious_bg || bg->free_blocks > most_spacious_bg->free_blocks) most_spacious_bg = bg;
+		if(bg->free_blocks >= num_blocks)
+			return kstd::move(allocate_blocks_in_group(bg, num_blocks, zero_out, goal));
 	}
 
-	if(target_bg) {
-		//We found a block group that will house all of the blocks we need to allocate
-		return kstd::move(allocate_blocks_in_group(target_bg, num_blocks, zero_out));
-	} else {
-		//If we couldn't find one bg to fit all the blocks, allocate the blocks in multiple groups
-		kstd::vector<uint32_t> ret;
-		ret.reserve(num_blocks);
-		while(num_blocks) {
-			//Find the most spacious bg
-			most_spacious_bg = nullptr;
-			for(uint32_t bgi = 0; bgi < num_block_groups; bgi++) {
-				Ext2BlockGroup *bg = get_block_group(bgi);
-				if(!bg) continue; //This error would have been printed out above presumably
-				if (!most_spacious_bg || bg->free_blocks > most_spacious_bg->free_blocks) most_spacious_bg = bg;
-			}
-
-			//If the most spacious bg has no free blocks, return ENOSPC
-			if(most_spacious_bg->free_blocks == 0) return Result(-ENOSPC);
-
-			//Allocate the needed amount of blocks in that group
-			auto res = allocate_blocks_in_group(most_spacious_bg, min(most_spacious_bg->free_blocks, num_blocks), zero_out);
-			if(res.is_error()) return res.result();
-
-			//Push the blocks allocated into the return vector
-			num_blocks -= res.value().size();
-			for(size_t i = 0; i < res.value().size(); i++) ret.push_back(res.value()[i]);
+	//If we couldn't find one bg to fit all the blocks, spread the blocks out over the groups after the goal
+	kstd::vector<uint32_t> ret;
+	ret.reserve(num_blocks);
+	for(uint32_t i = 0; i < num_block_groups && num_blocks; i++) {
+		Ext2BlockGroup* bg = get_block_group((goal_bg + i) % num_block_groups);
+		if(!bg->free_blocks)
+			continue;
+
+		auto res = allocate_blocks_in_group(bg, min(bg->free_blocks, num_blocks), zero_out, goal);
+		if(res.is_error()) {
+			free_blocks(ret);
+			return res.result();
 		}
-		return kstd::move(ret);
+
+		//Push the blocks allocated into the return vector
+		num_blocks -= res.value().size();
+		for(size_t j = 0; j < res.value().size(); j++) ret.push_back(res.value()[j]);
+	}
+
+	//If we still need more blocks, there isn't enough space
+	if(num_blocks) {
+		free_blocks(ret);
+		return Result(-ENOSPC);
 	}
+
+	return kstd::move(ret);
 }
 
-uint32_t Ext2Filesystem::allocate_block(bool zero_out) {
-	auto ret_or_err = allocate_blocks(1, zero_out);
+uint32_t Ext2Filesystem::allocate_block(bool zero_out, uint32_t goal) {
+	auto ret_or_err = allocate_blocks(1, zero_out, goal);
 	if(ret_or_err.is_error()) return 0;
 	if(ret_or_err.value().empty()) return 0;
 	return ret_or_err.value().at(0);
 }
 
 void Ext2Filesystem::free_block(uint32_t block) {
+	EXT2_JOURNAL_HANDLE(*this);
 	LOCK(ext2lock);
 
 	if(block == 0) {
@@ -351,22 +488,30 @@ void Ext2Filesystem::free_block(uint32_t block) {
 		return;
 	}
 
-	uint32_t group_index = (block - 1) / superblock.blocks_per_group;
+	uint32_t group_index = block_group_of(block);
 	Ext2BlockGroup* bg = get_block_group(group_index);
 	if(!bg) {
 		KLog::err("ext2", "Error getting block group %d!", group_index);
 		return;
 	}
 
+	//Whatever was written to it as metadata shouldn't end up written over what it's used for next
+	if(_journal)
+		_journal->forget_block(block);
+
 	//Update blockgroup
 	uint8_t block_buf[block_size()];
-	read_block(bg->block_bitmap_block, block_buf);
+	read_metadata_block(bg->block_bitmap_block, block_buf);
 	set_bitmap_bit(block_buf, block - bg->first_block(), false);
-	write_block(bg->block_bitmap_block, block_buf);
+	write_metadata_block(bg->block_bitmap_block, block_buf);
 	bg->free_blocks++;
+	bg->dirty = true;
+	if(block - bg->first_block() < bg->first_free_block)
+		bg->first_free_block = block - bg->first_block();
 
 	//Update superblock
 	superblock.free_blocks++;
+	superblock_dirty = true;
 }
 
 void Ext2Filesystem::free_blocks(kstd::vector<uint32_t>& blocks) {
@@ -381,4 +526,8 @@ Ext2BlockGroup *Ext2Filesystem::get_block_group(uint32_t block_group) {
 	return block_groups[block_group];
 }
 
+uint32_t Ext2Filesystem::block_group_of(uint32_t block) {
+	return (block - (block_size() == 1024 ? 1 : 0)) / superblock.blocks_per_group;
+}
+
 
@@ -28,6 +28,7 @@
 class Ext2Filesystem;
 class Ext2BlockGroup;
 class Ext2Inode;
+class Ext2Journal;
 class Ext2Filesystem: public FileBasedFilesystem {
 public:
 	Ext2Filesystem(const kstd::Arc<FileDescriptor>& file);
@@ -46,15 +47,34 @@ public:
 	void write_superblock();
 
 	//Block stuff
-	ResultRet<kstd::vector<uint32_t>> allocate_blocks_in_group(Ext2BlockGroup* group, uint32_t num_blocks, bool zero_out);
-	ResultRet<kstd::vector<uint32_t>> allocate_blocks(uint32_t num_blocks, bool zero_out = true);
-	uint32_t allocate_block(bool zero_out = true);
+	/**
+	 * Allocates blocks in a block group. If the goal block is in the group, the search for free blocks starts at it.
+	 */
+	ResultRet<kstd::vector<uint32_t>> allocate_blocks_in_group(Ext2BlockGroup* group, uint32_t num_blocks, bool zero_out, uint32_t goal = 0);
+	/**
+	 * Allocates blocks, as close after the goal block as possible. Block groups are searched starting at the goal's group,
+	 * so a goal of zero means the blocks can go anywhere.
+	 */
+	ResultRet<kstd::vector<uint32_t>> allocate_blocks(uint32_t num_blocks, bool zero_out = true, uint32_t goal = 0);
+	uint32_t allocate_block(bool zero_out = true, uint32_t goal = 0);
 
 	void free_block(uint32_t block);
 	void free_blocks(kstd::vector<uint32_t>& blocks);
 	Ext2BlockGroup* get_block_group(uint32_t block_group);
+	uint32_t block_group_of(uint32_t block);
 	Result read_block_group_raw(uint32_t block_group, ext2_block_group_descriptor* buffer);
-	Result write_block_group_raw(uint32_t block_group, const ext2_block_group_descriptor* buffer);
+
+	//Metadata
+	/** The filesystem's journal, or nullptr if it doesn't have one that can be used. **/
+	Ext2Journal* journal() { return _journal; }
+	/** Reads a metadata block, including changes to it that are still in the journal's transactions. **/
+	Result read_metadata_block(uint32_t block, uint8_t* buffer);
+	/** Writes a metadata block. With a journal, it's kept in the running transaction until it's committed. **/
+	Result write_metadata_block(uint32_t block, const uint8_t* buffer);
+
+	//FileBasedFilesystem
+	/** Commits the journal if there is one, otherwise writes out the changed free counts. **/
+	Result write_metadata() override;
 
 	//Misc
 	static bool probe(FileDescriptor& dev);
@@ -81,7 +101,17 @@ public:
 	size_t block_pointers_per_block;
 
 private:
+	friend class Ext2Journal;
+
+	/** Loads the journal and replays anything in it. **/
+	void load_journal();
+	/** Writes out the superblock and block group descriptors if their free counts have changed. **/
+	Result write_free_counts();
+
 	SpinLock ext2lock;
+	Ext2Journal* _journal = nullptr;
+	//Whether the superblock's free counts have changed since it was last written out by write_free_counts()
+	bool superblock_dirty = false;
 
 	//Block stuff
 	Ext2BlockGroup** block_groups = nullptr;
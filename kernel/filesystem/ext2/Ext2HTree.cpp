@@ -0,0 +1,597 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Ext2HTree.h"
+#include "Ext2Filesystem.h"
+#include <kernel/kstd/cstring.h>
+
+//Index node entries only use the lower 28 bits of the block number
+#define DX_BLOCK(entry) ((entry).block & 0x0FFFFFFFu)
+
+Ext2HTree::Ext2HTree(Ext2Inode& dir): m_dir(dir), m_fs(dir.ext2fs()), m_block_size(dir.ext2fs().block_size()) {}
+
+Result Ext2HTree::find(kstd::string_view name, Ext2Inode::DirEntryLocation& location) {
+	auto res = read_root();
+	if(res.is_error())
+		return res;
+
+	uint32_t hash = name_hash(name);
+	Frame frames[EXT2_HTREE_MAX_DEPTH];
+	uint32_t leaf;
+	res = probe(hash, frames, leaf);
+	if(res.is_error())
+		return res;
+
+	uint8_t block_buf[m_block_size];
+	do {
+		res = read_block(leaf, block_buf);
+		if(res.is_error())
+			return res;
+		if(m_dir.find_entry_in_block(block_buf, name, location)) {
+			location.block_index = leaf;
+			return Result(SUCCESS);
+		}
+	} while(next_leaf(hash, frames, leaf));
+
+	return Result(-ENOENT);
+}
+
+Result Ext2HTree::insert(const kstd::string& name, ino_t inode, uint8_t type) {
+	auto res = read_root();
+	if(res.is_error())
+		return res;
+
+	uint32_t hash = name_hash(name);
+	Frame frames[EXT2_HTREE_MAX_DEPTH];
+	uint32_t leaf;
+	res = probe(hash, frames, leaf);
+	if(res.is_error())
+		return res;
+
+	//If the leaf has room, we're done
+	uint8_t leaf_buf[m_block_size];
+	res = read_block(leaf, leaf_buf);
+	if(res.is_error())
+		return res;
+	if(m_dir.insert_entry_in_block(leaf_buf, inode, type, name))
+		return write_block(leaf, leaf_buf);
+
+	//Otherwise, the leaf has to be split in two. First, make sure the index has room for the new leaf.
+	res = make_room(frames);
+	if(res.is_error())
+		return res;
+
+	uint8_t upper_buf[m_block_size];
+	uint32_t split_hash;
+	res = split_entries(leaf_buf, leaf_buf, upper_buf, split_hash);
+	if(res.is_error())
+		return res;
+
+	auto new_leaf_or_err = m_dir.append_directory_block();
+	if(new_leaf_or_err.is_error())
+		return new_leaf_or_err.result();
+	uint32_t new_leaf = new_leaf_or_err.value();
+
+	res = write_block(new_leaf, upper_buf);
+	if(res.is_error())
+		return res;
+	res = write_block(leaf, leaf_buf);
+	if(res.is_error())
+		return res;
+	res = insert_index_entry(frames[m_levels], split_hash, new_leaf);
+	if(res.is_error())
+		return res;
+
+	//Then, put the new entry in whichever half its hash belongs in
+	uint32_t target_leaf = hash >= (split_hash & ~1u) ? new_leaf : leaf;
+	uint8_t* target_buf = target_leaf == new_leaf ? upper_buf : leaf_buf;
+	if(!m_dir.insert_entry_in_block(target_buf, inode, type, name))
+		return Result(-ENOSPC);
+	return write_block(target_leaf, target_buf);
+}
+
+Result Ext2HTree::create(Ext2Inode& dir, const kstd::string& name, ino_t inode, uint8_t type) {
+	Ext2HTree htree(dir);
+	auto& superblock = htree.m_fs.superblock;
+	const size_t block_size = htree.m_block_size;
+
+	uint8_t root_buf[block_size];
+	auto res = htree.read_block(0, root_buf);
+	if(res.is_error())
+		return res;
+
+	//The directory has to start with . and .., since those stay in the root of the index
+	auto* dot = (ext2_directory*) root_buf;
+	if(dot->size != EXT2_DIRENT_SIZE(1) || dot->name_length != 1 || *((char*) (dot + 1)) != '.')
+		return Result(-EINVAL);
+	auto* dotdot = (ext2_directory*) (root_buf + dot->size);
+	if(dotdot->size < EXT2_DIRENT_SIZE(2) || dotdot->name_length != 2 || ((char*) (dotdot + 1))[0] != '.' || ((char*) (dotdot + 1))[1] != '.')
+		return Result(-EINVAL);
+
+	//Figure out which hash to use
+	uint8_t stored_hash_version = superblock.default_hash_version;
+	if(stored_hash_version > EXT2_HASH_TEA)
+		stored_hash_version = EXT2_HASH_HALF_MD4;
+	htree.m_hash_version = stored_hash_version;
+	if(superblock.flags & EXT2_FLAGS_UNSIGNED_HASH)
+		htree.m_hash_version += EXT2_HASH_LEGACY_UNSIGNED;
+
+	//The rest of the entries get split into two leaves. Mark the entries we're moving out of the root as unused first.
+	uint8_t lower_buf[block_size];
+	uint8_t upper_buf[block_size];
+	uint8_t leaves_buf[block_size];
+	memcpy(leaves_buf, root_buf, block_size);
+	((ext2_directory*) leaves_buf)->inode = 0;
+	((ext2_directory*) (leaves_buf + dot->size))->inode = 0;
+	uint32_t split_hash;
+	res = htree.split_entries(leaves_buf, lower_buf, upper_buf, split_hash);
+	if(res.is_error())
+		return res;
+
+	auto lower_or_err = dir.append_directory_block();
+	if(lower_or_err.is_error())
+		return lower_or_err.result();
+	auto upper_or_err = dir.append_directory_block();
+	if(upper_or_err.is_error()) {
+		dir.truncate((off_t) block_size);
+		return upper_or_err.result();
+	}
+
+	res = htree.write_block(lower_or_err.value(), lower_buf);
+	if(res.is_error())
+		return res;
+	res = htree.write_block(upper_or_err.value(), upper_buf);
+	if(res.is_error())
+		return res;
+
+	//Then, rewrite the first block as the root of the index
+	ext2_directory dot_ent = *dot;
+	ext2_directory dotdot_ent = *dotdot;
+	memset(root_buf, 0, block_size);
+	dot_ent.size = EXT2_DIRENT_SIZE(1);
+	memcpy(root_buf, &dot_ent, sizeof(ext2_directory));
+	root_buf[sizeof(ext2_directory)] = '.';
+	dotdot_ent.size = block_size - dot_ent.size;
+	memcpy(root_buf + dot_ent.size, &dotdot_ent, sizeof(ext2_directory));
+	root_buf[dot_ent.size + sizeof(ext2_directory)] = '.';
+	root_buf[dot_ent.size + sizeof(ext2_directory) + 1] = '.';
+
+	size_t info_offset = dot_ent.size + EXT2_DIRENT_SIZE(2);
+	auto* info = (ext2_dx_root_info*) (root_buf + info_offset);
+	info->hash_version = stored_hash_version;
+	info->info_length = sizeof(ext2_dx_root_info);
+	info->indirect_levels = 0;
+
+	auto* entries = (ext2_dx_entry*) (info + 1);
+	auto* countlimit = (ext2_dx_countlimit*) entries;
+	countlimit->limit = (block_size - (info_offset + sizeof(ext2_dx_root_info))) / sizeof(ext2_dx_entry);
+	countlimit->count = 2;
+	entries[0].block = lower_or_err.value();
+	entries[1].hash = split_hash;
+	entries[1].block = upper_or_err.value();
+
+	res = htree.write_block(0, root_buf);
+	if(res.is_error())
+		return res;
+
+	dir.raw.flags |= EXT2_INDEX;
+	dir.write_inode_entry();
+
+	return htree.insert(name, inode, type);
+}
+
+Result Ext2HTree::read_root() {
+	uint8_t root_buf[m_block_size];
+	auto res = read_block(0, root_buf);
+	if(res.is_error())
+		return res;
+
+	//The root info comes right after the entries for . and ..
+	auto* dot = (ext2_directory*) root_buf;
+	if(dot->size < sizeof(ext2_directory) || dot->size >= m_block_size)
+		return Result(-EINVAL);
+	auto* dotdot = (ext2_directory*) (root_buf + dot->size);
+	size_t info_offset = dot->size + EXT2_DIRENT_SIZE(2);
+	if(dotdot->name_length != 2 || info_offset + sizeof(ext2_dx_root_info) > m_block_size)
+		return Result(-EINVAL);
+
+	auto* info = (ext2_dx_root_info*) (root_buf + info_offset);
+	if(info->reserved != 0 || info->hash_version > EXT2_HASH_TEA_UNSIGNED || info->indirect_levels >= EXT2_HTREE_MAX_DEPTH)
+		return Result(-EINVAL);
+
+	m_hash_version = info->hash_version;
+	if(m_hash_version <= EXT2_HASH_TEA && (m_fs.superblock.flags & EXT2_FLAGS_UNSIGNED_HASH))
+		m_hash_version += EXT2_HASH_LEGACY_UNSIGNED;
+	m_levels = info->indirect_levels;
+	m_root_info_offset = info_offset;
+	m_root_entries_offset = info_offset + info->info_length;
+	return Result(SUCCESS);
+}
+
+Result Ext2HTree::probe(uint32_t hash, Frame* frames, uint32_t& leaf) {
+	uint8_t block_buf[m_block_size];
+	uint32_t block_index = 0;
+	size_t entries_offset = m_root_entries_offset;
+	for(size_t level = 0; level <= m_levels; level++) {
+		if(block_index >= m_dir.num_blocks())
+			return Result(-EINVAL);
+		auto res = read_block(block_index, block_buf);
+		if(res.is_error())
+			return res;
+
+		auto* entries = (ext2_dx_entry*) (block_buf + entries_offset);
+		auto* countlimit = (ext2_dx_countlimit*) entries;
+		if(!countlimit->count || countlimit->count > countlimit->limit || entries_offset + countlimit->limit * sizeof(ext2_dx_entry) > m_block_size)
+			return Result(-EINVAL);
+
+		//Find the last entry with a hash less than or equal to ours. The first one covers every hash before the second.
+		size_t low = 1;
+		size_t high = countlimit->count;
+		while(low < high) {
+			size_t mid = (low + high) / 2;
+			if(entries[mid].hash > hash)
+				high = mid;
+			else
+				low = mid + 1;
+		}
+
+		frames[level] = {block_index, entries_offset, (uint16_t) (low - 1)};
+		block_index = DX_BLOCK(entries[low - 1]);
+		entries_offset = sizeof(ext2_directory); //Nodes below the root start with an empty directory entry
+	}
+
+	if(block_index >= m_dir.num_blocks())
+		return Result(-EINVAL);
+	leaf = block_index;
+	return Result(SUCCESS);
+}
+
+bool Ext2HTree::next_leaf(uint32_t hash, Frame* frames, uint32_t& leaf) {
+	uint8_t block_buf[m_block_size];
+
+	//Find the deepest node we passed through that has an entry after the one we followed
+	int level = m_levels;
+	ext2_dx_entry* entries = nullptr;
+	for(; level >= 0; level--) {
+		if(read_block(frames[level].block_index, block_buf).is_error())
+			return false;
+		entries = (ext2_dx_entry*) (block_buf + frames[level].entries_offset);
+		if(frames[level].position + 1 < ((ext2_dx_countlimit*) entries)->count)
+			break;
+	}
+	if(level < 0)
+		return false;
+
+	//If the next leaf starts at a different hash, there's nothing else to look through
+	frames[level].position++;
+	if((entries[frames[level].position].hash & ~1u) != hash)
+		return false;
+
+	//Otherwise, go back down to the start of the next leaf
+	uint32_t block_index = DX_BLOCK(entries[frames[level].position]);
+	for(level++; level <= m_levels; level++) {
+		if(block_index >= m_dir.num_blocks() || read_block(block_index, block_buf).is_error())
+			return false;
+		frames[level] = {block_index, sizeof(ext2_directory), 0};
+		block_index = DX_BLOCK(*((ext2_dx_entry*) (block_buf + sizeof(ext2_directory))));
+	}
+	if(block_index >= m_dir.num_blocks())
+		return false;
+	leaf = block_index;
+	return true;
+}
+
+Result Ext2HTree::make_room(Frame* frames) {
+	uint8_t node_buf[m_block_size];
+	auto res = read_block(frames[m_levels].block_index, node_buf);
+	if(res.is_error())
+		return res;
+	auto* node_entries = (ext2_dx_entry*) (node_buf + frames[m_levels].entries_offset);
+	auto* node_countlimit = (ext2_dx_countlimit*) node_entries;
+	if(node_countlimit->count < node_countlimit->limit)
+		return Result(SUCCESS);
+
+	const uint16_t node_limit = (m_block_size - sizeof(ext2_directory)) / sizeof(ext2_dx_entry);
+	uint8_t new_buf[m_block_size];
+	memset(new_buf, 0, m_block_size);
+	((ext2_directory*) new_buf)->size = m_block_size;
+	auto* new_entries = (ext2_dx_entry*) (new_buf + sizeof(ext2_directory));
+	auto* new_countlimit = (ext2_dx_countlimit*) new_entries;
+
+	if(m_levels == 0) {
+		//The root is full, so its entries move down into a new node below it and the tree gets deeper
+		auto new_node_or_err = m_dir.append_directory_block();
+		if(new_node_or_err.is_error())
+			return new_node_or_err.result();
+		uint32_t new_node = new_node_or_err.value();
+
+		memcpy(new_entries, node_entries, node_countlimit->count * sizeof(ext2_dx_entry));
+		new_countlimit->limit = node_limit;
+		res = write_block(new_node, new_buf);
+		if(res.is_error())
+			return res;
+
+		node_countlimit->count = 1;
+		node_entries[0].block = new_node;
+		((ext2_dx_root_info*) (node_buf + m_root_info_offset))->indirect_levels = 1;
+		res = write_block(0, node_buf);
+		if(res.is_error())
+			return res;
+
+		frames[1] = {new_node, sizeof(ext2_directory), frames[0].position};
+		frames[0].position = 0;
+		m_levels = 1;
+		return Result(SUCCESS);
+	}
+
+	//The node is full and the tree can't get any deeper, so the node has to be split. Make sure the root has room first.
+	uint8_t root_buf[m_block_size];
+	res = read_block(0, root_buf);
+	if(res.is_error())
+		return res;
+	auto* root_countlimit = (ext2_dx_countlimit*) (root_buf + m_root_entries_offset);
+	if(root_countlimit->count >= root_countlimit->limit)
+		return Result(-ENOSPC);
+
+	auto new_node_or_err = m_dir.append_directory_block();
+	if(new_node_or_err.is_error())
+		return new_node_or_err.result();
+	uint32_t new_node = new_node_or_err.value();
+
+	//Move the upper half of the node's entries into the new node
+	uint16_t count = node_countlimit->count;
+	uint16_t split = count / 2;
+	uint32_t split_hash = node_entries[split].hash;
+	memcpy(new_entries, node_entries + split, (count - split) * sizeof(ext2_dx_entry));
+	new_countlimit->limit = node_limit;
+	new_countlimit->count = count - split;
+	node_countlimit->count = split;
+
+	res = write_block(new_node, new_buf);
+	if(res.is_error())
+		return res;
+	res = write_block(frames[1].block_index, node_buf);
+	if(res.is_error())
+		return res;
+	res = insert_index_entry(frames[0], split_hash, new_node);
+	if(res.is_error())
+		return res;
+
+	//If the entry we followed was moved, we're in the new node now
+	if(frames[1].position >= split) {
+		frames[1] = {new_node, sizeof(ext2_directory), (uint16_t) (frames[1].position - split)};
+		frames[0].position++;
+	}
+	return Result(SUCCESS);
+}
+
+Result Ext2HTree::insert_index_entry(Frame& frame, uint32_t hash, uint32_t block_index) {
+	uint8_t node_buf[m_block_size];
+	auto res = read_block(frame.block_index, node_buf);
+	if(res.is_error())
+		return res;
+
+	auto* entries = (ext2_dx_entry*) (node_buf + frame.entries_offset);
+	auto* countlimit = (ext2_dx_countlimit*) entries;
+	if(countlimit->count >= countlimit->limit)
+		return Result(-ENOSPC);
+
+	for(size_t i = countlimit->count; i > frame.position + 1u; i--)
+		entries[i] = entries[i - 1];
+	entries[frame.position + 1] = {hash, block_index};
+	countlimit->count++;
+	return write_block(frame.block_index, node_buf);
+}
+
+Result Ext2HTree::split_entries(const uint8_t* leaf_buf, uint8_t* lower_buf, uint8_t* upper_buf, uint32_t& split_hash) {
+	//Hash all of the entries in the leaf and sort them that way
+	kstd::vector<LeafEntry> entries;
+	size_t total_size = 0;
+	for(size_t offset = 0; offset + sizeof(ext2_directory) <= m_block_size;) {
+		auto* entry = (const ext2_directory*) (leaf_buf + offset);
+		if(entry->size < sizeof(ext2_directory) || offset + entry->size > m_block_size)
+			return Result(-EINVAL);
+		if(entry->inode) {
+			LeafEntry leaf_entry = {hash((const char*) (entry + 1), entry->name_length, m_hash_version, m_fs.superblock.hash_seed), offset};
+			size_t i = entries.size();
+			entries.push_back(leaf_entry);
+			for(; i > 0 && entries[i - 1].hash > leaf_entry.hash; i--)
+				entries[i] = entries[i - 1];
+			entries[i] = leaf_entry;
+			total_size += EXT2_DIRENT_SIZE(entry->name_length);
+		}
+		offset += entry->size;
+	}
+	if(entries.size() < 2)
+		return Result(-ENOSPC);
+
+	//Split them in half by size
+	size_t split = 0;
+	for(size_t lower_size = 0; split < entries.size() - 1 && lower_size < total_size / 2; split++)
+		lower_size += EXT2_DIRENT_SIZE(((const ext2_directory*) (leaf_buf + entries[split].offset))->name_length);
+	if(split == 0)
+		split = 1;
+	split_hash = entries[split].hash;
+	if(entries[split - 1].hash == split_hash)
+		split_hash |= 1; //Names with this hash continue from the lower leaf into the upper one
+
+	//Then write out each half. The source might be the same as the lower half, so build it somewhere else first.
+	uint8_t lower_tmp[m_block_size];
+	for(int half = 0; half < 2; half++) {
+		uint8_t* buf = half ? upper_buf : lower_tmp;
+		memset(buf, 0, m_block_size);
+		size_t cur_offset = 0;
+		ext2_directory* last_entry = nullptr;
+		for(size_t i = half ? split : 0; i < (half ? entries.size() : split); i++) {
+			auto* entry = (const ext2_directory*) (leaf_buf + entries[i].offset);
+			size_t entry_size = EXT2_DIRENT_SIZE(entry->name_length);
+			last_entry = (ext2_directory*) (buf + cur_offset);
+			memcpy(last_entry, entry, sizeof(ext2_directory) + entry->name_length);
+			last_entry->size = entry_size;
+			cur_offset += entry_size;
+		}
+		last_entry->size += m_block_size - cur_offset;
+	}
+	memcpy(lower_buf, lower_tmp, m_block_size);
+
+	return Result(SUCCESS);
+}
+
+uint32_t Ext2HTree::name_hash(kstd::string_view name) {
+	return hash(name.data(), name.length(), m_hash_version, m_fs.superblock.hash_seed);
+}
+
+Result Ext2HTree::read_block(uint32_t block_index, uint8_t* buf) {
+	uint32_t block = m_dir.get_block_pointer(block_index);
+	if(!block)
+		return Result(-EINVAL);
+	return m_fs.read_metadata_block(block, buf);
+}
+
+Result Ext2HTree::write_block(uint32_t block_index, const uint8_t* buf) {
+	uint32_t block = m_dir.get_block_pointer(block_index);
+	if(!block)
+		return Result(-EINVAL);
+	return m_fs.write_metadata_block(block, buf);
+}
+
+/*
+ * Hash functions
+ */
+
+static inline uint32_t rotate_left(uint32_t value, uint32_t shift) {
+	return (value << shift) | (value >> (32 - shift));
+}
+
+static void tea_transform(uint32_t buf[4], const uint32_t in[4]) {
+	uint32_t sum = 0;
+	uint32_t b0 = buf[0], b1 = buf[1];
+	uint32_t a = in[0], b = in[1], c = in[2], d = in[3];
+	for(int n = 0; n < 16; n++) {
+		sum += 0x9E3779B9;
+		b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+		b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+	}
+	buf[0] += b0;
+	buf[1] += b1;
+}
+
+#define MD4_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD4_G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define MD4_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD4_ROUND(f, a, b, c, d, x, s) (a += f(b, c, d) + (x), a = rotate_left(a, s))
+#define MD4_K2 0x5A827999u
+#define MD4_K3 0x6ED9EBA1u
+
+static void half_md4_transform(uint32_t buf[4], const uint32_t in[8]) {
+	uint32_t a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+	MD4_ROUND(MD4_F, a, b, c, d, in[0], 3);
+	MD4_ROUND(MD4_F, d, a, b, c, in[1], 7);
+	MD4_ROUND(MD4_F, c, d, a, b, in[2], 11);
+	MD4_ROUND(MD4_F, b, c, d, a, in[3], 19);
+	MD4_ROUND(MD4_F, a, b, c, d, in[4], 3);
+	MD4_ROUND(MD4_F, d, a, b, c, in[5], 7);
+	MD4_ROUND(MD4_F, c, d, a, b, in[6], 11);
+	MD4_ROUND(MD4_F, b, c, d, a, in[7], 19);
+
+	MD4_ROUND(MD4_G, a, b, c, d, in[1] + MD4_K2, 3);
+	MD4_ROUND(MD4_G, d, a, b, c, in[3] + MD4_K2, 5);
+	MD4_ROUND(MD4_G, c, d, a, b, in[5] + MD4_K2, 9);
+	MD4_ROUND(MD4_G, b, c, d, a, in[7] + MD4_K2, 13);
+	MD4_ROUND(MD4_G, a, b, c, d, in[0] + MD4_K2, 3);
+	MD4_ROUND(MD4_G, d, a, b, c, in[2] + MD4_K2, 5);
+	MD4_ROUND(MD4_G, c, d, a, b, in[4] + MD4_K2, 9);
+	MD4_ROUND(MD4_G, b, c, d, a, in[6] + MD4_K2, 13);
+
+	MD4_ROUND(MD4_H, a, b, c, d, in[3] + MD4_K3, 3);
+	MD4_ROUND(MD4_H, d, a, b, c, in[7] + MD4_K3, 9);
+	MD4_ROUND(MD4_H, c, d, a, b, in[2] + MD4_K3, 11);
+	MD4_ROUND(MD4_H, b, c, d, a, in[6] + MD4_K3, 15);
+	MD4_ROUND(MD4_H, a, b, c, d, in[1] + MD4_K3, 3);
+	MD4_ROUND(MD4_H, d, a, b, c, in[5] + MD4_K3, 9);
+	MD4_ROUND(MD4_H, c, d, a, b, in[0] + MD4_K3, 11);
+	MD4_ROUND(MD4_H, b, c, d, a, in[4] + MD4_K3, 15);
+
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+static uint32_t legacy_hash(const char* name, size_t length, bool is_unsigned) {
+	uint32_t hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+	for(size_t i = 0; i < length; i++) {
+		int c = is_unsigned ? (int) (unsigned char) name[i] : (int) (signed char) name[i];
+		uint32_t hash = hash1 + (hash0 ^ (uint32_t) (c * 7152373));
+		if(hash & 0x80000000)
+			hash -= 0x7fffffff;
+		hash1 = hash0;
+		hash0 = hash;
+	}
+	return hash0 << 1;
+}
+
+/** Packs up to num * 4 characters of a string into words, padding it with its length. **/
+static void string_to_words(const char* str, size_t length, uint32_t* words, int num, bool is_unsigned) {
+	uint32_t pad = (uint32_t) length | ((uint32_t) length << 8);
+	pad |= pad << 16;
+
+	uint32_t value = pad;
+	if(length > (size_t) num * 4)
+		length = num * 4;
+	for(size_t i = 0; i < length; i++) {
+		int c = is_unsigned ? (int) (unsigned char) str[i] : (int) (signed char) str[i];
+		value = (uint32_t) c + (value << 8);
+		if((i % 4) == 3) {
+			*words++ = value;
+			value = pad;
+			num--;
+		}
+	}
+	if(--num >= 0)
+		*words++ = value;
+	while(--num >= 0)
+		*words++ = pad;
+}
+
+uint32_t Ext2HTree::hash(const char* name, size_t length, uint8_t version, const uint32_t seed[4]) {
+	uint32_t buf[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+	if(seed[0] || seed[1] || seed[2] || seed[3])
+		memcpy(buf, seed, sizeof(buf));
+
+	uint32_t hash;
+	uint32_t in[8];
+	bool is_unsigned = version >= EXT2_HASH_LEGACY_UNSIGNED;
+	switch(version) {
+		case EXT2_HASH_LEGACY:
+		case EXT2_HASH_LEGACY_UNSIGNED:
+			hash = legacy_hash(name, length, is_unsigned);
+			break;
+		case EXT2_HASH_HALF_MD4:
+		case EXT2_HASH_HALF_MD4_UNSIGNED:
+			for(ssize_t left = length; left > 0; left -= 32, name += 32) {
+				string_to_words(name, left, in, 8, is_unsigned);
+				half_md4_transform(buf, in);
+			}
+			hash = buf[1];
+			break;
+		case EXT2_HASH_TEA:
+		case EXT2_HASH_TEA_UNSIGNED:
+			for(ssize_t left = length; left > 0; left -= 16, name += 16) {
+				string_to_words(name, left, in, 4, is_unsigned);
+				tea_transform(buf, in);
+			}
+			hash = buf[0];
+			break;
+		default:
+			return 0;
+	}
+
+	//The lowest bit is used in the index to mark hash collisions that spill over into the next leaf, and the highest hash
+	//is reserved too
+	hash &= ~1u;
+	if(hash == 0xFFFFFFFE)
+		hash = 0xFFFFFFFC;
+	return hash;
+}
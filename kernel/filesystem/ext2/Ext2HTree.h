@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "Ext2Inode.h"
+#include "Ext2.h"
+
+//The most levels of index nodes a directory index can have, including the root
+#define EXT2_HTREE_MAX_DEPTH 2
+
+/**
+ * The hashed index (htree) of an ext2 directory. The first block of an indexed directory holds the root of a shallow
+ * b-tree keyed by the hashes of names, and its leaves are ordinary directory blocks. The index blocks look like empty
+ * directory entries, so an indexed directory can still be read as a plain list of entries.
+ */
+class Ext2HTree {
+public:
+	explicit Ext2HTree(Ext2Inode& dir);
+
+	/**
+	 * Finds an entry in the directory. Returns -ENOENT if the entry isn't there, or another error if the index couldn't
+	 * be used.
+	 */
+	Result find(kstd::string_view name, Ext2Inode::DirEntryLocation& location);
+
+	/**
+	 * Adds an entry to the directory. If the index is full or can't be used an error is returned, and the directory should
+	 * stop being indexed.
+	 */
+	Result insert(const kstd::string& name, ino_t inode, uint8_t type);
+
+	/** Indexes a directory that has one full block, and then adds an entry to it. **/
+	static Result create(Ext2Inode& dir, const kstd::string& name, ino_t inode, uint8_t type);
+
+	/** Calculates the hash of a name using one of the index hash functions. **/
+	static uint32_t hash(const char* name, size_t length, uint8_t version, const uint32_t seed[4]);
+
+private:
+	/** An index node passed through on the way to a leaf. **/
+	struct Frame {
+		uint32_t block_index; //The index of the node's block in the directory
+		size_t entries_offset; //Where the node's entries start in the block
+		uint16_t position; //The entry that was followed
+	};
+
+	/** An entry in a leaf that's being split. **/
+	struct LeafEntry {
+		uint32_t hash;
+		size_t offset;
+	};
+
+	/** Reads the root of the index and makes sure we know how to use it. **/
+	Result read_root();
+	/** Follows the index down to the leaf that a hash belongs in, keeping track of the nodes passed through. **/
+	Result probe(uint32_t hash, Frame* frames, uint32_t& leaf);
+	/** Moves on to the next leaf if names with the same hash carry on into it. **/
+	bool next_leaf(uint32_t hash, Frame* frames, uint32_t& leaf);
+	/** Makes sure the deepest node we passed through has room for another entry, adding a level or splitting if needed. **/
+	Result make_room(Frame* frames);
+	/** Adds an entry to the deepest node we passed through, right after the one that was followed. **/
+	Result insert_index_entry(Frame& frame, uint32_t hash, uint32_t block_index);
+	/**
+	 * Sorts the entries in a leaf by hash and writes the lower and upper halves into two new leaf blocks. The hash that
+	 * the upper half starts at is returned, with the lowest bit set if names with the same hash are in both halves.
+	 */
+	Result split_entries(const uint8_t* leaf_buf, uint8_t* lower_buf, uint8_t* upper_buf, uint32_t& split_hash);
+	uint32_t name_hash(kstd::string_view name);
+	Result read_block(uint32_t block_index, uint8_t* buf);
+	Result write_block(uint32_t block_index, const uint8_t* buf);
+
+	Ext2Inode& m_dir;
+	Ext2Filesystem& m_fs;
+	size_t m_block_size;
+	uint8_t m_hash_version = EXT2_HASH_HALF_MD4;
+	uint8_t m_levels = 0;
+	size_t m_root_info_offset = 0;
+	size_t m_root_entries_offset = 0;
+};
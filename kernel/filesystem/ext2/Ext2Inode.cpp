@@ -21,30 +21,20 @@
 #include <kernel/kstd/cstring.h>
 #include "Ext2BlockGroup.h"
 #include "Ext2Filesystem.h"
+#include "Ext2HTree.h"
+#include "Ext2Journal.h"
 #include <kernel/filesystem/DirectoryEntry.h>
+#include <kernel/filesystem/FileDescriptor.h>
 #include <kernel/kstd/KLog.h>
 
-Ext2Inode::Ext2Inode(Ext2Filesystem& filesystem, ino_t id): Inode(filesystem, id) {
-	//Get the block group
-	Ext2BlockGroup* bg = ext2fs().get_block_group(block_group());
-
-	//Read the inode table
-	uint8_t block_buf[ext2fs().block_size()];
-	ext2fs().read_blocks(bg->inode_table_block + block(), 1, block_buf);
-
-	//Copy inode entry into raw
-	auto* inodeRaw = (Raw*) block_buf;
-	inodeRaw += index() % ext2fs().inodes_per_block;
-	memcpy(&raw, inodeRaw, sizeof(Ext2Inode::Raw));
-
+Ext2Inode::Ext2Inode(Ext2Filesystem& filesystem, ino_t id, const Raw& raw): Inode(filesystem, id), raw(raw) {
 	create_metadata();
 
-	//Read block pointers
-	if(!_metadata.is_device())
-		read_block_pointers();
+	//Block pointers are read in lazily as they're needed
 }
 
 Ext2Inode::Ext2Inode(Ext2Filesystem& filesystem, ino_t i, const Raw &raw, kstd::vector<uint32_t>& block_pointers, ino_t parent): Inode(filesystem, i), block_pointers(block_pointers), raw(raw) {
+	block_pointers_loaded = true;
 	create_metadata();
 	if(IS_DIR(raw.mode)) {
 		kstd::vector<DirectoryEntry> entries;
@@ -59,8 +49,12 @@ Ext2Inode::Ext2Inode(Ext2Filesystem& filesystem, ino_t i, const Raw &raw, kstd::
 }
 
 Ext2Inode::~Ext2Inode() {
-	if(_dirty && exists())
-		write_to_disk();
+	if((_dirty && exists()) || prealloc_count) {
+		EXT2_JOURNAL_HANDLE(ext2fs());
+		if(_dirty && exists())
+			write_to_disk();
+		discard_preallocation();
+	}
 }
 
 uint32_t Ext2Inode::block_group(){
@@ -85,12 +79,139 @@ size_t Ext2Inode::num_blocks() {
 }
 
 uint32_t Ext2Inode::get_block_pointer(uint32_t block_index) {
-	if(block_index >= block_pointers.size()) return 0;
-	return block_pointers[block_index];
+	if(block_pointers_loaded) {
+		if(block_index >= block_pointers.size()) return 0;
+		return block_pointers[block_index];
+	}
+
+	if(block_index >= num_blocks()) return 0;
+	if(block_index < 12) return raw.block_pointers[block_index];
+
+	//Look for the run the block is in
+	{
+		LOCK(block_runs_lock);
+		size_t lo = 0, hi = block_runs.size();
+		while(lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			auto& run = block_runs[mid];
+			if(block_index < run.index)
+				hi = mid;
+			else if(block_index >= run.index + run.length)
+				lo = mid + 1;
+			else
+				return run.block ? run.block + (block_index - run.index) : 0;
+		}
+	}
+
+	return resolve_block_pointer(block_index);
+}
+
+uint32_t Ext2Inode::resolve_block_pointer(uint32_t block_index) {
+	//Find the singly indirect block that points to the block, and the index of the first block it points to
+	uint32_t ppb = ext2fs().block_pointers_per_block;
+	uint32_t index = block_index - 12;
+	uint32_t first_index = 12;
+	uint32_t pointer_block;
+	if(index < ppb) {
+		pointer_block = raw.s_pointer;
+	} else {
+		index -= ppb;
+		first_index += ppb;
+		uint32_t doubly_indirect_block = raw.d_pointer;
+		if(index >= ppb * ppb) {
+			index -= ppb * ppb;
+			first_index += ppb * ppb;
+			doubly_indirect_block = read_pointer(raw.t_pointer, index / (ppb * ppb));
+			first_index += (index / (ppb * ppb)) * ppb * ppb;
+			index %= ppb * ppb;
+		}
+		pointer_block = read_pointer(doubly_indirect_block, index / ppb);
+		first_index += (index / ppb) * ppb;
+	}
+
+	//Then turn every pointer in it into runs, since it's already been read
+	uint32_t num_pointers = min(ppb, (uint32_t) num_blocks() - first_index);
+	uint8_t block_buf[ext2fs().block_size()];
+	if(pointer_block)
+		ext2fs().read_metadata_block(pointer_block, block_buf);
+	else
+		memset(block_buf, 0, ext2fs().block_size());
+	auto* pointers = (uint32_t*) block_buf;
+
+	LOCK(block_runs_lock);
+	BlockRun run = {first_index, pointers[0], 1};
+	for(uint32_t i = 1; i < num_pointers; i++) {
+		if(pointers[i] == (run.block ? run.block + run.length : 0)) {
+			run.length++;
+		} else {
+			insert_block_run(run);
+			run = {first_index + i, pointers[i], 1};
+		}
+	}
+	insert_block_run(run);
+
+	return pointers[block_index - first_index];
+}
+
+uint32_t Ext2Inode::read_pointer(uint32_t pointer_block, uint32_t index) {
+	if(!pointer_block)
+		return 0;
+	uint8_t block_buf[ext2fs().block_size()];
+	ext2fs().read_metadata_block(pointer_block, block_buf);
+	return ((uint32_t*) block_buf)[index];
+}
+
+void Ext2Inode::insert_block_run(const BlockRun& run) {
+	//Find where the run goes
+	size_t lo = 0, hi = block_runs.size();
+	while(lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if(block_runs[mid].index < run.index)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	//Someone else may have cached it already
+	if(lo < block_runs.size() && block_runs[lo].index == run.index)
+		return;
+	if(lo > 0 && block_runs[lo - 1].index + block_runs[lo - 1].length > run.index)
+		return;
+
+	//Merge it into the run before it if it continues that one
+	if(lo > 0) {
+		auto& prev = block_runs[lo - 1];
+		if(prev.index + prev.length == run.index && run.block == (prev.block ? prev.block + prev.length : 0)) {
+			prev.length += run.length;
+			//And merge the run after it in too if that continues it
+			if(lo < block_runs.size()) {
+				auto& next = block_runs[lo];
+				if(prev.index + prev.length == next.index && next.block == (prev.block ? prev.block + prev.length : 0)) {
+					prev.length += next.length;
+					block_runs.erase(lo);
+				}
+			}
+			return;
+		}
+	}
+
+	//Or the run after it, if it leads into that one
+	if(lo < block_runs.size()) {
+		auto& next = block_runs[lo];
+		if(run.index + run.length == next.index && next.block == (run.block ? run.block + run.length : 0)) {
+			next.index = run.index;
+			next.block = run.block;
+			next.length += run.length;
+			return;
+		}
+	}
+
+	block_runs.insert(lo, run);
 }
 
 bool Ext2Inode::set_block_pointer(uint32_t block_index, uint32_t block) {
 	LOCK(lock);
+	load_block_pointers();
 
 	if(block_index == 0 && block_pointers.empty()) {
 		block_pointers.push_back(block);
@@ -108,10 +229,13 @@ bool Ext2Inode::set_block_pointer(uint32_t block_index, uint32_t block) {
 }
 
 kstd::vector<uint32_t>& Ext2Inode::get_block_pointers() {
+	load_block_pointers();
 	return block_pointers;
 }
 
 void Ext2Inode::free_all_blocks() {
+	load_block_pointers();
+	discard_preallocation();
 	ext2fs().free_blocks(block_pointers);
 	ext2fs().free_blocks(pointer_blocks);
 }
@@ -124,7 +248,7 @@ ssize_t Ext2Inode::read(size_t start, size_t length, SafePointer<uint8_t> buffer
 	if(!exists())
 		return -ENOENT; //Inode was deleted
 
-	LOCK(lock);
+	READ_LOCK(lock);
 
 	//Symlinks less than 60 characters use the block pointers to store their data
 	if (_metadata.is_symlink() && _metadata.size < 60) {
@@ -135,33 +259,34 @@ ssize_t Ext2Inode::read(size_t start, size_t length, SafePointer<uint8_t> buffer
 
 	if(start + length > _metadata.size) length = _metadata.size - start;
 
-	//TODO: symlinks
-	size_t first_block = start / ext2fs().block_size();
-	size_t first_block_start = start % ext2fs().block_size();
-	size_t bytes_left = length;
-	size_t block_index = first_block;
-
-	uint8_t block_buf[ext2fs().block_size()];
-	while(bytes_left) {
-		ext2fs().read_block(get_block_pointer(block_index), block_buf);
-		if(block_index == first_block) {
-			if(length < ext2fs().block_size() - first_block_start) {
-				buffer.write(block_buf + first_block_start, length);
-				bytes_left = 0;
-			} else {
-				buffer.write(block_buf + first_block_start, ext2fs().block_size() - first_block_start);
-				bytes_left -= ext2fs().block_size() - first_block_start;
-			}
+	//Read each run of blocks that are contiguous on disk with one request, straight into the buffer
+	size_t block_size = ext2fs().block_size();
+	size_t end = start + length;
+	size_t pos = start;
+	while(pos < end) {
+		size_t block_index = pos / block_size;
+		uint32_t block = get_block_pointer(block_index);
+		size_t run_end = min(end, (block_index + 1) * block_size);
+		while(block && !_metadata.is_directory() && run_end < end && get_block_pointer(run_end / block_size) == block + (run_end / block_size - block_index))
+			run_end = min(end, run_end + block_size);
+
+		SafePointer<uint8_t> run_buffer(buffer.raw() + (pos - start), buffer.is_user());
+		if(block && _metadata.is_directory()) {
+			//Directories are metadata, so the newest version of the block may still be in the journal
+			uint8_t block_buf[block_size];
+			auto res = ext2fs().read_metadata_block(block, block_buf);
+			if(res.is_error())
+				return res.code();
+			run_buffer.write(block_buf + pos % block_size, run_end - pos);
+		} else if(block) {
+			auto res = ext2fs().read_block_data(block, pos % block_size, run_end - pos, run_buffer);
+			if(res.is_error())
+				return res.code();
 		} else {
-			if(bytes_left < ext2fs().block_size()) {
-				buffer.write(block_buf, length - bytes_left, bytes_left);
-				bytes_left = 0;
-			} else {
-				buffer.write( block_buf, length - bytes_left, ext2fs().block_size());
-				bytes_left -= ext2fs().block_size();
-			}
+			//Holes in the file read as zeroes
+			run_buffer.memset(0, 0, run_end - pos);
 		}
-		block_index++;
+		pos = run_end;
 	}
 	return length;
 }
@@ -171,6 +296,7 @@ ssize_t Ext2Inode::write(size_t start, size_t length, SafePointer<uint8_t> buf,
 	if(length == 0) return 0;
 	if(!exists()) return -ENOENT; //Inode was deleted
 
+	EXT2_JOURNAL_HANDLE(ext2fs());
 	LOCK(lock);
 
 	//If it's a symlink and less than 60 characters, use the block pointers to store the link
@@ -230,79 +356,69 @@ ssize_t Ext2Inode::write(size_t start, size_t length, SafePointer<uint8_t> buf,
 }
 
 ssize_t Ext2Inode::read_dir_entry(size_t start, SafePointer<DirectoryEntry> buffer, FileDescriptor* fd) {
-	LOCK(lock);
+	READ_LOCK(lock);
+
+	const size_t block_size = ext2fs().block_size();
+	uint8_t buf[block_size];
+	size_t buf_block = -1;
+	size_t offset = start;
+	while(offset < _metadata.size) {
+		size_t block = offset / block_size;
+		size_t start_in_block = offset % block_size;
+		if(block != buf_block) {
+			if(read(block * block_size, block_size, KernelPointer<uint8_t>(buf), fd) == 0)
+				return 0;
+			buf_block = block;
+		}
 
-	uint8_t buf[ext2fs().block_size()];
-	size_t block = start / ext2fs().block_size();
-	size_t start_in_block = start % ext2fs().block_size();
-	if(read(block * ext2fs().block_size(), ext2fs().block_size(), KernelPointer<uint8_t>(buf), fd) == 0) {
-		return 0;
-	}
-	auto* dir = (ext2_directory*)(buf + start_in_block);
+		auto* dir = (ext2_directory*)(buf + start_in_block);
+		if(start_in_block + sizeof(ext2_directory) > block_size || dir->size < sizeof(ext2_directory) || start_in_block + dir->size > block_size) {
+			KLog::warn("ext2", "Corrupt directory entry in inode %d at offset %d", id, offset);
+			return 0;
+		}
+		offset += dir->size;
 
-	size_t name_length = dir->name_length;
-	if(name_length > NAME_MAXLEN - 1) name_length = NAME_MAXLEN - 1;
+		//Entries without an inode are free space, like what's left behind when an entry is removed
+		if(dir->inode == 0)
+			continue;
 
-	if(dir->inode == 0) {
-		return 0;
-	}
+		size_t name_length = dir->name_length;
+		if(name_length > NAME_MAXLEN - 1) name_length = NAME_MAXLEN - 1;
 
-	DirectoryEntry result;
-	result.name_length = name_length;
-	result.id = dir->inode;
-	result.type = dir->type;
-	buffer.set(result);
-	SafePointer<uint8_t> name_ptr((uint8_t*) buffer.raw()->name, buffer.is_user());
-	name_ptr.write(&dir->type+1, name_length);
+		DirectoryEntry result;
+		result.name_length = name_length;
+		result.id = dir->inode;
+		result.type = dir->type;
+		buffer.set(result);
+		SafePointer<uint8_t> name_ptr((uint8_t*) buffer.raw()->name, buffer.is_user());
+		name_ptr.write(&dir->type+1, name_length);
 
-	return dir->size;
+		return offset - start;
+	}
+
+	return 0;
 }
 
-ino_t Ext2Inode::find_id(const kstd::string& find_name) {
+ino_t Ext2Inode::find_id(kstd::string_view find_name) {
 	if(!metadata().is_directory()) return 0;
-	LOCK(lock);
-	ino_t ret = 0;
-	auto* buf = static_cast<uint8_t *>(kmalloc(ext2fs().block_size()));
-	for(size_t i = 0; i < num_blocks(); i++) {
-		uint32_t block = get_block_pointer(i);
-		ext2fs().read_block(block, buf);
-		auto* dir = reinterpret_cast<ext2_directory*>(buf);
-		uint32_t add = 0;
-		char name_buf[257];
-		while(dir->inode != 0 && add < ext2fs().block_size()) {
-			memcpy(name_buf, &dir->type+1, dir->name_length);
-			name_buf[dir->name_length] = '\0';
-			if(find_name == name_buf){
-				ret = dir->inode;
-				break;
-			}
-			add += dir->size;
-			dir = (ext2_directory*)((size_t)dir + dir->size);
-		}
-	}
-	kfree(buf);
-	return ret;
+	READ_LOCK(lock);
+	DirEntryLocation location;
+	if(!find_entry(find_name, location))
+		return 0;
+	return location.inode;
 }
 
 Result Ext2Inode::add_entry(const kstd::string &name, Inode &inode) {
 	ASSERT(inode.fs.fsid() == ext2fs().fsid());
 	if(!metadata().is_directory()) return Result(-ENOTDIR);
-	if(!name.length() || name.length() > NAME_MAXLEN) return Result(-ENAMETOOLONG);
+	if(!name.length() || name.length() > NAME_MAXLEN - 1) return Result(-ENAMETOOLONG);
 
+	EXT2_JOURNAL_HANDLE(ext2fs());
 	LOCK(lock);
 
-	//Read entries into a vector
-	kstd::vector<DirectoryEntry> entries;
-	size_t offset = 0;
-	ssize_t nread;
-	DirectoryEntry buf;
-	while((nread = read_dir_entry(offset, KernelPointer<DirectoryEntry>(&buf), nullptr))) {
-		offset += nread;
-		buf.name[buf.name_length] = '\0';
-		if(name == buf.name)
-			return Result(-EEXIST);
-		entries.push_back(buf);
-	}
+	DirEntryLocation location;
+	if(find_entry(name, location))
+		return Result(-EEXIST);
 
 	//Determine filetype
 	uint8_t type = EXT2_FT_UNKNOWN;
@@ -312,24 +428,33 @@ Result Ext2Inode::add_entry(const kstd::string &name, Inode &inode) {
 	else if(inode.metadata().is_block_device()) type = EXT2_FT_BLKDEV;
 	else if(inode.metadata().is_character_device()) type = EXT2_FT_CHRDEV;
 
+	//Write the new entry to disk
+	Result res = Result(SUCCESS);
+	if(raw.flags & EXT2_INDEX) {
+		res = Ext2HTree(*this).insert(name, inode.id, type);
+		if(res.is_error() && res.code() != -EIO) {
+			//The index is full or we can't use it, so stop using it. The directory is still a valid unindexed one.
+			KLog::warn("ext2", "Couldn't add to the index of directory inode %d (%d), removing it", id, res.code());
+			raw.flags &= ~EXT2_INDEX;
+			write_inode_entry();
+			res = insert_entry_linear(inode.id, type, name);
+		}
+	} else {
+		res = insert_entry_linear(inode.id, type, name);
+	}
+	if(res.is_error())
+		return res;
+
 	//Increase hardlink count of new inode
 	((Ext2Inode&) inode).increase_hardlink_count();
 
-	//Push new entry into vector and write to disk
-	entries.push_back({inode.id, type, name});
-	auto res = write_directory_entries(entries);
-	if(res.is_error()) return res;
-	if(_dirty) { //We changed the amount of blocks
-		res = write_to_disk();
-		if(res.is_error()) return res;
-	}
-
 	return Result(SUCCESS);
 }
 
 ResultRet<kstd::Arc<Inode>> Ext2Inode::create_entry(const kstd::string& name, mode_t mode, uid_t uid, gid_t gid) {
 	if(!name.length() || name.length() > NAME_MAXLEN) return Result(-ENAMETOOLONG);
 
+	EXT2_JOURNAL_HANDLE(ext2fs());
 	LOCK(lock);
 
 	//Create the inode
@@ -360,30 +485,14 @@ Result Ext2Inode::remove_entry(const kstd::string &name) {
 	if(!metadata().is_directory()) return Result(-ENOTDIR);
 	if(!name.length() || name.length() > NAME_MAXLEN) return Result(-ENAMETOOLONG);
 
+	EXT2_JOURNAL_HANDLE(ext2fs());
 	LOCK(lock);
 
-	//Read entries into vector and find the child we need
-	kstd::vector<DirectoryEntry> entries;
-	size_t offset = 0;
-	ssize_t nread;
-	size_t entry_index;
-	bool found = false;
-	size_t i = 0;
-	DirectoryEntry buf;
-	while((nread = read_dir_entry(offset, KernelPointer<DirectoryEntry>(&buf), nullptr))) {
-		offset += nread;
-		buf.name[buf.name_length] = '\0';
-		if(name == buf.name) {
-			entry_index = i;
-			found = true;
-		}
-		entries.push_back(buf);
-		i++;
-	}
-
-	//If we didn't find it or the inode doesn't exist for some reason, return with an error
-	if(!found) return Result(-ENOENT);
-	auto child_or_err = ext2fs().get_inode(entries[entry_index].id);
+	//Find the child we need. If we didn't find it or the inode doesn't exist for some reason, return with an error
+	DirEntryLocation location;
+	if(!find_entry(name, location))
+		return Result(-ENOENT);
+	auto child_or_err = ext2fs().get_inode(location.inode);
 	if(child_or_err.is_error()){
 		KLog::warn("ext2", "Orphaned directory entry in inode %d", id);
 		return child_or_err.result();
@@ -399,27 +508,34 @@ Result Ext2Inode::remove_entry(const kstd::string &name) {
 		ext2ino->reduce_hardlink_count();
 	}
 
-	//Erase the entry and write the entries to disk
-	entries.erase(entry_index);
-	auto res = write_directory_entries(entries);
-	if(res.is_error()) return res;
-	if(_dirty) { //We changed the amount of blocks
-		res = write_to_disk();
-		if(res.is_error()) return res;
-	}
-	return Result(SUCCESS);
+	//Erase the entry in place by merging it into the one before it, or marking it unused if it's first in its block
+	uint8_t block_buf[ext2fs().block_size()];
+	uint32_t block = get_block_pointer(location.block_index);
+	auto res = ext2fs().read_metadata_block(block, block_buf);
+	if(res.is_error())
+		return res;
+
+	auto* entry = (ext2_directory*) (block_buf + location.offset);
+	if(location.prev_offset != (size_t) -1)
+		((ext2_directory*) (block_buf + location.prev_offset))->size += entry->size;
+	else
+		entry->inode = 0;
+
+	return ext2fs().write_metadata_block(block, block_buf);
 }
 
 Result Ext2Inode::truncate(off_t length) {
 	if(length < 0) return Result(-EINVAL);
 	if((size_t)length == _metadata.size) return Result(SUCCESS);
+	EXT2_JOURNAL_HANDLE(ext2fs());
 	LOCK(lock);
+	load_block_pointers();
 
 	uint32_t new_num_blocks = (length + ext2fs().block_size() - 1) / ext2fs().block_size();
 
 	if(new_num_blocks > num_blocks()) {
 		//We're expanding the file, allocate new blocks
-		auto new_blocks_res = ext2fs().allocate_blocks(new_num_blocks - num_blocks(), true);
+		auto new_blocks_res = allocate_file_blocks(new_num_blocks - num_blocks());
 		if(new_blocks_res.is_error())
 			return new_blocks_res.result();
 
@@ -435,7 +551,9 @@ Result Ext2Inode::truncate(off_t length) {
 		_metadata.size = (size_t) length;
 		write_to_disk();
 	} else if(new_num_blocks < num_blocks()) {
-		//We're shrinking the file, free old blocks
+		//We're shrinking the file, free old blocks. The preallocated blocks won't be after the end of it anymore, so
+		//those go too.
+		discard_preallocation();
 		for(size_t i = num_blocks(); i > new_num_blocks; i--)
 			ext2fs().free_block(get_block_pointer(i - 1));
 		block_pointers.resize(new_num_blocks);
@@ -463,6 +581,7 @@ Result Ext2Inode::truncate(off_t length) {
 }
 
 Result Ext2Inode::chmod(mode_t mode) {
+	EXT2_JOURNAL_HANDLE(ext2fs());
 	LOCK(lock);
 	_metadata.mode = mode;
 	write_inode_entry();
@@ -470,6 +589,7 @@ Result Ext2Inode::chmod(mode_t mode) {
 }
 
 Result Ext2Inode::chown(uid_t uid, gid_t gid) {
+	EXT2_JOURNAL_HANDLE(ext2fs());
 	LOCK(lock);
 	_metadata.uid = uid;
 	_metadata.gid = gid;
@@ -480,7 +600,7 @@ Result Ext2Inode::chown(uid_t uid, gid_t gid) {
 void Ext2Inode::read_singly_indirect(uint32_t singly_indirect_block, uint32_t& block_index) {
 	if(block_index >= num_blocks()) return;
 	uint8_t block_buf[ext2fs().block_size()];
-	ext2fs().read_block(singly_indirect_block, block_buf);
+	ext2fs().read_metadata_block(singly_indirect_block, block_buf);
 	pointer_blocks.push_back(singly_indirect_block);
 	for(uint32_t i = 0; i < ext2fs().block_pointers_per_block && block_index < num_blocks(); i++) {
 		block_pointers.push_back(((uint32_t*)block_buf)[i]);
@@ -491,7 +611,7 @@ void Ext2Inode::read_singly_indirect(uint32_t singly_indirect_block, uint32_t& b
 void Ext2Inode::read_doubly_indirect(uint32_t doubly_indirect_block, uint32_t& block_index) {
 	if(block_index >= num_blocks()) return;
 	uint8_t block_buf[ext2fs().block_size()];
-	ext2fs().read_block(doubly_indirect_block, block_buf);
+	ext2fs().read_metadata_block(doubly_indirect_block, block_buf);
 	pointer_blocks.push_back(doubly_indirect_block);
 	for(uint32_t i = 0; i < ext2fs().block_pointers_per_block && block_index < num_blocks(); i++)
 		read_singly_indirect(((uint32_t*)block_buf)[i], block_index);
@@ -500,17 +620,21 @@ void Ext2Inode::read_doubly_indirect(uint32_t doubly_indirect_block, uint32_t& b
 void Ext2Inode::read_triply_indirect(uint32_t triply_indirect_block, uint32_t& block_index) {
 	if(block_index >= num_blocks()) return;
 	uint8_t block_buf[ext2fs().block_size()];
-	ext2fs().read_block(triply_indirect_block, block_buf);
+	ext2fs().read_metadata_block(triply_indirect_block, block_buf);
 	pointer_blocks.push_back(triply_indirect_block);
 	for(uint32_t i = 0; i < ext2fs().block_pointers_per_block && block_index < num_blocks(); i++) {
 		read_doubly_indirect(((uint32_t*)block_buf)[i], block_index);
 	}
 }
 
-void Ext2Inode::read_block_pointers() {
+void Ext2Inode::load_block_pointers() {
 	LOCK(lock);
+	if(block_pointers_loaded)
+		return;
+	block_pointers_loaded = true;
+	block_runs = kstd::vector<BlockRun>();
 
-	if(_metadata.is_symlink() && _metadata.size < 60) {
+	if(_metadata.is_device() || (_metadata.is_symlink() && _metadata.size < 60)) {
 		pointer_blocks = kstd::vector<uint32_t>();
 		block_pointers = kstd::vector<uint32_t>();
 		return;
@@ -532,6 +656,66 @@ void Ext2Inode::read_block_pointers() {
 	read_triply_indirect(raw.t_pointer, block_index);
 }
 
+ResultRet<kstd::vector<uint32_t>> Ext2Inode::allocate_file_blocks(uint32_t num_blocks) {
+	//The new blocks should go right after the last block of the file, or near the inode if the file is empty
+	uint32_t goal;
+	if(!block_pointers.empty() && block_pointers[block_pointers.size() - 1])
+		goal = block_pointers[block_pointers.size() - 1] + 1;
+	else
+		goal = ext2fs().get_block_group(block_group())->first_block();
+
+	kstd::vector<uint32_t> ret;
+	ret.reserve(num_blocks);
+
+	//Use up the preallocated blocks first, as long as they're still right after the end of the file
+	if(prealloc_count && prealloc_block != goal)
+		discard_preallocation();
+	while(prealloc_count && ret.size() < num_blocks) {
+		ext2fs().zero_block(prealloc_block);
+		ret.push_back(prealloc_block++);
+		prealloc_count--;
+	}
+	if(ret.size() == num_blocks)
+		return kstd::move(ret);
+
+	//Allocate the rest. Regular files get a few more blocks than they need, so the next write can use them.
+	uint32_t num_needed = num_blocks - ret.size();
+	uint32_t num_extra = _metadata.is_simple_file() ? EXT2_PREALLOC_BLOCKS : 0;
+	auto blocks_res = ext2fs().allocate_blocks(num_needed + num_extra, false, goal);
+	if(blocks_res.is_error() && num_extra) {
+		//There might still be enough space without the extra blocks
+		blocks_res = ext2fs().allocate_blocks(num_needed, false, goal);
+	}
+	if(blocks_res.is_error()) {
+		ext2fs().free_blocks(ret);
+		return blocks_res.result();
+	}
+
+	auto& blocks = blocks_res.value();
+	for(size_t i = 0; i < num_needed; i++) {
+		ext2fs().zero_block(blocks[i]);
+		ret.push_back(blocks[i]);
+	}
+
+	//The extra blocks that follow straight after the new ones are kept as the preallocation, the rest are given back
+	prealloc_block = ret[ret.size() - 1] + 1;
+	for(size_t i = num_needed; i < blocks.size(); i++) {
+		if(blocks[i] == prealloc_block + prealloc_count)
+			prealloc_count++;
+		else
+			ext2fs().free_block(blocks[i]);
+	}
+
+	return kstd::move(ret);
+}
+
+void Ext2Inode::discard_preallocation() {
+	LOCK(lock);
+	for(; prealloc_count; prealloc_count--)
+		ext2fs().free_block(prealloc_block + prealloc_count - 1);
+	prealloc_block = 0;
+}
+
 Result Ext2Inode::write_to_disk() {
 	LOCK(lock);
 
@@ -550,6 +734,7 @@ Result Ext2Inode::write_to_disk() {
 Result Ext2Inode::write_block_pointers() {
 	LOCK(lock);
 	if(_metadata.is_symlink() && _metadata.size < 60) return Result(SUCCESS);
+	if(!block_pointers_loaded) return Result(SUCCESS); //The block pointers can't have changed if they weren't loaded
 
 	pointer_blocks = kstd::vector<uint32_t>(0);
 	pointer_blocks.reserve(calculate_num_ptr_blocks(num_blocks()));
@@ -566,27 +751,27 @@ Result Ext2Inode::write_block_pointers() {
 
 	if(num_blocks() > 12) {
 		if (!raw.s_pointer) {
-			raw.s_pointer = ext2fs().allocate_block();
+			raw.s_pointer = ext2fs().allocate_block(true, get_block_pointer(12));
 			if (!raw.s_pointer) return Result(-ENOSPC); //Block allocation failed
 		}
 		pointer_blocks.push_back(raw.s_pointer);
 
 		//Write singly indirect block to disk
-		ext2fs().read_block(raw.s_pointer, block_buf);
+		ext2fs().read_metadata_block(raw.s_pointer, block_buf);
 		for (uint32_t block_index = 12; block_index < 12 + ext2fs().block_pointers_per_block; block_index++) {
 			((uint32_t *) block_buf)[block_index - 12] = get_block_pointer(block_index);
 		}
-		ext2fs().write_block(raw.s_pointer, block_buf);
+		ext2fs().write_metadata_block(raw.s_pointer, block_buf);
 	} else raw.s_pointer = 0;
 
 	if(num_blocks() > 12 + ext2fs().block_pointers_per_block) {
 		//Allocate doubly indirect block if needed and read
 		if(!raw.d_pointer) {
-			raw.d_pointer = ext2fs().allocate_block();
+			raw.d_pointer = ext2fs().allocate_block(true, get_block_pointer(12 + ext2fs().block_pointers_per_block));
 			if(!raw.d_pointer) return Result(-ENOSPC); //Block allocation failed
-			ext2fs().read_block(raw.d_pointer, block_buf);
+			ext2fs().read_metadata_block(raw.d_pointer, block_buf);
 			memset(block_buf, 0, ext2fs().block_size());
-		} else ext2fs().read_block(raw.d_pointer, block_buf);
+		} else ext2fs().read_metadata_block(raw.d_pointer, block_buf);
 		pointer_blocks.push_back(raw.d_pointer);
 
 		uint8_t dblock_buf[ext2fs().block_size()];
@@ -599,23 +784,23 @@ Result Ext2Inode::write_block_pointers() {
 			uint32_t dblock = ((uint32_t*)block_buf)[dindex];
 			//If the block isn't allocated, allocate it
 			if(!dblock) {
-				dblock = ext2fs().allocate_block();
+				dblock = ext2fs().allocate_block(true, get_block_pointer(cur_block));
 				((uint32_t*)block_buf)[dindex] = dblock;
 				if(!dblock) return Result(-ENOSPC); //Allocation failed
 			}
 			pointer_blocks.push_back(dblock);
 
 			//Update entries in the block and write to disk
-			ext2fs().read_block(dblock, dblock_buf);
+			ext2fs().read_metadata_block(dblock, dblock_buf);
 			for(uint32_t dblock_index = 0; dblock_index < ext2fs().block_size() / sizeof(uint32_t); dblock_index++) {
 				((uint32_t *) dblock_buf)[dblock_index] = get_block_pointer(cur_block);
 				cur_block++;
 			}
-			ext2fs().write_block(dblock, dblock_buf);
+			ext2fs().write_metadata_block(dblock, dblock_buf);
 		}
 
 		//Write doubly-indirect block to disk
-		ext2fs().write_block(raw.d_pointer, block_buf);
+		ext2fs().write_metadata_block(raw.d_pointer, block_buf);
 	} else raw.d_pointer = 0;
 
 	if(num_blocks() > 12 + ext2fs().block_pointers_per_block * ext2fs().block_pointers_per_block) {
@@ -639,7 +824,7 @@ Result Ext2Inode::write_inode_entry() {
 
 	//Get the block group and read the inode table
 	Ext2BlockGroup* bg = ext2fs().get_block_group(block_group());
-	ext2fs().read_block(bg->inode_table_block + block(), block_buf);
+	ext2fs().read_metadata_block(bg->inode_table_block + block(), block_buf);
 
 	//Update the inode entry
 	auto* inodeRaw = (Raw*) block_buf;
@@ -647,7 +832,7 @@ Result Ext2Inode::write_inode_entry() {
 	memcpy(inodeRaw, &raw, sizeof(Ext2Inode::Raw));
 
 	//Write the inode table to disk
-	ext2fs().write_block(bg->inode_table_block + block(), block_buf);
+	ext2fs().write_metadata_block(bg->inode_table_block + block(), block_buf);
 	_dirty = false;
 
 	return Result(SUCCESS);
@@ -655,73 +840,179 @@ Result Ext2Inode::write_inode_entry() {
 
 Result Ext2Inode::write_directory_entries(kstd::vector<DirectoryEntry> &entries) {
 	LOCK(lock);
+	const size_t block_size = ext2fs().block_size();
 
 	//First, determine the new file size
-	size_t new_filesize = 0;
+	size_t num_dir_blocks = 1;
+	size_t cur_byte_in_block = 0;
 	for(size_t i = 0; i < entries.size(); i++) {
-		size_t ent_size = sizeof(ext2_directory) + entries[i].name_length;
-		ent_size += ent_size % 4 ? 4 - ent_size % 4 : 0; //4-byte align
-		new_filesize += ent_size;
+		size_t ent_size = EXT2_DIRENT_SIZE(entries[i].name_length);
+		if(cur_byte_in_block + ent_size > block_size) {
+			num_dir_blocks++;
+			cur_byte_in_block = 0;
+		}
+		cur_byte_in_block += ent_size;
 	}
 
-	//Account for null entry that fills the rest of the last block
-	//(and if the last entry is block-aligned, we need a whole additional block for the null entry)
-	if(new_filesize % ext2fs().block_size() == 0) new_filesize++;
-	new_filesize = ((new_filesize + ext2fs().block_size() - 1) / ext2fs().block_size()) * ext2fs().block_size();
-
 	//Resize the file to the new size
-	auto res = truncate((off_t) new_filesize);
+	auto res = truncate((off_t) (num_dir_blocks * block_size));
 	if(res.is_error())
 		return res;
 
-	//Next, write all the entries
+	//Next, write all the entries. The last entry in each block is stretched to fill the rest of it.
 	size_t cur_block = 0;
-	size_t cur_byte_in_block = 0;
-	uint8_t block_buf[ext2fs().block_size()];
+	cur_byte_in_block = 0;
+	uint8_t block_buf[block_size];
+	memset(block_buf, 0, block_size);
+	ext2_directory* last_ent = nullptr;
 
 	for(size_t i = 0; i < entries.size(); i++) {
 		DirectoryEntry& ent = entries[i];
+		size_t ent_size = EXT2_DIRENT_SIZE(ent.name_length);
 
-		ext2_directory raw_ent;
-		raw_ent.name_length = ent.name_length;
-		raw_ent.type = ent.type;
-		raw_ent.inode = ent.id;
-		raw_ent.size = sizeof(raw_ent) + raw_ent.name_length;
-		raw_ent.size += raw_ent.size % 4 ? 4 - raw_ent.size % 4 : 0; //4-byte align
-
-		if(raw_ent.size + cur_byte_in_block >= ext2fs().block_size()) {
-			ext2fs().write_block(get_block_pointer(cur_block), block_buf);
-			memset(block_buf, 0, ext2fs().block_size());
+		if(cur_byte_in_block + ent_size > block_size) {
+			last_ent->size += block_size - cur_byte_in_block;
+			ext2fs().write_metadata_block(get_block_pointer(cur_block), block_buf);
+			memset(block_buf, 0, block_size);
 			cur_block++;
 			cur_byte_in_block = 0;
 		}
 
-		memcpy(block_buf + cur_byte_in_block, &raw_ent, sizeof(raw_ent));
-		memcpy(block_buf + cur_byte_in_block + sizeof(raw_ent), ent.name, ent.name_length + 1);
+		auto* raw_ent = (ext2_directory*) (block_buf + cur_byte_in_block);
+		raw_ent->name_length = ent.name_length;
+		raw_ent->type = ent.type;
+		raw_ent->inode = ent.id;
+		raw_ent->size = ent_size;
+		memcpy(raw_ent + 1, ent.name, ent.name_length);
 
-		cur_byte_in_block += raw_ent.size;
+		last_ent = raw_ent;
+		cur_byte_in_block += ent_size;
 	}
 
-	//We need to write the null entry at the end, and if we're already at the end of the block, we need to allocate a new one
-	if(cur_byte_in_block >= ext2fs().block_size()) {
-		ext2fs().write_block(get_block_pointer(cur_block), block_buf);
-		memset(block_buf, 0, ext2fs().block_size());
-		cur_block++;
-		cur_byte_in_block = 0;
+	if(last_ent) {
+		last_ent->size += block_size - cur_byte_in_block;
+	} else {
+		//If there aren't any entries, the block is one big unused one
+		auto* end_ent = (ext2_directory*) block_buf;
+		end_ent->size = block_size;
 	}
 
-	//Make and write the null entry at the end
-	ext2_directory end_ent;
-	end_ent.size = ext2fs().block_size() - cur_byte_in_block;
-	end_ent.type = EXT2_FT_UNKNOWN;
-	end_ent.name_length = 0;
-	end_ent.inode = 0;
-	memcpy(block_buf + cur_byte_in_block, &end_ent, sizeof(end_ent));
-
 	//Write the last block
-	ext2fs().write_block(get_block_pointer(cur_block), block_buf);
+	return ext2fs().write_metadata_block(get_block_pointer(cur_block), block_buf);
+}
 
-	return Result(SUCCESS);
+bool Ext2Inode::find_entry(kstd::string_view name, DirEntryLocation& location) {
+	if(raw.flags & EXT2_INDEX) {
+		auto res = Ext2HTree(*this).find(name, location);
+		if(!res.is_error())
+			return true;
+		if(res.code() == -ENOENT)
+			return false;
+		//An indexed directory is still a valid unindexed one, so we can just look through all of it instead
+		KLog::warn("ext2", "Couldn't use the index of directory inode %d (%d)", id, res.code());
+	}
+
+	uint8_t block_buf[ext2fs().block_size()];
+	for(size_t i = 0; i < num_blocks(); i++) {
+		if(ext2fs().read_metadata_block(get_block_pointer(i), block_buf).is_error())
+			return false;
+		if(find_entry_in_block(block_buf, name, location)) {
+			location.block_index = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool Ext2Inode::find_entry_in_block(const uint8_t* block_buf, kstd::string_view name, DirEntryLocation& location) {
+	const size_t block_size = ext2fs().block_size();
+	size_t prev_offset = -1;
+	for(size_t offset = 0; offset + sizeof(ext2_directory) <= block_size;) {
+		auto* entry = (const ext2_directory*) (block_buf + offset);
+		if(entry->size < sizeof(ext2_directory) || offset + entry->size > block_size)
+			break; //Corrupt entry
+
+		if(entry->inode && entry->name_length == name.length()) {
+			auto* entry_name = (const char*) (entry + 1);
+			size_t i = 0;
+			while(i < name.length() && entry_name[i] == name[i])
+				i++;
+			if(i == name.length()) {
+				location.offset = offset;
+				location.prev_offset = prev_offset;
+				location.inode = entry->inode;
+				return true;
+			}
+		}
+
+		prev_offset = offset;
+		offset += entry->size;
+	}
+	return false;
+}
+
+bool Ext2Inode::insert_entry_in_block(uint8_t* block_buf, ino_t inode, uint8_t type, const kstd::string& name) {
+	const size_t block_size = ext2fs().block_size();
+	const size_t needed_size = EXT2_DIRENT_SIZE(name.length());
+	for(size_t offset = 0; offset + sizeof(ext2_directory) <= block_size;) {
+		auto* entry = (ext2_directory*) (block_buf + offset);
+		if(entry->size < sizeof(ext2_directory) || offset + entry->size > block_size)
+			return false; //Corrupt entry
+
+		//Look for an entry with enough slack after it for the new one, or an unused entry that's big enough
+		size_t used_size = entry->inode ? EXT2_DIRENT_SIZE(entry->name_length) : 0;
+		if(entry->size - used_size >= needed_size) {
+			auto* new_entry = entry;
+			if(used_size) {
+				new_entry = (ext2_directory*) (block_buf + offset + used_size);
+				new_entry->size = entry->size - used_size;
+				entry->size = used_size;
+			}
+			new_entry->inode = inode;
+			new_entry->type = type;
+			new_entry->name_length = name.length();
+			memcpy(new_entry + 1, name.c_str(), name.length());
+			return true;
+		}
+
+		offset += entry->size;
+	}
+	return false;
+}
+
+Result Ext2Inode::insert_entry_linear(ino_t inode, uint8_t type, const kstd::string& name) {
+	const size_t block_size = ext2fs().block_size();
+	uint8_t block_buf[block_size];
+	for(size_t i = 0; i < num_blocks(); i++) {
+		uint32_t block = get_block_pointer(i);
+		auto res = ext2fs().read_metadata_block(block, block_buf);
+		if(res.is_error())
+			return res;
+		if(insert_entry_in_block(block_buf, inode, type, name))
+			return ext2fs().write_metadata_block(block, block_buf);
+	}
+
+	//A directory that's outgrowing its first block gets an index, if the filesystem supports them
+	if(num_blocks() == 1 && (ext2fs().superblock.optional_features & EXT2_FEATURE_DIR_INDEX)) {
+		auto res = Ext2HTree::create(*this, name, inode, type);
+		if(!res.is_error() || res.code() == -EIO)
+			return res;
+	}
+
+	//Otherwise, the entry goes in a new block at the end of the directory
+	auto block_index = TRY(append_directory_block());
+	memset(block_buf, 0, block_size);
+	((ext2_directory*) block_buf)->size = block_size;
+	insert_entry_in_block(block_buf, inode, type, name);
+	return ext2fs().write_metadata_block(get_block_pointer(block_index), block_buf);
+}
+
+ResultRet<uint32_t> Ext2Inode::append_directory_block() {
+	auto res = truncate((off_t) ((num_blocks() + 1) * ext2fs().block_size()));
+	if(res.is_error())
+		return res;
+	return num_blocks() - 1;
 }
 
 void Ext2Inode::create_metadata() {
@@ -821,7 +1112,17 @@ void Ext2Inode::open(FileDescriptor& fd, int options) {
 }
 
 void Ext2Inode::close(FileDescriptor& fd) {
+	//Whoever was writing to the file is done with it, so give the blocks we set aside for them back
+	if(fd.writable()) {
+		EXT2_JOURNAL_HANDLE(ext2fs());
+		LOCK(lock);
+		discard_preallocation();
+	}
+}
 
+size_t Ext2Inode::cache_footprint() {
+	//The block pointers are the only thing that grows with the file, so don't bother locking to count them exactly
+	return sizeof(Ext2Inode) + block_runs.size() * sizeof(BlockRun) + (block_pointers.size() + pointer_blocks.size()) * sizeof(uint32_t);
 }
 
 
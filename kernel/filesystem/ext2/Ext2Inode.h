@@ -21,9 +21,13 @@
 
 #include <kernel/filesystem/Inode.h>
 #include <kernel/kstd/vector.hpp>
+#include <kernel/memory/SlabCache.h>
+#include <kernel/tasking/Mutex.h>
 
 class Ext2Filesystem;
+class Ext2HTree;
 class Ext2Inode: public Inode {
+	SLAB_ALLOCATED(Ext2Inode)
 public:
 	typedef struct __attribute__((packed)) Raw {
 		uint16_t mode = 0;
@@ -49,7 +53,8 @@ public:
 		uint32_t os_specific_2[3] = {0};
 	} Raw;
 
-	explicit Ext2Inode(Ext2Filesystem& filesystem, ino_t i);
+	/** Makes an inode from its entry in the inode table, which the filesystem reads in. **/
+	explicit Ext2Inode(Ext2Filesystem& filesystem, ino_t i, const Raw& raw);
 	explicit Ext2Inode(Ext2Filesystem& filesystem, ino_t i, const Raw& raw, kstd::vector<uint32_t>& block_pointers, ino_t parent);
 	~Ext2Inode() override;
 
@@ -67,7 +72,7 @@ public:
 	ssize_t read(size_t start, size_t length, SafePointer<uint8_t> buffer, FileDescriptor* fd) override;
 	ssize_t read_dir_entry(size_t start, SafePointer<DirectoryEntry> buffer, FileDescriptor* fd) override;
 	ssize_t write(size_t start, size_t length, SafePointer<uint8_t> buffer, FileDescriptor* fd) override;
-	ino_t find_id(const kstd::string& name) override;
+	ino_t find_id(kstd::string_view name) override;
 	Result add_entry(const kstd::string& name, Inode& inode) override;
 	ResultRet<kstd::Arc<Inode>> create_entry(const kstd::string& name, mode_t mode, uid_t uid, gid_t gid) override;
 	Result remove_entry(const kstd::string& name) override;
@@ -76,25 +81,72 @@ public:
 	Result chown(uid_t uid, gid_t gid) override;
 	void open(FileDescriptor& fd, int options) override;
 	void close(FileDescriptor& fd) override;
+	size_t cache_footprint() override;
 
 private:
+	friend class Ext2HTree;
+
+	/** Where a directory entry is on disk. **/
+	struct DirEntryLocation {
+		uint32_t block_index; //The index of the block in the directory that the entry is in
+		size_t offset; //The offset of the entry in the block
+		size_t prev_offset; //The offset of the entry before it in the block, or -1 if it's the first one
+		ino_t inode;
+	};
+
+	/** A run of blocks in the file that are also contiguous on disk. Holes in the file are runs starting at block 0. **/
+	struct BlockRun {
+		uint32_t index; //The index of the first block of the run in the file
+		uint32_t block; //The block the run starts at on disk
+		uint32_t length;
+	};
+
+	/** Finds a block pointer that isn't in the block run cache yet by reading the indirect blocks that lead to it. **/
+	uint32_t resolve_block_pointer(uint32_t block_index);
+	/** Reads a single pointer out of an indirect block. **/
+	uint32_t read_pointer(uint32_t pointer_block, uint32_t index);
+	/** Adds a run to the block run cache, merging it into its neighbors if it continues them. **/
+	void insert_block_run(const BlockRun& run);
+	/** Reads every block pointer of the file so that they can be changed. The block run cache isn't used after this. **/
+	void load_block_pointers();
+	/** Allocates blocks to add to the end of the file, using up the preallocated blocks first. **/
+	ResultRet<kstd::vector<uint32_t>> allocate_file_blocks(uint32_t num_blocks);
+	/** Frees the blocks preallocated for the file that haven't been used. **/
+	void discard_preallocation();
 	void read_singly_indirect(uint32_t singly_indirect_block, uint32_t& block_index);
 	void read_doubly_indirect(uint32_t doubly_indirect_block, uint32_t& block_index);
 	void read_triply_indirect(uint32_t triply_indirect_block, uint32_t& block_index);
-	void read_block_pointers();
 	Result write_to_disk();
 	Result write_block_pointers();
 	Result write_inode_entry();
 	Result write_directory_entries(kstd::vector<DirectoryEntry>& entries);
+	/** Finds an entry in the directory, using its index if it has one. **/
+	bool find_entry(kstd::string_view name, DirEntryLocation& location);
+	/** Finds an entry in one block of the directory. The location's block index isn't filled in. **/
+	bool find_entry_in_block(const uint8_t* block_buf, kstd::string_view name, DirEntryLocation& location);
+	/** Puts a new entry in one block of the directory, if there's room for it. **/
+	bool insert_entry_in_block(uint8_t* block_buf, ino_t inode, uint8_t type, const kstd::string& name);
+	/** Puts a new entry in the first block of the directory with room for it, ignoring the index. **/
+	Result insert_entry_linear(ino_t inode, uint8_t type, const kstd::string& name);
+	/** Adds a block to the end of the directory and returns its index. Its contents are left for the caller to write. **/
+	ResultRet<uint32_t> append_directory_block();
 	void create_metadata();
 	void reduce_hardlink_count();
 	void increase_hardlink_count();
 	Result try_remove_dir();
 	uint32_t calculate_num_ptr_blocks(uint32_t num_blocks);
 
+	//Until the block pointers need to be changed, they're looked up lazily and cached as runs sorted by index
+	kstd::vector<BlockRun> block_runs;
+	Mutex block_runs_lock;
+	bool block_pointers_loaded = false;
 	kstd::vector<uint32_t> block_pointers;
 	kstd::vector<uint32_t> pointer_blocks;
 
+	//Blocks directly after the last block of the file that are allocated for it, but aren't part of it yet
+	uint32_t prealloc_block = 0;
+	uint32_t prealloc_count = 0;
+
 	Raw raw;
 	bool _dirty = false;
 };
@@ -0,0 +1,473 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Ext2Journal.h"
+#include "Ext2Filesystem.h"
+#include "Ext2BlockGroup.h"
+#include "Ext2Inode.h"
+#include <kernel/filesystem/FileDescriptor.h>
+#include <kernel/filesystem/File.h>
+#include <kernel/kstd/cstring.h>
+#include <kernel/kstd/KLog.h>
+#include <kernel/kstd/utility.h>
+
+//Everything in the journal is big-endian, so this converts to and from it
+static inline uint32_t be32(uint32_t value) {
+	return __builtin_bswap32(value);
+}
+
+Ext2Journal::Handle::Handle(Ext2Journal* journal): m_journal(journal) {
+	if(!m_journal)
+		return;
+
+	//Commit the running transaction if it's getting too big for the log. An operation that's already in it can't wait
+	//for it to be committed though, since the commit would be waiting on the operation too.
+	if(!m_journal->m_transaction_lock.held_for_reading()) {
+		size_t num_blocks;
+		{
+			LOCK(m_journal->m_lock);
+			num_blocks = m_journal->m_running->buffers.size();
+		}
+		if(num_blocks >= m_journal->m_max_transaction_blocks)
+			m_journal->commit();
+	}
+
+	m_journal->m_transaction_lock.acquire_read();
+}
+
+Ext2Journal::Handle::~Handle() {
+	if(m_journal)
+		m_journal->m_transaction_lock.release_read();
+}
+
+Ext2Journal::Transaction::~Transaction() {
+	for(auto& entry : buffers)
+		delete[] entry.second.data;
+}
+
+Ext2Journal::Ext2Journal(Ext2Filesystem& fs): m_fs(fs), m_block_size(fs.block_size()), m_running(new Transaction()) {}
+
+Ext2Journal::~Ext2Journal() {
+	delete m_running;
+	delete m_committing;
+}
+
+ResultRet<Ext2Journal*> Ext2Journal::load(Ext2Filesystem& fs) {
+	auto& superblock = fs.superblock;
+	if(!superblock.journal_inode || superblock.journal_device) {
+		KLog::warn("ext2", "Journals on other devices aren't supported");
+		return Result(-ENOTSUP);
+	}
+
+	//Read the journal's inode straight out of the inode table, since nothing should be cached before it's replayed
+	ino_t journal_ino = superblock.journal_inode;
+	uint32_t index = (journal_ino - 1) % superblock.inodes_per_group;
+	Ext2BlockGroup* bg = fs.get_block_group((journal_ino - 1) / superblock.inodes_per_group);
+	if(!bg)
+		return Result(-EIO);
+	uint8_t block_buf[fs.block_size()];
+	auto res = fs.read_block(bg->inode_table_block + index / fs.inodes_per_block, block_buf);
+	if(res.is_error())
+		return res;
+	auto& raw = *(Ext2Inode::Raw*) (block_buf + (index % fs.inodes_per_block) * superblock.inode_size);
+
+	auto* journal = new Ext2Journal(fs);
+	{
+		kstd::Arc<Ext2Inode> inode(new Ext2Inode(fs, journal_ino, raw));
+		journal->m_block_map = inode->get_block_pointers();
+	}
+
+	//Then read the journal's superblock and make sure we know how to use it
+	auto fail = [&](const char* reason, int code) -> Result {
+		KLog::warn("ext2", "Can't use the journal: %s", reason);
+		delete journal;
+		return Result(code);
+	};
+	if(journal->m_block_map.empty() || journal->read_log_block(0, block_buf).is_error())
+		return fail("Couldn't read its superblock", -EIO);
+	auto* jsb = (jbd_superblock*) block_buf;
+	if(be32(jsb->header.magic) != JBD_MAGIC)
+		return fail("Its superblock is invalid", -EINVAL);
+	if(be32(jsb->header.type) != JBD_SUPERBLOCK_V2)
+		return fail("Only version 2 journals are supported", -ENOTSUP);
+	if(be32(jsb->feature_incompat) & ~JBD_FEATURE_INCOMPAT_REVOKE)
+		return fail("It uses features that aren't supported", -ENOTSUP);
+	if(be32(jsb->block_size) != fs.block_size())
+		return fail("Its block size doesn't match the filesystem's", -EINVAL);
+	if(be32(jsb->max_length) > journal->m_block_map.size() || !be32(jsb->first) || be32(jsb->first) >= be32(jsb->max_length))
+		return fail("Its size is invalid", -EINVAL);
+
+	journal->m_first = be32(jsb->first);
+	journal->m_max_length = be32(jsb->max_length);
+	journal->m_sequence = be32(jsb->sequence);
+	journal->m_head = journal->m_first;
+	journal->m_tail = be32(jsb->start);
+	memcpy(journal->m_uuid, jsb->uuid, sizeof(journal->m_uuid));
+	journal->m_tags_per_descriptor = (fs.block_size() - sizeof(jbd_header) - sizeof(journal->m_uuid)) / sizeof(jbd_block_tag);
+	journal->m_revokes_per_block = (fs.block_size() - sizeof(jbd_revoke_header)) / sizeof(uint32_t);
+	journal->m_max_transaction_blocks = (journal->m_max_length - journal->m_first) / 4;
+	return journal;
+}
+
+ResultRet<size_t> Ext2Journal::recover() {
+	LOCK(m_commit_lock);
+
+	size_t num_replayed = 0;
+	if(m_tail) {
+		//Like JBD, this takes three passes: one to find the last transaction that was committed, one to find the blocks
+		//that were revoked by then, and then one to replay everything else
+		kstd::unordered_map<uint32_t, uint32_t> revoked;
+		auto end_res = recovery_pass(RecoveryPass::Scan, 0, revoked, num_replayed);
+		if(end_res.is_error())
+			return end_res.result();
+		uint32_t end = end_res.value();
+		auto res = recovery_pass(RecoveryPass::Revoke, end, revoked, num_replayed);
+		if(res.is_error())
+			return res.result();
+		res = recovery_pass(RecoveryPass::Replay, end, revoked, num_replayed);
+		if(res.is_error())
+			return res.result();
+
+		//Skip a number, so what's left of the transaction that was being committed can't be mistaken for the next one
+		m_sequence = end + 1;
+	}
+
+	auto res = empty_log();
+	if(res.is_error())
+		return res;
+	return num_replayed;
+}
+
+ResultRet<uint32_t> Ext2Journal::recovery_pass(RecoveryPass pass, uint32_t end_sequence, kstd::unordered_map<uint32_t, uint32_t>& revoked, size_t& num_replayed) {
+	uint8_t block_buf[m_block_size];
+	uint8_t data_buf[m_block_size];
+	uint32_t sequence = m_sequence;
+	uint32_t pos = m_tail;
+
+	//Go through the log until we get to a block that isn't from the transaction we expect next
+	while(pass == RecoveryPass::Scan || (int32_t) (end_sequence - sequence) > 0) {
+		auto res = read_log_block(pos, block_buf);
+		if(res.is_error())
+			return res;
+		auto* header = (jbd_header*) block_buf;
+		if(be32(header->magic) != JBD_MAGIC || be32(header->sequence) != sequence)
+			break;
+		pos = next_log_block(pos);
+
+		uint32_t type = be32(header->type);
+		if(type == JBD_DESCRIPTOR_BLOCK) {
+			//The descriptor is followed by the blocks its tags describe
+			for(size_t offset = sizeof(jbd_header); offset + sizeof(jbd_block_tag) <= m_block_size;) {
+				auto* tag = (jbd_block_tag*) (block_buf + offset);
+				uint32_t block = be32(tag->block);
+				uint32_t flags = be32(tag->flags);
+
+				//Blocks are replayed unless they were revoked in this transaction or a later one
+				auto* revoked_sequence = revoked.get(block);
+				if(pass == RecoveryPass::Replay && (!revoked_sequence || (int32_t) (sequence - *revoked_sequence) > 0)) {
+					res = read_log_block(pos, data_buf);
+					if(res.is_error())
+						return res;
+					if(flags & JBD_FLAG_ESCAPE)
+						*(uint32_t*) data_buf = be32(JBD_MAGIC);
+					res = m_fs.write_block(block, data_buf);
+					if(res.is_error())
+						return res;
+					num_replayed++;
+				}
+
+				pos = next_log_block(pos);
+				offset += sizeof(jbd_block_tag) + ((flags & JBD_FLAG_SAME_UUID) ? 0 : sizeof(m_uuid));
+				if(flags & JBD_FLAG_LAST_TAG)
+					break;
+			}
+		} else if(type == JBD_COMMIT_BLOCK) {
+			sequence++;
+		} else if(type == JBD_REVOKE_BLOCK) {
+			if(pass != RecoveryPass::Revoke)
+				continue;
+			size_t count = min((size_t) be32(((jbd_revoke_header*) block_buf)->count), m_block_size);
+			for(size_t offset = sizeof(jbd_revoke_header); offset + sizeof(uint32_t) <= count; offset += sizeof(uint32_t)) {
+				uint32_t block = be32(*(uint32_t*) (block_buf + offset));
+				auto* revoked_sequence = revoked.get(block);
+				if(!revoked_sequence || (int32_t) (sequence - *revoked_sequence) > 0)
+					revoked[block] = sequence;
+			}
+		} else {
+			break;
+		}
+	}
+
+	return sequence;
+}
+
+bool Ext2Journal::read_block(uint32_t block, uint8_t* buffer) {
+	LOCK(m_lock);
+	auto* buf = m_running->buffers.get(block);
+	if(!buf && m_committing) {
+		buf = m_committing->buffers.get(block);
+		if(buf && buf->forgotten)
+			buf = nullptr;
+	}
+	if(!buf)
+		return false;
+	memcpy(buffer, buf->data, m_block_size);
+	return true;
+}
+
+void Ext2Journal::write_block(uint32_t block, const uint8_t* buffer) {
+	LOCK(m_lock);
+	auto* buf = m_running->buffers.get(block);
+	if(!buf) {
+		buf = &m_running->buffers.insert(kstd::pair<uint32_t, Buffer>(block, {new uint8_t[m_block_size], false}))->second;
+		//It's metadata again, so it's fine to replay what was logged for it before now
+		m_running->revoked.erase(block);
+	}
+	memcpy(buf->data, buffer, m_block_size);
+}
+
+void Ext2Journal::forget_block(uint32_t block) {
+	LOCK(m_lock);
+	auto* buf = m_running->buffers.get(block);
+	if(buf) {
+		delete[] buf->data;
+		m_running->buffers.erase(block);
+	}
+
+	bool in_log = m_tail_blocks.contains(block);
+	if(m_committing) {
+		buf = m_committing->buffers.get(block);
+		if(buf) {
+			buf->forgotten = true;
+			in_log = true;
+		}
+	}
+
+	//If the block was logged, replaying the log could write over whatever it gets used for next
+	if(in_log)
+		m_running->revoked.insert(block);
+}
+
+Result Ext2Journal::commit() {
+	LOCK(m_commit_lock);
+
+	//Wait for the operations in the running transaction to finish, and then close it so new ones go in the next one
+	Transaction* transaction = nullptr;
+	{
+		LOCK(m_transaction_lock);
+		m_fs.write_free_counts();
+		LOCK_N(m_lock, buffers_locker);
+		if(!m_running->buffers.empty() || !m_running->revoked.empty()) {
+			transaction = m_running;
+			m_committing = transaction;
+			m_running = new Transaction();
+		}
+	}
+
+	//If nothing's happened since the last commit, it's on disk by now, so the log doesn't need to be replayed anymore
+	if(!transaction)
+		return m_tail ? empty_log() : Result(SUCCESS);
+
+	uint32_t sequence = m_sequence++;
+	size_t log_size = transaction_log_size(*transaction);
+	Result result = Result(SUCCESS);
+	if(log_size >= m_max_length - m_first) {
+		//Operations commit the running transaction long before it gets this big, so this shouldn't happen
+		KLog::warn("ext2", "Transaction %d is too big for the journal (%d blocks), so it won't be journaled", sequence, log_size);
+		result = empty_log();
+	} else {
+		//If it doesn't fit in the log after the transaction at the tail, make sure that one's on disk and start over
+		if(log_size > free_log_blocks()) {
+			result = flush_device();
+			LOCK(m_lock);
+			m_tail = 0;
+			m_head = m_first;
+			m_tail_blocks.clear();
+		}
+
+		uint32_t start = m_head;
+		uint32_t pos = start;
+		if(!result.is_error())
+			result = write_transaction(*transaction, sequence, pos);
+
+		//In ordered mode, file data goes out before the commit block so that committed metadata never points to garbage.
+		//This also gets the transaction at the tail of the log on disk, so the log can start at this one once it's done.
+		if(!result.is_error())
+			result = flush_device();
+
+		if(!result.is_error()) {
+			uint8_t block_buf[m_block_size];
+			memset(block_buf, 0, m_block_size);
+			auto* header = (jbd_header*) block_buf;
+			header->magic = be32(JBD_MAGIC);
+			header->type = be32(JBD_COMMIT_BLOCK);
+			header->sequence = be32(sequence);
+			result = write_log_block(pos, block_buf);
+		}
+		if(!result.is_error())
+			result = write_superblock(start, sequence);
+		if(!result.is_error())
+			result = flush_device();
+
+		if(!result.is_error()) {
+			LOCK(m_lock);
+			m_head = next_log_block(pos);
+			m_tail = start;
+			m_tail_blocks.clear();
+			for(auto& entry : transaction->buffers)
+				m_tail_blocks.insert(entry.first);
+		}
+	}
+
+	if(result.is_error())
+		KLog::err("ext2", "Error %d committing transaction %d to the journal", result.code(), sequence);
+
+	//Now the blocks can go where they belong, and the disk's flusher can write them out whenever
+	checkpoint(*transaction);
+	{
+		LOCK(m_lock);
+		m_committing = nullptr;
+	}
+	delete transaction;
+	return result;
+}
+
+Result Ext2Journal::write_transaction(Transaction& transaction, uint32_t sequence, uint32_t& pos) {
+	uint8_t block_buf[m_block_size];
+	uint8_t data_buf[m_block_size];
+	auto start_block = [&](uint32_t type) {
+		memset(block_buf, 0, m_block_size);
+		auto* header = (jbd_header*) block_buf;
+		header->magic = be32(JBD_MAGIC);
+		header->type = be32(type);
+		header->sequence = be32(sequence);
+	};
+
+	//Revoke records go first
+	for(auto revoked = transaction.revoked.begin(); revoked != transaction.revoked.end();) {
+		start_block(JBD_REVOKE_BLOCK);
+		size_t offset = sizeof(jbd_revoke_header);
+		for(; revoked != transaction.revoked.end() && offset + sizeof(uint32_t) <= m_block_size; ++revoked) {
+			*(uint32_t*) (block_buf + offset) = be32(*revoked);
+			offset += sizeof(uint32_t);
+		}
+		((jbd_revoke_header*) block_buf)->count = be32(offset);
+		auto res = write_log_block(pos, block_buf);
+		if(res.is_error())
+			return res;
+		pos = next_log_block(pos);
+	}
+
+	//Then each descriptor, followed by the blocks it describes
+	for(auto buffer = transaction.buffers.begin(); buffer != transaction.buffers.end();) {
+		start_block(JBD_DESCRIPTOR_BLOCK);
+		uint32_t descriptor_pos = pos;
+		pos = next_log_block(pos);
+
+		size_t offset = sizeof(jbd_header);
+		jbd_block_tag* tag = nullptr;
+		for(size_t i = 0; i < m_tags_per_descriptor && buffer != transaction.buffers.end(); i++, ++buffer) {
+			//Blocks that start with the journal's magic number have it zeroed out, so they aren't mistaken for headers
+			uint32_t flags = i ? JBD_FLAG_SAME_UUID : 0;
+			memcpy(data_buf, buffer->second.data, m_block_size);
+			if(*(uint32_t*) data_buf == be32(JBD_MAGIC)) {
+				*(uint32_t*) data_buf = 0;
+				flags |= JBD_FLAG_ESCAPE;
+			}
+			auto res = write_log_block(pos, data_buf);
+			if(res.is_error())
+				return res;
+			pos = next_log_block(pos);
+
+			tag = (jbd_block_tag*) (block_buf + offset);
+			tag->block = be32(buffer->first);
+			tag->flags = be32(flags);
+			offset += sizeof(jbd_block_tag);
+
+			//Only the first tag is followed by the journal's UUID
+			if(!i) {
+				memcpy(block_buf + offset, m_uuid, sizeof(m_uuid));
+				offset += sizeof(m_uuid);
+			}
+		}
+
+		tag->flags |= be32(JBD_FLAG_LAST_TAG);
+		auto res = write_log_block(descriptor_pos, block_buf);
+		if(res.is_error())
+			return res;
+	}
+
+	return Result(SUCCESS);
+}
+
+void Ext2Journal::checkpoint(Transaction& transaction) {
+	for(auto& entry : transaction.buffers) {
+		//The lock is held while writing so the block can't be freed and reused for something else in the middle of it
+		LOCK(m_lock);
+		if(!entry.second.forgotten)
+			m_fs.write_block(entry.first, entry.second.data);
+	}
+}
+
+Result Ext2Journal::write_superblock(uint32_t start, uint32_t sequence) {
+	uint8_t block_buf[m_block_size];
+	auto res = read_log_block(0, block_buf);
+	if(res.is_error())
+		return res;
+
+	auto* jsb = (jbd_superblock*) block_buf;
+	jsb->start = be32(start);
+	jsb->sequence = be32(sequence);
+	//We don't checksum commit blocks, and may write revoke records
+	jsb->feature_compat = 0;
+	jsb->feature_incompat |= be32(JBD_FEATURE_INCOMPAT_REVOKE);
+	return write_log_block(0, block_buf);
+}
+
+Result Ext2Journal::flush_device() {
+	return m_fs._file->file()->sync();
+}
+
+Result Ext2Journal::empty_log() {
+	auto res = flush_device();
+	if(res.is_error())
+		return res;
+	res = write_superblock(0, m_sequence);
+	if(res.is_error())
+		return res;
+	res = flush_device();
+	if(res.is_error())
+		return res;
+
+	LOCK(m_lock);
+	m_tail = 0;
+	m_head = m_first;
+	m_tail_blocks.clear();
+	return Result(SUCCESS);
+}
+
+Result Ext2Journal::read_log_block(uint32_t index, uint8_t* buffer) {
+	if(index >= m_block_map.size() || !m_block_map[index])
+		return Result(-EIO);
+	return m_fs.read_block(m_block_map[index], buffer);
+}
+
+Result Ext2Journal::write_log_block(uint32_t index, const uint8_t* buffer) {
+	if(index >= m_block_map.size() || !m_block_map[index])
+		return Result(-EIO);
+	return m_fs.write_block(m_block_map[index], buffer);
+}
+
+size_t Ext2Journal::free_log_blocks() const {
+	size_t log_length = m_max_length - m_first;
+	if(!m_tail)
+		return log_length;
+	size_t used = m_head >= m_tail ? m_head - m_tail : log_length - (m_tail - m_head);
+	return log_length - used;
+}
+
+size_t Ext2Journal::transaction_log_size(const Transaction& transaction) const {
+	return kstd::ceil_div(transaction.revoked.size(), m_revokes_per_block)
+		+ kstd::ceil_div(transaction.buffers.size(), m_tags_per_descriptor)
+		+ transaction.buffers.size() + 1;
+}
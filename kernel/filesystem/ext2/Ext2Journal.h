@@ -0,0 +1,136 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/Result.hpp>
+#include <kernel/tasking/SpinLock.h>
+#include <kernel/tasking/Mutex.h>
+#include <kernel/tasking/RWLock.h>
+#include <kernel/kstd/vector.hpp>
+#include <kernel/kstd/unordered_map.hpp>
+#include <kernel/kstd/unordered_set.hpp>
+#include "Ext2.h"
+
+/**
+ * Keeps the metadata changes an operation makes in the same transaction, by holding off commits until it's done. Must
+ * be started before taking any inode locks or the filesystem's lock, since a commit waiting on another operation would
+ * otherwise keep this one from finishing. Does nothing if the filesystem doesn't have a journal.
+ */
+#define EXT2_JOURNAL_HANDLE(fs) Ext2Journal::Handle __journal_handle((fs).journal())
+
+class Ext2Filesystem;
+
+/**
+ * An ext3-compatible journal kept in the filesystem's journal inode, in ordered data mode.
+ *
+ * Metadata blocks written while the filesystem is in use are held in memory in the running transaction, instead of
+ * being written to where they go. Every so often the running transaction is committed: file data is written out to disk
+ * first, then the transaction's blocks are written to the log together and followed by a commit block, and only then
+ * are they written to where they go on disk. After a crash, the committed transactions in the log are replayed when the
+ * filesystem is mounted, so the metadata is never left half-written.
+ *
+ * The log holds at most the transaction being committed and the one before it, whose blocks may not have all made it
+ * to disk yet. Each commit flushes the disk's cache before its commit block is written, so by then the transaction
+ * before it is safely on disk and the start of the log can be moved up to the new one.
+ */
+class Ext2Journal {
+public:
+	/** See EXT2_JOURNAL_HANDLE. **/
+	class Handle {
+	public:
+		explicit Handle(Ext2Journal* journal);
+		~Handle();
+
+	private:
+		Ext2Journal* m_journal;
+	};
+
+	/** Reads in the filesystem's journal. It should be recovered before the filesystem is used. **/
+	static ResultRet<Ext2Journal*> load(Ext2Filesystem& fs);
+	~Ext2Journal();
+
+	/**
+	 * Replays the transactions that were committed to the log but may not have been written to where they go, and then
+	 * empties the log. Returns the number of blocks that were replayed.
+	 */
+	ResultRet<size_t> recover();
+
+	/**
+	 * Reads a block that's been written to in a transaction that hasn't been written to where it goes yet. Returns false
+	 * if it isn't in one, in which case it should be read from the disk.
+	 */
+	bool read_block(uint32_t block, uint8_t* buffer);
+	/** Writes a metadata block into the running transaction. **/
+	void write_block(uint32_t block, const uint8_t* buffer);
+	/** Called when a block is freed, so that metadata that was written to it won't be written over what it's used for next. **/
+	void forget_block(uint32_t block);
+
+	/**
+	 * Commits the running transaction, along with everything that every operation in it has written. If there's nothing
+	 * to commit, the log is emptied so nothing will be replayed the next time the filesystem is mounted.
+	 */
+	Result commit();
+
+private:
+	explicit Ext2Journal(Ext2Filesystem& fs);
+
+	struct Buffer {
+		uint8_t* data;
+		bool forgotten; ///< Whether the block was freed while its transaction was being committed.
+	};
+
+	struct Transaction {
+		~Transaction();
+		kstd::unordered_map<uint32_t, Buffer> buffers;
+		kstd::unordered_set<uint32_t> revoked; ///< Blocks freed while still in the log, which shouldn't be replayed.
+	};
+
+	enum class RecoveryPass {
+		Scan, ///< Finds the end of the last committed transaction.
+		Revoke, ///< Finds the blocks that shouldn't be replayed.
+		Replay ///< Writes the blocks in the log to where they go.
+	};
+
+	/** Goes through the committed transactions in the log. Returns the sequence number after the last one. **/
+	ResultRet<uint32_t> recovery_pass(RecoveryPass pass, uint32_t end_sequence, kstd::unordered_map<uint32_t, uint32_t>& revoked, size_t& num_replayed);
+	/** Writes a transaction's revoke records, descriptors and blocks to the log, leaving pos where its commit block goes. **/
+	Result write_transaction(Transaction& transaction, uint32_t sequence, uint32_t& pos);
+	/** Writes the blocks of a committed transaction to where they go, through the disk's cache. **/
+	void checkpoint(Transaction& transaction);
+	/** Points the journal's superblock at where the log starts, or 0 if there's nothing to replay. **/
+	Result write_superblock(uint32_t start, uint32_t sequence);
+	/** Writes everything in the disk's cache out to disk. **/
+	Result flush_device();
+	/** Empties the log. The transaction in it must be in the disk's cache. **/
+	Result empty_log();
+
+	Result read_log_block(uint32_t index, uint8_t* buffer);
+	Result write_log_block(uint32_t index, const uint8_t* buffer);
+	uint32_t next_log_block(uint32_t index) const { return index + 1 >= m_max_length ? m_first : index + 1; }
+	/** The number of blocks in the log that aren't used by the transaction at the start of it. **/
+	size_t free_log_blocks() const;
+	/** The number of blocks a transaction will take up in the log. **/
+	size_t transaction_log_size(const Transaction& transaction) const;
+
+	Ext2Filesystem& m_fs;
+	size_t m_block_size;
+	kstd::vector<uint32_t> m_block_map; ///< The block each block of the journal is at on disk.
+	uint32_t m_first = 0; ///< The first block of the log in the journal.
+	uint32_t m_max_length = 0; ///< The number of blocks in the journal.
+	uint8_t m_uuid[16];
+	size_t m_tags_per_descriptor;
+	size_t m_revokes_per_block;
+	size_t m_max_transaction_blocks; ///< Operations commit the running transaction before starting once it's this big.
+
+	uint32_t m_sequence = 0; ///< The sequence number of the next transaction to be committed.
+	uint32_t m_head = 0; ///< Where in the log the next transaction will be written.
+	uint32_t m_tail = 0; ///< Where in the log the transaction that may still be replayed starts, or 0 if there isn't one.
+	kstd::unordered_set<uint32_t> m_tail_blocks; ///< The blocks in the transaction at the tail of the log.
+
+	Transaction* m_running = nullptr;
+	Transaction* m_committing = nullptr;
+	SpinLock m_lock; ///< Protects the transactions' buffers.
+	RWLock m_transaction_lock; ///< Held for reading by operations and for writing while closing the running transaction.
+	Mutex m_commit_lock;
+};
@@ -39,16 +39,25 @@ ProcFS::ProcFS() {
 	entries.push_back(ProcFSEntry(RootMemInfo, 0));
 	entries.push_back(ProcFSEntry(RootUptime, 0));
 	entries.push_back(ProcFSEntry(RootCpuInfo, 0));
+	entries.push_back(ProcFSEntry(RootSchedTrace, 0));
+	entries.push_back(ProcFSEntry(RootTrace, 0));
+	entries.push_back(ProcFSEntry(RootSyscalls, 0));
+	entries.push_back(ProcFSEntry(RootBoot, 0));
+	entries.push_back(ProcFSEntry(RootBuddyInfo, 0));
+	entries.push_back(ProcFSEntry(RootSoundInfo, 0));
+	entries.push_back(ProcFSEntry(RootProcs, 0));
+	entries.push_back(ProcFSEntry(RootKallsyms, 0));
+	entries.push_back(ProcFSEntry(RootZRAMInfo, 0));
 
 	root_inode = kstd::make_shared<ProcFSInode>(*this, entries[0]);
 }
 
 ino_t ProcFS::id_for_entry(pid_t pid, ProcFSInodeType type) {
-	return (type & 0xFu) | ((unsigned)pid << 8u);
+	return (type & 0xFFu) | ((unsigned)pid << 8u);
 }
 
 ProcFSInodeType ProcFS::type_for_id(ino_t id) {
-	return static_cast<ProcFSInodeType>(id & 0xFu);
+	return static_cast<ProcFSInodeType>(id & 0xFFu);
 }
 
 pid_t ProcFS::pid_for_id(ino_t id) {
@@ -64,15 +73,18 @@ void ProcFS::proc_add(Process* proc) {
 	entries.push_back(ProcFSEntry(ProcExe, pid));
 	entries.push_back(ProcFSEntry(ProcCwd, pid));
 	entries.push_back(ProcFSEntry(ProcStatus, pid));
+	entries.push_back(ProcFSEntry(ProcSched, pid));
+	entries.push_back(ProcFSEntry(ProcSyscalls, pid));
 }
 
 void ProcFS::proc_remove(Process* proc) {
 	pid_t pid = proc->pid();
-	for(size_t i = 0; i < entries.size(); i++) {
-		if(entries[i].pid == pid) {
+	auto proc_dir = id_for_entry(pid, RootProcEntry);
+	for(size_t i = 0; i < entries.size();) {
+		if(entries[i].dir_entry.id == proc_dir || entries[i].parent == proc_dir)
 			entries.erase(i);
-			break;
-		}
+		else
+			i++;
 	}
 }
 
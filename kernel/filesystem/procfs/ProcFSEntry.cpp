@@ -75,6 +75,60 @@ ProcFSEntry::ProcFSEntry(ProcFSInodeType type, pid_t pid): type(type), pid(pid)
 			parent = 1;
 			break;
 
+		case RootSchedTrace:
+			name = "schedtrace";
+			dirent_type = TYPE_FILE;
+			parent = 1;
+			break;
+
+		case RootTrace:
+			name = "trace";
+			dirent_type = TYPE_FILE;
+			parent = 1;
+			break;
+
+		case RootSyscalls:
+			name = "syscalls";
+			dirent_type = TYPE_FILE;
+			parent = 1;
+			break;
+
+		case RootBoot:
+			name = "boot";
+			dirent_type = TYPE_FILE;
+			parent = 1;
+			break;
+
+		case RootBuddyInfo:
+			name = "buddyinfo";
+			dirent_type = TYPE_FILE;
+			parent = 1;
+			break;
+
+		case RootSoundInfo:
+			name = "soundinfo";
+			dirent_type = TYPE_FILE;
+			parent = 1;
+			break;
+
+		case RootProcs:
+			name = "procs";
+			dirent_type = TYPE_FILE;
+			parent = 1;
+			break;
+
+		case RootKallsyms:
+			name = "kallsyms";
+			dirent_type = TYPE_FILE;
+			parent = 1;
+			break;
+
+		case RootZRAMInfo:
+			name = "zraminfo";
+			dirent_type = TYPE_FILE;
+			parent = 1;
+			break;
+
 		case ProcCwd:
 			name = "cwd";
 			dirent_type = TYPE_SYMLINK;
@@ -92,6 +146,18 @@ ProcFSEntry::ProcFSEntry(ProcFSInodeType type, pid_t pid): type(type), pid(pid)
 			dirent_type = TYPE_FILE;
 			parent = ProcFS::id_for_entry(pid, RootProcEntry);
 			break;
+
+		case ProcSched:
+			name = "sched";
+			dirent_type = TYPE_FILE;
+			parent = ProcFS::id_for_entry(pid, RootProcEntry);
+			break;
+
+		case ProcSyscalls:
+			name = "syscalls";
+			dirent_type = TYPE_FILE;
+			parent = ProcFS::id_for_entry(pid, RootProcEntry);
+			break;
 	}
 
 	dir_entry = DirectoryEntry(ProcFS::id_for_entry(pid, type), dirent_type, name);
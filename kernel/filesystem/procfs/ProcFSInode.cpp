@@ -30,10 +30,34 @@
 #include <kernel/kstd/cstring.h>
 #include <kernel/tasking/Process.h>
 #include <kernel/memory/PageDirectory.h>
+#include <kernel/memory/VMSpace.h>
 #include <kernel/device/DiskDevice.h>
+#include <kernel/tasking/SchedTrace.h>
+#include <kernel/Trace.h>
+#include <kernel/KernelMapper.h>
+#include <kernel/syscall/SyscallStats.h>
+#include <kernel/BootTimeline.h>
+#include <kernel/memory/SlabCache.h>
+#include <kernel/memory/Swap.h>
+#include <kernel/memory/PageMerger.h>
+#include <kernel/filesystem/FileBasedFilesystem.h>
+#include <kernel/device/AC97Device.h>
+#include <kernel/device/ZRAMDevice.h>
+#include <kernel/api/procinfo.h>
 
 const char* PROC_STATE_NAMES[] = {"Running", "Zombie", "Dead", "Sleeping"};
 
+static void append_u64(kstd::string& str, uint64_t num) {
+	char buf[21];
+	char* p = buf + sizeof(buf) - 1;
+	*p = '\0';
+	do {
+		*--p = '0' + (num % 10);
+		num /= 10;
+	} while(num);
+	str += p;
+}
+
 ProcFSInode::ProcFSInode(ProcFS& fs, ProcFSEntry& entry): Inode(fs, entry.dir_entry.id), procfs(fs), pid(entry.pid), type(entry.type), parent(entry.parent) {
 	switch(entry.dir_entry.type) {
 		case TYPE_SYMLINK:
@@ -47,6 +71,10 @@ ProcFSInode::ProcFSInode(ProcFS& fs, ProcFSEntry& entry): Inode(fs, entry.dir_en
 			_metadata.mode |= MODE_FILE | PERM_G_R | PERM_U_R | PERM_O_R;
 			break;
 	}
+
+	// Only root can see or change the trace, since it shows what every process is doing
+	if(type == RootTrace)
+		_metadata.mode = MODE_FILE | PERM_U_R | PERM_U_W;
 }
 
 ProcFSInode::~ProcFSInode() {
@@ -74,7 +102,7 @@ InodeMetadata ProcFSInode::metadata() {
 	return _metadata;
 }
 
-ino_t ProcFSInode::find_id(const kstd::string& name) {
+ino_t ProcFSInode::find_id(kstd::string_view name) {
 	for(size_t i = 0; i < procfs.entries.size(); i++) {
 		auto& e = procfs.entries[i];
 		if(e.parent == id && name == e.dir_entry.name) {
@@ -132,6 +160,67 @@ ssize_t ProcFSInode::read(size_t start, size_t length, SafePointer<uint8_t> buff
 			str += "\nkcache = ";
 			itoa((int) DiskDevice::used_cache_memory(), numbuf, 10);
 			str += numbuf;
+
+			str += "\nswap_total = ";
+			itoa((int) Swap::total_bytes(), numbuf, 10);
+			str += numbuf;
+
+			str += "\nswap_used = ";
+			itoa((int) Swap::used_bytes(), numbuf, 10);
+			str += numbuf;
+
+			str += "\nmerged = ";
+			itoa((int) (PageMerger::num_merged_pages() * PAGE_SIZE), numbuf, 10);
+			str += numbuf;
+
+			//Each slab cache is listed as "name = objects_used objects_total object_size num_slabs num_allocations"
+			str += "\n[slab]";
+			for(auto* cache = SlabCache::first_cache(); cache; cache = cache->next_cache()) {
+				auto stats = cache->stats();
+				str += "\n";
+				str += cache->name();
+				str += " =";
+				size_t values[] = {stats.objects_used, stats.objects_total, stats.object_size, stats.num_slabs, stats.num_allocations};
+				for(auto value : values) {
+					itoa((int) value, numbuf, 10);
+					str += " ";
+					str += numbuf;
+				}
+			}
+
+			//Each file-based filesystem's inode cache is listed as "mountpoint = inodes bytes max_inodes max_bytes hits misses evictions prefetches"
+			str += "\n[icache]";
+			for(auto& mount : VFS::inst().get_mounts()) {
+				if(!mount.guest_fs()->is_file_based())
+					continue;
+				auto stats = ((FileBasedFilesystem*) mount.guest_fs())->inode_cache_stats();
+				str += "\n";
+				str += mount.host_inode()->get_full_path();
+				str += " =";
+				size_t values[] = {stats.num_inodes, stats.num_bytes, stats.max_inodes, stats.max_bytes, stats.hits, stats.misses, stats.evictions, stats.prefetches};
+				for(auto value : values) {
+					itoa((int) value, numbuf, 10);
+					str += " ";
+					str += numbuf;
+				}
+			}
+
+			auto dcache_stats = VFS::inst().dentry_cache().stats();
+			str += "\n[dcache]\nentries = ";
+			itoa((int) dcache_stats.num_entries, numbuf, 10);
+			str += numbuf;
+
+			str += "\nnegative = ";
+			itoa((int) dcache_stats.num_negative, numbuf, 10);
+			str += numbuf;
+
+			str += "\nhits = ";
+			itoa((int) dcache_stats.hits, numbuf, 10);
+			str += numbuf;
+
+			str += "\nmisses = ";
+			itoa((int) dcache_stats.misses, numbuf, 10);
+			str += numbuf;
 			str += "\n";
 
 			if(start >= str.length())
@@ -231,6 +320,132 @@ ssize_t ProcFSInode::read(size_t start, size_t length, SafePointer<uint8_t> buff
 			str += "\nshmem = ";
 			itoa(proc.value()->used_shmem(), numbuf, 10);
 			str += numbuf;
+
+			str += "\nfilemem = ";
+			itoa(proc.value()->used_file_mem(), numbuf, 10);
+			str += numbuf;
+
+			str += "\nrss = ";
+			itoa(proc.value()->resident_mem(), numbuf, 10);
+			str += numbuf;
+
+			str += "\npss = ";
+			itoa(proc.value()->vm_space()->calculate_pss(), numbuf, 10);
+			str += numbuf;
+
+			str += "\nnice = ";
+			itoa(proc.value()->nice(), numbuf, 10);
+			str += numbuf;
+			str += "\n";
+
+			if(start >= str.length())
+				return 0;
+			if(start + length > str.length())
+				length = str.length() - start;
+			buffer.write((unsigned char*) str.c_str() + start, length);
+			return length;
+		}
+
+		case ProcSched: {
+			auto proc = TaskManager::process_for_pid(pid);
+			if(proc.is_error())
+				return -EIO;
+
+			kstd::string str;
+			for(auto tid : proc.value()->threads()) {
+				auto thread = proc.value()->get_thread(tid);
+				if(!thread)
+					continue;
+				auto& stats = thread->sched_stats();
+				char numbuf[12];
+
+				str += "[thread ";
+				itoa(tid, numbuf, 10);
+				str += numbuf;
+
+				str += "]\npriority = ";
+				itoa(thread->priority(), numbuf, 10);
+				str += numbuf;
+
+				str += "\nuser_us = ";
+				append_u64(str, stats.user_time);
+				str += "\nkernel_us = ";
+				append_u64(str, stats.kernel_time);
+				str += "\nrunnable_us = ";
+				append_u64(str, stats.runnable_time);
+				str += "\nmax_runnable_us = ";
+				append_u64(str, stats.max_runnable_time);
+				str += "\nblocked_us = ";
+				append_u64(str, stats.blocked_time);
+				str += "\nlast_blocked_us = ";
+				append_u64(str, stats.last_blocked_time);
+				str += "\nvoluntary_switches = ";
+				append_u64(str, stats.voluntary_switches);
+				str += "\ninvoluntary_switches = ";
+				append_u64(str, stats.involuntary_switches);
+				str += "\n";
+			}
+
+			if(start >= str.length())
+				return 0;
+			if(start + length > str.length())
+				length = str.length() - start;
+			buffer.write((unsigned char*) str.c_str() + start, length);
+			return length;
+		}
+
+		case RootSchedTrace:
+			return SchedTrace::read(start, length, buffer);
+
+		case RootTrace:
+			return Trace::read(length, buffer);
+
+		case RootKallsyms:
+			return KernelMapper::read_symbols(start, length, buffer);
+
+		case RootBoot: {
+			auto str = BootTimeline::to_string();
+			if(start >= str.length())
+				return 0;
+			if(start + length > str.length())
+				length = str.length() - start;
+			buffer.write((unsigned char*) str.c_str() + start, length);
+			return length;
+		}
+
+		case RootBuddyInfo: {
+			auto stats = MM.buddy_stats();
+			kstd::string str;
+
+			//Each order is listed as "order = free_blocks failed_allocations"
+			str += "[buddy]";
+			for(size_t order = 0; order <= BuddyZone::MAX_ORDER; order++) {
+				str += "\n";
+				append_u64(str, order);
+				str += " = ";
+				append_u64(str, stats.free_blocks[order]);
+				str += " ";
+				append_u64(str, stats.failed_allocations[order]);
+			}
+
+			//Each zone is listed as "zone = pages free_pages reserved_pages"
+			str += "\n[zones]";
+			const char* zone_names[NUM_PHYSICAL_ZONES] = {"dma", "normal"};
+			for(int zone = 0; zone < NUM_PHYSICAL_ZONES; zone++) {
+				str += "\n";
+				str += zone_names[zone];
+				str += " = ";
+				append_u64(str, MM.zone_pages((PhysicalZone) zone));
+				str += " ";
+				append_u64(str, MM.zone_free_pages((PhysicalZone) zone));
+				str += " ";
+				append_u64(str, MM.zone_reserve((PhysicalZone) zone));
+			}
+
+			str += "\n[compaction]\ncompactions = ";
+			append_u64(str, stats.num_compactions);
+			str += "\nmigrated = ";
+			append_u64(str, stats.num_migrated_pages);
 			str += "\n";
 
 			if(start >= str.length())
@@ -241,6 +456,130 @@ ssize_t ProcFSInode::read(size_t start, size_t length, SafePointer<uint8_t> buff
 			return length;
 		}
 
+		case RootSoundInfo: {
+			//Each line is "name = value", and there's nothing if there's no sound card
+			kstd::string str;
+			auto dev = Device::get_device(AC97_MAJOR, AC97_MINOR);
+			if(!dev.is_error()) {
+				auto status = kstd::static_pointer_cast<AC97Device>(dev.value())->status();
+				str += "sample_rate = ";
+				append_u64(str, status.sample_rate);
+				str += "\nmax_buffers = ";
+				append_u64(str, status.max_buffers);
+				str += "\nqueued_samples = ";
+				append_u64(str, status.queued_samples);
+				str += "\nplayed_samples = ";
+				append_u64(str, status.played_samples);
+				str += "\nunderruns = ";
+				append_u64(str, status.underruns);
+				str += "\nfifo_errors = ";
+				append_u64(str, status.fifo_errors);
+				str += "\n";
+			}
+
+			if(start >= str.length())
+				return 0;
+			if(start + length > str.length())
+				length = str.length() - start;
+			buffer.write((unsigned char*) str.c_str() + start, length);
+			return length;
+		}
+
+		case RootZRAMInfo: {
+			//Each line is "name = value", and there's nothing if the compressed RAM device isn't turned on
+			kstd::string str;
+			auto dev = Device::get_device(ZRAM_MAJOR, ZRAM_MINOR);
+			if(!dev.is_error()) {
+				auto stats = kstd::static_pointer_cast<ZRAMDevice>(dev.value())->stats();
+				str += "size = ";
+				append_u64(str, (uint64_t) stats.num_pages * PAGE_SIZE);
+				str += "\nstored_pages = ";
+				append_u64(str, stats.stored_pages);
+				str += "\nsame_filled_pages = ";
+				append_u64(str, stats.same_filled_pages);
+				str += "\nincompressible_pages = ";
+				append_u64(str, stats.incompressible_pages);
+				str += "\noriginal_bytes = ";
+				append_u64(str, (uint64_t) stats.stored_pages * PAGE_SIZE);
+				str += "\ncompressed_bytes = ";
+				append_u64(str, stats.compressed_bytes);
+				str += "\nreads = ";
+				append_u64(str, stats.num_reads);
+				str += "\nwrites = ";
+				append_u64(str, stats.num_writes);
+				str += "\n";
+			}
+
+			if(start >= str.length())
+				return 0;
+			if(start + length > str.length())
+				length = str.length() - start;
+			buffer.write((unsigned char*) str.c_str() + start, length);
+			return length;
+		}
+
+		case RootProcs: {
+			//Take the snapshot all at once, so that it's consistent as long as it's read in one go
+			kstd::vector<proc_info> infos;
+			{
+				LOCK(TaskManager::g_process_lock);
+				auto* procs = TaskManager::process_list();
+				infos.reserve(procs->size());
+				for(size_t i = 0; i < procs->size(); i++) {
+					auto* proc = procs->at(i);
+					uint64_t user_time, kernel_time;
+					proc->cpu_time(user_time, kernel_time);
+					proc_info info = {
+						.pid = proc->pid(),
+						.ppid = proc->ppid(),
+						.uid = proc->user().euid,
+						.gid = proc->user().egid,
+						.state = proc->all_threads_state(),
+						.nice = proc->nice(),
+						.pmem = proc->used_pmem(),
+						.vmem = proc->used_vmem(),
+						.shmem = proc->used_shmem(),
+						.file_mem = proc->used_file_mem(),
+						.rss = proc->resident_mem(),
+						.cpu_time = user_time + kernel_time,
+						.name = {0}
+					};
+					auto name = proc->name();
+					memcpy(info.name, name.c_str(), min(name.length(), (size_t) PROC_INFO_NAME_MAX - 1));
+					infos.push_back(info);
+				}
+			}
+
+			size_t size = infos.size() * sizeof(proc_info);
+			if(start >= size)
+				return 0;
+			if(start + length > size)
+				length = size - start;
+			buffer.write((unsigned char*) infos.storage() + start, length);
+			return length;
+		}
+
+		case RootSyscalls:
+		case ProcSyscalls: {
+			kstd::string str;
+			if(type == RootSyscalls) {
+				str = SyscallStats::global().to_string();
+			} else {
+				auto proc = TaskManager::process_for_pid(pid);
+				if(proc.is_error())
+					return -EIO;
+				auto* stats = proc.value()->syscall_stats();
+				str = stats ? stats->to_string() : SyscallStats::header();
+			}
+
+			if(start >= str.length())
+				return 0;
+			if(start + length > str.length())
+				length = str.length() - start;
+			buffer.write((unsigned char*) str.c_str() + start, length);
+			return length;
+		}
+
 		default:
 			return -EIO;
 	}
@@ -298,7 +637,19 @@ ssize_t ProcFSInode::read_dir_entry(size_t start, SafePointer<DirectoryEntry> bu
 }
 
 ssize_t ProcFSInode::write(size_t start, size_t length, SafePointer<uint8_t> buf, FileDescriptor* fd) {
-	return -EIO;
+	if(type != RootTrace)
+		return -EIO;
+
+	// Writing a mask to the trace enables the tracepoints whose bits are set
+	char str[16];
+	if(length >= sizeof(str))
+		return -EINVAL;
+	buf.read((uint8_t*) str, length);
+	uint32_t mask;
+	if(!Trace::parse_mask(str, length, mask))
+		return -EINVAL;
+	Trace::set_enabled_mask(mask);
+	return length;
 }
 
 Result ProcFSInode::add_entry(const kstd::string& name, Inode& inode) {
@@ -30,10 +30,21 @@ enum ProcFSInodeType {
 	RootCmdLine,
 	RootUptime,
 	RootCpuInfo,
+	RootSchedTrace,
+	RootTrace,
+	RootSyscalls,
+	RootBoot,
+	RootBuddyInfo,
+	RootSoundInfo,
+	RootProcs,
+	RootKallsyms,
+	RootZRAMInfo,
 
 	//Process entries
 	ProcExe,
 	ProcCwd,
-	ProcStatus
+	ProcStatus,
+	ProcSched,
+	ProcSyscalls
 };
 
@@ -69,7 +69,7 @@ InodeMetadata PTYFSInode::metadata() {
 	return ret;
 }
 
-ino_t PTYFSInode::find_id(const kstd::string& name) {
+ino_t PTYFSInode::find_id(kstd::string_view name) {
 	LOCK(ptyfs._lock);
 	for(size_t i = 1; i < ptyfs._entries.size(); i++) {
 		if(name == ptyfs._entries[i]->dir_entry.name)
@@ -121,6 +121,12 @@ bool PTYFSInode::can_read(const FileDescriptor& fd) {
 	return _pty->can_read(fd);
 }
 
+WaitQueue& PTYFSInode::poll_queue() {
+	if(_pty)
+		return _pty->poll_queue();
+	return Inode::poll_queue();
+}
+
 Result PTYFSInode::add_entry(const kstd::string& name, Inode& inode) { return Result(-EROFS); }
 ResultRet<kstd::Arc<Inode>> PTYFSInode::create_entry(const kstd::string& name, mode_t mode, uid_t uid, gid_t gid) { return Result(-EROFS); }
 Result PTYFSInode::remove_entry(const kstd::string& name) { return Result(-EROFS); }
@@ -38,7 +38,7 @@ public:
 
 	//Inode
 	InodeMetadata metadata() override;
-	ino_t find_id(const kstd::string& name) override;
+	ino_t find_id(kstd::string_view name) override;
 	ssize_t read(size_t start, size_t length, SafePointer<uint8_t> buffer, FileDescriptor* fd) override;
 	ResultRet<kstd::Arc<LinkedInode>> resolve_link(const kstd::Arc<LinkedInode>& base, const User& user, kstd::Arc<LinkedInode>* parent_storage, int options, int recursion_level) override;
 	ssize_t read_dir_entry(size_t start, SafePointer<DirectoryEntry> buffer, FileDescriptor* fd) override;
@@ -52,6 +52,7 @@ public:
 	void open(FileDescriptor& fd, int options) override;
 	void close(FileDescriptor& fd) override;
 	bool can_read(const FileDescriptor& fd) override;
+	WaitQueue& poll_queue() override;
 
 private:
 	Type type;
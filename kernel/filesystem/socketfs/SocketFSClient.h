@@ -23,6 +23,7 @@
 #include <kernel/kstd/queue.hpp>
 #include <kernel/kstd/unix_types.h>
 #include <kernel/tasking/SpinLock.h>
+#include "socketfs_defines.h"
 
 class Process;
 class SocketFSClient {
@@ -32,6 +33,7 @@ public:
 	sockid_t id;
 	pid_t pid;
 	kstd::queue<uint8_t> data_queue;
+	size_t queue_size = SOCKETFS_MAX_BUFFER_SIZE;
 	SpinLock data_lock;
 	BooleanBlocker blocker;
 };
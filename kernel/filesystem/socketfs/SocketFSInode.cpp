@@ -25,6 +25,7 @@
 #include <kernel/kstd/cstring.h>
 #include <kernel/filesystem/LinkedInode.h>
 #include <kernel/kstd/KLog.h>
+#include <kernel/Trace.h>
 
 SocketFSInode::SocketFSInode(SocketFS& fs, ino_t id, const kstd::string& name, mode_t mode, uid_t uid, gid_t gid):
 	Inode(fs, id),
@@ -67,7 +68,7 @@ InodeMetadata SocketFSInode::metadata() {
 	return ret;
 }
 
-ino_t SocketFSInode::find_id(const kstd::string& find_name) {
+ino_t SocketFSInode::find_id(kstd::string_view find_name) {
 	for(size_t i = 0; i < fs.sockets.size(); i++) {
 		if(fs.sockets[i]->name == find_name)
 			return fs.sockets[i]->id;
@@ -101,6 +102,7 @@ ssize_t SocketFSInode::read(size_t start, size_t length, SafePointer<uint8_t> bu
 	}
 
 	reader->blocker.set_ready(true);
+	TRACE(TRACE_SOCKET_RECV, reader->id, 0, length);
 
 	return length;
 }
@@ -146,8 +148,24 @@ ssize_t SocketFSInode::write(size_t start, size_t length, SafePointer<uint8_t> b
 	if(!fd)
 		return -EINVAL;
 
-	auto packet = SafePointer<SocketFSPacket>(buf).get();
-	auto packet_data = SafePointer<uint8_t>(buf.raw() + sizeof(SocketFSPacket), buf.is_user());
+	//The buffer can hold any number of packets one after another. Each one is sent like it was written on its own, so one
+	//that can't be sent doesn't stop the rest, and the first error is returned at the end
+	ssize_t ret = SUCCESS;
+	size_t offset = 0;
+	while(offset + sizeof(SocketFSPacket) <= length) {
+		auto packet_buf = SafePointer<uint8_t>(buf.raw() + offset, buf.is_user());
+		auto packet = SafePointer<SocketFSPacket>(packet_buf).get();
+		if(packet.length > length - offset - sizeof(SocketFSPacket))
+			return ret ? ret : -EINVAL;
+		auto res = write_one(packet, SafePointer<uint8_t>(packet_buf.raw() + sizeof(SocketFSPacket), buf.is_user()), fd);
+		if(res && !ret)
+			ret = res;
+		offset += sizeof(SocketFSPacket) + packet.length;
+	}
+	return offset ? ret : -EINVAL;
+}
+
+ssize_t SocketFSInode::write_one(const SocketFSPacket& packet, SafePointer<uint8_t> packet_data, FileDescriptor* fd) {
 	bool is_broadcast = packet.type == SOCKETFS_TYPE_BROADCAST;
 
 	//Find the client that the packet is coming from
@@ -309,8 +327,12 @@ bool SocketFSInode::can_read(const FileDescriptor& fd) {
 }
 
 Result SocketFSInode::write_packet(const kstd::Arc<SocketFSClient>& client, int type, sockid_t sender, size_t length, int shm_id, int shm_perms, SafePointer<uint8_t> buffer, bool nonblock) {
-	//If there's room in the buffer, block (if O_NONBLOCK isn't set)
-	while(sizeof(SocketFSPacket) + length + client->data_queue.size() > SOCKETFS_MAX_BUFFER_SIZE) {
+	//If the packet could never fit in the queue, don't wait for it to
+	if(sizeof(SocketFSPacket) + length > client->queue_size)
+		return Result(-EMSGSIZE);
+
+	//If there's no room in the buffer, block (if O_NONBLOCK isn't set)
+	while(sizeof(SocketFSPacket) + length + client->data_queue.size() > client->queue_size) {
 		if(!nonblock) {
 			client->blocker.set_ready(false);
 			TaskManager::current_thread()->block(client->blocker);
@@ -334,9 +356,31 @@ Result SocketFSInode::write_packet(const kstd::Arc<SocketFSClient>& client, int
 	for(size_t i = 0; i < length; i++)
 		client->data_queue.push_back(buffer.get(i));
 
+	TRACE(TRACE_SOCKET_SEND, client->id, type, length);
+	m_poll_queue.wake();
+
 	return Result(SUCCESS);
 }
 
+size_t SocketFSInode::queue_size(const FileDescriptor& fd) {
+	auto client = get_client(&fd);
+	return client ? client->queue_size : 0;
+}
+
+ResultRet<size_t> SocketFSInode::set_queue_size(const FileDescriptor& fd, size_t size) {
+	if(size < sizeof(SocketFSPacket) || size > SOCKETFS_MAX_QUEUE_SIZE)
+		return Result(EINVAL);
+	auto client = get_client(&fd);
+	if(!client)
+		return Result(EIO);
+
+	//Packets that are already waiting are kept even if they don't fit anymore, and writers wait for them to be read
+	LOCK(client->data_lock);
+	client->queue_size = size;
+	client->blocker.set_ready(true);
+	return size;
+}
+
 kstd::Arc<SocketFSClient> SocketFSInode::get_client(const FileDescriptor* fd) const {
 	auto id = SocketFS::client_hash(fd);
 	if(id == host->id)
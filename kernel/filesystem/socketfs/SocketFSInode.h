@@ -40,7 +40,7 @@ public:
 
 	//Inode
 	InodeMetadata metadata() override;
-	ino_t find_id(const kstd::string& name) override;
+	ino_t find_id(kstd::string_view name) override;
 	ssize_t read(size_t start, size_t length, SafePointer<uint8_t> buf, FileDescriptor* fd) override;
 	ResultRet<kstd::Arc<LinkedInode>> resolve_link(const kstd::Arc<LinkedInode>& base, const User& user, kstd::Arc<LinkedInode>* parent_storage, int options, int recursion_level) override;
 	ssize_t read_dir_entry(size_t start, SafePointer<DirectoryEntry> buf, FileDescriptor* fd) override;
@@ -55,11 +55,18 @@ public:
 	void close(FileDescriptor& fd) override;
 	bool can_read(const FileDescriptor& fd) override;
 
+	/** The most bytes of packets that can be waiting to be read by a file descriptor. **/
+	size_t queue_size(const FileDescriptor& fd);
+	/** Sets how many bytes of packets can be waiting to be read by a file descriptor, up to SOCKETFS_MAX_QUEUE_SIZE. **/
+	ResultRet<size_t> set_queue_size(const FileDescriptor& fd, size_t size);
+
 	SocketFS& fs;
 	ino_t id;
 	kstd::string name;
 
 private:
+	/** Sends one packet that was written to the socket, returning an error code or SUCCESS. **/
+	ssize_t write_one(const SocketFSPacket& packet, SafePointer<uint8_t> packet_data, FileDescriptor* fd);
 	Result write_packet(const kstd::Arc<SocketFSClient>& recipient, int type, sockid_t sender, size_t size, int shm_id, int shm_perms, SafePointer<uint8_t> buffer, bool nonblock);
 
 	[[nodiscard]] kstd::Arc<SocketFSClient> get_client(const FileDescriptor* fd) const;
@@ -19,7 +19,8 @@
 
 #pragma once
 
-#define SOCKETFS_MAX_BUFFER_SIZE 16384
+#define SOCKETFS_MAX_BUFFER_SIZE 16384 //The default size of a queue, and so the biggest packet that's sure to fit in one
+#define SOCKETFS_MAX_QUEUE_SIZE 1048576 //The biggest that a queue can be made with F_SETSOCK_SZ
 #define SOCKETFS_TYPE_MSG 0
 #define SOCKETFS_RECIPIENT_HOST 0
 #define SOCKETFS_TYPE_BROADCAST -1
@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "TmpFS.h"
+#include "TmpFSInode.h"
+#include <kernel/memory/MemoryManager.h>
+
+TmpFS::TmpFS(size_t max_size): m_max_pages(max_size / PAGE_SIZE) {
+	_root_inode_id = create_inode(MODE_DIRECTORY | 01777u, 0, 0, 0)->id;
+}
+
+size_t TmpFS::used_size() {
+	LOCK(m_lock);
+	return m_used_pages * PAGE_SIZE;
+}
+
+char* TmpFS::name() {
+	return "tmpfs";
+}
+
+ResultRet<kstd::Arc<Inode>> TmpFS::get_inode(ino_t id) {
+	LOCK(m_lock);
+	auto inode = m_inodes.get(id);
+	if(!inode)
+		return Result(-ENOENT);
+	return static_cast<kstd::Arc<Inode>>(*inode);
+}
+
+ino_t TmpFS::root_inode_id() {
+	return _root_inode_id;
+}
+
+uint8_t TmpFS::fsid() {
+	return TMPFS_FSID;
+}
+
+kstd::Arc<TmpFSInode> TmpFS::create_inode(mode_t mode, uid_t uid, gid_t gid, ino_t parent) {
+	LOCK(m_lock);
+	ino_t id = m_next_id++;
+	auto inode = kstd::make_shared<TmpFSInode>(*this, id, mode, uid, gid, parent ? parent : id);
+	m_inodes.insert({id, inode});
+	return inode;
+}
+
+void TmpFS::forget_inode(ino_t id) {
+	//The inode may be destroyed here, which releases its pages, so let go of it after releasing the lock
+	kstd::Arc<TmpFSInode> inode;
+	LOCK(m_lock);
+	auto entry = m_inodes.get(id);
+	if(!entry)
+		return;
+	inode = kstd::move(*entry);
+	m_inodes.erase(id);
+}
+
+Result TmpFS::reserve_pages(size_t num_pages) {
+	LOCK(m_lock);
+	if(num_pages > m_max_pages - m_used_pages)
+		return Result(-ENOSPC);
+	m_used_pages += num_pages;
+	return Result(SUCCESS);
+}
+
+void TmpFS::release_pages(size_t num_pages) {
+	LOCK(m_lock);
+	ASSERT(num_pages <= m_used_pages);
+	m_used_pages -= num_pages;
+}
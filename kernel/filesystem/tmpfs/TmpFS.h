@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/filesystem/Filesystem.h>
+#include <kernel/api/page_size.h>
+#include <kernel/kstd/unordered_map.hpp>
+#include <kernel/tasking/SpinLock.h>
+
+#define TMPFS_FSID 5
+// Without the tmpfs_size kernel option, tmpfs can hold up to this fraction of usable memory
+#define TMPFS_DEFAULT_SIZE_DIVISOR 4
+
+class TmpFSInode;
+
+/**
+ * A filesystem that keeps everything in memory. The data of each file is kept in an anonymous object, which mappings of
+ * the file map directly. The space taken up by files is limited to a maximum size, and everything is lost on reboot.
+ */
+class TmpFS: public Filesystem {
+public:
+	explicit TmpFS(size_t max_size);
+
+	/** The most bytes of file data the filesystem can hold. **/
+	size_t max_size() const { return m_max_pages * PAGE_SIZE; }
+	/** How many bytes of file data the filesystem is holding, in whole pages. **/
+	size_t used_size();
+
+	//Filesystem
+	char* name() override;
+	ResultRet<kstd::Arc<Inode>> get_inode(ino_t id) override;
+	ino_t root_inode_id() override;
+	uint8_t fsid() override;
+	bool can_cache_lookups() override { return true; }
+	bool has_unique_inodes() override { return true; }
+
+private:
+	friend class TmpFSInode;
+
+	/** Makes a new inode, which is kept around until forget_inode() is called after its last link is removed. **/
+	kstd::Arc<TmpFSInode> create_inode(mode_t mode, uid_t uid, gid_t gid, ino_t parent);
+	void forget_inode(ino_t id);
+	/** Sets aside space for pages of file data, failing with -ENOSPC if there isn't enough left. **/
+	Result reserve_pages(size_t num_pages);
+	void release_pages(size_t num_pages);
+
+	SpinLock m_lock;
+	kstd::unordered_map<ino_t, kstd::Arc<TmpFSInode>> m_inodes;
+	ino_t m_next_id = 1;
+	size_t m_max_pages;
+	size_t m_used_pages = 0;
+};
@@ -0,0 +1,309 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "TmpFSInode.h"
+#include "TmpFS.h"
+#include <kernel/filesystem/DirectoryEntry.h>
+#include <kernel/memory/AnonymousVMObject.h>
+#include <kernel/memory/MemoryManager.h>
+
+//The length of a directory entry with a name of a given length, like DirectoryEntry::entry_length()
+#define DIR_ENTRY_LENGTH(len) (sizeof(DirectoryEntry::id) + sizeof(DirectoryEntry::type) + sizeof(DirectoryEntry::name_length) + sizeof(char) * (len))
+
+TmpFSInode::TmpFSInode(TmpFS& fs, ino_t id, mode_t mode, uid_t uid, gid_t gid, ino_t parent):
+	Inode(fs, id),
+	m_fs(fs),
+	m_parent(parent)
+{
+	_metadata.mode = mode;
+	_metadata.uid = uid;
+	_metadata.gid = gid;
+	_metadata.inode_id = id;
+
+	if(!IS_DIR(mode)) {
+		//Shared mappings of the file map the data directly, so forked processes should keep sharing it
+		m_data = AnonymousVMObject::alloc_lazy(0);
+		m_data->set_fork_action(VMObject::ForkAction::Share);
+	}
+
+	//The root directory is its own parent, and is never removed
+	if(parent == id)
+		m_links = 1;
+}
+
+TmpFSInode::~TmpFSInode() {
+	if(m_reserved_pages)
+		m_fs.release_pages(m_reserved_pages);
+}
+
+ino_t TmpFSInode::find_id(kstd::string_view name) {
+	if(!_metadata.is_directory())
+		return 0;
+	if(name == ".")
+		return id;
+	if(name == "..")
+		return m_parent;
+
+	LOCK(lock);
+	int index = find_entry(name);
+	return index < 0 ? 0 : m_entries[index].id;
+}
+
+ssize_t TmpFSInode::read(size_t start, size_t length, SafePointer<uint8_t> buffer, FileDescriptor* fd) {
+	if(_metadata.is_directory())
+		return -EISDIR;
+
+	LOCK(lock);
+	if(start >= _metadata.size)
+		return 0;
+	length = min(length, _metadata.size - start);
+
+	LOCK_N(m_data->lock(), data_locker);
+	for(size_t nread = 0; nread < length;) {
+		size_t pos = start + nread;
+		size_t chunk = min(length - nread, PAGE_SIZE - pos % PAGE_SIZE);
+		auto page = m_data->physical_page(pos / PAGE_SIZE).index();
+		if(page) {
+			MM.with_quickmapped(page, [&](void* ptr) {
+				buffer.write((uint8_t*) ptr + pos % PAGE_SIZE, nread, chunk);
+			});
+		} else {
+			//Pages that were never written to are holes
+			buffer.memset(0, nread, chunk);
+		}
+		nread += chunk;
+	}
+
+	return length;
+}
+
+ssize_t TmpFSInode::read_dir_entry(size_t start, SafePointer<DirectoryEntry> buffer, FileDescriptor* fd) {
+	if(!_metadata.is_directory())
+		return -ENOTDIR;
+
+	if(start == 0) {
+		DirectoryEntry ent(id, TYPE_DIR, ".");
+		buffer.set(ent);
+		return ent.entry_length();
+	} else if(start == DIR_ENTRY_LENGTH(1)) {
+		DirectoryEntry ent(m_parent, TYPE_DIR, "..");
+		buffer.set(ent);
+		return ent.entry_length();
+	}
+
+	LOCK(lock);
+	size_t cur_offset = DIR_ENTRY_LENGTH(1) + DIR_ENTRY_LENGTH(2);
+	for(auto& entry : m_entries) {
+		size_t length = DIR_ENTRY_LENGTH(entry.name.length());
+		if(cur_offset >= start) {
+			buffer.set(DirectoryEntry(entry.id, entry.type, entry.name));
+			return length;
+		}
+		cur_offset += length;
+	}
+
+	return 0;
+}
+
+ssize_t TmpFSInode::write(size_t start, size_t length, SafePointer<uint8_t> buffer, FileDescriptor* fd) {
+	if(_metadata.is_directory())
+		return -EISDIR;
+	if(!length)
+		return 0;
+
+	LOCK(lock);
+	size_t old_size = _metadata.size;
+	if(start + length > old_size) {
+		auto res = resize(start + length);
+		if(res.is_error())
+			return res.code();
+	}
+
+	size_t nwritten = 0;
+	{
+		LOCK_N(m_data->lock(), data_locker);
+		while(nwritten < length) {
+			size_t pos = start + nwritten;
+			size_t chunk = min(length - nwritten, PAGE_SIZE - pos % PAGE_SIZE);
+			auto page_res = m_data->page_for_write(pos / PAGE_SIZE);
+			if(page_res.is_error())
+				break;
+			MM.with_quickmapped(page_res.value(), [&](void* ptr) {
+				buffer.read((uint8_t*) ptr + pos % PAGE_SIZE, nwritten, chunk);
+			});
+			nwritten += chunk;
+		}
+	}
+
+	//If we ran out of memory partway through, don't leave the file bigger than what was written
+	if(nwritten < length && start + length > old_size)
+		resize(max(old_size, start + nwritten));
+
+	return nwritten ? (ssize_t) nwritten : -ENOMEM;
+}
+
+Result TmpFSInode::add_entry(const kstd::string& name, Inode& inode) {
+	if(!_metadata.is_directory())
+		return Result(-ENOTDIR);
+	if(&inode.fs != &fs)
+		return Result(-EXDEV);
+	if(name.length() >= NAME_MAXLEN)
+		return Result(-ENAMETOOLONG);
+
+	LOCK(lock);
+	if(name == "." || name == ".." || find_entry(name) >= 0)
+		return Result(-EEXIST);
+
+	auto& tmpfs_inode = (TmpFSInode&) inode;
+	{
+		LOCK_N(tmpfs_inode.lock, inode_locker);
+		tmpfs_inode.m_links++;
+	}
+	m_entries.push_back({name, inode.id, entry_type(inode.metadata().mode)});
+	_metadata.size += DIR_ENTRY_LENGTH(name.length());
+	return Result(SUCCESS);
+}
+
+ResultRet<kstd::Arc<Inode>> TmpFSInode::create_entry(const kstd::string& name, mode_t mode, uid_t uid, gid_t gid) {
+	if(!_metadata.is_directory())
+		return Result(-ENOTDIR);
+	if(name.length() >= NAME_MAXLEN)
+		return Result(-ENAMETOOLONG);
+
+	LOCK(lock);
+	if(name == "." || name == ".." || find_entry(name) >= 0)
+		return Result(-EEXIST);
+
+	auto inode = m_fs.create_inode(mode, uid, gid, id);
+	inode->m_links = 1;
+	m_entries.push_back({name, inode->id, entry_type(mode)});
+	_metadata.size += DIR_ENTRY_LENGTH(name.length());
+	return static_cast<kstd::Arc<Inode>>(inode);
+}
+
+Result TmpFSInode::remove_entry(const kstd::string& name) {
+	if(!_metadata.is_directory())
+		return Result(-ENOTDIR);
+	if(name == ".")
+		return Result(-EINVAL);
+	if(name == "..")
+		return Result(-ENOTEMPTY);
+
+	LOCK(lock);
+	int index = find_entry(name);
+	if(index < 0)
+		return Result(-ENOENT);
+	auto inode_res = m_fs.get_inode(m_entries[index].id);
+	if(inode_res.is_error())
+		return inode_res.result();
+	auto inode = (kstd::Arc<TmpFSInode>) inode_res.value();
+
+	bool unlinked;
+	{
+		LOCK_N(inode->lock, inode_locker);
+		if(inode->_metadata.is_directory() && !inode->m_entries.empty())
+			return Result(-ENOTEMPTY);
+		unlinked = !--inode->m_links;
+		if(unlinked)
+			inode->mark_deleted();
+	}
+
+	_metadata.size -= DIR_ENTRY_LENGTH(name.length());
+	m_entries.erase(index);
+
+	//It stays around until anything that has it open lets go of it
+	if(unlinked)
+		m_fs.forget_inode(inode->id);
+	return Result(SUCCESS);
+}
+
+Result TmpFSInode::truncate(off_t length) {
+	if(_metadata.is_directory())
+		return Result(-EISDIR);
+	if(length < 0)
+		return Result(-EINVAL);
+	LOCK(lock);
+	return resize(length);
+}
+
+Result TmpFSInode::chmod(mode_t mode) {
+	LOCK(lock);
+	_metadata.mode = (_metadata.mode & ~04777u) | (mode & 04777u);
+	return Result(SUCCESS);
+}
+
+Result TmpFSInode::chown(uid_t uid, gid_t gid) {
+	LOCK(lock);
+	_metadata.uid = uid;
+	_metadata.gid = gid;
+	return Result(SUCCESS);
+}
+
+void TmpFSInode::open(FileDescriptor& fd, int options) {
+
+}
+
+void TmpFSInode::close(FileDescriptor& fd) {
+
+}
+
+ResultRet<kstd::Arc<VMObject>> TmpFSInode::object_for_mapping(bool shared) {
+	if(!_metadata.is_simple_file())
+		return Result(ENODEV);
+	if(shared)
+		return kstd::static_pointer_cast<VMObject>(m_data);
+	return m_data->clone();
+}
+
+Result TmpFSInode::resize(size_t size) {
+	size_t num_pages = kstd::ceil_div(size, PAGE_SIZE);
+	if(num_pages > m_reserved_pages) {
+		auto res = m_fs.reserve_pages(num_pages - m_reserved_pages);
+		if(res.is_error())
+			return res;
+	}
+
+	Result res = Result(SUCCESS);
+	{
+		LOCK_N(m_data->lock(), data_locker);
+		res = m_data->resize(size);
+	}
+	if(res.is_error()) {
+		if(num_pages > m_reserved_pages)
+			m_fs.release_pages(num_pages - m_reserved_pages);
+		return Result(-ENOMEM);
+	}
+
+	if(num_pages < m_reserved_pages)
+		m_fs.release_pages(m_reserved_pages - num_pages);
+	m_reserved_pages = num_pages;
+	_metadata.size = size;
+	return Result(SUCCESS);
+}
+
+int TmpFSInode::find_entry(kstd::string_view name) {
+	for(size_t i = 0; i < m_entries.size(); i++) {
+		if(m_entries[i].name == name)
+			return (int) i;
+	}
+	return -1;
+}
+
+uint8_t TmpFSInode::entry_type(mode_t mode) {
+	switch(mode & 0xF000u) {
+		case MODE_DIRECTORY:
+			return TYPE_DIR;
+		case MODE_CHAR_DEVICE:
+			return TYPE_CHARACTER_DEVICE;
+		case MODE_BLOCK_DEVICE:
+			return TYPE_BLOCK_DEVICE;
+		case MODE_FIFO:
+			return TYPE_FIFO;
+		case MODE_SOCKET:
+			return TYPE_SOCKET;
+		case MODE_SYMLINK:
+			return TYPE_SYMLINK;
+		default:
+			return TYPE_FILE;
+	}
+}
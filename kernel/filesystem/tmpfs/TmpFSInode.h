@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/filesystem/Inode.h>
+#include <kernel/kstd/vector.hpp>
+
+class TmpFS;
+class AnonymousVMObject;
+
+class TmpFSInode: public Inode {
+public:
+	TmpFSInode(TmpFS& fs, ino_t id, mode_t mode, uid_t uid, gid_t gid, ino_t parent);
+	~TmpFSInode() override;
+
+	//Inode
+	ino_t find_id(kstd::string_view name) override;
+	ssize_t read(size_t start, size_t length, SafePointer<uint8_t> buffer, FileDescriptor* fd) override;
+	ssize_t read_dir_entry(size_t start, SafePointer<DirectoryEntry> buffer, FileDescriptor* fd) override;
+	ssize_t write(size_t start, size_t length, SafePointer<uint8_t> buffer, FileDescriptor* fd) override;
+	Result add_entry(const kstd::string& name, Inode& inode) override;
+	ResultRet<kstd::Arc<Inode>> create_entry(const kstd::string& name, mode_t mode, uid_t uid, gid_t gid) override;
+	Result remove_entry(const kstd::string& name) override;
+	Result truncate(off_t length) override;
+	Result chmod(mode_t mode) override;
+	Result chown(uid_t uid, gid_t gid) override;
+	void open(FileDescriptor& fd, int options) override;
+	void close(FileDescriptor& fd) override;
+	ResultRet<kstd::Arc<VMObject>> object_for_mapping(bool shared) override;
+
+private:
+	struct Entry {
+		kstd::string name;
+		ino_t id;
+		uint8_t type;
+	};
+
+	/** Changes the size of the data, taking space from or giving it back to the filesystem. The lock must be held. **/
+	Result resize(size_t size);
+	/** Finds the index of an entry in the directory, or -1 if it isn't there. The lock must be held. **/
+	int find_entry(kstd::string_view name);
+	static uint8_t entry_type(mode_t mode);
+
+	TmpFS& m_fs;
+	ino_t m_parent;
+	kstd::vector<Entry> m_entries; ///< The entries of a directory, besides "." and "..".
+	kstd::Arc<AnonymousVMObject> m_data; ///< The data of a file or symlink.
+	size_t m_reserved_pages = 0; ///< How many pages of the filesystem's space the data is using.
+	size_t m_links = 0;
+};
@@ -0,0 +1,110 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "APIC.h"
+#include "idt.h"
+#include <kernel/memory/MemoryManager.h>
+#include <kernel/kstd/KLog.h>
+
+#define MSR_APIC_BASE 0x1B
+#define APIC_BASE_ENABLE 0x800
+
+// Registers
+#define APIC_ID 0x20
+#define APIC_TPR 0x80
+#define APIC_EOI 0xB0
+#define APIC_SVR 0xF0
+#define APIC_ICR_LOW 0x300
+#define APIC_ICR_HIGH 0x310
+#define APIC_LVT_LINT0 0x350
+#define APIC_LVT_LINT1 0x360
+
+#define APIC_SVR_ENABLE 0x100
+#define APIC_SPURIOUS_VECTOR 0xFF
+#define APIC_DELIVERY_NMI 0x400
+#define APIC_DELIVERY_EXTINT 0x700
+#define APIC_LVT_MASKED 0x10000
+#define APIC_ICR_INIT 0x500
+#define APIC_ICR_STARTUP 0x600
+#define APIC_ICR_PENDING 0x1000
+#define APIC_ICR_ASSERT 0x4000
+
+extern "C" void _iret();
+
+namespace APIC {
+	kstd::Arc<VMRegion> s_region;
+	volatile uint32_t* s_registers = nullptr;
+
+	inline uint32_t read(uint32_t reg) {
+		return s_registers[reg / sizeof(uint32_t)];
+	}
+
+	inline void write(uint32_t reg, uint32_t value) {
+		s_registers[reg / sizeof(uint32_t)] = value;
+	}
+
+	bool init() {
+		if(s_registers)
+			return true;
+
+		uint32_t eax, ebx, ecx, edx;
+		asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+		if(!(edx & (1 << 9)))
+			return false;
+
+		uint32_t base_low, base_high;
+		asm volatile("rdmsr" : "=a"(base_low), "=d"(base_high) : "c"(MSR_APIC_BASE));
+		if(!(base_low & APIC_BASE_ENABLE)) {
+			KLog::warn("APIC", "The local APIC is disabled");
+			return false;
+		}
+
+		s_region = MM.alloc_mapped_region(base_low & ~(PAGE_SIZE - 1), PAGE_SIZE);
+		s_registers = (volatile uint32_t*) s_region->start();
+
+		// Spurious interrupts are just ignored. The LINT pins are set up for virtual wire mode, so the PIC's interrupts
+		// and NMIs keep coming through the way they did while the local APIC was disabled.
+		Interrupt::idt_set_gate(APIC_SPURIOUS_VECTOR, (unsigned) _iret, 0x08, 0x8E);
+		write(APIC_LVT_LINT0, APIC_DELIVERY_EXTINT);
+		write(APIC_LVT_LINT1, APIC_DELIVERY_NMI);
+		write(APIC_TPR, 0);
+		write(APIC_SVR, APIC_SVR_ENABLE | APIC_SPURIOUS_VECTOR);
+
+		KLog::dbg("APIC", "Local APIC %d enabled at 0x%x", id(), base_low & ~(PAGE_SIZE - 1));
+		return true;
+	}
+
+	void init_application_processor() {
+		write(APIC_LVT_LINT0, APIC_LVT_MASKED);
+		write(APIC_LVT_LINT1, APIC_DELIVERY_NMI);
+		write(APIC_TPR, 0);
+		write(APIC_SVR, APIC_SVR_ENABLE | APIC_SPURIOUS_VECTOR);
+	}
+
+	void send_ipi(uint8_t apic_id, uint32_t command) {
+		write(APIC_ICR_HIGH, ((uint32_t) apic_id) << 24);
+		write(APIC_ICR_LOW, command);
+		while(read(APIC_ICR_LOW) & APIC_ICR_PENDING)
+			asm volatile("pause");
+	}
+
+	bool available() {
+		return s_registers;
+	}
+
+	uint8_t id() {
+		return read(APIC_ID) >> 24;
+	}
+
+	void send_init(uint8_t apic_id) {
+		send_ipi(apic_id, APIC_ICR_INIT | APIC_ICR_ASSERT);
+	}
+
+	void send_startup(uint8_t apic_id, uint8_t page) {
+		send_ipi(apic_id, APIC_ICR_STARTUP | APIC_ICR_ASSERT | page);
+	}
+
+	void send_eoi() {
+		write(APIC_EOI, 0);
+	}
+}
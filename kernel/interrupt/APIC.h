@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+
+/**
+ * The local APICs. The PIC still delivers the legacy IRQs (through the boot processor's LINT0 pin in virtual wire mode),
+ * so the local APIC is only used to receive message-signaled interrupts from PCI devices and acknowledge them, and to
+ * send the IPIs that start the application processors. Every processor sees its own local APIC at the same address.
+ */
+namespace APIC {
+	/// Maps and software-enables the local APIC. Does nothing if it's already been done.
+	/// @return Whether there's a local APIC to use.
+	bool init();
+	/// Software-enables the calling application processor's local APIC, with its LINT0 pin masked so that the PIC's
+	/// interrupts only go to the boot processor.
+	void init_application_processor();
+	/// Whether the local APIC has been set up.
+	bool available();
+	/// The ID of the calling processor's local APIC. Message-signaled interrupts are addressed to the boot processor's.
+	uint8_t id();
+	/// Sends an INIT IPI to a processor, which resets it to wait for a startup IPI.
+	void send_init(uint8_t apic_id);
+	/// Sends a startup IPI to a processor, which starts it in real mode at the page with the given index.
+	void send_startup(uint8_t apic_id, uint8_t page);
+	/// Tells the local APIC that the interrupt it delivered has been handled.
+	void send_eoi();
+}
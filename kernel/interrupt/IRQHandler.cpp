@@ -55,6 +55,21 @@ bool IRQHandler::mark_in_irq() {
 	return true;
 }
 
+bool IRQHandler::use_msi(PCI::Address address, uint16_t entry) {
+	int irq = Interrupt::irq_alloc_msi();
+	if(irq < 0)
+		return false;
+	if(!PCI::enable_msi(address, entry, irq)) {
+		Interrupt::irq_free_msi(irq);
+		return false;
+	}
+	if(_irq)
+		uninstall_irq();
+	_irq = irq;
+	Interrupt::irq_set_handler(irq, this);
+	return true;
+}
+
 void IRQHandler::send_eoi() {
 	Interrupt::send_eoi(_irq);
 	_sent_eoi = true;
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <kernel/kstd/kstddef.h>
+#include <kernel/pci/PCI.h>
 
 class IRQHandler {
 public:
@@ -35,6 +36,15 @@ protected:
 	void uninstall_irq();
 	void reinstall_irq();
 	void send_eoi();
+	/**
+	 * Switches this handler from the device's legacy interrupt line to a message-signaled interrupt with an IRQ of its
+	 * own, so that it isn't called for other devices sharing the line. If the device or system doesn't support it, the
+	 * handler stays on its legacy line.
+	 * @param address The PCI device.
+	 * @param entry The device's MSI-X table entry to use, for devices that can interrupt for each of their queues.
+	 * @return Whether the handler is now using a message-signaled interrupt.
+	 */
+	bool use_msi(PCI::Address address, uint16_t entry = 0);
 
 private:
 	int _irq = 0;
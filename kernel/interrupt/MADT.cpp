@@ -0,0 +1,188 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "MADT.h"
+#include <kernel/memory/MemoryManager.h>
+#include <kernel/kstd/KLog.h>
+
+#define BDA_EBDA_SEGMENT 0x40E
+#define EBDA_SEARCH_SIZE 1024
+#define BIOS_AREA_START 0xE0000
+#define BIOS_AREA_END 0x100000
+#define RSDP_SIGNATURE "RSD PTR "
+#define MADT_SIGNATURE "APIC"
+#define MADT_ENTRY_LOCAL_APIC 0
+#define MADT_LOCAL_APIC_ENABLED 0x1
+
+namespace MADT {
+	struct RSDP {
+		char signature[8];
+		uint8_t checksum;
+		char oem_id[6];
+		uint8_t revision;
+		uint32_t rsdt_address;
+	} __attribute__((packed));
+
+	struct SDTHeader {
+		char signature[4];
+		uint32_t length;
+		uint8_t revision;
+		uint8_t checksum;
+		char oem_id[6];
+		char oem_table_id[8];
+		uint32_t oem_revision;
+		uint32_t creator_id;
+		uint32_t creator_revision;
+	} __attribute__((packed));
+
+	struct Header {
+		SDTHeader sdt;
+		uint32_t local_apic_address;
+		uint32_t flags;
+	} __attribute__((packed));
+
+	struct EntryHeader {
+		uint8_t type;
+		uint8_t length;
+	} __attribute__((packed));
+
+	struct LocalAPICEntry {
+		EntryHeader header;
+		uint8_t processor_id;
+		uint8_t apic_id;
+		uint32_t flags;
+	} __attribute__((packed));
+
+	bool s_initialized = false;
+	bool s_found = false;
+	kstd::vector<uint8_t> s_apic_ids;
+
+	/// A physical range mapped into kernel space, which is unmapped when it goes out of scope.
+	class PhysicalMapping {
+	public:
+		PhysicalMapping(PhysicalAddress start, size_t size) {
+			PhysicalAddress page_start = start & ~(PAGE_SIZE - 1);
+			size_t offset = start - page_start;
+			m_region = MM.alloc_mapped_region(page_start, ((offset + size + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE);
+			m_data = (uint8_t*) m_region->start() + offset;
+		}
+
+		template<typename T>
+		T* as() const { return (T*) m_data; }
+
+	private:
+		kstd::Arc<VMRegion> m_region;
+		uint8_t* m_data;
+	};
+
+	bool signature_is(const char* signature, const char* expected, size_t length) {
+		for(size_t i = 0; i < length; i++) {
+			if(signature[i] != expected[i])
+				return false;
+		}
+		return true;
+	}
+
+	bool checksum_ok(const void* data, size_t size) {
+		uint8_t sum = 0;
+		for(size_t i = 0; i < size; i++)
+			sum += ((const uint8_t*) data)[i];
+		return sum == 0;
+	}
+
+	/// Searches a physical range for the RSDP, which is always on a 16-byte boundary. Returns the RSDT's address or 0.
+	PhysicalAddress find_rsdt(PhysicalAddress start, PhysicalAddress end) {
+		PhysicalMapping mapping(start, end - start);
+		auto* data = mapping.as<uint8_t>();
+		for(size_t offset = 0; offset + sizeof(RSDP) <= end - start; offset += 16) {
+			auto* rsdp = (RSDP*) (data + offset);
+			if(signature_is(rsdp->signature, RSDP_SIGNATURE, 8) && checksum_ok(rsdp, sizeof(RSDP)))
+				return rsdp->rsdt_address;
+		}
+		return 0;
+	}
+
+	void read_madt(PhysicalAddress address) {
+		size_t length;
+		{
+			PhysicalMapping header_mapping(address, sizeof(SDTHeader));
+			length = header_mapping.as<SDTHeader>()->length;
+		}
+
+		PhysicalMapping mapping(address, length);
+		auto* madt = mapping.as<Header>();
+		if(length < sizeof(Header) || !checksum_ok(madt, length)) {
+			KLog::warn("MADT", "The MADT is corrupt");
+			return;
+		}
+
+		size_t offset = sizeof(Header);
+		while(offset + sizeof(EntryHeader) <= length) {
+			auto* entry = (EntryHeader*) (mapping.as<uint8_t>() + offset);
+			if(entry->length < sizeof(EntryHeader) || offset + entry->length > length)
+				break;
+			if(entry->type == MADT_ENTRY_LOCAL_APIC && entry->length >= sizeof(LocalAPICEntry)) {
+				auto* local_apic = (LocalAPICEntry*) entry;
+				if(local_apic->flags & MADT_LOCAL_APIC_ENABLED)
+					s_apic_ids.push_back(local_apic->apic_id);
+			}
+			offset += entry->length;
+		}
+		s_found = true;
+	}
+
+	bool init() {
+		if(s_initialized)
+			return s_found;
+		s_initialized = true;
+
+		// The EBDA's segment is in the BIOS data area. It might have the RSDP in its first KiB.
+		PhysicalAddress rsdt = 0;
+		{
+			PhysicalMapping bda(BDA_EBDA_SEGMENT, sizeof(uint16_t));
+			PhysicalAddress ebda = ((PhysicalAddress) *bda.as<uint16_t>()) << 4;
+			if(ebda)
+				rsdt = find_rsdt(ebda, ebda + EBDA_SEARCH_SIZE);
+		}
+		if(!rsdt)
+			rsdt = find_rsdt(BIOS_AREA_START, BIOS_AREA_END);
+		if(!rsdt) {
+			KLog::warn("MADT", "Couldn't find the RSDP");
+			return false;
+		}
+
+		size_t length;
+		{
+			PhysicalMapping header_mapping(rsdt, sizeof(SDTHeader));
+			length = header_mapping.as<SDTHeader>()->length;
+		}
+		PhysicalMapping rsdt_mapping(rsdt, length);
+		if(length < sizeof(SDTHeader) || !checksum_ok(rsdt_mapping.as<void>(), length)) {
+			KLog::warn("MADT", "The RSDT is corrupt");
+			return false;
+		}
+
+		// The RSDT is followed by the physical addresses of all of the other tables
+		auto* tables = (uint32_t*) (rsdt_mapping.as<uint8_t>() + sizeof(SDTHeader));
+		size_t num_tables = (length - sizeof(SDTHeader)) / sizeof(uint32_t);
+		for(size_t i = 0; i < num_tables && !s_found; i++) {
+			bool is_madt;
+			{
+				PhysicalMapping header_mapping(tables[i], sizeof(SDTHeader));
+				is_madt = signature_is(header_mapping.as<SDTHeader>()->signature, MADT_SIGNATURE, 4);
+			}
+			if(is_madt)
+				read_madt(tables[i]);
+		}
+
+		if(s_found)
+			KLog::dbg("MADT", "Found %d enabled processor(s)", (int) s_apic_ids.size());
+		else
+			KLog::warn("MADT", "Couldn't find the MADT");
+		return s_found;
+	}
+
+	const kstd::vector<uint8_t>& processor_apic_ids() {
+		return s_apic_ids;
+	}
+}
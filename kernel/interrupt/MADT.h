@@ -0,0 +1,19 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+#include <kernel/kstd/vector.hpp>
+
+/**
+ * Reads the ACPI Multiple APIC Description Table, which lists the local APIC of each processor in the system. The RSDP
+ * is found by searching the EBDA and the BIOS area, since multiboot doesn't hand it to us.
+ */
+namespace MADT {
+	/// Finds and reads the MADT. Does nothing if it's already been read.
+	/// @return Whether a MADT was found.
+	bool init();
+	/// The IDs of the local APICs of the processors that are enabled, in the order the firmware lists them.
+	const kstd::vector<uint8_t>& processor_apic_ids();
+}
@@ -18,14 +18,20 @@
 */
 
 #include <kernel/kstd/kstddef.h>
+#include <kernel/kstd/kstdio.h>
 #include <kernel/interrupt/idt.h>
 #include <kernel/interrupt/irq.h>
 #include <kernel/tasking/TaskManager.h>
 #include "IRQHandler.h"
+#include <kernel/random.h>
 #include "interrupt.h"
+#include "APIC.h"
+#include <kernel/tasking/SpinLock.h>
 
 namespace Interrupt {
-	IRQHandler* handlers[16] = {nullptr};
+	IRQHandler* handlers[NUM_IRQS] = {nullptr};
+	bool msi_allocated[NUM_MSI_IRQS] = {false};
+	SpinLock msi_lock;
 
 	volatile bool _in_interrupt = false;
 
@@ -37,6 +43,31 @@ namespace Interrupt {
 		handlers[irq] = nullptr;
 	}
 
+	int irq_alloc_msi() {
+		if(!APIC::init())
+			return -1;
+		LOCK(msi_lock);
+		for(int i = 0; i < NUM_MSI_IRQS; i++) {
+			if(msi_allocated[i])
+				continue;
+			msi_allocated[i] = true;
+			idt_set_gate(IRQ_VECTOR_BASE + NUM_LEGACY_IRQS + i, msi_irq_stubs[i], 0x08, 0x8E);
+			return NUM_LEGACY_IRQS + i;
+		}
+		return -1;
+	}
+
+	void irq_free_msi(int irq) {
+		ASSERT(irq_is_msi(irq));
+		LOCK(msi_lock);
+		handlers[irq] = nullptr;
+		msi_allocated[irq - NUM_LEGACY_IRQS] = false;
+	}
+
+	bool irq_is_msi(int irq) {
+		return irq >= NUM_LEGACY_IRQS && irq < NUM_IRQS;
+	}
+
 	void irq_remap(){
 		IO::outb(PIC1_COMMAND, 0x11); //Init
 		IO::wait();
@@ -81,7 +112,10 @@ namespace Interrupt {
 	}
 
 	void irq_handler(struct Registers *r){
-		auto handler = handlers[r->num - 0x20];
+		int irq = r->num - IRQ_VECTOR_BASE;
+		add_interrupt_randomness(irq);
+
+		auto handler = handlers[irq];
 		if(handler) {
 			//Mark that we're in an interrupt so that yield will be async if it occurs
 			_in_interrupt = handler->mark_in_irq();
@@ -92,7 +126,7 @@ namespace Interrupt {
 
 		//Send EOI if we haven't already
 		if(!handler || !handler->sent_eoi())
-			send_eoi(r->num - 0x20);
+			send_eoi(irq);
 
 		//If we need to yield asynchronously after the interrupt because we called TaskManager::yield() during it, do so
 		TaskManager::do_yield_async();
@@ -103,6 +137,11 @@ namespace Interrupt {
 	}
 
 	void send_eoi(int irq_number) {
+		if(irq_is_msi(irq_number)) {
+			APIC::send_eoi();
+			_in_interrupt = false;
+			return;
+		}
 		if(irq_number >= 8)
 			IO::outb(PIC2_COMMAND, 0x20);
 		IO::outb(PIC1_COMMAND, 0x20);
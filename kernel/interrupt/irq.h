@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <kernel/kstd/types.h>
+
 #define PIC1 0x20
 #define PIC2 0xA0
 #define PIC1_COMMAND PIC1
@@ -26,6 +28,12 @@
 #define PIC2_COMMAND PIC2
 #define PIC2_DATA (PIC2+1)
 
+//IRQs 0-15 come from the PIC, and the rest are given out to message-signaled interrupts. IRQ n is always vector 0x20 + n.
+#define IRQ_VECTOR_BASE 0x20
+#define NUM_LEGACY_IRQS 16
+#define NUM_MSI_IRQS 32
+#define NUM_IRQS (NUM_LEGACY_IRQS + NUM_MSI_IRQS)
+
 class IRQHandler;
 
 namespace Interrupt {
@@ -46,9 +54,15 @@ namespace Interrupt {
 	extern "C" void irq14();
 	extern "C" void irq15();
 	extern "C" void irq_handler(struct Registers *r);
+	extern "C" uint32_t msi_irq_stubs[NUM_MSI_IRQS];
 
 	void irq_set_handler(int irq, IRQHandler* handler);
 	void irq_remove_handler(int irq);
+	/// Reserves an IRQ for a message-signaled interrupt. Returns -1 if they've all been taken.
+	int irq_alloc_msi();
+	/// Frees an IRQ reserved with irq_alloc_msi.
+	void irq_free_msi(int irq);
+	bool irq_is_msi(int irq);
 	void irq_remap();
 	void irq_init();
 	bool in_irq();
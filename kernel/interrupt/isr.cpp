@@ -27,6 +27,7 @@
 #include <kernel/tasking/Signal.h>
 #include <kernel/tasking/Thread.h>
 #include <kernel/tasking/Process.h>
+#include <kernel/tasking/FPU.h>
 
 namespace Interrupt {
 	void isr_init(){
@@ -79,6 +80,10 @@ namespace Interrupt {
 					handle_fault("DIVIDE_BY_ZERO", "Please don't do that.", SIGILL);
 					break;
 
+				case 7: //Device not available
+					FPU::handle_device_not_available();
+					break;
+
 				case 13: //GPF
 					handle_fault("GENERAL_PROTECTION_FAULT", "How did you manage to do that?", SIGILL);
 					break;
@@ -89,16 +94,12 @@ namespace Interrupt {
 					} else {
 						size_t err_pos;
 						asm volatile ("mov %%cr2, %0" : "=r" (err_pos));
-						PageFault::Type type;
-						if(r->err_code == FAULT_USER_READ)
-							type = PageFault::Type::Read;
-						else if(r->err_code == FAULT_USER_WRITE)
-							type = PageFault::Type::Write;
-						else
-							type = PageFault::Type::Unknown;
+						// Bit 1 of the error code is set for writes, whether the page was present or not
+						auto type = (r->err_code & 0x2) ? PageFault::Type::Write : PageFault::Type::Read;
 						TaskManager::current_thread()->handle_pagefault({
 							err_pos,
 							r->eip,
+							type
 						});
 					}
 					break;
@@ -26,13 +26,20 @@
 #include <kernel/device/Device.h>
 #include <kernel/time/TimeManager.h>
 #include <kernel/interrupt/interrupt.h>
+#include <kernel/syscall/syscall.h>
+#include <kernel/Trace.h>
 #include <kernel/CommandLine.h>
 #include <kernel/device/BochsVGADevice.h>
 #include <kernel/device/MultibootVGADevice.h>
 #include <kernel/tasking/TaskManager.h>
 #include <kernel/tasking/Process.h>
 #include <kernel/tasking/Thread.h>
+#include <kernel/tasking/Processor.h>
 #include <kernel/device/PATADevice.h>
+#include <kernel/device/NVMeController.h>
+#include <kernel/device/NVMeDevice.h>
+#include <kernel/device/AHCIController.h>
+#include <kernel/device/AHCIDevice.h>
 #include <kernel/terminal/VirtualTTY.h>
 #include <kernel/filesystem/ext2/Ext2Filesystem.h>
 #include <kernel/device/PartitionDevice.h>
@@ -42,11 +49,14 @@
 #include <kernel/filesystem/VFS.h>
 #include <kernel/filesystem/ptyfs/PTYFS.h>
 #include <kernel/filesystem/socketfs/SocketFS.h>
+#include <kernel/filesystem/tmpfs/TmpFS.h>
 #include <kernel/KernelMapper.h>
 #include <kernel/tasking/ProcessArgs.h>
 #include <kernel/kstd/KLog.h>
 #include <kernel/tests/KernelTest.h>
 #include "bootlogo.h"
+#include <kernel/BootTimeline.h>
+#include <kernel/random.h>
 
 uint8_t boot_disk;
 
@@ -68,6 +78,9 @@ int kmain(uint32_t mbootptr){
 	for (constructor_func* ctor = start_ctors; ctor < end_ctors; ctor++)
 		(*ctor)();
 	ASSERT(did_constructors);
+	init_memory_functions();
+	random_init();
+	BootTimeline::mark("kmain");
 
 	clearScreen();
 	KLog::info("kinit", "Starting duckOS...");
@@ -78,9 +91,12 @@ int kmain(uint32_t mbootptr){
 	CommandLine cmd_line(mboot_header);
 	Memory::load_gdt();
 	Interrupt::init();
+	init_sysenter();
 	MemoryManager::inst().setup_paging();
+	BootTimeline::mark("paging");
 	VMWare::detect();
 	Device::init();
+	BootTimeline::mark("devices");
 
 	//Try setting up VGA
 	BochsVGADevice* bochs_vga = BochsVGADevice::create();
@@ -107,6 +123,7 @@ int kmain(uint32_t mbootptr){
 	KLog::info("kinit", "Debug mode is enabled.");
 #endif
 	KLog::dbg("kinit", "First stage complete.");
+	BootTimeline::mark("video");
 	
 	TaskManager::init();
 	ASSERT(false); //We should never get here
@@ -116,7 +133,11 @@ int kmain(uint32_t mbootptr){
 void kmain_late(){
 	KLog::dbg("kinit", "Tasking initialized.");
 
+	BootTimeline::mark("tasking");
 	TimeManager::init();
+	Trace::init();
+	BootTimeline::mark("time");
+	Processor::start_application_processors();
 
 	auto* tty0 = new VirtualTTY(4, 0);
 	tty0->set_active();
@@ -124,19 +145,33 @@ void kmain_late(){
 
 	KLog::dbg("kinit", "Initializing disk...");
 
-	//Setup the disk (Assumes we're using primary master drive
-	auto disk = kstd::Arc<PATADevice>(PATADevice::find(
-					PATADevice::PRIMARY,
-					PATADevice::MASTER,
-					CommandLine::inst().has_option("use_pio") //Use PIO if the command line option is present
-				));
+	//Setup the disk. Use the first namespace on the NVMe controller or the first disk on the AHCI controller if there is
+	//one (unless the no_nvme or no_ahci options are present), and otherwise assume we're using the primary master IDE drive
+	kstd::Arc<DiskDevice> disk;
+	if(!CommandLine::inst().has_option("no_nvme")) {
+		auto* nvme = NVMeController::find();
+		if(nvme && !nvme->disks().empty())
+			disk = kstd::Arc<DiskDevice>(nvme->disks()[0]);
+	}
+	if(!disk && !CommandLine::inst().has_option("no_ahci")) {
+		auto* ahci = AHCIController::find();
+		if(ahci && !ahci->disks().empty())
+			disk = kstd::Arc<DiskDevice>(ahci->disks()[0]);
+	}
 	if(!disk) {
-		KLog::crit("kinit", "Couldn't find IDE controller! Hanging...");
+		disk = kstd::Arc<DiskDevice>(PATADevice::find(
+				PATADevice::PRIMARY,
+				PATADevice::MASTER,
+				CommandLine::inst().has_option("use_pio") //Use PIO if the command line option is present
+			));
+	}
+	if(!disk) {
+		KLog::crit("kinit", "Couldn't find a disk! Hanging...");
 		while(1);
 	}
 
 	//Find the LBA of the first partition
-	auto* mbr_buf = new uint8_t[512];
+	auto* mbr_buf = new uint8_t[disk->block_size()];
 	disk->read_block(0, mbr_buf);
 	uint32_t part_offset = *((uint32_t*) &mbr_buf[0x1C6]);
 	delete[] mbr_buf;
@@ -160,6 +195,7 @@ void kmain_late(){
 		while(true);
 	}
 
+	BootTimeline::mark("disk");
 	KLog::dbg("kinit", "Partition is ext2 %d.%d", ext2fs->superblock.version_major, ext2fs->superblock.version_minor);
 
 	if(ext2fs->superblock.inode_size != 128){
@@ -217,6 +253,21 @@ void kmain_late(){
 		while(true);
 	}
 
+	//Mount TmpFS, if there's somewhere to put it
+	auto tmp_or_err = VFS::inst().resolve_path("/tmp", VFS::inst().root_ref(), root_user);
+	if(!tmp_or_err.is_error()) {
+		size_t tmpfs_size = MM.usable_mem() / TMPFS_DEFAULT_SIZE_DIVISOR;
+		auto& tmpfs_size_opt = CommandLine::inst().get_option_value("tmpfs_size");
+		if(tmpfs_size_opt.length())
+			tmpfs_size = atoi(tmpfs_size_opt.c_str());
+		res = VFS::inst().mount(new TmpFS(tmpfs_size), tmp_or_err.value());
+		if(res.is_error())
+			KLog::warn("kinit", "Failed to mount tmp: %d", res.code());
+	} else {
+		KLog::warn("kinit", "Not mounting tmpfs, since /tmp doesn't exist");
+	}
+	BootTimeline::mark("filesystems");
+
 	//Load the kernel symbols
 	KernelMapper::load_map();
 
@@ -229,7 +280,14 @@ void kmain_late(){
 		while(true);
 	}
 
+	//Or benchmarks
+	if(CommandLine::inst().get_option_value("kernel-bench") == "true") {
+		KernelTestRegistry::inst().run_benchmarks();
+		while(true);
+	}
+
 	KLog::dbg("kinit", "Starting init...");
+	BootTimeline::mark("init");
 
 	//Replace kinit with init
 	auto* init_args = new ProcessArgs(VFS::inst().root_ref());
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "bits/RefCount.h"
+#include "kstddef.h"
 
 namespace kstd {
 	template<typename T>
@@ -12,6 +13,28 @@ namespace kstd {
 	template<typename T>
 	class ArcSelf;
 	class ArcSelfBase;
+	template<typename T>
+	class ArcRef;
+
+	/** The reference count of an ArcIntrusive. It's defined up here so that Arc can find the count from a T*. **/
+	class ArcIntrusiveBase {
+	protected:
+		template<typename T>
+		friend class Arc;
+		template<typename T>
+		friend class ArcRef;
+		template<typename T>
+		friend class ArcIntrusive;
+
+		explicit ArcIntrusiveBase(const IntrusiveOps* ops) {
+			::new (m_ref_count_storage) RefCount(ops);
+		}
+
+		RefCount* intrusive_ref_count() { return (RefCount*) m_ref_count_storage; }
+
+		// The count has to outlive the object's destructor for any weak references, so it's never destroyed itself
+		alignas(RefCount) uint8_t m_ref_count_storage[sizeof(RefCount)];
+	};
 
 	template<typename T>
 	void __set_shared_weak_self(ArcSelfBase* base, Weak<T> weak);
@@ -71,12 +94,20 @@ namespace kstd {
 
 		explicit Arc(T* ptr):
 			m_ptr(ptr),
-			m_count(ptr ? new RefCount(1) : nullptr)
+			m_count(nullptr)
 		{
-			if constexpr(is_base_of<ArcSelfBase, T>) {
-				if(ptr)
-					__set_shared_weak_self(static_cast<ArcSelfBase*>(ptr), Weak<T>(*this));
+			if(!ptr)
+				return;
+			if constexpr(is_base_of<ArcIntrusiveBase, T>) {
+				// The count is in the object, so this is safe to do even if another Arc already owns it
+				m_count = static_cast<ArcIntrusiveBase*>(ptr)->intrusive_ref_count();
+				if(!m_count->acquire_strong_intrusive())
+					return;
+			} else {
+				m_count = new RefCount(1);
 			}
+			if constexpr(is_base_of<ArcSelfBase, T>)
+				__set_shared_weak_self(static_cast<ArcSelfBase*>(ptr), Weak<T>(*this));
 		}
 
 		explicit Arc(T* ptr, RefCount* count):
@@ -147,8 +178,14 @@ namespace kstd {
 
 		void reset() {
 			if(m_count) {
-				if(m_count->release_strong() == PtrReleaseAction::Destroy)
-					delete m_ptr;
+				// A separately allocated count may be freed by release_strong(), so check what kind it is first
+				bool intrusive = m_count->is_intrusive();
+				if(m_count->release_strong() == PtrReleaseAction::Destroy) {
+					if(intrusive)
+						m_count->destroy_intrusive();
+					else
+						delete m_ptr;
+				}
 			}
 			m_ptr = nullptr;
 			m_count = nullptr;
@@ -345,4 +382,93 @@ namespace kstd {
 	void __set_shared_weak_self(ArcSelfBase* base, Weak<T> weak) {
 		base->m_weak_self = weak;
 	}
+
+	/**
+	 * Like ArcSelf, but with the reference count stored inside of the object instead of separately allocated. This saves
+	 * an allocation per object and a pointer chase per reference, and means self() and wrapping a raw pointer in an Arc
+	 * are just an increment. Objects must be allocated as T itself, not as a subclass of it.
+	 */
+	template<typename T>
+	class ArcIntrusive: public ArcSelf<T>, public ArcIntrusiveBase {
+	public:
+		ArcIntrusive(): ArcIntrusiveBase(&s_ops) {}
+		ArcIntrusive(const ArcIntrusive& other): ArcIntrusiveBase(&s_ops) {}
+		ArcIntrusive& operator=(const ArcIntrusive& other) { return *this; }
+
+		inline Arc<T> self() {
+			ASSERT(intrusive_ref_count()->strong_count());
+			return Arc<T>(static_cast<T*>(this), intrusive_ref_count());
+		}
+
+	private:
+		static T* object_for(RefCount* count) {
+			// The count is the only thing in ArcIntrusiveBase, so it's at the start of it
+			return static_cast<T*>(static_cast<ArcIntrusive*>(reinterpret_cast<ArcIntrusiveBase*>(count)));
+		}
+
+		static void destroy_object(RefCount* count) {
+			object_for(count)->~T();
+		}
+
+		static void free_object(RefCount* count) {
+			void* mem = object_for(count);
+			if constexpr(requires { T::operator delete(mem); })
+				T::operator delete(mem);
+			else
+				::operator delete(mem);
+		}
+
+		static constexpr IntrusiveOps s_ops = {destroy_object, free_object};
+	};
+
+	/**
+	 * A borrowed reference to an object owned by an Arc somewhere else, which doesn't touch the reference count. Hot paths
+	 * can pass these around instead of copying Arcs, but one mustn't outlive the Arc it came from. Use arc() to take a
+	 * real reference when it needs to be kept.
+	 */
+	template<typename T>
+	class ArcRef {
+	public:
+		ArcRef(): m_ptr(nullptr), m_count(nullptr) {}
+		ArcRef(const Arc<T>& arc): m_ptr(arc.get()), m_count(arc.ref_count()) {}
+		template<typename U>
+		ArcRef(const Arc<U>& arc): m_ptr(static_cast<T*>(arc.get())), m_count(arc.ref_count()) {}
+		// Borrowing a temporary Arc would leave us pointing at an object nobody's keeping alive
+		ArcRef(Arc<T>&& arc) = delete;
+
+		/** Borrows an object with an intrusive count from a raw pointer, since the count can be found from it. **/
+		explicit ArcRef(T* ptr) requires is_base_of<ArcIntrusiveBase, T>:
+			m_ptr(ptr),
+			m_count(ptr ? static_cast<ArcIntrusiveBase*>(ptr)->intrusive_ref_count() : nullptr) {}
+
+		/** Takes a strong reference to the object. **/
+		Arc<T> arc() const { return Arc<T>(m_ptr, m_count); }
+
+		T* get() const { return m_ptr; }
+
+		T& operator*() const {
+			ASSERT(m_ptr);
+			return *m_ptr;
+		}
+
+		T* operator->() const {
+			ASSERT(m_ptr);
+			return m_ptr;
+		}
+
+		explicit operator bool() const { return m_ptr; }
+
+		template<typename U>
+		bool operator==(const ArcRef<U>& other) const { return other.get() == m_ptr; }
+		template<typename U>
+		bool operator==(const Arc<U>& other) const { return other.get() == m_ptr; }
+		template<typename U>
+		bool operator!=(const ArcRef<U>& other) const { return other.get() != m_ptr; }
+		template<typename U>
+		bool operator!=(const Arc<U>& other) const { return other.get() != m_ptr; }
+
+	private:
+		T* m_ptr;
+		RefCount* m_count;
+	};
 }
\ No newline at end of file
@@ -41,7 +41,9 @@ namespace kstd {
 			if(m_bits)
 				kfree(m_bits);
 			m_bits = other.m_bits;
+			m_num_bits = other.m_num_bits;
 			other.m_bits = nullptr;
+			other.m_num_bits = 0;
 			return *this;
 		}
 
@@ -62,6 +64,24 @@ namespace kstd {
 			memset(m_bits, value ? (~0) : 0, (m_num_bits + 7) / 8);
 		}
 
+		/** Grows the bitmap to hold a number of bits. The new bits are cleared. **/
+		void grow(size_t num_bits) {
+			if(num_bits <= m_num_bits)
+				return;
+			auto* new_bits = (uint8_t*) kmalloc((num_bits + 7) / 8);
+			memset(new_bits, 0, (num_bits + 7) / 8);
+			if(m_bits) {
+				memcpy(new_bits, m_bits, (m_num_bits + 7) / 8);
+				if(m_num_bits % 8)
+					new_bits[m_num_bits / 8] &= (1 << (m_num_bits % 8)) - 1;
+				kfree(m_bits);
+			}
+			m_bits = new_bits;
+			m_num_bits = num_bits;
+		}
+
+		size_t size() const { return m_num_bits; }
+
 	private:
 		uint8_t* m_bits = nullptr;
 		size_t m_num_bits;
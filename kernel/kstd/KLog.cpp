@@ -1,21 +1,105 @@
 #include "KLog.h"
 #include "kstdio.h"
+#include "kstdlib.h"
+#include "cstring.h"
+#include "lockfree_queue.hpp"
 #include "../tasking/SpinLock.h"
+#include "../tasking/TaskManager.h"
+#include "../tasking/Thread.h"
 #include <kernel/time/TimeManager.h>
 
-extern SpinLock printf_lock;
+extern bool g_panicking;
+
+struct KLogRecord {
+	size_t length;
+	char text[KLOG_RECORD_SIZE];
+};
+
+static kstd::mpsc_queue<KLogRecord, KLOG_QUEUE_SIZE> s_queue;
+static BooleanBlocker s_blocker;
+static bool s_thread_running = false;
+static Atomic<size_t> s_num_dropped = 0;
+static size_t s_num_reported_dropped = 0;
+
+void klog_entry() {
+	// Nothing's waiting on the log, so it can wait for everything else
+	TaskManager::current_thread()->set_base_priority(THREAD_PRIORITY_MIN);
+	s_thread_running = true;
+	while(1) {
+		// Clear the blocker before draining so that records queued while we're busy aren't missed
+		s_blocker.set_ready(false);
+		KLog::flush();
+		TaskManager::current_thread()->block(s_blocker);
+	}
+}
+
+static void write_out(const char* text, size_t length) {
+	char buf[KLOG_RECORD_SIZE + 1];
+	memcpy(buf, text, length);
+	buf[length] = '\0';
+	printf("%s", buf);
+}
+
+static void queue(const char* text, size_t length) {
+	if(!s_thread_running || g_panicking) {
+		write_out(text, length);
+		return;
+	}
+
+	KLogRecord record;
+	record.length = length;
+	memcpy(record.text, text, length);
+	if(!s_queue.push(record)) {
+		s_num_dropped.add(1);
+		return;
+	}
+	s_blocker.set_ready(true);
+}
+
 void klog_print(const char* component, const char* color, const char* type, const char* fmt, va_list list) {
 	auto time = TimeManager::uptime();
-	char* usec_buf = "0000000";
+	char usec_buf[8] = "0000000";
 	for(int i = 0; i < 7; i++) {
 		usec_buf[6 - i] = (unsigned char) (time.tv_usec % 10) + '0';
 		time.tv_usec /= 10;
 	}
 
-	LOCK(printf_lock);
-	printf("\033[%sm[%d.%s] [%s] [%s] ", color, (int) time.tv_sec, usec_buf, component, type);
-	vprintf(fmt, list);
-	print("\033[39;49m\n");
+	// Leave room for resetting the color at the end, even if the message had to be cut off
+	static const char* suffix = "\033[39;49m\n";
+	static const size_t suffix_length = strlen(suffix);
+	char buf[KLOG_RECORD_SIZE];
+	size_t max_length = KLOG_RECORD_SIZE - suffix_length;
+	size_t length = min(snprintf(buf, max_length + 1, "\033[%sm[%d.%s] [%s] [%s] ", color, (int) time.tv_sec, usec_buf, component, type), max_length);
+	length += min(vsnprintf(buf + length, max_length - length + 1, fmt, list), max_length - length);
+	memcpy(buf + length, suffix, suffix_length);
+	queue(buf, length + suffix_length);
+}
+
+void KLog::write(const char* text, size_t length) {
+	while(length) {
+		size_t chunk = min(length, (size_t) KLOG_RECORD_SIZE);
+		queue(text, chunk);
+		text += chunk;
+		length -= chunk;
+	}
+}
+
+void KLog::flush() {
+	KLogRecord record;
+	while(s_queue.pop(record)) {
+		auto num_dropped = s_num_dropped.load();
+		if(num_dropped != s_num_reported_dropped) {
+			char buf[64];
+			snprintf(buf, sizeof(buf), "[KLog] %d messages dropped\n", (int) (num_dropped - s_num_reported_dropped));
+			write_out(buf, strlen(buf));
+			s_num_reported_dropped = num_dropped;
+		}
+		write_out(record.text, record.length);
+	}
+}
+
+size_t KLog::num_dropped() {
+	return s_num_dropped.load();
 }
 
 void KLog::dbg(const char* component, const char* fmt, ...) {
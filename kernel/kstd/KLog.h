@@ -19,6 +19,19 @@
 
 #pragma once
 
+#include "types.h"
+
+// The most characters in one queued kernel log record, and how many records can be waiting to be written out.
+#define KLOG_RECORD_SIZE 256
+#define KLOG_QUEUE_SIZE 256
+
+void klog_entry();
+
+/**
+ * The kernel log. Messages are formatted into a lock-free queue, and a low-priority kernel thread writes them out to the
+ * serial port and console, so that logging never has to wait on the UART. Until that thread starts, and once the
+ * kernel panics, messages are written out right away instead. If the queue is full, messages are dropped and counted.
+ */
 namespace KLog {
 	void dbg(const char* component, const char* fmt, ...);
 	void info(const char* component, const char* fmt, ...);
@@ -26,4 +39,11 @@ namespace KLog {
 	void warn(const char* component, const char* fmt, ...);
 	void err(const char* component, const char* fmt, ...);
 	void crit(const char* component, const char* fmt, ...);
+
+	/// Queues text to be written to the log as-is. Text longer than a record is split across several.
+	void write(const char* text, size_t length);
+	/// Writes out everything that's queued right away. Called when panicking.
+	void flush();
+	/// The number of records that were dropped because the queue was full.
+	size_t num_dropped();
 }
@@ -3,36 +3,59 @@
 
 #pragma once
 
-#include "map.hpp"
-#include "vector.hpp"
 #include "pair.hpp"
+#include "utility.h"
 #include "../Result.hpp"
 #include "Optional.h"
+#include "../memory/kslab.h"
 
 namespace kstd {
+	/**
+	 * A cache that keeps track of the order its items were used in. Items are kept in a hash table for lookups and are
+	 * chained together in a list from least to most recently used, so getting, inserting, promoting and evicting an item
+	 * don't depend on how big the cache is. Keys must be integers.
+	 */
 	template<typename Key, typename Value>
 	class LRUCache {
 	public:
 		LRUCache() = default;
+		LRUCache(const LRUCache& other) = delete;
+		~LRUCache() {
+			prune(m_size);
+			delete[] m_buckets;
+		}
 
 		/** Insert the item with the given key and value, replacing it if it exists. **/
 		void insert(Key key, Value value) {
-			auto node = m_map.get(key);
+			auto* node = find(key);
 			if(node) {
-				*node = value;
-				promote(key);
-			} else {
-				m_map.insert({key, value});
-				m_lru_list.push_back(key);
+				node->value = kstd::move(value);
+				move_to_back(node);
+				return;
 			}
+
+			if(m_size >= m_num_buckets)
+				grow();
+			node = new Node(key, kstd::move(value));
+			auto& bucket = m_buckets[bucket_for(key)];
+			node->hash_next = bucket;
+			bucket = node;
+			append(node);
+			m_size++;
 		}
 
 		/** Removes the item with the given key if it exists. **/
 		void erase(Key key) {
-			m_map.erase(key);
-			for(size_t i = 0; i < m_lru_list.size(); i++) {
-				if(m_lru_list[i] == key) {
-					m_lru_list.erase(i);
+			if(!m_num_buckets)
+				return;
+			auto** link = &m_buckets[bucket_for(key)];
+			for(; *link; link = &(*link)->hash_next) {
+				if((*link)->key == key) {
+					auto* node = *link;
+					*link = node->hash_next;
+					unlink(node);
+					delete node;
+					m_size--;
 					return;
 				}
 			}
@@ -40,55 +63,156 @@ namespace kstd {
 
 		/** Promote the item with the given key, if in the list, to be most recently used. **/
 		void promote(Key key) {
-			bool found = false;
-			for(size_t i = 0; i < m_lru_list.size(); i++) {
-				if(m_lru_list[i] == key) {
-					m_lru_list.erase(i);
-					found = true;
-					break;
-				}
-			}
+			auto* node = find(key);
+			if(node)
+				move_to_back(node);
+		}
 
-			if(found)
-				m_lru_list.push_back(key);
+		/** Whether the item with the given key is in the cache. Doesn't promote it. **/
+		bool contains(Key key) {
+			return find(key);
 		}
 
 		/** Gets the item with the given key **/
 		kstd::Optional<Value> get(Key key) {
-			auto item = m_map.get(key);
-			if(item) {
-				promote(key);
-				return *item;
-			}
-			return kstd::nullopt;
+			auto* node = find(key);
+			if(!node)
+				return kstd::nullopt;
+			move_to_back(node);
+			return node->value;
 		}
 
 		/** Prunes a number of items from the cache. **/
 		void prune(size_t num) {
-			while(!m_lru_list.empty() && num--) {
-				m_map.erase(m_lru_list[0]);
-				m_lru_list.erase(0);
+			while(m_lru_head && num--)
+				erase(m_lru_head->key);
+		}
+
+		/**
+		 * Prunes up to a number of items that match a predicate from the cache, least recently used first.
+		 * @param num The maximum number of items to prune.
+		 * @param predicate A function taking a key and a value reference that returns whether to prune the item.
+		 * @return The number of items pruned.
+		 */
+		template<typename F>
+		size_t prune_if(size_t num, F&& predicate) {
+			size_t num_pruned = 0;
+			auto* node = m_lru_head;
+			while(node && num_pruned < num) {
+				auto* next = node->lru_next;
+				if(predicate(node->key, node->value)) {
+					erase(node->key);
+					num_pruned++;
+				}
+				node = next;
 			}
+			return num_pruned;
 		}
 
 		/** Returns the least recently used item. **/
 		kstd::Optional<kstd::pair<Key, Value&>> lru() {
 			if(empty())
 				return kstd::nullopt;
-			return kstd::pair<Key, Value&> {m_lru_list[0], m_map[m_lru_list[0]]};
+			return kstd::pair<Key, Value&> {m_lru_head->key, m_lru_head->value};
 		}
 
 		/** Returns the least recently used item without wrapping in an optional. **/
 		kstd::pair<Key, Value&> lru_unsafe() {
 			ASSERT(!empty());
-			return kstd::pair<Key, Value&> {m_lru_list[0], m_map[m_lru_list[0]]};
+			return kstd::pair<Key, Value&> {m_lru_head->key, m_lru_head->value};
 		}
 
-		[[nodiscard]] size_t size() const { return m_lru_list.size(); }
-		[[nodiscard]] bool empty() const { return m_lru_list.empty(); }
+		[[nodiscard]] size_t size() const { return m_size; }
+		[[nodiscard]] bool empty() const { return !m_size; }
 
 	private:
-		kstd::map<Key, Value> m_map;
-		kstd::vector<Key> m_lru_list;
+		class Node {
+		public:
+			Node(Key key, Value value): key(key), value(kstd::move(value)) {}
+
+			static void* operator new(size_t size) { return kslab_alloc(size); }
+			static void operator delete(void* ptr) { kslab_free(ptr); }
+
+			Key key;
+			Value value;
+			Node* hash_next = nullptr;
+			Node* lru_prev = nullptr;
+			Node* lru_next = nullptr;
+		};
+
+		size_t bucket_for(Key key) const {
+			//Fibonacci hashing, using the top bits since the keys often have the same low bits (like block numbers)
+			auto wide_key = (uint64_t) key;
+			auto hash = (uint32_t) (wide_key ^ (wide_key >> 32)) * 2654435761u;
+			return hash >> (32 - m_bucket_bits);
+		}
+
+		Node* find(Key key) {
+			if(!m_num_buckets)
+				return nullptr;
+			for(auto* node = m_buckets[bucket_for(key)]; node; node = node->hash_next) {
+				if(node->key == key)
+					return node;
+			}
+			return nullptr;
+		}
+
+		/** Doubles the number of buckets, so that there are about as many buckets as items. **/
+		void grow() {
+			auto* old_buckets = m_buckets;
+			size_t old_num_buckets = m_num_buckets;
+			m_bucket_bits = m_num_buckets ? m_bucket_bits + 1 : 4;
+			m_num_buckets = 1u << m_bucket_bits;
+			m_buckets = new Node*[m_num_buckets];
+			for(size_t i = 0; i < m_num_buckets; i++)
+				m_buckets[i] = nullptr;
+
+			for(size_t i = 0; i < old_num_buckets; i++) {
+				auto* node = old_buckets[i];
+				while(node) {
+					auto* next = node->hash_next;
+					auto& bucket = m_buckets[bucket_for(node->key)];
+					node->hash_next = bucket;
+					bucket = node;
+					node = next;
+				}
+			}
+			delete[] old_buckets;
+		}
+
+		void append(Node* node) {
+			node->lru_prev = m_lru_tail;
+			node->lru_next = nullptr;
+			if(m_lru_tail)
+				m_lru_tail->lru_next = node;
+			else
+				m_lru_head = node;
+			m_lru_tail = node;
+		}
+
+		void unlink(Node* node) {
+			if(node->lru_prev)
+				node->lru_prev->lru_next = node->lru_next;
+			else
+				m_lru_head = node->lru_next;
+			if(node->lru_next)
+				node->lru_next->lru_prev = node->lru_prev;
+			else
+				m_lru_tail = node->lru_prev;
+		}
+
+		void move_to_back(Node* node) {
+			if(node == m_lru_tail)
+				return;
+			unlink(node);
+			append(node);
+		}
+
+		Node** m_buckets = nullptr;
+		size_t m_num_buckets = 0;
+		size_t m_bucket_bits = 0;
+		size_t m_size = 0;
+		Node* m_lru_head = nullptr; ///< The least recently used item.
+		Node* m_lru_tail = nullptr; ///< The most recently used item.
 	};
-}
\ No newline at end of file
+}
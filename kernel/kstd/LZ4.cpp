@@ -0,0 +1,166 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "LZ4.h"
+#include "cstring.h"
+#include "kstdlib.h"
+#include "kstdio.h"
+
+// The format requires the last match to start at least 12 bytes before the end, and the last 5 bytes to be literals
+#define LZ4_MIN_MATCH 4
+#define LZ4_MATCH_START_LIMIT 12
+#define LZ4_LAST_LITERALS 5
+#define LZ4_HASH_BITS 12
+
+namespace kstd::LZ4 {
+	static inline uint32_t read32(const uint8_t* ptr) {
+		uint32_t value;
+		memcpy(&value, ptr, sizeof(uint32_t));
+		return value;
+	}
+
+	static inline uint32_t hash(uint32_t sequence) {
+		return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+	}
+
+	/// The most bytes a sequence with the given literal and match lengths can take up.
+	static inline size_t sequence_bound(size_t literal_length, size_t match_length) {
+		return 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1;
+	}
+
+	static inline void write_length(uint8_t*& out, size_t length) {
+		length -= 15;
+		while(length >= 255) {
+			*out++ = 255;
+			length -= 255;
+		}
+		*out++ = (uint8_t) length;
+	}
+
+	size_t compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity) {
+		ASSERT(size <= max_input_size);
+		const uint8_t* in = src;
+		const uint8_t* anchor = src;
+		const uint8_t* const end = src + size;
+		uint8_t* out = dst;
+		uint8_t* const out_end = dst + capacity;
+
+		// Positions of recently seen four-byte sequences, by hash. Inputs are small enough for them to fit in 16 bits.
+		uint16_t table[1 << LZ4_HASH_BITS];
+		memset(table, 0, sizeof(table));
+
+		if(size > LZ4_MATCH_START_LIMIT) {
+			const uint8_t* const match_start_limit = end - LZ4_MATCH_START_LIMIT;
+			const uint8_t* const match_end_limit = end - LZ4_LAST_LITERALS;
+			while(in < match_start_limit) {
+				uint32_t sequence = read32(in);
+				auto& entry = table[hash(sequence)];
+				const uint8_t* match = src + entry;
+				entry = (uint16_t) (in - src);
+				if(match >= in || read32(match) != sequence) {
+					in++;
+					continue;
+				}
+
+				// Extend the match as far as it goes in both directions
+				while(in > anchor && match > src && in[-1] == match[-1]) {
+					in--;
+					match--;
+				}
+				const uint8_t* match_end = in + LZ4_MIN_MATCH;
+				const uint8_t* ref_end = match + LZ4_MIN_MATCH;
+				while(match_end < match_end_limit && *match_end == *ref_end) {
+					match_end++;
+					ref_end++;
+				}
+
+				size_t literal_length = in - anchor;
+				size_t match_length = match_end - in - LZ4_MIN_MATCH;
+				if(sequence_bound(literal_length, match_length) > (size_t) (out_end - out))
+					return 0;
+
+				uint8_t* token = out++;
+				*token = (uint8_t) ((min(literal_length, (size_t) 15) << 4) | min(match_length, (size_t) 15));
+				if(literal_length >= 15)
+					write_length(out, literal_length);
+				memcpy(out, anchor, literal_length);
+				out += literal_length;
+				size_t offset = in - match;
+				*out++ = (uint8_t) offset;
+				*out++ = (uint8_t) (offset >> 8);
+				if(match_length >= 15)
+					write_length(out, match_length);
+
+				in = match_end;
+				anchor = in;
+			}
+		}
+
+		// Whatever's left over goes in a final sequence of just literals
+		size_t literal_length = end - anchor;
+		if(sequence_bound(literal_length, 0) > (size_t) (out_end - out))
+			return 0;
+		*out++ = (uint8_t) (min(literal_length, (size_t) 15) << 4);
+		if(literal_length >= 15)
+			write_length(out, literal_length);
+		memcpy(out, anchor, literal_length);
+		out += literal_length;
+		return out - dst;
+	}
+
+	ssize_t decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity) {
+		const uint8_t* in = src;
+		const uint8_t* const end = src + size;
+		uint8_t* out = dst;
+		uint8_t* const out_end = dst + capacity;
+
+		auto read_length = [&](size_t& length) -> bool {
+			uint8_t byte;
+			do {
+				if(in >= end)
+					return false;
+				byte = *in++;
+				length += byte;
+			} while(byte == 255);
+			return true;
+		};
+
+		while(in < end) {
+			uint8_t token = *in++;
+
+			size_t literal_length = token >> 4;
+			if(literal_length == 15 && !read_length(literal_length))
+				return -1;
+			if(literal_length > (size_t) (end - in) || literal_length > (size_t) (out_end - out))
+				return -1;
+			memcpy(out, in, literal_length);
+			in += literal_length;
+			out += literal_length;
+
+			// The last sequence doesn't have a match
+			if(in == end)
+				break;
+
+			if(end - in < 2)
+				return -1;
+			size_t offset = in[0] | (in[1] << 8);
+			in += 2;
+			if(!offset || offset > (size_t) (out - dst))
+				return -1;
+
+			size_t match_length = token & 0xFu;
+			if(match_length == 15 && !read_length(match_length))
+				return -1;
+			match_length += LZ4_MIN_MATCH;
+			if(match_length > (size_t) (out_end - out))
+				return -1;
+
+			// Matches can overlap with what they're writing, so they have to be copied a byte at a time
+			const uint8_t* match = out - offset;
+			for(size_t i = 0; i < match_length; i++)
+				*out++ = *match++;
+		}
+
+		return out - dst;
+	}
+}
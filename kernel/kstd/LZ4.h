@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "unix_types.h"
+
+/**
+ * A compressor and decompressor for the LZ4 block format. It trades compression ratio for speed, which makes it good for
+ * compressing pages in memory. Inputs are limited to 64KiB, so that match offsets always fit.
+ */
+namespace kstd::LZ4 {
+	static constexpr size_t max_input_size = 65535;
+
+	/**
+	 * Compresses a block of data.
+	 * @param src The data to compress.
+	 * @param size The size of the data. Must be at most max_input_size.
+	 * @param dst Where to write the compressed data.
+	 * @param capacity The size of dst.
+	 * @return The size of the compressed data, or 0 if it didn't fit in capacity.
+	 */
+	size_t compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity);
+
+	/**
+	 * Decompresses a block of data.
+	 * @param src The compressed data.
+	 * @param size The size of the compressed data.
+	 * @param dst Where to write the decompressed data.
+	 * @param capacity The size of dst.
+	 * @return The size of the decompressed data, or -1 if the compressed data is malformed or doesn't fit in capacity.
+	 */
+	ssize_t decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity);
+}
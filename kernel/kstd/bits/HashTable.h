@@ -0,0 +1,260 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "../kstddef.h"
+#include "../utility.h"
+#include "../pair.hpp"
+#include "../hash.h"
+
+//The smallest number of slots a table has once something is put in it
+#define KSTD_HASH_TABLE_MIN_CAPACITY 16
+
+namespace kstd {
+	template<typename Table, typename EntryType>
+	class HashTableIterator;
+
+	/**
+	 * An open addressing hash table using Robin Hood probing, which unordered_map and unordered_set are built on. Entries
+	 * are stored inline in a flat array of slots, and each one keeps track of how far it is from the slot its hash wants.
+	 * When inserting, an entry takes the place of any entry closer to its own slot than it is, which keeps probe sequences
+	 * short. Removing an entry shifts the entries after it back instead of leaving tombstones.
+	 *
+	 * Inserting into or removing from the table invalidates iterators and pointers to entries.
+	 *
+	 * @tparam Entry The type stored in the table.
+	 * @tparam Key The type of the keys.
+	 * @tparam KeyOf A type with a static key(const Entry&) function returning the key of an entry.
+	 * @tparam Hash The hash function for keys.
+	 */
+	template<typename Entry, typename Key, typename KeyOf, typename Hash>
+	class HashTable {
+	public:
+		using Iterator = HashTableIterator<HashTable, Entry>;
+		using ConstIterator = HashTableIterator<const HashTable, const Entry>;
+
+		HashTable() = default;
+
+		HashTable(const HashTable& other) {
+			reserve(other.m_size);
+			for(auto& entry : other)
+				insert(Entry(entry));
+		}
+
+		HashTable(HashTable&& other) noexcept:
+			m_slots(other.m_slots), m_capacity(other.m_capacity), m_size(other.m_size)
+		{
+			other.m_slots = nullptr;
+			other.m_capacity = 0;
+			other.m_size = 0;
+		}
+
+		~HashTable() {
+			clear();
+			delete[] m_slots;
+		}
+
+		HashTable& operator=(const HashTable& other) {
+			if(&other != this) {
+				clear();
+				reserve(other.m_size);
+				for(auto& entry : other)
+					insert(Entry(entry));
+			}
+			return *this;
+		}
+
+		HashTable& operator=(HashTable&& other) noexcept {
+			if(&other != this) {
+				clear();
+				delete[] m_slots;
+				m_slots = other.m_slots;
+				m_capacity = other.m_capacity;
+				m_size = other.m_size;
+				other.m_slots = nullptr;
+				other.m_capacity = 0;
+				other.m_size = 0;
+			}
+			return *this;
+		}
+
+		/** Finds the entry with the given key, or returns nullptr if there isn't one. **/
+		Entry* find(const Key& key) const {
+			size_t index = find_index(key);
+			return index == m_capacity ? nullptr : &m_slots[index].entry();
+		}
+
+		/**
+		 * Inserts an entry if there isn't one with the same key already.
+		 * @return The entry with the key, and whether it was inserted.
+		 */
+		pair<Entry*, bool> insert(Entry&& entry) {
+			auto* existing = find(KeyOf::key(entry));
+			if(existing)
+				return {existing, false};
+
+			//Keep the load factor under 3/4, past which probe sequences get long
+			if((m_size + 1) * 4 > m_capacity * 3)
+				rehash(m_capacity ? m_capacity * 2 : KSTD_HASH_TABLE_MIN_CAPACITY);
+
+			auto* inserted = place(kstd::move(entry));
+			m_size++;
+			return {inserted, true};
+		}
+
+		/** Removes the entry with the given key. Returns whether there was one. **/
+		bool erase(const Key& key) {
+			size_t index = find_index(key);
+			if(index == m_capacity)
+				return false;
+
+			//Shift the entries after it back a slot until one is already where it belongs
+			size_t mask = m_capacity - 1;
+			m_slots[index].entry().~Entry();
+			while(true) {
+				size_t next = (index + 1) & mask;
+				auto& next_slot = m_slots[next];
+				if(next_slot.distance <= 1)
+					break;
+				new (&m_slots[index].storage) Entry(kstd::move(next_slot.entry()));
+				m_slots[index].distance = next_slot.distance - 1;
+				next_slot.entry().~Entry();
+				index = next;
+			}
+			m_slots[index].distance = 0;
+			m_size--;
+			return true;
+		}
+
+		/** Removes every entry, but keeps the slots allocated. **/
+		void clear() {
+			for(size_t i = 0; i < m_capacity && m_size; i++) {
+				if(m_slots[i].distance) {
+					m_slots[i].entry().~Entry();
+					m_slots[i].distance = 0;
+					m_size--;
+				}
+			}
+		}
+
+		/** Makes room for a number of entries, so that inserting them doesn't have to grow the table. **/
+		void reserve(size_t num_entries) {
+			size_t capacity = m_capacity ? m_capacity : KSTD_HASH_TABLE_MIN_CAPACITY;
+			while(num_entries * 4 > capacity * 3)
+				capacity *= 2;
+			if(capacity != m_capacity)
+				rehash(capacity);
+		}
+
+		[[nodiscard]] size_t size() const { return m_size; }
+		[[nodiscard]] bool empty() const { return !m_size; }
+		[[nodiscard]] size_t capacity() const { return m_capacity; }
+
+		Iterator begin() { return Iterator(*this, 0); }
+		ConstIterator begin() const { return ConstIterator(*this, 0); }
+		Iterator end() { return Iterator(*this, m_capacity); }
+		ConstIterator end() const { return ConstIterator(*this, m_capacity); }
+
+	private:
+		friend class HashTableIterator<HashTable, Entry>;
+		friend class HashTableIterator<const HashTable, const Entry>;
+
+		struct Slot {
+			uint32_t distance = 0; ///< How many slots the entry is from where its hash wants it plus one, or zero if empty.
+			alignas(Entry) uint8_t storage[sizeof(Entry)];
+
+			Entry& entry() { return *((Entry*) storage); }
+		};
+
+		/** Finds the slot with the given key, or returns the capacity if there isn't one. **/
+		size_t find_index(const Key& key) const {
+			if(!m_size)
+				return m_capacity;
+			size_t mask = m_capacity - 1;
+			size_t index = Hash()(key) & mask;
+			for(uint32_t distance = 1;; distance++) {
+				auto& slot = m_slots[index];
+				//If we find an entry closer to home than we would be, ours would have taken its place
+				if(slot.distance < distance)
+					return m_capacity;
+				if(KeyOf::key(slot.entry()) == key)
+					return index;
+				index = (index + 1) & mask;
+			}
+		}
+
+		/** Puts an entry that isn't in the table yet into it, and returns where it ended up. There must be a free slot. **/
+		Entry* place(Entry&& new_entry) {
+			size_t mask = m_capacity - 1;
+			size_t index = Hash()(KeyOf::key(new_entry)) & mask;
+			Entry* placed = nullptr;
+			Entry carried(kstd::move(new_entry));
+			uint32_t distance = 1;
+			while(true) {
+				auto& slot = m_slots[index];
+				if(!slot.distance) {
+					new (&slot.storage) Entry(kstd::move(carried));
+					slot.distance = distance;
+					return placed ? placed : &slot.entry();
+				}
+				if(slot.distance < distance) {
+					//Take the slot from the entry that's closer to home, and carry on finding a place for that one
+					kstd::swap(slot.entry(), carried);
+					kstd::swap(slot.distance, distance);
+					if(!placed)
+						placed = &slot.entry();
+				}
+				index = (index + 1) & mask;
+				distance++;
+			}
+		}
+
+		void rehash(size_t new_capacity) {
+			auto* old_slots = m_slots;
+			size_t old_capacity = m_capacity;
+			m_slots = new Slot[new_capacity];
+			m_capacity = new_capacity;
+			for(size_t i = 0; i < old_capacity; i++) {
+				if(old_slots[i].distance) {
+					place(kstd::move(old_slots[i].entry()));
+					old_slots[i].entry().~Entry();
+				}
+			}
+			delete[] old_slots;
+		}
+
+		Slot* m_slots = nullptr;
+		size_t m_capacity = 0; ///< The number of slots. Always zero or a power of two.
+		size_t m_size = 0;
+	};
+
+	template<typename Table, typename EntryType>
+	class HashTableIterator {
+	public:
+		HashTableIterator(Table& table, size_t index): m_table(table), m_index(index) {
+			skip_empty();
+		}
+
+		bool operator==(const HashTableIterator& other) const { return m_index == other.m_index; }
+		bool operator!=(const HashTableIterator& other) const { return m_index != other.m_index; }
+
+		HashTableIterator& operator++() {
+			m_index++;
+			skip_empty();
+			return *this;
+		}
+
+		EntryType& operator*() const { return m_table.m_slots[m_index].entry(); }
+		EntryType* operator->() const { return &m_table.m_slots[m_index].entry(); }
+
+	private:
+		void skip_empty() {
+			while(m_index < m_table.m_capacity && !m_table.m_slots[m_index].distance)
+				m_index++;
+		}
+
+		Table& m_table;
+		size_t m_index;
+	};
+}
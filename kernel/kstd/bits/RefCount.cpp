@@ -3,6 +3,7 @@
 
 #include "RefCount.h"
 #include "../../tasking/SpinLock.h"
+#include "../../memory/kslab.h"
 
 using namespace kstd;
 
@@ -10,9 +11,23 @@ RefCount::RefCount(int strong_count):
 		m_strong_count(strong_count),
 		m_weak_count(0) {}
 
+RefCount::RefCount(const IntrusiveOps* ops):
+		m_strong_count(0),
+		m_weak_count(1),
+		m_intrusive(ops) {}
+
 RefCount::RefCount(RefCount&& other):
 	m_strong_count(other.m_strong_count),
-	m_weak_count(other.m_weak_count) {}
+	m_weak_count(other.m_weak_count),
+	m_intrusive(other.m_intrusive) {}
+
+void* RefCount::operator new(size_t size) {
+	return kslab_alloc(size);
+}
+
+void RefCount::operator delete(void* ptr) {
+	kslab_free(ptr);
+}
 
 RefCount::~RefCount() {
 	ASSERT(m_strong_count.load() == 0);
@@ -38,31 +53,24 @@ bool RefCount::make_strong() {
 	return true;
 }
 
-void RefCount::acquire_strong() {
-	auto prev = m_strong_count.add(1);
-	ASSERT(prev != 0);
-}
-
 void RefCount::acquire_weak() {
 	m_weak_count.add(1);
 }
 
-PtrReleaseAction RefCount::release_strong() {
-	auto prev = m_strong_count.sub(1);
-	ASSERT(prev > 0);
-	if(prev == 1) {
-		if(m_weak_count.load() == 0)
-			delete this;
-		return PtrReleaseAction::Destroy;
-	}
-	return PtrReleaseAction::Keep;
-}
-
 void RefCount::release_weak() {
 	auto prev = m_weak_count.sub(1);
 	ASSERT(prev > 0);
 	if(prev == 1) {
-		if(m_strong_count.load() == 0)
+		if(m_intrusive)
+			m_intrusive->free(this);
+		else if(m_strong_count.load() == 0)
 			delete this;
 	}
+}
+
+void RefCount::destroy_intrusive() {
+	ASSERT(m_intrusive && !m_strong_count.load());
+	m_intrusive->destroy(this);
+	// Drop the weak reference the strong references were holding. If nothing else has one, this frees the object.
+	release_weak();
 }
\ No newline at end of file
@@ -12,13 +12,30 @@ namespace kstd {
 		Keep, Destroy
 	};
 
+	class RefCount;
+
+	/** How to destroy and free an object whose reference count is stored inside of it. See ArcIntrusive. **/
+	struct IntrusiveOps {
+		void (*destroy)(RefCount* count); ///< Runs the object's destructor, leaving its memory allocated.
+		void (*free)(RefCount* count); ///< Frees the object's memory.
+	};
+
 	class RefCount {
 	public:
 		explicit RefCount(int strong_count);
+		/**
+		 * Makes the reference count for an object that stores it inline. Its strong references collectively hold a weak
+		 * reference, so that the object's memory (and this count) stick around until the last weak reference is gone.
+		 */
+		explicit RefCount(const IntrusiveOps* ops);
 		RefCount(RefCount&& other);
 		RefCount(const RefCount& other) = delete;
 		~RefCount();
 
+		// Reference counts are allocated and freed constantly, so they come from the slab allocator
+		static void* operator new(size_t size);
+		static void operator delete(void* ptr);
+
 		/**
 		 * Gets the number of strong references.
 		 */
@@ -40,7 +57,19 @@ namespace kstd {
 		 * Increases the strong reference count when we know that
 		 * it's already at least one.
 		 */
-		void acquire_strong();
+		inline void acquire_strong() {
+			// Nothing is published by taking another reference, so there's nothing to order it against
+			auto prev = m_strong_count.add(1, MemoryOrder::Relaxed);
+			ASSERT(prev != 0);
+		}
+
+		/**
+		 * Increases the strong reference count of an intrusive count, which may be zero if it's the first reference.
+		 * @return Whether this was the first strong reference.
+		 */
+		inline bool acquire_strong_intrusive() {
+			return m_strong_count.add(1, MemoryOrder::Relaxed) == 0;
+		}
 
 		/**
 		 * Acquires a weak reference.
@@ -51,15 +80,31 @@ namespace kstd {
 		 * Releases a strong reference.
 		 * @return An action describing if the object should be destroyed or kept.
 		 */
-		PtrReleaseAction release_strong();
+		inline PtrReleaseAction release_strong() {
+			// Release so that our writes to the object happen before whoever destroys it, acquire so that they see them
+			auto prev = m_strong_count.sub(1, MemoryOrder::AcqRel);
+			ASSERT(prev > 0);
+			if(prev != 1)
+				return PtrReleaseAction::Keep;
+			if(!m_intrusive && m_weak_count.load() == 0)
+				delete this;
+			return PtrReleaseAction::Destroy;
+		}
 
 		/**
 		 * Releases a weak reference.
 		 */
 		void release_weak();
 
+		/** Whether this count is stored inside of the object it counts. **/
+		[[nodiscard]] bool is_intrusive() const { return m_intrusive; }
+
+		/** Destroys an intrusively-counted object once release_strong() says to. **/
+		void destroy_intrusive();
+
 	private:
 		Atomic<long, MemoryOrder::SeqCst> m_strong_count = 0;
 		Atomic<long, MemoryOrder::SeqCst> m_weak_count = 0;
+		const IntrusiveOps* m_intrusive = nullptr;
 	};
 }
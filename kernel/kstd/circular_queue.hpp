@@ -68,6 +68,48 @@ namespace kstd {
 			return true;
 		}
 
+		/**
+		 * Pushes as many elements as there's room for onto the back of the queue.
+		 * @return The number of elements pushed.
+		 */
+		size_t push_back(const T* elems, size_t count) {
+			if(count > _capacity - _size)
+				count = _capacity - _size;
+			//Copy up to the end of the storage, and then wrap around to the beginning
+			size_t start = (_front + _size) % _capacity;
+			size_t first = count < _capacity - start ? count : _capacity - start;
+			for(size_t i = 0; i < first; i++)
+				new(&_storage[start + i]) T(elems[i]);
+			for(size_t i = first; i < count; i++)
+				new(&_storage[i - first]) T(elems[i]);
+			_size += count;
+			if(_size)
+				_back = (_front + _size - 1) % _capacity;
+			return count;
+		}
+
+		/**
+		 * Pops up to count elements off of the front of the queue.
+		 * @return The number of elements popped.
+		 */
+		size_t pop_front(T* dest, size_t count) {
+			if(count > _size)
+				count = _size;
+			for(size_t i = 0; i < count; i++) {
+				size_t index = _front + i < _capacity ? _front + i : _front + i - _capacity;
+				dest[i] = kstd::move(_storage[index]);
+				_storage[index].~T();
+			}
+			_size -= count;
+			if(_size == 0) {
+				_front = 0;
+				_back = 0;
+			} else {
+				_front = (_front + count) % _capacity;
+			}
+			return count;
+		}
+
 		T pop_front() {
 			T ret = _storage[_front];
 			_storage[_front].~T();
@@ -18,6 +18,69 @@
 */
 
 #include "cstring.h"
+#include <kernel/api/page_size.h>
+
+// Copies and fills this small are done with plain moves, since starting up a string instruction costs more
+#define MEMCPY_SMALL_SIZE 32
+// Copies at least this big are streamed around the cache, since they'd throw everything else out of it anyway
+#define MEMCPY_NONTEMPORAL_SIZE (256 * 1024)
+
+#define CPUID_EDX_SSE2 (1u << 26)
+#define CPUID_EBX_ERMS (1u << 9)
+
+typedef uint32_t __attribute__((may_alias, aligned(1))) unaligned_uint32_t;
+
+// Whether rep movsb and rep stosb are fast for any size (Enhanced REP MOVSB/STOSB)
+static bool s_has_erms = false;
+// Whether movnti can be used to write around the cache
+static bool s_has_sse2 = false;
+
+void init_memory_functions() {
+	uint32_t eax, ebx, ecx, edx;
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+	uint32_t max_leaf = eax;
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1), "c"(0));
+	s_has_sse2 = edx & CPUID_EDX_SSE2;
+	if(max_leaf >= 7) {
+		asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(7), "c"(0));
+		s_has_erms = ebx & CPUID_EBX_ERMS;
+	}
+}
+
+// These loops must not be turned back into calls to memcpy and memset by the compiler
+#define NO_MEM_BUILTINS __attribute__((optimize("no-tree-loop-distribute-patterns")))
+
+NO_MEM_BUILTINS static inline void copy_small(uint8_t* dest, const uint8_t* src, size_t count) {
+	while(count >= 4) {
+		*((unaligned_uint32_t*) dest) = *((const unaligned_uint32_t*) src);
+		dest += 4;
+		src += 4;
+		count -= 4;
+	}
+	while(count--)
+		*dest++ = *src++;
+}
+
+NO_MEM_BUILTINS static void copy_nontemporal(uint8_t* dest, const uint8_t* src, size_t count) {
+	size_t head = (-(uintptr_t) dest) & 3;
+	copy_small(dest, src, head);
+	dest += head;
+	src += head;
+	count -= head;
+
+	for(; count >= 16; dest += 16, src += 16, count -= 16) {
+		auto* words = (const unaligned_uint32_t*) src;
+		uint32_t a = words[0], b = words[1], c = words[2], d = words[3];
+		asm volatile(
+			"movnti %1, 0(%0)\n"
+			"movnti %2, 4(%0)\n"
+			"movnti %3, 8(%0)\n"
+			"movnti %4, 12(%0)\n"
+			:: "r"(dest), "r"(a), "r"(b), "r"(c), "r"(d) : "memory");
+	}
+	asm volatile("sfence" ::: "memory");
+	copy_small(dest, src, count);
+}
 
 char *strcat(char *dest, const char *src){
 	uint32_t i,j;
@@ -44,18 +107,86 @@ bool strcmp(const char* str1, const char* str2){
 	return flag == 0 && str1[i] == '\0' && str2[i] == '\0';
 }
 
-extern "C" void* memset(void* dest, int c, size_t n) {
+extern "C" NO_MEM_BUILTINS void* memset(void* dest, int c, size_t n) {
 	void* odest = dest;
-	asm volatile( "rep stosb" : "=D"(dest), "=c"(n) : "0"(dest), "1"(n), "a"(c) : "memory");
+	auto* d = (uint8_t*) dest;
+	if(n <= MEMCPY_SMALL_SIZE) {
+		while(n--)
+			*d++ = (uint8_t) c;
+		return odest;
+	}
+
+	if(s_has_erms) {
+		asm volatile("rep stosb" : "+D"(d), "+c"(n) : "a"(c) : "memory");
+		return odest;
+	}
+
+	// Line up the destination and fill it four bytes at a time
+	size_t head = (-(uintptr_t) d) & 3;
+	size_t words = (n - head) / 4;
+	size_t tail = (n - head) & 3;
+	uint32_t pattern = (uint8_t) c * 0x01010101u;
+	asm volatile("rep stosb" : "+D"(d), "+c"(head) : "a"(c) : "memory");
+	asm volatile("rep stosl" : "+D"(d), "+c"(words) : "a"(pattern) : "memory");
+	asm volatile("rep stosb" : "+D"(d), "+c"(tail) : "a"(c) : "memory");
 	return odest;
 }
 
-extern "C" void *memcpy(void *dest, const void *src, size_t count){
+extern "C" NO_MEM_BUILTINS void *memcpy(void *dest, const void *src, size_t count){
 	void* odest = dest;
-	asm volatile( "rep movsb" : "+D"(dest), "+S"(src), "+c"(count)::"memory");
+	if(count <= MEMCPY_SMALL_SIZE) {
+		copy_small((uint8_t*) dest, (const uint8_t*) src, count);
+		return odest;
+	}
+
+	if(s_has_sse2 && count >= MEMCPY_NONTEMPORAL_SIZE) {
+		copy_nontemporal((uint8_t*) dest, (const uint8_t*) src, count);
+		return odest;
+	}
+
+	if(s_has_erms) {
+		asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(count)::"memory");
+		return odest;
+	}
+
+	// Line up the destination and copy four bytes at a time
+	size_t head = (-(uintptr_t) dest) & 3;
+	size_t words = (count - head) / 4;
+	size_t tail = (count - head) & 3;
+	asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(head)::"memory");
+	asm volatile("rep movsl" : "+D"(dest), "+S"(src), "+c"(words)::"memory");
+	asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(tail)::"memory");
 	return odest;
 }
 
+void memcpy_page(void* dest, const void* src) {
+	if(s_has_erms) {
+		size_t count = PAGE_SIZE;
+		asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(count)::"memory");
+	} else {
+		size_t count = PAGE_SIZE / sizeof(uint32_t);
+		asm volatile("rep movsl" : "+D"(dest), "+S"(src), "+c"(count)::"memory");
+	}
+}
+
+void memzero_page_nontemporal(void* dest) {
+	if(!s_has_sse2) {
+		memset(dest, 0, PAGE_SIZE);
+		return;
+	}
+
+	auto* words = (uint32_t*) dest;
+	for(size_t i = 0; i < PAGE_SIZE / sizeof(uint32_t); i += 4) {
+		asm volatile(
+			"movnti %1, 0(%0)\n"
+			"movnti %1, 4(%0)\n"
+			"movnti %1, 8(%0)\n"
+			"movnti %1, 12(%0)\n"
+			:: "r"(&words[i]), "r"(0) : "memory");
+	}
+	asm volatile("sfence" ::: "memory");
+}
+
 void* memcpy_uint32(uint32_t* d, uint32_t* s, size_t n) {
 	void* od = d;
 	asm volatile("rep movsl\n" : "+S"(s), "+D"(d), "+c"(n)::"memory");
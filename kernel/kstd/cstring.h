@@ -28,6 +28,12 @@ bool strcmp(const char *str1, const char *str2);
 extern "C" void *memset(void *dest, int val, size_t count);
 extern "C" void *memcpy(void *dest, const void *src, size_t count);
 void* memcpy_uint32(uint32_t* d, uint32_t* s, size_t n);
+/// Picks the fastest way to copy and fill memory on this CPU. Until this is called, the slower safe ways are used.
+void init_memory_functions();
+/// Copies a page-aligned page.
+void memcpy_page(void* dest, const void* src);
+/// Zeroes a page-aligned page without pulling it into the cache, for pages that won't be used for a while.
+void memzero_page_nontemporal(void* dest);
 int strlen(const char *str);
 void substr(int i, char *src, char *dest);
 void substri(int i, char *src, char *dest);
@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "types.h"
+#include "string.h"
+
+namespace kstd {
+	/** Scrambles the bits of an integer, so that keys which only differ in their high bits end up in different buckets. **/
+	inline size_t hash_int(uint64_t value) {
+		auto x = (uint32_t) (value ^ (value >> 32));
+		x ^= x >> 16;
+		x *= 0x7feb352du;
+		x ^= x >> 15;
+		x *= 0x846ca68bu;
+		x ^= x >> 16;
+		return x;
+	}
+
+	/** Calculates the FNV-1a hash of a run of bytes. **/
+	inline size_t hash_bytes(const void* data, size_t length) {
+		auto* bytes = (const uint8_t*) data;
+		uint32_t hash = 2166136261u;
+		for(size_t i = 0; i < length; i++) {
+			hash ^= bytes[i];
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	/** Hashes keys for unordered_map and unordered_set. Specialize this to use other types as keys. **/
+	template<typename T>
+	struct hash;
+
+#define KSTD_INT_HASH(type) \
+	template<> struct hash<type> { size_t operator()(type value) const { return hash_int((uint64_t) value); } };
+
+	KSTD_INT_HASH(bool)
+	KSTD_INT_HASH(char)
+	KSTD_INT_HASH(signed char)
+	KSTD_INT_HASH(unsigned char)
+	KSTD_INT_HASH(short)
+	KSTD_INT_HASH(unsigned short)
+	KSTD_INT_HASH(int)
+	KSTD_INT_HASH(unsigned int)
+	KSTD_INT_HASH(long)
+	KSTD_INT_HASH(unsigned long)
+	KSTD_INT_HASH(long long)
+	KSTD_INT_HASH(unsigned long long)
+
+#undef KSTD_INT_HASH
+
+	template<typename T>
+	struct hash<T*> {
+		size_t operator()(T* value) const { return hash_int((size_t) value); }
+	};
+
+	template<>
+	struct hash<string> {
+		size_t operator()(const string& value) const { return hash_bytes(value.c_str(), value.length()); }
+	};
+
+	template<>
+	struct hash<string_view> {
+		size_t operator()(string_view value) const { return hash_bytes(value.data(), value.length()); }
+	};
+}
@@ -27,6 +27,7 @@
 #include <kernel/KernelMapper.h>
 #include <kernel/interrupt/interrupt.h>
 #include "cstring.h"
+#include "KLog.h"
 #include <kernel/filesystem/FileDescriptor.h>
 
 kstd::Arc<FileDescriptor> tty_desc(nullptr);
@@ -34,6 +35,7 @@ kstd::Arc<VirtualTTY> tty(nullptr);
 bool use_tty = true;
 bool g_panicking = false;
 bool did_setup_tty = false;
+int tty_batch_depth = 0;
 
 void putch(char c){
 	if(did_setup_tty) {
@@ -86,10 +88,9 @@ void printf(const char* fmt, ...) {
 	va_end(list);
 }
 
-void vprintf(const char* fmt, va_list argp){
-	if(!g_panicking && !TaskManager::in_critical())
-		printf_lock.acquire();
-
+/// Formats a string like printf, passing the pieces of the result to out_str and out_char.
+template<typename StrF, typename CharF>
+static void format(const char* fmt, va_list argp, StrF out_str, CharF out_char) {
 	const char *p;
 	int i;
 	char *s;
@@ -97,55 +98,86 @@ void vprintf(const char* fmt, va_list argp){
 
 	for(p = fmt; *p != '\0'; p++){
 		if(*p != '%'){
-			putch(*p);
+			out_char(*p);
 			continue;
 		}
 		switch(*++p){
 			case 'c':
 				i = va_arg(argp, int);
-				putch(i);
+				out_char(i);
 				break;
 
 			case 'd':
 				i = va_arg(argp, int);
 				s = itoa(i, fmtbuf, 10);
-				print(s);
+				out_str(s);
 				break;
 
 			case 's':
 				s = va_arg(argp, char *);
-				print(s);
+				out_str(s);
 				break;
 
 			case 'x':
 				i = va_arg(argp, int);
 				s = itoa(i, fmtbuf, 16);
-				print(s);
+				out_str(s);
 				break;
 
 			case 'X':
 				i = va_arg(argp, int);
 				s = itoa(i, fmtbuf, 16);
 				to_upper(s);
-				print(s);
+				out_str(s);
 				break;
 
 			case 'b':
 				i = va_arg(argp, int);
 				s = itoa(i, fmtbuf, 2);
-				print(s);
+				out_str(s);
 				break;
 
 			case '%':
-				putch('%');
+				out_char('%');
 				break;
 		}
 	}
+}
 
+void vprintf(const char* fmt, va_list argp){
+	if(!g_panicking && !TaskManager::in_critical())
+		printf_lock.acquire();
+	begin_tty_batch();
+	format(fmt, argp, print, putch);
+	end_tty_batch();
 	if(!g_panicking && !TaskManager::in_critical())
 		printf_lock.release();
 }
 
+size_t vsnprintf(char* buf, size_t size, const char* fmt, va_list argp) {
+	size_t len = 0;
+	auto out_char = [&](char c) {
+		if(len + 1 < size)
+			buf[len] = c;
+		len++;
+	};
+	format(fmt, argp, [&](const char* str) {
+		while(*str)
+			out_char(*(str++));
+	}, out_char);
+	if(size)
+		buf[min(len, size - 1)] = '\0';
+	return len;
+}
+
+size_t snprintf(char* buf, size_t size, const char* fmt, ...) {
+	va_list list;
+	va_start(list, fmt);
+	auto len = vsnprintf(buf, size, fmt, list);
+	va_end(list);
+	return len;
+}
+
 bool panicked = false;
 
 [[noreturn]] void PANIC(const char* error, const char* msg, ...){
@@ -153,8 +185,15 @@ bool panicked = false;
 	Interrupt::NMIDisabler disabler;
 
 	g_panicking = true;
-	if(did_setup_tty)
+	if(did_setup_tty) {
 		tty->set_graphical(false);
+		//If we panicked in the middle of printing something, make sure the panic still gets drawn
+		while(tty_batch_depth)
+			end_tty_batch();
+	}
+
+	//Write out whatever was still waiting in the log, since it might say what led up to this
+	KLog::flush();
 
 	printf("\033[41;97m\033[2J"); //Red BG, bright white FG
 	print("Whoops! Something terrible happened.\nIf you weren't expecting this, please open an issue on GitHub to report it.\nHere are the details:\n");
@@ -188,4 +227,17 @@ void setup_tty() {
 	tty_desc = kstd::make_shared<FileDescriptor>(tty);
 	tty_desc->set_options(O_WRONLY);
 	did_setup_tty = true;
-}
\ No newline at end of file
+}
+void begin_tty_batch() {
+	if(!did_setup_tty)
+		return;
+	tty->get_terminal()->begin_batch();
+	tty_batch_depth++;
+}
+
+void end_tty_batch() {
+	if(!did_setup_tty || !tty_batch_depth)
+		return;
+	tty_batch_depth--;
+	tty->get_terminal()->end_batch();
+}
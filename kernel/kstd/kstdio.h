@@ -38,7 +38,14 @@ void putch(char c);
 void serial_putch(char c);
 void vprintf(const char* fmt, va_list list);
 void printf(const char* fmt, ...);
+/// Formats a string like printf into a buffer of the given size, truncating it if it doesn't fit. Returns the length
+/// the whole string would have been, not counting the null terminator.
+size_t vsnprintf(char* buf, size_t size, const char* fmt, va_list list);
+size_t snprintf(char* buf, size_t size, const char* fmt, ...);
 void print(const char* str);
 [[noreturn]] void PANIC(const char *error, const char *msg, ...);
 void clearScreen();
 void setup_tty();
+/// Batches everything printed until the matching end_tty_batch, so that it's drawn on the console all at once.
+void begin_tty_batch();
+void end_tty_batch();
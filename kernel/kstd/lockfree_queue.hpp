@@ -0,0 +1,160 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "types.h"
+#include "utility.h"
+#include "../Atomic.h"
+
+//The head and tail of the queues are padded out to separate cache lines, so the producer and consumer don't fight over
+//one. This is padding instead of alignas, since kmalloc can't hand out memory aligned to more than a few bytes.
+#define KSTD_CACHE_LINE_SIZE 64
+#define KSTD_CACHE_LINE_PAD(name) uint8_t name[KSTD_CACHE_LINE_SIZE - sizeof(size_t)]
+
+namespace kstd {
+	/**
+	 * A fixed-size ring buffer that one producer and one consumer can use at the same time without any locking, such as
+	 * a driver pushing events and a reader popping them. Neither side ever waits on the other, so it's safe to push from
+	 * an interrupt handler. If there's more than one producer or consumer, each side needs its own lock.
+	 *
+	 * @tparam Capacity The number of elements the queue holds. Must be a power of two.
+	 */
+	template<typename T, size_t Capacity>
+	class spsc_queue {
+		static_assert(Capacity && !(Capacity & (Capacity - 1)), "Capacity must be a power of two");
+	public:
+		spsc_queue() = default;
+		spsc_queue(const spsc_queue& other) = delete;
+		~spsc_queue() {
+			T elem;
+			while(pop(elem));
+		}
+
+		/** Pushes an element onto the queue. Returns false if the queue is full. Only the producer may call this. **/
+		bool push(const T& elem) {
+			size_t tail = m_tail.load(MemoryOrder::Relaxed);
+			if(tail - m_head.load(MemoryOrder::Acquire) == Capacity)
+				return false;
+			new (&slot(tail)) T(elem);
+			m_tail.store(tail + 1, MemoryOrder::Release);
+			return true;
+		}
+
+		/** Pops an element off the queue into elem. Returns false if the queue is empty. Only the consumer may call this. **/
+		bool pop(T& elem) {
+			size_t head = m_head.load(MemoryOrder::Relaxed);
+			if(head == m_tail.load(MemoryOrder::Acquire))
+				return false;
+			elem = kstd::move(slot(head));
+			slot(head).~T();
+			m_head.store(head + 1, MemoryOrder::Release);
+			return true;
+		}
+
+		/** Whether the queue is empty. When called by anyone other than the consumer, the answer may already be stale. **/
+		[[nodiscard]] bool empty() const {
+			return m_head.load(MemoryOrder::Acquire) == m_tail.load(MemoryOrder::Acquire);
+		}
+
+		[[nodiscard]] size_t size() const {
+			return m_tail.load(MemoryOrder::Acquire) - m_head.load(MemoryOrder::Acquire);
+		}
+
+		[[nodiscard]] constexpr size_t capacity() const { return Capacity; }
+
+	private:
+		T& slot(size_t index) { return ((T*) m_storage)[index & (Capacity - 1)]; }
+
+		/*
+		 * The head and tail only ever count up, and are masked to get the slot they point to. The queue is empty when
+		 * they're equal and full when they're Capacity apart, so no slot has to be left unused to tell the two apart.
+		 */
+		Atomic<size_t> m_head = 0; ///< Written by the consumer.
+		KSTD_CACHE_LINE_PAD(m_head_pad);
+		Atomic<size_t> m_tail = 0; ///< Written by the producer.
+		KSTD_CACHE_LINE_PAD(m_tail_pad);
+		alignas(T) uint8_t m_storage[Capacity * sizeof(T)];
+	};
+
+	/**
+	 * A fixed-size ring buffer that any number of producers can push to at the same time without locking, and one
+	 * consumer can pop from. Each slot has a sequence number saying whether it's waiting to be written or read, so a
+	 * producer that's claimed a slot but not finished writing it doesn't let the consumer see a half-written element.
+	 *
+	 * @tparam Capacity The number of elements the queue holds. Must be a power of two.
+	 */
+	template<typename T, size_t Capacity>
+	class mpsc_queue {
+		static_assert(Capacity && !(Capacity & (Capacity - 1)), "Capacity must be a power of two");
+	public:
+		mpsc_queue() {
+			for(size_t i = 0; i < Capacity; i++)
+				m_cells[i].sequence.store(i, MemoryOrder::Relaxed);
+		}
+		mpsc_queue(const mpsc_queue& other) = delete;
+		~mpsc_queue() {
+			T elem;
+			while(pop(elem));
+		}
+
+		/** Pushes an element onto the queue. Returns false if the queue is full. **/
+		bool push(const T& elem) {
+			size_t tail = m_tail.load(MemoryOrder::Relaxed);
+			Cell* cell;
+			while(true) {
+				cell = &m_cells[tail & (Capacity - 1)];
+				auto diff = (intptr_t) (cell->sequence.load(MemoryOrder::Acquire) - tail);
+				if(diff == 0) {
+					//The slot is free, so try to claim it. If another producer beat us to it, tail is updated to theirs.
+					if(m_tail.compare_exchange_strong(tail, tail + 1, MemoryOrder::Relaxed))
+						break;
+				} else if(diff < 0) {
+					//The slot still holds an element from a lap ago, so the queue is full
+					return false;
+				} else {
+					tail = m_tail.load(MemoryOrder::Relaxed);
+				}
+			}
+			new (&cell->elem()) T(elem);
+			cell->sequence.store(tail + 1, MemoryOrder::Release);
+			return true;
+		}
+
+		/** Pops an element off the queue into elem. Returns false if the queue is empty. Only the consumer may call this. **/
+		bool pop(T& elem) {
+			size_t head = m_head.load(MemoryOrder::Relaxed);
+			auto& cell = m_cells[head & (Capacity - 1)];
+			if(cell.sequence.load(MemoryOrder::Acquire) != head + 1)
+				return false;
+			elem = kstd::move(cell.elem());
+			cell.elem().~T();
+			//Mark the slot as free for the producer that wraps around to it next
+			cell.sequence.store(head + Capacity, MemoryOrder::Release);
+			m_head.store(head + 1, MemoryOrder::Relaxed);
+			return true;
+		}
+
+		/** Whether the queue is empty. When called by anyone other than the consumer, the answer may already be stale. **/
+		[[nodiscard]] bool empty() const {
+			size_t head = m_head.load(MemoryOrder::Relaxed);
+			return m_cells[head & (Capacity - 1)].sequence.load(MemoryOrder::Acquire) != head + 1;
+		}
+
+		[[nodiscard]] constexpr size_t capacity() const { return Capacity; }
+
+	private:
+		struct Cell {
+			Atomic<size_t> sequence;
+			alignas(T) uint8_t storage[sizeof(T)];
+
+			T& elem() { return *((T*) storage); }
+		};
+
+		Atomic<size_t> m_head = 0; ///< Only touched by the consumer.
+		KSTD_CACHE_LINE_PAD(m_head_pad);
+		Atomic<size_t> m_tail = 0; ///< Claimed by producers.
+		KSTD_CACHE_LINE_PAD(m_tail_pad);
+		Cell m_cells[Capacity];
+	};
+}
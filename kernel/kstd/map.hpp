@@ -22,6 +22,7 @@
 #include "utility.h"
 #include "pair.hpp"
 #include "Optional.h"
+#include "../memory/kslab.h"
 
 namespace kstd {
 	template<typename MapType>
@@ -38,6 +39,9 @@ namespace kstd {
 		public:
 			Node(const pair<Key, Val>& data): data(data) {}
 
+			static void* operator new(size_t size) { return kslab_alloc(size); }
+			static void operator delete(void* ptr) { kslab_free(ptr); }
+
 			using MapType = map<Key, Val>;
 
 			pair<Key, Val> data;
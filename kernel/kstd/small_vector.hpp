@@ -0,0 +1,168 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "vector.hpp"
+
+namespace kstd {
+	/**
+	 * A vector that keeps up to N elements inside itself, and only allocates once it grows past that. Useful for short
+	 * lists that are made and thrown away often, since most of them never touch the heap.
+	 */
+	template<typename T, size_t N>
+	class small_vector {
+	public:
+		small_vector() = default;
+
+		small_vector(const small_vector& other) {
+			reserve(other._size);
+			for(size_t i = 0; i < other._size; i++)
+				new (&_storage[i]) T(other._storage[i]);
+			_size = other._size;
+		}
+
+		small_vector(small_vector&& other) noexcept {
+			take(kstd::move(other));
+		}
+
+		~small_vector() {
+			clear();
+			if(!is_inline())
+				kfree(_storage);
+		}
+
+		small_vector& operator=(const small_vector& other) {
+			if(this != &other) {
+				clear();
+				reserve(other._size);
+				for(size_t i = 0; i < other._size; i++)
+					new (&_storage[i]) T(other._storage[i]);
+				_size = other._size;
+			}
+			return *this;
+		}
+
+		small_vector& operator=(small_vector&& other) noexcept {
+			if(this != &other) {
+				clear();
+				if(!is_inline())
+					kfree(_storage);
+				_storage = inline_storage();
+				_capacity = N;
+				take(kstd::move(other));
+			}
+			return *this;
+		}
+
+		void push_back(const T& elem) {
+			emplace_back(elem);
+		}
+
+		void push_back(T&& elem) {
+			emplace_back(kstd::move(elem));
+		}
+
+		/** Constructs an element in place at the end of the vector, and returns it. **/
+		template<typename... Args>
+		T& emplace_back(Args&&... args) {
+			if(_size == _capacity)
+				reserve(_capacity * 2);
+			return *new (&_storage[_size++]) T(kstd::forward<Args>(args)...);
+		}
+
+		void pop_back() {
+			ASSERT(_size);
+			_storage[--_size].~T();
+		}
+
+		void erase(size_t elem) {
+			ASSERT(elem < _size);
+			_storage[elem].~T();
+			for(size_t i = elem; i < _size - 1; i++) {
+				new(&_storage[i]) T(kstd::move(_storage[i + 1]));
+				_storage[i + 1].~T();
+			}
+			_size--;
+		}
+
+		void resize(size_t new_size) {
+			reserve(new_size);
+			for(size_t i = _size; i < new_size; i++)
+				new (&_storage[i]) T();
+			for(size_t i = new_size; i < _size; i++)
+				_storage[i].~T();
+			_size = new_size;
+		}
+
+		void reserve(size_t new_capacity) {
+			if(new_capacity <= _capacity)
+				return;
+			T* new_storage = (T*) kmalloc(new_capacity * sizeof(T));
+			relocate(new_storage, _storage, _size);
+			if(!is_inline())
+				kfree(_storage);
+			_storage = new_storage;
+			_capacity = new_capacity;
+		}
+
+		void clear() {
+			for(size_t i = 0; i < _size; i++)
+				_storage[i].~T();
+			_size = 0;
+		}
+
+		size_t size() const { return _size; }
+		size_t capacity() const { return _capacity; }
+		bool empty() const { return !_size; }
+
+		T& operator[](size_t index) const {
+			ASSERT(index < _size);
+			return _storage[index];
+		}
+
+		T& front() {
+			ASSERT(_size);
+			return _storage[0];
+		}
+
+		T& back() {
+			ASSERT(_size);
+			return _storage[_size - 1];
+		}
+
+		T* storage() { return _storage; }
+
+		// Iterator
+		using Iterator = ContainerIterator<small_vector, T>;
+		using ConstIterator = ContainerIterator<const small_vector, const T>;
+
+		Iterator begin() { return Iterator::begin(*this); }
+		ConstIterator begin() const { return ConstIterator::begin(*this); }
+		Iterator end() { return Iterator::end(*this); }
+		ConstIterator end() const { return ConstIterator::end(*this); }
+
+	private:
+		T* inline_storage() { return (T*) _inline_storage; }
+		bool is_inline() { return _storage == inline_storage(); }
+
+		/** Takes the elements of another vector. This one must be empty and using its inline storage. **/
+		void take(small_vector&& other) {
+			if(other.is_inline()) {
+				relocate(_storage, other._storage, other._size);
+			} else {
+				_storage = other._storage;
+				_capacity = other._capacity;
+				other._storage = other.inline_storage();
+				other._capacity = N;
+			}
+			_size = other._size;
+			other._size = 0;
+		}
+
+		alignas(T) uint8_t _inline_storage[N * sizeof(T)];
+		T* _storage = inline_storage();
+		size_t _capacity = N;
+		size_t _size = 0;
+	};
+}
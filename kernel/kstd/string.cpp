@@ -19,99 +19,151 @@
 
 #include "string.h"
 #include "cstring.h"
+#include "utility.h"
 
 namespace kstd {
-	string::string(): _size(1), _length(0), _cstring(new char[1]) {
+	string::string(): _size(sizeof(_inline)), _length(0), _cstring(_inline) {
 		_cstring[0] = '\0';
 	}
 
-	string::string(const string& string) {
-		_length = string._length;
-		_size = string._size;
-		_cstring = new char[_size];
-		strcpy(_cstring, string._cstring);
+	string::string(const string& other): string() {
+		assign(other._cstring, other._length);
 	}
 
-	string::string(const char* str) {
-		_length = strlen(str);
-		_size = _length + 1;
-		_cstring = new char[_size];
-		strcpy(_cstring, str);
+	string::string(const char* str): string() {
+		assign(str, strlen(str));
 	}
 
-	string::string(const char* str, size_t length): _length(length + 1) {
-		_size = _length + 1;
-		_cstring = new char[_size];
-		_cstring[_length - 1] = '\0';
-		memcpy(_cstring, str, _length - 1);
+	string::string(const char* str, size_t length): string() {
+		assign(str, length);
+	}
+
+	string::string(string_view view): string() {
+		assign(view.data(), view.length());
+	}
+
+	string::string(string&& other) noexcept: string() {
+		operator=(kstd::move(other));
 	}
 
 	string::~string(){
-		delete[] _cstring;
+		if(!is_inline())
+			delete[] _cstring;
 		_cstring = nullptr;
 	}
 
 	string& string::operator=(const string& str) {
-		if (this != &str) {
-			_length = str._length;
-			_size = str._size;
-			delete[] _cstring;
-			_cstring = new char[this->_size];
+		if (this != &str)
+			assign(str._cstring, str._length);
+		return *this;
+	}
 
-			strcpy(_cstring, str._cstring);
+	string& string::operator=(string&& str) noexcept {
+		if(this == &str)
+			return *this;
+		if(str.is_inline()) {
+			assign(str._cstring, str._length);
+		} else {
+			//Take the other string's buffer, and leave it empty
+			if(!is_inline())
+				delete[] _cstring;
+			_cstring = str._cstring;
+			_size = str._size;
+			_length = str._length;
+			str._cstring = str._inline;
+			str._size = sizeof(str._inline);
 		}
-
+		str._length = 0;
+		str._cstring[0] = '\0';
 		return *this;
 	}
 
 	string& string::operator+=(const string& str) {
-		_length = _length + str._length;
-		_size = _length + 1;
-
-		char* buffer = new char[_size];
-		strcpy(buffer, _cstring);
-		strcat(buffer, str._cstring);
-
-		delete[] _cstring;
-		_cstring = buffer;
-
+		append(str._cstring, str._length);
 		return *this;
 	}
 
 	string string::operator+(const string& str) const {
-		char* buffer = new char[_length + str._length + 1];
-		strcpy(buffer, _cstring);
-		strcat(buffer, str._cstring);
-
-		string ret = string(buffer);
-		delete[] buffer;
-
+		string ret;
+		ret.reserve(_length + str._length);
+		ret.append(_cstring, _length);
+		ret.append(str._cstring, str._length);
 		return ret;
 	}
 
 	string& string::operator=(const char* str) {
-		delete[] _cstring;
-		_length = strlen(str);
-		_size = _length + 1;
-		_cstring = new char[_size];
-		strcpy(_cstring, str);
+		assign(str, strlen(str));
 		return *this;
 	}
 
 	bool string::operator==(const string &str) const {
-		return strcmp(_cstring, str._cstring);
+		return operator==((string_view) str);
 	}
 
 	bool string::operator==(const char *str) const {
-		return strcmp(str, _cstring);
+		return operator==(string_view(str));
+	}
+
+	bool string::operator==(string_view str) const {
+		return (string_view) *this == str;
 	}
 
 	bool string::operator!=(const string &str) const {
-		return !strcmp(_cstring, str._cstring);
+		return !operator==((string_view) str);
 	}
 
 	bool string::operator!=(const char *str) const {
-		return !strcmp(str, _cstring);
+		return !operator==(string_view(str));
+	}
+
+	bool string::operator!=(string_view str) const {
+		return !operator==(str);
+	}
+
+	void string::reserve(size_t length) {
+		if(length + 1 <= _size)
+			return;
+		char* buffer = new char[length + 1];
+		memcpy(buffer, _cstring, _length + 1);
+		if(!is_inline())
+			delete[] _cstring;
+		_cstring = buffer;
+		_size = length + 1;
+	}
+
+	void string::assign(const char* str, size_t length) {
+		if(str >= _cstring && str < _cstring + _size) {
+			//Assigning part of ourselves, so copy it out first
+			string tmp(str, length);
+			operator=(kstd::move(tmp));
+			return;
+		}
+
+		if(length + 1 > _size) {
+			if(!is_inline())
+				delete[] _cstring;
+			_cstring = new char[length + 1];
+			_size = length + 1;
+		}
+		memcpy(_cstring, str, length);
+		_cstring[length] = '\0';
+		_length = length;
+	}
+
+	void string::append(const char* str, size_t length) {
+		if(_length + length + 1 > _size) {
+			//If we're appending part of ourselves, it'll move when we grow
+			bool is_self = str >= _cstring && str < _cstring + _size;
+			size_t self_offset = str - _cstring;
+			//Grow by at least double, so that appending over and over doesn't reallocate every time
+			size_t new_length = _length + length;
+			reserve(new_length > _size * 2 ? new_length : _size * 2);
+			if(is_self)
+				str = _cstring + self_offset;
+		}
+		memcpy(_cstring + _length, str, length);
+		_length += length;
+		_cstring[_length] = '\0';
 	}
 
 	char& string::operator[](size_t index) const {
@@ -123,14 +175,7 @@ namespace kstd {
 	}
 
 	string string::substr(size_t start, size_t length) const {
-		char* tmp = new char[length + 1];
-		memcpy(tmp, _cstring + start, length);
-		tmp[length] = '\0';
-
-		string ret(tmp);
-		delete[] tmp;
-
-		return ret;
+		return string(_cstring + start, length);
 	}
 
 	size_t string::find(const string& str, size_t start) const {
@@ -20,24 +20,34 @@
 #pragma once
 
 #include <kernel/kstd/types.h>
+#include <kernel/kstd/string_view.h>
+
+//Strings this long or shorter (plus the null terminator) are stored inside the string itself instead of on the heap
+#define KSTD_STRING_INLINE_LENGTH 15
 
 namespace kstd {
 	class string {
 	public:
 		string();
-		string(const string& string);
+		string(const string& other);
 		string(const char* string);
 		string(const char* string, size_t length);
+		explicit string(string_view view);
+		string(string&& other) noexcept;
 		~string();
 
 		string& operator=(const char* str);
 		string& operator=(const string& str);
+		string& operator=(string&& str) noexcept;
 		string& operator+=(const string& str);
 		string operator+(const string& b) const;
 		bool operator==(const string& str) const;
 		bool operator==(const char* str) const;
+		bool operator==(string_view str) const;
 		bool operator!=(const string& str) const;
 		bool operator!=(const char* str) const;
+		bool operator!=(string_view str) const;
+		operator string_view() const { return {_cstring, _length}; }
 		char& operator[](size_t index) const;
 
 		size_t length() const;
@@ -50,10 +60,18 @@ namespace kstd {
 		size_t find_last_of(const string& str, size_t end = -1) const;
 		size_t find_last_of(const char* str, size_t end = -1) const;
 		size_t find_last_of(const char c, size_t end = -1) const;
+		/** Makes room for a string of a given length, so that growing to it doesn't have to reallocate. **/
+		void reserve(size_t length);
+
 	private:
-		size_t _size;
+		bool is_inline() const { return _cstring == _inline; }
+		void assign(const char* str, size_t length);
+		void append(const char* str, size_t length);
+
+		size_t _size; ///< The number of characters that fit in the buffer, including the null terminator.
 		size_t _length;
 		char* _cstring;
+		char _inline[KSTD_STRING_INLINE_LENGTH + 1];
 	};
 }
 
@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+#include <kernel/kstd/cstring.h>
+
+namespace kstd {
+	/**
+	 * A reference to a run of characters owned by something else, like a kstd::string or a literal. Taking substrings
+	 * of a view doesn't allocate, so it's good for picking apart paths and names. Views aren't null-terminated, and
+	 * shouldn't outlive the characters they point to.
+	 */
+	class string_view {
+	public:
+		constexpr string_view(): _data(""), _length(0) {}
+		string_view(const char* str): _data(str), _length(strlen(str)) {}
+		constexpr string_view(const char* str, size_t length): _data(str), _length(length) {}
+
+		[[nodiscard]] constexpr const char* data() const { return _data; }
+		[[nodiscard]] constexpr size_t length() const { return _length; }
+		[[nodiscard]] constexpr bool empty() const { return !_length; }
+		constexpr char operator[](size_t index) const { return _data[index]; }
+
+		/** Returns a view of up to length characters starting at start. **/
+		[[nodiscard]] constexpr string_view substr(size_t start, size_t length = -1) const {
+			if(start > _length)
+				start = _length;
+			if(length > _length - start)
+				length = _length - start;
+			return {_data + start, length};
+		}
+
+		/** Returns the index of the first c at or after start, or -1 if there isn't one. **/
+		[[nodiscard]] constexpr size_t find(char c, size_t start = 0) const {
+			for(size_t i = start; i < _length; i++) {
+				if(_data[i] == c)
+					return i;
+			}
+			return -1;
+		}
+
+		/** Returns the index of the last c, or -1 if there isn't one. **/
+		[[nodiscard]] constexpr size_t rfind(char c) const {
+			for(size_t i = _length; i > 0; i--) {
+				if(_data[i - 1] == c)
+					return i - 1;
+			}
+			return -1;
+		}
+
+		constexpr bool operator==(const string_view& other) const {
+			if(_length != other._length)
+				return false;
+			for(size_t i = 0; i < _length; i++) {
+				if(_data[i] != other._data[i])
+					return false;
+			}
+			return true;
+		}
+
+		constexpr bool operator!=(const string_view& other) const { return !operator==(other); }
+		bool operator==(const char* str) const { return operator==(string_view(str)); }
+		bool operator!=(const char* str) const { return !operator==(string_view(str)); }
+
+	private:
+		const char* _data;
+		size_t _length;
+	};
+}
@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "bits/HashTable.h"
+
+namespace kstd {
+	/**
+	 * A map that keeps its entries in a hash table rather than a tree. Lookups don't have to chase pointers through the
+	 * map, but entries aren't kept in any order. Inserting or erasing invalidates pointers to values and iterators.
+	 */
+	template<typename K, typename V, typename Hash = kstd::hash<K>>
+	class unordered_map {
+	public:
+		using Key = K;
+		using Val = V;
+
+	private:
+		struct KeyOf {
+			static const Key& key(const pair<Key, Val>& entry) { return entry.first; }
+		};
+		using Table = HashTable<pair<Key, Val>, Key, KeyOf, Hash>;
+
+	public:
+		using Iterator = typename Table::Iterator;
+		using ConstIterator = typename Table::ConstIterator;
+
+		/** Inserts an element. Returns a pointer to it, or nullptr if there's already an element with the key. **/
+		pair<Key, Val>* insert(const pair<Key, Val>& elem) {
+			auto result = m_table.insert(pair<Key, Val>(elem));
+			return result.second ? result.first : nullptr;
+		}
+
+		/** Inserts an element by moving it. Returns a pointer to it, or nullptr if there's already an element with the key. **/
+		pair<Key, Val>* insert(pair<Key, Val>&& elem) {
+			auto result = m_table.insert(kstd::move(elem));
+			return result.second ? result.first : nullptr;
+		}
+
+		/** Gets the value with the given key, inserting a default value if there isn't one. **/
+		Val& operator[](const Key& key) {
+			auto* entry = m_table.find(key);
+			if(entry)
+				return entry->second;
+			return m_table.insert({key, Val()}).first->second;
+		}
+
+		/** Gets a pointer to the value with the given key, or nullptr if there isn't one. **/
+		Val* get(const Key& key) {
+			auto* entry = m_table.find(key);
+			return entry ? &entry->second : nullptr;
+		}
+
+		const Val* get(const Key& key) const {
+			auto* entry = m_table.find(key);
+			return entry ? &entry->second : nullptr;
+		}
+
+		bool contains(const Key& key) const { return m_table.find(key); }
+		/** Removes the element with the given key. Returns whether there was one. **/
+		bool erase(const Key& key) { return m_table.erase(key); }
+		void clear() { m_table.clear(); }
+		void reserve(size_t num_elements) { m_table.reserve(num_elements); }
+		[[nodiscard]] size_t size() const { return m_table.size(); }
+		[[nodiscard]] bool empty() const { return m_table.empty(); }
+
+		Iterator begin() { return m_table.begin(); }
+		ConstIterator begin() const { return m_table.begin(); }
+		Iterator end() { return m_table.end(); }
+		ConstIterator end() const { return m_table.end(); }
+
+	private:
+		Table m_table;
+	};
+}
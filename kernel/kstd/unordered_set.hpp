@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "bits/HashTable.h"
+
+namespace kstd {
+	/** A set of values kept in a hash table. Inserting or erasing invalidates iterators. **/
+	template<typename T, typename Hash = kstd::hash<T>>
+	class unordered_set {
+	private:
+		struct KeyOf {
+			static const T& key(const T& entry) { return entry; }
+		};
+		using Table = HashTable<T, T, KeyOf, Hash>;
+
+	public:
+		using ConstIterator = typename Table::ConstIterator;
+
+		/** Adds a value to the set. Returns whether it wasn't there already. **/
+		bool insert(const T& value) { return m_table.insert(T(value)).second; }
+		bool insert(T&& value) { return m_table.insert(kstd::move(value)).second; }
+		bool contains(const T& value) const { return m_table.find(value); }
+		/** Removes a value from the set. Returns whether it was there. **/
+		bool erase(const T& value) { return m_table.erase(value); }
+		void clear() { m_table.clear(); }
+		void reserve(size_t num_values) { m_table.reserve(num_values); }
+		[[nodiscard]] size_t size() const { return m_table.size(); }
+		[[nodiscard]] bool empty() const { return m_table.empty(); }
+
+		// Values can't be changed in place, since that would change where they belong in the table
+		ConstIterator begin() const { return m_table.begin(); }
+		ConstIterator end() const { return m_table.end(); }
+
+	private:
+		Table m_table;
+	};
+}
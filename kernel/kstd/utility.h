@@ -28,6 +28,16 @@ namespace kstd {
 		return static_cast<typename remove_reference<T>::type&&>(arg);
 	}
 
+	template<typename T>
+	constexpr T&& forward(typename remove_reference<T>::type& arg) {
+		return static_cast<T&&>(arg);
+	}
+
+	template<typename T>
+	constexpr T&& forward(typename remove_reference<T>::type&& arg) {
+		return static_cast<T&&>(arg);
+	}
+
 	template<typename T> void swap(T& t1, T& t2) {
 		T temp = kstd::move(t1);
 		t1 = kstd::move(t2);
@@ -41,5 +51,8 @@ namespace kstd {
 
 	template<typename T, typename U>
 	inline constexpr bool is_base_of = __is_base_of(T, U);
+
+	template<typename T>
+	inline constexpr bool is_trivially_copyable = __is_trivially_copyable(T);
 }
 
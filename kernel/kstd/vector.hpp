@@ -23,9 +23,27 @@
 #include "kstddef.h"
 #include "utility.h"
 #include "kstdio.h"
+#include "cstring.h"
 #include "Iterator.h"
 
 namespace kstd {
+	/**
+	 * Moves a number of objects to uninitialized memory, and destroys the originals. Trivially copyable objects are just
+	 * copied over in one go. The ranges can't overlap.
+	 */
+	template<typename T>
+	void relocate(T* dest, T* src, size_t count) {
+		if constexpr(is_trivially_copyable<T>) {
+			if(count)
+				memcpy(dest, src, count * sizeof(T));
+		} else {
+			for(size_t i = 0; i < count; i++) {
+				new (&dest[i]) T(kstd::move(src[i]));
+				src[i].~T();
+			}
+		}
+	}
+
 	template<typename T>
 	class vector {
 	public:
@@ -33,13 +51,13 @@ namespace kstd {
 		}
 
 		explicit vector(size_t size, const T& value = T()): _capacity(size), _size(size) {
-			_storage = (T*) kcalloc(size, sizeof(T));
+			_storage = (T*) kmalloc(size * sizeof(T));
 			for(size_t i = 0; i < size; i++)
 				new (&_storage[i]) T(value);
 		}
 
-		vector(const vector<T>& other): _capacity(other._capacity), _size(other._size) {
-			_storage = (T*) kcalloc(_size, sizeof(T));
+		vector(const vector<T>& other): _capacity(other._size), _size(other._size) {
+			_storage = (T*) kmalloc(_size * sizeof(T));
 			for(size_t i = 0; i < _size; i++)
 				new (&_storage[i]) T(other._storage[i]);
 		}
@@ -58,10 +76,37 @@ namespace kstd {
 		}
 
 		void push_back(const T& elem) {
+			emplace_back(elem);
+		}
+
+		void push_back(T&& elem) {
+			emplace_back(kstd::move(elem));
+		}
+
+		/** Constructs an element in place at the end of the vector, and returns it. **/
+		template<typename... Args>
+		T& emplace_back(Args&&... args) {
+			if(_size + 1 > _capacity) {
+				realloc(_capacity == 0 ? 1 : _capacity * 2);
+			}
+			return *new (&_storage[_size++]) T(kstd::forward<Args>(args)...);
+		}
+
+		void insert(size_t index, const T& elem) {
+			insert(index, T(elem));
+		}
+
+		void insert(size_t index, T&& elem) {
+			ASSERT(index <= _size);
 			if(_size + 1 > _capacity) {
 				realloc(_capacity == 0 ? 1 : _capacity * 2);
 			}
-			new (&_storage[_size++]) T(elem);
+			for(size_t i = _size; i > index; i--) {
+				new(&_storage[i]) T(kstd::move(_storage[i - 1]));
+				_storage[i - 1].~T();
+			}
+			new (&_storage[index]) T(kstd::move(elem));
+			_size++;
 		}
 
 		void resize(size_t new_size) {
@@ -82,7 +127,7 @@ namespace kstd {
 
 			if(_storage == nullptr) {
 				_capacity = new_capacity;
-				_storage = (T*) kcalloc(_capacity, sizeof(T));
+				_storage = (T*) kmalloc(_capacity * sizeof(T));
 				return;
 			}
 
@@ -92,11 +137,8 @@ namespace kstd {
 				_size = new_capacity;
 			}
 
-			T* tmp_storage = (T*) kcalloc(new_capacity, sizeof(T));
-			for(size_t i = 0; i < _size; i++) {
-				new (&tmp_storage[i]) T(_storage[i]);
-				_storage[i].~T();
-			}
+			T* tmp_storage = (T*) kmalloc(new_capacity * sizeof(T));
+			relocate(tmp_storage, _storage, _size);
 			kfree(_storage);
 			_storage = tmp_storage;
 			_capacity = new_capacity;
@@ -106,7 +148,7 @@ namespace kstd {
 			ASSERT(elem < _size);
 			_storage[elem].~T();
 			for(size_t i = elem; i < _size - 1; i++) {
-				new(&_storage[i]) T(_storage[i + 1]);
+				new(&_storage[i]) T(kstd::move(_storage[i + 1]));
 				_storage[i + 1].~T();
 			}
 			_size--;
@@ -148,8 +190,8 @@ namespace kstd {
 				for(size_t i = 0; i < _size; i++) _storage[i].~T();
 				kfree(_storage);
 				_size = other._size;
-				_capacity = other._capacity;
-				_storage = (T*) kcalloc(_capacity, sizeof(T));
+				_capacity = other._size;
+				_storage = (T*) kmalloc(_capacity * sizeof(T));
 				for (size_t i = 0; i < _size; i++)
 					new (&_storage[i]) T(other._storage[i]);
 			}
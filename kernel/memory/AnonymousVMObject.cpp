@@ -8,32 +8,58 @@
 SpinLock AnonymousVMObject::s_shared_lock;
 int AnonymousVMObject::s_cur_shm_id = 1;
 kstd::map<int, kstd::Weak<AnonymousVMObject>> AnonymousVMObject::s_shared_objects;
+AnonymousVMObject::PurgeableShrinker AnonymousVMObject::s_purgeable_shrinker;
+SpinLock AnonymousVMObject::s_purgeable_lock;
+kstd::vector<AnonymousVMObject*> AnonymousVMObject::s_purgeable_objects;
+size_t AnonymousVMObject::s_purgeable_pages = 0;
+AnonymousVMObject::SwapShrinker AnonymousVMObject::s_swap_shrinker;
+Mutex AnonymousVMObject::s_swappable_lock;
+kstd::vector<AnonymousVMObject*> AnonymousVMObject::s_swappable_objects;
+size_t AnonymousVMObject::s_swap_cursor = 0;
 
 AnonymousVMObject::~AnonymousVMObject() {
 	if(m_is_shared) {
 		LOCK(s_shared_lock);
 		s_shared_objects.erase(m_shm_id);
 	}
+	if(m_purgeable)
+		set_purgeable(false);
+	if(m_swappable) {
+		LOCK(s_swappable_lock);
+		for(size_t i = 0; i < s_swappable_objects.size(); i++) {
+			if(s_swappable_objects[i] == this) {
+				s_swappable_objects.erase(i);
+				break;
+			}
+		}
+		for(auto slot : m_swap_slots) {
+			if(slot)
+				Swap::inst()->free_slot(slot);
+		}
+	}
 }
 
 ResultRet<kstd::Arc<AnonymousVMObject>> AnonymousVMObject::alloc(size_t size) {
 	size_t num_pages = kstd::ceil_div(size, PAGE_SIZE);
-	auto pages = TRY(MemoryManager::inst().alloc_physical_pages(num_pages));
-	auto object = kstd::Arc<AnonymousVMObject>(new AnonymousVMObject(pages, false));
-	auto tmp_mapped = MM.map_object(object);
-	memset((void*) tmp_mapped->start(), 0, object->size());
-	return object;
+	auto pages = TRY(MemoryManager::inst().alloc_physical_pages(num_pages, true));
+	return kstd::Arc<AnonymousVMObject>(new AnonymousVMObject(pages, false));
 }
 
-ResultRet<kstd::Arc<AnonymousVMObject>> AnonymousVMObject::alloc_contiguous(size_t size) {
+ResultRet<kstd::Arc<AnonymousVMObject>> AnonymousVMObject::alloc_contiguous(size_t size, PhysicalZone zone) {
 	size_t num_pages = kstd::ceil_div(size, PAGE_SIZE);
-	auto pages = TRY(MemoryManager::inst().alloc_contiguous_physical_pages(num_pages));
+	auto pages = TRY(MemoryManager::inst().alloc_contiguous_physical_pages(num_pages, zone));
 	auto object = kstd::Arc<AnonymousVMObject>(new AnonymousVMObject(pages, false));
 	auto tmp_mapped = MM.map_object(object);
 	memset((void*) tmp_mapped->start(), 0, object->size());
 	return object;
 }
 
+kstd::Arc<AnonymousVMObject> AnonymousVMObject::alloc_lazy(size_t size) {
+	kstd::vector<PageIndex> pages;
+	pages.resize(kstd::ceil_div(size, PAGE_SIZE));
+	return kstd::Arc<AnonymousVMObject>(new AnonymousVMObject(pages, false));
+}
+
 ResultRet<kstd::Arc<AnonymousVMObject>> AnonymousVMObject::map_to_physical(PhysicalAddress start, size_t size) {
 	ASSERT((start / PAGE_SIZE) * PAGE_SIZE == start);
 
@@ -89,11 +115,336 @@ ResultRet<VMProt> AnonymousVMObject::get_shared_permissions(pid_t pid) {
 	return node->data.second;
 }
 
+void AnonymousVMObject::unshare(pid_t pid) {
+	LOCK(m_page_lock);
+	m_shared_permissions.erase(pid);
+}
+
+bool AnonymousVMObject::set_purgeable(bool purgeable) {
+	static bool registered_shrinker = false;
+	if(!registered_shrinker) {
+		MM.register_shrinker(&s_purgeable_shrinker);
+		registered_shrinker = true;
+	}
+
+	LOCK(m_page_lock);
+	LOCK_N(s_purgeable_lock, purgeable_lock);
+	bool was_purged = m_purged;
+	if(purgeable == m_purgeable)
+		return was_purged;
+
+	m_purgeable = purgeable;
+	if(purgeable) {
+		m_purged = false;
+		s_purgeable_objects.push_back(this);
+		s_purgeable_pages += m_physical_pages.size();
+	} else {
+		for(size_t i = 0; i < s_purgeable_objects.size(); i++) {
+			if(s_purgeable_objects[i] == this) {
+				s_purgeable_objects.erase(i);
+				break;
+			}
+		}
+		if(!m_purged)
+			s_purgeable_pages -= m_physical_pages.size();
+	}
+	return was_purged;
+}
+
+Result AnonymousVMObject::make_swappable() {
+	static bool registered_shrinker = false;
+	if(!registered_shrinker) {
+		MM.register_shrinker(&s_swap_shrinker);
+		registered_shrinker = true;
+	}
+
+	{
+		LOCK(m_page_lock);
+		if(m_swappable)
+			return Result(SUCCESS);
+		m_swap_slots.resize(m_physical_pages.size());
+		m_swappable = true;
+	}
+
+	LOCK(s_swappable_lock);
+	s_swappable_objects.push_back(this);
+	return Result(SUCCESS);
+}
+
+Result AnonymousVMObject::page_in(PageIndex index) {
+	ASSERT(index < m_physical_pages.size());
+	if(m_physical_pages[index])
+		return Result(SUCCESS);
+
+	SwapSlot slot = m_swappable ? m_swap_slots[index] : 0;
+	if(!slot) {
+		m_physical_pages[index] = TRY(MM.alloc_physical_page(true));
+		return Result(SUCCESS);
+	}
+
+	auto page = TRY(MM.alloc_physical_page());
+	auto res = Swap::inst()->read_page(slot, page);
+	if(res.is_error()) {
+		MM.get_physical_page(page).unref();
+		return res;
+	}
+	Swap::inst()->free_slot(slot);
+	m_swap_slots[index] = 0;
+	m_physical_pages[index] = page;
+	return Result(SUCCESS);
+}
+
+Result AnonymousVMObject::page_in_for_read(PageIndex index) {
+	ASSERT(index < m_physical_pages.size());
+	if(m_physical_pages[index])
+		return Result(SUCCESS);
+	if(!m_swappable || m_swap_slots[index] || mapped_in_kernel())
+		return page_in(index);
+	m_physical_pages[index] = MM.zero_page();
+	m_cow_pages.set(index, true);
+	return Result(SUCCESS);
+}
+
+ResultRet<PageIndex> AnonymousVMObject::page_for_write(PageIndex index) {
+	auto res = page_in(index);
+	if(res.is_error())
+		return res;
+	if(page_is_cow(index)) {
+		res = try_cow_page(index);
+		if(res.is_error())
+			return res;
+		// Anything still mapping the old page has to fault on the new one
+		unmap_page(index);
+	}
+	return m_physical_pages[index];
+}
+
+void AnonymousVMObject::discard(PageIndex start, size_t num_pages) {
+	PageIndex end = min(start + num_pages, m_physical_pages.size());
+	for(PageIndex index = start; index < end; index++) {
+		drop_page(index);
+		if(m_swappable && m_swap_slots[index]) {
+			Swap::inst()->free_slot(m_swap_slots[index]);
+			m_swap_slots[index] = 0;
+		}
+	}
+}
+
+Result AnonymousVMObject::resize(size_t size) {
+	size_t num_pages = kstd::ceil_div(size, PAGE_SIZE);
+	for(PageIndex index = num_pages; index < m_physical_pages.size(); index++) {
+		drop_page(index);
+		if(m_swappable && m_swap_slots[index]) {
+			Swap::inst()->free_slot(m_swap_slots[index]);
+			m_swap_slots[index] = 0;
+		}
+	}
+
+	PageIndex last = num_pages - 1;
+	if(size % PAGE_SIZE && num_pages <= m_physical_pages.size() && (m_physical_pages[last] || (m_swappable && m_swap_slots[last]))) {
+		auto page = TRY(page_for_write(last));
+		MM.with_quickmapped(page, [&](void* ptr) {
+			memset((uint8_t*) ptr + size % PAGE_SIZE, 0, PAGE_SIZE - size % PAGE_SIZE);
+		});
+	}
+
+	if(num_pages > m_physical_pages.size()) {
+		m_physical_pages.resize(num_pages);
+		m_cow_pages.grow(num_pages);
+		if(m_swappable)
+			m_swap_slots.resize(num_pages);
+		m_size = num_pages * PAGE_SIZE;
+	}
+	return Result(SUCCESS);
+}
+
+size_t AnonymousVMObject::purge() {
+	size_t num_freed = 0;
+	for(size_t i = 0; i < m_physical_pages.size(); i++) {
+		auto page = m_physical_pages[i];
+		if(!page || MM.get_physical_page(page).allocated.ref_count.load(MemoryOrder::Relaxed) != 1)
+			continue;
+		drop_page(i);
+		num_freed++;
+	}
+
+	// Anything that was swapped out is gone too
+	if(m_swappable) {
+		for(auto& slot : m_swap_slots) {
+			if(slot)
+				Swap::inst()->free_slot(slot);
+			slot = 0;
+		}
+	}
+	return num_freed;
+}
+
+size_t AnonymousVMObject::swap_out_pages(size_t max_pages) {
+	auto swap = Swap::inst();
+	if(!swap || m_purgeable || mapped_in_kernel())
+		return 0;
+
+	size_t num_freed = 0;
+	for(size_t i = 0; i < m_physical_pages.size() && num_freed < max_pages && swap->num_free_slots(); i++) {
+		size_t index = m_swap_hand;
+		m_swap_hand = (m_swap_hand + 1) % m_physical_pages.size();
+
+		// Skip pages that are shared with another object (CoW), since they won't be freed
+		auto page = m_physical_pages[index];
+		if(!page || MM.get_physical_page(page).allocated.ref_count.load(MemoryOrder::Relaxed) != 1)
+			continue;
+
+		// Give pages that were accessed since we last looked at them a second chance
+		if(test_and_clear_accessed(index))
+			continue;
+
+		// Unmap the page before writing it out so it can't be modified while we're writing it
+		unmap_page(index);
+		auto slot_res = swap->write_page(page);
+		if(slot_res.is_error())
+			break;
+
+		m_swap_slots[index] = slot_res.value();
+		MM.get_physical_page(page).unref();
+		m_physical_pages[index] = 0;
+		m_cow_pages.set(index, false);
+		num_freed++;
+	}
+	return num_freed;
+}
+
+bool AnonymousVMObject::pages_movable() {
+	return m_swappable && !m_purgeable && !mapped_in_kernel();
+}
+
+void AnonymousVMObject::mark_movable_pages(kstd::Bitmap& bitmap) {
+	if(s_swappable_lock.held_by_current_thread() || !s_swappable_lock.try_acquire())
+		return;
+	for(auto object : s_swappable_objects) {
+		if(object->m_page_lock.held_by_current_thread() || !object->m_page_lock.try_acquire())
+			continue;
+		if(object->pages_movable()) {
+			for(auto page : object->m_physical_pages) {
+				if(page && MM.get_physical_page(page).allocated.ref_count.load(MemoryOrder::Relaxed) == 1)
+					bitmap.set(page, true);
+			}
+		}
+		object->m_page_lock.release();
+	}
+	s_swappable_lock.release();
+}
+
+size_t AnonymousVMObject::migrate_pages(PageIndex first_page, size_t num_pages, kstd::vector<PageIndex>& free_pages) {
+	if(s_swappable_lock.held_by_current_thread() || !s_swappable_lock.try_acquire())
+		return 0;
+	size_t num_moved = 0;
+	for(size_t i = 0; i < s_swappable_objects.size() && !free_pages.empty(); i++) {
+		auto object = s_swappable_objects[i];
+		if(object->m_page_lock.held_by_current_thread() || !object->m_page_lock.try_acquire())
+			continue;
+		if(!object->pages_movable()) {
+			object->m_page_lock.release();
+			continue;
+		}
+
+		auto& pages = object->m_physical_pages;
+		for(size_t index = 0; index < pages.size() && !free_pages.empty(); index++) {
+			auto page = pages[index];
+			if(page < first_page || page >= first_page + num_pages)
+				continue;
+			if(MM.get_physical_page(page).allocated.ref_count.load(MemoryOrder::Relaxed) != 1)
+				continue;
+
+			// Unmap the page first so that nothing can write to it while it's copied. Faulting it back in needs the
+			// object's lock, so anything that touches it will wait until the new page is in place.
+			object->unmap_page(index);
+			auto new_page = free_pages.back();
+			free_pages.resize(free_pages.size() - 1);
+			MM.copy_page(page, new_page);
+			pages[index] = new_page;
+			MM.get_physical_page(page).unref();
+			num_moved++;
+		}
+		object->m_page_lock.release();
+	}
+	s_swappable_lock.release();
+	return num_moved;
+}
+
+size_t AnonymousVMObject::PurgeableShrinker::reclaimable_pages() {
+	LOCK(s_purgeable_lock);
+	return s_purgeable_pages;
+}
+
+size_t AnonymousVMObject::PurgeableShrinker::shrink(size_t num_pages) {
+	// Objects take this lock before they're destroyed, so everything in the list stays valid while we hold it. Objects
+	// that are locked by someone else are skipped, since they're probably in use.
+	LOCK(s_purgeable_lock);
+	size_t num_freed = 0;
+	for(size_t i = 0; i < s_purgeable_objects.size() && num_freed < num_pages; i++) {
+		auto object = s_purgeable_objects[i];
+		if(object->m_purged || object->m_page_lock.held_by_current_thread() || !object->m_page_lock.try_acquire())
+			continue;
+		num_freed += object->purge();
+		object->m_purged = true;
+		s_purgeable_pages -= object->m_physical_pages.size();
+		object->m_page_lock.release();
+	}
+	return num_freed;
+}
+
+size_t AnonymousVMObject::SwapShrinker::reclaimable_pages() {
+	auto swap = Swap::inst();
+	if(!swap || s_swappable_lock.held_by_current_thread() || !s_swappable_lock.try_acquire())
+		return 0;
+	size_t num_pages = 0;
+	for(auto object : s_swappable_objects)
+		num_pages += object->m_physical_pages.size();
+	s_swappable_lock.release();
+	return min(num_pages, swap->num_free_slots());
+}
+
+size_t AnonymousVMObject::SwapShrinker::shrink(size_t num_pages) {
+	// Like the purgeable shrinker, objects remove themselves from the list before being destroyed, and objects that are
+	// locked by someone else are skipped.
+	if(!Swap::inst() || s_swappable_lock.held_by_current_thread() || !s_swappable_lock.try_acquire())
+		return 0;
+	size_t num_freed = 0;
+	for(size_t i = 0; i < s_swappable_objects.size() && num_freed < num_pages; i++) {
+		// Start where we left off last time so that every object gets its turn
+		s_swap_cursor = (s_swap_cursor + 1) % s_swappable_objects.size();
+		auto object = s_swappable_objects[s_swap_cursor];
+		if(object->m_page_lock.held_by_current_thread() || !object->m_page_lock.try_acquire())
+			continue;
+		num_freed += object->swap_out_pages(num_pages - num_freed);
+		object->m_page_lock.release();
+	}
+	s_swappable_lock.release();
+	return num_freed;
+}
+
 ResultRet<kstd::Arc<VMObject>> AnonymousVMObject::clone() {
 	LOCK(m_page_lock);
 	ASSERT(!is_shared());
+
+	// Bring back anything that was swapped out, since the pages will be shared with the new object
+	if(m_swappable) {
+		for(size_t i = 0; i < m_physical_pages.size(); i++) {
+			if(!m_swap_slots[i])
+				continue;
+			auto res = page_in(i);
+			if(res.is_error())
+				return res;
+		}
+	}
+
 	become_cow_and_ref_pages();
 	auto new_object = kstd::Arc(new AnonymousVMObject(m_physical_pages, true));
+	if(m_swappable) {
+		auto res = new_object->make_swappable();
+		if(res.is_error())
+			return res;
+	}
 	return kstd::static_pointer_cast<VMObject>(new_object);
 }
 
@@ -10,6 +10,8 @@
 #include "../kstd/unix_types.h"
 #include "../tasking/SpinLock.h"
 #include "VMRegion.h"
+#include "Shrinker.h"
+#include "Swap.h"
 
 class AnonymousVMObject: public VMObject {
 public:
@@ -25,9 +27,17 @@ public:
 	/**
 	 * Allocates a new anonymous VMObject backed by contiguous physical pages.
 	 * @param size The minimum size, in bytes, of the object.
+	 * @param zone The highest zone the object's memory may come from.
 	 * @return The newly allocated object, if successful.
 	 */
-	static ResultRet<kstd::Arc<AnonymousVMObject>> alloc_contiguous(size_t size);
+	static ResultRet<kstd::Arc<AnonymousVMObject>> alloc_contiguous(size_t size, PhysicalZone zone = PhysicalZone::Normal);
+
+	/**
+	 * Allocates a new anonymous VMObject whose pages aren't allocated until they're first used.
+	 * @param size The minimum size, in bytes, of the object.
+	 * @return The newly allocated object.
+	 */
+	static kstd::Arc<AnonymousVMObject> alloc_lazy(size_t size);
 
 	/**
 	 * Creates an anonymous VMObject backed by existing physical pages.
@@ -58,6 +68,68 @@ public:
 	 */
 	ResultRet<VMProt> get_shared_permissions(pid_t pid);
 
+	/**
+	 * Takes away a process's access to the shared object. Its existing mappings aren't affected.
+	 * @param pid The PID of the process.
+	 */
+	void unshare(pid_t pid);
+
+	/**
+	 * Marks the object as purgeable or not. While an object is purgeable, its pages may be freed when memory is low.
+	 * Pages that are accessed after being purged are filled with zeroes.
+	 * @param purgeable Whether the object should be purgeable.
+	 * @return Whether the object's pages were purged since it was last marked purgeable.
+	 */
+	bool set_purgeable(bool purgeable);
+	bool is_purgeable() const { return m_purgeable; }
+
+	/**
+	 * Allows the object's pages to be swapped out to disk when memory is low. Only objects that are only ever accessed
+	 * through userspace mappings should be made swappable, since the kernel can't fault pages back in for itself.
+	 */
+	Result make_swappable();
+	bool is_swappable() const { return m_swappable; }
+
+	/**
+	 * Allocates a page for an index of the object that doesn't have one (because it was purged or swapped out). If it
+	 * was swapped out, it is read back in from swap. Otherwise, it is filled with zeroes.
+	 * Should be called with the object's lock held.
+	 * @param index The index of the page to fill in.
+	 */
+	Result page_in(PageIndex index);
+
+	/**
+	 * Like page_in(), but for a page that's only being read. If the page would be filled with zeroes, it's mapped to
+	 * the shared zero page as CoW instead, so that reading untouched memory doesn't use any. Only swappable objects do
+	 * this, since the kernel may write to the pages of others directly. Should be called with the object's lock held.
+	 * @param index The index of the page to fill in.
+	 */
+	Result page_in_for_read(PageIndex index);
+
+	/**
+	 * Gets a page of the object ready for the kernel to write to, paging it in if needed and copying it if it's CoW.
+	 * Should be called with the object's lock held.
+	 * @param index The index of the page.
+	 * @return The physical page to write to.
+	 */
+	ResultRet<PageIndex> page_for_write(PageIndex index);
+
+	/**
+	 * Throws away the pages in a range of the object, along with anything swapped out from it. They read back as
+	 * zeroes. Should be called with the object's lock held.
+	 * @param start The index of the first page to throw away.
+	 * @param num_pages The number of pages to throw away.
+	 */
+	void discard(PageIndex start, size_t num_pages);
+
+	/**
+	 * Fits the object to a new size of the data kept in it, dropping pages past the end and zeroing the rest of the last
+	 * page. Dropped pages read back as zeroes. The object never gets smaller since it may be mapped past the new end.
+	 * Should be called with the object's lock held.
+	 */
+	Result resize(size_t size);
+
+	void set_fork_action(ForkAction action) { m_fork_action = action; }
 	bool is_shared() const { return m_is_shared; }
 	pid_t shared_owner() const { return m_shared_owner; }
 	int shm_id() const { return m_shm_id; }
@@ -70,9 +142,57 @@ public:
 
 private:
 	friend class MemoryManager;
+	friend class PageMerger;
 
 	explicit AnonymousVMObject(kstd::vector<PageIndex> physical_pages, bool cow);
 
+	/// Frees the pages of the object that aren't being used by anything else. Should be called with the object's lock
+	/// held. Returns the number of pages freed.
+	size_t purge();
+
+	/// Purges purgeable objects when memory is low.
+	class PurgeableShrinker: public Shrinker {
+	public:
+		const char* name() const override { return "purgeable memory"; }
+		size_t reclaimable_pages() override;
+		size_t shrink(size_t num_pages) override;
+	};
+
+	/// Swaps out pages that haven't been accessed recently from swappable objects. Each object keeps a "clock hand" that
+	/// goes around its pages; pages that were accessed since the hand last passed them are given a second chance.
+	class SwapShrinker: public Shrinker {
+	public:
+		const char* name() const override { return "swap"; }
+		size_t reclaimable_pages() override;
+		size_t shrink(size_t num_pages) override;
+	};
+
+	/// Swaps out up to max_pages pages that haven't been accessed recently. Should be called with the object's lock
+	/// held. Returns the number of pages freed.
+	size_t swap_out_pages(size_t max_pages);
+
+	/// Whether the object's pages can be moved to other physical pages. Like swapping, this is only safe for objects
+	/// the kernel doesn't access directly. Should be called with the object's lock held.
+	bool pages_movable();
+
+	/// Marks the physical pages that migrate_pages() could move in a bitmap indexed by absolute page index. Only pages
+	/// in swappable objects that aren't shared with another object are movable.
+	static void mark_movable_pages(kstd::Bitmap& bitmap);
+
+	/// Moves the movable pages in a range of physical pages to the pages in free_pages, which are taken from the back
+	/// as they're used. Used to compact physical memory. Returns the number of pages moved.
+	static size_t migrate_pages(PageIndex first_page, size_t num_pages, kstd::vector<PageIndex>& free_pages);
+
+	static PurgeableShrinker s_purgeable_shrinker;
+	static SpinLock s_purgeable_lock;
+	static kstd::vector<AnonymousVMObject*> s_purgeable_objects; ///< Objects remove themselves before being destroyed.
+	static size_t s_purgeable_pages; ///< The number of pages in purgeable objects that haven't been purged yet.
+
+	static SwapShrinker s_swap_shrinker;
+	static Mutex s_swappable_lock;
+	static kstd::vector<AnonymousVMObject*> s_swappable_objects; ///< Objects remove themselves before being destroyed.
+	static size_t s_swap_cursor;
+
 	static SpinLock s_shared_lock;
 	static int s_cur_shm_id;
 	static kstd::map<int, kstd::Weak<AnonymousVMObject>> s_shared_objects;
@@ -82,4 +202,9 @@ private:
 	ForkAction m_fork_action = ForkAction::BecomeCoW;
 	pid_t m_shared_owner;
 	int m_shm_id = 0;
+	bool m_purgeable = false;
+	bool m_purged = false;
+	bool m_swappable = false;
+	kstd::vector<SwapSlot> m_swap_slots; ///< The swap slot each swapped out page is in, or 0.
+	size_t m_swap_hand = 0;
 };
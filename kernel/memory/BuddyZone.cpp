@@ -24,6 +24,7 @@ BuddyZone::BuddyZone(PageIndex first_page, size_t num_pages):
 	}
 
 	m_orders[m_highest_order].freelist = 0;
+	m_orders[m_highest_order].num_free = 1;
 	m_orders[m_highest_order].set_bit(0, BuddyState::MIXED);
 }
 
@@ -31,6 +32,15 @@ PhysicalPage& BuddyZone::get_block(int block) const {
 	return MemoryManager::inst().get_physical_page(page_of_block(block));
 }
 
+void BuddyZone::mark_free_pages(kstd::Bitmap& bitmap) const {
+	for(unsigned int order = 0; order <= m_highest_order; order++) {
+		for(int block = m_orders[order].freelist; block != -1; block = get_block(block).free.next) {
+			for(size_t page = 0; page < size_of_order(order); page++)
+				bitmap.set(page_of_block(block) + page, true);
+		}
+	}
+}
+
 ResultRet<PageIndex> BuddyZone::alloc_block(size_t num_pages) {
 	if(m_free_pages < num_pages)
 		return Result(ENOMEM);
@@ -49,7 +59,9 @@ void BuddyZone::free_block(PageIndex start_page, size_t num_pages) {
 }
 
 ResultRet<int> BuddyZone::alloc_block_internal(unsigned int order) {
-	ASSERT(order <= m_highest_order);
+	// Zones are aligned to their size, so they may be smaller than the block requested
+	if(order > m_highest_order)
+		return Result(ENOMEM);
 
 	auto& bucket = m_orders[order];
 	if(bucket.freelist == -1) {
@@ -61,6 +73,7 @@ ResultRet<int> BuddyZone::alloc_block_internal(unsigned int order) {
 
 		// Update freelist to point to second block
 		bucket.freelist = higher_order_block + size_of_order(order);
+		bucket.num_free = 1;
 		auto& free_page = get_block(bucket.freelist);
 		free_page.free.next = -1;
 		free_page.free.prev = -1;
@@ -77,7 +90,9 @@ ResultRet<int> BuddyZone::alloc_block_internal(unsigned int order) {
 	// Update the freelist and bitmap
 	bucket.set_bit(block, BuddyState::BOTH);
 	bucket.freelist = get_block(bucket.freelist).free.next;
-	get_block(bucket.freelist).free.prev = -1;
+	if(bucket.freelist != -1)
+		get_block(bucket.freelist).free.prev = -1;
+	bucket.num_free--;
 
 	return block;
 }
@@ -110,6 +125,7 @@ void BuddyZone::free_block_internal(int block, unsigned int order) {
 		page.free.next = (int16_t) bucket.freelist;
 		page.free.prev = -1;
 		bucket.freelist = block;
+		bucket.num_free++;
 	}
 }
 
@@ -123,4 +139,5 @@ void BuddyZone::remove_from_freelist(int block, unsigned int order) {
 		ASSERT(page.prev == -1);
 		m_orders[order].freelist = page.next;
 	}
+	m_orders[order].num_free--;
 }
@@ -41,6 +41,7 @@ struct BuddyOrder {
 	unsigned int order; ///< The order of the block in the buddy system.
 	kstd::Bitmap block_map; ///< The map of blocks in the order bucket.
 	int freelist = -1; ///< The index to the first page in the freelist relative to the zone's first page. -1 == None free.
+	size_t num_free = 0; ///< The number of blocks in the freelist.
 };
 
 class BuddyZone {
@@ -88,8 +89,20 @@ public:
 	 */
 	void free_block(PageIndex start_page, size_t num_pages);
 
+	/** The number of free blocks of the given order in this zone. **/
+	size_t num_free_blocks(unsigned int order) const {
+		return order <= m_highest_order ? m_orders[order].num_free : 0;
+	}
+
+	/**
+	 * Marks every free page in this zone in a bitmap.
+	 * @param bitmap The bitmap to mark the pages in, indexed by absolute page index.
+	 */
+	void mark_free_pages(kstd::Bitmap& bitmap) const;
+
 	PageIndex first_page() const { return m_first_page; }
 	size_t num_pages() const { return m_num_pages; }
+	unsigned int highest_order() const { return m_highest_order; }
 	bool contains_page(PageIndex page) const {
 		return page >= m_first_page && page < m_first_page + m_num_pages;
 	}
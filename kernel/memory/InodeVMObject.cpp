@@ -2,45 +2,339 @@
 /* Copyright © 2016-2023 Byteduck */
 
 #include "InodeVMObject.h"
+#include "Readahead.h"
+#include "Prefetch.h"
+#include "MemoryManager.h"
+
+InodeVMObject::CleanPageShrinker InodeVMObject::s_shrinker;
+SpinLock InodeVMObject::s_objects_lock;
+kstd::vector<InodeVMObject*> InodeVMObject::s_objects;
+size_t InodeVMObject::s_shrink_cursor = 0;
 
 kstd::Arc<InodeVMObject> InodeVMObject::make_for_inode(kstd::Arc<Inode> inode, InodeVMObject::Type type) {
 	kstd::vector<PageIndex> pages;
 	pages.resize((inode->metadata().size + PAGE_SIZE - 1) / PAGE_SIZE);
 	memset(pages.storage(), 0, pages.size() * sizeof(PageIndex));
-	return kstd::Arc<InodeVMObject>(new InodeVMObject(pages, kstd::move(inode), type, false));
+	kstd::Arc<InodeVMObject> page_cache;
+	if(type == Type::Private)
+		page_cache = inode->page_cache();
+	return kstd::Arc<InodeVMObject>(new InodeVMObject(pages, kstd::move(inode), kstd::move(page_cache), type, false));
 }
 
 ResultRet<kstd::Arc<VMObject>> InodeVMObject::clone() {
-	ASSERT(m_inode);
+	ASSERT(m_inode_ref);
 	LOCK(m_page_lock);
 	ASSERT(m_type == Type::Private);
 	become_cow_and_ref_pages();
-	auto new_object = kstd::Arc(new InodeVMObject(m_physical_pages, m_inode, m_type, m_type == Type::Private));
+	auto new_object = kstd::Arc(new InodeVMObject(m_physical_pages, m_inode_ref, m_page_cache, m_type, m_type == Type::Private));
 	return kstd::static_pointer_cast<VMObject>(new_object);
 }
 
-InodeVMObject::InodeVMObject(kstd::vector<PageIndex> physical_pages, kstd::Arc<Inode> inode, InodeVMObject::Type type, bool cow):
+InodeVMObject::InodeVMObject(kstd::vector<PageIndex> physical_pages, kstd::Arc<Inode> inode, kstd::Arc<InodeVMObject> page_cache, InodeVMObject::Type type, bool cow):
 	VMObject(kstd::move(physical_pages), cow),
-	m_inode(kstd::move(inode)),
+	m_inode(inode),
+	m_page_cache(kstd::move(page_cache)),
 	m_type(type)
-{}
+{
+	if(m_type == Type::Private)
+		m_inode_ref = kstd::move(inode);
+
+	static bool registered_shrinker = false;
+	if(!registered_shrinker) {
+		MM.register_shrinker(&s_shrinker);
+		registered_shrinker = true;
+	}
+
+	LOCK(s_objects_lock);
+	s_objects.push_back(this);
+}
+
+InodeVMObject::~InodeVMObject() {
+	LOCK(s_objects_lock);
+	for(size_t i = 0; i < s_objects.size(); i++) {
+		if(s_objects[i] == this) {
+			s_objects.erase(i);
+			break;
+		}
+	}
+}
 
 ResultRet<bool> InodeVMObject::read_page_if_needed(size_t index) {
-	if(index >= m_physical_pages.size())
+	return TRY(read_pages_if_needed(index, 1)) != 0;
+}
+
+ResultRet<size_t> InodeVMObject::read_pages_if_needed(PageIndex start, size_t num_pages) {
+	if(start + num_pages > m_physical_pages.size())
 		return Result(ERANGE);
-	if(m_physical_pages[index])
-		return false;
+	if(m_type == Type::Private)
+		return read_private_pages(start, num_pages);
+
+	auto inode = m_inode.lock();
+	if(!inode)
+		return Result(ENOENT);
+
+	size_t num_read = 0;
+	PageIndex end = start + num_pages;
+	for(PageIndex index = start; index < end;) {
+		if(m_physical_pages[index]) {
+			index++;
+			continue;
+		}
+
+		// Find the run of pages that haven't been read in yet
+		size_t run = 1;
+		while(run < KERNEL_QUICKMAP_PAGES && index + run < end && !m_physical_pages[index + run])
+			run++;
+
+		PageIndex new_pages[KERNEL_QUICKMAP_PAGES];
+		for(size_t i = 0; i < run; i++) {
+			auto page_res = MM.alloc_physical_page();
+			if(page_res.is_error()) {
+				while(i--)
+					MM.free_physical_page(new_pages[i]);
+				return page_res.result();
+			}
+			new_pages[i] = page_res.value();
+		}
+
+		// Anything past the end of the inode reads as zeroes
+		ssize_t nread;
+		MM.with_quickmapped_pages(new_pages, run, [&](void* buf) {
+			nread = inode->read(index * PAGE_SIZE, run * PAGE_SIZE, KernelPointer<uint8_t>((uint8_t*) buf), nullptr);
+			if(nread >= 0 && (size_t) nread < run * PAGE_SIZE)
+				memset((uint8_t*) buf + nread, 0, run * PAGE_SIZE - nread);
+		});
+		if(nread < 0) {
+			for(size_t i = 0; i < run; i++)
+				MM.free_physical_page(new_pages[i]);
+			return Result(-nread);
+		}
+
+		for(size_t i = 0; i < run; i++)
+			m_physical_pages[index + i] = new_pages[i];
+		num_read += run;
+		index += run;
+	}
+
+	return num_read;
+}
+
+ResultRet<size_t> InodeVMObject::read_private_pages(PageIndex start, size_t num_pages) {
+	size_t num_read = 0;
+	PageIndex end = start + num_pages;
+	for(PageIndex index = start; index < end;) {
+		if(m_physical_pages[index]) {
+			index++;
+			continue;
+		}
+
+		size_t run = 1;
+		while(run < KERNEL_QUICKMAP_PAGES && index + run < end && !m_physical_pages[index + run])
+			run++;
+
+		// Share the pages with the page cache until they're written to. If the inode got smaller since we were mapped,
+		// the pages past its end are just zeroes.
+		PageIndex pages[KERNEL_QUICKMAP_PAGES];
+		size_t num_cached = TRY(m_page_cache->ref_pages(index, run, true, pages));
+		for(size_t i = num_cached; i < run; i++) {
+			auto page_res = MM.alloc_physical_page(true);
+			if(page_res.is_error()) {
+				while(i--)
+					MM.get_physical_page(pages[i]).unref();
+				return page_res.result();
+			}
+			pages[i] = page_res.value();
+		}
+
+		for(size_t i = 0; i < run; i++) {
+			m_physical_pages[index + i] = pages[i];
+			if(i < num_cached)
+				m_cow_pages.set(index + i, true);
+		}
+		num_read += run;
+		index += run;
+	}
+
+	return num_read;
+}
+
+ResultRet<size_t> InodeVMObject::ref_pages(PageIndex start, size_t num_pages, bool read_in, PageIndex* pages) {
+	ASSERT(m_type == Type::Shared);
+	LOCK(m_page_lock);
+	if(start >= m_physical_pages.size())
+		return 0;
+	num_pages = min(num_pages, m_physical_pages.size() - start);
+	if(read_in) {
+		Prefetch::record(*this, start, num_pages);
+		TRY(read_pages_if_needed(start, num_pages));
+	}
+	for(size_t i = 0; i < num_pages; i++) {
+		pages[i] = m_physical_pages[start + i];
+		if(pages[i])
+			MM.get_physical_page(pages[i]).ref();
+	}
+	return num_pages;
+}
+
+ssize_t InodeVMObject::read(size_t start, size_t length, SafePointer<uint8_t> buffer) {
+	// The pages are copied from with the lock released, since the buffer may be a mapping of this object. The references
+	// we hold keep them from being freed if they're dropped in the meantime.
+	size_t end = start + length;
+	size_t pos = start;
+	while(pos < end) {
+		PageIndex first_page = pos / PAGE_SIZE;
+		size_t num_pages = min(kstd::ceil_div(end, PAGE_SIZE) - first_page, (size_t) KERNEL_QUICKMAP_PAGES);
+		PageIndex pages[KERNEL_QUICKMAP_PAGES];
+		auto ref_res = ref_pages(first_page, num_pages, true, pages);
+		if(ref_res.is_error())
+			return pos > start ? (ssize_t) (pos - start) : -ref_res.code();
+		if(!ref_res.value())
+			break;
+		num_pages = ref_res.value();
 
-	auto new_page = TRY(MM.alloc_physical_page());
-	ssize_t nread;
-	MM.with_quickmapped(new_page, [&](void* buf) {
-		nread = m_inode->read(index * PAGE_SIZE, PAGE_SIZE, KernelPointer<uint8_t>((uint8_t*) buf), nullptr);
-	});
-	if(nread < 0) {
-		MM.free_physical_page(new_page);
-		return Result(-nread);
+		size_t chunk_end = min(end, (first_page + num_pages) * PAGE_SIZE);
+		MM.with_quickmapped_pages(pages, num_pages, [&](void* ptr) {
+			buffer.write((uint8_t*) ptr + pos % PAGE_SIZE, pos - start, chunk_end - pos);
+		});
+		for(size_t i = 0; i < num_pages; i++)
+			MM.get_physical_page(pages[i]).unref();
+		pos = chunk_end;
 	}
-	m_physical_pages[index] = new_page;
+	return pos - start;
+}
+
+void InodeVMObject::update(size_t start, size_t length, SafePointer<uint8_t> buffer) {
+	size_t end = start + length;
+	for(PageIndex index = start / PAGE_SIZE; index * PAGE_SIZE < end; index++) {
+		PageIndex page;
+		if(ref_pages(index, 1, false, &page).is_error() || !page)
+			continue;
+		size_t page_start = max(start, index * PAGE_SIZE);
+		size_t page_end = min(end, (index + 1) * PAGE_SIZE);
+		MM.with_quickmapped(page, [&](void* ptr) {
+			buffer.read((uint8_t*) ptr + page_start % PAGE_SIZE, page_start - start, page_end - page_start);
+		});
+		MM.get_physical_page(page).unref();
+	}
+}
+
+void InodeVMObject::resize(size_t size) {
+	ASSERT(m_type == Type::Shared);
+	LOCK(m_page_lock);
+	size_t num_pages = kstd::ceil_div(size, PAGE_SIZE);
+	for(PageIndex index = num_pages; index < m_physical_pages.size(); index++)
+		drop_page(index);
+
+	if(size % PAGE_SIZE && num_pages <= m_physical_pages.size() && m_physical_pages[num_pages - 1]) {
+		MM.with_quickmapped(m_physical_pages[num_pages - 1], [&](void* ptr) {
+			memset((uint8_t*) ptr + size % PAGE_SIZE, 0, PAGE_SIZE - size % PAGE_SIZE);
+		});
+	}
+
+	if(num_pages > m_physical_pages.size()) {
+		m_physical_pages.resize(num_pages);
+		m_cow_pages.grow(num_pages);
+		m_size = num_pages * PAGE_SIZE;
+	}
+}
+
+void InodeVMObject::add_region(VMRegion* region) {
+	LOCK(m_inode_ref_lock);
+	VMObject::add_region(region);
+
+	// Nothing else has to be holding onto the inode while its page cache is mapped, so hold onto it ourselves
+	if(m_type == Type::Shared && !m_inode_ref)
+		m_inode_ref = m_inode.lock();
+}
+
+void InodeVMObject::remove_region(VMRegion* region) {
+	// Let go of the inode after releasing the lock, since that might be the last reference to it
+	kstd::Arc<Inode> inode;
+	LOCK(m_inode_ref_lock);
+	VMObject::remove_region(region);
+	if(m_type == Type::Shared && !has_regions())
+		inode = kstd::move(m_inode_ref);
+}
 
-	return true;
+void InodeVMObject::readahead_after(PageIndex index) {
+	auto readahead = Readahead::inst();
+	if(!readahead || !Readahead::max_pages())
+		return;
+
+	// Don't read ahead if we'd just be making the reclaim thread drop other pages to make room
+	if(MM.num_free_pages() < MM.low_watermark())
+		return;
+
+	// If this fault is just past the last one (allowing for the pages that were read ahead or faulted around since),
+	// assume the object is being read sequentially and grow the window
+	bool sequential = m_readahead_pages && index > m_last_fault &&
+			index <= m_last_fault + m_readahead_pages + Readahead::fault_around_pages() + 1;
+	if(sequential)
+		m_readahead_pages = min(m_readahead_pages * 2, Readahead::max_pages());
+	else
+		m_readahead_pages = min((size_t) READAHEAD_PAGES_MIN, Readahead::max_pages());
+	m_last_fault = index;
+
+	PageIndex start = index + 1;
+	if(sequential && m_readahead_end > start)
+		start = m_readahead_end;
+	PageIndex end = min(index + 1 + m_readahead_pages, page_count());
+	if(start >= end)
+		return;
+
+	m_readahead_end = end;
+	readahead->queue(kstd::static_pointer_cast<InodeVMObject>(self()), start, end - start);
+}
+
+size_t InodeVMObject::drop_clean_pages(size_t max_pages) {
+	if(written())
+		return 0;
+
+	size_t num_dropped = 0;
+	for(size_t i = 0; i < m_physical_pages.size() && num_dropped < max_pages; i++) {
+		// Pages shared with a clone of the object are still in use there, so dropping them wouldn't free anything
+		auto page = m_physical_pages[i];
+		if(!page || MM.get_physical_page(page).allocated.ref_count.load(MemoryOrder::Relaxed) != 1)
+			continue;
+		drop_page(i);
+		num_dropped++;
+	}
+
+	// The pages we dropped may have been read ahead, so start the readahead window over
+	if(num_dropped) {
+		m_readahead_pages = 0;
+		m_readahead_end = 0;
+	}
+	return num_dropped;
+}
+
+size_t InodeVMObject::CleanPageShrinker::reclaimable_pages() {
+	LOCK(s_objects_lock);
+	size_t num_pages = 0;
+	for(auto object : s_objects) {
+		if(object->written())
+			continue;
+		for(auto page : object->m_physical_pages)
+			if(page)
+				num_pages++;
+	}
+	return num_pages;
+}
+
+size_t InodeVMObject::CleanPageShrinker::shrink(size_t num_pages) {
+	// Objects take this lock before they're destroyed, so everything in the list stays valid while we hold it. Objects
+	// are shrunk round-robin starting from wherever we left off last time, and ones that are locked are skipped since
+	// they're being faulted on or read into.
+	LOCK(s_objects_lock);
+	size_t num_freed = 0;
+	for(size_t i = 0; i < s_objects.size() && num_freed < num_pages; i++) {
+		auto object = s_objects[(s_shrink_cursor + i) % s_objects.size()];
+		if(object->m_page_lock.held_by_current_thread() || !object->m_page_lock.try_acquire())
+			continue;
+		num_freed += object->drop_clean_pages(num_pages - num_freed);
+		object->m_page_lock.release();
+	}
+	if(!s_objects.empty())
+		s_shrink_cursor = (s_shrink_cursor + 1) % s_objects.size();
+	return num_freed;
 }
@@ -5,15 +5,25 @@
 
 #include "VMObject.h"
 #include "../filesystem/Inode.h"
+#include "Shrinker.h"
 
+/**
+ * An object for the pages of an inode. Each inode has one shared object, which is its page cache: reads and writes of the
+ * inode go through it, and shared mappings of the inode map it directly. Private mappings get their own object, whose
+ * pages start out as copy-on-write references to pages in the page cache.
+ */
 class InodeVMObject: public VMObject {
 public:
 	enum class Type {
 		Shared, Private
 	};
 
+	/**
+	 * Makes an object for an inode. Shared objects should only be made by Inode::page_cache(), since each inode only has
+	 * one of them.
+	 */
 	static kstd::Arc<InodeVMObject> make_for_inode(kstd::Arc<Inode> inode, Type type);
-
+	~InodeVMObject() override;
 
 	PageIndex& physical_page_index(size_t index) const {
 		return m_physical_pages[index];
@@ -26,20 +36,92 @@ public:
 	 */
 	ResultRet<bool> read_page_if_needed(size_t index);
 
-	kstd::Arc<Inode> inode() const { return m_inode; }
-	SpinLock& lock() { return m_page_lock; }
+	/**
+	 * Reads in any pages in the given range that aren't allocated yet. Consecutive missing pages are read with a single
+	 * read from the inode.
+	 * @param start The index of the first page to read in.
+	 * @param num_pages The number of pages to read in.
+	 * @return The number of pages that were read in, or an error if the range is out of bounds or couldn't be read.
+	 */
+	ResultRet<size_t> read_pages_if_needed(PageIndex start, size_t num_pages);
+
+	/**
+	 * Copies data out of the page cache, reading in any pages that aren't cached yet. Only for shared objects.
+	 * @return The number of bytes read, or a negative error code.
+	 */
+	ssize_t read(size_t start, size_t length, SafePointer<uint8_t> buffer);
+
+	/**
+	 * Copies data that was just written to the inode into the pages of the page cache that are cached. Pages that
+	 * aren't cached are left alone, since they'll be read in with the new data. Only for shared objects.
+	 */
+	void update(size_t start, size_t length, SafePointer<uint8_t> buffer);
+
+	/**
+	 * Fits the page cache to a new size of the inode, dropping cached pages past the end and zeroing the rest of the last
+	 * page. The object never gets smaller since it may be mapped past the new end. Only for shared objects.
+	 */
+	void resize(size_t size);
+
+	/**
+	 * Takes references to the pages of the page cache in a range, so they can be used without holding the lock. Only for
+	 * shared objects.
+	 * @param read_in Whether to read in pages that aren't cached yet. If not, they're left as 0.
+	 * @return The number of pages in the range that are in the object, or an error if they couldn't be read.
+	 */
+	ResultRet<size_t> ref_pages(PageIndex start, size_t num_pages, bool read_in, PageIndex* pages);
+
+	/**
+	 * Records a fault on a page of the object and queues the pages after it to be read in by the readahead thread.
+	 * The readahead window doubles (up to Readahead::max_pages()) while faults keep moving forwards through the object,
+	 * and starts over when they jump somewhere else. Should be called with the object's lock held.
+	 * @param index The index of the page that was faulted on.
+	 */
+	void readahead_after(PageIndex index);
+
+	size_t page_count() const { return m_physical_pages.size(); }
+
+	kstd::Arc<Inode> inode() { return m_inode.lock(); }
 	Type type() const { return m_type; }
 	bool is_inode() const override { return true; }
 	ForkAction fork_action() const override {
 		return m_type == Type::Private ? ForkAction::BecomeCoW : ForkAction::Share;
 	}
 	ResultRet<kstd::Arc<VMObject>> clone() override;
+	void add_region(VMRegion* region) override;
+	void remove_region(VMRegion* region) override;
 
 	// TODO: Syncing
 
 private:
-	explicit InodeVMObject(kstd::vector<PageIndex> physical_pages, kstd::Arc<Inode> inode, Type type, bool cow);
+	InodeVMObject(kstd::vector<PageIndex> physical_pages, kstd::Arc<Inode> inode, kstd::Arc<InodeVMObject> page_cache, Type type, bool cow);
+
+	/// Reads pages into the page cache and takes references to them, for a private object.
+	ResultRet<size_t> read_private_pages(PageIndex start, size_t num_pages);
+
+	/// Drops up to a number of pages that can be read back in from the inode. That's only the case if the object has
+	/// never been mapped writable, since there's no writeback yet. Should be called with the object's lock held.
+	size_t drop_clean_pages(size_t max_pages);
+
+	/// Drops clean pages of inode mappings when memory is low.
+	class CleanPageShrinker: public Shrinker {
+	public:
+		const char* name() const override { return "inode pages"; }
+		size_t reclaimable_pages() override;
+		size_t shrink(size_t num_pages) override;
+	};
+
+	static CleanPageShrinker s_shrinker;
+	static SpinLock s_objects_lock;
+	static kstd::vector<InodeVMObject*> s_objects; ///< Objects remove themselves before being destroyed.
+	static size_t s_shrink_cursor; ///< Where in s_objects the shrinker left off last time.
 
-	kstd::Arc<Inode> m_inode;
+	kstd::Weak<Inode> m_inode; ///< An inode holds its own page cache, so the page cache only holds it weakly.
+	kstd::Arc<Inode> m_inode_ref; ///< Keeps private objects' inodes around, and shared objects' while they're mapped.
+	SpinLock m_inode_ref_lock;
+	kstd::Arc<InodeVMObject> m_page_cache; ///< The page cache that a private object's pages come from.
 	Type m_type;
+	PageIndex m_last_fault = 0;
+	size_t m_readahead_pages = 0;
+	PageIndex m_readahead_end = 0; ///< Every page before this has already been queued for readahead.
 };
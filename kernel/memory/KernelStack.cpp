@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "KernelStack.h"
+#include "MemoryManager.h"
+#include "AnonymousVMObject.h"
+#include "VMSpace.h"
+#include <kernel/tasking/Thread.h>
+#include <kernel/tasking/SpinLock.h>
+
+namespace {
+	SpinLock s_cache_lock;
+	KernelStack s_cache[KERNEL_STACK_CACHE_SIZE];
+	size_t s_num_cached = 0;
+}
+
+KernelStack::KernelStack(kstd::Arc<VMRegion> region, kstd::Arc<VMRegion> guard):
+	m_region(kstd::move(region)),
+	m_guard(kstd::move(guard))
+{}
+
+KernelStack::KernelStack(KernelStack&& other) noexcept:
+	m_region(kstd::move(other.m_region)),
+	m_guard(kstd::move(other.m_guard))
+{}
+
+KernelStack::~KernelStack() {
+	release();
+}
+
+KernelStack& KernelStack::operator=(KernelStack&& other) noexcept {
+	if(this != &other) {
+		release();
+		m_region = kstd::move(other.m_region);
+		m_guard = kstd::move(other.m_guard);
+	}
+	return *this;
+}
+
+KernelStack KernelStack::alloc() {
+	{
+		LOCK(s_cache_lock);
+		if(s_num_cached)
+			return kstd::move(s_cache[--s_num_cached]);
+	}
+
+	kstd::Arc<VMRegion> region, guard;
+	auto do_alloc = [&]() -> Result {
+		// The guard page never gets any physical pages, and can't be accessed at all
+		auto stack_object = TRY(AnonymousVMObject::alloc(THREAD_KERNEL_STACK_SIZE));
+		auto guard_object = AnonymousVMObject::alloc_lazy(PAGE_SIZE);
+
+		// Hold the space's lock so nothing else can be mapped between finding the space and mapping into it
+		auto space = MM.kernel_space();
+		LOCK(space->lock());
+		auto start = TRY(space->find_free_space(THREAD_KERNEL_STACK_SIZE + PAGE_SIZE));
+		guard = TRY(space->map_object(guard_object, {false, false, false}, {start, PAGE_SIZE}, 0, false));
+		region = TRY(space->map_object(stack_object, VMProt::RW, {start + PAGE_SIZE, THREAD_KERNEL_STACK_SIZE}));
+		return Result(SUCCESS);
+	};
+
+	if(do_alloc().is_error())
+		PANIC("ALLOC_KERNEL_STACK_FAIL", "Could not allocate a new kernel stack.");
+	return {region, guard};
+}
+
+size_t KernelStack::num_cached() {
+	LOCK(s_cache_lock);
+	return s_num_cached;
+}
+
+void KernelStack::release() {
+	if(!m_region)
+		return;
+
+	{
+		LOCK(s_cache_lock);
+		if(s_num_cached < KERNEL_STACK_CACHE_SIZE) {
+			s_cache[s_num_cached++] = kstd::move(*this);
+			return;
+		}
+	}
+
+	// The cache is full, so unmap the stack and its guard page
+	m_region.reset();
+	m_guard.reset();
+}
@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/Arc.h>
+#include "VMRegion.h"
+
+// How many freed kernel stacks are kept mapped so they can be handed out again
+#define KERNEL_STACK_CACHE_SIZE 16
+
+/**
+ * A kernel stack, with an inaccessible guard page right below it so that overflowing the stack faults instead of
+ * running into whatever is mapped underneath.
+ *
+ * Released stacks go into a cache with their pages still mapped, so threads that come and go quickly don't have to
+ * allocate physical pages or touch the kernel's page tables each time.
+ */
+class KernelStack {
+public:
+	KernelStack() = default;
+	KernelStack(const KernelStack& other) = delete;
+	KernelStack(KernelStack&& other) noexcept;
+	~KernelStack();
+
+	KernelStack& operator=(const KernelStack& other) = delete;
+	KernelStack& operator=(KernelStack&& other) noexcept;
+
+	/// Gets a stack from the cache, or allocates a new one if the cache is empty.
+	static KernelStack alloc();
+	/// The number of stacks in the cache.
+	static size_t num_cached();
+
+	/// Puts the stack back in the cache, or frees it if the cache is full. Happens automatically on destruction.
+	void release();
+
+	[[nodiscard]] VirtualAddress start() const { return m_region->start(); }
+	[[nodiscard]] VirtualAddress top() const { return m_region->end(); }
+	explicit operator bool() const { return m_region; }
+
+private:
+	KernelStack(kstd::Arc<VMRegion> region, kstd::Arc<VMRegion> guard);
+
+	kstd::Arc<VMRegion> m_region;
+	kstd::Arc<VMRegion> m_guard;
+};
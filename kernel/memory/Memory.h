@@ -20,15 +20,28 @@
 #define KERNEL_TEXT_SIZE (KERNEL_TEXT_END - KERNEL_TEXT)
 #define KERNEL_DATA_SIZE (KERNEL_DATA_END - KERNEL_DATA)
 #define KERNEL_END_VIRTADDR (HIGHER_HALF + KERNEL_SIZE_PAGES * PAGE_SIZE)
+#define PAGES_PER_LARGE_PAGE 1024
+#define LARGE_PAGE_SIZE (PAGE_SIZE * PAGES_PER_LARGE_PAGE)
 #define KERNEL_VIRTUAL_HEAP_BEGIN 0xE0000000
-#define KERNEL_QUICKMAP_PAGE_A (KERNEL_VIRTUAL_HEAP_BEGIN - PAGE_SIZE)
-#define KERNEL_QUICKMAP_PAGE_B (KERNEL_VIRTUAL_HEAP_BEGIN - (PAGE_SIZE * 2))
+#define KERNEL_QUICKMAP_PAGES 32
+#define KERNEL_QUICKMAP_BEGIN (KERNEL_VIRTUAL_HEAP_BEGIN - PAGE_SIZE * KERNEL_QUICKMAP_PAGES)
+#define DMA_ZONE_END 0x1000000
 
 // For disambiguating parameter meanings.
 typedef size_t PageIndex;
 typedef size_t PhysicalAddress;
 typedef size_t VirtualAddress;
 
+/**
+ * The zones physical memory is split into. Allocations from a zone fall back to the zones below it when it runs out,
+ * but never to the ones above it. There's no zone for memory above 4GiB, since we don't use it.
+ */
+enum class PhysicalZone {
+	DMA = 0, ///< The first 16MiB, for devices that can't address any more (like ISA DMA).
+	Normal = 1, ///< Everything else.
+};
+#define NUM_PHYSICAL_ZONES 2
+
 struct VirtualRange {
 public:
 	VirtualRange(VirtualAddress start, size_t size):
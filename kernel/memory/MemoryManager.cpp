@@ -26,9 +26,10 @@
 #include <kernel/multiboot.h>
 #include "AnonymousVMObject.h"
 #include <kernel/interrupt/isr.h>
-#include <kernel/device/DiskDevice.h>
 #include <kernel/tasking/Thread.h>
+#include <kernel/Trace.h>
 #include <kernel/tasking/TaskManager.h>
+#include <kernel/tasking/Processor.h>
 #include <kernel/kstd/KLog.h>
 
 size_t usable_bytes_ram = 0;
@@ -51,7 +52,7 @@ kstd::Arc<VMRegion> kernel_data_region;
 kstd::Arc<VMRegion> physical_pages_region;
 
 MemoryManager::MemoryManager():
-	m_kernel_space(kstd::Arc<VMSpace>::make(HIGHER_HALF, KERNEL_VIRTUAL_HEAP_BEGIN - HIGHER_HALF - PAGE_SIZE * 2, kernel_page_directory)),
+	m_kernel_space(kstd::Arc<VMSpace>::make(HIGHER_HALF, KERNEL_QUICKMAP_BEGIN - HIGHER_HALF, kernel_page_directory)),
 	m_heap_space(kstd::Arc<VMSpace>::make(KERNEL_VIRTUAL_HEAP_BEGIN, ~0x0 - KERNEL_VIRTUAL_HEAP_BEGIN + 1 - PAGE_SIZE, kernel_page_directory))
 {
 	if(_inst)
@@ -71,8 +72,12 @@ void MemoryManager::setup_paging() {
 	size_t num_physical_pages = mem_upper_limit / PAGE_SIZE;
 	size_t page_array_num_pages = kstd::ceil_div(num_physical_pages * sizeof(PhysicalPage), PAGE_SIZE);
 	size_t page_array_start_page = 0;
-	for(size_t i = 0; i < m_physical_regions.size(); i++) {
+	for(size_t attempt = 0; attempt < m_physical_regions.size() * 2; attempt++) {
+		// Try to keep it out of the DMA zone first
+		size_t i = attempt % m_physical_regions.size();
 		auto& region = m_physical_regions[i];
+		if(attempt < m_physical_regions.size() && region->zone() == PhysicalZone::DMA)
+			continue;
 		if(region->reserved() || region->num_pages() != region->free_pages() || region->free_pages() < page_array_num_pages)
 			continue;
 
@@ -114,6 +119,10 @@ void MemoryManager::setup_paging() {
 	for(size_t i = 0; i < m_physical_regions.size(); i++)
 		m_physical_regions[i]->init();
 
+	// Keep some of each zone for the allocations that can only use it
+	for(int zone = 0; zone < NUM_PHYSICAL_ZONES; zone++)
+		m_zone_reserve[zone] = zone_pages((PhysicalZone) zone) / PHYSICAL_ZONE_RESERVE_DIVISOR;
+
 	// Now that we're all set up to use normal methods of mapping stuff, map the kernel and physical pages again
 	auto do_map = [&]() -> Result {
 		auto kernel_text_object = TRY(AnonymousVMObject::map_to_physical(KERNEL_TEXT - HIGHER_HALF, KERNEL_TEXT_SIZE));
@@ -133,6 +142,14 @@ void MemoryManager::setup_paging() {
 	ASSERT(map_res.is_success());
 
 	did_setup_paging = true;
+
+	// The zero page is reserved so it's never freed, and its count is kept above one so it always looks shared
+	auto zero_page_res = alloc_physical_page(true);
+	if(zero_page_res.is_error())
+		PANIC("ZERO_PAGE_NOMEM", "Could not allocate the zero page.");
+	m_zero_page = zero_page_res.value();
+	get_physical_page(m_zero_page).allocated.ref_count = 2;
+	get_physical_page(m_zero_page).allocated.reserved = true;
 }
 
 void MemoryManager::load_page_directory(const kstd::Arc<PageDirectory>& page_directory) {
@@ -151,6 +168,7 @@ void MemoryManager::page_fault_handler(struct Registers *r) {
 	TaskManager::ScopedCritical critical;
 	uint32_t err_pos;
 	asm volatile ("mov %%cr2, %0" : "=r" (err_pos));
+	TRACE(TRACE_PAGE_FAULT, err_pos, r->err_code, r->eip);
 	switch (r->err_code) {
 		case FAULT_KERNEL_READ:
 			PANIC("KRNL_READ_NONPAGED_AREA", "0x%x", err_pos);
@@ -186,11 +204,11 @@ void MemoryManager::parse_mboot_memory_map(struct multiboot_info* header, struct
 		uint32_t addr_pagealigned = ((addr + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
 		uint32_t size_pagealigned = ((size - (addr_pagealigned - addr)) / PAGE_SIZE) * PAGE_SIZE;
 
-		// We don't want the zero page.
-		if(addr_pagealigned == 0) {
-			addr_pagealigned += PAGE_SIZE;
-			if(size_pagealigned)
-				size_pagealigned -= PAGE_SIZE;
+		// We don't want the zero page, and the page after it is where application processors start.
+		if(addr_pagealigned < AP_TRAMPOLINE_ADDR + PAGE_SIZE) {
+			uint32_t skip = min((uint32_t) (AP_TRAMPOLINE_ADDR + PAGE_SIZE - addr_pagealigned), size_pagealigned);
+			addr_pagealigned += skip;
+			size_pagealigned -= skip;
 		}
 
 		if(size_pagealigned / PAGE_SIZE < 2) {
@@ -232,6 +250,16 @@ void MemoryManager::parse_mboot_memory_map(struct multiboot_info* header, struct
 		KLog::dbg("Memory", "Adding memory region at page 0x%x of 0x%x pages (%s, %s)", region->start_page(), region->num_pages(), !region->free_pages() ? "Used" : "Unused", region->reserved() ? "Reserved" : "Unreserved");
 	};
 
+	// Split regions that cross out of the DMA zone, so that each region is in one zone
+	auto make_zoned_region = [&](size_t addr, size_t size, bool reserved, bool used) {
+		if(addr < DMA_ZONE_END && size > DMA_ZONE_END - addr) {
+			make_region(addr, DMA_ZONE_END - addr, reserved, used);
+			make_region(DMA_ZONE_END, size - (DMA_ZONE_END - addr), reserved, used);
+		} else {
+			make_region(addr, size, reserved, used);
+		}
+	};
+
 	while(mmap_offset < header->mmap_length) {
 		if(mmap_entry->addr_high || mmap_entry->len_high) {
 			//If the entry is in extended memory, ignore it
@@ -247,20 +275,20 @@ void MemoryManager::parse_mboot_memory_map(struct multiboot_info* header, struct
 				KLog::dbg("Memory", "Kernel is from pages 0x%x --> 0x%x", (KERNEL_TEXT - HIGHER_HALF) / PAGE_SIZE, (KERNEL_DATA_END - HIGHER_HALF) / PAGE_SIZE - 1);
 				if(addr < KERNEL_TEXT - HIGHER_HALF) {
 					// Space in region before kernel
-					make_region(addr,
+					make_zoned_region(addr,
 								KERNEL_TEXT - addr,
 								mmap_entry->type == MULTIBOOT_MEMORY_RESERVED,
 								mmap_entry->type != MULTIBOOT_MEMORY_AVAILABLE);
 				}
 				if(end > KERNEL_DATA_END - HIGHER_HALF) {
 					// Space in region after kernel
-					make_region(KERNEL_DATA_END - HIGHER_HALF,
+					make_zoned_region(KERNEL_DATA_END - HIGHER_HALF,
 								end - (KERNEL_DATA_END - HIGHER_HALF),
 								mmap_entry->type == MULTIBOOT_MEMORY_RESERVED,
 								mmap_entry->type != MULTIBOOT_MEMORY_AVAILABLE);
 				}
 			} else {
-				make_region(addr,
+				make_zoned_region(addr,
 							size,
 							mmap_entry->type == MULTIBOOT_MEMORY_RESERVED,
 							mmap_entry->type != MULTIBOOT_MEMORY_AVAILABLE);
@@ -274,56 +302,130 @@ void MemoryManager::parse_mboot_memory_map(struct multiboot_info* header, struct
 	KLog::dbg("Memory", "Total memory limits: 0x%x -> 0x%x", mem_lower_limit, mem_upper_limit);
 }
 
-ResultRet<PageIndex> MemoryManager::alloc_physical_page() const {
-	for(size_t i = 0; i < m_physical_regions.size(); i++) {
-		auto result = m_physical_regions[i]->alloc_page();
-		if(!result.is_error()) {
-			PageIndex ret = result.value();
-			// Set the refcount of the page to 1
-			auto& page = get_physical_page(ret);
-			page.allocated.ref_count = 1;
-			page.allocated.reserved = false;
-			return ret;
-		}
+ResultRet<PageIndex> MemoryManager::alloc_physical_page(bool zeroed, PhysicalZone zone) const {
+	// Pages in the zeroed pool could be from any zone
+	if(zeroed && zone == PhysicalZone::Normal) {
+		auto page = take_zeroed_page();
+		if(page)
+			return page;
+	}
+
+	auto result = alloc_physical_page_internal(zone);
+	if(!result.is_error()) {
+		check_watermarks();
+		if(zeroed)
+			MM.with_quickmapped(result.value(), [](void* ptr) {
+				memset(ptr, 0, PAGE_SIZE);
+			});
+		return result.value();
+	}
+
+	// We couldn't allocate any physical pages. Use one of the zeroed pages if there are any left.
+	if(zone == PhysicalZone::Normal) {
+		auto page = take_zeroed_page();
+		if(page)
+			return page;
 	}
 
-	// We couldn't allocate any physical pages. Try freeing four for good measure.
-	if(DiskDevice::free_pages(4) >= 1)
-		return alloc_physical_page();
+	// Otherwise, try reclaiming four for good measure.
+	if(reclaim_for_allocation(4))
+		return alloc_physical_page(zeroed, zone);
+
+	// Running out of a lower zone is left to the caller to deal with, since there's still memory elsewhere.
+	if(zone != PhysicalZone::Normal)
+		return Result(ENOMEM);
 
 	// No more pages. This is bad.
 	PANIC("NO_MEM", "The system ran out of physical memory.");
 }
 
-ResultRet<kstd::vector<PageIndex>> MemoryManager::alloc_physical_pages(size_t num_pages) const {
-	// If we already know we won't have enough free memory, try freeing twice as many up in the disk cache first
-	if((usable_bytes_ram - used_pmem()) / PAGE_SIZE < num_pages)
-		DiskDevice::free_pages(num_pages * 2);
+ResultRet<PageIndex> MemoryManager::alloc_physical_page_internal(PhysicalZone zone) const {
+	for(int from_zone = (int) zone; from_zone >= 0; from_zone--) {
+		if(!can_alloc_from_zone(zone, (PhysicalZone) from_zone, 1))
+			continue;
+		for(size_t i = 0; i < m_physical_regions.size(); i++) {
+			if(m_physical_regions[i]->zone() != (PhysicalZone) from_zone)
+				continue;
+			auto result = m_physical_regions[i]->alloc_page();
+			if(!result.is_error()) {
+				PageIndex ret = result.value();
+				// Set the refcount of the page to 1
+				auto& page = get_physical_page(ret);
+				page.allocated.ref_count = 1;
+				page.allocated.reserved = false;
+				return ret;
+			}
+		}
+	}
+	return Result(ENOMEM);
+}
+
+bool MemoryManager::can_alloc_from_zone(PhysicalZone alloc_zone, PhysicalZone from_zone, size_t num_pages) const {
+	// Falling back to a lower zone is fine as long as it leaves enough for the allocations that need it
+	return alloc_zone == from_zone || zone_free_pages(from_zone) >= m_zone_reserve[(int) from_zone] + num_pages;
+}
+
+PageIndex MemoryManager::take_zeroed_page() const {
+	LOCK(m_zeroed_lock);
+	if(!m_num_zeroed_pages)
+		return 0;
+	auto page = m_zeroed_pages[--m_num_zeroed_pages];
+	get_physical_page(page).allocated.ref_count = 1;
+	return page;
+}
+
+ResultRet<kstd::vector<PageIndex>> MemoryManager::alloc_physical_pages(size_t num_pages, bool zeroed, PhysicalZone zone) const {
+	// If we already know we won't have enough free memory, try reclaiming twice as many first
+	if(num_free_pages() < num_pages)
+		reclaim_for_allocation(num_pages * 2);
 
 	auto new_pages = kstd::vector<PageIndex>();
 	new_pages.reserve(num_pages);
 	while(num_pages--)
-		new_pages.push_back(TRY(MemoryManager::inst().alloc_physical_page()));
+		new_pages.push_back(TRY(MemoryManager::inst().alloc_physical_page(zeroed, zone)));
 	return new_pages;
 }
 
-ResultRet<kstd::vector<PageIndex>> MemoryManager::alloc_contiguous_physical_pages(size_t num_pages) const {
-	for(size_t i = 0; i < m_physical_regions.size(); i++) {
-		auto result = m_physical_regions[i]->alloc_pages(num_pages);
-		if(!result.is_error()) {
-			PageIndex first_page = result.value();
-			kstd::vector<PageIndex> ret;
-			ret.reserve(num_pages);
-			for(size_t page_index = 0; page_index < num_pages; page_index++) {
-				auto& page = get_physical_page(first_page + page_index);
-				page.allocated.ref_count = 1;
-				page.allocated.reserved = false;
-				ret.push_back(first_page + page_index);
+ResultRet<kstd::vector<PageIndex>> MemoryManager::alloc_contiguous_physical_pages(size_t num_pages, PhysicalZone zone) const {
+	auto order = BuddyZone::order_for(num_pages);
+	if(order > BuddyZone::MAX_ORDER)
+		return Result(EINVAL);
+
+	// Reclaimed pages won't necessarily be contiguous, but it's worth another try after reclaiming some. If that
+	// doesn't work, the free pages are probably too spread out, so try moving some out of the way.
+	for(int attempt = 0; attempt < 3; attempt++) {
+		if(attempt == 1 && !reclaim_for_allocation(num_pages))
+			continue;
+		if(attempt == 2 && !compact_for_allocation(order))
+			break;
+
+		for(size_t i = 0; i < m_physical_regions.size() * NUM_PHYSICAL_ZONES; i++) {
+			// Go through the regions in each zone from the highest allowed one down
+			auto from_zone = (PhysicalZone) ((int) zone - (int) (i / m_physical_regions.size()));
+			auto region = m_physical_regions[i % m_physical_regions.size()];
+			if((int) from_zone < 0 || region->zone() != from_zone || !can_alloc_from_zone(zone, from_zone, num_pages))
+				continue;
+			auto result = region->alloc_pages(num_pages);
+			if(!result.is_error()) {
+				PageIndex first_page = result.value();
+				kstd::vector<PageIndex> ret;
+				ret.reserve(num_pages);
+				for(size_t page_index = 0; page_index < num_pages; page_index++) {
+					auto& page = get_physical_page(first_page + page_index);
+					page.allocated.ref_count = 1;
+					page.allocated.reserved = false;
+					ret.push_back(first_page + page_index);
+				}
+				return ret;
 			}
-			return ret;
 		}
 	}
 
+	// Have the reclaim thread try compacting for the biggest order that failed, so the next try might work
+	m_failed_allocations[order].add(1);
+	if(order > m_compact_order.load())
+		m_compact_order.store(order);
+	m_reclaim_blocker.set_ready(true);
 	return Result(ENOMEM);
 }
 
@@ -338,9 +440,9 @@ kstd::Arc<VMRegion> MemoryManager::alloc_kernel_region(size_t size) {
 	return res.value();
 }
 
-kstd::Arc<VMRegion> MemoryManager::alloc_dma_region(size_t size) {
+kstd::Arc<VMRegion> MemoryManager::alloc_dma_region(size_t size, PhysicalZone zone) {
 	auto do_alloc = [&]() -> ResultRet<kstd::Arc<VMRegion>> {
-		auto object = TRY(AnonymousVMObject::alloc_contiguous(size));
+		auto object = TRY(AnonymousVMObject::alloc_contiguous(size, zone));
 		return TRY(m_kernel_space->map_object(object, VMProt::RW));
 	};
 	auto res = do_alloc();
@@ -367,12 +469,274 @@ kstd::Arc<VMRegion> MemoryManager::map_object(kstd::Arc<VMObject> object, Virtua
 	return res.value();
 }
 
+bool MemoryManager::fill_zeroed_pool(size_t max_pages) {
+	size_t num_filled = 0;
+	while(num_filled < max_pages) {
+		{
+			LOCK(m_zeroed_lock);
+			if(m_num_zeroed_pages >= ZEROED_PAGE_POOL_SIZE)
+				break;
+		}
+
+		// Don't take pages for the pool if memory is getting tight
+		if((usable_bytes_ram - used_pmem()) / PAGE_SIZE < ZEROED_PAGE_POOL_MIN_FREE)
+			break;
+
+		auto page_res = alloc_physical_page_internal();
+		if(page_res.is_error())
+			break;
+		auto page = page_res.value();
+
+		with_quickmapped(page, [](void* ptr) {
+			memzero_page_nontemporal(ptr);
+		});
+
+		get_physical_page(page).allocated.ref_count = 0;
+		LOCK(m_zeroed_lock);
+		if(m_num_zeroed_pages >= ZEROED_PAGE_POOL_SIZE) {
+			// Someone else filled the pool in the meantime
+			free_physical_page(page);
+			break;
+		}
+		m_zeroed_pages[m_num_zeroed_pages++] = page;
+		num_filled++;
+	}
+	return num_filled;
+}
+
+void MemoryManager::register_shrinker(Shrinker* shrinker) {
+	LOCK(m_shrinkers_lock);
+	m_shrinkers.push_back(shrinker);
+}
+
+void MemoryManager::unregister_shrinker(Shrinker* shrinker) {
+	LOCK(m_shrinkers_lock);
+	for(size_t i = 0; i < m_shrinkers.size(); i++) {
+		if(m_shrinkers[i] == shrinker) {
+			m_shrinkers.erase(i);
+			return;
+		}
+	}
+}
+
+size_t MemoryManager::reclaim(size_t num_pages) {
+	LOCK(m_shrinkers_lock);
+	uint64_t total_reclaimable = 0;
+	for(auto shrinker : m_shrinkers)
+		total_reclaimable += shrinker->reclaimable_pages();
+	if(!total_reclaimable)
+		return 0;
+
+	// Ask each shrinker for its share first, so that no one cache gets emptied while the others stay full
+	size_t num_freed = 0;
+	for(auto shrinker : m_shrinkers) {
+		if(num_freed >= num_pages)
+			return num_freed;
+		size_t share = kstd::ceil_div((uint64_t) num_pages * shrinker->reclaimable_pages(), total_reclaimable);
+		if(share)
+			num_freed += shrinker->shrink(min(share, num_pages - num_freed));
+	}
+
+	// Then take whatever's left from whoever can still give it
+	for(auto shrinker : m_shrinkers) {
+		if(num_freed >= num_pages)
+			break;
+		num_freed += shrinker->shrink(num_pages - num_freed);
+	}
+
+	return num_freed;
+}
+
+size_t MemoryManager::reclaim_for_allocation(size_t num_pages) const {
+	// Shrinkers free heap memory, so they can't run from an allocation made by the heap itself. The reclaim thread
+	// should keep enough memory free that this doesn't matter. Shrinkers also can't set off another reclaim themselves.
+	if(MM.liballoc_spinlock.held_by_current_thread() || MM.m_shrinkers_lock.held_by_current_thread())
+		return 0;
+	return MM.reclaim(num_pages);
+}
+
+bool MemoryManager::compact_for_allocation(unsigned int order) const {
+	// Compaction allocates, and moves pages that the shrinkers might be looking at
+	if(MM.liballoc_spinlock.held_by_current_thread() || MM.m_shrinkers_lock.held_by_current_thread() || MM.m_compact_lock.held_by_current_thread())
+		return false;
+	return MM.compact(order);
+}
+
+bool MemoryManager::has_free_block(unsigned int order) const {
+	size_t counts[BuddyZone::MAX_ORDER + 1] = {};
+	for(auto region : m_physical_regions)
+		region->count_free_blocks(counts);
+	for(; order <= BuddyZone::MAX_ORDER; order++) {
+		if(counts[order])
+			return true;
+	}
+	return false;
+}
+
+bool MemoryManager::compact(unsigned int order) {
+	LOCK(m_compact_lock);
+	if(has_free_block(order))
+		return true;
+
+	// Moving pages needs free pages to move them to, so don't take what little might be left
+	size_t block_size = BuddyZone::size_of_order(order);
+	if(num_free_pages() < block_size + m_low_watermark)
+		return false;
+	m_num_compactions++;
+
+	// Find out which pages are free and which can be moved
+	size_t num_physical_pages = mem_upper_limit / PAGE_SIZE + 1;
+	kstd::Bitmap free_pages(num_physical_pages);
+	kstd::Bitmap movable_pages(num_physical_pages);
+	for(auto region : m_physical_regions)
+		region->mark_free_pages(free_pages);
+	AnonymousVMObject::mark_movable_pages(movable_pages);
+
+	// Find the block that has nothing unmovable in it, and the fewest pages to move
+	PageIndex target = 0;
+	size_t target_movable = block_size + 1;
+	for(auto region : m_physical_regions) {
+		for(auto zone : region->m_zones) {
+			if(zone->highest_order() < order)
+				continue;
+			for(PageIndex block = zone->first_page(); block < zone->first_page() + zone->num_pages(); block += block_size) {
+				size_t num_movable = 0;
+				for(PageIndex page = block; page < block + block_size && num_movable < target_movable; page++) {
+					if(free_pages.get(page))
+						continue;
+					num_movable = movable_pages.get(page) ? num_movable + 1 : target_movable;
+				}
+				if(num_movable < target_movable) {
+					target = block;
+					target_movable = num_movable;
+				}
+			}
+		}
+	}
+	if(!target)
+		return false;
+
+	// Get pages to move them to. Pages that come out of the block itself are held onto until we're done, so that they
+	// don't get handed out to anyone else in the meantime.
+	kstd::vector<PageIndex> new_pages;
+	kstd::vector<PageIndex> held_pages;
+	new_pages.reserve(target_movable);
+	while(new_pages.size() < target_movable) {
+		auto page_res = alloc_physical_page_internal();
+		if(page_res.is_error())
+			break;
+		auto page = page_res.value();
+		if(page >= target && page < target + block_size)
+			held_pages.push_back(page);
+		else
+			new_pages.push_back(page);
+	}
+
+	m_num_migrated_pages += AnonymousVMObject::migrate_pages(target, block_size, new_pages);
+	for(auto page : new_pages)
+		get_physical_page(page).unref();
+	for(auto page : held_pages)
+		get_physical_page(page).unref();
+
+	return has_free_block(order);
+}
+
+size_t MemoryManager::zone_pages(PhysicalZone zone) const {
+	size_t num_pages = 0;
+	for(auto region : m_physical_regions) {
+		if(!region->reserved() && region->zone() == zone)
+			num_pages += region->num_pages();
+	}
+	return num_pages;
+}
+
+size_t MemoryManager::zone_free_pages(PhysicalZone zone) const {
+	size_t num_pages = 0;
+	for(auto region : m_physical_regions) {
+		if(!region->reserved() && region->zone() == zone)
+			num_pages += region->free_pages();
+	}
+	return num_pages;
+}
+
+MemoryManager::BuddyStats MemoryManager::buddy_stats() const {
+	BuddyStats stats = {};
+	for(auto region : m_physical_regions)
+		region->count_free_blocks(stats.free_blocks);
+	for(size_t order = 0; order <= BuddyZone::MAX_ORDER; order++)
+		stats.failed_allocations[order] = m_failed_allocations[order].load();
+	stats.num_compactions = m_num_compactions;
+	stats.num_migrated_pages = m_num_migrated_pages;
+	return stats;
+}
+
+void MemoryManager::check_watermarks() const {
+	if(m_low_watermark && !m_reclaim_blocker.is_ready() && num_free_pages() < m_low_watermark)
+		m_reclaim_blocker.set_ready(true);
+}
+
+void kreclaim_entry() {
+	MM.reclaim_thread();
+}
+
+void MemoryManager::reclaim_thread() {
+	size_t usable_pages = usable_bytes_ram / PAGE_SIZE;
+	m_high_watermark = max(usable_pages / RECLAIM_HIGH_WATERMARK_DIVISOR, (size_t) RECLAIM_WATERMARK_MIN_PAGES * 2);
+	m_low_watermark = max(usable_pages / RECLAIM_LOW_WATERMARK_DIVISOR, (size_t) RECLAIM_WATERMARK_MIN_PAGES);
+	KLog::dbg("Memory", "Reclaiming memory when less than %d pages are free (until %d are)", m_low_watermark, m_high_watermark);
+
+	while(1) {
+		// Clear the blocker before checking so that a wakeup while we're reclaiming isn't missed
+		m_reclaim_blocker.set_ready(false);
+		size_t free_pages = num_free_pages();
+		while(free_pages < m_high_watermark) {
+			if(!reclaim(m_high_watermark - free_pages))
+				break;
+			free_pages = num_free_pages();
+		}
+
+		// If a contiguous allocation failed, try to make a block big enough for the next one
+		auto compact_order = m_compact_order.load();
+		if(compact_order) {
+			m_compact_order.store(0);
+			compact(compact_order);
+		}
+		TaskManager::current_thread()->block(m_reclaim_blocker);
+	}
+}
+
 void MemoryManager::copy_page(PageIndex src, PageIndex dest) {
 	MM.with_dual_quickmapped(src, dest, [](void* src_ptr, void* dest_ptr) {
-		memcpy_uint32((uint32_t*) dest_ptr, (uint32_t*) src_ptr, PAGE_SIZE / sizeof(uint32_t));
+		memcpy_page(dest_ptr, src_ptr);
 	});
 }
 
+size_t MemoryManager::acquire_quickmap_slots(size_t num_pages) {
+	ASSERT(num_pages && num_pages <= KERNEL_QUICKMAP_PAGES);
+	uint32_t mask = num_pages == 32 ? 0xFFFFFFFF : (1u << num_pages) - 1;
+	while(true) {
+		auto slots = m_quickmap_slots.load();
+		size_t slot = 0;
+		while(slot + num_pages <= KERNEL_QUICKMAP_PAGES && (slots & (mask << slot)))
+			slot++;
+
+		// If there isn't a free run of slots big enough, wait for someone to release theirs
+		if(slot + num_pages > KERNEL_QUICKMAP_PAGES) {
+			TaskManager::yield();
+			continue;
+		}
+
+		// If this fails, someone claimed or released a slot in the meantime, so try again
+		if(m_quickmap_slots.compare_exchange_strong(slots, slots | (mask << slot)))
+			return slot;
+	}
+}
+
+void MemoryManager::release_quickmap_slots(size_t slot, size_t num_pages) {
+	uint32_t mask = num_pages == 32 ? 0xFFFFFFFF : (1u << num_pages) - 1;
+	m_quickmap_slots.bit_and(~(mask << slot));
+}
+
 void MemoryManager::free_physical_page(PageIndex page) const {
 	ASSERT(get_physical_page(page).allocated.ref_count.load(MemoryOrder::Relaxed) == 0);
 
@@ -400,13 +764,15 @@ ResultRet<VirtualAddress> MemoryManager::alloc_heap_pages(size_t num_pages) {
 
 	// Map the pages into kernel space.
 	size_t start_vpage = m_last_heap_loc / PAGE_SIZE;
+	TLBFlush flush;
 	for(size_t i = 0; i < num_pages; i++) {
 		kernel_page_directory.map_page(start_vpage + i, m_heap_pages[i], VMProt{
 			.read = true,
 			.write = true,
 			.execute = false
-		});
+		}, &flush);
 	}
+	flush.flush();
 
 	// Zero them out and return the address.
 	memset((void*) m_last_heap_loc, 0, num_pages * PAGE_SIZE);
@@ -449,6 +815,10 @@ size_t MemoryManager::used_pmem() const {
 	return used_pages * PAGE_SIZE;
 }
 
+size_t MemoryManager::num_free_pages() const {
+	return (usable_bytes_ram - used_pmem()) / PAGE_SIZE + m_num_zeroed_pages;
+}
+
 size_t MemoryManager::reserved_pmem() const {
 	return reserved_bytes_ram;
 }
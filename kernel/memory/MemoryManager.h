@@ -29,6 +29,24 @@
 #include "VMSpace.h"
 #include <kernel/tasking/SpinLock.h>
 #include "Memory.h"
+#include "TLBFlush.h"
+#include "Shrinker.h"
+#include <kernel/tasking/BooleanBlocker.h>
+
+// The number of pre-zeroed pages the idle thread tries to keep around, and how many pages have to be free for it to
+// take more for the pool.
+#define ZEROED_PAGE_POOL_SIZE 256
+#define ZEROED_PAGE_POOL_MIN_FREE (ZEROED_PAGE_POOL_SIZE * 4)
+
+// The reclaim thread is woken up when less than 1/RECLAIM_LOW_WATERMARK_DIVISOR of usable memory is free, and frees
+// memory until at least 1/RECLAIM_HIGH_WATERMARK_DIVISOR is free again.
+#define RECLAIM_LOW_WATERMARK_DIVISOR 64
+#define RECLAIM_HIGH_WATERMARK_DIVISOR 32
+#define RECLAIM_WATERMARK_MIN_PAGES 64
+
+// Allocations that fall back to a lower zone leave at least 1/PHYSICAL_ZONE_RESERVE_DIVISOR of it free for the ones that
+// actually need it.
+#define PHYSICAL_ZONE_RESERVE_DIVISOR 4
 
 /**
  * The basic premise of how the memory allocation in duckOS is as follows:
@@ -103,14 +121,19 @@ public:
 		return m_physical_pages[page_number];
 	}
 
-	/** Allocates a physical page for use. The resulting page will have a refcount of 1. **/
-	ResultRet<PageIndex> alloc_physical_page() const;
+	/**
+	 * Allocates a physical page for use. The resulting page will have a refcount of 1.
+	 * @param zeroed Whether the page should be zeroed. If it should, it's taken from the pool of pre-zeroed pages if any
+	 *               are available.
+	 * @param zone The highest zone the page may come from.
+	 */
+	ResultRet<PageIndex> alloc_physical_page(bool zeroed = false, PhysicalZone zone = PhysicalZone::Normal) const;
 
 	/** Allocates non-contiguous physical pages for use. The resulting pages will have a refcount of 1. **/
-	ResultRet<kstd::vector<PageIndex>> alloc_physical_pages(size_t num_pages) const;
+	ResultRet<kstd::vector<PageIndex>> alloc_physical_pages(size_t num_pages, bool zeroed = false, PhysicalZone zone = PhysicalZone::Normal) const;
 
 	/** Allocates contiguous physical pages for use. The resulting pages will have a refcount of 1. **/
-	ResultRet<kstd::vector<PageIndex>> alloc_contiguous_physical_pages(size_t num_pages) const;
+	ResultRet<kstd::vector<PageIndex>> alloc_contiguous_physical_pages(size_t num_pages, PhysicalZone zone = PhysicalZone::Normal) const;
 
 	/**
 	 * Allocates a new non-contiguous anonymous region in kernel space.
@@ -121,8 +144,10 @@ public:
 	/**
 	 * Allocates a new contiguous anonymous region in kernel space.
 	 * @param size The minimum size, in bytes, of the new region.
+	 * @param zone The highest zone the region's memory may come from. Devices that can address every page we use
+	 *             don't need anything below the normal zone.
 	 */
-	kstd::Arc<VMRegion> alloc_dma_region(size_t size);
+	kstd::Arc<VMRegion> alloc_dma_region(size_t size, PhysicalZone zone = PhysicalZone::Normal);
 
 	/**
 	 * Allocates a new virtual region in kernel space that is mapped to an existing range of physical pages.
@@ -146,13 +171,9 @@ public:
 	 */
 	template<typename F>
 	void with_quickmapped(PageIndex page, F&& callback) {
-		LOCK(m_quickmap_lock);
-		ASSERT(!m_is_quickmapping);
-		m_is_quickmapping = true;
-		kernel_page_directory.map_page(KERNEL_QUICKMAP_PAGE_A / PAGE_SIZE, page, VMProt::RW);
-		callback((void*) KERNEL_QUICKMAP_PAGE_A);
-		kernel_page_directory.unmap_page(KERNEL_QUICKMAP_PAGE_A / PAGE_SIZE);
-		m_is_quickmapping = false;
+		with_quickmapped_pages(&page, 1, [&](void* ptr) {
+			callback(ptr);
+		});
 	}
 
 	/**
@@ -163,20 +184,96 @@ public:
 	 */
 	template<typename F>
 	void with_dual_quickmapped(PageIndex page_a, PageIndex page_b, F&& callback) {
-		LOCK(m_quickmap_lock);
-		ASSERT(!m_is_quickmapping);
-		m_is_quickmapping = true;
-		kernel_page_directory.map_page(KERNEL_QUICKMAP_PAGE_A / PAGE_SIZE, page_a, VMProt::RW);
-		kernel_page_directory.map_page(KERNEL_QUICKMAP_PAGE_B / PAGE_SIZE, page_b, VMProt::RW);
-		callback((void*) KERNEL_QUICKMAP_PAGE_A, (void*) KERNEL_QUICKMAP_PAGE_B);
-		kernel_page_directory.unmap_page(KERNEL_QUICKMAP_PAGE_A / PAGE_SIZE);
-		kernel_page_directory.unmap_page(KERNEL_QUICKMAP_PAGE_B / PAGE_SIZE);
-		m_is_quickmapping = false;
+		PageIndex pages[2] = {page_a, page_b};
+		with_quickmapped_pages(pages, 2, [&](void* ptr) {
+			callback(ptr, (void*) ((uint8_t*) ptr + PAGE_SIZE));
+		});
+	}
+
+	/**
+	 * Temporarily maps physical pages into a contiguous range of memory and calls a function with them mapped.
+	 * Each call gets its own quickmap slots, so the callback may block and other threads can quickmap at the same time.
+	 * @param pages The physical pages to map.
+	 * @param num_pages The number of pages to map. Must be at most KERNEL_QUICKMAP_PAGES.
+	 * @param callback A callback that takes a void* pointer to the mapped memory of the first page.
+	 */
+	template<typename F>
+	void with_quickmapped_pages(const PageIndex* pages, size_t num_pages, F&& callback) {
+		size_t slot = acquire_quickmap_slots(num_pages);
+		VirtualAddress vaddr = KERNEL_QUICKMAP_BEGIN + slot * PAGE_SIZE;
+		TLBFlush flush;
+		for(size_t i = 0; i < num_pages; i++)
+			kernel_page_directory.map_page(vaddr / PAGE_SIZE + i, pages[i], VMProt::RW, &flush);
+		flush.flush();
+		callback((void*) vaddr);
+		for(size_t i = 0; i < num_pages; i++)
+			kernel_page_directory.unmap_page(vaddr / PAGE_SIZE + i, &flush);
+		flush.flush();
+		release_quickmap_slots(slot, num_pages);
 	}
 
+	/**
+	 * Zeroes free pages and adds them to the pool used by alloc_physical_page(true). Called by the idle thread.
+	 * @param max_pages The maximum number of pages to zero.
+	 * @return Whether any pages were added to the pool.
+	 */
+	bool fill_zeroed_pool(size_t max_pages);
+
+	/**
+	 * Registers a shrinker to be asked to free memory when the system is low on it.
+	 * @param shrinker The shrinker to register. Must be unregistered before it is destroyed.
+	 */
+	void register_shrinker(Shrinker* shrinker);
+	void unregister_shrinker(Shrinker* shrinker);
+
+	/**
+	 * Asks the registered shrinkers to free memory. Each shrinker is asked for a share of the pages proportional to
+	 * how much it says it can reclaim, and then any that are still left are asked for from whichever can give them.
+	 * @param num_pages The number of pages to try to free.
+	 * @return The number of pages that were freed.
+	 */
+	size_t reclaim(size_t num_pages);
+
+	/** Runs the reclaim thread. Called by kreclaim_entry(). **/
+	void reclaim_thread();
+
+	/**
+	 * Tries to make a free block of contiguous physical memory of at least the given order by moving movable pages out
+	 * of the block that needs the fewest of them moved.
+	 * @param order The order of the block needed.
+	 * @return Whether there's a free block of at least that order afterwards.
+	 */
+	bool compact(unsigned int order);
+
+	/** Statistics about fragmentation of the physical page allocator. **/
+	struct BuddyStats {
+		size_t free_blocks[BuddyZone::MAX_ORDER + 1]; ///< The number of free blocks of each order.
+		size_t failed_allocations[BuddyZone::MAX_ORDER + 1]; ///< Contiguous allocations of each order that failed.
+		size_t num_compactions;
+		size_t num_migrated_pages; ///< The number of pages that have been moved during compaction.
+	};
+	BuddyStats buddy_stats() const;
+
+	/** The number of usable and free pages in a zone, not counting the zeroed pool. **/
+	size_t zone_pages(PhysicalZone zone) const;
+	size_t zone_free_pages(PhysicalZone zone) const;
+	/** The number of pages in a zone that allocations falling back from higher zones leave free. **/
+	size_t zone_reserve(PhysicalZone zone) const { return m_zone_reserve[(int) zone]; }
+
+	/** The number of free physical pages, including those in the zeroed pool. **/
+	size_t num_free_pages() const;
+	size_t low_watermark() const { return m_low_watermark; }
+	size_t high_watermark() const { return m_high_watermark; }
+
 	/** Copies the contents of one physical page to another. **/
 	void copy_page(PageIndex src, PageIndex dest);
 
+	/**
+	 * A page of zeroes that untouched anonymous memory is mapped to when it's read, so that reading it doesn't use any
+	 * memory. It's always mapped CoW, so it's never written to.
+	 */
+	PageIndex zero_page() const { return m_zero_page; }
+
 	kstd::Arc<VMSpace> kernel_space() { return m_kernel_space; }
 	kstd::Arc<VMSpace> heap_space() { return m_heap_space; }
 
@@ -230,14 +327,57 @@ private:
 	VirtualAddress m_last_heap_loc;
 
 	PhysicalPage* m_physical_pages;
+	PageIndex m_zero_page = 0;
 	kstd::vector<PhysicalRegion*> m_physical_regions;
+	size_t m_zone_reserve[NUM_PHYSICAL_ZONES] = {};
 	kstd::Arc<VMSpace> m_kernel_space;
 	kstd::Arc<VMSpace> m_heap_space;
 
-	SpinLock m_quickmap_lock;
-	bool m_is_quickmapping = false;
+	/// Allocates a page from the physical regions without falling back to the zeroed pool or the disk cache.
+	ResultRet<PageIndex> alloc_physical_page_internal(PhysicalZone zone = PhysicalZone::Normal) const;
+	/// Returns whether an allocation from a zone can take pages from another zone at or below it.
+	bool can_alloc_from_zone(PhysicalZone alloc_zone, PhysicalZone from_zone, size_t num_pages) const;
+	/// Takes a page out of the zeroed pool, or returns 0 if it's empty.
+	PageIndex take_zeroed_page() const;
+	/// Reclaims memory directly from an allocation that couldn't be satisfied, if it's safe to do so from here.
+	size_t reclaim_for_allocation(size_t num_pages) const;
+	/// Wakes the reclaim thread up if free memory has dropped below the low watermark.
+	void check_watermarks() const;
+	/// Compacts memory directly from a contiguous allocation that couldn't be satisfied, if it's safe to do so from here.
+	bool compact_for_allocation(unsigned int order) const;
+	/// Returns whether any physical region has a free block of at least the given order.
+	bool has_free_block(unsigned int order) const;
+
+	// Pages that have already been zeroed by the idle thread. These are allocated, but have a refcount of zero.
+	mutable SpinLock m_zeroed_lock;
+	mutable PageIndex m_zeroed_pages[ZEROED_PAGE_POOL_SIZE];
+	mutable size_t m_num_zeroed_pages = 0;
+
+	// Reclaim
+	SpinLock m_shrinkers_lock;
+	kstd::vector<Shrinker*> m_shrinkers;
+	mutable BooleanBlocker m_reclaim_blocker;
+	size_t m_low_watermark = 0; ///< Zero until the reclaim thread has started.
+	size_t m_high_watermark = 0;
+
+	// Compaction
+	SpinLock m_compact_lock;
+	mutable Atomic<unsigned int> m_compact_order = 0; ///< The order the reclaim thread should compact for, or zero.
+	mutable Atomic<size_t, MemoryOrder::Relaxed> m_failed_allocations[BuddyZone::MAX_ORDER + 1] = {};
+	size_t m_num_compactions = 0;
+	size_t m_num_migrated_pages = 0;
+
+	/// Claims a run of free quickmap slots and returns the index of the first one, waiting if there aren't enough.
+	size_t acquire_quickmap_slots(size_t num_pages);
+	void release_quickmap_slots(size_t slot, size_t num_pages);
+
+	// A bitmap of which quickmap slots are in use. These are shared between processors and claimed without a lock.
+	Atomic<uint32_t, MemoryOrder::AcqRel> m_quickmap_slots = 0;
+	static_assert(KERNEL_QUICKMAP_PAGES <= 32);
 };
 
+void kreclaim_entry();
+
 void liballoc_lock();
 void liballoc_unlock();
 void* liballoc_alloc(int);
@@ -23,6 +23,7 @@
 #include <kernel/kstd/defines.h>
 #include <kernel/Atomic.h>
 #include "PageTable.h"
+#include "TLBFlush.h"
 #include "MemoryManager.h"
 #include "kernel/kstd/KLog.h"
 #include "../KernelMapper.h"
@@ -39,6 +40,10 @@
 __attribute__((aligned(4096))) PageDirectory::Entry PageDirectory::s_kernel_entries[1024];
 PageTable PageDirectory::s_kernel_page_tables[256];
 __attribute__((aligned(4096))) PageTable::Entry s_kernel_page_table_entries[256][1024];
+SpinLock PageDirectory::s_user_directories_lock;
+PageDirectory* PageDirectory::s_user_directories = nullptr;
+
+#define CR4_PSE (1u << 4)
 
 /**
  * KERNEL MANAGEMENT
@@ -61,13 +66,8 @@ void PageDirectory::init_paging() {
 		s_kernel_entries[i].value = 0;
 
 	// Map the kernel page tables into the upper 1GiB of the page directory
-	for(auto i = 768; i < 1024; i++) {
-		s_kernel_entries[i].value = 0;
-		s_kernel_entries[i].data.present = true;
-		s_kernel_entries[i].data.read_write = true;
-		s_kernel_entries[i].data.user = false;
-		s_kernel_entries[i].data.set_address((size_t) s_kernel_page_tables[i - 768].entries() - HIGHER_HALF);
-	}
+	for(auto i = 768; i < 1024; i++)
+		reset_kernel_entry(i);
 
 	auto map_range = [&](VirtualAddress vstart, VirtualAddress pstart, size_t size, VMProt prot) {
 		size_t start_vpage = vstart / PAGE_SIZE;
@@ -84,7 +84,11 @@ void PageDirectory::init_paging() {
 
 	map_range(KERNEL_DATA, KERNEL_DATA - HIGHER_HALF, KERNEL_DATA_SIZE, VMProt::RW);
 
-	// Enable paging
+	// Enable paging (with 4MiB pages)
+
+	uint32_t cr4;
+	asm volatile("mov %%cr4, %0" : "=r"(cr4));
+	asm volatile("mov %0, %%cr4" :: "r"(cr4 | CR4_PSE));
 
 	asm volatile(
 		"movl %%eax, %%cr3\n" //Put the page directory pointer in cr3
@@ -95,6 +99,21 @@ void PageDirectory::init_paging() {
 	);
 }
 
+void PageDirectory::reset_kernel_entry(size_t directory_index) {
+	auto& entry = s_kernel_entries[directory_index];
+	entry.value = 0;
+	entry.data.present = true;
+	entry.data.read_write = true;
+	entry.data.user = false;
+	entry.data.set_address((size_t) s_kernel_page_tables[directory_index - 768].entries() - HIGHER_HALF);
+}
+
+void PageDirectory::sync_kernel_entry(size_t directory_index) {
+	LOCK(s_user_directories_lock);
+	for(auto* directory = s_user_directories; directory; directory = directory->m_next_user)
+		directory->m_entries[directory_index].value = s_kernel_entries[directory_index].value;
+}
+
 void PageDirectory::Entry::Data::set_address(size_t address) {
 	page_table_addr = address >> 12u;
 }
@@ -114,10 +133,16 @@ PageDirectory::PageDirectory(PageDirectory::DirectoryType type):
 	if(type == DirectoryType::USER) {
 		m_entries_region = MemoryManager::inst().alloc_kernel_region(sizeof(Entry) * 1024);
 		m_entries = (Entry*) m_entries_region->start();
-		// Map the kernel into the directory
+
+		// Map the kernel into the directory, and add it to the list to be kept in sync with the kernel's entries
+		LOCK(s_user_directories_lock);
 		for(auto i = 768; i < 1024; i++) {
 			m_entries[i].value = s_kernel_entries[i].value;
 		}
+		m_next_user = s_user_directories;
+		if(s_user_directories)
+			s_user_directories->m_prev_user = this;
+		s_user_directories = this;
 	} else {
 		m_entries = s_kernel_entries;
 	}
@@ -127,6 +152,16 @@ PageDirectory::~PageDirectory() {
 	if(m_type == DirectoryType::KERNEL)
 		PANIC("KERNEL_PAGETABLE_DELETED", "The kernel page directory was destroyed. Something has gone horribly wrong.");
 
+	{
+		LOCK(s_user_directories_lock);
+		if(m_prev_user)
+			m_prev_user->m_next_user = m_next_user;
+		else
+			s_user_directories = m_next_user;
+		if(m_next_user)
+			m_next_user->m_prev_user = m_prev_user;
+	}
+
 	//Free page tables
 	for(auto & table : m_page_tables)
 		delete table;
@@ -140,6 +175,23 @@ size_t PageDirectory::entries_physaddr() {
 	return get_physaddr((size_t) m_entries);
 }
 
+/**
+ * Checks whether the 4MiB block of an object starting at first_page can be mapped with one large page. It can if all of
+ * the pages are physically contiguous starting at a 4MiB boundary, and none of them are CoW.
+ */
+static bool can_map_large_page(VMObject& object, PageIndex first_page) {
+	if(first_page + PAGES_PER_LARGE_PAGE > object.size() / PAGE_SIZE)
+		return false;
+	PageIndex first_ppage = object.physical_page(first_page).index();
+	if(!first_ppage || first_ppage % PAGES_PER_LARGE_PAGE)
+		return false;
+	for(size_t i = 0; i < PAGES_PER_LARGE_PAGE; i++) {
+		if(object.physical_page(first_page + i).index() != first_ppage + i || object.page_is_cow(first_page + i))
+			return false;
+	}
+	return true;
+}
+
 void PageDirectory::map(VMRegion& region, VirtualRange range) {
 	LOCK(m_lock);
 
@@ -156,21 +208,41 @@ void PageDirectory::map(VMRegion& region, VirtualRange range) {
 	ASSERT(range.size % PAGE_SIZE == 0);
 	ASSERT(range.start + range.size <= region.end());
 
+	TLBFlush flush;
 	for(size_t page_index = start_index; page_index < end_index; page_index++) {
+		auto vpage = start_vpage + page_index;
+
+		// Use a large page if this is the start of a 4MiB block that's entirely in the range and can be mapped with one
+		if(vpage % PAGES_PER_LARGE_PAGE == 0 && end_index - page_index >= PAGES_PER_LARGE_PAGE &&
+			can_map_large_page(*region.object(), page_index + page_offset))
+		{
+			auto directory_index = vpage / PAGES_PER_LARGE_PAGE;
+			auto& entry = m_entries[directory_index];
+			size_t num_present = (entry.data.present && entry.data.size) ? PAGES_PER_LARGE_PAGE : m_page_tables_num_mapped[directory_index];
+			auto ppage = region.object()->physical_page(page_index + page_offset).index();
+			if(map_large_page(directory_index, ppage, prot).is_error())
+				return;
+			account_pages(region, PAGES_PER_LARGE_PAGE - num_present);
+			page_index += PAGES_PER_LARGE_PAGE - 1;
+			continue;
+		}
+
 		auto& page = region.object()->physical_page(page_index + page_offset);
 		if(!page.index())
 			continue;
 
-		auto vpage = start_vpage + page_index;
 		auto ppage = region.object()->physical_page(page_index + page_offset).index();
 		VMProt page_prot = {
 			.read = prot.read,
-			.write = region.object()->page_is_cow(page_index) ? false : prot.write,
+			.write = region.object()->page_is_cow(page_index + page_offset) ? false : prot.write,
 			.execute = prot.execute
 		};
 
-		if(map_page(vpage, ppage, page_prot).is_error())
+		bool was_present = page_present(vpage);
+		if(map_page(vpage, ppage, page_prot, &flush).is_error())
 			return;
+		if(!was_present)
+			account_pages(region, 1);
 	}
 }
 
@@ -193,13 +265,34 @@ void PageDirectory::unmap(VMRegion& region, VirtualRange range) {
 		return;
 	}
 
+	TLBFlush flush;
 	for(size_t page_index = start_index; page_index < end_index; page_index++) {
-		if(unmap_page(start_vpage + page_index).is_error())
+		auto vpage = start_vpage + page_index;
+		auto directory_index = vpage / PAGES_PER_LARGE_PAGE;
+
+		// If the whole of a large page is being unmapped, we don't need to split it up
+		if(vpage % PAGES_PER_LARGE_PAGE == 0 && end_index - page_index >= PAGES_PER_LARGE_PAGE &&
+			m_entries[directory_index].data.present && m_entries[directory_index].data.size)
+		{
+			unmap_large_page(directory_index);
+			account_pages(region, -PAGES_PER_LARGE_PAGE);
+			page_index += PAGES_PER_LARGE_PAGE - 1;
+			continue;
+		}
+
+		bool was_present = page_present(vpage);
+		if(unmap_page(vpage, &flush).is_error())
 			return;
+		if(was_present)
+			account_pages(region, -1);
 	}
 }
 
 size_t PageDirectory::get_physaddr(size_t virtaddr) {
+	size_t large_index = virtaddr / LARGE_PAGE_SIZE;
+	if(m_entries[large_index].data.present && m_entries[large_index].data.size)
+		return m_entries[large_index].data.get_address() + (virtaddr % LARGE_PAGE_SIZE);
+
 	if(virtaddr < HIGHER_HALF) { //Program space
 		size_t page = virtaddr / PAGE_SIZE;
 		size_t directory_index = (page / 1024) % 1024;
@@ -251,6 +344,10 @@ void PageDirectory::dealloc_page_table(size_t tables_index) {
 
 bool PageDirectory::is_mapped(size_t vaddr, bool write) {
 	LOCK(m_lock);
+	auto& large_entry = m_entries[vaddr / LARGE_PAGE_SIZE];
+	if(large_entry.data.present && large_entry.data.size)
+		return !write || large_entry.data.read_write;
+
 	if(vaddr < HIGHER_HALF) { //Program space
 		size_t page = vaddr / PAGE_SIZE;
 		size_t directory_index = (page / 1024) % 1024;
@@ -274,16 +371,46 @@ bool PageDirectory::is_mapped(size_t vaddr, bool write) {
 	}
 }
 
+bool PageDirectory::test_and_clear_accessed(VirtualAddress vaddr) {
+	LOCK(m_lock);
+	if(vaddr >= HIGHER_HALF)
+		return false;
+
+	size_t page = vaddr / PAGE_SIZE;
+	size_t directory_index = (page / 1024) % 1024;
+	bool accessed;
+	if(m_entries[directory_index].data.present && m_entries[directory_index].data.size) {
+		accessed = m_entries[directory_index].data.accessed;
+		m_entries[directory_index].data.accessed = false;
+	} else {
+		if(!m_entries[directory_index].data.present || !m_page_tables[directory_index])
+			return false;
+		auto& entry = m_page_tables[directory_index]->entries()[page % 1024];
+		if(!entry.data.present)
+			return false;
+		accessed = entry.data.acessed;
+		entry.data.acessed = false;
+	}
+
+	// The processor only sets the accessed bit when it loads the entry into the TLB, so get rid of the cached entry
+	if(accessed)
+		MM.invlpg((void*) (page * PAGE_SIZE));
+	return accessed;
+}
+
 bool PageDirectory::is_mapped() {
 	size_t current_page_directory;
 	asm volatile("mov %%cr3, %0" : "=r"(current_page_directory));
 	return current_page_directory == entries_physaddr();
 }
 
-Result PageDirectory::map_page(PageIndex vpage, PageIndex ppage, VMProt prot) {
+Result PageDirectory::map_page(PageIndex vpage, PageIndex ppage, VMProt prot, TLBFlush* flush) {
 	size_t directory_index = (vpage / 1024) % 1024;
 	size_t table_index = vpage % 1024;
 
+	if(m_entries[directory_index].data.present && m_entries[directory_index].data.size)
+		split_large_page(directory_index);
+
 	PageTable::Entry* entry;
 
 	if(directory_index < 768) {
@@ -315,15 +442,21 @@ Result PageDirectory::map_page(PageIndex vpage, PageIndex ppage, VMProt prot) {
 	entry->data.read_write = prot.write;
 	entry->data.user = true;
 	entry->data.set_address(ppage * PAGE_SIZE);
-	MemoryManager::inst().invlpg((void *) (vpage * PAGE_SIZE));
+	if(flush)
+		flush->add(vpage * PAGE_SIZE);
+	else
+		MemoryManager::inst().invlpg((void *) (vpage * PAGE_SIZE));
 
 	return Result(SUCCESS);
 }
 
-Result PageDirectory::unmap_page(PageIndex vpage) {
+Result PageDirectory::unmap_page(PageIndex vpage, TLBFlush* flush) {
 	size_t directory_index = (vpage / 1024) % 1024;
 	size_t table_index = vpage % 1024;
 
+	if(m_entries[directory_index].data.present && m_entries[directory_index].data.size)
+		split_large_page(directory_index);
+
 	if(directory_index < 768) {
 		// Userspace
 		if(m_type != DirectoryType::USER) {
@@ -331,10 +464,9 @@ Result PageDirectory::unmap_page(PageIndex vpage) {
 			return Result(EINVAL);
 		}
 
-		//If the page table for this page hasn't been alloc'd yet, alloc it
-		if (!m_page_tables[directory_index]){
-			alloc_page_table(directory_index);
-		}
+		// If there's no page table for this page, it isn't mapped
+		if(!m_page_tables[directory_index])
+			return Result(SUCCESS);
 
 		auto* entry = &m_page_tables[directory_index]->entries()[table_index];
 		if(entry->data.present)
@@ -353,8 +485,131 @@ Result PageDirectory::unmap_page(PageIndex vpage) {
 		entry->value = 0;
 	}
 
-	MemoryManager::inst().invlpg((void *) (vpage * PAGE_SIZE));
+	if(flush)
+		flush->add(vpage * PAGE_SIZE);
+	else
+		MemoryManager::inst().invlpg((void *) (vpage * PAGE_SIZE));
+	return Result(SUCCESS);
+}
+
+bool PageDirectory::page_present(PageIndex vpage) {
+	size_t directory_index = (vpage / 1024) % 1024;
+	auto& directory_entry = m_entries[directory_index];
+	if(directory_entry.data.present && directory_entry.data.size)
+		return true;
+	if(directory_index >= 768 || !m_page_tables[directory_index])
+		return false;
+	return m_page_tables[directory_index]->entries()[vpage % 1024].data.present;
+}
+
+void PageDirectory::account_pages(VMRegion& region, ssize_t num_pages) {
+	if(m_type != DirectoryType::USER)
+		return;
+	switch(region.memory_kind()) {
+		case VMRegion::MemoryKind::Anonymous:
+			m_resident_stats.anonymous += num_pages;
+			break;
+		case VMRegion::MemoryKind::Shared:
+			m_resident_stats.shared += num_pages;
+			break;
+		case VMRegion::MemoryKind::File:
+			m_resident_stats.file += num_pages;
+			break;
+		case VMRegion::MemoryKind::Other:
+			m_resident_stats.other += num_pages;
+			break;
+	}
+}
+
+Result PageDirectory::map_large_page(size_t directory_index, PageIndex ppage, VMProt prot) {
+	ASSERT(ppage % PAGES_PER_LARGE_PAGE == 0);
+	LOCK(m_lock);
+
+	if(directory_index < 768) {
+		if(m_type != DirectoryType::USER) {
+			KLog::warn("PageDirectory", "Tried mapping user in kernel directory!");
+			return Result(EINVAL);
+		}
+
+		// The large page replaces the page table for this block, if there is one
+		dealloc_page_table(directory_index);
+		m_page_tables_num_mapped[directory_index] = 0;
+	} else {
+		if(m_type != DirectoryType::KERNEL) {
+			KLog::warn("PageDirectory", "Tried mapping kernel in non-kernel directory!");
+			return Result(EINVAL);
+		}
+
+		// Kernel page tables are never freed, but clear the entries so they're empty if the large page is split up
+		for(size_t i = 0; i < 1024; i++)
+			s_kernel_page_tables[directory_index - 768].entries()[i].value = 0;
+	}
+
+	auto& entry = m_entries[directory_index];
+	entry.value = 0;
+	entry.data.present = true;
+	entry.data.read_write = prot.write;
+	entry.data.user = directory_index < 768;
+	entry.data.size = 1;
+	entry.data.set_address(ppage * PAGE_SIZE);
+	if(directory_index >= 768)
+		sync_kernel_entry(directory_index);
+
+	// Any of the 4KiB pages in this block may still be in the TLB
+	TLBFlush flush;
+	flush.add(VirtualRange { directory_index * LARGE_PAGE_SIZE, LARGE_PAGE_SIZE });
+
 	return Result(SUCCESS);
 }
 
+void PageDirectory::split_large_page(size_t directory_index) {
+	LOCK(m_lock);
+
+	// The kernel's large pages can only be split up through the kernel's directory
+	if((directory_index >= 768) != (m_type == DirectoryType::KERNEL))
+		return;
+
+	auto& entry = m_entries[directory_index];
+	if(!entry.data.present || !entry.data.size)
+		return;
+
+	PageIndex first_ppage = entry.data.get_address() / PAGE_SIZE;
+	VMProt prot = {
+		.read = true,
+		.write = entry.data.read_write,
+		.execute = true
+	};
+
+	// Point the entry back at a page table (which map_page allocates for user directories), and fill it in
+	if(directory_index < 768)
+		entry.value = 0;
+	else
+		reset_kernel_entry(directory_index);
+
+	TLBFlush flush;
+	for(size_t i = 0; i < PAGES_PER_LARGE_PAGE; i++)
+		map_page(directory_index * PAGES_PER_LARGE_PAGE + i, first_ppage + i, prot, &flush);
+
+	if(directory_index >= 768)
+		sync_kernel_entry(directory_index);
+}
+
+void PageDirectory::unmap_large_page(size_t directory_index) {
+	LOCK(m_lock);
+
+	if((directory_index >= 768) != (m_type == DirectoryType::KERNEL))
+		return;
+
+	auto& entry = m_entries[directory_index];
+	if(!entry.data.present || !entry.data.size)
+		return;
+
+	if(directory_index < 768) {
+		entry.value = 0;
+	} else {
+		reset_kernel_entry(directory_index);
+		sync_kernel_entry(directory_index);
+	}
 
+	MemoryManager::inst().invlpg((void*) (directory_index * LARGE_PAGE_SIZE));
+}
@@ -26,6 +26,7 @@
 #include "VMRegion.h"
 
 class PageTable;
+class TLBFlush;
 
 class PageDirectory {
 public:
@@ -34,6 +35,16 @@ public:
 		KERNEL
 	};
 
+	/** How many pages of each kind of memory are mapped into a user page directory. **/
+	struct ResidentStats {
+		size_t anonymous;
+		size_t shared;
+		size_t file;
+		size_t other;
+
+		size_t total() const { return anonymous + shared + file + other; }
+	};
+
 	typedef union Entry {
 		class __attribute((packed)) Data {
 		public:
@@ -44,7 +55,7 @@ public:
 			bool cache_disable : 1;
 			bool accessed : 1;
 			bool zero : 1;
-			uint8_t size : 1;
+			uint8_t size : 1; // If set, this entry maps a 4MiB page instead of pointing to a page table.
 			bool ignored : 1;
 			uint8_t unused : 3;
 			size_t page_table_addr : 20;
@@ -76,7 +87,8 @@ public:
 	size_t entries_physaddr();
 
 	/**
-	 * Maps a portion of a region into the page directory.
+	 * Maps a portion of a region into the page directory. Any 4MiB-aligned blocks of the range that are backed by
+	 * 4MiB-aligned, physically contiguous pages are mapped with a single large page.
 	 * @param region The region to map.
 	 * @param range The range within the region to map relative to the start of the region. Use VirtualRange::null to map the whole region.
 	 */
@@ -122,6 +134,20 @@ public:
 	 */
 	bool is_mapped(VirtualAddress vaddr, bool write);
 
+	/**
+	 * Checks whether the page containing a given userspace address was accessed since the last time this was called
+	 * for it, and clears its accessed bit.
+	 * @param vaddr The virtual address to check.
+	 * @return Whether the page was accessed.
+	 */
+	bool test_and_clear_accessed(VirtualAddress vaddr);
+
+	/**
+	 * Gets how many pages of each kind of memory are mapped. This is kept up to date as regions are mapped and
+	 * unmapped, so it's cheap to call.
+	 */
+	ResidentStats resident_stats() const { return m_resident_stats; }
+
 	/**
 	 * Gets whether or not this PageDirectory is currently mapped.
 	 * @return Whether or not the PageDirectory is currently mapped.
@@ -135,16 +161,50 @@ private:
 	 * @param vpage The index of the virtual page to map.
 	 * @param ppage The index of the physical page to map it to.
 	 * @param prot The protection to map the page with.
+	 * @param flush If not null, the page is added to this batch instead of being invalidated in the TLB right away.
 	 * @return Whether the page was successfully mapped.
 	 */
-	Result map_page(PageIndex vpage, PageIndex ppage, VMProt prot);
+	Result map_page(PageIndex vpage, PageIndex ppage, VMProt prot, TLBFlush* flush = nullptr);
 
 	/**
 	 * Unmaps a virtual page.
 	 * @param vpage The index of the virtual page to unmap.
+	 * @param flush If not null, the page is added to this batch instead of being invalidated in the TLB right away.
 	 * @return Whether the page was successfully unmapped.
 	 */
-	Result unmap_page(PageIndex vpage);
+	Result unmap_page(PageIndex vpage, TLBFlush* flush = nullptr);
+
+	/**
+	 * Maps a 4MiB block of virtual memory to a 4MiB block of physical memory with one large page.
+	 * @param directory_index The index of the directory entry to use.
+	 * @param ppage The index of the first physical page to map it to. Must be 4MiB-aligned.
+	 * @param prot The protection to map the page with.
+	 */
+	Result map_large_page(size_t directory_index, PageIndex ppage, VMProt prot);
+
+	/**
+	 * Replaces a large page with a page table mapping the same pages, so that parts of it can be changed.
+	 * @param directory_index The index of the directory entry of the large page.
+	 */
+	void split_large_page(size_t directory_index);
+
+	/**
+	 * Unmaps a large page.
+	 * @param directory_index The index of the directory entry of the large page.
+	 */
+	void unmap_large_page(size_t directory_index);
+
+	/** Whether a userspace virtual page is mapped, either on its own or as part of a large page. **/
+	bool page_present(PageIndex vpage);
+
+	/** Adds to the resident stats for a region's kind of memory. Does nothing for the kernel's directory. **/
+	void account_pages(VMRegion& region, ssize_t num_pages);
+
+	/** Points the kernel's directory entry for a 4MiB block back at its page table. **/
+	static void reset_kernel_entry(size_t directory_index);
+
+	/** Copies one of the kernel's directory entries into every user page directory. **/
+	static void sync_kernel_entry(size_t directory_index);
 
 	// The entries for the kernel.
 	static Entry s_kernel_entries[1024];
@@ -163,5 +223,13 @@ private:
 	volatile int m_page_tables_num_mapped[1024] = {0};
 	// A lock used to prevent race conditions.
 	SpinLock m_lock;
+	// How many pages of each kind of memory are mapped. Only kept for user directories.
+	ResidentStats m_resident_stats = {0, 0, 0, 0};
+
+	// A list of every user page directory, so that changes to the kernel's directory entries can be copied into them.
+	static SpinLock s_user_directories_lock;
+	static PageDirectory* s_user_directories;
+	PageDirectory* m_next_user = nullptr;
+	PageDirectory* m_prev_user = nullptr;
 };
 
@@ -0,0 +1,166 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "PageMerger.h"
+#include "AnonymousVMObject.h"
+#include "MemoryManager.h"
+#include "../CommandLine.h"
+#include "../kstd/KLog.h"
+#include "../kstd/kstdlib.h"
+#include "../tasking/TaskManager.h"
+#include "../tasking/Thread.h"
+#include "../tasking/SleepBlocker.h"
+
+size_t PageMerger::s_object_cursor = 0;
+PageIndex PageMerger::s_page_cursor = 0;
+size_t PageMerger::s_num_merged_pages = 0;
+uint32_t PageMerger::s_zero_checksum = 0;
+kstd::unordered_map<uint32_t, PageIndex> PageMerger::s_stable_pages;
+kstd::unordered_map<PageIndex, uint32_t> PageMerger::s_checksums;
+kstd::unordered_map<PageIndex, uint32_t> PageMerger::s_last_checksums;
+kstd::unordered_map<uint32_t, bool> PageMerger::s_unchanged_checksums;
+
+void kpagemerge_entry() {
+	PageMerger::thread();
+}
+
+void PageMerger::thread() {
+	int interval_ms = PAGE_MERGE_INTERVAL_MS_DEFAULT;
+	auto& interval_opt = CommandLine::inst().get_option_value("page_merge");
+	if(interval_opt.length() && atoi(interval_opt.c_str()) > 0)
+		interval_ms = atoi(interval_opt.c_str());
+	KLog::dbg("PageMerger", "Merging identical pages every %dms", interval_ms);
+
+	s_zero_checksum = checksum(MM.zero_page());
+	while(1) {
+		SleepBlocker blocker(Time(interval_ms / 1000, (interval_ms % 1000) * 1000));
+		TaskManager::current_thread()->block(blocker);
+		scan(PAGE_MERGE_PAGES_PER_SCAN);
+	}
+}
+
+void PageMerger::scan(size_t max_pages) {
+	// Objects remove themselves from the list before they're destroyed, and ones that are in use are skipped, like in
+	// the swap shrinker
+	LOCK(AnonymousVMObject::s_swappable_lock);
+	auto& objects = AnonymousVMObject::s_swappable_objects;
+	size_t num_scanned = 0;
+	while(num_scanned < max_pages) {
+		if(s_object_cursor >= objects.size()) {
+			finish_pass();
+			s_object_cursor = 0;
+			s_page_cursor = 0;
+			return;
+		}
+
+		auto object = objects[s_object_cursor];
+		if(object->m_page_lock.held_by_current_thread() || !object->m_page_lock.try_acquire()) {
+			s_object_cursor++;
+			s_page_cursor = 0;
+			continue;
+		}
+
+		if(object->pages_movable()) {
+			auto num_pages = object->m_physical_pages.size();
+			while(s_page_cursor < num_pages && num_scanned < max_pages) {
+				scan_page(*object, s_page_cursor++);
+				num_scanned++;
+			}
+		}
+
+		if(!object->pages_movable() || s_page_cursor >= object->m_physical_pages.size()) {
+			s_object_cursor++;
+			s_page_cursor = 0;
+		}
+		object->m_page_lock.release();
+	}
+}
+
+void PageMerger::scan_page(AnonymousVMObject& object, PageIndex index) {
+	// Only look at pages that belong to this object alone. Anything CoW is either already merged or will be copied soon.
+	auto page = object.m_physical_pages[index];
+	if(!page || object.page_is_cow(index) || MM.get_physical_page(page).allocated.ref_count.load(MemoryOrder::Relaxed) != 1)
+		return;
+
+	auto sum = checksum(page);
+	s_checksums[page] = sum;
+
+	if(sum == s_zero_checksum && merge_page(object, index, MM.zero_page()))
+		return;
+
+	auto stable_page = s_stable_pages.get(sum);
+	if(stable_page) {
+		merge_page(object, index, *stable_page);
+		return;
+	}
+
+	// If the page hasn't changed since the last pass and another page like it has turned up, make it one that other
+	// pages can be merged into. It's unmapped and made CoW first, so that it can't change from under us afterwards.
+	auto last_sum = s_last_checksums.get(page);
+	if(!last_sum || *last_sum != sum)
+		return;
+	if(!s_unchanged_checksums.contains(sum)) {
+		s_unchanged_checksums[sum] = true;
+		return;
+	}
+	object.unmap_page(index);
+	if(checksum(page) != sum)
+		return;
+	object.m_cow_pages.set(index, true);
+	MM.get_physical_page(page).ref();
+	s_stable_pages[sum] = page;
+}
+
+bool PageMerger::merge_page(AnonymousVMObject& object, PageIndex index, PageIndex into) {
+	// Unmap the page before comparing it so it can't be written to while we do. Faulting it back in needs the object's
+	// lock, which we're holding, so anything that touches it will wait until we're done and then see the merged page.
+	auto page = object.m_physical_pages[index];
+	object.unmap_page(index);
+
+	bool identical = true;
+	MM.with_dual_quickmapped(page, into, [&](void* page_ptr, void* into_ptr) {
+		auto* a = (uint32_t*) page_ptr;
+		auto* b = (uint32_t*) into_ptr;
+		for(size_t i = 0; i < PAGE_SIZE / sizeof(uint32_t) && identical; i++)
+			identical = a[i] == b[i];
+	});
+	if(!identical)
+		return false;
+
+	MM.get_physical_page(into).ref();
+	object.m_physical_pages[index] = into;
+	object.m_cow_pages.set(index, true);
+	MM.get_physical_page(page).unref();
+	s_checksums.erase(page);
+	s_num_merged_pages++;
+	return true;
+}
+
+void PageMerger::finish_pass() {
+	// Stable pages that nothing else is using anymore can be let go of
+	kstd::vector<uint32_t> unused;
+	for(auto& pair : s_stable_pages) {
+		if(MM.get_physical_page(pair.second).allocated.ref_count.load(MemoryOrder::Relaxed) == 1)
+			unused.push_back(pair.first);
+	}
+	for(auto sum : unused) {
+		MM.get_physical_page(*s_stable_pages.get(sum)).unref();
+		s_stable_pages.erase(sum);
+	}
+
+	s_last_checksums = kstd::move(s_checksums);
+	s_checksums.clear();
+	s_unchanged_checksums.clear();
+}
+
+uint32_t PageMerger::checksum(PageIndex page) {
+	uint32_t sum = 2166136261u;
+	MM.with_quickmapped(page, [&](void* ptr) {
+		auto* words = (uint32_t*) ptr;
+		for(size_t i = 0; i < PAGE_SIZE / sizeof(uint32_t); i++) {
+			sum ^= words[i];
+			sum *= 16777619u;
+		}
+	});
+	return sum;
+}
@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "Memory.h"
+#include "../kstd/unordered_map.hpp"
+
+// How often the page merger scans, and how many pages it looks at each time. The interval can be changed with the
+// `page_merge=<ms>` command line option, which also turns the page merger on.
+#define PAGE_MERGE_INTERVAL_MS_DEFAULT 1000
+#define PAGE_MERGE_PAGES_PER_SCAN 512
+
+class AnonymousVMObject;
+
+void kpagemerge_entry();
+
+/**
+ * Merges identical pages of userspace anonymous memory on a kernel thread, so processes with the same data in memory
+ * share one copy of it. Every so often, it looks through a batch of pages. Pages that are all zeroes are swapped for
+ * the zero page, and pages with the same contents as a page that's already been merged are swapped for that one.
+ * Merged pages are CoW, so a process writing to one gets its own copy again.
+ *
+ * Pages only become candidates for merging into once they've stayed the same between two passes over all of memory
+ * and another page with the same checksum has turned up, so that pages that are being written to don't end up CoW.
+ */
+class PageMerger {
+public:
+	/// The number of pages that have been freed by merging them with another.
+	static size_t num_merged_pages() { return s_num_merged_pages; }
+
+private:
+	friend void kpagemerge_entry();
+	static void thread();
+	/// Looks at up to max_pages pages, continuing where the last scan left off.
+	static void scan(size_t max_pages);
+	/// Looks at a page of an object, merging it if it's a duplicate. Called with the object's lock held.
+	static void scan_page(AnonymousVMObject& object, PageIndex index);
+	/// Swaps a page of an object for an identical one if it's still identical once unmapped. Returns whether it did.
+	static bool merge_page(AnonymousVMObject& object, PageIndex index, PageIndex into);
+	/// Called once every page has been looked at. Forgets about merged pages that aren't used anymore.
+	static void finish_pass();
+	static uint32_t checksum(PageIndex page);
+
+	static size_t s_object_cursor;
+	static PageIndex s_page_cursor;
+	static size_t s_num_merged_pages;
+	static uint32_t s_zero_checksum;
+	/// Pages that other pages can be merged into, by checksum. We hold a reference to each.
+	static kstd::unordered_map<uint32_t, PageIndex> s_stable_pages;
+	/// The checksums of the pages looked at during the current and last passes, by physical page.
+	static kstd::unordered_map<PageIndex, uint32_t> s_checksums;
+	static kstd::unordered_map<PageIndex, uint32_t> s_last_checksums;
+	/// The checksums of pages that stayed the same since the last pass, so that a second one can be made stable.
+	static kstd::unordered_map<uint32_t, bool> s_unchanged_checksums;
+};
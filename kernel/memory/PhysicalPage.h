@@ -10,12 +10,18 @@
 
 union PhysicalPage {
 public:
+	// Reserved pages are never freed, so they aren't reference counted. This lets pages like the shared zero page be
+	// mapped any number of times.
 	void ref() {
+		if(allocated.reserved)
+			return;
 		if(allocated.ref_count.add(1) == 0xFFFF)
 			PANIC("PPAGE_REF_COUNT_OVERFLOW", "A physical page was referenced too many times and overflowed.");
 	}
 
 	void unref() {
+		if(allocated.reserved)
+			return;
 		auto prev_value = allocated.ref_count.sub(1);
 		ASSERT(prev_value);
 		if(prev_value == 1)
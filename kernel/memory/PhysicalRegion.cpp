@@ -8,8 +8,12 @@ PhysicalRegion::PhysicalRegion(size_t start_page, size_t num_pages, bool reserve
 	m_start_page(start_page),
 	m_num_pages(num_pages),
 	m_free_pages(used ? 0 : num_pages),
-	m_reserved(reserved)
+	m_reserved(reserved),
+	m_zone(start_page < DMA_ZONE_END / PAGE_SIZE ? PhysicalZone::DMA : PhysicalZone::Normal)
 {
+	// Regions are split up by MemoryManager so that they don't cross zones
+	ASSERT(m_zone == PhysicalZone::Normal || start_page + num_pages <= DMA_ZONE_END / PAGE_SIZE);
+
 	// If the region is reserved, don't bother allocating zones
 	if(reserved)
 		return;
@@ -20,6 +24,9 @@ PhysicalRegion::PhysicalRegion(size_t start_page, size_t num_pages, bool reserve
 		size_t zone_order = (sizeof(unsigned int) * 8) - __builtin_clz(num_pages) - 1;
 		if(zone_order > BuddyZone::MAX_ORDER)
 			zone_order = BuddyZone::MAX_ORDER;
+		// Keep zones aligned to their size, so that blocks in them (like 4MiB order-10 blocks) are naturally aligned too
+		if(start_page && (size_t) __builtin_ctz(start_page) < zone_order)
+			zone_order = __builtin_ctz(start_page);
 		size_t zone_num_pages = 1 << zone_order;
 		auto zone = new BuddyZone(start_page, zone_num_pages);
 		m_zones.push_back(zone);
@@ -100,6 +107,24 @@ bool PhysicalRegion::contains_page(PageIndex page) {
 	return page >= m_start_page && page < m_start_page + m_num_pages;
 }
 
+void PhysicalRegion::count_free_blocks(size_t counts[BuddyZone::MAX_ORDER + 1]) {
+	if(m_reserved)
+		return;
+	LOCK(m_lock);
+	for(auto zone : m_zones) {
+		for(unsigned int order = 0; order <= zone->highest_order(); order++)
+			counts[order] += zone->num_free_blocks(order);
+	}
+}
+
+void PhysicalRegion::mark_free_pages(kstd::Bitmap& bitmap) {
+	if(m_reserved)
+		return;
+	LOCK(m_lock);
+	for(auto zone : m_zones)
+		zone->mark_free_pages(bitmap);
+}
+
 void PhysicalRegion::init() {
 	if(m_reserved)
 		return;
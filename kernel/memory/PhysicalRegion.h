@@ -17,6 +17,7 @@ public:
 	size_t num_pages() const { return m_num_pages; }
 	size_t free_pages() const { return m_free_pages; }
 	bool reserved() const { return m_reserved; }
+	PhysicalZone zone() const { return m_zone; }
 
 	/**
 	 * Allocates a page in this region.
@@ -39,6 +40,15 @@ public:
 	/** Returns whether the given page is in this region. **/
 	bool contains_page(PageIndex page);
 
+	/**
+	 * Counts the free blocks of each order in this region.
+	 * @param counts The array to add the number of free blocks of each order to.
+	 */
+	void count_free_blocks(size_t counts[BuddyZone::MAX_ORDER + 1]);
+
+	/** Marks every free page in this region in a bitmap indexed by absolute page index. **/
+	void mark_free_pages(kstd::Bitmap& bitmap);
+
 protected:
 	friend class MemoryManager;
 	void init();
@@ -50,4 +60,5 @@ private:
 	size_t m_num_pages;
 	size_t m_free_pages;
 	const bool m_reserved;
+	const PhysicalZone m_zone;
 };
@@ -0,0 +1,162 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Prefetch.h"
+#include "InodeVMObject.h"
+#include "Readahead.h"
+#include "MemoryManager.h"
+#include <kernel/kstd/map.hpp>
+#include <kernel/kstd/unordered_set.hpp>
+#include <kernel/kstd/vector.hpp>
+#include <kernel/filesystem/VFS.h>
+#include <kernel/filesystem/Filesystem.h>
+#include <kernel/filesystem/LinkedInode.h>
+#include <kernel/tasking/TaskManager.h>
+#include <kernel/tasking/Process.h>
+#include <kernel/tasking/SpinLock.h>
+
+namespace Prefetch {
+	static SpinLock s_lock;
+	static bool s_recording = false;
+	static bool s_record_all = false;
+	static uint32_t s_session = 0;
+	static Filesystem* s_root_fs = nullptr;
+	static kstd::vector<prefetch_entry> s_entries;
+	static kstd::unordered_set<uint64_t> s_recorded;
+
+	static uint64_t key(ino_t ino, PageIndex page) {
+		return ((uint64_t) ino << 32) | (uint32_t) page;
+	}
+
+	int start_recording(pid_t pid) {
+		auto root_fs = &VFS::inst().root_ref()->inode()->fs;
+		LOCK(s_lock);
+		s_recording = false;
+		s_entries.resize(0);
+		s_recorded.clear();
+		s_root_fs = root_fs;
+		s_session++;
+		s_record_all = !pid;
+		if(pid) {
+			auto proc = TaskManager::process_for_pid(pid);
+			if(proc.is_error())
+				return -ESRCH;
+			proc.value()->set_prefetch_session(s_session);
+		}
+		s_recording = true;
+		return SUCCESS;
+	}
+
+	void stop_recording() {
+		LOCK(s_lock);
+		s_recording = false;
+	}
+
+	void record(InodeVMObject& object, PageIndex start, size_t num_pages) {
+		if(!s_recording || !num_pages)
+			return;
+		auto* process = TaskManager::current_process();
+		if(process->is_kernel_mode() || (!s_record_all && process->prefetch_session() != s_session))
+			return;
+		auto inode = object.inode();
+		if(!inode || &inode->fs != s_root_fs)
+			return;
+
+		LOCK(s_lock);
+		if(!s_recording)
+			return;
+		for(PageIndex page = start; page < start + num_pages && s_entries.size() < PREFETCH_MAX_ENTRIES; page++) {
+			if(s_recorded.insert(key(inode->id, page)))
+				s_entries.push_back({inode->id, (uint32_t) page});
+		}
+	}
+
+	ssize_t read(size_t start, size_t length, SafePointer<uint8_t> buffer) {
+		// Only whole entries can be read. They're copied out a batch at a time without the lock held, since writing to
+		// the buffer might fault on a file mapping and get recorded.
+		if(start % sizeof(prefetch_entry))
+			return -EINVAL;
+
+		size_t index = start / sizeof(prefetch_entry);
+		size_t count = length / sizeof(prefetch_entry);
+		size_t nread = 0;
+		while(nread < count) {
+			prefetch_entry batch[64];
+			size_t batch_size;
+			{
+				LOCK(s_lock);
+				if(index >= s_entries.size())
+					break;
+				batch_size = min(min(count - nread, s_entries.size() - index), (size_t) 64);
+				for(size_t i = 0; i < batch_size; i++)
+					batch[i] = s_entries[index + i];
+			}
+			buffer.write((uint8_t*) batch, nread * sizeof(prefetch_entry), batch_size * sizeof(prefetch_entry));
+			nread += batch_size;
+			index += batch_size;
+		}
+		return nread * sizeof(prefetch_entry);
+	}
+
+	ssize_t replay(SafePointer<uint8_t> buffer, size_t length) {
+		auto readahead = Readahead::inst();
+		if(!readahead)
+			return -EAGAIN;
+
+		// Sort the pages by inode and then by page, so that each file is read front to back in as few runs as possible.
+		// Inode numbers on most filesystems roughly follow where things are on the disk, too.
+		size_t count = min(length / sizeof(prefetch_entry), (size_t) PREFETCH_MAX_ENTRIES);
+		kstd::map<uint64_t, bool> pages;
+		for(size_t i = 0; i < count; i++) {
+			prefetch_entry entry;
+			buffer.read((uint8_t*) &entry, i * sizeof(prefetch_entry), sizeof(prefetch_entry));
+			pages[key(entry.ino, entry.page)] = true;
+		}
+
+		// Don't read in more than there's room for without the reclaim thread dropping other pages to make it
+		size_t budget = 0;
+		if(MM.num_free_pages() > MM.low_watermark())
+			budget = MM.num_free_pages() - MM.low_watermark();
+
+		auto& root_fs = VFS::inst().root_ref()->inode()->fs;
+		ino_t ino = 0;
+		kstd::Arc<InodeVMObject> page_cache;
+		PageIndex run_start = 0;
+		size_t run_length = 0;
+		auto queue_run = [&] {
+			if(!page_cache || !run_length)
+				return;
+			run_length = min(run_length, budget);
+			readahead->queue(page_cache, run_start, run_length);
+			budget -= run_length;
+			run_length = 0;
+		};
+
+		for(auto& pair : pages) {
+			if(!budget)
+				break;
+			ino_t entry_ino = pair.first >> 32;
+			PageIndex page = pair.first & 0xFFFFFFFF;
+			if(entry_ino != ino) {
+				queue_run();
+				ino = entry_ino;
+				auto inode_res = root_fs.get_inode(ino);
+				page_cache = inode_res.is_error() ? kstd::Arc<InodeVMObject>(nullptr) : inode_res.value()->page_cache();
+			}
+			if(!page_cache)
+				continue;
+
+			// Pages that follow on from the current run are read along with it
+			if(run_length && page == run_start + run_length) {
+				run_length++;
+				continue;
+			}
+			queue_run();
+			run_start = page;
+			run_length = 1;
+		}
+		queue_run();
+
+		return count * sizeof(prefetch_entry);
+	}
+}
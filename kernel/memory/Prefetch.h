@@ -0,0 +1,32 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+#include <kernel/api/prefetch.h>
+#include <kernel/memory/SafePointer.h>
+#include "Memory.h"
+
+class InodeVMObject;
+
+/**
+ * Records which pages of files a process reads or faults in while it starts up, and reads them back into the page
+ * cache ahead of time on the next start, through /dev/prefetch. Replayed lists are sorted by inode and page and read as
+ * big runs on the readahead thread, instead of a page or two at a time as the process happens to touch them.
+ *
+ * Only files on the root filesystem are recorded, since inode numbers don't mean anything across filesystems.
+ */
+namespace Prefetch {
+	/// Starts recording the given process and the processes it starts, or every userspace process if pid is zero.
+	/// Anything recorded before is thrown away. Returns -ESRCH if there's no such process.
+	int start_recording(pid_t pid);
+	void stop_recording();
+	/// Called when the pages of an inode's object are accessed, and records them if the current process is being
+	/// recorded. The pages are indices into the inode, not the object.
+	void record(InodeVMObject& object, PageIndex start, size_t num_pages);
+	/// Reads recorded entries starting at the given byte offset. See prefetch_entry for the format.
+	ssize_t read(size_t start, size_t length, SafePointer<uint8_t> buffer);
+	/// Queues the pages in a list of prefetch_entry to be read in. Returns the number of bytes of entries taken.
+	ssize_t replay(SafePointer<uint8_t> buffer, size_t length);
+}
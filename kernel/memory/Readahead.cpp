@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Readahead.h"
+#include <kernel/CommandLine.h>
+#include <kernel/tasking/TaskManager.h>
+#include <kernel/tasking/Thread.h>
+
+void kreadahead_entry() {
+	Readahead readahead;
+	readahead.start();
+}
+
+Readahead* Readahead::s_inst = nullptr;
+size_t Readahead::s_fault_around_pages = FAULT_AROUND_PAGES_DEFAULT;
+size_t Readahead::s_max_pages = READAHEAD_PAGES_MAX_DEFAULT;
+
+Readahead::Readahead() {
+	ASSERT(!s_inst);
+
+	auto& fault_around = CommandLine::inst().get_option_value("fault_around");
+	if(fault_around.length())
+		s_fault_around_pages = atoi(fault_around.c_str());
+	auto& max_pages = CommandLine::inst().get_option_value("readahead");
+	if(max_pages.length())
+		s_max_pages = atoi(max_pages.c_str());
+
+	s_inst = this;
+}
+
+Readahead* Readahead::inst() {
+	return s_inst;
+}
+
+void Readahead::queue(kstd::Arc<InodeVMObject> object, PageIndex start, size_t num_pages) {
+	if(!num_pages)
+		return;
+	{
+		LOCK(m_lock);
+		m_queue.push_back({kstd::move(object), start, num_pages});
+	}
+	m_blocker.set_ready(true);
+}
+
+void Readahead::start() {
+	while(1) {
+		m_lock.acquire();
+		while(!m_queue.empty()) {
+			auto request = m_queue.pop_front();
+			m_lock.release();
+
+			// Read in chunks so that faults on the object don't have to wait for the whole request
+			auto& object = request.object;
+			PageIndex end = min(request.start + request.num_pages, object->page_count());
+			for(PageIndex page = request.start; page < end; page += KERNEL_QUICKMAP_PAGES) {
+				LOCK(object->lock());
+				if(object->read_pages_if_needed(page, min(end - page, (size_t) KERNEL_QUICKMAP_PAGES)).is_error())
+					break;
+			}
+
+			m_lock.acquire();
+		}
+		// Clear the blocker before letting go of the lock so a request queued right after we finish isn't missed
+		m_blocker.set_ready(false);
+		m_lock.release();
+		TaskManager::current_thread()->block(m_blocker);
+	}
+}
@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/queue.hpp>
+#include <kernel/tasking/BooleanBlocker.h>
+#include <kernel/tasking/SpinLock.h>
+#include "InodeVMObject.h"
+
+// How many pages around a faulting page are mapped in too if they've already been read in (or allocated).
+// Can be changed with the `fault_around=<pages>` command line option.
+#define FAULT_AROUND_PAGES_DEFAULT 16
+// How many pages are read ahead of a fault in an inode mapping at first, and how big the window can grow to when the
+// mapping is being accessed sequentially. The maximum can be changed with the `readahead=<pages>` command line option.
+#define READAHEAD_PAGES_MIN 4
+#define READAHEAD_PAGES_MAX_DEFAULT 64
+
+void kreadahead_entry();
+
+/**
+ * Reads in pages of inode mappings on a kernel thread, so that a thread faulting its way through a mapped file doesn't
+ * have to wait on the disk once for every page.
+ */
+class Readahead {
+public:
+	Readahead();
+	/// Returns the readahead worker, or nullptr if it hasn't started yet.
+	static Readahead* inst();
+
+	/**
+	 * Queues a range of pages of an object to be read in. Pages that are already read in are skipped.
+	 * @param object The object to read pages into.
+	 * @param start The index of the first page to read in.
+	 * @param num_pages The number of pages to read in.
+	 */
+	void queue(kstd::Arc<InodeVMObject> object, PageIndex start, size_t num_pages);
+
+	static size_t fault_around_pages() { return s_fault_around_pages; }
+	static size_t max_pages() { return s_max_pages; }
+
+protected:
+	friend void kreadahead_entry();
+	void start();
+
+private:
+	struct Request {
+		kstd::Arc<InodeVMObject> object;
+		PageIndex start;
+		size_t num_pages;
+	};
+
+	SpinLock m_lock;
+	BooleanBlocker m_blocker;
+	kstd::queue<Request> m_queue;
+	static Readahead* s_inst;
+	static size_t s_fault_around_pages;
+	static size_t s_max_pages;
+};
@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+
+/**
+ * Something that holds onto memory it can give back when the system is running low, like a cache. Shrinkers are
+ * registered with MemoryManager::register_shrinker(), and are asked to free memory by the reclaim thread when the
+ * number of free pages drops below the low watermark, or directly by an allocation that couldn't be satisfied.
+ *
+ * Shrinkers may be called from the allocation path, so shrink() shouldn't wait on anything that could be waiting on
+ * an allocation itself (try-locking is fine).
+ */
+class Shrinker {
+public:
+	virtual ~Shrinker() = default;
+
+	/// A short name for the shrinker, for debugging.
+	virtual const char* name() const = 0;
+	/// Roughly how many pages could be freed by this shrinker right now.
+	virtual size_t reclaimable_pages() = 0;
+	/**
+	 * Tries to free some pages.
+	 * @param num_pages The number of pages to try to free.
+	 * @return The number of pages that were actually freed.
+	 */
+	virtual size_t shrink(size_t num_pages) = 0;
+};
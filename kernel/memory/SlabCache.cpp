@@ -0,0 +1,208 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "SlabCache.h"
+#include "kliballoc.h"
+#include <kernel/kstd/kstdlib.h>
+
+#define ROUND_UP(n, to) ((((n) + (to) - 1) / (to)) * (to))
+#define SLAB_HEADER_SIZE ROUND_UP(sizeof(Slab), SLAB_OBJECT_HEADER_SIZE)
+
+// The object sizes of the general-purpose caches used by kslab_alloc
+static constexpr size_t generic_cache_sizes[] = {16, 32, 64, 128, 256, 512};
+#define NUM_GENERIC_CACHES (sizeof(generic_cache_sizes) / sizeof(generic_cache_sizes[0]))
+
+static SlabCache* s_first_cache = nullptr;
+
+static SlabCache* generic_cache(size_t size) {
+	static SlabCache caches[NUM_GENERIC_CACHES] = {
+		{"kslab-16", 16},
+		{"kslab-32", 32},
+		{"kslab-64", 64},
+		{"kslab-128", 128},
+		{"kslab-256", 256},
+		{"kslab-512", 512}
+	};
+	for(size_t i = 0; i < NUM_GENERIC_CACHES; i++) {
+		if(size <= generic_cache_sizes[i])
+			return &caches[i];
+	}
+	return nullptr;
+}
+
+void* kslab_alloc(size_t size) {
+	auto* cache = generic_cache(size);
+	if(cache)
+		return cache->alloc(cache->m_object_size);
+
+	// Too big for any of the caches, so use the heap. A null slab pointer before the object tells free() so.
+	auto* header = (uint8_t*) kmalloc(size + SLAB_OBJECT_HEADER_SIZE);
+	if(!header)
+		return nullptr;
+	*((SlabCache::Slab**) header) = nullptr;
+	return header + SLAB_OBJECT_HEADER_SIZE;
+}
+
+void kslab_free(void* ptr) {
+	SlabCache::free(ptr);
+}
+
+SlabCache::SlabCache(const char* name, size_t object_size):
+	m_name(name),
+	m_object_size(object_size),
+	m_stride(SLAB_OBJECT_HEADER_SIZE + ROUND_UP(max(object_size, sizeof(FreeObject)), SLAB_OBJECT_HEADER_SIZE))
+{
+	m_objects_per_slab = max((SLAB_TARGET_SIZE - SLAB_HEADER_SIZE) / m_stride, (size_t) SLAB_MIN_OBJECTS);
+	m_slab_size = SLAB_HEADER_SIZE + m_objects_per_slab * m_stride;
+
+	// Caches are only ever created, so they can be added to the list without taking a lock
+	m_next_cache = __atomic_load_n(&s_first_cache, __ATOMIC_ACQUIRE);
+	while(!__atomic_compare_exchange_n(&s_first_cache, &m_next_cache, this, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+}
+
+void* SlabCache::alloc(size_t size) {
+	if(size != m_object_size)
+		return kslab_alloc(size);
+
+	m_lock.acquire();
+	auto* slab = m_partial;
+	if(!slab) {
+		// Don't hold the lock while allocating from the heap, since the heap may need to allocate objects of its own
+		m_lock.release();
+		auto* new_slab = create_slab();
+		if(!new_slab)
+			return nullptr;
+		m_lock.acquire();
+		push_front(m_partial, new_slab);
+		m_num_slabs++;
+		m_num_empty++;
+		slab = m_partial;
+	}
+
+	if(!slab->num_used)
+		m_num_empty--;
+	auto* object = slab->free_list;
+	slab->free_list = object->next;
+	slab->num_used++;
+	if(!slab->free_list) {
+		unlink(m_partial, slab);
+		push_front(m_full, slab);
+	}
+
+	m_objects_used++;
+	m_num_allocations++;
+	m_lock.release();
+	return object;
+}
+
+void SlabCache::free(void* ptr) {
+	if(!ptr)
+		return;
+	auto* header = (Slab**) ((uint8_t*) ptr - SLAB_OBJECT_HEADER_SIZE);
+	if(!*header) {
+		kfree(header);
+		return;
+	}
+	(*header)->cache->free_object(*header, ptr);
+}
+
+SlabCache::Stats SlabCache::stats() {
+	LOCK(m_lock);
+	return {
+		.object_size = m_object_size,
+		.num_slabs = m_num_slabs,
+		.objects_total = m_num_slabs * m_objects_per_slab,
+		.objects_used = m_objects_used,
+		.num_allocations = m_num_allocations
+	};
+}
+
+SlabCache* SlabCache::first_cache() {
+	return __atomic_load_n(&s_first_cache, __ATOMIC_ACQUIRE);
+}
+
+SlabCache::Slab* SlabCache::create_slab() {
+	auto* slab = (Slab*) kmalloc(m_slab_size);
+	if(!slab)
+		return nullptr;
+	slab->cache = this;
+	slab->prev = nullptr;
+	slab->next = nullptr;
+	slab->free_list = nullptr;
+	slab->num_used = 0;
+
+	// Build the free list backwards so that objects are handed out in address order
+	auto* objects = (uint8_t*) slab + SLAB_HEADER_SIZE;
+	for(size_t i = m_objects_per_slab; i > 0; i--) {
+		auto* slot = objects + (i - 1) * m_stride;
+		*((Slab**) slot) = slab;
+		auto* object = (FreeObject*) (slot + SLAB_OBJECT_HEADER_SIZE);
+		object->next = slab->free_list;
+		slab->free_list = object;
+	}
+	return slab;
+}
+
+void SlabCache::free_object(Slab* slab, void* ptr) {
+	Slab* to_free = nullptr;
+
+	m_lock.acquire();
+	if(!slab->free_list) {
+		unlink(m_full, slab);
+		push_front(m_partial, slab);
+	}
+
+	auto* object = (FreeObject*) ptr;
+	object->next = slab->free_list;
+	slab->free_list = object;
+	slab->num_used--;
+	m_objects_used--;
+
+	if(!slab->num_used) {
+		unlink(m_partial, slab);
+		if(m_num_empty >= SLAB_MAX_EMPTY) {
+			to_free = slab;
+			m_num_slabs--;
+		} else {
+			push_back(m_partial, slab);
+			m_num_empty++;
+		}
+	}
+	m_lock.release();
+
+	if(to_free)
+		kfree(to_free);
+}
+
+void SlabCache::unlink(Slab*& list, Slab* slab) {
+	if(slab->prev)
+		slab->prev->next = slab->next;
+	else
+		list = slab->next;
+	if(slab->next)
+		slab->next->prev = slab->prev;
+	slab->prev = nullptr;
+	slab->next = nullptr;
+}
+
+void SlabCache::push_front(Slab*& list, Slab* slab) {
+	slab->prev = nullptr;
+	slab->next = list;
+	if(list)
+		list->prev = slab;
+	list = slab;
+}
+
+void SlabCache::push_back(Slab*& list, Slab* slab) {
+	slab->next = nullptr;
+	if(!list) {
+		slab->prev = nullptr;
+		list = slab;
+		return;
+	}
+	auto* last = list;
+	while(last->next)
+		last = last->next;
+	last->next = slab;
+	slab->prev = last;
+}
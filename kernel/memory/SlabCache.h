@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+#include <kernel/tasking/SpinLock.h>
+#include <kernel/api/page_size.h>
+#include "kslab.h"
+
+// Every object is preceded by a pointer to the slab it's in, padded out to this many bytes to keep objects aligned
+#define SLAB_OBJECT_HEADER_SIZE 8
+// How big a slab should be, and the minimum number of objects in each slab for caches of large objects
+#define SLAB_TARGET_SIZE (PAGE_SIZE - 128)
+#define SLAB_MIN_OBJECTS 4
+// How many completely empty slabs a cache holds on to before giving them back to the heap
+#define SLAB_MAX_EMPTY 1
+
+/**
+ * Gives a class its own SlabCache, and makes new and delete use it. This should go at the start of the class body, and
+ * leaves the access specifier as public. Subclasses that don't use SLAB_ALLOCATED themselves are allocated from the
+ * general-purpose caches instead.
+ */
+#define SLAB_ALLOCATED(Type) \
+	public: \
+		static SlabCache& slab_cache() { static SlabCache cache(#Type, sizeof(Type)); return cache; } \
+		static void* operator new(size_t size) { return slab_cache().alloc(size); } \
+		static void* operator new(size_t, void* ptr) { return ptr; } \
+		static void operator delete(void* ptr) { SlabCache::free(ptr); }
+
+/**
+ * A cache of fixed-size objects. Objects are carved out of slabs, which are larger chunks allocated from the kernel
+ * heap, and each slab keeps a list of its free objects. Freed objects go back on their slab's list for the next
+ * allocation, so frequently created and destroyed objects don't fragment the heap or contend on its lock.
+ *
+ * Caches are created on first use, and every cache is kept in a list so their statistics can be shown in /proc/meminfo.
+ */
+class SlabCache {
+public:
+	struct Stats {
+		size_t object_size;
+		size_t num_slabs;
+		size_t objects_total;
+		size_t objects_used;
+		size_t num_allocations;
+	};
+
+	SlabCache(const char* name, size_t object_size);
+	SlabCache(const SlabCache& other) = delete;
+	~SlabCache() = default;
+
+	/// Allocates an object. If size isn't the object size of this cache, a general-purpose cache is used instead.
+	void* alloc(size_t size);
+	/// Frees an object allocated by any SlabCache or by kslab_alloc.
+	static void free(void* ptr);
+
+	[[nodiscard]] const char* name() const { return m_name; }
+	[[nodiscard]] size_t object_size() const { return m_object_size; }
+	Stats stats();
+
+	/// The first cache in the list of all caches.
+	static SlabCache* first_cache();
+	[[nodiscard]] SlabCache* next_cache() const { return m_next_cache; }
+
+private:
+	friend void* kslab_alloc(size_t size);
+
+	struct FreeObject {
+		FreeObject* next;
+	};
+
+	struct Slab {
+		SlabCache* cache;
+		Slab* prev;
+		Slab* next;
+		FreeObject* free_list;
+		size_t num_used;
+	};
+
+	Slab* create_slab();
+	void free_object(Slab* slab, void* ptr);
+	static void unlink(Slab*& list, Slab* slab);
+	static void push_front(Slab*& list, Slab* slab);
+	static void push_back(Slab*& list, Slab* slab);
+
+	const char* m_name;
+	size_t m_object_size;
+	size_t m_stride;
+	size_t m_objects_per_slab;
+	size_t m_slab_size;
+	SpinLock m_lock;
+	Slab* m_partial = nullptr; // Slabs with at least one free object. Empty slabs are kept at the back.
+	Slab* m_full = nullptr;
+	size_t m_num_slabs = 0;
+	size_t m_num_empty = 0;
+	size_t m_objects_used = 0;
+	size_t m_num_allocations = 0;
+	SlabCache* m_next_cache = nullptr;
+};
@@ -0,0 +1,162 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Swap.h"
+#include "MemoryManager.h"
+#include "SafePointer.h"
+#include "../filesystem/FileDescriptor.h"
+#include "../filesystem/InodeFile.h"
+#include "../filesystem/Inode.h"
+#include "../filesystem/InodeMetadata.h"
+#include "../device/BlockDevice.h"
+#include "../kstd/KLog.h"
+
+Swap* Swap::s_inst = nullptr;
+
+Swap::Swap(kstd::Arc<FileDescriptor> file, kstd::Arc<Inode> inode, kstd::Arc<BlockDevice> device, size_t num_slots):
+	m_file(kstd::move(file)),
+	m_inode(kstd::move(inode)),
+	m_device(kstd::move(device)),
+	m_used_slots(num_slots),
+	m_num_slots(num_slots)
+{
+	if(m_device)
+		m_blocks_per_slot = PAGE_SIZE / m_device->block_size();
+}
+
+Swap* Swap::inst() {
+	return s_inst;
+}
+
+Result Swap::enable(kstd::Arc<FileDescriptor> file) {
+	if(s_inst)
+		return Result(EBUSY);
+	if(file->metadata().is_block_device())
+		return enable_device(kstd::move(file));
+
+	if(!file->metadata().is_simple_file() || !file->file()->is_inode())
+		return Result(EINVAL);
+	auto inode = kstd::static_pointer_cast<InodeFile>(file->file())->inode();
+	size_t num_slots = file->metadata().size / PAGE_SIZE;
+	if(!num_slots)
+		return Result(EINVAL);
+
+	// Allocate all of the file's blocks now
+	auto zero_page = TRY(MM.alloc_physical_page(true));
+	Result result = Result(SUCCESS);
+	MM.with_quickmapped(zero_page, [&](void* ptr) {
+		for(size_t i = 0; i < num_slots; i++) {
+			ssize_t nwritten = inode->write(i * PAGE_SIZE, PAGE_SIZE, KernelPointer<uint8_t>((uint8_t*) ptr), file.get());
+			if(nwritten != PAGE_SIZE) {
+				result = Result(nwritten < 0 ? -nwritten : EIO);
+				return;
+			}
+		}
+	});
+	MM.get_physical_page(zero_page).unref();
+	if(result.is_error())
+		return result;
+
+	s_inst = new Swap(kstd::move(file), kstd::move(inode), kstd::Arc<BlockDevice>(nullptr), num_slots);
+	KLog::info("Swap", "Swapping to a %dKiB file", (int) (num_slots * PAGE_SIZE / 1024));
+	return Result(SUCCESS);
+}
+
+Result Swap::enable_device(kstd::Arc<FileDescriptor> file) {
+	// Block devices don't need their space allocated first, but we do need to know how big they are
+	auto metadata = file->metadata();
+	auto device_res = Device::get_device(metadata.dev_major, metadata.dev_minor);
+	if(device_res.is_error() || !device_res.value()->is_block_device())
+		return Result(ENODEV);
+	auto device = kstd::static_pointer_cast<BlockDevice>(device_res.value());
+	size_t block_size = device->block_size();
+	if(!block_size || block_size > PAGE_SIZE || PAGE_SIZE % block_size)
+		return Result(EINVAL);
+	size_t num_slots = device->num_blocks() / (PAGE_SIZE / block_size);
+	if(!num_slots)
+		return Result(EINVAL);
+
+	s_inst = new Swap(kstd::move(file), kstd::Arc<Inode>(nullptr), kstd::move(device), num_slots);
+	KLog::info("Swap", "Swapping to a %dKiB block device", (int) (num_slots * PAGE_SIZE / 1024));
+	return Result(SUCCESS);
+}
+
+ResultRet<SwapSlot> Swap::write_page(PageIndex page) {
+	// Find a free slot
+	size_t slot_index;
+	{
+		LOCK(m_lock);
+		if(m_num_used_slots == m_num_slots)
+			return Result(ENOSPC);
+		slot_index = m_next_slot;
+		while(m_used_slots.get(slot_index))
+			slot_index = (slot_index + 1) % m_num_slots;
+		m_used_slots.set(slot_index, true);
+		m_num_used_slots++;
+		m_next_slot = (slot_index + 1) % m_num_slots;
+	}
+
+	Result result = Result(SUCCESS);
+	MM.with_quickmapped(page, [&](void* ptr) {
+		result = write_slot(slot_index, (uint8_t*) ptr);
+	});
+	if(result.is_error()) {
+		free_slot(slot_index + 1);
+		return result;
+	}
+
+	return (SwapSlot) (slot_index + 1);
+}
+
+Result Swap::read_page(SwapSlot slot, PageIndex page) {
+	ASSERT(slot && slot <= m_num_slots);
+	Result result = Result(SUCCESS);
+	MM.with_quickmapped(page, [&](void* ptr) {
+		result = read_slot(slot - 1, (uint8_t*) ptr);
+	});
+	return result;
+}
+
+void Swap::free_slot(SwapSlot slot) {
+	ASSERT(slot && slot <= m_num_slots);
+	{
+		LOCK(m_lock);
+		ASSERT(m_used_slots.get(slot - 1));
+		m_used_slots.set(slot - 1, false);
+		m_num_used_slots--;
+	}
+	if(m_device)
+		m_device->discard_blocks((slot - 1) * m_blocks_per_slot, m_blocks_per_slot);
+}
+
+Result Swap::write_slot(size_t index, const uint8_t* data) {
+	if(m_device) {
+		if(m_device->write_blocks(index * m_blocks_per_slot, m_blocks_per_slot, data).is_error())
+			return Result(EIO);
+		return Result(SUCCESS);
+	}
+	ssize_t nwritten = m_inode->write(index * PAGE_SIZE, PAGE_SIZE, KernelPointer<uint8_t>((uint8_t*) data), m_file.get());
+	if(nwritten != PAGE_SIZE)
+		return Result(nwritten < 0 ? -nwritten : EIO);
+	return Result(SUCCESS);
+}
+
+Result Swap::read_slot(size_t index, uint8_t* data) {
+	if(m_device) {
+		if(m_device->read_blocks(index * m_blocks_per_slot, m_blocks_per_slot, data).is_error())
+			return Result(EIO);
+		return Result(SUCCESS);
+	}
+	ssize_t nread = m_inode->read(index * PAGE_SIZE, PAGE_SIZE, KernelPointer<uint8_t>(data), m_file.get());
+	if(nread != PAGE_SIZE)
+		return Result(nread < 0 ? -nread : EIO);
+	return Result(SUCCESS);
+}
+
+size_t Swap::total_bytes() {
+	return s_inst ? s_inst->m_num_slots * PAGE_SIZE : 0;
+}
+
+size_t Swap::used_bytes() {
+	return s_inst ? s_inst->m_num_used_slots * PAGE_SIZE : 0;
+}
@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "Memory.h"
+#include "../kstd/Arc.h"
+#include "../kstd/Bitmap.h"
+#include "../tasking/SpinLock.h"
+#include "../Result.hpp"
+
+class FileDescriptor;
+class Inode;
+class BlockDevice;
+
+/// A page-sized slot in the swap file. Slots are numbered starting from 1, so that 0 can mean "not swapped out".
+typedef uint32_t SwapSlot;
+
+/**
+ * A file or block device that anonymous pages are written out to when memory is low. It's split up into page-sized
+ * slots, and a bitmap keeps track of which slots are in use.
+ */
+class Swap {
+public:
+	/// Returns the swap file in use, or nullptr if swapping hasn't been enabled.
+	static Swap* inst();
+
+	/**
+	 * Starts swapping to a file or block device. A file is written over first so that its blocks are allocated up front,
+	 * since allocating them while swapping pages out would need more memory. Only one swap file can be used.
+	 * @param file The file or device to swap to. Its size (rounded down to a page) determines how much swap space there is.
+	 */
+	static Result enable(kstd::Arc<FileDescriptor> file);
+
+	/**
+	 * Writes a page out to a free slot.
+	 * @param page The physical page to write out.
+	 * @return The slot the page was written to.
+	 */
+	ResultRet<SwapSlot> write_page(PageIndex page);
+
+	/**
+	 * Reads a page back in from a slot. The slot isn't freed.
+	 * @param slot The slot to read from.
+	 * @param page The physical page to read into.
+	 */
+	Result read_page(SwapSlot slot, PageIndex page);
+
+	/** Marks a slot as free, and lets the device know it can forget what was in it. **/
+	void free_slot(SwapSlot slot);
+
+	size_t num_slots() const { return m_num_slots; }
+	size_t num_free_slots() const { return m_num_slots - m_num_used_slots; }
+
+	// Usage statistics. These are zero if swapping isn't enabled.
+	static size_t total_bytes();
+	static size_t used_bytes();
+
+private:
+	Swap(kstd::Arc<FileDescriptor> file, kstd::Arc<Inode> inode, kstd::Arc<BlockDevice> device, size_t num_slots);
+
+	static Result enable_device(kstd::Arc<FileDescriptor> file);
+	Result write_slot(size_t index, const uint8_t* data);
+	Result read_slot(size_t index, uint8_t* data);
+
+	static Swap* s_inst;
+
+	kstd::Arc<FileDescriptor> m_file;
+	kstd::Arc<Inode> m_inode; ///< Swapping reads and writes the inode directly, so swapped pages don't end up in its page cache.
+	kstd::Arc<BlockDevice> m_device; ///< Set instead of m_inode when swapping to a block device.
+	size_t m_blocks_per_slot = 0;
+	SpinLock m_lock;
+	kstd::Bitmap m_used_slots;
+	size_t m_num_slots;
+	size_t m_num_used_slots = 0;
+	size_t m_next_slot = 0; ///< Where to start looking for a free slot.
+};
@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "TLBFlush.h"
+#include "MemoryManager.h"
+#include <kernel/tasking/Processor.h>
+
+TLBFlush::~TLBFlush() {
+	flush();
+}
+
+void TLBFlush::add(VirtualAddress address) {
+	add(VirtualRange { address, PAGE_SIZE });
+}
+
+void TLBFlush::add(VirtualRange range) {
+	if(m_flush_all)
+		return;
+
+	VirtualAddress start = (range.start / PAGE_SIZE) * PAGE_SIZE;
+	size_t num_pages = kstd::ceil_div(range.end() - start, PAGE_SIZE);
+	m_num_pages += num_pages;
+	if(m_num_pages > TLB_FLUSH_MAX_PAGES) {
+		m_flush_all = true;
+		return;
+	}
+
+	// Merge with the last range if this one continues on from it
+	if(m_num_ranges) {
+		auto& last = m_ranges[m_num_ranges - 1];
+		if(last.start + last.num_pages * PAGE_SIZE == start) {
+			last.num_pages += num_pages;
+			return;
+		}
+	}
+
+	if(m_num_ranges == TLB_FLUSH_MAX_RANGES) {
+		m_flush_all = true;
+		return;
+	}
+	m_ranges[m_num_ranges++] = {start, num_pages};
+}
+
+void TLBFlush::flush() {
+	// Only this processor gets flushed. Threads only ever run on the boot processor, and the application processors are
+	// parked as soon as they start (see Processor), so no other processor will use these mappings and none of them is
+	// sent a shootdown IPI.
+	ASSERT(Processor::count() == 1);
+
+	if(m_flush_all) {
+		asm volatile(
+			"mov %%cr3, %%eax\n"
+			"mov %%eax, %%cr3\n"
+			::: "eax", "memory");
+	} else {
+		for(size_t i = 0; i < m_num_ranges; i++) {
+			for(size_t page = 0; page < m_ranges[i].num_pages; page++)
+				MemoryManager::inst().invlpg((void*) (m_ranges[i].start + page * PAGE_SIZE));
+		}
+	}
+
+	m_num_ranges = 0;
+	m_num_pages = 0;
+	m_flush_all = false;
+}
@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "Memory.h"
+
+// The number of separate ranges a TLBFlush can hold before it gives up and flushes everything.
+#define TLB_FLUSH_MAX_RANGES 8
+// The number of pages past which it's cheaper to flush the whole TLB than to invalidate each page.
+#define TLB_FLUSH_MAX_PAGES 64
+
+/**
+ * Collects the pages whose mappings were changed so that they can be invalidated in the TLB all at once. If enough are
+ * collected that invalidating them one by one would be slower than flushing everything, the whole TLB is flushed by
+ * reloading CR3 instead. Pages are invalidated when flush() is called or the batch goes out of scope.
+ */
+class TLBFlush {
+public:
+	TLBFlush() = default;
+	TLBFlush(const TLBFlush& other) = delete;
+	~TLBFlush();
+
+	/// Adds the page containing the given address to the batch.
+	void add(VirtualAddress address);
+	/// Adds the pages in the given range to the batch.
+	void add(VirtualRange range);
+	/// Invalidates everything in the batch and empties it.
+	void flush();
+
+private:
+	struct Range {
+		VirtualAddress start;
+		size_t num_pages;
+	};
+
+	Range m_ranges[TLB_FLUSH_MAX_RANGES];
+	size_t m_num_ranges = 0;
+	size_t m_num_pages = 0;
+	bool m_flush_all = false;
+};
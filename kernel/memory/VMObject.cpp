@@ -3,6 +3,8 @@
 
 #include "VMObject.h"
 #include "MemoryManager.h"
+#include "VMRegion.h"
+#include "VMSpace.h"
 
 VMObject::VMObject(kstd::vector<PageIndex> physical_pages, bool all_cow):
 	m_physical_pages(kstd::move(physical_pages)),
@@ -35,11 +37,16 @@ Result VMObject::try_cow_page(PageIndex page) {
 	if(!page_is_cow(page))
 		return Result(EINVAL);
 
-	// Copy the page
+	// Copy the page. There's nothing to copy from the zero page, so just grab a zeroed one instead.
 	auto& old_page = m_physical_pages[page];
 	ASSERT(old_page);
-	auto new_page = TRY(MM.alloc_physical_page());
-	MM.copy_page(old_page, new_page);
+	PageIndex new_page;
+	if(old_page == MM.zero_page()) {
+		new_page = TRY(MM.alloc_physical_page(true));
+	} else {
+		new_page = TRY(MM.alloc_physical_page());
+		MM.copy_page(old_page, new_page);
+	}
 
 	// Unref the old page and replace it with the new one
 	MM.get_physical_page(old_page).unref();
@@ -55,6 +62,95 @@ ResultRet<kstd::Arc<VMObject>> VMObject::clone() {
 	ASSERT(false);
 }
 
+void VMObject::add_region(VMRegion* region) {
+	LOCK(m_regions_lock);
+	if(region->m_in_object)
+		return;
+	region->m_prev_in_object = nullptr;
+	region->m_next_in_object = m_regions;
+	if(m_regions)
+		m_regions->m_prev_in_object = region;
+	m_regions = region;
+	region->m_in_object = true;
+}
+
+void VMObject::remove_region(VMRegion* region) {
+	LOCK(m_regions_lock);
+	if(!region->m_in_object)
+		return;
+	if(region->m_prev_in_object)
+		region->m_prev_in_object->m_next_in_object = region->m_next_in_object;
+	else
+		m_regions = region->m_next_in_object;
+	if(region->m_next_in_object)
+		region->m_next_in_object->m_prev_in_object = region->m_prev_in_object;
+	region->m_next_in_object = nullptr;
+	region->m_prev_in_object = nullptr;
+	region->m_in_object = false;
+}
+
+void VMObject::drop_page(PageIndex index) {
+	ASSERT(index < m_physical_pages.size());
+	auto& page = m_physical_pages[index];
+	if(!page)
+		return;
+
+	// Unmap it first so nothing can use it after it's freed
+	unmap_page(index);
+	MM.get_physical_page(page).unref();
+	page = 0;
+	m_cow_pages.set(index, false);
+}
+
+void VMObject::unmap_page(PageIndex index) {
+	LOCK(m_regions_lock);
+	size_t offset = index * PAGE_SIZE;
+	for(auto region = m_regions; region; region = region->m_next_in_object) {
+		if(offset < region->object_start() || offset >= region->object_start() + region->size())
+			continue;
+		region->m_space.with_locked([&](const kstd::Arc<VMSpace>& space) {
+			space->page_directory().unmap(*region, VirtualRange { offset - region->object_start(), PAGE_SIZE });
+		});
+	}
+}
+
+bool VMObject::test_and_clear_accessed(PageIndex index) {
+	LOCK(m_regions_lock);
+	size_t offset = index * PAGE_SIZE;
+	bool accessed = false;
+	for(auto region = m_regions; region; region = region->m_next_in_object) {
+		if(offset < region->object_start() || offset >= region->object_start() + region->size())
+			continue;
+		region->m_space.with_locked([&](const kstd::Arc<VMSpace>& space) {
+			if(space->page_directory().test_and_clear_accessed(region->start() + offset - region->object_start()))
+				accessed = true;
+		});
+	}
+	return accessed;
+}
+
+bool VMObject::mapped_in_kernel() {
+	LOCK(m_regions_lock);
+	for(auto region = m_regions; region; region = region->m_next_in_object) {
+		if(region->is_kernel())
+			return true;
+	}
+	return false;
+}
+
+bool VMObject::has_regions() {
+	LOCK(m_regions_lock);
+	return m_regions;
+}
+
+size_t VMObject::num_regions() {
+	LOCK(m_regions_lock);
+	size_t count = 0;
+	for(auto region = m_regions; region; region = region->m_next_in_object)
+		count++;
+	return count;
+}
+
 void VMObject::become_cow_and_ref_pages() {
 	LOCK(m_page_lock);
 	for(size_t i = 0; i < m_physical_pages.size(); i++) {
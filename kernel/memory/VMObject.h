@@ -10,6 +10,9 @@
 #include "../api/errno.h"
 #include "../kstd/Bitmap.h"
 #include "../tasking/SpinLock.h"
+#include "../tasking/Mutex.h"
+
+class VMRegion;
 
 /**
  * This is a base class to describe a (contiguous) object in virtual memory. This object may be shared across multiple
@@ -42,12 +45,43 @@ public:
 	/** Clones this VMObject using all the same physical pages and properties. **/
 	virtual ResultRet<kstd::Arc<VMObject>> clone();
 
+	/** The lock for the object's pages. Pages may only be mapped from or dropped from the object with this held. **/
+	Mutex& lock() { return m_page_lock; }
+
+	/** Keeps track of the regions the object is in, so that pages dropped from the object can be unmapped. **/
+	virtual void add_region(VMRegion* region);
+	virtual void remove_region(VMRegion* region);
+	/** Returns how many regions the object is in. **/
+	size_t num_regions();
+	/** Marks the object as having been mapped writable, meaning its pages may have been written to. **/
+	void mark_written() { m_written = true; }
+	/** Whether the object has ever been mapped writable. **/
+	bool written() const { return m_written; }
+
 protected:
 	/** Marks every page in this object as CoW, and increases the reference count of all pages by 1. **/
 	void become_cow_and_ref_pages();
 
+	/**
+	 * Drops the page at the given index from the object, unmapping it from every region the object is in and freeing it
+	 * if nothing else is using it. Should be called with the object's lock held.
+	 */
+	void drop_page(PageIndex index);
+	/** Unmaps the page at the given index from every region the object is in. **/
+	void unmap_page(PageIndex index);
+	/** Returns whether the page at the given index was accessed through any region since the last call, and resets it. **/
+	bool test_and_clear_accessed(PageIndex index);
+	/** Returns whether the object is mapped into kernel space. **/
+	bool mapped_in_kernel();
+	/** Returns whether the object is in any regions. **/
+	bool has_regions();
 	kstd::vector<PageIndex> m_physical_pages;
 	kstd::Bitmap m_cow_pages;
 	size_t m_size;
-	SpinLock m_page_lock;
+	Mutex m_page_lock;
+
+private:
+	SpinLock m_regions_lock;
+	VMRegion* m_regions = nullptr;
+	bool m_written = false;
 };
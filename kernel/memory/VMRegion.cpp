@@ -3,6 +3,7 @@
 
 #include "VMRegion.h"
 #include "MemoryManager.h"
+#include "AnonymousVMObject.h"
 
 VMProt VMProt::R = {
 		.read = true,
@@ -28,14 +29,27 @@ VMProt VMProt::RWX = {
 		.execute = true
 };
 
+static VMRegion::MemoryKind memory_kind_for(VMObject& object) {
+	if(object.is_inode())
+		return VMRegion::MemoryKind::File;
+	if(!object.is_anonymous())
+		return VMRegion::MemoryKind::Other;
+	if(((AnonymousVMObject&) object).is_shared() || object.fork_action() == VMObject::ForkAction::Share)
+		return VMRegion::MemoryKind::Shared;
+	return VMRegion::MemoryKind::Anonymous;
+}
+
 VMRegion::VMRegion(kstd::Arc<VMObject> object, kstd::Arc<VMSpace> space, VirtualRange range, size_t object_start, VMProt prot):
 	m_object(object),
 	m_space(space),
 	m_range(range),
 	m_object_start(object_start),
-	m_prot(prot)
+	m_prot(prot),
+	m_memory_kind(memory_kind_for(*object))
 {
-
+	if(prot.write)
+		m_object->mark_written();
+	m_object->add_region(this);
 }
 
 VMRegion::~VMRegion() {
@@ -43,8 +57,11 @@ VMRegion::~VMRegion() {
 		auto unmap_res = space->unmap_region(*this);
 		ASSERT(unmap_res.is_success());
 	});
+	m_object->remove_region(this);
 }
 
 void VMRegion::set_prot(VMProt prot) {
+	if(prot.write)
+		m_object->mark_written();
 	m_prot = prot;
 }
\ No newline at end of file
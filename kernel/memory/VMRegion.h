@@ -6,6 +6,7 @@
 #include "Memory.h"
 #include "VMObject.h"
 #include "../kstd/Arc.h"
+#include "SlabCache.h"
 
 struct VMProt {
 	static VMProt RWX;
@@ -22,8 +23,17 @@ class VMSpace;
 /**
  * This class describes a region in virtual memory in a specific address space.
  */
-class VMRegion: public kstd::ArcSelf<VMRegion> {
+class VMRegion: public kstd::ArcIntrusive<VMRegion> {
+	SLAB_ALLOCATED(VMRegion)
 public:
+	/** What the region's pages count as in the resident memory stats of the space it's in. **/
+	enum class MemoryKind: uint8_t {
+		Anonymous, ///< Private anonymous memory.
+		Shared, ///< Anonymous memory that's shared with other processes.
+		File,
+		Other ///< Anything else, like device memory.
+	};
+
 	/**
 	 * Creates a new virtual memory region.
 	 * @param object The VMObject that this region corresponds to.
@@ -43,12 +53,19 @@ public:
 	bool contains(VirtualAddress address) const { return m_range.contains(address); }
 	VMProt prot() const { return m_prot; }
 	void set_prot(VMProt prot);
+	/** Decided when the region is created, so that its pages are counted the same way when unmapped as when mapped. **/
+	MemoryKind memory_kind() const { return m_memory_kind; }
 
 private:
 	friend class VMSpace;
+	friend class VMObject;
 	kstd::Arc<VMObject> m_object; /// The object this VMRegion is associated with.
 	kstd::Weak<VMSpace> m_space; /// The VMSpace this region belongs to.
 	VirtualRange m_range; /// Where in the VMSpace this region resides.
 	size_t m_object_start; /// Where in the VMObject this region begins.
 	VMProt m_prot; /// The protection of this region.
+	MemoryKind m_memory_kind;
+	VMRegion* m_next_in_object = nullptr; /// The next region in the object's list of regions.
+	VMRegion* m_prev_in_object = nullptr;
+	bool m_in_object = false;
 };
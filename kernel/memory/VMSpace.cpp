@@ -6,6 +6,8 @@
 #include "AnonymousVMObject.h"
 #include "../kstd/cstring.h"
 #include "InodeVMObject.h"
+#include "Readahead.h"
+#include "Prefetch.h"
 #include "../kstd/KLog.h"
 
 const VMProt VMSpace::default_prot = {
@@ -17,9 +19,12 @@ const VMProt VMSpace::default_prot = {
 VMSpace::VMSpace(VirtualAddress start, size_t size, PageDirectory& page_directory):
 	m_start(start),
 	m_size(size),
-	m_region_map(new VMSpaceRegion {.start = start, .size = size, .used = false, .next = nullptr, .prev = nullptr}),
+	m_region_map(new VMSpaceRegion {.start = start, .size = size, .used = false, .next = nullptr, .prev = nullptr, .vmRegion = nullptr}),
+	m_region_tree(nullptr),
 	m_page_directory(page_directory)
-{}
+{
+	tree_insert(m_region_map);
+}
 
 VMSpace::~VMSpace() {
 	auto cur_region = m_region_map;
@@ -35,6 +40,7 @@ kstd::Arc<VMSpace> VMSpace::fork(PageDirectory& page_directory, kstd::vector<kst
 	auto new_space = kstd::Arc<VMSpace>(new VMSpace(m_start, m_size, page_directory));
 	new_space->m_used = m_used;
 	delete new_space->m_region_map;
+	new_space->m_region_tree = nullptr;
 
 	// Clone regions
 	auto cur_region = m_region_map;
@@ -48,6 +54,7 @@ kstd::Arc<VMSpace> VMSpace::fork(PageDirectory& page_directory, kstd::vector<kst
 		if(prev_new_region)
 			prev_new_region->next = new_region;
 		prev_new_region = new_region;
+		new_space->tree_insert(new_region);
 
 		// Clone the vmRegion
 		if(cur_region->vmRegion) {
@@ -71,7 +78,11 @@ kstd::Arc<VMSpace> VMSpace::fork(PageDirectory& page_directory, kstd::vector<kst
 							new_space,
 							region->range(), region->object_start(),
 							region->prot());
-					page_directory.map(*new_vmRegion);
+					// Shared regions never need copying, so they're mapped right away. Private ones aren't mapped into the
+					// new directory yet; their pages will be mapped as they're faulted on. Most forks exec right away, so
+					// this saves building page tables that would just be thrown out.
+					if(region->object()->fork_action() == VMObject::ForkAction::Share)
+						page_directory.map(*new_vmRegion);
 					new_region->vmRegion = new_vmRegion.get();
 					regions_vec.push_back(new_vmRegion);
 					break;
@@ -87,7 +98,7 @@ kstd::Arc<VMSpace> VMSpace::fork(PageDirectory& page_directory, kstd::vector<kst
 	return new_space;
 }
 
-ResultRet<kstd::Arc<VMRegion>> VMSpace::map_object(kstd::Arc<VMObject> object, VMProt prot, VirtualRange range, VirtualAddress object_start) {
+ResultRet<kstd::Arc<VMRegion>> VMSpace::map_object(kstd::Arc<VMObject> object, VMProt prot, VirtualRange range, VirtualAddress object_start, bool map_pages) {
 	// Use the size of the range if defined, or the remainder of the object size if not.
 	if(!range.size)
 		range.size = object->size() - object_start;
@@ -97,11 +108,23 @@ ResultRet<kstd::Arc<VMRegion>> VMSpace::map_object(kstd::Arc<VMObject> object, V
 		return Result(EINVAL);
 
 	// Allocate the space region appropriately
-	VMSpaceRegion* region;
-	if(range.start)
+	VMSpaceRegion* region = nullptr;
+	if(range.start) {
 		region = TRY(alloc_space_at(range.size, range.start));
-	else
-		region = TRY(alloc_space(range.size));
+	} else {
+		// If the object looks physically contiguous, try to line it up with a 4MiB boundary so it can use large pages
+		if(range.size >= LARGE_PAGE_SIZE) {
+			PageIndex first_page = object->physical_page(object_start / PAGE_SIZE).index();
+			PageIndex last_page = object->physical_page((object_start + range.size) / PAGE_SIZE - 1).index();
+			if(first_page && last_page == first_page + range.size / PAGE_SIZE - 1) {
+				auto region_res = alloc_space_large_aligned(range.size, (first_page * PAGE_SIZE) % LARGE_PAGE_SIZE);
+				if(!region_res.is_error())
+					region = region_res.value();
+			}
+		}
+		if(!region)
+			region = TRY(alloc_space(range.size));
+	}
 
 	// Create and map the region
 	auto vmRegion = kstd::make_shared<VMRegion>(
@@ -111,7 +134,16 @@ ResultRet<kstd::Arc<VMRegion>> VMSpace::map_object(kstd::Arc<VMObject> object, V
 			object_start,
 			prot);
 	region->vmRegion = vmRegion.get();
-	m_page_directory.map(*vmRegion);
+	if(!map_pages)
+		return vmRegion;
+
+	// Inode and anonymous objects can have pages dropped by reclaim, so hold the object's lock while mapping its pages
+	if(object->is_inode() || object->is_anonymous()) {
+		LOCK(object->lock());
+		m_page_directory.map(*vmRegion);
+	} else {
+		m_page_directory.map(*vmRegion);
+	}
 	return vmRegion;
 }
 
@@ -119,11 +151,7 @@ ResultRet<kstd::Arc<VMRegion>> VMSpace::map_stack(kstd::Arc<VMObject> object, VM
 	LOCK(m_lock);
 
 	// Find the endmost region with space in it
-	auto cur_region = m_region_map;
-	while(cur_region->next)
-		cur_region = cur_region->next;
-	while((cur_region->used || cur_region->size < object->size()) && cur_region)
-		cur_region = cur_region->prev;
+	auto cur_region = find_last_fit(object->size());
 	if(!cur_region)
 		return Result(ENOMEM);
 	return map_object(object, prot, {cur_region->end() - object->size(), object->size()});
@@ -131,21 +159,15 @@ ResultRet<kstd::Arc<VMRegion>> VMSpace::map_stack(kstd::Arc<VMObject> object, VM
 
 Result VMSpace::unmap_region(VMRegion& region) {
 	m_lock.acquire();
-	VMSpaceRegion* cur_region = m_region_map;
-	while(cur_region) {
-		if(cur_region->vmRegion == &region) {
-			if(cur_region->vmRegion) {
-				cur_region->vmRegion->m_space.reset();
-				m_page_directory.unmap(*cur_region->vmRegion);
-				m_lock.release();
-				auto free_res = free_region(cur_region);
-				ASSERT(!free_res.is_error());
-				return free_res;
-			}
-			m_lock.release();
-			return Result(ENOENT);
-		}
-		cur_region = cur_region->next;
+	auto cur_region = find_region_containing(region.start());
+	if(cur_region && cur_region->vmRegion == &region) {
+		m_page_directory.unmap(*cur_region->vmRegion);
+		cur_region->vmRegion->m_object->remove_region(cur_region->vmRegion);
+		cur_region->vmRegion->m_space.reset();
+		m_lock.release();
+		auto free_res = free_region(cur_region);
+		ASSERT(!free_res.is_error());
+		return free_res;
 	}
 	m_lock.release();
 	return Result(ENOENT);
@@ -153,51 +175,33 @@ Result VMSpace::unmap_region(VMRegion& region) {
 
 Result VMSpace::unmap_region(VirtualAddress address) {
 	m_lock.acquire();
-	VMSpaceRegion* cur_region = m_region_map;
-	while(cur_region) {
-		if(cur_region->start == address) {
-			if(cur_region->vmRegion) {
-				cur_region->vmRegion->m_space.reset();
-				m_page_directory.unmap(*cur_region->vmRegion);
-				m_lock.release();
-				auto free_res = free_region(cur_region);
-				ASSERT(!free_res.is_error());
-				return free_res;
-			}
-			m_lock.release();
-			return Result(ENOENT);
-		}
-		cur_region = cur_region->next;
+	auto cur_region = find_region_containing(address);
+	if(cur_region && cur_region->start == address && cur_region->vmRegion) {
+		m_page_directory.unmap(*cur_region->vmRegion);
+		cur_region->vmRegion->m_object->remove_region(cur_region->vmRegion);
+		cur_region->vmRegion->m_space.reset();
+		m_lock.release();
+		auto free_res = free_region(cur_region);
+		ASSERT(!free_res.is_error());
+		return free_res;
 	}
 	m_lock.release();
 	return Result(ENOENT);
 }
 
 ResultRet<kstd::Arc<VMRegion>> VMSpace::get_region_at(VirtualAddress address) {
-	LOCK(m_lock);
-	VMSpaceRegion* cur_region = m_region_map;
-	while(cur_region) {
-		if(cur_region->start == address) {
-			if(cur_region->vmRegion)
-				return cur_region->vmRegion->self();
-			return Result(ENOENT);
-		}
-		cur_region = cur_region->next;
-	}
+	READ_LOCK(m_lock);
+	auto cur_region = find_region_containing(address);
+	if(cur_region && cur_region->start == address && cur_region->vmRegion)
+		return cur_region->vmRegion->self();
 	return Result(ENOENT);
 }
 
 ResultRet<kstd::Arc<VMRegion>> VMSpace::get_region_containing(VirtualAddress address) {
-	LOCK(m_lock);
-	VMSpaceRegion* cur_region = m_region_map;
-	while(cur_region) {
-		if(cur_region->contains(address)) {
-			if(cur_region->vmRegion)
-				return cur_region->vmRegion->self();
-			return Result(ENOENT);
-		}
-		cur_region = cur_region->next;
-	}
+	READ_LOCK(m_lock);
+	auto cur_region = find_region_containing(address);
+	if(cur_region && cur_region->vmRegion)
+		return cur_region->vmRegion->self();
 	return Result(ENOENT);
 }
 
@@ -207,98 +211,163 @@ Result VMSpace::reserve_region(VirtualAddress start, size_t size) {
 }
 
 Result VMSpace::try_pagefault(PageFault fault) {
-	LOCK(m_lock);
-	auto cur_region = m_region_map;
-	while(cur_region) {
-		if(cur_region->contains(fault.address)) {
-			auto vmRegion = cur_region->vmRegion;
-			if(!vmRegion)
-				return Result(EINVAL);
-
-			// First, sanity check. If the region doesn't have the proper permissions, we can just fail here.
-			auto prot = vmRegion->prot();
-			if(
-				(!prot.read && fault.type == PageFault::Type::Read) ||
-				(!prot.write && fault.type == PageFault::Type::Write) ||
-				(!prot.execute && fault.type == PageFault::Type::Execute)
-			) {
-				return Result(EINVAL);
-			}
-
-			PageIndex error_page = (fault.address - vmRegion->start()) / PAGE_SIZE;
-
-			// Check if the region is a mapped inode.
-			if(vmRegion->object()->is_inode()) {
-				PageIndex inode_page = error_page + (vmRegion->object_start() / PAGE_SIZE);
-				auto inode_object = kstd::static_pointer_cast<InodeVMObject>(vmRegion->object());
-
-				// Check to see if it needs to be read in
-				LOCK_N(inode_object->lock(), inode_locker);
-				if(inode_object->physical_page_index(inode_page)) {
-					// This page may be marked CoW, so copy it if it is
-					if(vmRegion->prot().write && inode_object->page_is_cow(inode_page)) {
-						auto res = vmRegion->m_object->try_cow_page(inode_page);
-						if(res.is_error())
-							return res;
-					}
+	READ_LOCK(m_lock);
+	auto cur_region = find_region_containing(fault.address);
+	if(!cur_region)
+		return Result(ENOENT);
 
-					// Or, we may have encountered a race where the page was created by another thread after the fault.
-					m_page_directory.map(*vmRegion, VirtualRange { inode_page * PAGE_SIZE, PAGE_SIZE });
-					return Result(SUCCESS);
-				}
+	auto vmRegion = cur_region->vmRegion;
+	if(!vmRegion)
+		return Result(EINVAL);
 
-				// Otherwise, read in the page and map it
-				auto did_read = TRY(inode_object->read_page_if_needed(inode_page));
-				ASSERT(inode_object->physical_page_index(inode_page));
-				if(did_read)
-					m_page_directory.map(*vmRegion, VirtualRange { error_page * PAGE_SIZE, PAGE_SIZE });
+	// First, sanity check. If the region doesn't have the proper permissions, we can just fail here.
+	auto prot = vmRegion->prot();
+	if(
+		(!prot.read && fault.type == PageFault::Type::Read) ||
+		(!prot.write && fault.type == PageFault::Type::Write) ||
+		(!prot.execute && fault.type == PageFault::Type::Execute)
+	) {
+		return Result(EINVAL);
+	}
 
-				return Result(SUCCESS);
+	PageIndex error_page = (fault.address - vmRegion->start()) / PAGE_SIZE;
+
+	// Check if the region is a mapped inode.
+	if(vmRegion->object()->is_inode()) {
+		PageIndex inode_page = error_page + (vmRegion->object_start() / PAGE_SIZE);
+		auto inode_object = kstd::static_pointer_cast<InodeVMObject>(vmRegion->object());
+
+		// Check to see if it needs to be read in
+		LOCK_N(inode_object->lock(), inode_locker);
+		if(inode_object->physical_page_index(inode_page)) {
+			// This page may be marked CoW, so copy it if it is. Otherwise, it was either read ahead, or we encountered
+			// a race where the page was created by another thread after the fault.
+			if(vmRegion->prot().write && inode_object->page_is_cow(inode_page)) {
+				auto res = vmRegion->m_object->try_cow_page(inode_page);
+				if(res.is_error())
+					return res;
 			}
+		} else {
+			// Otherwise, read in the page
+			TRY(inode_object->read_page_if_needed(inode_page));
+			ASSERT(inode_object->physical_page_index(inode_page));
+		}
 
-			// CoW if the region is writeable.
-			if(vmRegion->prot().write) {
-				auto result = vmRegion->m_object->try_cow_page(error_page);
-				if(result.is_success())
-					m_page_directory.map(*vmRegion, VirtualRange { error_page * PAGE_SIZE, PAGE_SIZE });
-				return result;
-			}
+		// Map the page, along with any of its neighbours that have already been read in so they don't fault too
+		PageIndex around_start = error_page;
+		PageIndex around_end = error_page + 1;
+		auto fault_around = Readahead::fault_around_pages();
+		if(fault_around > 1) {
+			PageIndex object_offset = vmRegion->object_start() / PAGE_SIZE;
+			PageIndex region_pages = min(vmRegion->size() / PAGE_SIZE, inode_object->page_count() - object_offset);
+			around_start = error_page - (error_page % fault_around);
+			around_end = max(min(around_start + fault_around, region_pages), error_page + 1);
+		}
+		m_page_directory.map(*vmRegion, VirtualRange { around_start * PAGE_SIZE, (around_end - around_start) * PAGE_SIZE });
+
+		// The pages mapped around the fault won't fault themselves, so they're recorded as used along with it
+		Prefetch::record(*inode_object, around_start + vmRegion->object_start() / PAGE_SIZE, around_end - around_start);
+		inode_object->readahead_after(inode_page);
+		return Result(SUCCESS);
+	}
 
+	// Otherwise, the page should already exist in the object. It may not be mapped yet if the space was forked, or it
+	// may have been purged or swapped out from an anonymous object, in which case it's paged back in. Pages that are
+	// only being read can be left as the zero page until they're written to.
+	PageIndex object_page = error_page + (vmRegion->object_start() / PAGE_SIZE);
+	LOCK_N(vmRegion->object()->lock(), object_locker);
+	if(!vmRegion->object()->physical_page(object_page).index()) {
+		if(!vmRegion->object()->is_anonymous())
 			return Result(EINVAL);
+		auto anon_object = kstd::static_pointer_cast<AnonymousVMObject>(vmRegion->object());
+		auto fill_res = fault.type == PageFault::Type::Write ? anon_object->page_in(object_page) : anon_object->page_in_for_read(object_page);
+		if(fill_res.is_error())
+			return fill_res;
+	}
+
+	// CoW if we're writing to a CoW page. Writing to a page that isn't writeable was already ruled out above. Anonymous
+	// pages can be CoW within a single object (the zero page, or merged pages) that other regions may be mapping too, so
+	// those regions have to be made to fault on the new page.
+	if(fault.type == PageFault::Type::Write && vmRegion->object()->page_is_cow(object_page)) {
+		if(vmRegion->object()->is_anonymous()) {
+			auto res = kstd::static_pointer_cast<AnonymousVMObject>(vmRegion->object())->page_for_write(object_page);
+			if(res.is_error())
+				return res.result();
+		} else {
+			auto res = vmRegion->m_object->try_cow_page(object_page);
+			if(res.is_error())
+				return res;
 		}
-		cur_region = cur_region->next;
 	}
 
-	return Result(ENOENT);
+	// Map any of its neighbours that are already there too, since regions that weren't mapped up front (like attached
+	// shared memory and forked regions) would otherwise fault on every page
+	PageIndex around_start = error_page;
+	PageIndex around_end = error_page + 1;
+	auto fault_around = Readahead::fault_around_pages();
+	if(fault_around > 1) {
+		around_start = error_page - (error_page % fault_around);
+		around_end = min(around_start + fault_around, vmRegion->size() / PAGE_SIZE);
+	}
+	m_page_directory.map(*vmRegion, VirtualRange { around_start * PAGE_SIZE, (around_end - around_start) * PAGE_SIZE });
+	return Result(SUCCESS);
 }
 
-ResultRet<VirtualAddress> VMSpace::find_free_space(size_t size) {
-	LOCK(m_lock);
-	auto cur_region = m_region_map;
-	while(cur_region) {
-		if(!cur_region->used && cur_region->size >= size)
-			return cur_region->start;
-		cur_region = cur_region->next;
+Result VMSpace::populate(VMRegion& region, VirtualRange range) {
+	auto object = region.object();
+	PageIndex start_page = (region.object_start() + range.start) / PAGE_SIZE;
+	size_t num_pages = range.size / PAGE_SIZE;
+
+	LOCK(object->lock());
+	if(object->is_inode()) {
+		// Mappings can go past the end of the file, but there's nothing to read in there
+		auto inode_object = kstd::static_pointer_cast<InodeVMObject>(object);
+		if(start_page < inode_object->page_count())
+			TRY(inode_object->read_pages_if_needed(start_page, min(num_pages, inode_object->page_count() - start_page)));
+	} else if(object->is_anonymous()) {
+		auto anon_object = kstd::static_pointer_cast<AnonymousVMObject>(object);
+		for(size_t i = 0; i < num_pages; i++) {
+			auto res = anon_object->page_in(start_page + i);
+			if(res.is_error())
+				return res;
+		}
 	}
-	return Result(ENOMEM);
+
+	m_page_directory.map(region, range);
+	return Result(SUCCESS);
 }
 
-size_t VMSpace::calculate_regular_anonymous_total() {
-	LOCK(m_lock);
-	size_t total = 0;
-	auto cur_region = m_region_map;
-	while(cur_region) {
-		if(cur_region->used) {
-			auto& object = cur_region->vmRegion->m_object;
-			if(object->is_anonymous()) {
-				auto anon_object = kstd::static_pointer_cast<AnonymousVMObject>(object);
-				if(!anon_object->is_shared())
-					total += anon_object->size();
-			}
+ResultRet<VirtualAddress> VMSpace::find_free_space(size_t size) {
+	READ_LOCK(m_lock);
+	auto cur_region = find_first_fit(size);
+	if(!cur_region)
+		return Result(ENOMEM);
+	return cur_region->start;
+}
+
+size_t VMSpace::calculate_pss() {
+	READ_LOCK(m_lock);
+	uint64_t total = 0;
+	for(auto cur_region = m_region_map; cur_region; cur_region = cur_region->next) {
+		if(!cur_region->used || !cur_region->vmRegion)
+			continue;
+		auto& region = *cur_region->vmRegion;
+		auto& object = region.m_object;
+		if(!object->is_anonymous() && !object->is_inode())
+			continue;
+
+		// A page is shared between every object it's in, and every region those objects are mapped into
+		LOCK(object->lock());
+		size_t num_regions = max(object->num_regions(), (size_t) 1);
+		for(size_t offset = 0; offset < region.size(); offset += PAGE_SIZE) {
+			auto& page = object->physical_page((region.object_start() + offset) / PAGE_SIZE);
+			if(!page.index() || page.allocated.reserved || !m_page_directory.is_mapped(region.start() + offset, false))
+				continue;
+			size_t num_refs = max((size_t) page.allocated.ref_count.load(MemoryOrder::Relaxed), (size_t) 1);
+			total += PAGE_SIZE / (num_refs * num_regions);
 		}
-		cur_region = cur_region->next;
 	}
-	return total;
+	return (size_t) total;
 }
 
 ResultRet<VMSpace::VMSpaceRegion*> VMSpace::alloc_space(size_t size) {
@@ -313,16 +382,12 @@ ResultRet<VMSpace::VMSpaceRegion*> VMSpace::alloc_space(size_t size) {
 
 	{
 		LOCK(m_lock);
-		auto cur_region = m_region_map;
-		while(cur_region) {
-			if(cur_region->used || cur_region->size < size) {
-				cur_region = cur_region->next;
-				continue;
-			}
-
+		auto cur_region = find_first_fit(size);
+		if(cur_region) {
 			if(cur_region->size == size) {
 				cur_region->used = true;
 				m_used += cur_region->size;
+				tree_update(cur_region);
 				delete new_region;
 				return cur_region;
 			}
@@ -332,7 +397,8 @@ ResultRet<VMSpace::VMSpaceRegion*> VMSpace::alloc_space(size_t size) {
 					.size = size,
 					.used = true,
 					.next = cur_region,
-					.prev = cur_region->prev
+					.prev = cur_region->prev,
+					.vmRegion = nullptr
 			};
 
 			if(cur_region->prev)
@@ -345,6 +411,9 @@ ResultRet<VMSpace::VMSpaceRegion*> VMSpace::alloc_space(size_t size) {
 
 			if(m_region_map == cur_region)
 				m_region_map = new_region;
+
+			tree_update(cur_region);
+			tree_insert(new_region);
 			return new_region;
 		}
 	}
@@ -353,6 +422,21 @@ ResultRet<VMSpace::VMSpaceRegion*> VMSpace::alloc_space(size_t size) {
 	return Result(ENOMEM);
 }
 
+ResultRet<VMSpace::VMSpaceRegion*> VMSpace::alloc_space_large_aligned(size_t size, size_t offset) {
+	ASSERT(offset % PAGE_SIZE == 0 && offset < LARGE_PAGE_SIZE);
+	LOCK(m_lock);
+
+	// Find a free region big enough that we can put the allocation at the right offset no matter where it starts
+	auto cur_region = find_first_fit(size + LARGE_PAGE_SIZE - PAGE_SIZE);
+	if(!cur_region)
+		return Result(ENOMEM);
+
+	VirtualAddress address = cur_region->start - (cur_region->start % LARGE_PAGE_SIZE) + offset;
+	if(address < cur_region->start)
+		address += LARGE_PAGE_SIZE;
+	return alloc_space_at(size, address);
+}
+
 ResultRet<VMSpace::VMSpaceRegion*> VMSpace::alloc_space_at(size_t size, VirtualAddress address) {
 	ASSERT(address % PAGE_SIZE == 0);
 	ASSERT(size % PAGE_SIZE == 0);
@@ -367,72 +451,73 @@ ResultRet<VMSpace::VMSpaceRegion*> VMSpace::alloc_space_at(size_t size, VirtualA
 
 	{
 		LOCK(m_lock);
-		auto cur_region = m_region_map;
-		while(cur_region) {
-			if(cur_region->contains(address)) {
-				if(cur_region->used) {
-					delete new_region_before;
-					delete new_region_after;
-					return Result(ENOMEM);
-				}
+		auto cur_region = find_region_containing(address);
+		if(cur_region && !cur_region->used) {
+			if(cur_region->size == size) {
+				cur_region->used = true;
+				m_used += cur_region->size;
+				tree_update(cur_region);
+				delete new_region_before;
+				delete new_region_after;
+				return cur_region;
+			}
 
-				if(cur_region->size == size) {
-					cur_region->used = true;
-					m_used += cur_region->size;
-					delete new_region_before;
-					delete new_region_after;
-					return cur_region;
+			if(cur_region->size - (address - cur_region->start) >= size) {
+				// Create new region before if needed
+				bool needs_before = cur_region->start < address;
+				if(needs_before) {
+					*new_region_before = VMSpaceRegion {
+							.start = cur_region->start,
+							.size = address - cur_region->start,
+							.used = false,
+							.next = cur_region,
+							.prev = cur_region->prev,
+							.vmRegion = nullptr
+					};
+					if(cur_region->prev)
+						cur_region->prev->next = new_region_before;
+					cur_region->prev = new_region_before;
+					if(m_region_map == cur_region)
+						m_region_map = new_region_before;
 				}
 
-				if(cur_region->size - (address - cur_region->start) >= size) {
-					// Create new region before if needed
-					if(cur_region->start < address) {
-						*new_region_before = VMSpaceRegion {
-								.start = cur_region->start,
-								.size = address - cur_region->start,
-								.used = false,
-								.next = cur_region,
-								.prev = cur_region->prev
-						};
-						if(cur_region->prev)
-							cur_region->prev->next = new_region_before;
-						cur_region->prev = new_region_before;
-						if(m_region_map == cur_region)
-							m_region_map = new_region_before;
-					} else {
-						delete new_region_before;
-					}
-
-					// Create new region after if needed
-					if(cur_region->end() > address + size) {
-						*new_region_after = VMSpaceRegion {
-								.start = address + size,
-								.size = cur_region->end() - (address + size),
-								.used = false,
-								.next = cur_region->next,
-								.prev = cur_region
-						};
-						if(cur_region->next)
-							cur_region->next->prev = new_region_after;
-						cur_region->next = new_region_after;
-					} else {
-						delete new_region_after;
-					}
-
-					cur_region->start = address;
-					cur_region->size = size;
-					cur_region->used = true;
-					m_used += cur_region->size;
-					return cur_region;
+				// Create new region after if needed
+				bool needs_after = cur_region->end() > address + size;
+				if(needs_after) {
+					*new_region_after = VMSpaceRegion {
+							.start = address + size,
+							.size = cur_region->end() - (address + size),
+							.used = false,
+							.next = cur_region->next,
+							.prev = cur_region,
+							.vmRegion = nullptr
+					};
+					if(cur_region->next)
+						cur_region->next->prev = new_region_after;
+					cur_region->next = new_region_after;
 				}
 
-				return Result(ENOMEM);
-			}
+				cur_region->start = address;
+				cur_region->size = size;
+				cur_region->used = true;
+				m_used += cur_region->size;
 
-			cur_region = cur_region->next;
+				tree_update(cur_region);
+				if(needs_before)
+					tree_insert(new_region_before);
+				else
+					delete new_region_before;
+				if(needs_after)
+					tree_insert(new_region_after);
+				else
+					delete new_region_after;
+				return cur_region;
+			}
 		}
 	}
 
+	delete new_region_before;
+	delete new_region_after;
 	return Result(ENOMEM);
 }
 
@@ -447,6 +532,7 @@ Result VMSpace::free_region(VMSpaceRegion* region) {
 		// Merge previous region if needed
 		if(region->prev && !region->prev->used) {
 			to_delete[0] = region->prev;
+			tree_remove(to_delete[0]);
 			region->prev = region->prev->prev;
 			if(to_delete[0]->prev)
 				to_delete[0]->prev->next = region;
@@ -459,11 +545,14 @@ Result VMSpace::free_region(VMSpaceRegion* region) {
 		// Merge next region if needed
 		if(region->next && !region->next->used) {
 			to_delete[1] = region->next;
+			tree_remove(to_delete[1]);
 			region->next = region->next->next;
 			if(to_delete[1]->next)
 				to_delete[1]->next->prev = region;
 			region->size += to_delete[1]->size;
 		}
+
+		tree_update(region);
 	}
 
 	// We do this while not holding the lock just in case this triggers a page free in the allocator.
@@ -472,3 +561,164 @@ Result VMSpace::free_region(VMSpaceRegion* region) {
 
 	return Result(SUCCESS);
 }
+
+/**
+ * Region tree
+ */
+
+VMSpace::VMSpaceRegion* VMSpace::find_region_containing(VirtualAddress address) {
+	auto* region = m_region_tree;
+	while(region) {
+		if(address < region->start)
+			region = region->tree_left;
+		else if(address >= region->end())
+			region = region->tree_right;
+		else
+			return region;
+	}
+	return nullptr;
+}
+
+VMSpace::VMSpaceRegion* VMSpace::find_first_fit(size_t size) {
+	auto* region = m_region_tree;
+	while(region) {
+		if(region->tree_left && region->tree_left->max_free >= size)
+			region = region->tree_left;
+		else if(!region->used && region->size >= size)
+			return region;
+		else if(region->tree_right && region->tree_right->max_free >= size)
+			region = region->tree_right;
+		else
+			return nullptr;
+	}
+	return nullptr;
+}
+
+VMSpace::VMSpaceRegion* VMSpace::find_last_fit(size_t size) {
+	auto* region = m_region_tree;
+	while(region) {
+		if(region->tree_right && region->tree_right->max_free >= size)
+			region = region->tree_right;
+		else if(!region->used && region->size >= size)
+			return region;
+		else if(region->tree_left && region->tree_left->max_free >= size)
+			region = region->tree_left;
+		else
+			return nullptr;
+	}
+	return nullptr;
+}
+
+void VMSpace::tree_insert(VMSpaceRegion* region) {
+	region->tree_parent = nullptr;
+	region->tree_left = nullptr;
+	region->tree_right = nullptr;
+	region->tree_height = 1;
+
+	VMSpaceRegion* parent = nullptr;
+	auto** link = &m_region_tree;
+	while(*link) {
+		parent = *link;
+		link = region->start < parent->start ? &parent->tree_left : &parent->tree_right;
+	}
+	*link = region;
+	region->tree_parent = parent;
+	tree_update(region);
+}
+
+void VMSpace::tree_remove(VMSpaceRegion* region) {
+	VMSpaceRegion* update_from;
+	if(!region->tree_left || !region->tree_right) {
+		auto* child = region->tree_left ? region->tree_left : region->tree_right;
+		update_from = region->tree_parent;
+		tree_replace_child(region, child);
+		if(child)
+			child->tree_parent = region->tree_parent;
+	} else {
+		// Put the in-order successor (the leftmost node in the right subtree) where the region was
+		auto* successor = region->tree_right;
+		while(successor->tree_left)
+			successor = successor->tree_left;
+
+		if(successor->tree_parent != region) {
+			update_from = successor->tree_parent;
+			tree_replace_child(successor, successor->tree_right);
+			if(successor->tree_right)
+				successor->tree_right->tree_parent = successor->tree_parent;
+			successor->tree_right = region->tree_right;
+			successor->tree_right->tree_parent = successor;
+		} else {
+			update_from = successor;
+		}
+
+		successor->tree_left = region->tree_left;
+		successor->tree_left->tree_parent = successor;
+		tree_replace_child(region, successor);
+		successor->tree_parent = region->tree_parent;
+		successor->tree_height = region->tree_height;
+	}
+
+	region->tree_parent = nullptr;
+	region->tree_left = nullptr;
+	region->tree_right = nullptr;
+	if(update_from)
+		tree_update(update_from);
+}
+
+void VMSpace::tree_update(VMSpaceRegion* region) {
+	// Recalculate the augmented data of each node up to the root, rebalancing along the way
+	while(region) {
+		int balance = region->balance();
+		if(balance > 1) {
+			if(region->tree_right->balance() < 0)
+				tree_rotate_right(region->tree_right);
+			region = tree_rotate_left(region);
+		} else if(balance < -1) {
+			if(region->tree_left->balance() > 0)
+				tree_rotate_left(region->tree_left);
+			region = tree_rotate_right(region);
+		}
+
+		region->recalculate();
+		region = region->tree_parent;
+	}
+}
+
+VMSpace::VMSpaceRegion* VMSpace::tree_rotate_left(VMSpaceRegion* region) {
+	auto* pivot = region->tree_right;
+	region->tree_right = pivot->tree_left;
+	if(pivot->tree_left)
+		pivot->tree_left->tree_parent = region;
+	tree_replace_child(region, pivot);
+	pivot->tree_parent = region->tree_parent;
+	pivot->tree_left = region;
+	region->tree_parent = pivot;
+
+	// tree_update() only recalculates from the pivot upwards, so the region we rotated down needs to be done here
+	region->recalculate();
+	return pivot;
+}
+
+VMSpace::VMSpaceRegion* VMSpace::tree_rotate_right(VMSpaceRegion* region) {
+	auto* pivot = region->tree_left;
+	region->tree_left = pivot->tree_right;
+	if(pivot->tree_right)
+		pivot->tree_right->tree_parent = region;
+	tree_replace_child(region, pivot);
+	pivot->tree_parent = region->tree_parent;
+	pivot->tree_right = region;
+	region->tree_parent = pivot;
+
+	region->recalculate();
+	return pivot;
+}
+
+void VMSpace::tree_replace_child(VMSpaceRegion* old_child, VMSpaceRegion* new_child) {
+	auto* parent = old_child->tree_parent;
+	if(!parent)
+		m_region_tree = new_child;
+	else if(parent->tree_left == old_child)
+		parent->tree_left = new_child;
+	else
+		parent->tree_right = new_child;
+}
@@ -6,12 +6,16 @@
 #include "../kstd/Arc.h"
 #include "VMRegion.h"
 #include "../Result.hpp"
-#include "../tasking/SpinLock.h"
+#include "../tasking/RWLock.h"
 #include "PageDirectory.h"
 
 /**
  * This class represents a virtual memory address space and all of the regions it contains. It's used to allocate and
  * map new regions in virtual memory.
+ *
+ * The space is split into contiguous used and free regions, which are kept both in a list ordered by address and in an
+ * AVL tree keyed by start address. Each node in the tree also tracks the largest free region in its subtree, so
+ * finding the region containing an address and finding free space are both O(log n).
  */
 class VMSpace: public kstd::ArcSelf<VMSpace> {
 public:
@@ -34,9 +38,10 @@ public:
 	 * @param prot The protection to use.
 	 * @param range The range within the space to map to. Use a start of zero to map wherever it fits, and a size of zero to map the whole object. Both must be page-aligned.
 	 * @param object_start The offset within the object to begin the mapping. Must be page-aligned.
+	 * @param map_pages Whether to map the object's pages right away. If not, they're mapped as they're faulted on.
 	 * @return The newly created region.
 	 */
-	ResultRet<kstd::Arc<VMRegion>> map_object(kstd::Arc<VMObject> object, VMProt prot, VirtualRange range = VirtualRange::null, VirtualAddress object_start = 0);
+	ResultRet<kstd::Arc<VMRegion>> map_object(kstd::Arc<VMObject> object, VMProt prot, VirtualRange range = VirtualRange::null, VirtualAddress object_start = 0, bool map_pages = true);
 
 	/**
 	 * Allocates a new region for the given object near the end of the memory space.
@@ -88,6 +93,15 @@ public:
 	 */
 	Result try_pagefault(PageFault fault);
 
+	/**
+	 * Reads in or allocates any pages of a region's object that aren't there yet, and maps them all at once so that
+	 * accessing them won't fault.
+	 * @param region The region to populate.
+	 * @param range The range to populate, relative to the start of the region.
+	 * @return A result indicating whether all of the pages could be read in.
+	 */
+	Result populate(VMRegion& region, VirtualRange range);
+
 	/**
 	 * Finds a region in the space that has at least `size` bytes free.
 	 * SHOULD ONLY BE USED BY `MemoryManager` FOR HEAP ALLOCATION.
@@ -98,15 +112,24 @@ public:
 	ResultRet<VirtualAddress> find_free_space(size_t size);
 
 	/**
-	 * Calculates the total non-shared, anonymous memory in the space.
+	 * Gets how many pages of each kind of memory are mapped into the space. This is kept up to date as pages are mapped
+	 * and unmapped, so it's cheap to call.
 	 */
-	size_t calculate_regular_anonymous_total();
+	PageDirectory::ResidentStats resident_stats() const { return m_page_directory.resident_stats(); }
+
+	/**
+	 * Calculates the proportional set size of the space, in bytes: the memory mapped into it, with each page divided up
+	 * between everything using it. Only anonymous and file memory is counted, and reserved pages (like the zero page)
+	 * aren't. This looks at every page in the space, so it's much slower than resident_stats().
+	 */
+	size_t calculate_pss();
 
 	VirtualAddress start() const { return m_start; }
 	size_t size() const { return m_size; }
 	VirtualAddress end() const { return m_start + m_size; }
 	size_t used() const { return m_used; }
-	SpinLock& lock() { return m_lock; }
+	RWLock& lock() { return m_lock; }
+	PageDirectory& page_directory() { return m_page_directory; }
 
 private:
 	struct VMSpaceRegion {
@@ -117,18 +140,51 @@ private:
 		VMSpaceRegion* prev;
 		VMRegion* vmRegion;
 
+		// Tree links and augmented data
+		VMSpaceRegion* tree_parent = nullptr;
+		VMSpaceRegion* tree_left = nullptr;
+		VMSpaceRegion* tree_right = nullptr;
+		int tree_height = 1;
+		size_t max_free = 0; // The size of the largest free region in this subtree
+
 		size_t end() const { return start + size; }
 		bool contains(VirtualAddress address) const { return start <= address && end() > address; }
+
+		static int height(const VMSpaceRegion* region) { return region ? region->tree_height : 0; }
+		int balance() const { return height(tree_right) - height(tree_left); }
+		/// Recalculates tree_height and max_free from this region and its children.
+		void recalculate() {
+			tree_height = max(height(tree_left), height(tree_right)) + 1;
+			max_free = used ? 0 : size;
+			if(tree_left)
+				max_free = max(max_free, tree_left->max_free);
+			if(tree_right)
+				max_free = max(max_free, tree_right->max_free);
+		}
 	};
 
 	ResultRet<VMSpaceRegion*> alloc_space(size_t size);
+	/// Allocates space at an address that is `offset` bytes past a 4MiB boundary, so it can be mapped with large pages.
+	ResultRet<VMSpaceRegion*> alloc_space_large_aligned(size_t size, size_t offset);
 	ResultRet<VMSpaceRegion*> alloc_space_at(size_t size, VirtualAddress address);
 	Result free_region(VMSpaceRegion* region);
 
+	// Region tree
+	VMSpaceRegion* find_region_containing(VirtualAddress address);
+	VMSpaceRegion* find_first_fit(size_t size);
+	VMSpaceRegion* find_last_fit(size_t size);
+	void tree_insert(VMSpaceRegion* region);
+	void tree_remove(VMSpaceRegion* region);
+	void tree_update(VMSpaceRegion* region);
+	VMSpaceRegion* tree_rotate_left(VMSpaceRegion* region);
+	VMSpaceRegion* tree_rotate_right(VMSpaceRegion* region);
+	void tree_replace_child(VMSpaceRegion* old_child, VMSpaceRegion* new_child);
+
 	VirtualAddress m_start;
 	size_t m_size;
 	VMSpaceRegion* m_region_map;
+	VMSpaceRegion* m_region_tree;
 	size_t m_used = 0;
-	SpinLock m_lock;
+	RWLock m_lock;
 	PageDirectory& m_page_directory;
 };
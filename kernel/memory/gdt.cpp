@@ -21,6 +21,7 @@
 #include <kernel/memory/gdt.h>
 #include <kernel/tasking/TSS.h>
 #include <kernel/tasking/TaskManager.h>
+#include <kernel/tasking/Processor.h>
 #include <kernel/kstd/cstring.h>
 
 Memory::GDTEntry gdt[GDT_ENTRIES];
@@ -49,37 +50,75 @@ void Memory::gdt_set_gate(uint32_t num, uint32_t limit, uint32_t base, bool read
 	gdt[num].access.bits.ring = ring;
 }
 
-void Memory::setup_tss(){
-	uint32_t base = (uint32_t) &TaskManager::tss;
-	uint32_t limit = sizeof(TaskManager::tss) - 1;
+static void set_tss_gate(Memory::GDTEntry* entries, TSS& tss) {
+	uint32_t base = (uint32_t) &tss;
+	uint32_t limit = sizeof(tss) - 1;
 
 	// Now, add our TSS descriptor's address to the GDT.
-	gdt[5].limit_low = limit & 0xFFFFu;
-	gdt[5].base_low = (base & 0xFFFFu);
-	gdt[5].base_middle = (base >> 16u) & 0xFFu;
-	gdt[5].base_high = (base >> 24u) & 0xFFu;
-	gdt[5].access.bits.accessed = true; //This indicates it's a TSS and not a LDT. This is a changed meaning
-	gdt[5].access.bits.read_write = false; //This indicates if the TSS is busy or not. 0 for not busy
-	gdt[5].access.bits.direction = false; //always 0 for TSS
-	gdt[5].access.bits.executable = true; //For TSS this is 1 for 32bit usage, or 0 for 16bit.
-	gdt[5].access.bits.type = false; //indicate it is a TSS
-	gdt[5].access.bits.ring = 3; //same meaning
-	gdt[5].access.bits.present = true; //same meaning
-	gdt[5].flags_and_limit.bits.limit_high = (limit >> 16u) & 0xFu; //isolate top nibble
-	gdt[5].flags_and_limit.bits.zero = 0;
-	gdt[5].flags_and_limit.bits.size = false; //should leave zero according to manuals. No effect
-	gdt[5].flags_and_limit.bits.granularity = false; //so that our computed GDT limit is in bytes, not pages
-
-	memset(&TaskManager::tss, 0, sizeof(TSS));
-
-	TaskManager::tss.ss0 = 0x10;
-
-	TaskManager::tss.cs = 0x0b;
-	TaskManager::tss.ss = 0x13;
-	TaskManager::tss.ds = 0x13;
-	TaskManager::tss.es = 0x13;
-	TaskManager::tss.fs = 0x13;
-	TaskManager::tss.gs = 0x13;
+	entries[5].limit_low = limit & 0xFFFFu;
+	entries[5].base_low = (base & 0xFFFFu);
+	entries[5].base_middle = (base >> 16u) & 0xFFu;
+	entries[5].base_high = (base >> 24u) & 0xFFu;
+	entries[5].access.bits.accessed = true; //This indicates it's a TSS and not a LDT. This is a changed meaning
+	entries[5].access.bits.read_write = false; //This indicates if the TSS is busy or not. 0 for not busy
+	entries[5].access.bits.direction = false; //always 0 for TSS
+	entries[5].access.bits.executable = true; //For TSS this is 1 for 32bit usage, or 0 for 16bit.
+	entries[5].access.bits.type = false; //indicate it is a TSS
+	entries[5].access.bits.ring = 3; //same meaning
+	entries[5].access.bits.present = true; //same meaning
+	entries[5].flags_and_limit.bits.limit_high = (limit >> 16u) & 0xFu; //isolate top nibble
+	entries[5].flags_and_limit.bits.zero = 0;
+	entries[5].flags_and_limit.bits.size = false; //should leave zero according to manuals. No effect
+	entries[5].flags_and_limit.bits.granularity = false; //so that our computed GDT limit is in bytes, not pages
+
+	memset(&tss, 0, sizeof(TSS));
+
+	tss.ss0 = 0x10;
+
+	tss.cs = 0x0b;
+	tss.ss = 0x13;
+	tss.ds = 0x13;
+	tss.es = 0x13;
+	tss.fs = 0x13;
+	tss.gs = 0x13;
+}
+
+void Memory::setup_tss(){
+	set_tss_gate(gdt, Processor::boot_processor().tss);
+}
+
+void Memory::load_processor_gdt(GDTEntry* entries, TSS& tss) {
+	memcpy(entries, gdt, sizeof(gdt));
+	set_tss_gate(entries, tss);
+
+	GDTPointer pointer;
+	pointer.limit = (sizeof(GDTEntry) * GDT_ENTRIES) - 1;
+	pointer.base = (uint32_t) entries;
+	asm volatile(
+		"lgdt %0\n"
+		"mov $0x10, %%ax\n"
+		"mov %%ax, %%ds\n"
+		"mov %%ax, %%es\n"
+		"mov %%ax, %%fs\n"
+		"mov %%ax, %%gs\n"
+		"mov %%ax, %%ss\n"
+		"ljmp $0x08, $1f\n"
+		"1:\n"
+		:: "m"(pointer) : "eax", "memory");
+	asm volatile("ltr %0": : "r"((uint16_t)0x2B));
+}
+
+void Memory::set_tls_base(uint32_t base) {
+	auto* entries = Processor::current().gdt();
+	entries[GDT_TLS_ENTRY].base_low = (base & 0xFFFFu);
+	entries[GDT_TLS_ENTRY].base_middle = (base >> 16u) & 0xFFu;
+	entries[GDT_TLS_ENTRY].base_high = (base >> 24u) & 0xFFu;
+
+	// If gs already has the TLS selector in it, it has to be reloaded to pick up the new base
+	asm volatile(
+		"mov %%gs, %%ax\n"
+		"mov %%ax, %%gs\n"
+		::: "eax", "memory");
 }
 
 void Memory::load_gdt(){
@@ -91,6 +130,7 @@ void Memory::load_gdt(){
 	gdt_set_gate(2, 0xFFFFF, 0, true, false, true, 0); //Kernel Data
 	gdt_set_gate(3, 0xFFFFF, 0, true, true, true, 3); //User code
 	gdt_set_gate(4, 0xFFFFF, 0, true, false, true, 3); //User data
+	gdt_set_gate(GDT_TLS_ENTRY, 0xFFFFF, 0, true, false, true, 3); //User TLS
 
 	setup_tss();
 
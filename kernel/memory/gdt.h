@@ -21,7 +21,11 @@
 
 #include <kernel/kstd/types.h>
 
-#define GDT_ENTRIES 6
+#define GDT_ENTRIES 7
+#define GDT_TLS_ENTRY 6
+#define GDT_TLS_SELECTOR 0x33
+
+struct TSS;
 
 namespace Memory {
 	union GDTEntryAccessByte {
@@ -64,6 +68,20 @@ namespace Memory {
 	void gdt_set_gate(uint32_t num, uint32_t limit, uint32_t base, bool read_write, bool executable, bool type, uint8_t ring, bool present = true, bool accessed = false);
 
 	void setup_tss();
+
+	/**
+	 * Loads a copy of the GDT for a processor, with a TSS descriptor pointing at that processor's own TSS, and loads its
+	 * task register. Each processor needs its own, since a TSS is marked busy in the GDT when it's loaded and the TLS
+	 * segment is different for the thread each one is running.
+	 */
+	void load_processor_gdt(GDTEntry* entries, TSS& tss);
+
+	/**
+	 * Points the current processor's user TLS segment at the given thread pointer. Userspace loads its selector into gs,
+	 * and since the descriptor is only read when gs is loaded, this has to be done before returning to a thread with a
+	 * different one.
+	 */
+	void set_tls_base(uint32_t base);
 	extern "C" void load_gdt();
 	extern "C" void gdt_flush();
 }
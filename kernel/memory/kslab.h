@@ -0,0 +1,13 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+
+/**
+ * Allocates memory for a small object from one of the general-purpose slab caches, picked by size. Allocations too big
+ * for any of the caches fall back to kmalloc. Memory from kslab_alloc must be freed with kslab_free. See SlabCache.h.
+ */
+void* kslab_alloc(size_t size);
+void kslab_free(void* ptr);
@@ -19,6 +19,9 @@
 
 #include "PCI.h"
 #include <kernel/IO.h>
+#include <kernel/interrupt/irq.h>
+#include <kernel/interrupt/APIC.h>
+#include <kernel/memory/MemoryManager.h>
 
 namespace PCI {
 	uint8_t read_byte(Address address, uint8_t field) {
@@ -75,6 +78,93 @@ namespace PCI {
 		write_word(address, PCI_COMMAND, comm.value);
 	}
 
+	uint8_t find_capability(Address address, uint8_t id) {
+		if(!(read_word(address, PCI_STATUS) & PCI_STATUS_CAPABILITIES_LIST))
+			return 0;
+		// The bottom two bits of the pointers are reserved. Stop after a sane number of entries in case the list loops.
+		uint8_t cap = read_byte(address, PCI_CAPABILITIES_POINTER) & ~0x3;
+		for(int i = 0; cap && i < 48; i++) {
+			if(read_byte(address, cap + PCI_CAP_ID) == id)
+				return cap;
+			cap = read_byte(address, cap + PCI_CAP_NEXT) & ~0x3;
+		}
+		return 0;
+	}
+
+	uint16_t msix_vectors(Address address) {
+		auto cap = find_capability(address, PCI_CAP_MSIX);
+		if(!cap)
+			return 0;
+		return (read_word(address, cap + PCI_MSIX_CONTROL) & PCI_MSIX_CONTROL_TABLE_SIZE) + 1;
+	}
+
+	static bool enable_msix(Address address, uint8_t cap, uint16_t entry, uint32_t msg_address, uint16_t msg_data) {
+		auto control = read_word(address, cap + PCI_MSIX_CONTROL);
+		if(entry > (control & PCI_MSIX_CONTROL_TABLE_SIZE))
+			return false;
+
+		// Find the table, which lives in one of the device's memory BARs
+		auto table = read_dword(address, cap + PCI_MSIX_TABLE);
+		uint8_t bar_field = PCI_BAR0 + (table & PCI_MSIX_TABLE_BIR) * 4;
+		if(bar_field > PCI_BAR5)
+			return false;
+		auto bar = read_dword(address, bar_field);
+		if(bar & 0x1)
+			return false;
+		if((bar & 0x6) == 0x4 && (bar_field == PCI_BAR5 || read_dword(address, bar_field + 4)))
+			return false; // A 64-bit BAR above 4GiB, which we can't reach
+		PhysicalAddress entry_addr = (bar & ~0xF) + (table & ~PCI_MSIX_TABLE_BIR) + entry * PCI_MSIX_ENTRY_SIZE;
+
+		// Mask the function while the entry is being changed
+		write_word(address, cap + PCI_MSIX_CONTROL, control | PCI_MSIX_CONTROL_ENABLE | PCI_MSIX_CONTROL_FUNCTION_MASK);
+		auto region = MM.alloc_mapped_region(entry_addr & ~(PAGE_SIZE - 1), PAGE_SIZE);
+		auto* entry_regs = (volatile uint32_t*) (region->start() + (entry_addr & (PAGE_SIZE - 1)));
+		entry_regs[0] = msg_address;
+		entry_regs[1] = 0;
+		entry_regs[2] = msg_data;
+		entry_regs[3] &= ~PCI_MSIX_ENTRY_VECTOR_CONTROL_MASKED;
+		write_word(address, cap + PCI_MSIX_CONTROL, (control | PCI_MSIX_CONTROL_ENABLE) & ~PCI_MSIX_CONTROL_FUNCTION_MASK);
+		return true;
+	}
+
+	bool enable_msi(Address address, uint16_t entry, int irq) {
+		if(!Interrupt::irq_is_msi(irq) || !APIC::available())
+			return false;
+
+		// Fixed delivery, edge-triggered, to the boot processor
+		uint32_t msg_address = PCI_MSI_ADDRESS_BASE | ((uint32_t) APIC::id() << 12);
+		uint16_t msg_data = IRQ_VECTOR_BASE + irq;
+
+		bool enabled = false;
+		if(auto cap = find_capability(address, PCI_CAP_MSIX)) {
+			enabled = enable_msix(address, cap, entry, msg_address, msg_data);
+		} else if(auto cap = find_capability(address, PCI_CAP_MSI); cap && entry == 0) {
+			// Only ask for one message, since the vectors of multiple messages have to be contiguous and aligned
+			auto control = read_word(address, cap + PCI_MSI_CONTROL);
+			write_dword(address, cap + PCI_MSI_ADDRESS, msg_address);
+			if(control & PCI_MSI_CONTROL_64BIT) {
+				write_dword(address, cap + PCI_MSI_ADDRESS_HIGH, 0);
+				write_word(address, cap + PCI_MSI_DATA_64, msg_data);
+			} else {
+				write_word(address, cap + PCI_MSI_DATA_32, msg_data);
+			}
+			control &= ~PCI_MSI_CONTROL_MULTIPLE_ENABLE;
+			write_word(address, cap + PCI_MSI_CONTROL, control | PCI_MSI_CONTROL_ENABLE);
+			enabled = true;
+		}
+
+		if(enabled)
+			disable_interrupt(address);
+		return enabled;
+	}
+
+	void disable_msi(Address address) {
+		if(auto cap = find_capability(address, PCI_CAP_MSIX))
+			write_word(address, cap + PCI_MSIX_CONTROL, read_word(address, cap + PCI_MSIX_CONTROL) & ~PCI_MSIX_CONTROL_ENABLE);
+		if(auto cap = find_capability(address, PCI_CAP_MSI))
+			write_word(address, cap + PCI_MSI_CONTROL, read_word(address, cap + PCI_MSI_CONTROL) & ~PCI_MSI_CONTROL_ENABLE);
+	}
+
 	void enumerate_devices(PCIEnumerationCallback callback, void* dataPtr) {
 		if((read_byte({0,0,0}, PCI_HEADER_TYPE) & PCI_MULTIFUNCTION) == 0) {
 			//Single controller
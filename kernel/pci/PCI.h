@@ -46,9 +46,42 @@
 #define PCI_BAR5 0x24 //32
 #define PCI_PRIMARY_BUS 0x18 //8
 #define PCI_SECONDARY_BUS 0x19 //8
+#define PCI_CAPABILITIES_POINTER 0x34 //8
 #define PCI_INTERRUPT_LINE 0x3c //8
 #define PCI_INTERRUPT_PIN 0x3d //8
 
+//Status bits
+#define PCI_STATUS_CAPABILITIES_LIST 0x10
+
+//Capabilities
+#define PCI_CAP_ID 0x0 //8
+#define PCI_CAP_NEXT 0x1 //8
+#define PCI_CAP_MSI 0x05
+#define PCI_CAP_MSIX 0x11
+
+//MSI capability fields (relative to the capability)
+#define PCI_MSI_CONTROL 0x2 //16
+#define PCI_MSI_ADDRESS 0x4 //32
+#define PCI_MSI_ADDRESS_HIGH 0x8 //32, only if 64-bit
+#define PCI_MSI_DATA_32 0x8 //16
+#define PCI_MSI_DATA_64 0xC //16
+#define PCI_MSI_CONTROL_ENABLE 0x1
+#define PCI_MSI_CONTROL_MULTIPLE_ENABLE 0x70
+#define PCI_MSI_CONTROL_64BIT 0x80
+
+//MSI-X capability fields (relative to the capability)
+#define PCI_MSIX_CONTROL 0x2 //16
+#define PCI_MSIX_TABLE 0x4 //32
+#define PCI_MSIX_CONTROL_TABLE_SIZE 0x7FF
+#define PCI_MSIX_CONTROL_FUNCTION_MASK 0x4000
+#define PCI_MSIX_CONTROL_ENABLE 0x8000
+#define PCI_MSIX_TABLE_BIR 0x7
+#define PCI_MSIX_ENTRY_SIZE 16
+#define PCI_MSIX_ENTRY_VECTOR_CONTROL_MASKED 0x1
+
+//Where message-signaled interrupts are written to be delivered to a local APIC
+#define PCI_MSI_ADDRESS_BASE 0xFEE00000
+
 //Header types
 #define PCI_MULTIFUNCTION 0x80
 
@@ -149,6 +182,24 @@ namespace PCI {
 	void enable_bus_mastering(Address address);
 	void disable_bus_mastering(Address address);
 
+	/// Finds a capability in a device's capability list.
+	/// @return The offset of the capability in the device's configuration space, or 0 if it doesn't have it.
+	uint8_t find_capability(Address address, uint8_t id);
+	/// The number of MSI-X table entries a device has, or 0 if it doesn't support MSI-X.
+	uint16_t msix_vectors(Address address);
+	/**
+	 * Points a message-signaled interrupt of a device at an IRQ reserved with Interrupt::irq_alloc_msi and turns off its
+	 * legacy interrupt line. MSI-X is used if the device supports it, which allows each entry in its table (for
+	 * instance, each queue) to have a vector of its own. Otherwise, plain MSI is used, which only supports entry 0.
+	 * @param address The device.
+	 * @param entry The MSI-X table entry to program.
+	 * @param irq The IRQ to deliver the interrupt to.
+	 * @return Whether the interrupt could be set up.
+	 */
+	bool enable_msi(Address address, uint16_t entry, int irq);
+	/// Turns off MSI and MSI-X for a device. Its legacy interrupt line has to be enabled again separately.
+	void disable_msi(Address address);
+
 	void enumerate_devices(PCIEnumerationCallback callback, void* dataPtr);
 	void enumerate_bus(uint8_t bus, PCIEnumerationCallback callback, void* dataPtr);
 	void enumerate_slot(uint8_t bus, uint8_t slot, PCIEnumerationCallback callback, void* dataPtr);
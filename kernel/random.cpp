@@ -18,11 +18,49 @@
 */
 
 #include "random.h"
+#include "tasking/SpinLock.h"
+#include "tasking/Processor.h"
+#include "kstd/cstring.h"
+#include "kstd/kstdlib.h"
+
+#define CPUID_ECX_RDRAND (1u << 30)
+#define CPUID_EBX_RDSEED (1u << 18)
+
+// How many times to retry RDRAND / RDSEED when they don't have a number ready for us
+#define HW_RANDOM_RETRIES 10
+// How many bytes a CPU's generator can give out before it's reseeded
+#define RESEED_BYTES (1024 * 1024)
+// How many blocks get_random_bytes generates before copying them out
+#define OUTPUT_BLOCKS 8
+#define POOL_WORDS 8
+
+#define ROTL(a, b) (((a) << (b)) | ((a) >> (32 - (b))))
+#define QUARTER_ROUND(a, b, c, d) \
+	a += b; d ^= a; d = ROTL(d, 16); \
+	c += d; b ^= c; b = ROTL(b, 12); \
+	a += b; d ^= a; d = ROTL(d, 8); \
+	c += d; b ^= c; b = ROTL(b, 7);
+
+struct RandomState {
+	SpinLock lock;
+	uint32_t key[8];
+	uint32_t nonce[3];
+	uint32_t counter;
+	size_t since_reseed;
+	bool seeded;
+};
 
 static unsigned long int next = 1;
+static bool s_has_rdrand = false;
+static bool s_has_rdseed = false;
+static RandomState s_states[MAX_PROCESSORS];
+
+// Interrupt timings are folded into this pool as they come in. It isn't locked, since a race between two CPUs adding
+// to it can only lose a little bit of entropy.
+static uint32_t s_pool[POOL_WORDS];
+static uint32_t s_pool_index = 0;
 
 int rand() {
-	//FIXME: use rdrand
 	next = next * 1103515245 + 12345;
 	return (unsigned int)(next / 65536) % 32768;
 }
@@ -31,6 +69,132 @@ void srand(unsigned int seed) {
 	next = seed;
 }
 
+static inline uint64_t read_tsc() {
+	uint32_t low, high;
+	asm volatile("rdtsc" : "=a"(low), "=d"(high));
+	return ((uint64_t) high << 32) | low;
+}
+
+// Gets a word from RDSEED if possible, or RDRAND if not. Returns zero if the CPU has neither or they keep failing.
+static uint32_t hardware_random() {
+	uint32_t value;
+	uint8_t ok;
+	if(s_has_rdseed) {
+		for(int i = 0; i < HW_RANDOM_RETRIES; i++) {
+			asm volatile("rdseed %0; setc %1" : "=r"(value), "=qm"(ok));
+			if(ok)
+				return value;
+			asm volatile("pause");
+		}
+	}
+	if(s_has_rdrand) {
+		for(int i = 0; i < HW_RANDOM_RETRIES; i++) {
+			asm volatile("rdrand %0; setc %1" : "=r"(value), "=qm"(ok));
+			if(ok)
+				return value;
+		}
+	}
+	return 0;
+}
+
+void random_init() {
+	uint32_t eax, ebx, ecx, edx;
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+	uint32_t max_leaf = eax;
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1), "c"(0));
+	s_has_rdrand = ecx & CPUID_ECX_RDRAND;
+	if(max_leaf >= 7) {
+		asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(7), "c"(0));
+		s_has_rdseed = ebx & CPUID_EBX_RDSEED;
+	}
+	srand(read_tsc());
+}
+
+void add_interrupt_randomness(int irq) {
+	uint64_t tsc = read_tsc();
+	uint32_t index = s_pool_index++ % POOL_WORDS;
+	s_pool[index] = ROTL(s_pool[index], 7) ^ (uint32_t) tsc ^ (uint32_t) (tsc >> 32) ^ ((uint32_t) irq << 24);
+}
+
+void chacha20_block(const uint32_t key[8], uint32_t counter, const uint32_t nonce[3], uint32_t out[16]) {
+	uint32_t in[16] = {
+		0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+		key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+		counter, nonce[0], nonce[1], nonce[2]
+	};
+	uint32_t x[16];
+	for(int i = 0; i < 16; i++)
+		x[i] = in[i];
+	for(int i = 0; i < 10; i++) {
+		QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+		QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+		QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+		QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+		QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+		QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+		QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+		QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+	}
+	for(int i = 0; i < 16; i++)
+		out[i] = x[i] + in[i];
+}
+
+static void wipe(void* buffer, size_t size) {
+	memset(buffer, 0, size);
+	asm volatile("" : : "r"(buffer) : "memory");
+}
+
+// Replaces the state's key with half of its next block and hands out the other half. Since the old key is gone, the
+// output can't be worked backwards from the state if it's ever leaked.
+static void next_key(RandomState& state, uint32_t out_key[8]) {
+	uint32_t block[16];
+	chacha20_block(state.key, state.counter++, state.nonce, block);
+	memcpy(state.key, block, sizeof(state.key));
+	memcpy(out_key, block + 8, sizeof(state.key));
+	wipe(block, sizeof(block));
+}
+
+static void reseed(RandomState& state) {
+	uint64_t tsc = read_tsc();
+	for(int i = 0; i < 8; i++)
+		state.key[i] ^= hardware_random() ^ s_pool[i % POOL_WORDS];
+	state.key[0] ^= (uint32_t) tsc;
+	state.key[1] ^= (uint32_t) (tsc >> 32);
+	state.nonce[0] = Processor::current().id();
+	state.nonce[1] ^= hardware_random();
+	state.nonce[2] ^= (uint32_t) (tsc >> 16);
+	state.since_reseed = 0;
+	state.seeded = true;
+
+	// Stir the new key so that nothing we mixed in can be read back out of it
+	uint32_t discard[8];
+	next_key(state, discard);
+	wipe(discard, sizeof(discard));
+}
+
 void get_random_bytes(SafePointer<uint8_t> buffer, size_t count) {
-	for(auto i = 0; i < count; i++) buffer.set(i, rand());
-}
\ No newline at end of file
+	// Take a key of our own from this CPU's generator, and then generate the output without holding its lock (the
+	// buffer may be in userspace, and writing to it could fault).
+	uint32_t key[8];
+	{
+		auto& state = s_states[Processor::current().id()];
+		LOCK(state.lock);
+		if(!state.seeded || state.since_reseed >= RESEED_BYTES)
+			reseed(state);
+		state.since_reseed += count;
+		next_key(state, key);
+	}
+
+	const uint32_t nonce[3] = {0, 0, 0};
+	uint32_t blocks[16 * OUTPUT_BLOCKS];
+	uint32_t counter = 0;
+	for(size_t offset = 0; offset < count; offset += sizeof(blocks)) {
+		size_t num_blocks = min((count - offset + 63) / 64, (size_t) OUTPUT_BLOCKS);
+		for(size_t i = 0; i < num_blocks; i++)
+			chacha20_block(key, counter++, nonce, blocks + i * 16);
+		buffer.write((uint8_t*) blocks, offset, min(count - offset, sizeof(blocks)));
+	}
+
+	wipe(blocks, sizeof(blocks));
+	wipe(key, sizeof(key));
+}
@@ -22,7 +22,31 @@
 #include <kernel/kstd/types.h>
 #include <kernel/memory/SafePointer.h>
 
+/**
+ * A quick pseudorandom number generator for things that don't need to be unpredictable, like tests. Use
+ * get_random_bytes for anything else.
+ */
 int rand();
 void srand(unsigned int seed);
+
+/** Checks which hardware random number instructions the CPU has. Must be called before get_random_bytes. **/
+void random_init();
+
+/**
+ * Mixes the time an interrupt came in at into the entropy that the generator is reseeded with. Cheap enough to be
+ * called for every interrupt.
+ */
+void add_interrupt_randomness(int irq);
+
+/**
+ * Fills a buffer with cryptographically secure random bytes. These come from a ChaCha20 generator for each CPU, which
+ * is seeded (and periodically reseeded) from RDSEED / RDRAND if the CPU has them, the TSC, and interrupt timings.
+ * Never blocks.
+ */
 void get_random_bytes(SafePointer<uint8_t> buffer, size_t count);
 
+/**
+ * Computes a ChaCha20 block (RFC 7539) with the given key, block counter and nonce.
+ */
+void chacha20_block(const uint32_t key[8], uint32_t counter, const uint32_t nonce[3], uint32_t out[16]);
+
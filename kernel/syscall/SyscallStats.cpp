@@ -0,0 +1,194 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "SyscallStats.h"
+#include "syscall_numbers.h"
+
+static SyscallStats s_global_stats;
+
+static void append_u64(kstd::string& str, uint64_t num) {
+	char buf[21];
+	char* p = buf + sizeof(buf) - 1;
+	*p = '\0';
+	do {
+		*--p = '0' + (num % 10);
+		num /= 10;
+	} while(num);
+	str += p;
+}
+
+void SyscallStats::record(uint32_t call, uint64_t latency_ns, int result) {
+	if(call >= SYSCALL_STATS_MAX)
+		return;
+	auto& counter = m_counters[call];
+	uint64_t latency_us = latency_ns / 1000;
+
+	//Bucket n counts latencies from 2^(n-1) up to 2^n microseconds
+	size_t bucket = 0;
+	if(latency_us)
+		bucket = latency_us >= (1u << 31) ? 32 : 32 - __builtin_clz((uint32_t) latency_us);
+	if(bucket >= SYSCALL_LATENCY_BUCKETS)
+		bucket = SYSCALL_LATENCY_BUCKETS - 1;
+
+	counter.calls.add(1);
+	//Some syscalls return addresses, so only count small negative numbers as errors
+	if(result < 0 && result > -4096)
+		counter.errors.add(1);
+	counter.total_us.add(latency_us);
+	counter.buckets[bucket].add(1);
+}
+
+kstd::string SyscallStats::header() {
+	kstd::string str = "# name calls errors total_us";
+	for(size_t i = 0; i < SYSCALL_LATENCY_BUCKETS - 1; i++) {
+		str += " <";
+		append_u64(str, 1u << i);
+	}
+	str += " >=";
+	append_u64(str, 1u << (SYSCALL_LATENCY_BUCKETS - 2));
+	str += "\n";
+	return str;
+}
+
+kstd::string SyscallStats::to_string() const {
+	auto str = header();
+	for(uint32_t call = 0; call < SYSCALL_STATS_MAX; call++) {
+		auto& counter = m_counters[call];
+		auto calls = counter.calls.load();
+		if(!calls)
+			continue;
+		auto* call_name = name(call);
+		if(call_name) {
+			str += call_name;
+		} else {
+			str += "syscall_";
+			append_u64(str, call);
+		}
+		str += " ";
+		append_u64(str, calls);
+		str += " ";
+		append_u64(str, counter.errors.load());
+		str += " ";
+		append_u64(str, counter.total_us.load());
+		for(auto& bucket : counter.buckets) {
+			str += " ";
+			append_u64(str, bucket.load());
+		}
+		str += "\n";
+	}
+	return str;
+}
+
+SyscallStats& SyscallStats::global() {
+	return s_global_stats;
+}
+
+const char* SyscallStats::name(uint32_t call) {
+	switch(call) {
+		case SYS_EXIT: return "exit";
+		case SYS_FORK: return "fork";
+		case SYS_READ: return "read";
+		case SYS_WRITE: return "write";
+		case SYS_EXECVE: return "execve";
+		case SYS_OPEN: return "open";
+		case SYS_CLOSE: return "close";
+		case SYS_FSTAT: return "fstat";
+		case SYS_STAT: return "stat";
+		case SYS_LSEEK: return "lseek";
+		case SYS_KILL: return "kill";
+		case SYS_GETPID: return "getpid";
+		case SYS_TIMES: return "times";
+		case SYS_UNLINK: return "unlink";
+		case SYS_GETTIMEOFDAY: return "gettimeofday";
+		case SYS_SIGACTION: return "sigaction";
+		case SYS_ISATTY: return "isatty";
+		case SYS_LINK: return "link";
+		case SYS_WAITPID: return "waitpid";
+		case SYS_READDIR: return "readdir";
+		case SYS_CHDIR: return "chdir";
+		case SYS_GETCWD: return "getcwd";
+		case SYS_RMDIR: return "rmdir";
+		case SYS_MKDIR: return "mkdir";
+		case SYS_MKDIRAT: return "mkdirat";
+		case SYS_TRUNCATE: return "truncate";
+		case SYS_FTRUNCATE: return "ftruncate";
+		case SYS_PIPE: return "pipe";
+		case SYS_DUP: return "dup";
+		case SYS_DUP2: return "dup2";
+		case SYS_LSTAT: return "lstat";
+		case SYS_SYMLINK: return "symlink";
+		case SYS_SYMLINKAT: return "symlinkat";
+		case SYS_READLINK: return "readlink";
+		case SYS_READLINKAT: return "readlinkat";
+		case SYS_GETSID: return "getsid";
+		case SYS_SETSID: return "setsid";
+		case SYS_GETPGID: return "getpgid";
+		case SYS_GETPGRP: return "getpgrp";
+		case SYS_SETPGID: return "setpgid";
+		case SYS_SETUID: return "setuid";
+		case SYS_SETEUID: return "seteuid";
+		case SYS_GETUID: return "getuid";
+		case SYS_GETEUID: return "geteuid";
+		case SYS_SETGID: return "setgid";
+		case SYS_SETEGID: return "setegid";
+		case SYS_GETGID: return "getgid";
+		case SYS_GETEGID: return "getegid";
+		case SYS_SETGROUPS: return "setgroups";
+		case SYS_GETGROUPS: return "getgroups";
+		case SYS_UMASK: return "umask";
+		case SYS_CHMOD: return "chmod";
+		case SYS_FCHMOD: return "fchmod";
+		case SYS_CHOWN: return "chown";
+		case SYS_FCHOWN: return "fchown";
+		case SYS_LCHOWN: return "lchown";
+		case SYS_MMAP: return "mmap";
+		case SYS_MUNMAP: return "munmap";
+		case SYS_IOCTL: return "ioctl";
+		case SYS_GETPPID: return "getppid";
+		case SYS_SHMCREATE: return "shmcreate";
+		case SYS_SHMATTACH: return "shmattach";
+		case SYS_SHMDETACH: return "shmdetach";
+		case SYS_SHMALLOW: return "shmallow";
+		case SYS_POLL: return "poll";
+		case SYS_PTSNAME: return "ptsname";
+		case SYS_SLEEP: return "sleep";
+		case SYS_THREADCREATE: return "threadcreate";
+		case SYS_GETTID: return "gettid";
+		case SYS_THREADJOIN: return "threadjoin";
+		case SYS_THREADEXIT: return "threadexit";
+		case SYS_ISCOMPUTERON: return "iscomputeron";
+		case SYS_ACCESS: return "access";
+		case SYS_MPROTECT: return "mprotect";
+		case SYS_UNAME: return "uname";
+		case SYS_GETPRIORITY: return "getpriority";
+		case SYS_SETPRIORITY: return "setpriority";
+		case SYS_SCHED_SETAFFINITY: return "sched_setaffinity";
+		case SYS_SCHED_GETAFFINITY: return "sched_getaffinity";
+		case SYS_SHMPURGEABLE: return "shmpurgeable";
+		case SYS_SWAPON: return "swapon";
+		case SYS_FSYNC: return "fsync";
+		case SYS_SYNC: return "sync";
+		case SYS_SPLICE: return "splice";
+		case SYS_TEE: return "tee";
+		case SYS_FCNTL: return "fcntl";
+		case SYS_EPOLL_CREATE: return "epoll_create";
+		case SYS_EPOLL_CTL: return "epoll_ctl";
+		case SYS_EPOLL_WAIT: return "epoll_wait";
+		case SYS_READV: return "readv";
+		case SYS_WRITEV: return "writev";
+		case SYS_PREADV: return "preadv";
+		case SYS_PWRITEV: return "pwritev";
+		case SYS_COPY_FILE_RANGE: return "copy_file_range";
+		case SYS_CLOCK_GETTIME: return "clock_gettime";
+		case SYS_SPAWN: return "spawn";
+		case SYS_FUTEX: return "futex";
+		case SYS_SET_THREAD_POINTER: return "set_thread_pointer";
+		case SYS_GETRUSAGE: return "getrusage";
+		case SYS_FSTATAT: return "fstatat";
+		case SYS_GETRANDOM: return "getrandom";
+		case SYS_MADVISE: return "madvise";
+		case SYS_IORING_SETUP: return "ioring_setup";
+		case SYS_IORING_ENTER: return "ioring_enter";
+		default: return nullptr;
+	}
+}
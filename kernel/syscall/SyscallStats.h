@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+#include <kernel/kstd/string.h>
+#include <kernel/Atomic.h>
+
+//Syscalls numbered this or higher aren't counted
+#define SYSCALL_STATS_MAX 128
+//Latencies are counted in power-of-two buckets of microseconds, and the last bucket counts everything slower than that
+#define SYSCALL_LATENCY_BUCKETS 16
+
+/**
+ * Counts how many times each syscall was made, how many of those failed, and a histogram of how long they took. One of
+ * these is kept for the whole system, and one for each process that makes syscalls.
+ */
+class SyscallStats {
+public:
+	/** Records a syscall that returned result after latency_ns nanoseconds. **/
+	void record(uint32_t call, uint64_t latency_ns, int result);
+	/**
+	 * Formats the stats as a line for each syscall that has been made, with the name, count, error count, total
+	 * microseconds, and then the count in each latency bucket.
+	 */
+	kstd::string to_string() const;
+	/** The line describing the columns, which to_string() starts with. **/
+	static kstd::string header();
+
+	static SyscallStats& global();
+	static const char* name(uint32_t call);
+
+private:
+	struct Counter {
+		Atomic<uint32_t, MemoryOrder::Relaxed> calls = 0;
+		Atomic<uint32_t, MemoryOrder::Relaxed> errors = 0;
+		Atomic<uint64_t, MemoryOrder::Relaxed> total_us = 0;
+		Atomic<uint32_t, MemoryOrder::Relaxed> buckets[SYSCALL_LATENCY_BUCKETS] = {};
+	};
+
+	Counter m_counters[SYSCALL_STATS_MAX];
+};
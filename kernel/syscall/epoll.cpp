@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "../tasking/Process.h"
+#include "../memory/SafePointer.h"
+#include "../filesystem/FileDescriptor.h"
+#include "../filesystem/EventPoll.h"
+#include "../api/epoll.h"
+
+int Process::sys_epoll_create(int flags) {
+	if(flags & ~EPOLL_CLOEXEC)
+		return -EINVAL;
+
+	auto epoll = kstd::make_shared<EventPoll>();
+	auto epoll_fd = kstd::make_shared<FileDescriptor>(epoll);
+	epoll_fd->set_owner(_self_ptr);
+	epoll_fd->set_options(O_RDONLY | ((flags & EPOLL_CLOEXEC) ? O_CLOEXEC : 0));
+	_file_descriptors.push_back(epoll_fd);
+	epoll_fd->set_id((int) _file_descriptors.size() - 1);
+	return (int) _file_descriptors.size() - 1;
+}
+
+int Process::sys_epoll_ctl(UserspacePointer<struct epoll_ctl_args> args_ptr) {
+	auto args = args_ptr.get();
+	if(args.epfd < 0 || args.epfd >= (int) _file_descriptors.size() || !_file_descriptors[args.epfd])
+		return -EBADF;
+	if(args.fd < 0 || args.fd >= (int) _file_descriptors.size() || !_file_descriptors[args.fd])
+		return -EBADF;
+	auto epoll_file = _file_descriptors[args.epfd]->file();
+	if(!epoll_file->is_epoll())
+		return -EINVAL;
+	auto epoll = (EventPoll*) epoll_file.get();
+
+	Result res = Result(SUCCESS);
+	switch(args.op) {
+		case EPOLL_CTL_ADD:
+			res = epoll->add(args.fd, _file_descriptors[args.fd], UserspacePointer<struct epoll_event>(args.event).get());
+			break;
+		case EPOLL_CTL_MOD:
+			res = epoll->modify(args.fd, UserspacePointer<struct epoll_event>(args.event).get());
+			break;
+		case EPOLL_CTL_DEL:
+			res = epoll->remove(args.fd);
+			break;
+		default:
+			return -EINVAL;
+	}
+	return -res.code();
+}
+
+int Process::sys_epoll_wait(UserspacePointer<struct epoll_wait_args> args_ptr) {
+	auto args = args_ptr.get();
+	if(args.epfd < 0 || args.epfd >= (int) _file_descriptors.size() || !_file_descriptors[args.epfd])
+		return -EBADF;
+	auto epoll_file = _file_descriptors[args.epfd]->file();
+	if(!epoll_file->is_epoll())
+		return -EINVAL;
+	return ((EventPoll*) epoll_file.get())->wait(UserspacePointer<struct epoll_event>(args.events), args.maxevents, Time(0, args.timeout * 1000));
+}
@@ -6,6 +6,8 @@
 #include "../tasking/ProcessArgs.h"
 #include "../filesystem/VFS.h"
 #include "../terminal/VirtualTTY.h"
+#include "../tasking/TaskManager.h"
+#include "../api/spawn.h"
 
 int Process::exec(const kstd::string& filename, ProcessArgs* args) {
 	//Scoped so that stack variables are cleaned up before yielding
@@ -20,6 +22,9 @@ int Process::exec(const kstd::string& filename, ProcessArgs* args) {
 		new_proc->_user = _user;
 		new_proc->_pgid = _pgid;
 		new_proc->_sid = _sid;
+		new_proc->set_nice(_nice);
+		new_proc->_prefetch_session = _prefetch_session;
+		new_proc->get_thread(_pid)->set_affinity(TaskManager::current_thread()->affinity());
 		if (_kernel_mode) {
 			//Kernel processes have no file descriptors, so we need to initialize them
 			auto ttydesc = kstd::make_shared<FileDescriptor>(VirtualTTY::current_tty());
@@ -59,8 +64,8 @@ int Process::exec(const kstd::string& filename, ProcessArgs* args) {
 			main_thread->_tid = -1;
 			insert_thread(main_thread);
 		}
-		_pid = -1;
-		_ppid = 0;
+		TaskManager::process_table().set_key(this, ProcessTable::PID, -1);
+		set_ppid(0);
 		TaskManager::add_process(new_proc);
 	}
 
@@ -85,4 +90,118 @@ int Process::sys_execve(UserspacePointer<char> filename, UserspacePointer<char*>
 		}
 	}
 	return exec(filename.str(), args);
-}
\ No newline at end of file
+}
+pid_t Process::sys_spawn(UserspacePointer<struct spawn_args> args_ptr) {
+	auto spawn_args = args_ptr.get();
+	if(!spawn_args.path || spawn_args.num_actions < 0)
+		return -EINVAL;
+	auto path = UserspacePointer<char>((char*) spawn_args.path).str();
+
+	//Do the file actions to a copy of our file descriptors and working directory
+	kstd::vector<kstd::Arc<FileDescriptor>> fds;
+	fds.resize(_file_descriptors.size());
+	for(size_t i = 0; i < _file_descriptors.size(); i++)
+		if(_file_descriptors[i])
+			fds[i] = kstd::make_shared<FileDescriptor>(*_file_descriptors[i]);
+	auto cwd = _cwd;
+
+	UserspacePointer<spawn_file_action> actions((spawn_file_action*) spawn_args.actions);
+	for(int i = 0; i < spawn_args.num_actions; i++) {
+		auto action = actions.get(i);
+		switch(action.type) {
+			case SPAWN_ACTION_DUP2: {
+				if(action.fd < 0 || action.fd >= (int) fds.size() || !fds[action.fd] || action.new_fd < 0)
+					return -EBADF;
+				//Duplicating a descriptor onto itself just makes it survive the exec
+				if(action.new_fd == action.fd) {
+					fds[action.fd]->unset_options(O_CLOEXEC);
+					break;
+				}
+				if(action.new_fd >= (int) fds.size())
+					fds.resize(action.new_fd + 1);
+				auto new_fd = kstd::make_shared<FileDescriptor>(*fds[action.fd]);
+				new_fd->set_id(action.new_fd);
+				new_fd->unset_options(O_CLOEXEC);
+				fds[action.new_fd] = new_fd;
+				break;
+			}
+
+			case SPAWN_ACTION_CLOSE:
+				if(action.fd < 0 || action.fd >= (int) fds.size() || !fds[action.fd])
+					return -EBADF;
+				fds[action.fd] = kstd::Arc<FileDescriptor>();
+				break;
+
+			case SPAWN_ACTION_CHDIR: {
+				auto dir_path = UserspacePointer<char>((char*) action.path).str();
+				auto dir_or_err = VFS::inst().resolve_path(dir_path, cwd, _user);
+				if(dir_or_err.is_error())
+					return dir_or_err.code();
+				if(!dir_or_err.value()->inode()->metadata().is_directory())
+					return -ENOTDIR;
+				cwd = dir_or_err.value();
+				break;
+			}
+
+			default:
+				return -EINVAL;
+		}
+	}
+
+	//Make sure we can join the requested process group before making the process
+	bool set_pgroup = spawn_args.flags & POSIX_SPAWN_SETPGROUP;
+	if(set_pgroup && spawn_args.pgroup) {
+		if(spawn_args.pgroup < 0)
+			return -EINVAL;
+		auto* group_member = TaskManager::process_table().find(ProcessTable::PGID, spawn_args.pgroup);
+		if(!group_member || group_member->_sid != _sid)
+			return -EPERM;
+	}
+
+	auto* args = new ProcessArgs(cwd);
+	if(spawn_args.argv) {
+		UserspacePointer<char*> argv((char**) spawn_args.argv);
+		for(int i = 0; argv.get(i); i++)
+			args->argv.push_back(UserspacePointer<char>(argv.get(i)).str());
+	}
+	if(spawn_args.envp) {
+		UserspacePointer<char*> envp((char**) spawn_args.envp);
+		for(int i = 0; envp.get(i); i++)
+			args->env.push_back(UserspacePointer<char>(envp.get(i)).str());
+	}
+
+	//Create the new process straight from the executable, instead of copying ourselves first like fork() would
+	auto new_proc_res = Process::create_user(path, _user, args, TaskManager::get_new_pid(), _pid);
+	delete args;
+	if(new_proc_res.is_error())
+		return new_proc_res.code();
+	auto* new_proc = new_proc_res.value();
+	auto pid = new_proc->pid();
+
+	new_proc->_user = _user;
+	new_proc->_sid = _sid;
+	//A process group of 0 means the new process leads a new group
+	new_proc->_pgid = set_pgroup ? (spawn_args.pgroup ? spawn_args.pgroup : pid) : _pgid;
+	new_proc->_umask = _umask;
+	new_proc->_tty = _tty;
+	new_proc->set_nice(_nice);
+	new_proc->_prefetch_session = _prefetch_session;
+	new_proc->get_thread(pid)->set_affinity(TaskManager::current_thread()->affinity());
+
+	//Give the new process the file descriptors that aren't closed on exec
+	new_proc->_file_descriptors.resize(0);
+	int last_fd = -1;
+	for(size_t i = 0; i < fds.size(); i++) {
+		if(fds[i] && !fds[i]->cloexec()) {
+			last_fd = i;
+			fds[i]->set_owner(new_proc);
+		} else {
+			fds[i] = kstd::Arc<FileDescriptor>();
+		}
+	}
+	fds.resize(last_fd + 1);
+	new_proc->_file_descriptors = fds;
+
+	TaskManager::add_process(new_proc);
+	return pid;
+}
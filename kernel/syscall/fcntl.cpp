@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "../tasking/Process.h"
+#include "../filesystem/FileDescriptor.h"
+#include "../filesystem/Pipe.h"
+#include "../filesystem/InodeFile.h"
+#include "../filesystem/socketfs/SocketFSInode.h"
+
+int Process::sys_fcntl(int file, int cmd, int arg) {
+	if(file < 0 || file >= (int) _file_descriptors.size() || !_file_descriptors[file])
+		return -EBADF;
+	auto fd = _file_descriptors[file];
+
+	switch(cmd) {
+		case F_GETPIPE_SZ:
+		case F_SETPIPE_SZ: {
+			if(!fd->file()->is_fifo())
+				return -EBADF;
+			auto pipe = (Pipe*) fd->file().get();
+			if(cmd == F_GETPIPE_SZ)
+				return (int) pipe->capacity();
+			if(arg < 0)
+				return -EINVAL;
+			auto res = pipe->set_capacity(arg);
+			if(res.is_error())
+				return -res.code();
+			return (int) res.value();
+		}
+
+		case F_GETSOCK_SZ:
+		case F_SETSOCK_SZ: {
+			if(!fd->file()->is_inode())
+				return -EBADF;
+			auto inode = kstd::static_pointer_cast<InodeFile>(fd->file())->inode();
+			if(inode->fs.fsid() != SOCKETFS_FSID || !IS_SOCKET(inode->metadata().mode))
+				return -EBADF;
+			auto socket = (SocketFSInode*) inode.get();
+			if(cmd == F_GETSOCK_SZ)
+				return (int) socket->queue_size(*fd);
+			if(arg < 0)
+				return -EINVAL;
+			auto res = socket->set_queue_size(*fd, arg);
+			if(res.is_error())
+				return -res.code();
+			return (int) res.value();
+		}
+
+		//TODO: Implement the other commands
+		default:
+			return -EINVAL;
+	}
+}
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "../tasking/Process.h"
+#include "../tasking/Futex.h"
+#include "../memory/SafePointer.h"
+#include "../api/futex.h"
+
+int Process::sys_futex(UserspacePointer<struct futex_args> args_ptr) {
+	auto args = args_ptr.get();
+	switch(args.op) {
+		case FUTEX_WAIT: {
+			Time timeout = Time(-1, 0);
+			if(args.timeout) {
+				auto spec = UserspacePointer<timespec>((timespec*) args.timeout).get();
+				if(spec.tv_sec < 0 || spec.tv_nsec < 0 || spec.tv_nsec >= 1000000000)
+					return -EINVAL;
+				timeout = Time(spec);
+			}
+			return Futex::wait(*_vm_space, (VirtualAddress) args.addr, args.val, timeout);
+		}
+		case FUTEX_WAKE:
+			return Futex::wake(*_vm_space, (VirtualAddress) args.addr, args.val);
+		default:
+			return -EINVAL;
+	}
+}
@@ -0,0 +1,13 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "../tasking/Process.h"
+#include "../random.h"
+#include "../api/random.h"
+
+ssize_t Process::sys_getrandom(UserspacePointer<uint8_t> buf, size_t count, unsigned int flags) {
+	if(flags & ~(GRND_NONBLOCK | GRND_RANDOM))
+		return -EINVAL;
+	get_random_bytes(buf, count);
+	return count;
+}
@@ -4,8 +4,25 @@
 #include "../tasking/Process.h"
 #include "../memory/SafePointer.h"
 #include "../time/Time.h"
+#include "../time/TimeManager.h"
 
 int Process::sys_gettimeofday(UserspacePointer<timeval> t, UserspacePointer<void*> z) {
 	t.set(Time::now().to_timeval());
 	return 0;
-}
\ No newline at end of file
+}
+
+int Process::sys_clock_gettime(clockid_t clock, UserspacePointer<timespec> t) {
+	switch(clock) {
+		case CLOCK_REALTIME:
+		case CLOCK_REALTIME_COARSE:
+			t.set(TimeManager::now());
+			return 0;
+		case CLOCK_MONOTONIC:
+		case CLOCK_MONOTONIC_RAW:
+		case CLOCK_MONOTONIC_COARSE:
+			t.set(TimeManager::uptime());
+			return 0;
+		default:
+			return -EINVAL;
+	}
+}
@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "../tasking/Process.h"
+#include "../tasking/IORing.h"
+#include "../memory/SafePointer.h"
+
+int Process::sys_ioring_setup(UserspacePointer<struct ioring_params> params_ptr) {
+	auto params = params_ptr.get();
+	if(!params.entries || params.entries > IORING_MAX_ENTRIES || (params.entries & (params.entries - 1)))
+		return -EINVAL;
+	if(!params.ring || ((size_t) params.ring % alignof(ioring_sqe)))
+		return -EINVAL;
+
+	LOCK(m_ioring_lock);
+	if(m_ioring)
+		return -EBUSY;
+
+	//Make sure the whole ring is there and writable before we start using it
+	UserspacePointer<uint8_t> ring((uint8_t*) params.ring);
+	ring.memset(0, 0, IORING_SIZE(params.entries));
+	auto* header = (ioring_header*) params.ring;
+	UserspacePointer<uint32_t>(&header->entries).set(params.entries);
+
+	m_ioring = kstd::make_shared<IORing>(_self_ptr, header, params.entries);
+	return SUCCESS;
+}
+
+int Process::sys_ioring_enter(uint32_t to_submit, uint32_t min_complete, int flags) {
+	if(flags & ~IORING_ENTER_GETEVENTS)
+		return -EINVAL;
+	kstd::Arc<IORing> ring;
+	{
+		LOCK(m_ioring_lock);
+		ring = m_ioring;
+	}
+	if(!ring)
+		return -ENXIO;
+	return ring->enter(to_submit, min_complete, flags);
+}
@@ -14,12 +14,10 @@ int Process::sys_kill(pid_t pid, int sig) {
 		kill(sig);
 	else if(pid == 0) {
 		//Kill all processes with _pgid == this->_pgid
-		auto* procs = TaskManager::process_list();
-		for(int i = 0; i < procs->size(); i++) {
-			auto c_proc = procs->at(i);
-			if((_user.uid == 0 || c_proc->_user.uid == _user.uid) && c_proc->_pgid == _pgid && c_proc->_pid != 1)
+		TaskManager::process_table().for_each(ProcessTable::PGID, _pgid, [&](Process* c_proc) {
+			if((_user.uid == 0 || c_proc->_user.uid == _user.uid) && c_proc->_pid != 1)
 				c_proc->kill(sig);
-		}
+		});
 		kill(sig);
 	} else if(pid == -1) {
 		//kill all processes for which we have permission to kill except init
@@ -32,12 +30,10 @@ int Process::sys_kill(pid_t pid, int sig) {
 		kill(sig);
 	} else if(pid < -1) {
 		//Kill all processes with _pgid == -pid
-		auto* procs = TaskManager::process_list();
-		for(int i = 0; i < procs->size(); i++) {
-			auto c_proc = procs->at(i);
-			if((_user.uid == 0 || c_proc->_user.uid == _user.uid) && c_proc->_pgid == -pid && c_proc->_pid != 1)
+		TaskManager::process_table().for_each(ProcessTable::PGID, -pid, [&](Process* c_proc) {
+			if((_user.uid == 0 || c_proc->_user.uid == _user.uid) && c_proc->_pid != 1)
 				c_proc->kill(sig);
-		}
+		});
 		kill(sig);
 	} else {
 		//Kill process with _pid == pid
@@ -9,12 +9,15 @@
 #include "../filesystem/FileDescriptor.h"
 #include "../filesystem/InodeFile.h"
 #include "../memory/InodeVMObject.h"
+#include "../memory/Swap.h"
+#include "../filesystem/VFS.h"
 
 int Process::sys_shmcreate(void* addr, size_t size, UserspacePointer<struct shm> s) {
 	auto object_res = AnonymousVMObject::alloc(size);
 	if(object_res.is_error())
 		return object_res.code();
 	auto object = object_res.value();
+	object->make_swappable();
 
 	object->share(_pid, VMProt::RW);
 	auto region_res = addr ? map_object(object, (VirtualAddress) addr, VMProt::RW) : map_object(object, VMProt::RW);
@@ -23,7 +26,7 @@ int Process::sys_shmcreate(void* addr, size_t size, UserspacePointer<struct shm>
 	auto region = region_res.value();
 
 	m_mem_lock.synced<void>([&]() {
-		m_used_shmem += region->size();
+		m_shm_attachments[object->shm_id()] = {region, 1};
 	});
 
 	shm ret;
@@ -45,12 +48,22 @@ int Process::sys_shmattach(int id, void* addr, UserspacePointer<struct shm> s) {
 		if(!perms.read)
 			return Result(ENOENT);
 
-		// Map into our space
-		auto region = TRY(addr ? _vm_space->map_object(object, perms, VirtualRange { (VirtualAddress) addr, object->size() }) : _vm_space->map_object(object, perms));
 		LOCK(m_mem_lock);
-		_vm_regions.push_back(region);
-
-		m_used_shmem += region->size();
+		kstd::Arc<VMRegion> region;
+		auto attachment = m_shm_attachments.find_node(id);
+		if(attachment) {
+			// It's already attached, so use the same region
+			region = attachment->data.second.region;
+			if(addr && (VirtualAddress) addr != region->start())
+				return Result(EEXIST);
+			attachment->data.second.count++;
+		} else {
+			// Map into our space. The pages are mapped as they're touched, since the buffer may be big and only partly used.
+			VirtualRange range = addr ? VirtualRange { (VirtualAddress) addr, object->size() } : VirtualRange::null;
+			region = TRY(_vm_space->map_object(object, perms, range, 0, false));
+			_vm_regions.push_back(region);
+			m_shm_attachments[id] = {region, 1};
+		}
 
 		// Setup the shm struct
 		struct shm ret = {
@@ -67,23 +80,27 @@ int Process::sys_shmattach(int id, void* addr, UserspacePointer<struct shm> s) {
 }
 
 int Process::sys_shmdetach(int id) {
-	// Find the object in question
-	auto object_res = AnonymousVMObject::get_shared(id);
-	if(object_res.is_error())
-		return object_res.code();
-	auto object = object_res.value();
-
-	// Remove it from our vm regions
 	LOCK(m_mem_lock);
+	auto attachment = m_shm_attachments.find_node(id);
+	if(!attachment)
+		return -ENOENT;
+	if(--attachment->data.second.count == 0)
+		remove_shm_attachment(id);
+	return SUCCESS;
+}
+
+void Process::remove_shm_attachment(int id) {
+	auto attachment = m_shm_attachments.find_node(id);
+	if(!attachment)
+		return;
+	auto region = attachment->data.second.region;
+	m_shm_attachments.erase(id);
 	for(size_t i = 0; i < _vm_regions.size(); i++) {
-		if(_vm_regions[i]->object() == object) {
-			m_used_shmem -= object->size();
+		if(_vm_regions[i] == region) {
 			_vm_regions.erase(i);
-			return SUCCESS;
+			return;
 		}
 	}
-
-	return ENOENT;
 }
 
 int Process::sys_shmallow(int id, pid_t pid, int perms) {
@@ -95,21 +112,74 @@ int Process::sys_shmallow(int id, pid_t pid, int perms) {
 		return -EINVAL;
 	if((perms & SHM_WRITE) && !(perms & SHM_READ))
 		return -EINVAL;
+
+	// Find the object in question
+	auto object_res = AnonymousVMObject::get_shared(id);
+	if(object_res.is_error())
+		return object_res.code();
+	auto object = object_res.value();
+
+	VMProt prot = {
+		.read = (bool) (perms & SHM_READ),
+		.write = (bool) (perms & SHM_WRITE),
+		.execute = false
+	};
+
+	// Packets that carry shared memory share it every time they're sent, so skip the rest if it's already shared
+	bool transfer = perms & SHM_TRANSFER;
+	auto existing_perms = object->get_shared_permissions(pid);
+	if(!transfer && !existing_perms.is_error() && (existing_perms.value().write || !prot.write))
+		return SUCCESS;
+
 	if(TaskManager::process_for_pid(pid).is_error())
 		return -EINVAL;
 
+	if(transfer) {
+		// We're giving up our own access, so we need to have everything we're handing over
+		if(pid == _pid)
+			return -EINVAL;
+		auto our_perms = object->get_shared_permissions(_pid);
+		if(our_perms.is_error() || (prot.write && !our_perms.value().write))
+			return -EPERM;
+	}
+
+	object->share(pid, prot);
+
+	// When transferring, the pages stay where they are and only the mappings change: ours goes away, and the other
+	// process maps the same pages when it attaches.
+	if(transfer) {
+		object->unshare(_pid);
+		LOCK(m_mem_lock);
+		remove_shm_attachment(id);
+	}
+
+	return SUCCESS;
+}
+
+int Process::sys_shmpurgeable(int id, int purgeable) {
 	// Find the object in question
 	auto object_res = AnonymousVMObject::get_shared(id);
 	if(object_res.is_error())
-		return object_res.code();
+		return -object_res.code();
+	auto object = object_res.value();
 
-	// Set the perms
-	object_res.value()->share(pid, VMProt {
-			.read = (bool) (perms & SHM_READ),
-			.write = (bool) (perms & SHM_WRITE),
-			.execute = false
-	});
+	// Only processes that can write to the memory can let it be thrown away
+	auto perms_res = object->get_shared_permissions(_pid);
+	if(perms_res.is_error() || !perms_res.value().write)
+		return -EPERM;
+
+	return object->set_purgeable(purgeable) ? 1 : 0;
+}
 
+int Process::sys_swapon(UserspacePointer<char> path) {
+	if(!_user.can_override_permissions())
+		return -EPERM;
+	auto fd_res = VFS::inst().open(path.str(), O_RDWR, 0, _user, _cwd);
+	if(fd_res.is_error())
+		return fd_res.code();
+	auto res = Swap::enable(fd_res.value());
+	if(res.is_error())
+		return -res.code();
 	return SUCCESS;
 }
 
@@ -127,7 +197,15 @@ ResultRet<void*> Process::sys_mmap(UserspacePointer<struct mmap_args> args_ptr)
 
 	// First, create an appropriate object
 	if(args.flags & MAP_ANONYMOUS) {
-		vm_object = TRY(AnonymousVMObject::alloc(args.length));
+		// Anonymous memory is allocated up front unless asked not to, so that running out of it is reported here instead
+		// of when the memory is first touched
+		kstd::Arc<AnonymousVMObject> anon_object;
+		if((args.flags & MAP_NORESERVE) && !(args.flags & MAP_POPULATE))
+			anon_object = AnonymousVMObject::alloc_lazy(args.length);
+		else
+			anon_object = TRY(AnonymousVMObject::alloc(args.length));
+		anon_object->make_swappable();
+		vm_object = anon_object;
 	} else {
 		if(args.fd >= _file_descriptors.size() || !_file_descriptors[args.fd])
 			return Result(EBADF);
@@ -135,13 +213,9 @@ ResultRet<void*> Process::sys_mmap(UserspacePointer<struct mmap_args> args_ptr)
 		if((!file_desc->readable() && prot.read) || (!file_desc->writable() && prot.write && (args.flags & MAP_SHARED)))
 			return Result(EPERM);
 		auto file = file_desc->file();
-		if(!file || !file->is_inode())
+		if(!file)
 			return Result(EBADF);
-		auto inode = kstd::static_pointer_cast<InodeFile>(file)->inode();
-		if(args.flags & MAP_SHARED)
-			vm_object = inode->shared_vm_object();
-		else
-			vm_object = InodeVMObject::make_for_inode(inode, InodeVMObject::Type::Private);
+		vm_object = TRY(file->object_for_mapping(args.offset + args.length, args.flags & MAP_SHARED));
 	}
 
 	if(!vm_object)
@@ -159,7 +233,11 @@ ResultRet<void*> Process::sys_mmap(UserspacePointer<struct mmap_args> args_ptr)
 	if(!region)
 		return Result(EINVAL);
 
-	m_used_pmem += region->size();
+	// Anonymous memory is already all there, but files and devices have to be read in. If that fails, whatever's left
+	// will be faulted in as usual.
+	if((args.flags & MAP_POPULATE) && !(args.flags & MAP_ANONYMOUS))
+		_vm_space->populate(*region, VirtualRange { 0, region->size() });
+
 	_vm_regions.push_back(region);
 	return (void*) region->start();
 }
@@ -170,7 +248,6 @@ int Process::sys_munmap(void* addr, size_t length) {
 	// Find the region
 	for(size_t i = 0; i < _vm_regions.size(); i++) {
 		if(_vm_regions[i]->start() == (VirtualAddress) addr && _vm_regions[i]->size() == length) {
-			m_used_pmem -= _vm_regions[i]->size();
 			_vm_regions.erase(i);
 			return SUCCESS;
 		}
@@ -192,6 +269,7 @@ int Process::sys_mprotect(void* addr, size_t length, int prot_flags) {
 	// Find the region
 	for(size_t i = 0; i < _vm_regions.size(); i++) {
 		if(_vm_regions[i]->start() == (VirtualAddress) addr) {
+			LOCK_N(_vm_regions[i]->object()->lock(), object_lock);
 			_vm_regions[i]->set_prot(prot);
 			_page_directory->map(*_vm_regions[i]);
 			return SUCCESS;
@@ -200,4 +278,46 @@ int Process::sys_mprotect(void* addr, size_t length, int prot_flags) {
 
 	KLog::warn("Process", "mprotect() for %s(%d) failed.", _name.c_str(), _pid);
 	return ENOENT;
-}
\ No newline at end of file
+}
+
+int Process::sys_madvise(void* addr, size_t length, int advice) {
+	if((VirtualAddress) addr % PAGE_SIZE)
+		return -EINVAL;
+
+	LOCK(m_mem_lock);
+	auto region_res = _vm_space->get_region_containing((VirtualAddress) addr);
+	if(region_res.is_error())
+		return -ENOMEM;
+	auto region = region_res.value();
+	VirtualAddress offset = (VirtualAddress) addr - region->start();
+	VirtualRange range = { offset, min(kstd::ceil_div(length, PAGE_SIZE) * PAGE_SIZE, region->size() - offset) };
+
+	switch(advice) {
+	case MADV_NORMAL:
+		return SUCCESS;
+
+	case MADV_WILLNEED: {
+		auto res = _vm_space->populate(*region, range);
+		if(res.is_error())
+			return -res.code();
+		return SUCCESS;
+	}
+
+	case MADV_DONTNEED: {
+		// Private anonymous memory is thrown away, and reads back as zeroes. Anything else is only unmapped, since its
+		// contents are still needed by the file or whatever else it's shared with, and it'll be faulted back in from there.
+		auto object = region->object();
+		LOCK_N(object->lock(), object_lock);
+		if(object->is_anonymous() && object->fork_action() == VMObject::ForkAction::BecomeCoW) {
+			auto anon_object = kstd::static_pointer_cast<AnonymousVMObject>(object);
+			anon_object->discard((region->object_start() + range.start) / PAGE_SIZE, range.size / PAGE_SIZE);
+		} else {
+			_page_directory->unmap(*region, range);
+		}
+		return SUCCESS;
+	}
+
+	default:
+		return -EINVAL;
+	}
+}
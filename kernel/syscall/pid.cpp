@@ -19,15 +19,11 @@ int Process::sys_getsid(pid_t pid) {
 
 int Process::sys_setsid() {
 	//Make sure there's no other processes in the group
-	auto* procs = TaskManager::process_list();
-	for(int i = 0; i < procs->size(); i++) {
-		auto c_proc = procs->at(i);
-		if(c_proc->_pgid == _pid)
-			return -EPERM;
-	}
+	if(TaskManager::process_table().find(ProcessTable::PGID, _pid))
+		return -EPERM;
 
-	_sid = _pid;
-	_pgid = _pid;
+	set_sid(_pid);
+	set_pgid(_pid);
 	_tty.reset();
 	return _sid;
 }
@@ -63,17 +59,11 @@ int Process::sys_setpgid(pid_t pid, pid_t new_pgid) {
 		new_pgid = proc.value()->_pid;
 
 	//Make sure we're not switching to another session
-	pid_t new_sid = _sid;
-	auto* procs = TaskManager::process_list();
-	for(int i = 0; i < procs->size(); i++) {
-		auto c_proc = procs->at(i);
-		if(c_proc->_pgid == new_pgid)
-			new_sid = c_proc->_sid;
-	}
-	if(new_sid != _sid)
+	auto* group_member = TaskManager::process_table().find(ProcessTable::PGID, new_pgid);
+	if(group_member && group_member->_sid != _sid)
 		return -EPERM;
 
-	proc.value()->_pgid = new_pgid;
+	proc.value()->set_pgid(new_pgid);
 	return SUCCESS;
 }
 
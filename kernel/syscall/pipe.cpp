@@ -5,6 +5,7 @@
 #include "../memory/SafePointer.h"
 #include "../filesystem/VFS.h"
 #include "../filesystem/Pipe.h"
+#include "../api/splice.h"
 
 int Process::sys_pipe(UserspacePointer<int> filedes, int options) {
 	options &= (O_CLOEXEC | O_NONBLOCK);
@@ -33,4 +34,61 @@ int Process::sys_pipe(UserspacePointer<int> filedes, int options) {
 	filedes.set(1, (int) _file_descriptors.size() - 1);
 
 	return SUCCESS;
-}
\ No newline at end of file
+}
+int Process::sys_splice(UserspacePointer<struct splice_args> args_ptr) {
+	auto args = args_ptr.get();
+	if(args.fd_in < 0 || args.fd_in >= (int) _file_descriptors.size() || !_file_descriptors[args.fd_in])
+		return -EBADF;
+	if(args.fd_out < 0 || args.fd_out >= (int) _file_descriptors.size() || !_file_descriptors[args.fd_out])
+		return -EBADF;
+	auto in_fd = _file_descriptors[args.fd_in];
+	auto out_fd = _file_descriptors[args.fd_out];
+	if(!in_fd->readable() || !out_fd->writable())
+		return -EBADF;
+
+	auto in_file = in_fd->file();
+	auto out_file = out_fd->file();
+	bool in_pipe = in_file->is_fifo();
+	bool out_pipe = out_file->is_fifo();
+	if((in_pipe && args.off_in) || (out_pipe && args.off_out))
+		return -ESPIPE;
+	if(in_pipe && out_pipe)
+		return ((Pipe*) in_file.get())->splice_to(*in_fd, *((Pipe*) out_file.get()), *out_fd, args.len, false);
+	if(!in_pipe && !out_pipe)
+		return -EINVAL;
+
+	//The file on the other end is used at the given offset, or at its own offset if there isn't one
+	auto& file_fd = in_pipe ? *out_fd : *in_fd;
+	UserspacePointer<off_t> offset_ptr(in_pipe ? args.off_out : args.off_in);
+	off_t offset = offset_ptr.raw() ? offset_ptr.get() : (off_t) file_fd.offset();
+	if(offset < 0)
+		return -EINVAL;
+
+	ssize_t ret;
+	if(in_pipe)
+		ret = ((Pipe*) in_file.get())->splice_to_file(*in_fd, *out_file, *out_fd, offset, args.len);
+	else
+		ret = ((Pipe*) out_file.get())->splice_from_file(*out_fd, *in_file, *in_fd, offset, args.len);
+
+	if(ret > 0) {
+		if(offset_ptr.raw())
+			offset_ptr.set(offset + ret);
+		else
+			file_fd.seek(offset + ret, SEEK_SET);
+	}
+	return ret;
+}
+
+int Process::sys_tee(int fd_in, int fd_out, size_t len) {
+	if(fd_in < 0 || fd_in >= (int) _file_descriptors.size() || !_file_descriptors[fd_in])
+		return -EBADF;
+	if(fd_out < 0 || fd_out >= (int) _file_descriptors.size() || !_file_descriptors[fd_out])
+		return -EBADF;
+	auto in_fd = _file_descriptors[fd_in];
+	auto out_fd = _file_descriptors[fd_out];
+	if(!in_fd->readable() || !out_fd->writable())
+		return -EBADF;
+	if(!in_fd->file()->is_fifo() || !out_fd->file()->is_fifo())
+		return -EINVAL;
+	return ((Pipe*) in_fd->file().get())->splice_to(*in_fd, *((Pipe*) out_fd->file().get()), *out_fd, len, true);
+}
@@ -4,6 +4,9 @@
 #include "../tasking/Process.h"
 #include "../filesystem/FileDescriptor.h"
 #include <kernel/filesystem/VFS.h>
+#include <kernel/api/uio.h>
+#include <kernel/api/splice.h>
+#include <kernel/filesystem/InodeFile.h>
 
 ssize_t Process::sys_read(int fd, UserspacePointer<uint8_t> buf, size_t count) {
 	if(fd < 0 || fd >= (int) _file_descriptors.size() || !_file_descriptors[fd])
@@ -24,6 +27,88 @@ ssize_t Process::sys_write(int fd, UserspacePointer<uint8_t> buffer, size_t coun
 	return ret;
 }
 
+ssize_t Process::sys_readv(int fd, UserspacePointer<struct iovec> iov, int iovcnt) {
+	if(fd < 0 || fd >= (int) _file_descriptors.size() || !_file_descriptors[fd])
+		return -EBADF;
+	return _file_descriptors[fd]->readv(iov, iovcnt);
+}
+
+ssize_t Process::sys_writev(int fd, UserspacePointer<struct iovec> iov, int iovcnt) {
+	if(fd < 0 || fd >= (int) _file_descriptors.size() || !_file_descriptors[fd])
+		return -EBADF;
+	return _file_descriptors[fd]->writev(iov, iovcnt);
+}
+
+ssize_t Process::sys_preadv(UserspacePointer<struct iov_args> args_ptr) {
+	auto args = args_ptr.get();
+	if(args.fd < 0 || args.fd >= (int) _file_descriptors.size() || !_file_descriptors[args.fd])
+		return -EBADF;
+	if(args.offset < 0)
+		return -EINVAL;
+	return _file_descriptors[args.fd]->readv(UserspacePointer<struct iovec>((struct iovec*) args.iov), args.iovcnt, args.offset);
+}
+
+ssize_t Process::sys_pwritev(UserspacePointer<struct iov_args> args_ptr) {
+	auto args = args_ptr.get();
+	if(args.fd < 0 || args.fd >= (int) _file_descriptors.size() || !_file_descriptors[args.fd])
+		return -EBADF;
+	if(args.offset < 0)
+		return -EINVAL;
+	return _file_descriptors[args.fd]->writev(UserspacePointer<struct iovec>((struct iovec*) args.iov), args.iovcnt, args.offset);
+}
+
+ssize_t Process::sys_copy_file_range(UserspacePointer<struct splice_args> args_ptr) {
+	auto args = args_ptr.get();
+	if(args.fd_in < 0 || args.fd_in >= (int) _file_descriptors.size() || !_file_descriptors[args.fd_in])
+		return -EBADF;
+	if(args.fd_out < 0 || args.fd_out >= (int) _file_descriptors.size() || !_file_descriptors[args.fd_out])
+		return -EBADF;
+	auto in_fd = _file_descriptors[args.fd_in];
+	auto out_fd = _file_descriptors[args.fd_out];
+	if(!in_fd->readable() || !out_fd->writable() || out_fd->append_mode())
+		return -EBADF;
+	if(args.flags)
+		return -EINVAL;
+
+	//Both ends have to be regular files
+	auto in_file = in_fd->file();
+	auto out_file = out_fd->file();
+	if(!in_file->is_inode() || !out_file->is_inode())
+		return -EINVAL;
+	auto in_inode = ((InodeFile*) in_file.get())->inode();
+	auto out_inode = ((InodeFile*) out_file.get())->inode();
+	if(in_inode->metadata().is_directory() || out_inode->metadata().is_directory())
+		return -EISDIR;
+	if(!in_inode->metadata().is_simple_file() || !out_inode->metadata().is_simple_file())
+		return -EINVAL;
+
+	//Each file is used at the given offset, or at its own offset if there isn't one
+	UserspacePointer<off_t> in_offset_ptr(args.off_in);
+	UserspacePointer<off_t> out_offset_ptr(args.off_out);
+	off_t in_offset = in_offset_ptr.raw() ? in_offset_ptr.get() : (off_t) in_fd->offset();
+	off_t out_offset = out_offset_ptr.raw() ? out_offset_ptr.get() : (off_t) out_fd->offset();
+	if(in_offset < 0 || out_offset < 0)
+		return -EINVAL;
+	size_t len = min(args.len, (size_t) INT32_MAX);
+
+	//Copying a file onto an overlapping part of itself would read data we just wrote
+	if(in_inode.get() == out_inode.get() && (size_t) in_offset < out_offset + len && (size_t) out_offset < in_offset + len)
+		return -EINVAL;
+
+	ssize_t ret = ((InodeFile*) in_file.get())->copy_to(*in_fd, in_offset, *out_file, *out_fd, out_offset, len);
+	if(ret > 0) {
+		if(in_offset_ptr.raw())
+			in_offset_ptr.set(in_offset + ret);
+		else
+			in_fd->seek(in_offset + ret, SEEK_SET);
+		if(out_offset_ptr.raw())
+			out_offset_ptr.set(out_offset + ret);
+		else
+			out_fd->seek(out_offset + ret, SEEK_SET);
+	}
+	return ret;
+}
+
 int Process::sys_lseek(int file, off_t off, int whence) {
 	if(file < 0 || file >= (int) _file_descriptors.size() || !_file_descriptors[file])
 		return -EBADF;
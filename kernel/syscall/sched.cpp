@@ -0,0 +1,159 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "../tasking/Process.h"
+#include "../tasking/TaskManager.h"
+#include "../tasking/Thread.h"
+#include "../tasking/Processor.h"
+#include "../memory/SafePointer.h"
+#include "../api/resource.h"
+
+template<typename F>
+static int for_each_priority_target(int which, id_t who, F callback) {
+	switch(which) {
+		case PRIO_PROCESS: {
+			auto proc = TaskManager::process_for_pid(who);
+			if(!proc.is_error())
+				callback(proc.value());
+			return SUCCESS;
+		}
+		case PRIO_PGRP:
+			TaskManager::process_table().for_each(ProcessTable::PGID, who, callback);
+			return SUCCESS;
+		case PRIO_USER: {
+			auto* procs = TaskManager::process_list();
+			for(size_t i = 0; i < procs->size(); i++) {
+				auto proc = procs->at(i);
+				if(proc->user().uid == who && proc->state() == Process::ALIVE)
+					callback(proc);
+			}
+			return SUCCESS;
+		}
+		default:
+			return -EINVAL;
+	}
+}
+
+static ResultRet<kstd::Arc<Thread>> thread_for_tid(Process* self, tid_t tid) {
+	if(tid == 0)
+		return TaskManager::current_thread();
+	auto thread = self->get_thread(tid);
+	if(thread)
+		return thread;
+	auto proc = TaskManager::process_for_pid(tid);
+	if(proc.is_error())
+		return Result(-ESRCH);
+	thread = proc.value()->get_thread(tid);
+	if(!thread)
+		return Result(-ESRCH);
+	return thread;
+}
+
+int Process::sys_getpriority(int which, id_t who) {
+	if(!who)
+		who = which == PRIO_USER ? _user.uid : (which == PRIO_PGRP ? _pgid : _pid);
+
+	int nice = PRIO_MAX;
+	bool found = false;
+	auto res = for_each_priority_target(which, who, [&](Process* proc) {
+		found = true;
+		if(proc->_nice < nice)
+			nice = proc->_nice;
+	});
+	if(res != SUCCESS)
+		return res;
+	if(!found)
+		return -ESRCH;
+
+	// Nice values can be negative, so return it offset such that it can't be confused with an error
+	return PRIO_MAX - nice;
+}
+
+int Process::sys_setpriority(int which, id_t who, int value) {
+	if(!who)
+		who = which == PRIO_USER ? _user.uid : (which == PRIO_PGRP ? _pgid : _pid);
+	if(value < PRIO_MIN)
+		value = PRIO_MIN;
+	else if(value >= PRIO_MAX)
+		value = PRIO_MAX - 1;
+
+	int ret = SUCCESS;
+	bool found = false;
+	auto res = for_each_priority_target(which, who, [&](Process* proc) {
+		found = true;
+		if(_user.euid != 0 && proc->_user.uid != _user.euid) {
+			ret = -EPERM;
+			return;
+		}
+		//Only root can raise a process's priority
+		if(_user.euid != 0 && value < proc->_nice) {
+			ret = -EACCES;
+			return;
+		}
+		proc->set_nice(value);
+	});
+	if(res != SUCCESS)
+		return res;
+	if(!found)
+		return -ESRCH;
+	return ret;
+}
+
+int Process::sys_getrusage(int who, UserspacePointer<struct rusage> usage) {
+	uint64_t user_time, kernel_time;
+	if(who == RUSAGE_SELF) {
+		cpu_time(user_time, kernel_time);
+	} else if(who == RUSAGE_CHILDREN) {
+		LOCK(_thread_lock);
+		user_time = _child_user_time;
+		kernel_time = _child_kernel_time;
+	} else {
+		return -EINVAL;
+	}
+
+	struct rusage ret = {};
+	ret.ru_utime = {(time_t) (user_time / 1000000), (suseconds_t) (user_time % 1000000)};
+	ret.ru_stime = {(time_t) (kernel_time / 1000000), (suseconds_t) (kernel_time % 1000000)};
+	usage.set(ret);
+	return SUCCESS;
+}
+
+int Process::sys_sched_setaffinity(tid_t tid, size_t size, UserspacePointer<cpu_set_t> mask) {
+	if(size < sizeof(cpu_set_t))
+		return -EINVAL;
+	auto thread_res = thread_for_tid(_self_ptr, tid);
+	if(thread_res.is_error())
+		return thread_res.code();
+	auto thread = thread_res.value();
+	if(_user.euid != 0 && thread->process()->_user.uid != _user.euid)
+		return -EPERM;
+
+	//The thread has to be able to run on at least one processor that's online
+	auto affinity = mask.get().mask;
+	if(!(affinity & Processor::online_mask()))
+		return -EINVAL;
+
+	{
+		CRITICAL_LOCK(TaskManager::g_tasking_lock);
+		thread->set_affinity(affinity);
+		//Move the thread to a processor it's allowed to run on if it's waiting to run on one it isn't
+		if(thread->is_queued()) {
+			TaskManager::dequeue_thread(thread.get());
+			TaskManager::queue_thread(thread);
+		}
+	}
+
+	if(thread == TaskManager::current_thread() && !thread->can_run_on(Processor::current().id()))
+		TaskManager::yield();
+	return SUCCESS;
+}
+
+int Process::sys_sched_getaffinity(tid_t tid, size_t size, UserspacePointer<cpu_set_t> mask) {
+	if(size < sizeof(cpu_set_t))
+		return -EINVAL;
+	auto thread_res = thread_for_tid(_self_ptr, tid);
+	if(thread_res.is_error())
+		return thread_res.code();
+	mask.set({thread_res.value()->affinity() & Processor::online_mask()});
+	return SUCCESS;
+}
@@ -4,6 +4,7 @@
 #include "../tasking/Process.h"
 #include "../memory/SafePointer.h"
 #include "../filesystem/VFS.h"
+#include "syscall_numbers.h"
 
 int Process::sys_fstat(int file, UserspacePointer<struct stat> buf) {
 	if(file < 0 || file >= (int) _file_descriptors.size() || !_file_descriptors[file])
@@ -34,4 +35,28 @@ int Process::sys_lstat(UserspacePointer<char> file, UserspacePointer<struct stat
 		inode_or_err.value()->inode()->metadata().stat(buf.raw());
 	});
 	return 0;
-}
\ No newline at end of file
+}
+
+int Process::sys_fstatat(UserspacePointer<struct fstatat_args> args_ptr) {
+	auto args = args_ptr.get();
+	kstd::string path = UserspacePointer<char>((char*) args.path).str();
+
+	//Relative paths are looked up from the directory the fd was opened for, which is cheaper than resolving a full path
+	auto base = _cwd;
+	if(args.fd != AT_FDCWD && (!path.length() || path[0] != '/')) {
+		if(args.fd < 0 || args.fd >= (int) _file_descriptors.size() || !_file_descriptors[args.fd])
+			return -EBADF;
+		base = _file_descriptors[args.fd]->linked_inode();
+		if(!base || !base->inode()->metadata().is_directory())
+			return -ENOTDIR;
+	}
+
+	auto inode_or_err = VFS::inst().resolve_path(path, base, _user, nullptr, (args.flags & AT_SYMLINK_NOFOLLOW) ? O_INTERNAL_RETLINK : 0);
+	if(inode_or_err.is_error())
+		return inode_or_err.code();
+	UserspacePointer<struct stat> buf(args.buf);
+	buf.checked<void>(true, 0, 1, [&]() {
+		inode_or_err.value()->inode()->metadata().stat(buf.raw());
+	});
+	return 0;
+}
@@ -0,0 +1,23 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "../tasking/Process.h"
+#include "../filesystem/FileDescriptor.h"
+#include "../filesystem/File.h"
+#include "../filesystem/FileBasedFilesystem.h"
+#include "../device/DiskDevice.h"
+
+int Process::sys_fsync(int file) {
+	if(file < 0 || file >= (int) _file_descriptors.size() || !_file_descriptors[file])
+		return -EBADF;
+	auto res = _file_descriptors[file]->file()->sync();
+	if(res.is_error())
+		return res.code();
+	return SUCCESS;
+}
+
+int Process::sys_sync() {
+	FileBasedFilesystem::write_all_metadata();
+	DiskDevice::flush_all();
+	return SUCCESS;
+}
@@ -22,11 +22,48 @@
 #include <kernel/kstd/kstdio.h>
 #include <kernel/tasking/TaskManager.h>
 #include "kernel/memory/SafePointer.h"
+#include <kernel/tasking/Processor.h>
+#include <kernel/kstd/KLog.h>
+#include <kernel/Trace.h>
+#include <kernel/time/TimeManager.h>
+
+#define MSR_SYSENTER_CS 0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+extern "C" void asm_sysenter_handler();
+
+void init_sysenter() {
+	uint32_t eax, ebx, ecx, edx;
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+	uint32_t family = (eax >> 8) & 0xF, model = (eax >> 4) & 0xF, stepping = eax & 0xF;
+	//Early Pentium Pros claim to support sysenter, but don't
+	if(!(edx & (1 << 11)) || (family == 6 && model < 3 && stepping < 3)) {
+		KLog::dbg("Syscall", "sysenter isn't supported, only int 0x80 will be used");
+		return;
+	}
+
+	//The stack pointer is loaded from the TSS by the entry stub, since it changes with every context switch
+	auto wrmsr = [](uint32_t msr, uint32_t value) {
+		asm volatile("wrmsr" :: "c"(msr), "a"(value), "d"(0));
+	};
+	wrmsr(MSR_SYSENTER_CS, 0x08);
+	wrmsr(MSR_SYSENTER_ESP, (uint32_t) &Processor::current().tss.esp0);
+	wrmsr(MSR_SYSENTER_EIP, (uint32_t) asm_sysenter_handler);
+	KLog::dbg("Syscall", "sysenter enabled");
+}
 
 void syscall_handler(Registers& regs){
+	TaskManager::current_thread()->stats_enter_kernel();
 	TaskManager::current_thread()->enter_critical();
+	auto call = regs.eax;
+	TRACE(TRACE_SYSCALL_ENTER, call, regs.ebx, regs.ecx);
+	auto start_ns = TimeManager::uptime_ns();
 	regs.eax = handle_syscall(regs, regs.eax, regs.ebx, regs.ecx, regs.edx);
+	TaskManager::current_thread()->process()->record_syscall(call, TimeManager::uptime_ns() - start_ns, (int) regs.eax);
+	TRACE(TRACE_SYSCALL_EXIT, call, regs.eax);
 	TaskManager::current_thread()->leave_critical();
+	TaskManager::current_thread()->stats_leave_kernel();
 }
 
 int handle_syscall(Registers& regs, uint32_t call, uint32_t arg1, uint32_t arg2, uint32_t arg3) {
@@ -171,7 +208,7 @@ int handle_syscall(Registers& regs, uint32_t call, uint32_t arg1, uint32_t arg2,
 		case SYS_SLEEP:
 			return cur_proc->sys_sleep((timespec*) arg1, (timespec*) arg2);
 		case SYS_THREADCREATE:
-			return cur_proc->sys_threadcreate((void* (*)(void* (*)(void*), void*)) arg1, (void* (*)(void*)) arg2, (void*) arg3);
+			return cur_proc->sys_threadcreate((struct threadcreate_args*) arg1);
 		case SYS_GETTID:
 			return cur_proc->sys_gettid();
 		case SYS_THREADJOIN:
@@ -186,6 +223,64 @@ int handle_syscall(Registers& regs, uint32_t call, uint32_t arg1, uint32_t arg2,
 			return cur_proc->sys_mprotect((void*) arg1, (size_t) arg2, arg3);
 		case SYS_UNAME:
 			return cur_proc->sys_uname((struct utsname*) arg1);
+		case SYS_GETPRIORITY:
+			return cur_proc->sys_getpriority((int) arg1, (id_t) arg2);
+		case SYS_SETPRIORITY:
+			return cur_proc->sys_setpriority((int) arg1, (id_t) arg2, (int) arg3);
+		case SYS_SCHED_SETAFFINITY:
+			return cur_proc->sys_sched_setaffinity((tid_t) arg1, (size_t) arg2, (cpu_set_t*) arg3);
+		case SYS_SCHED_GETAFFINITY:
+			return cur_proc->sys_sched_getaffinity((tid_t) arg1, (size_t) arg2, (cpu_set_t*) arg3);
+		case SYS_SHMPURGEABLE:
+			return cur_proc->sys_shmpurgeable((int) arg1, (int) arg2);
+		case SYS_SWAPON:
+			return cur_proc->sys_swapon((char*) arg1);
+		case SYS_FSYNC:
+			return cur_proc->sys_fsync((int) arg1);
+		case SYS_SYNC:
+			return cur_proc->sys_sync();
+		case SYS_SPLICE:
+			return cur_proc->sys_splice((struct splice_args*) arg1);
+		case SYS_TEE:
+			return cur_proc->sys_tee((int) arg1, (int) arg2, (size_t) arg3);
+		case SYS_FCNTL:
+			return cur_proc->sys_fcntl((int) arg1, (int) arg2, (int) arg3);
+		case SYS_EPOLL_CREATE:
+			return cur_proc->sys_epoll_create((int) arg1);
+		case SYS_EPOLL_CTL:
+			return cur_proc->sys_epoll_ctl((struct epoll_ctl_args*) arg1);
+		case SYS_EPOLL_WAIT:
+			return cur_proc->sys_epoll_wait((struct epoll_wait_args*) arg1);
+		case SYS_READV:
+			return cur_proc->sys_readv((int) arg1, (struct iovec*) arg2, (int) arg3);
+		case SYS_WRITEV:
+			return cur_proc->sys_writev((int) arg1, (struct iovec*) arg2, (int) arg3);
+		case SYS_PREADV:
+			return cur_proc->sys_preadv((struct iov_args*) arg1);
+		case SYS_PWRITEV:
+			return cur_proc->sys_pwritev((struct iov_args*) arg1);
+		case SYS_COPY_FILE_RANGE:
+			return cur_proc->sys_copy_file_range((struct splice_args*) arg1);
+		case SYS_CLOCK_GETTIME:
+			return cur_proc->sys_clock_gettime((clockid_t) arg1, (struct timespec*) arg2);
+		case SYS_SPAWN:
+			return cur_proc->sys_spawn((struct spawn_args*) arg1);
+		case SYS_FUTEX:
+			return cur_proc->sys_futex((struct futex_args*) arg1);
+		case SYS_SET_THREAD_POINTER:
+			return cur_proc->sys_set_thread_pointer((void*) arg1);
+		case SYS_GETRUSAGE:
+			return cur_proc->sys_getrusage((int) arg1, (struct rusage*) arg2);
+		case SYS_FSTATAT:
+			return cur_proc->sys_fstatat((struct fstatat_args*) arg1);
+		case SYS_GETRANDOM:
+			return cur_proc->sys_getrandom((uint8_t*) arg1, (size_t) arg2, (unsigned int) arg3);
+		case SYS_MADVISE:
+			return cur_proc->sys_madvise((void*) arg1, (size_t) arg2, (int) arg3);
+		case SYS_IORING_SETUP:
+			return cur_proc->sys_ioring_setup((struct ioring_params*) arg1);
+		case SYS_IORING_ENTER:
+			return cur_proc->sys_ioring_enter((uint32_t) arg1, (uint32_t) arg2, (int) arg3);
 
 		//TODO: Implement these syscalls
 		case SYS_TIMES:
@@ -23,4 +23,6 @@
 #include "../kstd/kstddef.h"
 
 extern "C" void syscall_handler(Registers& regs);
+/// Sets up sysenter on the current processor if it supports it. int 0x80 keeps working either way.
+void init_sysenter();
 int handle_syscall(Registers& regs, uint32_t call, uint32_t arg1, uint32_t arg2, uint32_t arg3);
\ No newline at end of file
@@ -78,6 +78,35 @@
 #define SYS_ACCESS 75
 #define SYS_MPROTECT 76
 #define SYS_UNAME 77
+#define SYS_GETPRIORITY 78
+#define SYS_SETPRIORITY 79
+#define SYS_SCHED_SETAFFINITY 80
+#define SYS_SCHED_GETAFFINITY 81
+#define SYS_SHMPURGEABLE 82
+#define SYS_SWAPON 83
+#define SYS_FSYNC 84
+#define SYS_SYNC 85
+#define SYS_SPLICE 86
+#define SYS_TEE 87
+#define SYS_FCNTL 88
+#define SYS_EPOLL_CREATE 89
+#define SYS_EPOLL_CTL 90
+#define SYS_EPOLL_WAIT 91
+#define SYS_READV 92
+#define SYS_WRITEV 93
+#define SYS_PREADV 94
+#define SYS_PWRITEV 95
+#define SYS_COPY_FILE_RANGE 96
+#define SYS_CLOCK_GETTIME 97
+#define SYS_SPAWN 98
+#define SYS_FUTEX 99
+#define SYS_SET_THREAD_POINTER 100
+#define SYS_GETRUSAGE 101
+#define SYS_FSTATAT 102
+#define SYS_GETRANDOM 103
+#define SYS_MADVISE 104
+#define SYS_IORING_SETUP 105
+#define SYS_IORING_ENTER 106
 
 #ifndef DUCKOS_KERNEL
 #include <sys/types.h>
@@ -88,4 +117,18 @@ struct readlinkat_args {
 	const char* path;
 	char* buf;
 	size_t bufsize;
+};
+
+struct fstatat_args {
+	int fd;
+	const char* path;
+	struct stat* buf;
+	int flags;
+};
+
+struct threadcreate_args {
+	void* (*entry_func)(void* (*)(void*), void*);
+	void* (*thread_func)(void*);
+	void* arg;
+	void* thread_pointer; ///< What the new thread's gs segment starts at, for its thread-local storage.
 };
\ No newline at end of file
@@ -3,10 +3,13 @@
 
 #include "../tasking/Process.h"
 #include "../memory/SafePointer.h"
+#include "../memory/gdt.h"
+#include "syscall_numbers.h"
 
-int Process::sys_threadcreate(void* (*entry_func)(void* (*)(void*), void*), void* (*thread_func)(void*), void* arg) {
-	auto thread = kstd::make_shared<Thread>(_self_ptr, TaskManager::get_new_pid(), entry_func, thread_func, arg);
-	recalculate_pmem_total();
+int Process::sys_threadcreate(UserspacePointer<struct threadcreate_args> args_ptr) {
+	auto args = args_ptr.get();
+	auto thread = kstd::make_shared<Thread>(_self_ptr, TaskManager::get_new_pid(), args.entry_func, args.thread_func, args.arg);
+	thread->set_tls_base((uintptr_t) args.thread_pointer);
 	insert_thread(thread);
 	{
 		CRITICAL_LOCK(TaskManager::g_tasking_lock);
@@ -44,4 +47,11 @@ int Process::sys_threadexit(void* return_value) {
 	TaskManager::current_thread()->exit(return_value);
 	ASSERT(false);
 	return -1;
+}
+
+int Process::sys_set_thread_pointer(void* pointer) {
+	// If we get preempted in between, switching back to us will load the new one anyway
+	TaskManager::current_thread()->set_tls_base((uintptr_t) pointer);
+	Memory::set_tls_base((uintptr_t) pointer);
+	return SUCCESS;
 }
\ No newline at end of file
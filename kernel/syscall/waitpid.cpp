@@ -15,7 +15,16 @@ int Process::sys_waitpid(pid_t pid, UserspacePointer<int> status, int flags) {
 		return blocker.error();
 	if(status)
 		status.set(blocker.exit_status());
-	if(blocker.waited_process())
-		delete blocker.waited_process();
+	auto child = blocker.waited_process();
+	if(child) {
+		uint64_t user_time, kernel_time;
+		child->cpu_time(user_time, kernel_time);
+		{
+			LOCK(_thread_lock);
+			_child_user_time += user_time + child->_child_user_time;
+			_child_kernel_time += kernel_time + child->_child_kernel_time;
+		}
+		delete child;
+	}
 	return blocker.waited_pid();
 }
@@ -19,6 +19,16 @@
 
 #include "Blocker.h"
 #include "Process.h"
+#include "TaskManager.h"
+
+Blocker::Blocker(): m_timeout_timer(timeout_callback, this) {}
+
+Blocker::~Blocker() {
+	TaskManager::ScopedCritical critical;
+	clear_timeout();
+	while(m_waiters)
+		remove_waiter(m_waiters);
+}
 
 bool Blocker::can_be_interrupted() {
 	return true;
@@ -26,6 +36,7 @@ bool Blocker::can_be_interrupted() {
 
 void Blocker::interrupt() {
 	_interrupted = true;
+	notify();
 }
 
 void Blocker::reset_interrupted() {
@@ -36,10 +47,54 @@ bool Blocker::was_interrupted() {
 	return _interrupted;
 }
 
+bool Blocker::notify() {
+	TaskManager::ScopedCritical critical;
+	if(!m_waiters || !(_interrupted || is_ready()))
+		return false;
+
+	while(m_waiters) {
+		auto* thread = m_waiters;
+		remove_waiter(thread);
+		thread->unblock();
+	}
+	return true;
+}
+
 void Blocker::on_interrupted() {
 
 }
 
+void Blocker::set_timeout(Time time) {
+	m_timeout_timer.start(time);
+}
+
+void Blocker::clear_timeout() {
+	m_timeout_timer.stop();
+}
+
+void Blocker::timeout_callback(void* blocker) {
+	((Blocker*) blocker)->notify();
+}
+
+void Blocker::add_waiter(Thread* thread) {
+	thread->m_prev_waiter = nullptr;
+	thread->m_next_waiter = m_waiters;
+	if(m_waiters)
+		m_waiters->m_prev_waiter = thread;
+	m_waiters = thread;
+}
+
+void Blocker::remove_waiter(Thread* thread) {
+	if(thread->m_prev_waiter)
+		thread->m_prev_waiter->m_next_waiter = thread->m_next_waiter;
+	else if(m_waiters == thread)
+		m_waiters = thread->m_next_waiter;
+	if(thread->m_next_waiter)
+		thread->m_next_waiter->m_prev_waiter = thread->m_prev_waiter;
+	thread->m_next_waiter = nullptr;
+	thread->m_prev_waiter = nullptr;
+}
+
 bool Blocker::is_lock() {
 	return false;
 }
@@ -19,10 +19,16 @@
 
 #pragma once
 
+#include <kernel/time/Time.h>
+#include <kernel/time/TimerQueue.h>
+
 class Process;
 class Thread;
 class Blocker {
 public:
+	Blocker();
+	virtual ~Blocker();
+
 	virtual bool is_ready() = 0;
 	virtual bool can_be_interrupted();
 	virtual bool is_lock();
@@ -32,10 +38,28 @@ public:
 	void reset_interrupted();
 	bool was_interrupted();
 
+	/// Unblocks the threads blocked on this blocker if it is ready or was interrupted. Safe to call from an interrupt.
+	/// Returns whether any threads were unblocked.
+	bool notify();
+
 protected:
 	virtual void on_interrupted();
 
+	/// Makes sure that notify() gets called once the given time is reached.
+	void set_timeout(Time time);
+	void clear_timeout();
+
 private:
+	friend class Thread;
+	void add_waiter(Thread* thread);
+	void remove_waiter(Thread* thread);
+	static void timeout_callback(void* blocker);
+
 	bool _interrupted = false;
+
+	// Threads blocked on this blocker, linked through Thread::m_next_waiter
+	Thread* m_waiters = nullptr;
+
+	Timer m_timeout_timer;
 };
 
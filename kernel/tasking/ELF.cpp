@@ -21,6 +21,7 @@
 #include <kernel/filesystem/VFS.h>
 #include <kernel/memory/MemoryManager.h>
 #include <kernel/filesystem/FileDescriptor.h>
+#include <kernel/filesystem/InodeFile.h>
 #include <kernel/memory/PageDirectory.h>
 #include <kernel/kstd/KLog.h>
 
@@ -119,6 +120,23 @@ ResultRet<kstd::vector<kstd::Arc<VMRegion>>> ELF::load_sections(FileDescriptor&
 		if(header.p_type == ELF_PT_LOAD) {
 			size_t loadloc_pagealigned = (header.p_vaddr/PAGE_SIZE) * PAGE_SIZE;
 			size_t loadsize_pagealigned = header.p_memsz + (header.p_vaddr % PAGE_SIZE);
+			VMProt prot = {
+				.read = (bool) (header.p_flags & ELF_PF_R),
+				.write = (bool) (header.p_flags & ELF_PF_W),
+				.execute = (bool) (header.p_flags & ELF_PF_X)
+			};
+
+			//Read-only segments are mapped straight from the file, so every process running it shares the page cache's
+			//copy of them. They have to line up with pages in the file, and can't have any zeroed space after them.
+			auto file = fd.file();
+			if(!prot.write && header.p_memsz == header.p_filesz && header.p_offset % PAGE_SIZE == header.p_vaddr % PAGE_SIZE && file->is_inode()) {
+				auto inode = kstd::static_pointer_cast<InodeFile>(file)->inode();
+				auto object = TRY(inode->object_for_mapping(false));
+				size_t size = ((loadsize_pagealigned + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+				auto vmem_region = TRY(vm_space->map_object(object, prot, VirtualRange { loadloc_pagealigned, size }, header.p_offset - header.p_vaddr % PAGE_SIZE));
+				regions.push_back(vmem_region);
+				continue;
+			}
 
 			//Allocate a kernel memory region to load the section into
 			auto tmp_region = MM.alloc_kernel_region(loadsize_pagealigned);
@@ -128,11 +146,6 @@ ResultRet<kstd::vector<kstd::Arc<VMRegion>>> ELF::load_sections(FileDescriptor&
 			fd.read(KernelPointer<uint8_t>((uint8_t*) tmp_region->start() + (header.p_vaddr - loadloc_pagealigned)), header.p_filesz);
 
 			//Map it into the program's vmem
-			VMProt prot = {
-				.read = (bool) (header.p_flags & ELF_PF_R),
-				.write = (bool) (header.p_flags & ELF_PF_W),
-				.execute = (bool) (header.p_flags & ELF_PF_X)
-			};
 			auto vmem_region = TRY(vm_space->map_object(tmp_region->object(), prot, VirtualRange { loadloc_pagealigned, tmp_region->size() }));
 			regions.push_back(vmem_region);
 		}
@@ -0,0 +1,115 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "FPU.h"
+#include "Processor.h"
+#include "Thread.h"
+#include <kernel/kstd/KLog.h>
+
+#define CR0_TS (1u << 3)
+#define CR4_OSXSAVE (1u << 18)
+#define CPUID_ECX_XSAVE (1u << 26)
+#define CPUID_ECX_AVX (1u << 28)
+#define XCR0_X87 (1u << 0)
+#define XCR0_SSE (1u << 1)
+#define XCR0_AVX (1u << 2)
+#define MXCSR_DEFAULT 0x1F80
+
+namespace FPU {
+	static bool s_use_xsave = false;
+	static uint32_t s_xsave_mask = 0;
+
+	static inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t& eax, uint32_t& ebx, uint32_t& ecx, uint32_t& edx) {
+		asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(leaf), "c"(subleaf));
+	}
+
+	static inline void set_ts() {
+		uint32_t cr0;
+		asm volatile("mov %%cr0, %0" : "=r"(cr0));
+		asm volatile("mov %0, %%cr0" :: "r"(cr0 | CR0_TS));
+	}
+
+	static inline void clear_ts() {
+		asm volatile("clts");
+	}
+
+	static void save(uint8_t* state) {
+		if(s_use_xsave)
+			asm volatile("xsave (%0)" :: "r"(state), "a"(s_xsave_mask), "d"(0) : "memory");
+		else
+			asm volatile("fxsave (%0)" :: "r"(state) : "memory");
+	}
+
+	static void restore(uint8_t* state) {
+		if(s_use_xsave)
+			asm volatile("xrstor (%0)" :: "r"(state), "a"(s_xsave_mask), "d"(0) : "memory");
+		else
+			asm volatile("fxrstor (%0)" :: "r"(state) : "memory");
+	}
+
+	void init() {
+		uint32_t eax, ebx, ecx, edx;
+		cpuid(1, 0, eax, ebx, ecx, edx);
+		if(ecx & CPUID_ECX_XSAVE) {
+			uint32_t cr4;
+			asm volatile("mov %%cr4, %0" : "=r"(cr4));
+			asm volatile("mov %0, %%cr4" :: "r"(cr4 | CR4_OSXSAVE));
+
+			uint32_t mask = XCR0_X87 | XCR0_SSE;
+			if(ecx & CPUID_ECX_AVX)
+				mask |= XCR0_AVX;
+			asm volatile("xsetbv" :: "c"(0), "a"(mask), "d"(0));
+
+			// Make sure the state for everything we enabled fits in the space we reserve in each thread
+			cpuid(0xD, 0, eax, ebx, ecx, edx);
+			if(ebx <= FPU_STATE_SIZE) {
+				s_use_xsave = true;
+				s_xsave_mask = mask;
+			} else {
+				asm volatile("xsetbv" :: "c"(0), "a"(XCR0_X87 | XCR0_SSE), "d"(0));
+			}
+		}
+
+		KLog::dbg("FPU", "Using %s for FPU context switching", s_use_xsave ? "xsave" : "fxsave");
+	}
+
+	void switch_to(Thread* thread) {
+		if(Processor::current().fpu_owner == thread)
+			clear_ts();
+		else
+			set_ts();
+	}
+
+	void handle_device_not_available() {
+		auto& cpu = Processor::current();
+		auto* thread = cpu.current_thread.get();
+		clear_ts();
+		if(cpu.fpu_owner == thread)
+			return;
+
+		if(cpu.fpu_owner)
+			save(cpu.fpu_owner->fpu_state());
+
+		if(thread->fpu_initialized) {
+			restore(thread->fpu_state());
+		} else {
+			uint32_t mxcsr = MXCSR_DEFAULT;
+			asm volatile("fninit");
+			asm volatile("ldmxcsr %0" :: "m"(mxcsr));
+			thread->fpu_initialized = true;
+		}
+
+		cpu.fpu_owner = thread;
+	}
+
+	void forget(Thread* thread) {
+		for(int i = 0; i < Processor::count(); i++) {
+			if(Processor::get(i).fpu_owner == thread)
+				Processor::get(i).fpu_owner = nullptr;
+		}
+	}
+
+	bool using_xsave() {
+		return s_use_xsave;
+	}
+}
@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+
+// The amount of space reserved in each thread for its FPU state. This is enough for the x87, SSE, and AVX state.
+#define FPU_STATE_SIZE 1024
+#define FPU_STATE_ALIGNMENT 64
+
+class Thread;
+
+/**
+ * Lazy FPU context switching. Instead of saving and restoring the FPU state of every thread on every context switch,
+ * the FPU state stays in the registers of whichever thread last used it (the processor's fpu_owner). Switching to any
+ * other thread sets CR0.TS, so the first FPU instruction it executes triggers a device-not-available fault. The fault
+ * handler saves the owner's state, restores (or initializes) the faulting thread's state, and makes it the new owner.
+ *
+ * XSAVE/XRSTOR are used instead of FXSAVE/FXRSTOR when the CPU supports them, so AVX state is switched too.
+ */
+namespace FPU {
+	/// Enables XSAVE if it's supported and figures out how big the saved state is.
+	void init();
+
+	/// Called after a context switch to make sure the next thread faults on the FPU if it doesn't own it.
+	void switch_to(Thread* thread);
+	/// Handles a device-not-available (#NM) fault.
+	void handle_device_not_available();
+	/// Called when a thread is destroyed so that no processor keeps pointing to it as its FPU owner.
+	void forget(Thread* thread);
+
+	[[nodiscard]] bool using_xsave();
+}
@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Futex.h"
+#include "TaskManager.h"
+#include "Thread.h"
+#include "../memory/VMRegion.h"
+#include "../memory/SafePointer.h"
+#include "../kstd/hash.h"
+
+Futex::Bucket Futex::s_buckets[FUTEX_NUM_BUCKETS];
+
+int Futex::wait(VMSpace& space, VirtualAddress address, int expected, Time timeout) {
+	kstd::Arc<VMRegion> region;
+	auto key_res = key_for(space, address, region);
+	if(key_res.is_error())
+		return -key_res.code();
+
+	auto& bucket = bucket_for(key_res.value());
+	Waiter waiter(key_res.value(), timeout);
+	{
+		LOCK(bucket.lock);
+		if(UserspacePointer<int>((int*) address).get() != expected)
+			return -EAGAIN;
+		waiter.next = bucket.waiters;
+		bucket.waiters = &waiter;
+	}
+
+	TaskManager::current_thread()->block(waiter);
+
+	LOCK(bucket.lock);
+	if(waiter.woken)
+		return SUCCESS;
+	remove(bucket, &waiter);
+	return waiter.was_interrupted() ? -EINTR : -ETIMEDOUT;
+}
+
+int Futex::wake(VMSpace& space, VirtualAddress address, int count) {
+	kstd::Arc<VMRegion> region;
+	auto key_res = key_for(space, address, region);
+	if(key_res.is_error())
+		return -key_res.code();
+	auto key = key_res.value();
+
+	auto& bucket = bucket_for(key);
+	LOCK(bucket.lock);
+	int num_woken = 0;
+	auto waiter = bucket.waiters;
+	while(waiter && num_woken < count) {
+		auto next = waiter->next;
+		if(waiter->key == key) {
+			remove(bucket, waiter);
+			waiter->woken = true;
+			waiter->notify();
+			num_woken++;
+		}
+		waiter = next;
+	}
+	return num_woken;
+}
+
+ResultRet<Futex::Key> Futex::key_for(VMSpace& space, VirtualAddress address, kstd::Arc<VMRegion>& region) {
+	if(address % sizeof(int))
+		return Result(EINVAL);
+	auto region_res = space.get_region_containing(address);
+	if(region_res.is_error())
+		return Result(EFAULT);
+	region = region_res.value();
+	return Key {region->object().get(), address - region->start() + region->object_start()};
+}
+
+Futex::Bucket& Futex::bucket_for(const Key& key) {
+	return s_buckets[kstd::hash_int((size_t) key.object ^ key.offset) % FUTEX_NUM_BUCKETS];
+}
+
+void Futex::remove(Bucket& bucket, Waiter* waiter) {
+	for(auto cur = &bucket.waiters; *cur; cur = &(*cur)->next) {
+		if(*cur == waiter) {
+			*cur = waiter->next;
+			return;
+		}
+	}
+}
+
+Futex::Waiter::Waiter(Key key, Time timeout):
+	key(key), has_timeout(timeout >= Time()), end_time(Time::now() + timeout)
+{
+	if(has_timeout)
+		set_timeout(end_time);
+}
+
+bool Futex::Waiter::is_ready() {
+	return woken || (has_timeout && Time::now() >= end_time);
+}
@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "Blocker.h"
+#include "SpinLock.h"
+#include "../memory/VMSpace.h"
+
+// The number of buckets waiting threads are hashed into
+#define FUTEX_NUM_BUCKETS 64
+
+/**
+ * Lets userspace threads sleep until another thread wakes them up through an int in memory they share, which is what
+ * userspace mutexes and condition variables are built on. Waiters are identified by the VMObject and offset their int
+ * is at rather than its virtual address, so processes using the same shared memory can wake each other up no matter
+ * where they have it mapped, and CoW copies made by fork() don't wake up each other's waiters.
+ */
+class Futex {
+public:
+	/**
+	 * Waits for a wake() on an int in a memory space, as long as it has an expected value. The value is checked with
+	 * the futex locked, so a wake() right after it's changed is never missed.
+	 * @param space The memory space of the current process, which the int is in.
+	 * @param address The address of the int. Must be aligned.
+	 * @param expected The value the int is expected to have. If it doesn't, this returns right away with -EAGAIN.
+	 * @param timeout How long to wait for, or a negative time to wait forever.
+	 * @return 0 if woken up, or -EAGAIN, -ETIMEDOUT, -EINTR, -EFAULT, or -EINVAL.
+	 */
+	static int wait(VMSpace& space, VirtualAddress address, int expected, Time timeout);
+
+	/**
+	 * Wakes up threads that are waiting on an int.
+	 * @param space The memory space the int is in.
+	 * @param address The address of the int.
+	 * @param count The maximum number of threads to wake.
+	 * @return The number of threads woken up, or -EFAULT or -EINVAL.
+	 */
+	static int wake(VMSpace& space, VirtualAddress address, int count);
+
+private:
+	struct Key {
+		VMObject* object;
+		size_t offset;
+		bool operator==(const Key& other) const { return object == other.object && offset == other.offset; }
+	};
+
+	/// A thread waiting on a futex. These live on the stack of the thread waiting.
+	class Waiter: public Blocker {
+	public:
+		Waiter(Key key, Time timeout);
+		bool is_ready() override;
+
+		Key key;
+		bool woken = false;
+		bool has_timeout;
+		Time end_time;
+		Waiter* next = nullptr;
+	};
+
+	struct Bucket {
+		SpinLock lock;
+		Waiter* waiters = nullptr;
+	};
+
+	/// Finds the key of the int at an address. The region is kept so the object stays alive while it's being used.
+	static ResultRet<Key> key_for(VMSpace& space, VirtualAddress address, kstd::Arc<VMRegion>& region);
+	static Bucket& bucket_for(const Key& key);
+	static void remove(Bucket& bucket, Waiter* waiter);
+
+	static Bucket s_buckets[FUTEX_NUM_BUCKETS];
+};
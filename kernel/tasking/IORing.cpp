@@ -0,0 +1,199 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "IORing.h"
+#include "Process.h"
+#include "Thread.h"
+#include "TaskManager.h"
+#include "PollBlocker.h"
+#include "../memory/SafePointer.h"
+#include "../filesystem/VFS.h"
+#include "../filesystem/FileDescriptor.h"
+#include "../filesystem/InodeFile.h"
+#include "../filesystem/LinkedInode.h"
+#include "../filesystem/socketfs/SocketFS.h"
+
+IORing::IORing(Process* process, ioring_header* header, uint32_t entries):
+	m_process(process),
+	m_header(header),
+	m_sqes(IORING_SQES(header)),
+	m_cqes((ioring_cqe*) (IORING_SQES(header) + entries)),
+	m_entries(entries)
+{}
+
+int IORing::enter(uint32_t to_submit, uint32_t min_complete, int flags) {
+	LOCK(m_lock);
+
+	//Consume the submissions. The process may be adding more as we go, so only take the ones that were there to begin with.
+	uint32_t head = load(&m_header->sq_head);
+	uint32_t tail = load(&m_header->sq_tail);
+	uint32_t num_submitted = min(tail - head, min(to_submit, m_entries));
+	uint32_t num_completed = 0;
+	for(uint32_t i = 0; i < num_submitted; i++) {
+		auto sqe = UserspacePointer<ioring_sqe>(&m_sqes[(head + i) & (m_entries - 1)]).get();
+		bool pending = false;
+		int32_t res = execute(sqe, pending);
+		if(!pending) {
+			complete(sqe.user_data, res);
+			num_completed++;
+		}
+	}
+	store(&m_header->sq_head, head + num_submitted);
+
+	num_completed += complete_polls();
+	if(!(flags & IORING_ENTER_GETEVENTS))
+		return (int) num_submitted;
+
+	//The only things that don't complete right away are polls, so wait on those until enough have completed
+	while(num_completed < min_complete && !m_polls.empty()) {
+		kstd::vector<PollBlocker::PollFD> polls;
+		polls.reserve(m_polls.size());
+		for(auto& poll : m_polls)
+			polls.push_back({poll.fd_num, poll.fd, poll.events});
+		PollBlocker blocker(polls, Time(0, -1));
+		TaskManager::current_thread()->block(blocker);
+		if(blocker.was_interrupted())
+			return num_submitted ? (int) num_submitted : -EINTR;
+		num_completed += complete_polls();
+	}
+
+	return (int) num_submitted;
+}
+
+int32_t IORing::execute(const ioring_sqe& sqe, bool& pending) {
+	switch(sqe.opcode) {
+		case IORING_OP_NOP:
+			return 0;
+
+		case IORING_OP_READ:
+		case IORING_OP_RECV:
+		case IORING_OP_WRITE:
+		case IORING_OP_SEND: {
+			auto fd = file_descriptor(sqe.fd);
+			if(!fd)
+				return -EBADF;
+			bool write = sqe.opcode == IORING_OP_WRITE || sqe.opcode == IORING_OP_SEND;
+			UserspacePointer<uint8_t> buffer((uint8_t*) sqe.addr);
+
+			//SocketFS packets are sent and received by writing and reading them on the socket
+			if(sqe.opcode == IORING_OP_SEND || sqe.opcode == IORING_OP_RECV) {
+				auto file = fd->file();
+				if(!file->is_inode() || ((InodeFile*) file.get())->inode()->fs.fsid() != SOCKETFS_FSID)
+					return -ENOTSOCK;
+				return write ? fd->write(buffer, sqe.len) : fd->read(buffer, sqe.len);
+			}
+
+			if(sqe.off < 0)
+				return write ? fd->write(buffer, sqe.len) : fd->read(buffer, sqe.len);
+			if(sqe.off > INT32_MAX)
+				return -EOVERFLOW;
+			return write ? fd->write_at(buffer, sqe.len, (off_t) sqe.off) : fd->read_at(buffer, sqe.len, (off_t) sqe.off);
+		}
+
+		case IORING_OP_POLL: {
+			auto fd = file_descriptor(sqe.fd);
+			if(!fd)
+				return -EBADF;
+			short events = (short) (sqe.op_flags & (POLLIN | POLLOUT));
+			if(!events)
+				return -EINVAL;
+			m_polls.push_back({sqe.user_data, sqe.fd, fd, events});
+			pending = true;
+			return 0;
+		}
+
+		case IORING_OP_READDIR:
+			return m_process->sys_readdir(sqe.fd, UserspacePointer<char>((char*) sqe.addr), sqe.len);
+
+		case IORING_OP_OPENAT:
+			return openat(sqe);
+
+		case IORING_OP_CLOSE:
+			return m_process->sys_close(sqe.fd);
+
+		default:
+			return -EINVAL;
+	}
+}
+
+int32_t IORing::openat(const ioring_sqe& sqe) {
+	kstd::string path = UserspacePointer<char>((char*) sqe.addr).str();
+
+	//Relative paths are looked up from the directory the fd was opened for, like fstatat()
+	auto base = m_process->_cwd;
+	if(sqe.fd != AT_FDCWD && (!path.length() || path[0] != '/')) {
+		auto dir_fd = file_descriptor(sqe.fd);
+		if(!dir_fd)
+			return -EBADF;
+		base = dir_fd->linked_inode();
+		if(!base || !base->inode()->metadata().is_directory())
+			return -ENOTDIR;
+	}
+
+	mode_t mode = (mode_t) sqe.off & 04777;
+	auto fd_or_err = VFS::inst().open(path, (int) sqe.op_flags, mode & ~m_process->_umask, m_process->_user, base);
+	if(fd_or_err.is_error())
+		return fd_or_err.code();
+	auto& fds = m_process->_file_descriptors;
+	fds.push_back(fd_or_err.value());
+	fd_or_err.value()->set_owner(m_process);
+	fd_or_err.value()->set_path(path);
+	fd_or_err.value()->set_id((int) fds.size() - 1);
+	return (int32_t) fds.size() - 1;
+}
+
+kstd::Arc<FileDescriptor> IORing::file_descriptor(int fd) {
+	auto& fds = m_process->_file_descriptors;
+	if(fd < 0 || fd >= (int) fds.size())
+		return kstd::Arc<FileDescriptor>(nullptr);
+	return fds[fd];
+}
+
+uint32_t IORing::complete_polls() {
+	uint32_t num_completed = 0;
+	for(size_t i = 0; i < m_polls.size();) {
+		auto& poll = m_polls[i];
+		short revents = 0;
+		if((poll.events & POLLIN) && poll.fd->file()->can_read(*poll.fd))
+			revents |= POLLIN;
+		if((poll.events & POLLOUT) && poll.fd->file()->can_write(*poll.fd))
+			revents |= POLLOUT;
+		if(!revents) {
+			i++;
+			continue;
+		}
+		complete(poll.user_data, revents);
+		m_polls.erase(i);
+		num_completed++;
+	}
+	return num_completed;
+}
+
+void IORing::complete(uint64_t user_data, int32_t res) {
+	uint32_t tail = load(&m_header->cq_tail);
+	uint32_t cq_entries = IORING_CQ_ENTRIES(m_entries);
+	if(tail - load(&m_header->cq_head) >= cq_entries) {
+		//The process isn't keeping up, so drop the completion and tell it so on the next one that makes it in
+		store(&m_header->cq_overflow, load(&m_header->cq_overflow) + 1);
+		m_overflowed = true;
+		return;
+	}
+
+	UserspacePointer<ioring_cqe>(&m_cqes[tail & (cq_entries - 1)]).set({
+		user_data,
+		res,
+		m_overflowed ? IORING_CQE_F_OVERFLOW : 0u
+	});
+	m_overflowed = false;
+	//Make sure the completion is visible before the tail that publishes it
+	asm volatile("" ::: "memory");
+	store(&m_header->cq_tail, tail + 1);
+}
+
+uint32_t IORing::load(uint32_t* field) {
+	return UserspacePointer<uint32_t>(field).get();
+}
+
+void IORing::store(uint32_t* field, uint32_t value) {
+	UserspacePointer<uint32_t>(field).set(value);
+}
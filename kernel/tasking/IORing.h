@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "Mutex.h"
+#include "../api/ioring.h"
+#include "../kstd/vector.hpp"
+#include "../kstd/Arc.h"
+
+class Process;
+class FileDescriptor;
+
+/**
+ * A submission and completion queue pair shared with a process, which lets it hand the kernel a whole batch of I/O at
+ * once instead of making a syscall for every operation. See kernel/api/ioring.h for the layout of the ring.
+ *
+ * Submissions are consumed in the context of the thread calling ioring_enter() and run through the same paths as the
+ * equivalent syscalls, so they see the same file descriptors and permissions. Polls that aren't ready yet are kept
+ * around and completed by a later ioring_enter() once they are.
+ */
+class IORing {
+public:
+	IORing(Process* process, ioring_header* header, uint32_t entries);
+
+	/**
+	 * Consumes submissions and posts their completions.
+	 * @param to_submit The most submissions to consume.
+	 * @param min_complete With IORING_ENTER_GETEVENTS, how many completions to wait for before returning.
+	 * @param flags IORING_ENTER_GETEVENTS or 0.
+	 * @return The number of submissions consumed, or -EINTR if interrupted while waiting.
+	 */
+	int enter(uint32_t to_submit, uint32_t min_complete, int flags);
+
+private:
+	struct PendingPoll {
+		uint64_t user_data;
+		int fd_num;
+		kstd::Arc<FileDescriptor> fd;
+		short events;
+	};
+
+	/// Runs a submission. Returns its result, or sets pending if it'll be completed later instead.
+	int32_t execute(const ioring_sqe& sqe, bool& pending);
+	int32_t openat(const ioring_sqe& sqe);
+	kstd::Arc<FileDescriptor> file_descriptor(int fd);
+	/// Completes the pending polls that are ready. Returns how many were completed.
+	uint32_t complete_polls();
+	void complete(uint64_t user_data, int32_t res);
+
+	uint32_t load(uint32_t* field);
+	void store(uint32_t* field, uint32_t value);
+
+	Process* m_process;
+	ioring_header* m_header;
+	ioring_sqe* m_sqes;
+	ioring_cqe* m_cqes;
+	uint32_t m_entries;
+	kstd::vector<PendingPoll> m_polls;
+	bool m_overflowed = false;
+	Mutex m_lock;
+};
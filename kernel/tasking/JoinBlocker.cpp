@@ -20,9 +20,10 @@
 #include "JoinBlocker.h"
 #include "Thread.h"
 
-JoinBlocker::JoinBlocker(kstd::Arc<Thread> thread, kstd::Arc<Thread> wait_for) {
+JoinBlocker::JoinBlocker(kstd::Arc<Thread> thread, kstd::Arc<Thread> wait_for): m_entry(this) {
 	_thread = thread;
 	_wait_thread = wait_for;
+	_wait_thread->join_queue().add(m_entry);
 }
 
 bool JoinBlocker::is_ready() {
@@ -23,6 +23,7 @@
 #include "Blocker.h"
 #include <kernel/kstd/unix_types.h>
 #include <kernel/kstd/Arc.h>
+#include "WaitQueue.h"
 
 class Thread;
 class JoinBlocker: public Blocker {
@@ -35,6 +36,7 @@ private:
 	int _exit_status = 0;
 	kstd::Arc<Thread> _wait_thread;
 	kstd::Arc<Thread> _thread;
+	WaitQueue::Entry m_entry;
 };
 
 
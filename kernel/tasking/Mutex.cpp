@@ -0,0 +1,97 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Mutex.h"
+#include "Thread.h"
+#include "TaskManager.h"
+#include "Processor.h"
+
+extern bool g_panicking;
+
+bool Mutex::locked() {
+	return m_holding_thread.load(MemoryOrder::SeqCst) != -1;
+}
+
+void Mutex::acquire() {
+	auto cur_thread = TaskManager::current_thread();
+	if(!TaskManager::enabled() || !cur_thread || g_panicking)
+		return; //Tasking isn't initialized yet
+	ASSERT(!TaskManager::in_critical());
+
+	auto cur_tid = cur_thread->tid();
+	int spins = 0;
+	while(!try_lock(cur_tid)) {
+		if(spins < MUTEX_SPIN_LIMIT && holder_is_running()) {
+			spins++;
+			asm volatile("pause");
+			continue;
+		}
+
+		MutexBlocker blocker(*this);
+		cur_thread->block(blocker);
+	}
+
+	m_times_locked++;
+}
+
+bool Mutex::try_acquire() {
+	auto cur_thread = TaskManager::current_thread();
+	if(!TaskManager::enabled() || !cur_thread || g_panicking)
+		return true;
+	if(!try_lock(cur_thread->tid()))
+		return false;
+	m_times_locked++;
+	return true;
+}
+
+void Mutex::release() {
+	if(!TaskManager::enabled() || g_panicking)
+		return;
+	ASSERT(held_by_current_thread());
+
+	TaskManager::ScopedCritical crit;
+	m_times_locked--;
+	if(!m_times_locked) {
+		m_holding_thread.store(-1, MemoryOrder::SeqCst);
+		m_waiters.wake_one();
+	}
+}
+
+bool Mutex::held_by_current_thread() {
+	auto cur_thread = TaskManager::current_thread();
+	return !cur_thread || cur_thread->tid() == m_holding_thread.load(MemoryOrder::SeqCst);
+}
+
+bool Mutex::try_lock(tid_t tid) {
+	tid_t expected = -1;
+	if(m_holding_thread.compare_exchange_strong(expected, tid))
+		return true;
+	return expected == tid;
+}
+
+bool Mutex::holder_is_running() {
+	auto holder = m_holding_thread.load(MemoryOrder::SeqCst);
+	auto& cur_cpu = Processor::current();
+	for(int i = 0; i < Processor::count(); i++) {
+		auto& cpu = Processor::get(i);
+		if(&cpu != &cur_cpu && cpu.current_thread && cpu.current_thread->tid() == holder)
+			return true;
+	}
+	return false;
+}
+
+Mutex::MutexBlocker::MutexBlocker(Mutex& mutex): m_mutex(mutex), m_entry(this) {
+	m_mutex.m_waiters.add(m_entry);
+}
+
+bool Mutex::MutexBlocker::is_ready() {
+	return !m_mutex.locked();
+}
+
+bool Mutex::MutexBlocker::can_be_interrupted() {
+	return false;
+}
+
+bool Mutex::MutexBlocker::is_lock() {
+	return true;
+}
@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "Lock.h"
+#include "Blocker.h"
+#include "WaitQueue.h"
+#include "../kstd/unix_types.h"
+#include "../Atomic.h"
+
+// How many times to spin waiting for a mutex held by a running thread before blocking
+#define MUTEX_SPIN_LIMIT 1000
+
+/**
+ * A recursive lock that puts waiting threads to sleep instead of having them spin. This should be used instead of a
+ * SpinLock for anything that may be held for a long time, like across disk I/O.
+ *
+ * If the thread holding the mutex is currently running on another processor, waiters spin for a short while first
+ * since it'll probably be released soon, and only block if it isn't.
+ *
+ * A mutex can't be acquired in an interrupt or while in a critical section, since doing so may block.
+ */
+class Mutex: public Lock {
+public:
+	Mutex() = default;
+	~Mutex() = default;
+
+	bool locked() override;
+	void acquire() override;
+	bool try_acquire();
+	void release() override;
+	bool held_by_current_thread();
+	[[nodiscard]] tid_t holding_thread() const { return m_holding_thread.load(MemoryOrder::SeqCst); }
+	[[nodiscard]] int times_locked() const { return m_times_locked; }
+
+private:
+	class MutexBlocker: public Blocker {
+	public:
+		explicit MutexBlocker(Mutex& mutex);
+		bool is_ready() override;
+		bool can_be_interrupted() override;
+		bool is_lock() override;
+
+	private:
+		Mutex& m_mutex;
+		WaitQueue::Entry m_entry;
+	};
+
+	bool try_lock(tid_t tid);
+	bool holder_is_running();
+
+	Atomic<tid_t, MemoryOrder::AcqRel> m_holding_thread = -1;
+	int m_times_locked = 0;
+	WaitQueue m_waiters;
+};
@@ -24,6 +24,20 @@
 PollBlocker::PollBlocker(kstd::vector<PollFD>& pollfd, Time timeout):
 	polls(pollfd), has_timeout(timeout >= Time()), start_time(Time::now()), end_time(Time::now() + timeout)
 {
+	// Wait on each of the files being polled so that we're notified when one of them might be ready
+	m_entries.resize(polls.size());
+	for(size_t i = 0; i < polls.size(); i++) {
+		m_entries[i].set_blocker(this);
+		polls[i].fd->file()->poll_queue().add(m_entries[i]);
+	}
+
+	if(has_timeout)
+		set_timeout(end_time);
+}
+
+PollBlocker::~PollBlocker() {
+	for(size_t i = 0; i < polls.size(); i++)
+		polls[i].fd->file()->poll_queue().remove(m_entries[i]);
 }
 
 bool PollBlocker::is_ready() {
@@ -23,6 +23,7 @@
 #include "Blocker.h"
 #include <kernel/time/Time.h>
 #include <kernel/kstd/Arc.h>
+#include "WaitQueue.h"
 
 class FileDescriptor;
 class PollBlocker: public Blocker {
@@ -35,12 +36,14 @@ public:
 	};
 
 	PollBlocker(kstd::vector<PollFD>& pollfd, Time timeout);
+	~PollBlocker() override;
 	bool is_ready() override;
 
 	int polled;
 	short polled_revent;
 private:
 	kstd::vector<PollFD> polls;
+	kstd::vector<WaitQueue::Entry> m_entries;
 	Time end_time;
 	Time start_time;
 	bool has_timeout;
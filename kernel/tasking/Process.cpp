@@ -28,6 +28,10 @@
 #include "Thread.h"
 #include "../kstd/KLog.h"
 #include "../filesystem/procfs/ProcFS.h"
+#include "../time/TimeManager.h"
+#include "../memory/AnonymousVMObject.h"
+#include "../syscall/SyscallStats.h"
+#include "IORing.h"
 
 Process* Process::create_kernel(const kstd::string& name, void (*func)()){
 	ProcessArgs args = ProcessArgs(kstd::Arc<LinkedInode>(nullptr));
@@ -75,8 +79,6 @@ ResultRet<Process*> Process::create_user(const kstd::string& executable_loc, Use
 	for(const auto& region : regions)
 		proc->_vm_regions.push_back(region);
 
-	proc->recalculate_pmem_total();
-
 	return proc->_self_ptr;
 }
 
@@ -93,7 +95,15 @@ pid_t Process::ppid() {
 }
 
 void Process::set_ppid(pid_t ppid) {
-	_ppid = ppid;
+	TaskManager::process_table().set_key(this, ProcessTable::PPID, ppid);
+}
+
+void Process::set_pgid(pid_t pgid) {
+	TaskManager::process_table().set_key(this, ProcessTable::PGID, pgid);
+}
+
+void Process::set_sid(pid_t sid) {
+	TaskManager::process_table().set_key(this, ProcessTable::SID, sid);
 }
 
 pid_t Process::sid() {
@@ -142,6 +152,22 @@ bool Process::is_kernel_mode() {
 	return _kernel_mode;
 }
 
+int Process::nice() const {
+	return _nice;
+}
+
+void Process::set_nice(int nice) {
+	LOCK(_thread_lock);
+	_nice = nice;
+	auto priority = Thread::priority_for_nice(nice);
+	for(auto& tid : _tids)
+		_threads[tid]->set_base_priority(priority);
+}
+
+WaitQueue& Process::child_wait_queue() {
+	return _child_wait_queue;
+}
+
 tid_t Process::last_active_thread() {
 	return _last_active_thread;
 }
@@ -191,6 +217,14 @@ Process::Process(const kstd::string& name, size_t entry_point, bool kernel, Proc
 		//Make new page directory
 		_page_directory = kstd::make_shared<PageDirectory>();
 		_vm_space = kstd::make_shared<VMSpace>(PAGE_SIZE, HIGHER_HALF - PAGE_SIZE, *_page_directory);
+
+		//Map the time page before anything else can end up where it goes
+		auto time_page = TimeManager::time_page();
+		if(time_page) {
+			auto time_page_res = map_object(time_page, TIME_PAGE_ADDR, VMProt::R);
+			if(time_page_res.is_error())
+				KLog::warn("Process", "Couldn't map the time page for %s: %d", _name.c_str(), time_page_res.code());
+		}
 	}
 
 	//Create the main thread
@@ -211,9 +245,9 @@ Process::Process(Process *to_fork, Registers &regs): _user(to_fork->_user), _sel
 	_sid = to_fork->_sid;
 	_pgid = to_fork->_pgid;
 	_umask = to_fork->_umask;
+	_nice = to_fork->_nice;
+	_prefetch_session = to_fork->_prefetch_session;
 	_tty = to_fork->_tty;
-	m_used_pmem = to_fork->m_used_pmem;
-	m_used_shmem = to_fork->m_used_shmem;
 	_state = ALIVE;
 
 	//TODO: Prevent thread race condition when copying signal handlers/file descriptors
@@ -239,11 +273,14 @@ Process::Process(Process *to_fork, Registers &regs): _user(to_fork->_user), _sel
 
 	//Create the main thread
 	auto* main_thread = new Thread(_self_ptr, _pid, regs);
+	main_thread->set_affinity(TaskManager::current_thread()->affinity());
+	main_thread->set_tls_base(TaskManager::current_thread()->tls_base());
 	insert_thread(kstd::Arc<Thread>(main_thread));
 }
 
 Process::~Process() {
 	TaskManager::remove_process(this);
+	delete m_syscall_stats.load();
 }
 
 void Process::kill(int signal) {
@@ -335,7 +372,7 @@ ResultRet<kstd::Arc<VMRegion>> Process::map_object(kstd::Arc<VMObject> object, V
 }
 
 size_t Process::used_pmem() const {
-	return m_used_pmem;
+	return _vm_space->resident_stats().anonymous * PAGE_SIZE;
 }
 
 size_t Process::used_vmem() const {
@@ -343,7 +380,34 @@ size_t Process::used_vmem() const {
 }
 
 size_t Process::used_shmem() const {
-	return m_used_shmem;
+	return _vm_space->resident_stats().shared * PAGE_SIZE;
+}
+
+size_t Process::used_file_mem() const {
+	return _vm_space->resident_stats().file * PAGE_SIZE;
+}
+
+size_t Process::resident_mem() const {
+	return _vm_space->resident_stats().total() * PAGE_SIZE;
+}
+
+void Process::record_syscall(uint32_t call, uint64_t latency_ns, int result) {
+	SyscallStats::global().record(call, latency_ns, result);
+
+	//The stats are allocated the first time they're needed, since they're fairly big
+	auto* stats = m_syscall_stats.load();
+	if(!stats) {
+		auto* new_stats = new SyscallStats();
+		if(m_syscall_stats.compare_exchange_strong(stats, new_stats))
+			stats = new_stats;
+		else
+			delete new_stats;
+	}
+	stats->record(call, latency_ns, result);
+}
+
+SyscallStats* Process::syscall_stats() const {
+	return m_syscall_stats.load();
 }
 
 /************
@@ -378,24 +442,33 @@ void Process::alert_thread_died(kstd::Arc<Thread> thread) {
 		}
 		TaskManager::reparent_orphans(this);
 		_state = ZOMBIE;
+		if(!parent.is_error())
+			parent.value()->_child_wait_queue.wake();
 	}
 }
 
-void Process::recalculate_pmem_total() {
-	if(_is_destroying || !_vm_space)
-		return;
-	m_used_pmem = _vm_space->calculate_regular_anonymous_total();
-}
-
 void Process::insert_thread(const kstd::Arc<Thread>& thread) {
 	LOCK(_thread_lock);
 	_threads[thread->_tid] = thread;
 	_tids.push_back(thread->_tid);
 }
 
+void Process::cpu_time(uint64_t& user_time, uint64_t& kernel_time) {
+	LOCK(_thread_lock);
+	user_time = _dead_user_time;
+	kernel_time = _dead_kernel_time;
+	for(auto& tid : _tids) {
+		auto& stats = _threads[tid]->sched_stats();
+		user_time += stats.user_time;
+		kernel_time += stats.kernel_time;
+	}
+}
+
 void Process::remove_thread(const kstd::Arc<Thread>& thread) {
 	LOCK(_thread_lock);
 	_thread_return_values[thread->_tid] = thread->_return_value;
+	_dead_user_time += thread->sched_stats().user_time;
+	_dead_kernel_time += thread->sched_stats().kernel_time;
 	_threads.erase(thread->_tid);
 	for(size_t i = 0; i < _tids.size(); i++) {
 		if(_tids[i] == thread->_tid) {
@@ -27,6 +27,10 @@
 #include <kernel/User.h>
 #include <kernel/kstd/string.h>
 #include "../api/poll.h"
+#include "../api/sched.h"
+#include "WaitQueue.h"
+#include "ProcessTable.h"
+#include <kernel/Atomic.h>
 
 class FileDescriptor;
 class Blocker;
@@ -35,6 +39,8 @@ class TTYDevice;
 class Thread;
 class PageDirectory;
 class LinkedInode;
+class SyscallStats;
+class IORing;
 
 namespace ELF {struct elf32_header;};
 
@@ -60,7 +66,9 @@ public:
 	pid_t pgid();
 	pid_t ppid();
 	void set_ppid(pid_t ppid);
+	void set_pgid(pid_t pgid);
 	pid_t sid();
+	void set_sid(pid_t sid);
 	User user();
 	kstd::string name();
 	kstd::string exe();
@@ -70,8 +78,16 @@ public:
 	int all_threads_state();
 	int exit_status();
 	bool is_kernel_mode();
+	int nice() const;
+	void set_nice(int nice);
+	/// The time spent running in userspace and in the kernel by every thread of the process, in microseconds.
+	void cpu_time(uint64_t& user_time, uint64_t& kernel_time);
+	/// The prefetch recording session this process is part of, or 0. Passed on to the processes it starts.
+	uint32_t prefetch_session() const { return _prefetch_session; }
+	void set_prefetch_session(uint32_t session) { _prefetch_session = session; }
 
 	//Threads
+	WaitQueue& child_wait_queue();
 	tid_t last_active_thread();
 	void set_last_active_thread(tid_t tid);
 	kstd::Arc<Thread> spawn_kernel_thread(void (*entry)());
@@ -88,18 +104,31 @@ public:
 	kstd::Arc<VMSpace> vm_space();
 	ResultRet<kstd::Arc<VMRegion>> map_object(kstd::Arc<VMObject> object, VMProt prot);
 	ResultRet<kstd::Arc<VMRegion>> map_object(kstd::Arc<VMObject> object, VirtualAddress address, VMProt prot);
-	size_t used_pmem() const;
+	// Memory usage in bytes. Everything but vmem only counts pages that are mapped in.
+	size_t used_pmem() const; ///< Private anonymous memory.
 	size_t used_vmem() const;
-	size_t used_shmem() const;
+	size_t used_shmem() const; ///< Anonymous memory shared with other processes.
+	size_t used_file_mem() const; ///< Memory mapped from files.
+	size_t resident_mem() const; ///< All of the above, plus anything else (like device memory).
+	/** Records a syscall made by the process in its own stats and the system-wide stats. **/
+	void record_syscall(uint32_t call, uint64_t latency_ns, int result);
+	/** The process's syscall stats, or null if it hasn't made any syscalls. **/
+	SyscallStats* syscall_stats() const;
 
 	//Syscalls
 	void check_ptr(const void* ptr, bool write = false);
 	void sys_exit(int status);
 	ssize_t sys_read(int fd, UserspacePointer<uint8_t> buf, size_t count);
 	ssize_t sys_write(int fd, UserspacePointer<uint8_t> buf, size_t count);
+	ssize_t sys_readv(int fd, UserspacePointer<struct iovec> iov, int iovcnt);
+	ssize_t sys_writev(int fd, UserspacePointer<struct iovec> iov, int iovcnt);
+	ssize_t sys_preadv(UserspacePointer<struct iov_args> args);
+	ssize_t sys_pwritev(UserspacePointer<struct iov_args> args);
+	ssize_t sys_copy_file_range(UserspacePointer<struct splice_args> args);
 	pid_t sys_fork(Registers& regs);
 	int exec(const kstd::string& filename, ProcessArgs* args);
 	int sys_execve(UserspacePointer<char> filename, UserspacePointer<char*> argv, UserspacePointer<char*> envp);
+	pid_t sys_spawn(UserspacePointer<struct spawn_args> args);
 	int sys_execvp(UserspacePointer<char> filename, UserspacePointer<char*> argv);
 	int sys_open(UserspacePointer<char> filename, int options, int mode);
 	int sys_close(int file);
@@ -109,9 +138,11 @@ public:
 	int sys_fstat(int file, UserspacePointer<struct stat> buf);
 	int sys_stat(UserspacePointer<char> file, UserspacePointer<struct stat> buf);
 	int sys_lstat(UserspacePointer<char> file, UserspacePointer<struct stat> buf);
+	int sys_fstatat(UserspacePointer<struct fstatat_args> args);
 	int sys_lseek(int file, off_t off, int whence);
 	int sys_waitpid(pid_t pid, UserspacePointer<int> status, int flags);
 	int sys_gettimeofday(UserspacePointer<timeval> t, UserspacePointer<void*> z);
+	int sys_clock_gettime(clockid_t clock, UserspacePointer<timespec> t);
 	int sys_sigaction(int sig, UserspacePointer<sigaction> new_action, UserspacePointer<sigaction> old_action);
 	int sys_kill(pid_t pid, int sig);
 	int sys_unlink(UserspacePointer<char> name);
@@ -122,9 +153,18 @@ public:
 	int sys_truncate(UserspacePointer<char> path, off_t length);
 	int sys_ftruncate(int fd, off_t length);
 	int sys_pipe(UserspacePointer<int>, int options);
+	int sys_splice(UserspacePointer<struct splice_args> args);
+	int sys_tee(int fd_in, int fd_out, size_t len);
+	int sys_fcntl(int fd, int cmd, int arg);
+	int sys_epoll_create(int flags);
+	int sys_epoll_ctl(UserspacePointer<struct epoll_ctl_args> args);
+	int sys_epoll_wait(UserspacePointer<struct epoll_wait_args> args);
+	int sys_futex(UserspacePointer<struct futex_args> args);
 	int sys_dup(int oldfd);
 	int sys_dup2(int oldfd, int newfd);
 	int sys_isatty(int fd);
+	int sys_fsync(int fd);
+	int sys_sync();
 	int sys_symlink(UserspacePointer<char> file, UserspacePointer<char> linkname);
 	int sys_symlinkat(UserspacePointer<char> file, int dirfd, UserspacePointer<char> linkname);
 	int sys_readlink(UserspacePointer<char> file, UserspacePointer<char> buf, size_t bufsize);
@@ -155,29 +195,45 @@ public:
 	int sys_shmattach(int id, void* addr, UserspacePointer<struct shm> s);
 	int sys_shmdetach(int id);
 	int sys_shmallow(int id, pid_t pid, int perms);
+	int sys_shmpurgeable(int id, int purgeable);
+	int sys_swapon(UserspacePointer<char> path);
 	int sys_poll(UserspacePointer<pollfd> pollfd, nfds_t nfd, int timeout);
 	int sys_ptsname(int fd, UserspacePointer<char> buf, size_t bufsize);
 	int sys_sleep(UserspacePointer<timespec> time, UserspacePointer<timespec> remainder);
-	int sys_threadcreate(void* (*entry_func)(void* (*)(void*), void*), void* (*thread_func)(void*), void* arg);
+	int sys_threadcreate(UserspacePointer<struct threadcreate_args> args);
 	int sys_gettid();
 	int sys_threadjoin(tid_t tid, UserspacePointer<void*> retp);
 	int sys_threadexit(void* return_value);
+	int sys_set_thread_pointer(void* pointer);
 	int sys_access(UserspacePointer<char> pathname, int mode);
 	ResultRet<void*> sys_mmap(UserspacePointer<struct mmap_args> args);
 	int sys_munmap(void* addr, size_t length);
 	int sys_mprotect(void* addr, size_t length, int prot);
+	int sys_madvise(void* addr, size_t length, int advice);
+
 	int sys_uname(UserspacePointer<struct utsname> buf);
+	int sys_getpriority(int which, id_t who);
+	int sys_setpriority(int which, id_t who, int value);
+	int sys_getrusage(int who, UserspacePointer<struct rusage> usage);
+	int sys_sched_setaffinity(tid_t tid, size_t size, UserspacePointer<cpu_set_t> mask);
+	int sys_sched_getaffinity(tid_t tid, size_t size, UserspacePointer<cpu_set_t> mask);
+	ssize_t sys_getrandom(UserspacePointer<uint8_t> buf, size_t count, unsigned int flags);
+	int sys_ioring_setup(UserspacePointer<struct ioring_params> params);
+	int sys_ioring_enter(uint32_t to_submit, uint32_t min_complete, int flags);
 
 private:
 	friend class Thread;
 	friend class Reaper;
+	friend class ProcessTable;
+	friend class IORing;
 	Process(const kstd::string& name, size_t entry_point, bool kernel, ProcessArgs* args, pid_t pid, pid_t ppid);
 	Process(Process* to_fork, Registers& regs);
 
 	void alert_thread_died(kstd::Arc<Thread> thread);
-	void recalculate_pmem_total();
 	void insert_thread(const kstd::Arc<Thread>& thread);
 	void remove_thread(const kstd::Arc<Thread>& thread);
+	/// Unmaps an attached shared memory object, however many times it was attached. Call with m_mem_lock held.
+	void remove_shm_attachment(int id);
 
 	//Identifying info and state
 	kstd::string _name = "";
@@ -189,22 +245,36 @@ private:
 	kstd::Arc<TTYDevice> _tty;
 	User _user;
 	mode_t _umask = 022;
+	int _nice = 0;
+	uint32_t _prefetch_session = 0;
 	int _exit_status = 0;
 	State _state;
 	bool _kernel_mode = false;
 	bool _is_destroying = false;
+	ProcessTable::Link _process_table_links[ProcessTable::NUM_KEYS];
+	bool _in_process_table = false;
 
 	//Memory
 	kstd::Arc<VMSpace> _vm_space;
 	kstd::Arc<PageDirectory> _page_directory;
 	kstd::vector<kstd::Arc<VMRegion>> _vm_regions;
+	/// The region each shared memory object is attached at, and how many times it's been attached there. Attaching
+	/// the same object again reuses the region, and it's only unmapped once it's been detached as many times.
+	struct ShmAttachment {
+		kstd::Arc<VMRegion> region;
+		int count;
+	};
+	kstd::map<int, ShmAttachment> m_shm_attachments;
 	SpinLock m_mem_lock;
-	size_t m_used_pmem = 0;
-	size_t m_used_shmem = 0;
 
 	//Files & Pipes
 	kstd::vector<kstd::Arc<FileDescriptor>> _file_descriptors;
 	kstd::Arc<LinkedInode> _cwd;
+	kstd::Arc<IORing> m_ioring;
+	SpinLock m_ioring_lock;
+
+	//Children
+	WaitQueue _child_wait_queue;
 
 	//Signals
 	Signal::SigAction signal_actions[32] = {{Signal::SigAction()}};
@@ -218,6 +288,13 @@ private:
 	tid_t _last_active_thread = 1;
 	SpinLock _thread_lock;
 
+	//Stats
+	Atomic<SyscallStats*> m_syscall_stats = nullptr;
+	uint64_t _dead_user_time = 0; // CPU time (in microseconds) used by threads that have exited
+	uint64_t _dead_kernel_time = 0;
+	uint64_t _child_user_time = 0; // CPU time (in microseconds) used by children that have been waited for
+	uint64_t _child_kernel_time = 0;
+
 	Process* _self_ptr;
 };
 
@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "ProcessTable.h"
+#include "Process.h"
+#include "TaskManager.h"
+
+void ProcessTable::add(Process* process) {
+	TaskManager::ScopedCritical critical;
+	if(process->_in_process_table)
+		return;
+	for(int key = 0; key < NUM_KEYS; key++)
+		link_key(process, (Key) key);
+	process->_in_process_table = true;
+}
+
+void ProcessTable::remove(Process* process) {
+	TaskManager::ScopedCritical critical;
+	if(!process->_in_process_table)
+		return;
+	for(int key = 0; key < NUM_KEYS; key++)
+		unlink_key(process, (Key) key);
+	process->_in_process_table = false;
+}
+
+void ProcessTable::set_key(Process* process, Key key, pid_t value) {
+	TaskManager::ScopedCritical critical;
+	bool indexed = process->_in_process_table;
+	if(indexed)
+		unlink_key(process, key);
+	switch(key) {
+		case PID:
+			process->_pid = value;
+			break;
+		case PGID:
+			process->_pgid = value;
+			break;
+		case SID:
+			process->_sid = value;
+			break;
+		case PPID:
+			process->_ppid = value;
+			break;
+		default:
+			break;
+	}
+	if(indexed)
+		link_key(process, key);
+}
+
+Process* ProcessTable::find(Key key, pid_t value, pid_t exclude) {
+	for(auto* process = m_buckets[key][bucket(value)]; process; process = link(process, key).next) {
+		if(matches(process, key, value) && process->_pid != exclude)
+			return process;
+	}
+	return nullptr;
+}
+
+pid_t ProcessTable::key_value(Process* process, Key key) {
+	switch(key) {
+		case PID:
+			return process->_pid;
+		case PGID:
+			return process->_pgid;
+		case SID:
+			return process->_sid;
+		case PPID:
+			return process->_ppid;
+		default:
+			return 0;
+	}
+}
+
+ProcessTable::Link& ProcessTable::link(Process* process, Key key) {
+	return process->_process_table_links[key];
+}
+
+bool ProcessTable::matches(Process* process, Key key, pid_t value) {
+	return key_value(process, key) == value && process->_state != Process::DEAD;
+}
+
+void ProcessTable::link_key(Process* process, Key key) {
+	auto& head = m_buckets[key][bucket(key_value(process, key))];
+	auto& process_link = link(process, key);
+	process_link.prev = nullptr;
+	process_link.next = head;
+	if(head)
+		link(head, key).prev = process;
+	head = process;
+}
+
+void ProcessTable::unlink_key(Process* process, Key key) {
+	auto& process_link = link(process, key);
+	if(process_link.prev)
+		link(process_link.prev, key).next = process_link.next;
+	else
+		m_buckets[key][bucket(key_value(process, key))] = process_link.next;
+	if(process_link.next)
+		link(process_link.next, key).prev = process_link.prev;
+	process_link.next = nullptr;
+	process_link.prev = nullptr;
+}
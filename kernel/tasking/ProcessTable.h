@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/unix_types.h>
+
+// The number of hash buckets for each key. Must be a power of two.
+#define PROCESS_TABLE_BUCKETS 256
+
+class Process;
+
+/**
+ * An index of processes by pid, process group, session, and parent, so that looking up a process or the members of
+ * a group doesn't need to scan every process. Each key is a hash table of intrusive lists linked through the process
+ * itself, so indexing a process never allocates.
+ *
+ * A process's pid, pgid, sid, and ppid must only be changed through set_key() once it has been added to the table.
+ */
+class ProcessTable {
+public:
+	enum Key {
+		PID = 0,
+		PGID,
+		SID,
+		PPID,
+		NUM_KEYS
+	};
+
+	struct Link {
+		Process* next = nullptr;
+		Process* prev = nullptr;
+	};
+
+	ProcessTable() = default;
+
+	void add(Process* process);
+	void remove(Process* process);
+	/// Changes one of the IDs of a process, re-indexing it if it is in the table.
+	void set_key(Process* process, Key key, pid_t value);
+
+	/// Returns a process that isn't dead whose ID matches the given value, or nullptr if there isn't one.
+	Process* find(Key key, pid_t value, pid_t exclude = -1);
+
+	/// Calls the callback for each process that isn't dead whose ID matches the given value. The callback may remove
+	/// or re-key the process it was given, but no others.
+	template<typename F>
+	void for_each(Key key, pid_t value, F callback) {
+		auto* process = m_buckets[key][bucket(value)];
+		while(process) {
+			auto* next = link(process, key).next;
+			if(matches(process, key, value))
+				callback(process);
+			process = next;
+		}
+	}
+
+private:
+	static constexpr size_t bucket(pid_t value) { return ((size_t) value) & (PROCESS_TABLE_BUCKETS - 1); }
+	static pid_t key_value(Process* process, Key key);
+	static Link& link(Process* process, Key key);
+	static bool matches(Process* process, Key key, pid_t value);
+	void link_key(Process* process, Key key);
+	void unlink_key(Process* process, Key key);
+
+	Process* m_buckets[NUM_KEYS][PROCESS_TABLE_BUCKETS] = {{nullptr}};
+};
@@ -0,0 +1,197 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Processor.h"
+#include "Thread.h"
+#include <kernel/kstd/KLog.h>
+#include <kernel/kstd/cstring.h>
+#include <kernel/CommandLine.h>
+#include <kernel/interrupt/APIC.h>
+#include <kernel/interrupt/MADT.h>
+#include <kernel/interrupt/idt.h>
+#include <kernel/memory/MemoryManager.h>
+#include <kernel/time/TimeManager.h>
+
+#define AP_STACK_SIZE (PAGE_SIZE * 4)
+// How long to wait after the INIT IPI, after the first startup IPI, and for the processor to start after the second
+#define AP_INIT_DELAY_US 10000
+#define AP_STARTUP_DELAY_US 200
+#define AP_START_TIMEOUT_US 100000
+
+/// The parameters at the end of ap_trampoline.s.
+struct APTrampolineParams {
+	uint32_t page_directory;
+	uint32_t stack;
+	uint32_t processor;
+} __attribute__((packed));
+
+extern "C" char ap_trampoline_start[];
+extern "C" char ap_trampoline_params[];
+extern "C" char ap_trampoline_end[];
+
+extern "C" void ap_main(int id) {
+	Processor::application_processor_entry(id);
+}
+
+Processor Processor::s_processors[MAX_PROCESSORS];
+int Processor::s_count = 1;
+int Processor::s_count_detected = 1;
+int8_t Processor::s_id_by_apic_id[256];
+static size_t s_kernel_directory_physaddr = 0;
+static kstd::vector<kstd::Arc<VMRegion>> s_ap_stacks;
+
+static uint8_t cpuid_apic_id() {
+	uint32_t eax, ebx, ecx, edx;
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+	return ebx >> 24;
+}
+
+static void wait_us(uint64_t us) {
+	auto deadline = TimeManager::uptime_us() + us;
+	while(TimeManager::uptime_us() < deadline)
+		asm volatile("pause");
+}
+
+void Processor::init() {
+	for(int i = 0; i < MAX_PROCESSORS; i++)
+		s_processors[i].m_id = i;
+	for(auto& id : s_id_by_apic_id)
+		id = -1;
+
+	auto& boot = s_processors[0];
+	boot.m_apic_id = cpuid_apic_id();
+	boot.m_online = true;
+	boot.m_started.store(true);
+	s_id_by_apic_id[boot.m_apic_id] = 0;
+
+	// Switch the boot processor over from the GDT it booted with to its own, like the other processors will have
+	Memory::load_processor_gdt(boot.m_gdt, boot.tss);
+
+	// The MADT lists every processor's local APIC. Without it, we don't know how to address any of the others.
+	if(MADT::init()) {
+		for(auto apic_id : MADT::processor_apic_ids()) {
+			if(apic_id == boot.m_apic_id)
+				continue;
+			if(s_count_detected == MAX_PROCESSORS) {
+				KLog::warn("Processor", "Ignoring processors past the first %d", MAX_PROCESSORS);
+				break;
+			}
+			auto& cpu = s_processors[s_count_detected];
+			cpu.m_apic_id = apic_id;
+			s_id_by_apic_id[apic_id] = (int8_t) s_count_detected;
+			s_count_detected++;
+		}
+	}
+
+	KLog::dbg("Processor", "Detected %d processor(s), %d online", s_count_detected, s_count);
+}
+
+void Processor::start_application_processors() {
+	if(s_count_detected == 1)
+		return;
+	if(!CommandLine::inst().has_option("start_aps")) {
+		KLog::dbg("Processor", "Not starting the other %d processor(s) without start_aps", s_count_detected - 1);
+		return;
+	}
+	if(!APIC::init())
+		return;
+
+	// Copy the trampoline down to where the processors start
+	auto trampoline = MM.alloc_mapped_region(AP_TRAMPOLINE_ADDR, PAGE_SIZE);
+	memcpy((void*) trampoline->start(), ap_trampoline_start, ap_trampoline_end - ap_trampoline_start);
+	auto* params = (APTrampolineParams*) (trampoline->start() + (ap_trampoline_params - ap_trampoline_start));
+
+	// Paging is turned on while the processor is still running the trampoline, so it starts with a page directory that
+	// has the trampoline identity mapped along with the kernel. It switches to the kernel's own right away.
+	auto directory = MM.alloc_kernel_region(PAGE_SIZE);
+	auto* entries = (PageDirectory::Entry*) directory->start();
+	memset(entries, 0, PAGE_SIZE);
+	for(size_t i = 768; i < 1024; i++)
+		entries[i] = MM.kernel_page_directory.entries()[i];
+	entries[0].data.present = true;
+	entries[0].data.read_write = true;
+	entries[0].data.size = 1;
+	entries[0].data.set_address(0);
+	params->page_directory = MM.kernel_page_directory.get_physaddr(directory->start());
+	s_kernel_directory_physaddr = (size_t) MM.kernel_page_directory.entries() - HIGHER_HALF;
+
+	int num_started = 0;
+	for(int i = 1; i < s_count_detected; i++) {
+		auto& cpu = s_processors[i];
+		auto stack = MM.alloc_kernel_region(AP_STACK_SIZE);
+		s_ap_stacks.push_back(stack);
+		params->stack = stack->end();
+		params->processor = i;
+
+		// INIT, then up to two startup IPIs, as the MP spec says to
+		APIC::send_init(cpu.m_apic_id);
+		wait_us(AP_INIT_DELAY_US);
+		for(int attempt = 0; attempt < 2 && !cpu.m_started.load(); attempt++) {
+			APIC::send_startup(cpu.m_apic_id, AP_TRAMPOLINE_ADDR / PAGE_SIZE);
+			auto deadline = TimeManager::uptime_us() + (attempt ? AP_START_TIMEOUT_US : AP_STARTUP_DELAY_US);
+			while(!cpu.m_started.load() && TimeManager::uptime_us() < deadline)
+				asm volatile("pause");
+		}
+
+		// If it's just slow, it could still pick up the next processor's parameters. So don't start any more.
+		if(!cpu.m_started.load()) {
+			KLog::warn("Processor", "Processor %d (APIC %d) didn't start", i, cpu.m_apic_id);
+			break;
+		}
+		num_started++;
+	}
+
+	KLog::info("Processor", "Started and parked %d of %d application processor(s)", num_started, s_count_detected - 1);
+}
+
+void Processor::application_processor_entry(int id) {
+	// Nothing here can take a lock, since the scheduler doesn't know about this processor and would think we're
+	// whatever thread the boot processor is running.
+	auto& cpu = s_processors[id];
+	asm volatile("mov %0, %%cr3" :: "r"(s_kernel_directory_physaddr) : "memory");
+	Memory::load_processor_gdt(cpu.m_gdt, cpu.tss);
+	Interrupt::idt_load();
+	APIC::init_application_processor();
+	cpu.m_started.store(true);
+
+	// See the comment on Processor for why the processor doesn't run threads
+	while(true)
+		asm volatile("cli; hlt");
+}
+
+Processor& Processor::current() {
+	return s_processors[current_id()];
+}
+
+Processor& Processor::boot_processor() {
+	return s_processors[0];
+}
+
+Processor& Processor::get(int id) {
+	return s_processors[id];
+}
+
+int Processor::count() {
+	return s_count;
+}
+
+int Processor::count_detected() {
+	return s_count_detected;
+}
+
+uint32_t Processor::online_mask() {
+	uint32_t mask = 0;
+	for(int i = 0; i < s_count; i++) {
+		if(s_processors[i].m_online)
+			mask |= 1u << i;
+	}
+	return mask;
+}
+
+int Processor::current_id() {
+	// With just one processor online there's no need to ask which one we are
+	if(s_count == 1)
+		return 0;
+	// APIC IDs don't have to be contiguous, so they're looked up in the table built from the MADT
+	return s_id_by_apic_id[APIC::id()];
+}
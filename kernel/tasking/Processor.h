@@ -0,0 +1,82 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/Arc.h>
+#include <kernel/Atomic.h>
+#include <kernel/memory/gdt.h>
+#include "TSS.h"
+#include "RunQueue.h"
+
+#define MAX_PROCESSORS 8
+//The physical address that application processors start at. Must match ap_trampoline.s.
+#define AP_TRAMPOLINE_ADDR 0x1000
+
+class Thread;
+
+/**
+ * The state that each processor keeps for itself: the thread it's running, its TSS, how deeply nested its critical
+ * sections are, and its own run queue.
+ *
+ * The scheduler only touches the state of the processor it's running on.
+ *
+ * Processors are numbered by the order the MADT lists them in, with the boot processor always being processor 0, and
+ * are looked up by the ID of their local APIC.
+ *
+ * Only the boot processor runs threads. The application processors can be started with the start_aps command line
+ * option, but they're parked as soon as they've come up and are never brought online: critical sections only disable
+ * interrupts on the processor they're entered on, and there's no TLB shootdown or timer for the other processors.
+ */
+class Processor {
+public:
+	/// Sets up the boot processor and finds the other processors in the MADT.
+	static void init();
+	/// Starts the application processors and parks them, if the start_aps command line option is set. Must be called
+	/// once timekeeping is running.
+	static void start_application_processors();
+	/// Where application processors go once the trampoline has them in protected mode with paging on.
+	[[noreturn]] static void application_processor_entry(int id);
+	/// The processor that the caller is running on. Must be called with interrupts disabled if the result is going to
+	/// be used after a point where the current thread could be preempted.
+	static Processor& current();
+	static Processor& boot_processor();
+	static Processor& get(int id);
+	/// The number of processors that are online.
+	static int count();
+	/// The number of processors that were detected, including ones that aren't online.
+	static int count_detected();
+	/// An affinity mask with the bits of all of the processors that are online set.
+	static uint32_t online_mask();
+
+	[[nodiscard]] int id() const { return m_id; }
+	[[nodiscard]] bool is_online() const { return m_online; }
+	[[nodiscard]] uint8_t apic_id() const { return m_apic_id; }
+	[[nodiscard]] Memory::GDTEntry* gdt() { return m_gdt; }
+
+	TSS tss;
+	kstd::Arc<Thread> current_thread;
+	RunQueue run_queue;
+	Atomic<int, MemoryOrder::SeqCst> critical_count = 0;
+	Thread* fpu_owner = nullptr; // The thread whose FPU state is currently loaded. See FPU.h.
+
+	// Scheduler state
+	int quantum_counter = 0;
+	bool yield_voluntary = false;
+	bool yield_async = false;
+	bool preempting = false;
+
+private:
+	static int current_id();
+
+	static Processor s_processors[MAX_PROCESSORS];
+	static int s_count;
+	static int s_count_detected;
+	static int8_t s_id_by_apic_id[256]; ///< The processor with each local APIC ID, or -1 if there isn't one.
+
+	int m_id = 0;
+	uint8_t m_apic_id = 0;
+	bool m_online = false;
+	Atomic<bool, MemoryOrder::SeqCst> m_started = false;
+	Memory::GDTEntry m_gdt[GDT_ENTRIES]; ///< The processor's own GDT. The global one is only used while booting.
+};
@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Profiler.h"
+#include "TaskManager.h"
+#include "Thread.h"
+#include "Process.h"
+#include <kernel/memory/MemoryManager.h>
+#include <kernel/time/TimeManager.h>
+
+namespace Profiler {
+	static profile_sample* s_samples = nullptr;
+	static uint64_t s_next_seq = 0;
+	static bool s_running = false;
+	static pid_t s_pid = 0;
+
+	void start(pid_t pid) {
+		// The buffer is allocated the first time it's needed and kept around, so sampling never has to allocate
+		if(!s_samples) {
+			auto* samples = new profile_sample[PROFILE_BUFFER_SIZE];
+			TaskManager::ScopedCritical critical;
+			if(!s_samples)
+				s_samples = samples;
+			else
+				delete[] samples;
+		}
+
+		TaskManager::ScopedCritical critical;
+		s_pid = pid;
+		s_running = true;
+	}
+
+	void stop() {
+		TaskManager::ScopedCritical critical;
+		s_running = false;
+	}
+
+	void sample(Registers* regs) {
+		if(!s_running)
+			return;
+		auto& thread = TaskManager::current_thread();
+		if(!thread)
+			return;
+		auto* process = thread->process();
+		if(s_pid && process->pid() != s_pid)
+			return;
+
+		auto& sample = s_samples[s_next_seq % PROFILE_BUFFER_SIZE];
+		sample.seq = s_next_seq++;
+		sample.time = TimeManager::uptime_us();
+		sample.pid = process->pid();
+		sample.tid = thread->tid();
+		bool kernel = !(regs->cs & 3);
+		sample.flags = kernel ? PROFILE_SAMPLE_KERNEL : 0;
+		sample.frames[0] = regs->eip;
+		sample.num_frames = 1;
+
+		// Follow the frame pointers for as long as they stay mapped and on the same side of the address space. The
+		// interrupted code might not use frame pointers, in which case we'll just stop at the first odd-looking one.
+		auto& page_directory = kernel ? MM.kernel_page_directory : *process->page_directory();
+		auto* frame = (uint32_t*) regs->ebp;
+		while(sample.num_frames < PROFILE_MAX_FRAMES && frame && !((size_t) frame & 3)) {
+			if(((size_t) frame >= HIGHER_HALF) != kernel)
+				break;
+			if(!page_directory.is_mapped((VirtualAddress) frame, false) || !page_directory.is_mapped((VirtualAddress) &frame[1], false))
+				break;
+			auto return_address = frame[1];
+			if(!return_address)
+				break;
+			sample.frames[sample.num_frames++] = return_address;
+			// Stacks grow down, so the next frame has to be higher up
+			auto* next = (uint32_t*) frame[0];
+			if(next <= frame)
+				break;
+			frame = next;
+		}
+	}
+
+	ssize_t read(size_t start, size_t length, SafePointer<uint8_t> buffer) {
+		// Only whole samples can be read
+		if(start % sizeof(profile_sample))
+			return -EINVAL;
+
+		uint64_t seq = start / sizeof(profile_sample);
+		size_t count = length / sizeof(profile_sample);
+		size_t nread = 0;
+		while(nread < count) {
+			profile_sample sample;
+			{
+				TaskManager::ScopedCritical critical;
+				if(seq >= s_next_seq)
+					break;
+				if(s_next_seq - seq > PROFILE_BUFFER_SIZE) {
+					// This sample got overwritten already
+					sample = {};
+					sample.seq = seq;
+					sample.flags = PROFILE_SAMPLE_LOST;
+				} else {
+					sample = s_samples[seq % PROFILE_BUFFER_SIZE];
+				}
+			}
+			buffer.write((uint8_t*) &sample, nread * sizeof(profile_sample), sizeof(profile_sample));
+			nread++;
+			seq++;
+		}
+		return nread * sizeof(profile_sample);
+	}
+}
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+#include <kernel/kstd/kstddef.h>
+#include <kernel/api/profile.h>
+#include <kernel/memory/SafePointer.h>
+
+// The number of samples kept in the profiler's ring buffer
+#define PROFILE_BUFFER_SIZE 2048
+
+/**
+ * A sampling profiler. While it's running, every timer interrupt records where the processor was, along with a short
+ * frame pointer backtrace, into a ring buffer that's read through /dev/profile. Sampling never allocates or blocks,
+ * since it happens in the middle of an interrupt.
+ */
+namespace Profiler {
+	/// Starts sampling the given process, or every process if pid is zero.
+	void start(pid_t pid);
+	void stop();
+	/// Called from the timer interrupt with the registers of whatever was interrupted.
+	void sample(Registers* regs);
+	/// Reads samples starting at the given byte offset into the stream. See profile_sample for the format.
+	ssize_t read(size_t start, size_t length, SafePointer<uint8_t> buffer);
+}
@@ -0,0 +1,167 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "RWLock.h"
+#include "Thread.h"
+#include "TaskManager.h"
+
+extern bool g_panicking;
+
+bool RWLock::locked() {
+	return m_writer != -1 || m_num_readers;
+}
+
+void RWLock::acquire() {
+	auto cur_thread = TaskManager::current_thread();
+	if(!TaskManager::enabled() || !cur_thread || g_panicking)
+		return; //Tasking isn't initialized yet
+	ASSERT(!TaskManager::in_critical());
+
+	auto cur_tid = cur_thread->tid();
+	bool waiting = false;
+	while(true) {
+		{
+			TaskManager::ScopedCritical crit;
+			if(m_writer == cur_tid) {
+				m_times_write_locked++;
+				return;
+			}
+
+			// Upgrading from a read lock isn't allowed
+			ASSERT(!reader_for(cur_tid));
+
+			if(can_write()) {
+				if(waiting)
+					m_waiting_writers--;
+				m_writer = cur_tid;
+				m_times_write_locked = 1;
+				return;
+			}
+
+			if(!waiting) {
+				waiting = true;
+				m_waiting_writers++;
+			}
+		}
+
+		RWLockBlocker blocker(*this, true);
+		cur_thread->block(blocker);
+	}
+}
+
+void RWLock::release() {
+	if(!TaskManager::enabled() || g_panicking)
+		return;
+	ASSERT(held_for_writing());
+
+	TaskManager::ScopedCritical crit;
+	if(!--m_times_write_locked) {
+		m_writer = -1;
+		m_waiters.wake();
+	}
+}
+
+void RWLock::acquire_read() {
+	auto cur_thread = TaskManager::current_thread();
+	if(!TaskManager::enabled() || !cur_thread || g_panicking)
+		return; //Tasking isn't initialized yet
+	ASSERT(!TaskManager::in_critical());
+
+	auto cur_tid = cur_thread->tid();
+	while(true) {
+		{
+			TaskManager::ScopedCritical crit;
+
+			// Reading while holding the lock for writing just counts as another write lock
+			if(m_writer == cur_tid) {
+				m_times_write_locked++;
+				return;
+			}
+
+			// Readers that already hold the lock can always take it again, even if a writer is waiting
+			auto reader = reader_for(cur_tid);
+			if(reader) {
+				reader->times_locked++;
+				return;
+			}
+
+			if(can_read()) {
+				reader = reader_for(-1);
+				reader->tid = cur_tid;
+				reader->times_locked = 1;
+				m_num_readers++;
+				return;
+			}
+		}
+
+		RWLockBlocker blocker(*this, false);
+		cur_thread->block(blocker);
+	}
+}
+
+void RWLock::release_read() {
+	if(!TaskManager::enabled() || g_panicking)
+		return;
+
+	auto cur_tid = TaskManager::current_thread()->tid();
+	if(m_writer == cur_tid) {
+		release();
+		return;
+	}
+
+	TaskManager::ScopedCritical crit;
+	auto reader = reader_for(cur_tid);
+	ASSERT(reader);
+	if(!--reader->times_locked) {
+		reader->tid = -1;
+		if(!--m_num_readers)
+			m_waiters.wake();
+		else if(m_num_readers == RWLOCK_MAX_READERS - 1)
+			m_waiters.wake_one();
+	}
+}
+
+bool RWLock::held_for_writing() {
+	auto cur_thread = TaskManager::current_thread();
+	return !cur_thread || cur_thread->tid() == m_writer;
+}
+
+bool RWLock::held_for_reading() {
+	auto cur_thread = TaskManager::current_thread();
+	if(!cur_thread || cur_thread->tid() == m_writer)
+		return true;
+	TaskManager::ScopedCritical crit;
+	return reader_for(cur_thread->tid());
+}
+
+bool RWLock::can_write() {
+	return m_writer == -1 && !m_num_readers;
+}
+
+bool RWLock::can_read() {
+	return m_writer == -1 && !m_waiting_writers && m_num_readers < RWLOCK_MAX_READERS;
+}
+
+RWLock::Reader* RWLock::reader_for(tid_t tid) {
+	for(auto& reader : m_readers) {
+		if(reader.tid == tid)
+			return &reader;
+	}
+	return nullptr;
+}
+
+RWLock::RWLockBlocker::RWLockBlocker(RWLock& lock, bool write): m_lock(lock), m_write(write), m_entry(this) {
+	m_lock.m_waiters.add(m_entry);
+}
+
+bool RWLock::RWLockBlocker::is_ready() {
+	return m_write ? m_lock.can_write() : m_lock.can_read();
+}
+
+bool RWLock::RWLockBlocker::can_be_interrupted() {
+	return false;
+}
+
+bool RWLock::RWLockBlocker::is_lock() {
+	return true;
+}
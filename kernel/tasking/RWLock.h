@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "Lock.h"
+#include "Blocker.h"
+#include "WaitQueue.h"
+#include "../kstd/unix_types.h"
+
+#define READ_LOCK(lock) RWLock::ScopedReadLocker __read_locker((lock))
+#define WRITE_LOCK(lock) LOCK(lock)
+
+// The maximum number of different threads that can hold an RWLock for reading at once
+#define RWLOCK_MAX_READERS 16
+
+/**
+ * A lock that can be held by any number of readers at once, or by a single writer. Waiting threads are put to sleep,
+ * so like a Mutex, it can't be acquired in an interrupt or while in a critical section.
+ *
+ * Writers are preferred: once a writer is waiting, threads that don't already hold the lock can't start reading until
+ * the writer is done. Recursion follows the rules of SpinLock - a thread holding the lock for writing can take it again
+ * for writing or reading, and a thread holding it for reading can take it again for reading. A reader can't upgrade to
+ * a writer, since two readers trying to do so at once would deadlock.
+ *
+ * acquire() and release() (and thus LOCK()) take the lock for writing.
+ */
+class RWLock: public Lock {
+public:
+	class ScopedReadLocker {
+	public:
+		explicit ScopedReadLocker(RWLock& lock): m_lock(lock) { m_lock.acquire_read(); }
+		~ScopedReadLocker() { m_lock.release_read(); }
+	private:
+		RWLock& m_lock;
+	};
+
+	RWLock() = default;
+	~RWLock() = default;
+
+	bool locked() override;
+	void acquire() override;
+	void release() override;
+	void acquire_read();
+	void release_read();
+
+	bool held_for_writing();
+	bool held_for_reading();
+	[[nodiscard]] tid_t writer() const { return m_writer; }
+	[[nodiscard]] int num_readers() const { return m_num_readers; }
+
+	template<typename R, typename F>
+	R synced_read(F&& lambda) {
+		READ_LOCK(*this);
+		return lambda();
+	}
+
+private:
+	struct Reader {
+		tid_t tid = -1;
+		int times_locked = 0;
+	};
+
+	class RWLockBlocker: public Blocker {
+	public:
+		RWLockBlocker(RWLock& lock, bool write);
+		bool is_ready() override;
+		bool can_be_interrupted() override;
+		bool is_lock() override;
+
+	private:
+		RWLock& m_lock;
+		bool m_write;
+		WaitQueue::Entry m_entry;
+	};
+
+	bool can_write();
+	bool can_read();
+	Reader* reader_for(tid_t tid);
+
+	tid_t m_writer = -1;
+	int m_times_write_locked = 0;
+	int m_waiting_writers = 0;
+	int m_num_readers = 0;
+	Reader m_readers[RWLOCK_MAX_READERS];
+	WaitQueue m_waiters;
+};
@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "RunQueue.h"
+#include "Thread.h"
+
+void RunQueue::push(Thread* thread) {
+	if(thread->m_queued_priority != -1)
+		return;
+
+	// If the thread hasn't been queued since the last boost, it gets boosted now
+	if(thread->m_boost_epoch != m_boost_epoch) {
+		thread->m_boost_epoch = m_boost_epoch;
+		thread->m_priority = thread->m_base_priority;
+	}
+
+	int priority = thread->m_priority;
+	thread->m_queued_priority = priority;
+	thread->m_next = nullptr;
+	thread->m_prev = m_tails[priority];
+	if(m_tails[priority])
+		m_tails[priority]->m_next = thread;
+	else
+		m_heads[priority] = thread;
+	m_tails[priority] = thread;
+
+	m_counts[priority]++;
+	m_size++;
+	m_bitmap |= 1u << priority;
+}
+
+Thread* RunQueue::pop() {
+	int priority = highest_priority();
+	if(priority == -1)
+		return nullptr;
+	auto* thread = m_heads[priority];
+	remove(thread);
+	return thread;
+}
+
+void RunQueue::remove(Thread* thread) {
+	int priority = thread->m_queued_priority;
+	if(priority == -1)
+		return;
+
+	if(thread->m_prev)
+		thread->m_prev->m_next = thread->m_next;
+	else
+		m_heads[priority] = thread->m_next;
+	if(thread->m_next)
+		thread->m_next->m_prev = thread->m_prev;
+	else
+		m_tails[priority] = thread->m_prev;
+
+	thread->m_next = nullptr;
+	thread->m_prev = nullptr;
+	thread->m_queued_priority = -1;
+
+	m_size--;
+	if(!--m_counts[priority])
+		m_bitmap &= ~(1u << priority);
+}
+
+void RunQueue::boost() {
+	m_boost_epoch++;
+
+	// Go from the lowest priority up so that threads which were waiting the longest end up at the front
+	for(int priority = THREAD_PRIORITY_MIN; priority > THREAD_PRIORITY_MAX; priority--) {
+		// Threads that are already at their base priority go back onto the end of this list, so only look at as many
+		// threads as were in the list to begin with
+		size_t count = m_counts[priority];
+		while(count--) {
+			auto* thread = m_heads[priority];
+			remove(thread);
+			push(thread);
+		}
+	}
+}
+
+int RunQueue::highest_priority() const {
+	if(!m_bitmap)
+		return -1;
+	return __builtin_ctz(m_bitmap);
+}
@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+
+// The number of priority levels in the run queue. Level 0 is the highest priority.
+#define THREAD_PRIORITY_LEVELS 8
+#define THREAD_PRIORITY_MAX 0
+#define THREAD_PRIORITY_MIN (THREAD_PRIORITY_LEVELS - 1)
+#define THREAD_PRIORITY_DEFAULT 2
+
+// An affinity mask that allows a thread to run on any processor
+#define THREAD_AFFINITY_ALL 0xFFFFFFFFu
+
+// How often (in ticks) all threads are boosted back to their base priority to prevent starvation.
+#define THREAD_PRIORITY_BOOST_TICKS 1024
+
+class Thread;
+
+/**
+ * A multi-level run queue of threads. Each priority level has its own intrusive FIFO list of threads (linked through
+ * Thread::m_next and Thread::m_prev), and a bitmap keeps track of which levels are non-empty so that picking the
+ * highest-priority thread and queueing / dequeueing a thread are all O(1).
+ *
+ * The run queue does no locking of its own; TaskManager::g_tasking_lock must be held while using it.
+ */
+class RunQueue {
+public:
+	RunQueue() = default;
+
+	/// Adds a thread to the back of the list for its current priority. Does nothing if it is already queued.
+	void push(Thread* thread);
+	/// Removes and returns the thread at the front of the highest-priority non-empty list, or nullptr if empty.
+	Thread* pop();
+	/// Removes a thread from the queue if it is queued.
+	void remove(Thread* thread);
+	/// Moves every queued thread back to its base priority. Threads that aren't queued right now will be moved back to
+	/// their base priority the next time they are queued.
+	void boost();
+
+	/// Returns the highest priority level with a queued thread, or -1 if the queue is empty.
+	[[nodiscard]] int highest_priority() const;
+	[[nodiscard]] bool empty() const { return !m_bitmap; }
+	[[nodiscard]] size_t size() const { return m_size; }
+	[[nodiscard]] size_t size(int priority) const { return m_counts[priority]; }
+
+	/// The length of the quantum (in ticks) that a thread at a given priority level gets.
+	static constexpr int quantum(int priority) { return 2 << priority; }
+
+private:
+	Thread* m_heads[THREAD_PRIORITY_LEVELS] = {nullptr};
+	Thread* m_tails[THREAD_PRIORITY_LEVELS] = {nullptr};
+	size_t m_counts[THREAD_PRIORITY_LEVELS] = {0};
+	uint32_t m_bitmap = 0;
+	size_t m_size = 0;
+	uint32_t m_boost_epoch = 0;
+};
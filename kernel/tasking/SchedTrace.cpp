@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "SchedTrace.h"
+#include "TaskManager.h"
+#include "Thread.h"
+#include "Process.h"
+#include <kernel/time/TimeManager.h>
+
+namespace SchedTrace {
+	static sched_trace_event s_events[SCHED_TRACE_SIZE];
+	static uint64_t s_next_seq = 0;
+
+	void record(uint32_t type, Thread* thread, Thread* next) {
+		TaskManager::ScopedCritical critical;
+		auto& event = s_events[s_next_seq % SCHED_TRACE_SIZE];
+		event.seq = s_next_seq++;
+		event.time = TimeManager::uptime_us();
+		event.type = type;
+		event.pid = thread->process()->pid();
+		event.tid = thread->tid();
+		event.next_pid = next ? next->process()->pid() : 0;
+		event.next_tid = next ? next->tid() : 0;
+		event.priority = next ? next->priority() : thread->priority();
+	}
+
+	ssize_t read(size_t start, size_t length, SafePointer<uint8_t> buffer) {
+		// Only whole events can be read
+		if(start % sizeof(sched_trace_event))
+			return -EINVAL;
+
+		uint64_t seq = start / sizeof(sched_trace_event);
+		size_t count = length / sizeof(sched_trace_event);
+		size_t nread = 0;
+		while(nread < count) {
+			sched_trace_event event;
+			{
+				TaskManager::ScopedCritical critical;
+				if(seq >= s_next_seq)
+					break;
+				if(s_next_seq - seq > SCHED_TRACE_SIZE) {
+					// This event got overwritten already
+					event = {};
+					event.seq = seq;
+					event.type = SCHED_TRACE_LOST;
+				} else {
+					event = s_events[seq % SCHED_TRACE_SIZE];
+				}
+			}
+			buffer.write((uint8_t*) &event, nread * sizeof(sched_trace_event), sizeof(sched_trace_event));
+			nread++;
+			seq++;
+		}
+		return nread * sizeof(sched_trace_event);
+	}
+}
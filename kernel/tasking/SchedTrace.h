@@ -0,0 +1,23 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+#include <kernel/api/sched.h>
+#include <kernel/memory/SafePointer.h>
+
+// The number of events kept in the scheduler trace ring buffer
+#define SCHED_TRACE_SIZE 1024
+
+class Thread;
+
+/**
+ * A ring buffer of recent scheduler events, exported through /proc/schedtrace. Recording never allocates or locks, so
+ * it's safe to do from the middle of preempt().
+ */
+namespace SchedTrace {
+	void record(uint32_t type, Thread* thread, Thread* next = nullptr);
+	/// Reads events starting at the given byte offset into the trace. See sched_trace_event for the format.
+	ssize_t read(size_t start, size_t length, SafePointer<uint8_t> buffer);
+}
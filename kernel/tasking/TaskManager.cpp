@@ -22,30 +22,53 @@
 #include <kernel/interrupt/irq.h>
 #include <kernel/filesystem/procfs/ProcFS.h>
 #include "TSS.h"
+#include "Processor.h"
+#include "FPU.h"
+#include "SchedTrace.h"
+#include <kernel/Trace.h>
 #include "Process.h"
 #include "Thread.h"
 #include "Reaper.h"
+#include <kernel/memory/Readahead.h>
+#include <kernel/memory/MemoryManager.h>
+#include <kernel/memory/PageMerger.h>
+#include <kernel/CommandLine.h>
+#include <kernel/device/DiskDevice.h>
+#include <kernel/device/BlockIOQueue.h>
+#include <kernel/tasking/WorkQueue.h>
+#include "Blocker.h"
+#include <kernel/time/TimeManager.h>
 #include <kernel/kstd/KLog.h>
+#include <kernel/memory/gdt.h>
 
-TSS TaskManager::tss;
 SpinLock TaskManager::g_tasking_lock;
 SpinLock TaskManager::g_process_lock;
 
-kstd::Arc<Thread> cur_thread;
 Process* kernel_process;
+static kstd::Arc<Thread> kidle_thread;
 kstd::vector<Process*>* processes = nullptr;
-Thread* TaskManager::g_next_thread;
+static ProcessTable g_process_table;
 
 Atomic<int> next_pid = 0;
 bool tasking_enabled = false;
-bool yield_async = false;
-bool preempting = false;
-static uint8_t quantum_counter = 0;
+static bool should_boost = false;
+static int boost_counter = 0;
 
 void kidle(){
 	tasking_enabled = true;
 	TaskManager::yield();
 	while(1) {
+		// Use the spare time to zero pages for later. Anything that gets woken up by an interrupt in the meantime will
+		// preempt us, so only a few pages need to be done at a time.
+		if(MM.fill_zeroed_pool(4))
+			continue;
+
+		// If there's nothing else to run, stop the periodic tick until something wakes up. Any interrupt that queues a
+		// thread will preempt us when it returns, and the tick is resumed when we switch away from this thread.
+		TaskManager::enter_critical();
+		if(Processor::current().run_queue.empty())
+			TimeManager::stop_tick();
+		TaskManager::leave_critical();
 		asm volatile("hlt");
 	}
 }
@@ -53,64 +76,61 @@ void kidle(){
 ResultRet<Process*> TaskManager::process_for_pid(pid_t pid){
 	if(!pid)
 		return Result(-ENOENT);
-	for(int i = 0; i < processes->size(); i++) {
-		auto cur = processes->at(i);
-		if(cur->pid() == pid && cur->state() != Process::DEAD)
-			return processes->at(i);
-	}
-	return Result(-ENOENT);
+	auto* proc = g_process_table.find(ProcessTable::PID, pid);
+	if(!proc)
+		return Result(-ENOENT);
+	return proc;
 }
 
 ResultRet<Process*> TaskManager::process_for_pgid(pid_t pgid, pid_t excl){
 	if(!pgid)
 		return Result(-ENOENT);
-	for(int i = 0; i < processes->size(); i++) {
-		auto cur = processes->at(i);
-		if(cur->pgid() == pgid && cur->pid() != excl && cur->state() != Process::DEAD)
-			return processes->at(i);
-	}
-	return Result(-ENOENT);
+	auto* proc = g_process_table.find(ProcessTable::PGID, pgid, excl);
+	if(!proc)
+		return Result(-ENOENT);
+	return proc;
 }
 
 ResultRet<Process*> TaskManager::process_for_ppid(pid_t ppid, pid_t excl){
 	if(!ppid)
 		return Result(-ENOENT);
-	for(int i = 0; i < processes->size(); i++) {
-		auto cur = processes->at(i);
-		if(cur->ppid() == ppid && cur->pid() != excl && cur->state() != Process::DEAD)
-			return processes->at(i);
-	}
-	return Result(-ENOENT);
+	auto* proc = g_process_table.find(ProcessTable::PPID, ppid, excl);
+	if(!proc)
+		return Result(-ENOENT);
+	return proc;
 }
 
 ResultRet<Process*> TaskManager::process_for_sid(pid_t sid, pid_t excl){
 	if(!sid)
 		return Result(-ENOENT);
-	for(int i = 0; i < processes->size(); i++) {
-		auto cur = processes->at(i);
-		if(cur->sid() == sid && cur->pid() != excl && cur->state() != Process::DEAD)
-			return processes->at(i);
-	}
-	return Result(-ENOENT);
+	auto* proc = g_process_table.find(ProcessTable::SID, sid, excl);
+	if(!proc)
+		return Result(-ENOENT);
+	return proc;
 }
 
 void TaskManager::kill_pgid(pid_t pgid, int sig) {
 	if(!pgid)
 		return;
-	for(int i = 0; i < processes->size(); i++) {
-		auto cur = processes->at(i);
-		if(cur->pgid() == pgid) {
-			cur->kill(sig);
-			return;
-		}
-	}
+	auto* proc = g_process_table.find(ProcessTable::PGID, pgid);
+	if(proc)
+		proc->kill(sig);
 }
 
 void TaskManager::reparent_orphans(Process* dead) {
 	CRITICAL_LOCK(g_tasking_lock);
-	for(auto process : *processes)
-		if(process->ppid() == dead->pid())
-			process->set_ppid(1);
+	bool reparented = false;
+	g_process_table.for_each(ProcessTable::PPID, dead->pid(), [&](Process* process) {
+		process->set_ppid(1);
+		reparented = true;
+	});
+
+	// Let init know in case any of its new children are already zombies
+	if(reparented) {
+		auto init = process_for_pid(1);
+		if(!init.is_error())
+			init.value()->child_wait_queue().wake();
+	}
 }
 
 bool TaskManager::enabled(){
@@ -120,11 +140,11 @@ bool TaskManager::enabled(){
 bool TaskManager::is_idle() {
 	if(!kernel_process)
 		return true;
-	return cur_thread->tid() == kernel_process->pid();
+	return Processor::current().current_thread->tid() == kernel_process->pid();
 }
 
 bool TaskManager::is_preempting() {
-	return preempting;
+	return Processor::current().preempting;
 }
 
 pid_t TaskManager::get_new_pid(){
@@ -133,43 +153,64 @@ pid_t TaskManager::get_new_pid(){
 
 void TaskManager::init(){
 	KLog::dbg("TaskManager", "Initializing tasking...");
+	Processor::init();
+	FPU::init();
 	g_tasking_lock.acquire();
 
 	processes = new kstd::vector<Process*>();
 
 	//Create kernel process
 	kernel_process = Process::create_kernel("[kernel]", kidle);
+	kidle_thread = kernel_process->get_thread(kernel_process->pid());
 	processes->push_back(kernel_process);
+	g_process_table.add(kernel_process);
 
 	//Create kinit process
 	auto kinit_process = Process::create_kernel("[kinit]", kmain_late);
 	processes->push_back(kinit_process);
+	g_process_table.add(kinit_process);
 	queue_thread(kinit_process->get_thread(kinit_process->pid()));
 
 	//Create kernel threads
 	kernel_process->spawn_kernel_thread(kreaper_entry);
+	kernel_process->spawn_kernel_thread(kreadahead_entry);
+	kernel_process->spawn_kernel_thread(kreclaim_entry);
+	kernel_process->spawn_kernel_thread(kflush_entry);
+	kernel_process->spawn_kernel_thread(kblockio_entry);
+	kernel_process->spawn_kernel_thread(kworker_entry);
+	//With klog_sync, log messages are written out right away so that none are lost if the machine hangs or resets
+	if(!CommandLine::inst().has_option("klog_sync"))
+		kernel_process->spawn_kernel_thread(klog_entry);
+	if(CommandLine::inst().has_option("page_merge"))
+		kernel_process->spawn_kernel_thread(kpagemerge_entry);
 
 	//Preempt
-	cur_thread = kernel_process->get_thread(kernel_process->pid());
-	preempt_init_asm(cur_thread->registers.esp);
+	auto& cpu = Processor::current();
+	cpu.current_thread = kidle_thread;
+	preempt_init_asm(cpu.current_thread->registers.esp);
 }
 
 kstd::vector<Process*>* TaskManager::process_list() {
 	return processes;
 }
 
+ProcessTable& TaskManager::process_table() {
+	return g_process_table;
+}
+
 kstd::Arc<Thread>& TaskManager::current_thread() {
-	return cur_thread;
+	return Processor::current().current_thread;
 }
 
 Process* TaskManager::current_process() {
-	return cur_thread->process();
+	return Processor::current().current_thread->process();
 }
 
 int TaskManager::add_process(Process* proc){
 	g_process_lock.acquire();
 	ProcFS::inst().proc_add(proc);
 	processes->push_back(proc);
+	g_process_table.add(proc);
 	g_process_lock.release();
 
 	CRITICAL_LOCK(g_tasking_lock);
@@ -182,6 +223,7 @@ int TaskManager::add_process(Process* proc){
 void TaskManager::remove_process(Process* proc) {
 	LOCK(g_process_lock);
 	ProcFS::inst().proc_remove(proc);
+	g_process_table.remove(proc);
 	for(size_t i = 0; i < processes->size(); i++) {
 		if(processes->at(i) == proc) {
 			processes->erase(i);
@@ -206,54 +248,77 @@ void TaskManager::queue_thread(const kstd::Arc<Thread>& thread) {
 		return;
 	}
 
-	if(g_next_thread)
-		g_next_thread->enqueue_thread(thread.get());
-	else
-		g_next_thread = thread.get();
+	// Queue the thread on this processor if it's allowed to run here, otherwise on the first one it can run on
+	auto* cpu = &Processor::current();
+	if(!thread->can_run_on(cpu->id())) {
+		for(int i = 0; i < Processor::count(); i++) {
+			if(thread->can_run_on(i)) {
+				cpu = &Processor::get(i);
+				break;
+			}
+		}
+	}
+	cpu->run_queue.push(thread.get());
+	thread->stats_queued();
+
+	// If we're idle, switch to the thread once we're out of the interrupt that queued it
+	if(cpu == &Processor::current() && is_idle() && Interrupt::in_irq())
+		cpu->yield_async = true;
+}
+
+void TaskManager::dequeue_thread(Thread* thread) {
+	ASSERT(g_tasking_lock.held_by_current_thread());
+	// The thread might be queued on any processor
+	for(int i = 0; i < Processor::count(); i++)
+		Processor::get(i).run_queue.remove(thread);
 }
 
 void TaskManager::notify_current(uint32_t sig){
-	cur_thread->process()->kill(sig);
+	Processor::current().current_thread->process()->kill(sig);
 }
 
-kstd::Arc<Thread> TaskManager::pick_next_thread() {
+kstd::ArcRef<Thread> TaskManager::pick_next_thread() {
 	ASSERT(g_tasking_lock.held_by_current_thread());
 
-	// Make sure the next thread is in a runnable state
-	while(g_next_thread && !g_next_thread->can_be_run())
-		g_next_thread = g_next_thread->next_thread();
+	// Take the highest-priority thread that is in a runnable state. Threads that aren't runnable anymore are dropped
+	// from the queue, and will be queued again when they become runnable.
+	auto& cpu = Processor::current();
+	Thread* next;
+	while((next = cpu.run_queue.pop()) && !next->can_be_run());
 
 	// If we don't have a next thread to run, either continue running the current thread or run kidle
-	if(!g_next_thread) {
-		if(cur_thread->can_be_run()) {
-			return cur_thread;
-		} else if(kernel_process->get_thread(kernel_process->pid())->state() != Thread::ALIVE) {
+	if(!next) {
+		if(cpu.current_thread->can_be_run()) {
+			return cpu.current_thread;
+		} else if(kidle_thread->state() != Thread::ALIVE) {
 			PANIC("KTHREAD_DEADLOCK", "The kernel idle thread is blocked!");
 		} else {
-			return kernel_process->get_thread(kernel_process->pid());
+			return kidle_thread;
 		}
 	}
 
-	auto next = g_next_thread->self();
-	g_next_thread = g_next_thread->next_thread();
-	return next;
+	// Threads are only reaped with the tasking lock held, so there's no need to take a reference to it yet
+	return kstd::ArcRef<Thread>(next);
 }
 
 bool TaskManager::yield() {
-	ASSERT(!preempting);
-	quantum_counter = 0;
+	auto& cpu = Processor::current();
+	ASSERT(!cpu.preempting);
 	if(Interrupt::in_irq()) {
 		// We can't yield in an interrupt. Instead, we'll yield immediately after we exit the interrupt
-		yield_async = true;
+		cpu.yield_async = true;
 		return false;
 	} else {
+		// The current thread is giving up the rest of its quantum
+		cpu.quantum_counter = 0;
+		cpu.yield_voluntary = true;
 		preempt();
 		return true;
 	}
 }
 
 bool TaskManager::yield_if_not_preempting() {
-	if(!preempting)
+	if(!Processor::current().preempting)
 		return yield();
 	return true;
 }
@@ -261,71 +326,102 @@ bool TaskManager::yield_if_not_preempting() {
 bool TaskManager::yield_if_idle() {
 	if(!kernel_process)
 		return false;
-	if(cur_thread->tid() == kernel_process->pid())
+	if(is_idle())
 		return yield();
 	return false;
 }
 
 void TaskManager::do_yield_async() {
-	if(yield_async) {
-		yield_async = false;
+	auto& cpu = Processor::current();
+	if(cpu.yield_async) {
+		cpu.yield_async = false;
 		preempt();
 	}
 }
 
 void TaskManager::tick() {
 	ASSERT(Interrupt::in_irq());
+	auto& cpu = Processor::current();
+	if(cpu.quantum_counter)
+		cpu.quantum_counter--;
+
+	// Periodically boost every thread back to its base priority so that CPU-bound threads can't be starved forever
+	if(++boost_counter >= THREAD_PRIORITY_BOOST_TICKS) {
+		boost_counter = 0;
+		should_boost = true;
+	}
+
+	// Preempt after the interrupt. The current thread will keep running unless its quantum expired or a higher-priority
+	// thread is runnable.
 	yield();
 }
 
-Atomic<int, MemoryOrder::SeqCst> g_critical_count = 0;
-
 void TaskManager::enter_critical() {
 	asm volatile("cli");
-	g_critical_count.add(1);
+	Processor::current().critical_count.add(1);
 }
 
 void TaskManager::leave_critical() {
-	ASSERT(g_critical_count.load() > 0);
-	if(g_critical_count.sub(1) == 1)
+	auto& critical_count = Processor::current().critical_count;
+	ASSERT(critical_count.load() > 0);
+	if(critical_count.sub(1) == 1)
 		asm volatile("sti");
 }
 
 bool TaskManager::in_critical() {
-	return g_critical_count.load();
+	return Processor::current().critical_count.load();
 }
 
 void TaskManager::preempt(){
 	if(!tasking_enabled)
 		return;
-	ASSERT(!g_critical_count.load());
+	ASSERT(!in_critical());
 
 	g_tasking_lock.acquire_and_enter_critical();
-	cur_thread->enter_critical();
-	preempting = true;
-
-	// Try unblocking threads that are blocked
-	if(g_process_lock.try_acquire()) {
-		for(auto& process : *processes) {
-			if(process->state() != Process::ALIVE)
-				continue;
-			for(auto& tid : process->threads()) {
-				auto thread = process->get_thread(tid);
-				if(!thread)
-					continue;
-				if(thread->state() == Thread::BLOCKED && thread->should_unblock())
-					thread->unblock();
+	auto& cpu = Processor::current();
+	cpu.current_thread->enter_critical();
+	cpu.preempting = true;
+
+	if(should_boost) {
+		should_boost = false;
+		for(int i = 0; i < Processor::count(); i++)
+			Processor::get(i).run_queue.boost();
+	}
+
+	// Pick a new thread
+	auto old_thread = cpu.current_thread;
+	kstd::ArcRef<Thread> next_thread;
+	bool was_voluntary = cpu.yield_voluntary;
+	cpu.yield_voluntary = false;
+	if(old_thread->tid() != kernel_process->pid()) {
+		if(old_thread->can_be_run()) {
+			int highest_queued = cpu.run_queue.highest_priority();
+			if(cpu.quantum_counter && (highest_queued == -1 || highest_queued >= old_thread->priority())) {
+				// The old thread still has some of its quantum left and nothing more important is waiting
+				next_thread = old_thread;
+			} else {
+				// A thread that used up its entire quantum drops down a level
+				if(!cpu.quantum_counter && !was_voluntary)
+					old_thread->demote();
+				queue_thread(old_thread);
 			}
+		} else {
+			// A thread that blocked before using up its quantum is probably interactive, so it moves up a level
+			old_thread->promote();
 		}
-		g_process_lock.release();
 	}
 
-	// Pick a new thread
-	auto old_thread = cur_thread;
-	auto next_thread = pick_next_thread();
-	quantum_counter = 1; //Every process has a quantum of 1 for now
+	if(!next_thread) {
+		next_thread = pick_next_thread();
+		cpu.quantum_counter = RunQueue::quantum(next_thread->priority());
+	}
+	dequeue_thread(next_thread.get());
 
-	bool should_preempt = old_thread != next_thread;
+	bool should_preempt = old_thread.get() != next_thread.get();
+
+	// The periodic tick may have been stopped while we were idle
+	if(next_thread->tid() != kernel_process->pid())
+		TimeManager::resume_tick();
 
 	//If we were just in a signal handler, don't save the esp to old_proc->registers
 	unsigned int* old_esp;
@@ -356,31 +452,36 @@ void TaskManager::preempt(){
 	unsigned int* new_esp;
 	if(next_thread->in_signal_handler()) {
 		new_esp = &next_thread->signal_registers.esp;
-		tss.esp0 = (size_t) next_thread->signal_stack_top();
+		cpu.tss.esp0 = (size_t) next_thread->signal_stack_top();
 	} else {
 		new_esp = &next_thread->registers.esp;
-		tss.esp0 = (size_t) next_thread->kernel_stack_top();
+		cpu.tss.esp0 = (size_t) next_thread->kernel_stack_top();
 	}
 
 	if(should_preempt)
 		next_thread->process()->set_last_active_thread(next_thread->tid());
 
 	// Switch context.
-	preempting = false;
+	cpu.preempting = false;
 	if(!next_thread->can_be_run())
 		PANIC("INVALID_CONTEXT_SWITCH", "Tried to switch to thread %d of PID %d in state %d", next_thread->tid(), next_thread->process()->pid(), next_thread->state());
 	if(should_preempt) {
-		// If we can run the old thread, re-queue it after we preempt
-		if(old_thread->tid() != kernel_process->pid() && old_thread->can_be_run())
-			queue_thread(old_thread);
+		if(old_thread.get() != next_thread.get()) {
+			old_thread->stats_switched_out(was_voluntary || !old_thread->can_be_run());
+			next_thread->stats_switched_in();
+			SchedTrace::record(SCHED_TRACE_SWITCH, old_thread.get(), next_thread.get());
+			TRACE(TRACE_SCHED_SWITCH, next_thread->process()->pid(), next_thread->tid());
+		}
 
-		cur_thread = next_thread;
-		next_thread.reset();
+		cpu.current_thread = next_thread.arc();
+		next_thread = {};
 		old_thread.reset();
 
-		asm volatile("fxsave %0" : "=m"(cur_thread->fpu_state));
-		preempt_asm(old_esp, new_esp, cur_thread->page_directory()->entries_physaddr());
-		asm volatile("fxrstor %0" ::"m"(cur_thread->fpu_state));
+		// The FPU state is switched lazily the first time the new thread uses the FPU
+		FPU::switch_to(cpu.current_thread.get());
+		// The new thread's gs gets reloaded on the way back to userspace, which picks up its TLS segment from the GDT.
+		Memory::set_tls_base(cpu.current_thread->tls_base());
+		preempt_asm(old_esp, new_esp, cpu.current_thread->page_directory()->entries_physaddr());
 	}
 
 	preempt_finish();
@@ -391,6 +492,7 @@ void TaskManager::preempt_finish() {
 	g_tasking_lock.release();
 	leave_critical();
 	// Handle a pending signal.
+	auto& cur_thread = Processor::current().current_thread;
 	if(cur_thread->tid() != kernel_process->pid())
 		cur_thread->process()->handle_pending_signal();
 	cur_thread->leave_critical();
@@ -25,6 +25,9 @@
 #include <kernel/kstd/unix_types.h>
 #include "Thread.h"
 #include "Process.h"
+#include "RunQueue.h"
+#include "Processor.h"
+#include "ProcessTable.h"
 
 class Process;
 class Thread;
@@ -32,8 +35,6 @@ class SpinLock;
 struct TSS;
 
 namespace TaskManager {
-	extern TSS tss;
-
 	/** This lock is acquired while preempting to ensure that thread queues are in a valid state. This lock MUST be
 	 *  held prior to calling queue_thread or messing with the thread queue. You should use a ScopedCriticalLocker or
 	 *  the CRITICAL_LOCK macro to acquire g_tasking_lock and enter a critical state which will automatically be
@@ -44,11 +45,6 @@ namespace TaskManager {
 	/** This lock is acquired while editing the process list. **/
 	extern SpinLock g_process_lock;
 
-	/** This is the thread at the beginning of the thread queue. The thread queue is updated on calls to `queue_thread`
-	 *  and in Thread::reap (which ensures that the reaped thread is removed from the queue.
-	 */
-	extern Thread* g_next_thread;
-
 	void init();
 	bool enabled();
 	bool is_idle();
@@ -56,9 +52,13 @@ namespace TaskManager {
 	void reparent_orphans(Process* proc);
 
 	kstd::vector<Process*>* process_list();
+	/** The index of processes by pid, pgid, sid and ppid. Lookups should go through this instead of scanning
+	 *  process_list(). **/
+	ProcessTable& process_table();
 	int add_process(Process* proc);
 	void remove_process(Process* proc);
 	void queue_thread(const kstd::Arc<Thread>& thread);
+	void dequeue_thread(Thread* thread);
 	kstd::Arc<Thread>& current_thread();
 	Process* current_process();
 	ResultRet<Process*> process_for_pid(pid_t pid);
@@ -101,7 +101,8 @@ namespace TaskManager {
 	void notify_current(uint32_t sig);
 
 	pid_t get_new_pid();
-	kstd::Arc<Thread> pick_next_thread();
+	/// Picks the thread to run next. It's borrowed, and stays alive as long as g_tasking_lock is held.
+	kstd::ArcRef<Thread> pick_next_thread();
 
 
 	extern "C" void preempt();
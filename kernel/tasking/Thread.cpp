@@ -28,6 +28,11 @@
 #include <kernel/memory/SafePointer.h>
 #include "../memory/AnonymousVMObject.h"
 #include "Reaper.h"
+#include "FPU.h"
+#include "SchedTrace.h"
+#include <kernel/time/TimeManager.h>
+#include "../api/resource.h"
+#include <kernel/memory/gdt.h>
 
 Thread::Thread(Process* process, tid_t tid, size_t entry_point, ProcessArgs* args):
 	_tid(tid),
@@ -35,11 +40,14 @@ Thread::Thread(Process* process, tid_t tid, size_t entry_point, ProcessArgs* arg
 	m_vm_space(process->_vm_space),
 	m_page_directory(process->_page_directory)
 {
+	set_base_priority(priority_for_nice(process->nice()));
+	m_stats_in_kernel = is_kernel_mode();
+
 	//Create the kernel stack
-	_kernel_stack_region = MM.alloc_kernel_region(THREAD_KERNEL_STACK_SIZE);
+	_kernel_stack = KernelStack::alloc();
 	kstd::Arc<VMRegion> mapped_user_stack_region;
 	Stack user_stack(nullptr, 0);
-	Stack kernel_stack((void*) _kernel_stack_region->end());
+	Stack kernel_stack((void*) _kernel_stack.top());
 
 	if(!is_kernel_mode()) {
 		auto do_create_stack = [&]() -> Result {
@@ -53,7 +61,7 @@ Thread::Thread(Process* process, tid_t tid, size_t entry_point, ProcessArgs* arg
 
 		user_stack = Stack((void*) mapped_user_stack_region->end(), _stack_region->end());
 	} else {
-		user_stack = Stack((void*) _kernel_stack_region->end());
+		user_stack = Stack((void*) _kernel_stack.top());
 	}
 
 	//Setup registers
@@ -76,7 +84,7 @@ Thread::Thread(Process* process, tid_t tid, size_t entry_point, ProcessArgs* arg
 		registers.ds = 0x23; // ds
 		registers.es = 0x23; // es
 		registers.fs = 0x23; // fs
-		registers.gs = 0x23; // gs
+		registers.gs = GDT_TLS_SELECTOR; // gs
 	}
 
 	//Set up the user stack for the program arguments
@@ -96,12 +104,15 @@ Thread::Thread(Process* process, tid_t tid, Registers& regs):
 	m_vm_space(process->_vm_space),
 	m_page_directory(process->_page_directory)
 {
+	set_base_priority(priority_for_nice(process->nice()));
+	m_stats_in_kernel = false; // The child starts out returning from fork() to userspace
+
 	//Allocate kernel stack
-	_kernel_stack_region = MM.alloc_kernel_region(THREAD_KERNEL_STACK_SIZE);
+	_kernel_stack = KernelStack::alloc();
 
 	//Setup registers and stack
 	registers.eax = 0; // fork() in child returns zero
-	Stack stack((void*) (_kernel_stack_region->start() + _kernel_stack_region->size()));
+	Stack stack((void*) _kernel_stack.top());
 	setup_kernel_stack(stack, regs.useresp, registers);
 }
 
@@ -111,11 +122,12 @@ Thread::Thread(Process* process, tid_t tid, void* (*entry_func)(void* (*)(void*)
 	m_vm_space(process->_vm_space),
 	m_page_directory(process->_page_directory)
 {
+	set_base_priority(priority_for_nice(process->nice()));
 	//Create the kernel stack
-	_kernel_stack_region = MM.alloc_kernel_region(THREAD_KERNEL_STACK_SIZE);
+	_kernel_stack = KernelStack::alloc();
 	kstd::Arc<VMRegion> mapped_user_stack_region;
 	Stack user_stack(nullptr, 0);
-	Stack kernel_stack((void*) (_kernel_stack_region->end()));
+	Stack kernel_stack((void*) _kernel_stack.top());
 
 	if(!is_kernel_mode()) {
 		auto do_create_stack = [&]() -> Result {
@@ -130,7 +142,7 @@ Thread::Thread(Process* process, tid_t tid, void* (*entry_func)(void* (*)(void*)
 
 		user_stack = Stack((void*) mapped_user_stack_region->end(), _stack_region->end());
 	} else {
-		user_stack = Stack((void*) _kernel_stack_region->end());
+		user_stack = Stack((void*) _kernel_stack.top());
 	}
 
 	//Setup registers
@@ -153,7 +165,7 @@ Thread::Thread(Process* process, tid_t tid, void* (*entry_func)(void* (*)(void*)
 		registers.ds = 0x23; // ds
 		registers.es = 0x23; // es
 		registers.fs = 0x23; // fs
-		registers.gs = 0x23; // gs
+		registers.gs = GDT_TLS_SELECTOR; // gs
 	}
 
 	//Set up the user stack for the thread arguments
@@ -170,6 +182,11 @@ Thread::Thread(Process* process, tid_t tid, void* (*entry_func)(void* (*)(void*)
 
 Thread::~Thread() {
 	ASSERT(_state == DEAD);
+	FPU::forget(this);
+}
+
+uint8_t* Thread::fpu_state() {
+	return (uint8_t*) (((uintptr_t) m_fpu_storage + FPU_STATE_ALIGNMENT - 1) & ~(uintptr_t) (FPU_STATE_ALIGNMENT - 1));
 }
 
 Process* Thread::process() {
@@ -181,7 +198,7 @@ tid_t Thread::tid() {
 }
 
 void* Thread::kernel_stack_top() {
-	return (void*)(_kernel_stack_region->start() + _kernel_stack_region->size());
+	return (void*) _kernel_stack.top();
 }
 
 Thread::State Thread::state() {
@@ -263,10 +280,6 @@ void Thread::block(Blocker& blocker) {
 		PANIC("INVALID_BLOCK", "Tried to block thread %d of PID %d in state %s", _tid, _process->pid(), state_name());
 	ASSERT(!_blocker);
 
-	// Check if the blocker is already ready. If so, unblock immediately
-	if(blocker.is_ready())
-		return;
-
 	// Check for deadlock
 	// TODO: This will only detect if 2 threads are directly deadlocking each other. This will not detect deadlocks involving more than 2 threads.
 	if(blocker.responsible_thread()) {
@@ -281,22 +294,50 @@ void Thread::block(Blocker& blocker) {
 		}
 	}
 
+	// Start waiting on the blocker before checking if it's ready, so that we can't miss it becoming ready in between
 	{
 		TaskManager::ScopedCritical critical;
-		_state = BLOCKED;
 		_blocker = &blocker;
+		blocker.add_waiter(this);
+	}
+
+	// Check if the blocker is already ready. If so, don't block
+	if(blocker.is_ready()) {
+		TaskManager::ScopedCritical critical;
+		if(_blocker) {
+			blocker.remove_waiter(this);
+			_blocker = nullptr;
+		}
+		return;
+	}
+
+	{
+		TaskManager::ScopedCritical critical;
+		// If the blocker was notified since we started waiting, we were already unblocked
+		if(!_blocker)
+			return;
+		_state = BLOCKED;
+		m_blocked_since = TimeManager::uptime_us();
+		SchedTrace::record(SCHED_TRACE_BLOCK, this);
 	}
 
 	ASSERT(TaskManager::yield());
 }
 
 void Thread::unblock() {
+	TaskManager::ScopedCritical critical;
 	if(!_blocker)
 		return;
+	_blocker->remove_waiter(this);
 	_blocker = nullptr;
-	if(_state == BLOCKED)
+	if(_state == BLOCKED) {
 		_state = ALIVE;
-	{
+		if(m_blocked_since) {
+			m_sched_stats.last_blocked_time = TimeManager::uptime_us() - m_blocked_since;
+			m_sched_stats.blocked_time += m_sched_stats.last_blocked_time;
+			m_blocked_since = 0;
+		}
+		SchedTrace::record(SCHED_TRACE_WAKEUP, this);
 		CRITICAL_LOCK(TaskManager::g_tasking_lock);
 		TaskManager::queue_thread(self());
 	}
@@ -348,6 +389,10 @@ Result Thread::join(const kstd::Arc<Thread>& self_ptr, const kstd::Arc<Thread>&
 	return Result(SUCCESS);
 }
 
+WaitQueue& Thread::join_queue() {
+	return _join_queue;
+}
+
 void Thread::acquired_lock(SpinLock* lock) {
 	TaskManager::ScopedCritical crit;
 	if(_held_locks.size() == _held_locks.capacity())
@@ -402,12 +447,12 @@ bool Thread::call_signal_handler(int signal) {
 	auto k_ustack = MM.map_object(_sighandler_ustack_region->object());
 
 	//Allocate a kernel stack
-	if(!_sighandler_kstack_region)
-		_sighandler_kstack_region = MM.alloc_kernel_region(THREAD_KERNEL_STACK_SIZE);
+	if(!_sighandler_kstack)
+		_sighandler_kstack = KernelStack::alloc();
 
 	Stack user_stack((void*) k_ustack->end(), _sighandler_ustack_region->end());
-	Stack kernel_stack((void*) _sighandler_kstack_region->end());
-	_signal_stack_top = _sighandler_kstack_region->end();
+	Stack kernel_stack((void*) _sighandler_kstack.top());
+	_signal_stack_top = _sighandler_kstack.top();
 
 	//Push signal number and fake return address to the stack
 	user_stack.push_int(signal);
@@ -433,7 +478,7 @@ bool Thread::call_signal_handler(int signal) {
 		signal_registers.ds = 0x23; // ds
 		signal_registers.es = 0x23; // es
 		signal_registers.fs = 0x23; // fs
-		signal_registers.gs = 0x23; // gs
+		signal_registers.gs = GDT_TLS_SELECTOR; // gs
 	}
 
 	//Set up the stack
@@ -493,22 +538,127 @@ void Thread::handle_pagefault(PageFault fault) {
 	}
 }
 
-void Thread::enqueue_thread(Thread* thread) {
-	ASSERT(TaskManager::g_tasking_lock.held_by_current_thread());
-	if(thread == this)
-		return;
-	if(m_next) {
-		m_next->enqueue_thread(thread);
-	} else {
-		m_next = thread;
-		thread->m_prev = this;
+int Thread::priority() const {
+	return m_priority;
+}
+
+int Thread::base_priority() const {
+	return m_base_priority;
+}
+
+void Thread::set_base_priority(int priority) {
+	if(priority < THREAD_PRIORITY_MAX)
+		priority = THREAD_PRIORITY_MAX;
+	else if(priority > THREAD_PRIORITY_MIN)
+		priority = THREAD_PRIORITY_MIN;
+	m_base_priority = priority;
+	reset_priority();
+}
+
+void Thread::demote() {
+	if(m_priority < THREAD_PRIORITY_MIN)
+		m_priority++;
+}
+
+void Thread::promote() {
+	if(m_priority > m_base_priority)
+		m_priority--;
+}
+
+void Thread::reset_priority() {
+	m_priority = m_base_priority;
+}
+
+bool Thread::is_queued() const {
+	return m_queued_priority != -1;
+}
+
+uint32_t Thread::affinity() const {
+	return m_affinity;
+}
+
+void Thread::set_affinity(uint32_t affinity) {
+	m_affinity = affinity;
+}
+
+uintptr_t Thread::tls_base() const {
+	return m_tls_base;
+}
+
+void Thread::set_tls_base(uintptr_t base) {
+	m_tls_base = base;
+}
+
+bool Thread::can_run_on(int processor) const {
+	return (m_affinity >> processor) & 1;
+}
+
+int Thread::priority_for_nice(int nice) {
+	if(nice < PRIO_MIN)
+		nice = PRIO_MIN;
+	else if(nice >= PRIO_MAX)
+		nice = PRIO_MAX - 1;
+
+	// Round away from the default so that every non-zero nice value moves a thread at least one level, and the
+	// extremes map onto the highest and lowest levels
+	if(nice < 0) {
+		int levels = THREAD_PRIORITY_DEFAULT - THREAD_PRIORITY_MAX;
+		return THREAD_PRIORITY_DEFAULT - (-nice * levels - PRIO_MIN - 1) / -PRIO_MIN;
+	}
+	int levels = THREAD_PRIORITY_MIN - THREAD_PRIORITY_DEFAULT;
+	return THREAD_PRIORITY_DEFAULT + (nice * levels + PRIO_MAX - 2) / (PRIO_MAX - 1);
+}
+
+const Thread::SchedStats& Thread::sched_stats() const {
+	return m_sched_stats;
+}
+
+void Thread::stats_queued() {
+	if(!m_runnable_since)
+		m_runnable_since = TimeManager::uptime_us();
+}
+
+void Thread::stats_switched_in() {
+	auto now = TimeManager::uptime_us();
+	if(m_runnable_since) {
+		auto waited = now - m_runnable_since;
+		m_sched_stats.runnable_time += waited;
+		if(waited > m_sched_stats.max_runnable_time)
+			m_sched_stats.max_runnable_time = waited;
+		m_runnable_since = 0;
 	}
+	m_running_since = now;
 }
 
-Thread* Thread::next_thread() {
-	auto next = m_next;
-	m_next = nullptr;
-	return next;
+void Thread::stats_switched_out(bool voluntary) {
+	auto now = TimeManager::uptime_us();
+	if(m_running_since) {
+		if(m_stats_in_kernel)
+			m_sched_stats.kernel_time += now - m_running_since;
+		else
+			m_sched_stats.user_time += now - m_running_since;
+		m_running_since = 0;
+	}
+	if(voluntary)
+		m_sched_stats.voluntary_switches++;
+	else
+		m_sched_stats.involuntary_switches++;
+}
+
+void Thread::stats_enter_kernel() {
+	auto now = TimeManager::uptime_us();
+	if(m_running_since)
+		m_sched_stats.user_time += now - m_running_since;
+	m_running_since = now;
+	m_stats_in_kernel = true;
+}
+
+void Thread::stats_leave_kernel() {
+	auto now = TimeManager::uptime_us();
+	if(m_running_since)
+		m_sched_stats.kernel_time += now - m_running_since;
+	m_running_since = now;
+	m_stats_in_kernel = false;
 }
 
 void Thread::setup_kernel_stack(Stack& kernel_stack, size_t user_stack_ptr, Registers& regs) {
@@ -555,11 +705,10 @@ void Thread::exit(void* return_value) {
 
 void Thread::reap() {
 	_process->alert_thread_died(self());
-	TaskManager::ScopedCritical critical;
-	if(TaskManager::g_next_thread == this)
-		TaskManager::g_next_thread = m_next;
-	if(m_prev && m_prev->m_next == this)
-		m_prev->m_next = m_next;
-	if(m_next)
-		m_next->m_prev = this;
+	CRITICAL_LOCK(TaskManager::g_tasking_lock);
+	TaskManager::dequeue_thread(this);
+	if(_blocker) {
+		_blocker->remove_waiter(this);
+		_blocker = nullptr;
+	}
 }
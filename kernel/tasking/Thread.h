@@ -26,9 +26,14 @@
 #include <kernel/Result.hpp>
 #include "kernel/memory/VMRegion.h"
 #include "SpinLock.h"
+#include "RunQueue.h"
+#include "WaitQueue.h"
+#include "FPU.h"
 #include "../memory/PageDirectory.h"
 #include "../kstd/queue.hpp"
 #include "kernel/kstd/circular_queue.hpp"
+#include "../memory/SlabCache.h"
+#include "../memory/KernelStack.h"
 
 #define THREAD_STACK_SIZE 1048576 //1024KiB
 #define THREAD_KERNEL_STACK_SIZE 524288 //512KiB
@@ -37,7 +42,8 @@ class Process;
 class Blocker;
 class ProcessArgs;
 template<typename T> class UserspacePointer;
-class Thread: public kstd::ArcSelf<Thread> {
+class Thread: public kstd::ArcIntrusive<Thread> {
+	SLAB_ALLOCATED(Thread)
 public:
 	enum State {
 		ALIVE = 0,
@@ -46,6 +52,18 @@ public:
 		BLOCKED = 3
 	};
 
+	/// Statistics kept by the scheduler about a thread. All times are in microseconds.
+	struct SchedStats {
+		uint64_t user_time = 0;
+		uint64_t kernel_time = 0;
+		uint64_t runnable_time = 0; // Time spent runnable but waiting for a processor
+		uint64_t max_runnable_time = 0;
+		uint64_t blocked_time = 0;
+		uint64_t last_blocked_time = 0;
+		uint32_t voluntary_switches = 0;
+		uint32_t involuntary_switches = 0;
+	};
+
 	Thread(Process* process, tid_t tid, size_t entry_point, ProcessArgs* args);
 	Thread(Process* process, tid_t tid, Registers& regs);
 	Thread(Process* process, tid_t tid, void* (*entry_func)(void* (*)(void*), void*), void* (*thread_func)(void*), void* arg);
@@ -76,6 +94,7 @@ public:
 	bool is_blocked();
 	bool should_unblock();
 	Result join(const kstd::Arc<Thread>& self_ptr, const kstd::Arc<Thread>& other, UserspacePointer<void*> retp);
+	WaitQueue& join_queue();
 	void acquired_lock(SpinLock* lock);
 	void released_lock(SpinLock* lock);
 
@@ -90,17 +109,43 @@ public:
 	//Misc
 	void handle_pagefault(PageFault fault);
 
-	//Thread queue
-	void enqueue_thread(Thread* thread);
-	Thread* next_thread();
-
-	uint8_t fpu_state[512] __attribute__((aligned(16)));
+	//Scheduling
+	[[nodiscard]] int priority() const;
+	[[nodiscard]] int base_priority() const;
+	void set_base_priority(int priority);
+	void demote();
+	void promote();
+	void reset_priority();
+	[[nodiscard]] bool is_queued() const;
+	[[nodiscard]] uint32_t affinity() const;
+	void set_affinity(uint32_t affinity);
+	[[nodiscard]] bool can_run_on(int processor) const;
+	/// The base priority level that threads with the given nice value run at.
+	static int priority_for_nice(int nice);
+
+	//Scheduler statistics
+	[[nodiscard]] const SchedStats& sched_stats() const;
+	void stats_queued();
+	void stats_switched_in();
+	void stats_switched_out(bool voluntary);
+	void stats_enter_kernel();
+	void stats_leave_kernel();
+
+	/// The base of the thread's user TLS segment (its thread pointer), which is loaded into the GDT when it's switched to.
+	[[nodiscard]] uintptr_t tls_base() const;
+	void set_tls_base(uintptr_t base);
+
+	/// The area the thread's FPU state is saved to when another thread takes over the FPU. See FPU.h.
+	uint8_t* fpu_state();
+	bool fpu_initialized = false;
 	Registers registers = {};
 	Registers signal_registers = {};
 
 private:
 	friend class Process;
 	friend class Reaper;
+	friend class RunQueue;
+	friend class Blocker;
 
 	void setup_kernel_stack(Stack& kernel_stack, size_t user_stack_ptr, Registers& regs);
 	void exit(void* return_value);
@@ -114,16 +159,23 @@ private:
 	int _in_critical = 1; // _in_critical starts as 1 since we leave critical after the first preemption
 	bool _waiting_to_die = false;
 
+	// Threads aren't necessarily allocated with the alignment the FPU save instructions need, so the state is stored at
+	// the first suitably aligned address in this buffer
+	uint8_t m_fpu_storage[FPU_STATE_SIZE + FPU_STATE_ALIGNMENT] = {0};
+
 	//Memory
 	kstd::Arc<VMSpace> m_vm_space;
 	kstd::Arc<PageDirectory> m_page_directory;
 
 	//Stack
-	kstd::Arc<VMRegion> _kernel_stack_region;
+	KernelStack _kernel_stack;
 	kstd::Arc<VMRegion> _stack_region;
 
 	//Blocking and Joining
 	Blocker* _blocker = nullptr;
+	Thread* m_next_waiter = nullptr;
+	Thread* m_prev_waiter = nullptr;
+	WaitQueue _join_queue;
 	bool _joined = false;
 	SpinLock _join_lock;
 	kstd::Arc<Thread> _joined_thread;
@@ -135,10 +187,23 @@ private:
 	bool _just_finished_signal = false;
 	size_t _signal_stack_top = 0;
 	kstd::Arc<VMRegion> _sighandler_ustack_region;
-	kstd::Arc<VMRegion> _sighandler_kstack_region;
-
-	// Thread queue
+	KernelStack _sighandler_kstack;
+
+	//Scheduling
+	int m_priority = THREAD_PRIORITY_DEFAULT;
+	int m_base_priority = THREAD_PRIORITY_DEFAULT;
+	int m_queued_priority = -1;
+	uint32_t m_affinity = THREAD_AFFINITY_ALL;
+	uint32_t m_boost_epoch = 0;
+	uintptr_t m_tls_base = 0;
 	Thread* m_next = nullptr;
 	Thread* m_prev = nullptr;
+
+	//Scheduler statistics
+	SchedStats m_sched_stats;
+	uint64_t m_runnable_since = 0;
+	uint64_t m_running_since = 0;
+	uint64_t m_blocked_since = 0;
+	bool m_stats_in_kernel = true;
 };
 
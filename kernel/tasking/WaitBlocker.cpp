@@ -22,8 +22,9 @@
 #include "Thread.h"
 #include "Process.h"
 
-WaitBlocker::WaitBlocker(kstd::Arc<Thread> thread, pid_t wait_for) {
+WaitBlocker::WaitBlocker(kstd::Arc<Thread> thread, pid_t wait_for): m_entry(this) {
 	_thread = thread;
+	_thread->process()->child_wait_queue().add(m_entry);
 	_wait_pid = wait_for;
 	if(_wait_pid < -1) {
 		//Any child with pgid |pid|
@@ -39,20 +40,21 @@ WaitBlocker::WaitBlocker(kstd::Arc<Thread> thread, pid_t wait_for) {
 
 bool WaitBlocker::is_ready() {
 	bool found_one = false;
+	bool found_zombie = false;
 
-	auto* procs = TaskManager::process_list();
-	for(int i = 0; i < procs->size(); i++) {
-		auto proc = procs->at(i);
-		if(proc->ppid() == _thread->process()->pid()) {
-			found_one = true;
-			if((_wait_pgid == -1 || proc->pgid() == _wait_pgid) && (_wait_pid == -1 || proc->pid() == _wait_pid) && proc->state() == Process::ZOMBIE) {
-				_wait_pid = proc->pid();
-				_exit_status = proc->exit_status();
-				_waited_process = proc;
-				return true;
-			}
+	TaskManager::process_table().for_each(ProcessTable::PPID, _thread->process()->pid(), [&](Process* proc) {
+		found_one = true;
+		if(found_zombie)
+			return;
+		if((_wait_pgid == -1 || proc->pgid() == _wait_pgid) && (_wait_pid == -1 || proc->pid() == _wait_pid) && proc->state() == Process::ZOMBIE) {
+			_wait_pid = proc->pid();
+			_exit_status = proc->exit_status();
+			_waited_process = proc;
+			found_zombie = true;
 		}
-	}
+	});
+	if(found_zombie)
+		return true;
 
 	if(!found_one)
 		_err = -ECHILD;
@@ -22,6 +22,7 @@
 #include "Blocker.h"
 #include <kernel/kstd/unix_types.h>
 #include <kernel/kstd/Arc.h>
+#include "WaitQueue.h"
 
 class Thread;
 class WaitBlocker: public Blocker {
@@ -41,5 +42,6 @@ private:
 	pid_t _wait_pid;
 	pid_t _wait_pgid;
 	kstd::Arc<Thread> _thread;
+	WaitQueue::Entry m_entry;
 };
 
@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "WaitQueue.h"
+#include "Blocker.h"
+#include "TaskManager.h"
+
+WaitQueue::Entry::~Entry() {
+	if(m_queue)
+		m_queue->remove(*this);
+}
+
+WaitQueue::~WaitQueue() {
+	TaskManager::ScopedCritical critical;
+	while(m_head)
+		remove(*m_head);
+}
+
+void WaitQueue::add(Entry& entry) {
+	TaskManager::ScopedCritical critical;
+	if(entry.m_queue)
+		entry.m_queue->remove(entry);
+	entry.m_queue = this;
+	entry.m_next = nullptr;
+	entry.m_prev = m_tail;
+	if(m_tail)
+		m_tail->m_next = &entry;
+	else
+		m_head = &entry;
+	m_tail = &entry;
+}
+
+void WaitQueue::remove(Entry& entry) {
+	TaskManager::ScopedCritical critical;
+	if(entry.m_queue != this)
+		return;
+	if(entry.m_prev)
+		entry.m_prev->m_next = entry.m_next;
+	else
+		m_head = entry.m_next;
+	if(entry.m_next)
+		entry.m_next->m_prev = entry.m_prev;
+	else
+		m_tail = entry.m_prev;
+	entry.m_queue = nullptr;
+	entry.m_next = nullptr;
+	entry.m_prev = nullptr;
+}
+
+void WaitQueue::wake() {
+	TaskManager::ScopedCritical critical;
+	auto* entry = m_head;
+	while(entry) {
+		auto* next = entry->m_next;
+		if(entry->m_callback)
+			entry->m_callback(entry->m_data);
+		else if(entry->m_blocker)
+			entry->m_blocker->notify();
+		entry = next;
+	}
+}
+
+void WaitQueue::wake_one() {
+	TaskManager::ScopedCritical critical;
+	auto* entry = m_head;
+	while(entry) {
+		auto* next = entry->m_next;
+		//Callbacks don't count as waking a thread up, since we can't tell if they did
+		if(entry->m_callback)
+			entry->m_callback(entry->m_data);
+		else if(entry->m_blocker && entry->m_blocker->notify())
+			return;
+		entry = next;
+	}
+}
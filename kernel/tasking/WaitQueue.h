@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+class Blocker;
+
+/**
+ * A list of blockers that are waiting for some event to happen. When the event happens, wake() should be called so
+ * that each blocker in the queue can wake up its waiting threads if it is now ready.
+ *
+ * Entries are owned by the blocker that is waiting, so adding and removing entries never allocates and is safe to do
+ * in interrupt context.
+ */
+class WaitQueue {
+public:
+	class Entry {
+	public:
+		Entry() = default;
+		explicit Entry(Blocker* blocker): m_blocker(blocker) {}
+		Entry(const Entry& other): m_blocker(other.m_blocker), m_callback(other.m_callback), m_data(other.m_data) {}
+		~Entry();
+
+		void set_blocker(Blocker* blocker) { m_blocker = blocker; }
+		/// Calls a function instead of notifying a blocker when woken up, for things that watch lots of queues at once.
+		/// The function is called in a critical section, and possibly in interrupt context.
+		void set_callback(void (*callback)(void* data), void* data) { m_callback = callback; m_data = data; }
+		[[nodiscard]] bool is_queued() const { return m_queue; }
+
+	private:
+		friend class WaitQueue;
+		Blocker* m_blocker = nullptr;
+		void (*m_callback)(void* data) = nullptr;
+		void* m_data = nullptr;
+		WaitQueue* m_queue = nullptr;
+		Entry* m_next = nullptr;
+		Entry* m_prev = nullptr;
+	};
+
+	WaitQueue() = default;
+	WaitQueue(const WaitQueue& other) = delete;
+	~WaitQueue();
+
+	void add(Entry& entry);
+	void remove(Entry& entry);
+	/// Notifies every blocker in the queue that the event it's waiting on may have happened.
+	void wake();
+	/// Notifies blockers in the order they were added until one of them wakes a thread up.
+	void wake_one();
+	[[nodiscard]] bool empty() const { return !m_head; }
+
+private:
+	Entry* m_head = nullptr;
+	Entry* m_tail = nullptr;
+};
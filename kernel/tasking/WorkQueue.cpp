@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "WorkQueue.h"
+#include "TaskManager.h"
+#include "Thread.h"
+
+static WorkQueue s_system_queue;
+
+void kworker_entry() {
+	// Deferred work is usually the rest of an interrupt handler, so it shouldn't have to wait behind other threads
+	TaskManager::current_thread()->set_base_priority(THREAD_PRIORITY_MAX);
+	WorkQueue::system().run();
+}
+
+WorkQueue& WorkQueue::system() {
+	return s_system_queue;
+}
+
+void WorkQueue::queue(Work& work) {
+	{
+		CRITICAL_LOCK(m_lock);
+		if(work.m_queued)
+			return;
+		work.m_queued = true;
+		work.m_next = nullptr;
+		if(m_tail)
+			m_tail->m_next = &work;
+		else
+			m_head = &work;
+		m_tail = &work;
+	}
+	m_blocker.set_ready(true);
+}
+
+void WorkQueue::run() {
+	while(1) {
+		// Clear the blocker before checking the queue so that work queued while we're busy isn't missed
+		m_blocker.set_ready(false);
+		while(1) {
+			Function function;
+			void* data;
+			{
+				CRITICAL_LOCK(m_lock);
+				auto* work = m_head;
+				if(!work)
+					break;
+				m_head = work->m_next;
+				if(!m_head)
+					m_tail = nullptr;
+				// Unmark it before running, so anything that comes in while it runs queues it again
+				work->m_queued = false;
+				function = work->m_function;
+				data = work->m_data;
+			}
+			function(data);
+		}
+		TaskManager::current_thread()->block(m_blocker);
+	}
+}
@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "BooleanBlocker.h"
+#include "SpinLock.h"
+
+void kworker_entry();
+
+/**
+ * Runs deferred work on a kernel thread. Interrupt handlers should only do what has to be done right away (acknowledging
+ * the device and grabbing its data), and queue the rest here, so that slow work doesn't hold up other interrupts.
+ */
+class WorkQueue {
+public:
+	typedef void (*Function)(void* data);
+
+	/**
+	 * A piece of work that can be queued. It doesn't allocate, so it can be queued from an interrupt handler, and queueing
+	 * it again before it runs does nothing.
+	 */
+	class Work {
+	public:
+		Work(Function function, void* data): m_function(function), m_data(data) {}
+		Work(const Work& other) = delete;
+
+	private:
+		friend class WorkQueue;
+		Function m_function;
+		void* m_data;
+		Work* m_next = nullptr;
+		bool m_queued = false;
+	};
+
+	/// The queue run by the kworker thread.
+	static WorkQueue& system();
+
+	/// Queues work to be run. Safe to call from an interrupt handler.
+	void queue(Work& work);
+
+protected:
+	friend void kworker_entry();
+	void run();
+
+private:
+	SpinLock m_lock;
+	BooleanBlocker m_blocker;
+	Work* m_head = nullptr;
+	Work* m_tail = nullptr;
+};
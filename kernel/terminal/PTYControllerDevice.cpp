@@ -20,8 +20,9 @@
 #include "PTYDevice.h"
 #include "PTYControllerDevice.h"
 #include <kernel/api/ioctl.h>
+#include <kernel/CommandLine.h>
 
-PTYControllerDevice::PTYControllerDevice(unsigned int id): CharacterDevice(300, id), _output_buffer(8192) {
+PTYControllerDevice::PTYControllerDevice(unsigned int id): CharacterDevice(300, id), _output_buffer(buffer_size()) {
 	_pty = (new PTYDevice(id, shared_ptr()))->shared_ptr();
 	_buffer_blocker.set_ready(true);
 }
@@ -31,21 +32,33 @@ ssize_t PTYControllerDevice::write(FileDescriptor& fd, size_t offset, SafePointe
 	LOCK_N(_ref_lock, ref_locker);
 	if(!_pty)
 		return 0;
-	int off = 0;
-	while(count--)
-		_pty->emit(buffer.get(off++));
+
+	//Emit in chunks, so that the PTY can take them all at once in raw mode
+	uint8_t chunk[256];
+	size_t written = 0;
+	while(written < count) {
+		size_t nchunk = min(count - written, sizeof(chunk));
+		buffer.read(chunk, written, nchunk);
+		_pty->emit(chunk, nchunk);
+		written += nchunk;
+	}
 	return count;
 }
 
 ssize_t PTYControllerDevice::read(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
 	LOCK(_output_lock);
+	uint8_t chunk[256];
+	size_t nread = 0;
 	count = min(count, _output_buffer.size());
-	size_t count_loop = count;
-	int off = 0;
-	while(count_loop--)
-		buffer.set(off++, _output_buffer.pop_front());
-	_buffer_blocker.set_ready(_output_buffer.empty());
-	return count;
+	while(nread < count) {
+		size_t nchunk = _output_buffer.pop_front(chunk, min(count - nread, sizeof(chunk)));
+		buffer.write(chunk, nread, nchunk);
+		nread += nchunk;
+	}
+
+	//There's space for writers now
+	_buffer_blocker.set_ready(true);
+	return nread;
 }
 
 bool PTYControllerDevice::is_pty_controller() {
@@ -76,33 +89,30 @@ int PTYControllerDevice::ioctl(unsigned int request, SafePointer<void*> argp) {
 }
 
 size_t PTYControllerDevice::putchars(const uint8_t* buffer, size_t count) {
-	if(count > _output_buffer.capacity())
-		return -ENOSPC;
-
-	// Acquire lock and wait for space in buffer
-	while(true) {
+	//Put in as much as there's space for at a time, waiting for the reader to make more space as needed
+	size_t written = 0;
+	while(written < count) {
 		_output_lock.acquire();
-		if(_output_buffer.capacity() - _output_buffer.size() < count) {
+		if(_output_buffer.size() == _output_buffer.capacity()) {
+			_buffer_blocker.set_ready(false);
 			_output_lock.release();
 			TaskManager::current_thread()->block(_buffer_blocker);
 			if(_buffer_blocker.was_interrupted())
-				return -EINTR;
-		} else {
-			break;
+				return written ? written : -EINTR;
+			continue;
 		}
-	}
-
-	size_t count_loop = count;
-	while(count_loop--)
-		_output_buffer.push_back(*(buffer++));
 
-	_output_lock.release();
+		written += _output_buffer.push_back(buffer + written, count - written);
+		_output_lock.release();
+		m_poll_queue.wake();
+	}
 
 	return count;
 }
 
 void PTYControllerDevice::notify_pty_closed() {
 	_pty = kstd::Arc<PTYDevice>(nullptr);
+	m_poll_queue.wake();
 }
 
 void PTYControllerDevice::ref_inc() {
@@ -123,3 +133,13 @@ void PTYControllerDevice::ref_dec() {
 kstd::Arc<PTYDevice> PTYControllerDevice::pty() {
 	return _pty;
 }
+
+size_t PTYControllerDevice::buffer_size() {
+	auto& size_opt = CommandLine::inst().get_option_value("pty_buffer_size");
+	if(size_opt.length()) {
+		int size = atoi(size_opt.c_str());
+		if(size > 0)
+			return size;
+	}
+	return PTY_DEFAULT_BUFFER_SIZE;
+}
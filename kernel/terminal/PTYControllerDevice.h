@@ -24,6 +24,8 @@
 #include <kernel/tasking/SpinLock.h>
 #include <kernel/kstd/Arc.h>
 
+#define PTY_DEFAULT_BUFFER_SIZE 16384
+
 class PTYDevice;
 class PTYControllerDevice: public CharacterDevice {
 public:
@@ -43,6 +45,9 @@ public:
 	void ref_dec();
 	kstd::Arc<PTYDevice> pty();
 
+	/// The size of the buffers on each side of a PTY, which can be set with the pty_buffer_size kernel option.
+	static size_t buffer_size();
+
 private:
 	SpinLock _output_lock, _write_lock, _ref_lock;
 	kstd::circular_queue<uint8_t> _output_buffer;
@@ -21,7 +21,7 @@
 #include "PTYControllerDevice.h"
 #include <kernel/filesystem/ptyfs/PTYFS.h>
 
-PTYDevice::PTYDevice(unsigned int id, const kstd::Arc<PTYControllerDevice>& controller): TTYDevice(301, id), _controller(controller) {
+PTYDevice::PTYDevice(unsigned int id, const kstd::Arc<PTYControllerDevice>& controller): TTYDevice(301, id, PTYControllerDevice::buffer_size()), _controller(controller) {
 	char numbuf[10];
 	itoa(id, numbuf, 10);
 	_name = kstd::string("/dev/pts/") + numbuf;
@@ -23,7 +23,8 @@
 #include <kernel/tasking/Signal.h>
 #include <kernel/api/ioctl.h>
 
-TTYDevice::TTYDevice(unsigned int major, unsigned int minor): CharacterDevice(major, minor), _input_buffer(1024) {
+TTYDevice::TTYDevice(unsigned int major, unsigned int minor, size_t input_buffer_size):
+	CharacterDevice(major, minor), _input_buffer(input_buffer_size) {
 	_termios.c_iflag = 0;
 	_termios.c_oflag = 0;
 	_termios.c_cflag = 0;
@@ -45,18 +46,17 @@ ssize_t TTYDevice::write(FileDescriptor &fd, size_t offset, SafePointer<uint8_t>
 
 ssize_t TTYDevice::read(FileDescriptor &fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) {
 	LOCK(_input_lock);
-	//Block until there's something to read
-	while(!_buffer_blocker.is_ready()) {
-		TaskManager::current_thread()->block(_buffer_blocker);
-		if(_buffer_blocker.was_interrupted())
-			return -EINTR;
-	}
-
 	size_t nread = 0;
 
-	count = min(count, _input_buffer.size());
 	if(_termios.c_lflag & ICANON) {
-		//Canonical mode
+		//Canonical mode. Block until there's a line to read.
+		while(!_buffer_blocker.is_ready()) {
+			TaskManager::current_thread()->block(_buffer_blocker);
+			if(_buffer_blocker.was_interrupted())
+				return -EINTR;
+		}
+
+		count = min(count, _input_buffer.size());
 		for(nread = 0; nread < count; nread++) {
 			char c = _input_buffer.pop_front();
 			if(c == '\n' || c == _termios.c_cc[VEOL]) {
@@ -75,13 +75,39 @@ ssize_t TTYDevice::read(FileDescriptor &fd, size_t offset, SafePointer<uint8_t>
 		//If we read all the lines or the buffer is empty, set the buffer blocker to not ready
 		_buffer_blocker.set_ready(_lines && !_input_buffer.empty());
 	} else {
-		//Non-canonical mode
-		while(count--) {
-			buffer.set(nread, _input_buffer.pop_front());
-			nread++;
+		//Non-canonical mode. Wait for VMIN characters (or fewer, if that's all that was asked for), for at most VTIME
+		//tenths of a second. With both set, the timer starts once the first character comes in rather than being reset
+		//by each one. With neither set, don't wait at all.
+		cc_t vmin = _termios.c_cc[VMIN];
+		cc_t vtime = _termios.c_cc[VTIME];
+		size_t wanted = (vmin || vtime) ? max(min(count, (size_t) vmin), (size_t) 1) : 0;
+		Time timeout = Time(vtime / 10, (vtime % 10) * 100000);
+		Time deadline = (vtime && !vmin) ? Time::now() + timeout : Time::distant_future();
+		while(_input_buffer.size() < wanted) {
+			if(vtime && vmin && !_input_buffer.empty() && deadline == Time::distant_future())
+				deadline = Time::now() + timeout;
+
+			//Only get woken up once there's enough to read, or a character to start the timer with
+			_read_threshold = (vtime && vmin && _input_buffer.empty()) ? 1 : wanted;
+			_buffer_blocker.set_ready(_input_buffer.size() >= _read_threshold);
+			_buffer_blocker.set_deadline(deadline);
+			TaskManager::current_thread()->block(_buffer_blocker);
+			_buffer_blocker.set_deadline(Time::distant_future());
+			if(_buffer_blocker.was_interrupted())
+				return -EINTR;
+			if(Time::now() >= deadline)
+				break;
+		}
+
+		uint8_t chunk[256];
+		count = min(count, _input_buffer.size());
+		while(nread < count) {
+			size_t nchunk = _input_buffer.pop_front(chunk, min(count - nread, sizeof(chunk)));
+			buffer.write(chunk, nread, nchunk);
+			nread += nchunk;
 		}
 
-		//If we read all the data, set the buffer blocker to not ready
+		_read_threshold = 1;
 		_buffer_blocker.set_ready(!_input_buffer.empty());
 	}
 
@@ -115,6 +141,7 @@ void TTYDevice::emit(uint8_t c) {
 			_input_buffer.push_back('\0');
 			_lines++;
 			_buffer_blocker.set_ready(true);
+			m_poll_queue.wake();
 			return;
 		}
 		if(c == '\n' || c == _termios.c_cc[VEOL]) {
@@ -139,16 +166,26 @@ void TTYDevice::emit(uint8_t c) {
 	}
 
 	_input_buffer.push_back(c);
-
-	if(!(_termios.c_lflag & ICANON))
-		_buffer_blocker.set_ready(true);
+	input_added();
 
 	if(_termios.c_lflag & ECHO)
 		echo(c);
 }
 
+void TTYDevice::emit(const uint8_t* buffer, size_t count) {
+	//In raw mode, nothing needs to look at each character, so they can all go straight into the buffer
+	if(_termios.c_lflag & (ICANON | ISIG | ECHO)) {
+		for(size_t i = 0; i < count; i++)
+			emit(buffer[i]);
+		return;
+	}
+
+	_input_buffer.push_back(buffer, count);
+	input_added();
+}
+
 bool TTYDevice::can_read(const FileDescriptor& fd) {
-	return _termios.c_lflag & ICANON ? _lines : _input_buffer.empty();
+	return _termios.c_lflag & ICANON ? _lines : _input_buffer.size() >= min_input();
 }
 
 bool TTYDevice::can_write(const FileDescriptor& fd) {
@@ -201,6 +238,24 @@ int TTYDevice::ioctl(unsigned int request, SafePointer<void*> argp) {
 	}
 }
 
+void TTYDevice::input_added() {
+	//Only wake up readers and pollers once there's enough for them to read
+	if(_termios.c_lflag & ICANON) {
+		if(_lines)
+			m_poll_queue.wake();
+		return;
+	}
+
+	if(_input_buffer.size() >= _read_threshold)
+		_buffer_blocker.set_ready(true);
+	if(_input_buffer.size() >= min_input())
+		m_poll_queue.wake();
+}
+
+size_t TTYDevice::min_input() {
+	return max((size_t) _termios.c_cc[VMIN], (size_t) 1);
+}
+
 void TTYDevice::generate_signal(int sig) {
 	if(_pgid == 0)
 		return;
@@ -234,3 +289,15 @@ bool TTYDevice::erase() {
 		return false;
 	}
 }
+
+bool TTYDevice::InputBlocker::is_ready() {
+	return BooleanBlocker::is_ready() || Time::now() >= _deadline;
+}
+
+void TTYDevice::InputBlocker::set_deadline(Time deadline) {
+	_deadline = deadline;
+	if(deadline == Time::distant_future())
+		clear_timeout();
+	else
+		set_timeout(deadline);
+}
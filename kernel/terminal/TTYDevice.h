@@ -26,10 +26,11 @@
 #include "../api/termios.h"
 
 #define NUM_TTYS 8
+#define TTY_DEFAULT_INPUT_BUFFER_SIZE 1024
 
 class TTYDevice: public CharacterDevice {
 public:
-	TTYDevice(unsigned major, unsigned minor);
+	TTYDevice(unsigned major, unsigned minor, size_t input_buffer_size = TTY_DEFAULT_INPUT_BUFFER_SIZE);
 
 	//Device
 	ssize_t write(FileDescriptor& fd, size_t offset, SafePointer<uint8_t> buffer, size_t count) override;
@@ -40,12 +41,25 @@ public:
 
 	bool is_tty() override;
 	void emit(uint8_t c);
+	/// Emits a buffer of characters. In raw mode, this skips the line discipline and puts them all in at once.
+	void emit(const uint8_t* buffer, size_t count);
 	virtual void echo(uint8_t c) = 0;
 	virtual size_t tty_write(const uint8_t* buffer, size_t count) = 0;
 
 private:
+	/// A BooleanBlocker that also becomes ready at a deadline, for VTIME.
+	class InputBlocker: public BooleanBlocker {
+	public:
+		bool is_ready() override;
+		void set_deadline(Time deadline);
+
+	private:
+		Time _deadline = Time::distant_future();
+	};
+
 	kstd::circular_queue<uint8_t> _input_buffer;
-	BooleanBlocker _buffer_blocker;
+	InputBlocker _buffer_blocker;
+	size_t _read_threshold = 1; ///< How many characters a non-canonical read is waiting for before it wakes up
 	SpinLock _input_lock;
 	pid_t _pgid = -1;
 	termios _termios;
@@ -53,6 +67,8 @@ private:
 	int _lines = 0;
 
 	void generate_signal(int sig);
+	void input_added();
+	size_t min_input();
 	bool backspace();
 	bool erase();
 };
@@ -68,6 +68,9 @@ void VirtualTTY::clear() {
 }
 
 void VirtualTTY::set_graphical(bool graphical) {
+	//Whatever's drawing graphics expects the display to start at the top of the framebuffer
+	if(graphical && !_graphical)
+		VGADevice::inst().reset_scroll();
 	_graphical = graphical;
 }
 
@@ -78,7 +81,7 @@ Term::Terminal* VirtualTTY::get_terminal() {
 int VirtualTTY::ioctl(unsigned int request, SafePointer<void*> argp) {
 	switch(request) {
 		case TIOSGFX:
-			_graphical = true;
+			set_graphical(true);
 			return SUCCESS;
 		case TIOSNOGFX:
 			_graphical = false;
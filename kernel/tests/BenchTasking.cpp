@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "KernelTest.h"
+#include "../tasking/TaskManager.h"
+#include "../tasking/Process.h"
+#include "../tasking/Thread.h"
+#include "../tasking/BooleanBlocker.h"
+
+static BooleanBlocker s_ping;
+static BooleanBlocker s_pong;
+static volatile bool s_pong_done;
+
+static void pong_entry() {
+	while(true) {
+		TaskManager::current_thread()->block(s_ping);
+		s_ping.set_ready(false);
+		if(s_pong_done)
+			TaskManager::current_thread()->kill();
+		s_pong.set_ready(true);
+	}
+}
+
+KERNEL_BENCH(context_switch_round_trip) {
+	// Each iteration wakes up another thread and waits for it to wake us back up, so it's two context switches
+	s_ping.set_ready(false);
+	s_pong.set_ready(false);
+	s_pong_done = false;
+	{
+		CRITICAL_LOCK(TaskManager::g_tasking_lock);
+		TaskManager::current_process()->spawn_kernel_thread(pong_entry);
+	}
+
+	while(bench.iterate()) {
+		s_pong.set_ready(false);
+		s_ping.set_ready(true);
+		TaskManager::current_thread()->block(s_pong);
+	}
+
+	s_pong_done = true;
+	s_ping.set_ready(true);
+}
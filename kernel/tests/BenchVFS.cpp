@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "KernelTest.h"
+#include "../filesystem/VFS.h"
+#include "../User.h"
+
+KERNEL_BENCH(vfs_resolve_path) {
+	auto root = VFS::inst().root_ref();
+	auto user = User::root();
+	while(bench.iterate()) {
+		if(VFS::inst().resolve_path("/bin/init", root, user).is_error())
+			break;
+	}
+}
@@ -17,6 +17,11 @@ bool KernelTestRegistry::register_test(const KernelTest& test) {
 	return true;
 }
 
+bool KernelTestRegistry::register_bench(const KernelBenchmark& bench) {
+	m_benchmarks.push_back(bench);
+	return true;
+}
+
 void KernelTestRegistry::run_tests() {
 	KLog::info("KernelTests", "Running kernel tests...");
 	int n_pass = 0;
@@ -39,4 +44,100 @@ void KernelTestRegistry::run_tests() {
 	} else {
 		KLog::err("KernelTests", "Finished tests with errors: (%d/%d passed)", n_pass, m_tests.size());
 	}
-}
\ No newline at end of file
+}
+
+void KernelTestRegistry::run_benchmarks() {
+	KLog::info("KernelBench", "Running kernel benchmarks...");
+
+	// Time an empty loop first, so the cost of timing each iteration can be taken out of the results
+	KernelBench empty(KERNEL_BENCH_ITERATIONS);
+	while(empty.iterate());
+	auto overhead = empty.fastest();
+
+	for(size_t i = 0; i < m_benchmarks.size(); i++) {
+		auto& benchmark = m_benchmarks[i];
+		KernelBench bench(KERNEL_BENCH_ITERATIONS);
+		benchmark.func(bench);
+		if(!bench.num_samples()) {
+			KLog::warn("KernelBench", "%s: No iterations were run", benchmark.name);
+			continue;
+		}
+		bench.subtract_overhead(overhead);
+		KLog::info("KernelBench", "%s: min %d median %d p99 %d cycles (%d iterations)", benchmark.name,
+				   (int) bench.fastest(), (int) bench.median(), (int) bench.p99(), (int) bench.num_samples());
+	}
+
+	KLog::success("KernelBench", "Finished benchmarks! (Timing overhead: %d cycles)", (int) overhead);
+}
+
+static inline uint64_t read_tsc() {
+	uint32_t low, high;
+	asm volatile("rdtsc" : "=a"(low), "=d"(high));
+	return ((uint64_t) high << 32) | low;
+}
+
+KernelBench::KernelBench(size_t iterations): m_iterations(iterations) {
+	m_samples.reserve(iterations);
+}
+
+bool KernelBench::iterate() {
+	auto now = read_tsc();
+	if(m_running)
+		m_samples.push_back(now - m_start);
+	m_running = m_samples.size() < m_iterations;
+	// Read the TSC again so that storing the sample isn't counted
+	m_start = read_tsc();
+	return m_running;
+}
+
+void KernelBench::pause() {
+	m_paused_at = read_tsc();
+}
+
+void KernelBench::resume() {
+	m_start += read_tsc() - m_paused_at;
+}
+
+void KernelBench::set_iterations(size_t iterations) {
+	ASSERT(m_samples.empty());
+	m_iterations = iterations;
+	m_samples.reserve(iterations);
+}
+
+uint64_t KernelBench::fastest() {
+	sort();
+	return m_samples.empty() ? 0 : m_samples[0];
+}
+
+uint64_t KernelBench::median() {
+	sort();
+	return m_samples.empty() ? 0 : m_samples[m_samples.size() / 2];
+}
+
+uint64_t KernelBench::p99() {
+	sort();
+	return m_samples.empty() ? 0 : m_samples[(m_samples.size() * 99) / 100];
+}
+
+void KernelBench::subtract_overhead(uint64_t cycles) {
+	for(size_t i = 0; i < m_samples.size(); i++)
+		m_samples[i] = m_samples[i] > cycles ? m_samples[i] - cycles : 0;
+}
+
+void KernelBench::sort() {
+	if(m_sorted)
+		return;
+	m_sorted = true;
+
+	// Shell sort, which is plenty for a few thousand samples
+	size_t size = m_samples.size();
+	for(size_t gap = size / 2; gap > 0; gap /= 2) {
+		for(size_t i = gap; i < size; i++) {
+			auto sample = m_samples[i];
+			size_t j = i;
+			for(; j >= gap && m_samples[j - gap] > sample; j -= gap)
+				m_samples[j] = m_samples[j - gap];
+			m_samples[j] = sample;
+		}
+	}
+}
@@ -11,6 +11,23 @@
 	static bool __didRegister_test##name = KernelTestRegistry::inst().register_test({#name, __test_##name}); \
 	void __test_##name()
 
+// How many times a benchmark's loop runs, unless it picks a different number
+#define KERNEL_BENCH_ITERATIONS 1000
+
+/**
+ * Defines a benchmark, which is run when the kernel is booted with kernel-bench=true. The body loops on
+ * bench.iterate(), and every pass through the loop is timed separately:
+ *
+ *     KERNEL_BENCH(thing) {
+ *         while(bench.iterate())
+ *             do_thing();
+ *     }
+ */
+#define KERNEL_BENCH(name) \
+	void __bench_##name(KernelBench& bench); \
+	static bool __didRegister_bench##name = KernelTestRegistry::inst().register_bench({#name, __bench_##name}); \
+	void __bench_##name(KernelBench& bench)
+
 #define ENSURE(...) KernelTestRegistry::inst().ensure(__FILE__, __LINE__, __VA_ARGS__)
 #define ENSURE_EQ(...) KernelTestRegistry::inst().ensure_eq(__FILE__, __LINE__, __VA_ARGS__)
 
@@ -20,12 +37,53 @@ struct KernelTest {
 	TestFunc func;
 } __attribute__((aligned(8)));
 
+/** Times the iterations of a benchmark in TSC cycles. **/
+class KernelBench {
+public:
+	explicit KernelBench(size_t iterations);
+
+	/// Finishes timing the last iteration and starts timing the next one. Returns false once they've all run.
+	bool iterate();
+	/// Stops the clock for work in an iteration that shouldn't be counted, like setting up the next one.
+	void pause();
+	void resume();
+	/// Changes how many iterations are run. Must be called before the first call to iterate().
+	void set_iterations(size_t iterations);
+
+	/// The fastest, median, and 99th percentile iteration, in cycles.
+	uint64_t fastest();
+	uint64_t median();
+	uint64_t p99();
+	size_t num_samples() const { return m_samples.size(); }
+	/// Takes a number of cycles off of every sample, for the overhead of timing them.
+	void subtract_overhead(uint64_t cycles);
+
+private:
+	void sort();
+
+	kstd::vector<uint64_t> m_samples;
+	size_t m_iterations;
+	uint64_t m_start = 0;
+	uint64_t m_paused_at = 0;
+	bool m_running = false;
+	bool m_sorted = false;
+};
+
+typedef void (*BenchFunc)(KernelBench& bench);
+struct KernelBenchmark {
+	const char* name;
+	BenchFunc func;
+} __attribute__((aligned(8)));
+
 class KernelTestRegistry {
 public:
 	static KernelTestRegistry& inst();
 	bool register_test(const KernelTest& test);
+	bool register_bench(const KernelBenchmark& bench);
 
 	void run_tests();
+	/// Runs every benchmark and logs how long their iterations took, for comparing against a baseline.
+	void run_benchmarks();
 
 	inline void ensure(const char* file_name, int line_no, bool assertion) {
 		if(!assertion) {
@@ -53,6 +111,7 @@ public:
 private:
 	static KernelTestRegistry* m_instance;
 	kstd::vector<KernelTest> m_tests;
+	kstd::vector<KernelBenchmark> m_benchmarks;
 	KernelTest* m_current_test = nullptr;
 	bool m_passing = true;
 };
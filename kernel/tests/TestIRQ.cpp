@@ -0,0 +1,21 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "KernelTest.h"
+#include "../interrupt/irq.h"
+
+KERNEL_TEST(msi_irq_alloc) {
+	int first = Interrupt::irq_alloc_msi();
+	if(first < 0)
+		return; // No local APIC to deliver them to
+	int second = Interrupt::irq_alloc_msi();
+	ENSURE(Interrupt::irq_is_msi(first), "Allocated MSI IRQ is a legacy IRQ");
+	ENSURE(second != first, "The same MSI IRQ was allocated twice");
+
+	// A freed IRQ should be handed out again
+	Interrupt::irq_free_msi(first);
+	int third = Interrupt::irq_alloc_msi();
+	ENSURE_EQ(third, first);
+	Interrupt::irq_free_msi(second);
+	Interrupt::irq_free_msi(third);
+}
@@ -0,0 +1,93 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "KernelTest.h"
+#include "../memory/MemoryManager.h"
+#include "../random.h"
+
+#define BENCH_BUFFER_SIZE (1024 * 1024)
+
+KERNEL_TEST(memcpy_memset_sizes) {
+	auto src_region = MM.alloc_kernel_region(BENCH_BUFFER_SIZE);
+	auto dest_region = MM.alloc_kernel_region(BENCH_BUFFER_SIZE);
+	auto* src = (uint8_t*) src_region->start();
+	auto* dest = (uint8_t*) dest_region->start();
+	for(size_t i = 0; i < BENCH_BUFFER_SIZE; i++)
+		src[i] = rand();
+
+	// Try both sides of each size cutoff, with the source and destination misaligned
+	size_t sizes[] = {0, 1, 3, 31, 32, 33, 255, 4096, 4099, 256 * 1024 - 1, 256 * 1024 + 5};
+	for(auto size : sizes) {
+		size_t src_offset = rand() % 4, dest_offset = rand() % 4;
+		memset(dest, 0xAA, size + 8);
+		memcpy(dest + dest_offset, src + src_offset, size);
+		bool matches = true;
+		for(size_t i = 0; i < size; i++)
+			matches &= dest[dest_offset + i] == src[src_offset + i];
+		ENSURE(matches, "memcpy copied the wrong data");
+		ENSURE(dest[dest_offset + size] == 0xAA, "memcpy copied too much");
+
+		memset(dest + dest_offset, 0x5C, size);
+		bool filled = true;
+		for(size_t i = 0; i < size; i++)
+			filled &= dest[dest_offset + i] == 0x5C;
+		ENSURE(filled, "memset didn't fill everything");
+		ENSURE(dest[dest_offset + size] == 0xAA, "memset filled too much");
+	}
+
+	memcpy_page(dest, src);
+	bool page_matches = true;
+	for(size_t i = 0; i < PAGE_SIZE; i++)
+		page_matches &= dest[i] == src[i];
+	ENSURE(page_matches, "memcpy_page copied the wrong data");
+	memzero_page_nontemporal(dest);
+	bool zeroed = true;
+	for(size_t i = 0; i < PAGE_SIZE; i++)
+		zeroed &= !dest[i];
+	ENSURE(zeroed, "memzero_page_nontemporal didn't zero the page");
+}
+
+// Every copy in a benchmark reuses the same two buffers, so the smaller sizes are measured with a warm cache
+static uint8_t* bench_src;
+static uint8_t* bench_dest;
+
+static void alloc_bench_buffers(kstd::Arc<VMRegion>& src_region, kstd::Arc<VMRegion>& dest_region) {
+	src_region = MM.alloc_kernel_region(BENCH_BUFFER_SIZE);
+	dest_region = MM.alloc_kernel_region(BENCH_BUFFER_SIZE);
+	bench_src = (uint8_t*) src_region->start();
+	bench_dest = (uint8_t*) dest_region->start();
+	memset(bench_src, 1, BENCH_BUFFER_SIZE);
+	memset(bench_dest, 0, BENCH_BUFFER_SIZE);
+}
+
+#define MEMCPY_BENCH(size) \
+	KERNEL_BENCH(memcpy_##size) { \
+		kstd::Arc<VMRegion> src_region, dest_region; \
+		alloc_bench_buffers(src_region, dest_region); \
+		while(bench.iterate()) \
+			memcpy(bench_dest, bench_src, size); \
+	} \
+	KERNEL_BENCH(memset_##size) { \
+		kstd::Arc<VMRegion> src_region, dest_region; \
+		alloc_bench_buffers(src_region, dest_region); \
+		while(bench.iterate()) \
+			memset(bench_dest, 0x5C, size); \
+	}
+
+MEMCPY_BENCH(16)
+MEMCPY_BENCH(64)
+MEMCPY_BENCH(512)
+MEMCPY_BENCH(4096)
+MEMCPY_BENCH(65536)
+MEMCPY_BENCH(1048576)
+
+KERNEL_BENCH(memcpy_page) {
+	kstd::Arc<VMRegion> src_region, dest_region;
+	alloc_bench_buffers(src_region, dest_region);
+	size_t num_pages = BENCH_BUFFER_SIZE / PAGE_SIZE;
+	size_t page = 0;
+	while(bench.iterate()) {
+		memcpy_page(bench_dest + page * PAGE_SIZE, bench_src + page * PAGE_SIZE);
+		page = (page + 1) % num_pages;
+	}
+}
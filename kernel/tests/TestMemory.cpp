@@ -2,6 +2,11 @@
 /* Copyright © 2016-2022 Byteduck */
 #include "KernelTest.h"
 #include "../memory/PageDirectory.h"
+#include "../memory/MemoryManager.h"
+#include "../memory/VMSpace.h"
+#include "../memory/AnonymousVMObject.h"
+#include "../memory/KernelStack.h"
+#include "../kstd/kstdlib.h"
 #include "../random.h"
 
 #define NUM_REGIONS 100
@@ -23,4 +28,94 @@ KERNEL_TEST(allocate_and_free_regions) {
 		regions[i].reset();
 		ENSURE(!MM.kernel_page_directory.is_mapped(start, true));
 	}
-}
\ No newline at end of file
+}
+
+KERNEL_TEST(kernel_stack_cache) {
+	auto stack = KernelStack::alloc();
+	auto top = stack.top();
+	ENSURE(MM.kernel_page_directory.is_mapped(top - PAGE_SIZE, true));
+	ENSURE(!MM.kernel_page_directory.is_mapped(stack.start() - PAGE_SIZE, false));
+
+	// A released stack should stay mapped in the cache and be the next one handed out
+	bool will_cache = KernelStack::num_cached() < KERNEL_STACK_CACHE_SIZE;
+	stack.release();
+	ENSURE(!stack);
+	if(will_cache) {
+		ENSURE(MM.kernel_page_directory.is_mapped(top - PAGE_SIZE, true));
+		auto reused = KernelStack::alloc();
+		ENSURE_EQ(reused.top(), top);
+	}
+}
+
+KERNEL_TEST(zero_page_cow) {
+	auto object = AnonymousVMObject::alloc_lazy(PAGE_SIZE * 2);
+	ENSURE(object->make_swappable().is_success());
+	LOCK(object->lock());
+
+	// Reading an untouched page shouldn't allocate anything
+	ENSURE(object->page_in_for_read(0).is_success());
+	ENSURE_EQ(object->physical_page(0).index(), MM.zero_page());
+	ENSURE(object->page_is_cow(0));
+
+	// Writing to it should give it a page of its own, still full of zeroes
+	auto page = object->page_for_write(0);
+	ENSURE(!page.is_error());
+	ENSURE(page.value() != MM.zero_page());
+	ENSURE(!object->page_is_cow(0));
+	MM.with_quickmapped(page.value(), [&](void* ptr) {
+		for(size_t i = 0; i < PAGE_SIZE / sizeof(uint32_t); i++)
+			ENSURE_EQ(((uint32_t*) ptr)[i], 0u);
+	});
+}
+
+KERNEL_TEST(resident_stats) {
+	PageDirectory directory;
+	auto space = kstd::make_shared<VMSpace>(PAGE_SIZE, HIGHER_HALF - PAGE_SIZE, directory);
+	auto object = AnonymousVMObject::alloc(PAGE_SIZE * 3);
+	ENSURE(!object.is_error());
+	auto region = space->map_object(object.value(), VMProt::RW);
+	ENSURE(!region.is_error());
+	ENSURE_EQ(space->resident_stats().anonymous, 3);
+	ENSURE_EQ(space->resident_stats().total(), 3);
+	ENSURE_EQ(space->calculate_pss(), PAGE_SIZE * 3);
+
+	// Unmapping part of the region or all of it should take its pages off again
+	directory.unmap(*region.value(), VirtualRange { 0, PAGE_SIZE });
+	ENSURE_EQ(space->resident_stats().anonymous, 2);
+	region.value().reset();
+	ENSURE_EQ(space->resident_stats().total(), 0);
+}
+
+KERNEL_BENCH(physical_page_alloc_free) {
+	// Goes through the buddy allocator of whichever zone the page comes from
+	while(bench.iterate()) {
+		auto page = MM.alloc_physical_page();
+		if(page.is_error())
+			break;
+		MM.free_physical_page(page.value());
+	}
+}
+
+#define KMALLOC_BENCH(size) \
+	KERNEL_BENCH(kmalloc_##size) { \
+		while(bench.iterate()) \
+			kfree(kmalloc(size)); \
+	}
+
+KMALLOC_BENCH(16)
+KMALLOC_BENCH(256)
+KMALLOC_BENCH(4096)
+KMALLOC_BENCH(65536)
+
+KERNEL_BENCH(anonymous_page_fault) {
+	// Faulting from the kernel panics, so call the fault handler directly. This leaves out the cost of the trap itself.
+	constexpr size_t num_pages = 256;
+	auto region = MM.map_object(AnonymousVMObject::alloc_lazy(num_pages * PAGE_SIZE));
+	bench.set_iterations(num_pages);
+	size_t page = 0;
+	while(bench.iterate()) {
+		auto res = MM.kernel_space()->try_pagefault({region->start() + (page++) * PAGE_SIZE, 0, PageFault::Type::Write});
+		if(res.is_error())
+			break;
+	}
+}
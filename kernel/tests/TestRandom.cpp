@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "KernelTest.h"
+#include "../random.h"
+
+KERNEL_TEST(chacha20_block) {
+	// The test vector from section 2.3.2 of RFC 7539
+	uint32_t key[8];
+	for(uint32_t i = 0; i < 8; i++)
+		key[i] = (i * 4) | ((i * 4 + 1) << 8) | ((i * 4 + 2) << 16) | ((i * 4 + 3) << 24);
+	const uint32_t nonce[3] = {0x09000000, 0x4a000000, 0x00000000};
+	const uint32_t expected[16] = {
+		0xe4e7f110, 0x15593bd1, 0x1fdd0f50, 0xc47120a3,
+		0xc7f4d1c7, 0x0368c033, 0x9aaa2204, 0x4e6cd4c3,
+		0x466482d2, 0x09aa9f07, 0x05d7c214, 0xa2028bd9,
+		0xd19c12b5, 0xb94e16de, 0xe883d0cb, 0x4e3c50a2
+	};
+	uint32_t out[16];
+	chacha20_block(key, 1, nonce, out);
+	for(int i = 0; i < 16; i++)
+		ENSURE_EQ(out[i], expected[i]);
+}
+
+KERNEL_TEST(get_random_bytes) {
+	// Two reads should never come out the same, and a read shouldn't write past the end of the buffer
+	uint8_t first[100], second[100];
+	memset(first, 0, sizeof(first));
+	memset(second, 0, sizeof(second));
+	get_random_bytes(KernelPointer<uint8_t>(first), 99);
+	get_random_bytes(KernelPointer<uint8_t>(second), 99);
+	bool same = true;
+	for(int i = 0; i < 99; i++)
+		same &= first[i] == second[i];
+	ENSURE(!same, "get_random_bytes returned the same bytes twice");
+	ENSURE(first[99] == 0 && second[99] == 0, "get_random_bytes wrote too much");
+}
+
+KERNEL_BENCH(get_random_bytes_4096) {
+	static uint8_t buffer[4096];
+	while(bench.iterate())
+		get_random_bytes(KernelPointer<uint8_t>(buffer), sizeof(buffer));
+}
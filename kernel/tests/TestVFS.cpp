@@ -0,0 +1,32 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "KernelTest.h"
+#include "../filesystem/VFS.h"
+#include "../filesystem/procfs/ProcFS.h"
+#include "../User.h"
+
+KERNEL_TEST(vfs_mounts) {
+	auto root = VFS::inst().root_ref();
+	auto user = User::root();
+
+	// Looking up a mountpoint should give the root of what's mounted on it
+	auto proc_or_err = VFS::inst().resolve_path("/proc", root, user);
+	ENSURE(!proc_or_err.is_error(), "Couldn't resolve /proc");
+	if(!proc_or_err.is_error())
+		ENSURE_EQ(proc_or_err.value()->inode()->fs.fsid(), PROCFS_FSID);
+
+	// Everything else on the root filesystem isn't a mountpoint
+	auto bin_or_err = VFS::inst().resolve_path("/bin", root, user);
+	ENSURE(!bin_or_err.is_error(), "Couldn't resolve /bin");
+	if(!bin_or_err.is_error())
+		ENSURE(VFS::inst().get_mount(bin_or_err.value()).is_error(), "/bin was a mountpoint");
+
+	// Every mount should be found from its mountpoint
+	for(auto& mount : VFS::inst().get_mounts()) {
+		auto found = VFS::inst().get_mount(mount.host_inode());
+		ENSURE(!found.is_error(), "A mount couldn't be found from its mountpoint");
+		if(!found.is_error())
+			ENSURE(found.value().guest_fs() == mount.guest_fs(), "The wrong mount was found for a mountpoint");
+	}
+}
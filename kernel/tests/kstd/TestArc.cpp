@@ -118,4 +118,44 @@ KERNEL_TEST(arc_assignment) {
 
 	arc2.reset();
 	ENSURE_EQ(TestClass::num_alloced, 0);
-}
\ No newline at end of file
+}
+class IntrusiveTestClass: public kstd::ArcIntrusive<IntrusiveTestClass> {
+public:
+	static int num_alloced;
+
+	IntrusiveTestClass() {
+		num_alloced++;
+	}
+
+	~IntrusiveTestClass() {
+		num_alloced--;
+	}
+};
+
+int IntrusiveTestClass::num_alloced = 0;
+
+KERNEL_TEST(arc_intrusive) {
+	IntrusiveTestClass::num_alloced = 0;
+	auto* raw_ptr = new IntrusiveTestClass();
+	Arc<IntrusiveTestClass> arc(raw_ptr);
+	auto* ref_count = arc.ref_count();
+	ENSURE(ref_count->is_intrusive());
+	ENSURE_EQ(ref_count->strong_count(), 1);
+
+	// Wrapping the raw pointer again should share the count instead of making a new one
+	Arc<IntrusiveTestClass> arc2(raw_ptr);
+	ENSURE_EQ(arc2.ref_count(), ref_count);
+	ENSURE_EQ(ref_count->strong_count(), 2);
+
+	kstd::ArcRef<IntrusiveTestClass> borrowed(raw_ptr);
+	ENSURE_EQ(ref_count->strong_count(), 2);
+	auto self = borrowed->self();
+	ENSURE_EQ(ref_count->strong_count(), 3);
+
+	Weak<IntrusiveTestClass> weak = arc;
+	arc.reset();
+	arc2.reset();
+	self.reset();
+	ENSURE_EQ(IntrusiveTestClass::num_alloced, 0);
+	ENSURE(!weak.lock());
+}
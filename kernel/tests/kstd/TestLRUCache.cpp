@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "../KernelTest.h"
+#include <kernel/kstd/LRUCache.h>
+#include <kernel/random.h>
+
+using IntCache = kstd::LRUCache<size_t, int>;
+
+KERNEL_TEST(lru_cache_insert_get) {
+	IntCache cache;
+	for(size_t i = 0; i < 1000; i++)
+		cache.insert(i * 8, (int) i);
+	ENSURE_EQ(cache.size(), 1000);
+	for(size_t i = 0; i < 1000; i++) {
+		auto item = cache.get(i * 8);
+		ENSURE(item);
+		if(item)
+			ENSURE_EQ(item.value(), (int) i);
+	}
+	ENSURE(!cache.get(1));
+	cache.insert(8, 42);
+	ENSURE_EQ(cache.size(), 1000);
+	ENSURE_EQ(cache.get(8).value(), 42);
+}
+
+KERNEL_TEST(lru_cache_order) {
+	IntCache cache;
+	for(size_t i = 0; i < 100; i++)
+		cache.insert(i, (int) i);
+
+	// Using an item should move it to the back of the line, but checking whether it's there shouldn't
+	cache.get(0);
+	cache.promote(1);
+	ENSURE(cache.contains(2));
+	ENSURE(!cache.contains(100));
+	ENSURE_EQ(cache.lru_unsafe().first, 2);
+	cache.prune(98);
+	ENSURE_EQ(cache.size(), 2);
+	ENSURE_EQ(cache.lru_unsafe().first, 0);
+	cache.erase(0);
+	ENSURE_EQ(cache.lru_unsafe().first, 1);
+	cache.erase(1);
+	ENSURE(cache.empty());
+	ENSURE(!cache.lru());
+}
+
+KERNEL_TEST(lru_cache_prune_if) {
+	IntCache cache;
+	for(size_t i = 0; i < 100; i++)
+		cache.insert(i, (int) i);
+	auto num_pruned = cache.prune_if(10, [](size_t key, int& value) { return key % 2; });
+	ENSURE_EQ(num_pruned, 10);
+	ENSURE_EQ(cache.size(), 90);
+	for(size_t i = 0; i < 20; i++)
+		ENSURE_EQ((bool) cache.get(i), !(i % 2));
+	ENSURE(cache.get(21));
+}
+
+KERNEL_BENCH(lru_cache_hit) {
+	IntCache cache;
+	constexpr size_t num_items = 10000;
+	for(size_t i = 0; i < num_items; i++)
+		cache.insert(i * 8, (int) i);
+	// Pick the keys ahead of time so that rand() isn't timed along with the lookups
+	size_t keys[KERNEL_BENCH_ITERATIONS];
+	for(auto& key : keys)
+		key = (rand() % num_items) * 8;
+	size_t i = 0;
+	while(bench.iterate())
+		cache.get(keys[i++ % KERNEL_BENCH_ITERATIONS]);
+}
@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "../KernelTest.h"
+#include <kernel/kstd/LZ4.h>
+#include <kernel/kstd/vector.hpp>
+#include <kernel/random.h>
+
+static bool round_trips(kstd::vector<uint8_t>& data, size_t& compressed_size) {
+	kstd::vector<uint8_t> compressed(data.size() + data.size() / 255 + 16);
+	kstd::vector<uint8_t> decompressed(data.size());
+	compressed_size = kstd::LZ4::compress(data.storage(), data.size(), compressed.storage(), compressed.size());
+	if(!compressed_size)
+		return false;
+	auto size = kstd::LZ4::decompress(compressed.storage(), compressed_size, decompressed.storage(), decompressed.size());
+	if(size != (ssize_t) data.size())
+		return false;
+	for(size_t i = 0; i < data.size(); i++) {
+		if(data[i] != decompressed[i])
+			return false;
+	}
+	return true;
+}
+
+KERNEL_TEST(lz4_round_trip) {
+	srand(1234);
+	size_t compressed_size;
+	const size_t sizes[] = {0, 1, 12, 13, 100, 4096, 10000};
+	for(size_t size : sizes) {
+		kstd::vector<uint8_t> random(size), repetitive(size), sparse(size);
+		for(size_t i = 0; i < size; i++) {
+			random[i] = (uint8_t) rand();
+			repetitive[i] = (uint8_t) (i % 37);
+			sparse[i] = rand() % 16 ? 0 : (uint8_t) rand();
+		}
+		ENSURE(round_trips(random, compressed_size));
+		ENSURE(round_trips(repetitive, compressed_size));
+		if(size >= 4096)
+			ENSURE(compressed_size < size / 8);
+		ENSURE(round_trips(sparse, compressed_size));
+	}
+}
+
+KERNEL_TEST(lz4_limits) {
+	// Compressing into too small of a buffer should fail rather than overrun it
+	kstd::vector<uint8_t> data(4096);
+	for(size_t i = 0; i < data.size(); i++)
+		data[i] = (uint8_t) rand();
+	kstd::vector<uint8_t> compressed(4096);
+	ENSURE_EQ(kstd::LZ4::compress(data.storage(), data.size(), compressed.storage(), compressed.size()), 0);
+
+	// And malformed input or a small output buffer should fail decompression
+	for(auto& byte : data)
+		byte = 0;
+	size_t size = kstd::LZ4::compress(data.storage(), data.size(), compressed.storage(), compressed.size());
+	ENSURE(size);
+	kstd::vector<uint8_t> decompressed(4096);
+	ENSURE_EQ(kstd::LZ4::decompress(compressed.storage(), size, decompressed.storage(), 4095), -1);
+	ENSURE_EQ(kstd::LZ4::decompress(compressed.storage(), size - 1, decompressed.storage(), decompressed.size()), -1);
+}
@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "../KernelTest.h"
+#include <kernel/kstd/lockfree_queue.hpp>
+
+template<typename Queue>
+static void test_queue_wraparound(Queue& queue) {
+	int value;
+	ENSURE(queue.empty());
+	ENSURE(!queue.pop(value));
+
+	// Go around the ring a few times, filling it all the way up each time
+	for(int lap = 0; lap < 4; lap++) {
+		for(int i = 0; i < (int) queue.capacity(); i++)
+			ENSURE(queue.push(lap * 100 + i));
+		ENSURE(!queue.push(-1));
+		for(int i = 0; i < (int) queue.capacity(); i++) {
+			ENSURE(queue.pop(value));
+			ENSURE_EQ(value, lap * 100 + i);
+		}
+		ENSURE(queue.empty());
+	}
+}
+
+KERNEL_TEST(spsc_queue_wraparound) {
+	kstd::spsc_queue<int, 16> queue;
+	test_queue_wraparound(queue);
+}
+
+KERNEL_TEST(mpsc_queue_wraparound) {
+	kstd::mpsc_queue<int, 16> queue;
+	test_queue_wraparound(queue);
+}
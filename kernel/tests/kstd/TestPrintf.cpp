@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "../KernelTest.h"
+#include <kernel/kstd/kstdio.h>
+#include <kernel/kstd/cstring.h>
+
+KERNEL_TEST(snprintf) {
+	char buf[16];
+	ENSURE_EQ(snprintf(buf, sizeof(buf), "%s %d %x %c%%", "abc", -12, 0xbeef, 'z'), (size_t) 15);
+	ENSURE(strcmp(buf, "abc -12 beef z%"));
+
+	// Output that doesn't fit is cut off, but the full length is still returned
+	ENSURE_EQ(snprintf(buf, 8, "%s", "0123456789"), (size_t) 10);
+	ENSURE(strcmp(buf, "0123456"));
+	ENSURE_EQ(snprintf(buf, 0, "%d", 1234), (size_t) 4);
+}
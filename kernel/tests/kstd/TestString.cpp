@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "../KernelTest.h"
+#include <kernel/kstd/string.h>
+#include <kernel/kstd/utility.h>
+
+KERNEL_TEST(string_inline_and_heap) {
+	kstd::string short_str("short");
+	kstd::string long_str("a string that's too long to fit inside of itself");
+	ENSURE_EQ(short_str.length(), 5);
+	ENSURE(short_str == "short");
+	ENSURE(long_str == "a string that's too long to fit inside of itself");
+
+	// Moving should leave the old strings empty, whether they were stored inline or not
+	kstd::string moved_short(kstd::move(short_str));
+	kstd::string moved_long(kstd::move(long_str));
+	ENSURE(moved_short == "short");
+	ENSURE(moved_long.length() == 48);
+	ENSURE(!short_str.length() && !long_str.length());
+
+	kstd::string appended;
+	for(int i = 0; i < 40; i++)
+		appended += "x";
+	ENSURE_EQ(appended.length(), 40);
+	appended += appended;
+	ENSURE_EQ(appended.length(), 80);
+	ENSURE(kstd::string("ab") + "cd" == "abcd");
+}
+
+KERNEL_TEST(string_view_substrings) {
+	kstd::string path("/usr/bin/sh");
+	kstd::string_view view = path;
+	ENSURE_EQ(view.find('/', 1), 4);
+	ENSURE_EQ(view.rfind('/'), 8);
+	ENSURE(view.substr(1, 3) == "usr");
+	ENSURE(view.substr(9) == "sh");
+	ENSURE(view.substr(20).empty());
+	ENSURE(path == view);
+	ENSURE(kstd::string(view.substr(5, 3)) == "bin");
+}
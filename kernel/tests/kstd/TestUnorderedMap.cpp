@@ -0,0 +1,104 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "../KernelTest.h"
+#include <kernel/kstd/unordered_map.hpp>
+#include <kernel/kstd/unordered_set.hpp>
+#include <kernel/kstd/string.h>
+
+static int num_alive = 0;
+
+class CountedValue {
+public:
+	CountedValue() { num_alive++; }
+	CountedValue(const CountedValue&) { num_alive++; }
+	CountedValue(CountedValue&&) { num_alive++; }
+	CountedValue& operator=(const CountedValue&) = default;
+	CountedValue& operator=(CountedValue&&) = default;
+	~CountedValue() { num_alive--; }
+};
+
+KERNEL_TEST(unordered_map_insert) {
+	kstd::unordered_map<int, int> map;
+	for(int i = 0; i < 1000; i++)
+		map[i * 4096] = i;
+	ENSURE_EQ(map.size(), 1000);
+	for(int i = 0; i < 1000; i++) {
+		auto* value = map.get(i * 4096);
+		ENSURE(value);
+		if(value)
+			ENSURE_EQ(*value, i);
+	}
+	ENSURE(!map.get(1));
+	ENSURE(!map.insert({0, 5}));
+	ENSURE_EQ(map[0], 0);
+}
+
+KERNEL_TEST(unordered_map_erase) {
+	kstd::unordered_map<int, int> map;
+	for(int i = 0; i < 1000; i++)
+		map[i] = i * 2;
+	for(int i = 0; i < 1000; i += 2)
+		ENSURE(map.erase(i));
+	ENSURE(!map.erase(0));
+	ENSURE_EQ(map.size(), 500);
+	for(int i = 0; i < 1000; i++) {
+		if(i % 2)
+			ENSURE_EQ(map[i], i * 2);
+		else
+			ENSURE(!map.contains(i));
+	}
+
+	// Everything should still be found after erasing and inserting in a mixed up order
+	for(int i = 0; i < 1000; i += 2)
+		map[i] = i * 3;
+	for(int i = 1; i < 1000; i += 4)
+		map.erase(i);
+	size_t count = 0;
+	for(auto& entry : map) {
+		ENSURE_EQ(entry.second, entry.first % 2 ? entry.first * 2 : entry.first * 3);
+		count++;
+	}
+	ENSURE_EQ(count, map.size());
+	ENSURE_EQ(map.size(), 750);
+}
+
+KERNEL_TEST(unordered_map_string_keys) {
+	kstd::unordered_map<kstd::string, int> map;
+	map.insert({"bin", 1});
+	map.insert({"dev", 2});
+	map.insert({"proc", 3});
+	ENSURE_EQ(*map.get("dev"), 2);
+	ENSURE(!map.get("etc"));
+	map.erase("bin");
+	ENSURE(!map.contains("bin"));
+	ENSURE_EQ(map.size(), 2);
+}
+
+KERNEL_TEST(unordered_map_constructors_destructors) {
+	num_alive = 0;
+	{
+		kstd::unordered_map<int, CountedValue> map;
+		for(int i = 0; i < 100; i++)
+			map.insert({i, CountedValue()});
+		ENSURE_EQ(num_alive, 100);
+		for(int i = 0; i < 50; i++)
+			map.erase(i);
+		ENSURE_EQ(num_alive, 50);
+		auto copy = map;
+		ENSURE_EQ(num_alive, 100);
+	}
+	ENSURE_EQ(num_alive, 0);
+}
+
+KERNEL_TEST(unordered_set) {
+	kstd::unordered_set<void*> set;
+	int values[100];
+	for(auto& value : values)
+		ENSURE(set.insert(&value));
+	ENSURE(!set.insert(&values[0]));
+	ENSURE_EQ(set.size(), 100);
+	ENSURE(set.erase(&values[10]));
+	ENSURE(!set.contains(&values[10]));
+	ENSURE(set.contains(&values[11]));
+}
@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "../KernelTest.h"
+#include <kernel/kstd/small_vector.hpp>
+#include <kernel/kstd/string.h>
+
+static int num_copies = 0;
+
+class CopyCounter {
+public:
+	explicit CopyCounter(int value): value(value) {}
+	CopyCounter(const CopyCounter& other): value(other.value) { num_copies++; }
+	CopyCounter(CopyCounter&& other): value(other.value) {}
+	CopyCounter& operator=(const CopyCounter& other) { value = other.value; num_copies++; return *this; }
+	CopyCounter& operator=(CopyCounter&& other) { value = other.value; return *this; }
+	int value;
+};
+
+KERNEL_TEST(vector_growth_moves) {
+	num_copies = 0;
+	kstd::vector<CopyCounter> vec;
+	for(int i = 0; i < 100; i++)
+		vec.emplace_back(i);
+	vec.erase(0);
+	vec.insert(0, CopyCounter(-1));
+	ENSURE_EQ(num_copies, 0);
+	ENSURE_EQ(vec[0].value, -1);
+	ENSURE_EQ(vec[99].value, 99);
+}
+
+KERNEL_TEST(small_vector) {
+	kstd::small_vector<kstd::string, 4> vec;
+	for(int i = 0; i < 4; i++)
+		vec.push_back("inline");
+	ENSURE_EQ(vec.capacity(), 4);
+	for(int i = 0; i < 4; i++)
+		vec.push_back("heap");
+	ENSURE_EQ(vec.size(), 8);
+	ENSURE(vec[3] == "inline");
+	ENSURE(vec[4] == "heap");
+
+	auto moved = kstd::move(vec);
+	ENSURE(vec.empty());
+	ENSURE_EQ(moved.size(), 8);
+	auto copied = moved;
+	copied.resize(2);
+	ENSURE_EQ(copied.size(), 2);
+	ENSURE(copied[1] == "inline");
+}
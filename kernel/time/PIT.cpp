@@ -21,6 +21,8 @@
 #include <kernel/time/PIT.h>
 #include <kernel/IO.h>
 #include "TimeManager.h"
+#include "TimerQueue.h"
+#include <kernel/tasking/TaskManager.h>
 
 PIT::PIT(TimeManager* manager): TimeKeeper(manager), IRQHandler(PIT_IRQ) {
 	auto divisor = (uint16_t)(1193180u / PIT_FREQUENCY);
@@ -37,7 +39,7 @@ PIT::PIT(TimeManager* manager): TimeKeeper(manager), IRQHandler(PIT_IRQ) {
 }
 
 void PIT::handle_irq(Registers* regs) {
-	TimeKeeper::tick();
+	TimeKeeper::tick(regs);
 }
 
 bool PIT::mark_in_irq() {
@@ -60,3 +62,32 @@ void PIT::write(uint16_t data, uint8_t counter){
 	uint8_t port = (counter==0) ? PIT_COUNTER0 : ((counter==1) ? PIT_COUNTER1 : PIT_COUNTER2);
 	IO::outb(port, (uint8_t)data);
 }
+
+PITOneShot::PITOneShot(): IRQHandler(PIT_IRQ) {
+	disarm();
+}
+
+void PITOneShot::arm(uint64_t usecs) {
+	uint64_t count = (usecs * PIT_BASE_FREQUENCY) / 1000000;
+	if(count < 1)
+		count = 1;
+	if(count > 0xFFFF)
+		count = 0xFFFF;
+
+	// Channel 0, lobyte/hibyte access, mode 0 (interrupt on terminal count). Counting starts once the count is written.
+	IO::outb(PIT_CMD, 0x30);
+	IO::outb(PIT_COUNTER0, count & 0xFFu);
+	IO::outb(PIT_COUNTER0, (count >> 8u) & 0xFFu);
+}
+
+void PITOneShot::disarm() {
+	// Writing the mode without a count stops the counter until it's armed again
+	IO::outb(PIT_CMD, 0x30);
+}
+
+void PITOneShot::handle_irq(Registers* regs) {
+	TimerQueue::inst().advance();
+
+	// A timer probably woke something up, so give the scheduler a chance to run it
+	TaskManager::yield();
+}
@@ -25,6 +25,7 @@
 #define PIT_CMD  0x43
 #define PIT_IRQ 0
 #define PIT_FREQUENCY 1000 //Hz
+#define PIT_BASE_FREQUENCY 1193182 //Hz
 
 #include <kernel/interrupt/IRQHandler.h>
 #include "TimeKeeper.h"
@@ -46,3 +47,20 @@ public:
 private:
 	static void write(uint16_t data, uint8_t counter);
 };
+
+/**
+ * Uses channel 0 of the PIT in one-shot mode to interrupt once at a specific point in the future. This is used by the
+ * TimerQueue to interrupt at the next timer deadline instead of waiting for the next tick.
+ */
+class PITOneShot: public IRQHandler {
+public:
+	PITOneShot();
+
+	/// Interrupts after the given number of microseconds. Since the counter is only 16 bits, the delay is capped at
+	/// about 55ms; the TimerQueue will re-arm it when it fires if the deadline is further away than that.
+	void arm(uint64_t usecs);
+	void disarm();
+
+	///IRQHandler
+	void handle_irq(Registers* regs) override;
+};
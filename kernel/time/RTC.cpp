@@ -77,7 +77,7 @@ time_t RTC::timestamp() {
 
 void RTC::handle_irq(Registers* regs) {
 	CMOS::read(0x8C);
-	TimeKeeper::tick();
+	TimeKeeper::tick(regs);
 }
 
 bool RTC::set_frequency(int frequency) {
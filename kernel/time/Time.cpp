@@ -38,7 +38,7 @@ Time Time::distant_future() {
 }
 
 timespec Time::to_timespec() const {
-	return {_sec, _usec};
+	return {_sec, _usec, _usec * 1000};
 }
 
 timeval Time::to_timeval() const {
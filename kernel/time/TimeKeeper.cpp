@@ -19,11 +19,13 @@
 
 #include "TimeKeeper.h"
 #include "TimeManager.h"
+#include <kernel/tasking/Profiler.h>
 
 TimeKeeper::TimeKeeper(TimeManager* time): _manager(time) {
 
 }
 
-void TimeKeeper::tick() {
+void TimeKeeper::tick(Registers* regs) {
+	Profiler::sample(regs);
 	_manager->tick();
 }
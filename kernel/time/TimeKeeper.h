@@ -30,7 +30,8 @@ public:
 	virtual void disable() = 0;
 
 protected:
-	void tick();
+	/// Called by the timer interrupt, with the registers of whatever it interrupted.
+	void tick(Registers* regs);
 
 private:
 	TimeManager* _manager;
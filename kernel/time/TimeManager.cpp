@@ -21,7 +21,10 @@
 #include "TimeManager.h"
 #include "PIT.h"
 #include "RTC.h"
+#include "TimerQueue.h"
 #include <kernel/kstd/KLog.h>
+#include <kernel/memory/AnonymousVMObject.h>
+#include <kernel/memory/MemoryManager.h>
 
 TimeManager* TimeManager::_inst = nullptr;
 
@@ -40,14 +43,45 @@ void TimeManager::init() {
 
 	_inst = new TimeManager();
 	_inst->_keeper->enable();
+	TimerQueue::inst().init();
 }
 
 TimeManager::TimeManager(): _keeper(new RTC(this)) {
-	// Measure the tsc speed in MHz for accurate time measurement by using the PIT.
+	// Measure the tsc speed for accurate time measurement by using the PIT.
 	_boot_epoch = RTC::timestamp();
 	measure_tsc_speed();
-	_tsc_speed = (final_tsc - initial_tsc) / 10000;
-	KLog::dbg("TimeManager", "TSC speed measured at %dMHz", (uint32_t) _tsc_speed);
+	_tsc_hz = (final_tsc - initial_tsc) * PIT_BASE_FREQUENCY / TSC_CALIBRATION_PIT_COUNT;
+	KLog::dbg("TimeManager", "TSC speed measured at %dkHz", (uint32_t) (_tsc_hz / 1000));
+
+	// Processes share the time page with us, so it has to stay shared when they fork
+	auto page_res = AnonymousVMObject::alloc(PAGE_SIZE);
+	if(page_res.is_error()) {
+		KLog::err("TimeManager", "Couldn't allocate the time page: %d", page_res.code());
+		return;
+	}
+	_time_page_object = page_res.value();
+	_time_page_object->set_fork_action(VMObject::ForkAction::Share);
+	_time_page_region = MM.map_object(_time_page_object);
+	update_time_page();
+}
+
+void TimeManager::update_time_page() {
+	if(!_time_page_region)
+		return;
+	auto* page = (struct time_page*) _time_page_region->start();
+	page->seq++;
+	asm volatile("" ::: "memory");
+	page->tsc_hz = _tsc_hz;
+	page->tsc_base = initial_tsc;
+	page->boot_epoch = _boot_epoch;
+	asm volatile("" ::: "memory");
+	page->seq++;
+}
+
+kstd::Arc<AnonymousVMObject> TimeManager::time_page() {
+	if(!_inst)
+		return {};
+	return _inst->_time_page_object;
 }
 
 TimeManager& TimeManager::inst() {
@@ -55,13 +89,78 @@ TimeManager& TimeManager::inst() {
 }
 
 timespec TimeManager::uptime() {
-	if(!_inst)
-		return {0, 0};
-	return _inst->_uptime;
+	auto nsecs = uptime_ns();
+	return {(time_t) (nsecs / 1000000000), (long) ((nsecs % 1000000000) / 1000), (long) (nsecs % 1000000000)};
 }
 
 timespec TimeManager::now() {
-	return _inst->_epoch;
+	auto ret = uptime();
+	ret.tv_sec += boot_epoch();
+	return ret;
+}
+
+uint64_t TimeManager::uptime_us() {
+	if(!_inst)
+		return 0;
+	// Split off whole seconds first so that multiplying the remainder can't overflow
+	auto ticks = read_tsc() - initial_tsc;
+	auto hz = _inst->_tsc_hz;
+	return (ticks / hz) * 1000000 + ((ticks % hz) * 1000000) / hz;
+}
+
+uint64_t TimeManager::uptime_ns() {
+	return tsc_to_uptime_ns(read_tsc());
+}
+
+uint64_t TimeManager::tsc_to_uptime_ns(uint64_t tsc) {
+	if(!_inst)
+		return 0;
+	auto ticks = tsc - initial_tsc;
+	auto hz = _inst->_tsc_hz;
+	return (ticks / hz) * 1000000000 + ((ticks % hz) * 1000000000) / hz;
+}
+
+int64_t TimeManager::tsc_to_uptime_us(uint64_t tsc) {
+	if(!_inst)
+		return 0;
+	if(tsc >= initial_tsc)
+		return (int64_t) (tsc_to_uptime_ns(tsc) / 1000);
+	auto ticks = initial_tsc - tsc;
+	auto hz = _inst->_tsc_hz;
+	return -(int64_t) ((ticks / hz) * 1000000 + ((ticks % hz) * 1000000) / hz);
+}
+
+time_t TimeManager::boot_epoch() {
+	if(!_inst)
+		return 0;
+	return _inst->_boot_epoch;
+}
+
+void TimeManager::stop_tick() {
+	TaskManager::ScopedCritical critical;
+	if(!_inst || _inst->_tick_stopped)
+		return;
+	_inst->_keeper->disable();
+	_inst->_tick_stopped = true;
+	_inst->_tick_stopped_at = uptime_us();
+}
+
+void TimeManager::resume_tick() {
+	TaskManager::ScopedCritical critical;
+	if(!_inst || !_inst->_tick_stopped)
+		return;
+	_inst->_keeper->enable();
+	_inst->_tick_stopped = false;
+
+	// The tick is only ever stopped while idle, so count the ticks we missed as idle ones
+	auto missed = ((uptime_us() - _inst->_tick_stopped_at) * _inst->_keeper->frequency()) / 1000000;
+	if(missed > 100)
+		missed = 100;
+	while(missed--) {
+		if(_inst->idle_ticks.size() == 100)
+			_inst->idle_ticks.pop_front();
+		_inst->idle_ticks.push_back(true);
+	}
 }
 
 void TimeManager::tick() {
@@ -70,13 +169,10 @@ void TimeManager::tick() {
 	if(idle_ticks.size() == 100)
 		idle_ticks.pop_front();
 	idle_ticks.push_back(TaskManager::is_idle());
-	TaskManager::tick();
 
-	auto uptime_us = (read_tsc() - initial_tsc) / _tsc_speed;
-	_uptime.tv_usec = (long) (uptime_us % 1000000);
-	_uptime.tv_sec = (long) (uptime_us / 1000000);
-	_epoch.tv_sec = _boot_epoch + _uptime.tv_sec;
-	_epoch.tv_usec = _uptime.tv_usec;
+	// Expire any timers that the one-shot timer hasn't gotten to yet before ticking the TaskManager
+	TimerQueue::inst().advance();
+	TaskManager::tick();
 }
 
 double TimeManager::percent_idle() {
@@ -21,7 +21,15 @@
 
 #include <kernel/kstd/unix_types.h>
 #include "TimeKeeper.h"
+
+// The number of PIT cycles that measure_tsc_speed counts the TSC for (about 10ms)
+#define TSC_CALIBRATION_PIT_COUNT 0x2e9b
 #include <kernel/kstd/circular_queue.hpp>
+#include <kernel/kstd/Arc.h>
+#include <kernel/api/timepage.h>
+
+class AnonymousVMObject;
+class VMRegion;
 
 class TimeManager {
 public:
@@ -30,7 +38,21 @@ public:
 
 	static timespec uptime();
 	static timespec now();
+	static uint64_t uptime_us();
+	static uint64_t uptime_ns();
+	/// Converts a value read from the TSC to nanoseconds since boot.
+	static uint64_t tsc_to_uptime_ns(uint64_t tsc);
+	/// Converts a value read from the TSC to microseconds since boot, which is negative if it was read before the clock started.
+	static int64_t tsc_to_uptime_us(uint64_t tsc);
+	static time_t boot_epoch();
 	static double percent_idle();
+	/// The page that's mapped read-only into every userspace process so that it can tell the time without a syscall.
+	static kstd::Arc<AnonymousVMObject> time_page();
+
+	/// Stops the periodic tick while the CPU is idle. Timers will still expire via the TimerQueue's one-shot timer.
+	static void stop_tick();
+	/// Restarts the periodic tick if it was stopped.
+	static void resume_tick();
 
 protected:
 	friend class TimeKeeper;
@@ -38,14 +60,17 @@ protected:
 
 private:
 	TimeManager();
+	void update_time_page();
 
 	static TimeManager* _inst;
 	TimeKeeper* _keeper = nullptr;
-	timespec _epoch = {0, 0};
-	timespec _uptime = {0, 0};
 	int _ticks = 0;
+	bool _tick_stopped = false;
+	uint64_t _tick_stopped_at = 0;
 	time_t _boot_epoch = 0;
-	uint64_t _tsc_speed = 0; // Measured in MHz
+	uint64_t _tsc_hz = 0;
+	kstd::Arc<AnonymousVMObject> _time_page_object;
+	kstd::Arc<VMRegion> _time_page_region;
 	kstd::circular_queue<bool> idle_ticks = kstd::circular_queue<bool>(100);
 };
 
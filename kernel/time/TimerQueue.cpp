@@ -0,0 +1,214 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "TimerQueue.h"
+#include "TimeManager.h"
+#include "PIT.h"
+#include <kernel/tasking/TaskManager.h>
+
+TimerQueue TimerQueue::s_inst;
+
+Timer::Timer(Callback callback, void* data): m_callback(callback), m_data(data) {}
+
+Timer::~Timer() {
+	stop();
+}
+
+void Timer::start(Time time) {
+	TaskManager::ScopedCritical critical;
+	stop();
+
+	// Convert the time to microseconds of uptime
+	int64_t secs = (int64_t) time.sec() - TimeManager::boot_epoch();
+	if(secs < 0)
+		m_deadline = 0;
+	else
+		m_deadline = (uint64_t) secs * 1000000 + time.usec();
+
+	TimerQueue::inst().add(*this);
+}
+
+void Timer::stop() {
+	TaskManager::ScopedCritical critical;
+	if(m_active)
+		TimerQueue::inst().remove(*this);
+}
+
+TimerQueue& TimerQueue::inst() {
+	return s_inst;
+}
+
+void TimerQueue::init() {
+	if(m_oneshot)
+		return;
+	m_oneshot = new PITOneShot();
+	TaskManager::ScopedCritical critical;
+	reprogram();
+}
+
+void TimerQueue::add(Timer& timer) {
+	TaskManager::ScopedCritical critical;
+	if(timer.m_active)
+		unlink(timer);
+
+	// If there are no timers, we can skip all the way ahead to the present without having to expire anything
+	if(!m_count) {
+		auto now = TimeManager::uptime_us() >> TIMER_WHEEL_GRANULARITY_BITS;
+		if(now > m_current)
+			m_current = now;
+	}
+
+	insert(timer);
+	timer.m_active = true;
+	m_count++;
+	reprogram();
+}
+
+void TimerQueue::remove(Timer& timer) {
+	TaskManager::ScopedCritical critical;
+	if(!timer.m_active)
+		return;
+	unlink(timer);
+	timer.m_active = false;
+	m_count--;
+}
+
+void TimerQueue::advance() {
+	TaskManager::ScopedCritical critical;
+	auto now = TimeManager::uptime_us();
+	auto target = now >> TIMER_WHEEL_GRANULARITY_BITS;
+
+	while(true) {
+		if(!m_count) {
+			if(target > m_current)
+				m_current = target;
+			break;
+		}
+
+		expire(now);
+		if(m_current >= target)
+			break;
+
+		// Move to the next slot, and whenever a level wraps around, cascade the next slot of the level above it down
+		m_current++;
+		for(int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+			if((m_current >> (TIMER_WHEEL_SLOT_BITS * (level - 1))) & TIMER_WHEEL_SLOT_MASK)
+				break;
+			cascade(level);
+		}
+	}
+
+	reprogram();
+}
+
+uint64_t TimerQueue::next_deadline() const {
+	if(!m_count)
+		return 0;
+
+	uint64_t deadline = (uint64_t) -1;
+
+	// If there are timers in the upper levels, we need to cascade the next one down before it could possibly expire
+	for(int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+		if(m_bitmaps[level]) {
+			auto next_cascade = ((m_current >> TIMER_WHEEL_SLOT_BITS) + 1) << TIMER_WHEEL_SLOT_BITS;
+			deadline = next_cascade << TIMER_WHEEL_GRANULARITY_BITS;
+			break;
+		}
+	}
+
+	// Find the first non-empty slot in the first level, starting from the current one, and the earliest timer in it
+	auto bitmap = m_bitmaps[0];
+	if(bitmap) {
+		int cur = m_current & TIMER_WHEEL_SLOT_MASK;
+		if(cur)
+			bitmap = (bitmap >> cur) | (bitmap << (TIMER_WHEEL_SLOTS - cur));
+		int slot = (cur + __builtin_ctzll(bitmap)) & TIMER_WHEEL_SLOT_MASK;
+		for(auto* timer = m_slots[0][slot]; timer; timer = timer->m_next)
+			if(timer->m_deadline < deadline)
+				deadline = timer->m_deadline;
+	}
+
+	return deadline;
+}
+
+void TimerQueue::insert(Timer& timer) {
+	auto expires = timer.m_deadline >> TIMER_WHEEL_GRANULARITY_BITS;
+	if(expires < m_current)
+		expires = m_current;
+
+	// Timers too far in the future to fit in the wheel go in the last slot we can reach, and will be put back in the
+	// correct place when they're cascaded down
+	auto delta = expires - m_current;
+	if(delta >= (1ull << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS))) {
+		delta = (1ull << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1;
+		expires = m_current + delta;
+	}
+
+	int level = 0;
+	while(level < TIMER_WHEEL_LEVELS - 1 && delta >= (1ull << (TIMER_WHEEL_SLOT_BITS * (level + 1))))
+		level++;
+	int slot = (expires >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK;
+
+	timer.m_level = level;
+	timer.m_slot = slot;
+	timer.m_prev = nullptr;
+	timer.m_next = m_slots[level][slot];
+	if(timer.m_next)
+		timer.m_next->m_prev = &timer;
+	m_slots[level][slot] = &timer;
+	m_bitmaps[level] |= 1ull << slot;
+}
+
+void TimerQueue::unlink(Timer& timer) {
+	if(timer.m_prev)
+		timer.m_prev->m_next = timer.m_next;
+	else
+		m_slots[timer.m_level][timer.m_slot] = timer.m_next;
+	if(timer.m_next)
+		timer.m_next->m_prev = timer.m_prev;
+	if(!m_slots[timer.m_level][timer.m_slot])
+		m_bitmaps[timer.m_level] &= ~(1ull << timer.m_slot);
+	timer.m_next = nullptr;
+	timer.m_prev = nullptr;
+}
+
+void TimerQueue::expire(uint64_t now) {
+	int slot = m_current & TIMER_WHEEL_SLOT_MASK;
+	auto* timer = m_slots[0][slot];
+	while(timer) {
+		if(timer->m_deadline > now) {
+			timer = timer->m_next;
+			continue;
+		}
+
+		remove(*timer);
+		timer->m_callback(timer->m_data);
+
+		// The callback may have added or removed other timers, so start over from the beginning of the slot
+		timer = m_slots[0][slot];
+	}
+}
+
+void TimerQueue::cascade(int level) {
+	int slot = (m_current >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK;
+	auto* timer = m_slots[level][slot];
+	m_slots[level][slot] = nullptr;
+	m_bitmaps[level] &= ~(1ull << slot);
+	while(timer) {
+		auto* next = timer->m_next;
+		insert(*timer);
+		timer = next;
+	}
+}
+
+void TimerQueue::reprogram() {
+	if(!m_oneshot)
+		return;
+	auto deadline = next_deadline();
+	if(!deadline) {
+		m_oneshot->disarm();
+		return;
+	}
+	auto now = TimeManager::uptime_us();
+	m_oneshot->arm(deadline > now ? deadline - now : 0);
+}
@@ -0,0 +1,90 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <kernel/kstd/types.h>
+#include "Time.h"
+
+// The timer wheel has TIMER_WHEEL_LEVELS levels of 2^TIMER_WHEEL_SLOT_BITS slots each. Each slot in the first level
+// covers 2^TIMER_WHEEL_GRANULARITY_BITS microseconds, and each slot in a level covers an entire lower level.
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_GRANULARITY_BITS 10
+
+class PITOneShot;
+
+/**
+ * A timer that calls a callback once a certain time is reached. The callback is called in interrupt context, so it
+ * must not block or allocate.
+ */
+class Timer {
+public:
+	typedef void (*Callback)(void* data);
+
+	Timer(Callback callback, void* data);
+	Timer(const Timer& other) = delete;
+	~Timer();
+
+	/// Starts (or restarts) the timer so that it expires at the given time.
+	void start(Time time);
+	/// Stops the timer if it is active.
+	void stop();
+	[[nodiscard]] bool is_active() const { return m_active; }
+
+private:
+	friend class TimerQueue;
+
+	Callback m_callback;
+	void* m_data;
+	uint64_t m_deadline = 0; // In microseconds of uptime
+	bool m_active = false;
+	uint8_t m_level = 0;
+	uint8_t m_slot = 0;
+	Timer* m_next = nullptr;
+	Timer* m_prev = nullptr;
+};
+
+/**
+ * A hierarchical timer wheel which keeps track of every active Timer. Adding and removing a timer is O(1), and timers
+ * in the higher levels are cascaded down into the lower levels as their time approaches.
+ *
+ * Rather than only checking for expired timers on every tick, the queue programs a one-shot timer interrupt for the
+ * next deadline. This lets timers expire more precisely than the tick rate allows, and lets the periodic tick be
+ * stopped while the CPU is idle.
+ */
+class TimerQueue {
+public:
+	static TimerQueue& inst();
+
+	/// Sets up the one-shot timer used to interrupt at the next deadline. Until this is called, timers only expire on
+	/// calls to advance().
+	void init();
+
+	void add(Timer& timer);
+	void remove(Timer& timer);
+	/// Expires every timer that is due and programs the one-shot timer for the next deadline.
+	void advance();
+	/// Returns the uptime (in microseconds) by which advance() should next be called, or 0 if there are no timers.
+	[[nodiscard]] uint64_t next_deadline() const;
+	[[nodiscard]] size_t size() const { return m_count; }
+
+private:
+	TimerQueue() = default;
+
+	void insert(Timer& timer);
+	void unlink(Timer& timer);
+	void expire(uint64_t now);
+	void cascade(int level);
+	void reprogram();
+
+	static TimerQueue s_inst;
+
+	Timer* m_slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS] = {{nullptr}};
+	uint64_t m_bitmaps[TIMER_WHEEL_LEVELS] = {0};
+	uint64_t m_current = 0; // The slot of the wheel we're on, in units of first-level slots
+	size_t m_count = 0;
+	PITOneShot* m_oneshot = nullptr;
+};
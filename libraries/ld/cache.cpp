@@ -0,0 +1,217 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "ld.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <libduck/Log.h>
+
+using Duck::Log;
+
+/*
+ * Libraries are laid out one after another following the executable, so as long as the executable and every library it
+ * loads are the same files they were last time, they all end up at the same addresses and relocate to exactly the same
+ * contents. A prelink snapshot saves those relocated pages, so that later runs can map them from the snapshot (sharing
+ * them between processes until they're written to) instead of doing all of the relocations again.
+ */
+
+static void cpu_signature(uint32_t signature[4]) {
+	uint32_t eax, ebx, ecx, edx;
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0));
+	uint32_t max_leaf = eax;
+	//The low byte of ebx in leaf 1 has the APIC ID of the CPU we happen to be running on, so it's left out
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+	signature[0] = eax;
+	signature[1] = ecx;
+	signature[2] = edx;
+	signature[3] = 0;
+	if(max_leaf >= 7) {
+		asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(7), "c"(0));
+		signature[3] = ebx;
+	}
+}
+
+static std::string snapshot_path(Object* object) {
+	char path[64];
+	snprintf(path, sizeof(path), LD_CACHE_DIR "/%llx-%llx", (unsigned long long) object->dev, (unsigned long long) object->inode);
+	return path;
+}
+
+static bool read_all(int fd, void* buffer, size_t size) {
+	auto* buf = (uint8_t*) buffer;
+	while(size) {
+		ssize_t nread = read(fd, buf, size);
+		if(nread <= 0)
+			return false;
+		buf += nread;
+		size -= nread;
+	}
+	return true;
+}
+
+static bool write_all(int fd, const void* buffer, size_t size) {
+	auto* buf = (const uint8_t*) buffer;
+	while(size) {
+		ssize_t nwritten = write(fd, buf, size);
+		if(nwritten <= 0)
+			return false;
+		buf += nwritten;
+		size -= nwritten;
+	}
+	return true;
+}
+
+static bool page_is_zero(uintptr_t page) {
+	auto* words = (const uint32_t*) page;
+	for(size_t i = 0; i < PAGE_SIZE / sizeof(uint32_t); i++) {
+		if(words[i])
+			return false;
+	}
+	return true;
+}
+
+static LDCacheObject cache_object(Object* object) {
+	return {object->dev, object->inode, object->mtime, (uint32_t) object->memloc, (uint32_t) object->memsz};
+}
+
+/**
+ * Maps the relocated pages from the executable's prelink snapshot over the loaded objects, if it has one that's still
+ * valid. Returns whether it did, in which case the objects must not be relocated again.
+ */
+bool map_prelink_snapshot() {
+	int fd = open(snapshot_path(executable).c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	LDCacheHeader header;
+	uint32_t signature[4];
+	cpu_signature(signature);
+	if(!read_all(fd, &header, sizeof(header)) || header.magic != LD_CACHE_MAGIC || header.version != LD_CACHE_VERSION ||
+	   memcmp(header.cpu_signature, signature, sizeof(signature)) || header.bind_now != bind_now ||
+	   header.num_objects != search_order.size()) {
+		close(fd);
+		return false;
+	}
+
+	//Make sure nothing has been changed, replaced, or loaded somewhere else since the snapshot was taken
+	for(auto* object : search_order) {
+		LDCacheObject cached;
+		auto current = cache_object(object);
+		if(!read_all(fd, &cached, sizeof(cached)) || memcmp(&cached, &current, sizeof(cached))) {
+			if(debug)
+				Log::dbgf("Prelink snapshot for {} is out of date because of {}", executable->name, object->name);
+			close(fd);
+			return false;
+		}
+	}
+
+	std::vector<LDCacheSegment> segments(header.num_segments);
+	if(!read_all(fd, segments.data(), segments.size() * sizeof(LDCacheSegment))) {
+		close(fd);
+		return false;
+	}
+	for(auto& segment : segments) {
+		if(segment.object >= search_order.size() || segment.address % PAGE_SIZE || segment.offset % PAGE_SIZE || segment.size % PAGE_SIZE) {
+			close(fd);
+			return false;
+		}
+	}
+
+	/*
+	 * Once any pages have been replaced, there's no going back to relocating the objects normally since relocations
+	 * read their addends from the pages. So if a segment can't be mapped, its pages are read into the memory that's
+	 * already there instead.
+	 */
+	for(auto& segment : segments) {
+		if(mmap((void*) segment.address, segment.size, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE, fd, segment.offset) != MAP_FAILED)
+			continue;
+		if(lseek(fd, segment.offset, SEEK_SET) < 0 || !read_all(fd, (void*) segment.address, segment.size)) {
+			Log::errf("ld-duckos.so: Failed to load prelinked pages at {#x}: {}", segment.address, strerror(errno));
+			exit(127);
+		}
+	}
+
+	close(fd);
+	if(debug)
+		Log::dbgf("Using prelink snapshot for {}", executable->name);
+	return true;
+}
+
+/**
+ * Saves a snapshot of the relocated pages of the executable and every object it loaded. This has to be called after
+ * relocating and before any of the objects' initializers run, so the pages are exactly what relocating them gave.
+ */
+int write_prelink_snapshot() {
+	std::vector<LDCacheObject> objects;
+	std::vector<LDCacheSegment> segments;
+	for(size_t i = 0; i < search_order.size(); i++) {
+		auto* object = search_order[i];
+
+		//Only writable segments are snapshotted, so relocations can't have touched anything else
+		if(object->has_text_relocations) {
+			Log::err("ld-duckos.so: ", object->name, " has text relocations, so it can't be prelinked");
+			errno = ENOEXEC;
+			return -1;
+		}
+
+		objects.push_back(cache_object(object));
+		for(auto& pheader : object->pheaders) {
+			if(pheader.p_type != PT_LOAD || !(pheader.p_flags & PF_W))
+				continue;
+			size_t vaddr_mod = pheader.p_vaddr % PAGE_SIZE;
+			size_t round_memloc = object->memloc + pheader.p_vaddr - vaddr_mod;
+			size_t round_size = ((pheader.p_memsz + vaddr_mod + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+
+			//Trailing pages with nothing in them are left out, since they're zeroed when the segment is loaded anyway
+			while(round_size && page_is_zero(round_memloc + round_size - PAGE_SIZE))
+				round_size -= PAGE_SIZE;
+			if(round_size)
+				segments.push_back({(uint32_t) i, (uint32_t) round_memloc, (uint32_t) round_size, 0});
+		}
+	}
+
+	LDCacheHeader header = {LD_CACHE_MAGIC, LD_CACHE_VERSION, {}, bind_now, (uint32_t) objects.size(), (uint32_t) segments.size()};
+	cpu_signature(header.cpu_signature);
+	size_t offset = sizeof(header) + objects.size() * sizeof(LDCacheObject) + segments.size() * sizeof(LDCacheSegment);
+	offset = ((offset + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+	for(auto& segment : segments) {
+		segment.offset = offset;
+		offset += segment.size;
+	}
+
+	//Write it to a temporary file first, so nothing ever maps a half-written snapshot
+	if(mkdir(LD_CACHE_DIR, 0755) < 0 && errno != EEXIST)
+		return -1;
+	auto path = snapshot_path(executable);
+	auto temp_path = path + ".tmp";
+	int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0)
+		return -1;
+
+	bool success = write_all(fd, &header, sizeof(header)) &&
+			write_all(fd, objects.data(), objects.size() * sizeof(LDCacheObject)) &&
+			write_all(fd, segments.data(), segments.size() * sizeof(LDCacheSegment));
+	for(auto& segment : segments) {
+		if(!success)
+			break;
+		success = lseek(fd, segment.offset, SEEK_SET) >= 0 && write_all(fd, (void*) segment.address, segment.size);
+	}
+	close(fd);
+
+	if(!success) {
+		unlink(temp_path.c_str());
+		return -1;
+	}
+	unlink(path.c_str());
+	if(rename(temp_path.c_str(), path.c_str()) < 0)
+		return -1;
+
+	printf("Prelinked %s with %lu objects and %lu segments\n", executable->name.c_str(), (unsigned long) objects.size(), (unsigned long) segments.size());
+	return 0;
+}
@@ -25,26 +25,72 @@
 #include <cstring>
 #include <cstdlib>
 #include <map>
+#include <algorithm>
 #include <libduck/Log.h>
 #include <sys/mman.h>
 
 using Duck::Log;
 
-std::unordered_map<std::string, uintptr_t> global_symbols;
-std::unordered_map<std::string, uintptr_t> symbols;
 std::map<std::string, Object*> objects;
+std::vector<Object*> search_order; ///< The order objects are searched for symbols in: the executable, then breadth-first through its dependencies.
 size_t current_brk = 0;
 bool debug = false;
+bool bind_now = false; ///< Whether to bind every PLT entry up front instead of when each one is first called.
 Object* executable;
+size_t tls_size = 0; ///< The size of the static TLS block every thread gets, which holds every object's TLS.
+size_t tls_align = 1;
 
 extern "C" [[noreturn]] void call_main(int argc, char** argv, char** envp, main_t main);
+extern "C" void lazy_bind_trampoline();
+
+/**
+ * Gives each object with thread-local storage its offset below the thread pointer. The executable's has to go right
+ * below it, since that's where the static linker expects it to be for local-exec accesses, and the rest go below that.
+ */
+static void layout_tls() {
+	for(auto* object : search_order) {
+		if(!object->tls_size)
+			continue;
+		tls_size = ((tls_size + object->tls_size + object->tls_align - 1) / object->tls_align) * object->tls_align;
+		object->tls_offset = tls_size;
+		tls_align = std::max(tls_align, object->tls_align);
+	}
+}
+
+/**
+ * Gives libc the image each thread's TLS block starts out as, which sets up the TLS for the main thread. This has to be
+ * done after relocating, since the objects' initial TLS contents can have relocations too.
+ */
+static void init_tls() {
+	SymbolName init_tls("__init_tls");
+	auto init_tls_loc = lookup_symbol(init_tls, nullptr);
+	if(!init_tls_loc)
+		return;
+
+	auto* image = new uint8_t[tls_size]();
+	for(auto* object : search_order) {
+		if(object->tls_size)
+			memcpy(image + tls_size - object->tls_offset, (const void*) object->tls_image, object->tls_image_size);
+	}
+	((void(*)(const void*, size_t, size_t)) init_tls_loc)(image, tls_size, tls_align);
+}
 
 int main(int argc, char** argv, char** envp) {
+	//With --prelink, the binary is loaded and relocated but not run, and a snapshot of it is saved for next time
+	bool prelink = argc >= 2 && !strcmp(argv[1], "--prelink");
+	if(prelink) {
+		argc--;
+		argv++;
+	}
+
 	if(argc < 2) {
-		fprintf(stderr, "No binary specified. Usage: ld-duckos.so BINARY\n");
+		fprintf(stderr, "No binary specified. Usage: ld-duckos.so [--prelink] BINARY\n");
 		return -1;
 	}
 
+	char* ld_bind_now = getenv("LD_BIND_NOW");
+	bind_now = ld_bind_now && *ld_bind_now;
+
 	executable = new Object();
 	objects[std::string(argv[1])] = executable;
 
@@ -58,6 +104,9 @@ int main(int argc, char** argv, char** envp) {
 	// Map the executable
 	struct stat statbuf;
 	fstat(executable->fd, &statbuf);
+	executable->dev = statbuf.st_dev;
+	executable->inode = statbuf.st_ino;
+	executable->mtime = statbuf.st_mtime;
 	executable->mapped_size = ((statbuf.st_size + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
 	auto* mapped_file = mmap(nullptr, executable->mapped_size, PROT_READ, MAP_SHARED, executable->fd, 0);
 	if(mapped_file == MAP_FAILED) {
@@ -70,28 +119,44 @@ int main(int argc, char** argv, char** envp) {
 	if(executable->load(argv[1], true) < 0)
 		return errno;
 
-	//Read the symbols from the libraries and executable
-	auto rev_it = objects.rbegin();
-	while(rev_it != objects.rend()) {
-		auto* object = rev_it->second;
-		object->read_symbols();
-		rev_it++;
+	//Figure out what order to search the objects in for symbols
+	search_order.push_back(executable);
+	for(size_t i = 0; i < search_order.size(); i++) {
+		for(auto* dependency : search_order[i]->dependencies) {
+			if(std::find(search_order.begin(), search_order.end(), dependency) == search_order.end())
+				search_order.push_back(dependency);
+		}
 	}
+	layout_tls();
 
-	//Relocate the libraries and executable
-	rev_it = objects.rbegin();
+	//Relocate the libraries and executable, unless they've been prelinked and we can map the relocated pages instead
+	bool prelinked = !prelink && map_prelink_snapshot();
+	auto rev_it = objects.rbegin();
 	while(rev_it != objects.rend()) {
 		auto* object = rev_it->second;
-		object->relocate();
+		if(prelinked)
+			object->setup_lazy_binding();
+		else
+			object->relocate();
 		object->mprotect_sections();
 		rev_it++;
 	}
 
-	//Call __init_stdio for libc.so before any other initializer
-	if(symbols["__init_stdio"] != 0) {
-		((void(*)()) symbols["__init_stdio"])();
+	if(prelink) {
+		if(write_prelink_snapshot() < 0) {
+			perror("ld-duckos.so");
+			return errno;
+		}
+		return 0;
 	}
 
+	//Set up TLS and call __init_stdio for libc.so before any other initializer
+	init_tls();
+	SymbolName init_stdio("__init_stdio");
+	auto init_stdio_loc = lookup_symbol(init_stdio, nullptr);
+	if(init_stdio_loc)
+		((void(*)()) init_stdio_loc)();
+
 	//Call the initializer methods for the libraries and executable
 	rev_it = objects.rbegin();
 	while(rev_it != objects.rend()) {
@@ -177,12 +242,6 @@ int Object::load(char* name_cstr, bool is_main_executable) {
 	// Read the dynamic table
 	read_dynamic_table();
 
-	//Read the copy relocations of the main executable
-	if(is_main_executable && read_copy_relocations() < 0) {
-		Log::err("Failed to read copy relocations of ", name_cstr, ": ", strerror(errno));
-		return -1;
-	}
-
 	//Load the required libraries
 	for(auto& library_name : required_libraries) {
 		//Open the library
@@ -196,6 +255,7 @@ int Object::load(char* name_cstr, bool is_main_executable) {
 		if(library->load(library_name, false) < 0) {
 			Log::err("Failed to load required library ", library_name, ": ", strerror(errno));
 		}
+		dependencies.push_back(library);
 	}
 
 	loaded = true;
@@ -231,6 +291,9 @@ Object* Object::open_library(char* library_name) {
 	auto* object = new Object();
 	objects[library_name] = object;
 	object->fd = fd;
+	object->dev = statbuf.st_dev;
+	object->inode = statbuf.st_ino;
+	object->mtime = statbuf.st_mtime;
 	object->name = library_name;
 	object->mapped_file = (uint8_t*) mapped_file;
 	object->mapped_size = mapped_size;
@@ -301,6 +364,10 @@ void Object::read_dynamic_table() {
 				symbol_table_size = hash[1];
 				break;
 
+			case DT_GNU_HASH:
+				gnu_hash = (uint32_t*) (memloc + dynamic.d_val);
+				break;
+
 			case DT_STRTAB:
 				string_table = (char*) (memloc + dynamic.d_val);
 				break;
@@ -323,12 +390,61 @@ void Object::read_dynamic_table() {
 
 			case DT_INIT_ARRAYSZ:
 				init_array_size = dynamic.d_val / sizeof(uintptr_t);
+				break;
+
+			case DT_PLTGOT:
+				got = (uintptr_t*) (memloc + dynamic.d_val);
+				break;
+
+			case DT_JMPREL:
+				plt_relocations = (uint8_t*) (memloc + dynamic.d_val);
+				break;
+
+			case DT_BIND_NOW:
+				wants_bind_now = true;
+				break;
+
+			case DT_TEXTREL:
+				has_text_relocations = true;
+				break;
+
+			case DT_FLAGS:
+				if(dynamic.d_val & DF_BIND_NOW)
+					wants_bind_now = true;
+				if(dynamic.d_val & DF_TEXTREL)
+					has_text_relocations = true;
+				break;
+
+			case DT_FLAGS_1:
+				if(dynamic.d_val & DF_1_NOW)
+					wants_bind_now = true;
+				break;
 
 			default:
 				break;
 		}
 	}
 
+	//The GNU hash table doesn't say how many symbols there are, so find the end of the last chain in it
+	if(!hash && gnu_hash) {
+		uint32_t num_buckets = gnu_hash[0];
+		uint32_t symbol_offset = gnu_hash[1];
+		auto* buckets = gnu_hash + 4 + gnu_hash[2];
+		auto* chains = buckets + num_buckets;
+		uint32_t last_symbol = 0;
+		for(uint32_t i = 0; i < num_buckets; i++)
+			last_symbol = std::max(last_symbol, buckets[i]);
+		if(last_symbol < symbol_offset) {
+			symbol_table_size = symbol_offset;
+		} else {
+			while(!(chains[last_symbol - symbol_offset] & 1))
+				last_symbol++;
+			symbol_table_size = last_symbol + 1;
+		}
+	}
+	symbol_cache.resize(symbol_table_size);
+	symbol_cached.resize(symbol_table_size);
+
 	//Now that the string table is loaded, we can iterate again and find the required libraries
 	required_libraries.resize(0);
 	for(auto& dynamic : dynamic_table) {
@@ -339,27 +455,36 @@ void Object::read_dynamic_table() {
 
 int Object::load_sections() {
 	for(auto& pheader : pheaders) {
+		//The initial contents of the object's TLS are part of one of its loaded segments
+		if(pheader.p_type == PT_TLS) {
+			tls_image = memloc + pheader.p_vaddr;
+			tls_image_size = pheader.p_filesz;
+			tls_size = pheader.p_memsz;
+			tls_align = pheader.p_align ? pheader.p_align : 1;
+			continue;
+		}
+
 		if(pheader.p_type != PT_LOAD)
 			continue;
 
-		// Allocate memory for the section
 		size_t vaddr_mod = pheader.p_vaddr % PAGE_SIZE;
 		size_t round_memloc = memloc + pheader.p_vaddr - vaddr_mod;
 		size_t round_size = ((pheader.p_memsz + vaddr_mod + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+
+		// Map read-only sections straight from the file, so that every process using the object shares one copy of them.
+		// It's mapped writable until mprotect_sections() so relocations can be done, which only copies the pages they touch.
+		if(!(pheader.p_flags & PF_W) && pheader.p_memsz == pheader.p_filesz && pheader.p_offset % PAGE_SIZE == vaddr_mod) {
+			if(mmap((void*) round_memloc, round_size, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE, fd, pheader.p_offset - vaddr_mod) != MAP_FAILED)
+				continue;
+			Duck::Log::warnf("ld: Failed to map section at {#x}->{#x}, copying it instead: {}", pheader.p_vaddr, pheader.p_vaddr + pheader.p_memsz, strerror(errno));
+		}
+
+		// Allocate memory for the section
 		if(mmap((void*) round_memloc, round_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_FIXED, 0, 0) == MAP_FAILED)
 			Duck::Log::errf("ld: Failed to allocate memory for section at {#x}->{#x}: {}", pheader.p_vaddr, pheader.p_vaddr + pheader.p_memsz, strerror(errno));
 		lseek(fd, pheader.p_offset, SEEK_SET);
 		read(fd, (void*) (memloc + pheader.p_vaddr), pheader.p_filesz);
 
-		// Map the section into memory
-		// TODO: Why is this slower?
-//		size_t round_offset = pheader.p_offset - vaddr_mod;
-//		size_t round_filesz = ((pheader.p_filesz + vaddr_mod + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
-//		if(mmap((void*) round_memloc, round_filesz, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE, fd, round_offset) == MAP_FAILED)
-//			Duck::Log::errf("ld: Failed to allocate memory for section at {#x}->{#x}: {}", pheader.p_vaddr, pheader.p_vaddr + pheader.p_memsz, strerror(errno));
-//		if(pheader.p_memsz != pheader.p_filesz)
-//			if(mmap((void*) (round_memloc + round_filesz), round_size - round_filesz, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_FIXED, 0, 0) == MAP_FAILED)
-//				Duck::Log::errf("ld: Failed to allocate memory for section at {#x}->{#x}: {}", pheader.p_vaddr, pheader.p_vaddr + pheader.p_memsz, strerror(errno));
 
 		// Zero out the remaining bytes
 		size_t bytes_left = pheader.p_memsz - pheader.p_filesz;
@@ -385,37 +510,155 @@ void Object::mprotect_sections() {
 	}
 }
 
-int Object::read_copy_relocations() {
-	//In the relocation table, find all of the copy relocations (ELF32_R_TYPE == STT_COMMON) and put them in the global symbols
-	for(auto& shdr : sheaders) {
-		if(shdr.sh_type != SHT_REL)
-			continue;
-		auto* rel_table = (elf32_rel*) (shdr.sh_addr + memloc);
-		for(size_t i = 0; i < shdr.sh_size / sizeof(elf32_rel); i++) {
-			auto& rel = rel_table[i];
-			if(ELF32_R_TYPE(rel.r_info) == R_386_COPY) {
-				auto& symbol = symbol_table[ELF32_R_SYM(rel.r_info)];
-				auto* symbol_name = (char*)((uintptr_t)string_table + symbol.st_name);
-				global_symbols[symbol_name] = rel.r_offset;
+SymbolName::SymbolName(const char* name): name(name) {
+	uint32_t hash = 5381;
+	for(auto* c = (const uint8_t*) name; *c; c++)
+		hash = (hash << 5) + hash + *c;
+	gnu_hash = hash;
+}
+
+uint32_t SymbolName::sysv_hash() {
+	if(!m_has_sysv_hash) {
+		uint32_t hash = 0;
+		for(auto* c = (const uint8_t*) name; *c; c++) {
+			hash = (hash << 4) + *c;
+			uint32_t high = hash & 0xf0000000;
+			if(high)
+				hash ^= high >> 24;
+			hash &= ~high;
+		}
+		m_sysv_hash = hash;
+		m_has_sysv_hash = true;
+	}
+	return m_sysv_hash;
+}
+
+const elf32_sym* Object::find_symbol(SymbolName& name) const {
+	auto matches = [&](uint32_t index) -> const elf32_sym* {
+		auto& symbol = symbol_table[index];
+		if(symbol.st_shndx == SHN_UNDEF || ELF32_ST_BIND(symbol.st_info) == STB_LOCAL)
+			return nullptr;
+		return strcmp(string_table + symbol.st_name, name.name) ? nullptr : &symbol;
+	};
+
+	if(gnu_hash) {
+		uint32_t num_buckets = gnu_hash[0];
+		uint32_t symbol_offset = gnu_hash[1];
+		uint32_t bloom_size = gnu_hash[2];
+		uint32_t bloom_shift = gnu_hash[3];
+		auto* bloom = gnu_hash + 4;
+		auto* buckets = bloom + bloom_size;
+		auto* chains = buckets + num_buckets;
+
+		//The bloom filter rules out most of the objects that don't have the symbol without touching the symbol table
+		uint32_t name_hash = name.gnu_hash;
+		uint32_t word = bloom[(name_hash / 32) % bloom_size];
+		uint32_t mask = (1u << (name_hash % 32)) | (1u << ((name_hash >> bloom_shift) % 32));
+		if((word & mask) != mask)
+			return nullptr;
+
+		uint32_t index = buckets[name_hash % num_buckets];
+		if(index < symbol_offset)
+			return nullptr;
+		for(;; index++) {
+			//Each chain entry is the hash of its symbol, with the lowest bit set on the last one in the chain
+			uint32_t chain_hash = chains[index - symbol_offset];
+			if((chain_hash | 1) == (name_hash | 1)) {
+				if(auto* symbol = matches(index))
+					return symbol;
 			}
+			if(chain_hash & 1)
+				return nullptr;
 		}
 	}
-	return 0;
+
+	if(hash) {
+		uint32_t num_buckets = hash[0];
+		auto* buckets = hash + 2;
+		auto* chains = buckets + num_buckets;
+		for(uint32_t index = buckets[name.sysv_hash() % num_buckets]; index; index = chains[index]) {
+			if(auto* symbol = matches(index))
+				return symbol;
+		}
+	}
+
+	return nullptr;
 }
 
-int Object::read_symbols() {
-	//Put all the symbols into the symbols map if they aren't there already
-	for(size_t i = 0; i < symbol_table_size; i++) {
-		auto* symbol = &symbol_table[i];
-		char* symbol_name = (char*)((uintptr_t) string_table + symbol->st_name);
-		if(symbol->st_shndx && symbols.find(symbol_name) == symbols.end()) {
-			symbols[symbol_name] = symbol->st_value + memloc;
+uintptr_t Object::symbol_address(const elf32_sym& symbol) const {
+	//The value of an indirect function is a resolver that returns the address of the implementation to use
+	if(ELF32_ST_TYPE(symbol.st_info) == STT_GNU_IFUNC)
+		return ((uintptr_t(*)()) (symbol.st_value + memloc))();
+	return symbol.st_value + memloc;
+}
+
+uintptr_t Object::resolve_symbol(uint32_t index, bool is_copy) {
+	if(!index)
+		return 0;
+
+	//A copy relocation copies a symbol's initial value from the library that defines it, so it can't find our own copy
+	if(!is_copy && symbol_cached[index])
+		return symbol_cache[index];
+
+	auto& symbol = symbol_table[index];
+	SymbolName symbol_name(string_table + symbol.st_name);
+	uintptr_t symbol_loc = lookup_symbol(symbol_name, is_copy ? this : nullptr);
+	if(!symbol_loc) {
+		if(symbol.st_shndx != SHN_UNDEF && !is_copy) {
+			symbol_loc = symbol_address(symbol);
+		} else if(debug) {
+			Log::warn("Symbol ", symbol_name.name, " not found for ", name);
 		}
 	}
-	return 0;
+
+	if(!is_copy) {
+		symbol_cache[index] = symbol_loc;
+		symbol_cached[index] = true;
+	}
+	return symbol_loc;
+}
+
+/**
+ * Finds the object that defines a thread-local symbol, and the symbol's offset into that object's TLS block. Index 0
+ * refers to the object's own TLS block, which is what local-dynamic accesses use.
+ */
+Object* Object::resolve_tls_symbol(uint32_t index, uintptr_t& offset) {
+	offset = 0;
+	if(!index)
+		return this;
+
+	auto& symbol = symbol_table[index];
+	SymbolName symbol_name(string_table + symbol.st_name);
+	const elf32_sym* found;
+	if(auto* object = lookup_symbol_object(symbol_name, nullptr, found)) {
+		offset = found->st_value;
+		return object;
+	}
+	if(symbol.st_shndx != SHN_UNDEF) {
+		offset = symbol.st_value;
+		return this;
+	}
+	if(debug)
+		Log::warn("TLS symbol ", symbol_name.name, " not found for ", name);
+	return nullptr;
+}
+
+/**
+ * Unless we were told to bind everything now, the PLT's GOT entries are left pointing back into the PLT. The first call
+ * through an entry then pushes the relocation's offset and jumps to the start of the PLT, which pushes GOT[1] and jumps
+ * to GOT[2], and we fill in the entry from there. Returns whether the object is bound lazily.
+ */
+bool Object::setup_lazy_binding() {
+	if(bind_now || wants_bind_now || !got || !plt_relocations)
+		return false;
+	got[1] = (uintptr_t) this;
+	got[2] = (uintptr_t) lazy_bind_trampoline;
+	return true;
 }
 
 int Object::relocate() {
+	bool lazy = setup_lazy_binding();
+
 	//Relocate the symbols
 	for(auto& shdr : sheaders) {
 		if(shdr.sh_type != SHT_REL)
@@ -429,33 +672,18 @@ int Object::relocate() {
 			if(rel_type == R_386_NONE)
 				continue;
 
+			//The GOT entry has the address of the PLT entry after its jump, which just needs adjusting for where we loaded
+			if(rel_type == R_386_JMP_SLOT && lazy) {
+				*((uintptr_t*) (memloc + rel.r_offset)) += memloc;
+				continue;
+			}
+
 			auto& symbol = symbol_table[rel_symbol];
-			uintptr_t symbol_loc = memloc + symbol.st_value;
-			char* symbol_name = (char *)((uintptr_t) string_table + symbol.st_name);
+			uintptr_t symbol_loc = 0;
 
 			//If this kind of relocation is a symbol, look it up
-			if(rel_type == R_386_32 || rel_type == R_386_PC32 || rel_type == R_386_COPY || rel_type == R_386_GLOB_DAT || rel_type == R_386_JMP_SLOT) {
-				if(symbol_name) {
-					auto map_it = symbols.find(symbol_name);
-					if(map_it == symbols.end()) {
-						if(debug)
-							Log::warn("Symbol ", symbol_name, " not found for ", name);
-						symbol_loc = 0x0;
-					} else {
-						symbol_loc = map_it->second;
-					}
-				}
-			}
-
-			//If this is a global symbol, try finding it in the global symbol table
-			if(rel_type == R_386_GLOB_DAT) {
-				if(symbol_name) {
-					auto map_it = global_symbols.find(symbol_name);
-					if(map_it != symbols.end()) {
-						symbol_loc = map_it->second;
-					}
-				}
-			}
+			if(rel_type == R_386_32 || rel_type == R_386_PC32 || rel_type == R_386_COPY || rel_type == R_386_GLOB_DAT || rel_type == R_386_JMP_SLOT)
+				symbol_loc = resolve_symbol(rel_symbol, rel_type == R_386_COPY);
 
 			//Perform the actual relocation
 			auto* reloc_loc = (void*) (memloc + rel.r_offset);
@@ -472,7 +700,8 @@ int Object::relocate() {
 					break;
 
 				case R_386_COPY:
-					memcpy(reloc_loc, (const void*) symbol_loc, symbol.st_size);
+					if(symbol_loc)
+						memcpy(reloc_loc, (const void*) symbol_loc, symbol.st_size);
 					break;
 
 				case R_386_GLOB_DAT:
@@ -485,6 +714,39 @@ int Object::relocate() {
 					*((uintptr_t*) reloc_loc) = (uintptr_t) symbol_loc;
 					break;
 
+				case R_386_IRELATIVE:
+					symbol_loc = ((uintptr_t(*)()) (memloc + *((ssize_t*) reloc_loc)))();
+					*((uintptr_t*) reloc_loc) = (uintptr_t) symbol_loc;
+					break;
+
+				/*
+				 * TLS is only laid out statically, so every thread-local variable is at a fixed offset from the thread
+				 * pointer. That means the "module ID" for general-dynamic accesses can just be the object's offset,
+				 * which libc's __tls_get_addr knows to subtract from the thread pointer.
+				 */
+				case R_386_TLS_TPOFF:
+				case R_386_TLS_TPOFF32:
+				case R_386_TLS_DTPMOD32: {
+					uintptr_t offset;
+					auto* tls_object = resolve_tls_symbol(rel_symbol, offset);
+					if(!tls_object)
+						break;
+					if(rel_type == R_386_TLS_TPOFF)
+						*((uintptr_t*) reloc_loc) += offset - tls_object->tls_offset;
+					else if(rel_type == R_386_TLS_TPOFF32)
+						*((uintptr_t*) reloc_loc) += tls_object->tls_offset - offset;
+					else
+						*((uintptr_t*) reloc_loc) = tls_object->tls_offset;
+					break;
+				}
+
+				case R_386_TLS_DTPOFF32: {
+					uintptr_t offset;
+					if(resolve_tls_symbol(rel_symbol, offset))
+						*((uintptr_t*) reloc_loc) += offset;
+					break;
+				}
+
 				default:
 					if(debug)
 						Log::warn("Unknown relocation type ", (int) rel_type, " for ",  (int) rel_symbol);
@@ -516,4 +778,41 @@ std::string find_library(char* library_name) {
 	}
 
 	return "";
-}
\ No newline at end of file
+}
+
+uintptr_t Object::bind_plt_entry(uint32_t relocation_offset) {
+	auto& rel = *((elf32_rel*) (plt_relocations + relocation_offset));
+	uintptr_t symbol_loc = resolve_symbol(ELF32_R_SYM(rel.r_info), false);
+	if(!symbol_loc) {
+		auto& symbol = symbol_table[ELF32_R_SYM(rel.r_info)];
+		Log::err("ld-duckos.so: Couldn't find ", string_table + symbol.st_name, " for ", name);
+		exit(127);
+	}
+	*((uintptr_t*) (memloc + rel.r_offset)) = symbol_loc;
+	return symbol_loc;
+}
+
+/**
+ * Called by lazy_bind_trampoline the first time a PLT entry is called. This can be called by several threads at once,
+ * but they'd all be writing the same address to the same places, so it doesn't need a lock.
+ */
+extern "C" uintptr_t lazy_bind(Object* object, uint32_t relocation_offset) {
+	return object->bind_plt_entry(relocation_offset);
+}
+
+uintptr_t lookup_symbol(SymbolName& name, const Object* skip) {
+	const elf32_sym* symbol;
+	if(auto* object = lookup_symbol_object(name, skip, symbol))
+		return object->symbol_address(*symbol);
+	return 0;
+}
+
+Object* lookup_symbol_object(SymbolName& name, const Object* skip, const elf32_sym*& symbol) {
+	for(auto* object : search_order) {
+		if(object == skip)
+			continue;
+		if((symbol = object->find_symbol(name)))
+			return object;
+	}
+	return nullptr;
+}
@@ -20,7 +20,8 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
+#include <string>
+#include <sys/types.h>
 #include <kernel/api/page_size.h>
 
 #define ELF_MAGIC 0x464C457F //0x7F followed by 'ELF'
@@ -46,6 +47,7 @@
 #define PT_NOTE 4
 #define PT_SHLIB 5
 #define PT_PHDR 6
+#define PT_TLS 7
 
 #define PF_X 1u
 #define PF_W 2u
@@ -75,8 +77,10 @@
 #define DT_DEBUG	21
 #define DT_TEXTREL	22
 #define DT_JMPREL	23
+#define DT_BIND_NOW	24
 #define DT_INIT_ARRAY	25
 #define DT_INIT_ARRAYSZ	27
+#define DT_FLAGS	30
 #define DT_ENCODING	32
 #define OLD_DT_LOOS		0x60000000
 #define DT_LOOS			0x6000000d
@@ -84,6 +88,7 @@
 #define DT_VALRNGLO		0x6ffffd00
 #define DT_VALRNGHI		0x6ffffdff
 #define DT_ADDRRNGLO	0x6ffffe00
+#define DT_GNU_HASH		0x6ffffef5
 #define DT_ADDRRNGHI	0x6ffffeff
 #define DT_VERSYM		0x6ffffff0
 #define DT_RELACOUNT	0x6ffffff9
@@ -122,6 +127,15 @@
 #define STT_FILE    4
 #define STT_COMMON  5
 #define STT_TLS     6
+#define STT_GNU_IFUNC 10
+
+#define STB_LOCAL 0
+
+#define SHN_UNDEF 0
+
+#define DF_TEXTREL 0x4
+#define DF_BIND_NOW 0x8
+#define DF_1_NOW 0x1
 
 #define R_386_NONE		0
 #define R_386_32		1
@@ -133,9 +147,15 @@
 #define R_386_JMP_SLOT	7
 #define R_386_RELATIVE	8
 #define R_386_TLS_TPOFF	14
+#define R_386_TLS_DTPMOD32	35
+#define R_386_TLS_DTPOFF32	36
+#define R_386_TLS_TPOFF32	37
+#define R_386_IRELATIVE	42
 
 #define ELF32_R_SYM(x) ((x) >> 8u)
 #define ELF32_R_TYPE(x) ((x) & 0xffu)
+#define ELF32_ST_TYPE(x) ((x) & 0xfu)
+#define ELF32_ST_BIND(x) ((x) >> 4u)
 
 typedef struct {
 	unsigned char	e_ident[16];
@@ -205,6 +225,56 @@ typedef struct {
 
 typedef int (*main_t)(int argc, char* argv[], char* envp[]);
 
+#define LD_CACHE_DIR "/etc/ld.cache"
+#define LD_CACHE_MAGIC 0x48434c44 // 'DLCH'
+#define LD_CACHE_VERSION 2
+
+/**
+ * The header of a prelink snapshot. LD_CACHE_DIR has one of these for each executable that's been prelinked with
+ * `ld-duckos.so --prelink BINARY`, named after the device and inode of the executable. It's followed by an LDCacheObject
+ * for each object in search order, then an LDCacheSegment for each snapshotted segment, then the page-aligned contents
+ * of those segments as they were right after relocation.
+ */
+struct LDCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t cpu_signature[4]; ///< Indirect functions pick their implementation based on the CPU, so it has to match.
+	uint32_t bind_now;
+	uint32_t num_objects;
+	uint32_t num_segments;
+};
+
+/** An object that was loaded when the snapshot was taken. The snapshot is only used if all of these are unchanged. **/
+struct LDCacheObject {
+	uint64_t dev;
+	uint64_t inode;
+	int64_t mtime;
+	uint32_t memloc;
+	uint32_t memsz;
+};
+
+struct LDCacheSegment {
+	uint32_t object;
+	uint32_t address; ///< Where the pages go. Always page-aligned.
+	uint32_t size;
+	uint32_t offset; ///< Where in the snapshot file the pages are. Always page-aligned.
+};
+
+/** The name of a symbol being looked up, along with its hashes so they're only calculated once per lookup. **/
+class SymbolName {
+public:
+	explicit SymbolName(const char* name);
+
+	uint32_t sysv_hash();
+
+	const char* name;
+	uint32_t gnu_hash;
+
+private:
+	uint32_t m_sysv_hash = 0;
+	bool m_has_sysv_hash = false;
+};
+
 class Object {
 public:
 	Object() = default;
@@ -219,12 +289,20 @@ public:
 	void read_dynamic_table();
 	int load_sections();
 	void mprotect_sections();
-	int read_copy_relocations();
-	int read_symbols();
+	bool setup_lazy_binding();
 	int relocate();
 
+	const elf32_sym* find_symbol(SymbolName& name) const;
+	uintptr_t symbol_address(const elf32_sym& symbol) const;
+	uintptr_t resolve_symbol(uint32_t index, bool is_copy);
+	Object* resolve_tls_symbol(uint32_t index, uintptr_t& offset);
+	uintptr_t bind_plt_entry(uint32_t relocation_offset);
+
 	std::string name;
 	int fd = 0;
+	dev_t dev = 0;
+	ino_t inode = 0;
+	time_t mtime = 0;
 	elf32_ehdr* header = nullptr;
 	size_t memsz = 0;
 	size_t memloc = 0;
@@ -236,12 +314,27 @@ public:
 	elf32_sym* symbol_table = nullptr;
 	size_t symbol_table_size = 0;
 	uint32_t* hash = nullptr;
+	uint32_t* gnu_hash = nullptr;
 	void (**init_array)() = nullptr;
 	size_t init_array_size = 0;
 	void (*init_func)() = nullptr;
+	uintptr_t* got = nullptr;
+	uint8_t* plt_relocations = nullptr;
+	bool wants_bind_now = false;
+	bool has_text_relocations = false;
 	main_t entry;
 
+	//Thread-local storage, from the PT_TLS header
+	uintptr_t tls_image = 0;
+	size_t tls_image_size = 0;
+	size_t tls_size = 0;
+	size_t tls_align = 1;
+	size_t tls_offset = 0; ///< How far below the thread pointer the object's TLS block starts.
+
 	std::vector<char*> required_libraries;
+	std::vector<Object*> dependencies;
+	std::vector<uintptr_t> symbol_cache; ///< The resolved addresses of the symbols relocations refer to, by index.
+	std::vector<bool> symbol_cached;
 	uint8_t* mapped_file = nullptr;
 	size_t mapped_size = 0;
 	std::vector<elf32_pheader> pheaders;
@@ -250,4 +343,14 @@ public:
 };
 
 std::string find_library(char* library_name);
+uintptr_t lookup_symbol(SymbolName& name, const Object* skip);
+Object* lookup_symbol_object(SymbolName& name, const Object* skip, const elf32_sym*& symbol);
+
+bool map_prelink_snapshot();
+int write_prelink_snapshot();
+
+extern std::vector<Object*> search_order;
+extern bool debug;
+extern bool bind_now;
+extern Object* executable;
 
@@ -20,11 +20,28 @@
 #include "App.h"
 #include <libgraphics/PNG.h>
 #include <libduck/Config.h>
+#include <libduck/MappedFile.h>
+#include <kernel/api/prefetch.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <cstdio>
 
 using namespace App;
 using Duck::Result, Duck::ResultRet, Duck::Path;
 
+#define LIBAPP_REGISTRY_MAGIC 0x53505041 //"APPS"
+#define LIBAPP_REGISTRY_VERSION 1
+
+namespace {
+	struct RegistryHeader {
+		uint32_t magic;
+		uint32_t version;
+		time_t apps_mtime; ///The modification time of the apps directory when the registry was made.
+		size_t size; ///The size of the whole registry, so one that didn't get written completely isn't used.
+	};
+}
+
 ResultRet<Info> Info::from_app_directory(const Path& app_directory) {
 	auto config_res = Duck::Config::read_from(app_directory / "app.conf");
 	if(config_res.is_error())
@@ -132,17 +149,19 @@ std::shared_ptr<const Gfx::Image> Info::resource_image(const Path& path) {
 }
 
 size_t Info::serialized_size() const {
-	bool has_icon;
+	std::vector<std::string> extensions(_extensions.begin(), _extensions.end());
+	size_t size = Duck::Serialization::buffer_size(_exists, _name, _base_path.string(), _exec, _hidden, extensions, (bool) _icon);
 	if(_icon)
-		return Duck::Serialization::buffer_size(_name, _base_path.string(), _hidden, has_icon, *_icon);
-	else
-		return Duck::Serialization::buffer_size(_name, _base_path.string(), _hidden, has_icon);
+		size += Gfx::Framebuffer(nullptr, _icon->size().width, _icon->size().height).serialized_size();
+	return size;
 }
 
 void Info::serialize(uint8_t*& buf) const {
-	Duck::Serialization::serialize(buf, _name, _base_path.string(), _hidden, _icon.operator bool());
+	std::vector<std::string> extensions(_extensions.begin(), _extensions.end());
+	Duck::Serialization::serialize(buf, _exists, _name, _base_path.string(), _exec, _hidden, extensions, (bool) _icon);
 	if(_icon) {
 		Gfx::Framebuffer icon_buf(_icon->size().width, _icon->size().height);
+		icon_buf.fill({{0, 0}, _icon->size()}, RGBA(0, 0, 0, 0));
 		_icon->draw(icon_buf, {{0, 0}, _icon->size()});
 		Duck::Serialization::serialize(buf, icon_buf);
 	}
@@ -150,9 +169,11 @@ void Info::serialize(uint8_t*& buf) const {
 
 void Info::deserialize(const uint8_t*& buf) {
 	std::string base_path;
+	std::vector<std::string> extensions;
 	bool has_icon;
-	Duck::Serialization::deserialize(buf, _name, base_path, _hidden, has_icon);
+	Duck::Serialization::deserialize(buf, _exists, _name, base_path, _exec, _hidden, extensions, has_icon);
 	_base_path = base_path;
+	_extensions = std::set<std::string>(extensions.begin(), extensions.end());
 	if(has_icon) {
 		auto* iconbuf = new Gfx::Framebuffer();
 		Duck::Serialization::deserialize(buf, *iconbuf);
@@ -169,6 +190,7 @@ bool Info::can_handle(Duck::Path path) const {
 }
 
 Result Info::run(const std::vector<std::string>& args, bool do_fork) const {
+	prefetch();
 	if(!do_fork || !fork()) {
 		std::string exec_str = exec();
 		auto c_args = new char*[2 + args.size()];
@@ -187,10 +209,70 @@ Result Info::run(const std::vector<std::string>& args, bool do_fork) const {
 	return Result::SUCCESS;
 }
 
+void Info::prefetch() const {
+	// Lists are recorded with `prefetch record /var/prefetch/apps/<name> <command>`. Replaying one just queues the
+	// reads, so this doesn't hold up the launch.
+	int list_fd = open((std::string(LIBAPP_PREFETCH_PATH) + "/" + name()).c_str(), O_RDONLY | O_CLOEXEC);
+	if(list_fd < 0)
+		return;
+	std::vector<prefetch_entry> entries(PREFETCH_MAX_ENTRIES);
+	ssize_t nread = read(list_fd, entries.data(), entries.size() * sizeof(prefetch_entry));
+	close(list_fd);
+	int fd = open("/dev/prefetch", O_WRONLY | O_CLOEXEC);
+	if(fd < 0 || nread <= 0) {
+		if(fd >= 0)
+			close(fd);
+		return;
+	}
+	write(fd, entries.data(), nread);
+	close(fd);
+}
+
+static bool read_registry(time_t apps_mtime, std::vector<Info>& apps) {
+	auto file_res = Duck::MappedFile::map(Path(LIBAPP_REGISTRY_PATH));
+	if(file_res.is_error())
+		return false;
+	auto& file = file_res.value();
+	auto* header = file->data<RegistryHeader>();
+	if(file->size() < sizeof(RegistryHeader) || header->magic != LIBAPP_REGISTRY_MAGIC ||
+	   header->version != LIBAPP_REGISTRY_VERSION || header->apps_mtime != apps_mtime || header->size != file->size())
+		return false;
+	auto* buf = file->data<uint8_t>() + sizeof(RegistryHeader);
+	Duck::Serialization::deserialize(buf, apps);
+	return true;
+}
+
+static void write_registry(time_t apps_mtime, const std::vector<Info>& apps) {
+	size_t size = sizeof(RegistryHeader) + Duck::Serialization::buffer_size(apps);
+	std::vector<uint8_t> data(size);
+	*((RegistryHeader*) data.data()) = {LIBAPP_REGISTRY_MAGIC, LIBAPP_REGISTRY_VERSION, apps_mtime, size};
+	auto* buf = data.data() + sizeof(RegistryHeader);
+	Duck::Serialization::serialize(buf, apps);
+
+	//Write to a temporary file first, so nobody reads a registry that's only partly written
+	auto temp_path = std::string(LIBAPP_REGISTRY_PATH) + ".tmp" + std::to_string(getpid());
+	FILE* file = fopen(temp_path.c_str(), "w");
+	if(!file)
+		return;
+	bool success = fwrite(data.data(), 1, size, file) == size;
+	fclose(file);
+	if(!success || rename(temp_path.c_str(), LIBAPP_REGISTRY_PATH))
+		unlink(temp_path.c_str());
+}
+
 std::vector<Info> App::get_all_apps() {
 	static std::vector<Info> ret;
 	if(!ret.empty())
 		return ret;
+
+	//Installing or removing an app modifies the apps directory, which is all we need to check to know the registry is current
+	struct stat apps_stat;
+	if(stat(LIBAPP_BASEPATH, &apps_stat) < 0)
+		return ret;
+	if(read_registry(apps_stat.st_mtime, ret))
+		return ret;
+	ret.clear();
+
 	auto ent_res = Path(LIBAPP_BASEPATH).get_directory_entries();
 	if(ent_res.is_error())
 		return ret;
@@ -198,11 +280,16 @@ std::vector<Info> App::get_all_apps() {
 		if(ent.is_directory()) {
 			if(ent.path().extension() == "app") {
 				auto app_res = Info::from_app_directory(ent.path());
-				if(!app_res.is_error())
-					ret.push_back(app_res.value());
+				if(!app_res.is_error()) {
+					//Load the icon now, so it's decoded in the registry
+					auto app = app_res.value();
+					app.icon();
+					ret.push_back(app);
+				}
 			}
 		}
 	}
+	write_registry(apps_stat.st_mtime, ret);
 	return ret;
 }
 
@@ -30,6 +30,8 @@
 
 #define LIBAPP_BASEPATH "/apps"
 #define LIBAPP_MISSING_ICON "/usr/share/icons/missing_icon.icon/16x16.png"
+#define LIBAPP_PREFETCH_PATH "/var/prefetch/apps"
+#define LIBAPP_REGISTRY_PATH "/var/cache/apps/registry"
 
 namespace App {
 	class Info: public Duck::Serializable {
@@ -60,6 +62,9 @@ namespace App {
 		void deserialize(const uint8_t*& buf) override;
 
 	private:
+		/// Starts reading in the pages of files the app used the last time it was recorded starting up, if it was.
+		void prefetch() const;
+
 		bool _exists = false;
 		Duck::Path _base_path;
 		std::string _name;
@@ -71,6 +76,10 @@ namespace App {
 	};
 
 
+	/**
+	 * Gets every installed app, along with its icon. These are read from the registry at LIBAPP_REGISTRY_PATH, which is
+	 * made again from the apps' directories whenever the apps directory has been modified since it was last made.
+	 */
 	std::vector<Info> get_all_apps();
 	Duck::ResultRet<Info> app_for_file(Duck::Path file);
 	Duck::Result open(Duck::Path file, bool fork = true);
@@ -34,6 +34,9 @@ struct __attribute__((packed)) krnl_dirent {
 	char name[];
 };
 
+//The size of the buffer readdir reads entries into. It has to be big enough for at least one entry with the longest name.
+#define DIRBUFSZ 8192
+
 DIR *opendir(const char *name) {
 	int fd = open(name, O_RDONLY | O_DIRECTORY);
 	if (fd == -1)
@@ -54,25 +57,21 @@ int __read_dir(int file, char *ptr, size_t len) {
 }
 
 struct dirent *readdir(DIR *dirp) {
-	//If the buffer hasn't been initialized yet, initialize and read
-	if(!dirp->dd_buf) {
-		struct stat st;
-		fstat(dirp->dd_fd, &st);
-		size_t dirsize = st.st_size;
-		dirp->dd_buf = (char*)malloc(dirsize);
-		ssize_t res = __read_dir(dirp->dd_fd, dirp->dd_buf, dirsize);
-		dirp->dd_len = res;
-		if(res < 0) {
-			errno = -res;
-			free(dirp->dd_buf);
-			dirp->dd_buf = 0;
+	//If we've used up everything in the buffer, read as many more entries as will fit into it
+	if(dirp->dd_seek + sizeof(struct krnl_dirent) > dirp->dd_len) {
+		if(!dirp->dd_buf && !(dirp->dd_buf = (char*) malloc(DIRBUFSZ))) {
+			errno = ENOMEM;
 			return 0;
 		}
+		ssize_t res = __read_dir(dirp->dd_fd, dirp->dd_buf, DIRBUFSZ);
+		if(res < 0)
+			errno = -res;
+		dirp->dd_seek = 0;
+		dirp->dd_len = res > 0 ? res : 0;
+		if(res <= 0)
+			return 0;
 	}
 
-	//If the next entry would be out of the bounds of the buffer, return 0
-	if(dirp->dd_seek + sizeof(struct krnl_dirent) >= dirp->dd_len) return 0;
-
 	struct krnl_dirent* kent = (struct krnl_dirent*)(dirp->dd_buf + dirp->dd_seek);
 	unsigned short reclen = sizeof(struct krnl_dirent) + sizeof(char) * kent->namelen;
 
@@ -83,8 +82,7 @@ struct dirent *readdir(DIR *dirp) {
 
 	//Copy information from krnl_dirent into dirent
 	dent->d_reclen = reclen;
-	for (size_t i = 0; i < kent->namelen; i++)
-		dent->d_name[i] = kent->name[i];
+	memcpy(dent->d_name, kent->name, kent->namelen);
 	dent->d_name[kent->namelen] = '\0';
 	dent->d_ino = kent->inode;
 	dent->d_type = kent->mode;
@@ -101,7 +99,9 @@ int readdir_r(DIR* dirp, struct dirent** entry, struct dirent** result) {
 }
 
 void rewinddir(DIR *dirp) {
+	lseek(dirp->dd_fd, 0, SEEK_SET);
 	dirp->dd_seek = 0;
+	dirp->dd_len = 0;
 }
 
 int closedir(DIR *dirp) {
@@ -114,4 +114,8 @@ int closedir(DIR *dirp) {
 		dirp->dd_fd = -1;
 	free(dirp);
 	return rc;
+}
+
+int dirfd(DIR* dirp) {
+	return dirp->dd_fd;
 }
\ No newline at end of file
@@ -56,6 +56,7 @@ struct dirent* readdir(DIR *dirname);
 int readdir_r(DIR* dirp, struct dirent** entry, struct dirent** result);
 void rewinddir(DIR* dirp);
 int closedir(DIR* dirp);
+int dirfd(DIR* dirp);
 
 __DECL_END
 
@@ -17,4 +17,18 @@
     Copyright (c) Byteduck 2016-2020. All rights reserved.
 */
 
-int __errno = 0;
\ No newline at end of file
+#include <errno.h>
+
+/*
+ * libc.a is only used by the dynamic loader, which runs before there's any thread-local storage (and whose TLS offsets
+ * would clash with the executable's anyway), so only the shared libc gets a per-thread errno.
+ */
+#ifdef LIBC_SHARED
+static __thread int errno_value __attribute__((tls_model("initial-exec"))) = 0;
+#else
+static int errno_value = 0;
+#endif
+
+int* __errno_location() {
+	return &errno_value;
+}
\ No newline at end of file
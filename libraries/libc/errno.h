@@ -24,8 +24,8 @@
 #include <kernel/api/errno.h>
 
 __DECL_BEGIN
-extern int __errno;
-#define errno (__errno)
+int* __errno_location();
+#define errno (*__errno_location())
 __DECL_END
 
 #endif //DUCKOS_LIBC_ERRNO_H
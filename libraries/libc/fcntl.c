@@ -37,5 +37,23 @@ int openat(int dirfd, const char* pathname, int flags) {
 }
 
 int fcntl(int fd, int cmd, ...) {
-	return -1;
+	va_list list;
+	va_start(list, cmd);
+	int arg = va_arg(list, int);
+	va_end(list);
+	return syscall4(SYS_FCNTL, fd, cmd, arg);
+}
+
+ssize_t splice(int fd_in, off_t* off_in, int fd_out, off_t* off_out, size_t len, unsigned int flags) {
+	struct splice_args args = { fd_in, off_in, fd_out, off_out, len, flags };
+	return syscall2(SYS_SPLICE, (int) &args);
+}
+
+ssize_t tee(int fd_in, int fd_out, size_t len, unsigned int flags) {
+	return syscall4(SYS_TEE, fd_in, fd_out, len);
+}
+
+ssize_t copy_file_range(int fd_in, off_t* off_in, int fd_out, off_t* off_out, size_t len, unsigned int flags) {
+	struct splice_args args = { fd_in, off_in, fd_out, off_out, len, flags };
+	return syscall2(SYS_COPY_FILE_RANGE, (int) &args);
 }
\ No newline at end of file
@@ -23,12 +23,16 @@
 #include <sys/cdefs.h>
 #include <sys/types.h>
 #include <kernel/api/fcntl.h>
+#include <kernel/api/splice.h>
 
 __DECL_BEGIN
 
 int open(const char* pathname, int flags, ...);
 int openat(int dirfd, const char* pathname, int flags);
 int fcntl(int fd, int cmd, ...);
+ssize_t splice(int fd_in, off_t* off_in, int fd_out, off_t* off_out, size_t len, unsigned int flags);
+ssize_t tee(int fd_in, int fd_out, size_t len, unsigned int flags);
+ssize_t copy_file_range(int fd_in, off_t* off_in, int fd_out, off_t* off_out, size_t len, unsigned int flags);
 
 __DECL_END
 
@@ -0,0 +1,107 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "pthread.h"
+#include "threads.h"
+#include <errno.h>
+
+_Static_assert(sizeof(pthread_mutex_t) == sizeof(mtx_t), "pthread_mutex_t must be the same as mtx_t");
+_Static_assert(sizeof(pthread_cond_t) == sizeof(cnd_t), "pthread_cond_t must be the same as cnd_t");
+_Static_assert(PTHREAD_MUTEX_RECURSIVE == mtx_recursive, "Mutex types must match");
+
+#define AS_MTX(mutex) ((mtx_t*) (mutex))
+#define AS_CND(cond) ((cnd_t*) (cond))
+
+static int to_errno(int result) {
+	switch(result) {
+		case thrd_success:
+			return 0;
+		case thrd_busy:
+			return EBUSY;
+		case thrd_timedout:
+			return ETIMEDOUT;
+		case thrd_nomem:
+			return ENOMEM;
+		default:
+			return EINVAL;
+	}
+}
+
+int pthread_mutexattr_init(pthread_mutexattr_t* attr) {
+	attr->__type = PTHREAD_MUTEX_DEFAULT;
+	return 0;
+}
+
+int pthread_mutexattr_destroy(pthread_mutexattr_t* attr) {
+	return 0;
+}
+
+int pthread_mutexattr_settype(pthread_mutexattr_t* attr, int type) {
+	if(type != PTHREAD_MUTEX_NORMAL && type != PTHREAD_MUTEX_RECURSIVE)
+		return EINVAL;
+	attr->__type = type;
+	return 0;
+}
+
+int pthread_mutexattr_gettype(const pthread_mutexattr_t* attr, int* type) {
+	*type = attr->__type;
+	return 0;
+}
+
+int pthread_mutex_init(pthread_mutex_t* mutex, const pthread_mutexattr_t* attr) {
+	return to_errno(mtx_init(AS_MTX(mutex), attr ? attr->__type : PTHREAD_MUTEX_DEFAULT));
+}
+
+int pthread_mutex_destroy(pthread_mutex_t* mutex) {
+	mtx_destroy(AS_MTX(mutex));
+	return 0;
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) {
+	return to_errno(mtx_lock(AS_MTX(mutex)));
+}
+
+int pthread_mutex_trylock(pthread_mutex_t* mutex) {
+	return to_errno(mtx_trylock(AS_MTX(mutex)));
+}
+
+int pthread_mutex_timedlock(pthread_mutex_t* mutex, const struct timespec* abstime) {
+	return to_errno(mtx_timedlock(AS_MTX(mutex), abstime));
+}
+
+int pthread_mutex_unlock(pthread_mutex_t* mutex) {
+	return to_errno(mtx_unlock(AS_MTX(mutex)));
+}
+
+int pthread_condattr_init(pthread_condattr_t* attr) {
+	return 0;
+}
+
+int pthread_condattr_destroy(pthread_condattr_t* attr) {
+	return 0;
+}
+
+int pthread_cond_init(pthread_cond_t* cond, const pthread_condattr_t* attr) {
+	return to_errno(cnd_init(AS_CND(cond)));
+}
+
+int pthread_cond_destroy(pthread_cond_t* cond) {
+	cnd_destroy(AS_CND(cond));
+	return 0;
+}
+
+int pthread_cond_signal(pthread_cond_t* cond) {
+	return to_errno(cnd_signal(AS_CND(cond)));
+}
+
+int pthread_cond_broadcast(pthread_cond_t* cond) {
+	return to_errno(cnd_broadcast(AS_CND(cond)));
+}
+
+int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex) {
+	return to_errno(cnd_wait(AS_CND(cond), AS_MTX(mutex)));
+}
+
+int pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* abstime) {
+	return to_errno(cnd_timedwait(AS_CND(cond), AS_MTX(mutex), abstime));
+}
@@ -0,0 +1,13 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "sched.h"
+#include <sys/syscall.h>
+
+int sched_setaffinity(pid_t pid, size_t cpusetsize, const cpu_set_t* mask) {
+	return syscall4(SYS_SCHED_SETAFFINITY, pid, (int) cpusetsize, (int) mask);
+}
+
+int sched_getaffinity(pid_t pid, size_t cpusetsize, cpu_set_t* mask) {
+	return syscall4(SYS_SCHED_GETAFFINITY, pid, (int) cpusetsize, (int) mask);
+}
@@ -0,0 +1,14 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <sys/types.h>
+#include <kernel/api/sched.h>
+
+__DECL_BEGIN
+
+int sched_setaffinity(pid_t pid, size_t cpusetsize, const cpu_set_t* mask);
+int sched_getaffinity(pid_t pid, size_t cpusetsize, cpu_set_t* mask);
+
+__DECL_END
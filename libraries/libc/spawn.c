@@ -0,0 +1,155 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "spawn.h"
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+int posix_spawn(pid_t* pid, const char* path, const posix_spawn_file_actions_t* file_actions, const posix_spawnattr_t* attrp, char* const argv[], char* const envp[]) {
+	struct spawn_args args = {
+		.path = path,
+		.argv = argv,
+		.envp = envp,
+		.actions = file_actions ? file_actions->actions : NULL,
+		.num_actions = file_actions ? file_actions->num_actions : 0,
+		.flags = attrp ? attrp->flags : 0,
+		.pgroup = attrp ? attrp->pgroup : 0
+	};
+
+	// Unlike most calls, this returns the error instead of setting errno
+	int res = syscall2_noerr(SYS_SPAWN, (int) &args);
+	if(res < 0)
+		return -res;
+	if(pid)
+		*pid = res;
+	return 0;
+}
+
+int posix_spawnp(pid_t* pid, const char* file, const posix_spawn_file_actions_t* file_actions, const posix_spawnattr_t* attrp, char* const argv[], char* const envp[]) {
+	// If the path contains a slash, don't search the path
+	if(strchr(file, '/'))
+		return posix_spawn(pid, file, file_actions, attrp, argv, envp);
+
+	char* path = getenv("PATH");
+	if(!path)
+		path = DEFAULT_PATH;
+	path = strdup(path);
+
+	// Try each element of the path
+	int res = ENOENT;
+	char* save_ptr;
+	char* path_elem = strtok_r(path, ":", &save_ptr);
+	while(path_elem) {
+		size_t path_len = strlen(path_elem);
+		char* full_path = malloc(path_len + strlen(file) + 2);
+		strcpy(full_path, path_elem);
+		full_path[path_len] = '/';
+		strcpy(full_path + path_len + 1, file);
+
+		res = posix_spawn(pid, full_path, file_actions, attrp, argv, envp);
+		free(full_path);
+		if(res != ENOENT)
+			break;
+		path_elem = strtok_r(NULL, ":", &save_ptr);
+	}
+
+	free(path);
+	return res;
+}
+
+static struct spawn_file_action* add_action(posix_spawn_file_actions_t* file_actions) {
+	struct spawn_file_action* actions = realloc(file_actions->actions, (file_actions->num_actions + 1) * sizeof(struct spawn_file_action));
+	if(!actions)
+		return NULL;
+	file_actions->actions = actions;
+	struct spawn_file_action* action = &actions[file_actions->num_actions++];
+	memset(action, 0, sizeof(struct spawn_file_action));
+	return action;
+}
+
+int posix_spawn_file_actions_init(posix_spawn_file_actions_t* file_actions) {
+	file_actions->actions = NULL;
+	file_actions->num_actions = 0;
+	return 0;
+}
+
+int posix_spawn_file_actions_destroy(posix_spawn_file_actions_t* file_actions) {
+	for(int i = 0; i < file_actions->num_actions; i++)
+		free((char*) file_actions->actions[i].path);
+	free(file_actions->actions);
+	file_actions->actions = NULL;
+	file_actions->num_actions = 0;
+	return 0;
+}
+
+int posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t* file_actions, int fd, int new_fd) {
+	if(fd < 0 || new_fd < 0)
+		return EBADF;
+	struct spawn_file_action* action = add_action(file_actions);
+	if(!action)
+		return ENOMEM;
+	action->type = SPAWN_ACTION_DUP2;
+	action->fd = fd;
+	action->new_fd = new_fd;
+	return 0;
+}
+
+int posix_spawn_file_actions_addclose(posix_spawn_file_actions_t* file_actions, int fd) {
+	if(fd < 0)
+		return EBADF;
+	struct spawn_file_action* action = add_action(file_actions);
+	if(!action)
+		return ENOMEM;
+	action->type = SPAWN_ACTION_CLOSE;
+	action->fd = fd;
+	return 0;
+}
+
+int posix_spawn_file_actions_addchdir_np(posix_spawn_file_actions_t* file_actions, const char* path) {
+	char* path_copy = strdup(path);
+	if(!path_copy)
+		return ENOMEM;
+	struct spawn_file_action* action = add_action(file_actions);
+	if(!action) {
+		free(path_copy);
+		return ENOMEM;
+	}
+	action->type = SPAWN_ACTION_CHDIR;
+	action->path = path_copy;
+	return 0;
+}
+
+int posix_spawnattr_init(posix_spawnattr_t* attr) {
+	attr->flags = 0;
+	attr->pgroup = 0;
+	return 0;
+}
+
+int posix_spawnattr_destroy(posix_spawnattr_t* attr) {
+	return 0;
+}
+
+int posix_spawnattr_getflags(const posix_spawnattr_t* attr, short* flags) {
+	*flags = attr->flags;
+	return 0;
+}
+
+int posix_spawnattr_setflags(posix_spawnattr_t* attr, short flags) {
+	if(flags & ~POSIX_SPAWN_SETPGROUP)
+		return EINVAL;
+	attr->flags = flags;
+	return 0;
+}
+
+int posix_spawnattr_getpgroup(const posix_spawnattr_t* attr, pid_t* pgroup) {
+	*pgroup = attr->pgroup;
+	return 0;
+}
+
+int posix_spawnattr_setpgroup(posix_spawnattr_t* attr, pid_t pgroup) {
+	attr->pgroup = pgroup;
+	return 0;
+}
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <sys/types.h>
+#include <kernel/api/spawn.h>
+
+__DECL_BEGIN
+
+typedef struct {
+	struct spawn_file_action* actions;
+	int num_actions;
+} posix_spawn_file_actions_t;
+
+typedef struct {
+	short flags;
+	pid_t pgroup;
+} posix_spawnattr_t;
+
+int posix_spawn(pid_t* pid, const char* path, const posix_spawn_file_actions_t* file_actions, const posix_spawnattr_t* attrp, char* const argv[], char* const envp[]);
+int posix_spawnp(pid_t* pid, const char* file, const posix_spawn_file_actions_t* file_actions, const posix_spawnattr_t* attrp, char* const argv[], char* const envp[]);
+
+int posix_spawn_file_actions_init(posix_spawn_file_actions_t* file_actions);
+int posix_spawn_file_actions_destroy(posix_spawn_file_actions_t* file_actions);
+int posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t* file_actions, int fd, int new_fd);
+int posix_spawn_file_actions_addclose(posix_spawn_file_actions_t* file_actions, int fd);
+int posix_spawn_file_actions_addchdir_np(posix_spawn_file_actions_t* file_actions, const char* path);
+
+int posix_spawnattr_init(posix_spawnattr_t* attr);
+int posix_spawnattr_destroy(posix_spawnattr_t* attr);
+int posix_spawnattr_getflags(const posix_spawnattr_t* attr, short* flags);
+int posix_spawnattr_setflags(posix_spawnattr_t* attr, short flags);
+int posix_spawnattr_getpgroup(const posix_spawnattr_t* attr, pid_t* pgroup);
+int posix_spawnattr_setpgroup(posix_spawnattr_t* attr, pid_t pgroup);
+
+__DECL_END
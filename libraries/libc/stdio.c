@@ -17,80 +17,105 @@
     Copyright (c) Byteduck 2016-2020. All rights reserved.
 */
 
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/internals.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/syscall.h>
 #include <fcntl.h>
 #include <stdbool.h>
+#include <threads.h>
+#include <errno.h>
 #include <sys/printf.h>
 #include <sys/scanf.h>
 
+//The most a stream will buffer at once, no matter how big the file's st_blksize is
+#define MAX_BUFSIZ (64 * 1024)
+//How many characters can be pushed back with ungetc() when there's no room for them in the read buffer
+#define UNGET_SIZE 8
+
 struct FILE {
+	struct __FILE_buffer buf; //Has to come first, since the inline functions in stdio.h use it
 	int fd;
 	int options;
-	int ungetc;
 	int eof;
-	ssize_t err;
-	char* buffer;
+	int err;
+	unsigned char* buffer; //The buffer, or NULL if it hasn't been allocated yet or the stream is unbuffered
 	uint8_t bufmode; //The buffer mode (_IOFBF, _IOLBF, _IONBF)
-	size_t offset; //The current offset into the buffer
-	size_t bufavail; //The amount of bytes from the beginning of the buffer that can be read
-	size_t bufsiz; //The size of the buffer
+	bool free_buffer; //Whether we allocated the buffer, and should free it
+	size_t bufsiz; //The size of the buffer, or the size to allocate it with (0 to pick one based on the file)
+	unsigned char unget[UNGET_SIZE]; //Holds characters pushed back with ungetc() and unbuffered reads
+	unsigned char* saved_rpos; //Where reading picks back up once the characters in unget run out
+	unsigned char* saved_rend;
+	mtx_t lock;
 	FILE* next; //The next file in the linked list of all open files
 	FILE* prev; //The previous file in the linked list of all open files
 };
 
-bool can_read(FILE* file) {
+//Streams are only locked once there's more than one thread, since nothing else could be using them before then
+#define LOCK(mutex) bool __locked = __libc_threaded && !mtx_lock(mutex)
+#define UNLOCK(mutex) do { if(__locked) mtx_unlock(mutex); } while(0)
+
+static bool can_read(FILE* file) {
 	return file->options & O_RDWR || !(file->options & O_WRONLY);
 }
 
-bool can_write(FILE* file) {
+static bool can_write(FILE* file) {
 	return file->options & O_RDWR || file->options & O_WRONLY;
 }
 
 FILE __stdin = {
+		.buf = {NULL, NULL, NULL, NULL, EOF},
 		.fd = STDIN_FILENO,
 		.options = O_RDONLY,
-		.ungetc = -1,
 		.eof = 0,
 		.err = 0,
 		.buffer = NULL,
-		.bufmode = _IONBF,
-		.offset = 0,
-		.bufavail = 0,
+		.bufmode = _IOLBF,
+		.free_buffer = false,
 		.bufsiz = 0,
+		.saved_rpos = NULL,
+		.saved_rend = NULL,
+		.lock = {0, mtx_recursive, 0, 0},
 		.next = &__stdout,
 		.prev = NULL
 };
 
 FILE __stdout = {
+		.buf = {NULL, NULL, NULL, NULL, EOF},
 		.fd = STDOUT_FILENO,
 		.options = O_WRONLY,
-		.ungetc = -1,
 		.eof = 0,
 		.err = 0,
 		.buffer = NULL,
 		.bufmode = _IONBF,
-		.offset = 0,
-		.bufavail = 0,
+		.free_buffer = false,
 		.bufsiz = 0,
+		.saved_rpos = NULL,
+		.saved_rend = NULL,
+		.lock = {0, mtx_recursive, 0, 0},
 		.next = &__stderr,
 		.prev = &__stdin
 };
 
 FILE __stderr = {
+		.buf = {NULL, NULL, NULL, NULL, EOF},
 		.fd = STDERR_FILENO,
 		.options = O_WRONLY,
-		.ungetc = -1,
 		.eof = 0,
 		.err = 0,
 		.buffer = NULL,
 		.bufmode = _IONBF,
-		.offset = 0,
-		.bufavail = 0,
+		.free_buffer = false,
 		.bufsiz = 0,
+		.saved_rpos = NULL,
+		.saved_rend = NULL,
+		.lock = {0, mtx_recursive, 0, 0},
 		.next = NULL,
 		.prev = &__stdout
 };
@@ -98,21 +123,29 @@ FILE __stderr = {
 //File stuff
 FILE* filelist_first = &__stdin;
 FILE* filelist_last = &__stderr;
+mtx_t filelist_lock = {0, mtx_plain, 0, 0};
+
 
 void filelist_insert(FILE* file) {
+	LOCK(&filelist_lock);
 	filelist_last->next = file;
 	file->prev = filelist_last;
 	file->next = NULL;
 	filelist_last = file;
+	UNLOCK(&filelist_lock);
 }
 
 void filelist_remove(FILE* file) {
+	LOCK(&filelist_lock);
 	if(file->next)
 		file->next->prev = file->prev;
 	if(file->prev)
 		file->prev->next = file->next;
+	if(file == filelist_first)
+		filelist_first = file->next;
 	if(file == filelist_last)
 		filelist_last = file->prev;
+	UNLOCK(&filelist_lock);
 }
 
 int remove(const char* filename) {
@@ -134,49 +167,230 @@ char* tmpnam(char* s) {
 	return NULL;
 }
 
+//Buffering
+/** Picks a buffer size that's a whole number of the file's blocks, so full buffers are written a block at a time. **/
+static size_t preferred_bufsiz(FILE* stream) {
+	struct stat st;
+	if(fstat(stream->fd, &st) < 0 || st.st_blksize <= 0)
+		return BUFSIZ;
+	size_t blksize = st.st_blksize;
+	size_t size = ((BUFSIZ + blksize - 1) / blksize) * blksize;
+	return size > MAX_BUFSIZ ? MAX_BUFSIZ : size;
+}
+
+/** Allocates a buffer for the stream the first time it's used. If that fails, the stream just goes unbuffered. **/
+static void allocate_buffer(FILE* stream) {
+	if(!stream->bufsiz)
+		stream->bufsiz = preferred_bufsiz(stream);
+	stream->buffer = malloc(stream->bufsiz);
+	if(!stream->buffer) {
+		stream->bufmode = _IONBF;
+		stream->bufsiz = 0;
+		stream->buf.__lbf = EOF;
+		return;
+	}
+	stream->free_buffer = true;
+}
+
+/**
+ * Writes out what's in the write buffer followed by len bytes of data, in one writev() if the file takes it all.
+ * Afterwards the write buffer is empty, even if writing failed.
+ */
+static int flush_with(FILE* stream, const void* data, size_t len) {
+	struct iovec iov[2] = {
+		{stream->buffer, stream->buf.__wpos ? stream->buf.__wpos - stream->buffer : 0},
+		{(void*) data, len}
+	};
+	struct iovec* cur = iov[0].iov_len ? &iov[0] : &iov[1];
+	int count = cur == iov ? 2 : 1;
+	if(stream->buf.__wpos)
+		stream->buf.__wpos = stream->buffer;
+	while(count && cur->iov_len) {
+		ssize_t nwritten = writev(stream->fd, cur, count);
+		if(nwritten <= 0) {
+			stream->err = nwritten < 0 ? errno : EIO;
+			errno = stream->err;
+			return EOF;
+		}
+		while(count && (size_t) nwritten >= cur->iov_len) {
+			nwritten -= cur->iov_len;
+			cur++;
+			count--;
+		}
+		if(count) {
+			cur->iov_base = (uint8_t*) cur->iov_base + nwritten;
+			cur->iov_len -= nwritten;
+		}
+	}
+	return 0;
+}
+
+/** How many characters have been read into the buffers but not taken yet, including any pushed back by ungetc(). **/
+static size_t unread(FILE* stream) {
+	size_t count = stream->buf.__rend - stream->buf.__rpos;
+	if(stream->saved_rend)
+		count += stream->saved_rend - stream->saved_rpos;
+	return count;
+}
+
+/** Throws away whatever's left in the read buffer, seeking back so the file's offset is where the user expects it. **/
+static int drop_read(FILE* stream) {
+	size_t count = unread(stream);
+	stream->buf.__rpos = stream->buf.__rend = NULL;
+	stream->saved_rpos = stream->saved_rend = NULL;
+	if(count && lseek(stream->fd, -(off_t) count, SEEK_CUR) < 0) {
+		//Can't seek pipes, we don't care
+		if(errno == ESPIPE) {
+			errno = 0;
+			return 0;
+		}
+		stream->err = errno;
+		return EOF;
+	}
+	return 0;
+}
+
+/** Gets the stream ready to be read from, writing out anything that was buffered to be written first. **/
+static int start_reading(FILE* stream) {
+	if(!can_read(stream)) {
+		stream->err = errno = EBADF;
+		return EOF;
+	}
+	if(stream->buf.__wpos) {
+		int res = flush_with(stream, NULL, 0);
+		stream->buf.__wpos = stream->buf.__wend = NULL;
+		if(res)
+			return EOF;
+	}
+	if(!stream->buffer && stream->bufmode != _IONBF)
+		allocate_buffer(stream);
+	return 0;
+}
+
+/** Gets the stream ready to be written to, throwing away anything that was buffered from reading it first. **/
+static int start_writing(FILE* stream) {
+	if(!can_write(stream)) {
+		stream->err = errno = EBADF;
+		return EOF;
+	}
+	if(stream->buf.__rend && drop_read(stream))
+		return EOF;
+	if(!stream->buffer && stream->bufmode != _IONBF)
+		allocate_buffer(stream);
+	if(!stream->buf.__wpos && stream->buffer) {
+		stream->buf.__wpos = stream->buffer;
+		stream->buf.__wend = stream->buffer + stream->bufsiz;
+	}
+	return 0;
+}
+
+static int flush_unlocked(FILE* stream) {
+	if(stream->buf.__wpos)
+		return flush_with(stream, NULL, 0);
+	if(stream->buf.__rend)
+		return drop_read(stream);
+	return 0;
+}
+
+/** Waiting for input shows whatever's been written to stdout first, so that prompts appear before they're answered. **/
+static void flush_line_buffered() {
+	if(stdout->bufmode != _IOFBF && stdout->buf.__wpos != stdout->buffer) {
+		LOCK(&stdout->lock);
+		flush_unlocked(stdout);
+		UNLOCK(&stdout->lock);
+	}
+}
+
+/** Reads as much as will fit in the buffer. Returns how many characters were read, or 0 at the end of the file. **/
+static size_t fill(FILE* stream) {
+	if(stream->bufmode != _IOFBF)
+		flush_line_buffered();
+
+	//If we previously reached eof, don't try again until it's cleared
+	if(stream->eof)
+		return 0;
+
+	//Unbuffered streams read a character at a time, into the end of the space for characters pushed back by ungetc()
+	unsigned char* dest = stream->buffer ? stream->buffer : stream->unget + UNGET_SIZE - 1;
+	ssize_t nread = read(stream->fd, dest, stream->buffer ? stream->bufsiz : 1);
+	if(nread <= 0) {
+		if(nread < 0)
+			stream->err = errno;
+		else
+			stream->eof = 1;
+		return 0;
+	}
+	stream->buf.__rpos = dest;
+	stream->buf.__rend = dest + nread;
+	return nread;
+}
+
+int __uflow(FILE* stream) {
+	//Pick back up where we were once the characters pushed back by ungetc() run out
+	if(stream->saved_rend) {
+		stream->buf.__rpos = stream->saved_rpos;
+		stream->buf.__rend = stream->saved_rend;
+		stream->saved_rpos = stream->saved_rend = NULL;
+		if(stream->buf.__rpos != stream->buf.__rend)
+			return *stream->buf.__rpos++;
+	}
+
+	if(start_reading(stream) || !fill(stream))
+		return EOF;
+	return *stream->buf.__rpos++;
+}
+
+int __overflow(FILE* stream, int c) {
+	unsigned char ch = c;
+	if(start_writing(stream))
+		return EOF;
+
+	if(!stream->buffer) {
+		if(flush_with(stream, &ch, 1))
+			return EOF;
+		return ch;
+	}
+
+	if(stream->buf.__wpos == stream->buf.__wend && flush_with(stream, NULL, 0))
+		return EOF;
+	*stream->buf.__wpos++ = ch;
+	if(ch == stream->buf.__lbf && flush_with(stream, NULL, 0))
+		return EOF;
+	return ch;
+}
+
 int fclose(FILE* stream) {
-	int flush_result = fflush(stream);
+	LOCK(&stream->lock);
+	int flush_result = flush_unlocked(stream);
+	UNLOCK(&stream->lock);
 	int close_result = close(stream->fd);
 	if(flush_result < 0)
 		errno = stream->err;
 	filelist_remove(stream);
-	if(stream->buffer)
+	if(stream->free_buffer)
 		free(stream->buffer);
-	free(stream);
+	if(stream != stdin && stream != stdout && stream != stderr)
+		free(stream);
 	return !flush_result && !close_result ? 0 : -1;
 }
 
 int fflush(FILE* stream) {
-	if(stream->bufmode == _IONBF)
-		return 0;
-
-	if(can_write(stream) && !stream->bufavail) {
-		//Flush the data written to the buffer
-		int res = write(stream->fd, stream->buffer, stream->offset);
-		if(res < 0)
-			stream->err = errno;
+	if(stream) {
+		LOCK(&stream->lock);
+		int res = flush_unlocked(stream);
+		UNLOCK(&stream->lock);
+		return res;
 	}
 
-	if(can_read(stream) && stream->bufavail) {
-		//Seek back to where we were in the read buffer so it's where the user expects
-		int res = lseek(stream->fd, -(stream->bufavail - stream->offset), SEEK_CUR);
-		if(res < 0) {
-			//Can't seek pipes, we don't care
-			if(errno == ESPIPE) {
-				errno = 0;
-				return 0;
-			}
-
-			stream->err = errno;
-			return -1;
-		}
+	//Flush everything that's open
+	int res = 0;
+	LOCK(&filelist_lock);
+	for(FILE* cur = filelist_first; cur; cur = cur->next) {
+		if(cur->buf.__wpos && fflush(cur))
+			res = EOF;
 	}
-
-	//Clear the buffer
-	stream->offset = 0;
-	stream->bufavail = 0;
-
-	return 0;
+	UNLOCK(&filelist_lock);
+	return res;
 }
 
 int extended_char_option(char opt) {
@@ -226,6 +440,21 @@ int parse_str_options(const char* mode) {
 	return options;
 }
 
+/** Makes a FILE for an open fd. Its buffer isn't allocated until it's first used. **/
+static FILE* make_file(int fd, int options) {
+	FILE* ret = malloc(sizeof(FILE));
+	if(!ret)
+		return NULL;
+	memset(ret, 0, sizeof(FILE));
+	ret->fd = fd;
+	ret->options = options;
+	ret->bufmode = _IOFBF;
+	ret->buf.__lbf = EOF;
+	mtx_init(&ret->lock, mtx_recursive);
+	filelist_insert(ret);
+	return ret;
+}
+
 FILE* fopen(const char* filename, const char* mode) {
 	//Parse options
 	int options = parse_str_options(mode);
@@ -239,24 +468,14 @@ FILE* fopen(const char* filename, const char* mode) {
 		truncate(filename, 0);
 
 	//Open fd
-	int fd = open(filename, options);
+	int fd = open(filename, options, 0666);
 	if(fd == -1)
 		return NULL;
 
 	//Make the file
-	FILE* ret = malloc(sizeof(FILE));
-	ret->fd = fd;
-	ret->options = options;
-	ret->ungetc = -1;
-	ret->eof = 0;
-	ret->err = 0;
-	ret->bufsiz = 0;
-	ret->buffer = NULL;
-	ret->bufavail = 0;
-	ret->offset = 0;
-	setvbuf(ret, NULL, _IOFBF, BUFSIZ);
-	filelist_insert(ret);
-
+	FILE* ret = make_file(fd, options);
+	if(!ret)
+		close(fd);
 	return ret;
 }
 
@@ -269,19 +488,7 @@ FILE* fdopen(int fd, const char* mode) {
 	}
 
 	//Make the file
-	FILE* ret = malloc(sizeof(FILE));
-	ret->fd = fd;
-	ret->options = options;
-	ret->ungetc = -1;
-	ret->eof = 0;
-	ret->err = 0;
-	ret->bufsiz = 0;
-	ret->buffer = NULL;
-	ret->bufavail = 0;
-	ret->offset = 0;
-	setvbuf(ret, NULL, _IOFBF, BUFSIZ);
-
-	return 0;
+	return make_file(fd, options);
 }
 
 FILE* freopen(const char* filename, const char* mode, FILE* stream) {
@@ -298,25 +505,27 @@ int setvbuf(FILE* stream, char* buf, int mode, size_t size) {
 		return -1;
 
 	//Free the previous buffer if there is one
-	fflush(stream);
-	if(stream->buffer)
+	LOCK(&stream->lock);
+	flush_unlocked(stream);
+	stream->buf.__rpos = stream->buf.__rend = NULL;
+	stream->buf.__wpos = stream->buf.__wend = NULL;
+	if(stream->free_buffer)
 		free(stream->buffer);
+	stream->buffer = NULL;
+	stream->free_buffer = false;
 
-	//If the mode is _IONBF, don't set a buffer
+	//Set the buffer if we were given one. Otherwise, one of the requested size is allocated when it's first needed
 	stream->bufmode = mode;
+	stream->buf.__lbf = mode == _IOLBF ? '\n' : EOF;
 	if(mode == _IONBF) {
-		stream->buffer = NULL;
 		stream->bufsiz = 0;
-		return 0;
+	} else {
+		if(buf && size)
+			stream->buffer = (unsigned char*) buf;
+		stream->bufsiz = size;
 	}
 
-	//Allocate or set the buffer
-	if(buf)
-		stream->buffer = buf;
-	else
-		stream->buffer = malloc(size);
-	stream->bufsiz = size;
-
+	UNLOCK(&stream->lock);
 	return 0;
 }
 
@@ -384,11 +593,24 @@ int sscanf(const char* s, const char* format, ...) {
 }
 
 int vfprintf(FILE* stream, const char* format, va_list arg) {
-	char* str;
-	int ret = vasprintf(&str, format, arg);
-	fwrite(str, ret, 1, stream);
+	//Most output fits on the stack, so it only has to be allocated when it doesn't
+	char buffer[256];
+	va_list arg_copy;
+	va_copy(arg_copy, arg);
+	int ret = vsnprintf(buffer, sizeof(buffer), format, arg_copy);
+	va_end(arg_copy);
+	if(ret < 0)
+		return ret;
+	if((size_t) ret < sizeof(buffer))
+		return fwrite(buffer, 1, ret, stream) == (size_t) ret ? ret : -1;
+
+	char* str = malloc(ret + 1);
+	if(!str)
+		return -1;
+	vsnprintf(str, ret + 1, format, arg);
+	size_t written = fwrite(str, 1, ret, stream);
 	free(str);
-	return ret;
+	return written == (size_t) ret ? ret : -1;
 }
 
 int vfscanf(FILE* stream, const char* format, va_list arg) {
@@ -415,70 +637,81 @@ int vsscanf(const char* s, const char* format, va_list arg) {
 }
 
 int vasprintf(char** s, const char* format, va_list arg) {
-	// TODO: This frequently truncates output
-	size_t len = strlen(format) + 1000;
-	*s = malloc(len);
-	return vsnprintf(*s, len, format, arg);
+	va_list arg_copy;
+	va_copy(arg_copy, arg);
+	int len = vsnprintf(NULL, 0, format, arg_copy);
+	va_end(arg_copy);
+	if(len < 0)
+		return len;
+	*s = malloc(len + 1);
+	if(!*s)
+		return -1;
+	return vsnprintf(*s, len + 1, format, arg);
 }
 
 int vsnprintf(char* s, size_t n, const char* format, va_list arg) {
 	return common_printf(s, n, format, arg);
 }
 
+
 //Character input/output
 int fgetc(FILE* stream) {
-	char buf[1];
-	if(fread(buf, 1, 1, stream) != 1) {
-		stream->eof = 1;
-		return EOF;
-	}
-	return (unsigned char) *buf;
+	LOCK(&stream->lock);
+	int c = __getc_unlocked(stream);
+	UNLOCK(&stream->lock);
+	return c;
 }
 
 char* fgets(char* s, int n, FILE* stream) {
-	int c;
-	char* os = s;
-
-	if(n == 1) {
-		*s = '\0';
-		return os;
-	}
-
-	while((c = fgetc(stream)) >= 0) {
-		*s++ = c;
-
-		//If we've read n-1 characters, null-terminate the string and return it
-		n--;
-		if(n == 1) {
-			*s = '\0';
-			return os;
-		}
+	if(n <= 0)
+		return NULL;
 
-		//Return it if we encounter a newline
-		*s = '\0';
-		if(c == '\n') {
-			return os;
+	LOCK(&stream->lock);
+	char* out = s;
+	size_t left = n - 1;
+	while(left) {
+		//Copy straight out of the buffer up to the first newline, so long lines aren't read a character at a time
+		size_t avail = stream->buf.__rend - stream->buf.__rpos;
+		if(avail) {
+			size_t count = avail < left ? avail : left;
+			unsigned char* newline = memchr(stream->buf.__rpos, '\n', count);
+			if(newline)
+				count = newline - stream->buf.__rpos + 1;
+			memcpy(out, stream->buf.__rpos, count);
+			stream->buf.__rpos += count;
+			out += count;
+			left -= count;
+			if(newline)
+				break;
+			continue;
 		}
-	}
 
-	if(c == EOF) {
-		stream->eof = 1;
-		return os == s ? NULL : os;
+		int c = __uflow(stream);
+		if(c == EOF)
+			break;
+		*out++ = c;
+		left--;
+		if(c == '\n')
+			break;
 	}
+	UNLOCK(&stream->lock);
 
-	return NULL;
+	if(out == s && n > 1)
+		return NULL;
+	*out = '\0';
+	return s;
 }
 
 int fputc(int c, FILE* stream) {
-	if(fwrite(&c, 1, 1, stream) == -1) {
-		stream->eof = 1;
-		return EOF;
-	}
+	LOCK(&stream->lock);
+	c = __putc_unlocked(c, stream);
+	UNLOCK(&stream->lock);
 	return c;
 }
 
 int fputs(const char* s, FILE* stream) {
-	if(fwrite(s, 1, strlen(s), stream) == -1)
+	size_t len = strlen(s);
+	if(fwrite(s, 1, len, stream) != len)
 		return EOF;
 	return 0;
 }
@@ -499,121 +732,201 @@ int putchar(int c) {
 	return fputc(c, stdout);
 }
 
+static size_t fwrite_unlocked(const void* ptr, size_t len, FILE* stream);
+
 int puts(const char* s) {
-	fwrite(s, 1, strlen(s), stdout);
-	fwrite("\n", 1, 1, stdout);
-	return 0;
+	LOCK(&stdout->lock);
+	size_t len = strlen(s);
+	int res = fwrite_unlocked(s, len, stdout) == len && __putc_unlocked('\n', stdout) != EOF ? 0 : EOF;
+	UNLOCK(&stdout->lock);
+	return res;
 }
 
 int ungetc(int c, FILE* stream) {
-	if(stream->ungetc != -1)
+	if(c == EOF)
 		return EOF;
 
-	stream->ungetc = c;
-	return c;
+	LOCK(&stream->lock);
+	int ret = EOF;
+	if(!start_reading(stream)) {
+		//If there's no room for it before what's left in the read buffer, it goes in unget until it's read again
+		bool in_unget = stream->buf.__rend == stream->unget + UNGET_SIZE;
+		if(!in_unget && (!stream->buf.__rpos || stream->buf.__rpos == stream->buffer)) {
+			stream->saved_rpos = stream->buf.__rpos;
+			stream->saved_rend = stream->buf.__rend;
+			stream->buf.__rpos = stream->buf.__rend = stream->unget + UNGET_SIZE;
+			in_unget = true;
+		}
+		if(stream->buf.__rpos > (in_unget ? stream->unget : stream->buffer)) {
+			*--stream->buf.__rpos = c;
+			stream->eof = 0;
+			ret = (unsigned char) c;
+		}
+	}
+	UNLOCK(&stream->lock);
+	return ret;
 }
 
-//Direct input/output
-size_t fread(void* ptr, size_t size, size_t count, FILE* stream) {
-	if(!count || !size)
-		return 0;
+//Locking
+void flockfile(FILE* stream) {
+	mtx_lock(&stream->lock);
+}
 
-	char* buf = (char*) ptr;
-	size_t len = count * size;
-	size_t nread = 0;
+int ftrylockfile(FILE* stream) {
+	return mtx_trylock(&stream->lock) == thrd_success ? 0 : -1;
+}
 
-	//If we have something in ungetc, first account for that
-	if(stream->ungetc >= 0) {
-		*(buf++) = stream->ungetc;
-		stream->ungetc = -1;
-		nread++;
-		len--;
-	}
+void funlockfile(FILE* stream) {
+	mtx_unlock(&stream->lock);
+}
 
-	//If we don't have a buffer, just read directly
-	if(stream->bufmode == _IONBF) {
-		//Read directly from the file
-		ssize_t res = read(stream->fd, buf, len);
-		if(res < 0)
-			stream->err = res;
-		else if(res < len)
-			stream->eof = 1;
-		else
-			nread += res;
+#undef getc_unlocked
+#undef getchar_unlocked
+#undef putc_unlocked
+#undef putchar_unlocked
 
-		return nread / size;
-	}
+int getc_unlocked(FILE* stream) {
+	return __getc_unlocked(stream);
+}
+
+int getchar_unlocked() {
+	return __getc_unlocked(stdin);
+}
+
+int putc_unlocked(int c, FILE* stream) {
+	return __putc_unlocked(c, stream);
+}
+
+int putchar_unlocked(int c) {
+	return __putc_unlocked(c, stdout);
+}
 
+//Direct input/output
+static size_t fread_unlocked(void* ptr, size_t len, FILE* stream) {
+	if(start_reading(stream))
+		return 0;
+
+	unsigned char* buf = (unsigned char*) ptr;
+	size_t nread = 0;
 	while(len) {
-		size_t bufleft = stream->bufavail - stream->offset;
-		size_t nbuf = bufleft < len ? bufleft : len;
+		//First take whatever's already been read into the buffer
+		size_t avail = stream->buf.__rend - stream->buf.__rpos;
+		if(avail) {
+			size_t count = avail < len ? avail : len;
+			memcpy(buf, stream->buf.__rpos, count);
+			stream->buf.__rpos += count;
+			buf += count;
+			nread += count;
+			len -= count;
+			continue;
+		}
+		if(stream->saved_rend) {
+			stream->buf.__rpos = stream->saved_rpos;
+			stream->buf.__rend = stream->saved_rend;
+			stream->saved_rpos = stream->saved_rend = NULL;
+			continue;
+		}
 
-		//If there's nothing left in the buffer, read into it
-		if(!nbuf) {
-			//If we previously reached eof, break
+		//Reads that would fill the buffer anyway go straight into the destination instead of being copied through it
+		if(!stream->buffer || len >= stream->bufsiz) {
+			if(stream->bufmode != _IOFBF)
+				flush_line_buffered();
 			if(stream->eof)
 				break;
-			fflush(stream);
-			ssize_t res = read(stream->fd, stream->buffer, stream->bufsiz);
+			ssize_t res = read(stream->fd, buf, len);
 			if(res < 0) {
 				stream->err = errno;
 				break;
-			} else if(res == 0)
+			} else if(res == 0) {
 				stream->eof = 1;
-			stream->bufavail = res;
+				break;
+			}
+			buf += res;
+			nread += res;
+			len -= res;
 			continue;
 		}
 
-		//Copy from the buffer
-		memcpy(buf, stream->buffer + stream->offset, nbuf);
-		buf += nbuf;
-		nread += nbuf;
-		len -= nbuf;
-		stream->offset += nbuf;
+		if(!fill(stream))
+			break;
 	}
 
+	return nread;
+}
+
+size_t fread(void* ptr, size_t size, size_t count, FILE* stream) {
+	if(!count || !size)
+		return 0;
+	LOCK(&stream->lock);
+	size_t nread = fread_unlocked(ptr, count * size, stream);
+	UNLOCK(&stream->lock);
 	return nread / size;
 }
 
-size_t fwrite(const void* ptr, size_t size, size_t count, FILE* stream) {
+static size_t fwrite_unlocked(const void* ptr, size_t len, FILE* stream) {
+	if(start_writing(stream))
+		return 0;
+
 	//If we're in no buffer mode, write directly
-	if(stream->bufmode == _IONBF) {
-		int res = write(stream->fd, ptr, count * size);
-		if(res < 0) {
-			stream->err = errno;
-			return 0;
+	const unsigned char* buf = (const unsigned char*) ptr;
+	if(!stream->buffer)
+		return flush_with(stream, buf, len) ? 0 : len;
+
+	//The common case, where it all fits in the buffer
+	size_t space = stream->buf.__wend - stream->buf.__wpos;
+	size_t flush_len = 0;
+	if(stream->bufmode == _IOLBF) {
+		for(size_t i = len; i; i--) {
+			if(buf[i - 1] == '\n') {
+				flush_len = i;
+				break;
+			}
 		}
-		return res;
+	}
+	if(!flush_len && len <= space) {
+		memcpy(stream->buf.__wpos, buf, len);
+		stream->buf.__wpos += len;
+		return len;
 	}
 
-	const char* buf = (const char*) ptr;
-	size_t len = count * size;
-	size_t nwrote = 0;
-
-	while(len) {
-		size_t bufleft = stream->bufsiz - stream->offset;
-		size_t nbuf = bufleft < len ? bufleft : len;
-
-		//If there's no space left in the buffer or we had previously used it for reading, flush
-		if(!nbuf || stream->bufavail) {
-			fflush(stream);
-			continue;
+	/*
+	 * Write out everything up to the last newline if we're line buffered, or all of it if what's left wouldn't fit in
+	 * an empty buffer. Whatever's already buffered goes out with it in the same write.
+	 */
+	size_t nwrite = len - flush_len >= stream->bufsiz ? len : flush_len;
+	if(nwrite) {
+		if(nwrite <= space) {
+			memcpy(stream->buf.__wpos, buf, nwrite);
+			stream->buf.__wpos += nwrite;
+			if(flush_with(stream, NULL, 0))
+				return 0;
+		} else if(flush_with(stream, buf, nwrite)) {
+			return 0;
 		}
+	}
 
-		//Copy to the buffer
-		memcpy(stream->buffer + stream->offset, buf, nbuf);
-		nwrote += nbuf;
-		len -= nbuf;
-		stream->offset += nbuf;
-		stream->bufavail = 0;
-
-		//If we are in line buffered mode and we wrote a newline, flush
-		if(stream->bufmode == _IOLBF && memchr(buf, '\n', nwrote))
-			fflush(stream);
-
-		buf += nbuf;
+	//Buffer the rest, which is less than a full buffer's worth
+	size_t nwrote = nwrite;
+	while(nwrote < len) {
+		size_t count = stream->buf.__wend - stream->buf.__wpos;
+		if(count > len - nwrote)
+			count = len - nwrote;
+		memcpy(stream->buf.__wpos, buf + nwrote, count);
+		stream->buf.__wpos += count;
+		nwrote += count;
+		if(stream->buf.__wpos == stream->buf.__wend && flush_with(stream, NULL, 0))
+			return nwrote - count;
 	}
 
+	return nwrote;
+}
+
+size_t fwrite(const void* ptr, size_t size, size_t count, FILE* stream) {
+	if(!count || !size)
+		return 0;
+	LOCK(&stream->lock);
+	size_t nwrote = fwrite_unlocked(ptr, count * size, stream);
+	UNLOCK(&stream->lock);
 	return nwrote / size;
 }
 
@@ -626,16 +939,14 @@ int fgetpos(FILE* stream, fpos_t* pos) {
 }
 
 int fseek(FILE* stream, long int offset, int whence) {
-	fflush(stream);
+	LOCK(&stream->lock);
+	flush_unlocked(stream);
 	stream->eof = 0;
-	stream->ungetc = -1;
 	off_t res = lseek(stream->fd, offset, whence);
-	if(res == -1) {
+	if(res == -1)
 		stream->err = errno;
-		return -1;
-	} else {
-		return 0;
-	}
+	UNLOCK(&stream->lock);
+	return res == -1 ? -1 : 0;
 }
 
 int fsetpos(FILE* stream, const fpos_t* pos) {
@@ -643,13 +954,22 @@ int fsetpos(FILE* stream, const fpos_t* pos) {
 }
 
 long int ftell(FILE* stream) {
-	if(fflush(stream) < 0)
-		return -1;
-	return lseek(stream->fd, 0, SEEK_CUR);
+	//Work out where the user is from the file's offset and what's buffered, so the buffer doesn't have to be thrown away
+	LOCK(&stream->lock);
+	off_t pos = lseek(stream->fd, 0, SEEK_CUR);
+	if(pos < 0)
+		stream->err = errno;
+	else if(stream->buf.__wpos)
+		pos += stream->buf.__wpos - stream->buffer;
+	else
+		pos -= unread(stream);
+	UNLOCK(&stream->lock);
+	return pos;
 }
 
 void rewind(FILE* stream) {
 	fseek(stream, 0, SEEK_SET);
+	clearerr(stream);
 }
 
 //Error handling
@@ -672,15 +992,12 @@ void perror(const char* s) {
 
 //Internal
 void __init_stdio() {
-	setvbuf(&__stdin, NULL, _IOLBF, BUFSIZ);
-	setvbuf(&__stdout, NULL, _IOLBF, BUFSIZ);
-	setvbuf(&__stderr, NULL, _IOLBF, BUFSIZ);
+	//Output to a terminal is shown a line at a time, but when it's going to a file or pipe it's fully buffered
+	setvbuf(&__stdin, NULL, _IOLBF, 0);
+	setvbuf(&__stdout, NULL, isatty(STDOUT_FILENO) ? _IOLBF : _IOFBF, 0);
+	setvbuf(&__stderr, NULL, _IOLBF, 0);
 }
 
 void __cleanup_stdio() {
-	FILE* cur = filelist_first;
-	while(cur) {
-		fclose(cur);
-		cur = cur->next;
-	}
-}
\ No newline at end of file
+	fflush(NULL);
+}
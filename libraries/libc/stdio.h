@@ -49,6 +49,18 @@ __DECL_BEGIN
 typedef struct FILE FILE;
 typedef long fpos_t;
 
+/*
+ * The start of every FILE, which holds its buffer pointers so that getc_unlocked() and putc_unlocked() can be inlined.
+ * Only one of the read and write halves is in use at a time; the other is left empty.
+ */
+struct __FILE_buffer {
+	unsigned char* __rpos; //The next buffered character to read
+	unsigned char* __rend; //The end of the buffered characters to read
+	unsigned char* __wpos; //Where the next character written goes in the buffer
+	unsigned char* __wend; //The end of the space in the buffer for writing
+	int __lbf; //'\n' if the stream is line buffered, or EOF if not, so putc_unlocked() knows when to flush
+};
+
 extern FILE __stdin;
 extern FILE __stdout;
 extern FILE __stderr;
@@ -100,6 +112,36 @@ int putchar(int c);
 int puts(const char* s);
 int ungetc(int c, FILE* stream);
 
+//Locking
+void flockfile(FILE* stream);
+int ftrylockfile(FILE* stream);
+void funlockfile(FILE* stream);
+
+//Character input/output without locking, for use with flockfile()
+int getc_unlocked(FILE* stream);
+int getchar_unlocked();
+int putc_unlocked(int c, FILE* stream);
+int putchar_unlocked(int c);
+int __uflow(FILE* stream);
+int __overflow(FILE* stream, int c);
+
+static inline int __getc_unlocked(FILE* stream) {
+	struct __FILE_buffer* buf = (struct __FILE_buffer*) stream;
+	return buf->__rpos != buf->__rend ? *buf->__rpos++ : __uflow(stream);
+}
+
+static inline int __putc_unlocked(int c, FILE* stream) {
+	struct __FILE_buffer* buf = (struct __FILE_buffer*) stream;
+	if((unsigned char) c != buf->__lbf && buf->__wpos != buf->__wend)
+		return *buf->__wpos++ = (unsigned char) c;
+	return __overflow(stream, (unsigned char) c);
+}
+
+#define getc_unlocked(stream) __getc_unlocked(stream)
+#define getchar_unlocked() __getc_unlocked(stdin)
+#define putc_unlocked(c, stream) __putc_unlocked(c, stream)
+#define putchar_unlocked(c) __putc_unlocked(c, stdout)
+
 //Direct input/output
 size_t fread(void* ptr, size_t size, size_t count, FILE* stream);
 size_t fwrite(const void* ptr, size_t size, size_t count, FILE* stream);
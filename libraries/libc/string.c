@@ -20,38 +20,12 @@
 #include <string.h>
 #include <errno.h>
 
-//Memory manipulation
-
-void* memcpy(void* dest, const void* src, size_t n) {
-	void* odest = dest;
-	asm volatile( "rep movsb" : "+D"(dest), "+S"(src), "+c"(n)::"memory");
-	return odest;
-}
-
-void* memmove(void* dest, const void* src, size_t n) {
-	if (dest < src)
-		return memcpy(dest, src, n);
-
-	uint8_t* dest8 = (uint8_t*) dest;
-	const uint8_t* src8 = (const uint8_t*) src;
-	for (dest8 += n, src8 += n; n--;)
-		*--dest8 = *--src8;
-
-	return dest;
-}
-
-void* memset(void* dest, int c, size_t n) {
-	void* odest = dest;
-	asm volatile( "rep stosb" : "=D"(dest), "=c"(n) : "0"(dest), "1"(n), "a"(c) : "memory");
-	return odest;
-}
+//memcpy, memmove, memset, memchr and strlen are in string_x86.c
 
 //String manipulation
 
 char* strcpy(char* dest, const char* src) {
-	char* odest = dest;
-	while ((*dest++ = *src++) != '\0');
-	return odest;
+	return memcpy(dest, src, strlen(src) + 1);
 }
 
 char* strncpy(char* dest, const char* src, size_t n) {
@@ -64,11 +38,7 @@ char* strncpy(char* dest, const char* src, size_t n) {
 }
 
 char* strcat(char* dest, const char* src) {
-	size_t destlen = strlen(dest);
-	size_t i = 0;
-	for (; src[i] != '\0'; i++)
-		dest[i+ destlen] = src[i];
-	dest[i + destlen] = '\0';
+	memcpy(dest + strlen(dest), src, strlen(src) + 1);
 	return dest;
 }
 
@@ -144,16 +114,23 @@ int strncmp(const char* s1, const char* s2, size_t n) {
 
 //Search
 
-void* memchr(const void* s, int c, size_t n) {
-	const char* sc = (const char*)s;
-	for(size_t i = 0; i < n; i++) {
-		if(sc[i] == (char)c)
-			return (void*) (&sc[i]);
-	}
-	return NULL;
-}
-
 char* strchr(const char* s, int c) {
+	//Check a dword at a time for either the character or the end of the string once we're aligned
+	typedef uint32_t __attribute__((may_alias)) aliased_dword;
+	while((uintptr_t) s & 3) {
+		if(*s == (char) c)
+			return (char*) s;
+		if(!*s)
+			return NULL;
+		s++;
+	}
+	uint32_t pattern = (uint8_t) c * 0x01010101u;
+	for(;; s += 4) {
+		uint32_t dword = *((const aliased_dword*) s);
+		uint32_t matched = dword ^ pattern;
+		if(((dword - 0x01010101u) & ~dword & 0x80808080u) || ((matched - 0x01010101u) & ~matched & 0x80808080u))
+			break;
+	}
 	for(;;) {
 		if(*s == (char)c)
 			return (char*) (s);
@@ -386,9 +363,3 @@ char* strerror(int errnum) {
 			return "Unknown error";
 	}
 }
-
-size_t strlen(const char* str) {
-	const char *s;
-	for (s = str; *s; s++);
-	return (s - str);
-}
\ No newline at end of file
@@ -0,0 +1,378 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+/*
+ * The memory and string routines that are worth having more than one version of. Each one has a version that works a
+ * dword at a time, and a version using SSE2, and which one gets used is picked by a resolver based on what the CPU
+ * supports.
+ *
+ * In libc.so, the routines are indirect functions, so the dynamic linker calls the resolver once while loading libc
+ * and binds calls straight to the version it returns. The static libc is also linked into the dynamic linker itself,
+ * where nothing would resolve them, so there each routine instead calls through a pointer that's resolved on the
+ * first call.
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <emmintrin.h>
+
+#define CPU_SSE2 0x1
+#define CPU_ERMS 0x2
+
+#define DWORD_ONES 0x01010101u
+#define DWORD_HIGHS 0x80808080u
+#define DWORD_HAS_ZERO(x) (((x) - DWORD_ONES) & ~(x) & DWORD_HIGHS)
+
+typedef uint32_t __attribute__((may_alias)) aliased_dword;
+
+// Past this size, memcpy skips the cache when writing since the destination wouldn't fit in it anyway
+#define MEMCPY_NONTEMPORAL_THRESHOLD (512 * 1024)
+
+#ifdef LIBC_SHARED
+#define STRING_IFUNC(ret, name, params, args) \
+	__attribute__((used)) static __typeof__(name)* resolve_##name(void); \
+	asm(".globl " #name "\n.type " #name ", @gnu_indirect_function\n.set " #name ", resolve_" #name);
+#else
+#define STRING_IFUNC(ret, name, params, args) \
+	static __typeof__(name)* resolve_##name(void); \
+	static ret name##_first params; \
+	static __typeof__(name)* name##_impl = name##_first; \
+	ret name params { return name##_impl args; } \
+	static ret name##_first params { \
+		name##_impl = resolve_##name(); \
+		return name##_impl args; \
+	}
+#endif
+
+STRING_IFUNC(void*, memcpy, (void* dest, const void* src, size_t n), (dest, src, n))
+STRING_IFUNC(void*, memmove, (void* dest, const void* src, size_t n), (dest, src, n))
+STRING_IFUNC(void*, memset, (void* dest, int c, size_t n), (dest, c, n))
+STRING_IFUNC(void*, memchr, (const void* s, int c, size_t n), (s, c, n))
+STRING_IFUNC(size_t, strlen, (const char* s), (s))
+
+/** Resolvers run before libc is relocated, so this can't call anything or touch anything that needs relocating. **/
+static inline int cpu_features(void) {
+	unsigned int eax, ebx, ecx, edx;
+	int features = 0;
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0));
+	unsigned int max_leaf = eax;
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+	if(edx & (1 << 26))
+		features |= CPU_SSE2;
+	if(max_leaf >= 7) {
+		asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(7), "c"(0));
+		if(ebx & (1 << 9))
+			features |= CPU_ERMS;
+	}
+	return features;
+}
+
+static inline void copy_bytes(uint8_t* dest, const uint8_t* src, size_t n) {
+	asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(n) :: "memory");
+}
+
+//memcpy
+
+/** On CPUs with enhanced rep movsb, the microcode copies whole cache lines at a time and beats anything we can do. **/
+static void* memcpy_erms(void* dest, const void* src, size_t n) {
+	copy_bytes(dest, src, n);
+	return dest;
+}
+
+static void* memcpy_dwords(void* dest, const void* src, size_t n) {
+	uint8_t* d = dest;
+	const uint8_t* s = src;
+	if(n >= 16) {
+		size_t head = (-(uintptr_t) d) & 3;
+		copy_bytes(d, s, head);
+		d += head;
+		s += head;
+		n -= head;
+		size_t dwords = n / 4;
+		asm volatile("rep movsl" : "+D"(d), "+S"(s), "+c"(dwords) :: "memory");
+		n &= 3;
+	}
+	copy_bytes(d, s, n);
+	return dest;
+}
+
+__attribute__((target("sse2")))
+static void* memcpy_sse2(void* dest, const void* src, size_t n) {
+	if(n < 64)
+		return memcpy_dwords(dest, src, n);
+
+	//Align the destination so the stores are aligned, and the loads can be wherever
+	uint8_t* d = dest;
+	const uint8_t* s = src;
+	size_t head = (-(uintptr_t) d) & 15;
+	copy_bytes(d, s, head);
+	d += head;
+	s += head;
+	n -= head;
+
+	if(n >= MEMCPY_NONTEMPORAL_THRESHOLD) {
+		for(; n >= 64; n -= 64, d += 64, s += 64) {
+			__m128i a = _mm_loadu_si128((const __m128i*) s);
+			__m128i b = _mm_loadu_si128((const __m128i*) (s + 16));
+			__m128i c = _mm_loadu_si128((const __m128i*) (s + 32));
+			__m128i e = _mm_loadu_si128((const __m128i*) (s + 48));
+			_mm_stream_si128((__m128i*) d, a);
+			_mm_stream_si128((__m128i*) (d + 16), b);
+			_mm_stream_si128((__m128i*) (d + 32), c);
+			_mm_stream_si128((__m128i*) (d + 48), e);
+		}
+		_mm_sfence();
+	}
+
+	for(; n >= 64; n -= 64, d += 64, s += 64) {
+		__m128i a = _mm_loadu_si128((const __m128i*) s);
+		__m128i b = _mm_loadu_si128((const __m128i*) (s + 16));
+		__m128i c = _mm_loadu_si128((const __m128i*) (s + 32));
+		__m128i e = _mm_loadu_si128((const __m128i*) (s + 48));
+		_mm_store_si128((__m128i*) d, a);
+		_mm_store_si128((__m128i*) (d + 16), b);
+		_mm_store_si128((__m128i*) (d + 32), c);
+		_mm_store_si128((__m128i*) (d + 48), e);
+	}
+	for(; n >= 16; n -= 16, d += 16, s += 16)
+		_mm_store_si128((__m128i*) d, _mm_loadu_si128((const __m128i*) s));
+	copy_bytes(d, s, n);
+	return dest;
+}
+
+static __typeof__(memcpy)* resolve_memcpy(void) {
+	int features = cpu_features();
+	if(features & CPU_ERMS)
+		return memcpy_erms;
+	if(features & CPU_SSE2)
+		return memcpy_sse2;
+	return memcpy_dwords;
+}
+
+//memmove
+
+/*
+ * When the destination is below the source, all of the memcpy versions are safe to use since they copy from low to high
+ * addresses and read each chunk before writing it. Otherwise, we copy from the end backwards.
+ */
+
+static void* memmove_dwords(void* dest, const void* src, size_t n) {
+	if(dest <= src || (const uint8_t*) dest >= (const uint8_t*) src + n)
+		return memcpy_dwords(dest, src, n);
+
+	uint8_t* d = (uint8_t*) dest + n;
+	const uint8_t* s = (const uint8_t*) src + n;
+	while(n && ((uintptr_t) d & 3)) {
+		*--d = *--s;
+		n--;
+	}
+	for(; n >= 4; n -= 4) {
+		d -= 4;
+		s -= 4;
+		*((aliased_dword*) d) = *((const aliased_dword*) s);
+	}
+	while(n--)
+		*--d = *--s;
+	return dest;
+}
+
+__attribute__((target("sse2")))
+static void* memmove_sse2(void* dest, const void* src, size_t n) {
+	if(dest <= src || (const uint8_t*) dest >= (const uint8_t*) src + n)
+		return memcpy_sse2(dest, src, n);
+	if(n < 64)
+		return memmove_dwords(dest, src, n);
+
+	uint8_t* d = (uint8_t*) dest + n;
+	const uint8_t* s = (const uint8_t*) src + n;
+	while((uintptr_t) d & 15) {
+		*--d = *--s;
+		n--;
+	}
+	for(; n >= 64; n -= 64) {
+		d -= 64;
+		s -= 64;
+		__m128i a = _mm_loadu_si128((const __m128i*) (s + 48));
+		__m128i b = _mm_loadu_si128((const __m128i*) (s + 32));
+		__m128i c = _mm_loadu_si128((const __m128i*) (s + 16));
+		__m128i e = _mm_loadu_si128((const __m128i*) s);
+		_mm_store_si128((__m128i*) (d + 48), a);
+		_mm_store_si128((__m128i*) (d + 32), b);
+		_mm_store_si128((__m128i*) (d + 16), c);
+		_mm_store_si128((__m128i*) d, e);
+	}
+	for(; n >= 16; n -= 16) {
+		d -= 16;
+		s -= 16;
+		_mm_store_si128((__m128i*) d, _mm_loadu_si128((const __m128i*) s));
+	}
+	while(n--)
+		*--d = *--s;
+	return dest;
+}
+
+static void* memmove_erms(void* dest, const void* src, size_t n) {
+	if(dest <= src || (const uint8_t*) dest >= (const uint8_t*) src + n)
+		return memcpy_erms(dest, src, n);
+	return memmove_sse2(dest, src, n);
+}
+
+static __typeof__(memmove)* resolve_memmove(void) {
+	int features = cpu_features();
+	if((features & CPU_ERMS) && (features & CPU_SSE2))
+		return memmove_erms;
+	if(features & CPU_SSE2)
+		return memmove_sse2;
+	return memmove_dwords;
+}
+
+//memset
+
+static void* memset_dwords(void* dest, int c, size_t n) {
+	uint8_t* d = dest;
+	if(n >= 16) {
+		size_t head = (-(uintptr_t) d) & 3;
+		n -= head;
+		asm volatile("rep stosb" : "+D"(d), "+c"(head) : "a"(c) : "memory");
+		size_t dwords = n / 4;
+		uint32_t pattern = (uint8_t) c * DWORD_ONES;
+		asm volatile("rep stosl" : "+D"(d), "+c"(dwords) : "a"(pattern) : "memory");
+		n &= 3;
+	}
+	asm volatile("rep stosb" : "+D"(d), "+c"(n) : "a"(c) : "memory");
+	return dest;
+}
+
+__attribute__((target("sse2")))
+static void* memset_sse2(void* dest, int c, size_t n) {
+	if(n < 64)
+		return memset_dwords(dest, c, n);
+
+	uint8_t* d = dest;
+	size_t head = (-(uintptr_t) d) & 15;
+	n -= head;
+	asm volatile("rep stosb" : "+D"(d), "+c"(head) : "a"(c) : "memory");
+
+	__m128i pattern = _mm_set1_epi8((char) c);
+	for(; n >= 64; n -= 64, d += 64) {
+		_mm_store_si128((__m128i*) d, pattern);
+		_mm_store_si128((__m128i*) (d + 16), pattern);
+		_mm_store_si128((__m128i*) (d + 32), pattern);
+		_mm_store_si128((__m128i*) (d + 48), pattern);
+	}
+	for(; n >= 16; n -= 16, d += 16)
+		_mm_store_si128((__m128i*) d, pattern);
+	asm volatile("rep stosb" : "+D"(d), "+c"(n) : "a"(c) : "memory");
+	return dest;
+}
+
+static void* memset_erms(void* dest, int c, size_t n) {
+	void* d = dest;
+	asm volatile("rep stosb" : "+D"(d), "+c"(n) : "a"(c) : "memory");
+	return dest;
+}
+
+static __typeof__(memset)* resolve_memset(void) {
+	int features = cpu_features();
+	if(features & CPU_ERMS)
+		return memset_erms;
+	if(features & CPU_SSE2)
+		return memset_sse2;
+	return memset_dwords;
+}
+
+//memchr
+
+/*
+ * The searching routines read whole aligned dwords or 16-byte blocks, which can go a little past the end of the string
+ * or buffer. An aligned read never crosses into another page, so it can't fault if the first byte it needed couldn't.
+ */
+
+static void* memchr_dwords(const void* s, int c, size_t n) {
+	const uint8_t* p = s;
+	uint8_t target = c;
+	while(n && ((uintptr_t) p & 3)) {
+		if(*p == target)
+			return (void*) p;
+		p++;
+		n--;
+	}
+
+	uint32_t pattern = target * DWORD_ONES;
+	for(; n >= 4; n -= 4, p += 4) {
+		uint32_t dword = *((const aliased_dword*) p) ^ pattern;
+		if(DWORD_HAS_ZERO(dword))
+			break;
+	}
+
+	for(; n; n--, p++) {
+		if(*p == target)
+			return (void*) p;
+	}
+	return NULL;
+}
+
+__attribute__((target("sse2")))
+static void* memchr_sse2(const void* s, int c, size_t n) {
+	if(n < 16)
+		return memchr_dwords(s, c, n);
+
+	const uint8_t* end = (const uint8_t*) s + n;
+	const uint8_t* block = (const uint8_t*) ((uintptr_t) s & ~15);
+	__m128i pattern = _mm_set1_epi8((char) c);
+
+	//Ignore the matches in the first block that come before s
+	unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*) block), pattern));
+	mask &= ~0u << ((uintptr_t) s & 15);
+	for(;;) {
+		if(mask) {
+			const uint8_t* match = block + __builtin_ctz(mask);
+			return match < end ? (void*) match : NULL;
+		}
+		block += 16;
+		if(block >= end)
+			return NULL;
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*) block), pattern));
+	}
+}
+
+static __typeof__(memchr)* resolve_memchr(void) {
+	if(cpu_features() & CPU_SSE2)
+		return memchr_sse2;
+	return memchr_dwords;
+}
+
+//strlen
+
+static size_t strlen_dwords(const char* s) {
+	const char* p = s;
+	while((uintptr_t) p & 3) {
+		if(!*p)
+			return p - s;
+		p++;
+	}
+	while(!DWORD_HAS_ZERO(*((const aliased_dword*) p)))
+		p += 4;
+	while(*p)
+		p++;
+	return p - s;
+}
+
+__attribute__((target("sse2")))
+static size_t strlen_sse2(const char* s) {
+	const char* block = (const char*) ((uintptr_t) s & ~15);
+	__m128i zero = _mm_setzero_si128();
+	unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*) block), zero));
+	mask &= ~0u << ((uintptr_t) s & 15);
+	while(!mask) {
+		block += 16;
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*) block), zero));
+	}
+	return block + __builtin_ctz(mask) - s;
+}
+
+static __typeof__(strlen)* resolve_strlen(void) {
+	if(cpu_features() & CPU_SSE2)
+		return strlen_sse2;
+	return strlen_dwords;
+}
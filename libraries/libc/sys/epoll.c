@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "epoll.h"
+#include "syscall.h"
+#include <errno.h>
+
+int epoll_create1(int flags) {
+	return syscall2(SYS_EPOLL_CREATE, flags);
+}
+
+int epoll_create(int size) {
+	if(size <= 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	return epoll_create1(0);
+}
+
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event* event) {
+	struct epoll_ctl_args args = {epfd, op, fd, event};
+	return syscall2(SYS_EPOLL_CTL, (int) &args);
+}
+
+int epoll_wait(int epfd, struct epoll_event* events, int maxevents, int timeout) {
+	struct epoll_wait_args args = {epfd, events, maxevents, timeout};
+	return syscall2(SYS_EPOLL_WAIT, (int) &args);
+}
@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "cdefs.h"
+#include "types.h"
+#include <kernel/api/epoll.h>
+
+__DECL_BEGIN
+
+/**
+ * Creates a set of file descriptors to wait for events on, which is kept between calls to epoll_wait().
+ * @param flags 0 or EPOLL_CLOEXEC.
+ * @return A file descriptor referring to the set, or -1 on error.
+ */
+int epoll_create1(int flags);
+
+/** The same as epoll_create1(0). The size is ignored, but must be positive. **/
+int epoll_create(int size);
+
+/**
+ * Adds, changes, or removes a file descriptor in a set.
+ * @param epfd The set, from epoll_create().
+ * @param op EPOLL_CTL_ADD, EPOLL_CTL_MOD, or EPOLL_CTL_DEL.
+ * @param fd The file descriptor to watch.
+ * @param event The events to watch for (EPOLLIN and/or EPOLLOUT, optionally with EPOLLET or EPOLLONESHOT) and the data
+ *              to return with them. Ignored for EPOLL_CTL_DEL.
+ * @return 0 if successful, -1 if not.
+ */
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event* event);
+
+/**
+ * Waits for events on the file descriptors in a set.
+ * @param epfd The set, from epoll_create().
+ * @param events Where to store the events.
+ * @param maxevents The most events to store.
+ * @param timeout How long to wait in milliseconds, or -1 to wait forever.
+ * @return The number of events stored, or -1 on error.
+ */
+int epoll_wait(int epfd, struct epoll_event* events, int maxevents, int timeout);
+
+__DECL_END
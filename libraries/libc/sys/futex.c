@@ -0,0 +1,10 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "futex.h"
+#include "syscall.h"
+
+int futex(int* addr, int op, int val, const struct timespec* timeout) {
+	struct futex_args args = {addr, op, val, timeout};
+	return syscall2(SYS_FUTEX, (int) &args);
+}
@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "cdefs.h"
+#include "types.h"
+#include <kernel/api/futex.h>
+
+__DECL_BEGIN
+
+/**
+ * Waits on or wakes up threads waiting on an int. This is what mutexes and condition variables are built on; most
+ * programs should use those instead.
+ * @param addr The int to wait or wake on. Threads in different processes can use the same int in shared memory.
+ * @param op FUTEX_WAIT to sleep as long as *addr is val and until woken up, or FUTEX_WAKE to wake up to val threads.
+ * @param val The value to expect for FUTEX_WAIT, or the number of threads to wake for FUTEX_WAKE.
+ * @param timeout For FUTEX_WAIT, how long to wait for at most, or NULL to wait forever.
+ * @return For FUTEX_WAIT, 0 when woken up or -1 on error (EAGAIN if *addr wasn't val, ETIMEDOUT, or EINTR). For
+ *         FUTEX_WAKE, the number of threads woken up or -1 on error.
+ */
+int futex(int* addr, int op, int val, const struct timespec* timeout);
+
+__DECL_END
@@ -20,6 +20,11 @@
 #ifndef DUCKOS_LIBC_INTERNALS_H
 #define DUCKOS_LIBC_INTERNALS_H
 
+#include <sys/cdefs.h>
+#include <stddef.h>
+
+__DECL_BEGIN
+
 extern void _init();
 extern void _fini();
 
@@ -28,4 +33,15 @@ void __cxa_finalize(void* dso_handle);
 __attribute__((noreturn)) void __cxa_pure_virtual() __attribute__((weak));
 __attribute__((noreturn)) void __stack_chk_fail();
 
+//Set once the process creates a second thread, so things that need locking can skip it until then
+extern int __libc_threaded;
+
+//Thread-local storage (see sys/tls.c). The dynamic loader calls __init_tls with the initial image of every thread's block
+void __init_tls(const void* image, size_t size, size_t align);
+void* __tls_allocate();
+void __tls_free(void* thread_pointer);
+void* __tls_self();
+
+__DECL_END
+
 #endif //DUCKOS_LIBC_INTERNALS_H
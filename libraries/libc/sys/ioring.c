@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "ioring.h"
+#include "syscall.h"
+#include "mman.h"
+#include <string.h>
+
+int ioring_setup(struct ioring_params* params) {
+	return syscall2(SYS_IORING_SETUP, (int) params);
+}
+
+int ioring_enter(uint32_t to_submit, uint32_t min_complete, int flags) {
+	return syscall4(SYS_IORING_ENTER, (int) to_submit, (int) min_complete, flags);
+}
+
+int ioring_init(struct ioring* ring, uint32_t entries) {
+	size_t size = IORING_SIZE(entries);
+	void* mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if(mem == MAP_FAILED)
+		return -1;
+
+	struct ioring_params params = {mem, entries};
+	if(ioring_setup(&params) < 0) {
+		munmap(mem, size);
+		return -1;
+	}
+
+	ring->header = (struct ioring_header*) mem;
+	ring->sqes = IORING_SQES(ring->header);
+	ring->cqes = IORING_CQES(ring->header);
+	ring->entries = entries;
+	ring->sq_tail = 0;
+	return 0;
+}
+
+struct ioring_sqe* ioring_get_sqe(struct ioring* ring) {
+	uint32_t head = __atomic_load_n(&ring->header->sq_head, __ATOMIC_ACQUIRE);
+	if(ring->sq_tail - head >= ring->entries)
+		return NULL;
+	struct ioring_sqe* sqe = &ring->sqes[ring->sq_tail++ & (ring->entries - 1)];
+	memset(sqe, 0, sizeof(struct ioring_sqe));
+	sqe->off = -1;
+	return sqe;
+}
+
+int ioring_submit(struct ioring* ring, uint32_t wait_nr) {
+	__atomic_store_n(&ring->header->sq_tail, ring->sq_tail, __ATOMIC_RELEASE);
+	uint32_t to_submit = ring->sq_tail - __atomic_load_n(&ring->header->sq_head, __ATOMIC_ACQUIRE);
+	return ioring_enter(to_submit, wait_nr, wait_nr ? IORING_ENTER_GETEVENTS : 0);
+}
+
+struct ioring_cqe* ioring_peek_cqe(struct ioring* ring) {
+	uint32_t head = ring->header->cq_head;
+	if(head == __atomic_load_n(&ring->header->cq_tail, __ATOMIC_ACQUIRE))
+		return NULL;
+	return &ring->cqes[head & (IORING_CQ_ENTRIES(ring->entries) - 1)];
+}
+
+void ioring_cqe_seen(struct ioring* ring) {
+	__atomic_store_n(&ring->header->cq_head, ring->header->cq_head + 1, __ATOMIC_RELEASE);
+}
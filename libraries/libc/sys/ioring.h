@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "cdefs.h"
+#include "types.h"
+#include <kernel/api/ioring.h>
+
+__DECL_BEGIN
+
+/**
+ * Sets up the submission/completion ring for the current process. Each process can only have one ring, and it stays
+ * set up until the process exits or execs. Most programs should use ioring_init() instead.
+ * @param params The memory to use for the ring and how many submission slots it should have.
+ * @return 0 if successful, or -1 on error (EINVAL if the parameters are bad, EBUSY if there's already a ring).
+ */
+int ioring_setup(struct ioring_params* params);
+
+/**
+ * Hands the kernel the submissions in the ring and posts their completions.
+ * @param to_submit The most submissions to consume.
+ * @param min_complete With IORING_ENTER_GETEVENTS, how many completions to wait for. Only polls can be waited on, since
+ *                     everything else completes before this returns.
+ * @param flags IORING_ENTER_GETEVENTS or 0.
+ * @return The number of submissions consumed, or -1 on error.
+ */
+int ioring_enter(uint32_t to_submit, uint32_t min_complete, int flags);
+
+/** The process side of a ring, as set up by ioring_init(). **/
+struct ioring {
+	struct ioring_header* header;
+	struct ioring_sqe* sqes;
+	struct ioring_cqe* cqes;
+	uint32_t entries;
+	uint32_t sq_tail; ///< The tail including submissions that haven't been handed to the kernel yet.
+};
+
+/**
+ * Allocates and sets up the ring for the current process.
+ * @param ring The ring to initialize.
+ * @param entries The number of submission slots. Must be a power of two no bigger than IORING_MAX_ENTRIES.
+ * @return 0 if successful, or -1 on error.
+ */
+int ioring_init(struct ioring* ring, uint32_t entries);
+
+/** Gets the next free submission slot, or NULL if they're all full. It's submitted by the next ioring_submit(). **/
+struct ioring_sqe* ioring_get_sqe(struct ioring* ring);
+
+/**
+ * Submits every submission filled in since the last call.
+ * @param wait_nr How many completions to wait for.
+ * @return The number of submissions consumed, or -1 on error.
+ */
+int ioring_submit(struct ioring* ring, uint32_t wait_nr);
+
+/** Gets the oldest completion that hasn't been marked as seen, or NULL if there aren't any. **/
+struct ioring_cqe* ioring_peek_cqe(struct ioring* ring);
+
+/** Marks the completion returned by ioring_peek_cqe() as seen, freeing up its slot. **/
+void ioring_cqe_seen(struct ioring* ring);
+
+__DECL_END
@@ -0,0 +1,475 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "malloc.h"
+#include "mman.h"
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <atomic>
+#include <kernel/api/page_size.h>
+#include <libduck/Mutex.h>
+
+/*
+ * Small allocations are rounded up to one of a set of size classes and carved out of slabs, which are mappings that
+ * only hold objects of one class. Freed objects go onto a per-thread cache for their class, and are moved between the
+ * cache and the slabs in batches, so most allocations and frees only touch the thread's own cache. A slab that has
+ * become empty is unmapped once there are more than a few empty ones for its class. Allocations too big for a slab
+ * get a mapping of their own, which is unmapped as soon as they're freed.
+ *
+ * A pointer's slab is found with a page map from page numbers to the mapping that owns the page, so objects don't need
+ * a header of their own.
+ */
+
+// The biggest allocation made out of a slab. Anything bigger gets its own mapping.
+#define MALLOC_MAX_SMALL_SIZE 8192
+#define MALLOC_NUM_SIZE_CLASSES 32
+#define MALLOC_SLAB_SIZE 65536
+#define MALLOC_SPAN_HEADER_SIZE ((sizeof(Span) + 15) & ~15)
+#define MALLOC_LARGE_CLASS 0xFFFF
+
+// About how many bytes worth of objects to move between a thread cache and the slabs at once
+#define MALLOC_BATCH_BYTES 4096
+#define MALLOC_MAX_BATCH 32
+// How many empty slabs of each size class to keep mapped, so that a thread freeing and allocating in a loop doesn't map
+// and unmap a slab every time
+#define MALLOC_EMPTY_SLABS_KEPT 1
+
+/*
+ * In libc.so, each thread is handed one of the caches round-robin the first time it allocates, and keeps a pointer to it
+ * in thread-local storage. libc.a has no thread-local storage (it's only linked into ld), so there threads are spread
+ * across the caches by which stack they're running on instead (thread stacks are THREAD_STACK_SIZE apart). Caches
+ * outlive their threads and more threads than caches can share one, so each cache still has a lock, but it's almost
+ * never contended, and taking an uncontended Duck::Mutex doesn't make a syscall.
+ */
+#define MALLOC_CACHE_BITS 3
+#define MALLOC_NUM_CACHES (1 << MALLOC_CACHE_BITS)
+#define MALLOC_STACK_SIZE 1048576
+
+#define MALLOC_PAGEMAP_BITS 10
+#define MALLOC_PAGEMAP_SIZE (1 << MALLOC_PAGEMAP_BITS)
+
+namespace {
+	struct FreeObject {
+		FreeObject* next;
+	};
+
+	/** The header at the start of every mapping malloc makes, which is either a slab or a single large allocation. **/
+	struct Span {
+		Span* prev;
+		Span* next;
+		FreeObject* free_list; ///< Objects that were freed back to the slab.
+		char* bump; ///< The start of the part of the slab that has never been handed out.
+		char* end; ///< The end of the last object that fits in the slab.
+		size_t mapped_size;
+		uint32_t num_used; ///< How many objects are allocated or sitting in thread caches.
+		uint16_t size_class;
+		bool in_partial; ///< Whether the slab is in its size class's list of slabs with free objects.
+
+		bool has_free() const { return free_list || bump < end; }
+	};
+
+	struct SizeClass {
+		Duck::Mutex lock;
+		Span* partial; ///< Slabs with free objects.
+		size_t num_slabs;
+		size_t num_empty;
+	};
+
+	struct CacheList {
+		FreeObject* head;
+		uint32_t count;
+	};
+
+	struct ThreadCache {
+		Duck::Mutex lock;
+		CacheList lists[MALLOC_NUM_SIZE_CLASSES];
+		uint64_t num_mallocs;
+		uint64_t num_frees;
+		uint64_t bytes_allocated;
+		uint64_t bytes_freed; ///< May be more than bytes_allocated, if other threads' allocations are freed here.
+	};
+
+	const uint16_t s_class_sizes[MALLOC_NUM_SIZE_CLASSES] = {
+		16, 32, 48, 64, 80, 96, 112, 128,
+		160, 192, 224, 256, 320, 384, 448, 512,
+		640, 768, 896, 1024, 1280, 1536, 1792, 2048,
+		2560, 3072, 3584, 4096, 5120, 6144, 7168, 8192
+	};
+
+	SizeClass s_classes[MALLOC_NUM_SIZE_CLASSES];
+	ThreadCache s_caches[MALLOC_NUM_CACHES];
+#ifdef LIBC_SHARED
+	std::atomic<uint32_t> s_next_cache = {0};
+	__thread ThreadCache* s_thread_cache __attribute__((tls_model("initial-exec"))) = nullptr;
+#endif
+
+	std::atomic<Span**> s_pagemap[MALLOC_PAGEMAP_SIZE];
+	Duck::Mutex s_pagemap_lock;
+
+	std::atomic<size_t> s_mapped_bytes = {0};
+	std::atomic<size_t> s_released_slabs = {0};
+	std::atomic<size_t> s_large_allocations = {0};
+	std::atomic<size_t> s_large_bytes = {0};
+	std::atomic<uint64_t> s_large_mallocs = {0};
+	std::atomic<uint64_t> s_large_frees = {0};
+}
+
+/**
+ * Returns the size class for an allocation. Up to 128 bytes, the classes are 16 bytes apart. After that, there are four
+ * classes between each power of two.
+ */
+static inline int size_class_of(size_t size) {
+	if(size <= 128)
+		return size ? (size - 1) / 16 : 0;
+	int shift = 31 - __builtin_clz(size - 1);
+	return 8 + (shift - 7) * 4 + (int) ((size - 1) >> (shift - 2)) - 4;
+}
+
+static inline uint32_t batch_size(int size_class) {
+	uint32_t batch = MALLOC_BATCH_BYTES / s_class_sizes[size_class];
+	if(batch < 2)
+		return 2;
+	return batch > MALLOC_MAX_BATCH ? MALLOC_MAX_BATCH : batch;
+}
+
+static inline ThreadCache& current_cache() {
+#ifdef LIBC_SHARED
+	if(__builtin_expect(!s_thread_cache, 0))
+		s_thread_cache = &s_caches[s_next_cache.fetch_add(1, std::memory_order_relaxed) % MALLOC_NUM_CACHES];
+	return *s_thread_cache;
+#else
+	auto stack = (uint32_t) ((uintptr_t) __builtin_frame_address(0) / MALLOC_STACK_SIZE);
+	return s_caches[(stack * 2654435761u) >> (32 - MALLOC_CACHE_BITS)];
+#endif
+}
+
+static void* map_memory(size_t size) {
+	void* mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS, 0, 0);
+	if(mem == MAP_FAILED)
+		return nullptr;
+	s_mapped_bytes.fetch_add(size, std::memory_order_relaxed);
+	return mem;
+}
+
+static void unmap_memory(void* mem, size_t size) {
+	if(munmap(mem, size) < 0) {
+		fprintf(stderr, "malloc: Failed to unmap %p\n", mem);
+		return;
+	}
+	s_mapped_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+static inline Span* span_of(void* ptr) {
+	auto page = (uintptr_t) ptr / PAGE_SIZE;
+	auto* leaf = s_pagemap[page >> MALLOC_PAGEMAP_BITS].load(std::memory_order_acquire);
+	return leaf ? leaf[page & (MALLOC_PAGEMAP_SIZE - 1)] : nullptr;
+}
+
+/** Points the page map entries for the first num_pages pages of a span at it (or at nothing, if span is null). **/
+static bool set_pagemap(void* start, size_t num_pages, Span* span) {
+	Duck::ScopedLock lock(s_pagemap_lock);
+	auto first_page = (uintptr_t) start / PAGE_SIZE;
+	for(auto page = first_page; page < first_page + num_pages; page++) {
+		auto& leaf_entry = s_pagemap[page >> MALLOC_PAGEMAP_BITS];
+		auto* leaf = leaf_entry.load(std::memory_order_relaxed);
+		if(!leaf) {
+			//Leaves are never freed, so lookups can read them without taking the lock
+			leaf = (Span**) map_memory(MALLOC_PAGEMAP_SIZE * sizeof(Span*));
+			if(!leaf)
+				return false;
+			leaf_entry.store(leaf, std::memory_order_release);
+		}
+		leaf[page & (MALLOC_PAGEMAP_SIZE - 1)] = span;
+	}
+	return true;
+}
+
+static void partial_push(SizeClass& size_class, Span* slab) {
+	slab->prev = nullptr;
+	slab->next = size_class.partial;
+	if(slab->next)
+		slab->next->prev = slab;
+	size_class.partial = slab;
+	slab->in_partial = true;
+}
+
+static void partial_remove(SizeClass& size_class, Span* slab) {
+	if(slab->prev)
+		slab->prev->next = slab->next;
+	else
+		size_class.partial = slab->next;
+	if(slab->next)
+		slab->next->prev = slab->prev;
+	slab->in_partial = false;
+}
+
+/** Maps a new slab for a size class. The size class must be locked. **/
+static Span* alloc_slab(int class_index) {
+	auto* slab = (Span*) map_memory(MALLOC_SLAB_SIZE);
+	if(!slab)
+		return nullptr;
+	size_t object_size = s_class_sizes[class_index];
+	char* data = (char*) slab + MALLOC_SPAN_HEADER_SIZE;
+	slab->free_list = nullptr;
+	slab->bump = data;
+	slab->end = data + ((MALLOC_SLAB_SIZE - MALLOC_SPAN_HEADER_SIZE) / object_size) * object_size;
+	slab->mapped_size = MALLOC_SLAB_SIZE;
+	slab->num_used = 0;
+	slab->size_class = class_index;
+	if(!set_pagemap(slab, MALLOC_SLAB_SIZE / PAGE_SIZE, slab)) {
+		unmap_memory(slab, MALLOC_SLAB_SIZE);
+		return nullptr;
+	}
+
+	auto& size_class = s_classes[class_index];
+	partial_push(size_class, slab);
+	size_class.num_slabs++;
+	size_class.num_empty++;
+	return slab;
+}
+
+/** Unmaps an empty slab. The size class must be locked. **/
+static void release_slab(SizeClass& size_class, Span* slab) {
+	partial_remove(size_class, slab);
+	set_pagemap(slab, MALLOC_SLAB_SIZE / PAGE_SIZE, nullptr);
+	unmap_memory(slab, MALLOC_SLAB_SIZE);
+	size_class.num_slabs--;
+	s_released_slabs.fetch_add(1, std::memory_order_relaxed);
+}
+
+/** Moves a batch of objects from the slabs into an empty thread cache list. The cache must be locked. **/
+static bool refill(ThreadCache& cache, int class_index) {
+	auto& size_class = s_classes[class_index];
+	auto& list = cache.lists[class_index];
+	size_t object_size = s_class_sizes[class_index];
+	uint32_t batch = batch_size(class_index);
+
+	Duck::ScopedLock lock(size_class.lock);
+	while(list.count < batch) {
+		Span* slab = size_class.partial;
+		if(!slab) {
+			//Don't map another slab if we already got some objects
+			if(list.count)
+				break;
+			slab = alloc_slab(class_index);
+			if(!slab)
+				return false;
+		}
+
+		FreeObject* object;
+		if(slab->free_list) {
+			object = slab->free_list;
+			slab->free_list = object->next;
+		} else {
+			object = (FreeObject*) slab->bump;
+			slab->bump += object_size;
+		}
+		if(!slab->num_used++)
+			size_class.num_empty--;
+		if(!slab->has_free())
+			partial_remove(size_class, slab);
+
+		object->next = list.head;
+		list.head = object;
+		list.count++;
+	}
+	return true;
+}
+
+/** Moves a number of objects from a thread cache list back to their slabs. The cache must be locked. **/
+static void flush(ThreadCache& cache, int class_index, uint32_t count) {
+	auto& size_class = s_classes[class_index];
+	auto& list = cache.lists[class_index];
+
+	Duck::ScopedLock lock(size_class.lock);
+	while(count-- && list.head) {
+		auto* object = list.head;
+		list.head = object->next;
+		list.count--;
+
+		Span* slab = span_of(object);
+		object->next = slab->free_list;
+		slab->free_list = object;
+		if(!slab->in_partial)
+			partial_push(size_class, slab);
+		if(!--slab->num_used) {
+			if(size_class.num_empty >= MALLOC_EMPTY_SLABS_KEPT)
+				release_slab(size_class, slab);
+			else
+				size_class.num_empty++;
+		}
+	}
+}
+
+static void* alloc_large(size_t size) {
+	if(size > SIZE_MAX - MALLOC_SPAN_HEADER_SIZE - PAGE_SIZE) {
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	size_t mapped_size = (size + MALLOC_SPAN_HEADER_SIZE + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+	auto* span = (Span*) map_memory(mapped_size);
+	if(!span) {
+		errno = ENOMEM;
+		return nullptr;
+	}
+	span->mapped_size = mapped_size;
+	span->size_class = MALLOC_LARGE_CLASS;
+
+	//The pointer we hand out is always in the first page, so that's the only one the page map needs to know about
+	if(!set_pagemap(span, 1, span)) {
+		unmap_memory(span, mapped_size);
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	s_large_allocations.fetch_add(1, std::memory_order_relaxed);
+	s_large_bytes.fetch_add(mapped_size, std::memory_order_relaxed);
+	s_large_mallocs.fetch_add(1, std::memory_order_relaxed);
+	return (char*) span + MALLOC_SPAN_HEADER_SIZE;
+}
+
+static void free_large(Span* span) {
+	size_t mapped_size = span->mapped_size;
+	set_pagemap(span, 1, nullptr);
+	unmap_memory(span, mapped_size);
+	s_large_allocations.fetch_sub(1, std::memory_order_relaxed);
+	s_large_bytes.fetch_sub(mapped_size, std::memory_order_relaxed);
+	s_large_frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+void* malloc(size_t size) {
+	if(size > MALLOC_MAX_SMALL_SIZE)
+		return alloc_large(size);
+
+	int class_index = size_class_of(size);
+	auto& cache = current_cache();
+	Duck::ScopedLock lock(cache.lock);
+	auto& list = cache.lists[class_index];
+	if(!list.head && !refill(cache, class_index)) {
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	auto* object = list.head;
+	list.head = object->next;
+	list.count--;
+	cache.num_mallocs++;
+	cache.bytes_allocated += s_class_sizes[class_index];
+	return object;
+}
+
+void free(void* ptr) {
+	if(!ptr)
+		return;
+
+	Span* span = span_of(ptr);
+	if(!span) {
+		fprintf(stderr, "malloc: free() called on invalid pointer %p\n", ptr);
+		return;
+	}
+	if(span->size_class == MALLOC_LARGE_CLASS) {
+		free_large(span);
+		return;
+	}
+
+	int class_index = span->size_class;
+	auto& cache = current_cache();
+	Duck::ScopedLock lock(cache.lock);
+	auto& list = cache.lists[class_index];
+	auto* object = (FreeObject*) ptr;
+	object->next = list.head;
+	list.head = object;
+	list.count++;
+	cache.num_frees++;
+	cache.bytes_freed += s_class_sizes[class_index];
+
+	//Keep up to two batches in the cache, so that alternating mallocs and frees around the limit don't flush every time
+	uint32_t batch = batch_size(class_index);
+	if(list.count > batch * 2)
+		flush(cache, class_index, batch);
+}
+
+void* calloc(size_t nmemb, size_t size) {
+	if(size && nmemb > SIZE_MAX / size) {
+		errno = ENOMEM;
+		return nullptr;
+	}
+	void* ptr = malloc(nmemb * size);
+	if(ptr)
+		memset(ptr, 0, nmemb * size);
+	return ptr;
+}
+
+void* realloc(void* ptr, size_t size) {
+	if(!ptr)
+		return malloc(size);
+	if(!size) {
+		free(ptr);
+		return nullptr;
+	}
+
+	//If the allocation still fits without wasting most of it, there's no need to move it
+	size_t usable_size = malloc_usable_size(ptr);
+	if(size <= usable_size && size >= usable_size / 2)
+		return ptr;
+
+	void* new_ptr = malloc(size);
+	if(!new_ptr)
+		return nullptr;
+	memcpy(new_ptr, ptr, size < usable_size ? size : usable_size);
+	free(ptr);
+	return new_ptr;
+}
+
+size_t malloc_usable_size(void* ptr) {
+	if(!ptr)
+		return 0;
+	Span* span = span_of(ptr);
+	if(!span)
+		return 0;
+	if(span->size_class == MALLOC_LARGE_CLASS)
+		return span->mapped_size - MALLOC_SPAN_HEADER_SIZE;
+	return s_class_sizes[span->size_class];
+}
+
+void malloc_get_statistics(struct malloc_statistics* stats) {
+	uint64_t bytes_allocated = 0, bytes_freed = 0;
+	stats->cached_bytes = 0;
+	stats->num_mallocs = s_large_mallocs.load(std::memory_order_relaxed);
+	stats->num_frees = s_large_frees.load(std::memory_order_relaxed);
+	for(auto& cache : s_caches) {
+		Duck::ScopedLock lock(cache.lock);
+		for(int i = 0; i < MALLOC_NUM_SIZE_CLASSES; i++)
+			stats->cached_bytes += cache.lists[i].count * s_class_sizes[i];
+		stats->num_mallocs += cache.num_mallocs;
+		stats->num_frees += cache.num_frees;
+		bytes_allocated += cache.bytes_allocated;
+		bytes_freed += cache.bytes_freed;
+	}
+
+	stats->num_slabs = 0;
+	for(auto& size_class : s_classes) {
+		Duck::ScopedLock lock(size_class.lock);
+		stats->num_slabs += size_class.num_slabs;
+	}
+
+	stats->num_large_allocations = s_large_allocations.load(std::memory_order_relaxed);
+	stats->large_bytes = s_large_bytes.load(std::memory_order_relaxed);
+	stats->in_use_bytes = (size_t) (bytes_allocated - bytes_freed) + stats->large_bytes;
+	stats->num_released_slabs = s_released_slabs.load(std::memory_order_relaxed);
+	stats->mapped_bytes = s_mapped_bytes.load(std::memory_order_relaxed);
+}
+
+void malloc_stats(void) {
+	struct malloc_statistics stats;
+	malloc_get_statistics(&stats);
+	fprintf(stderr, "Mapped:            %u bytes\n", stats.mapped_bytes);
+	fprintf(stderr, "In use:            %u bytes\n", stats.in_use_bytes);
+	fprintf(stderr, "Cached:            %u bytes\n", stats.cached_bytes);
+	fprintf(stderr, "Slabs:             %u (%u released)\n", stats.num_slabs, stats.num_released_slabs);
+	fprintf(stderr, "Large allocations: %u (%u bytes)\n", stats.num_large_allocations, stats.large_bytes);
+	fprintf(stderr, "Mallocs:           %llu\n", stats.num_mallocs);
+	fprintf(stderr, "Frees:             %llu\n", stats.num_frees);
+}
@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "cdefs.h"
+#include <stddef.h>
+#include <stdint.h>
+
+__DECL_BEGIN
+
+/** A snapshot of what the calling process's malloc is up to. **/
+struct malloc_statistics {
+	size_t mapped_bytes; ///< How much memory malloc has mapped, including its own bookkeeping.
+	size_t in_use_bytes; ///< How much memory is in allocations that haven't been freed, rounded up to their size class.
+	size_t cached_bytes; ///< How much freed memory is sitting in thread caches waiting to be reused.
+	size_t num_slabs; ///< How many slabs small allocations are being made out of.
+	size_t num_released_slabs; ///< How many empty slabs have been given back to the system.
+	size_t num_large_allocations; ///< How many allocations too big for a slab are in use.
+	size_t large_bytes; ///< How much memory is mapped for allocations too big for a slab.
+	uint64_t num_mallocs;
+	uint64_t num_frees;
+};
+
+void* malloc(size_t size);
+void* realloc(void* ptr, size_t size);
+void* calloc(size_t nmemb, size_t size);
+void free(void* ptr);
+
+/** Returns how many bytes can actually be used in an allocation, which may be more than was asked for. **/
+size_t malloc_usable_size(void* ptr);
+
+/** Fills stats with statistics about the calling process's memory allocations. **/
+void malloc_get_statistics(struct malloc_statistics* stats);
+
+/** Prints statistics about the calling process's memory allocations to stderr. **/
+void malloc_stats(void);
+
+__DECL_END
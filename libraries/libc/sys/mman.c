@@ -16,4 +16,8 @@ int munmap(void* addr, size_t length) {
 
 int mprotect(void *addr, size_t len, int prot) {
 	return syscall4(SYS_MPROTECT, (int) addr, (int) len, prot);
-}
\ No newline at end of file
+}
+
+int madvise(void* addr, size_t length, int advice) {
+	return syscall4(SYS_MADVISE, (int) addr, (int) length, advice);
+}
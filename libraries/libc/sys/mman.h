@@ -10,4 +10,5 @@ __DECL_BEGIN
 void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset);
 int munmap(void* addr, size_t length);
 int mprotect(void *addr, size_t len, int prot);
+int madvise(void* addr, size_t length, int advice);
 __DECL_END
\ No newline at end of file
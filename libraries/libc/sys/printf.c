@@ -19,321 +19,695 @@
 
 #include <sys/printf.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define FLAG_LEFT 0x1
+#define FLAG_SIGN 0x2
+#define FLAG_SPACE 0x4
+#define FLAG_ALT 0x8
+#define FLAG_ZERO 0x10
+#define FLAG_UPPER 0x20
+
+// Enough base 10^9 limbs for the exact value of any double, which can have up to 767 significant digits
+#define BIGNUM_LIMBS 90
+#define BIGNUM_DIGITS (BIGNUM_LIMBS * 9)
+
+const char __digit_pairs[200] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static inline char* fmt_dec32(uint32_t value, char* end) {
+	while(value >= 100) {
+		uint32_t pair = value % 100;
+		value /= 100;
+		end -= 2;
+		memcpy(end, &__digit_pairs[pair * 2], 2);
+	}
+	if(value >= 10) {
+		end -= 2;
+		memcpy(end, &__digit_pairs[value * 2], 2);
+	} else {
+		*--end = (char) ('0' + value);
+	}
+	return end;
+}
+
+char* __fmt_dec(uint64_t value, char* end) {
+	//64-bit division is a library call on i686, so split the number into 9-digit chunks that can be done in 32 bits
+	while(value > UINT32_MAX) {
+		uint64_t quotient = value / 1000000000;
+		char* start = fmt_dec32((uint32_t) (value - quotient * 1000000000), end);
+		end -= 9;
+		memset(end, '0', start - end);
+		value = quotient;
+	}
+	return fmt_dec32((uint32_t) value, end);
+}
+
+char* __fmt_hex(uint64_t value, char* end, bool upper) {
+	const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+	do {
+		*--end = digits[value & 0xFu];
+		value >>= 4;
+	} while(value);
+	return end;
+}
 
-void hex_str(unsigned int val, char** buf, unsigned int width, size_t n, size_t* len, bool upper, char pad) {
-	//Figure out the width of the resulting string
-	size_t num_chars = 0;
-	unsigned int val2 = val;
+static char* fmt_oct(uint64_t value, char* end) {
 	do {
-		num_chars ++;
-		val2 /= 0x10;
-	} while(val2);
-
-	//Pad
-	for(size_t i = num_chars; i < width && *len < n; i++) {
-		**buf = pad;
-		(*buf)++;
-		(*len)++;
+		*--end = (char) ('0' + (value & 7u));
+		value >>= 3;
+	} while(value);
+	return end;
+}
+
+/*
+ * Output goes through these, which keep counting once the buffer is full so the full length can be returned.
+ */
+struct printf_out {
+	char* buf;
+	size_t size;
+	size_t len;
+};
+
+static void out_chars(struct printf_out* out, const char* str, size_t count) {
+	if(out->len < out->size) {
+		size_t space = out->size - out->len;
+		memcpy(out->buf + out->len, str, count < space ? count : space);
 	}
+	out->len += count;
+}
 
-	if(*len - n < num_chars)
-		num_chars = *len - n;
+static void out_fill(struct printf_out* out, char c, size_t count) {
+	if(out->len < out->size) {
+		size_t space = out->size - out->len;
+		memset(out->buf + out->len, c, count < space ? count : space);
+	}
+	out->len += count;
+}
+
+struct printf_spec {
+	int flags;
+	size_t width;
+	int precision;
+};
+
+/**
+ * Writes a formatted number out, padded to the width. The zeroes are put between the prefix (the sign and 0x) and the
+ * body, which is how both zero padding and integer precision work.
+ */
+static void out_padded(struct printf_out* out, const struct printf_spec* spec, const char* prefix, size_t prefix_len,
+					   size_t zeroes, const char* body, size_t body_len) {
+	size_t len = prefix_len + zeroes + body_len;
+	size_t padding = spec->width > len ? spec->width - len : 0;
+	if(!(spec->flags & FLAG_LEFT))
+		out_fill(out, ' ', padding);
+	out_chars(out, prefix, prefix_len);
+	out_fill(out, '0', zeroes);
+	out_chars(out, body, body_len);
+	if(spec->flags & FLAG_LEFT)
+		out_fill(out, ' ', padding);
+}
 
-	//Print the hex
-	char* hex = upper ? "0123456789ABCDEF" : "0123456789abcdef";
-	for(size_t i = 1; i <= num_chars; i++) {
-		**buf = hex[(val >> ((num_chars - i) * 4)) & 0xFu];
-		(*buf)++;
+static void format_integer(struct printf_out* out, const struct printf_spec* spec, uint64_t value, bool negative, char conversion) {
+	char buf[24];
+	char* end = buf + sizeof(buf);
+	char* digits;
+	char prefix[2];
+	size_t prefix_len = 0;
+
+	if(conversion == 'o') {
+		digits = fmt_oct(value, end);
+	} else if(conversion == 'x' || conversion == 'X') {
+		digits = __fmt_hex(value, end, conversion == 'X');
+		if((spec->flags & FLAG_ALT) && value) {
+			prefix[0] = '0';
+			prefix[1] = conversion;
+			prefix_len = 2;
+		}
+	} else {
+		digits = __fmt_dec(value, end);
+		if(negative)
+			prefix[prefix_len++] = '-';
+		else if(spec->flags & FLAG_SIGN)
+			prefix[prefix_len++] = '+';
+		else if(spec->flags & FLAG_SPACE)
+			prefix[prefix_len++] = ' ';
 	}
 
-	(*len) += num_chars;
+	//A precision of zero means zero is printed as nothing at all
+	size_t ndigits = end - digits;
+	if(!value && !spec->precision)
+		ndigits = 0;
+
+	size_t zeroes = 0;
+	if(spec->precision >= 0) {
+		if((size_t) spec->precision > ndigits)
+			zeroes = spec->precision - ndigits;
+	} else if((spec->flags & FLAG_ZERO) && !(spec->flags & FLAG_LEFT)) {
+		if(spec->width > prefix_len + ndigits)
+			zeroes = spec->width - prefix_len - ndigits;
+	}
+
+	//The alternate form of octal always starts with a zero
+	if(conversion == 'o' && (spec->flags & FLAG_ALT) && !zeroes && (!ndigits || *digits != '0'))
+		zeroes = 1;
+
+	out_padded(out, spec, prefix, prefix_len, zeroes, end - ndigits, ndigits);
 }
 
-void dec_str(unsigned int val, char** buf, unsigned int width, size_t n, size_t* len, char pad) {
-	//Figure out the width of the resulting string
-	size_t num_chars = 0;
-	unsigned int val2 = val;
-	do {
-		num_chars++;
-		val2 /= 10;
-	} while(val2);
-
-	//Pad
-	for(size_t i = num_chars; i < width && *len < n; i++) {
-		**buf = pad;
-		(*buf)++;
-		(*len)++;
+/*
+ * Floating point numbers are printed exactly, like glibc does. The double is turned into a big integer in base 10^9
+ * (its mantissa times 2^exponent, or times 5^-exponent with the decimal point moved over) and then rounded to the
+ * number of digits asked for.
+ */
+struct decimal {
+	char digits[BIGNUM_DIGITS];
+	int ndigits;
+	int point; //The number of digits before the decimal point, which can be negative or past the end of the digits
+};
+
+static void bignum_mul(uint32_t* limbs, int* nlimbs, uint32_t factor) {
+	uint64_t carry = 0;
+	for(int i = 0; i < *nlimbs; i++) {
+		uint64_t product = (uint64_t) limbs[i] * factor + carry;
+		carry = product / 1000000000;
+		limbs[i] = (uint32_t) (product - carry * 1000000000);
+	}
+	while(carry) {
+		uint64_t next = carry / 1000000000;
+		limbs[(*nlimbs)++] = (uint32_t) (carry - next * 1000000000);
+		carry = next;
 	}
+}
 
-	if(*len - n < num_chars)
-		num_chars = *len - n;
+static void decimal_from_double(struct decimal* dec, double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint64_t mantissa = bits & ((1ull << 52) - 1);
+	int exponent = (int) ((bits >> 52) & 0x7FF);
+	if(!exponent && !mantissa) {
+		dec->digits[0] = '0';
+		dec->ndigits = 1;
+		dec->point = 1;
+		return;
+	}
+	if(exponent)
+		mantissa |= 1ull << 52;
+	else
+		exponent = 1;
+	exponent -= 1023 + 52;
+
+	uint32_t limbs[BIGNUM_LIMBS];
+	int nlimbs = 0;
+	while(mantissa) {
+		uint64_t next = mantissa / 1000000000;
+		limbs[nlimbs++] = (uint32_t) (mantissa - next * 1000000000);
+		mantissa = next;
+	}
 
-	(*buf) += num_chars - 1;
+	int shift = 0;
+	if(exponent > 0) {
+		for(; exponent >= 29; exponent -= 29)
+			bignum_mul(limbs, &nlimbs, 1u << 29);
+		bignum_mul(limbs, &nlimbs, 1u << exponent);
+	} else if(exponent < 0) {
+		shift = -exponent;
+		for(; exponent <= -13; exponent += 13)
+			bignum_mul(limbs, &nlimbs, 1220703125); //5^13
+		uint32_t factor = 1;
+		for(; exponent < 0; exponent++)
+			factor *= 5;
+		bignum_mul(limbs, &nlimbs, factor);
+	}
+
+	char* end = dec->digits + BIGNUM_DIGITS;
+	char* start = end;
+	for(int i = 0; i < nlimbs - 1; i++) {
+		char* limb_start = fmt_dec32(limbs[i], start);
+		start -= 9;
+		memset(start, '0', limb_start - start);
+	}
+	start = fmt_dec32(limbs[nlimbs - 1], start);
+
+	//Trailing zeroes don't matter since the digits are padded with zeroes anyway
+	while(end[-1] == '0')
+		end--;
+	dec->point = (int) (dec->digits + BIGNUM_DIGITS - start) - shift;
+	dec->ndigits = (int) (end - start);
+	memmove(dec->digits, start, dec->ndigits);
+}
 
-	//Print the decimal
-	for(size_t i = 0; i < num_chars; i++) {
-		**buf = "0123456789"[val % 10];
-		val /= 10;
-		(*buf)--;
+/** Rounds the decimal to the first keep digits, with ties going to even. **/
+static void decimal_round(struct decimal* dec, int keep) {
+	if(keep >= dec->ndigits)
+		return;
+	if(keep < 0) {
+		dec->digits[0] = '0';
+		dec->ndigits = 1;
+		dec->point = 1;
+		return;
 	}
 
-	(*len) += num_chars;
-	(*buf) += num_chars + 1;
+	bool round_up = dec->digits[keep] > '5';
+	if(dec->digits[keep] == '5') {
+		//Trailing zeroes were stripped, so it's exactly halfway if the 5 is the last digit
+		round_up = keep + 1 < dec->ndigits || (keep > 0 && (dec->digits[keep - 1] - '0') % 2);
+	}
+	dec->ndigits = keep;
+
+	if(round_up) {
+		int i = keep - 1;
+		while(i >= 0 && dec->digits[i] == '9')
+			i--;
+		if(i < 0) {
+			//All nines, so it carries into a new digit
+			dec->digits[0] = '1';
+			dec->ndigits = 1;
+			dec->point++;
+			return;
+		}
+		dec->digits[i]++;
+		dec->ndigits = i + 1;
+	}
+
+	while(dec->ndigits > 1 && dec->digits[dec->ndigits - 1] == '0')
+		dec->ndigits--;
+	if(!dec->ndigits) {
+		dec->digits[0] = '0';
+		dec->ndigits = 1;
+		dec->point = 1;
+	}
 }
 
-int common_printf(char* s, size_t n, const char* format, va_list arg) {
-	char* buf = s;
-	size_t len = 0;
-	for(const char* p = format; *p && len < n; p++) {
-		int precision = -1;
-
-		//If it's not a percent, add it to the buffer
-		if(*p != '%') {
-			*buf++ = *p;
-			len++;
-			continue;
+static void out_digits(struct printf_out* out, const struct decimal* dec, int from, int count) {
+	//Prints count digits starting at from, where anything outside of the digits is a zero
+	if(from < 0) {
+		int zeroes = count < -from ? count : -from;
+		out_fill(out, '0', zeroes);
+		count -= zeroes;
+		from = 0;
+	}
+	if(from < dec->ndigits) {
+		int available = dec->ndigits - from;
+		int n = count < available ? count : available;
+		out_chars(out, dec->digits + from, n);
+		count -= n;
+	}
+	out_fill(out, '0', count);
+}
+
+static void format_float(struct printf_out* out, const struct printf_spec* spec, double value, char conversion) {
+	bool upper = conversion >= 'A' && conversion <= 'Z';
+	conversion |= 0x20;
+
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	char sign[3];
+	size_t sign_len = 0;
+	if(bits >> 63)
+		sign[sign_len++] = '-';
+	else if(spec->flags & FLAG_SIGN)
+		sign[sign_len++] = '+';
+	else if(spec->flags & FLAG_SPACE)
+		sign[sign_len++] = ' ';
+	bits &= ~(1ull << 63);
+
+	if((bits >> 52) == 0x7FF) {
+		const char* str = (bits << 12) ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf");
+		struct printf_spec nozero = *spec;
+		nozero.flags &= ~FLAG_ZERO;
+		out_padded(out, &nozero, sign, sign_len, 0, str, 3);
+		return;
+	}
+
+	//The padding has to go before the sign unless it's zeroes, so the length is worked out before anything is printed
+	size_t len;
+	size_t padding = 0;
+	#define PAD_BEFORE() do { \
+		padding = spec->width > len ? spec->width - len : 0; \
+		if(!(spec->flags & (FLAG_LEFT | FLAG_ZERO))) \
+			out_fill(out, ' ', padding); \
+		out_chars(out, sign, sign_len); \
+		if((spec->flags & FLAG_ZERO) && !(spec->flags & FLAG_LEFT)) \
+			out_fill(out, '0', padding); \
+	} while(0)
+	#define PAD_AFTER() do { \
+		if(spec->flags & FLAG_LEFT) \
+			out_fill(out, ' ', padding); \
+	} while(0)
+
+	if(conversion == 'a') {
+		int exponent = (int) (bits >> 52);
+		uint64_t mantissa = bits & ((1ull << 52) - 1);
+		int lead = exponent ? 1 : 0;
+		if(!exponent && mantissa)
+			exponent = -1022;
+		else if(exponent)
+			exponent -= 1023;
+
+		int ndigits = 13;
+		if(spec->precision >= 0 && spec->precision < 13) {
+			//The leading digit is rounded along with the rest, since it can be what makes it even or carry into a 2
+			int shift = (13 - spec->precision) * 4;
+			mantissa |= (uint64_t) lead << 52;
+			uint64_t rem = mantissa & ((1ull << shift) - 1);
+			uint64_t half = 1ull << (shift - 1);
+			mantissa >>= shift;
+			if(rem > half || (rem == half && (mantissa & 1)))
+				mantissa++;
+			ndigits = spec->precision;
+			lead = (int) (mantissa >> (ndigits * 4));
+			mantissa &= (1ull << (ndigits * 4)) - 1;
+		} else {
+			while(ndigits && !(mantissa & 0xF)) {
+				mantissa >>= 4;
+				ndigits--;
+			}
 		}
+		size_t zeroes = spec->precision > ndigits ? spec->precision - ndigits : 0;
+
+		char hex[16];
+		char* hex_end = hex + sizeof(hex);
+		char* hex_start = ndigits ? __fmt_hex(mantissa, hex_end, upper) : hex_end;
+		while(hex_end - hex_start < ndigits)
+			*--hex_start = '0';
+		char exp_buf[8];
+		char* exp_end = exp_buf + sizeof(exp_buf);
+		char* exp_start = __fmt_dec(exponent < 0 ? -exponent : exponent, exp_end);
+		*--exp_start = exponent < 0 ? '-' : '+';
+		*--exp_start = upper ? 'P' : 'p';
+
+		//Zero padding goes after the 0x, so it's treated as part of the sign
+		sign[sign_len++] = '0';
+		sign[sign_len++] = upper ? 'X' : 'x';
+		char lead_digit = (char) ('0' + lead);
+		bool point = ndigits || zeroes || (spec->flags & FLAG_ALT);
+		len = sign_len + 1 + point + ndigits + zeroes + (exp_end - exp_start);
+		PAD_BEFORE();
+		out_chars(out, &lead_digit, 1);
+		if(point)
+			out_chars(out, ".", 1);
+		out_chars(out, hex_start, ndigits);
+		out_fill(out, '0', zeroes);
+		out_chars(out, exp_start, exp_end - exp_start);
+		PAD_AFTER();
+		return;
+	}
 
+	struct decimal dec;
+	decimal_from_double(&dec, value < 0 ? -value : value);
+	int precision = spec->precision < 0 ? 6 : spec->precision;
+	bool alt = spec->flags & FLAG_ALT;
+	bool is_zero = dec.digits[0] == '0';
+
+	if(conversion == 'g') {
+		//%g uses %e's format if the exponent would be less than -4 or at least the precision, and %f's otherwise
+		if(!precision)
+			precision = 1;
+		decimal_round(&dec, precision);
+		int exponent = is_zero ? 0 : dec.point - 1;
+		if(exponent >= -4 && exponent < precision) {
+			conversion = 'f';
+			precision = precision - 1 - exponent;
+			if(!alt)
+				precision = dec.ndigits - dec.point > 0 ? dec.ndigits - dec.point : 0;
+		} else {
+			conversion = 'e';
+			precision -= 1;
+			if(!alt)
+				precision = dec.ndigits - 1;
+		}
+	} else if(conversion == 'e') {
+		decimal_round(&dec, precision + 1);
+	} else {
+		decimal_round(&dec, dec.point + precision);
+	}
+	bool point = precision || alt;
+
+	if(conversion == 'f') {
+		int int_digits = dec.point > 0 ? dec.point : 1;
+		len = sign_len + int_digits + point + precision;
+		PAD_BEFORE();
+		if(dec.point > 0)
+			out_digits(out, &dec, 0, dec.point);
+		else
+			out_chars(out, "0", 1);
+		if(point)
+			out_chars(out, ".", 1);
+		out_digits(out, &dec, dec.point, precision);
+		PAD_AFTER();
+		return;
+	}
+
+	int exponent = is_zero ? 0 : dec.point - 1;
+	char exp_buf[8];
+	char* exp_end = exp_buf + sizeof(exp_buf);
+	char* exp_start = __fmt_dec(exponent < 0 ? -exponent : exponent, exp_end);
+	if(exp_end - exp_start < 2)
+		*--exp_start = '0';
+	*--exp_start = exponent < 0 ? '-' : '+';
+	*--exp_start = upper ? 'E' : 'e';
+
+	len = sign_len + 1 + point + precision + (exp_end - exp_start);
+	PAD_BEFORE();
+	out_chars(out, dec.digits, 1);
+	if(point)
+		out_chars(out, ".", 1);
+	out_digits(out, &dec, 1, precision);
+	out_chars(out, exp_start, exp_end - exp_start);
+	PAD_AFTER();
+
+	#undef PAD_BEFORE
+	#undef PAD_AFTER
+}
+
+enum length_modifier {
+	LEN_DEFAULT,
+	LEN_CHAR,
+	LEN_SHORT,
+	LEN_LONG,
+	LEN_LONG_LONG,
+	LEN_INTMAX,
+	LEN_SIZE,
+	LEN_PTRDIFF,
+	LEN_LONG_DOUBLE
+};
+
+int common_printf(char* s, size_t n, const char* format, va_list arg) {
+	struct printf_out out = {s, n ? n - 1 : 0, 0};
+	const char* p = format;
+	while(*p) {
+		//Copy everything up until the next conversion all at once
+		const char* next = p;
+		while(*next && *next != '%')
+			next++;
+		out_chars(&out, p, next - p);
+		p = next;
+		if(!*p)
+			break;
 		p++;
-		bool zero_pad = false;
-		bool force_sign = false;
-		bool left_justify = false;
-		bool alt_prefix = false;
-		bool space_no_sign = false;
-		uint8_t size = 0;
-		unsigned int arg_width = 0;
-
-		//Interpret arguments to the format
-		while(1) {
-			char ch = *p;
-			if(ch == '-') {
-				left_justify = true;
-				p++;
-			} else if(ch == '+') {
-				force_sign = true;
-				p++;
-			} else if(ch == '0') {
-				zero_pad = true;
-				p++;
-			} else if(ch == '*') {
-				arg_width = (char) va_arg(arg, int);
-				p++;
-			} else if(ch == '#') {
-				alt_prefix = true;
-				p++;
-			} else if(ch == ' ') {
-				space_no_sign = true;
-				p++;
-			} else break;
+
+		struct printf_spec spec = {0, 0, -1};
+		for(;; p++) {
+			if(*p == '-')
+				spec.flags |= FLAG_LEFT;
+			else if(*p == '+')
+				spec.flags |= FLAG_SIGN;
+			else if(*p == ' ')
+				spec.flags |= FLAG_SPACE;
+			else if(*p == '#')
+				spec.flags |= FLAG_ALT;
+			else if(*p == '0')
+				spec.flags |= FLAG_ZERO;
+			else
+				break;
 		}
 
-		//Interpret the argument width
-		INTERPRET_NUMBER(p, arg_width);
+		if(*p == '*') {
+			//A negative width from the arguments means the same as the - flag
+			int width = va_arg(arg, int);
+			if(width < 0) {
+				spec.flags |= FLAG_LEFT;
+				width = -width;
+			}
+			spec.width = width;
+			p++;
+		} else {
+			INTERPRET_NUMBER(p, spec.width);
+		}
 
-		//Interpret argument precision
 		if(*p == '.') {
 			p++;
-			precision = 0;
 			if(*p == '*') {
-				//Precision is given in argument list
-				precision = (int) va_arg(arg, int);
+				//A negative precision from the arguments is the same as not having one
+				spec.precision = va_arg(arg, int);
+				if(spec.precision < 0)
+					spec.precision = -1;
 				p++;
 			} else {
-				//Precision is given in string
-				INTERPRET_NUMBER(p, precision);
+				spec.precision = 0;
+				INTERPRET_NUMBER(p, spec.precision);
 			}
 		}
 
-		//Interpret number size
-		if(*p == 'z') {
-			size = 1;
-			p++;
-		} else if(*p == 'l') {
-			p++;
-			size = 1;
-			if(*p == 'l') {
-				p++;
-				size = 2;
-			}
-		}
-
-		bool uppercase = false;
+		enum length_modifier length = LEN_DEFAULT;
 		switch(*p) {
-			case 'c': //Character
-				*buf++ = (char) va_arg(arg, int);
-				len++;
-				break;
-
-			case 'p': //Pointer address
-				if(!arg_width)
-					arg_width = 8;
-				zero_pad = true;
-				goto hex;
-			case 'X':
-				uppercase = true;
-			case 'x': //Hex
-			hex:
-				if(alt_prefix) {
-					*buf++ = '0';
-					*buf++ = 'x';
-					len += 2;
-				}
-
-				//Precision can also be used for zero padding with ints / hex
-				if(precision != -1) {
-					arg_width = precision;
-					zero_pad = true;
+			case 'h':
+				length = LEN_SHORT;
+				if(*++p == 'h') {
+					length = LEN_CHAR;
+					p++;
 				}
-
-				if(size == 2) { //long long
-					unsigned long long val = (unsigned long long) va_arg(arg, unsigned long long);
-					if(val > 0xFFFFFFFF)
-						hex_str(val >> 32, &buf, arg_width > 8 ? (arg_width - 8) : 0, n, &len, uppercase, zero_pad ? '0' : ' ');
-					hex_str(val & 0xFFFFFFFF, &buf, arg_width > 8 ? 8 : arg_width, n, &len, uppercase, zero_pad ? '0' : ' ');
-				} else { //unsigned long or smaller
-					unsigned long val = va_arg(arg, unsigned long);
-					hex_str(val, &buf, arg_width, n, &len, uppercase, zero_pad ? '0' : ' ');
+				break;
+			case 'l':
+				length = LEN_LONG;
+				if(*++p == 'l') {
+					length = LEN_LONG_LONG;
+					p++;
 				}
 				break;
+			case 'j':
+				length = LEN_INTMAX;
+				p++;
+				break;
+			case 'z':
+				length = LEN_SIZE;
+				p++;
+				break;
+			case 't':
+				length = LEN_PTRDIFF;
+				p++;
+				break;
+			case 'L':
+				length = LEN_LONG_DOUBLE;
+				p++;
+				break;
+		}
 
-			case 'i':
-			case 'd': //Dec
-			{
+		char conversion = *p;
+		if(!conversion)
+			break;
+		p++;
+		switch(conversion) {
+			case 'd':
+			case 'i': {
 				long long val;
-				if(size == 2)
-					val = (long long) va_arg(arg, long long);
-				else
-				val = (long long) va_arg(arg, long);
-
-				//Print sign if necessary
-				if(val < 0) {
-					*buf++ = '-';
-					val = -val;
-					len++;
-				} else if(force_sign) {
-					*buf++ = '+';
-					len++;
-				} else if(space_no_sign) {
-					*buf++ = ' ';
-					len++;
+				switch(length) {
+					case LEN_CHAR: val = (signed char) va_arg(arg, int); break;
+					case LEN_SHORT: val = (short) va_arg(arg, int); break;
+					case LEN_LONG: val = va_arg(arg, long); break;
+					case LEN_LONG_LONG: val = va_arg(arg, long long); break;
+					case LEN_INTMAX: val = va_arg(arg, intmax_t); break;
+					case LEN_SIZE: val = va_arg(arg, ssize_t); break;
+					case LEN_PTRDIFF: val = va_arg(arg, ptrdiff_t); break;
+					default: val = va_arg(arg, int); break;
 				}
-
-				//Precision can also be used for zero padding with ints / hex
-				if(precision != -1) {
-					arg_width = precision;
-					zero_pad = true;
-				}
-
-				dec_str(val, &buf, arg_width, n, &len, zero_pad ? '0' : ' ');
+				format_integer(&out, &spec, val < 0 ? -(uint64_t) val : (uint64_t) val, val < 0, 'd');
 				break;
 			}
 
-			case 'u': //Unsigned dec
-			{
+			case 'u':
+			case 'o':
+			case 'x':
+			case 'X': {
 				unsigned long long val;
-				if(size == 2)
-					val = (unsigned long long) va_arg(arg, unsigned long long);
-				else
-					val = (unsigned long long) va_arg(arg, unsigned long);
-
-				//Print sign if necessary
-				if(force_sign) {
-					*buf++ = '+';
-					len++;
-				} else if(space_no_sign) {
-					*buf++ = ' ';
-					len++;
-				}
-
-				//Precision can also be used for zero padding with ints / hex
-				if(precision != -1) {
-					arg_width = precision;
-					zero_pad = true;
+				switch(length) {
+					case LEN_CHAR: val = (unsigned char) va_arg(arg, unsigned int); break;
+					case LEN_SHORT: val = (unsigned short) va_arg(arg, unsigned int); break;
+					case LEN_LONG: val = va_arg(arg, unsigned long); break;
+					case LEN_LONG_LONG: val = va_arg(arg, unsigned long long); break;
+					case LEN_INTMAX: val = va_arg(arg, uintmax_t); break;
+					case LEN_SIZE: val = va_arg(arg, size_t); break;
+					case LEN_PTRDIFF: val = (size_t) va_arg(arg, ptrdiff_t); break;
+					default: val = va_arg(arg, unsigned int); break;
 				}
+				format_integer(&out, &spec, val, false, conversion);
+				break;
+			}
 
-				dec_str(val, &buf, arg_width, n, &len, zero_pad ? '0' : ' ');
+			case 'p': {
+				//Pointers are eight digits of hex, with 0x only if # is given
+				void* val = va_arg(arg, void*);
+				if(spec.precision < 0)
+					spec.precision = 8;
+				format_integer(&out, &spec, (uintptr_t) val, false, 'x');
 				break;
 			}
 
+			case 'f':
 			case 'F':
-				uppercase = true;
-			case 'f': //Double
-			{
-				double val = (double) va_arg(arg, double);
-
-				//Print sign if necessary
-				if(val < 0) {
-					*buf++ = '-';
-					val = -val;
-					len++;
-				} else if(force_sign) {
-					*buf++ = '+';
-					len++;
-				} else if(space_no_sign) {
-					*buf++ = ' ';
-					len++;
-				}
-
-				//Print before decimal
-				dec_str((int) val, &buf, arg_width, n, &len, zero_pad ? '0' : ' ');
-
-				//Print decimal
-				if(len < n) {
-					*buf++ = '.';
-					len++;
-				}
-
-				//Print decimal places
-				int num_places = (precision > -1 && precision < 8) ? precision : 8;
-				for (int d = 0; d < num_places && len < n; d++) {
-					if ((int) (val * 100000.0) % 100000 == 0 && d != 0)
-						break;
-					val *= 10.0;
-					*buf++ = "0123456789"[((int) val) % 10];
-					len++;
-				}
+			case 'e':
+			case 'E':
+			case 'g':
+			case 'G':
+			case 'a':
+			case 'A': {
+				//long double is printed with the precision of a double
+				double val;
+				if(length == LEN_LONG_DOUBLE)
+					val = (double) va_arg(arg, long double);
+				else
+					val = va_arg(arg, double);
+				format_float(&out, &spec, val, conversion);
+				break;
+			}
 
+			case 'c': {
+				char c = (char) va_arg(arg, int);
+				struct printf_spec char_spec = {spec.flags & FLAG_LEFT, spec.width, -1};
+				out_padded(&out, &char_spec, NULL, 0, 0, &c, 1);
 				break;
 			}
 
-			case 's': //String
-			{
-				char* str = (char*) va_arg(arg, char*);
-				if(!str) str = "(null)";
-				size_t nchr = 0;
-				//Precision and arg width are used as string length
-				if(precision < 0) {
-					while(*str && len < n) {
-						*buf++ = *str++;
-						nchr++;
-						len++;
-						if(arg_width && nchr == arg_width) break;
-					}
+			case 's': {
+				const char* str = va_arg(arg, const char*);
+				if(!str)
+					str = "(null)";
+				size_t len;
+				if(spec.precision >= 0) {
+					//The string doesn't need to be terminated if it's at least as long as the precision
+					const char* end = memchr(str, '\0', spec.precision);
+					len = end ? (size_t) (end - str) : (size_t) spec.precision;
 				} else {
-					while(*str && precision && len < n) {
-						*buf++ = *str++;
-						nchr++;
-						precision--;
-						len++;
-						if(arg_width && nchr == arg_width) break;
-					}
+					len = strlen(str);
 				}
+				struct printf_spec str_spec = {spec.flags & FLAG_LEFT, spec.width, -1};
+				out_padded(&out, &str_spec, NULL, 0, 0, str, len);
 				break;
 			}
 
-			case '%':
-				*buf++ = '%';
-				len++;
+			case 'n':
+				switch(length) {
+					case LEN_CHAR: *va_arg(arg, signed char*) = (signed char) out.len; break;
+					case LEN_SHORT: *va_arg(arg, short*) = (short) out.len; break;
+					case LEN_LONG: *va_arg(arg, long*) = (long) out.len; break;
+					case LEN_LONG_LONG: *va_arg(arg, long long*) = (long long) out.len; break;
+					case LEN_INTMAX: *va_arg(arg, intmax_t*) = (intmax_t) out.len; break;
+					case LEN_SIZE: *va_arg(arg, size_t*) = out.len; break;
+					case LEN_PTRDIFF: *va_arg(arg, ptrdiff_t*) = (ptrdiff_t) out.len; break;
+					default: *va_arg(arg, int*) = (int) out.len; break;
+				}
 				break;
 
 			default:
-				//TODO: e, E, g, G, n
-				*buf++ = *p;
-				len++;
+				//% and anything that isn't a conversion are printed as-is
+				out_chars(&out, &conversion, 1);
 				break;
 		}
 	}
 
-	*buf = '\0';
-	return len;
-}
\ No newline at end of file
+	if(n)
+		s[out.len < out.size ? out.len : out.size] = '\0';
+	return (int) out.len;
+}
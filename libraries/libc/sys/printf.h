@@ -22,6 +22,7 @@
 
 #include <sys/cdefs.h>
 #include <sys/types.h>
+#include <stdint.h>
 #include <stdarg.h>
 #include <stdbool.h>
 
@@ -35,9 +36,29 @@ __DECL_BEGIN
 		(s)++; \
 	}
 
+/**
+ * Formats into s like vsnprintf: at most n - 1 characters are written followed by a null terminator, and the length of
+ * the whole formatted string is returned even if it didn't fit.
+ */
 int common_printf(char* s, size_t n, const char* format, va_list arg);
-void dec_str(unsigned int val, char** buf, unsigned int width, size_t n, size_t* len, char pad);
-void hex_str(unsigned int val, char** buf, unsigned int width, size_t n, size_t* len, bool upper, char pad);
+
+/*
+ * The pieces printf is built out of, which libduck's FormatStream also uses. The number formatters write the digits
+ * backwards into the space before end and return where they start, so the caller doesn't need to know the length first.
+ */
+
+/** "00" through "99", so integers can be converted two digits at a time. **/
+extern const char __digit_pairs[200];
+
+char* __fmt_dec(uint64_t value, char* end);
+char* __fmt_hex(uint64_t value, char* end, bool upper);
+
+/**
+ * Gets the shortest digits that read back as value, which must be positive and finite, so that value is digits times
+ * 10^exponent. Returns the number of digits, which is at most 17.
+ */
+int __fmt_shortest(double value, char* digits, int* exponent);
+int __fmt_shortestf(float value, char* digits, int* exponent);
 
 __DECL_END
 
@@ -0,0 +1,9 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "random.h"
+#include "syscall.h"
+
+ssize_t getrandom(void* buf, size_t buflen, unsigned int flags) {
+	return syscall4(SYS_GETRANDOM, (int) buf, (int) buflen, (int) flags);
+}
@@ -0,0 +1,13 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <sys/types.h>
+#include <kernel/api/random.h>
+
+__DECL_BEGIN
+
+ssize_t getrandom(void* buf, size_t buflen, unsigned int flags);
+
+__DECL_END
@@ -0,0 +1,21 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "resource.h"
+#include "syscall.h"
+
+int getpriority(int which, id_t who) {
+	// The kernel returns PRIO_MAX - nice so that negative nice values can't be mistaken for errors
+	int ret = syscall3(SYS_GETPRIORITY, which, (int) who);
+	if(ret == -1)
+		return -1;
+	return PRIO_MAX - ret;
+}
+
+int setpriority(int which, id_t who, int value) {
+	return syscall4(SYS_SETPRIORITY, which, (int) who, value);
+}
+
+int getrusage(int who, struct rusage* usage) {
+	return syscall3(SYS_GETRUSAGE, who, (int) usage);
+}
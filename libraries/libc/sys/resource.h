@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <sys/types.h>
+#include <kernel/api/resource.h>
+
+__DECL_BEGIN
+
+int getpriority(int which, id_t who);
+int setpriority(int which, id_t who, int value);
+int getrusage(int who, struct rusage* usage);
+
+__DECL_END
@@ -35,4 +35,8 @@ int shmdetach(int id) {
 
 int shmallow(int id, pid_t pid, int perms) {
 	return syscall4(SYS_SHMALLOW, id, pid, perms);
+}
+
+int shmpurgeable(int id, int purgeable) {
+	return syscall3(SYS_SHMPURGEABLE, id, purgeable);
 }
\ No newline at end of file
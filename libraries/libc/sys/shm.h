@@ -36,7 +36,8 @@ __DECL_BEGIN
 int shmcreate(void* addr, size_t size, struct shm* s);
 
 /**
- * Attaches an already-created area of shared memory to the program.
+ * Attaches an already-created area of shared memory to the program. If it's already attached, the same mapping is
+ * returned, and it has to be detached as many times as it was attached. Pages are mapped in as they're first touched.
  * @param id The ID, given in struct shm by shmcreate(), of the shared memory area to attach.
  * @param addr NULL, or a specific address to attach the memory to. Will be rounded down to be page-aligned.
  * @param s A pointer to a struct shm where information about the attached memory area will be stored.
@@ -53,11 +54,22 @@ int shmdetach(int id);
 
 /**
  * Allows another process access to a shared memory segment with certain permissions. CANNOT be used to revoke permissions.
+ * With SHM_TRANSFER, the segment is handed over instead: the calling process loses its access and is detached from
+ * it, without the memory being copied.
  * @param id The ID of the shared memory segment to allow access to.
  * @param pid The pid of the process to allow.
- * @param perms The permissions to allow. (SHM_READ, SHM_WRITE, and SHM_SHARE)
- * @return
+ * @param perms The permissions to allow. (SHM_READ, SHM_WRITE, SHM_SHARE, and SHM_TRANSFER)
+ * @return 0 if successful, -1 if not.
  */
 int shmallow(int id, pid_t pid, int perms);
 
+/**
+ * Marks a shared memory segment as purgeable or not. While a segment is purgeable, the kernel may throw away its
+ * contents when memory is low, after which it reads as zeroes. Useful for caches that can be regenerated.
+ * @param id The ID of the shared memory segment. The calling process needs write access to it.
+ * @param purgeable Nonzero to make the segment purgeable, zero to make it not purgeable.
+ * @return 1 if the contents were purged since the segment was last made purgeable, 0 if not, or -1 on error.
+ */
+int shmpurgeable(int id, int purgeable);
+
 __DECL_END
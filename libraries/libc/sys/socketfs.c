@@ -33,6 +33,8 @@ struct socketfs_packet* read_packet(int fd) {
 	ret->sender = packet_header.sender;
 	ret->sender_pid = packet_header.sender_pid;
 	ret->length = packet_header.length;
+	ret->shm_id = packet_header.shm_id;
+	ret->shm_perms = packet_header.shm_perms;
 
 	if(packet_header.length) {
 		if(read(fd, ret->data, packet_header.length) < 0) {
@@ -52,7 +54,51 @@ int write_packet_of_type(int fd, int type, sockid_t id, int shm_id, int shm_perm
 	packet->shm_id = shm_id;
 	packet->shm_perms = shm_perms;
 	memcpy(packet->data, data, length);
-	int ret = write(fd, packet, length);
+	int ret = write(fd, packet, sizeof(struct socketfs_packet) + length);
 	free(packet);
 	return ret;
+}
+
+struct socketfs_packet* read_packets(int fd, size_t* length) {
+	size_t capacity = SOCKETFS_MAX_BUFFER_SIZE;
+	uint8_t* buf = malloc(capacity);
+	ssize_t nread = read(fd, buf, capacity);
+	if(nread <= 0) {
+		free(buf);
+		return NULL;
+	}
+
+	//Packets are always queued whole, so if the last one got cut off, the rest of it is already waiting to be read
+	size_t size = nread;
+	size_t offset = 0;
+	while(offset < size) {
+		size_t needed = offset + sizeof(struct socketfs_packet);
+		if(size >= needed) {
+			needed += ((struct socketfs_packet*) (buf + offset))->length;
+			if(size >= needed) {
+				offset = needed;
+				continue;
+			}
+		}
+
+		if(needed > capacity) {
+			capacity = needed;
+			buf = realloc(buf, capacity);
+		}
+		while(size < needed) {
+			nread = read(fd, buf + size, needed - size);
+			if(nread <= 0) {
+				free(buf);
+				return NULL;
+			}
+			size += nread;
+		}
+	}
+
+	*length = size;
+	return (struct socketfs_packet*) buf;
+}
+
+int write_packets(int fd, struct socketfs_packet* packets, size_t length) {
+	return write(fd, packets, length);
 }
\ No newline at end of file
@@ -50,6 +50,21 @@ __DECL_BEGIN
 
 struct socketfs_packet* read_packet(int fd);
 
+/**
+ * Reads every packet waiting on a socket with as few reads as possible. The packets are put one after another in a
+ * buffer (which should be freed), each taking up sizeof(struct socketfs_packet) + length bytes.
+ * @param length Set to the total size of the packets read.
+ * @return The packets, or NULL if there weren't any or there was an error.
+ */
+struct socketfs_packet* read_packets(int fd, size_t* length);
+
+/**
+ * Writes packets laid out one after another like read_packets gives them, in one write. Each packet is sent as if it
+ * was written on its own, so one that can't be sent doesn't stop the rest.
+ * @return 0 if every packet was sent, or -1 with errno set to the first error.
+ */
+int write_packets(int fd, struct socketfs_packet* packets, size_t length);
+
 int write_packet_of_type(int fd, int type, sockid_t id, int shm_id, int shm_perms, size_t length, void* data);
 
 inline int write_packet(int fd, sockid_t id, size_t length, void* data) {
@@ -48,6 +48,11 @@ int stat(const char* path, struct stat* statbuf) {
 	return syscall3(SYS_STAT, (int) path, (int) statbuf);
 }
 
+int fstatat(int dirfd, const char* path, struct stat* statbuf, int flags) {
+	struct fstatat_args args = { dirfd, path, statbuf, flags };
+	return syscall2(SYS_FSTATAT, (int) &args);
+}
+
 unsigned int major(dev_t dev) {
 	return (dev & 0xfff00u) >> 8u;
 }
@@ -58,6 +58,7 @@ int mkdir(const char* pathname, mode_t mode);
 int fstat(int fd, struct stat* statbuf);
 int lstat(const char* path, struct stat* statbuf);
 int stat(const char* path, struct stat* statbuf);
+int fstatat(int dirfd, const char* path, struct stat* statbuf, int flags);
 
 unsigned int major(dev_t dev);
 unsigned int minor(dev_t dev);
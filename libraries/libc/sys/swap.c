@@ -0,0 +1,9 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "swap.h"
+#include "syscall.h"
+
+int swapon(const char* path) {
+	return syscall2(SYS_SWAPON, (int) path);
+}
\ No newline at end of file
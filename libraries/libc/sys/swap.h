@@ -0,0 +1,18 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <sys/cdefs.h>
+
+__DECL_BEGIN
+
+/**
+ * Starts swapping memory out to a file when memory is low. The file must already be as big as the swap space should
+ * be, and must not be used for anything else while swapping to it. Only the superuser may call this.
+ * @param path The path of the file to swap to.
+ * @return 0 if successful, -1 if not.
+ */
+int swapon(const char* path);
+
+__DECL_END
@@ -19,10 +19,46 @@
 
 #include <errno.h>
 
-int syscall(int call) {
-	int ret = 0;
-	asm volatile("int $0x80" :: "a"(call));
-	asm volatile("mov %%eax, %0" : "=r"(ret));
+static int sysenter_supported = -1;
+
+static int check_sysenter() {
+	unsigned int eax, ebx, ecx, edx;
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+	unsigned int family = (eax >> 8) & 0xF, model = (eax >> 4) & 0xF, stepping = eax & 0xF;
+	//Early Pentium Pros claim to support sysenter, but don't (the kernel checks the same thing before enabling it)
+	return (edx & (1 << 11)) && !(family == 6 && model < 3 && stepping < 3);
+}
+
+/*
+ * Uses sysenter if the CPU supports it, since it's a lot cheaper than an interrupt, and int 0x80 otherwise. The kernel
+ * returns with sysexit, which needs our stack pointer in ebp and the address to return to in esi, and clobbers ecx and
+ * edx.
+ */
+static inline int do_syscall(int call, int b, int c, int d) {
+	int ret;
+	if(sysenter_supported < 0)
+		sysenter_supported = check_sysenter();
+	if(sysenter_supported) {
+		asm volatile(
+				"push %%ebp\n"
+				"push %%esi\n"
+				"mov %%esp, %%ebp\n"
+				"call 1f\n"
+				"1: pop %%esi\n"
+				"add $2f - 1b, %%esi\n"
+				"sysenter\n"
+				"2: pop %%esi\n"
+				"pop %%ebp\n"
+				: "=a"(ret), "+c"(c), "+d"(d)
+				: "a"(call), "b"(b)
+				: "memory", "cc");
+	} else {
+		asm volatile("int $0x80" : "=a"(ret) : "a"(call), "b"(b), "c"(c), "d"(d) : "memory");
+	}
+	return ret;
+}
+
+static inline int set_errno(int ret) {
 	if(ret < 0) {
 		errno = -ret;
 		return -1;
@@ -30,63 +66,34 @@ int syscall(int call) {
 	return ret;
 }
 
+int syscall(int call) {
+	return set_errno(do_syscall(call, 0, 0, 0));
+}
+
 int syscall_noerr(int call) {
-	int ret = 0;
-	asm volatile("int $0x80" :: "a"(call));
-	asm volatile("mov %%eax, %0" : "=r"(ret));
-	return ret;
+	return do_syscall(call, 0, 0, 0);
 }
 
 int syscall2(int call, int b) {
-	int ret = 0;
-	asm volatile("int $0x80" :: "a"(call), "b"(b));
-	asm volatile("mov %%eax, %0" : "=r"(ret));
-	if(ret < 0) {
-		errno = -ret;
-		return -1;
-	}
-	return ret;
+	return set_errno(do_syscall(call, b, 0, 0));
 }
 
 int syscall2_noerr(int call, int b) {
-	int ret = 0;
-	asm volatile("int $0x80" :: "a"(call), "b"(b));
-	asm volatile("mov %%eax, %0" : "=r"(ret));
-	return ret;
+	return do_syscall(call, b, 0, 0);
 }
 
 int syscall3(int call, int b, int c) {
-	int ret = 0;
-	asm volatile("int $0x80" :: "a"(call), "b"(b), "c"(c));
-	asm volatile("mov %%eax, %0" : "=r"(ret));
-	if(ret < 0) {
-		errno = -ret;
-		return -1;
-	}
-	return ret;
+	return set_errno(do_syscall(call, b, c, 0));
 }
 
 int syscall3_noerr(int call, int b, int c) {
-	int ret = 0;
-	asm volatile("int $0x80" :: "a"(call), "b"(b), "c"(c));
-	asm volatile("mov %%eax, %0" : "=r"(ret));
-	return ret;
+	return do_syscall(call, b, c, 0);
 }
 
 int syscall4(int call, int b, int c, int d) {
-	int ret = 0;
-	asm volatile("int $0x80" :: "a"(call), "b"(b), "c"(c), "d"(d));
-	asm volatile("mov %%eax, %0" : "=r"(ret));
-	if(ret < 0) {
-		errno = -ret;
-		return -1;
-	}
-	return ret;
+	return set_errno(do_syscall(call, b, c, d));
 }
 
 int syscall4_noerr(int call, int b, int c, int d) {
-	int ret = 0;
-	asm volatile("int $0x80" :: "a"(call), "b"(b), "c"(c), "d"(d));
-	asm volatile("mov %%eax, %0" : "=r"(ret));
-	return ret;
-}
\ No newline at end of file
+	return do_syscall(call, b, c, d);
+}
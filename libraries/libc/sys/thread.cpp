@@ -21,6 +21,10 @@
 #include <atomic>
 #include "thread.h"
 #include "syscall.h"
+#include "internals.h"
+#include <errno.h>
+
+int __libc_threaded = 0;
 
 void thread_entry(void* (*entry_func)(void*), void* arg) {
 	void* ret = entry_func(arg);
@@ -28,11 +32,23 @@ void thread_entry(void* (*entry_func)(void*), void* arg) {
 }
 
 tid_t thread_create(void* (*entry_func)(void*), void* arg) {
-	return syscall4(SYS_THREADCREATE, (int)thread_entry, (int)entry_func, (int)arg);
+	__libc_threaded = 1;
+	void* thread_pointer = __tls_allocate();
+	if(!thread_pointer && __tls_self()) {
+		errno = ENOMEM;
+		return -1;
+	}
+	struct threadcreate_args args = {(void* (*)(void* (*)(void*), void*)) thread_entry, entry_func, arg, thread_pointer};
+	int ret = syscall2(SYS_THREADCREATE, (int) &args);
+	if(ret < 0)
+		__tls_free(thread_pointer);
+	return ret;
 }
 
 void thread_exit(void* retval) {
-	syscall2(SYS_THREADEXIT, (int) retval);
+	//Nothing can touch thread-local storage (including errno) once it's freed, so this can't use syscall2()
+	__tls_free(__tls_self());
+	syscall2_noerr(SYS_THREADEXIT, (int) retval);
 }
 
 int thread_join(tid_t thread, void** retval) {
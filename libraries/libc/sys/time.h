@@ -26,6 +26,24 @@ __DECL_BEGIN
 
 int gettimeofday(struct timeval *tv, void *tz);
 
+#define timeradd(a, b, res) do { \
+		(res)->tv_sec = (a)->tv_sec + (b)->tv_sec; \
+		(res)->tv_usec = (a)->tv_usec + (b)->tv_usec; \
+		if((res)->tv_usec >= 1000000) { \
+			(res)->tv_sec++; \
+			(res)->tv_usec -= 1000000; \
+		} \
+	} while(0)
+
+#define timersub(a, b, res) do { \
+		(res)->tv_sec = (a)->tv_sec - (b)->tv_sec; \
+		(res)->tv_usec = (a)->tv_usec - (b)->tv_usec; \
+		if((res)->tv_usec < 0) { \
+			(res)->tv_sec--; \
+			(res)->tv_usec += 1000000; \
+		} \
+	} while(0)
+
 __DECL_END
 
 #endif //DUCKOS_LIBC_SYSTIME_H
@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "internals.h"
+#include "syscall.h"
+#include <string.h>
+#include <stdint.h>
+#include <kernel/api/mmap.h>
+#include <kernel/api/page_size.h>
+
+/*
+ * Thread-local storage uses the i386 "variant II" layout: every thread's TLS block sits right below its thread pointer,
+ * which is the base of its gs segment and points to a TCB that starts with a pointer to itself. The dynamic loader gives
+ * each object a fixed offset below the thread pointer, and hands us an image of the whole block to copy for each thread.
+ */
+
+struct tls_tcb {
+	struct tls_tcb* self; ///< %gs:0, so code can find the thread pointer with a single load.
+	void* mapping;
+	size_t mapping_size;
+};
+
+/** What general-dynamic TLS accesses pass to __tls_get_addr. See ld.cpp for what the dynamic loader puts in it. **/
+typedef struct {
+	unsigned long module;
+	unsigned long offset;
+} tls_index;
+
+static const void* tls_image = NULL;
+static size_t tls_size = 0;
+static size_t tls_align = 1;
+static int tls_initialized = 0;
+
+/*
+ * These use the syscalls directly instead of mmap() and munmap(), since errno is itself thread-local and setting it
+ * while there's no (or no longer a) TLS block would fault.
+ */
+static void* tls_map(size_t size) {
+	struct mmap_args args = {NULL, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, 0, 0};
+	int ret = syscall2_noerr(SYS_MMAP, (int) &args);
+	return ret < 0 ? NULL : (void*) ret;
+}
+
+static struct tls_tcb* tls_current() {
+	struct tls_tcb* tcb;
+	asm volatile("movl %%gs:0, %0" : "=r"(tcb));
+	return tcb;
+}
+
+void* __tls_allocate() {
+	if(!tls_initialized)
+		return NULL;
+
+	//Extra room is mapped so the thread pointer can be aligned even if the block needs more than page alignment
+	size_t block_size = (tls_size + tls_align - 1) & ~(tls_align - 1);
+	size_t mapping_size = (tls_align + block_size + sizeof(struct tls_tcb) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+	char* mapping = tls_map(mapping_size);
+	if(!mapping)
+		return NULL;
+
+	uintptr_t thread_pointer = ((uintptr_t) mapping + block_size + tls_align - 1) & ~(tls_align - 1);
+	memcpy((void*) (thread_pointer - block_size), tls_image, tls_size);
+	struct tls_tcb* tcb = (struct tls_tcb*) thread_pointer;
+	tcb->self = tcb;
+	tcb->mapping = mapping;
+	tcb->mapping_size = mapping_size;
+	return tcb;
+}
+
+void __tls_free(void* thread_pointer) {
+	struct tls_tcb* tcb = thread_pointer;
+	if(tcb)
+		syscall3_noerr(SYS_MUNMAP, (int) tcb->mapping, (int) tcb->mapping_size);
+}
+
+void* __tls_self() {
+	return tls_initialized ? tls_current() : NULL;
+}
+
+void __init_tls(const void* image, size_t size, size_t align) {
+	tls_image = image;
+	tls_size = size;
+	tls_align = align < sizeof(void*) ? sizeof(void*) : align;
+	tls_initialized = 1;
+
+	void* thread_pointer = __tls_allocate();
+	if(!thread_pointer) {
+		static const char message[] = "libc: Couldn't allocate thread-local storage\n";
+		syscall4_noerr(SYS_WRITE, 2, (int) message, sizeof(message) - 1);
+		syscall2_noerr(SYS_EXIT, 127);
+	}
+	syscall2_noerr(SYS_SET_THREAD_POINTER, (int) thread_pointer);
+}
+
+/*
+ * The dynamic loader only ever lays out TLS statically, so instead of a module ID it stores each object's offset below
+ * the thread pointer in the module field, and the address can be worked out without any per-thread tables.
+ */
+__attribute__((regparm(1))) void* ___tls_get_addr(tls_index* index) {
+	return (char*) tls_current() - index->module + index->offset;
+}
+
+void* __tls_get_addr(tls_index* index) {
+	return (char*) tls_current() - index->module + index->offset;
+}
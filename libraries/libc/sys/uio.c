@@ -0,0 +1,23 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "uio.h"
+#include "syscall.h"
+
+ssize_t readv(int fd, const struct iovec* iov, int iovcnt) {
+	return syscall4(SYS_READV, fd, (int) iov, iovcnt);
+}
+
+ssize_t writev(int fd, const struct iovec* iov, int iovcnt) {
+	return syscall4(SYS_WRITEV, fd, (int) iov, iovcnt);
+}
+
+ssize_t preadv(int fd, const struct iovec* iov, int iovcnt, off_t offset) {
+	struct iov_args args = {fd, iov, iovcnt, offset};
+	return syscall2(SYS_PREADV, (int) &args);
+}
+
+ssize_t pwritev(int fd, const struct iovec* iov, int iovcnt, off_t offset) {
+	struct iov_args args = {fd, iov, iovcnt, offset};
+	return syscall2(SYS_PWRITEV, (int) &args);
+}
@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "cdefs.h"
+#include "types.h"
+#include <kernel/api/uio.h>
+
+__DECL_BEGIN
+
+/**
+ * Reads from a file descriptor into several buffers in turn, as if it were one read.
+ * @return The number of bytes read, or -1 on error.
+ */
+ssize_t readv(int fd, const struct iovec* iov, int iovcnt);
+
+/**
+ * Writes several buffers to a file descriptor in turn, as if it were one write.
+ * @return The number of bytes written, or -1 on error.
+ */
+ssize_t writev(int fd, const struct iovec* iov, int iovcnt);
+
+/** Like readv(), but reads at the given offset without using or changing the file descriptor's offset. **/
+ssize_t preadv(int fd, const struct iovec* iov, int iovcnt, off_t offset);
+
+/** Like writev(), but writes at the given offset without using or changing the file descriptor's offset. **/
+ssize_t pwritev(int fd, const struct iovec* iov, int iovcnt, off_t offset);
+
+__DECL_END
@@ -0,0 +1,146 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "threads.h"
+#include <sys/futex.h>
+#include <sys/thread.h>
+#include <errno.h>
+#include <limits.h>
+
+/** Works out how long is left until an absolute TIME_UTC time. Returns 0 if it's already passed. **/
+static int time_until(const struct timespec* time_point, struct timespec* timeout) {
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	timeout->tv_sec = time_point->tv_sec - now.tv_sec;
+	timeout->tv_nsec = time_point->tv_nsec - now.tv_nsec;
+	if(timeout->tv_nsec < 0) {
+		timeout->tv_sec--;
+		timeout->tv_nsec += 1000000000;
+	}
+	return timeout->tv_sec >= 0 && (timeout->tv_sec || timeout->tv_nsec);
+}
+
+static int lock(mtx_t* mutex, const struct timespec* time_point) {
+	tid_t tid = 0;
+	if(mutex->__type & mtx_recursive) {
+		tid = gettid();
+		if(mutex->__owner == tid) {
+			mutex->__count++;
+			return thrd_success;
+		}
+	}
+
+	int state = 0;
+	if(!__atomic_compare_exchange_n(&mutex->__state, &state, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+		// Mark the mutex as contended so that whoever unlocks it knows to wake us up, and sleep until it's free
+		if(state != 2)
+			state = __atomic_exchange_n(&mutex->__state, 2, __ATOMIC_ACQUIRE);
+		while(state) {
+			struct timespec timeout;
+			if(time_point && !time_until(time_point, &timeout))
+				return thrd_timedout;
+			futex(&mutex->__state, FUTEX_WAIT, 2, time_point ? &timeout : NULL);
+			state = __atomic_exchange_n(&mutex->__state, 2, __ATOMIC_ACQUIRE);
+		}
+	}
+
+	if(mutex->__type & mtx_recursive) {
+		mutex->__owner = tid;
+		mutex->__count = 1;
+	}
+	return thrd_success;
+}
+
+int mtx_init(mtx_t* mutex, int type) {
+	mutex->__state = 0;
+	mutex->__type = type;
+	mutex->__owner = 0;
+	mutex->__count = 0;
+	return thrd_success;
+}
+
+int mtx_lock(mtx_t* mutex) {
+	return lock(mutex, NULL);
+}
+
+int mtx_timedlock(mtx_t* mutex, const struct timespec* time_point) {
+	return lock(mutex, time_point);
+}
+
+int mtx_trylock(mtx_t* mutex) {
+	tid_t tid = 0;
+	if(mutex->__type & mtx_recursive) {
+		tid = gettid();
+		if(mutex->__owner == tid) {
+			mutex->__count++;
+			return thrd_success;
+		}
+	}
+
+	int state = 0;
+	if(!__atomic_compare_exchange_n(&mutex->__state, &state, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return thrd_busy;
+
+	if(mutex->__type & mtx_recursive) {
+		mutex->__owner = tid;
+		mutex->__count = 1;
+	}
+	return thrd_success;
+}
+
+int mtx_unlock(mtx_t* mutex) {
+	if(mutex->__type & mtx_recursive) {
+		if(--mutex->__count)
+			return thrd_success;
+		mutex->__owner = 0;
+	}
+
+	// Only make a syscall if someone might be waiting
+	if(__atomic_exchange_n(&mutex->__state, 0, __ATOMIC_RELEASE) == 2)
+		futex(&mutex->__state, FUTEX_WAKE, 1, NULL);
+	return thrd_success;
+}
+
+void mtx_destroy(mtx_t* mutex) {}
+
+int cnd_init(cnd_t* cond) {
+	cond->__seq = 0;
+	return thrd_success;
+}
+
+int cnd_signal(cnd_t* cond) {
+	__atomic_fetch_add(&cond->__seq, 1, __ATOMIC_RELEASE);
+	futex(&cond->__seq, FUTEX_WAKE, 1, NULL);
+	return thrd_success;
+}
+
+int cnd_broadcast(cnd_t* cond) {
+	__atomic_fetch_add(&cond->__seq, 1, __ATOMIC_RELEASE);
+	futex(&cond->__seq, FUTEX_WAKE, INT_MAX, NULL);
+	return thrd_success;
+}
+
+int cnd_wait(cnd_t* cond, mtx_t* mutex) {
+	return cnd_timedwait(cond, mutex, NULL);
+}
+
+int cnd_timedwait(cnd_t* cond, mtx_t* mutex, const struct timespec* time_point) {
+	// If the condition is signalled after we unlock the mutex but before we sleep, the sequence will have changed and
+	// the kernel won't put us to sleep
+	int seq = __atomic_load_n(&cond->__seq, __ATOMIC_ACQUIRE);
+	struct timespec timeout;
+	int timed_out = time_point && !time_until(time_point, &timeout);
+
+	// A recursive mutex has to be all the way unlocked while we wait
+	int count = mutex->__count;
+	mutex->__count = 1;
+	mtx_unlock(mutex);
+	if(!timed_out)
+		timed_out = futex(&cond->__seq, FUTEX_WAIT, seq, time_point ? &timeout : NULL) == -1 && errno == ETIMEDOUT;
+	lock(mutex, NULL);
+	mutex->__count = count;
+
+	return timed_out ? thrd_timedout : thrd_success;
+}
+
+void cnd_destroy(cnd_t* cond) {}
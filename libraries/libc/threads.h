@@ -20,7 +20,59 @@
 #ifndef DUCKOS_LIBC_THREADS_H
 #define DUCKOS_LIBC_THREADS_H
 
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <time.h>
+
 #define thread_local _Thread_local
-//TODO
+
+__DECL_BEGIN
+
+enum {
+	thrd_success = 0,
+	thrd_busy,
+	thrd_error,
+	thrd_nomem,
+	thrd_timedout
+};
+
+enum {
+	mtx_plain = 0,
+	mtx_recursive = 1,
+	mtx_timed = 2
+};
+
+/**
+ * A mutex. Locking one that's free doesn't make a syscall, and threads waiting for one sleep in the kernel instead of
+ * spinning, so a thread holding one can be preempted without the others burning their time slices.
+ */
+typedef struct {
+	int __state; ///< 0 if unlocked, 1 if locked, 2 if locked and there may be threads waiting.
+	int __type;
+	tid_t __owner; ///< The thread holding a recursive mutex.
+	int __count; ///< How many times a recursive mutex has been locked by its owner.
+} mtx_t;
+
+typedef struct {
+	int __seq; ///< Changed every time the condition is signalled, so waiters can tell they missed a signal.
+} cnd_t;
+
+int mtx_init(mtx_t* mutex, int type);
+int mtx_lock(mtx_t* mutex);
+int mtx_timedlock(mtx_t* mutex, const struct timespec* time_point);
+int mtx_trylock(mtx_t* mutex);
+int mtx_unlock(mtx_t* mutex);
+void mtx_destroy(mtx_t* mutex);
+
+int cnd_init(cnd_t* cond);
+int cnd_signal(cnd_t* cond);
+int cnd_broadcast(cnd_t* cond);
+int cnd_wait(cnd_t* cond, mtx_t* mutex);
+int cnd_timedwait(cnd_t* cond, mtx_t* mutex, const struct timespec* time_point);
+void cnd_destroy(cnd_t* cond);
+
+//TODO: thrd_* and tss_*
+
+__DECL_END
 
 #endif //DUCKOS_LIBC_THREADS_H
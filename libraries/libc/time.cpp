@@ -20,6 +20,7 @@
 #include <time.h>
 #include <sys/time.h>
 #include <sys/syscall.h>
+#include <kernel/api/timepage.h>
 
 constexpr time_t SECOND = 1;
 constexpr time_t MINUTE = SECOND * 60;
@@ -150,8 +151,38 @@ size_t strftime(char* s, size_t maxsize, const char* format, const struct tm* ti
 	return -1;
 }
 
+// Reads the time base from the page the kernel maps into every process. Returns false if we have to ask the kernel.
+static bool read_time_page(uint64_t& uptime_ns, time_t& boot_epoch) {
+	auto* page = (const struct time_page*) TIME_PAGE_ADDR;
+	uint32_t seq;
+	uint64_t tsc_hz, tsc_base;
+	do {
+		seq = page->seq;
+		asm volatile("" ::: "memory");
+		tsc_hz = page->tsc_hz;
+		tsc_base = page->tsc_base;
+		boot_epoch = page->boot_epoch;
+		asm volatile("" ::: "memory");
+	} while((seq & 1) || seq != page->seq);
+
+	if(!tsc_hz)
+		return false;
+	uint32_t low, high;
+	asm volatile("rdtsc" : "=a"(low), "=d"(high));
+	// Split off whole seconds first so that multiplying the remainder can't overflow
+	uint64_t ticks = (((uint64_t) high << 32) | low) - tsc_base;
+	uptime_ns = (ticks / tsc_hz) * 1000000000 + ((ticks % tsc_hz) * 1000000000) / tsc_hz;
+	return true;
+}
+
 int gettimeofday(struct timeval *tv, void *tz) {
-	return syscall3(SYS_GETTIMEOFDAY, (int) tv, (int) tz);
+	uint64_t uptime_ns;
+	time_t boot_epoch;
+	if(!tv || !read_time_page(uptime_ns, boot_epoch))
+		return syscall3(SYS_GETTIMEOFDAY, (int) tv, (int) tz);
+	tv->tv_sec = boot_epoch + (time_t) (uptime_ns / 1000000000);
+	tv->tv_usec = (suseconds_t) ((uptime_ns % 1000000000) / 1000);
+	return 0;
 }
 
 int nanosleep(const struct timespec *req, struct timespec *rem) {
@@ -163,7 +194,19 @@ int clock_getres(clockid_t clk_id, struct timespec *res) {
 }
 
 int clock_gettime(clockid_t clk_id, struct timespec *tp) {
-	return -1;
+	uint64_t uptime_ns;
+	time_t boot_epoch;
+	bool realtime = clk_id == CLOCK_REALTIME || clk_id == CLOCK_REALTIME_COARSE;
+	bool monotonic = clk_id == CLOCK_MONOTONIC || clk_id == CLOCK_MONOTONIC_RAW || clk_id == CLOCK_MONOTONIC_COARSE;
+	if(!(realtime || monotonic) || !tp || !read_time_page(uptime_ns, boot_epoch))
+		return syscall3(SYS_CLOCK_GETTIME, clk_id, (int) tp);
+
+	tp->tv_sec = (time_t) (uptime_ns / 1000000000);
+	if(realtime)
+		tp->tv_sec += boot_epoch;
+	tp->tv_nsec = (long) (uptime_ns % 1000000000);
+	tp->tv_usec = tp->tv_nsec / 1000;
+	return 0;
 }
 
 int clock_settime(clockid_t clk_id, const struct timespec *tp) {
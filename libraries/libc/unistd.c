@@ -25,6 +25,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
 
 char** environ = NULL;
 char** __original_environ = NULL;
@@ -155,7 +157,8 @@ ssize_t read(int fd, void* buf, size_t count) {
 }
 
 ssize_t pread(int fd, void* buf, size_t count, off_t offset) {
-	return -1;
+	struct iovec iov = {buf, count};
+	return preadv(fd, &iov, 1, offset);
 }
 
 ssize_t write(int fd, const void* buf, size_t count) {
@@ -163,7 +166,8 @@ ssize_t write(int fd, const void* buf, size_t count) {
 }
 
 ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset) {
-	return -1;
+	struct iovec iov = {(void*) buf, count};
+	return pwritev(fd, &iov, 1, offset);
 }
 
 off_t lseek(int fd, off_t off, int whence) {
@@ -178,6 +182,14 @@ int ftruncate(int fd, off_t length) {
 	return syscall3(SYS_FTRUNCATE, fd, length);
 }
 
+int fsync(int fd) {
+	return syscall2(SYS_FSYNC, fd);
+}
+
+void sync() {
+	syscall(SYS_SYNC);
+}
+
 int close(int fd) {
 	return syscall2(SYS_CLOSE, fd);
 }
@@ -263,6 +275,19 @@ int sleep(unsigned secs) {
 	return 0;
 }
 
+int nice(int inc) {
+	errno = 0;
+	int cur = getpriority(PRIO_PROCESS, 0);
+	if(cur == -1 && errno)
+		return -1;
+	if(setpriority(PRIO_PROCESS, 0, cur + inc) == -1) {
+		if(errno == EACCES)
+			errno = EPERM;
+		return -1;
+	}
+	return getpriority(PRIO_PROCESS, 0);
+}
+
 int usleep(useconds_t usec) {
 	struct timespec time = {0, usec};
 	struct timespec remainder;
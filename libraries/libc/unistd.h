@@ -72,6 +72,8 @@ ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset);
 off_t lseek(int fd, off_t off, int whence);
 int fchown(int fd, uid_t uid, gid_t gid);
 int ftruncate(int fd, off_t length);
+int fsync(int fd);
+void sync();
 int close(int fd);
 int isatty(int fd);
 
@@ -97,6 +99,7 @@ char* getwd(char* buf);
 
 int sleep(unsigned secs);
 int usleep(useconds_t usec);
+int nice(int inc);
 
 pid_t tcgetpgrp(int fd);
 int tcsetpgrp(int fd, pid_t pgid);
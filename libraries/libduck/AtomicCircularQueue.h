@@ -4,6 +4,7 @@
 #pragma once
 
 #include <atomic>
+#include <algorithm>
 #include <cassert>
 #include "SharedBuffer.h"
 
@@ -46,6 +47,34 @@ namespace Duck {
 			return true;
 		}
 
+		/**
+		 * Pushes as many values from an array as there's space for.
+		 * @return The number of values pushed.
+		 */
+		size_t push(const T* values, size_t count) {
+			auto front = m_queue->front.load();
+			auto back = m_queue->back.load();
+			count = std::min(count, Size - 1 - (back - front));
+			auto start = back % Size;
+			auto first = std::min(count, Size - start);
+			std::copy(values, values + first, &m_queue->storage[start]);
+			std::copy(values + first, values + count, &m_queue->storage[0]);
+			m_queue->back.fetch_add(count);
+			return count;
+		}
+
+		/** Pushes every value from an array to the queue, waiting for space when there isn't enough. **/
+		void push_wait(const T* values, size_t count) {
+			while(true) {
+				auto pushed = push(values, count);
+				values += pushed;
+				count -= pushed;
+				if(!count)
+					return;
+				usleep(1);
+			}
+		}
+
 		/** Pushes a value to the queue, waiting until space is available. **/
 		void push_wait(const T& value) {
 			while(!push(value))
@@ -62,6 +91,27 @@ namespace Duck {
 			return ret;
 		}
 
+		/**
+		 * Pops as many values as are available (up to count) into an array.
+		 * @return The number of values popped.
+		 */
+		size_t pop(T* values, size_t count) {
+			auto front = m_queue->front.load();
+			auto back = m_queue->back.load();
+			count = std::min(count, back - front);
+			auto start = front % Size;
+			auto first = std::min(count, Size - start);
+			std::move(&m_queue->storage[start], &m_queue->storage[start + first], values);
+			std::move(&m_queue->storage[0], &m_queue->storage[count - first], values + first);
+			m_queue->front.fetch_add(count);
+			return count;
+		}
+
+		/** The number of values waiting to be popped. **/
+		size_t size() {
+			return m_queue->back.load() - m_queue->front.load();
+		}
+
 		/** Pops a value from the queue, waiting until one is available. **/
 		T pop_wait() {
 			while(true) {
@@ -20,6 +20,7 @@
 #include "Config.h"
 #include "StringUtils.h"
 #include "FileStream.h"
+#include "MappedFile.h"
 
 using namespace Duck;
 
@@ -40,6 +41,22 @@ std::map<std::string, std::string>& Config::defaults() {
 }
 
 ResultRet<Config> Config::read_from(const Path& filename) {
+	// If we can, map the file and parse it right out of memory
+	auto map_res = MappedFile::map(filename);
+	if(!map_res.is_error()) {
+		Config ret;
+		std::string header;
+		auto data = map_res.value()->view();
+		while(!data.empty()) {
+			auto end = data.find('\n');
+			parse_line(data.substr(0, end), header, ret);
+			data = end == std::string_view::npos ? std::string_view() : data.substr(end + 1);
+		}
+		return ret;
+	} else if(map_res.result().code() != ENODEV) {
+		return map_res.result();
+	}
+
 	auto file_res = File::open(filename, "r");
 	if(file_res.is_error())
 		return file_res.result();
@@ -59,34 +76,28 @@ ResultRet<Config> Config::read_from(InputStream& stream) {
 Result Config::read_from(InputStream& stream, Config& config) {
 	stream.set_delimeter('\n');
 	std::string curr_header = "";
-	std::string line;
-	while(true) {
-		if(stream.eof())
-			break;
-
-		stream >> line;
-
-		trim(line);
-		if(line[0] == '[' && line[line.length() - 1] == ']') {
-			curr_header = line.substr(1, line.length() - 2);
-			continue;
-		}
-
-		auto eq_index = line.find_first_of('=');
-		if(eq_index != std::string::npos) {
-			auto key = line.substr(0, eq_index);
-			rtrim(key);
-
-			auto val = line.substr(eq_index + 1);
-			ltrim(val);
+	while(auto line = stream.read_until('\n'))
+		parse_line(*line, curr_header, config);
+	return Result::SUCCESS;
+}
 
-			if(val[0] == '"' && val[val.length() - 1] == '"')
-				val = val.substr(1, val.length() - 2);
+void Config::parse_line(std::string_view line, std::string& header, Config& config) {
+	line = trim(line);
+	if(line.empty())
+		return;
 
-			config._values[curr_header][key] = val;
-		}
+	if(line[0] == '[' && line[line.length() - 1] == ']') {
+		header = line.substr(1, line.length() - 2);
+		return;
 	}
 
-	return Result::SUCCESS;
+	auto eq_index = line.find_first_of('=');
+	if(eq_index != std::string_view::npos) {
+		auto key = rtrim(line.substr(0, eq_index));
+		auto val = ltrim(line.substr(eq_index + 1));
+		if(val.length() >= 2 && val[0] == '"' && val[val.length() - 1] == '"')
+			val = val.substr(1, val.length() - 2);
+		config._values[header][std::string(key)] = val;
+	}
 }
 
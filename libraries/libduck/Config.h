@@ -39,6 +39,7 @@ namespace Duck {
 		Config() = default;
 
 		static Result read_from(InputStream& stream, Config& config);
+		static void parse_line(std::string_view line, std::string& header, Config& config);
 
 		std::map<std::string, std::map<std::string, std::string>> _values;
 	};
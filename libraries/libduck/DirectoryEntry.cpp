@@ -25,11 +25,15 @@
 
 using namespace Duck;
 
-DirectoryEntry::DirectoryEntry(const Path& parent_path, const struct dirent* entry) :
+DirectoryEntry::DirectoryEntry(const Path& parent_path, const struct dirent* entry, int dir_fd) :
 		m_path(parent_path / entry->d_name), m_inode(entry->d_ino), m_type((Type) entry->d_type),
 		m_name(entry->d_name) {
 	struct stat st;
-	stat(m_path.string().c_str(), &st);
+	if(dir_fd == AT_FDCWD)
+		stat(m_path.string().c_str(), &st);
+	else
+		fstatat(dir_fd, entry->d_name, &st, 0);
 	m_size = st.st_size;
 	m_mode = st.st_mode;
+	m_mtime = st.st_mtime;
 }
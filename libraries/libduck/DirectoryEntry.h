@@ -21,6 +21,7 @@
 
 #include "Path.h"
 #include <dirent.h>
+#include <fcntl.h>
 #include <string_view>
 #include <vector>
 #include "DataSize.h"
@@ -39,13 +40,18 @@ namespace Duck {
 			SYMLINK = DT_LNK
 		};
 
-		DirectoryEntry(const Path& parent_path, const dirent* entry);
+		/**
+		 * Makes an entry for a file in a directory, along with its size and mode.
+		 * @param dir_fd An fd of the open directory, so the file can be looked up in it rather than by its full path.
+		 */
+		DirectoryEntry(const Path& parent_path, const dirent* entry, int dir_fd = AT_FDCWD);
 
 		[[nodiscard]] std::string_view name() const { return m_name; }
 		[[nodiscard]] Type type() const { return m_type; }
 		[[nodiscard]] ino_t inode() const { return m_inode; }
 		[[nodiscard]] DataSize size() const { return m_size; }
 		[[nodiscard]] mode_t mode() const { return m_mode; }
+		[[nodiscard]] time_t mtime() const { return m_mtime; }
 		[[nodiscard]] const Path& path() const { return m_path; }
 
 		[[nodiscard]] bool is_regular() const { return m_type == REGULAR; }
@@ -62,6 +68,7 @@ namespace Duck {
 		std::string m_name;
 		DataSize m_size;
 		mode_t m_mode;
+		time_t m_mtime;
 		Path m_path;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "EventLoop.h"
+#include <poll.h>
+
+using namespace Duck;
+
+namespace {
+	thread_local EventLoop* s_current = nullptr;
+}
+
+EventLoop& EventLoop::current() {
+	if(!s_current)
+		s_current = new EventLoop();
+	return *s_current;
+}
+
+void EventLoop::set_current(EventLoop* loop) {
+	s_current = loop;
+}
+
+void EventLoop::watch(int fd, bool write, std::function<void()> callback) {
+	m_watches.push_back({fd, write, std::move(callback)});
+}
+
+void EventLoop::call_later(long millis, std::function<void()> callback) {
+	m_timers.emplace(Time::monotonic() + Time::millis(millis), std::move(callback));
+}
+
+void EventLoop::post(std::function<void()> callback) {
+	m_posted.push_back(std::move(callback));
+}
+
+void EventLoop::run_while(const std::function<bool()>& predicate) {
+	while(predicate() && has_work())
+		iterate();
+}
+
+void EventLoop::run() {
+	run_while([] { return true; });
+}
+
+bool EventLoop::has_work() const {
+	return !m_posted.empty() || !m_timers.empty() || !m_watches.empty();
+}
+
+void EventLoop::iterate() {
+	//Callbacks can post more, so only call the ones that were posted before we started
+	auto posted = std::move(m_posted);
+	m_posted.clear();
+	for(auto& callback : posted)
+		callback();
+
+	//Figure out how long we can sleep for
+	int timeout = -1;
+	auto now = Time::monotonic();
+	if(!m_posted.empty())
+		timeout = 0;
+	else if(!m_timers.empty())
+		timeout = m_timers.begin()->first <= now ? 0 : (int) (m_timers.begin()->first - now).millis() + 1;
+
+	if(!m_watches.empty()) {
+		std::vector<pollfd> pollfds;
+		pollfds.reserve(m_watches.size());
+		for(auto& watch : m_watches)
+			pollfds.push_back({watch.fd, (short) (watch.write ? POLLOUT : POLLIN), 0});
+		if(poll(pollfds.data(), pollfds.size(), timeout) > 0) {
+			//Take out the watches that are ready before calling them, since the callbacks may add more
+			std::vector<std::function<void()>> ready;
+			size_t watch_index = 0;
+			for(auto& pfd : pollfds) {
+				if(pfd.revents) {
+					ready.push_back(std::move(m_watches[watch_index].callback));
+					m_watches.erase(m_watches.begin() + watch_index);
+				} else {
+					watch_index++;
+				}
+			}
+			for(auto& callback : ready)
+				callback();
+		}
+	} else if(timeout > 0) {
+		poll(nullptr, 0, timeout);
+	}
+
+	//Fire the timers that are due
+	now = Time::monotonic();
+	while(!m_timers.empty() && m_timers.begin()->first <= now) {
+		auto callback = std::move(m_timers.begin()->second);
+		m_timers.erase(m_timers.begin());
+		callback();
+	}
+}
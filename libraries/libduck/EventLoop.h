@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "Time.h"
+#include <deque>
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace Duck {
+	/**
+	 * Calls functions when file descriptors become ready or timers go off. This is what drives Duck::Task; when a task
+	 * waits on something, it asks the current event loop to resume it once it's ready.
+	 *
+	 * The loop used by default is a standalone one built on poll(). Programs with their own loop (like libui's) can
+	 * make it the current one by subclassing this and overriding the virtual functions.
+	 */
+	class EventLoop {
+	public:
+		EventLoop() = default;
+		EventLoop(const EventLoop& other) = delete;
+		virtual ~EventLoop() = default;
+
+		/// The event loop of the current thread. If none was set, this is a standalone one.
+		static EventLoop& current();
+		static void set_current(EventLoop* loop);
+
+		/// Calls a function once, the next time a file descriptor is ready to be read from (or written to).
+		virtual void watch(int fd, bool write, std::function<void()> callback);
+		/// Calls a function once after the given number of milliseconds.
+		virtual void call_later(long millis, std::function<void()> callback);
+		/// Calls a function from the loop as soon as possible.
+		virtual void post(std::function<void()> callback);
+		/// Runs the loop for as long as the predicate returns true, or until there's nothing left for it to wait on.
+		virtual void run_while(const std::function<bool()>& predicate);
+
+		/// Runs the loop until there's nothing left for it to wait on.
+		void run();
+
+	private:
+		struct Watch {
+			int fd;
+			bool write;
+			std::function<void()> callback;
+		};
+
+		[[nodiscard]] bool has_work() const;
+		void iterate();
+
+		std::vector<Watch> m_watches;
+		std::multimap<Time, std::function<void()>> m_timers;
+		std::deque<std::function<void()>> m_posted;
+	};
+}
@@ -18,10 +18,11 @@
 */
 
 #include "FileStream.h"
+#include <cstring>
 
 using namespace Duck;
 
-[[maybe_unused]] FileInputStream FileStream::std_in(File::std_in);
+[[maybe_unused]] FileInputStream FileStream::std_in(File::std_in, 0); // Shares stdin with stdio, so it can't have its own buffer
 [[maybe_unused]] FileOutputStream FileStream::std_out(File::std_out);
 [[maybe_unused]] FileOutputStream FileStream::std_err(File::std_err);
 
@@ -39,17 +40,133 @@ Result FileStream::open(const Path& path) {
 	return Result::SUCCESS;
 }
 
+void FileInputStream::set_buffer_size(size_t size) {
+	m_buffer_size = size;
+}
+
 size_t FileInputStream::read(void* buffer, size_t n) {
 	if(!m_file.c_file())
 		return 0;
 
-	auto res = m_file.read(buffer, n);
-	if(res.is_error()) {
-		m_err = res.result();
+	if(!m_buffer_size && m_buffer_start == m_buffer_end) {
+		auto res = m_file.read(buffer, n);
+		if(res.is_error()) {
+			m_err = res.result();
+			return 0;
+		} else {
+			return res.value();
+		}
+	}
+
+	auto* out = (char*) buffer;
+	size_t nread = 0;
+	while(nread < n) {
+		// Use up whatever's buffered first
+		size_t buffered = m_buffer_end - m_buffer_start;
+		if(buffered) {
+			size_t amount = std::min(buffered, n - nread);
+			memcpy(out + nread, m_buffer.data() + m_buffer_start, amount);
+			m_buffer_start += amount;
+			nread += amount;
+			continue;
+		}
+
+		// Big reads go straight to the file instead of through the buffer
+		if(n - nread >= m_buffer_size) {
+			ssize_t res = ::read(m_file.fd(), out + nread, n - nread);
+			if(res < 0)
+				m_err = Result(errno);
+			if(res <= 0) {
+				m_eof = res == 0;
+				break;
+			}
+			nread += res;
+			continue;
+		}
+
+		if(!fill_buffer())
+			break;
+	}
+	return nread;
+}
+
+bool FileInputStream::eof() const {
+	if(m_buffer_start != m_buffer_end)
+		return false;
+	return m_eof || m_file.eof();
+}
+
+Result FileInputStream::seek(long seek, Whence whence) {
+	if(!m_buffer_size && m_buffer_start == m_buffer_end)
+		return m_file.seek(seek, whence);
+
+	// The file is ahead of us by however much is buffered, so throw that away and account for it
+	if(whence == CUR)
+		seek -= (long) (m_buffer_end - m_buffer_start);
+	m_buffer_start = m_buffer_end = 0;
+	m_eof = false;
+	if(lseek(m_file.fd(), seek, whence) < 0)
+		return Result(errno);
+	return Result::SUCCESS;
+}
+
+std::optional<std::string_view> FileInputStream::read_until(char delimiter) {
+	if(!m_file.c_file())
+		return std::nullopt;
+	if(!m_buffer_size && m_buffer_start == m_buffer_end)
+		return InputStream::read_until(delimiter);
+
+	size_t searched = m_buffer_start;
+	while(true) {
+		auto* start = m_buffer.data() + m_buffer_start;
+		auto* found = searched < m_buffer_end ? (char*) memchr(m_buffer.data() + searched, delimiter, m_buffer_end - searched) : nullptr;
+		if(found) {
+			std::string_view ret(start, found - start);
+			m_buffer_start = found - m_buffer.data() + 1;
+			return ret;
+		}
+
+		// If we hit the end of the file, whatever's left is the last line
+		searched = m_buffer_end;
+		size_t prev_start = m_buffer_start;
+		if(!fill_buffer()) {
+			if(m_buffer_start == m_buffer_end)
+				return std::nullopt;
+			std::string_view ret(m_buffer.data() + m_buffer_start, m_buffer_end - m_buffer_start);
+			m_buffer_start = m_buffer_end;
+			return ret;
+		}
+		searched -= prev_start - m_buffer_start;
+	}
+}
+
+size_t FileInputStream::fill_buffer() {
+	// Move what's left to the front. If there's no room after that, the buffer grows so a long line still fits.
+	size_t buffered = m_buffer_end - m_buffer_start;
+	if(buffered && m_buffer_start)
+		memmove(m_buffer.data(), m_buffer.data() + m_buffer_start, buffered);
+	m_buffer_start = 0;
+	m_buffer_end = buffered;
+	size_t wanted = std::max(m_buffer_size, (size_t) 1);
+	if(m_buffer.size() < wanted)
+		m_buffer.resize(wanted);
+	else if(m_buffer_end == m_buffer.size())
+		m_buffer.resize(m_buffer.size() * 2);
+
+	ssize_t res = ::read(m_file.fd(), m_buffer.data() + m_buffer_end, m_buffer.size() - m_buffer_end);
+	if(res < 0)
+		m_err = Result(errno);
+	if(res <= 0) {
+		m_eof = res == 0;
 		return 0;
-	} else {
-		return res.value();
 	}
+	m_buffer_end += res;
+	return res;
+}
+
+void FileOutputStream::set_buffer_size(size_t size) {
+	if(m_file.c_file())
+		setvbuf(m_file.c_file(), nullptr, size ? _IOFBF : _IONBF, size);
 }
 
 size_t FileOutputStream::write(const void* buffer, size_t n) {
@@ -21,6 +21,9 @@
 
 #include "Stream.h"
 #include "File.h"
+#include <vector>
+
+#define FILE_STREAM_DEFAULT_BUFFER_SIZE 4096
 
 namespace Duck {
 	class FileInputStream;
@@ -47,20 +50,44 @@ namespace Duck {
 		File m_file;
 	};
 
+	/**
+	 * Reads from a file through a buffer of its own, so lots of small reads (or read_until, which doesn't copy anything)
+	 * don't each turn into a call into libc. While it's buffered, the file is read and seeked with its file descriptor
+	 * and shouldn't be used anywhere else.
+	 */
 	class FileInputStream: public FileStream, public InputStream {
 	public:
 		FileInputStream(): FileStream() {};
-		explicit FileInputStream(const File& file): FileStream(file) {}
-		explicit FileInputStream(const Path& path): FileStream() {open(path);}
+		explicit FileInputStream(const File& file, size_t buffer_size = FILE_STREAM_DEFAULT_BUFFER_SIZE):
+			FileStream(file), m_buffer_size(buffer_size) {}
+		explicit FileInputStream(const Path& path, size_t buffer_size = FILE_STREAM_DEFAULT_BUFFER_SIZE):
+			FileStream(), m_buffer_size(buffer_size) {open(path);}
+
+		/**
+		 * Sets how much of the file is read at once. Anything already buffered is kept.
+		 * @param size The size of the buffer, or zero to read straight from the file.
+		 */
+		void set_buffer_size(size_t size);
+		[[nodiscard]] size_t buffer_size() const { return m_buffer_size; }
 
 		//InputStream
 		size_t read(void* buffer, size_t n) override;
-		[[nodiscard]] bool eof() const override { return m_file.eof(); }
-		Result seek(long seek, Whence whence) override { return m_file.seek(seek, whence); }
+		[[nodiscard]] bool eof() const override;
+		Result seek(long seek, Whence whence) override;
+		std::optional<std::string_view> read_until(char delimiter) override;
 
 	protected:
 		//FileStream
 		[[nodiscard]] const char* open_mode() const override { return "r"; }
+
+	private:
+		size_t fill_buffer();
+
+		std::vector<char> m_buffer;
+		size_t m_buffer_size = FILE_STREAM_DEFAULT_BUFFER_SIZE;
+		size_t m_buffer_start = 0; ///< Where the unread part of m_buffer starts
+		size_t m_buffer_end = 0; ///< Where the unread part of m_buffer ends
+		bool m_eof = false;
 	};
 
 	class FileOutputStream: public FileStream, public OutputStream {
@@ -72,6 +99,13 @@ namespace Duck {
 			setvbuf(m_file.c_file(), NULL, _IOLBF, BUFSIZ);
 		}
 
+		/**
+		 * Sets the size of the file's buffer. Writes are collected in it until it fills up or the stream is flushed.
+		 * @param size The size of the buffer, or zero to write straight to the file.
+		 */
+		void set_buffer_size(size_t size);
+		Result flush() { return m_file.flush(); }
+
 		//OutputStream
 		size_t write(const void* buffer, size_t n) override;
 		Result seek(long seek, Whence whence) override { return m_file.seek(seek, whence); }
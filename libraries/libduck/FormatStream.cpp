@@ -18,159 +18,164 @@
 */
 
 #include "FormatStream.h"
+#include <cstdio>
+#include <cstring>
 using namespace Duck;
 
-FormatParams::FormatParams(InputStream& stream) {
-	enum {
-		REGULAR,
-		PRECISION
-	} state = REGULAR;
-
-	std::string precision_string;
-
-	while(!stream.eof()) {
-		char ch = stream.getchar();
-		switch(state) {
-			case REGULAR: {
-				regstate:
-				switch(ch) {
-					case '{':
-						literal_brace = true;
-						return;
-					case 'c':
-						number_format = CHARACTER;
-						break;
-					case 'x':
-						number_format = HEX;
-						break;
-					case 'X':
-						number_format = HEX_UPPER;
-						break;
-					case 'd':
-						number_format = DECIMAL;
-						break;
-					case '#':
-						alternate_form = true;
-						break;
-					case '.':
-						state = PRECISION;
-						precision_string = "";
-						break;
-					case '}':
-						return;
-					default:
-						break;
-				}
-				break;
-			}
-
-			case PRECISION: {
-				if(ch >= '0' && ch <= '9') {
-					precision_string += ch;
-				} else {
-					precision = atoi(precision_string.c_str());
-					state = REGULAR;
-					goto regstate;
-				}
-			}
-		}
-
-	}
-}
-
-FormatStream::FormatStream(OutputStream& stream, std::string format):
-	m_stream(stream), m_format(std::move(format)), m_fmt_stream(m_format) {}
-
 FormatStream::~FormatStream() {
 	//Flush the rest of the format string
-	while(!m_fmt_stream.eof()) {
-		output_until_format();
-		if(read_format_params().literal_brace)
-			m_stream << "{";
-	}
-}
-
-void FormatStream::output_until_format() {
-	m_fmt_stream.set_delimeter('{');
-	std::string buf;
-	m_fmt_stream >> buf;
-	m_stream << buf;
+	FormatSegment segment;
+	while(next_arg(segment));
 }
 
-FormatParams FormatStream::read_format_params() {
-	return FormatParams(m_fmt_stream);
+bool FormatStream::next_arg(FormatSegment& segment) {
+	while(*m_format) {
+		const char* base = m_format;
+		m_format = FormatSegment::parse(base, base, segment);
+		if(segment.length)
+			m_stream.write(base, segment.length);
+		if(segment.has_arg)
+			return true;
+	}
+	return false;
 }
 
-void FormatStream::write_hex(FormatParams params, unsigned long long num) {
-	//Figure out the width of the resulting string
-	size_t num_chars = 0;
-	unsigned int numchar_calc = num;
-	do {
-		num_chars++;
-		numchar_calc /= 0x10;
-	} while(numchar_calc);
-
-	//If we have to print the prefix, do so
-	if(params.alternate_form)
-		m_stream << "0x";
+namespace Duck {
+	FormatStream operator%(OutputStream& stream, const char* fmt) {
+		return {stream, fmt};
+	}
 
-	//Output the hex
-	const char* hex = params.number_format == FormatParams::HEX_UPPER ? "0123456789ABCDEF" : "0123456789abcdef";
-	for(size_t i = 1; i <= num_chars; i++)
-		m_stream.putchar(hex[(num >> ((num_chars - i) * 4)) & 0xFu]);
-}
+	void format_arg(OutputStream& stream, const FormatParams& params, unsigned long long arg) {
+		char buf[24];
+		char* end = buf + sizeof(buf);
+		char* start;
+		switch(params.number_format) {
+			case FormatParams::CHARACTER:
+				stream.putchar((char) arg);
+				return;
+			case FormatParams::HEX:
+			case FormatParams::HEX_UPPER:
+				start = __fmt_hex(arg, end, params.number_format == FormatParams::HEX_UPPER);
+				if(params.alternate_form) {
+					*--start = 'x';
+					*--start = '0';
+				}
+				break;
+			default:
+				start = __fmt_dec(arg, end);
+				break;
+		}
+		stream.write(start, end - start);
+	}
 
-void FormatStream::write_arg(FormatParams params, long long arg) {
-	switch(params.number_format) {
-		case FormatParams::CHARACTER:
-			m_stream.putchar((char) arg);
-			break;
-		case FormatParams::HEX:
-		case FormatParams::HEX_UPPER:
-			write_hex(params, arg);
-			break;
-		case FormatParams::DECIMAL:
-			m_stream << arg;
-			break;
+	void format_signed(OutputStream& stream, const FormatParams& params, long long arg, unsigned long long bits) {
+		if(params.number_format != FormatParams::DECIMAL || arg >= 0)
+			return format_arg(stream, params, bits);
+		stream.putchar('-');
+		format_arg(stream, params, -(unsigned long long) arg);
 	}
-}
 
-void FormatStream::write_arg(FormatParams params, unsigned long long int arg) {
-	switch(params.number_format) {
-		case FormatParams::CHARACTER:
-			m_stream.putchar((char) arg);
-			break;
-		case FormatParams::HEX:
-		case FormatParams::HEX_UPPER:
-			write_hex(params, arg);
-			break;
-		case FormatParams::DECIMAL:
-			m_stream << arg;
-			break;
+	/**
+	 * Writes the shortest digits that read back as the number. Very big and very small numbers get an exponent, and
+	 * everything else always gets a decimal point so it still looks like a float.
+	 */
+	static void write_shortest(OutputStream& stream, const char* digits, int ndigits, int exponent) {
+		char buf[32];
+		char* out = buf;
+		int point = ndigits + exponent; //How many of the digits come before the decimal point
+		if(point > 17 || point < -3) {
+			*out++ = digits[0];
+			if(ndigits > 1) {
+				*out++ = '.';
+				memcpy(out, digits + 1, ndigits - 1);
+				out += ndigits - 1;
+			}
+			*out++ = 'e';
+			int exp10 = point - 1;
+			*out++ = exp10 < 0 ? '-' : '+';
+			char exp_buf[4];
+			char* exp_end = exp_buf + sizeof(exp_buf);
+			char* exp_start = __fmt_dec(exp10 < 0 ? -exp10 : exp10, exp_end);
+			memcpy(out, exp_start, exp_end - exp_start);
+			out += exp_end - exp_start;
+		} else if(point <= 0) {
+			*out++ = '0';
+			*out++ = '.';
+			memset(out, '0', -point);
+			out += -point;
+			memcpy(out, digits, ndigits);
+			out += ndigits;
+		} else if(point >= ndigits) {
+			memcpy(out, digits, ndigits);
+			out += ndigits;
+			memset(out, '0', point - ndigits);
+			out += point - ndigits;
+			*out++ = '.';
+			*out++ = '0';
+		} else {
+			memcpy(out, digits, point);
+			out += point;
+			*out++ = '.';
+			memcpy(out, digits + point, ndigits - point);
+			out += ndigits - point;
+		}
+		stream.write(buf, out - buf);
 	}
-}
 
-void FormatStream::write_arg(FormatParams params, long double arg) {
-	//Write the part before the decimal
-	m_stream << ((long) arg);
+	/** Writes the things that don't have digits, and returns whether the number was one of them. **/
+	static bool write_special(OutputStream& stream, double arg) {
+		if(arg != arg) {
+			stream << "nan";
+		} else if(arg == __builtin_inf() || arg == -__builtin_inf()) {
+			stream << (arg < 0 ? "-inf" : "inf");
+		} else if(arg == 0) {
+			stream << (__builtin_signbit(arg) ? "-0.0" : "0.0");
+		} else {
+			return false;
+		}
+		return true;
+	}
 
-	if(params.precision != 0)
-		m_stream.putchar('.');
-	else
-		return;
+	static void write_fixed(OutputStream& stream, int precision, double arg) {
+		char buf[64];
+		int len = snprintf(buf, sizeof(buf), "%.*f", precision, arg);
+		if(len < (int) sizeof(buf)) {
+			stream.write(buf, len);
+			return;
+		}
+		std::string str(len + 1, '\0');
+		snprintf(str.data(), len + 1, "%.*f", precision, arg);
+		stream.write(str.data(), len);
+	}
 
-	//Print decimal places
-	int num_places = (params.precision > -1 && params.precision < 8) ? params.precision : 8;
-	for (int d = 0; d < num_places; d++) {
-		if ((int) (arg * 100000.0) % 100000 == 0 && d != 0)
-			break;
-		arg *= 10.0;
-		m_stream.putchar("0123456789"[((int) arg) % 10]);
+	void format_arg(OutputStream& stream, const FormatParams& params, double arg) {
+		if(params.precision >= 0)
+			return write_fixed(stream, params.precision, arg);
+		if(write_special(stream, arg))
+			return;
+		if(arg < 0) {
+			stream.putchar('-');
+			arg = -arg;
+		}
+		char digits[17];
+		int exponent;
+		int ndigits = __fmt_shortest(arg, digits, &exponent);
+		write_shortest(stream, digits, ndigits, exponent);
 	}
-}
 
-namespace Duck {
-	FormatStream operator%(OutputStream& stream, const char* fmt) {
-		return {stream, fmt};
+	void format_arg(OutputStream& stream, const FormatParams& params, float arg) {
+		//Printing the float's own shortest digits means 0.1f comes out as 0.1, and not the double closest to it
+		if(params.precision >= 0)
+			return write_fixed(stream, params.precision, arg);
+		if(write_special(stream, arg))
+			return;
+		if(arg < 0) {
+			stream.putchar('-');
+			arg = -arg;
+		}
+		char digits[9];
+		int exponent;
+		int ndigits = __fmt_shortestf(arg, digits, &exponent);
+		write_shortest(stream, digits, ndigits, exponent);
 	}
-}
\ No newline at end of file
+}
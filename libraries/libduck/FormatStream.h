@@ -19,13 +19,54 @@
 
 #include "Stream.h"
 #include "StringStream.h"
+#include <sys/printf.h>
 
 #pragma once
 
 namespace Duck {
 	class FormatParams {
 	public:
-		explicit FormatParams(InputStream& stream);
+		constexpr FormatParams() = default;
+
+		/**
+		 * Reads the parameters of an argument in a format string, starting just after its opening brace, and returns
+		 * where the argument ends. This is constexpr so that format strings made with _fmt can be parsed at compile time.
+		 */
+		static constexpr const char* parse(const char* fmt, FormatParams& params) {
+			if(*fmt == '{') {
+				params.literal_brace = true;
+				return fmt + 1;
+			}
+			while(*fmt) {
+				switch(*fmt++) {
+					case 'c':
+						params.number_format = CHARACTER;
+						break;
+					case 'x':
+						params.number_format = HEX;
+						break;
+					case 'X':
+						params.number_format = HEX_UPPER;
+						break;
+					case 'd':
+						params.number_format = DECIMAL;
+						break;
+					case '#':
+						params.alternate_form = true;
+						break;
+					case '.':
+						params.precision = 0;
+						while(*fmt >= '0' && *fmt <= '9')
+							params.precision = params.precision * 10 + (*fmt++ - '0');
+						break;
+					case '}':
+						return fmt;
+					default:
+						break;
+				}
+			}
+			return fmt;
+		}
 
 		enum {
 			CHARACTER,
@@ -38,98 +79,181 @@ namespace Duck {
 		bool literal_brace = false;
 	};
 
+	/** A run of text in a format string, followed by an argument unless has_arg is false. **/
+	struct FormatSegment {
+		size_t start = 0;
+		size_t length = 0;
+		bool has_arg = false;
+		FormatParams params;
+
+		/** Reads the segment starting at fmt, and returns where the next one starts. **/
+		static constexpr const char* parse(const char* base, const char* fmt, FormatSegment& segment) {
+			segment = FormatSegment();
+			segment.start = fmt - base;
+			while(*fmt && *fmt != '{')
+				fmt++;
+			segment.length = fmt - base - segment.start;
+			if(!*fmt)
+				return fmt;
+			fmt = FormatParams::parse(fmt + 1, segment.params);
+			if(segment.params.literal_brace)
+				segment.length++; //"{{" is the first brace of the pair followed by no argument
+			else
+				segment.has_arg = true;
+			return fmt;
+		}
+	};
+
+	/*
+	 * The formatters for each type of argument. Anything without one of its own is written with operator<<.
+	 */
+
+	void format_arg(OutputStream& stream, const FormatParams& params, unsigned long long arg);
+	void format_signed(OutputStream& stream, const FormatParams& params, long long arg, unsigned long long bits);
+	void format_arg(OutputStream& stream, const FormatParams& params, double arg);
+	void format_arg(OutputStream& stream, const FormatParams& params, float arg);
+
+	//Signed numbers are given as their bits too, so that they're printed in hex with the width of their type
+	inline void format_arg(OutputStream& stream, const FormatParams& params, long long arg) { format_signed(stream, params, arg, arg); }
+	inline void format_arg(OutputStream& stream, const FormatParams& params, long arg) { format_signed(stream, params, arg, (unsigned long) arg); }
+	inline void format_arg(OutputStream& stream, const FormatParams& params, int arg) { format_signed(stream, params, arg, (unsigned int) arg); }
+	inline void format_arg(OutputStream& stream, const FormatParams& params, char arg) { format_signed(stream, params, arg, (unsigned char) arg); }
+	inline void format_arg(OutputStream& stream, const FormatParams& params, unsigned long arg) { format_arg(stream, params, (unsigned long long) arg); }
+	inline void format_arg(OutputStream& stream, const FormatParams& params, unsigned int arg) { format_arg(stream, params, (unsigned long long) arg); }
+	inline void format_arg(OutputStream& stream, const FormatParams& params, long double arg) { format_arg(stream, params, (double) arg); }
+
+	template<typename T>
+	void format_arg(OutputStream& stream, const FormatParams& params, const T& arg) {
+		stream << arg;
+	}
+
+	/**
+	 * Formats a string given at runtime, one argument at a time: stream % "{} is {#x}" % a % b. The arguments are read
+	 * straight out of the format string, which has to stay around until the FormatStream is destroyed.
+	 */
 	class FormatStream {
 	public:
-		FormatStream(OutputStream& stream, std::string format);
+		FormatStream(OutputStream& stream, const char* format): m_stream(stream), m_format(format) {}
 		~FormatStream();
 
 		template<typename T>
 		FormatStream& operator%(const T& arg) {
-			feed(arg);
+			FormatSegment segment;
+			if(next_arg(segment))
+				format_arg(m_stream, segment.params, arg);
 			return *this;
 		}
 
 	private:
-		void output_until_format();
-		FormatParams read_format_params();
-
-		template<typename T>
-		void feed(const T& arg) {
-			feed_start:
-			output_until_format();
-			if(m_fmt_stream.eof())
-				return; //If we reached EOF, there's no argument to print
-			auto fmt_params = read_format_params();
-
-			//If the format parameter is '{', that means just print '{' and look for the next argument
-			if(fmt_params.literal_brace) {
-				m_stream << "{";
-				goto feed_start;
-			}
+		bool next_arg(FormatSegment& segment);
 
-			//Write the argument
-			write_arg(fmt_params, arg);
-		}
-
-		//Base formatters
-		void write_hex(FormatParams params, unsigned long long arg);
-
-		//Integers
-		void write_arg(FormatParams params, long long arg);
-		void write_arg (FormatParams params, long arg) { write_arg(params, (long long) arg); }
-		void write_arg (FormatParams params, int arg) { write_arg(params, (long long) arg); }
-		void write_arg (FormatParams params, char arg) { write_arg(params, (long long) arg); }
-		void write_arg(FormatParams params, unsigned long long arg);
-		void write_arg(FormatParams params, unsigned long arg) { write_arg(params, (unsigned long long) arg); }
-		void write_arg(FormatParams params, unsigned int arg) { write_arg(params, (unsigned long long) arg); }
+		OutputStream& m_stream;
+		const char* m_format;
+	};
 
-		//Floats and Doubles
-		void write_arg(FormatParams params, long double arg);
-		void write_arg(FormatParams params, double arg) { write_arg(params, (long double) arg); }
-		void write_arg(FormatParams params, float arg) { write_arg(params, (long double) arg); }
+	FormatStream operator%(OutputStream& stream, const char* fmt);
 
-		//All other types of args
-		template<typename T>
-		void write_arg(FormatParams params, const T& arg) {
-			m_stream << arg;
+	constexpr size_t count_format_segments(const char* string, bool args_only) {
+		size_t count = 0;
+		FormatSegment segment;
+		for(const char* fmt = string; *fmt;) {
+			fmt = FormatSegment::parse(string, fmt, segment);
+			count += !args_only || segment.has_arg;
 		}
+		return count;
+	}
 
-		OutputStream& m_stream;
-		std::string m_format;
-		StringInputStream m_fmt_stream;
+	template<size_t N>
+	struct FormatSegments {
+		FormatSegment list[N ? N : 1];
 	};
 
-	FormatStream operator%(OutputStream& stream, const char* fmt);
+	template<size_t N>
+	constexpr FormatSegments<N> parse_format_segments(const char* string) {
+		FormatSegments<N> segments {};
+		size_t i = 0;
+		for(const char* fmt = string; *fmt; i++)
+			fmt = FormatSegment::parse(string, fmt, segments.list[i]);
+		return segments;
+	}
+
+	/**
+	 * A format string parsed at compile time, made with the _fmt literal: "{} is {#x}"_fmt. Formatting with one checks
+	 * that it was given the right number of arguments, and doesn't have to parse the string again every time.
+	 */
+	template<char... Chars>
+	class CompiledFormat {
+	public:
+		static constexpr char string[] = {Chars..., '\0'};
+		static constexpr size_t num_segments = count_format_segments(string, false);
+		static constexpr size_t num_args = count_format_segments(string, true);
+		static constexpr FormatSegments<num_segments> segments = parse_format_segments<num_segments>(string);
+	};
 
 	template<typename... T>
 	void sprint(OutputStream& stream, const char* fmt, T... args) {
 		(stream % fmt % ... % args);
 	}
 
-	template<typename... T>
-	void sprintln(OutputStream& stream, const char* fmt, T... args) {
+	template<char... Chars, typename... T>
+	void sprint(OutputStream& stream, CompiledFormat<Chars...>, const T&... args) {
+		using Format = CompiledFormat<Chars...>;
+		static_assert(Format::num_args == sizeof...(T), "The number of arguments doesn't match the format string");
+		size_t i = 0;
+		auto write_segment = [&](const auto& arg) {
+			for(;;) {
+				auto& segment = Format::segments.list[i++];
+				if(segment.length)
+					stream.write(Format::string + segment.start, segment.length);
+				if(segment.has_arg) {
+					format_arg(stream, segment.params, arg);
+					return;
+				}
+			}
+		};
+		(write_segment(args), ...);
+		for(; i < Format::num_segments; i++) {
+			auto& segment = Format::segments.list[i];
+			stream.write(Format::string + segment.start, segment.length);
+		}
+	}
+
+	template<typename FormatT, typename... T>
+	void sprintln(OutputStream& stream, const FormatT& fmt, const T&... args) {
 		sprint(stream, fmt, args...);
 		stream << "\n";
 	}
 
-	template<typename... T>
-	void print(const char* fmt, T... args) {
+	/** Formats into a string. **/
+	template<typename FormatT, typename... T>
+	std::string format(const FormatT& fmt, const T&... args) {
+		StringOutputStream stream;
+		sprint(stream, fmt, args...);
+		return stream.string();
+	}
+
+	template<typename FormatT, typename... T>
+	void print(const FormatT& fmt, const T&... args) {
 		sprint(Stream::std_out, fmt, args...);
 	}
 
-	template<typename... T>
-	void println(const char* fmt, T... args) {
+	template<typename FormatT, typename... T>
+	void println(const FormatT& fmt, const T&... args) {
 		sprintln(Stream::std_out, fmt, args...);
 	}
 
-	template<typename... T>
-	void printerr(const char* fmt, T... args) {
+	template<typename FormatT, typename... T>
+	void printerr(const FormatT& fmt, const T&... args) {
 		sprint(Stream::std_err, fmt, args...);
 	}
 
-	template<typename... T>
-	void printerrln(const char* fmt, T... args) {
+	template<typename FormatT, typename... T>
+	void printerrln(const FormatT& fmt, const T&... args) {
 		sprintln(Stream::std_err, fmt, args...);
 	}
 }
 
+template<typename CharT, CharT... Chars>
+constexpr Duck::CompiledFormat<Chars...> operator""_fmt() {
+	return {};
+}
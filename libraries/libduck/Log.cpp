@@ -18,5 +18,225 @@
 */
 
 #include "Log.h"
+#include "Mutex.h"
+#include "Time.h"
+#include <sys/futex.h>
+#include <sys/thread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 
-Duck::FileOutputStream Duck::Log::kstream = Duck::FileOutputStream("/dev/klog");
\ No newline at end of file
+using namespace Duck;
+
+// How long the same message has to stop coming in before it's logged again instead of just being counted
+#define LOG_REPEAT_WINDOW_NS 1000000000ULL
+
+namespace {
+	/**
+	 * A fixed-size queue that any number of threads can push records to without locking. Each slot has a sequence
+	 * number saying whether it's waiting to be written or read, like the kernel's mpsc_queue. Only one thread pops at
+	 * a time, which s_consumer_lock makes sure of.
+	 */
+	struct Cell {
+		std::atomic<size_t> sequence;
+		Log::Record record;
+	};
+
+	Cell s_cells[DUCK_LOG_QUEUE_SIZE];
+	std::atomic<size_t> s_tail = 0;
+	size_t s_head = 0;
+
+	std::atomic<int> s_epoch = 0; ///< Bumped whenever a record is pushed, for the writer thread to wait on.
+	std::atomic<bool> s_writer_sleeping = false;
+	std::atomic<size_t> s_num_dropped = 0;
+	Mutex s_consumer_lock;
+	Mutex s_start_lock;
+	std::atomic<pid_t> s_writer_pid = 0;
+	int s_klog_fd = -1;
+
+	// What was written last, for collapsing repeated messages. Only touched with s_consumer_lock held.
+	Log::Record s_last_record;
+	uint64_t s_last_written_ns = 0;
+	size_t s_num_repeats = 0;
+	size_t s_num_reported_dropped = 0;
+
+	void reset_queue() {
+		for(size_t i = 0; i < DUCK_LOG_QUEUE_SIZE; i++)
+			s_cells[i].sequence.store(i, std::memory_order_relaxed);
+		s_tail.store(0, std::memory_order_relaxed);
+		s_head = 0;
+	}
+
+	bool push(const Log::Record& record) {
+		size_t tail = s_tail.load(std::memory_order_relaxed);
+		Cell* cell;
+		while(true) {
+			cell = &s_cells[tail % DUCK_LOG_QUEUE_SIZE];
+			auto diff = (intptr_t) (cell->sequence.load(std::memory_order_acquire) - tail);
+			if(diff == 0) {
+				if(s_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+					break;
+			} else if(diff < 0) {
+				return false;
+			} else {
+				tail = s_tail.load(std::memory_order_relaxed);
+			}
+		}
+		cell->record = record;
+		cell->sequence.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(Log::Record& record) {
+		auto& cell = s_cells[s_head % DUCK_LOG_QUEUE_SIZE];
+		if(cell.sequence.load(std::memory_order_acquire) != s_head + 1)
+			return false;
+		record = cell.record;
+		cell.sequence.store(s_head + DUCK_LOG_QUEUE_SIZE, std::memory_order_release);
+		s_head++;
+		return true;
+	}
+
+	void write_record(const Log::Record& record) {
+		if(s_klog_fd < 0)
+			s_klog_fd = open("/dev/klog", O_WRONLY | O_CLOEXEC);
+		if(s_klog_fd >= 0)
+			write(s_klog_fd, record.text(), record.length());
+	}
+
+
+	/// Writes out a record, unless it's the same as the last one and that was only just written. Call with
+	/// s_consumer_lock held.
+	void consume(const Log::Record& record) {
+		auto num_dropped = s_num_dropped.load(std::memory_order_relaxed);
+		if(num_dropped != s_num_reported_dropped) {
+			Log::Record note(Log::Level::Warn);
+			note << "[Log] " << (unsigned long) (num_dropped - s_num_reported_dropped) << " messages dropped";
+			write_record(note);
+			s_num_reported_dropped = num_dropped;
+		}
+
+		auto now = Time::monotonic_nanos();
+		bool repeat = record.length() == s_last_record.length() && !memcmp(record.text(), s_last_record.text(), record.length());
+		if(repeat && now - s_last_written_ns < LOG_REPEAT_WINDOW_NS) {
+			s_num_repeats++;
+			return;
+		}
+		if(s_num_repeats) {
+			Log::Record note(s_last_record.level());
+			note << "Last message repeated " << (unsigned long) s_num_repeats << " times";
+			write_record(note);
+			s_num_repeats = 0;
+		}
+		write_record(record);
+		s_last_record = record;
+		s_last_written_ns = now;
+	}
+
+	void drain() {
+		s_consumer_lock.acquire();
+		Log::Record record;
+		while(pop(record))
+			consume(record);
+		s_consumer_lock.release();
+	}
+
+	void* writer_thread(void*) {
+		while(true) {
+			drain();
+			// Say we're going to sleep before checking for anything new, so that a push we miss sees it and wakes us
+			int epoch = s_epoch.load();
+			s_writer_sleeping.store(true);
+			if(s_cells[s_head % DUCK_LOG_QUEUE_SIZE].sequence.load(std::memory_order_acquire) != s_head + 1)
+				futex((int*) &s_epoch, FUTEX_WAIT, epoch, nullptr);
+			s_writer_sleeping.store(false);
+		}
+		return nullptr;
+	}
+
+	/// Starts the writer thread if this process doesn't have one yet. A forked child doesn't get its parent's, and
+	/// anything its parent had queued is the parent's to write. Returns whether there's a writer thread.
+	bool start_writer() {
+		auto pid = getpid();
+		if(s_writer_pid.load(std::memory_order_acquire) == pid)
+			return true;
+		s_start_lock.acquire();
+		bool started = s_writer_pid.load() == pid;
+		if(!started) {
+			static bool registered_exit = false;
+			reset_queue();
+			started = thread_create(writer_thread, nullptr) >= 0;
+			if(started) {
+				s_writer_pid.store(pid, std::memory_order_release);
+				if(!registered_exit)
+					atexit(Log::flush);
+				registered_exit = true;
+			}
+		}
+		s_start_lock.release();
+		return started;
+	}
+
+	Log::Level level_from_env() {
+		const char* names[] = {"crit", "err", "warn", "success", "info", "debug"};
+		const char* env = getenv("DUCK_LOG_LEVEL");
+		if(env) {
+			for(int i = 0; i < 6; i++)
+				if(!strcmp(env, names[i]))
+					return (Log::Level) (i + 1);
+		}
+		return Log::Level::Debug;
+	}
+}
+
+std::atomic<Log::Level> Log::s_level = level_from_env();
+
+Log::Record::Record(Level level) {
+	m_text[0] = (char) level;
+	m_length = 1;
+}
+
+size_t Log::Record::write(const void* buffer, size_t n) {
+	n = std::min(n, DUCK_LOG_RECORD_SIZE - m_length);
+	memcpy(m_text + m_length, buffer, n);
+	m_length += n;
+	return n;
+}
+
+void Log::flush() {
+	s_consumer_lock.acquire();
+	Record record;
+	while(pop(record))
+		consume(record);
+	if(s_num_repeats) {
+		Record note(s_last_record.level());
+		note << "Last message repeated " << (unsigned long) s_num_repeats << " times";
+		write_record(note);
+		s_num_repeats = 0;
+	}
+	s_consumer_lock.release();
+}
+
+void Log::submit(const Record& record) {
+	// Critical messages might be the last thing we get to say, so they're written out right away
+	if(record.level() == Level::Critical || !start_writer()) {
+		s_consumer_lock.acquire();
+		Record queued;
+		while(pop(queued))
+			consume(queued);
+		consume(record);
+		s_consumer_lock.release();
+		return;
+	}
+
+	if(!push(record)) {
+		s_num_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	s_epoch.fetch_add(1);
+	if(s_writer_sleeping.load())
+		futex((int*) &s_epoch, FUTEX_WAKE, 1, nullptr);
+}
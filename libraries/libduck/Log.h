@@ -19,99 +19,139 @@
 
 #pragma once
 
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include "FormatStream.h"
 #include "FileStream.h"
 
+// The longest a log message can be, including its level. Anything past that is cut off.
+#define DUCK_LOG_RECORD_SIZE 512
+// How many messages can be waiting to be written out before new ones are dropped.
+#define DUCK_LOG_QUEUE_SIZE 256
+
 namespace Duck {
+	/**
+	 * Logs messages to the kernel log. Messages are formatted on the calling thread and handed to a background thread
+	 * through a lock-free queue, so logging never waits on the log being written out. Messages below the log level are
+	 * dropped before they're formatted, and the same message being logged over and over is collapsed into a count.
+	 */
 	class Log {
 	public:
+		enum class Level {
+			Critical = 1, Error, Warn, Success, Info, Debug
+		};
+
+		/// Sets the least important level of message that's logged. Defaults to the level named by the DUCK_LOG_LEVEL
+		/// environment variable (crit, err, warn, success, info or debug), or debug if it isn't set.
+		static void set_level(Level level) { s_level.store(level, std::memory_order_relaxed); }
+		static Level level() { return s_level.load(std::memory_order_relaxed); }
+		static bool enabled(Level level) { return level <= s_level.load(std::memory_order_relaxed); }
+
+		/// Waits for every message that's been logged so far to be written out.
+		static void flush();
+
 		template<typename... ParamTs>
 		static inline void dbg(const ParamTs&... params) {
-			((kstream << "\06") << ... << params) << "\n";
-//			(Stream::std_err << "\033[90m[DEBUG] " << ... << params) << "\033[39;49m" << "\n";
+			log(Level::Debug, params...);
 		}
 
 		template<typename... ParamTs>
 		static inline void info(const ParamTs&... params) {
-			((kstream << "\05") << ... << params) << "\n";
-//			(Stream::std_err << "\033[94m[INFO] " << ... << params) << "\033[39;49m" << "\n";
+			log(Level::Info, params...);
 		}
-		
+
 		template<typename... ParamTs>
 		static inline void success(const ParamTs&... params) {
-			((kstream << "\04") << ... << params) << "\n";
-//			(Stream::std_err << "\033[92m[SUCCESS] " << ... << params) << "\033[39;49m" << "\n";
+			log(Level::Success, params...);
 		}
-		
+
 		template<typename... ParamTs>
 		static inline void warn(const ParamTs&... params) {
-			((kstream << "\03") << ... << params) << "\n";
-//			(Stream::std_err << "\033[93m[WARN] " << ... << params) << "\033[39;49m" << "\n";
+			log(Level::Warn, params...);
 		}
-		
+
 		template<typename... ParamTs>
 		static inline void err(const ParamTs&... params) {
-			((kstream << "\02") << ... << params) << "\n";
-//			(Stream::std_err << "\033[91m[ERROR] " << ... << params) << "\033[39;49m" << "\n";
+			log(Level::Error, params...);
 		}
 
 		template<typename... ParamTs>
 		static inline void crit(const ParamTs&... params) {
-			((kstream << "\01") << ... << params) << "\n";
-//			(Stream::std_err << "\033[97;41m[CRITICAL] " << ... << params) << "\033[39;49m" << "\n";
+			log(Level::Critical, params...);
 		}
 
-		template<typename... ParamTs>
-		static inline void dbgf(const char* fmt, const ParamTs&... params) {
-			((kstream << "\06") % fmt % ... % params);
-			kstream << "\n";
-//			((Stream::std_err << "\033[90m[DEBUG] ") % fmt % ... % params);
-//			Stream::std_err << "\033[39;49m" << "\n";
+		template<typename FormatT, typename... ParamTs>
+		static inline void dbgf(const FormatT& fmt, const ParamTs&... params) {
+			logf(Level::Debug, fmt, params...);
 		}
 
-		template<typename... ParamTs>
-		static inline void infof(const char* fmt, const ParamTs&... params) {
-			((kstream << "\05") % fmt % ... % params);
-			kstream << "\n";
-//			((Stream::std_err << "\033[94m[INFO] ") % fmt % ... % params);
-//			Stream::std_err << "\033[39;49m" << "\n";
+		template<typename FormatT, typename... ParamTs>
+		static inline void infof(const FormatT& fmt, const ParamTs&... params) {
+			logf(Level::Info, fmt, params...);
 		}
 
-		template<typename... ParamTs>
-		static inline void successf(const char* fmt, const ParamTs&... params) {
-			((kstream << "\04") % fmt % ... % params);
-			kstream << "\n";
-//			((Stream::std_err << "\033[92m[SUCCESS] ") % fmt % ... % params);
-//			Stream::std_err << "\033[39;49m" << "\n";
+		template<typename FormatT, typename... ParamTs>
+		static inline void successf(const FormatT& fmt, const ParamTs&... params) {
+			logf(Level::Success, fmt, params...);
 		}
 
-		template<typename... ParamTs>
-		static inline void warnf(const char* fmt, const ParamTs&... params) {
-			((kstream << "\03") % fmt % ... % params);
-			kstream << "\n";
-//			((Stream::std_err << "\033[93m[WARN] ") % fmt % ... % params);
-//			Stream::std_err << "\033[39;49m" << "\n";
+		template<typename FormatT, typename... ParamTs>
+		static inline void warnf(const FormatT& fmt, const ParamTs&... params) {
+			logf(Level::Warn, fmt, params...);
 		}
 
-		template<typename... ParamTs>
-		static inline void errf(const char* fmt, const ParamTs&... params) {
-			((kstream << "\02") % fmt % ... % params);
-			kstream << "\n";
-//			((Stream::std_err << "\033[91m[ERROR] ") % fmt % ... % params);
-//			Stream::std_err << "\033[39;49m" << "\n";
+		template<typename FormatT, typename... ParamTs>
+		static inline void errf(const FormatT& fmt, const ParamTs&... params) {
+			logf(Level::Error, fmt, params...);
 		}
 
-		template<typename... ParamTs>
-		static inline void critf(const char* fmt, const ParamTs&... params) {
-			((kstream << "\01") % fmt % ... % params);
-			kstream << "\n";
-//			((Stream::std_err << "\033[97;41m[CRITICAL] ") % fmt % ... % params);
-//			Stream::std_err << "\033[39;49m" << "\n";
+		template<typename FormatT, typename... ParamTs>
+		static inline void critf(const FormatT& fmt, const ParamTs&... params) {
+			logf(Level::Critical, fmt, params...);
 		}
-		
+
+		/// A message being formatted, which is cut off if it gets too long.
+		class Record: public OutputStream {
+		public:
+			Record() = default;
+			explicit Record(Level level);
+
+			//OutputStream
+			size_t write(const void* buffer, size_t n) override;
+			Result seek(long offset, Whence whence) override { return Result(EINVAL); }
+
+			[[nodiscard]] Level level() const { return (Level) m_text[0]; }
+			/// The message, starting with its level as a byte, which is how /dev/klog expects it.
+			[[nodiscard]] const char* text() const { return m_text; }
+			[[nodiscard]] size_t length() const { return m_length; }
+
+		private:
+			char m_text[DUCK_LOG_RECORD_SIZE];
+			size_t m_length = 0;
+		};
+
 	private:
-		static Duck::FileOutputStream kstream;
+		template<typename... ParamTs>
+		static void log(Level level, const ParamTs&... params) {
+			if(!enabled(level))
+				return;
+			Record record(level);
+			(record << ... << params);
+			submit(record);
+		}
+
+		template<typename FormatT, typename... ParamTs>
+		static void logf(Level level, const FormatT& fmt, const ParamTs&... params) {
+			if(!enabled(level))
+				return;
+			Record record(level);
+			sprint(record, fmt, params...);
+			submit(record);
+		}
+
+		static void submit(const Record& record);
+
+		static std::atomic<Level> s_level;
 	};
 }
\ No newline at end of file
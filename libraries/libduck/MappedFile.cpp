@@ -0,0 +1,52 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "MappedFile.h"
+#include "Log.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cstring>
+
+using namespace Duck;
+
+ResultRet<Duck::Ptr<MappedFile>> MappedFile::map(const Path& path) {
+	int fd = open(path.string().c_str(), O_RDONLY | O_CLOEXEC);
+	if(fd < 0)
+		return Result(errno);
+	auto ret = map(fd);
+	close(fd);
+	return ret;
+}
+
+ResultRet<Duck::Ptr<MappedFile>> MappedFile::map(const File& file) {
+	if(!file.is_open())
+		return Result(EBADF);
+	return map(file.fd());
+}
+
+ResultRet<Duck::Ptr<MappedFile>> MappedFile::map(int fd) {
+	struct stat st;
+	if(fstat(fd, &st) < 0)
+		return Result(errno);
+	if(!S_ISREG(st.st_mode))
+		return Result(ENODEV);
+
+	// Nothing to map for an empty file, but it's still a perfectly good (empty) file
+	if(!st.st_size)
+		return Ptr<MappedFile>(new MappedFile(nullptr, 0));
+
+	void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(data == MAP_FAILED)
+		return Result(errno);
+	return Ptr<MappedFile>(new MappedFile(data, st.st_size));
+}
+
+MappedFile::MappedFile(void* data, size_t size): m_data(data), m_size(size) {
+
+}
+
+MappedFile::~MappedFile() noexcept {
+	if(m_data && munmap(m_data, m_size) < 0)
+		Duck::Log::warnf("Duck::MappedFile: Failed to unmap file: {}", strerror(errno));
+}
@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <string_view>
+#include "Result.h"
+#include "Object.h"
+#include "Path.h"
+#include "File.h"
+
+namespace Duck {
+	/**
+	 * A whole file mapped read-only into memory, for things that parse a file all at once and would otherwise have to
+	 * read it into a buffer first. Only regular files can be mapped.
+	 */
+	class MappedFile: public Duck::Object {
+	public:
+		DUCK_OBJECT_DEF(MappedFile);
+
+		~MappedFile() noexcept;
+
+		static ResultRet<Duck::Ptr<MappedFile>> map(const Path& path);
+		static ResultRet<Duck::Ptr<MappedFile>> map(const File& file);
+
+		[[nodiscard]] const void* data() const { return m_data; }
+		[[nodiscard]] size_t size() const { return m_size; }
+		[[nodiscard]] std::string_view view() const { return {(const char*) m_data, m_size}; }
+
+		template<typename T>
+		[[nodiscard]] const T* data() const { return (const T*) m_data; }
+
+	private:
+		MappedFile(void* data, size_t size);
+		static ResultRet<Duck::Ptr<MappedFile>> map(int fd);
+
+		void* m_data;
+		size_t m_size;
+	};
+}
@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Mutex.h"
+#include <sys/futex.h>
+
+using namespace Duck;
+
+void Mutex::acquire() {
+	int state = 0;
+	if(m_state.compare_exchange_strong(state, 1, std::memory_order_acquire, std::memory_order_relaxed))
+		return;
+
+	// Mark the mutex as contended so that release() wakes us up, and sleep until it's free
+	if(state != 2)
+		state = m_state.exchange(2, std::memory_order_acquire);
+	while(state) {
+		futex((int*) &m_state, FUTEX_WAIT, 2, nullptr);
+		state = m_state.exchange(2, std::memory_order_acquire);
+	}
+}
+
+bool Mutex::try_acquire() {
+	int state = 0;
+	return m_state.compare_exchange_strong(state, 1, std::memory_order_acquire, std::memory_order_relaxed);
+}
+
+void Mutex::release() {
+	if(m_state.exchange(0, std::memory_order_release) == 2)
+		futex((int*) &m_state, FUTEX_WAKE, 1, nullptr);
+}
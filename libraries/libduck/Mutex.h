@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "SpinLock.h"
+#include <atomic>
+
+namespace Duck {
+	/**
+	 * A lock that threads sleep on in the kernel while it's held. Acquiring or releasing one that nobody else wants
+	 * doesn't make any syscalls.
+	 */
+	class Mutex {
+	public:
+		Mutex() = default;
+		Mutex(const Mutex& other) = delete;
+
+		void acquire();
+		bool try_acquire();
+		void release();
+
+	private:
+		std::atomic<int> m_state = {0}; ///< 0 if unlocked, 1 if locked, 2 if locked and there may be threads waiting.
+	};
+}
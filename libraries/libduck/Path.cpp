@@ -80,7 +80,7 @@ ResultRet<std::vector<DirectoryEntry>> Path::get_directory_entries() const {
 	struct dirent* entry;
 	while((entry = readdir(dir)) != NULL) {
 		if(std::string(entry->d_name) != "." && std::string(entry->d_name) != "..")
-			entries.emplace_back(*this, entry);
+			entries.emplace_back(*this, entry, dirfd(dir));
 	}
 	closedir(dir);
 
@@ -0,0 +1,16 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Service.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+void Duck::Service::notify_ready() {
+	auto* fd_str = getenv(INIT_NOTIFY_FD_ENV);
+	if(!fd_str)
+		return;
+	int fd = atoi(fd_str);
+	write(fd, "\n", 1);
+	close(fd);
+	unsetenv(INIT_NOTIFY_FD_ENV);
+}
@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+// The environment variable that init uses to tell a service which file descriptor to notify it on
+#define INIT_NOTIFY_FD_ENV "INIT_NOTIFY_FD"
+
+namespace Duck::Service {
+	/**
+	 * Tells init that this service is ready, so that the services that come after it can be started. This only does
+	 * anything for services with notify=true in their config, which init waits on until they call this.
+	 */
+	void notify_ready();
+}
@@ -40,7 +40,7 @@ SharedBuffer::SharedBuffer(shm shm_info): m_shm(shm_info) {
 }
 
 SharedBuffer::~SharedBuffer() noexcept {
-	if(shmdetach(m_shm.id) < 0)
+	if(!m_transferred && shmdetach(m_shm.id) < 0)
 		Duck::Log::warnf("Duck::SharedBuffer: Failed to detach shm: {}", strerror(errno));
 }
 
@@ -55,3 +55,19 @@ ResultRet<Duck::Ptr<SharedBuffer>> SharedBuffer::copy() const {
 int SharedBuffer::allow(int pid, bool read, bool write) {
 	return shmallow(m_shm.id, pid, (read ? SHM_READ : 0) | (write ? SHM_WRITE : 0));
 }
+
+Result SharedBuffer::transfer(int pid, bool write) {
+	if(shmallow(m_shm.id, pid, SHM_READ | (write ? SHM_WRITE : 0) | SHM_TRANSFER) < 0)
+		return Result(errno);
+	m_transferred = true;
+	m_shm.ptr = nullptr;
+	m_shm.size = 0;
+	return Result::SUCCESS;
+}
+
+ResultRet<bool> SharedBuffer::set_purgeable(bool purgeable) {
+	int res = shmpurgeable(m_shm.id, purgeable);
+	if(res < 0)
+		return Result(errno);
+	return res == 1;
+}
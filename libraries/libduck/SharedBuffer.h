@@ -37,6 +37,19 @@ namespace Duck {
 
 		[[nodiscard]] ResultRet<Duck::Ptr<SharedBuffer>> copy() const;
 		int allow(int pid, bool read = true, bool write = true);
+		/**
+		 * Hands the buffer over to another process without copying it. This process loses its access to the buffer, so
+		 * it can't be used afterwards; the other process can adopt it with the same id.
+		 * @param pid The process to give the buffer to.
+		 * @param write Whether the other process may write to the buffer.
+		 */
+		Result transfer(int pid, bool write = true);
+		/**
+		 * Lets the kernel throw away the contents of the buffer when memory is low, or stops it from doing so.
+		 * @param purgeable Whether the buffer should be purgeable.
+		 * @return Whether the contents were thrown away since the buffer was last made purgeable.
+		 */
+		ResultRet<bool> set_purgeable(bool purgeable);
 
 		[[nodiscard]] void* ptr() const { return m_shm.ptr; }
 		[[nodiscard]] size_t size() const { return m_shm.size; }
@@ -51,6 +64,7 @@ namespace Duck {
 		explicit SharedBuffer(struct shm shm_info);
 
 		struct shm m_shm = {nullptr, 0, 0};
+		bool m_transferred = false;
 	};
 }
 
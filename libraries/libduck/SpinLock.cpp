@@ -18,20 +18,25 @@
 */
 
 #include "SpinLock.h"
-#include <sys/thread.h>
+#include <sys/futex.h>
+
+// How many times to try taking the lock before sleeping on it
+#define SPINLOCK_SPIN_COUNT 64
 
 void Duck::SpinLock::acquire() {
-	while(times_locked.exchange(1, std::memory_order_acquire));
+	for(int i = 0; i < SPINLOCK_SPIN_COUNT; i++) {
+		int expected = 0;
+		if(times_locked.compare_exchange_weak(expected, 1, std::memory_order_acquire, std::memory_order_relaxed))
+			return;
+		__builtin_ia32_pause();
+	}
+
+	// Mark the lock as contended so that release() wakes us up, and sleep until it's free
+	while(times_locked.exchange(2, std::memory_order_acquire))
+		futex((int*) &times_locked, FUTEX_WAIT, 2, nullptr);
 }
 
 void Duck::SpinLock::release() {
-	times_locked.store(0, std::memory_order_release);
-}
-
-Duck::ScopedLock::ScopedLock(Duck::SpinLock& lock): lock(lock) {
-	lock.acquire();
-}
-
-Duck::ScopedLock::~ScopedLock() {
-	lock.release();
+	if(times_locked.exchange(0, std::memory_order_release) == 2)
+		futex((int*) &times_locked, FUTEX_WAKE, 1, nullptr);
 }
@@ -25,6 +25,11 @@
 #define LOCK(l) Duck::ScopedLock __lock(l);
 
 namespace Duck {
+	/**
+	 * A lock for short critical sections. A thread trying to acquire it spins for a little while in case it's released
+	 * soon, and then sleeps on a futex until it is, so a holder that gets preempted doesn't leave everyone else spinning
+	 * away their time slices.
+	 */
 	class SpinLock {
 	public:
 		SpinLock() = default;
@@ -32,15 +37,23 @@ namespace Duck {
 		void release();
 
 	private:
-		std::atomic<int> times_locked = {0};
+		std::atomic<int> times_locked = {0}; ///< 0 if unlocked, 1 if locked, 2 if locked and there may be threads waiting.
 	};
 
+	/** Holds a lock (anything with acquire() and release()) for as long as it's in scope. **/
+	template<typename Lock>
 	class ScopedLock {
 	public:
-		explicit ScopedLock(SpinLock& lock);
-		~ScopedLock();
+		explicit ScopedLock(Lock& lock): lock(lock) {
+			lock.acquire();
+		}
+
+		~ScopedLock() {
+			lock.release();
+		}
+
 	private:
-		SpinLock& lock;
+		Lock& lock;
 	};
 }
 
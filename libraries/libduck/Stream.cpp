@@ -19,6 +19,7 @@
 
 #include "Stream.h"
 #include "FileStream.h"
+#include <sys/printf.h>
 
 using namespace Duck;
 
@@ -34,6 +35,19 @@ Stream::~Stream() = default;
 	return ret;
 }
 
+std::optional<std::string_view> InputStream::read_until(char delimiter) {
+	m_line.clear();
+	char read_char;
+	size_t nread = read(&read_char, 1);
+	if(!nread)
+		return std::nullopt;
+	while(nread && read_char != delimiter) {
+		m_line += read_char;
+		nread = read(&read_char, 1);
+	}
+	return m_line;
+}
+
 
 /*
  * Stream operators
@@ -54,15 +68,11 @@ namespace Duck {
 	}
 
 	InputStream& operator>>(InputStream& stream, std::string& string) {
-		string = "";
-		char read;
-		size_t nread = stream.read(&read, 1);
-
-		while(read != stream.delimeter() && nread) {
-			string += read;
-			nread = stream.read(&read, 1);
-		}
-
+		auto line = stream.read_until(stream.delimeter());
+		if(line)
+			string.assign(line->data(), line->size());
+		else
+			string.clear();
 		return stream;
 	}
 
@@ -89,6 +99,21 @@ namespace Duck {
 	 * OutputStream primitives
 	 */
 
+	static OutputStream& write_unsigned(OutputStream& stream, unsigned long long value) {
+		char buf[20];
+		char* start = __fmt_dec(value, buf + sizeof(buf));
+		stream.write(start, buf + sizeof(buf) - start);
+		return stream;
+	}
+
+	static OutputStream& write_signed(OutputStream& stream, long long value) {
+		if(value < 0) {
+			stream.write("-", 1);
+			return write_unsigned(stream, -(unsigned long long) value);
+		}
+		return write_unsigned(stream, value);
+	}
+
 	OutputStream& operator<<(OutputStream& stream, char chr) {
 		stream.write(&chr, 1);
 		return stream;
@@ -100,11 +125,11 @@ namespace Duck {
 	}
 
 	OutputStream& operator<<(OutputStream& stream, int value) {
-		return operator<<(stream, std::to_string(value));
+		return write_signed(stream, value);
 	}
 
 	OutputStream& operator<<(OutputStream& stream, long value) {
-		return operator<<(stream, std::to_string(value));
+		return write_signed(stream, value);
 	}
 
 	OutputStream& operator<<(OutputStream& stream, float value) {
@@ -116,7 +141,7 @@ namespace Duck {
 	}
 
 	OutputStream& operator<<(OutputStream& stream, long long value) {
-		return operator<<(stream, std::to_string(value));
+		return write_signed(stream, value);
 	}
 
 	OutputStream& operator<<(OutputStream& stream, long double value) {
@@ -124,14 +149,14 @@ namespace Duck {
 	}
 
 	OutputStream& operator<<(OutputStream& stream, unsigned int value) {
-		return operator<<(stream, std::to_string(value));
+		return write_unsigned(stream, value);
 	}
 
 	OutputStream& operator<<(OutputStream& stream, unsigned long value) {
-		return operator<<(stream, std::to_string(value));
+		return write_unsigned(stream, value);
 	}
 
 	OutputStream& operator<<(OutputStream& stream, unsigned long long value) {
-		return operator<<(stream, std::to_string(value));
+		return write_unsigned(stream, value);
 	}
 }
\ No newline at end of file
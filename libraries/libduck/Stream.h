@@ -21,6 +21,8 @@
 
 #include "Result.h"
 #include "bits/IOBits.h"
+#include <optional>
+#include <string_view>
 
 namespace Duck {
 	class InputStream;
@@ -53,8 +55,18 @@ namespace Duck {
 			return ret;
 		}
 
+		/**
+		 * Reads up to the next delimiter (or the end of the stream). The delimiter is read too, but isn't included.
+		 * @param delimiter The character to read up to.
+		 * @return A view of what was read, which is only valid until the stream is next used. If the stream was already
+		 *         at its end, nothing is returned.
+		 */
+		virtual std::optional<std::string_view> read_until(char delimiter);
+		std::optional<std::string_view> readline() { return read_until('\n'); }
+
 	private:
 		char m_delimeter = '\n';
+		std::string m_line;
 	};
 
 	class OutputStream: public Stream {
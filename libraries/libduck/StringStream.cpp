@@ -33,6 +33,23 @@ size_t StringInputStream::read(void* buffer, size_t n) {
 	return n;
 }
 
+std::optional<std::string_view> StringInputStream::read_until(char delimiter) {
+	if(m_offset >= m_string.length()) {
+		m_eof = true;
+		return std::nullopt;
+	}
+	auto view = std::string_view(m_string).substr(m_offset);
+	auto end = view.find(delimiter);
+	if(end == std::string_view::npos) {
+		m_offset = m_string.length();
+	} else {
+		view = view.substr(0, end);
+		m_offset += end + 1;
+	}
+	m_eof = m_offset == m_string.length();
+	return view;
+}
+
 Result StringInputStream::seek(long offset, Whence whence) {
 	switch(whence) {
 	case SET:
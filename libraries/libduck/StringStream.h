@@ -32,6 +32,7 @@ namespace Duck {
 		size_t read(void* buffer, size_t n) override;
 		Result seek(long offset, Whence whence) override;
 		[[nodiscard]] bool eof() const override { return m_eof; }
+		std::optional<std::string_view> read_until(char delimiter) override;
 
 	private:
 		std::string m_string;
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <algorithm>
 
 namespace Duck {
@@ -40,5 +41,21 @@ namespace Duck {
 	inline std::string& trim(std::string& str) {
 		return ltrim(rtrim(str));
 	}
+
+	inline std::string_view rtrim(std::string_view str) {
+		while(!str.empty() && std::isspace((unsigned char) str.back()))
+			str.remove_suffix(1);
+		return str;
+	}
+
+	inline std::string_view ltrim(std::string_view str) {
+		while(!str.empty() && std::isspace((unsigned char) str.front()))
+			str.remove_prefix(1);
+		return str;
+	}
+
+	inline std::string_view trim(std::string_view str) {
+		return ltrim(rtrim(str));
+	}
 }
 
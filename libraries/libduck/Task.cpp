@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Task.h"
+#include "Log.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+
+using namespace Duck;
+
+/**
+ * Saves the callee-saved registers on the current stack, stores the stack pointer in *save_stack_pointer, and then
+ * switches to new_stack_pointer and restores the registers that were saved there. Returns on the new stack.
+ */
+extern "C" void duck_fiber_switch(void** save_stack_pointer, void* new_stack_pointer) __attribute__((visibility("hidden")));
+asm(R"(
+.pushsection .text
+.globl duck_fiber_switch
+.hidden duck_fiber_switch
+.type duck_fiber_switch, @function
+duck_fiber_switch:
+	movl 4(%esp), %eax
+	movl 8(%esp), %edx
+	pushl %ebp
+	pushl %ebx
+	pushl %esi
+	pushl %edi
+	movl %esp, (%eax)
+	movl %edx, %esp
+	popl %edi
+	popl %esi
+	popl %ebx
+	popl %ebp
+	ret
+.popsection
+)");
+
+namespace {
+	thread_local Fiber* s_current_fiber = nullptr;
+}
+
+Fiber::Fiber() {
+	m_stack = mmap(nullptr, STACK_SIZE, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	assert(m_stack != MAP_FAILED);
+	//The bottom page is left inaccessible, so that running off the end of the stack faults right away
+	mprotect(m_stack, PAGE_SIZE, PROT_NONE);
+
+	//Set up the stack so that switching to it "returns" into entry(this), with the stack aligned like a normal call
+	auto* stack_top = (uint32_t*) ((uintptr_t) m_stack + STACK_SIZE);
+	stack_top -= 4;
+	stack_top[0] = (uint32_t) this;
+	*--stack_top = 0; // entry() never returns
+	*--stack_top = (uint32_t) entry;
+	for(int i = 0; i < 4; i++)
+		*--stack_top = 0; // ebp, ebx, esi, edi
+	m_stack_pointer = stack_top;
+}
+
+Fiber::~Fiber() {
+	assert(m_state != Running);
+	munmap(m_stack, STACK_SIZE);
+}
+
+Fiber* Fiber::current() {
+	return s_current_fiber;
+}
+
+void Fiber::suspend() {
+	auto* fiber = s_current_fiber;
+	assert(fiber);
+	fiber->m_state = Suspended;
+	duck_fiber_switch(&fiber->m_stack_pointer, fiber->m_resumer_stack_pointer);
+}
+
+void Fiber::resume() {
+	assert(m_state == Created || m_state == Suspended);
+	m_resumer = s_current_fiber;
+	s_current_fiber = this;
+	m_state = Running;
+	duck_fiber_switch(&m_resumer_stack_pointer, m_stack_pointer);
+	s_current_fiber = m_resumer;
+}
+
+void Fiber::entry(Fiber* fiber) {
+	fiber->run();
+	fiber->m_state = Finished;
+	duck_fiber_switch(&fiber->m_stack_pointer, fiber->m_resumer_stack_pointer);
+	__builtin_unreachable();
+}
+
+void Async::wait(const std::function<void(std::function<void()>)>& start) {
+	auto* fiber = Fiber::current();
+	if(!fiber) {
+		//We aren't in a task, so the best we can do is run the event loop until we're woken up
+		auto woken = std::make_shared<bool>(false);
+		start([woken] { *woken = true; });
+		EventLoop::current().run_while([woken] { return !*woken; });
+		if(!*woken)
+			Log::warn("Duck::Async::wait: The event loop ran out of things to wait on before we were woken up");
+		return;
+	}
+
+	//The waker might be called right away (before we've suspended), in which case there's nothing to resume
+	auto self = fiber->shared_from_this();
+	auto woken = std::make_shared<bool>(false);
+	start([self, woken] {
+		*woken = true;
+		if(self->suspended())
+			self->resume();
+	});
+	while(!*woken)
+		Fiber::suspend();
+}
+
+void Async::poll(int fd, bool write) {
+	wait([fd, write](std::function<void()> wake) {
+		EventLoop::current().watch(fd, write, std::move(wake));
+	});
+}
+
+ResultRet<size_t> Async::read(int fd, void* buffer, size_t count) {
+	poll(fd, false);
+	ssize_t nread = ::read(fd, buffer, count);
+	if(nread < 0)
+		return Result(errno);
+	return (size_t) nread;
+}
+
+ResultRet<size_t> Async::write(int fd, const void* buffer, size_t count) {
+	poll(fd, true);
+	ssize_t nwritten = ::write(fd, buffer, count);
+	if(nwritten < 0)
+		return Result(errno);
+	return (size_t) nwritten;
+}
+
+void Async::sleep(long millis) {
+	wait([millis](std::function<void()> wake) {
+		EventLoop::current().call_later(millis, std::move(wake));
+	});
+}
@@ -0,0 +1,165 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "EventLoop.h"
+#include "Result.h"
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace Duck {
+	/**
+	 * A function running on its own stack, which can suspend itself partway through and be resumed later. This is
+	 * what Task is built on; use that instead.
+	 */
+	class Fiber: public std::enable_shared_from_this<Fiber> {
+	public:
+		/// How big a fiber's stack is. Its pages are only allocated as they're used.
+		static constexpr size_t STACK_SIZE = 256 * 1024;
+
+		Fiber(const Fiber& other) = delete;
+		virtual ~Fiber();
+
+		/// The fiber running on the current thread, or nullptr if we aren't in one.
+		static Fiber* current();
+		/// Switches back to whatever resumed the current fiber. Returns when the fiber is resumed again.
+		static void suspend();
+
+		/// Runs the fiber until it suspends itself or finishes.
+		void resume();
+
+		[[nodiscard]] bool suspended() const { return m_state == Suspended; }
+		[[nodiscard]] bool finished() const { return m_state == Finished; }
+
+	protected:
+		Fiber();
+		virtual void run() = 0;
+
+	private:
+		enum State {
+			Created, Running, Suspended, Finished
+		};
+
+		static void entry(Fiber* fiber);
+
+		State m_state = Created;
+		void* m_stack = nullptr;
+		void* m_stack_pointer = nullptr;
+		void* m_resumer_stack_pointer = nullptr;
+		Fiber* m_resumer = nullptr;
+	};
+
+	namespace Async {
+		/**
+		 * Suspends the current task until it's woken up. start is called with a function that wakes the task, which
+		 * should be handed to whatever the task is waiting on. Outside of a task, this runs the event loop until woken.
+		 */
+		void wait(const std::function<void(std::function<void()>)>& start);
+
+		/// Like wait(), but for something that wakes the task with a value, which is returned.
+		template<typename T>
+		T wait_for(const std::function<void(std::function<void(T)>)>& start) {
+			auto result = std::make_shared<std::optional<T>>();
+			wait([&](std::function<void()> wake) {
+				start([result, wake](T value) {
+					*result = std::move(value);
+					wake();
+				});
+			});
+			return std::move(**result);
+		}
+
+		/// Waits until a file descriptor is ready to be read from (or written to).
+		void poll(int fd, bool write = false);
+		/// Waits until a file descriptor can be read from, and then reads from it.
+		ResultRet<size_t> read(int fd, void* buffer, size_t count);
+		/// Waits until a file descriptor can be written to, and then writes as much to it as it'll take.
+		ResultRet<size_t> write(int fd, const void* buffer, size_t count);
+		/// Waits for the given number of milliseconds.
+		void sleep(long millis);
+	}
+
+	/**
+	 * A function that runs asynchronously on the current event loop. Tasks are stackful coroutines: they run like
+	 * any other function until they wait on something with Duck::Async (or await another task), at which point they
+	 * suspend and let the event loop get on with other things until whatever they're waiting on is ready. Many reads,
+	 * writes and calls can then be in flight at once without any threads or chains of callbacks.
+	 *
+	 * A Task is a handle to the running function. It can be copied around, and the function keeps running even if
+	 * every handle to it is gone.
+	 */
+	template<typename T>
+	class Task {
+	public:
+		/// Starts running a function as a task. It runs right away until it first waits on something.
+		static Task spawn(std::function<T()> func) {
+			auto state = std::make_shared<State>(std::move(func));
+			state->resume();
+			return Task(state);
+		}
+
+		[[nodiscard]] bool done() const { return m_state->finished(); }
+
+		/// Waits for the task to finish and returns its result. Outside of a task, this runs the event loop meanwhile.
+		T await() {
+			if(!done()) {
+				auto state = m_state;
+				Async::wait([state](std::function<void()> wake) {
+					state->on_done(std::move(wake));
+				});
+			}
+			if constexpr(!std::is_void<T>())
+				return *m_state->result;
+		}
+
+		/// Calls a function from the event loop once the task is finished.
+		void on_done(std::function<void()> callback) {
+			m_state->on_done(std::move(callback));
+		}
+
+	private:
+		using Storage = typename std::conditional<std::is_void<T>::value, bool, T>::type;
+
+		class State: public Fiber {
+		public:
+			explicit State(std::function<T()> func): m_func(std::move(func)) {}
+
+			void on_done(std::function<void()> callback) {
+				if(finished())
+					EventLoop::current().post(std::move(callback));
+				else
+					m_waiters.push_back(std::move(callback));
+			}
+
+			std::optional<Storage> result;
+
+		protected:
+			void run() override {
+				if constexpr(std::is_void<T>()) {
+					m_func();
+					result = true;
+				} else {
+					result = m_func();
+				}
+				m_func = nullptr;
+
+				//Wake up whoever's waiting from the event loop, since we're about to be switched away from for good
+				for(auto& waiter : m_waiters)
+					EventLoop::current().post(std::move(waiter));
+				m_waiters.clear();
+			}
+
+		private:
+			std::function<T()> m_func;
+			std::vector<std::function<void()>> m_waiters;
+		};
+
+		explicit Task(std::shared_ptr<State> state): m_state(std::move(state)) {}
+
+		std::shared_ptr<State> m_state;
+	};
+}
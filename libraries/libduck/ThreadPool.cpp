@@ -0,0 +1,280 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "ThreadPool.h"
+#include <limits.h>
+#include <memory>
+#include <sched.h>
+#include <sys/futex.h>
+#include <sys/thread.h>
+
+using namespace Duck;
+
+/**
+ * A worker and its deque of tasks, which is the Chase-Lev deque as described in "Correct and Efficient Work-Stealing
+ * for Weak Memory Models" (Lê et al.). Only the worker pushes and pops at the bottom, and anybody can steal from the
+ * top. When the deque fills up, the worker copies it into one twice the size. The old buffers are kept around until
+ * the worker exits, since a thief may still be reading from one.
+ */
+class ThreadPool::Worker {
+public:
+	Worker(ThreadPool& pool, int index): m_pool(pool), m_index(index) {
+		m_buffers.push_back(new Buffer(64));
+		m_buffer.store(m_buffers.back(), std::memory_order_relaxed);
+	}
+
+	~Worker() {
+		for(auto* buffer : m_buffers)
+			delete buffer;
+	}
+
+	void push(Task* task) {
+		ssize_t bottom = m_bottom.load(std::memory_order_relaxed);
+		ssize_t top = m_top.load(std::memory_order_acquire);
+		auto* buffer = m_buffer.load(std::memory_order_relaxed);
+		if(bottom - top > (ssize_t) buffer->capacity - 1)
+			buffer = grow(buffer, top, bottom);
+		buffer->put(bottom, task);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	Task* pop() {
+		ssize_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+		auto* buffer = m_buffer.load(std::memory_order_relaxed);
+		m_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		ssize_t top = m_top.load(std::memory_order_relaxed);
+
+		if(top > bottom) {
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		auto* task = buffer->get(bottom);
+		if(top == bottom) {
+			// This is the last task, so we have to race any thieves for it
+			if(!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				task = nullptr;
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return task;
+	}
+
+	Task* steal() {
+		ssize_t top = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		ssize_t bottom = m_bottom.load(std::memory_order_acquire);
+		if(top >= bottom)
+			return nullptr;
+
+		auto* task = m_buffer.load(std::memory_order_acquire)->get(top);
+		if(!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return task;
+	}
+
+	bool empty() const {
+		return m_top.load(std::memory_order_relaxed) >= m_bottom.load(std::memory_order_relaxed);
+	}
+
+	void start() {
+		m_tid = thread_create(entry, this);
+	}
+
+	void join() {
+		if(m_tid > 0)
+			thread_join(m_tid, nullptr);
+	}
+
+	[[nodiscard]] ThreadPool& pool() const { return m_pool; }
+	[[nodiscard]] int index() const { return m_index; }
+
+	/// The worker that's running on the current thread, if any.
+	static thread_local Worker* current;
+
+private:
+	struct Buffer {
+		explicit Buffer(size_t capacity): capacity(capacity), items(new std::atomic<Task*>[capacity]) {}
+		~Buffer() { delete[] items; }
+
+		Task* get(ssize_t index) { return items[index & (capacity - 1)].load(std::memory_order_relaxed); }
+		void put(ssize_t index, Task* task) { items[index & (capacity - 1)].store(task, std::memory_order_relaxed); }
+
+		size_t capacity; ///< Always a power of two, so indices can just be masked.
+		std::atomic<Task*>* items;
+	};
+
+	Buffer* grow(Buffer* old_buffer, ssize_t top, ssize_t bottom) {
+		auto* buffer = new Buffer(old_buffer->capacity * 2);
+		for(ssize_t i = top; i < bottom; i++)
+			buffer->put(i, old_buffer->get(i));
+		m_buffers.push_back(buffer);
+		m_buffer.store(buffer, std::memory_order_release);
+		return buffer;
+	}
+
+	static void* entry(void* arg) {
+		auto* self = (Worker*) arg;
+		current = self;
+		self->m_pool.run_worker(self);
+		return nullptr;
+	}
+
+	ThreadPool& m_pool;
+	int m_index;
+	tid_t m_tid = -1;
+	std::atomic<ssize_t> m_top = {0};
+	std::atomic<ssize_t> m_bottom = {0};
+	std::atomic<Buffer*> m_buffer;
+	std::vector<Buffer*> m_buffers; ///< Every buffer the deque has used, so they can be freed when the worker is.
+};
+
+thread_local ThreadPool::Worker* ThreadPool::Worker::current = nullptr;
+
+namespace {
+	/// The state of a call to run_chunks(), which is shared with the tasks helping out with it.
+	struct ChunkJob {
+		const std::function<void(size_t)>* func;
+		size_t num_chunks;
+		std::atomic<size_t> next_chunk = {0};
+		std::atomic<int> num_done = {0};
+
+		/// Works on chunks until they've all been claimed.
+		void work() {
+			size_t chunk;
+			while((chunk = next_chunk.fetch_add(1)) < num_chunks) {
+				(*func)(chunk);
+				if(num_done.fetch_add(1) + 1 == (int) num_chunks)
+					futex((int*) &num_done, FUTEX_WAKE, INT_MAX, nullptr);
+			}
+		}
+	};
+}
+
+ThreadPool::ThreadPool(int num_workers) {
+	if(num_workers <= 0)
+		num_workers = num_processors();
+	for(int i = 0; i < num_workers; i++)
+		m_workers.push_back(new Worker(*this, i));
+	for(auto* worker : m_workers)
+		worker->start();
+}
+
+ThreadPool::~ThreadPool() {
+	m_stopping = true;
+	m_epoch++;
+	futex((int*) &m_epoch, FUTEX_WAKE, INT_MAX, nullptr);
+	for(auto* worker : m_workers) {
+		worker->join();
+		while(auto* task = worker->pop())
+			delete task;
+		delete worker;
+	}
+	for(auto* task : m_shared_queue)
+		delete task;
+}
+
+ThreadPool& ThreadPool::global() {
+	static auto* pool = new ThreadPool();
+	return *pool;
+}
+
+int ThreadPool::num_processors() {
+	cpu_set_t set;
+	if(sched_getaffinity(0, sizeof(set), &set) < 0 || !set.mask)
+		return 1;
+	return __builtin_popcount(set.mask);
+}
+
+void ThreadPool::submit(Task task) {
+	queue(new Task(std::move(task)));
+}
+
+void ThreadPool::run_chunks(size_t num_chunks, const std::function<void(size_t)>& func) {
+	if(!num_chunks)
+		return;
+
+	// Helpers that start after every chunk is claimed still look at the job, so it has to outlive this call
+	auto job = std::make_shared<ChunkJob>();
+	job->func = &func;
+	job->num_chunks = num_chunks;
+	size_t num_helpers = std::min((size_t) num_workers(), num_chunks - 1);
+	for(size_t i = 0; i < num_helpers; i++)
+		submit([job] { job->work(); });
+
+	job->work();
+	int done;
+	while((done = job->num_done.load()) != (int) num_chunks)
+		futex((int*) &job->num_done, FUTEX_WAIT, done, nullptr);
+}
+
+void ThreadPool::queue(Task* task) {
+	auto* worker = Worker::current;
+	if(worker && &worker->pool() == this) {
+		worker->push(task);
+	} else {
+		LOCK(m_shared_lock);
+		m_shared_queue.push_back(task);
+		m_shared_size++;
+	}
+
+	m_epoch++;
+	if(m_num_sleeping.load())
+		futex((int*) &m_epoch, FUTEX_WAKE, 1, nullptr);
+}
+
+ThreadPool::Task* ThreadPool::find_task(Worker* self) {
+	if(auto* task = self->pop())
+		return task;
+
+	if(m_shared_size.load()) {
+		LOCK(m_shared_lock);
+		if(!m_shared_queue.empty()) {
+			auto* task = m_shared_queue.front();
+			m_shared_queue.pop_front();
+			m_shared_size--;
+			return task;
+		}
+	}
+
+	// Try stealing from the other workers, starting from the next one over so thieves don't all pile onto the same one
+	size_t start = self->index() + 1;
+	for(size_t i = 0; i < m_workers.size(); i++) {
+		auto* victim = m_workers[(start + i) % m_workers.size()];
+		if(victim == self)
+			continue;
+		if(auto* task = victim->steal())
+			return task;
+	}
+
+	return nullptr;
+}
+
+bool ThreadPool::has_work() {
+	if(m_shared_size.load())
+		return true;
+	for(auto* worker : m_workers) {
+		if(!worker->empty())
+			return true;
+	}
+	return false;
+}
+
+void ThreadPool::run_worker(Worker* self) {
+	while(!m_stopping.load()) {
+		if(auto* task = find_task(self)) {
+			(*task)();
+			delete task;
+			continue;
+		}
+
+		// Nothing to do, so go to sleep until something is queued. If something is queued after we read the epoch,
+		// the futex won't wait, and if it's queued after we wait, the queuer sees that we're sleeping and wakes us.
+		int epoch = m_epoch.load();
+		m_num_sleeping++;
+		if(!has_work() && !m_stopping.load())
+			futex((int*) &m_epoch, FUTEX_WAIT, epoch, nullptr);
+		m_num_sleeping--;
+	}
+}
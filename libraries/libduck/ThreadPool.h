@@ -0,0 +1,126 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "Mutex.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace Duck {
+	/**
+	 * A pool of worker threads that run tasks in the background. Each worker keeps its own Chase-Lev deque of tasks:
+	 * tasks submitted from a worker go on the bottom of its deque, where it pops them off without any locking, and
+	 * workers that run out of work steal from the top of the others' deques. Tasks submitted from any other thread go
+	 * into a shared queue that idle workers take from. Workers with nothing to do sleep on a futex.
+	 */
+	class ThreadPool {
+	public:
+		using Task = std::function<void()>;
+
+		/**
+		 * Starts a thread pool.
+		 * @param num_workers The number of worker threads to start, or 0 for one per processor we can run on.
+		 */
+		explicit ThreadPool(int num_workers = 0);
+		ThreadPool(const ThreadPool& other) = delete;
+		~ThreadPool();
+
+		/// The pool shared by the whole process, which is started the first time it's used.
+		static ThreadPool& global();
+		/// The number of processors the calling thread can run on.
+		static int num_processors();
+
+		/// Queues a task to run on one of the workers.
+		void submit(Task task);
+
+		/**
+		 * Calls a function once for each chunk of some work, spread out over the workers. The calling thread works on
+		 * chunks too, so this can safely be used from within a task. Returns once every chunk is done.
+		 * @param num_chunks The number of chunks.
+		 * @param func The function to call with the index of each chunk.
+		 */
+		void run_chunks(size_t num_chunks, const std::function<void(size_t)>& func);
+
+		[[nodiscard]] int num_workers() const { return (int) m_workers.size(); }
+
+	private:
+		class Worker;
+		friend class Worker;
+
+		void queue(Task* task);
+		void run_worker(Worker* self);
+		Task* find_task(Worker* self);
+		bool has_work();
+
+		std::vector<Worker*> m_workers;
+		Mutex m_shared_lock;
+		std::deque<Task*> m_shared_queue; ///< Tasks submitted from outside of the pool's workers.
+		std::atomic<size_t> m_shared_size = {0};
+		std::atomic<int> m_epoch = {0}; ///< Bumped whenever work is queued, so sleeping workers know to wake up.
+		std::atomic<int> m_num_sleeping = {0};
+		std::atomic<bool> m_stopping = {false};
+	};
+
+	/**
+	 * Calls a function for every index in a range, spread out over the global thread pool.
+	 * @param begin The first index.
+	 * @param end The index after the last.
+	 * @param func The function to call with each index.
+	 * @param grain The number of indices each task handles at a time.
+	 */
+	template<typename F>
+	void parallel_for(size_t begin, size_t end, F func, size_t grain = 1) {
+		if(end <= begin)
+			return;
+		grain = std::max(grain, (size_t) 1);
+		size_t num_chunks = (end - begin + grain - 1) / grain;
+		if(num_chunks == 1) {
+			for(size_t i = begin; i < end; i++)
+				func(i);
+			return;
+		}
+		ThreadPool::global().run_chunks(num_chunks, [&](size_t chunk) {
+			size_t chunk_end = std::min(begin + (chunk + 1) * grain, end);
+			for(size_t i = begin + chunk * grain; i < chunk_end; i++)
+				func(i);
+		});
+	}
+
+	/**
+	 * Sorts a range using the global thread pool. The range is split into a chunk for each processor which are sorted
+	 * in parallel, and then merged together in parallel passes.
+	 * @param begin The start of the range.
+	 * @param end The end of the range.
+	 * @param comp The comparison to sort by.
+	 * @param min_chunk The smallest number of elements worth sorting on their own. Smaller ranges are just sorted here.
+	 */
+	template<typename It, typename Compare = std::less<>>
+	void parallel_sort(It begin, It end, Compare comp = Compare(), size_t min_chunk = 4096) {
+		size_t size = end - begin;
+		size_t num_chunks = std::min((size_t) ThreadPool::global().num_workers() + 1, size / std::max(min_chunk, (size_t) 1));
+		if(num_chunks <= 1) {
+			std::sort(begin, end, comp);
+			return;
+		}
+
+		auto chunk_start = [&](size_t chunk) { return begin + std::min(chunk * ((size + num_chunks - 1) / num_chunks), size); };
+		ThreadPool::global().run_chunks(num_chunks, [&](size_t chunk) {
+			std::sort(chunk_start(chunk), chunk_start(chunk + 1), comp);
+		});
+
+		// Merge neighbouring runs of sorted chunks until there's only one
+		for(size_t width = 1; width < num_chunks; width *= 2) {
+			size_t num_merges = (num_chunks + width * 2 - 1) / (width * 2);
+			ThreadPool::global().run_chunks(num_merges, [&](size_t merge) {
+				size_t first = merge * width * 2;
+				if(first + width >= num_chunks)
+					return;
+				std::inplace_merge(chunk_start(first), chunk_start(first + width), chunk_start(std::min(first + width * 2, num_chunks)), comp);
+			});
+		}
+	}
+}
@@ -31,6 +31,18 @@ Time Time::now() {
 	return Time {tv};
 }
 
+Time Time::monotonic() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return {ts.tv_sec, ts.tv_nsec / 1000};
+}
+
+uint64_t Time::monotonic_nanos() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 
 Time Time::operator+(const Time& other) const {
 	Time ret(*this);
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "sys/time.h"
+#include <time.h>
 
 namespace Duck {
 	class Time {
@@ -29,6 +30,10 @@ namespace Duck {
 		explicit Time(timeval val);
 
 		[[nodiscard]] static Time now();
+		/// The time since boot, which unlike now() never jumps around. Use this for measuring how long things take.
+		[[nodiscard]] static Time monotonic();
+		/// The time since boot in nanoseconds, for when microseconds aren't precise enough.
+		[[nodiscard]] static uint64_t monotonic_nanos();
 		[[nodiscard]] static Time millis(long millis) { return {millis / 1000, (millis % 1000) * 1000}; }
 
 		[[nodiscard]] timeval to_timeval() const { return {m_sec, m_usec}; }
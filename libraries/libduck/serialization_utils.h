@@ -20,6 +20,7 @@
 #pragma once
 
 #include <vector>
+#include <string_view>
 #include "Log.h"
 #include "ByteBuffer.h"
 
@@ -60,6 +61,7 @@ namespace Duck::Serialization {
 				std::is_pod<T>() ||
 				is_vector<T>() ||
 				std::is_same<T, std::string>() ||
+				std::is_same<T, std::string_view>() ||
 				std::is_same<T, Duck::ByteBuffer>() ||
 				std::is_base_of<Duck::Serializable, T>() ||
 				is_serializable_struct<T>()
@@ -68,6 +70,26 @@ namespace Duck::Serialization {
 	template<typename T>
 	struct is_serializable_return_type : std::integral_constant<bool, is_serializable_type<T>() || std::is_void<T>()> {};
 
+	/**
+	 * Whether a type is serialized by copying its bytes, so it always takes up the same amount of space.
+	 */
+	template<typename T>
+	struct is_fixed_size : std::integral_constant<bool,
+				std::is_trivially_copyable<T>() &&
+				!std::is_same<T, std::string_view>() &&
+				!std::is_base_of<Duck::Serializable, T>() &&
+				!is_serializable_struct<T>()
+			> {};
+
+	/**
+	 * The size (in bytes) of the buffer needed to serialize values of the given types, if they're all fixed-size.
+	 */
+	template<typename... ParamTs>
+	constexpr size_t fixed_buffer_size() {
+		static_assert((is_fixed_size<ParamTs>() && ...), "Types must be fixed-size!");
+		return (sizeof(ParamTs) + ... + 0);
+	}
+
 	constexpr size_t buffer_size() {
 		return 0; //Base case
 	}
@@ -77,16 +99,25 @@ namespace Duck::Serialization {
 	 */
 	template<typename ParamT, typename... ParamTs>
 	constexpr size_t buffer_size(const ParamT& first, const ParamTs&... rest) {
-		if constexpr(is_vector<ParamT>())
-			return sizeof(size_t) + sizeof(typename ParamT::value_type) * first.size() + buffer_size(rest...);
-		else if constexpr(std::is_same<ParamT, std::string>())
+		if constexpr(is_fixed_size<ParamT>() && (is_fixed_size<ParamTs>() && ...)) {
+			return fixed_buffer_size<ParamT, ParamTs...>();
+		} else if constexpr(is_vector<ParamT>()) {
+			typedef typename ParamT::value_type VecT;
+			if constexpr(is_fixed_size<VecT>())
+				return sizeof(size_t) + sizeof(VecT) * first.size() + buffer_size(rest...);
+			size_t size = sizeof(size_t);
+			for(const VecT& item : first)
+				size += buffer_size(item);
+			return size + buffer_size(rest...);
+		} else if constexpr(std::is_same<ParamT, std::string>() || std::is_same<ParamT, std::string_view>()) {
 			return first.size() + 1 + buffer_size(rest...);
-		else if constexpr(std::is_same<ParamT, Duck::ByteBuffer>())
+		} else if constexpr(std::is_same<ParamT, Duck::ByteBuffer>()) {
 			return sizeof(size_t) + first.size() + buffer_size(rest...);
-		else if constexpr(std::is_base_of<Duck::Serializable, ParamT>())
+		} else if constexpr(std::is_base_of<Duck::Serializable, ParamT>() || is_serializable_struct<ParamT>()) {
 			return first.serialized_size() + buffer_size(rest...);
-		else
+		} else {
 			return sizeof(ParamT) + buffer_size(rest...);
+		}
 	}
 
 	constexpr void serialize(uint8_t*& buf) {
@@ -104,21 +135,27 @@ namespace Duck::Serialization {
 			//If it's a vector, push a size_t of the size and then the data
 			*((size_t*)buf) = first.size();
 			buf += sizeof(size_t);
-			for(const VecT& item : first)
-				serialize(buf, item);
-		} else if constexpr(std::is_same<ParamT, std::string>()) {
+			if constexpr(is_fixed_size<VecT>()) {
+				memcpy(buf, first.data(), sizeof(VecT) * first.size());
+				buf += sizeof(VecT) * first.size();
+			} else {
+				for(const VecT& item : first)
+					serialize(buf, item);
+			}
+		} else if constexpr(std::is_same<ParamT, std::string>() || std::is_same<ParamT, std::string_view>()) {
 			//If it's a string, we can just push the bytes of the string
-			strcpy((char*) buf, first.data());
+			memcpy(buf, first.data(), first.size());
+			buf[first.size()] = '\0';
 			buf += first.size() + 1;
 		} else if constexpr(std::is_same<ParamT, Duck::ByteBuffer>()) {
 			*((size_t*) buf) = first.size();
 			buf += sizeof(size_t);
 			memcpy((char*) buf, first.template data<void>(), first.size());
 			buf += first.size();
-		} else if constexpr(std::is_base_of<Duck::Serializable, ParamT>()) {
+		} else if constexpr(std::is_base_of<Duck::Serializable, ParamT>() || is_serializable_struct<ParamT>()) {
 			first.serialize(buf);
 		} else {
-			*((ParamT*) buf) = first;
+			memcpy(buf, &first, sizeof(ParamT));
 			buf += sizeof(ParamT);
 		}
 
@@ -139,21 +176,30 @@ namespace Duck::Serialization {
 			//If it's a vector, pop a size_t of the size and then the data
 			first.resize(*((size_t*)buf)); //TODO Sanity check?
 			buf += sizeof(size_t);
-			for(VecT& item : first)
-				deserialize(buf, item);
+			if constexpr(is_fixed_size<VecT>()) {
+				memcpy(first.data(), buf, sizeof(VecT) * first.size());
+				buf += sizeof(VecT) * first.size();
+			} else {
+				for(VecT& item : first)
+					deserialize(buf, item);
+			}
 		} else if constexpr(std::is_same<ParamT, std::string>()) {
 			//If it's a string, just copy from the buffer until we hit a null terminator
 			first = std::string((char*)buf);
 			buf += first.size() + 1;
+		} else if constexpr(std::is_same<ParamT, std::string_view>()) {
+			//A string_view just points into the buffer instead of copying it, so it's only good for as long as the buffer is
+			first = std::string_view((const char*) buf);
+			buf += first.size() + 1;
 		} else if constexpr(std::is_same<ParamT, Duck::ByteBuffer>()) {
 			size_t size = *((size_t*) buf); //TODO Sanity check?
 			buf += sizeof(size_t);
 			first = Duck::ByteBuffer::copy(buf, size);
-		} else if constexpr(std::is_base_of<Duck::Serializable, ParamT>()) {
+		} else if constexpr(std::is_base_of<Duck::Serializable, ParamT>() || is_serializable_struct<ParamT>()) {
 			first.deserialize(buf);
 		} else {
-			//If it's not a vector, just push the data
-			first = *((ParamT*) buf);
+			//If it's not a vector, just copy the data
+			memcpy(&first, buf, sizeof(ParamT));
 			buf += sizeof(ParamT);
 		}
 
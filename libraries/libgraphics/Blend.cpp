@@ -0,0 +1,481 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+/*
+ * Blending works on each channel as (src * (alpha + 1) + dest * (256 - alpha)) >> 8, where alpha is the source's alpha.
+ * That never goes past 65535, so each channel fits in a 16-bit lane and SSE2 can blend four pixels at a time (or AVX2,
+ * eight).
+ * An alpha of 0 gives back dest exactly and an alpha of 255 gives back src exactly, which is what the fast paths rely on.
+ *
+ * With premultiplied alpha, src has already been multiplied by its alpha, so blending is just src + ((dest * (256 - alpha)) >> 8).
+ */
+
+#include "Blend.h"
+#include "CPU.h"
+#include <immintrin.h>
+#include <cstring>
+#include <cstdint>
+
+using namespace Gfx;
+
+static inline void blend_pixel(Color& dest, Color src) {
+	if(src.a == 255)
+		dest = src;
+	else if(src.a)
+		dest = dest.blended(src);
+}
+
+//A premultiplied pixel with an alpha of 0 can still add light, so only ones that are entirely zero can be skipped
+static inline void blend_pixel_premultiplied(Color& dest, Color src) {
+	if(src.a == 255)
+		dest = src;
+	else if(src.value)
+		dest = dest.blended_premultiplied(src);
+}
+
+/** Blends two pixels that have been unpacked to 16 bits per channel. **/
+SSE2 static inline __m128i blend2(__m128i dest, __m128i src) {
+	__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m128i src_factor = _mm_add_epi16(alpha, _mm_set1_epi16(1));
+	__m128i dest_factor = _mm_sub_epi16(_mm_set1_epi16(256), alpha);
+	__m128i sum = _mm_add_epi16(_mm_mullo_epi16(src, src_factor), _mm_mullo_epi16(dest, dest_factor));
+	return _mm_srli_epi16(sum, 8);
+}
+
+SSE2 static void blend_row_sse2(Color* dest, const Color* src, size_t count) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha_mask = _mm_set1_epi32((int) 0xFF000000);
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i*) (src + i));
+		__m128i alphas = _mm_and_si128(s, alpha_mask);
+		if(_mm_movemask_epi8(_mm_cmpeq_epi32(alphas, zero)) == 0xFFFF)
+			continue;
+		if(_mm_movemask_epi8(_mm_cmpeq_epi32(alphas, alpha_mask)) == 0xFFFF) {
+			_mm_storeu_si128((__m128i*) (dest + i), s);
+			continue;
+		}
+		__m128i d = _mm_loadu_si128((const __m128i*) (dest + i));
+		__m128i low = blend2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero));
+		__m128i high = blend2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero));
+		_mm_storeu_si128((__m128i*) (dest + i), _mm_packus_epi16(low, high));
+	}
+	for(; i < count; i++)
+		blend_pixel(dest[i], src[i]);
+}
+
+SSE2 static inline __m128i blend2_premultiplied(__m128i dest, __m128i src) {
+	__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m128i dest_factor = _mm_sub_epi16(_mm_set1_epi16(256), alpha);
+	return _mm_add_epi16(src, _mm_srli_epi16(_mm_mullo_epi16(dest, dest_factor), 8));
+}
+
+SSE2 static void blend_row_premultiplied_sse2(Color* dest, const Color* src, size_t count) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha_mask = _mm_set1_epi32((int) 0xFF000000);
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i*) (src + i));
+		if(_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xFFFF)
+			continue;
+		if(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alpha_mask), alpha_mask)) == 0xFFFF) {
+			_mm_storeu_si128((__m128i*) (dest + i), s);
+			continue;
+		}
+		__m128i d = _mm_loadu_si128((const __m128i*) (dest + i));
+		__m128i low = blend2_premultiplied(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero));
+		__m128i high = blend2_premultiplied(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero));
+		_mm_storeu_si128((__m128i*) (dest + i), _mm_packus_epi16(low, high));
+	}
+	for(; i < count; i++)
+		blend_pixel_premultiplied(dest[i], src[i]);
+}
+
+SSE2 static inline __m128i premultiply2(__m128i src) {
+	__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	return _mm_srli_epi16(_mm_mullo_epi16(src, _mm_add_epi16(alpha, _mm_set1_epi16(1))), 8);
+}
+
+SSE2 static void premultiply_row_sse2(Color* dest, const Color* src, size_t count) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha_mask = _mm_set1_epi32((int) 0xFF000000);
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i*) (src + i));
+		__m128i multiplied = _mm_packus_epi16(premultiply2(_mm_unpacklo_epi8(s, zero)), premultiply2(_mm_unpackhi_epi8(s, zero)));
+		//The alpha channel itself stays the same
+		__m128i result = _mm_or_si128(_mm_andnot_si128(alpha_mask, multiplied), _mm_and_si128(s, alpha_mask));
+		_mm_storeu_si128((__m128i*) (dest + i), result);
+	}
+	for(; i < count; i++)
+		dest[i] = src[i].premultiplied();
+}
+
+SSE2 static void blend_color_sse2(Color* dest, Color color, size_t count) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i src = _mm_unpacklo_epi8(_mm_set1_epi32((int) color.value), zero);
+	__m128i premultiplied = _mm_mullo_epi16(src, _mm_set1_epi16((short) (color.a + 1)));
+	__m128i dest_factor = _mm_set1_epi16((short) (256 - color.a));
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128i d = _mm_loadu_si128((const __m128i*) (dest + i));
+		__m128i low = _mm_add_epi16(premultiplied, _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), dest_factor));
+		__m128i high = _mm_add_epi16(premultiplied, _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), dest_factor));
+		_mm_storeu_si128((__m128i*) (dest + i), _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8)));
+	}
+	for(; i < count; i++)
+		dest[i] = dest[i].blended(color);
+}
+
+SSE2 static void fill_row_sse2(Color* dest, Color color, size_t count, bool non_temporal) {
+	const __m128i value = _mm_set1_epi32((int) color.value);
+	size_t i = 0;
+	if(non_temporal) {
+		//Streaming stores have to be aligned, so the pixels before the first aligned one are stored normally
+		for(; i < count && ((uintptr_t) (dest + i) & 15); i++)
+			dest[i] = color;
+		for(; i + 4 <= count; i += 4)
+			_mm_stream_si128((__m128i*) (dest + i), value);
+		_mm_sfence();
+	} else {
+		for(; i + 4 <= count; i += 4)
+			_mm_storeu_si128((__m128i*) (dest + i), value);
+	}
+	for(; i < count; i++)
+		dest[i] = color;
+}
+
+/** Multiplies two pixels unpacked to 16 bits per channel by a color, which is unpacked the same way. **/
+SSE2 static inline __m128i multiply2(__m128i pixels, __m128i color) {
+	return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(pixels, color), _mm_set1_epi16(255)), 8);
+}
+
+SSE2 static void multiply_row_sse2(Color* dest, Color color, size_t count) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i color16 = _mm_unpacklo_epi8(_mm_set1_epi32((int) color.value), zero);
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128i d = _mm_loadu_si128((const __m128i*) (dest + i));
+		__m128i low = multiply2(_mm_unpacklo_epi8(d, zero), color16);
+		__m128i high = multiply2(_mm_unpackhi_epi8(d, zero), color16);
+		_mm_storeu_si128((__m128i*) (dest + i), _mm_packus_epi16(low, high));
+	}
+	for(; i < count; i++)
+		dest[i] *= color;
+}
+
+static inline void blend_pixel_masked(Color& dest, Color color, uint8_t mask) {
+	Color masked = {color.r, color.g, color.b, (uint8_t) ((mask * (color.a + 1)) >> 8)};
+	if(masked.a == 255)
+		dest = masked;
+	else if(masked.a)
+		dest = dest.blended_premultiplied(masked.premultiplied());
+}
+
+/** Blends a color onto two pixels unpacked to 16 bits per channel, with each pixel's alpha in all four of its lanes. **/
+SSE2 static inline __m128i blend2_masked(__m128i dest, __m128i color, __m128i alpha) {
+	__m128i src = _mm_srli_epi16(_mm_mullo_epi16(color, _mm_add_epi16(alpha, _mm_set1_epi16(1))), 8);
+	__m128i dest_factor = _mm_sub_epi16(_mm_set1_epi16(256), alpha);
+	return _mm_add_epi16(src, _mm_srli_epi16(_mm_mullo_epi16(dest, dest_factor), 8));
+}
+
+SSE2 static void blend_row_masked_sse2(Color* dest, Color color, const uint8_t* mask, size_t count) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha_factor = _mm_set1_epi16((short) (color.a + 1));
+	//The alpha lanes are 255 so that premultiplying them gives back the alpha they're multiplied by
+	const __m128i color16 = _mm_unpacklo_epi8(_mm_set1_epi32((int) (color.value | 0xFF000000)), zero);
+	const __m128i opaque = _mm_set1_epi32((int) color.value);
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		uint32_t mask_bytes;
+		memcpy(&mask_bytes, mask + i, sizeof(mask_bytes));
+		if(!mask_bytes)
+			continue;
+		if(mask_bytes == 0xFFFFFFFF && color.a == 255) {
+			_mm_storeu_si128((__m128i*) (dest + i), opaque);
+			continue;
+		}
+
+		//Scale the mask by the color's alpha, and then spread each pixel's alpha over all four of its channels
+		__m128i alphas = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int) mask_bytes), zero), alpha_factor), 8);
+		alphas = _mm_unpacklo_epi16(alphas, alphas);
+		__m128i d = _mm_loadu_si128((const __m128i*) (dest + i));
+		__m128i low = blend2_masked(_mm_unpacklo_epi8(d, zero), color16, _mm_unpacklo_epi32(alphas, alphas));
+		__m128i high = blend2_masked(_mm_unpackhi_epi8(d, zero), color16, _mm_unpackhi_epi32(alphas, alphas));
+		_mm_storeu_si128((__m128i*) (dest + i), _mm_packus_epi16(low, high));
+	}
+	for(; i < count; i++)
+		blend_pixel_masked(dest[i], color, mask[i]);
+}
+
+SSE2 static void lerp_rows_sse2(Color* dest, const Color* a, const Color* b, unsigned int weight, size_t count) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i a_factor = _mm_set1_epi16((short) (256 - weight));
+	const __m128i b_factor = _mm_set1_epi16((short) weight);
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128i va = _mm_loadu_si128((const __m128i*) (a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i*) (b + i));
+		__m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), a_factor), _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), b_factor));
+		__m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), a_factor), _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), b_factor));
+		_mm_storeu_si128((__m128i*) (dest + i), _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8)));
+	}
+	for(; i < count; i++)
+		dest[i] = a[i].lerped(b[i], weight);
+}
+
+static inline Color halve_pixel(const Color* a, const Color* b) {
+	auto channel = [](unsigned int a0, unsigned int a1, unsigned int b0, unsigned int b1) {
+		return (uint8_t) ((a0 + a1 + b0 + b1 + 2) >> 2);
+	};
+	return {
+		channel(a[0].r, a[1].r, b[0].r, b[1].r),
+		channel(a[0].g, a[1].g, b[0].g, b[1].g),
+		channel(a[0].b, a[1].b, b[0].b, b[1].b),
+		channel(a[0].a, a[1].a, b[0].a, b[1].a)
+	};
+}
+
+/** Averages each 2x2 block in four pixels from each of two rows, giving two pixels unpacked to 16 bits per channel. **/
+SSE2 static inline __m128i halve2(__m128i a, __m128i b) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+	__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+	__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+	return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+SSE2 static void halve_rows_sse2(Color* dest, const Color* a, const Color* b, size_t count) {
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128i low = halve2(_mm_loadu_si128((const __m128i*) (a + i * 2)), _mm_loadu_si128((const __m128i*) (b + i * 2)));
+		__m128i high = halve2(_mm_loadu_si128((const __m128i*) (a + i * 2 + 4)), _mm_loadu_si128((const __m128i*) (b + i * 2 + 4)));
+		_mm_storeu_si128((__m128i*) (dest + i), _mm_packus_epi16(low, high));
+	}
+	for(; i < count; i++)
+		dest[i] = halve_pixel(a + i * 2, b + i * 2);
+}
+
+/*
+ * The AVX2 versions are the same as the SSE2 ones, since unpacking and packing both work within each 128-bit half and
+ * so put the pixels back in the order they started in.
+ */
+
+AVX2 static inline __m256i blend2_avx2(__m256i dest, __m256i src) {
+	__m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m256i src_factor = _mm256_add_epi16(alpha, _mm256_set1_epi16(1));
+	__m256i dest_factor = _mm256_sub_epi16(_mm256_set1_epi16(256), alpha);
+	__m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(src, src_factor), _mm256_mullo_epi16(dest, dest_factor));
+	return _mm256_srli_epi16(sum, 8);
+}
+
+AVX2 static void blend_row_avx2(Color* dest, const Color* src, size_t count) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alpha_mask = _mm256_set1_epi32((int) 0xFF000000);
+	size_t i = 0;
+	for(; i + 8 <= count; i += 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i*) (src + i));
+		__m256i alphas = _mm256_and_si256(s, alpha_mask);
+		if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(alphas, zero)) == -1)
+			continue;
+		if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(alphas, alpha_mask)) == -1) {
+			_mm256_storeu_si256((__m256i*) (dest + i), s);
+			continue;
+		}
+		__m256i d = _mm256_loadu_si256((const __m256i*) (dest + i));
+		__m256i low = blend2_avx2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero));
+		__m256i high = blend2_avx2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero));
+		_mm256_storeu_si256((__m256i*) (dest + i), _mm256_packus_epi16(low, high));
+	}
+	_mm256_zeroupper();
+	blend_row_sse2(dest + i, src + i, count - i);
+}
+
+AVX2 static inline __m256i blend2_premultiplied_avx2(__m256i dest, __m256i src) {
+	__m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m256i dest_factor = _mm256_sub_epi16(_mm256_set1_epi16(256), alpha);
+	return _mm256_add_epi16(src, _mm256_srli_epi16(_mm256_mullo_epi16(dest, dest_factor), 8));
+}
+
+AVX2 static void blend_row_premultiplied_avx2(Color* dest, const Color* src, size_t count) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alpha_mask = _mm256_set1_epi32((int) 0xFF000000);
+	size_t i = 0;
+	for(; i + 8 <= count; i += 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i*) (src + i));
+		if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(s, zero)) == -1)
+			continue;
+		if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(s, alpha_mask), alpha_mask)) == -1) {
+			_mm256_storeu_si256((__m256i*) (dest + i), s);
+			continue;
+		}
+		__m256i d = _mm256_loadu_si256((const __m256i*) (dest + i));
+		__m256i low = blend2_premultiplied_avx2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero));
+		__m256i high = blend2_premultiplied_avx2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero));
+		_mm256_storeu_si256((__m256i*) (dest + i), _mm256_packus_epi16(low, high));
+	}
+	_mm256_zeroupper();
+	blend_row_premultiplied_sse2(dest + i, src + i, count - i);
+}
+
+AVX2 static void blend_color_avx2(Color* dest, Color color, size_t count) {
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i src = _mm256_unpacklo_epi8(_mm256_set1_epi32((int) color.value), zero);
+	__m256i premultiplied = _mm256_mullo_epi16(src, _mm256_set1_epi16((short) (color.a + 1)));
+	__m256i dest_factor = _mm256_set1_epi16((short) (256 - color.a));
+	size_t i = 0;
+	for(; i + 8 <= count; i += 8) {
+		__m256i d = _mm256_loadu_si256((const __m256i*) (dest + i));
+		__m256i low = _mm256_add_epi16(premultiplied, _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), dest_factor));
+		__m256i high = _mm256_add_epi16(premultiplied, _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), dest_factor));
+		_mm256_storeu_si256((__m256i*) (dest + i), _mm256_packus_epi16(_mm256_srli_epi16(low, 8), _mm256_srli_epi16(high, 8)));
+	}
+	_mm256_zeroupper();
+	blend_color_sse2(dest + i, color, count - i);
+}
+
+AVX2 static void fill_row_avx2(Color* dest, Color color, size_t count, bool non_temporal) {
+	const __m256i value = _mm256_set1_epi32((int) color.value);
+	size_t i = 0;
+	if(non_temporal) {
+		for(; i < count && ((uintptr_t) (dest + i) & 31); i++)
+			dest[i] = color;
+		for(; i + 8 <= count; i += 8)
+			_mm256_stream_si256((__m256i*) (dest + i), value);
+	} else {
+		for(; i + 8 <= count; i += 8)
+			_mm256_storeu_si256((__m256i*) (dest + i), value);
+	}
+	_mm256_zeroupper();
+	fill_row_sse2(dest + i, color, count - i, non_temporal);
+}
+
+AVX2 static void multiply_row_avx2(Color* dest, Color color, size_t count) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i color16 = _mm256_unpacklo_epi8(_mm256_set1_epi32((int) color.value), zero);
+	const __m256i round = _mm256_set1_epi16(255);
+	size_t i = 0;
+	for(; i + 8 <= count; i += 8) {
+		__m256i d = _mm256_loadu_si256((const __m256i*) (dest + i));
+		__m256i low = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), color16), round), 8);
+		__m256i high = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), color16), round), 8);
+		_mm256_storeu_si256((__m256i*) (dest + i), _mm256_packus_epi16(low, high));
+	}
+	_mm256_zeroupper();
+	multiply_row_sse2(dest + i, color, count - i);
+}
+
+void Gfx::blend_row(Color* dest, const Color* src, size_t count) {
+	int level = cpu_level();
+	if(level == CPU_AVX2) {
+		blend_row_avx2(dest, src, count);
+		return;
+	} else if(level == CPU_SSE2) {
+		blend_row_sse2(dest, src, count);
+		return;
+	}
+	for(size_t i = 0; i < count; i++)
+		blend_pixel(dest[i], src[i]);
+}
+
+void Gfx::blend_row(Color* dest, Color color, size_t count) {
+	if(!color.a)
+		return;
+	if(color.a == 255) {
+		for(size_t i = 0; i < count; i++)
+			dest[i] = color;
+		return;
+	}
+	int level = cpu_level();
+	if(level == CPU_AVX2) {
+		blend_color_avx2(dest, color, count);
+		return;
+	} else if(level == CPU_SSE2) {
+		blend_color_sse2(dest, color, count);
+		return;
+	}
+	for(size_t i = 0; i < count; i++)
+		dest[i] = dest[i].blended(color);
+}
+
+void Gfx::blend_row_masked(Color* dest, Color color, const uint8_t* mask, size_t count) {
+	if(!color.a)
+		return;
+	if(cpu_level() >= CPU_SSE2) {
+		blend_row_masked_sse2(dest, color, mask, count);
+		return;
+	}
+	for(size_t i = 0; i < count; i++)
+		blend_pixel_masked(dest[i], color, mask[i]);
+}
+
+void Gfx::blend_row_premultiplied(Color* dest, const Color* src, size_t count) {
+	int level = cpu_level();
+	if(level == CPU_AVX2) {
+		blend_row_premultiplied_avx2(dest, src, count);
+		return;
+	} else if(level == CPU_SSE2) {
+		blend_row_premultiplied_sse2(dest, src, count);
+		return;
+	}
+	for(size_t i = 0; i < count; i++)
+		blend_pixel_premultiplied(dest[i], src[i]);
+}
+
+void Gfx::fill_row(Color* dest, Color color, size_t count, bool non_temporal) {
+	int level = cpu_level();
+	if(level == CPU_AVX2) {
+		fill_row_avx2(dest, color, count, non_temporal);
+		return;
+	} else if(level == CPU_SSE2) {
+		fill_row_sse2(dest, color, count, non_temporal);
+		return;
+	}
+	for(size_t i = 0; i < count; i++)
+		dest[i] = color;
+}
+
+void Gfx::multiply_row(Color* dest, Color color, size_t count) {
+	int level = cpu_level();
+	if(level == CPU_AVX2) {
+		multiply_row_avx2(dest, color, count);
+		return;
+	} else if(level == CPU_SSE2) {
+		multiply_row_sse2(dest, color, count);
+		return;
+	}
+	for(size_t i = 0; i < count; i++)
+		dest[i] *= color;
+}
+
+void Gfx::premultiply_row(Color* dest, const Color* src, size_t count) {
+	if(cpu_level() >= CPU_SSE2) {
+		premultiply_row_sse2(dest, src, count);
+		return;
+	}
+	for(size_t i = 0; i < count; i++)
+		dest[i] = src[i].premultiplied();
+}
+
+void Gfx::unpremultiply_row(Color* dest, const Color* src, size_t count) {
+	for(size_t i = 0; i < count; i++)
+		dest[i] = src[i].unpremultiplied();
+}
+
+void Gfx::lerp_rows(Color* dest, const Color* a, const Color* b, unsigned int weight, size_t count) {
+	if(cpu_level() >= CPU_SSE2) {
+		lerp_rows_sse2(dest, a, b, weight, count);
+		return;
+	}
+	for(size_t i = 0; i < count; i++)
+		dest[i] = a[i].lerped(b[i], weight);
+}
+
+void Gfx::halve_rows(Color* dest, const Color* a, const Color* b, size_t count) {
+	if(cpu_level() >= CPU_SSE2) {
+		halve_rows_sse2(dest, a, b, count);
+		return;
+	}
+	for(size_t i = 0; i < count; i++)
+		dest[i] = halve_pixel(a + i * 2, b + i * 2);
+}
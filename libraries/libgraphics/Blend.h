@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <cstddef>
+#include "Color.h"
+
+namespace Gfx {
+	/**
+	 * Blends a row of pixels over another, giving exactly what Color::blended would for each one. Pixels that are fully
+	 * transparent or fully opaque are skipped or copied instead of blended, so rows of those are about as fast as memcpy.
+	 * @param dest The pixels to blend onto.
+	 * @param src The pixels to blend over them.
+	 * @param count The number of pixels in the row.
+	 */
+	void blend_row(Color* dest, const Color* src, size_t count);
+
+	/**
+	 * Blends one color over a row of pixels, the same way blend_row does.
+	 * @param dest The pixels to blend onto.
+	 * @param color The color to blend over them.
+	 * @param count The number of pixels in the row.
+	 */
+	void blend_row(Color* dest, Color color, size_t count);
+
+	/**
+	 * Blends one color over a row of pixels through an alpha mask, which is how text gets drawn. Each pixel is blended
+	 * like blend_row_premultiplied would with the color premultiplied by its alpha scaled by the mask, so opaque pixels
+	 * stay opaque and premultiplied pixels stay premultiplied.
+	 * @param dest The pixels to blend onto.
+	 * @param color The color to blend over them.
+	 * @param mask The alpha mask, with one byte for each pixel.
+	 * @param count The number of pixels in the row.
+	 */
+	void blend_row_masked(Color* dest, Color color, const uint8_t* mask, size_t count);
+
+	/**
+	 * Blends a row of pixels with premultiplied alpha over another, the same way Color::blended_premultiplied does. The
+	 * pixels being blended onto should be premultiplied too, unless they're opaque (in which case it doesn't matter).
+	 * @param dest The pixels to blend onto.
+	 * @param src The premultiplied pixels to blend over them.
+	 * @param count The number of pixels in the row.
+	 */
+	void blend_row_premultiplied(Color* dest, const Color* src, size_t count);
+
+	/**
+	 * Fills a row of pixels with one color.
+	 * @param dest The pixels to fill.
+	 * @param color The color to fill them with.
+	 * @param count The number of pixels in the row.
+	 * @param non_temporal Whether to write around the cache, for fills too big to stay in it anyway. Doing this for
+	 *                     small ones would only mean the pixels have to be read back in from memory later.
+	 */
+	void fill_row(Color* dest, Color color, size_t count, bool non_temporal = false);
+
+	/**
+	 * Multiplies each pixel in a row by a color, giving exactly what Color's operator* would.
+	 * @param dest The pixels to multiply.
+	 * @param color The color to multiply them by.
+	 * @param count The number of pixels in the row.
+	 */
+	void multiply_row(Color* dest, Color color, size_t count);
+
+	/**
+	 * Converts a row of pixels from straight alpha to premultiplied alpha.
+	 * @param dest Where to put the premultiplied pixels. This can be the same as src.
+	 * @param src The pixels to convert.
+	 * @param count The number of pixels in the row.
+	 */
+	void premultiply_row(Color* dest, const Color* src, size_t count);
+
+	/**
+	 * Converts a row of pixels from premultiplied alpha back to straight alpha.
+	 * @param dest Where to put the straight alpha pixels. This can be the same as src.
+	 * @param src The pixels to convert.
+	 * @param count The number of pixels in the row.
+	 */
+	void unpremultiply_row(Color* dest, const Color* src, size_t count);
+
+	/**
+	 * Mixes two rows of pixels together, the same way Color::lerped does.
+	 * @param dest Where to put the mixed pixels. This can be the same as either of the rows.
+	 * @param a The first row of pixels.
+	 * @param b The second row of pixels.
+	 * @param weight How much of the second row to mix in, from 0 to 256.
+	 * @param count The number of pixels in each row.
+	 */
+	void lerp_rows(Color* dest, const Color* a, const Color* b, unsigned int weight, size_t count);
+
+	/**
+	 * Shrinks two rows of pixels into one row half as wide, averaging each 2x2 block of pixels.
+	 * @param dest Where to put the averaged pixels.
+	 * @param a The first row of pixels, which should be count * 2 pixels long.
+	 * @param b The second row of pixels, which should be count * 2 pixels long.
+	 * @param count The number of pixels to put in dest.
+	 */
+	void halve_rows(Color* dest, const Color* a, const Color* b, size_t count);
+}
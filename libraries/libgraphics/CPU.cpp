@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "CPU.h"
+
+static int s_cpu = CPU_UNKNOWN;
+
+int Gfx::cpu_level() {
+	if(s_cpu == CPU_UNKNOWN) {
+		unsigned int eax, ebx, ecx, edx;
+		asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0));
+		unsigned int max_leaf = eax;
+		asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+		s_cpu = (edx & (1 << 26)) ? CPU_SSE2 : CPU_NONE;
+
+		//AVX2 also needs the kernel to have turned on saving the upper halves of the registers (see kernel/tasking/FPU.cpp)
+		bool os_avx = (ecx & (1 << 27)) && (ecx & (1 << 28));
+		if(os_avx && max_leaf >= 7) {
+			asm volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+			bool ymm_saved = (eax & 6) == 6;
+			asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(7), "c"(0));
+			if(ymm_saved && (ebx & (1 << 5)))
+				s_cpu = CPU_AVX2;
+		}
+	}
+	return s_cpu;
+}
@@ -0,0 +1,21 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#define CPU_UNKNOWN 0
+#define CPU_NONE 1
+#define CPU_SSE2 2
+#define CPU_AVX2 3
+
+//For functions that are only called once cpu_level() says the instructions they use are there
+#define SSE2 __attribute__((target("sse2")))
+#define AVX2 __attribute__((target("avx2")))
+
+namespace Gfx {
+	/**
+	 * Finds out which vector instructions can be used, which is worked out the first time this is called.
+	 * @return CPU_NONE, CPU_SSE2, or CPU_AVX2.
+	 */
+	int cpu_level();
+}
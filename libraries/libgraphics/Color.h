@@ -33,6 +33,43 @@ public:
 		};
 	}
 
+	/// Blends a color with premultiplied alpha over this one, which only takes one multiply-add per channel.
+	[[nodiscard]] constexpr Color blended_premultiplied(Color other) const {
+		unsigned int inv_alpha = 256 - other.a;
+		auto channel = [&](unsigned int src, unsigned int dest) {
+			unsigned int result = src + ((inv_alpha * dest) >> 8);
+			return (uint8_t) (result > 255 ? 255 : result);
+		};
+		return {channel(other.r, r), channel(other.g, g), channel(other.b, b), channel(other.a, a)};
+	}
+
+	/// This color with its color channels multiplied by its alpha.
+	[[nodiscard]] constexpr Color premultiplied() const {
+		unsigned int alpha = a + 1;
+		return {(uint8_t) ((alpha * r) >> 8), (uint8_t) ((alpha * g) >> 8), (uint8_t) ((alpha * b) >> 8), a};
+	}
+
+	/// Mixes this color with another, where a weight of 0 gives this color and 256 gives the other one.
+	[[nodiscard]] constexpr Color lerped(Color other, unsigned int weight) const {
+		unsigned int inv_weight = 256 - weight;
+		auto channel = [&](unsigned int a, unsigned int b) {
+			return (uint8_t) ((a * inv_weight + b * weight) >> 8);
+		};
+		return {channel(r, other.r), channel(g, other.g), channel(b, other.b), channel(a, other.a)};
+	}
+
+	/// The straight alpha color that a premultiplied one stands for.
+	[[nodiscard]] constexpr Color unpremultiplied() const {
+		if(!a)
+			return {0, 0, 0, 0};
+		unsigned int alpha = a + 1;
+		auto channel = [&](unsigned int value) {
+			unsigned int result = (value * 256 + alpha / 2) / alpha;
+			return (uint8_t) (result > 255 ? 255 : result);
+		};
+		return {channel(r), channel(g), channel(b), a};
+	}
+
 	[[nodiscard]] constexpr Color operator*(Color other) const {
 		return {
 				((uint8_t) (((int) r * (int) other.r + 255 ) >> 8)),
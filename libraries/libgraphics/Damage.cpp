@@ -0,0 +1,119 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Damage.h"
+#include <cstring>
+#include <algorithm>
+
+using namespace Gfx;
+
+DamageTracker::DamageTracker(Dimensions dimensions, int tile_size): m_tile_size(tile_size) {
+	resize(dimensions);
+	clear();
+}
+
+void DamageTracker::resize(Dimensions dimensions) {
+	m_dimensions = dimensions;
+	m_tiles_x = (dimensions.width + m_tile_size - 1) / m_tile_size;
+	m_tiles_y = (dimensions.height + m_tile_size - 1) / m_tile_size;
+	m_tiles.resize(m_tiles_x * m_tiles_y);
+	add_all();
+}
+
+void DamageTracker::add(Rect area) {
+	area = area.overlapping_area({0, 0, m_dimensions.width, m_dimensions.height});
+	if(area.width <= 0 || area.height <= 0)
+		return;
+
+	int first_x = area.x / m_tile_size;
+	int last_x = (area.x + area.width - 1) / m_tile_size;
+	int first_y = area.y / m_tile_size;
+	int last_y = (area.y + area.height - 1) / m_tile_size;
+	for(int y = first_y; y <= last_y; y++) {
+		uint8_t* row = &m_tiles[y * m_tiles_x];
+		for(int x = first_x; x <= last_x; x++) {
+			m_num_damaged += !row[x];
+			row[x] = 1;
+		}
+	}
+}
+
+void DamageTracker::add_all() {
+	memset(m_tiles.data(), 1, m_tiles.size());
+	m_num_damaged = (int) m_tiles.size();
+}
+
+void DamageTracker::clear() {
+	memset(m_tiles.data(), 0, m_tiles.size());
+	m_num_damaged = 0;
+}
+
+std::vector<Rect> DamageTracker::regions() const {
+	std::vector<Rect> regions;
+	if(empty())
+		return regions;
+
+	//The rects that reached the bottom of the previous row of tiles, which a run in this row can join onto
+	size_t open_start = 0;
+	for(int y = 0; y < m_tiles_y; y++) {
+		const uint8_t* row = &m_tiles[y * m_tiles_x];
+		size_t open_end = regions.size();
+		size_t next_open_start = regions.size();
+		size_t search = open_start;
+		for(int x = 0; x < m_tiles_x; x++) {
+			if(!row[x])
+				continue;
+			int run_start = x;
+			while(x < m_tiles_x && row[x])
+				x++;
+			Rect run = {run_start * m_tile_size, y * m_tile_size, (x - run_start) * m_tile_size, m_tile_size};
+
+			//The open rects are in order from left to right, so the search for one to join can carry on from the last
+			while(search < open_end && regions[search].x < run.x)
+				search++;
+			if(search < open_end && regions[search].x == run.x && regions[search].width == run.width) {
+				//Moving the joined rect down to the end keeps the open rects for the next row in order
+				Rect joined = regions[search];
+				joined.height += m_tile_size;
+				regions[search].width = 0;
+				regions.push_back(joined);
+				search++;
+			} else {
+				regions.push_back(run);
+			}
+		}
+		open_start = next_open_start;
+	}
+
+	//Get rid of the rects that got joined onto, and clip the rest to the Framebuffer
+	std::vector<Rect> ret;
+	ret.reserve(regions.size());
+	for(auto& region : regions) {
+		if(!region.width)
+			continue;
+		region.width = std::min(region.width, m_dimensions.width - region.x);
+		region.height = std::min(region.height, m_dimensions.height - region.y);
+		ret.push_back(region);
+	}
+	return ret;
+}
+
+Rect DamageTracker::bounds() const {
+	if(empty())
+		return {0, 0, 0, 0};
+
+	int min_x = m_tiles_x, min_y = m_tiles_y, max_x = 0, max_y = 0;
+	for(int y = 0; y < m_tiles_y; y++) {
+		for(int x = 0; x < m_tiles_x; x++) {
+			if(!m_tiles[x + y * m_tiles_x])
+				continue;
+			min_x = std::min(min_x, x);
+			max_x = std::max(max_x, x);
+			min_y = std::min(min_y, y);
+			max_y = std::max(max_y, y);
+		}
+	}
+
+	Rect bounds = {min_x * m_tile_size, min_y * m_tile_size, (max_x - min_x + 1) * m_tile_size, (max_y - min_y + 1) * m_tile_size};
+	return bounds.overlapping_area({0, 0, m_dimensions.width, m_dimensions.height});
+}
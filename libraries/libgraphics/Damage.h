@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Geometry.h"
+
+#define DAMAGE_TILE_SIZE 64
+
+namespace Gfx {
+	/**
+	 * Keeps track of which parts of a Framebuffer have been drawn to, by splitting it into square tiles and marking each
+	 * one that a drawing function touches. A Framebuffer with one of these set as its damage tracker marks everything it
+	 * draws, so whatever shows it on screen can copy just the tiles that changed instead of working it out separately.
+	 */
+	class DamageTracker {
+	public:
+		/**
+		 * Creates a tracker for a Framebuffer of a certain size, with nothing damaged yet.
+		 * @param dimensions The dimensions of the Framebuffer.
+		 * @param tile_size The width and height of each tile, in pixels.
+		 */
+		explicit DamageTracker(Dimensions dimensions = {0, 0}, int tile_size = DAMAGE_TILE_SIZE);
+
+		/**
+		 * Changes the size of the Framebuffer being tracked, which marks the whole thing as damaged.
+		 * @param dimensions The new dimensions of the Framebuffer.
+		 */
+		void resize(Dimensions dimensions);
+
+		/**
+		 * Marks every tile an area overlaps as damaged.
+		 * @param area The area that was drawn to.
+		 */
+		void add(Rect area);
+
+		/**
+		 * Marks the whole Framebuffer as damaged.
+		 */
+		void add_all();
+
+		/**
+		 * Marks everything as undamaged, which should be done once the damage has been dealt with.
+		 */
+		void clear();
+
+		/**
+		 * Whether nothing has been damaged since the tracker was last cleared.
+		 */
+		[[nodiscard]] bool empty() const { return m_num_damaged == 0; }
+
+		/**
+		 * Gets the damaged tiles as a list of rects that don't overlap. Runs of damaged tiles next to each other in a row
+		 * become one rect, and runs that span the same columns in consecutive rows are joined together too. The rects are
+		 * clipped to the Framebuffer, and come out sorted from top to bottom.
+		 * @return The damaged areas.
+		 */
+		[[nodiscard]] std::vector<Rect> regions() const;
+
+		/**
+		 * Gets the smallest rect that covers every damaged tile, or an empty rect if nothing is damaged.
+		 */
+		[[nodiscard]] Rect bounds() const;
+
+		[[nodiscard]] Dimensions dimensions() const { return m_dimensions; }
+		[[nodiscard]] int tile_size() const { return m_tile_size; }
+
+	private:
+		Dimensions m_dimensions;
+		int m_tile_size;
+		int m_tiles_x = 0;
+		int m_tiles_y = 0;
+		std::vector<uint8_t> m_tiles;
+		int m_num_damaged = 0;
+	};
+}
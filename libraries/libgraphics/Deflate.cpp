@@ -18,23 +18,66 @@
 */
 
 #include "Deflate.h"
-#include <stdlib.h>
-
-unsigned int read_bits(DEFLATE* def, size_t num_bits) {
-	unsigned int ret = 0;
-	for(size_t i = 0; i < num_bits; i++) {
-		if(def->bit_pos == 8) { //We've read all 8 bits from the current byte, read a new one
-			def->bit_buf = def->read(def->arg);
-			def->bit_pos = 0;
-		}
-		ret |= (def->bit_buf & 0x1u) << i;
-		def->bit_buf >>= 1;
-		def->bit_pos++;
+#include <string.h>
+
+#define FAST_MASK ((1u << HUFFMAN_FAST_BITS) - 1)
+
+#define STATE_BLOCK_HEADER 0
+#define STATE_STORED 1
+#define STATE_HUFFMAN 2
+#define STATE_DONE 3
+
+//What the parts of inflate_resume() return when they've finished and it should move on to the next one
+#define DEFLATE_CONTINUE 3
+
+//Enough input for any length/distance pair (15 + 5 + 15 + 13 bits), and for any block header (with some to spare)
+#define MAX_SYMBOL_BITS 48
+#define MAX_HEADER_BITS (600 * 8)
+
+/*
+ * Bits are read out of a 64-bit buffer, which is refilled eight bytes at a time when there are enough of them left.
+ * Doing that puts bits past bit_count in the buffer too, but they're always the bits of the input from in_pos onwards,
+ * so refilling again just ORs the same bits back in (and whoever gives inflate_resume() more input has to keep them).
+ * Past the end of the input, the buffer reads as zeroes and overran gets set.
+ */
+static inline void refill(DEFLATE* def) {
+	if(def->in_pos + 8 <= def->in_size) {
+		uint64_t word;
+		memcpy(&word, def->in + def->in_pos, sizeof(word));
+		def->bit_buf |= word << def->bit_count;
+		def->in_pos += (63 - def->bit_count) >> 3;
+		def->bit_count |= 56;
+		return;
 	}
+	while(def->bit_count <= 56 && def->in_pos < def->in_size) {
+		def->bit_buf |= (uint64_t) def->in[def->in_pos++] << def->bit_count;
+		def->bit_count += 8;
+	}
+}
+
+static inline void drop_bits(DEFLATE* def, unsigned int num_bits) {
+	if(def->bit_count < num_bits) {
+		def->overran = 1;
+		def->bit_count = num_bits;
+	}
+	def->bit_buf >>= num_bits;
+	def->bit_count -= num_bits;
+}
+
+static inline unsigned int read_bits(DEFLATE* def, unsigned int num_bits) {
+	if(def->bit_count < num_bits)
+		refill(def);
+	unsigned int ret = def->bit_buf & ((1ull << num_bits) - 1);
+	drop_bits(def, num_bits);
 	return ret;
 }
 
-void create_huffman(const uint8_t lengths[], uint32_t size, huffman* huff) {
+/** Whether there might not be enough input left for the next part of the stream, and more of it is coming. **/
+static inline bool need_input(DEFLATE* def, size_t num_bits) {
+	return !def->in_final && def->bit_count + (def->in_size - def->in_pos) * 8 < num_bits;
+}
+
+static void create_huffman(const uint8_t lengths[], uint32_t size, huffman* huff) {
 	//Zero out code length counts
 	for(size_t i = 0; i < 16; i++)
 		huff->counts[i] = 0;
@@ -45,40 +88,118 @@ void create_huffman(const uint8_t lengths[], uint32_t size, huffman* huff) {
 
 	huff->counts[0] = 0;
 
-	//Figure out the starting indexes into the final symbol array for each code length
+	//Figure out the starting indexes into the final symbol array and the first code for each code length
 	uint32_t count = 0;
 	uint16_t indexes[16];
+	uint16_t next_code[16];
+	uint16_t code = 0;
 	for(uint16_t i = 0; i < 16; i++) {
 		indexes[i] = count;
 		count += huff->counts[i];
+		if(i)
+			code = (code + huff->counts[i - 1]) << 1;
+		next_code[i] = code;
 	}
 
-	//Create the final symbol array which we can index into using codes
-	for (uint16_t i = 0; i < size; i++) {
-		if (lengths[i])
-			huff->symbols[indexes[lengths[i]]++] = i;
+	//Create the final symbol array which we can index into using codes, and the table for decoding short codes in one go
+	memset(huff->fast, 0, sizeof(huff->fast));
+	for(uint16_t i = 0; i < size; i++) {
+		uint8_t length = lengths[i];
+		if(!length)
+			continue;
+		huff->symbols[indexes[length]++] = i;
+
+		uint16_t symbol_code = next_code[length]++;
+		if(length > HUFFMAN_FAST_BITS)
+			continue;
+
+		//Codes are packed starting from their most significant bit, but bits are read starting from the least
+		uint16_t reversed = 0;
+		for(uint8_t bit = 0; bit < length; bit++)
+			reversed |= ((symbol_code >> bit) & 1u) << (length - 1 - bit);
+		for(uint32_t entry = reversed; entry <= FAST_MASK; entry += 1u << length)
+			huff->fast[entry] = (length << 9) | i;
 	}
 }
 
-uint16_t huffman_decode(DEFLATE* def, huffman* huff) {
-	int count = 0;
-	int cur = 0;
-	for(int i = 1; cur >= 0; i++) {
-		cur = read_bits(def, 1) | (cur << 1);
-		count += huff->counts[i];
-		cur -= huff->counts[i];
+/** Decodes one symbol, or returns -1 if the input isn't a valid code. **/
+static inline int huffman_decode(DEFLATE* def, const huffman* huff) {
+	if(def->bit_count < 16)
+		refill(def);
+	uint16_t entry = huff->fast[def->bit_buf & FAST_MASK];
+	if(entry) {
+		drop_bits(def, entry >> 9);
+		return entry & 0x1FF;
 	}
-	return huff->symbols[count + cur];
+
+	//Longer codes are walked one bit at a time through the canonical code
+	int code = 0;
+	int first = 0;
+	int index = 0;
+	for(int length = 1; length < 16; length++) {
+		code |= read_bits(def, 1);
+		int count = huff->counts[length];
+		if(code - first < count)
+			return huff->symbols[index + (code - first)];
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
+	return -1;
+}
+
+static huffman fixed_len_huff;
+static huffman fixed_dist_huff;
+static int made_fixed = 0;
+
+static void make_fixed_huffman() {
+	if(made_fixed)
+		return;
+	made_fixed = 1;
+
+	uint8_t len_lengths[288];
+	for(uint16_t i = 0; i < 288; i++) {
+		if(i < 144 || i >= 280)
+			len_lengths[i] = 8;
+		else if(i < 256)
+			len_lengths[i] = 9;
+		else if(i < 280)
+			len_lengths[i] = 7;
+	}
+	create_huffman(len_lengths, 288, &fixed_len_huff);
+
+	uint8_t dist_lengths[30];
+	for(uint8_t i = 0; i < 30; i++)
+		dist_lengths[i] = 5;
+	create_huffman(dist_lengths, 30, &fixed_dist_huff);
 }
 
-void def_write(DEFLATE* def, uint8_t byte) {
-	if(def->frame_pointer == 0x8000)
-		def->frame_pointer = 0;
-	def->reading_frame[def->frame_pointer++] = byte;
-	def->write(byte, def->arg);
+/**
+ * Writes as much of the current back-reference to the output as will fit, from copy_distance bytes behind the current
+ * position. If they overlap, whatever's being copied repeats every copy_distance bytes.
+ * @return Whether all of it was written.
+ */
+static inline bool copy_match(DEFLATE* def) {
+	size_t length = def->copy_length;
+	if(length > def->out_size - def->out_pos)
+		length = def->out_size - def->out_pos;
+
+	uint8_t* dest = def->out + def->out_pos;
+	const uint8_t* src = dest - def->copy_distance;
+	if(def->copy_distance >= length) {
+		memcpy(dest, src, length);
+	} else if(def->copy_distance == 1) {
+		memset(dest, *src, length);
+	} else {
+		for(size_t i = 0; i < length; i++)
+			dest[i] = src[i];
+	}
+	def->out_pos += length;
+	def->copy_length -= length;
+	return !def->copy_length;
 }
 
-void inflate(DEFLATE* def, huffman* len_huff, huffman* dist_huff) {
+static int inflate_huffman(DEFLATE* def) {
 	//The lengths corresponding to symbols > 256
 	static const uint16_t lengths[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
 	//The number of extra bits to read and add to the lengths corresponding to symbols > 256
@@ -88,26 +209,64 @@ void inflate(DEFLATE* def, huffman* len_huff, huffman* dist_huff) {
 	//The number of extra bits to read and add to the distances above
 	static const uint16_t distances_extrabits[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
 
+	const huffman* len_huff = def->len_huff;
+	const huffman* dist_huff = def->dist_huff;
+
+	//Finish off a back-reference that didn't fit last time
+	if(def->copy_length && !copy_match(def))
+		return DEFLATE_OUTPUT_FULL;
+
 	while(1) {
-		uint16_t sym = huffman_decode(def, len_huff);
-		if(sym < 256) {
-			def_write(def, sym);
-		} else {
-			if(sym == 256)
+		if(need_input(def, MAX_SYMBOL_BITS))
+			return DEFLATE_NEED_INPUT;
+
+		if(def->out_pos == def->out_size) {
+			//The end of the block is the only thing that fits, so anything else gets put back to be read again later
+			uint64_t bit_buf = def->bit_buf;
+			unsigned int bit_count = def->bit_count;
+			size_t in_pos = def->in_pos;
+			if(huffman_decode(def, len_huff) == 256 && !def->overran)
 				break;
-			uint16_t length = read_bits(def, lengths_extrabits[sym - 257]) + lengths[sym - 257];
-			uint16_t distance_index = huffman_decode(def, dist_huff);
-			uint16_t distance = distances[distance_index] + read_bits(def, distances_extrabits[distance_index]);
-			//If sym > 256, write length bytes to the output from distance bytes behind the current position
-			for(uint16_t i = 0; i < length; i++) {
-				uint8_t byte = def->reading_frame[(def->frame_pointer - distance) % 0x8000];
-				def_write(def, byte);
-			}
+			def->bit_buf = bit_buf;
+			def->bit_count = bit_count;
+			def->in_pos = in_pos;
+			def->overran = 0;
+			return DEFLATE_OUTPUT_FULL;
+		}
+
+		int sym = huffman_decode(def, len_huff);
+		if(sym < 256) {
+			if(sym < 0 || def->overran)
+				return DEFLATE_ERROR;
+			def->out[def->out_pos++] = sym;
+			continue;
 		}
+		if(sym == 256)
+			break;
+		if(sym > 285)
+			return DEFLATE_ERROR;
+
+		size_t length = lengths[sym - 257] + read_bits(def, lengths_extrabits[sym - 257]);
+		int distance_index = huffman_decode(def, dist_huff);
+		if(distance_index < 0 || distance_index >= 30)
+			return DEFLATE_ERROR;
+		size_t distance = distances[distance_index] + read_bits(def, distances_extrabits[distance_index]);
+		if(distance > def->out_pos || def->overran)
+			return DEFLATE_ERROR;
+
+		def->copy_length = length;
+		def->copy_distance = distance;
+		if(!copy_match(def))
+			return DEFLATE_OUTPUT_FULL;
 	}
+
+	if(def->overran)
+		return DEFLATE_ERROR;
+	def->state = def->last_block ? STATE_DONE : STATE_BLOCK_HEADER;
+	return DEFLATE_CONTINUE;
 }
 
-void inflate_dynamic(DEFLATE* def) {
+static int read_dynamic_huffman(DEFLATE* def) {
 	//The code lengths for the dynamic huffman alphabet
 	static const uint8_t codelen_alphabet[] = {
 			16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
@@ -116,6 +275,8 @@ void inflate_dynamic(DEFLATE* def) {
 	uint16_t hlit = read_bits(def, 5) + 257; //# of Literal/Length codes
 	uint8_t hdist = read_bits(def, 5) + 1; //# of Distance codes
 	uint8_t hclen = read_bits(def, 4) + 4; //# of Code Length codes
+	if(hlit > 286 || hdist > 30)
+		return -1;
 
 	//Get the code lengths for each entry in the code length alphabet
 	uint8_t alphabet_codelens[19] = {0};
@@ -130,7 +291,9 @@ void inflate_dynamic(DEFLATE* def) {
 	uint16_t i = 0;
 	uint8_t lengths[320];
 	while(i < hdist + hlit) {
-		uint16_t sym = huffman_decode(def, &codes_huff);
+		int sym = huffman_decode(def, &codes_huff);
+		if(sym < 0)
+			return -1;
 		if(sym < 16) { //0-15: Represent code lengths of 0 - 15
 			lengths[i++] = sym;
 		} else {
@@ -138,6 +301,8 @@ void inflate_dynamic(DEFLATE* def) {
 			uint8_t to_repeat = 0;
 			switch(sym) {
 				case 16: //16: Copy the previous code length 3 - 6 times.
+					if(!i)
+						return -1;
 					to_repeat = lengths[i - 1];
 					num_repeats = read_bits(def, 2) + 3;
 					break;
@@ -148,95 +313,138 @@ void inflate_dynamic(DEFLATE* def) {
 					num_repeats = read_bits(def, 7) + 11;
 					break;
 				default:
-					//Shouldn't happen...
-					break;
+					return -1;
 			}
+			if(i + num_repeats > hdist + hlit)
+				return -1;
 			for(uint8_t j = 0; j < num_repeats; j++)
 				lengths[i++] = to_repeat;
 		}
 	}
+	if(def->overran)
+		return -1;
 
 	//Build the length/dist tables
-	huffman length_huff;
-	create_huffman(lengths, hlit, &length_huff);
-	huffman dist_huff;
-	create_huffman(lengths + hlit, hdist, &dist_huff);
-
-	inflate(def, &length_huff, &dist_huff);
+	create_huffman(lengths, hlit, &def->dynamic_len_huff);
+	create_huffman(lengths + hlit, hdist, &def->dynamic_dist_huff);
+	def->len_huff = &def->dynamic_len_huff;
+	def->dist_huff = &def->dynamic_dist_huff;
+	return 0;
 }
 
-int inflate_uncompressed(DEFLATE* def) {
-	def->bit_buf = 0;
-	def->bit_pos = 8;
-
-	uint16_t len_a = def->read(def->arg);
-	uint16_t len_b = def->read(def->arg);
-	uint16_t len = len_a | (len_b << 8);
-
-	uint16_t lencomp_a = def->read(def->arg);
-	uint16_t lencomp_b = def->read(def->arg);
-	uint16_t lencomp = lencomp_a | (lencomp_b << 8);
+static int read_block_header(DEFLATE* def) {
+	if(need_input(def, MAX_HEADER_BITS))
+		return DEFLATE_NEED_INPUT;
+
+	def->last_block = read_bits(def, 1);
+	uint8_t btype = read_bits(def, 2);
+	switch(btype) {
+		case 0b00: {
+			//Skip to the next byte, then read the length and its ones complement
+			drop_bits(def, def->bit_count & 7);
+			uint16_t len = read_bits(def, 16);
+			uint16_t lencomp = read_bits(def, 16);
+			if((lencomp & 0xFFFF) != (~len & 0xFFFF) || def->overran)
+				return DEFLATE_ERROR;
+			def->stored_left = len;
+			def->state = STATE_STORED;
+			break;
+		}
+		case 0b01:
+			def->len_huff = &fixed_len_huff;
+			def->dist_huff = &fixed_dist_huff;
+			def->state = STATE_HUFFMAN;
+			break;
+		case 0b10:
+			if(read_dynamic_huffman(def) < 0)
+				return DEFLATE_ERROR;
+			def->state = STATE_HUFFMAN;
+			break;
+		default:
+			fprintf(stderr, "deflate: Invalid btype 0b11\n");
+			return DEFLATE_ERROR;
+	}
+	return DEFLATE_CONTINUE;
+}
 
-	//Make sure lencomp is actually the ones complement of length
-	if((lencomp & 0xFFFF) != (~len & 0xFFFF))
-		return -1;
+static int inflate_stored(DEFLATE* def) {
+	//Whatever's left in the bit buffer is whole bytes by now, which come before the rest of the input
+	while(def->stored_left && def->bit_count) {
+		if(def->out_pos == def->out_size)
+			return DEFLATE_OUTPUT_FULL;
+		def->out[def->out_pos++] = read_bits(def, 8);
+		def->stored_left--;
+	}
 
-	for(uint16_t i = 0; i < len; i++)
-		def_write(def, def->read(def->arg));
+	if(def->stored_left) {
+		//The buffer is empty, so get rid of the bits past bit_count too, since the input is about to be read directly
+		def->bit_buf = 0;
+		size_t length = def->stored_left;
+		if(length > def->in_size - def->in_pos)
+			length = def->in_size - def->in_pos;
+		if(length > def->out_size - def->out_pos)
+			length = def->out_size - def->out_pos;
+		memcpy(def->out + def->out_pos, def->in + def->in_pos, length);
+		def->in_pos += length;
+		def->out_pos += length;
+		def->stored_left -= length;
+		if(def->stored_left) {
+			if(def->out_pos == def->out_size)
+				return DEFLATE_OUTPUT_FULL;
+			return def->in_final ? DEFLATE_ERROR : DEFLATE_NEED_INPUT;
+		}
+	}
 
-	return 0;
+	def->state = def->last_block ? STATE_DONE : STATE_BLOCK_HEADER;
+	return DEFLATE_CONTINUE;
 }
 
-huffman fixed_len_huff;
-huffman fixed_dist_huff;
-int made_fixed = 0;
-
-int decompress(DEFLATE* def) {
-	def->bit_pos = 8;
-	def->frame_pointer = 0;
+void inflate_init(DEFLATE* def) {
+	make_fixed_huffman();
+	def->in_pos = 0;
+	def->in_final = 0;
 	def->bit_buf = 0;
+	def->bit_count = 0;
+	def->overran = 0;
+	def->out_pos = 0;
+	def->state = STATE_BLOCK_HEADER;
+	def->last_block = 0;
+	def->copy_length = 0;
+	def->stored_left = 0;
+}
 
-	uint8_t bfinal = 0;
-
-	//Make the huffman code tables for fixed code inflation if they don't exist already
-	if(!made_fixed) {
-		made_fixed = 1;
-		uint8_t len_lengths[288];
-		for(uint16_t i = 0; i < 288; i++) {
-			if(i < 144 || i >= 280)
-				len_lengths[i] = 8;
-			else if(i < 256)
-				len_lengths[i] = 9;
-			else if(i < 280)
-				len_lengths[i] = 7;
-		}
-		create_huffman(len_lengths, 288, &fixed_len_huff);
-
-		uint8_t dist_lengths[30];
-		for(uint8_t i = 0; i < 30; i++)
-			dist_lengths[i] = 5;
-		create_huffman(dist_lengths, 30, &fixed_dist_huff);
-	}
-
-	while(!bfinal) {
-		bfinal = read_bits(def, 1);
-		uint8_t btype = read_bits(def, 2);
-		switch(btype) {
-			case 0b00:
-				if(inflate_uncompressed(def) < 0)
-					return -1;
+int inflate_resume(DEFLATE* def) {
+	while(1) {
+		int ret;
+		switch(def->state) {
+			case STATE_BLOCK_HEADER:
+				ret = read_block_header(def);
 				break;
-			case 0b01:
-				inflate(def, &fixed_len_huff, &fixed_dist_huff);
+			case STATE_STORED:
+				ret = inflate_stored(def);
 				break;
-			case 0b10:
-				inflate_dynamic(def);
+			case STATE_HUFFMAN:
+				ret = inflate_huffman(def);
 				break;
 			default:
-				fprintf(stderr, "deflate: Invalid btype 0b11\n");
-				return -1;
+				return DEFLATE_DONE;
 		}
+		if(ret == DEFLATE_ERROR)
+			fprintf(stderr, "deflate: Invalid compressed data\n");
+		if(ret != DEFLATE_CONTINUE)
+			return ret;
 	}
+}
 
-	return 0;
-}
\ No newline at end of file
+void inflate_slide(DEFLATE* def) {
+	if(def->out_pos <= DEFLATE_WINDOW_SIZE)
+		return;
+	memmove(def->out, def->out + def->out_pos - DEFLATE_WINDOW_SIZE, DEFLATE_WINDOW_SIZE);
+	def->out_pos = DEFLATE_WINDOW_SIZE;
+}
+
+int decompress(DEFLATE* def) {
+	inflate_init(def);
+	def->in_final = 1;
+	return inflate_resume(def) == DEFLATE_DONE ? 0 : -1;
+}
@@ -24,23 +24,69 @@
 
 __DECL_BEGIN
 
-typedef struct DEFLATE {
-	uint8_t bit_pos;
-	uint8_t bit_buf;
-	size_t frame_pointer;
-	uint8_t reading_frame[0x8000];
-
-	void (*write)(uint8_t, void*);
-	uint8_t (*read)(void*);
-	void* arg;
-} DEFLATE;
+#define HUFFMAN_FAST_BITS 9
+
+//How far back a deflate stream can refer to, which is how much output inflate_slide() keeps
+#define DEFLATE_WINDOW_SIZE 32768
+
+//What inflate_resume() returns
+#define DEFLATE_ERROR (-1)
+#define DEFLATE_DONE 0
+#define DEFLATE_NEED_INPUT 1
+#define DEFLATE_OUTPUT_FULL 2
 
 typedef struct huffman {
+	/// Indexed by the next HUFFMAN_FAST_BITS bits of input, giving (code length << 9) | symbol, or 0 if the code is longer.
+	uint16_t fast[1 << HUFFMAN_FAST_BITS];
 	uint16_t counts[16];
 	uint16_t symbols[288];
 } huffman;
 
+/**
+ * A deflate stream being decompressed from one buffer into another. The output buffer doubles as the window that
+ * back-references copy from, so it either has to be big enough for everything the stream decompresses to, or the
+ * stream has to be decompressed a piece at a time with inflate_resume() and inflate_slide().
+ */
+typedef struct DEFLATE {
+	const uint8_t* in;
+	size_t in_size;
+	size_t in_pos;
+	int in_final; ///< Whether in holds the rest of the stream. If it doesn't, bytes from in_pos on are needed again.
+	uint64_t bit_buf;
+	unsigned int bit_count;
+	int overran; ///< Set if the stream went past the end of the input, in which case it's corrupt.
+
+	uint8_t* out;
+	size_t out_size;
+	size_t out_pos;
+
+	//Where inflate_resume() got to
+	int state;
+	int last_block;
+	size_t copy_length;
+	size_t copy_distance;
+	size_t stored_left;
+	const huffman* len_huff;
+	const huffman* dist_huff;
+	huffman dynamic_len_huff;
+	huffman dynamic_dist_huff;
+} DEFLATE;
+
+/** Gets a DEFLATE ready to start decompressing a stream. The input and output still need to be set. **/
+void inflate_init(DEFLATE* def);
+
+/**
+ * Decompresses as much of the stream as it can. If it returns DEFLATE_NEED_INPUT, it should be called again with the
+ * bytes from in_pos onwards plus some more in in; if it returns DEFLATE_OUTPUT_FULL, it should be called again once
+ * there's more room in out (see inflate_slide()).
+ * @return DEFLATE_DONE, DEFLATE_NEED_INPUT, DEFLATE_OUTPUT_FULL, or DEFLATE_ERROR if the stream is corrupt.
+ */
+int inflate_resume(DEFLATE* def);
+
+/** Makes room in the output buffer by moving the last DEFLATE_WINDOW_SIZE bytes of output to the start of it. **/
+void inflate_slide(DEFLATE* def);
+
+/** Decompresses a whole stream in one go, so in has to hold all of it and out has to be big enough for all of it. **/
 int decompress(DEFLATE* def);
 
 __DECL_END
-
@@ -23,208 +23,254 @@
 #include <cstring>
 #include <climits>
 #include <sys/shm.h>
-#include <memory>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
 
 using namespace Gfx;
 
-Font* Font::load_bdf_shm(const char* path) {
+bool Font::compile_bdf(const char* path, std::vector<uint8_t>& font_data) {
 	FILE* file = fopen(path, "r");
 	if(!file) {
 		perror("Couldn't open font");
-		return nullptr;
+		return false;
 	}
 
+	auto fail = [&](const char* message) {
+		fprintf(stderr, "Couldn't load font: %s\n", message);
+		fclose(file);
+		return false;
+	};
+
 	char linebuf[512] = {0};
 
 	fgets(linebuf, 128, file);
 	strtok(linebuf, "\n"); //Remove newline
 	char* startfont = strtok(linebuf, " ");
-	if(strcmp(startfont, "STARTFONT") != 0) {
-		fprintf(stderr, "Couldn't load font: Invalid BDF header\n");
-		return nullptr;
-	}
+	if(!startfont || strcmp(startfont, "STARTFONT") != 0)
+		return fail("Invalid BDF header");
 
 	char* fontver = strtok(NULL, "");
-	if(strcmp(fontver, "2.1") != 0) {
-		fprintf(stderr, "Couldn't load font: Invalid BDF version %s\n", fontver);
-		return nullptr;
-	}
+	if(!fontver || strcmp(fontver, "2.1") != 0)
+		return fail("Invalid BDF version");
 
 	FontData font;
 	while(true) {
-		if(!fgets(linebuf, 512, file)) {
-			fprintf(stderr, "Couldn't load font: File ended before expected\n");
-			return nullptr;
-		}
+		if(!fgets(linebuf, 512, file))
+			return fail("File ended before expected");
 
 		strtok(linebuf, "\n"); //Remove newline
 		char* property = strtok(linebuf, " ");
+		if(!property)
+			continue;
 
 		if(!strcmp(property, "FONT")) {
 			strncpy(font.id, strtok(NULL, ""), 127);
 		} else if(!strcmp(property, "SIZE")) {
 			font.size = atoi(strtok(NULL, " "));
-			if(font.size == INT_MAX) {
-				fprintf(stderr, "Couldn't load font: Invalid SIZE");
-				return nullptr;
-			}
+			if(font.size == INT_MAX)
+				return fail("Invalid SIZE");
 		} else if(!strcmp(property, "FONTBOUNDINGBOX")) {
 			auto& bbx = font.bounding_box;
 			bbx.width = atol(strtok(NULL, " "));
 			bbx.height = atoi(strtok(NULL, " "));
 			bbx.base_x = atoi(strtok(NULL, " "));
 			bbx.base_y = atoi(strtok(NULL, " "));
-			if(bbx.width == INT_MAX || bbx.height == INT_MAX || bbx.base_x == INT_MAX || bbx.base_y == INT_MAX) {
-				fprintf(stderr, "Couldn't load font: Invalid FONTBOUNDINGBOX");
-				return nullptr;
-			}
+			if(bbx.width == INT_MAX || bbx.height == INT_MAX || bbx.base_x == INT_MAX || bbx.base_y == INT_MAX)
+				return fail("Invalid FONTBOUNDINGBOX");
 		} else if(!strcmp(property, "CHARS")) {
 			font.num_glyphs = atoi(strtok(NULL, " "));
-			if(font.size == INT_MAX) {
-				fprintf(stderr, "Couldn't load font: Invalid SIZE");
-				return nullptr;
-			}
+			if(font.num_glyphs < 0 || font.num_glyphs == INT_MAX)
+				return fail("Invalid CHARS");
 			break;
 		}
 	}
 
-	shm fontshm;
-	{
-		//Read all of the glyphs from the file
-		std::shared_ptr<FontGlyph> glyphs[font.num_glyphs];
-		size_t total_memsz = sizeof(FontData);
-		for(size_t i = 0; i < font.num_glyphs; i++) {
-			//Find the next STARTCHAR
-			while(true) {
-				if(!fgets(linebuf, 512, file)) {
-					fprintf(stderr, "Couldn't load font: File ended before expected\n");
-					return nullptr;
-				}
-
-				if(!strcmp(strtok(linebuf, " "), "STARTCHAR"))
-					break;
-			}
+	//Read all of the glyphs from the file. The masks all go in one buffer, so there's no allocating for each glyph.
+	std::vector<FontGlyph> glyphs(font.num_glyphs);
+	std::vector<uint8_t> masks;
+	for(auto& glyph : glyphs) {
+		//Find the next STARTCHAR
+		while(true) {
+			if(!fgets(linebuf, 512, file))
+				return fail("File ended before expected");
+
+			char* keyword = strtok(linebuf, " \n");
+			if(keyword && !strcmp(keyword, "STARTCHAR"))
+				break;
+		}
 
-			//Read the glyph properties
-			FontGlyph glyph_properties;
-			while(true) {
-				if(!fgets(linebuf, 512, file)) {
-					fprintf(stderr, "Couldn't load font: File ended before expected\n");
-					return nullptr;
-				}
-
-				strtok(linebuf, "\n"); //Remove newline
-				char* property = strtok(linebuf, " ");
-
-				if(!strcmp(property, "ENCODING")) {
-					glyph_properties.codepoint = strtoul(strtok(NULL, " "), NULL, 10);
-					if(glyph_properties.codepoint == ULONG_MAX) {
-						fprintf(stderr, "Couldn't load font: Invalid glyph codepoint");
-						return nullptr;
-					}
-				} else if(!strcmp(property, "DWIDTH")) {
-					auto& dwidth = glyph_properties.next_offset;
-					dwidth.x = atol(strtok(NULL, " "));
-					dwidth.y = atol(strtok(NULL, " "));
-					if(dwidth.x == INT_MAX || dwidth.y == INT_MAX) {
-						fprintf(stderr, "Couldn't load font: Invalid glyph DWIDTH");
-						return nullptr;
-					}
-				} else if(!strcmp(property, "BBX")) {
-					glyph_properties.width = atol(strtok(NULL, " "));
-					glyph_properties.height = atoi(strtok(NULL, " "));
-					glyph_properties.base_x = atoi(strtok(NULL, " "));
-					glyph_properties.base_y = atoi(strtok(NULL, " "));
-					if(glyph_properties.width == INT_MAX || glyph_properties.height == INT_MAX || glyph_properties.base_x == INT_MAX || glyph_properties.base_y == INT_MAX) {
-						fprintf(stderr, "Couldn't load font: Invalid glyph bounding box");
-						return nullptr;
-					}
-				} else if(!strcmp(property, "BITMAP"))
-					break;
-			}
+		//Read the glyph properties
+		while(true) {
+			if(!fgets(linebuf, 512, file))
+				return fail("File ended before expected");
+
+			strtok(linebuf, "\n"); //Remove newline
+			char* property = strtok(linebuf, " ");
+			if(!property)
+				continue;
+
+			if(!strcmp(property, "ENCODING")) {
+				glyph.codepoint = strtoul(strtok(NULL, " "), NULL, 10);
+				if(glyph.codepoint == ULONG_MAX)
+					return fail("Invalid glyph codepoint");
+			} else if(!strcmp(property, "DWIDTH")) {
+				auto& dwidth = glyph.next_offset;
+				dwidth.x = atol(strtok(NULL, " "));
+				dwidth.y = atol(strtok(NULL, " "));
+				if(dwidth.x == INT_MAX || dwidth.y == INT_MAX)
+					return fail("Invalid glyph DWIDTH");
+			} else if(!strcmp(property, "BBX")) {
+				glyph.width = atol(strtok(NULL, " "));
+				glyph.height = atoi(strtok(NULL, " "));
+				glyph.base_x = atoi(strtok(NULL, " "));
+				glyph.base_y = atoi(strtok(NULL, " "));
+				if(glyph.width < 0 || glyph.height < 0 || glyph.width > 512 || glyph.height > 512 || glyph.base_x == INT_MAX || glyph.base_y == INT_MAX)
+					return fail("Invalid glyph bounding box");
+			} else if(!strcmp(property, "BITMAP"))
+				break;
+		}
 
-			//Read the glyph bitmap
-			size_t glyph_memsz = sizeof(FontGlyph) + sizeof(uint32_t) * glyph_properties.width * glyph_properties.height;
-			total_memsz += glyph_memsz;
-			auto glyph = std::shared_ptr<FontGlyph>((FontGlyph*) malloc(glyph_memsz));
-			memcpy(glyph.get(), &glyph_properties, sizeof(FontGlyph));
-			for(size_t y = 0; y < glyph_properties.height; y++) {
-				if(!fgets(linebuf, 512, file)) {
-					fprintf(stderr, "Couldn't load font: File ended before expected\n");
-					return nullptr;
-				}
-
-				//Set each pixel on the line to white or transparent
-				auto* line = &glyph->bitmap[y * glyph_properties.width];
-				for(size_t x = 0; x < glyph_properties.width; x++) {
-					char nibble_char = linebuf[x / 4];
-					uint8_t nibble = 0;
-
-					if(nibble_char >= '0' && nibble_char <= '9')
-						nibble = nibble_char - '0';
-					else if(nibble_char >= 'A' && nibble_char <= 'F')
-						nibble = 0xa + (nibble_char - 'A');
-					else if(nibble_char >= 'a' && nibble_char <= 'f')
-						nibble = 0xa + (nibble_char - 'a');
-
-					line[x] = nibble & (0x8u >> (x % 4)) ? 0xFFFFFFFF : 0x00000000;
-				}
+		//Read the glyph bitmap
+		glyph.mask_offset = masks.size();
+		masks.resize(masks.size() + glyph.width * glyph.height);
+		for(int y = 0; y < glyph.height; y++) {
+			if(!fgets(linebuf, 512, file))
+				return fail("File ended before expected");
+
+			//Set each pixel on the line to opaque or transparent
+			auto* line = &masks[glyph.mask_offset + y * glyph.width];
+			for(int x = 0; x < glyph.width; x++) {
+				char nibble_char = linebuf[x / 4];
+				uint8_t nibble = 0;
+
+				if(nibble_char >= '0' && nibble_char <= '9')
+					nibble = nibble_char - '0';
+				else if(nibble_char >= 'A' && nibble_char <= 'F')
+					nibble = 0xa + (nibble_char - 'A');
+				else if(nibble_char >= 'a' && nibble_char <= 'f')
+					nibble = 0xa + (nibble_char - 'a');
+
+				line[x] = nibble & (0x8u >> (x % 4)) ? 0xFF : 0x00;
 			}
-
-			glyphs[i] = glyph;
 		}
+	}
+	fclose(file);
+
+	//Glyphs are looked up with a binary search, so they need to be in order
+	std::sort(glyphs.begin(), glyphs.end(), [](const FontGlyph& a, const FontGlyph& b) {
+		return a.codepoint < b.codepoint;
+	});
+
+	font.masks_size = masks.size();
+	size_t glyphs_size = glyphs.size() * sizeof(FontGlyph);
+	font_data.resize(sizeof(FontData) + glyphs_size + masks.size());
+	memcpy(font_data.data(), &font, sizeof(FontData));
+	memcpy(font_data.data() + sizeof(FontData), glyphs.data(), glyphs_size);
+	memcpy(font_data.data() + sizeof(FontData) + glyphs_size, masks.data(), masks.size());
+	return true;
+}
 
-		//Close the file & allocate shared memory for the font data
-		fclose(file);
-		if(shmcreate(nullptr, total_memsz, &fontshm) < 0) {
-			perror("Couldn't load font: Couldn't create shared memory region");
-			return nullptr;
-		}
+Font* Font::load_bdf_shm(const char* path) {
+	std::vector<uint8_t> font_data;
+	if(!compile_bdf(path, font_data))
+		return nullptr;
+	return create_shm(font_data);
+}
+
+Font* Font::create_shm(const std::vector<uint8_t>& font_data) {
+	shm fontshm;
+	if(shmcreate(nullptr, font_data.size(), &fontshm) < 0) {
+		perror("Couldn't load font: Couldn't create shared memory region");
+		return nullptr;
+	}
+	memcpy(fontshm.ptr, font_data.data(), font_data.size());
+	return load_from_shm(fontshm);
+}
 
-		//Copy the font into shared memory
-		memcpy(fontshm.ptr, &font, sizeof(FontData));
-		void* cptr = (void*) ((size_t) fontshm.ptr + sizeof(FontData));
-		for(size_t i = 0; i < font.num_glyphs; i++) {
-			auto& glyph = glyphs[i];
-			size_t glyph_size = sizeof(FontGlyph) + (glyph->width * glyph->height * sizeof(uint32_t));
-			memcpy(cptr, glyph.get(), glyph_size);
-			cptr = (void*) ((size_t) cptr + glyph_size);
+Font* Font::load_shm(const char* path) {
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) {
+		perror("Couldn't open font");
+		return nullptr;
+	}
+
+	struct stat statbuf;
+	if(fstat(fd, &statbuf) < 0 || (size_t) statbuf.st_size < sizeof(FontData)) {
+		fprintf(stderr, "Couldn't load font: Invalid font file\n");
+		close(fd);
+		return nullptr;
+	}
+
+	shm fontshm;
+	if(shmcreate(nullptr, statbuf.st_size, &fontshm) < 0) {
+		perror("Couldn't load font: Couldn't create shared memory region");
+		close(fd);
+		return nullptr;
+	}
+
+	size_t nread = 0;
+	while(nread < (size_t) statbuf.st_size) {
+		ssize_t ret = read(fd, (uint8_t*) fontshm.ptr + nread, statbuf.st_size - nread);
+		if(ret <= 0) {
+			perror("Couldn't read font");
+			close(fd);
+			shmdetach(fontshm.id);
+			return nullptr;
 		}
+		nread += ret;
 	}
+	close(fd);
 
-	return load_from_shm(fontshm);
+	auto* font = load_from_shm(fontshm);
+	if(!font)
+		shmdetach(fontshm.id);
+	return font;
 }
 
 Font* Font::load_from_shm(shm fontshm) {
-	if(memcmp(fontshm.ptr, "@FONT", 5) != 0) {
+	auto* font_data = (FontData*) fontshm.ptr;
+	if(fontshm.size < sizeof(FontData) || memcmp(font_data->MAGIC, "@FONT", 5) != 0) {
 		fprintf(stderr, "Couldn't load font from shm: magic mismatch\n");
 		return nullptr;
 	}
 
+	if(font_data->version != FONT_FORMAT_VERSION) {
+		fprintf(stderr, "Couldn't load font from shm: unsupported version %u\n", font_data->version);
+		return nullptr;
+	}
+
+	if(font_data->num_glyphs < 0 || fontshm.size < sizeof(FontData) + font_data->num_glyphs * sizeof(FontGlyph) + font_data->masks_size) {
+		fprintf(stderr, "Couldn't load font from shm: font is truncated\n");
+		return nullptr;
+	}
+
+	for(int i = 0; i < font_data->num_glyphs; i++) {
+		auto& glyph = font_data->glyphs[i];
+		if(glyph.width < 0 || glyph.height < 0 || glyph.mask_offset + (size_t) glyph.width * glyph.height > font_data->masks_size) {
+			fprintf(stderr, "Couldn't load font from shm: glyph %u is out of bounds\n", glyph.codepoint);
+			return nullptr;
+		}
+	}
+
 	return new Font(fontshm);
 }
 
 Font::Font(shm fontshm): fontshm(fontshm), uses_shm(true) {
 	data = (FontData*) fontshm.ptr;
+	masks = (const uint8_t*) &data->glyphs[data->num_glyphs];
 
-	//Read glyphs into map
-	FontGlyph* gptr = data->glyphs;
-	for(size_t i = 0; i < data->num_glyphs; i++) {
-		glyphs[gptr->codepoint] = gptr;
-		size_t glyph_size = sizeof(FontGlyph) + (gptr->width * gptr->height * sizeof(uint32_t));
-		gptr = (FontGlyph*) ((size_t) gptr + glyph_size);
-	}
+	//Use REPLACEMENT CHARACTER for unknown glyphs, or a blank glyph if there isn't one
+	unknown_glyph = {&blank_glyph, masks};
+	auto replacement = find_glyph(0xFFFD);
+	if(replacement.glyph)
+		unknown_glyph = replacement;
 
-	//Create the unknown character glyph
-	if(glyphs[0xFFFD]) { //REPLACEMENT CHARACTER
-		size_t glyph_size = sizeof(FontGlyph) + (glyphs[0xFFFD]->width * glyphs[0xFFFD]->height * sizeof(uint32_t));
-		unknown_glyph = (FontGlyph*) malloc(glyph_size);
-		memcpy(unknown_glyph, glyphs[0xFFFD], glyph_size);
-	} else {
-		//Don't have REPLACEMENT CHARACTER, just make a blank glyph
-		unknown_glyph = new FontGlyph;
+	for(uint32_t codepoint = 0; codepoint < 256; codepoint++) {
+		auto entry = find_glyph(codepoint);
+		latin1_glyphs[codepoint] = entry.glyph ? entry : unknown_glyph;
 	}
-
 }
 
 Font::~Font() {
@@ -234,8 +280,6 @@ Font::~Font() {
 	} else {
 		delete data;
 	}
-
-	delete unknown_glyph;
 }
 
 FontData::BoundingBox Font::bounding_box() {
@@ -251,11 +295,33 @@ int Font::shm_id() {
 }
 
 FontGlyph* Font::glyph(uint32_t codepoint) {
-	auto* glyph = glyphs[codepoint];
-	return glyph ? glyph : unknown_glyph;
+	return atlas_glyph(codepoint).glyph;
+}
+
+AtlasGlyph Font::atlas_glyph(uint32_t codepoint) {
+	if(codepoint < 256)
+		return latin1_glyphs[codepoint];
+	auto found = find_glyph(codepoint);
+	return found.glyph ? found : unknown_glyph;
+}
+
+AtlasGlyph Font::find_glyph(uint32_t codepoint) {
+	FontGlyph* begin = data->glyphs;
+	FontGlyph* end = data->glyphs + data->num_glyphs;
+	FontGlyph* glyph = std::lower_bound(begin, end, codepoint, [](const FontGlyph& glyph, uint32_t codepoint) {
+		return glyph.codepoint < codepoint;
+	});
+	if(glyph == end || glyph->codepoint != codepoint)
+		return {};
+	return {glyph, masks + glyph->mask_offset};
 }
 
 Dimensions Font::size_of(const char* string) {
+	std::string key = string;
+	auto cached = size_cache.find(key);
+	if(cached != size_cache.end())
+		return cached->second;
+
 	Rect bounding_box = {0, 0, 0, this->bounding_box().height};
 	Point cpos = {0, 0};
 	while(*string) {
@@ -272,6 +338,11 @@ Dimensions Font::size_of(const char* string) {
 		cpos = cpos + Point {glph->next_offset.x, glph->next_offset.y};
 		string++;
 	}
+
+	//Don't let the cache grow forever if something measures lots of different strings
+	if(size_cache.size() >= 1024)
+		size_cache.clear();
+	size_cache[std::move(key)] = bounding_box.dimensions();
 	return bounding_box.dimensions();
 }
 
@@ -23,9 +23,14 @@
 #include <cstdint>
 #include <sys/shm.h>
 #include <map>
+#include <vector>
+#include <string>
+#include <unordered_map>
 #include "Graphics.h"
 #include "Geometry.h"
 
+#define FONT_FORMAT_VERSION 1
+
 namespace Gfx {
 	struct FontGlyph {
 		uint32_t codepoint = -1;
@@ -40,11 +45,16 @@ namespace Gfx {
 			int y = 0;
 		} next_offset; ///< The offset of the next glyph from the origin of this glyph
 
-		Color bitmap[]; ///< The actual pixels making up the glyph. Should be grayscale.
+		uint32_t mask_offset = 0; ///< Where the glyph's alpha mask is in the font's masks, which has one byte per pixel.
 	};
 
+	/**
+	 * The binary font format, which is also how fonts are laid out in the shared memory pond gives clients. It's this
+	 * header, then num_glyphs glyphs sorted by codepoint, and then masks_size bytes of the glyphs' alpha masks.
+	 */
 	struct FontData {
 		char MAGIC[6] = "@FONT";
+		uint32_t version = FONT_FORMAT_VERSION;
 		char id[128];
 		int size;
 		typedef struct {
@@ -55,13 +65,33 @@ namespace Gfx {
 		} BoundingBox;
 		BoundingBox bounding_box;
 		int num_glyphs;
+		uint32_t masks_size;
 		FontGlyph glyphs[];
 	};
 
+	/// A glyph along with its alpha mask in the font's masks, which has one byte per pixel going row by row.
+	struct AtlasGlyph {
+		FontGlyph* glyph = nullptr;
+		const uint8_t* mask = nullptr;
+	};
+
 	class Font {
 	public:
+		/**
+		 * Parses a BDF font into the binary font format.
+		 * @param path The path of the BDF font.
+		 * @param font_data Where to put the font in the binary format.
+		 * @return Whether the font could be parsed.
+		 */
+		static bool compile_bdf(const char* path, std::vector<uint8_t>& font_data);
+
 		static Font* load_bdf_shm(const char* path);
 
+		/**
+		 * Loads a font in the binary format into shared memory, which only takes reading it straight into the shm.
+		 */
+		static Font* load_shm(const char* path);
+
 		static Font* load_from_shm(shm shm);
 
 		int size();
@@ -72,6 +102,11 @@ namespace Gfx {
 
 		FontGlyph* glyph(uint32_t codepoint);
 
+		AtlasGlyph atlas_glyph(uint32_t codepoint);
+
+		/**
+		 * Measures a string. The results are cached, since layout tends to measure the same strings over and over.
+		 */
 		Dimensions size_of(const char* string);
 
 	private:
@@ -79,11 +114,17 @@ namespace Gfx {
 
 		~Font();
 
+		static Font* create_shm(const std::vector<uint8_t>& font_data);
+		AtlasGlyph find_glyph(uint32_t codepoint);
+
 		bool uses_shm = false;
 		shm fontshm = {nullptr, 0, 0};
 		FontData* data;
-		std::map<uint32_t, FontGlyph*> glyphs;
-		FontGlyph* unknown_glyph;
+		const uint8_t* masks;
+		AtlasGlyph latin1_glyphs[256]; ///< Looked up directly instead of searching the glyphs, since they're most of the text drawn.
+		FontGlyph blank_glyph;
+		AtlasGlyph unknown_glyph;
+		std::unordered_map<std::string, Dimensions> size_cache;
 	};
 }
 
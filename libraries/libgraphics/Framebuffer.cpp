@@ -22,16 +22,21 @@
 #include "Font.h"
 #include "Memory.h"
 #include "Geometry.h"
+#include "Blend.h"
+#include <vector>
+
+//Fills at least this big are written around the cache, since they'd push everything else out of it anyway
+#define FILL_NON_TEMPORAL_SIZE (512 * 1024)
 
 using namespace Gfx;
 
 Framebuffer::Framebuffer(): data(nullptr), width(0), height(0) {}
 Framebuffer::Framebuffer(Color* buffer, int width, int height): data(buffer), width(width), height(height) {}
 Framebuffer::Framebuffer(int width, int height): data(new Color[width * height]), width(width), height(height), should_free(true) {}
-Framebuffer::Framebuffer(Framebuffer&& other) noexcept: data(other.data), width(other.width), height(other.height), should_free(other.should_free) {
+Framebuffer::Framebuffer(Framebuffer&& other) noexcept: data(other.data), width(other.width), height(other.height), should_free(other.should_free), premultiplied(other.premultiplied), damage(other.damage) {
 	other.data = nullptr;
 }
-Framebuffer::Framebuffer(Framebuffer& other) noexcept: data(other.data), width(other.width), height(other.height), should_free(false) {}
+Framebuffer::Framebuffer(Framebuffer& other) noexcept: data(other.data), width(other.width), height(other.height), should_free(false), premultiplied(other.premultiplied), damage(other.damage) {}
 
 Framebuffer::~Framebuffer() noexcept {
 	if(should_free)
@@ -45,6 +50,8 @@ Framebuffer& Framebuffer::operator=(const Framebuffer& other) {
 	height = other.height;
 	data = other.data;
 	should_free = false;
+	premultiplied = other.premultiplied;
+	damage = other.damage;
 	return *this;
 }
 
@@ -55,6 +62,8 @@ Framebuffer& Framebuffer::operator=(Framebuffer&& other) noexcept {
 	height = other.height;
 	data = other.data;
 	should_free = other.should_free;
+	premultiplied = other.premultiplied;
+	damage = other.damage;
 	other.data = nullptr;
 	return *this;
 }
@@ -66,6 +75,72 @@ void Framebuffer::free() {
 	}
 }
 
+void Framebuffer::premultiply() {
+	if(premultiplied)
+		return;
+	premultiply_row(data, data, width * height);
+	premultiplied = true;
+	mark_damaged({0, 0, width, height});
+}
+
+void Framebuffer::unpremultiply() {
+	if(!premultiplied)
+		return;
+	unpremultiply_row(data, data, width * height);
+	premultiplied = false;
+	mark_damaged({0, 0, width, height});
+}
+
+Framebuffer Framebuffer::halved() const {
+	Framebuffer ret(width / 2, height / 2);
+	ret.premultiplied = true;
+	std::vector<Color> rows;
+	if(!premultiplied)
+		rows.resize(ret.width * 4);
+	for(int y = 0; y < ret.height; y++) {
+		const Color* row_a = &data[y * 2 * width];
+		const Color* row_b = row_a + width;
+		if(!premultiplied) {
+			premultiply_row(&rows[0], row_a, ret.width * 2);
+			premultiply_row(&rows[ret.width * 2], row_b, ret.width * 2);
+			row_a = &rows[0];
+			row_b = &rows[ret.width * 2];
+		}
+		halve_rows(&ret.data[y * ret.width], row_a, row_b, ret.width);
+	}
+	return ret;
+}
+
+/**
+ * Blends a row of pixels from one framebuffer onto another. Straight alpha pixels being blended onto a premultiplied
+ * framebuffer are premultiplied a chunk at a time on the way.
+ */
+static void blend_row_between(const Framebuffer& dest_buffer, Color* dest, const Framebuffer& src_buffer, const Color* src, size_t count) {
+	if(src_buffer.premultiplied) {
+		blend_row_premultiplied(dest, src, count);
+	} else if(dest_buffer.premultiplied) {
+		Color chunk[64];
+		while(count) {
+			size_t chunk_size = count < 64 ? count : 64;
+			premultiply_row(chunk, src, chunk_size);
+			blend_row_premultiplied(dest, chunk, chunk_size);
+			dest += chunk_size;
+			src += chunk_size;
+			count -= chunk_size;
+		}
+	} else {
+		blend_row(dest, src, count);
+	}
+}
+
+static inline Color blend_pixel_between(const Framebuffer& dest_buffer, Color dest, const Framebuffer& src_buffer, Color src) {
+	if(src_buffer.premultiplied)
+		return dest.blended_premultiplied(src);
+	if(dest_buffer.premultiplied)
+		return dest.blended_premultiplied(src.premultiplied());
+	return dest.blended(src);
+}
+
 void Framebuffer::copy(const Framebuffer& other, Rect other_area, const Point& pos) const {
 	//Make sure self_area is in bounds of the framebuffer
 	Rect self_area = {pos.x, pos.y, other_area.width, other_area.height};
@@ -78,6 +153,7 @@ void Framebuffer::copy(const Framebuffer& other, Rect other_area, const Point& p
 	other_area.y += self_area.y - pos.y;
 	other_area.width = self_area.width;
 	other_area.height = self_area.height;
+	mark_damaged(self_area);
 
 	for(int y = 0; y < self_area.height; y++) {
 		memcpy_uint32((uint32_t*) &data[self_area.x + (self_area.y + y) * width], (uint32_t*) &other.data[other_area.x + (other_area.y + y) * other.width], self_area.width);
@@ -96,6 +172,7 @@ void Framebuffer::copy_noalpha(const Framebuffer& other, Rect other_area, const
 	other_area.y += self_area.y - pos.y;
 	other_area.width = self_area.width;
 	other_area.height = self_area.height;
+	mark_damaged(self_area);
 
 	for(int y = 0; y < self_area.height; y++) {
 		for(int x = 0; x < self_area.width; x++) {
@@ -116,14 +193,10 @@ void Framebuffer::copy_blitting(const Framebuffer& other, Rect other_area, const
 	other_area.y += self_area.y - pos.y;
 	other_area.width = self_area.width;
 	other_area.height = self_area.height;
+	mark_damaged(self_area);
 
-	for(int y = 0; y < self_area.height; y++) {
-		for(int x = 0; x < self_area.width; x++) {
-			auto& this_val = data[(self_area.x + x) + (self_area.y + y) * width];
-			auto& other_val = other.data[(other_area.x + x) + (other_area.y + y) * other.width];
-			this_val = this_val.blended(other_val);
-		}
-	}
+	for(int y = 0; y < self_area.height; y++)
+		blend_row_between(*this, &data[self_area.x + (self_area.y + y) * width], other, &other.data[other_area.x + (other_area.y + y) * other.width], self_area.width);
 }
 
 void Framebuffer::copy_blitting_flipped(const Framebuffer& other, Rect other_area, const Point& pos, bool flip_h, bool flip_v) const {
@@ -138,15 +211,22 @@ void Framebuffer::copy_blitting_flipped(const Framebuffer& other, Rect other_are
 	other_area.y += self_area.y - pos.y;
 	other_area.width = self_area.width;
 	other_area.height = self_area.height;
+	mark_damaged(self_area);
 
 	for(int y = 0; y < self_area.height; y++) {
+		//Without a horizontal flip, each row is still a straight run of pixels from the other image
+		if(!flip_h) {
+			int other_y = other_area.y + (flip_v ? other_area.height - y - 1 : y);
+			blend_row_between(*this, &data[self_area.x + (self_area.y + y) * width], other, &other.data[other_area.x + other_y * other.width], self_area.width);
+			continue;
+		}
 		for(int x = 0; x < self_area.width; x++) {
 			auto& this_val = data[(self_area.x + x) + (self_area.y + y) * width];
 			auto& other_val = other.data[
 				 other_area.x + (flip_h ? other_area.width - x - 1 : x) +
 				(other_area.y + (flip_v ? other_area.height - y - 1 : y)) * other.width
 			];
-			this_val = this_val.blended(other_val);
+			this_val = blend_pixel_between(*this, this_val, other, other_val);
 		}
 	}
 }
@@ -163,6 +243,7 @@ void Framebuffer::copy_tiled(const Framebuffer& other, Rect other_area, const Po
 	other_area.y += self_area.y - pos.y;
 	other_area.width = self_area.width;
 	other_area.height = self_area.height;
+	mark_damaged(self_area);
 
 	for(int y = 0; y < self_area.height; y++) {
 		for(int x = 0; x < self_area.width; x++) {
@@ -183,48 +264,129 @@ void Framebuffer::draw_image(const Framebuffer& other, Rect other_area, const Po
 	other_area.y += self_area.y - pos.y;
 	other_area.width = self_area.width;
 	other_area.height = self_area.height;
+	mark_damaged(self_area);
 
-	for(int y = 0; y < self_area.height; y++) {
-		for(int x = 0; x < self_area.width; x++) {
-			auto& this_val = data[(self_area.x + x) + (self_area.y + y) * width];
-			auto& other_val = other.data[(other_area.x + x) + (other_area.y + y) * other.width];
-			this_val = this_val.blended(other_val);
-		}
-	}
+	for(int y = 0; y < self_area.height; y++)
+		blend_row_between(*this, &data[self_area.x + (self_area.y + y) * width], other, &other.data[other_area.x + (other_area.y + y) * other.width], self_area.width);
 }
 
 void Framebuffer::draw_image(const Framebuffer& other, const Point& pos) const {
 	draw_image(other, {0, 0, other.width, other.height}, pos);
 }
 
-void Framebuffer::draw_image_scaled(const Framebuffer& other, const Rect& rect) const {
+void Framebuffer::draw_image_scaled(const Framebuffer& other, const Rect& rect, ScaleMode mode) const {
 	if(rect.width == other.width && rect.height == other.height) {
 		draw_image(other, rect.position());
 		return;
 	}
 
-	double scale_x = (double) rect.width / (double) other.width;
-	double scale_y = (double) rect.height / (double) other.height;
+	if(rect.width <= 0 || rect.height <= 0 || other.width <= 0 || other.height <= 0)
+		return;
 
 	//Make sure self_area is in bounds of the framebuffer
 	Rect self_area = rect;
 	self_area = self_area.overlapping_area({0, 0, width, height});
 	if(self_area.empty())
 		return;
+	mark_damaged(self_area);
+
+	//Positions in the other image are stepped through in 16.16 fixed point, sampling at the middle of each pixel drawn
+	int32_t step_x = (int32_t) (((int64_t) other.width << 16) / rect.width);
+	int32_t step_y = (int32_t) (((int64_t) other.height << 16) / rect.height);
+	int32_t start_x = (self_area.x - rect.x) * step_x + step_x / 2;
+	int32_t start_y = (self_area.y - rect.y) * step_y + step_y / 2;
+
+	if(mode == ScaleMode::NearestNeighbor) {
+		std::vector<Color> row(self_area.width);
+		for(int y = 0; y < self_area.height; y++) {
+			const Color* other_row = &other.data[((start_y + y * step_y) >> 16) * other.width];
+			int32_t other_x = start_x;
+			for(int x = 0; x < self_area.width; x++, other_x += step_x)
+				row[x] = other_row[other_x >> 16];
+			blend_row_between(*this, &data[self_area.x + (self_area.y + y) * width], other, row.data(), self_area.width);
+		}
+		return;
+	}
 
-	//Update other area with the changes made to self_area
-	DoubleRect other_area = {0, 0, (float) other.width, (float) other.height};
-	other_area.x += (self_area.x - rect.x) / scale_x;
-	other_area.y += (self_area.y - rect.y) / scale_y;
-	other_area.width = self_area.width / scale_x;
-	other_area.height = self_area.height / scale_y;
+	/*
+	 * Bilinear sampling mixes each pair of rows it needs together a whole row at a time, and then mixes each pixel in the
+	 * result with the one to its right. The rows are premultiplied first so transparent pixels don't bleed their color
+	 * into the ones next to them, and the result is blended as premultiplied pixels even onto straight alpha ones, which
+	 * comes out the same as blending the straight alpha colors would (give or take rounding).
+	 */
+	auto sample = [](int32_t pos, int size, int& index, unsigned int& weight) {
+		pos -= 0x8000;
+		index = pos < 0 ? 0 : pos >> 16;
+		weight = pos < 0 ? 0 : (pos >> 8) & 0xFF;
+		if(index >= size - 1) {
+			index = size - 1;
+			weight = 0;
+		}
+	};
+
+	//Work out which pixels each column mixes together, as offsets into the span of the other image's rows that's used
+	std::vector<int> columns(self_area.width);
+	std::vector<uint8_t> column_weights(self_area.width);
+	int span_start, span_end;
+	unsigned int unused_weight;
+	sample(start_x, other.width, span_start, unused_weight);
+	sample(start_x + (self_area.width - 1) * step_x, other.width, span_end, unused_weight);
+	if(span_end + 1 < other.width)
+		span_end++;
+	for(int x = 0; x < self_area.width; x++) {
+		int index;
+		unsigned int weight;
+		sample(start_x + x * step_x, other.width, index, weight);
+		columns[x] = index - span_start;
+		column_weights[x] = weight;
+	}
 
+	//Each row has an extra pixel on the end, so a column at the right edge of the other image has something to mix with
+	size_t span = span_end - span_start + 1;
+	std::vector<Color> rows((span + 1) * 3);
+	Color* row_a = &rows[0];
+	Color* row_b = &rows[span + 1];
+	Color* mixed = &rows[(span + 1) * 2];
+	int row_a_index = -1, row_b_index = -1;
+	auto load_row = [&](Color* row, int index) {
+		const Color* other_row = &other.data[span_start + index * other.width];
+		if(other.premultiplied)
+			memcpy_uint32((uint32_t*) row, (uint32_t*) other_row, span);
+		else
+			premultiply_row(row, other_row, span);
+		row[span] = row[span - 1];
+	};
+
+	std::vector<Color> out(self_area.width);
 	for(int y = 0; y < self_area.height; y++) {
-		for(int x = 0; x < self_area.width; x++) {
-			auto& this_val = data[(self_area.x + x) + (self_area.y + y) * width];
-			auto& other_val = other.data[(int) (other_area.x + x / scale_x) + (int) (other_area.y + y / scale_y) * other.width];
-			this_val = this_val.blended(other_val);
+		int index;
+		unsigned int weight;
+		sample(start_y + y * step_y, other.height, index, weight);
+		int next_index = index + 1 < other.height ? index + 1 : index;
+
+		//Moving down usually needs the same rows or the next one, so rows are only loaded when they weren't already
+		if(row_a_index != index) {
+			if(row_b_index == index) {
+				std::swap(row_a, row_b);
+				std::swap(row_a_index, row_b_index);
+			} else {
+				load_row(row_a, index);
+				row_a_index = index;
+			}
+		}
+		if(weight && row_b_index != next_index) {
+			load_row(row_b, next_index);
+			row_b_index = next_index;
 		}
+
+		const Color* row = row_a;
+		if(weight) {
+			lerp_rows(mixed, row_a, row_b, weight, span + 1);
+			row = mixed;
+		}
+		for(int x = 0; x < self_area.width; x++)
+			out[x] = row[columns[x]].lerped(row[columns[x] + 1], column_weights[x]);
+		blend_row_premultiplied(&data[self_area.x + (self_area.y + y) * width], out.data(), self_area.width);
 	}
 }
 
@@ -233,12 +395,13 @@ void Framebuffer::fill(Rect area, Color color) const {
 	area = area.overlapping_area({0, 0, width, height});
 	if(area.empty())
 		return;
+	mark_damaged(area);
 
-	for(int y = 0; y < area.height; y++) {
-		for(int x = 0; x < area.width; x++) {
-			data[x + area.x + (area.y + y) * width] = color;
-		}
-	}
+	if(premultiplied)
+		color = color.premultiplied();
+	bool non_temporal = (size_t) area.width * area.height * sizeof(Color) >= FILL_NON_TEMPORAL_SIZE;
+	for(int y = 0; y < area.height; y++)
+		fill_row(&data[area.x + (area.y + y) * width], color, area.width, non_temporal);
 }
 
 void Framebuffer::fill_blitting(Rect area, Color color) const {
@@ -246,38 +409,64 @@ void Framebuffer::fill_blitting(Rect area, Color color) const {
 	area = area.overlapping_area({0, 0, width, height});
 	if(area.empty())
 		return;
+	mark_damaged(area);
 
-	unsigned int alpha = COLOR_A(color) + 1;
-	unsigned int inv_alpha = 256 - COLOR_A(color);
-	unsigned int premultiplied_r = alpha * COLOR_R(color);
-	unsigned int premultiplied_g = alpha * COLOR_G(color);
-	unsigned int premultiplied_b = alpha * COLOR_B(color);
-	unsigned int premultiplied_a = alpha * COLOR_A(color);
+	if(!premultiplied) {
+		for(int y = 0; y < area.height; y++)
+			blend_row(&data[area.x + (area.y + y) * width], color, area.width);
+		return;
+	}
 
+	//Blending onto premultiplied pixels is done with a row of the premultiplied color
+	Color chunk[64];
+	Color premultiplied_color = color.premultiplied();
+	for(auto& pixel : chunk)
+		pixel = premultiplied_color;
 	for(int y = 0; y < area.height; y++) {
-		for(int x = 0; x < area.width; x++) {
-			auto this_val = data[(area.x + x) + (area.y + y) * width];
-			data[(area.x + x) + (area.y + y) * width] = RGBA(
-					(uint8_t)((premultiplied_r + inv_alpha * COLOR_R(this_val)) >> 8),
-					(uint8_t)((premultiplied_g + inv_alpha * COLOR_G(this_val)) >> 8),
-					(uint8_t)((premultiplied_b + inv_alpha * COLOR_B(this_val)) >> 8),
-					(uint8_t)((premultiplied_a + inv_alpha * COLOR_A(this_val)) >> 8));
+		for(int x = 0; x < area.width; x += 64) {
+			int chunk_size = area.width - x < 64 ? area.width - x : 64;
+			blend_row_premultiplied(&data[area.x + x + (area.y + y) * width], chunk, chunk_size);
 		}
 	}
 }
 
 void Framebuffer::fill_gradient_h(Rect area, Color color_a, Color color_b) const {
-	if(color_a == color_b)
+	if(color_a == color_b) {
 		fill(area, color_a);
-	for(int x = 0; x < area.width; x++)
-		fill({area.x + x, area.y, 1, area.height}, color_a.mixed(color_b, (float) x / area.width));
+		return;
+	}
+
+	Rect self_area = area.overlapping_area({0, 0, width, height});
+	if(self_area.empty())
+		return;
+	mark_damaged(self_area);
+
+	//Every row is the same, so work out the colors once and copy them to each row
+	std::vector<Color> row(self_area.width);
+	for(int x = 0; x < self_area.width; x++) {
+		auto color = color_a.mixed(color_b, (float) (self_area.x - area.x + x) / area.width);
+		row[x] = premultiplied ? color.premultiplied() : color;
+	}
+	for(int y = 0; y < self_area.height; y++)
+		memcpy_uint32((uint32_t*) &data[self_area.x + (self_area.y + y) * width], (uint32_t*) row.data(), self_area.width);
 }
 
 void Framebuffer::fill_gradient_v(Rect area, Color color_a, Color color_b) const {
-	if(color_a == color_b)
+	if(color_a == color_b) {
 		fill(area, color_a);
-	for(int y = 0; y < area.height; y++)
-		fill({area.x, area.y + y, area.width, 1}, color_a.mixed(color_b, (float) y / area.height));
+		return;
+	}
+
+	Rect self_area = area.overlapping_area({0, 0, width, height});
+	if(self_area.empty())
+		return;
+	mark_damaged(self_area);
+
+	//Each row is one color, so only the rows that are visible need their colors worked out
+	for(int y = 0; y < self_area.height; y++) {
+		auto color = color_a.mixed(color_b, (float) (self_area.y - area.y + y) / area.height);
+		fill_row(&data[self_area.x + (self_area.y + y) * width], premultiplied ? color.premultiplied() : color, self_area.width);
+	}
 }
 
 void Framebuffer::outline(Rect area, Color color) const {
@@ -295,26 +484,61 @@ void Framebuffer::outline_blitting(Rect area, Color color) const {
 }
 
 void Framebuffer::draw_text(const char* str, const Point& pos, Font* font, Color color) const {
+	//Work out where each glyph goes, so that their masks can be put together and the whole run blended a row at a time
+	struct PlacedGlyph {
+		AtlasGlyph glyph;
+		Rect rect;
+	};
+	std::vector<PlacedGlyph> placed;
+	Rect run_area = {pos, 0, 0};
 	Point current_pos = pos;
 	while(*str) {
-		current_pos = draw_glyph(font, *str, current_pos, color);
+		auto atlas_glyph = font->atlas_glyph(*str);
+		auto* glyph = atlas_glyph.glyph;
+		Rect rect = {
+			current_pos.x + glyph->base_x - font->bounding_box().base_x,
+			current_pos.y + (font->bounding_box().base_y - glyph->base_y) + (font->size() - glyph->height),
+			glyph->width, glyph->height
+		};
+		if(rect.width > 0 && rect.height > 0) {
+			run_area = placed.empty() ? rect : run_area.combine(rect);
+			placed.push_back({atlas_glyph, rect});
+		}
+		current_pos = current_pos + Point {glyph->next_offset.x, glyph->next_offset.y};
 		str++;
 	}
+
+	//Make sure run_area is in bounds of the framebuffer
+	run_area = run_area.overlapping_area({0, 0, width, height});
+	if(placed.empty() || run_area.width <= 0 || run_area.height <= 0)
+		return;
+	mark_damaged(run_area);
+
+	std::vector<uint8_t> mask(run_area.width * run_area.height);
+	for(auto& glyph : placed) {
+		Rect area = glyph.rect.overlapping_area(run_area);
+		if(area.width <= 0 || area.height <= 0)
+			continue;
+		for(int y = 0; y < area.height; y++) {
+			const uint8_t* glyph_row = &glyph.glyph.mask[(area.x - glyph.rect.x) + (area.y - glyph.rect.y + y) * glyph.rect.width];
+			uint8_t* mask_row = &mask[(area.x - run_area.x) + (area.y - run_area.y + y) * run_area.width];
+			for(int x = 0; x < area.width; x++)
+				mask_row[x] = std::max(mask_row[x], glyph_row[x]);
+		}
+	}
+
+	for(int y = 0; y < run_area.height; y++)
+		blend_row_masked(&data[run_area.x + (run_area.y + y) * width], color, &mask[y * run_area.width], run_area.width);
 }
 
 Point Framebuffer::draw_glyph(Font* font, uint32_t codepoint, const Point& glyph_pos, Color color) const {
-	auto* glyph = font->glyph(codepoint);
+	auto atlas_glyph = font->atlas_glyph(codepoint);
+	auto* glyph = atlas_glyph.glyph;
 	int y_offset = (font->bounding_box().base_y - glyph->base_y) + (font->size() - glyph->height);
 	int x_offset = glyph->base_x - font->bounding_box().base_x;
 	Point pos = {glyph_pos.x + x_offset, glyph_pos.y + y_offset};
 	Rect glyph_area = {0, 0, glyph->width, glyph->height};
 
-	//Calculate the color multipliers
-	double r_mult = COLOR_R(color) / 255.0;
-	double g_mult = COLOR_G(color) / 255.0;
-	double b_mult = COLOR_B(color) / 255.0;
-	double alpha_mult = COLOR_A(color) / 255.0;
-
 	//Make sure self_area is in bounds of the framebuffer
 	Rect self_area = {pos.x, pos.y, glyph_area.width, glyph_area.height};
 	self_area = self_area.overlapping_area({0, 0, width, height});
@@ -326,31 +550,20 @@ Point Framebuffer::draw_glyph(Font* font, uint32_t codepoint, const Point& glyph
 	glyph_area.y += self_area.y - pos.y;
 	glyph_area.width = self_area.width;
 	glyph_area.height = self_area.height;
+	mark_damaged(self_area);
 
-	for(int y = 0; y < self_area.height; y++) {
-		for(int x = 0; x < self_area.width; x++) {
-			auto& this_val = data[(self_area.x + x) + (self_area.y + y) * width];
-			auto& other_val = glyph->bitmap[(glyph_area.x + x) + (glyph_area.y + y) * glyph->width];
-			double alpha = (COLOR_A(other_val) / 255.00) * alpha_mult;
-			if(alpha == 0)
-				continue;
-			double oneminusalpha = 1.00 - alpha;
-			this_val = RGB(
-					(uint8_t) (COLOR_R(this_val) * oneminusalpha + COLOR_R(other_val) * alpha * r_mult),
-					(uint8_t) (COLOR_G(this_val) * oneminusalpha + COLOR_G(other_val) * alpha * g_mult),
-					(uint8_t) (COLOR_B(this_val) * oneminusalpha + COLOR_B(other_val) * alpha * b_mult));
-		}
-	}
+	for(int y = 0; y < self_area.height; y++)
+		blend_row_masked(&data[self_area.x + (self_area.y + y) * width], color, &atlas_glyph.mask[glyph_area.x + (glyph_area.y + y) * glyph->width], self_area.width);
 
 	return glyph_pos + Point {glyph->next_offset.x, glyph->next_offset.y};
 }
 
 void Framebuffer::multiply(Color color) {
-	for(int y = 0; y < height; y++) {
-		for(int x = 0; x < width; x++) {
-			data[x + y * width] *= color;
-		}
-	}
+	//Premultiplied color channels also get multiplied by the alpha being multiplied by
+	if(premultiplied)
+		color = {(uint8_t) (color.r * color.a / 255), (uint8_t) (color.g * color.a / 255), (uint8_t) (color.b * color.a / 255), color.a};
+	mark_damaged({0, 0, width, height});
+	multiply_row(data, color, (size_t) width * height);
 }
 
 Color* Framebuffer::at(const Point& position) const {
@@ -389,5 +602,6 @@ void Framebuffer::deserialize(const uint8_t*& buf) {
 		memcpy_uint32((uint32_t*) data, serialization->data, width * height);
 	}
 	should_free = true;
+	premultiplied = false;
 	buf += serialized_size();
 }
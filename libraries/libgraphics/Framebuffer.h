@@ -22,6 +22,7 @@
 #include <sys/types.h>
 #include "Geometry.h"
 #include "Color.h"
+#include "Damage.h"
 #include <libduck/Serializable.h>
 
 #define IMGSIZE(width, height) (sizeof(uint32_t) * (width) * (height))
@@ -30,6 +31,12 @@
 
 namespace Gfx {
 	class Font;
+
+	enum class ScaleMode {
+		NearestNeighbor, ///< Each pixel drawn is just the nearest pixel in the image. Fast, and keeps pixel art crisp.
+		Bilinear ///< Each pixel drawn is mixed from the four nearest pixels in the image. Meant for shrinking things by up to half.
+	};
+
 	class Framebuffer: public Duck::Serializable {
 	public:
 		Framebuffer();
@@ -47,11 +54,51 @@ namespace Gfx {
 		int height = 0;
 		bool should_free = false;
 
+		/**
+		 * Whether the pixels have premultiplied alpha, in which case blending them onto something is a single multiply-add
+		 * per channel. The blending, filling, multiplying and text drawing functions take care of converting between the
+		 * two, but copying just writes pixels as they are.
+		 */
+		bool premultiplied = false;
+
+		/**
+		 * If set, every drawing function marks the area it draws to as damaged in this tracker. The Framebuffer doesn't
+		 * own it, and copies of the Framebuffer (which share its pixels) mark the same tracker.
+		 */
+		DamageTracker* damage = nullptr;
+
+		/**
+		 * Marks an area of the Image as damaged, if it has a damage tracker. Anything that writes to the pixels itself
+		 * instead of through the drawing functions should call this.
+		 * @param area The area that was drawn to.
+		 */
+		inline void mark_damaged(const Rect& area) const {
+			if(damage)
+				damage->add(area);
+		}
+
 		/**
 		 * Frees the data associated with the Image.
 		 */
 		void free();
 
+		/**
+		 * Converts the Image to premultiplied alpha, if it isn't already.
+		 */
+		void premultiply();
+
+		/**
+		 * Converts the Image back to straight alpha, if it's premultiplied.
+		 */
+		void unpremultiply();
+
+		/**
+		 * Makes a copy of the Image at half the size (rounded down), where each pixel is the average of a 2x2 block of
+		 * pixels. The copy is premultiplied, so transparent pixels don't darken the ones next to them.
+		 * @return The shrunken copy of the Image.
+		 */
+		Framebuffer halved() const;
+
 		/**
 		 * Copies a part of another Image to this one.
 		 * @param other The other Image to copy from.
@@ -111,8 +158,9 @@ namespace Gfx {
 		 * fit inside of the specified rect.
 		 * @param other The Image to draw.
 		 * @param size The rect on this Image to scale the image to and draw on.
+		 * @param mode How to sample the other Image.
 		 */
-		void draw_image_scaled(const Framebuffer& other, const Rect& rect) const;
+		void draw_image_scaled(const Framebuffer& other, const Rect& rect, ScaleMode mode = ScaleMode::NearestNeighbor) const;
 
 		/**
 		 * Fills an area of the Image with a color.
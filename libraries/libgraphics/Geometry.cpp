@@ -17,4 +17,151 @@
 	Copyright (c) Byteduck 2016-2021. All rights reserved.
 */
 
-#include "Geometry.h"
\ No newline at end of file
+#include "Geometry.h"
+
+using namespace Gfx;
+
+namespace {
+	struct Span {
+		int start;
+		int end;
+	};
+
+	//Gets the spans of the band in a region that covers a row, skipping bands above it starting from pos.
+	void band_spans(const std::vector<Rect>& rects, size_t& pos, int top, std::vector<Span>& spans) {
+		spans.clear();
+		while(pos < rects.size() && rects[pos].y + rects[pos].height <= top)
+			pos++;
+		if(pos == rects.size() || rects[pos].y > top)
+			return;
+		for(size_t i = pos; i < rects.size() && rects[i].y == rects[pos].y; i++)
+			spans.push_back({rects[i].x, rects[i].x + rects[i].width});
+	}
+
+	bool spans_equal(const std::vector<Span>& a, const std::vector<Span>& b) {
+		if(a.size() != b.size())
+			return false;
+		for(size_t i = 0; i < a.size(); i++) {
+			if(a[i].start != b[i].start || a[i].end != b[i].end)
+				return false;
+		}
+		return true;
+	}
+}
+
+Region::Region(const Rect& rect) {
+	if(rect.width > 0 && rect.height > 0)
+		m_rects.push_back(rect);
+}
+
+Region Region::combine(const Region& a, const Region& b, Operation op) {
+	//Neither region changes between the edges of their bands, so the result is worked out one of those rows at a time
+	std::vector<int> edges;
+	edges.reserve((a.m_rects.size() + b.m_rects.size()) * 2);
+	for(auto* region : {&a, &b}) {
+		for(auto& rect : region->m_rects) {
+			edges.push_back(rect.y);
+			edges.push_back(rect.y + rect.height);
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+	Region ret;
+	std::vector<Span> a_spans, b_spans, spans, last_spans;
+	std::vector<int> xs;
+	size_t a_pos = 0, b_pos = 0;
+	size_t last_band = 0;
+	int last_bottom = 0;
+	for(size_t i = 0; i + 1 < edges.size(); i++) {
+		int top = edges[i], bottom = edges[i + 1];
+		band_spans(a.m_rects, a_pos, top, a_spans);
+		band_spans(b.m_rects, b_pos, top, b_spans);
+
+		//Same thing for the spans: between each of their ends, a part of the row is either in both regions or it isn't
+		xs.clear();
+		for(auto* list : {&a_spans, &b_spans}) {
+			for(auto& span : *list) {
+				xs.push_back(span.start);
+				xs.push_back(span.end);
+			}
+		}
+		std::sort(xs.begin(), xs.end());
+		xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+
+		spans.clear();
+		size_t a_span = 0, b_span = 0;
+		for(size_t x = 0; x + 1 < xs.size(); x++) {
+			while(a_span < a_spans.size() && a_spans[a_span].end <= xs[x])
+				a_span++;
+			while(b_span < b_spans.size() && b_spans[b_span].end <= xs[x])
+				b_span++;
+			bool in_a = a_span < a_spans.size() && a_spans[a_span].start <= xs[x];
+			bool in_b = b_span < b_spans.size() && b_spans[b_span].start <= xs[x];
+			bool in_result = op == Operation::Union ? (in_a || in_b) : op == Operation::Subtract ? (in_a && !in_b) : (in_a && in_b);
+			if(!in_result)
+				continue;
+			if(!spans.empty() && spans.back().end == xs[x])
+				spans.back().end = xs[x + 1];
+			else
+				spans.push_back({xs[x], xs[x + 1]});
+		}
+		if(spans.empty())
+			continue;
+
+		//If this band is right below one with the same spans, that one just gets taller
+		if(!ret.m_rects.empty() && last_bottom == top && spans_equal(spans, last_spans)) {
+			for(size_t rect = last_band; rect < ret.m_rects.size(); rect++)
+				ret.m_rects[rect].height += bottom - top;
+		} else {
+			last_band = ret.m_rects.size();
+			for(auto& span : spans)
+				ret.m_rects.push_back({span.start, top, span.end - span.start, bottom - top});
+			std::swap(spans, last_spans);
+		}
+		last_bottom = bottom;
+	}
+
+	return ret;
+}
+
+void Region::add(const Region& other) {
+	*this = combine(*this, other, Operation::Union);
+}
+
+void Region::subtract(const Region& other) {
+	*this = combine(*this, other, Operation::Subtract);
+}
+
+void Region::intersect(const Region& other) {
+	*this = combine(*this, other, Operation::Intersect);
+}
+
+Region Region::united(const Region& other) const {
+	return combine(*this, other, Operation::Union);
+}
+
+Region Region::subtracted(const Region& other) const {
+	return combine(*this, other, Operation::Subtract);
+}
+
+Region Region::intersected(const Region& other) const {
+	return combine(*this, other, Operation::Intersect);
+}
+
+bool Region::collides(const Rect& rect) const {
+	for(auto& region_rect : m_rects) {
+		if(region_rect.collides(rect))
+			return true;
+	}
+	return false;
+}
+
+Rect Region::bounds() const {
+	if(m_rects.empty())
+		return {0, 0, 0, 0};
+	Rect bounds = m_rects[0];
+	for(auto& rect : m_rects)
+		bounds = bounds.combine(rect);
+	return bounds;
+}
@@ -21,6 +21,7 @@
 
 #include <algorithm>
 #include <math.h>
+#include <vector>
 #include <libduck/Stream.h>
 
 namespace Gfx {
@@ -426,4 +427,58 @@ namespace Gfx {
 	using IntRect = GenericRect<int>;
 	using FloatRect = GenericRect<float>;
 	using DoubleRect = GenericRect<double>;
+
+	/**
+	 * An area made up of any number of rects. It's stored as bands: rows of rects that all have the same y and height,
+	 * sorted from left to right without touching each other. Bands are sorted top to bottom without overlapping, and
+	 * neighbouring bands with the same rects in them get joined, so the same area is always stored the same way.
+	 */
+	class Region {
+	public:
+		Region() = default;
+		Region(const Rect& rect);
+
+		/**
+		 * Adds an area to the region.
+		 */
+		void add(const Region& other);
+
+		/**
+		 * Takes an area out of the region.
+		 */
+		void subtract(const Region& other);
+
+		/**
+		 * Shrinks the region down to the part of it that's also in another area.
+		 */
+		void intersect(const Region& other);
+
+		[[nodiscard]] Region united(const Region& other) const;
+		[[nodiscard]] Region subtracted(const Region& other) const;
+		[[nodiscard]] Region intersected(const Region& other) const;
+
+		/**
+		 * Whether any part of the region overlaps a rect.
+		 */
+		[[nodiscard]] bool collides(const Rect& rect) const;
+
+		/**
+		 * Gets the smallest rect that contains the whole region.
+		 */
+		[[nodiscard]] Rect bounds() const;
+
+		void clear() { m_rects.clear(); }
+		[[nodiscard]] bool empty() const { return m_rects.empty(); }
+
+		/**
+		 * The rects that make up the region, which don't overlap each other and are sorted top to bottom, then left to right.
+		 */
+		[[nodiscard]] const std::vector<Rect>& rects() const { return m_rects; }
+
+	private:
+		enum class Operation { Union, Subtract, Intersect };
+		static Region combine(const Region& a, const Region& b, Operation op);
+
+		std::vector<Rect> m_rects;
+	};
 }
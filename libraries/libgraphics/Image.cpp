@@ -25,6 +25,17 @@
 using namespace Gfx;
 using namespace Duck;
 
+static std::function<Framebuffer*(const std::string&)> s_shared_loader;
+
+static Framebuffer* load_framebuffer(const std::string& path) {
+	if(s_shared_loader) {
+		auto* shared = s_shared_loader(path);
+		if(shared)
+			return shared;
+	}
+	return load_png(path);
+}
+
 Image::Image(std::map<std::pair<int, int>, Duck::Ptr<Framebuffer>> framebuffers, Dimensions size):
 	m_framebuffers(std::move(framebuffers)), m_size(std::move(size)) {}
 
@@ -37,7 +48,7 @@ Duck::ResultRet<Duck::Ptr<Image>> Image::load(Duck::Path path) {
 		for(auto& entry : entries) {
 			int width, height;
 			if(sscanf(entry.path().basename().c_str(), "%dx%d", &width, &height) == 2) {
-				auto* png = load_png(entry.path());
+				auto* png = load_framebuffer(entry.path());
 				if(png && png->width == width && png->height == height) {
 					if(largest_size.width * largest_size.height < width * height)
 						largest_size = {width, height};
@@ -49,7 +60,7 @@ Duck::ResultRet<Duck::Ptr<Image>> Image::load(Duck::Path path) {
 			return Result("No valid images in icon");
 		return Image::make(buffers, largest_size);
 	} else if(path.extension() == "png") {
-		auto* png = load_png(path);
+		auto* png = load_framebuffer(path);
 		if(!png)
 			return Result("Invalid PNG file");
 		std::map<std::pair<int, int>, Ptr<Framebuffer>> map = {{{png->width, png->height}, Ptr<Framebuffer>(png)}};
@@ -58,6 +69,10 @@ Duck::ResultRet<Duck::Ptr<Image>> Image::load(Duck::Path path) {
 	return Result("Invalid image file");
 }
 
+void Image::set_shared_loader(std::function<Framebuffer*(const std::string&)> loader) {
+	s_shared_loader = std::move(loader);
+}
+
 Ptr<Image> Image::take(Framebuffer* buffer) {
 	return Image::make(
 			std::map<std::pair<int, int>, Ptr<Framebuffer>> {{{buffer->width, buffer->height}, Ptr<Framebuffer>(buffer)}},
@@ -97,8 +112,15 @@ void Image::draw(const Framebuffer& buffer, Rect rect) const {
 		}
 	}
 
-	// Draw the image
-	buffer.draw_image_scaled(*m_framebuffers.find(best_size)->second, rect);
+	// Enlarged images are drawn with nearest neighbor sampling to keep them crisp
+	auto& framebuffer = *m_framebuffers.find(best_size)->second;
+	if(rect.width >= framebuffer.width && rect.height >= framebuffer.height) {
+		buffer.draw_image_scaled(framebuffer, rect);
+		return;
+	}
+
+	// Shrunken images are drawn with bilinear sampling from the smallest mipmap that's still at least as big as the rect
+	buffer.draw_image_scaled(mipmap(best_size, rect.dimensions()), rect, ScaleMode::Bilinear);
 }
 
 void Image::draw(const Framebuffer& buffer, Point point) const {
@@ -109,6 +131,27 @@ void Image::draw(const Framebuffer& buffer, Point point) const {
 
 void Image::multiply(Color color) {
 	for(auto& framebuffer : m_framebuffers) {
-		framebuffer.second->multiply(color);
+		// Framebuffers that don't own their pixels might be read-only shared images, so those get copied first
+		auto& buffer = *framebuffer.second;
+		if(!buffer.should_free) {
+			Framebuffer copy(buffer.width, buffer.height);
+			memcpy(copy.data, buffer.data, buffer.width * buffer.height * sizeof(Color));
+			copy.premultiplied = buffer.premultiplied;
+			buffer = std::move(copy);
+		}
+		buffer.multiply(color);
+	}
+	m_mipmaps.clear();
+}
+
+const Framebuffer& Image::mipmap(std::pair<int, int> size, Dimensions dimensions) const {
+	const Framebuffer* level = m_framebuffers.find(size)->second.get();
+	auto& chain = m_mipmaps[size];
+	size_t index = 0;
+	while(level->width / 2 >= dimensions.width && level->height / 2 >= dimensions.height) {
+		if(index == chain.size())
+			chain.push_back(std::make_shared<Framebuffer>(level->halved()));
+		level = chain[index++].get();
 	}
+	return *level;
 }
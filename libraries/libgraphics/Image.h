@@ -23,6 +23,8 @@
 #include "Graphics.h"
 #include <libduck/Object.h>
 #include <map>
+#include <vector>
+#include <functional>
 
 namespace Gfx {
 	class Image: public Duck::Object {
@@ -30,10 +32,21 @@ namespace Gfx {
 		DUCK_OBJECT_DEF(Image)
 
 		static Duck::ResultRet<Duck::Ptr<Image>> load(Duck::Path path);
+
+		/**
+		 * Sets a function that load() tries before decoding a PNG itself, which can hand back one that's already been
+		 * decoded somewhere else (like pond's image cache). It should return nullptr for any PNG it can't get.
+		 */
+		static void set_shared_loader(std::function<Framebuffer*(const std::string& path)> loader);
 		static Duck::Ptr<Image> take(Framebuffer* framebuffer);
 		static Duck::Ptr<Image> empty(Dimensions dimensions = {0, 0});
 		Duck::Ptr<Image> clone() const;
 
+		/**
+		 * Draws the Image scaled to fit the given rect, using whichever of its sizes is closest. Shrinking it uses
+		 * bilinear sampling from a chain of half-size copies that's made the first time each one is needed, so the
+		 * framebuffers shouldn't be drawn on directly after that.
+		 */
 		void draw(const Framebuffer& buffer, Rect rect) const;
 		void draw(const Framebuffer& buffer, Point point) const;
 		void multiply(Color color);
@@ -44,9 +57,11 @@ namespace Gfx {
 	private:
 		Image(std::map<std::pair<int, int>, Duck::Ptr<Framebuffer>> framebuffers, Dimensions size);
 		void initialize() override {};
+		const Framebuffer& mipmap(std::pair<int, int> size, Dimensions dimensions) const;
 
 		const std::map<std::pair<int, int>, Duck::Ptr<Framebuffer>> m_framebuffers;
 		Dimensions m_size;
+		mutable std::map<std::pair<int, int>, std::vector<Duck::Ptr<Framebuffer>>> m_mipmaps;
 	};
 }
 
@@ -19,17 +19,21 @@
 
 #include "PNG.h"
 #include <memory.h>
+#include <vector>
+#include <algorithm>
+#include <immintrin.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "Deflate.h"
 #include "Framebuffer.h"
+#include "CPU.h"
 
 #define abs(a) ((a) < 0 ? -(a) : (a))
 
-uint32_t fget32(FILE* file) {
-	uint32_t d = fgetc(file);
-	uint32_t c = fgetc(file);
-	uint32_t b = fgetc(file);
-	uint32_t a = fgetc(file);
-	return a | (b << 8) | (c << 16) | (d << 24);
+static inline uint32_t get32(const uint8_t* data) {
+	return data[3] | (data[2] << 8) | (data[1] << 16) | ((uint32_t) data[0] << 24);
 }
 
 const uint8_t PNG_HEADER[] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
@@ -38,10 +42,6 @@ const uint8_t PNG_HEADER[] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
 #define CHUNK_IDAT 0x49444154
 #define CHUNK_IEND 0x49454e44
 
-#define STATE_SCANLINE_BEGIN 1
-#define STATE_READPIXEL 2
-#define STATE_DONE 3
-
 #define PNG_FILTERTYPE_NONE 0
 #define PNG_FILTERTYPE_SUB 1
 #define PNG_FILTERTYPE_UP 2
@@ -54,30 +54,10 @@ const uint8_t PNG_HEADER[] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
 #define PNG_COLORTYPE_AGRAYSCALE 4
 #define PNG_COLORTYPE_ATRUECOLOR 6
 
-using namespace Gfx;
+//Images bigger than this many pixels are refused, so that working out the size of the image data can't overflow
+#define PNG_MAX_PIXELS 0x4000000
 
-typedef struct PNG {
-	struct {
-		uint32_t width;
-		uint32_t height;
-		uint8_t	bit_depth;
-		uint8_t color_type;
-		uint8_t compression_method;
-		uint8_t filter_method;
-		uint8_t interlace_method;
-	} ihdr;
-	Gfx::Framebuffer* image;
-	FILE* file;
-	uint32_t chunk_size;
-	uint32_t chunk_type;
-
-	uint8_t state;
-	uint8_t pixel_buffer[4];
-	uint8_t pixel_buffer_pos;
-	int pixel_x;
-	int pixel_y;
-	uint8_t scanline_filtertype;
-} PNG;
+using namespace Gfx;
 
 //A, B, or C, whichever is closest to p = A + B − C
 int paeth(int a, int b, int c) {
@@ -87,296 +67,566 @@ int paeth(int a, int b, int c) {
 	return c;
 }
 
-void put_pixel(PNG* png, uint32_t color) {
-	IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y) = color;
-	png->pixel_buffer_pos = 0;
-	png->pixel_x++;
-	if(png->pixel_x == png->ihdr.width) {
-		if(png->pixel_y == png->ihdr.height - 1) {
-			png->state = STATE_DONE;
-		} else {
-			png->state = STATE_SCANLINE_BEGIN;
-			png->pixel_x = 0;
-			png->pixel_y++;
-		}
+/*
+ * Sub, Avg, and Paeth each depend on the pixel to the left, so the SSE2 versions work through a scanline a pixel at a
+ * time, with all of a pixel's bytes in one register. Up doesn't, so that one does 16 bytes at a time.
+ *
+ * Three byte pixels are still moved in and out of registers four bytes at a time, except at the end of the scanline.
+ * Storing a pixel that way overwrites the first byte of the next one, so each pixel is loaded before the one before it
+ * is stored.
+ */
+
+template<size_t bpp>
+SSE2 static inline __m128i load_pixel(const uint8_t* line, size_t i, size_t stride) {
+	uint32_t pixel = 0;
+	if(bpp == 4 || i + 4 <= stride)
+		memcpy(&pixel, line + i, 4);
+	else
+		memcpy(&pixel, line + i, bpp);
+	return _mm_cvtsi32_si128((int) pixel);
+}
+
+template<size_t bpp>
+SSE2 static inline void store_pixel(uint8_t* line, size_t i, size_t stride, __m128i pixel) {
+	uint32_t value = (uint32_t) _mm_cvtsi128_si32(pixel);
+	if(bpp == 4 || i + 4 <= stride)
+		memcpy(line + i, &value, 4);
+	else
+		memcpy(line + i, &value, bpp);
+}
+
+SSE2 static void unfilter_up_sse2(uint8_t* line, const uint8_t* prev, size_t stride) {
+	size_t i = 0;
+	for(; i + 16 <= stride; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*) (line + i));
+		__m128i b = _mm_loadu_si128((const __m128i*) (prev + i));
+		_mm_storeu_si128((__m128i*) (line + i), _mm_add_epi8(x, b));
+	}
+	for(; i < stride; i++)
+		line[i] += prev[i];
+}
+
+template<size_t bpp>
+SSE2 static void unfilter_sub_sse2(uint8_t* line, size_t stride) {
+	__m128i a = _mm_setzero_si128();
+	__m128i x = load_pixel<bpp>(line, 0, stride);
+	for(size_t i = 0; i < stride; i += bpp) {
+		__m128i next = i + bpp < stride ? load_pixel<bpp>(line, i + bpp, stride) : x;
+		a = _mm_add_epi8(a, x);
+		store_pixel<bpp>(line, i, stride, a);
+		x = next;
 	}
 }
 
-void grayscale_pixel(PNG* png) {
-	uint8_t c = png->pixel_buffer[0];
-
-	if(png->scanline_filtertype == PNG_FILTERTYPE_SUB && png->pixel_x > 0) {
-		Color left_color = IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y);
-		c += COLOR_R(left_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_UP && png->pixel_y > 0) {
-		Color up_color = IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1);
-		c += COLOR_R(up_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_AVG) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		c += (COLOR_R(up_color) + COLOR_R(left_color)) / 2;
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_PAETH) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		Color corner_color = (png->pixel_x > 0 && png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y - 1) : Color();
-
-		c = ((int) c + paeth(COLOR_R(left_color), COLOR_R(up_color), COLOR_R(corner_color))) % 256;
+template<size_t bpp>
+SSE2 static void unfilter_avg_sse2(uint8_t* line, const uint8_t* prev, size_t stride) {
+	//_mm_avg_epu8 rounds up, so the low bit it added gets taken back off
+	const __m128i one = _mm_set1_epi8(1);
+	__m128i a = _mm_setzero_si128();
+	__m128i x = load_pixel<bpp>(line, 0, stride);
+	for(size_t i = 0; i < stride; i += bpp) {
+		__m128i next = i + bpp < stride ? load_pixel<bpp>(line, i + bpp, stride) : x;
+		__m128i b = load_pixel<bpp>(prev, i, stride);
+		__m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+		a = _mm_add_epi8(x, avg);
+		store_pixel<bpp>(line, i, stride, a);
+		x = next;
 	}
+}
+
+SSE2 static inline __m128i abs_epi16(__m128i x) {
+	return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+SSE2 static inline __m128i select(__m128i mask, __m128i a, __m128i b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
 
-	put_pixel(png, RGB(c,c,c));
+template<size_t bpp>
+SSE2 static void unfilter_paeth_sse2(uint8_t* line, const uint8_t* prev, size_t stride) {
+	//With p = a + b - c, the distances from p to a, b, and c are |b - c|, |a - c|, and |(b - c) + (a - c)|
+	const __m128i zero = _mm_setzero_si128();
+	__m128i a = zero;
+	__m128i c = zero;
+	__m128i x = load_pixel<bpp>(line, 0, stride);
+	for(size_t i = 0; i < stride; i += bpp) {
+		__m128i next = i + bpp < stride ? load_pixel<bpp>(line, i + bpp, stride) : x;
+		__m128i b = _mm_unpacklo_epi8(load_pixel<bpp>(prev, i, stride), zero);
+		__m128i b_minus_c = _mm_sub_epi16(b, c);
+		__m128i a_minus_c = _mm_sub_epi16(a, c);
+		__m128i pa = abs_epi16(b_minus_c);
+		__m128i pb = abs_epi16(a_minus_c);
+		__m128i pc = abs_epi16(_mm_add_epi16(b_minus_c, a_minus_c));
+		__m128i b_or_c = select(_mm_cmpgt_epi16(pb, pc), c, b);
+		__m128i predictor = select(_mm_cmpgt_epi16(pa, _mm_min_epi16(pb, pc)), b_or_c, a);
+		__m128i result = _mm_add_epi8(x, _mm_packus_epi16(predictor, zero));
+		store_pixel<bpp>(line, i, stride, result);
+		a = _mm_unpacklo_epi8(result, zero);
+		c = b;
+		x = next;
+	}
+}
+
+template<size_t bpp>
+SSE2 static void unfilter_scanline_sse2(uint8_t filter_type, uint8_t* line, const uint8_t* prev, size_t stride) {
+	switch(filter_type) {
+		case PNG_FILTERTYPE_SUB:
+			unfilter_sub_sse2<bpp>(line, stride);
+			break;
+		case PNG_FILTERTYPE_UP:
+			unfilter_up_sse2(line, prev, stride);
+			break;
+		case PNG_FILTERTYPE_AVG:
+			unfilter_avg_sse2<bpp>(line, prev, stride);
+			break;
+		case PNG_FILTERTYPE_PAETH:
+			unfilter_paeth_sse2<bpp>(line, prev, stride);
+			break;
+	}
 }
 
-void truecolor_pixel(PNG* png) {
-	uint8_t r = png->pixel_buffer[0];
-	uint8_t g = png->pixel_buffer[1];
-	uint8_t b = png->pixel_buffer[2];
-
-	if(png->scanline_filtertype == PNG_FILTERTYPE_SUB && png->pixel_x > 0) {
-		Color left_color = IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y);
-		r += COLOR_R(left_color);
-		g += COLOR_G(left_color);
-		b += COLOR_B(left_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_UP && png->pixel_y > 0) {
-		Color up_color = IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1);
-		r += COLOR_R(up_color);
-		g += COLOR_G(up_color);
-		b += COLOR_B(up_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_AVG) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		r += (COLOR_R(up_color) + COLOR_R(left_color)) / 2;
-		g += (COLOR_G(up_color) + COLOR_G(left_color)) / 2;
-		b += (COLOR_B(up_color) + COLOR_B(left_color)) / 2;
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_PAETH) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		Color corner_color = (png->pixel_x > 0 && png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y - 1) : Color();
-
-		r = ((int) r + paeth(COLOR_R(left_color), COLOR_R(up_color), COLOR_R(corner_color))) % 256;
-		g = ((int) g + paeth(COLOR_G(left_color), COLOR_G(up_color), COLOR_G(corner_color))) % 256;
-		b = ((int) b + paeth(COLOR_B(left_color), COLOR_B(up_color), COLOR_B(corner_color))) % 256;
+/**
+ * Undoes the filter on a scanline in place. Filters work on bytes, with each one predicted from the byte in the same
+ * place in the pixel to its left, the byte above it, or both (which are zero past the edges of the image).
+ */
+static bool unfilter_scanline(uint8_t filter_type, uint8_t* line, const uint8_t* prev, size_t stride, size_t bpp) {
+	if(filter_type > PNG_FILTERTYPE_PAETH)
+		return false;
+	if(filter_type != PNG_FILTERTYPE_NONE && cpu_level() >= CPU_SSE2) {
+		if(bpp == 4) {
+			unfilter_scanline_sse2<4>(filter_type, line, prev, stride);
+			return true;
+		} else if(bpp == 3) {
+			unfilter_scanline_sse2<3>(filter_type, line, prev, stride);
+			return true;
+		} else if(filter_type == PNG_FILTERTYPE_UP) {
+			unfilter_up_sse2(line, prev, stride);
+			return true;
+		}
+	}
+
+	switch(filter_type) {
+		case PNG_FILTERTYPE_NONE:
+			break;
+		case PNG_FILTERTYPE_SUB:
+			for(size_t i = bpp; i < stride; i++)
+				line[i] += line[i - bpp];
+			break;
+		case PNG_FILTERTYPE_UP:
+			for(size_t i = 0; i < stride; i++)
+				line[i] += prev[i];
+			break;
+		case PNG_FILTERTYPE_AVG:
+			for(size_t i = 0; i < bpp; i++)
+				line[i] += prev[i] / 2;
+			for(size_t i = bpp; i < stride; i++)
+				line[i] += (line[i - bpp] + prev[i]) / 2;
+			break;
+		case PNG_FILTERTYPE_PAETH:
+			for(size_t i = 0; i < bpp; i++)
+				line[i] += prev[i];
+			for(size_t i = bpp; i < stride; i++)
+				line[i] += paeth(line[i - bpp], prev[i], prev[i - bpp]);
+			break;
 	}
+	return true;
+}
 
-	put_pixel(png, RGB(r,g,b));
+//8-bit RGBA is the same as a Color with red and blue swapped, so this swaps them for four pixels at a time
+SSE2 static void convert_rgba_sse2(const uint8_t* line, Color* pixels, size_t count) {
+	const __m128i green_alpha = _mm_set1_epi32((int) 0xFF00FF00);
+	size_t x = 0;
+	for(; x + 4 <= count; x += 4) {
+		__m128i rgba = _mm_loadu_si128((const __m128i*) (line + x * 4));
+		__m128i red_blue = _mm_andnot_si128(green_alpha, rgba);
+		__m128i swapped = _mm_or_si128(_mm_slli_epi32(red_blue, 16), _mm_srli_epi32(red_blue, 16));
+		_mm_storeu_si128((__m128i*) (pixels + x), _mm_or_si128(_mm_and_si128(rgba, green_alpha), swapped));
+	}
+	for(; x < count; x++)
+		pixels[x] = RGBA(line[x * 4], line[x * 4 + 1], line[x * 4 + 2], line[x * 4 + 3]);
 }
 
-void alpha_truecolor_pixel(PNG* png) {
-	uint8_t r = png->pixel_buffer[0];
-	uint8_t g = png->pixel_buffer[1];
-	uint8_t b = png->pixel_buffer[2];
-	uint8_t a = png->pixel_buffer[3];
-
-	if(png->scanline_filtertype == PNG_FILTERTYPE_SUB && png->pixel_x > 0) {
-		Color left_color = IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y);
-		r += COLOR_R(left_color);
-		g += COLOR_G(left_color);
-		b += COLOR_B(left_color);
-		a += COLOR_A(left_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_UP && png->pixel_y > 0) {
-		Color up_color = IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1);
-		r += COLOR_R(up_color);
-		g += COLOR_G(up_color);
-		b += COLOR_B(up_color);
-		a += COLOR_A(up_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_AVG) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		r += (COLOR_R(up_color) + COLOR_R(left_color)) / 2;
-		g += (COLOR_G(up_color) + COLOR_G(left_color)) / 2;
-		b += (COLOR_B(up_color) + COLOR_B(left_color)) / 2;
-		a += (COLOR_A(up_color) + COLOR_A(left_color)) / 2;
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_PAETH) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		Color corner_color = (png->pixel_x > 0 && png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y - 1) : Color();
-
-		r = ((int) r + paeth(COLOR_R(left_color), COLOR_R(up_color), COLOR_R(corner_color))) % 256;
-		g = ((int) g + paeth(COLOR_G(left_color), COLOR_G(up_color), COLOR_G(corner_color))) % 256;
-		b = ((int) b + paeth(COLOR_B(left_color), COLOR_B(up_color), COLOR_B(corner_color))) % 256;
-		a = ((int) a + paeth(COLOR_A(left_color), COLOR_A(up_color), COLOR_A(corner_color))) % 256;
+/** Converts an unfiltered scanline to pixels. For 16-bit images, only the most significant byte of each sample is used. **/
+static void convert_scanline(const uint8_t* line, Color* pixels, size_t width, uint8_t color_type, uint8_t bit_depth) {
+	size_t sample = bit_depth / 8;
+	switch(color_type) {
+		case PNG_COLORTYPE_GRAYSCALE:
+			for(size_t x = 0; x < width; x++, line += sample)
+				pixels[x] = RGB(line[0], line[0], line[0]);
+			break;
+		case PNG_COLORTYPE_TRUECOLOR:
+			for(size_t x = 0; x < width; x++, line += sample * 3)
+				pixels[x] = RGB(line[0], line[sample], line[sample * 2]);
+			break;
+		case PNG_COLORTYPE_AGRAYSCALE:
+			for(size_t x = 0; x < width; x++, line += sample * 2)
+				pixels[x] = RGBA(line[0], line[0], line[0], line[sample]);
+			break;
+		case PNG_COLORTYPE_ATRUECOLOR:
+			if(sample == 1 && cpu_level() >= CPU_SSE2) {
+				convert_rgba_sse2(line, pixels, width);
+				break;
+			}
+			for(size_t x = 0; x < width; x++, line += sample * 4)
+				pixels[x] = RGBA(line[0], line[sample], line[sample * 2], line[sample * 3]);
+			break;
 	}
+}
+
+PNGDecoder::PNGDecoder(): m_deflate(new DEFLATE) {
+	inflate_init(m_deflate);
+}
+
+PNGDecoder::~PNGDecoder() {
+	delete m_image;
+	delete m_deflate;
+}
+
+void PNGDecoder::set_max_size(Dimensions max_size) {
+	m_max_size = max_size;
+}
 
-	put_pixel(png, RGBA(r,g,b,a));
+Framebuffer* PNGDecoder::take_image() {
+	auto* image = m_image;
+	m_image = nullptr;
+	return image;
 }
 
-void alpha_grayscale_pixel(PNG* png) {
-	uint8_t c = png->pixel_buffer[0];
-	uint8_t a = png->pixel_buffer[1];
-
-	if(png->scanline_filtertype == PNG_FILTERTYPE_SUB && png->pixel_x > 0) {
-		Color left_color = IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y);
-		c += COLOR_R(left_color);
-		a += COLOR_A(left_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_UP && png->pixel_y > 0) {
-		Color up_color = IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1);
-		c += COLOR_R(up_color);
-		a += COLOR_A(up_color);
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_AVG) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		c += (COLOR_R(up_color) + COLOR_R(left_color)) / 2;
-		a += (COLOR_A(up_color) + COLOR_A(left_color)) / 2;
-	} else if(png->scanline_filtertype == PNG_FILTERTYPE_PAETH) {
-		Color left_color = (png->pixel_x > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y) : Color();
-		Color up_color = (png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x, png->pixel_y - 1) : Color();
-		Color corner_color = (png->pixel_x > 0 && png->pixel_y > 0) ? IMGPTRPIXEL(png->image, png->pixel_x - 1, png->pixel_y - 1) : Color();
-
-		c = ((int) c + paeth(COLOR_R(left_color), COLOR_R(up_color), COLOR_R(corner_color))) % 256;
-		a = ((int) a + paeth(COLOR_A(left_color), COLOR_A(up_color), COLOR_A(corner_color))) % 256;
+bool PNGDecoder::feed(const uint8_t* data, size_t size) {
+	if(m_state == State::Error)
+		return false;
+	if(m_state == State::Done)
+		return true;
+	m_first_finished_row = -1;
+	m_finished_rows = 0;
+
+	//Leftover bytes from last time get topped up a few bytes at a time, since any part of the file can be parsed once
+	//it has this many bytes, and then the rest of the new bytes can be parsed from where they are
+	while(size && !m_pending.empty() && m_state != State::Error) {
+		size_t amount = std::min(size, (size_t) 16);
+		m_pending.insert(m_pending.end(), data, data + amount);
+		data += amount;
+		size -= amount;
+		m_pending.erase(m_pending.begin(), m_pending.begin() + process(m_pending.data(), m_pending.size()));
 	}
+	if(size && m_state != State::Error) {
+		size_t used = process(data, size);
+		m_pending.assign(data + used, data + size);
+	}
+
+	if(m_finished_rows && on_rows)
+		on_rows(m_first_finished_row, m_finished_rows);
+	return m_state != State::Error;
+}
 
-	put_pixel(png, RGBA(c,c,c,a));
+bool PNGDecoder::fail(const char* message) {
+	fprintf(stderr, "PNG: %s\n", message);
+	m_state = State::Error;
+	return false;
 }
 
-void png_write(uint8_t byte, void* png_void) {
-	PNG* png = (PNG*) png_void;
-
-	//Start of a scanline, use the byte as the
-	if(png->state == STATE_SCANLINE_BEGIN) {
-		png->scanline_filtertype = byte;
-		png->state = STATE_READPIXEL;
-	} else if(png->state == STATE_READPIXEL) {
-		png->pixel_buffer[png->pixel_buffer_pos++] = byte;
-		if(png->pixel_buffer_pos == 1 && png->ihdr.color_type == PNG_COLORTYPE_GRAYSCALE) {
-			grayscale_pixel(png);
-		} else if(png->pixel_buffer_pos == 3 && png->ihdr.color_type == PNG_COLORTYPE_TRUECOLOR) {
-			truecolor_pixel(png);
-		} else if(png->pixel_buffer_pos == 2 && png->ihdr.color_type == PNG_COLORTYPE_AGRAYSCALE) {
-			alpha_grayscale_pixel(png);
-		} else if(png->pixel_buffer_pos == 4 && png->ihdr.color_type == PNG_COLORTYPE_ATRUECOLOR) {
-			alpha_truecolor_pixel(png);
+/** Parses as much as it can, and returns how many bytes it got through. **/
+size_t PNGDecoder::process(const uint8_t* data, size_t size) {
+	size_t pos = 0;
+	while(true) {
+		size_t left = size - pos;
+		switch(m_state) {
+			case State::Signature:
+				if(left < 8)
+					return pos;
+				if(memcmp(data, PNG_HEADER, 8) != 0) {
+					fail("Invalid file header!");
+					return pos;
+				}
+				pos += 8;
+				m_state = State::ChunkHeader;
+				break;
+
+			case State::ChunkHeader:
+				if(left < 8)
+					return pos;
+				m_chunk_left = get32(data + pos);
+				m_chunk_type = get32(data + pos + 4);
+				pos += 8;
+				if(!m_num_chunks && m_chunk_type != CHUNK_IHDR) {
+					fail("No IHDR chunk");
+					return pos;
+				}
+
+				//The image data is all in a row, so once there's a chunk after it all of it has been seen
+				if(m_seen_idat && m_chunk_type != CHUNK_IDAT && !m_inflate_done && !inflate_data(nullptr, 0, true))
+					return pos;
+				if(m_chunk_type == CHUNK_IEND) {
+					if(m_row != m_height)
+						fail("Image data is corrupt");
+					else
+						m_state = State::Done;
+					return pos;
+				}
+				m_state = State::ChunkData;
+				break;
+
+			case State::ChunkData:
+				if(m_chunk_type == CHUNK_IHDR && m_num_chunks == 0) {
+					if(m_chunk_left < 13) {
+						fail("IHDR chunk is too small");
+						return pos;
+					}
+					if(left < 13)
+						return pos;
+					if(!read_header(data + pos, 13))
+						return pos;
+					pos += 13;
+					m_chunk_left -= 13;
+					m_num_chunks++;
+				} else {
+					size_t amount = std::min(left, (size_t) m_chunk_left);
+					if(m_chunk_type == CHUNK_IDAT) {
+						m_seen_idat = true;
+						if(!inflate_data(data + pos, amount, false))
+							return pos;
+					}
+					pos += amount;
+					m_chunk_left -= amount;
+					if(m_chunk_left)
+						return pos;
+					m_state = State::ChunkCRC;
+				}
+				break;
+
+			case State::ChunkCRC:
+				if(left < 4)
+					return pos;
+				pos += 4;
+				m_num_chunks++;
+				m_state = State::ChunkHeader;
+				break;
+
+			case State::Done:
+			case State::Error:
+				return pos;
 		}
 	}
 }
 
-uint8_t png_read(void* png_void) {
-	PNG* png = (PNG*) png_void;
-	if(png->chunk_size == 0) {
-		//Reached end of IDAT, read next one
-		fget32(png->file); //Ignore CRC
-		png->chunk_size = fget32(png->file);
-		png->chunk_type = fget32(png->file);
-		if(png->chunk_type != CHUNK_IDAT)
-			fprintf(stderr, "PNG: encountered non-IDAT chunk in middle of file, continuing anyway...\n");
+bool PNGDecoder::read_header(const uint8_t* data, size_t size) {
+	m_width = get32(data);
+	m_height = get32(data + 4);
+	m_bit_depth = data[8];
+	m_color_type = data[9];
+	uint8_t compression_method = data[10];
+	uint8_t filter_method = data[11];
+	uint8_t interlace_method = data[12];
+
+	//Check IHDR parameters
+	if(m_bit_depth != 1 && m_bit_depth != 2 && m_bit_depth != 4 && m_bit_depth != 8 && m_bit_depth != 16)
+		return fail("Invalid bit depth");
+	if(m_bit_depth < 8)
+		return fail("Bit depths below 8 are not supported!");
+	if(m_color_type == PNG_COLORTYPE_INDEXED)
+		return fail("Indexed color is not supported!");
+	if(m_color_type != 0 && m_color_type != 2 && m_color_type != 4 && m_color_type != 6)
+		return fail("Invalid color type");
+	if(compression_method != 0)
+		return fail("Invalid compression method");
+	if(filter_method != 0)
+		return fail("Invalid filter method");
+	if(interlace_method == 1)
+		return fail("Adam7 interlacing not supported yet!");
+	if(interlace_method != 0)
+		return fail("Invalid interlace method");
+	if(!m_width || !m_height || (uint64_t) m_width * m_height > PNG_MAX_PIXELS)
+		return fail("Invalid image size");
+
+	static const size_t channels[] = {1, 0, 3, 0, 2, 0, 4};
+	m_bytes_per_pixel = channels[m_color_type] * (m_bit_depth / 8);
+	m_stride = m_width * m_bytes_per_pixel;
+	m_line.resize(m_stride + 1);
+	m_prev_line.resize(m_stride);
+
+	//Enough room to decompress into that sliding the window doesn't happen too often
+	m_window.resize(DEFLATE_WINDOW_SIZE * 2);
+	m_deflate->out = m_window.data();
+	m_deflate->out_size = m_window.size();
+
+	Dimensions image_size = {(int) m_width, (int) m_height};
+	if(m_max_size.width > 0 && m_max_size.height > 0 && (image_size.width > m_max_size.width || image_size.height > m_max_size.height)) {
+		double scale = std::min((double) m_max_size.width / m_width, (double) m_max_size.height / m_height);
+		image_size = {std::max((int) (m_width * scale), 1), std::max((int) (m_height * scale), 1)};
+		m_row_pixels.resize(m_width);
+		m_column_map.resize(m_width);
+		m_column_counts.resize(image_size.width);
+		for(uint32_t x = 0; x < m_width; x++) {
+			m_column_map[x] = (uint64_t) x * image_size.width / m_width;
+			m_column_counts[m_column_map[x]]++;
+		}
+		m_sums.resize(image_size.width * 4);
 	}
-	png->chunk_size--;
-	return fgetc(png->file);
+	m_image = new Framebuffer(image_size.width, image_size.height);
+	return true;
 }
 
-Framebuffer* Gfx::load_png_from_file(FILE* file) {
-	//Read the header
-	fseek(file, 0, SEEK_SET);
-	uint8_t header[8];
-	fread(header, 8, 1, file);
-	if(memcmp(header, PNG_HEADER, 8) != 0) {
-		fprintf(stderr, "PNG: Invalid file header!\n");
-		return NULL;
+bool PNGDecoder::inflate_data(const uint8_t* data, size_t size, bool final) {
+	if(m_inflate_done)
+		return true;
+
+	//The image data starts with a zlib header
+	while(m_zlib_header_size < 2 && size) {
+		m_zlib_header[m_zlib_header_size++] = *(data++);
+		size--;
+		if(m_zlib_header_size == 2) {
+			if((m_zlib_header[0] & 0xFu) != 0x8)
+				return fail("Unsupported zlib compression type");
+			if(m_zlib_header[1] & 0x20u)
+				return fail("zlib presets are not supported.");
+		}
+	}
+	if(m_zlib_header_size < 2)
+		return final ? fail("No image data") : true;
+
+	//Whatever inflate didn't get to last time comes before the new data
+	const uint8_t* in = data;
+	size_t in_size = size;
+	if(!m_compressed.empty()) {
+		m_compressed.insert(m_compressed.end(), data, data + size);
+		in = m_compressed.data();
+		in_size = m_compressed.size();
 	}
 
-	PNG png;
-	png.file = file;
-	png.pixel_buffer_pos = 0;
-	png.pixel_x = 0;
-	png.pixel_y = 0;
-	png.state = STATE_SCANLINE_BEGIN;
-
-	//Read the chunks
-	size_t chunk = 0;
-	while(1) {
-		png.chunk_size = fget32(file);
-		png.chunk_type = fget32(file);
-		if(feof(file) || png.state == STATE_DONE)
-			break;
+	m_deflate->in = in;
+	m_deflate->in_size = in_size;
+	m_deflate->in_pos = 0;
+	m_deflate->in_final = final;
+	while(true) {
+		int ret = inflate_resume(m_deflate);
+		if(ret == DEFLATE_ERROR || !consume_output())
+			return fail("Image data is corrupt");
+		if(ret == DEFLATE_OUTPUT_FULL) {
+			inflate_slide(m_deflate);
+			m_window_pos = m_deflate->out_pos;
+			continue;
+		}
+		if(ret == DEFLATE_DONE)
+			m_inflate_done = true;
+		else if(final)
+			return fail("Image data is corrupt");
+		break;
+	}
 
-		if(chunk == 0 && png.chunk_type != CHUNK_IHDR) {
-			fprintf(stderr, "PNG: No IHDR chunk 0x%lx\n", png.chunk_type);
-			return NULL;
-		} else if(chunk == 0) {
-			//Read IHDR
-			png.ihdr.width = fget32(file);
-			png.ihdr.height = fget32(file);
-			png.ihdr.bit_depth = fgetc(file);
-			png.ihdr.color_type = fgetc(file);
-			png.ihdr.compression_method = fgetc(file);
-			png.ihdr.filter_method = fgetc(file);
-			png.ihdr.interlace_method = fgetc(file);
-
-			//Check IHDR parameters
-			if(png.ihdr.bit_depth != 1 && png.ihdr.bit_depth != 2 && png.ihdr.bit_depth != 4 && png.ihdr.bit_depth != 8 && png.ihdr.bit_depth != 16) {
-				fprintf(stderr, "PNG: Invalid bit depth %d\n", png.ihdr.bit_depth);
-				return NULL;
-			}
-			if(png.ihdr.color_type != 0 && png.ihdr.color_type != 2 && png.ihdr.color_type != 4 && png.ihdr.color_type != 6) {
-				if(png.ihdr.color_type == 3)
-					fprintf(stderr, "PNG: Indexed color is not supported!\n");
-				else
-					fprintf(stderr, "PNG: Invalid color type %d\n", png.ihdr.color_type);
-				return NULL;
-			}
-			if(png.ihdr.compression_method != 0) {
-				fprintf(stderr, "PNG: Invalid compression method %d\n", png.ihdr.compression_method);
-				return NULL;
-			}
-			if(png.ihdr.filter_method != 0) {
-				fprintf(stderr, "PNG: Invalid filter method %d\n", png.ihdr.filter_method);
-				return NULL;
-			}
-			if(png.ihdr.interlace_method != 0 && png.ihdr.interlace_method != 1) {
-				fprintf(stderr, "PNG: Invalid interlace method %d\n", png.ihdr.interlace_method);
-				return NULL;
-			}
-			if(png.ihdr.interlace_method == 1) {
-				fprintf(stderr, "PNG: Adam7 interlacing not supported yet!\n");
-				return NULL;
-			}
+	if(m_inflate_done)
+		m_compressed.clear();
+	else if(m_compressed.empty())
+		m_compressed.assign(in + m_deflate->in_pos, in + in_size);
+	else
+		m_compressed.erase(m_compressed.begin(), m_compressed.begin() + m_deflate->in_pos);
+	return true;
+}
 
-			//Allocate framebuffer space
-			png.image = new Framebuffer(png.ihdr.width, png.ihdr.height);
-			//Skip unused bytes
-			for(size_t i = 13; i < png.chunk_size; i++)
-				fgetc(file);
-		} else if(png.chunk_type == CHUNK_IDAT) {
-			uint8_t zlib_method = fgetc(file);
-			if((zlib_method & 0xFu) != 0x8) {
-				fprintf(stderr, "PNG: Unsupported zlib compression type 0x%x\n!", zlib_method & 0xFu);
-				free(png.image->data);
-				return NULL;
-			}
-			uint8_t zlib_flags = fgetc(file);
-			if(zlib_flags & 0x20u) {
-				fprintf(stderr, "PNG: zlib presets are not supported.\n");
-				free(png.image->data);
-				return NULL;
-			}
+/** Goes through the bytes that inflate has added to the window since last time, putting them in scanlines. **/
+bool PNGDecoder::consume_output() {
+	while(m_window_pos < m_deflate->out_pos) {
+		if(m_row == m_height)
+			return false;
+		size_t amount = std::min(m_deflate->out_pos - m_window_pos, m_line.size() - m_line_pos);
+		memcpy(m_line.data() + m_line_pos, m_window.data() + m_window_pos, amount);
+		m_window_pos += amount;
+		m_line_pos += amount;
+		if(m_line_pos == m_line.size() && !finish_row())
+			return false;
+	}
+	return true;
+}
 
-			png.chunk_size -= 2;
+bool PNGDecoder::finish_row() {
+	uint8_t* line = m_line.data() + 1;
+	if(!unfilter_scanline(m_line[0], line, m_prev_line.data(), m_stride, m_bytes_per_pixel))
+		return false;
+
+	int finished_row;
+	if(m_sums.empty()) {
+		convert_scanline(line, &m_image->data[m_row * m_width], m_width, m_color_type, m_bit_depth);
+		finished_row = m_row;
+	} else {
+		convert_scanline(line, m_row_pixels.data(), m_width, m_color_type, m_bit_depth);
+		finished_row = scale_row(m_row_pixels.data());
+	}
 
-			auto* def = new DEFLATE;
-			def->arg = &png;
-			def->write = png_write;
-			def->read = png_read;
-			decompress(def);
-			delete def;
-		} else if(png.chunk_type == CHUNK_IEND) {
-			break;
-		} else {
-			//Since fseek() clears the read buffer, this is usually faster
-			for(uint32_t i = 0; i < png.chunk_size; i++)
-				fgetc(file);
-		}
+	memcpy(m_prev_line.data(), line, m_stride);
+	m_line_pos = 0;
+	m_row++;
+	if(finished_row >= 0) {
+		if(m_first_finished_row < 0)
+			m_first_finished_row = finished_row;
+		m_finished_rows++;
+	}
+	return true;
+}
+
+/**
+ * Adds a row to the sums, and writes the row of the image they make once it's the last one that maps to it.
+ * @return The row of the image that got written, or -1 if none did.
+ */
+int PNGDecoder::scale_row(const Color* row) {
+	for(uint32_t x = 0; x < m_width; x++) {
+		uint64_t* sum = &m_sums[m_column_map[x] * 4];
+		Color color = row[x];
+		sum[0] += color.r * color.a;
+		sum[1] += color.g * color.a;
+		sum[2] += color.b * color.a;
+		sum[3] += color.a;
+	}
+	m_summed_rows++;
+
+	uint32_t image_row = (uint64_t) m_row * m_image->height / m_height;
+	if(m_row + 1 != m_height && (uint64_t) (m_row + 1) * m_image->height / m_height == image_row)
+		return -1;
+
+	Color* out = &m_image->data[image_row * m_image->width];
+	for(int x = 0; x < m_image->width; x++) {
+		uint64_t* sum = &m_sums[x * 4];
+		uint64_t pixels = (uint64_t) m_column_counts[x] * m_summed_rows;
+		if(sum[3])
+			out[x] = RGBA(sum[0] / sum[3], sum[1] / sum[3], sum[2] / sum[3], sum[3] / pixels);
+		else
+			out[x] = RGBA(0, 0, 0, 0);
+		sum[0] = sum[1] = sum[2] = sum[3] = 0;
+	}
+	m_summed_rows = 0;
+	return image_row;
+}
 
-		fget32(file); //Skip CRC
-		chunk++;
+Framebuffer* Gfx::load_png_from_memory(const uint8_t* data, size_t size) {
+	PNGDecoder decoder;
+	if(!decoder.feed(data, size))
+		return NULL;
+	if(!decoder.done()) {
+		fprintf(stderr, "PNG: File ended before the image did\n");
+		return NULL;
 	}
+	return decoder.take_image();
+}
 
-	return png.image;
+static Framebuffer* load_png_from_fd(int fd) {
+	struct stat st;
+	if(fstat(fd, &st) < 0 || st.st_size <= 0)
+		return nullptr;
+	void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if(data == MAP_FAILED)
+		return nullptr;
+	auto* ret = load_png_from_memory((const uint8_t*) data, st.st_size);
+	munmap(data, st.st_size);
+	return ret;
+}
+
+Framebuffer* Gfx::load_png_from_file(FILE* file) {
+	return load_png_from_fd(fileno(file));
 }
 
 Framebuffer* Gfx::load_png(const std::string& filename) {
-	auto* file = fopen(filename.c_str(), "r");
-	if(!file)
+	int fd = open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
 		return nullptr;
-	auto* ret = load_png_from_file(file);
-	fclose(file);
+	auto* ret = load_png_from_fd(fd);
+	close(fd);
 	return ret;
-}
\ No newline at end of file
+}
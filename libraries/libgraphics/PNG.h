@@ -25,12 +25,114 @@
 
 #include <string>
 #include <cstdio>
+#include <vector>
+#include <functional>
 
 __DECL_BEGIN
 
 namespace Gfx {
+	/**
+	 * Decodes a PNG that has already been read (or mapped) into memory.
+	 * @param data The contents of the PNG file.
+	 * @param size The size of the file, in bytes.
+	 * @return The decoded image, or nullptr if it couldn't be decoded.
+	 */
+	Gfx::Framebuffer* load_png_from_memory(const uint8_t* data, size_t size);
 	Gfx::Framebuffer* load_png_from_file(FILE* file);
 	Gfx::Framebuffer* load_png(const std::string& filename);
 }
 
 __DECL_END
+
+namespace Gfx {
+	/**
+	 * Decodes a PNG a piece at a time as its bytes come in, so it can be shown before it's all there. The rows of the
+	 * image are filled in from the top as they're decoded, and only a small window of the decompressed data is ever
+	 * kept around.
+	 */
+	class PNGDecoder {
+	public:
+		PNGDecoder();
+		~PNGDecoder();
+		PNGDecoder(const PNGDecoder& other) = delete;
+		PNGDecoder& operator=(const PNGDecoder& other) = delete;
+
+		/**
+		 * Makes the image get scaled down to fit in the given size (keeping its aspect ratio) while it's decoded, so
+		 * the full-size image is never in memory. This has to be called before the header is fed in.
+		 * @param max_size The largest the decoded image can be.
+		 */
+		void set_max_size(Dimensions max_size);
+
+		/**
+		 * Feeds the next part of the file to the decoder, decoding as much of the image as it can.
+		 * @param data The next bytes of the file.
+		 * @param size The number of bytes.
+		 * @return false if the PNG is invalid (in which case a message is printed), true otherwise.
+		 */
+		bool feed(const uint8_t* data, size_t size);
+
+		/** Whether the whole image has been decoded. **/
+		[[nodiscard]] bool done() const { return m_image && m_row == m_height; }
+
+		/** The image being decoded, or nullptr if the header hasn't been fed in yet. **/
+		[[nodiscard]] Framebuffer* image() const { return m_image; }
+
+		/** Takes ownership of the image away from the decoder, which shouldn't be fed anything else after that. **/
+		Framebuffer* take_image();
+
+		/** Called after feed() finishes rows of the image, with the first row it finished and how many. **/
+		std::function<void(int first_row, int num_rows)> on_rows;
+
+	private:
+		enum class State { Signature, ChunkHeader, ChunkData, ChunkCRC, Done, Error };
+
+		size_t process(const uint8_t* data, size_t size);
+		bool read_header(const uint8_t* data, size_t size);
+		bool inflate_data(const uint8_t* data, size_t size, bool final);
+		bool consume_output();
+		bool finish_row();
+		int scale_row(const Color* row);
+		bool fail(const char* message);
+
+		State m_state = State::Signature;
+		std::vector<uint8_t> m_pending;
+		uint32_t m_chunk_type = 0;
+		uint32_t m_chunk_left = 0;
+		size_t m_num_chunks = 0;
+		bool m_seen_idat = false;
+
+		uint32_t m_width = 0;
+		uint32_t m_height = 0;
+		uint8_t m_bit_depth = 0;
+		uint8_t m_color_type = 0;
+		size_t m_bytes_per_pixel = 0;
+		size_t m_stride = 0;
+		Dimensions m_max_size = {0, 0};
+		Framebuffer* m_image = nullptr;
+
+		//The compressed data that inflate still needs, the window it decompresses into, and the scanlines it makes. Each
+		//scanline is unfiltered against the one before it.
+		DEFLATE* m_deflate = nullptr;
+		uint8_t m_zlib_header[2];
+		size_t m_zlib_header_size = 0;
+		bool m_inflate_done = false;
+		std::vector<uint8_t> m_compressed;
+		std::vector<uint8_t> m_window;
+		size_t m_window_pos = 0;
+		std::vector<uint8_t> m_line;
+		std::vector<uint8_t> m_prev_line;
+		size_t m_line_pos = 0;
+		uint32_t m_row = 0;
+		int m_first_finished_row = -1;
+		int m_finished_rows = 0;
+
+		//For scaling down, each column of the PNG maps to a column of the image, and rows get summed up (with their
+		//color weighted by alpha) until the next one maps to a different row of the image.
+		std::vector<Color> m_row_pixels;
+		std::vector<uint32_t> m_column_map;
+		std::vector<uint32_t> m_column_counts;
+		std::vector<uint64_t> m_sums;
+		uint32_t m_summed_rows = 0;
+	};
+}
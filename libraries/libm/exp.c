@@ -0,0 +1,534 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+/*
+ * Exponentials, logarithms, powers, and the hyperbolic functions built out of them. exp and log use fdlibm's
+ * polynomials. pow, expm1 and log1p need more precision in their intermediate results than a double has to come out
+ * accurate, which the x87 gives us for free, so they're done in long double with its log2 and 2^x instructions.
+ */
+
+#include "math_private.h"
+
+static const double ln2hi = 0x1.62e42feep-1; // The first 32 bits of ln(2), so that k * ln2hi is exact
+static const double ln2lo = 0x1.a39ef35793c76p-33;
+static const double ln2 = 0x1.62e42fefa39efp-1;
+static const double ln2_tail = 0x1.abc9e3b39803fp-56; // ln(2) - ln2
+static const double invln2 = 0x1.71547652b82fep+0;
+
+static const double
+	P1 = 1.66666666666666019037e-01,
+	P2 = -2.77777777770155933842e-03,
+	P3 = 6.61375632143793436117e-05,
+	P4 = -1.65339022054652515390e-06,
+	P5 = 4.13813679705723846039e-08;
+
+/** e^(hi - lo) * 2^k, for |hi - lo| <= ln(2)/2. **/
+double __exp_kernel(double hi, double lo, int k) {
+	double x = hi - lo;
+	double xx = x * x;
+	double c = x - xx * (P1 + xx * (P2 + xx * (P3 + xx * (P4 + xx * P5))));
+	double y = 1 + (x * c / (2 - c) - lo + hi);
+	return k ? scalbn(y, k) : y;
+}
+
+double exp(double x) {
+	uint32_t hx = HIGH_WORD(x);
+	int negative = hx >> 31;
+	hx &= 0x7fffffff;
+
+	if(hx >= 0x4086232b) {
+		if(isnan(x))
+			return x;
+		if(x > 709.782712893383973096)
+			return math_oflow(0);
+		if(x < -745.13321910194110842)
+			return math_uflow(0);
+	}
+
+	//Reduce x to r = x - k * ln(2) with |r| <= ln(2)/2, so e^x = 2^k * e^r
+	double hi, lo = 0;
+	int k = 0;
+	if(hx > 0x3fd62e42) {
+		k = hx >= 0x3ff0a2b2 ? (int) round_nearest(invln2 * x) : 1 - negative - negative;
+		hi = x - k * ln2hi;
+		lo = k * ln2lo;
+	} else if(hx > 0x3e300000) {
+		hi = x;
+	} else {
+		return 1 + x;
+	}
+	return __exp_kernel(hi, lo, k);
+}
+
+double exp2(double x) {
+	if(isnan(x))
+		return x;
+	if(x >= 1024)
+		return math_oflow(0);
+	if(x < -1075)
+		return math_uflow(0);
+	if(fabs(x) < 0x1p-54)
+		return 1 + x;
+
+	//2^x = 2^k * e^(r * ln(2)), with r * ln(2) worked out to more than double precision
+	int k = (int) round_nearest(x);
+	double r = x - k;
+	double hi, lo;
+	two_product(r, ln2, &hi, &lo);
+	lo += r * ln2_tail;
+	return __exp_kernel(hi, -lo, k);
+}
+
+double expm1(double x) {
+	if(isnan(x))
+		return x;
+	if(x > 709.782712893383973096)
+		return math_oflow(0);
+	if(x < -40)
+		return -1.0;
+	if(fabs(x) < 0x1p-54)
+		return x;
+
+	long double t = x * x87_log2e();
+	if(t >= -1 && t <= 1)
+		return (double) x87_f2xm1(t);
+
+	//Outside of that range, e^x is far enough from one that subtracting one doesn't lose anything
+	return (double) ((long double) exp(x) - 1);
+}
+
+static const double
+	Lg1 = 6.666666666666735130e-01,
+	Lg2 = 3.999999999940941908e-01,
+	Lg3 = 2.857142874366239149e-01,
+	Lg4 = 2.222219843214978396e-01,
+	Lg5 = 1.818357216161805012e-01,
+	Lg6 = 1.531383769920937332e-01,
+	Lg7 = 1.479819860511658591e-01;
+
+/*
+ * Breaks x down into 2^k * (1 + f) with 1 + f in [sqrt(2)/2, sqrt(2)], and works out the parts of log(1 + f) that log,
+ * log2 and log10 all use: log(1 + f) = f - hfsq + s * (hfsq + R), where hfsq = f^2 / 2 and s = f / (2 + f). Returns 0
+ * if the result is already known, in which case it's in *special.
+ */
+static int log_reduce(double x, int* k, double* f, double* hfsq, double* sR, double* special) {
+	uint64_t bits = asuint64(x);
+	uint32_t hx = (uint32_t) (bits >> 32);
+	*k = 0;
+
+	if(hx < 0x00100000 || (hx >> 31)) {
+		if(!(bits << 1)) {
+			*special = math_divzero(1);
+			return 0;
+		}
+		if(hx >> 31) {
+			*special = isnan(x) ? x : math_invalid(x);
+			return 0;
+		}
+		//Subnormal, so scale it up
+		*k -= 54;
+		x *= 0x1p54;
+		bits = asuint64(x);
+		hx = (uint32_t) (bits >> 32);
+	} else if(hx >= 0x7ff00000) {
+		*special = x;
+		return 0;
+	} else if(hx == 0x3ff00000 && !(uint32_t) bits) {
+		*special = 0;
+		return 0;
+	}
+
+	//Adjusting the exponent this way puts the mantissa in [sqrt(2)/2, sqrt(2)] instead of [1, 2]
+	hx += 0x3ff00000 - 0x3fe6a09e;
+	*k += (int) (hx >> 20) - 0x3ff;
+	hx = (hx & 0x000fffff) + 0x3fe6a09e;
+	x = asdouble((uint64_t) hx << 32 | (bits & 0xffffffff));
+
+	*f = x - 1.0;
+	*hfsq = 0.5 * *f * *f;
+	double s = *f / (2.0 + *f);
+	double z = s * s;
+	double w = z * z;
+	double t1 = w * (Lg2 + w * (Lg4 + w * Lg6));
+	double t2 = z * (Lg1 + w * (Lg3 + w * (Lg5 + w * Lg7)));
+	*sR = s * (*hfsq + t1 + t2);
+	return 1;
+}
+
+double log(double x) {
+	int k;
+	double f, hfsq, sR, special;
+	if(!log_reduce(x, &k, &f, &hfsq, &sR, &special))
+		return special;
+	double dk = k;
+	return sR + dk * ln2lo - hfsq + f + dk * ln2hi;
+}
+
+static const double ivln2hi = 0x1.71547652p+0; // The first 33 bits of 1/ln(2)
+static const double ivln2lo = 0x1.705fc2eefa2p-33;
+
+double log2(double x) {
+	int k;
+	double f, hfsq, sR, special;
+	if(!log_reduce(x, &k, &f, &hfsq, &sR, &special))
+		return special;
+
+	//Split f - hfsq into a part with few enough bits that multiplying it by ivln2hi is exact, and the rest
+	double hi = WITH_LOW_WORD(f - hfsq, 0);
+	double lo = f - hi - hfsq + sR;
+	double val_hi = hi * ivln2hi;
+	double val_lo = (lo + hi) * ivln2lo + lo * ivln2hi;
+	double y = k;
+	double w = y + val_hi;
+	val_lo += (y - w) + val_hi;
+	return val_lo + w;
+}
+
+static const double ivln10hi = 0x1.bcb7b152p-2; // The first 33 bits of 1/ln(10)
+static const double ivln10lo = 0x1.b9438ca9aadd5p-36;
+static const double log10_2hi = 0x1.34413509p-2; // The first 33 bits of log10(2)
+static const double log10_2lo = 0x1.ef3fde623e256p-35;
+
+double log10(double x) {
+	int k;
+	double f, hfsq, sR, special;
+	if(!log_reduce(x, &k, &f, &hfsq, &sR, &special))
+		return special;
+
+	double hi = WITH_LOW_WORD(f - hfsq, 0);
+	double lo = f - hi - hfsq + sR;
+	double val_hi = hi * ivln10hi;
+	double dk = k;
+	double y = dk * log10_2hi;
+	double val_lo = dk * log10_2lo + (lo + hi) * ivln10lo + lo * ivln10hi;
+	double w = y + val_hi;
+	val_lo += (y - w) + val_hi;
+	return val_lo + w;
+}
+
+double log1p(double x) {
+	if(isnan(x))
+		return x;
+	if(x <= -1) {
+		if(x == -1)
+			return math_divzero(1);
+		return math_invalid(x);
+	}
+	if(isinf(x))
+		return x;
+	if(fabs(x) < 0x1p-54)
+		return x;
+
+	return (double) x87_log1p(x);
+}
+
+/** Whether y is an integer, and if it is, whether it's odd. **/
+static int integer_kind(double y, int* odd) {
+	*odd = 0;
+	if(trunc(y) != y)
+		return 0;
+	if(fabs(y) < 0x1p53)
+		*odd = (int) ((int64_t) y & 1);
+	return 1;
+}
+
+double pow(double x, double y) {
+	if(y == 0 || x == 1)
+		return 1.0;
+	if(isnan(x) || isnan(y))
+		return x + y;
+
+	int odd;
+	int is_integer = integer_kind(y, &odd);
+
+	if(x == 0) {
+		int negative = odd && signbit(x);
+		if(y < 0)
+			return math_divzero(negative);
+		return negative ? -0.0 : 0.0;
+	}
+
+	if(isinf(y)) {
+		double ax = fabs(x);
+		if(ax == 1)
+			return 1.0;
+		return ((ax < 1) == (y < 0)) ? HUGE_VAL : 0.0;
+	}
+
+	if(isinf(x)) {
+		int negative = signbit(x) && odd;
+		if(y < 0)
+			return negative ? -0.0 : 0.0;
+		return negative ? -HUGE_VAL : HUGE_VAL;
+	}
+
+	int negative = 0;
+	if(x < 0) {
+		if(!is_integer)
+			return math_invalid(x);
+		negative = odd;
+		x = -x;
+	}
+
+	//x^y = 2^(y * log2(x)), with y * log2(x) in long double so the error in it doesn't get blown up by 2^x
+	long double t;
+	asm("fyl2x" : "=t"(t) : "0"((long double) x), "u"((long double) y) : "st(1)");
+	if(t > 1100)
+		return math_oflow(negative);
+	if(t < -1200)
+		return math_uflow(negative);
+	double result = (double) x87_exp2(t);
+	if(isinf(result))
+		return math_oflow(negative);
+	if(result == 0)
+		return math_uflow(negative);
+	return negative ? -result : result;
+}
+
+/*
+ * The float versions work in double with simpler polynomials, since double has more than enough precision for them to
+ * round correctly nearly all the time. They don't branch outside of the special cases, so they also suit being inlined
+ * into loops.
+ */
+
+/** e^r for |r| <= ln(2)/2, to a little better than float precision. **/
+static inline double expf_poly(double r) {
+	return 1.0 + r * (1.0 + r * (1.0 / 2 + r * (1.0 / 6 + r * (1.0 / 24 + r * (1.0 / 120 + r * (1.0 / 720 +
+			r * (1.0 / 5040 + r * (1.0 / 40320))))))));
+}
+
+float expf(float x) {
+	if(isnan(x))
+		return x;
+	if(x > 88.72283935546875f)
+		return math_oflowf(0);
+	if(x < -103.97208404541015625f)
+		return math_uflowf(0);
+	double k = round_nearest((double) x * invln2);
+	double r = (double) x - k * ln2;
+	return (float) (expf_poly(r) * asdouble((uint64_t) ((int) k + 1023) << 52));
+}
+
+float exp2f(float x) {
+	if(isnan(x))
+		return x;
+	if(x >= 128.0f)
+		return math_oflowf(0);
+	if(x < -150.0f)
+		return math_uflowf(0);
+	double k = round_nearest(x);
+	double r = ((double) x - k) * ln2;
+	return (float) (expf_poly(r) * asdouble((uint64_t) ((int) k + 1023) << 52));
+}
+
+float expm1f(float x) {
+	return (float) expm1(x);
+}
+
+/**
+ * ln(x) for a positive, finite, normal float, using log(1 + f) = 2 * atanh(f / (2 + f)) on the mantissa.
+ */
+static inline double logf_kernel(float x) {
+	uint32_t ix = asuint(x);
+	//Bias the exponent so that the mantissa ends up in [sqrt(2)/2, sqrt(2)]
+	ix += 0x3f800000 - 0x3f3504f3;
+	int k = (int) (ix >> 23) - 0x7f;
+	ix = (ix & 0x007fffff) + 0x3f3504f3;
+	double f = (double) asfloat(ix) - 1.0;
+	double s = f / (2.0 + f);
+	double z = s * s;
+	double series = 2.0 * s * (1.0 + z * (1.0 / 3 + z * (1.0 / 5 + z * (1.0 / 7 + z * (1.0 / 9 + z * (1.0 / 11))))));
+	return k * ln2 + series;
+}
+
+/** Handles the arguments logf_kernel can't. Returns 0 if x is fine to pass to it. **/
+static inline int logf_special(float* x, float* result) {
+	uint32_t ix = asuint(*x);
+	if(ix >= 0x7f800000 || ix < 0x00800000) {
+		if(!(ix << 1)) {
+			*result = (float) math_divzero(1);
+			return 1;
+		}
+		if(ix >> 31) {
+			*result = isnan(*x) ? *x : math_invalidf(*x);
+			return 1;
+		}
+		if(ix >= 0x7f800000) {
+			*result = *x;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+float logf(float x) {
+	float result;
+	if(logf_special(&x, &result))
+		return result;
+	if(asuint(x) < 0x00800000)
+		return (float) (logf_kernel(x * 0x1p23f) - 23 * ln2);
+	return (float) logf_kernel(x);
+}
+
+float log2f(float x) {
+	float result;
+	if(logf_special(&x, &result))
+		return result;
+	if(asuint(x) < 0x00800000)
+		return (float) (logf_kernel(x * 0x1p23f) * invln2 - 23);
+	return (float) (logf_kernel(x) * invln2);
+}
+
+float log10f(float x) {
+	float result;
+	if(logf_special(&x, &result))
+		return result;
+	static const double invln10 = 0x1.bcb7b1526e50ep-2;
+	if(asuint(x) < 0x00800000)
+		return (float) ((logf_kernel(x * 0x1p23f) - 23 * ln2) * invln10);
+	return (float) (logf_kernel(x) * invln10);
+}
+
+float log1pf(float x) {
+	return (float) log1p(x);
+}
+
+float powf(float x, float y) {
+	return (float) pow(x, y);
+}
+
+double sinh(double x) {
+	double h = copysign(0.5, x);
+	double ax = fabs(x);
+	if(ax < 0x1p-26 || isnan(x))
+		return x;
+	if(ax < 22) {
+		double t = expm1(ax);
+		if(ax < 1)
+			return h * (2.0 * t - t * t / (t + 1.0));
+		return h * (t + t / (t + 1.0));
+	}
+	if(ax < 709.78)
+		return h * exp(ax);
+	//e^|x| would overflow even though sinh(x) might not, so do it in two halves
+	double w = exp(0.5 * ax);
+	double result = (h * w) * w;
+	if(isinf(result) && !isinf(x))
+		errno = ERANGE;
+	return result;
+}
+
+double cosh(double x) {
+	double ax = fabs(x);
+	if(isnan(x))
+		return x;
+	if(ax < 0.5 * ln2) {
+		if(ax < 0x1p-26)
+			return 1.0;
+		double t = expm1(ax);
+		return 1.0 + (t * t) / (2.0 * (1.0 + t));
+	}
+	if(ax < 22) {
+		double t = exp(ax);
+		return 0.5 * t + 0.5 / t;
+	}
+	if(ax < 709.78)
+		return 0.5 * exp(ax);
+	double w = exp(0.5 * ax);
+	double result = (0.5 * w) * w;
+	if(isinf(result) && !isinf(x))
+		errno = ERANGE;
+	return result;
+}
+
+double tanh(double x) {
+	double ax = fabs(x);
+	if(isnan(x))
+		return x;
+	double result;
+	if(ax > 22) {
+		result = 1.0;
+	} else if(ax >= 1) {
+		double t = expm1(2 * ax);
+		result = 1.0 - 2.0 / (t + 2.0);
+	} else if(ax >= 0x1p-55) {
+		double t = expm1(-2 * ax);
+		result = -t / (t + 2.0);
+	} else {
+		return x;
+	}
+	return copysign(result, x);
+}
+
+double asinh(double x) {
+	double ax = fabs(x);
+	if(isnan(x) || isinf(x))
+		return x;
+	double result;
+	if(ax > 0x1p28) {
+		result = log(ax) + ln2;
+	} else if(ax > 2) {
+		result = log(2 * ax + 1.0 / (sqrt(x * x + 1.0) + ax));
+	} else if(ax >= 0x1p-28) {
+		double t = x * x;
+		result = log1p(ax + t / (1.0 + sqrt(1.0 + t)));
+	} else {
+		return x;
+	}
+	return copysign(result, x);
+}
+
+double acosh(double x) {
+	if(isnan(x))
+		return x;
+	if(x < 1)
+		return math_invalid(x);
+	if(x > 0x1p28)
+		return isinf(x) ? x : log(x) + ln2;
+	if(x > 2)
+		return log(2 * x - 1.0 / (x + sqrt(x * x - 1.0)));
+	double t = x - 1.0;
+	return log1p(t + sqrt(2.0 * t + t * t));
+}
+
+double atanh(double x) {
+	double ax = fabs(x);
+	if(isnan(x))
+		return x;
+	if(ax > 1)
+		return math_invalid(x);
+	if(ax == 1)
+		return math_divzero(signbit(x));
+	if(ax < 0x1p-28)
+		return x;
+	double result;
+	if(ax < 0.5)
+		result = 0.5 * log1p(2 * ax + 2 * ax * ax / (1 - ax));
+	else
+		result = 0.5 * log1p(2 * ax / (1 - ax));
+	return copysign(result, x);
+}
+
+float sinhf(float x) {
+	return (float) sinh(x);
+}
+
+float coshf(float x) {
+	return (float) cosh(x);
+}
+
+float tanhf(float x) {
+	return (float) tanh(x);
+}
+
+float asinhf(float x) {
+	return (float) asinh(x);
+}
+
+float acoshf(float x) {
+	return (float) acosh(x);
+}
+
+float atanhf(float x) {
+	return (float) atanh(x);
+}
@@ -0,0 +1,178 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+/*
+ * The long double versions. The ones the x87 can do exactly in long double are; the rest are only worked out to double
+ * precision, which is all anything here needs so far.
+ */
+
+#include "math_private.h"
+
+long double fabsl(long double x) {
+	return __builtin_fabsl(x);
+}
+
+long double copysignl(long double x, long double y) {
+	return __builtin_copysignl(x, y);
+}
+
+long double sqrtl(long double x) {
+	if(x < 0)
+		return math_invalid((double) x);
+	long double result;
+	asm("fsqrt" : "=t"(result) : "0"(x));
+	return result;
+}
+
+long double rintl(long double x) {
+	long double result;
+	asm("frndint" : "=t"(result) : "0"(x));
+	return result;
+}
+
+long double nearbyintl(long double x) {
+	return rintl(x);
+}
+
+long lrintl(long double x) {
+	return (long) rintl(x);
+}
+
+long long llrintl(long double x) {
+	return (long long) rintl(x);
+}
+
+long double scalbnl(long double x, int n) {
+	long double result;
+	asm("fscale" : "=t"(result) : "0"(x), "u"((long double) n));
+	return result;
+}
+
+long double scalblnl(long double x, long n) {
+	long double result;
+	asm("fscale" : "=t"(result) : "0"(x), "u"((long double) n));
+	return result;
+}
+
+long double ldexpl(long double x, int exp) {
+	return scalbnl(x, exp);
+}
+
+long double fmodl(long double x, long double y) {
+	if(isnan(x) || isnan(y))
+		return x + y;
+	if(isinf(x) || y == 0)
+		return math_invalid((double) (x * y));
+	long double result;
+	asm("1: fprem\n"
+		"fnstsw %%ax\n"
+		"testb $4, %%ah\n"
+		"jnz 1b" : "=t"(result) : "0"(x), "u"(y) : "ax", "cc");
+	return result;
+}
+
+long double logl(long double x) {
+	if(!(x > 0) || isinf(x))
+		return log((double) x);
+	return x87_log(x);
+}
+
+long double log1pl(long double x) {
+	if(!(x > -1) || isinf(x))
+		return log1p((double) x);
+	return x87_log1p(x);
+}
+
+long double expl(long double x) {
+	if(isnan(x) || x > 11356 || x < -11400)
+		return exp((double) x);
+	return x87_exp(x);
+}
+
+long double exp2l(long double x) {
+	if(isnan(x) || x > 16383 || x < -16445)
+		return exp2((double) x);
+	return x87_exp2(x);
+}
+
+#define DOUBLE_PRECISION_1(name) \
+	long double name##l(long double x) { return name((double) x); }
+#define DOUBLE_PRECISION_2(name) \
+	long double name##l(long double x, long double y) { return name((double) x, (double) y); }
+
+DOUBLE_PRECISION_1(acos)
+DOUBLE_PRECISION_1(asin)
+DOUBLE_PRECISION_1(atan)
+DOUBLE_PRECISION_2(atan2)
+DOUBLE_PRECISION_1(cos)
+DOUBLE_PRECISION_1(sin)
+DOUBLE_PRECISION_1(tan)
+DOUBLE_PRECISION_1(acosh)
+DOUBLE_PRECISION_1(asinh)
+DOUBLE_PRECISION_1(atanh)
+DOUBLE_PRECISION_1(cosh)
+DOUBLE_PRECISION_1(sinh)
+DOUBLE_PRECISION_1(tanh)
+DOUBLE_PRECISION_1(expm1)
+DOUBLE_PRECISION_1(log10)
+DOUBLE_PRECISION_1(log2)
+DOUBLE_PRECISION_1(logb)
+DOUBLE_PRECISION_1(cbrt)
+DOUBLE_PRECISION_2(hypot)
+DOUBLE_PRECISION_2(pow)
+DOUBLE_PRECISION_1(erf)
+DOUBLE_PRECISION_1(erfc)
+DOUBLE_PRECISION_1(lgamma)
+DOUBLE_PRECISION_1(tgamma)
+DOUBLE_PRECISION_1(ceil)
+DOUBLE_PRECISION_1(floor)
+DOUBLE_PRECISION_1(round)
+DOUBLE_PRECISION_1(trunc)
+DOUBLE_PRECISION_2(remainder)
+DOUBLE_PRECISION_2(fdim)
+DOUBLE_PRECISION_2(fmax)
+DOUBLE_PRECISION_2(fmin)
+
+long double frexpl(long double x, int* exp) {
+	return frexp((double) x, exp);
+}
+
+int ilogbl(long double x) {
+	return ilogb((double) x);
+}
+
+long double modfl(long double x, long double* iptr) {
+	double integer;
+	long double fraction = modf((double) x, &integer);
+	*iptr = integer;
+	return fraction;
+}
+
+long lroundl(long double x) {
+	return lround((double) x);
+}
+
+long long llroundl(long double x) {
+	return llround((double) x);
+}
+
+long double remquol(long double x, long double y, int* quo) {
+	return remquo((double) x, (double) y, quo);
+}
+
+long double nanl(const char* tagp) {
+	(void) tagp;
+	return __builtin_nanl("");
+}
+
+long double nextafterl(long double x, long double y) {
+	return nextafter((double) x, (double) y);
+}
+
+long double nexttowardl(long double x, long double y) {
+	return nexttoward((double) x, y);
+}
+
+long double fmal(long double x, long double y, long double z) {
+	return fma((double) x, (double) y, (double) z);
+}
@@ -17,18 +17,534 @@
     Copyright (c) Byteduck 2016-2020. All rights reserved.
 */
 
+#include "math_private.h"
+#include <limits.h>
+
+/*
+ * Absolute values, rounding, remainders, and picking apart and putting together floating point numbers. These are all
+ * exact, so the float versions that just call the double ones give the same answers they would on their own.
+ */
+
+double fabs(double x) {
+	return asdouble(asuint64(x) & 0x7fffffffffffffffull);
+}
+
+float fabsf(float x) {
+	return asfloat(asuint(x) & 0x7fffffff);
+}
+
+double copysign(double x, double y) {
+	return asdouble((asuint64(x) & 0x7fffffffffffffffull) | (asuint64(y) & 0x8000000000000000ull));
+}
+
+float copysignf(float x, float y) {
+	return asfloat((asuint(x) & 0x7fffffff) | (asuint(y) & 0x80000000));
+}
+
+double trunc(double x) {
+	uint64_t bits = asuint64(x);
+	int exponent = (int) ((bits >> 52) & 0x7ff) - 0x3ff;
+	if(exponent >= 52)
+		return x;
+	if(exponent < 0)
+		return asdouble(bits & 0x8000000000000000ull);
+	return asdouble(bits & ~(0xfffffffffffffull >> exponent));
+}
+
+float truncf(float x) {
+	return (float) trunc(x);
+}
+
+double floor(double x) {
+	double t = trunc(x);
+	return (x < 0 && t != x) ? t - 1.0 : t;
+}
+
+float floorf(float x) {
+	return (float) floor(x);
+}
+
+double ceil(double x) {
+	double t = trunc(x);
+	return (x > 0 && t != x) ? t + 1.0 : t;
+}
+
+float ceilf(float x) {
+	return (float) ceil(x);
+}
+
+double round(double x) {
+	double t = trunc(x);
+	if(fabs(x - t) >= 0.5)
+		t += copysign(1.0, x);
+	return t;
+}
+
+float roundf(float x) {
+	return (float) round(x);
+}
+
+long lround(double x) {
+	return (long) round(x);
+}
+
+long lroundf(float x) {
+	return (long) round(x);
+}
+
+long long llround(double x) {
+	return (long long) round(x);
+}
+
+long long llroundf(float x) {
+	return (long long) round(x);
+}
+
+double rint(double x) {
+	return round_nearest(x);
+}
+
+float rintf(float x) {
+	return (float) round_nearest(x);
+}
+
+double nearbyint(double x) {
+	return round_nearest(x);
+}
+
+float nearbyintf(float x) {
+	return (float) round_nearest(x);
+}
+
+long lrint(double x) {
+	return (long) round_nearest(x);
+}
+
+long lrintf(float x) {
+	return (long) round_nearest(x);
+}
+
+long long llrint(double x) {
+	return (long long) round_nearest(x);
+}
+
+long long llrintf(float x) {
+	return (long long) round_nearest(x);
+}
+
+double modf(double x, double* iptr) {
+	double t = trunc(x);
+	*iptr = t;
+	if(isinf(x))
+		return copysign(0.0, x);
+	return copysign(x - t, x);
+}
+
+float modff(float x, float* iptr) {
+	double integer;
+	float fraction = (float) modf(x, &integer);
+	*iptr = (float) integer;
+	return fraction;
+}
+
+/*
+ * The x87 can work out exact remainders a chunk of the quotient at a time, setting C2 until it's done. The remainder is
+ * always representable, so it doesn't matter that it's done in long double.
+ */
+static long double x87_fmod(long double x, long double y) {
+	long double result;
+	asm("1: fprem\n"
+		"fnstsw %%ax\n"
+		"testb $4, %%ah\n"
+		"jnz 1b" : "=t"(result) : "0"(x), "u"(y) : "ax", "cc");
+	return result;
+}
+
+/** Like x87_fmod, but rounds the quotient to the nearest integer instead of truncating it. **/
+static long double x87_remainder(long double x, long double y, int* quotient) {
+	long double result;
+	uint16_t status;
+	asm("1: fprem1\n"
+		"fnstsw %%ax\n"
+		"testb $4, %%ah\n"
+		"jnz 1b" : "=t"(result), "=a"(status) : "0"(x), "u"(y) : "cc");
+	//The low three bits of the quotient end up in C0, C3, and C1
+	*quotient = (((status >> 8) & 1) << 2) | (((status >> 14) & 1) << 1) | ((status >> 9) & 1);
+	return result;
+}
+
+double fmod(double x, double y) {
+	if(isnan(x) || isnan(y))
+		return x + y;
+	if(isinf(x) || y == 0)
+		return math_invalid(x * y);
+	return (double) x87_fmod(x, y);
+}
+
+float fmodf(float x, float y) {
+	return (float) fmod(x, y);
+}
+
+double remquo(double x, double y, int* quo) {
+	*quo = 0;
+	if(isnan(x) || isnan(y))
+		return x + y;
+	if(isinf(x) || y == 0)
+		return math_invalid(x * y);
+	int quotient;
+	double result = (double) x87_remainder(x, y, &quotient);
+	*quo = (signbit(x) != signbit(y)) ? -quotient : quotient;
+	return result;
+}
+
+float remquof(float x, float y, int* quo) {
+	return (float) remquo(x, y, quo);
+}
+
+double remainder(double x, double y) {
+	int quotient;
+	return remquo(x, y, &quotient);
+}
+
+float remainderf(float x, float y) {
+	return (float) remainder(x, y);
+}
+
+double frexp(double x, int* exp) {
+	uint64_t bits = asuint64(x);
+	int exponent = (int) ((bits >> 52) & 0x7ff);
+	if(!exponent) {
+		if(x == 0) {
+			*exp = 0;
+			return x;
+		}
+		//Subnormal, so scale it up into the normal range first
+		x = frexp(x * 0x1p64, exp);
+		*exp -= 64;
+		return x;
+	}
+	if(exponent == 0x7ff) {
+		*exp = 0;
+		return x;
+	}
+	*exp = exponent - 0x3fe;
+	return asdouble((bits & 0x800fffffffffffffull) | 0x3fe0000000000000ull);
+}
+
+float frexpf(float x, int* exp) {
+	return (float) frexp(x, exp);
+}
+
+double scalbn(double x, int n) {
+	//Scale in up to three steps, so that exponents far outside the normal range still overflow or underflow properly
+	double y = x;
+	if(n > 1023) {
+		y *= 0x1p1023;
+		n -= 1023;
+		if(n > 1023) {
+			y *= 0x1p1023;
+			n -= 1023;
+			if(n > 1023)
+				n = 1023;
+		}
+	} else if(n < -1022) {
+		//Keep the final step from rounding twice in the subnormal range by leaving at least 53 bits of scaling for it
+		y *= 0x1p-1022 * 0x1p53;
+		n += 1022 - 53;
+		if(n < -1022) {
+			y *= 0x1p-1022 * 0x1p53;
+			n += 1022 - 53;
+			if(n < -1022)
+				n = -1022;
+		}
+	}
+	return y * asdouble((uint64_t) (0x3ff + n) << 52);
+}
+
+float scalbnf(float x, int n) {
+	float y = x;
+	if(n > 127) {
+		y *= 0x1p127f;
+		n -= 127;
+		if(n > 127) {
+			y *= 0x1p127f;
+			n -= 127;
+			if(n > 127)
+				n = 127;
+		}
+	} else if(n < -126) {
+		y *= 0x1p-126f * 0x1p24f;
+		n += 126 - 24;
+		if(n < -126) {
+			y *= 0x1p-126f * 0x1p24f;
+			n += 126 - 24;
+			if(n < -126)
+				n = -126;
+		}
+	}
+	return y * asfloat((uint32_t) (0x7f + n) << 23);
+}
+
+double scalbln(double x, long n) {
+	if(n > INT_MAX)
+		n = INT_MAX;
+	else if(n < INT_MIN)
+		n = INT_MIN;
+	return scalbn(x, (int) n);
+}
+
+float scalblnf(float x, long n) {
+	if(n > INT_MAX)
+		n = INT_MAX;
+	else if(n < INT_MIN)
+		n = INT_MIN;
+	return scalbnf(x, (int) n);
+}
+
 double ldexp(double x, int exp) {
-	return x * (0x1u >> exp);
+	return scalbn(x, exp);
+}
+
+float ldexpf(float x, int exp) {
+	return scalbnf(x, exp);
+}
+
+int ilogb(double x) {
+	if(x == 0 || isnan(x)) {
+		errno = EDOM;
+		return isnan(x) ? FP_ILOGBNAN : FP_ILOGB0;
+	}
+	if(isinf(x)) {
+		errno = EDOM;
+		return INT_MAX;
+	}
+	int exp;
+	frexp(x, &exp);
+	return exp - 1;
+}
+
+int ilogbf(float x) {
+	return ilogb(x);
+}
+
+double logb(double x) {
+	if(isnan(x))
+		return x;
+	if(isinf(x))
+		return fabs(x);
+	if(x == 0)
+		return math_divzero(1);
+	return (double) ilogb(x);
+}
+
+float logbf(float x) {
+	return (float) logb(x);
+}
+
+double nextafter(double x, double y) {
+	if(isnan(x) || isnan(y))
+		return x + y;
+	if(x == y)
+		return y;
+	if(x == 0)
+		return copysign(asdouble(1), y);
+	uint64_t bits = asuint64(x);
+	if((x < y) == (x > 0))
+		bits++;
+	else
+		bits--;
+	double result = asdouble(bits);
+	if(isinf(result) || !isnormal(result))
+		errno = ERANGE;
+	return result;
+}
+
+float nextafterf(float x, float y) {
+	if(isnan(x) || isnan(y))
+		return x + y;
+	if(x == y)
+		return y;
+	if(x == 0)
+		return copysignf(asfloat(1), y);
+	uint32_t bits = asuint(x);
+	if((x < y) == (x > 0))
+		bits++;
+	else
+		bits--;
+	float result = asfloat(bits);
+	if(isinf(result) || !isnormal(result))
+		errno = ERANGE;
+	return result;
+}
+
+double nexttoward(double x, long double y) {
+	if(isnan(y))
+		return (double) y;
+	if((long double) x == y)
+		return (double) y;
+	return nextafter(x, (long double) x < y ? INFINITY : -INFINITY);
+}
+
+float nexttowardf(float x, long double y) {
+	if(isnan(y))
+		return (float) y;
+	if((long double) x == y)
+		return (float) y;
+	return nextafterf(x, (long double) x < y ? INFINITY : -INFINITY);
+}
+
+double fdim(double x, double y) {
+	if(isnan(x) || isnan(y))
+		return x + y;
+	return x > y ? x - y : 0.0;
+}
+
+float fdimf(float x, float y) {
+	if(isnan(x) || isnan(y))
+		return x + y;
+	return x > y ? x - y : 0.0f;
+}
+
+double fmax(double x, double y) {
+	if(isnan(x))
+		return y;
+	if(isnan(y))
+		return x;
+	//fmax(-0, +0) should be +0
+	if(signbit(x) != signbit(y))
+		return signbit(x) ? y : x;
+	return x < y ? y : x;
+}
+
+float fmaxf(float x, float y) {
+	return (float) fmax(x, y);
+}
+
+double fmin(double x, double y) {
+	if(isnan(x))
+		return y;
+	if(isnan(y))
+		return x;
+	if(signbit(x) != signbit(y))
+		return signbit(x) ? x : y;
+	return x < y ? x : y;
+}
+
+float fminf(float x, float y) {
+	return (float) fmin(x, y);
+}
+
+/*
+ * This adds the exact product (as a double plus its rounding error) to z, and only rounds once at the end. It can still
+ * be off from the correctly rounded result when the sum lands exactly halfway between two doubles, but that's rare.
+ */
+double fma(double x, double y, double z) {
+	if(!isfinite(x) || !isfinite(y) || !isfinite(z) || x == 0 || y == 0)
+		return x * y + z;
+	//Splitting the operands into halves could overflow near the edges of the exponent range
+	int ex, ey;
+	frexp(x, &ex);
+	frexp(y, &ey);
+	if(ex + ey > 1000 || ex + ey < -900)
+		return x * y + z;
+
+	double product, product_error;
+	two_product(x, y, &product, &product_error);
+	double sum = product + z;
+	double b = sum - product;
+	double sum_error = (product - (sum - b)) + (z - b);
+	return sum + (sum_error + product_error);
+}
+
+float fmaf(float x, float y, float z) {
+	//The product of two floats is exact in a double
+	return (float) ((double) x * y + z);
+}
+
+double nan(const char* tagp) {
+	(void) tagp;
+	return NAN;
+}
+
+float nanf(const char* tagp) {
+	(void) tagp;
+	return __builtin_nanf("");
 }
 
 double sqrt(double x) {
+	if(x < 0)
+		return math_invalid(x);
 	double result;
 	asm("fsqrt" : "=t"(result) : "0"(x));
 	return result;
 }
 
 float sqrtf(float x) {
+	if(x < 0)
+		return math_invalidf(x);
 	float result;
 	asm("fsqrt" : "=t"(result) : "0"(x));
 	return result;
-}
\ No newline at end of file
+}
+
+double hypot(double x, double y) {
+	if(isinf(x) || isinf(y))
+		return HUGE_VAL;
+	if(isnan(x) || isnan(y))
+		return x + y;
+	//The squares can't overflow or lose precision in long double, which has a much bigger exponent range
+	long double sum = (long double) x * x + (long double) y * y;
+	long double result;
+	asm("fsqrt" : "=t"(result) : "0"(sum));
+	if(isinf((double) result))
+		errno = ERANGE;
+	return (double) result;
+}
+
+float hypotf(float x, float y) {
+	return (float) hypot(x, y);
+}
+
+static const uint32_t B1 = 715094163; // (1023 - 1023/3 - 0.03306235651) * 2^20
+static const uint32_t B2 = 696219795; // (1023 - 1023/3 - 54/3 - 0.03306235651) * 2^20
+static const double
+	P0 = 1.87595182427177009643,
+	P1 = -1.88497979543377169875,
+	P2 = 1.621429720105354466140,
+	P3 = -0.758397934778766047437,
+	P4 = 0.145996192886612446982;
+
+double cbrt(double x) {
+	uint64_t bits = asuint64(x);
+	uint32_t hx = (uint32_t) (bits >> 32) & 0x7fffffff;
+	if(hx >= 0x7ff00000)
+		return x + x;
+
+	//Get a rough guess by dividing the exponent (and the top of the mantissa along with it) by three
+	if(hx < 0x00100000) {
+		bits = asuint64(x * 0x1p54);
+		hx = (uint32_t) (bits >> 32) & 0x7fffffff;
+		if(!hx)
+			return x;
+		hx = hx / 3 + B2;
+	} else {
+		hx = hx / 3 + B1;
+	}
+	bits &= 1ull << 63;
+	bits |= (uint64_t) hx << 32;
+	double t = asdouble(bits);
+
+	//Improve it to 23 bits with a polynomial, round it to fewer bits so the next step is exact, then do a Newton step
+	double r = (t * t) * (t / x);
+	t = t * ((P0 + r * (P1 + r * P2)) + ((r * r) * r) * (P3 + r * P4));
+	t = asdouble((asuint64(t) + 0x80000000) & 0xffffffffc0000000ull);
+	double s = t * t;
+	r = x / s;
+	double w = t + t;
+	r = (r - t) / (w + r);
+	return t + t * r;
+}
+
+float cbrtf(float x) {
+	return (float) cbrt(x);
+}
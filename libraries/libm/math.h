@@ -26,10 +26,10 @@ __DECL_BEGIN
 
 #define FLT_EVAL_METHOD 0
 #define HUGE_VAL __builtin_huge_val()
-#define HUGE_VALF __builtin_huge_val()
+#define HUGE_VALF __builtin_huge_valf()
 #define HUGE_VALD __builtin_huge_val()
-#define INFINITY __builtin_huge_val()
-#define NAN __builtin_nan("")
+#define INFINITY __builtin_inff()
+#define NAN __builtin_nanf("")
 
 #define FP_INFINITE 1
 #define FP_NAN 2
@@ -37,6 +37,22 @@ __DECL_BEGIN
 #define FP_SUBNORMAL 4
 #define FP_ZERO 0
 
+#define FP_ILOGB0 (-2147483647 - 1)
+#define FP_ILOGBNAN (-2147483647 - 1)
+
+#define fpclassify(x) __builtin_fpclassify(FP_NAN, FP_INFINITE, FP_NORMAL, FP_SUBNORMAL, FP_ZERO, x)
+#define isfinite(x) __builtin_isfinite(x)
+#define isinf(x) __builtin_isinf_sign(x)
+#define isnan(x) __builtin_isnan(x)
+#define isnormal(x) __builtin_isnormal(x)
+#define signbit(x) __builtin_signbit(x)
+#define isgreater(x, y) __builtin_isgreater(x, y)
+#define isgreaterequal(x, y) __builtin_isgreaterequal(x, y)
+#define isless(x, y) __builtin_isless(x, y)
+#define islessequal(x, y) __builtin_islessequal(x, y)
+#define islessgreater(x, y) __builtin_islessgreater(x, y)
+#define isunordered(x, y) __builtin_isunordered(x, y)
+
 #define MATH_ERRNO 1
 #define MATH_ERREXCEPT 2
 #define math_errhandling MATH_ERRNO
@@ -55,6 +71,8 @@ __DECL_BEGIN
 typedef float float_t;
 typedef double double_t;
 
+extern int signgam;
+
 double acos(double x);
 float acosf(float x);
 long double acosl(long double x);
@@ -227,5 +245,11 @@ double fma(double x, double y, double z);
 float fmaf(float x, float y, float z);
 long double fmal(long double x, long double y,long double z);
 
+// duckOS extensions: the float functions over arrays of values, which are faster than calling them one at a time.
+void vsinf(const float* x, float* out, __SIZE_TYPE__ n);
+void vcosf(const float* x, float* out, __SIZE_TYPE__ n);
+void vexpf(const float* x, float* out, __SIZE_TYPE__ n);
+void vlogf(const float* x, float* out, __SIZE_TYPE__ n);
+
 __DECL_END
 
@@ -0,0 +1,175 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include "math.h"
+
+/*
+ * libm is built with -fexcess-precision=standard, so that on the x87 every assignment to a double really does round to
+ * a double. A lot of the algorithms here depend on that, which is also why none of them use double_t.
+ */
+
+static inline uint64_t asuint64(double x) {
+	union { double f; uint64_t i; } u = {x};
+	return u.i;
+}
+
+static inline double asdouble(uint64_t i) {
+	union { uint64_t i; double f; } u = {i};
+	return u.f;
+}
+
+static inline uint32_t asuint(float x) {
+	union { float f; uint32_t i; } u = {x};
+	return u.i;
+}
+
+static inline float asfloat(uint32_t i) {
+	union { uint32_t i; float f; } u = {i};
+	return u.f;
+}
+
+#define HIGH_WORD(x) ((uint32_t) (asuint64(x) >> 32))
+#define LOW_WORD(x) ((uint32_t) asuint64(x))
+#define WITH_LOW_WORD(x, low) asdouble((asuint64(x) & 0xffffffff00000000ull) | (uint32_t) (low))
+
+/** Rounds to the nearest integer (ties to even) in the current rounding mode, without raising any exceptions. **/
+static inline double round_nearest(double x) {
+#ifdef __i386__
+	double result;
+	asm("frndint" : "=t"(result) : "0"(x));
+	return result;
+#else
+	return __builtin_rint(x);
+#endif
+}
+
+/**
+ * Splits a double into its top 26 bits and the rest, so that multiplying the halves of two doubles together is exact
+ * (or nearly, for the two low halves). This masks the bits off instead of using Veltkamp's trick since that relies on
+ * every operation rounding to a double, which the x87 doesn't do.
+ */
+static inline void split(double x, double* hi, double* lo) {
+	*hi = asdouble(asuint64(x) & 0xfffffffff8000000ull);
+	*lo = x - *hi;
+}
+
+/** Multiplies two doubles, giving the result as the rounded product plus the error from rounding it. **/
+static inline void two_product(double a, double b, double* product, double* error) {
+	double ahi, alo, bhi, blo;
+	split(a, &ahi, &alo);
+	split(b, &bhi, &blo);
+	*product = a * b;
+	*error = ((ahi * bhi - *product) + ahi * blo + alo * bhi) + alo * blo;
+}
+
+/** Keeps the compiler from optimizing away a calculation that's only there for the floating point exception it raises. **/
+#define FORCE_EVAL(x) do { volatile __typeof__(x) __force_eval = (x); (void) __force_eval; } while(0)
+
+/*
+ * The results for the error cases C99 describes, which also set errno since math_errhandling is MATH_ERRNO.
+ */
+static inline double math_invalid(double x) {
+	errno = EDOM;
+	return (x - x) / (x - x);
+}
+
+static inline double math_divzero(int negative) {
+	errno = ERANGE;
+	return negative ? -HUGE_VAL : HUGE_VAL;
+}
+
+static inline double math_oflow(int negative) {
+	errno = ERANGE;
+	return (negative ? -0x1p769 : 0x1p769) * 0x1p769;
+}
+
+static inline double math_uflow(int negative) {
+	errno = ERANGE;
+	return (negative ? -0x1p-767 : 0x1p-767) * 0x1p-767;
+}
+
+static inline float math_invalidf(float x) {
+	errno = EDOM;
+	return (x - x) / (x - x);
+}
+
+static inline float math_oflowf(int negative) {
+	errno = ERANGE;
+	return (negative ? -0x1p97f : 0x1p97f) * 0x1p97f;
+}
+
+static inline float math_uflowf(int negative) {
+	errno = ERANGE;
+	return (negative ? -0x1p-95f : 0x1p-95f) * 0x1p-95f;
+}
+
+/*
+ * The x87's transcendental instructions, which work in long double. These are used where the extra precision is needed
+ * for a double result to come out right.
+ */
+
+static inline long double x87_log2e() {
+	long double result;
+	asm("fldl2e" : "=t"(result));
+	return result;
+}
+
+/** 2^x - 1 for |x| <= 1. **/
+static inline long double x87_f2xm1(long double x) {
+	long double result;
+	asm("f2xm1" : "=t"(result) : "0"(x));
+	return result;
+}
+
+/** 2^x for any x that won't overflow a long double. **/
+static inline long double x87_exp2(long double x) {
+	long double n;
+	asm("frndint" : "=t"(n) : "0"(x));
+	long double result = x87_f2xm1(x - n) + 1;
+	asm("fscale" : "=t"(result) : "0"(result), "u"(n));
+	return result;
+}
+
+/** ln(x) for positive x. **/
+static inline long double x87_log(long double x) {
+	long double result;
+	asm("fldln2\n"
+		"fxch\n"
+		"fyl2x" : "=t"(result) : "0"(x));
+	return result;
+}
+
+/** ln(1 + x) for x > -1, without losing the low bits of x to rounding 1 + x. **/
+static inline long double x87_log1p(long double x) {
+	//fyl2xp1 only works for |x| < 1 - sqrt(2)/2. Past that, 1 + x is exact unless x is so big it doesn't matter.
+	if(x > 0.29L || x < -0.29L)
+		return x87_log(1 + x);
+	long double result;
+	asm("fldln2\n"
+		"fxch\n"
+		"fyl2xp1" : "=t"(result) : "0"(x));
+	return result;
+}
+
+static inline long double x87_exp(long double x) {
+	return x87_exp2(x * x87_log2e());
+}
+
+/*
+ * Kernels shared between the double and float versions of functions. The double trig kernels take their argument as
+ * the sum of two doubles, which is what reducing it by multiples of pi/2 gives.
+ */
+int __rem_pio2(double x, double* y);
+double __sin(double x, double y, int iy);
+double __cos(double x, double y);
+double __tan(double x, double y, int odd);
+int __rem_pio2f(float x, double* y);
+float __sindf(double x);
+float __cosdf(double x);
+float __tandf(double x, int odd);
+double __exp_kernel(double hi, double lo, int k);
@@ -0,0 +1,190 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+/*
+ * The error and gamma functions. These are series and continued fractions summed in long double, which is slower than
+ * the minimax approximations everything else uses but keeps them simple to check.
+ */
+
+#include "math_private.h"
+
+int signgam;
+
+static const long double two_over_sqrt_pi = 1.1283791670955125738961589031215452L;
+static const long double one_over_sqrt_pi = 0.5641895835477562869480794515607726L;
+
+/** erf(x) for 0 <= x < 3, from erf(x) = 2/sqrt(pi) * e^-x^2 * sum of (2x^2)^n * x / (1 * 3 * ... * (2n + 1)). **/
+static long double erf_series(long double x) {
+	long double x2 = x * x;
+	long double term = x;
+	long double sum = x;
+	//Every term is positive, so nothing cancels out
+	for(int n = 1; n < 200; n++) {
+		term *= 2 * x2 / (2 * n + 1);
+		sum += term;
+		if(term < sum * 0x1p-66L)
+			break;
+	}
+	return two_over_sqrt_pi * x87_exp(-x2) * sum;
+}
+
+/** erfc(x) for x >= 2, from the continued fraction e^-x^2 / sqrt(pi) / (x + (1/2) / (x + 1 / (x + (3/2) / (x + ...)))). **/
+static long double erfc_fraction(long double x) {
+	if(x > 27)
+		return 0;
+	int terms = x < 3 ? 160 : x < 6 ? 60 : 24;
+	long double fraction = x;
+	for(int n = terms; n > 0; n--)
+		fraction = x + (n * 0.5L) / fraction;
+	return one_over_sqrt_pi * x87_exp(-x * x) / fraction;
+}
+
+double erf(double x) {
+	if(isnan(x))
+		return x;
+	double ax = fabs(x);
+	if(ax >= 6)
+		return copysign(1.0, x);
+	if(ax < 3)
+		return copysign((double) erf_series(ax), x);
+	return copysign((double) (1 - erfc_fraction(ax)), x);
+}
+
+double erfc(double x) {
+	if(isnan(x))
+		return x;
+	if(x < 2) {
+		if(x < -6)
+			return 2.0;
+		if(x < 0)
+			return (double) (2 - (x > -2 ? 1 - erf_series(-x) : erfc_fraction(-x)));
+		return (double) (1 - erf_series(x));
+	}
+	double result = (double) erfc_fraction(x);
+	if(result == 0)
+		errno = ERANGE;
+	return result;
+}
+
+float erff(float x) {
+	return (float) erf(x);
+}
+
+float erfcf(float x) {
+	return (float) erfc(x);
+}
+
+static const long double euler_gamma = 0.5772156649015328606065120900824024L;
+static const long double half_log_2pi = 0.9189385332046727417803297364056176L;
+static const long double pi_l = 3.1415926535897932384626433832795029L;
+
+/** zeta(k) - 1, for k from 2 up. **/
+static const long double zeta_minus_one[] = {
+	6.449340668482264364724e-1L, 2.020569031595942853997e-1L, 8.232323371113819151600e-2L, 3.692775514336992633137e-2L,
+	1.734306198444913971452e-2L, 8.349277381922826839798e-3L, 4.077356197944339378685e-3L, 2.008392826082214417853e-3L,
+	9.945751278180853371460e-4L, 4.941886041194645587023e-4L, 2.460865533080482986380e-4L, 1.227133475784891467518e-4L,
+	6.124813505870482925855e-5L, 3.058823630702049355173e-5L, 1.528225940865187173257e-5L, 7.637197637899762273600e-6L,
+	3.817293264999839856462e-6L, 1.908212716553938925657e-6L, 9.539620338727961131520e-7L, 4.769329867878064631167e-7L,
+	2.384505027277329900036e-7L, 1.192199259653110730678e-7L, 5.960818905125947961244e-8L, 2.980350351465228018606e-8L,
+	1.490155482836504123466e-8L, 7.450711789835429491981e-9L, 3.725334024788457054819e-9L, 1.862659723513049006404e-9L,
+	9.313274324196681828718e-10L, 4.656629065033784072989e-10L, 2.328311833676505492001e-10L, 1.164155017270051977593e-10L
+};
+
+/**
+ * lgamma(2 + z) for |z| <= 0.5, from its Taylor series (1 - gamma) * z + sum of (-1)^k * (zeta(k) - 1) / k * z^k. It's
+ * lgamma(1 + z) + log(1 + z) written out so that it's accurate right up to the zero at z = 0.
+ */
+static long double lgamma_near_two(long double z) {
+	long double sum = 0;
+	long double power = z;
+	for(size_t k = 0; k < sizeof(zeta_minus_one) / sizeof(long double); k++) {
+		power *= -z;
+		sum -= zeta_minus_one[k] * power / (k + 2);
+	}
+	return (1 - euler_gamma) * z + sum;
+}
+
+/** lgamma(x) for x > 0. **/
+static long double lgamma_positive(long double x) {
+	if(x < 0.5L)
+		return lgamma_near_two(x) - x87_log1p(x) - x87_log(x);
+	if(x < 1.5L)
+		return lgamma_near_two(x - 1) - x87_log1p(x - 1);
+	if(x <= 2.5L)
+		return lgamma_near_two(x - 2);
+
+	//Shift x up with lgamma(x) = lgamma(x + 1) - log(x) until Stirling's series converges quickly enough
+	long double product = 1;
+	while(x < 16) {
+		product *= x;
+		x += 1;
+	}
+	long double inv = 1 / x;
+	long double inv2 = inv * inv;
+	long double series = inv * (1.0L / 12 + inv2 * (-1.0L / 360 + inv2 * (1.0L / 1260 + inv2 * (-1.0L / 1680 +
+			inv2 * (1.0L / 1188 + inv2 * (-691.0L / 360360 + inv2 * (1.0L / 156 + inv2 * (-3617.0L / 122400))))))));
+	return (x - 0.5L) * x87_log(x) - x + half_log_2pi + series - x87_log(product);
+}
+
+/** sin(pi * x), which is exactly zero at the integers, unlike sin(M_PI * x). **/
+static double sinpi(double x) {
+	double n = round_nearest(2 * x);
+	double r = (x - n * 0.5) * M_PI;
+	switch((int64_t) n & 3) {
+		case 0: return __sin(r, 0, 0);
+		case 1: return __cos(r, 0);
+		case 2: return -__sin(r, 0, 0);
+		default: return -__cos(r, 0);
+	}
+}
+
+double lgamma(double x) {
+	signgam = 1;
+	if(isnan(x))
+		return x;
+	if(isinf(x))
+		return HUGE_VAL;
+	if(x <= 0 && trunc(x) == x)
+		return math_divzero(0);
+	if(x > 0)
+		return (double) lgamma_positive(x);
+
+	//Below zero, use the reflection formula gamma(x) * gamma(1 - x) = pi / sin(pi * x)
+	double s = sinpi(x);
+	if(s < 0)
+		signgam = -1;
+	return (double) (x87_log(pi_l / __builtin_fabsl((long double) s * x)) - lgamma_positive(-(long double) x));
+}
+
+float lgammaf(float x) {
+	return (float) lgamma(x);
+}
+
+double tgamma(double x) {
+	if(isnan(x))
+		return x;
+	if(x == 0)
+		return math_divzero(signbit(x));
+	if(isinf(x))
+		return x > 0 ? x : math_invalid(x);
+	if(x < 0 && trunc(x) == x)
+		return math_invalid(x);
+	if(x > 171.7)
+		return math_oflow(0);
+
+	if(x > 0)
+		return (double) x87_exp(lgamma_positive(x));
+
+	//gamma(x) = pi / (sin(pi * x) * -x * gamma(-x))
+	if(x < -190)
+		return math_uflow(sinpi(x) < 0);
+	long double reflected = x87_exp(lgamma_positive(-(long double) x));
+	double result = (double) (pi_l / (sinpi(x) * -(long double) x * reflected));
+	if(result == 0)
+		errno = ERANGE;
+	return result;
+}
+
+float tgammaf(float x) {
+	return (float) tgamma(x);
+}
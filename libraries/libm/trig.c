@@ -0,0 +1,694 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+/*
+ * The trig functions reduce their argument to [-pi/4, pi/4] and evaluate minimax polynomials on it, the same way as
+ * fdlibm. The coefficients are fdlibm's (and musl's for the float kernels).
+ */
+
+#include "math_private.h"
+
+static const double pio2_1 = 0x1.921fb544p+0;          // The first 33 bits of pi/2
+static const double pio2_1t = 0x1.0b4611a626331p-34;   // pi/2 - pio2_1
+static const double pio2_2 = 0x1.0b4611a6p-34;         // The next 33 bits of pi/2
+static const double pio2_2t = 0x1.3198a2e037073p-69;   // pi/2 - (pio2_1 + pio2_2)
+static const double pio2_3 = 0x1.3198a2ep-69;          // The next 33 bits of pi/2
+static const double pio2_3t = 0x1.b839a252049c1p-104;  // pi/2 - (pio2_1 + pio2_2 + pio2_3)
+static const double pio2_hi = 0x1.921fb54442d18p+0;
+static const double pio2_lo = 0x1.1a62633145c07p-54;
+static const double invpio2 = 0x1.45f306dc9c883p-1;
+
+/*
+ * The bits of 2/pi, for reducing arguments too big for pio2_1 + pio2_2 + pio2_3 to be precise enough. A double can be
+ * up to 2^1024, so this needs a little over 1024 + 192 bits.
+ */
+static const uint32_t two_over_pi[] = {
+	0xa2f9836e, 0x4e441529, 0xfc2757d1, 0xf534ddc0, 0xdb629599, 0x3c439041, 0xfe5163ab, 0xdebbc561,
+	0xb7246e3a, 0x424dd2e0, 0x06492eea, 0x09d1921c, 0xfe1deb1c, 0xb129a73e, 0xe88235f5, 0x2ebb4484,
+	0xe99c7026, 0xb45f7e41, 0x3991d639, 0x835339f4, 0x9c845f8b, 0xbdf9283b, 0x1ff897ff, 0xde05980f,
+	0xef2f118b, 0x5a0a6d1f, 0x6d367ecf, 0x27cb09b7, 0x4f463f66, 0x9e5fea2d, 0x7527bac7, 0xebe5f17b,
+	0x3d0739f7, 0x8a5292ea, 0x6bfb5fb1, 0x1f8d5d08, 0x56033046, 0xfc7b6bab, 0xf0cfbc20, 0x9af4361d,
+	0xa9e39161, 0x5ee61b08, 0x6599855f
+};
+
+/*
+ * Reduces a huge argument (Payne-Hanek). Writing x as M * 2^E with M a 53-bit integer, x * 2/pi mod 4 only depends on
+ * the bits of 2/pi from 2^-(E-1) onwards, since the bits before that contribute multiples of four. We multiply M by
+ * the next 192 bits of 2/pi, which leaves the integer part (the quadrant) and more than enough of the fraction even
+ * for the arguments closest to a multiple of pi/2.
+ */
+static int rem_pio2_large(double x, double* y) {
+	uint64_t bits = asuint64(x);
+	int exponent = (int) ((bits >> 52) & 0x7ff) - 1075;
+	uint64_t mantissa = (bits & 0xfffffffffffffull) | 0x10000000000000ull;
+
+	//Grab 192 bits of 2/pi starting at bit `start` (where the first bit after the binary point is bit 1)
+	int start = exponent - 1 > 1 ? exponent - 1 : 1;
+	uint32_t window[6]; // Least significant first
+	for(int i = 0; i < 6; i++) {
+		int bit = start - 1 + 32 * i;
+		int word = bit / 32, offset = bit % 32;
+		uint32_t value = two_over_pi[word] << offset;
+		if(offset)
+			value |= two_over_pi[word + 1] >> (32 - offset);
+		window[5 - i] = value;
+	}
+
+	//Multiply the mantissa by the window, least significant limb first
+	uint32_t product[9] = {0}; // The top limb is always zero, which saves checking the bounds when reading the quadrant
+	uint32_t m[2] = {(uint32_t) mantissa, (uint32_t) (mantissa >> 32)};
+	for(int i = 0; i < 2; i++) {
+		uint64_t carry = 0;
+		for(int j = 0; j < 6; j++) {
+			carry += (uint64_t) m[i] * window[j] + product[i + j];
+			product[i + j] = (uint32_t) carry;
+			carry >>= 32;
+		}
+		product[i + 6] += (uint32_t) carry;
+	}
+
+	//The product has `point` bits after the binary point. Shift the fraction up to the top so it starts at 2^-1.
+	int point = start + 191 - exponent;
+	int quadrant = (int) (((product[point / 32] | ((uint64_t) product[point / 32 + 1] << 32)) >> (point % 32)) & 3);
+	uint32_t fraction[8] = {0};
+	int shift = 256 - point;
+	int word_shift = shift / 32, bit_shift = shift % 32;
+	for(int i = 7; i >= word_shift; i--) {
+		uint32_t value = product[i - word_shift] << bit_shift;
+		if(bit_shift && i - word_shift - 1 >= 0)
+			value |= product[i - word_shift - 1] >> (32 - bit_shift);
+		fraction[i] = value;
+	}
+
+	//Round to the nearest quadrant, so the remainder is between -pi/4 and pi/4
+	int negative = fraction[7] >> 31;
+	if(negative) {
+		quadrant++;
+		uint64_t borrow = 1;
+		for(int i = 0; i < 8; i++) {
+			borrow += (uint64_t) (uint32_t) ~fraction[i];
+			fraction[i] = (uint32_t) borrow;
+			borrow >>= 32;
+		}
+	}
+
+	//Normalize the fraction so its top bit is set, and turn its top 106 bits into two doubles
+	int leading_zeros = 0;
+	while(!fraction[7] && leading_zeros < 192) {
+		for(int i = 7; i > 0; i--)
+			fraction[i] = fraction[i - 1];
+		fraction[0] = 0;
+		leading_zeros += 32;
+	}
+	if(!fraction[7]) {
+		y[0] = y[1] = 0;
+		return (bits >> 63) ? -quadrant : quadrant;
+	}
+	int lz = __builtin_clz(fraction[7]);
+	if(lz) {
+		for(int i = 7; i > 0; i--)
+			fraction[i] = (fraction[i] << lz) | (fraction[i - 1] >> (32 - lz));
+		fraction[0] <<= lz;
+		leading_zeros += lz;
+	}
+	uint64_t top = ((uint64_t) fraction[7] << 32) | fraction[6];
+	uint64_t next = ((uint64_t) fraction[5] << 32) | fraction[4];
+	double scale = asdouble((uint64_t) (1023 - leading_zeros) << 52);
+	double f_hi = (double) (top >> 11) * 0x1p-53 * scale;
+	double f_lo = ((double) (top & 0x7ff) * 0x1p-64 + (double) (next >> 11) * 0x1p-117) * scale;
+
+	//Multiply by pi/2, keeping the product as two doubles
+	double r_hi, r_lo;
+	two_product(f_hi, pio2_hi, &r_hi, &r_lo);
+	r_lo += f_hi * pio2_lo + f_lo * pio2_hi;
+	y[0] = r_hi + r_lo;
+	y[1] = r_lo - (y[0] - r_hi);
+	if(negative) {
+		y[0] = -y[0];
+		y[1] = -y[1];
+	}
+
+	if(bits >> 63) {
+		y[0] = -y[0];
+		y[1] = -y[1];
+		return -quadrant;
+	}
+	return quadrant;
+}
+
+/**
+ * Reduces x to y[0] + y[1] = x - n * pi/2, with |y[0] + y[1]| <= pi/4, and returns n. Only the low two bits of n are
+ * meaningful for huge arguments.
+ */
+int __rem_pio2(double x, double* y) {
+	uint32_t ix = HIGH_WORD(x) & 0x7fffffff;
+
+	if(ix >= 0x7ff00000) {
+		y[0] = y[1] = x - x;
+		return 0;
+	}
+
+	//Below 2^20 * pi/2, n * pio2_1 is exact, and the three parts of pi/2 are enough for any argument (Cody-Waite)
+	if(ix >= 0x413921fb)
+		return rem_pio2_large(x, y);
+
+	double fn = round_nearest(x * invpio2);
+	int n = (int) fn;
+	double r = x - fn * pio2_1;
+	double w = fn * pio2_1t;
+	y[0] = r - w;
+	int ex = (int) (ix >> 20);
+	int ey = (int) ((HIGH_WORD(y[0]) >> 20) & 0x7ff);
+	if(ex - ey > 16) {
+		//The first subtraction cancelled out a lot of bits, so use the next part of pi/2
+		double t = r;
+		w = fn * pio2_2;
+		r = t - w;
+		w = fn * pio2_2t - ((t - r) - w);
+		y[0] = r - w;
+		ey = (int) ((HIGH_WORD(y[0]) >> 20) & 0x7ff);
+		if(ex - ey > 49) {
+			t = r;
+			w = fn * pio2_3;
+			r = t - w;
+			w = fn * pio2_3t - ((t - r) - w);
+			y[0] = r - w;
+		}
+	}
+	y[1] = (r - y[0]) - w;
+	return n;
+}
+
+static const double
+	S1 = -1.66666666666666324348e-01,
+	S2 = 8.33333333332248946124e-03,
+	S3 = -1.98412698298579493134e-04,
+	S4 = 2.75573137070700676789e-06,
+	S5 = -2.50507602534068634195e-08,
+	S6 = 1.58969099521155010221e-10;
+
+/** sin(x + y) for |x + y| <= pi/4. iy says whether y is nonzero. **/
+double __sin(double x, double y, int iy) {
+	double z = x * x;
+	double w = z * z;
+	double r = S2 + z * (S3 + z * S4) + z * w * (S5 + z * S6);
+	double v = z * x;
+	if(!iy)
+		return x + v * (S1 + z * r);
+	return x - ((z * (0.5 * y - v * r) - y) - v * S1);
+}
+
+static const double
+	C1 = 4.16666666666666019037e-02,
+	C2 = -1.38888888888741095749e-03,
+	C3 = 2.48015872894767294178e-05,
+	C4 = -2.75573143513906633035e-07,
+	C5 = 2.08757232129817482790e-09,
+	C6 = -1.13596475577881948265e-11;
+
+/** cos(x + y) for |x + y| <= pi/4. **/
+double __cos(double x, double y) {
+	double z = x * x;
+	double w = z * z;
+	double r = z * (C1 + z * (C2 + z * C3)) + w * w * (C4 + z * (C5 + z * C6));
+	double hz = 0.5 * z;
+	w = 1.0 - hz;
+	return w + (((1.0 - w) - hz) + (z * r - x * y));
+}
+
+static const double T[] = {
+	3.33333333333334091986e-01,
+	1.33333333333201242699e-01,
+	5.39682539762260521377e-02,
+	2.18694882948595424599e-02,
+	8.86323982359930005737e-03,
+	3.59207910759131235356e-03,
+	1.45620945432529025516e-03,
+	5.88041240820264096874e-04,
+	2.46463134818469906812e-04,
+	7.81794442939557092300e-05,
+	7.14072491382608190305e-05,
+	-1.85586374855275456654e-05,
+	2.59073051863633712884e-05,
+};
+static const double pio4 = 0x1.921fb54442d18p-1;
+static const double pio4lo = 0x1.1a62633145c07p-55;
+
+/** tan(x + y) for |x + y| <= pi/4, or -1/tan(x + y) if odd is set. **/
+double __tan(double x, double y, int odd) {
+	uint32_t hx = HIGH_WORD(x);
+	int big = (hx & 0x7fffffff) >= 0x3fe59428; // |x| >= 0.6744
+	int negative = 0;
+	if(big) {
+		//Use tan(pi/4 - x) = (1 - tan(x)) / (1 + tan(x)) so the polynomial stays near zero
+		negative = hx >> 31;
+		if(negative) {
+			x = -x;
+			y = -y;
+		}
+		x = (pio4 - x) + (pio4lo - y);
+		y = 0.0;
+	}
+	double z = x * x;
+	double w = z * z;
+	double r = T[1] + w * (T[3] + w * (T[5] + w * (T[7] + w * (T[9] + w * T[11]))));
+	double v = z * (T[2] + w * (T[4] + w * (T[6] + w * (T[8] + w * (T[10] + w * T[12])))));
+	double s = z * x;
+	r = y + z * (s * (r + v) + y) + s * T[0];
+	w = x + r;
+	if(big) {
+		s = 1 - 2 * odd;
+		v = s - 2.0 * (x + (r - w * w / (w + s)));
+		return negative ? -v : v;
+	}
+	if(!odd)
+		return w;
+
+	//-1/(x + r) would be off by up to two ulps, so work it out with the halves of w and -1/w
+	double w0 = WITH_LOW_WORD(w, 0);
+	v = r - (w0 - x);
+	double a = -1.0 / w;
+	double a0 = WITH_LOW_WORD(a, 0);
+	return a0 + a * (1.0 + a0 * w0 + a0 * v);
+}
+
+double sin(double x) {
+	uint32_t ix = HIGH_WORD(x) & 0x7fffffff;
+	if(ix <= 0x3fe921fb) {
+		if(ix < 0x3e500000)
+			return x;
+		return __sin(x, 0.0, 0);
+	}
+	if(ix >= 0x7ff00000)
+		return math_invalid(x);
+
+	double y[2];
+	switch(__rem_pio2(x, y) & 3) {
+		case 0: return __sin(y[0], y[1], 1);
+		case 1: return __cos(y[0], y[1]);
+		case 2: return -__sin(y[0], y[1], 1);
+		default: return -__cos(y[0], y[1]);
+	}
+}
+
+double cos(double x) {
+	uint32_t ix = HIGH_WORD(x) & 0x7fffffff;
+	if(ix <= 0x3fe921fb) {
+		if(ix < 0x3e46a09e)
+			return 1.0;
+		return __cos(x, 0.0);
+	}
+	if(ix >= 0x7ff00000)
+		return math_invalid(x);
+
+	double y[2];
+	switch(__rem_pio2(x, y) & 3) {
+		case 0: return __cos(y[0], y[1]);
+		case 1: return -__sin(y[0], y[1], 1);
+		case 2: return -__cos(y[0], y[1]);
+		default: return __sin(y[0], y[1], 1);
+	}
+}
+
+double tan(double x) {
+	uint32_t ix = HIGH_WORD(x) & 0x7fffffff;
+	if(ix <= 0x3fe921fb) {
+		if(ix < 0x3e400000)
+			return x;
+		return __tan(x, 0.0, 0);
+	}
+	if(ix >= 0x7ff00000)
+		return math_invalid(x);
+
+	double y[2];
+	int n = __rem_pio2(x, y);
+	return __tan(y[0], y[1], n & 1);
+}
+
+static const double pS0 = 1.66666666666666657415e-01,
+	pS1 = -3.25565818622400915405e-01,
+	pS2 = 2.01212532134862925881e-01,
+	pS3 = -4.00555345006794114027e-02,
+	pS4 = 7.91534994289814532176e-04,
+	pS5 = 3.47933107596021167570e-05,
+	qS1 = -2.40339491173441421878e+00,
+	qS2 = 2.02094576023350569471e+00,
+	qS3 = -6.88283971605453293030e-01,
+	qS4 = 7.70381505559019352791e-02;
+
+/** The rational approximation that asin and acos share: (asin(sqrt(z)) - sqrt(z)) / sqrt(z)^3 for z in [0, 0.25]. **/
+static double asin_rational(double z) {
+	double p = z * (pS0 + z * (pS1 + z * (pS2 + z * (pS3 + z * (pS4 + z * pS5)))));
+	double q = 1.0 + z * (qS1 + z * (qS2 + z * (qS3 + z * qS4)));
+	return p / q;
+}
+
+double asin(double x) {
+	uint32_t hx = HIGH_WORD(x);
+	uint32_t ix = hx & 0x7fffffff;
+	if(ix >= 0x3ff00000) {
+		if(ix == 0x3ff00000 && !LOW_WORD(x))
+			return x * pio2_hi;
+		return math_invalid(x);
+	}
+
+	if(ix < 0x3fe00000) {
+		if(ix < 0x3e500000)
+			return x;
+		return x + x * asin_rational(x * x);
+	}
+
+	//For |x| >= 0.5, asin(x) = pi/2 - 2 * asin(sqrt((1 - |x|) / 2))
+	double z = (1 - fabs(x)) * 0.5;
+	double s = sqrt(z);
+	double r = asin_rational(z);
+	double result;
+	if(ix >= 0x3fef3333) {
+		result = pio2_hi - (2 * (s + s * r) - pio2_lo);
+	} else {
+		//Split sqrt(z) into f + c to get a few more bits out of it
+		double f = WITH_LOW_WORD(s, 0);
+		double c = (z - f * f) / (s + f);
+		result = 0.5 * pio2_hi - (2 * s * r - (pio2_lo - 2 * c) - (0.5 * pio2_hi - 2 * f));
+	}
+	return (hx >> 31) ? -result : result;
+}
+
+double acos(double x) {
+	uint32_t hx = HIGH_WORD(x);
+	uint32_t ix = hx & 0x7fffffff;
+	if(ix >= 0x3ff00000) {
+		if(ix == 0x3ff00000 && !LOW_WORD(x))
+			return (hx >> 31) ? 2 * pio2_hi : 0.0;
+		return math_invalid(x);
+	}
+
+	if(ix < 0x3fe00000) {
+		if(ix <= 0x3c600000)
+			return pio2_hi;
+		return pio2_hi - (x - (pio2_lo - x * asin_rational(x * x)));
+	}
+
+	if(hx >> 31) {
+		double z = (1.0 + x) * 0.5;
+		double s = sqrt(z);
+		double w = asin_rational(z) * s - pio2_lo;
+		return 2 * (pio2_hi - (s + w));
+	}
+
+	double z = (1.0 - x) * 0.5;
+	double s = sqrt(z);
+	double df = WITH_LOW_WORD(s, 0);
+	double c = (z - df * df) / (s + df);
+	double w = asin_rational(z) * s + c;
+	return 2 * (df + w);
+}
+
+static const double atanhi[] = {
+	4.63647609000806093515e-01, // atan(0.5)
+	7.85398163397448278999e-01, // atan(1.0)
+	9.82793723247329054082e-01, // atan(1.5)
+	1.57079632679489655800e+00, // atan(inf)
+};
+
+static const double atanlo[] = {
+	2.26987774529616870924e-17,
+	3.06161699786838301793e-17,
+	1.39033110312309984516e-17,
+	6.12323399573676603587e-17,
+};
+
+static const double aT[] = {
+	3.33333333333329318027e-01,
+	-1.99999999998764832476e-01,
+	1.42857142725034663711e-01,
+	-1.11111104054623557880e-01,
+	9.09088713343650656196e-02,
+	-7.69187620504482999495e-02,
+	6.66107313738753120669e-02,
+	-5.83357013379057348645e-02,
+	4.97687799461593236017e-02,
+	-3.65315727442169155270e-02,
+	1.62858201153657823623e-02,
+};
+
+double atan(double x) {
+	uint32_t hx = HIGH_WORD(x);
+	uint32_t ix = hx & 0x7fffffff;
+	int negative = hx >> 31;
+	int id;
+
+	if(ix >= 0x44100000) {
+		if(isnan(x))
+			return x;
+		return negative ? -atanhi[3] : atanhi[3];
+	}
+
+	//Reduce |x| to below 7/16 with atan(x) = atan(c) + atan((x - c) / (1 + x * c)) for c in 0.5, 1, 1.5 and inf
+	if(ix < 0x3fdc0000) {
+		if(ix < 0x3e400000)
+			return x;
+		id = -1;
+	} else {
+		x = fabs(x);
+		if(ix < 0x3ff30000) {
+			if(ix < 0x3fe60000) {
+				id = 0;
+				x = (2.0 * x - 1.0) / (2.0 + x);
+			} else {
+				id = 1;
+				x = (x - 1.0) / (x + 1.0);
+			}
+		} else {
+			if(ix < 0x40038000) {
+				id = 2;
+				x = (x - 1.5) / (1.0 + 1.5 * x);
+			} else {
+				id = 3;
+				x = -1.0 / x;
+			}
+		}
+	}
+
+	double z = x * x;
+	double w = z * z;
+	double s1 = z * (aT[0] + w * (aT[2] + w * (aT[4] + w * (aT[6] + w * (aT[8] + w * aT[10])))));
+	double s2 = w * (aT[1] + w * (aT[3] + w * (aT[5] + w * (aT[7] + w * aT[9]))));
+	if(id < 0)
+		return x - x * (s1 + s2);
+	z = atanhi[id] - ((x * (s1 + s2) - atanlo[id]) - x);
+	return negative ? -z : z;
+}
+
+static const double pi = 0x1.921fb54442d18p+1;
+static const double pi_lo = 0x1.1a62633145c07p-53;
+
+double atan2(double y, double x) {
+	if(isnan(x) || isnan(y))
+		return x + y;
+
+	uint32_t ix = HIGH_WORD(x), lx = LOW_WORD(x);
+	uint32_t iy = HIGH_WORD(y), ly = LOW_WORD(y);
+	if(ix == 0x3ff00000 && !lx)
+		return atan(y);
+
+	int m = (int) (((iy >> 31) & 1) | ((ix >> 30) & 2)); // 2 * sign(x) + sign(y)
+	ix &= 0x7fffffff;
+	iy &= 0x7fffffff;
+
+	if(!(iy | ly)) {
+		switch(m) {
+			case 0:
+			case 1: return y;
+			case 2: return pi;
+			default: return -pi;
+		}
+	}
+
+	if(!(ix | lx))
+		return (m & 1) ? -pio2_hi : pio2_hi;
+
+	if(ix == 0x7ff00000) {
+		if(iy == 0x7ff00000) {
+			switch(m) {
+				case 0: return pio4;
+				case 1: return -pio4;
+				case 2: return 3 * pio4;
+				default: return -3 * pio4;
+			}
+		}
+		switch(m) {
+			case 0: return 0.0;
+			case 1: return -0.0;
+			case 2: return pi;
+			default: return -pi;
+		}
+	}
+
+	//|y/x| > 2^64
+	if(ix + (64 << 20) < iy || iy == 0x7ff00000)
+		return (m & 1) ? -pio2_hi : pio2_hi;
+
+	//|y/x| < 2^-64 with x < 0 is just pi, and dividing could underflow
+	double z;
+	if((m & 2) && iy + (64 << 20) < ix)
+		z = 0;
+	else
+		z = atan(fabs(y / x));
+
+	switch(m) {
+		case 0: return z;
+		case 1: return -z;
+		case 2: return pi - (z - pi_lo);
+		default: return (z - pi_lo) - pi;
+	}
+}
+
+/*
+ * The float versions do their work in double, which has plenty of spare precision for them, so they don't need the
+ * careful extra-precision steps the double versions do.
+ */
+
+static const double pio2_1f = 0x1.921fb5p+0;          // The first 25 bits of pi/2
+static const double pio2_1tf = 0x1.110b4611a6263p-26; // pi/2 - pio2_1f
+
+/** Reduces x to y = x - n * pi/2 with |y| <= pi/4, and returns n. **/
+int __rem_pio2f(float x, double* y) {
+	uint32_t ix = asuint(x) & 0x7fffffff;
+
+	//Below 2^28 * pi/2, n fits in 28 bits, so n * pio2_1f is exact
+	if(ix < 0x4dc90fdb) {
+		double fn = round_nearest((double) x * invpio2);
+		*y = (double) x - fn * pio2_1f - fn * pio2_1tf;
+		return (int) fn;
+	}
+
+	if(ix >= 0x7f800000) {
+		*y = x - x;
+		return 0;
+	}
+
+	double parts[2];
+	int n = rem_pio2_large(x, parts);
+	*y = parts[0] + parts[1];
+	return n;
+}
+
+static const double
+	S1F = -0x15555554cbac77.0p-55,
+	S2F = 0x111110896efbb2.0p-59,
+	S3F = -0x1a00f9e2cae774.0p-65,
+	S4F = 0x16cd878c3b46a7.0p-71;
+
+/** sin(x) for |x| <= pi/4. **/
+float __sindf(double x) {
+	double z = x * x;
+	double w = z * z;
+	double r = S3F + z * S4F;
+	double s = z * x;
+	return (float) ((x + s * (S1F + z * S2F)) + s * w * r);
+}
+
+static const double
+	C0F = -0x1ffffffd0c5e81.0p-54,
+	C1F = 0x155553e1053a42.0p-57,
+	C2F = -0x16c087e80f1e27.0p-62,
+	C3F = 0x199342e0ee5069.0p-68;
+
+/** cos(x) for |x| <= pi/4. **/
+float __cosdf(double x) {
+	double z = x * x;
+	double w = z * z;
+	double r = C2F + z * C3F;
+	return (float) (((1.0 + z * C0F) + w * C1F) + (w * z) * r);
+}
+
+static const double TF[] = {
+	0x15554d3418c99f.0p-54,
+	0x1112fd38999f72.0p-55,
+	0x1b54c91d865afe.0p-57,
+	0x191df3908c33ce.0p-58,
+	0x185dadfcecf44e.0p-61,
+	0x1362b9bf971bcd.0p-59,
+};
+
+/** tan(x) for |x| <= pi/4, or -1/tan(x) if odd is set. **/
+float __tandf(double x, int odd) {
+	double z = x * x;
+	double r = TF[4] + z * TF[5];
+	double t = TF[2] + z * TF[3];
+	double w = z * z;
+	double s = z * x;
+	double u = TF[0] + z * TF[1];
+	r = (x + s * u) + (s * w) * (t + w * r);
+	return (float) (odd ? -1.0 / r : r);
+}
+
+float sinf(float x) {
+	uint32_t ix = asuint(x) & 0x7fffffff;
+	if(ix <= 0x3f490fda) {
+		if(ix < 0x39800000)
+			return x;
+		return __sindf(x);
+	}
+	if(ix >= 0x7f800000)
+		return math_invalidf(x);
+
+	double y;
+	switch(__rem_pio2f(x, &y) & 3) {
+		case 0: return __sindf(y);
+		case 1: return __cosdf(y);
+		case 2: return __sindf(-y);
+		default: return -__cosdf(y);
+	}
+}
+
+float cosf(float x) {
+	uint32_t ix = asuint(x) & 0x7fffffff;
+	if(ix <= 0x3f490fda) {
+		if(ix < 0x39800000)
+			return 1.0f;
+		return __cosdf(x);
+	}
+	if(ix >= 0x7f800000)
+		return math_invalidf(x);
+
+	double y;
+	switch(__rem_pio2f(x, &y) & 3) {
+		case 0: return __cosdf(y);
+		case 1: return __sindf(-y);
+		case 2: return -__cosdf(y);
+		default: return __sindf(y);
+	}
+}
+
+float tanf(float x) {
+	uint32_t ix = asuint(x) & 0x7fffffff;
+	if(ix <= 0x3f490fda) {
+		if(ix < 0x39800000)
+			return x;
+		return __tandf(x, 0);
+	}
+	if(ix >= 0x7f800000)
+		return math_invalidf(x);
+
+	double y;
+	int n = __rem_pio2f(x, &y);
+	return __tandf(y, n & 1);
+}
+
+float asinf(float x) {
+	return (float) asin(x);
+}
+
+float acosf(float x) {
+	return (float) acos(x);
+}
+
+float atanf(float x) {
+	return (float) atan(x);
+}
+
+float atan2f(float y, float x) {
+	return (float) atan2(y, x);
+}
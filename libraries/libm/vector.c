@@ -0,0 +1,186 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+/*
+ * Versions of the float functions that work on whole arrays at a time, for things like filling gradients and
+ * processing audio. When the CPU has SSE2, they do four values at once with single precision polynomials (from Cephes),
+ * which are good to within a couple of ulps. Any group of four with a value the polynomials don't cover (huge, NaN,
+ * infinite, or about to overflow or underflow) is handed to the normal scalar functions instead.
+ */
+
+#include "math_private.h"
+#include <emmintrin.h>
+
+#define CPU_UNKNOWN 0
+#define CPU_SSE2 1
+#define CPU_NO_SSE2 2
+
+static int s_cpu = CPU_UNKNOWN;
+
+static int has_sse2() {
+	if(s_cpu == CPU_UNKNOWN) {
+		unsigned int eax, ebx, ecx, edx;
+		asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+		s_cpu = (edx & (1 << 26)) ? CPU_SSE2 : CPU_NO_SSE2;
+	}
+	return s_cpu == CPU_SSE2;
+}
+
+#define SSE2 __attribute__((target("sse2")))
+
+SSE2 static inline __m128 select_ps(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/** sin(x) (or cos(x), if cos is set) for four values with |x| <= 8192. **/
+SSE2 static inline __m128 sincos4(__m128 x, int cos) {
+	//Reduce to [-pi/4, pi/4] with a quadrant. pi/2 is split into parts of 11 bits, so that q * each of them but the last is exact.
+	__m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.636619772367581f)));
+	__m128 qf = _mm_cvtepi32_ps(q);
+	__m128 r = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(1.5703125f)));
+	r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(0x1.fb4p-12f)));
+	r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(0x1.444p-24f)));
+	r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(0x1.68c234p-39f)));
+	if(cos)
+		q = _mm_add_epi32(q, _mm_set1_epi32(1));
+
+	__m128 z = _mm_mul_ps(r, r);
+	__m128 s = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(-1.9515295891e-4f)), _mm_set1_ps(8.3321608736e-3f));
+	s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(-1.6666654611e-1f));
+	s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, z), r), r);
+	__m128 c = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(2.443315711809948e-5f)), _mm_set1_ps(-1.388731625493765e-3f));
+	c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(4.166664568298827e-2f));
+	c = _mm_mul_ps(_mm_mul_ps(c, z), z);
+	c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+	//Odd quadrants use the cosine polynomial, and the second two quadrants are negated
+	__m128i one = _mm_set1_epi32(1);
+	__m128 use_cos = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+	__m128 negate = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30));
+	return _mm_xor_ps(select_ps(use_cos, c, s), negate);
+}
+
+SSE2 static void vsincosf_sse2(const float* x, float* out, size_t n, int cos) {
+	__m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4) {
+		__m128 v = _mm_loadu_ps(x + i);
+		//cmpnle is true for NaNs as well as anything bigger
+		if(_mm_movemask_ps(_mm_cmpnle_ps(_mm_and_ps(v, abs_mask), _mm_set1_ps(8192.0f)))) {
+			for(size_t j = i; j < i + 4; j++)
+				out[j] = cos ? cosf(x[j]) : sinf(x[j]);
+			continue;
+		}
+		_mm_storeu_ps(out + i, sincos4(v, cos));
+	}
+	for(; i < n; i++)
+		out[i] = cos ? cosf(x[i]) : sinf(x[i]);
+}
+
+SSE2 static void vexpf_sse2(const float* x, float* out, size_t n) {
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4) {
+		__m128 v = _mm_loadu_ps(x + i);
+		//Past these, 2^k isn't a normal float anymore
+		if(_mm_movemask_ps(_mm_or_ps(_mm_cmpnle_ps(v, _mm_set1_ps(88.0f)), _mm_cmpnge_ps(v, _mm_set1_ps(-87.0f))))) {
+			for(size_t j = i; j < i + 4; j++)
+				out[j] = expf(x[j]);
+			continue;
+		}
+
+		//e^x = 2^k * e^r, with r = x - k * ln(2) worked out in two parts
+		__m128i k = _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(1.44269504088896341f)));
+		__m128 kf = _mm_cvtepi32_ps(k);
+		__m128 r = _mm_sub_ps(v, _mm_mul_ps(kf, _mm_set1_ps(0.693359375f)));
+		r = _mm_sub_ps(r, _mm_mul_ps(kf, _mm_set1_ps(-2.12194440e-4f)));
+
+		__m128 p = _mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(1.9875691500e-4f)), _mm_set1_ps(1.3981999507e-3f));
+		p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(8.3334519073e-3f));
+		p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(4.1665795894e-2f));
+		p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.6666665459e-1f));
+		p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(5.0000001201e-1f));
+		p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, r), r), r), _mm_set1_ps(1.0f));
+
+		__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(k, _mm_set1_epi32(127)), 23));
+		_mm_storeu_ps(out + i, _mm_mul_ps(p, scale));
+	}
+	for(; i < n; i++)
+		out[i] = expf(x[i]);
+}
+
+SSE2 static void vlogf_sse2(const float* x, float* out, size_t n) {
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4) {
+		__m128 v = _mm_loadu_ps(x + i);
+		//Zero, negatives, subnormals, infinity, and NaN all need special handling
+		if(_mm_movemask_ps(_mm_or_ps(_mm_cmpnge_ps(v, _mm_set1_ps(0x1p-126f)), _mm_cmpnle_ps(v, _mm_set1_ps(0x1.fffffep127f))))) {
+			for(size_t j = i; j < i + 4; j++)
+				out[j] = logf(x[j]);
+			continue;
+		}
+
+		//Split x into m * 2^e with m in [0.5, 1), then move m into [sqrt(2)/2, sqrt(2)) and take one off
+		__m128i bits = _mm_castps_si128(v);
+		__m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+		__m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f000000)));
+		__m128 small = _mm_cmplt_ps(m, _mm_set1_ps(0.707106781186547524f));
+		__m128 f = _mm_add_ps(_mm_sub_ps(m, _mm_set1_ps(1.0f)), _mm_and_ps(small, m));
+		e = _mm_sub_ps(e, _mm_and_ps(small, _mm_set1_ps(1.0f)));
+
+		__m128 z = _mm_mul_ps(f, f);
+		__m128 y = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(7.0376836292e-2f)), _mm_set1_ps(-1.1514610310e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(1.1676998740e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(-1.2420140846e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(1.4249322787e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(-1.6668057665e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(2.0000714765e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(-2.4999993993e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(3.3333331174e-1f));
+		y = _mm_mul_ps(_mm_mul_ps(y, f), z);
+
+		//log(x) = e * ln(2) + log(1 + f), with ln(2) in two parts
+		y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(-2.12194440e-4f)));
+		y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+		__m128 result = _mm_add_ps(f, y);
+		result = _mm_add_ps(result, _mm_mul_ps(e, _mm_set1_ps(0.693359375f)));
+		_mm_storeu_ps(out + i, result);
+	}
+	for(; i < n; i++)
+		out[i] = logf(x[i]);
+}
+
+void vsinf(const float* x, float* out, size_t n) {
+	if(has_sse2()) {
+		vsincosf_sse2(x, out, n, 0);
+		return;
+	}
+	for(size_t i = 0; i < n; i++)
+		out[i] = sinf(x[i]);
+}
+
+void vcosf(const float* x, float* out, size_t n) {
+	if(has_sse2()) {
+		vsincosf_sse2(x, out, n, 1);
+		return;
+	}
+	for(size_t i = 0; i < n; i++)
+		out[i] = cosf(x[i]);
+}
+
+void vexpf(const float* x, float* out, size_t n) {
+	if(has_sse2()) {
+		vexpf_sse2(x, out, n);
+		return;
+	}
+	for(size_t i = 0; i < n; i++)
+		out[i] = expf(x[i]);
+}
+
+void vlogf(const float* x, float* out, size_t n) {
+	if(has_sse2()) {
+		vlogf_sse2(x, out, n);
+		return;
+	}
+	for(size_t i = 0; i < n; i++)
+		out[i] = logf(x[i]);
+}
@@ -22,6 +22,7 @@
 #include <cstdio>
 #include <sys/shm.h>
 #include <libgraphics/Font.h>
+#include <libgraphics/Image.h>
 #include <utility>
 #include <libriver/river.h>
 
@@ -54,6 +55,11 @@ Context* Context::init() {
 	}
 	auto connection = conn_res.value();
 
+	//Events are sent to us a lot, so have them skip the kernel if we can
+	auto ring_res = connection->use_shared_ring();
+	if(ring_res.is_error())
+		Log::warnf("libpond: Couldn't set up shared ring, falling back to socket: {}", River::error_str(ring_res.code()));
+
 	auto endpoint_res = connection->get_endpoint("pond_server");
 	if(endpoint_res.is_error()) {
 		Log::errf("libpond: Couldn't get endpoint: {}", River::error_str(conn_res.code()));
@@ -81,6 +87,7 @@ Context::Context(std::shared_ptr<Endpoint> endpt): endpoint(std::move(endpt)) {
 	GET_FUNC(resize_window, WindowResizedPkt, WindowResizePkt, resize_window);
 	GET_FUNC(invalidate_window, void, WindowInvalidatePkt, invalidate_window);
 	GET_FUNC(get_font, FontResponsePkt, GetFontPkt, get_font);
+	GET_FUNC(get_image, ImageResponsePkt, GetImagePkt, get_image);
 	GET_FUNC(set_title, void, SetTitlePkt, set_title);
 	GET_FUNC(reparent, void, WindowReparentPkt, reparent);
 	GET_FUNC(set_hint, void, SetHintPkt, set_hint);
@@ -89,12 +96,21 @@ Context::Context(std::shared_ptr<Endpoint> endpt): endpoint(std::move(endpt)) {
 	GET_FUNC(set_app_info, void, App::Info, set_app_info);
 	GET_FUNC(focus_window, void, WindowFocusPkt, focus_window);
 	GET_FUNC(set_minimum_size, void, WindowMinSizePkt, set_minimum_size);
+	GET_FUNC(mouse_motion_handled, void, MouseMotionHandledPkt, mouse_motion_handled);
+
+	Image::set_shared_loader([this](const std::string& path) { return get_image(path); });
 }
 
 void Context::read_events(bool block) {
 	endpoint->bus()->read_and_handle_packets(block);
 }
 
+void Context::event_taken(const Event& event) {
+	//Windows with a motion hint get held back mouse movement once they've seen the last of it
+	if(event.type == PEVENT_MOUSE_MOVE && event.mouse_move.window->_motion_hint)
+		__river_mouse_motion_handled({event.mouse_move.window->id()});
+}
+
 bool Context::has_event() {
 	read_events(false);
 	return !events.empty();
@@ -107,6 +123,7 @@ Event Context::next_event() {
 		read_events(false);
 	Event ret = events.front();
 	events.pop_front();
+	event_taken(ret);
 	return ret;
 }
 
@@ -122,6 +139,7 @@ Event Context::next_event(int type) {
 			if(it->type == type) {
 				Event ret = *it;
 				events.erase(it);
+				event_taken(ret);
 				return ret;
 			}
 			it++;
@@ -150,6 +168,32 @@ Font* Context::get_font(const char* font) {
 	return event.font_response.font;
 }
 
+Framebuffer* Context::get_image(const std::string& path) {
+	//Longer paths wouldn't fit in the packet
+	if(path.size() > 256)
+		return nullptr;
+
+	auto resp = __river_get_image({path});
+	if(resp.image_shm_id < 0)
+		return nullptr;
+
+	//Each image is attached once and stays attached, since the framebuffers handed out point straight into it
+	auto& buffer = images[resp.image_shm_id];
+	if(!buffer) {
+		auto buffer_res = SharedBuffer::adopt(resp.image_shm_id);
+		if(buffer_res.is_error()) {
+			Log::errf("libpond: Failed to attach image shm: {}", buffer_res.result());
+			images.erase(resp.image_shm_id);
+			return nullptr;
+		}
+		buffer = buffer_res.value();
+	}
+
+	if(buffer->size<Color>() < (size_t) (resp.dimensions.width * resp.dimensions.height))
+		return nullptr;
+	return new Framebuffer(buffer->ptr<Color>(), resp.dimensions.width, resp.dimensions.height);
+}
+
 int Context::connection_fd() {
 	return endpoint->bus()->file_descriptor();
 }
@@ -30,6 +30,7 @@
 #include <deque>
 #include <memory>
 #include <libriver/river.h>
+#include <libduck/SharedBuffer.h>
 
 namespace Pond {
 	/**
@@ -78,6 +79,14 @@ namespace Pond {
 		 */
 		Gfx::Font* get_font(const char* font);
 
+		/**
+		 * Gets a decoded PNG from pond's image cache, which is shared between every app that loads it. Gfx::Image::load
+		 * uses this automatically once the context is initialized.
+		 * @param path The path of the PNG.
+		 * @return A framebuffer pointing to the image's read-only pixels, or nullptr if pond doesn't cache the image.
+		 */
+		Gfx::Framebuffer* get_image(const std::string& path);
+
 		/**
 		 * Returns the file descriptor for the socket used to listen for events. This can be used to wait on
 		 * events from pond as well as other file descriptors with select(), poll(), or similar.
@@ -101,6 +110,7 @@ namespace Pond {
 		explicit Context(std::shared_ptr<River::Endpoint> endpoint);
 
 		void read_events(bool block);
+		void event_taken(const Event& event);
 
 		void handle_window_opened(const WindowOpenedPkt& pkt, Event& event);
 		void handle_window_destroyed(const WindowDestroyPkt& pkt, Event& event);
@@ -117,6 +127,7 @@ namespace Pond {
 		std::shared_ptr<River::Endpoint> endpoint;
 		std::map<int, Window*> windows;
 		std::map<std::string, Gfx::Font*> fonts;
+		std::map<int, Duck::Ptr<Duck::SharedBuffer>> images;
 		std::deque<Event> events;
 
 #define PONDFUNC(name, ret_t, data_t) River::Function<ret_t, data_t> __river_##name = {#name}
@@ -126,6 +137,7 @@ namespace Pond {
 		PONDFUNC(resize_window, WindowResizedPkt, WindowResizePkt);
 		PONDFUNC(invalidate_window, void, WindowInvalidatePkt);
 		PONDFUNC(get_font, FontResponsePkt, GetFontPkt);
+		PONDFUNC(get_image, ImageResponsePkt, GetImagePkt);
 		PONDFUNC(set_title, void, SetTitlePkt);
 		PONDFUNC(reparent, void, WindowReparentPkt);
 		PONDFUNC(set_hint, void, SetHintPkt);
@@ -134,6 +146,7 @@ namespace Pond {
 		PONDFUNC(set_app_info, void, App::Info);
 		PONDFUNC(focus_window, void, WindowFocusPkt);
 		PONDFUNC(set_minimum_size, void, WindowMinSizePkt);
+		PONDFUNC(mouse_motion_handled, void, MouseMotionHandledPkt);
 	};
 }
 
@@ -107,6 +107,11 @@ void Window::set_uses_alpha(bool alpha_blending) {
 	_context->__river_set_hint({_id, PWINDOW_HINT_USEALPHA, alpha_blending});
 }
 
+void Window::set_motion_hint(bool motion_hint) {
+	_context->__river_set_hint({_id, PWINDOW_HINT_MOTIONHINT, motion_hint});
+	_motion_hint = motion_hint;
+}
+
 int Window::id() const {
 	return _id;
 }
@@ -115,6 +120,10 @@ Framebuffer Window::framebuffer() const {
 	return {(Gfx::Color*) _shm.ptr + (_flipped ? 0 : _rect.width * _rect.height), _rect.width, _rect.height};
 }
 
+Framebuffer Window::displayed_framebuffer() const {
+	return {(Gfx::Color*) _shm.ptr + (_flipped ? _rect.width * _rect.height : 0), _rect.width, _rect.height};
+}
+
 unsigned int Window::mouse_buttons() const {
 	return _mouse_buttons;
 }
@@ -33,6 +33,7 @@
 #define PWINDOW_HINT_RESIZABLE 0x5
 #define PWINDOW_HINT_WINDOWTYPE 0x6
 #define PWINDOW_HINT_SHADOW 0x7
+#define PWINDOW_HINT_MOTIONHINT 0x8
 
 /**
  * A window Object representing a window in the Pond window system.
@@ -152,6 +153,14 @@ namespace Pond {
 		 */
 		void set_uses_alpha(bool alpha_blending);
 
+		/**
+		 * Sets whether the window only needs to know where the mouse is now, rather than every step it took to get there.
+		 * With this set, the compositor holds back mouse movement until the last movement event has been taken off of the
+		 * event queue, and then sends one event with where the mouse ended up.
+		 * @param motion_hint Whether or not mouse movement should be held back.
+		 */
+		void set_motion_hint(bool motion_hint);
+
 		/**
 		 * Gets the ID of the window.
 		 * @return The ID of the window.
@@ -164,6 +173,12 @@ namespace Pond {
 		 */
 		Gfx::Framebuffer framebuffer() const;
 
+		/**
+		 * Gets the window's active framebuffer (the one pond is currently displaying). This shouldn't be drawn to.
+		 * @return The displayed framebuffer of the window.
+		 */
+		Gfx::Framebuffer displayed_framebuffer() const;
+
 		/**
 		 * Gets the current mouse buttons of the window.
 		 * @return The current mouse buttons of the window.
@@ -220,6 +235,7 @@ namespace Pond {
 		Context* _context = nullptr; ///< The context associated with the window.
 		bool _flipped = false; ///< Whether or not the window's framebuffer is currently flipped.
 		WindowType _window_type = DEFAULT;
+		bool _motion_hint = false; ///< Whether the compositor waits to be told we've seen each mouse movement.
 	};
 }
 
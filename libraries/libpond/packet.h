@@ -84,6 +84,10 @@ namespace Pond {
 		int window_id;
 	};
 
+	struct MouseMotionHandledPkt {
+		int window_id;
+	};
+
 	struct KeyEventPkt {
 		int window_id;
 		uint16_t scancode;
@@ -100,6 +104,15 @@ namespace Pond {
 		int font_shm_id;
 	};
 
+	struct GetImagePkt {
+		SerializedString<256> path;
+	};
+
+	struct ImageResponsePkt {
+		int image_shm_id; ///< -1 if pond doesn't have the image
+		Gfx::Dimensions dimensions;
+	};
+
 	struct SetTitlePkt {
 		int window_id;
 		SerializedString<256> title;
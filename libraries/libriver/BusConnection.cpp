@@ -22,6 +22,7 @@
 #include <sys/socketfs.h>
 #include <cstring>
 #include <poll.h>
+#include <fcntl.h>
 #include "Endpoint.h"
 #include "BusServer.h"
 #include "Function.hpp"
@@ -88,10 +89,51 @@ ResultRet<std::shared_ptr<Endpoint>> BusConnection::get_endpoint(const std::stri
 }
 
 Result BusConnection::send_packet(const RiverPacket& packet) {
+	if(_server) {
+		_server->handle_local_packet(packet);
+		return Result::SUCCESS;
+	}
 	return River::send_packet(_fd, SOCKETFS_RECIPIENT_HOST, packet);
 }
 
+Result BusConnection::set_queue_size(size_t size) {
+	if(_server)
+		return Result::SUCCESS;
+	if(fcntl(_fd, F_SETSOCK_SZ, (int) size) < 0)
+		return Result(errno);
+	return Result::SUCCESS;
+}
+
+Result BusConnection::use_shared_ring(size_t size) {
+	//Local connections don't go through a socket at all, so they don't need a ring
+	if(_ring || _server)
+		return Result::SUCCESS;
+
+	auto ring_res = PacketRing::create(size);
+	if(ring_res.is_error())
+		return ring_res.result();
+	auto& ring = ring_res.value();
+
+	auto res = River::send_packet(_fd, SOCKETFS_RECIPIENT_HOST, {SETUP_RING}, ring->shm_id(), SHM_READ | SHM_WRITE);
+	if(res.is_error())
+		return res;
+	auto packet = await_packet(SETUP_RING);
+	if(packet.error) {
+		Log::err("[River] Error setting up shared ring: ", error_str(packet.error));
+		return Result(packet.error);
+	}
+
+	//Anything the server sends us from now on will be in the ring
+	_ring = std::move(ring);
+	return Result::SUCCESS;
+}
+
 void BusConnection::read_all_packets(bool block) {
+	if(_server) {
+		read_packet(block);
+		return;
+	}
+
 	if(block) {
 		struct pollfd pfd = {_fd, POLLIN, 0};
 		poll(&pfd, 1, -1);
@@ -102,13 +144,19 @@ void BusConnection::read_all_packets(bool block) {
 void BusConnection::read_and_handle_packets(bool block) {
 	read_all_packets(_packet_queue.empty() ? block : false);
 	while(!_packet_queue.empty()) {
-		auto& pkt = _packet_queue.front();
+		//Take the packet out first, since handling it might make calls that add packets to or take them from the queue
+		auto pkt = std::move(_packet_queue.front());
+		_packet_queue.pop_front();
 
 		switch(pkt.type) {
 			case FUNCTION_CALL:
 				handle_function_call(pkt);
 				break;
 
+			case FUNCTION_RETURN:
+				handle_function_return(pkt);
+				break;
+
 			case CLIENT_CONNECTED:
 				handle_client_connected(pkt);
 				break;
@@ -124,39 +172,155 @@ void BusConnection::read_and_handle_packets(bool block) {
 			default:
 				Log::err("[River] Unhandled packet type ", pkt.type);
 		}
-
-		_packet_queue.pop_front();
 	}
 }
 
 int BusConnection::file_descriptor() {
+	//For a local connection, packets for us only show up once the server handles the ones on its socket
+	if(_server)
+		return _server->file_descriptor();
 	return _fd;
 }
 
 PacketReadResult BusConnection::read_packet(bool block) {
-	auto pkt_res = River::receive_packet(_fd, block);
-	if(pkt_res.is_error())
-		return static_cast<PacketReadResult>(pkt_res.code());
-	_packet_queue.push_back(pkt_res.value());
-	return PACKET_READ;
+	if(_server) {
+		auto num_queued = _packet_queue.size();
+		_server->read_and_handle_packets(block);
+		return _packet_queue.size() != num_queued ? PACKET_READ : NO_PACKET;
+	}
+
+	while(true) {
+		//Empty the ring out completely, since the server only wakes us up when it puts a packet in an empty ring
+		if(_ring) {
+			auto num_queued = _packet_queue.size();
+			while(auto packet = _ring->pop()) {
+				if(packet->type != RING_SOCKET_PACKET) {
+					_packet_queue.push_back(std::move(packet.value()));
+				} else if(_early_socket_packets) {
+					_early_socket_packets--;
+				} else {
+					//The packet was too big for the ring, and the server sent it through the socket before leaving the note
+					ResultRet<RiverPacket> pkt_res(0);
+					do {
+						pkt_res = River::receive_packet(_fd, true);
+					} while(!pkt_res.is_error() && pkt_res.value().type == RING_WAKEUP);
+					if(!pkt_res.is_error())
+						_packet_queue.push_back(std::move(pkt_res.value()));
+				}
+			}
+			if(_packet_queue.size() != num_queued)
+				return PACKET_READ;
+		}
+
+		//Take everything waiting on the socket, since it's as cheap to read all of it as it is to read one packet
+		std::deque<RiverPacket> packets;
+		auto res = River::receive_packets(_fd, block, packets);
+		if(res.is_error())
+			return static_cast<PacketReadResult>(res.code());
+		auto num_queued = _packet_queue.size();
+		for(auto& packet : packets) {
+			if(packet.type == RING_WAKEUP)
+				continue;
+			if(_ring)
+				_early_socket_packets++;
+			_packet_queue.push_back(std::move(packet));
+		}
+		if(_packet_queue.size() != num_queued)
+			return PACKET_READ;
+	}
 }
 
 RiverPacket BusConnection::await_packet(PacketType type, const std::string& endpoint, const std::string& path) {
+	//The packet might already be here, like replies from the server are for local connections
+	for(auto it = _packet_queue.begin(); it != _packet_queue.end(); it++) {
+		if(it->type == type && (endpoint.empty() || endpoint == it->endpoint) && (path.empty() || path == it->path)) {
+			auto ret = std::move(*it);
+			_packet_queue.erase(it);
+			return ret;
+		}
+	}
+
 	while(true) {
-		if(read_packet(true) == PACKET_READ) {
-			auto& packet = _packet_queue.back();
-			if (packet.type == type) {
-				if((endpoint.empty() || endpoint == packet.endpoint) && (path.empty() || path == packet.path)) {
-					auto ret = _packet_queue.back();
-					_packet_queue.pop_back();
-					return ret;
-				}
+		auto num_queued = _packet_queue.size();
+		if(read_packet(true) != PACKET_READ)
+			continue;
+		//Reading can queue more than one packet at a time, so look through all of the new ones
+		for(auto it = _packet_queue.begin() + num_queued; it != _packet_queue.end(); it++) {
+			if(it->type == type && (endpoint.empty() || endpoint == it->endpoint) && (path.empty() || path == it->path)) {
+				auto ret = std::move(*it);
+				_packet_queue.erase(it);
+				return ret;
+			}
+		}
+	}
+}
+
+uint32_t BusConnection::next_sequence() {
+	//Zero is what packets that aren't part of a call have
+	if(!++_sequence)
+		_sequence++;
+	return _sequence;
+}
+
+RiverPacket BusConnection::await_return(uint32_t sequence) {
+	//The return might've been read already while we were waiting for something else
+	for(auto it = _packet_queue.begin(); it != _packet_queue.end(); it++) {
+		if(it->type == FUNCTION_RETURN && it->sequence == sequence) {
+			auto ret = std::move(*it);
+			_packet_queue.erase(it);
+			return ret;
+		}
+	}
+
+	while(true) {
+		auto num_queued = _packet_queue.size();
+		if(read_packet(true) != PACKET_READ)
+			continue;
+		for(auto it = _packet_queue.begin() + num_queued; it != _packet_queue.end(); it++) {
+			if(it->type == FUNCTION_RETURN && it->sequence == sequence) {
+				auto ret = std::move(*it);
+				_packet_queue.erase(it);
+				return ret;
 			}
 		}
 	}
 }
 
+void BusConnection::on_return(uint32_t sequence, std::function<void(const RiverPacket&)> handler) {
+	_return_handlers[sequence] = std::move(handler);
+}
+
+void BusConnection::handle_function_return(const RiverPacket& packet) {
+	auto handler_it = _return_handlers.find(packet.sequence);
+	if(handler_it == _return_handlers.end()) {
+		Log::warn("[River] Got unexpected return from ", packet.endpoint, ":", packet.path);
+		return;
+	}
+
+	auto handler = std::move(handler_it->second);
+	_return_handlers.erase(handler_it);
+	handler(packet);
+}
+
+void BusConnection::set_handle(uint32_t handle, std::shared_ptr<IFunction> function) {
+	_function_handles[handle] = std::move(function);
+}
+
+void BusConnection::set_handle(uint32_t handle, std::shared_ptr<IMessage> message) {
+	_message_handles[handle] = std::move(message);
+}
+
 void BusConnection::handle_function_call(const RiverPacket& packet) {
+	if(packet.handle) {
+		auto func_it = _function_handles.find(packet.handle);
+		if(func_it == _function_handles.end()) {
+			Log::warn("[River] Got call for unknown function handle ", packet.handle);
+			return;
+		}
+		func_it->second->remote_call(packet);
+		return;
+	}
+
 	if(!_endpoints[packet.endpoint]) {
 		Log::warn("[River] Got function call for unknown endpoint ", packet.endpoint);
 		return;
@@ -173,6 +337,16 @@ void BusConnection::handle_function_call(const RiverPacket& packet) {
 }
 
 void BusConnection::handle_message(const RiverPacket& packet) {
+	if(packet.handle) {
+		auto message_it = _message_handles.find(packet.handle);
+		if(message_it == _message_handles.end()) {
+			Log::warn("[River] Got unknown message handle ", packet.handle);
+			return;
+		}
+		message_it->second->handle_message(packet);
+		return;
+	}
+
 	if(!_endpoints[packet.endpoint]) {
 		Log::warn("[River] Got message for unknown endooint ", packet.endpoint);
 		return;
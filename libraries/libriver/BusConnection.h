@@ -24,12 +24,16 @@
 #include <deque>
 #include <map>
 #include <memory>
+#include <functional>
 #include <utility>
 #include "packet.h"
+#include "PacketRing.h"
 
 namespace River {
 	class Endpoint;
 	class BusServer;
+	class IFunction;
+	class IMessage;
 
 	class BusConnection: public std::enable_shared_from_this<BusConnection> {
 	public:
@@ -49,6 +53,13 @@ namespace River {
 		Duck::ResultRet<std::shared_ptr<Endpoint>> get_endpoint(const std::string& name);
 
 		Duck::Result send_packet(const RiverPacket& packet);
+		/**
+		 * Asks the server to send us packets through a ring in shared memory instead of through our socket, which saves
+		 * copying them through the kernel. The socket is then only used to wake us up when packets are put in the ring.
+		 */
+		Duck::Result use_shared_ring(size_t size = LIBRIVER_RING_DEFAULT_SIZE);
+		/** Sets how many bytes of packets can be waiting for us in our socket before the sender has to wait. **/
+		Duck::Result set_queue_size(size_t size);
 		void read_all_packets(bool block);
 		void read_and_handle_packets(bool block);
 		int file_descriptor();
@@ -56,8 +67,22 @@ namespace River {
 		PacketReadResult read_packet(bool block);
 		RiverPacket await_packet(PacketType type, const std::string& endpoint = "", const std::string& path = "");
 
+		/** Gets a new sequence number to send a function call with, so its return can be told apart from others. **/
+		uint32_t next_sequence();
+		/** Waits for the return of the function call sent with the given sequence number. **/
+		RiverPacket await_return(uint32_t sequence);
+		/** Calls the handler from read_and_handle_packets when the return of the given function call comes back. **/
+		void on_return(uint32_t sequence, std::function<void(const RiverPacket&)> handler);
+
+		/** Lets function calls and messages that are sent by handle instead of by name find what they're for. **/
+		void set_handle(uint32_t handle, std::shared_ptr<IFunction> function);
+		void set_handle(uint32_t handle, std::shared_ptr<IMessage> message);
+
 	private:
+		friend class BusServer;
+
 		void handle_function_call(const RiverPacket& packet);
+		void handle_function_return(const RiverPacket& packet);
 		void handle_message(const RiverPacket& packet);
 		void handle_client_connected(const RiverPacket& packet);
 		void handle_client_disconnected(const RiverPacket& packet);
@@ -67,6 +92,12 @@ namespace River {
 		BusType _type;
 		std::map<std::string, std::shared_ptr<Endpoint>> _endpoints;
 		std::deque<RiverPacket> _packet_queue;
+		std::unique_ptr<PacketRing> _ring;
+		size_t _early_socket_packets = 0; ///< Packets read from the socket before we got to their note in the ring.
+		uint32_t _sequence = 0; ///< The sequence number of the last function call we made.
+		std::map<uint32_t, std::function<void(const RiverPacket&)>> _return_handlers; ///< Handlers for returns of async calls.
+		std::map<uint32_t, std::shared_ptr<IFunction>> _function_handles; ///< Functions we host, by the server's handle for them.
+		std::map<uint32_t, std::shared_ptr<IMessage>> _message_handles; ///< Messages we handle, by the server's handle for them.
 	};
 }
 
@@ -60,66 +60,108 @@ void BusServer::read_and_handle_packets(bool block) {
 		poll(&pfd, 1, -1);
 	}
 
-	ResultRet<RiverPacket> pkt_res(0);
-	while((pkt_res = receive_packet(_fd, false)).code() != NO_PACKET) {
-		if(pkt_res.is_error())
-			continue;
-		auto packet = pkt_res.value();
-
-		switch(packet.type) {
-			case SOCKETFS_CLIENT_CONNECTED:
-				client_connected(packet);
-				return;
-
-			case SOCKETFS_CLIENT_DISCONNECTED:
-				client_disconnected(packet);
-				return;
-
-			case REGISTER_ENDPOINT:
-				register_endpoint(packet);
-				return;
-
-			case GET_ENDPOINT:
-				get_endpoint(packet);
-				return;
-
-			case REGISTER_FUNCTION:
-				register_function(packet);
-				return;
-
-			case GET_FUNCTION:
-				get_function(packet);
-				return;
-
-			case FUNCTION_CALL:
-				call_function(packet);
-				return;
-
-			case FUNCTION_RETURN:
-				function_return(packet);
-				return;
-
-			case REGISTER_MESSAGE:
-				register_message(packet);
-				return;
-
-			case GET_MESSAGE:
-				get_message(packet);
-				return;
-
-			case SEND_MESSAGE:
-				send_message(packet);
-				return;
-
-			default:
-				packet.error = MALFORMED_DATA;
-				packet.data.clear();
-				send_packet(packet.__socketfs_from_id, packet);
-				return;
+	//Replies to everything we read go out together once we're done
+	begin_batch();
+	std::deque<RiverPacket> packets;
+	while(!receive_packets(_fd, false, packets).is_error()) {
+		while(!packets.empty()) {
+			handle_packet(packets.front());
+			packets.pop_front();
+		}
+	}
+	end_batch();
+}
+
+void BusServer::begin_batch() {
+	_batch_depth++;
+}
+
+void BusServer::end_batch() {
+	if(_batch_depth && !--_batch_depth)
+		_batch.flush();
+}
+
+void BusServer::handle_packet(const RiverPacket& packet) {
+	switch(packet.type) {
+		case SOCKETFS_CLIENT_CONNECTED:
+			client_connected(packet);
+			return;
+
+		case SOCKETFS_CLIENT_DISCONNECTED:
+			client_disconnected(packet);
+			return;
+
+		case REGISTER_ENDPOINT:
+			register_endpoint(packet);
+			return;
+
+		case GET_ENDPOINT:
+			get_endpoint(packet);
+			return;
+
+		case REGISTER_FUNCTION:
+			register_function(packet);
+			return;
+
+		case GET_FUNCTION:
+			get_function(packet);
+			return;
+
+		case FUNCTION_CALL:
+			call_function(packet);
+			return;
+
+		case FUNCTION_RETURN:
+			function_return(packet);
+			return;
+
+		case REGISTER_MESSAGE:
+			register_message(packet);
+			return;
+
+		case GET_MESSAGE:
+			get_message(packet);
+			return;
+
+		case SEND_MESSAGE:
+			send_message(packet);
+			return;
+
+		case SETUP_RING:
+			setup_ring(packet);
+			return;
+
+		default: {
+			RiverPacket resp = packet;
+			resp.error = MALFORMED_DATA;
+			resp.data.clear();
+			send_packet(packet.__socketfs_from_id, resp);
+			return;
 		}
 	}
 }
 
+std::shared_ptr<BusConnection> BusServer::connect_local() {
+	auto connection = _local.lock();
+	if(connection)
+		return connection;
+	connection = std::make_shared<BusConnection>(this);
+	_local = connection;
+	_clients[LIBRIVER_LOCAL_ID] = std::make_unique<ServerClient>(ServerClient {LIBRIVER_LOCAL_ID});
+	return connection;
+}
+
+int BusServer::file_descriptor() {
+	return _fd;
+}
+
+void BusServer::handle_local_packet(const RiverPacket& packet) {
+	RiverPacket local_packet = packet;
+	local_packet.__socketfs_from_id = LIBRIVER_LOCAL_ID;
+	local_packet.__socketfs_from_pid = _self_pid;
+	handle_packet(local_packet);
+}
+
 void* river_bus_server_thread(void* arg) {
 	auto* self = (BusServer*) arg;
 	while(true)
@@ -137,7 +179,45 @@ void BusServer::set_allow_new_endpoints(bool allow) {
 }
 
 Duck::Result BusServer::send_packet(int pid, const RiverPacket& packet) {
-	return River::send_packet(_fd, pid, packet);
+	//Packets for the local connection go straight into its queue
+	if((sockid_t) pid == LIBRIVER_LOCAL_ID) {
+		auto local = _local.lock();
+		if(!local)
+			return Result(ENOENT);
+		RiverPacket local_packet = packet;
+		local_packet.__socketfs_from_id = SOCKETFS_RECIPIENT_HOST;
+		local_packet.__socketfs_from_pid = _self_pid;
+		local->_packet_queue.push_back(std::move(local_packet));
+		return Result::SUCCESS;
+	}
+
+	auto client_it = _clients.find(pid);
+	if(client_it == _clients.end() || !client_it->second || !client_it->second->ring)
+		return send_socket_packet(pid, packet);
+
+	bool needs_wakeup;
+	auto& ring = client_it->second->ring;
+	auto res = ring->push(packet, needs_wakeup);
+	if(res.code() == EMSGSIZE) {
+		//Send it through the socket instead, and leave a note in the ring so the client knows where it fits in
+		res = send_socket_packet(pid, packet);
+		if(res.is_error())
+			return res;
+		res = ring->push({RING_SOCKET_PACKET}, needs_wakeup);
+	}
+	if(res.is_error()) {
+		Log::warnf("[River] Couldn't write packet to shared ring of client {x}: {}", pid, strerror(res.code()));
+		return res;
+	}
+	if(needs_wakeup)
+		return send_socket_packet(pid, {RING_WAKEUP});
+	return Result::SUCCESS;
+}
+
+Duck::Result BusServer::send_socket_packet(sockid_t id, const RiverPacket& packet) {
+	if(_batch_depth)
+		return _batch.add(id, packet);
+	return River::send_packet(_fd, id, packet);
 }
 
 #define VERIFY_ENDPOINT \
@@ -185,10 +265,20 @@ void BusServer::client_disconnected(const RiverPacket& packet) {
 		return;
 	}
 
-	//Erase the client's registered endpoints
+	//Erase the client's registered endpoints, and the handles of their functions and messages
 	auto& client = client_it->second;
-	for(auto& endpoint : client->registered_endpoints)
-		_endpoints.erase(endpoint);
+	for(auto& endpoint_name : client->registered_endpoints) {
+		auto endpoint_it = _endpoints.find(endpoint_name);
+		if(endpoint_it == _endpoints.end())
+			continue;
+		for(auto& function : endpoint_it->second->functions)
+			if(function.second)
+				_handles.erase(function.second->handle);
+		for(auto& message : endpoint_it->second->messages)
+			if(message.second)
+				_handles.erase(message.second->handle);
+		_endpoints.erase(endpoint_it);
+	}
 
 	//Send the disconnect message to all of the client's connected endpoints
 	for(auto& endpoint_name : client->connected_endpoints) {
@@ -292,31 +382,37 @@ void BusServer::register_function(const RiverPacket& packet) {
 		return;
 	}
 
-	endpoint->functions[packet.path] = std::make_unique<ServerFunction>(ServerFunction {packet.path});
+	auto handle = new_handle(endpoint.get(), false);
+	endpoint->functions[packet.path] = std::make_unique<ServerFunction>(ServerFunction {packet.path, handle});
 
-	send_packet(packet.__socketfs_from_id, {
+	RiverPacket resp = {
 			packet.type,
 			packet.endpoint,
 			packet.path,
 			SUCCESS
-	});
+	};
+	resp.handle = handle;
+	send_packet(packet.__socketfs_from_id, resp);
 }
 
 void BusServer::get_function(const RiverPacket& packet) {
 	VERIFY_ENDPOINT
 	VERIFY_FUNCTION
 
-	send_packet(packet.__socketfs_from_id, {
+	RiverPacket resp = {
 			packet.type,
 			packet.endpoint,
 			packet.path,
 			SUCCESS
-	});
+	};
+	resp.handle = endpoint->functions[packet.path]->handle;
+	send_packet(packet.__socketfs_from_id, resp);
 }
 
 void BusServer::call_function(const RiverPacket& packet) {
-	VERIFY_ENDPOINT
-	VERIFY_FUNCTION
+	auto endpoint = find_target(packet, false);
+	if(!endpoint)
+		return;
 
 	RiverPacket func_packet = packet;
 	func_packet.sender = packet.__socketfs_from_id;
@@ -325,8 +421,9 @@ void BusServer::call_function(const RiverPacket& packet) {
 }
 
 void BusServer::function_return(const RiverPacket& packet) {
-	VERIFY_ENDPOINT
-	VERIFY_FUNCTION
+	auto endpoint = find_target(packet, false);
+	if(!endpoint)
+		return;
 
 	if(endpoint->id != packet.__socketfs_from_id || packet.recipient == SOCKETFS_RECIPIENT_HOST || packet.recipient == _self_pid) {
 		send_packet(packet.__socketfs_from_id, {
@@ -364,34 +461,114 @@ void BusServer::register_message(const RiverPacket& packet) {
 		return;
 	}
 
-	endpoint->messages[packet.path] = std::make_unique<ServerMessage>(ServerMessage {packet.path});
+	auto handle = new_handle(endpoint.get(), true);
+	endpoint->messages[packet.path] = std::make_unique<ServerMessage>(ServerMessage {packet.path, handle});
 
-	send_packet(packet.__socketfs_from_id, {
+	RiverPacket resp = {
 			packet.type,
 			packet.endpoint,
 			packet.path,
 			SUCCESS
-	});
+	};
+	resp.handle = handle;
+	send_packet(packet.__socketfs_from_id, resp);
 }
 
 void BusServer::get_message(const RiverPacket& packet) {
 	VERIFY_ENDPOINT
 	VERIFY_MESSAGE
 
-	send_packet(packet.__socketfs_from_id, {
+	RiverPacket resp = {
 			packet.type,
 			packet.endpoint,
 			packet.path,
 			SUCCESS
-	});
+	};
+	resp.handle = endpoint->messages[packet.path]->handle;
+	send_packet(packet.__socketfs_from_id, resp);
 }
 
 void BusServer::send_message(const RiverPacket& packet) {
-	VERIFY_ENDPOINT
-	VERIFY_MESSAGE
+	auto endpoint = find_target(packet, true);
+	if(!endpoint)
+		return;
 
 	RiverPacket message_packet = packet;
 	message_packet.sender = packet.__socketfs_from_id;
 	message_packet.__socketfs_from_id = 0;
 	send_packet(packet.recipient, message_packet);
 }
+
+BusServer::ServerEndpoint* BusServer::find_target(const RiverPacket& packet, bool is_message) {
+	auto error = is_message ? MESSAGE_DOES_NOT_EXIST : FUNCTION_DOES_NOT_EXIST;
+
+	//Packets sent by handle don't have an endpoint or path, so we don't have to look those up
+	if(packet.handle) {
+		auto handle_it = _handles.find(packet.handle);
+		if(handle_it != _handles.end() && handle_it->second.is_message == is_message)
+			return handle_it->second.endpoint;
+	} else {
+		auto endpoint_it = _endpoints.find(packet.endpoint);
+		if(endpoint_it == _endpoints.end() || !endpoint_it->second) {
+			error = ENDPOINT_DOES_NOT_EXIST;
+		} else {
+			auto& endpoint = endpoint_it->second;
+			if(is_message ? endpoint->messages[packet.path].operator bool() : endpoint->functions[packet.path].operator bool())
+				return endpoint.get();
+		}
+	}
+
+	//Failed calls get a return with the error, so that the caller isn't left waiting for one
+	RiverPacket resp = {
+			packet.type == FUNCTION_CALL ? FUNCTION_RETURN : packet.type,
+			packet.endpoint,
+			packet.path,
+			error
+	};
+	resp.handle = packet.handle;
+	resp.sequence = packet.sequence;
+	send_packet(packet.__socketfs_from_id, resp);
+	return nullptr;
+}
+
+uint32_t BusServer::new_handle(ServerEndpoint* endpoint, bool is_message) {
+	//Zero means a packet isn't sent by handle, so skip it if we ever wrap around
+	do {
+		_last_handle++;
+	} while(!_last_handle || _handles.count(_last_handle));
+	_handles[_last_handle] = {endpoint, is_message};
+	return _last_handle;
+}
+
+void BusServer::setup_ring(const RiverPacket& packet) {
+	auto client_it = _clients.find(packet.__socketfs_from_id);
+	if(client_it == _clients.end() || !client_it->second || client_it->second->ring || !packet.__socketfs_shm_id) {
+		send_packet(packet.__socketfs_from_id, {
+				packet.type,
+				packet.endpoint,
+				packet.path,
+				ILLEGAL_REQUEST
+		});
+		return;
+	}
+
+	auto ring_res = PacketRing::attach(packet.__socketfs_shm_id);
+	if(ring_res.is_error()) {
+		send_packet(packet.__socketfs_from_id, {
+				packet.type,
+				packet.endpoint,
+				packet.path,
+				MALFORMED_DATA
+		});
+		return;
+	}
+
+	//Reply through the socket, since the client only starts reading from the ring once it knows we've accepted it
+	send_packet(packet.__socketfs_from_id, {
+			packet.type,
+			packet.endpoint,
+			packet.path,
+			SUCCESS
+	});
+	client_it->second->ring = std::move(ring_res.value());
+}
@@ -26,6 +26,7 @@
 #include <sys/types.h>
 #include <deque>
 #include "packet.h"
+#include "PacketRing.h"
 #include <unistd.h>
 
 namespace River {
@@ -47,13 +48,33 @@ namespace River {
 
 		void set_allow_new_endpoints(bool allow);
 
+		/**
+		 * Makes a BusConnection to this server that lives in the same process, for registering endpoints with. Packets
+		 * between it and the server are handed over directly instead of going through the socket, so calls to its
+		 * endpoints only take one hop from their clients. The server then has to be run from the same thread as the
+		 * connection (by reading packets from the connection) instead of with spawn_thread.
+		 */
+		std::shared_ptr<BusConnection> connect_local();
+		int file_descriptor();
+
+		/**
+		 * Holds on to packets sent to clients through the socket until end_batch is called, so they can all be written
+		 * at once. Batches can be nested, and packets are sent when the outermost one ends. Packets read by
+		 * read_and_handle_packets are always handled in a batch.
+		 */
+		void begin_batch();
+		void end_batch();
+
+
 	private:
 		struct ServerMessage {
 			std::string path;
+			uint32_t handle;
 		};
 
 		struct ServerFunction {
 			std::string path;
+			uint32_t handle;
 		};
 
 		struct ServerEndpoint {
@@ -63,15 +84,27 @@ namespace River {
 			std::map<std::string, std::unique_ptr<ServerMessage>> messages;
 		};
 
+		struct ServerHandle {
+			ServerEndpoint* endpoint;
+			bool is_message;
+		};
+
 		struct ServerClient {
 			sockid_t id;
 			std::vector<std::string> registered_endpoints;
 			std::vector<std::string> connected_endpoints;
+			std::unique_ptr<PacketRing> ring;
 		};
 
-		BusServer(int fd, ServerType type): _fd(fd), _type(type), _self_pid(getpid()) {}
+		BusServer(int fd, ServerType type): _fd(fd), _type(type), _self_pid(getpid()), _batch(fd) {}
+
+		friend class BusConnection;
+		void handle_packet(const RiverPacket& packet);
+		void handle_local_packet(const RiverPacket& packet);
 
 		Duck::Result send_packet(int pid, const RiverPacket& packet);
+		/** Sends a packet to a client through the socket, or adds it to the batch if there is one. **/
+		Duck::Result send_socket_packet(sockid_t id, const RiverPacket& packet);
 
 		void client_connected(const RiverPacket& packet);
 		void client_disconnected(const RiverPacket& packet);
@@ -84,6 +117,10 @@ namespace River {
 		void register_message(const RiverPacket& packet);
 		void get_message(const RiverPacket& packet);
 		void send_message(const RiverPacket& packet);
+		void setup_ring(const RiverPacket& packet);
+		/** Finds the endpoint a function call, return, or message is for, by handle if it has one. Replies with an error if there isn't one. **/
+		ServerEndpoint* find_target(const RiverPacket& packet, bool is_message);
+		uint32_t new_handle(ServerEndpoint* endpoint, bool is_message);
 
 		int _fd = 0;
 		ServerType _type;
@@ -92,7 +129,12 @@ namespace River {
 
 		std::map<sockid_t, std::unique_ptr<ServerClient>> _clients;
 		std::map<std::string, std::unique_ptr<ServerEndpoint>> _endpoints;
+		std::map<uint32_t, ServerHandle> _handles;
+		uint32_t _last_handle = 0;
 		pid_t _self_pid;
+		std::weak_ptr<BusConnection> _local;
+		PacketBatch _batch;
+		int _batch_depth = 0;
 	};
 }
 
@@ -64,8 +64,10 @@ namespace River {
 				return Duck::Result(packet.error);
 			}
 
-			auto ret = std::make_shared<Function<RetT, ParamTs...>>(path, shared_from_this(), callback);
+			auto ret = std::make_shared<Function<RetT, ParamTs...>>(path, shared_from_this(), callback, packet.handle);
 			_functions[stringname] = ret;
+			if(packet.handle)
+				_bus->set_handle(packet.handle, std::static_pointer_cast<IFunction>(ret));
 			return *ret;
 		}
 
@@ -97,7 +99,7 @@ namespace River {
 				return Duck::Result(packet.error);
 			}
 
-			auto ret = std::make_shared<Function<RetT, ParamTs...>>(path, shared_from_this());
+			auto ret = std::make_shared<Function<RetT, ParamTs...>>(path, shared_from_this(), nullptr, packet.handle);
 			_functions[stringname] = ret;
 			return *ret;
 		}
@@ -139,7 +141,7 @@ namespace River {
 				return Duck::Result(packet.error);
 			}
 
-			auto ret = std::make_shared<Message<T>>(path, shared_from_this());
+			auto ret = std::make_shared<Message<T>>(path, shared_from_this(), packet.handle);
 			_messages[stringname] = ret;
 			return *ret;
 		}
@@ -174,8 +176,10 @@ namespace River {
 				return Duck::Result(packet.error);
 			}
 
-			auto ret = std::make_shared<Message<T>>(path, shared_from_this(), callback);
+			auto ret = std::make_shared<Message<T>>(path, shared_from_this(), callback, packet.handle);
 			_messages[stringname] = ret;
+			if(packet.handle)
+				_bus->set_handle(packet.handle, std::static_pointer_cast<IMessage>(ret));
 			return Duck::Result(SUCCESS);
 		}
 
@@ -26,6 +26,7 @@
 #include <cstring>
 #include "BusConnection.h"
 #include <libduck/serialization_utils.h>
+#include <libduck/Task.h>
 
 #pragma once
 
@@ -45,10 +46,11 @@ namespace River {
 	public:
 		Function(const std::string& path): _path(path), _endpoint(nullptr), _callback(nullptr) {}
 
-		Function(const std::string& path, std::shared_ptr<Endpoint> endpoint, std::function<RetT(sockid_t, ParamTs...)> callback = nullptr):
+		Function(const std::string& path, std::shared_ptr<Endpoint> endpoint, std::function<RetT(sockid_t, ParamTs...)> callback = nullptr, uint32_t handle = 0):
 				_path(stringname_of(path)),
 				_endpoint(std::move(endpoint)),
-				_callback(callback) {}
+				_callback(callback),
+				_handle(handle) {}
 
 		static std::string stringname_of(const std::string& path) {
 			std::string ret = path + "<" + typeid(RetT).name() + "[";
@@ -67,40 +69,56 @@ namespace River {
 			}
 
 			if(_endpoint->type() == Endpoint::PROXY) {
-				RiverPacket packet = {
-						FUNCTION_CALL,
-						_endpoint->name(),
-						_path
-				};
-
-				//Serialize function call data (tuple {arg1, arg2, arg3...})
-				packet.data.resize(Duck::Serialization::buffer_size(args...));
-				uint8_t* call_data = packet.data.data();
-				Duck::Serialization::serialize(call_data, args...);
-
 				//Send the function call packet and await a reply (if the function has a non-void return type)
-				_endpoint->bus()->send_packet(packet);
-				if constexpr(!std::is_void<RetT>()) {
-					auto pkt = _endpoint->bus()->await_packet(FUNCTION_RETURN, _endpoint->name(), _path);
-					if(pkt.error) {
-						Duck::Log::err("[River] Remote function call ", pkt.endpoint, ":", pkt.path, " failed: ", error_str(pkt.error));
-						if constexpr(!std::is_void<RetT>())
-							return RetT();
-					}
-
-					//Deserialize and return the return value
-					RetT ret;
-					if(pkt.data.size() == sizeof(RetT)) {
-						const uint8_t* resp_data = pkt.data.data();
-						Duck::Serialization::deserialize(resp_data, ret);
-					}
-					return ret;
-				}
+				auto sequence = send_call(args...);
+				if constexpr(!std::is_void<RetT>())
+					return parse_return(_endpoint->bus()->await_return(sequence));
 			} else {
 				return _callback(0, args...);
 			}
 		}
 
+		/**
+		 * Calls the function without waiting for it to return, so that more calls can be made in the meantime. The
+		 * callback is called with the return value from BusConnection::read_and_handle_packets once it comes back.
+		 * (Functions that return void never wait anyway, so this is only for functions that return something.)
+		 */
+		template<typename CallbackT>
+		void call_async(CallbackT callback, ParamTs... args) const {
+			static_assert(!std::is_void<RetT>(), "Calls to functions that return void don't wait for a return anyway!");
+			if(!_endpoint) {
+				Duck::Log::err("[River] Tried calling uninitialized function ", _path);
+				return;
+			}
+
+			if(_endpoint->type() == Endpoint::PROXY) {
+				auto sequence = send_call(args...);
+				_endpoint->bus()->on_return(sequence, [callback](const RiverPacket& pkt) {
+					callback(parse_return(pkt));
+				});
+			} else {
+				callback(_callback(0, args...));
+			}
+		}
+
+		/**
+		 * Calls the function from inside of a Duck::Task, suspending the task until the return comes back instead of
+		 * blocking the whole thread. Outside of a task, this is the same as calling the function normally. Like with
+		 * call_async, the return is handled by BusConnection::read_and_handle_packets, so the event loop has to be
+		 * handling the bus's packets in the meantime.
+		 */
+		RetT call_await(ParamTs... args) const {
+			if constexpr(std::is_void<RetT>()) {
+				(*this)(args...);
+			} else {
+				if(!Duck::Fiber::current() || !_endpoint)
+					return (*this)(args...);
+				return Duck::Async::wait_for<RetT>([&](std::function<void(RetT)> done) {
+					call_async(std::move(done), args...);
+				});
+			}
+		}
+
 		const std::string& path() override {
 			return _path;
 		}
@@ -131,6 +149,8 @@ namespace River {
 						packet.path
 				};
 				resp.recipient = packet.sender;
+				resp.sequence = packet.sequence;
+				resp.handle = packet.handle;
 				RetT ret = _callback(packet.sender, std::get<ParamTs>(data_tuple)...);
 				resp.data.resize(Duck::Serialization::buffer_size(ret));
 				uint8_t* resp_data = resp.data.data();
@@ -142,9 +162,46 @@ namespace River {
 		}
 
 	private:
+		uint32_t send_call(ParamTs... args) const {
+			//Once we know the server's handle for the function, we can leave out its name
+			RiverPacket packet = {FUNCTION_CALL};
+			if(_handle) {
+				packet.handle = _handle;
+			} else {
+				packet.endpoint = _endpoint->name();
+				packet.path = _path;
+			}
+			packet.sequence = _endpoint->bus()->next_sequence();
+
+			//Serialize function call data (tuple {arg1, arg2, arg3...})
+			packet.data.resize(Duck::Serialization::buffer_size(args...));
+			uint8_t* call_data = packet.data.data();
+			Duck::Serialization::serialize(call_data, args...);
+
+			_endpoint->bus()->send_packet(packet);
+			return packet.sequence;
+		}
+
+		template<typename T = RetT>
+		static T parse_return(const RiverPacket& pkt) {
+			if(pkt.error) {
+				Duck::Log::err("[River] Remote function call ", pkt.endpoint, ":", pkt.path, " failed: ", error_str(pkt.error));
+				return T();
+			}
+
+			//Deserialize and return the return value
+			T ret;
+			if(pkt.data.size() == sizeof(T)) {
+				const uint8_t* resp_data = pkt.data.data();
+				Duck::Serialization::deserialize(resp_data, ret);
+			}
+			return ret;
+		}
+
 		std::string _path;
 		std::shared_ptr<Endpoint> _endpoint;
 		std::function<RetT(sockid_t, ParamTs...)> _callback;
+		uint32_t _handle = 0;
 	};
 }
 
@@ -38,14 +38,16 @@ namespace River {
 	public:
 		Message(const std::string& path): _path(path), _endpoint(nullptr), _callback(nullptr) {}
 
-		Message(const std::string& path, std::shared_ptr<Endpoint> endpoint):
+		Message(const std::string& path, std::shared_ptr<Endpoint> endpoint, uint32_t handle = 0):
 				_path(stringname_of(path)),
-				_endpoint(std::move(endpoint)) {}
+				_endpoint(std::move(endpoint)),
+				_handle(handle) {}
 
-		Message(const std::string& path, std::shared_ptr<Endpoint> endpoint, std::function<void(T)> callback):
+		Message(const std::string& path, std::shared_ptr<Endpoint> endpoint, std::function<void(T)> callback, uint32_t handle = 0):
 				_path(stringname_of(path)),
 				_endpoint(std::move(endpoint)),
-				_callback(callback) {}
+				_callback(callback),
+				_handle(handle) {}
 
 		static std::string stringname_of(const std::string& path) {
 			return path + "<" + typeid(T).name() + "[" + std::to_string(sizeof(T)) + "]>";
@@ -58,11 +60,14 @@ namespace River {
 			}
 
 			if(_endpoint->type() == Endpoint::HOST) {
-				RiverPacket packet = {
-						SEND_MESSAGE,
-						_endpoint->name(),
-						_path
-				};
+				//Once we know the server's handle for the message, we can leave out its name
+				RiverPacket packet = {SEND_MESSAGE};
+				if(_handle) {
+					packet.handle = _handle;
+				} else {
+					packet.endpoint = _endpoint->name();
+					packet.path = _path;
+				}
 				packet.recipient = recipient;
 
 				//Serialize message data
@@ -113,6 +118,7 @@ namespace River {
 		std::string _path;
 		std::shared_ptr<Endpoint> _endpoint;
 		std::function<void(T)> _callback = nullptr;
+		uint32_t _handle = 0;
 	};
 }
 
@@ -0,0 +1,156 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "PacketRing.h"
+#include <cstring>
+#include <libduck/Log.h>
+
+using namespace River;
+using Duck::Result, Duck::ResultRet, Duck::Log;
+
+//Each packet in the ring is its length followed by a RawPacket, padded to a multiple of this
+#define RECORD_ALIGN 4
+#define RECORD_SIZE(len) ((sizeof(uint32_t) + (len) + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1))
+
+ResultRet<std::unique_ptr<PacketRing>> PacketRing::create(size_t size) {
+	if(!size || (size & (size - 1)))
+		return Result(EINVAL);
+	auto buffer = TRY(Duck::SharedBuffer::alloc(sizeof(Header) + size));
+	auto* header = new (buffer->ptr()) Header;
+	header->magic = LIBRIVER_RING_MAGIC;
+	header->size = size;
+	header->head.store(0);
+	header->tail.store(0);
+	return std::unique_ptr<PacketRing>(new PacketRing(buffer, size));
+}
+
+ResultRet<std::unique_ptr<PacketRing>> PacketRing::attach(int shm_id) {
+	auto buffer = TRY(Duck::SharedBuffer::adopt(shm_id));
+	if(buffer->size() < sizeof(Header))
+		return Result(EINVAL);
+	auto* header = buffer->ptr<Header>();
+	uint32_t size = header->size;
+	if(header->magic != LIBRIVER_RING_MAGIC || !size || (size & (size - 1)) || size > buffer->size() - sizeof(Header))
+		return Result(EINVAL);
+	return std::unique_ptr<PacketRing>(new PacketRing(buffer, size));
+}
+
+PacketRing::PacketRing(Duck::Ptr<Duck::SharedBuffer> buffer, uint32_t size):
+	m_buffer(buffer),
+	m_header(buffer->ptr<Header>()),
+	m_data(buffer->ptr<uint8_t>() + sizeof(Header)),
+	m_size(size),
+	m_head(m_header->head.load()) {}
+
+Result PacketRing::push(const RiverPacket& packet, bool& needs_wakeup) {
+	auto full_name = packet_target(packet);
+	uint32_t length = sizeof(RawPacket) + full_name.length() + 1 + packet.data.size();
+	uint32_t tail = m_header->tail.load();
+	uint32_t used = m_head - tail;
+	if(used > m_size)
+		return Result(EINVAL);
+	if(RECORD_SIZE(length) > m_size)
+		return Result(EMSGSIZE);
+	if(RECORD_SIZE(length) > m_size - used)
+		return Result(ENOSPC);
+
+	RawPacket raw_packet;
+	raw_packet.type = packet.type;
+	raw_packet.error = packet.error;
+	raw_packet.data_length = packet.data.size();
+	raw_packet.path_length = full_name.length() + 1;
+	raw_packet.id = packet.recipient;
+	raw_packet.sequence = packet.sequence;
+	raw_packet.handle = packet.handle;
+
+	uint32_t pos = m_head;
+	copy_in(pos, &length, sizeof(uint32_t));
+	pos += sizeof(uint32_t);
+	copy_in(pos, &raw_packet, sizeof(RawPacket));
+	pos += sizeof(RawPacket);
+	copy_in(pos, full_name.c_str(), raw_packet.path_length);
+	pos += raw_packet.path_length;
+	copy_in(pos, packet.data.data(), packet.data.size());
+
+	//Publish the packet, and then check if the reader had caught up with us before it (and so might be asleep)
+	uint32_t old_head = m_head;
+	m_head += RECORD_SIZE(length);
+	m_header->head.store(m_head);
+	needs_wakeup = m_header->tail.load() == old_head;
+	return Result::SUCCESS;
+}
+
+std::optional<RiverPacket> PacketRing::pop() {
+	uint32_t tail = m_header->tail.load();
+	uint32_t available = m_header->head.load() - tail;
+	if(!available)
+		return std::nullopt;
+
+	uint32_t length = 0;
+	RawPacket raw_packet;
+	if(available >= sizeof(uint32_t) + sizeof(RawPacket)) {
+		copy_out(tail, &length, sizeof(uint32_t));
+		copy_out(tail + sizeof(uint32_t), &raw_packet, sizeof(RawPacket));
+	}
+
+	if(
+			available > m_size ||
+			length < sizeof(RawPacket) ||
+			RECORD_SIZE(length) > available ||
+			raw_packet.__river_magic != LIBRIVER_PACKET_MAGIC ||
+			raw_packet.path_length < 1 ||
+			raw_packet.path_length > length - sizeof(RawPacket) ||
+			raw_packet.path_length + raw_packet.data_length != length - sizeof(RawPacket)
+	) {
+		//We can't tell where the next packet starts, so throw everything away
+		Log::warn("[River] Malformed packet in shared ring, dropping its contents");
+		m_header->tail.store(m_header->head.load());
+		return std::nullopt;
+	}
+
+	RiverPacket packet {
+		raw_packet.type,
+		"",
+		"",
+		raw_packet.error,
+		raw_packet.id,
+		SOCKETFS_RECIPIENT_HOST,
+		0
+	};
+	packet.sequence = raw_packet.sequence;
+	packet.handle = raw_packet.handle;
+
+	uint32_t pos = tail + sizeof(uint32_t) + sizeof(RawPacket);
+	if(raw_packet.path_length > 1) {
+		std::string target(raw_packet.path_length - 1, '\0');
+		copy_out(pos, target.data(), raw_packet.path_length - 1);
+		target.resize(strlen(target.c_str()));
+		set_packet_target(packet, target);
+	}
+	pos += raw_packet.path_length;
+	if(raw_packet.data_length) {
+		packet.data.resize(raw_packet.data_length);
+		copy_out(pos, packet.data.data(), raw_packet.data_length);
+	}
+
+	m_header->tail.store(tail + RECORD_SIZE(length));
+	return packet;
+}
+
+bool PacketRing::empty() const {
+	return m_header->head.load() == m_header->tail.load();
+}
+
+void PacketRing::copy_in(uint32_t pos, const void* buf, size_t count) {
+	uint32_t offset = pos & (m_size - 1);
+	size_t first = std::min((size_t) (m_size - offset), count);
+	memcpy(m_data + offset, buf, first);
+	memcpy(m_data, (const uint8_t*) buf + first, count - first);
+}
+
+void PacketRing::copy_out(uint32_t pos, void* buf, size_t count) const {
+	uint32_t offset = pos & (m_size - 1);
+	size_t first = std::min((size_t) (m_size - offset), count);
+	memcpy(buf, m_data + offset, first);
+	memcpy((uint8_t*) buf + first, m_data, count - first);
+}
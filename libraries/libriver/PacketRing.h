@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <libduck/SharedBuffer.h>
+#include "packet.h"
+
+#define LIBRIVER_RING_MAGIC 0xBEEF421
+#define LIBRIVER_RING_DEFAULT_SIZE 0x10000
+
+namespace River {
+	/**
+	 * A ring of packets in memory shared between a BusServer and one of its clients, so that the packets the server sends
+	 * to the client don't have to be copied through the kernel. Only the server pushes and only the client pops, and the
+	 * server sends a RING_WAKEUP packet over SocketFS whenever it pushes to an empty ring so that the client can sleep on
+	 * its socket like it normally would.
+	 */
+	class PacketRing {
+	public:
+		/** Allocates a ring with room for size bytes of packets. The size must be a power of two. **/
+		static Duck::ResultRet<std::unique_ptr<PacketRing>> create(size_t size);
+		/** Attaches to a ring that was created by the other end of a connection. **/
+		static Duck::ResultRet<std::unique_ptr<PacketRing>> attach(int shm_id);
+
+		/**
+		 * Writes a packet into the ring. ENOSPC is returned if there isn't room for it, just like a non-blocking socket,
+		 * and EMSGSIZE if it's too big to ever fit.
+		 * @param needs_wakeup Set to whether the ring was empty, in which case the reader may be waiting to be woken up.
+		 */
+		Duck::Result push(const RiverPacket& packet, bool& needs_wakeup);
+		/** Reads the next packet out of the ring, if there is one. **/
+		std::optional<RiverPacket> pop();
+		bool empty() const;
+		int shm_id() const { return m_buffer->id(); }
+
+	private:
+		struct Header {
+			int magic;
+			uint32_t size;
+			std::atomic<uint32_t> head; ///< How many bytes have ever been pushed. Only written by the server.
+			std::atomic<uint32_t> tail; ///< How many bytes have ever been popped. Only written by the client.
+		};
+
+		PacketRing(Duck::Ptr<Duck::SharedBuffer> buffer, uint32_t size);
+
+		void copy_in(uint32_t pos, const void* buf, size_t count);
+		void copy_out(uint32_t pos, void* buf, size_t count) const;
+
+		Duck::Ptr<Duck::SharedBuffer> m_buffer;
+		Header* m_header;
+		uint8_t* m_data;
+		uint32_t m_size; ///< Our own copy of the size, since the other end could change the one in the header.
+		uint32_t m_head; ///< Our own copy of the head, for the same reason.
+	};
+}
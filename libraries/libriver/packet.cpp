@@ -19,6 +19,9 @@
 
 #include "packet.h"
 #include <libduck/Log.h>
+#include <libduck/SpinLock.h>
+#include <map>
+#include <algorithm>
 
 using namespace River;
 using Duck::Result, Duck::ResultRet, Duck::Log;
@@ -47,58 +50,80 @@ const char* River::error_str(int error) {
 	}
 }
 
-Duck::ResultRet<RiverPacket> River::receive_packet(int fd, bool block)  {
-	if(block) {
-		struct pollfd pfd = {fd, POLLIN, 0};
-		poll(&pfd, 1, -1);
-	}
+namespace {
+	struct PartialPacket {
+		uint32_t total_length;
+		std::vector<uint8_t> data;
+	};
 
-	socketfs_packet* raw_socketfs_packet;
-	if((raw_socketfs_packet = ::read_packet(fd))) {
-		//Handle SocketFS connect and disconnect messages
-		if(raw_socketfs_packet->type != SOCKETFS_TYPE_MSG) {
-			if(raw_socketfs_packet->type == SOCKETFS_TYPE_MSG_CONNECT || raw_socketfs_packet->type == SOCKETFS_TYPE_MSG_DISCONNECT) {
-				RiverPacket ret = {
-					raw_socketfs_packet->type == SOCKETFS_TYPE_MSG_CONNECT ? SOCKETFS_CLIENT_CONNECTED : SOCKETFS_CLIENT_DISCONNECTED,
-					"",
-					"",
-					SUCCESS,
-					0,
-					raw_socketfs_packet->connected_id,
-					raw_socketfs_packet->connected_pid
-				};
-				free(raw_socketfs_packet);
-				return ret;
-			}
+	//Packets that we've only gotten some of the fragments of so far, by socket and sender
+	std::map<std::pair<int, sockid_t>, PartialPacket> partial_packets;
+	Duck::SpinLock partial_packets_lock;
 
-			return Result(SOCKETFS_MESSAGE);
+	/**
+	 * Adds a fragment of a packet to the rest of it. PACKET_ERR is returned if the fragment doesn't make sense, and
+	 * NO_PACKET if there are still fragments to come. Otherwise, the whole packet is put in data.
+	 */
+	Result add_fragment(int fd, socketfs_packet* fragment, std::vector<uint8_t>& data) {
+		auto* header = (FragmentHeader*) fragment->data;
+		size_t length = fragment->length - sizeof(FragmentHeader);
+		auto key = std::make_pair(fd, fragment->sender);
+
+		LOCK(partial_packets_lock);
+		auto& partial = partial_packets[key];
+		if(header->offset == 0) {
+			partial.total_length = header->total_length;
+			partial.data.clear();
+		}
+
+		if(
+				header->total_length < sizeof(RawPacket) ||
+				header->total_length > LIBRIVER_MAX_PACKET_SIZE ||
+				header->total_length != partial.total_length ||
+				header->offset != partial.data.size() ||
+				length > header->total_length - header->offset
+		) {
+			Log::warnf("[River] Fragment out of place received from {x}", fragment->sender);
+			partial_packets.erase(key);
+			return Result(PACKET_ERR);
 		}
 
+		partial.data.insert(partial.data.end(), header->data, header->data + length);
+		if(partial.data.size() < partial.total_length)
+			return Result(NO_PACKET);
+		data = std::move(partial.data);
+		partial_packets.erase(key);
+		return Result::SUCCESS;
+	}
+
+	void forget_fragments(int fd, sockid_t sender) {
+		LOCK(partial_packets_lock);
+		partial_packets.erase(std::make_pair(fd, sender));
+	}
+
+	ResultRet<RiverPacket> parse_packet(const uint8_t* data, size_t length, socketfs_packet* source) {
 		//Check if the packet is at least the size of the RawPacket header
-		if(raw_socketfs_packet->length < sizeof(RawPacket)) {
-			Log::errf("[River] WARN: Foreign packet received from {x}", raw_socketfs_packet->sender);
-			free(raw_socketfs_packet);
+		if(length < sizeof(RawPacket)) {
+			Log::errf("[River] WARN: Foreign packet received from {x}", source->sender);
 			return Result(PACKET_ERR);
 		}
 
-		auto* raw_packet = (RawPacket*) raw_socketfs_packet->data;
+		auto* raw_packet = (const RawPacket*) data;
 
 		//Check if the RawPacket magic checks out
 		if(raw_packet->__river_magic != LIBRIVER_PACKET_MAGIC) {
-			Log::warnf("[River] RawPacket with invalid magic received from {x}", raw_socketfs_packet->sender);
-			free(raw_socketfs_packet);
+			Log::warnf("[River] RawPacket with invalid magic received from {x}", source->sender);
 			return Result(PACKET_ERR);
 		}
 
 		//Make sure the data and path lengths specified in the RawPacket are valid
 		if(
-				raw_packet->data_length + raw_packet->path_length != raw_socketfs_packet->length - sizeof(RawPacket) ||
-				raw_packet->data_length > SOCKETFS_MAX_BUFFER_SIZE ||
-				raw_packet->path_length > SOCKETFS_MAX_BUFFER_SIZE ||
+				raw_packet->data_length > LIBRIVER_MAX_PACKET_SIZE ||
+				raw_packet->path_length > LIBRIVER_MAX_PACKET_SIZE ||
+				raw_packet->data_length + raw_packet->path_length != length - sizeof(RawPacket) ||
 				raw_packet->path_length < 1
 		) {
-			Log::warnf("[River] Malformed packet received from {x}",raw_socketfs_packet->sender);
-			free(raw_socketfs_packet);
+			Log::warnf("[River] Malformed packet received from {x}", source->sender);
 			return Result(PACKET_ERR);
 		}
 
@@ -109,15 +134,12 @@ Duck::ResultRet<RiverPacket> River::receive_packet(int fd, bool block)  {
 			"",
 			raw_packet->error,
 			raw_packet->id,
-			raw_socketfs_packet->sender,
-			raw_socketfs_packet->sender_pid
+			source->sender,
+			source->sender_pid
 		};
-
-		//Get the target from the RawPacket
-		auto* target_cstr = new char[raw_packet->path_length];
-		strncpy(target_cstr, (const char*) raw_packet->data, raw_packet->path_length);
-		std::string target = target_cstr;
-		delete[] target_cstr;
+		packet.__socketfs_shm_id = source->shm_id;
+		packet.sequence = raw_packet->sequence;
+		packet.handle = raw_packet->handle;
 
 		//Get the data from the RawPacket
 		if(raw_packet->data_length) {
@@ -125,46 +147,230 @@ Duck::ResultRet<RiverPacket> River::receive_packet(int fd, bool block)  {
 			memcpy(packet.data.data(), raw_packet->data + raw_packet->path_length, raw_packet->data_length);
 		}
 
-		//Free the socketFS packet
-		free(raw_socketfs_packet);
+		//Get the target from the RawPacket, unless it was sent by handle and doesn't have one
+		if(raw_packet->path_length > 1) {
+			std::string target((const char*) raw_packet->data, raw_packet->path_length - 1);
+			target.resize(strlen(target.c_str()));
+			set_packet_target(packet, target);
+		}
+		return packet;
+	}
 
-		//Parse the target
-		auto colon = target.find(':');
-		if(colon == std::string::npos) {
-			packet.endpoint = target;
-		} else {
-			packet.endpoint = target.substr(0, colon);
-			packet.path = target.substr(colon + 1);
+	/**
+	 * Turns a SocketFS packet into a RiverPacket. NO_PACKET is returned if it was a fragment and there are still more to
+	 * come, and SOCKETFS_MESSAGE if it was some other SocketFS message.
+	 */
+	ResultRet<RiverPacket> handle_socketfs_packet(int fd, socketfs_packet* raw_socketfs_packet) {
+		//Handle SocketFS connect and disconnect messages
+		if(raw_socketfs_packet->type != SOCKETFS_TYPE_MSG) {
+			if(raw_socketfs_packet->type == SOCKETFS_TYPE_MSG_CONNECT || raw_socketfs_packet->type == SOCKETFS_TYPE_MSG_DISCONNECT) {
+				RiverPacket ret = {
+					raw_socketfs_packet->type == SOCKETFS_TYPE_MSG_CONNECT ? SOCKETFS_CLIENT_CONNECTED : SOCKETFS_CLIENT_DISCONNECTED,
+					"",
+					"",
+					SUCCESS,
+					0,
+					raw_socketfs_packet->connected_id,
+					raw_socketfs_packet->connected_pid
+				};
+				if(raw_socketfs_packet->type == SOCKETFS_TYPE_MSG_DISCONNECT)
+					forget_fragments(fd, raw_socketfs_packet->disconnected_id);
+				return ret;
+			}
+			return Result(SOCKETFS_MESSAGE);
 		}
 
-		return packet;
+		//If this is a fragment of a bigger packet, wait until we have all of it
+		auto* header = (FragmentHeader*) raw_socketfs_packet->data;
+		if(raw_socketfs_packet->length >= sizeof(FragmentHeader) && header->__river_magic == LIBRIVER_FRAGMENT_MAGIC) {
+			std::vector<uint8_t> data;
+			auto res = add_fragment(fd, raw_socketfs_packet, data);
+			if(res.is_error())
+				return res;
+			return parse_packet(data.data(), data.size(), raw_socketfs_packet);
+		}
+
+		return parse_packet(raw_socketfs_packet->data, raw_socketfs_packet->length, raw_socketfs_packet);
+	}
+
+	/**
+	 * Makes the RawPacket for a packet, which should be freed once it's sent.
+	 * @param length Set to the length of the RawPacket.
+	 * @return The RawPacket, or nullptr if the packet is too big to send.
+	 */
+	RawPacket* make_raw_packet(const RiverPacket& packet, size_t& length) {
+		auto full_name = packet_target(packet);
+		size_t n_bytes = full_name.length() + 1 + packet.data.size();
+		if(sizeof(RawPacket) + n_bytes > LIBRIVER_MAX_PACKET_SIZE)
+			return nullptr;
+
+		auto* raw_packet = (RawPacket*) malloc(sizeof(RawPacket) + n_bytes);
+		raw_packet->__river_magic = LIBRIVER_PACKET_MAGIC;
+		raw_packet->type = packet.type;
+		raw_packet->error = packet.error;
+		raw_packet->data_length = packet.data.size();
+		raw_packet->path_length = full_name.length() + 1;
+		raw_packet->id = packet.recipient;
+		raw_packet->sequence = packet.sequence;
+		raw_packet->handle = packet.handle;
+
+		memcpy(raw_packet->data, full_name.c_str(), full_name.length() + 1);
+		if(!packet.data.empty())
+			memcpy(raw_packet->data + full_name.length() + 1, packet.data.data(), packet.data.size());
+
+		length = sizeof(RawPacket) + n_bytes;
+		return raw_packet;
 	}
+}
+
+Duck::ResultRet<RiverPacket> River::receive_packet(int fd, bool block)  {
+	while(true) {
+		if(block) {
+			struct pollfd pfd = {fd, POLLIN, 0};
+			poll(&pfd, 1, -1);
+		}
+
+		socketfs_packet* raw_socketfs_packet;
+		if(!(raw_socketfs_packet = ::read_packet(fd)))
+			return Result(NO_PACKET);
 
-	return Result(NO_PACKET);
+		auto ret = handle_socketfs_packet(fd, raw_socketfs_packet);
+		free(raw_socketfs_packet);
+		if(ret.code() == NO_PACKET)
+			continue;
+		return ret;
+	}
 }
 
-Result River::send_packet(int fd, sockid_t recipient, const RiverPacket& packet) {
-	auto full_name = packet.endpoint + ":" + packet.path;
-	size_t n_bytes = full_name.length() + 1 + packet.data.size();
+Result River::receive_packets(int fd, bool block, std::deque<RiverPacket>& packets) {
+	while(true) {
+		if(block) {
+			struct pollfd pfd = {fd, POLLIN, 0};
+			poll(&pfd, 1, -1);
+		}
+
+		size_t length;
+		auto* buf = (uint8_t*) ::read_packets(fd, &length);
+		if(!buf)
+			return Result(NO_PACKET);
+
+		auto num_packets = packets.size();
+		for(size_t offset = 0; offset < length;) {
+			auto* raw_socketfs_packet = (socketfs_packet*) (buf + offset);
+			offset += sizeof(socketfs_packet) + raw_socketfs_packet->length;
+			auto res = handle_socketfs_packet(fd, raw_socketfs_packet);
+			if(!res.is_error())
+				packets.push_back(std::move(res.value()));
+		}
+		free(buf);
+
+		//If all we got were fragments of a packet that isn't here yet, wait for the rest of it
+		if(packets.size() != num_packets)
+			return Result::SUCCESS;
+	}
+}
 
-	auto* raw_packet = (RawPacket*) malloc(sizeof(RawPacket) + n_bytes);
-	raw_packet->__river_magic = LIBRIVER_PACKET_MAGIC;
-	raw_packet->type = packet.type;
-	raw_packet->error = packet.error;
-	raw_packet->data_length = packet.data.size();
-	raw_packet->path_length = full_name.length() + 1;
-	raw_packet->id = packet.recipient;
+Result River::send_packet(int fd, sockid_t recipient, const RiverPacket& packet, int shm_id, int shm_perms) {
+	size_t length;
+	auto* raw_packet = make_raw_packet(packet, length);
+	if(!raw_packet)
+		return Result(EMSGSIZE);
+	auto res = write_raw_packet(fd, recipient, raw_packet, length, shm_id, shm_perms);
+	free(raw_packet);
+	return res;
+}
 
-	memcpy(raw_packet->data, full_name.c_str(), full_name.length() + 1);
-	if(!packet.data.empty())
-		memcpy(raw_packet->data + full_name.length() + 1, packet.data.data(), packet.data.size());
+Result PacketBatch::add(sockid_t recipient, const RiverPacket& packet, int shm_id, int shm_perms) {
+	size_t length;
+	auto* raw_packet = make_raw_packet(packet, length);
+	if(!raw_packet)
+		return Result(EMSGSIZE);
 
-	if(::write_packet(fd, recipient, sizeof(RawPacket) + n_bytes, raw_packet)) {
-		Log::err("[River] Error writing packet: ", strerror(errno));
+	//Packets that have to be split up go by themselves, after everything before them
+	if(length > LIBRIVER_FRAGMENT_SIZE) {
+		auto res = flush();
+		if(!res.is_error())
+			res = write_raw_packet(_fd, recipient, raw_packet, length, shm_id, shm_perms);
 		free(raw_packet);
-		return Result(errno);
+		return res;
+	}
+
+	if(_data.size() + sizeof(socketfs_packet) + length > SOCKETFS_MAX_BUFFER_SIZE) {
+		auto res = flush();
+		if(res.is_error()) {
+			free(raw_packet);
+			return res;
+		}
 	}
 
+	socketfs_packet header = {SOCKETFS_TYPE_MSG};
+	header.recipient = recipient;
+	header.length = length;
+	header.shm_id = shm_id;
+	header.shm_perms = shm_perms;
+	_data.insert(_data.end(), (uint8_t*) &header, (uint8_t*) &header + sizeof(socketfs_packet));
+	_data.insert(_data.end(), (uint8_t*) raw_packet, (uint8_t*) raw_packet + length);
 	free(raw_packet);
 	return Result::SUCCESS;
-}
\ No newline at end of file
+}
+
+Result PacketBatch::flush() {
+	if(_data.empty())
+		return Result::SUCCESS;
+	int res = ::write_packets(_fd, (socketfs_packet*) _data.data(), _data.size());
+	_data.clear();
+	if(res) {
+		Log::err("[River] Error writing packets: ", strerror(errno));
+		return Result(errno);
+	}
+	return Result::SUCCESS;
+}
+
+bool PacketBatch::empty() const {
+	return _data.empty();
+}
+
+Result River::write_raw_packet(int fd, sockid_t recipient, RawPacket* raw_packet, size_t length, int shm_id, int shm_perms) {
+	if(length <= LIBRIVER_FRAGMENT_SIZE) {
+		if(::write_shm_packet(fd, recipient, shm_id, shm_perms, length, raw_packet)) {
+			Log::err("[River] Error writing packet: ", strerror(errno));
+			return Result(errno);
+		}
+		return Result::SUCCESS;
+	}
+
+	//Split the packet up, and send the shm with the last fragment so it's there by the time the packet is put back together
+	auto* fragment = (FragmentHeader*) malloc(sizeof(FragmentHeader) + LIBRIVER_FRAGMENT_SIZE);
+	fragment->__river_magic = LIBRIVER_FRAGMENT_MAGIC;
+	fragment->total_length = length;
+	for(size_t offset = 0; offset < length; offset += LIBRIVER_FRAGMENT_SIZE) {
+		size_t fragment_length = std::min((size_t) LIBRIVER_FRAGMENT_SIZE, length - offset);
+		bool is_last = offset + fragment_length == length;
+		fragment->offset = offset;
+		memcpy(fragment->data, (uint8_t*) raw_packet + offset, fragment_length);
+		if(::write_shm_packet(fd, recipient, is_last ? shm_id : 0, is_last ? shm_perms : 0, sizeof(FragmentHeader) + fragment_length, fragment)) {
+			Log::err("[River] Error writing packet fragment: ", strerror(errno));
+			free(fragment);
+			return Result(errno);
+		}
+	}
+
+	free(fragment);
+	return Result::SUCCESS;
+}
+
+std::string River::packet_target(const RiverPacket& packet) {
+	if(packet.endpoint.empty() && packet.path.empty())
+		return "";
+	return packet.endpoint + ":" + packet.path;
+}
+
+void River::set_packet_target(RiverPacket& packet, const std::string& target) {
+	auto colon = target.find(':');
+	if(colon == std::string::npos) {
+		packet.endpoint = target;
+	} else {
+		packet.endpoint = target.substr(0, colon);
+		packet.path = target.substr(colon + 1);
+	}
+}
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <vector>
+#include <deque>
 #include <string>
 #include <libduck/Result.h>
 #include <sys/socketfs.h>
@@ -28,6 +29,13 @@
 
 #define LIBRIVER_PACKET_MAGIC 0xBEEF420
 #define LIBRIVER_MAX_TARGET_NAME_LEN 1024
+#define LIBRIVER_FRAGMENT_MAGIC 0xBEEF422
+//Packets bigger than this are split up into fragments of this size, so that they fit in a SocketFS queue of the default size
+#define LIBRIVER_FRAGMENT_SIZE 4096
+//The biggest packet that will be put back together from fragments
+#define LIBRIVER_MAX_PACKET_SIZE 0x400000
+//The socket ID a BusServer gives the connection made with BusServer::connect_local
+#define LIBRIVER_LOCAL_ID ((sockid_t) -1)
 
 namespace River {
 	enum PacketType {
@@ -49,7 +57,11 @@ namespace River {
 		GET_MESSAGE = 26,
 		SEND_MESSAGE = 25,
 
-		DEREGISTER_PATH = 30
+		DEREGISTER_PATH = 30,
+
+		SETUP_RING = 40,
+		RING_WAKEUP = 41,
+		RING_SOCKET_PACKET = 42
 	};
 
 	enum ErrorType {
@@ -76,6 +88,16 @@ namespace River {
 		size_t data_length;
 		ErrorType error;
 		sockid_t id;
+		uint32_t sequence;
+		uint32_t handle;
+		uint8_t data[];
+	};
+
+	/** Comes before each piece of a RawPacket that was too big to send in one go. **/
+	struct FragmentHeader {
+		int __river_magic = LIBRIVER_FRAGMENT_MAGIC;
+		uint32_t total_length; //The length of the whole RawPacket, incl. its header
+		uint32_t offset; //Where in the RawPacket this fragment starts
 		uint8_t data[];
 	};
 
@@ -97,6 +119,9 @@ namespace River {
 		sockid_t __socketfs_from_id;
 		pid_t __socketfs_from_pid;
 		std::vector<uint8_t> data;
+		int __socketfs_shm_id = 0;
+		uint32_t sequence = 0; //Matches a FUNCTION_RETURN up with the FUNCTION_CALL it's for
+		uint32_t handle = 0; //The server's number for the function or message, which can be sent instead of its endpoint and path
 	};
 
 	enum PacketReadResult {
@@ -107,6 +132,33 @@ namespace River {
 	};
 
 	Duck::ResultRet<RiverPacket> receive_packet(int fd, bool block);
-	Duck::Result send_packet(int fd, sockid_t recipient, const RiverPacket& packet);
+	/** Reads every packet waiting on a socket at once and adds them to packets. NO_PACKET is returned if there weren't any. **/
+	Duck::Result receive_packets(int fd, bool block, std::deque<RiverPacket>& packets);
+	Duck::Result send_packet(int fd, sockid_t recipient, const RiverPacket& packet, int shm_id = 0, int shm_perms = 0);
+	/** Writes a RawPacket to a socket, splitting it into fragments if it's too big to go in one SocketFS packet. **/
+	Duck::Result write_raw_packet(int fd, sockid_t recipient, RawPacket* raw_packet, size_t length, int shm_id, int shm_perms);
+	/** Sets the endpoint and path of a packet from its target, which looks like "endpoint:path". **/
+	void set_packet_target(RiverPacket& packet, const std::string& target);
+	/** Gets the target of a packet that set_packet_target will parse. Packets sent by handle have an empty one. **/
+	std::string packet_target(const RiverPacket& packet);
+
+	/**
+	 * Collects packets to be sent through a socket, so that they can all be written at once instead of with a write
+	 * each. Packets that are too big to go in one SocketFS packet are sent straight away, after the ones before them.
+	 */
+	class PacketBatch {
+	public:
+		explicit PacketBatch(int fd): _fd(fd) {}
+
+		/** Adds a packet to the batch. It might not be sent until the batch is flushed. **/
+		Duck::Result add(sockid_t recipient, const RiverPacket& packet, int shm_id = 0, int shm_perms = 0);
+		/** Sends everything in the batch, returning the first error if any of the packets couldn't be sent. **/
+		Duck::Result flush();
+		bool empty() const;
+
+	private:
+		int _fd;
+		std::vector<uint8_t> _data;
+	};
 }
 
@@ -40,13 +40,19 @@ void Connection::queue_samples(Duck::Ptr<SampleBuffer> buffer) {
 	if(!m_buffer.buffer())
 		return;
 
-	//If we have to resample, do so
-	if(buffer->sample_rate() != m_server_samplerate)
-		buffer = buffer->resample(m_server_samplerate);
-
 	// Queue the samples
-	for(size_t i = 0; i < buffer->num_samples(); i++)
-		m_buffer.push_wait(buffer->samples()[i]);
+	if(buffer->sample_rate() == m_server_samplerate) {
+		m_buffer.push_wait(buffer->samples(), buffer->num_samples());
+		return;
+	}
+
+	// If we have to resample, do so as the samples are queued. The resampler is kept around so that it can carry on
+	// from the last buffer we were given.
+	if(!m_resampler || m_resampler->from_rate() != buffer->sample_rate())
+		m_resampler = std::make_unique<Resampler>(buffer->sample_rate(), m_server_samplerate);
+	m_resampler->process(buffer->samples(), buffer->num_samples(), [&](const Sample* samples, size_t count) {
+		m_buffer.push_wait(samples, count);
+	});
 }
 
 Connection::Connection(std::shared_ptr<River::Endpoint> endpoint): m_endpoint(std::move(endpoint)) {
@@ -22,6 +22,7 @@
 #include <libduck/Result.h>
 #include <libriver/river.h>
 #include "SampleBuffer.h"
+#include "Resampler.h"
 #include <libduck/AtomicCircularQueue.h>
 
 #define LIBSOUND_QUEUE_SIZE 4096
@@ -39,6 +40,7 @@ namespace Sound {
 		std::shared_ptr<River::Endpoint> m_endpoint;
 		uint32_t m_server_samplerate;
 		Duck::AtomicCircularQueue<Sample, LIBSOUND_QUEUE_SIZE> m_buffer;
+		std::unique_ptr<Resampler> m_resampler;
 
 		//RIVER FUNCTIONS
 		River::Function<int> server_request_buffer = {"request_buffer"};
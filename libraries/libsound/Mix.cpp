@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+/*
+ * Samples are two floats each (left and right), so SSE works on two samples at a time. Conversion to 16-bit LPCM packs
+ * the truncated ints down with signed saturation, which puts the left and right channels next to each other just like
+ * as_16bit_lpcm does.
+ */
+
+#include "Mix.h"
+#include <immintrin.h>
+
+using namespace Sound;
+
+bool Sound::has_sse2() {
+	static int s_sse2 = -1;
+	if(s_sse2 == -1) {
+		unsigned int eax, ebx, ecx, edx;
+		asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+		s_sse2 = (edx & (1 << 26)) ? 1 : 0;
+	}
+	return s_sse2;
+}
+
+SSE2 static void mix_samples_sse2(Sample* dest, const Sample* src, float volume, size_t count) {
+	const __m128 vol = _mm_set1_ps(volume);
+	size_t i = 0;
+	for(; i + 2 <= count; i += 2) {
+		__m128 d = _mm_loadu_ps(&dest[i].left);
+		__m128 s = _mm_loadu_ps(&src[i].left);
+		_mm_storeu_ps(&dest[i].left, _mm_add_ps(d, _mm_mul_ps(s, vol)));
+	}
+	for(; i < count; i++) {
+		dest[i].left += src[i].left * volume;
+		dest[i].right += src[i].right * volume;
+	}
+}
+
+SSE2 static void samples_to_16bit_lpcm_sse2(uint32_t* dest, const Sample* src, size_t count) {
+	const __m128 min = _mm_set1_ps(-1.0f);
+	const __m128 max = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(32767.0f);
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&src[i].left), min), max);
+		__m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&src[i + 2].left), min), max);
+		__m128i ia = _mm_cvttps_epi32(_mm_mul_ps(a, scale));
+		__m128i ib = _mm_cvttps_epi32(_mm_mul_ps(b, scale));
+		_mm_storeu_si128((__m128i*) (dest + i), _mm_packs_epi32(ia, ib));
+	}
+	for(; i < count; i++) {
+		Sample sample = {std::clamp(src[i].left, -1.0f, 1.0f), std::clamp(src[i].right, -1.0f, 1.0f)};
+		dest[i] = sample.as_16bit_lpcm();
+	}
+}
+
+void Sound::mix_samples(Sample* dest, const Sample* src, float volume, size_t count) {
+	if(has_sse2())
+		return mix_samples_sse2(dest, src, volume, count);
+	for(size_t i = 0; i < count; i++) {
+		dest[i].left += src[i].left * volume;
+		dest[i].right += src[i].right * volume;
+	}
+}
+
+void Sound::samples_to_16bit_lpcm(uint32_t* dest, const Sample* src, size_t count) {
+	if(has_sse2())
+		return samples_to_16bit_lpcm_sse2(dest, src, count);
+	for(size_t i = 0; i < count; i++) {
+		Sample sample = {std::clamp(src[i].left, -1.0f, 1.0f), std::clamp(src[i].right, -1.0f, 1.0f)};
+		dest[i] = sample.as_16bit_lpcm();
+	}
+}
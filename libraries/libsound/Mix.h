@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Sample.h"
+
+//For functions that are only called once has_sse2 says they can be
+#define SSE2 __attribute__((target("sse2")))
+
+namespace Sound {
+	/** Whether SSE2 instructions can be used, which is worked out the first time this is called. **/
+	bool has_sse2();
+
+	/**
+	 * Mixes a block of samples into another, scaled by a volume. Nothing is clamped, so loud mixes can go past -1 to 1
+	 * until they're converted with samples_to_16bit_lpcm.
+	 * @param dest The samples to mix into.
+	 * @param src The samples to mix in.
+	 * @param volume What to multiply src by.
+	 * @param count The number of samples.
+	 */
+	void mix_samples(Sample* dest, const Sample* src, float volume, size_t count);
+
+	/**
+	 * Converts a block of samples to 16-bit LPCM, the same way Sample::as_16bit_lpcm does except that samples outside of
+	 * -1 to 1 are clamped instead of wrapping around.
+	 * @param dest Where to put the converted samples.
+	 * @param src The samples to convert.
+	 * @param count The number of samples.
+	 */
+	void samples_to_16bit_lpcm(uint32_t* dest, const Sample* src, size_t count);
+}
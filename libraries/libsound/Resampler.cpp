@@ -0,0 +1,107 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Resampler.h"
+#include "Mix.h"
+#include <cmath>
+#include <immintrin.h>
+
+using namespace Sound;
+
+//The window is as wide as the filter, so it reaches zero at the outermost taps
+static double blackman(double x) {
+	double half_width = RESAMPLER_TAPS / 2.0;
+	if(x <= -half_width || x >= half_width)
+		return 0;
+	return 0.42 + 0.5 * cos(M_PI * x / half_width) + 0.08 * cos(2 * M_PI * x / half_width);
+}
+
+static double sinc(double x) {
+	if(x == 0)
+		return 1;
+	return sin(M_PI * x) / (M_PI * x);
+}
+
+Resampler::Resampler(uint32_t from_rate, uint32_t to_rate):
+	m_from_rate(from_rate),
+	m_to_rate(to_rate),
+	m_step((float) from_rate / (float) to_rate),
+	m_filters((RESAMPLER_PHASES + 1) * RESAMPLER_TAPS * 2)
+{
+	//Phase p is for output samples p / RESAMPLER_PHASES of the way between the two middle taps. There's one more phase
+	//than needed so that positions that round up to the next input sample still have one.
+	double cutoff = std::min(1.0, (double) to_rate / (double) from_rate);
+	for(size_t phase = 0; phase <= RESAMPLER_PHASES; phase++) {
+		auto* taps = &m_filters[phase * RESAMPLER_TAPS * 2];
+		double offset = (RESAMPLER_TAPS / 2 - 1) + (double) phase / RESAMPLER_PHASES;
+		double sum = 0;
+		for(size_t tap = 0; tap < RESAMPLER_TAPS; tap++) {
+			double x = tap - offset;
+			double value = cutoff * sinc(cutoff * x) * blackman(x);
+			taps[tap * 2] = taps[tap * 2 + 1] = value;
+			sum += value;
+		}
+
+		//Scale each filter so it doesn't change the volume
+		for(size_t i = 0; i < RESAMPLER_TAPS * 2; i++)
+			taps[i] /= sum;
+	}
+	reset();
+}
+
+SSE2 static Sample filter_sse2(const Sample* history, const float* taps) {
+	__m128 acc = _mm_setzero_ps();
+	for(size_t i = 0; i < RESAMPLER_TAPS; i += 2)
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&history[i].left), _mm_loadu_ps(taps + i * 2)));
+	acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+	Sample ret;
+	_mm_storel_pi((__m64*) &ret, acc);
+	return ret;
+}
+
+Sample Resampler::filter(float position) const {
+	const auto* history = &m_history[m_history_pos];
+	const auto* taps = &m_filters[(size_t) (position * RESAMPLER_PHASES + 0.5f) * RESAMPLER_TAPS * 2];
+	if(has_sse2())
+		return filter_sse2(history, taps);
+	Sample ret;
+	for(size_t i = 0; i < RESAMPLER_TAPS; i++) {
+		ret.left += history[i].left * taps[i * 2];
+		ret.right += history[i].right * taps[i * 2 + 1];
+	}
+	return ret;
+}
+
+void Resampler::process(const Sample* samples, size_t count, const std::function<void(const Sample*, size_t)>& output) {
+	size_t num_output = 0;
+	for(size_t i = 0; i < count; i++) {
+		m_history[m_history_pos] = samples[i];
+		m_history[m_history_pos + RESAMPLER_TAPS] = samples[i];
+		m_history_pos = (m_history_pos + 1) % RESAMPLER_TAPS;
+
+		//Work out every output sample that falls before the next input sample
+		while(m_position < 1.0f) {
+			m_output[num_output++] = filter(m_position);
+			if(num_output == RESAMPLER_CHUNK) {
+				output(m_output, num_output);
+				num_output = 0;
+			}
+			m_position += m_step;
+		}
+		m_position -= 1.0f;
+	}
+
+	if(num_output)
+		output(m_output, num_output);
+}
+
+size_t Resampler::max_output(size_t count) const {
+	return (size_t) ceilf(count / m_step) + 1;
+}
+
+void Resampler::reset() {
+	m_position = 0;
+	m_history_pos = 0;
+	for(auto& sample : m_history)
+		sample = {};
+}
@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Sample.h"
+
+#define RESAMPLER_TAPS 16 //How many input samples each output sample is filtered from
+#define RESAMPLER_PHASES 64 //How many positions between two input samples the filter is worked out for
+#define RESAMPLER_CHUNK 256 //How many output samples are handed over at a time
+
+namespace Sound {
+	/**
+	 * Converts a stream of samples from one sample rate to another with a windowed sinc filter, which is worked out ahead
+	 * of time for RESAMPLER_PHASES positions between input samples. When going down to a lower rate, the filter also cuts
+	 * off everything above the new rate's Nyquist frequency so it doesn't alias.
+	 *
+	 * The last few input samples are kept between calls to process, so a stream can be resampled a buffer at a time
+	 * without any clicks at the edges. Output is delayed by RESAMPLER_TAPS / 2 input samples.
+	 */
+	class Resampler {
+	public:
+		Resampler(uint32_t from_rate, uint32_t to_rate);
+
+		/**
+		 * Resamples some samples.
+		 * @param samples The samples to resample.
+		 * @param count The number of samples.
+		 * @param output Called with the resampled samples, up to RESAMPLER_CHUNK at a time. Everything that can be
+		 *               worked out from the samples so far is passed along before process returns.
+		 */
+		void process(const Sample* samples, size_t count, const std::function<void(const Sample*, size_t)>& output);
+
+		/** The most samples that processing the given number of samples could output. **/
+		[[nodiscard]] size_t max_output(size_t count) const;
+
+		/** Forgets about the samples we've been given so far, to start on a new stream. **/
+		void reset();
+
+		[[nodiscard]] uint32_t from_rate() const { return m_from_rate; }
+		[[nodiscard]] uint32_t to_rate() const { return m_to_rate; }
+
+	private:
+		Sample filter(float position) const;
+
+		uint32_t m_from_rate;
+		uint32_t m_to_rate;
+		float m_step; ///< How many input samples there are for each output sample.
+		float m_position = 0; ///< Where the next output sample is, from the middle of the history onwards.
+		std::vector<float> m_filters; ///< The filter for each phase, with each tap twice (for the left and right channels).
+		Sample m_history[RESAMPLER_TAPS * 2]; ///< The last RESAMPLER_TAPS input samples, twice so they can be read in one go.
+		size_t m_history_pos = 0; ///< Where the oldest sample in the history is.
+		Sample m_output[RESAMPLER_CHUNK]; ///< Output samples waiting to be handed over.
+	};
+}
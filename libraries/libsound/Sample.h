@@ -31,7 +31,7 @@ namespace Sound {
 		}
 
 		inline uint32_t as_16bit_lpcm() {
-			return ((uint32_t)(right * (int16_t) 32767) << 16) | ((uint32_t) (left * (int16_t) 32767) & 0xffff);
+			return ((uint32_t) (uint16_t) (int16_t) (right * 32767) << 16) | (uint16_t) (int16_t) (left * 32767);
 		}
 
 		inline Sample operator+(const Sample& other) const {
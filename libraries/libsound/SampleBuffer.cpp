@@ -18,6 +18,7 @@
 */
 
 #include "SampleBuffer.h"
+#include "Resampler.h"
 #include <libduck/Log.h>
 
 using namespace Sound;
@@ -36,12 +37,14 @@ SampleBuffer::~SampleBuffer() noexcept {
 Ptr<SampleBuffer> SampleBuffer::resample(uint32_t sample_rate) const {
 	if(sample_rate == m_sample_rate)
 		return copy();
-	float ratio = (float) sample_rate / (float) m_sample_rate;
-	auto new_num_samples = (size_t) (m_num_samples * ratio);
-	auto new_buffer = SampleBuffer::make(sample_rate, new_num_samples);
-	auto new_samples = new_buffer->samples();
-	for(size_t i = 0; i < new_num_samples; i++)
-		new_samples[i] = m_samples[(int) (i / ratio)];
+	Resampler resampler(m_sample_rate, sample_rate);
+	auto new_buffer = SampleBuffer::make(sample_rate, resampler.max_output(m_num_samples));
+	size_t num_resampled = 0;
+	resampler.process(m_samples, m_num_samples, [&](const Sample* samples, size_t count) {
+		memcpy(new_buffer->m_samples + num_resampled, samples, sizeof(Sample) * count);
+		num_resampled += count;
+	});
+	new_buffer->m_num_samples = num_resampled;
 	return new_buffer;
 }
 
@@ -62,7 +65,9 @@ void SampleBuffer::set_sample_rate(uint32_t sample_rate) {
 }
 
 void SampleBuffer::set_num_samples(uint32_t num_samples) {
-	realloc(m_samples, num_samples * sizeof(Sample));
+	if(num_samples > m_num_samples)
+		m_samples = (Sample*) realloc(m_samples, num_samples * sizeof(Sample));
+	m_num_samples = num_samples;
 }
 
 ResultRet<Ptr<SampleBuffer>> SampleBuffer::copy() const {
@@ -32,7 +32,7 @@ namespace Sound {
 
 		[[nodiscard]] Duck::Ptr<SampleBuffer> resample(uint32_t sample_rate) const;
 		void set_sample_rate(uint32_t sample_rate); //Does NOT resample
-		void set_num_samples(uint32_t num_samples); //Does NOT resize buffer
+		void set_num_samples(uint32_t num_samples); //Only grows the buffer if it has to
 
 		[[nodiscard]] Sample* samples() const;
 		[[nodiscard]] uint32_t sample_rate() const;
@@ -18,6 +18,8 @@
 */
 
 #include "WavReader.h"
+#include <sys/thread.h>
+#include <unistd.h>
 
 using namespace Sound;
 using Duck::ResultRet, Duck::Result;
@@ -45,6 +47,8 @@ ResultRet<WavReader> WavReader::read_wav(Duck::File& file) {
 	CHECK(header.fmt_header == WAV_FMT_HEADER);
 	CHECK_SUPPORTED(header.fmt_size == 16);
 	CHECK_SUPPORTED(header.audio_fmt == WAV_FMT_PCM);
+	CHECK_SUPPORTED(header.bits_per_sample == 16);
+	CHECK_SUPPORTED(header.num_channels == 1 || header.num_channels == 2);
 	CHECK(header.chunk2_header == WAV_DATA_HEADER);
 
 	return WavReader(file, header);
@@ -54,47 +58,101 @@ WavReader::WavReader(Duck::File& file, WavHeader header): m_file(file), m_header
 
 }
 
-Duck::ResultRet<Duck::Ptr<SampleBuffer>> WavReader::read_samples(size_t num_samples) {
-	//First, read the samples from the file
-	const size_t buf_size = (m_header.bits_per_sample / 8) * m_header.num_channels * num_samples;
-	auto* buffer = new uint8_t[buf_size];
-	auto read_res = m_file.read(buffer, buf_size);
-	if(read_res.is_error()) {
-		delete[] buffer;
+WavReader::~WavReader() {
+	if(m_read_ahead && m_read_ahead->thread) {
+		m_read_ahead->stop = true;
+		thread_join(m_read_ahead->thread, nullptr);
+	}
+}
+
+Duck::Result WavReader::start_read_ahead() {
+	if(m_read_ahead)
+		return Result::SUCCESS;
+	auto queue_res = Duck::AtomicCircularQueue<Sample, WAV_READ_AHEAD_SAMPLES>::alloc();
+	if(queue_res.is_error())
+		return queue_res.result();
+
+	m_read_ahead.reset(new ReadAhead {m_file, m_header, queue_res.value()});
+	m_read_ahead->thread = thread_create(read_ahead_thread, m_read_ahead.get());
+	if(m_read_ahead->thread < 0) {
+		m_read_ahead.reset();
+		return Result(errno);
+	}
+	return Result::SUCCESS;
+}
+
+void* WavReader::read_ahead_thread(void* arg) {
+	auto* read_ahead = (ReadAhead*) arg;
+	Sample samples[WAV_READ_CHUNK_SAMPLES];
+	uint8_t raw[WAV_READ_CHUNK_SAMPLES * sizeof(uint32_t)];
+	while(!read_ahead->stop) {
+		auto res = decode(read_ahead->file, read_ahead->header, raw, samples, WAV_READ_CHUNK_SAMPLES);
+		if(res.is_error() || !res.value())
+			break;
+
+		//Wait for room in the queue a bit at a time, so we notice if we're told to stop
+		size_t num_pushed = 0;
+		while(num_pushed < res.value() && !read_ahead->stop) {
+			num_pushed += read_ahead->queue.push(samples + num_pushed, res.value() - num_pushed);
+			if(num_pushed < res.value())
+				usleep(1000);
+		}
+	}
+	read_ahead->done = true;
+	return nullptr;
+}
+
+ResultRet<size_t> WavReader::decode(Duck::File& file, const WavHeader& header, uint8_t* raw, Sample* samples, size_t num_samples) {
+	const size_t frame_size = sizeof(int16_t) * header.num_channels;
+	auto read_res = file.read(raw, frame_size * num_samples);
+	if(read_res.is_error())
 		return read_res.result();
+	num_samples = read_res.value() / frame_size;
+
+	auto* pcm = (const int16_t*) raw;
+	if(header.num_channels == 2) {
+		for(size_t i = 0; i < num_samples; i++)
+			samples[i] = {pcm[i * 2] / 32767.0f, pcm[i * 2 + 1] / 32767.0f};
+	} else {
+		for(size_t i = 0; i < num_samples; i++)
+			samples[i] = {pcm[i] / 32767.0f, pcm[i] / 32767.0f};
 	}
-	num_samples = (read_res.value() / (m_header.bits_per_sample / 8)) / m_header.num_channels;
+	return num_samples;
+}
 
-	//Create the sample buffer
-	auto sample_buf = SampleBuffer::make(m_header.sample_rate, num_samples);
+size_t WavReader::read_decoded(Sample* samples, size_t num_samples) {
+	//With read-ahead, wait for as many samples as were asked for unless the file runs out first
+	if(m_read_ahead) {
+		size_t num_read = 0;
+		while(true) {
+			num_read += m_read_ahead->queue.pop(samples + num_read, num_samples - num_read);
+			if(num_read == num_samples || (m_read_ahead->done && m_read_ahead->queue.empty()))
+				return num_read;
+			usleep(1000);
+		}
+	}
 
-	//Load in the samples
-	for(size_t i = 0; i < num_samples; i++)
-		sample_buf->samples()[i] = Sample::from_16bit_lpcm(((uint32_t*)buffer)[i]);
-	delete[] buffer;
+	//Otherwise, decode straight from the file into the samples, a chunk at a time
+	m_raw.resize(std::min(num_samples, (size_t) WAV_READ_CHUNK_SAMPLES) * sizeof(uint32_t));
+	size_t num_read = 0;
+	while(num_read < num_samples) {
+		auto res = decode(m_file, m_header, m_raw.data(), samples + num_read, std::min(num_samples - num_read, (size_t) WAV_READ_CHUNK_SAMPLES));
+		if(res.is_error() || !res.value())
+			break;
+		num_read += res.value();
+	}
+	return num_read;
+}
 
+Duck::ResultRet<Duck::Ptr<SampleBuffer>> WavReader::read_samples(size_t num_samples) {
+	auto sample_buf = SampleBuffer::make(m_header.sample_rate, num_samples);
+	sample_buf->set_num_samples(read_decoded(sample_buf->samples(), num_samples));
 	return sample_buf;
 }
 
 ResultRet<size_t> WavReader::read_samples(Duck::Ptr<SampleBuffer> sample_buf) {
-	size_t num_samples = sample_buf->num_samples();
-
-	//First, read the samples from the file
-	const size_t buf_size = (m_header.bits_per_sample / 8) * m_header.num_channels * num_samples;
-	auto* buffer = new uint8_t[buf_size];
-	auto read_res = m_file.read(buffer, buf_size);
-	if(read_res.is_error()) {
-		delete[] buffer;
-		return read_res.result();
-	}
-	num_samples = (read_res.value() / (m_header.bits_per_sample / 8)) / m_header.num_channels;
-
-	//Load in the samples
+	auto num_samples = read_decoded(sample_buf->samples(), sample_buf->num_samples());
 	sample_buf->set_sample_rate(m_header.sample_rate);
 	sample_buf->set_num_samples(num_samples);
-	for(size_t i = 0; i < num_samples; i++)
-		sample_buf->samples()[i] = Sample::from_16bit_lpcm(((uint32_t*) buffer)[i]);
-	delete[] buffer;
-
 	return num_samples;
 }
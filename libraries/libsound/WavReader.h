@@ -22,6 +22,10 @@
 #include <libduck/Result.h>
 #include <libduck/Path.h>
 #include <libduck/File.h>
+#include <libduck/AtomicCircularQueue.h>
+#include <atomic>
+#include <memory>
+#include <vector>
 #include "SampleBuffer.h"
 
 #define WAV_RIFF_MAGIC 0x46464952
@@ -30,6 +34,8 @@
 #define WAV_DATA_HEADER 0x61746164
 #define WAV_FMT_PCM 0x1
 #define WAV_FMT_FLOAT 0x3
+#define WAV_READ_CHUNK_SAMPLES 2048 //How many samples are read from the file at a time
+#define WAV_READ_AHEAD_SAMPLES 32768 //How many samples the read-ahead thread can get ahead by
 
 namespace Sound {
 	class WavReader {
@@ -53,15 +59,41 @@ namespace Sound {
 		static Duck::ResultRet<WavReader> open_wav(const Duck::Path& path);
 		static Duck::ResultRet<WavReader> read_wav(Duck::File& file);
 
+		WavReader(WavReader&& other) = default;
+		~WavReader();
+
+		/**
+		 * Starts a thread that reads and decodes the file ahead of time, so that reads don't have to wait on the disk.
+		 * Memory use stays the same no matter how long the file is. The file shouldn't be used for anything else after this.
+		 */
+		Duck::Result start_read_ahead();
+
 		Duck::ResultRet<Duck::Ptr<SampleBuffer>> read_samples(size_t num_samples);
+		/** Reads samples into a buffer, filling it up unless the file runs out. Its size is set to the number read. **/
 		Duck::ResultRet<size_t> read_samples(Duck::Ptr<SampleBuffer> buffer);
 
 		[[nodiscard]] uint32_t sample_rate() const { return m_header.sample_rate; }
 
 	private:
+		struct ReadAhead {
+			Duck::File file;
+			WavHeader header;
+			Duck::AtomicCircularQueue<Sample, WAV_READ_AHEAD_SAMPLES> queue;
+			std::atomic<bool> done = false;
+			std::atomic<bool> stop = false;
+			tid_t thread = 0;
+		};
+
 		WavReader(Duck::File& file, WavHeader header);
 
+		static void* read_ahead_thread(void* arg);
+		/** Reads up to num_samples samples from a file into raw, and decodes them into samples. **/
+		static Duck::ResultRet<size_t> decode(Duck::File& file, const WavHeader& header, uint8_t* raw, Sample* samples, size_t num_samples);
+		size_t read_decoded(Sample* samples, size_t num_samples);
+
 		Duck::File m_file;
 		WavHeader m_header;
+		std::vector<uint8_t> m_raw; ///< Where the file is read into before it's decoded, without read-ahead.
+		std::unique_ptr<ReadAhead> m_read_ahead;
 	};
 }
\ No newline at end of file
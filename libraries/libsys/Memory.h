@@ -36,6 +36,8 @@ namespace Sys::Mem {
 		Amount kernel_phys;
 		Amount kernel_heap;
 		Amount kernel_disk_cache;
+		Amount swap_total;
+		Amount swap_used;
 
 		inline double used_frac() const {
 			return (double)((long double) used / (long double) usable);
@@ -19,30 +19,57 @@
 
 #include "Process.h"
 #include <libduck/Filesystem.h>
-#include <libduck/Config.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <string.h>
+#include <time.h>
 
 using namespace Sys;
 using Duck::Result, Duck::ResultRet, Duck::Path;
 
+namespace {
+	//Reads the whole process table from /proc/procs in one go, so it's a consistent snapshot.
+	std::vector<proc_info> read_proc_infos() {
+		std::vector<proc_info> infos(64);
+		int fd = open("/proc/procs", O_RDONLY | O_CLOEXEC);
+		if(fd < 0)
+			return {};
+
+		//If it fills the buffer, there might be more processes than fit in it, so try again with a bigger one.
+		ssize_t nread;
+		while((nread = pread(fd, infos.data(), infos.size() * sizeof(proc_info), 0)) == (ssize_t) (infos.size() * sizeof(proc_info)))
+			infos.resize(infos.size() * 2);
+		close(fd);
+
+		infos.resize(nread < 0 ? 0 : nread / sizeof(proc_info));
+		return infos;
+	}
+}
+
 std::map<pid_t, Process> Process::get_all() {
 	std::map<pid_t, Process> ret;
-
-	auto ent_res = Path("/proc/").get_directory_entries();
-	if(ent_res.is_error())
-		return ret; //This should not happen
-
-	for(const auto& ent : ent_res.value()) {
-		if(ent.is_directory() && std::isdigit(ent.name()[0])) {
-			pid_t pid = std::stoi(std::string(ent.name()));
-			auto proc_res = get(pid);
-			if(proc_res.has_value())
-				ret[pid] = proc_res.value();
-		}
-	}
+	for(auto& info : read_proc_infos())
+		ret.emplace(info.pid, Process(info));
 	return ret;
 }
 
+Process::Process(const proc_info& info):
+	_name(info.name),
+	_pid(info.pid),
+	_ppid(info.ppid),
+	_gid(info.gid),
+	_uid(info.uid),
+	_state((State) info.state),
+	_physical_mem({info.pmem}),
+	_virtual_mem({info.vmem}),
+	_shared_mem({info.shmem}),
+	_file_mem({info.file_mem}),
+	_resident_mem({info.rss}),
+	_cpu_time(info.cpu_time),
+	_nice(info.nice) {}
+
 ResultRet<Process> Process::get(pid_t pid) {
 	Process ret;
 	ret._pid = pid;
@@ -78,29 +105,82 @@ std::string Process::exe() const {
 	return link;
 }
 
+Result Process::set_nice(int nice) {
+	if(setpriority(PRIO_PROCESS, _pid, nice) < 0)
+		return Result(errno);
+	_nice = nice;
+	return Result::SUCCESS;
+}
+
+ResultRet<uint32_t> Process::affinity() const {
+	cpu_set_t set;
+	if(sched_getaffinity(_pid, sizeof(set), &set) < 0)
+		return Result(errno);
+	return set.mask;
+}
+
+Result Process::set_affinity(uint32_t mask) {
+	cpu_set_t set = {mask};
+	if(sched_setaffinity(_pid, sizeof(set), &set) < 0)
+		return Result(errno);
+	return Result::SUCCESS;
+}
+
 ResultRet<App::Info> Process::app_info() const {
 	return App::Info::from_app_directory(Path(exe()).parent());
 }
 
 Result Process::update() {
-	auto cfg_res = Duck::Config::read_from("/proc/" + std::to_string(_pid) + "/status");
-	if(cfg_res.is_error())
-		return cfg_res.result();
-	auto& cfg = cfg_res.value();
-
-	if(!cfg.has_section("proc"))
-		return Result::FAILURE;
-	auto& proc = cfg["proc"];
-
-	_name = proc["name"];
-	_pid = std::stoi(proc["pid"]);
-	_ppid = std::stoi(proc["ppid"]);
-	_gid = std::stoi(proc["gid"]);
-	_uid = std::stoi(proc["uid"]);
-	_state = (State) std::stoi(proc["state"]);
-	_physical_mem = {std::stoul(proc["pmem"])};
-	_virtual_mem = {std::stoul(proc["vmem"])};
-	_shared_mem = {std::stoul(proc["shmem"])};
+	for(auto& info : read_proc_infos()) {
+		if(info.pid == _pid) {
+			*this = Process(info);
+			return Result::SUCCESS;
+		}
+	}
+	return Result(ENOENT);
+}
 
-	return Result::SUCCESS;
+ProcessTable::Changes ProcessTable::update() {
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint64_t now_us = now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+	uint64_t elapsed_us = _last_update_us ? now_us - _last_update_us : 0;
+	_last_update_us = now_us;
+
+	Changes changes;
+	auto old_entries = std::move(_entries);
+	_entries.clear();
+	for(auto& info : read_proc_infos()) {
+		auto old = old_entries.find(info.pid);
+		if(old == old_entries.end()) {
+			changes.added.push_back(info.pid);
+			_processes.insert_or_assign(info.pid, Process(info));
+			_entries[info.pid] = {info, 0};
+			continue;
+		}
+
+		//Processes that are exactly as they were last time (which most sleeping ones will be) can be skipped
+		auto& old_info = old->second.info;
+		double cpu_percent = 0;
+		if(elapsed_us && info.cpu_time > old_info.cpu_time)
+			cpu_percent = (double) (info.cpu_time - old_info.cpu_time) * 100.0 / elapsed_us;
+		if(memcmp(&info, &old_info, sizeof(proc_info)) != 0 || cpu_percent != old->second.cpu_percent) {
+			changes.changed.push_back(info.pid);
+			_processes.insert_or_assign(info.pid, Process(info));
+		}
+		_entries[info.pid] = {info, cpu_percent};
+		old_entries.erase(old);
+	}
+
+	for(auto& [pid, entry] : old_entries) {
+		changes.removed.push_back(pid);
+		_processes.erase(pid);
+	}
+
+	return changes;
+}
+
+double ProcessTable::cpu_percent(pid_t pid) const {
+	auto entry = _entries.find(pid);
+	return entry == _entries.end() ? 0 : entry->second.cpu_percent;
 }
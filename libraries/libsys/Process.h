@@ -22,9 +22,12 @@
 #include <sys/types.h>
 #include "Memory.h"
 #include <map>
+#include <vector>
 #include <libapp/App.h>
+#include <kernel/api/procinfo.h>
 
 namespace Sys {
+	class ProcessTable;
 	class Process {
 	public:
 		enum State {
@@ -34,6 +37,8 @@ namespace Sys {
 			BLOCKED = 3
 		};
 
+		Process() = default;
+
 		static std::map<pid_t, Process> get_all();
 		static Duck::ResultRet<Process> get(pid_t pid);
 		static Duck::ResultRet<Process> self();
@@ -46,15 +51,34 @@ namespace Sys {
 		uid_t uid() const { return _uid; }
 		State state() const { return _state; }
 		std::string state_name() const;
+		/// The private anonymous memory the process has mapped in.
 		Mem::Amount physical_mem() const { return _physical_mem; }
 		Mem::Amount virtual_mem() const { return _virtual_mem; }
+		/// The shared anonymous memory the process has mapped in.
 		Mem::Amount shared_mem() const { return _shared_mem; }
+		/// The memory the process has mapped in from files.
+		Mem::Amount file_mem() const { return _file_mem; }
+		/// All of the memory the process has mapped in.
+		Mem::Amount resident_mem() const { return _resident_mem; }
+		/// The total time the process's threads have spent running, in microseconds.
+		uint64_t cpu_time() const { return _cpu_time; }
+		int nice() const { return _nice; }
+
+		/// Sets the nice value of the process. Only root can lower it.
+		Duck::Result set_nice(int nice);
+		/// Gets the mask of processors that the process's main thread is allowed to run on.
+		Duck::ResultRet<uint32_t> affinity() const;
+		/// Sets the mask of processors that the process's main thread is allowed to run on.
+		Duck::Result set_affinity(uint32_t mask);
 
 		Duck::ResultRet<App::Info> app_info() const;
 
 		Duck::Result update();
 
 	private:
+		friend class ProcessTable;
+		explicit Process(const proc_info& info);
+
 		std::string _name;
 		pid_t _pid;
 		pid_t _ppid;
@@ -64,6 +88,41 @@ namespace Sys {
 		Mem::Amount _physical_mem;
 		Mem::Amount _virtual_mem;
 		Mem::Amount _shared_mem;
+		Mem::Amount _file_mem;
+		Mem::Amount _resident_mem;
+		uint64_t _cpu_time = 0;
+		int _nice = 0;
+	};
+
+	/**
+	 * A copy of the process table that can be brought up to date, for things that show it over time like the monitor.
+	 * Each update says which processes were added, removed or changed, so only those need to be looked at again.
+	 */
+	class ProcessTable {
+	public:
+		struct Changes {
+			std::vector<pid_t> added;
+			std::vector<pid_t> removed;
+			std::vector<pid_t> changed;
+		};
+
+		/// Reads the process table again and finds what's different since the last update.
+		Changes update();
+
+		const std::map<pid_t, Process>& processes() const { return _processes; }
+
+		/// The percentage of one CPU's time the process used between the last two updates.
+		double cpu_percent(pid_t pid) const;
+
+	private:
+		struct Entry {
+			proc_info info;
+			double cpu_percent;
+		};
+
+		std::map<pid_t, Process> _processes;
+		std::map<pid_t, Entry> _entries;
+		uint64_t _last_update_us = 0;
 	};
 }
 
@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Stats.h"
+#include <libriver/river.h>
+#include <libduck/Log.h>
+
+using namespace Sys;
+using namespace Sys::Stats;
+using Duck::Result;
+
+Sample Sample::make(const CPU::Info& cpu, const Mem::Info& mem) {
+	return {
+		cpu.utilization,
+		mem.usable,
+		mem.used,
+		mem.reserved,
+		mem.kernel_virt,
+		mem.kernel_phys,
+		mem.kernel_heap,
+		mem.kernel_disk_cache,
+		mem.swap_total,
+		mem.swap_used
+	};
+}
+
+CPU::Info Sample::cpu() const {
+	return {cpu_utilization};
+}
+
+Mem::Info Sample::mem() const {
+	return {
+		mem_usable,
+		mem_used,
+		mem_reserved,
+		kernel_virt,
+		kernel_phys,
+		kernel_heap,
+		kernel_disk_cache,
+		swap_total,
+		swap_used
+	};
+}
+
+Duck::Ptr<Subscription> Subscription::subscribe(Callback callback) {
+	auto ret = Duck::Ptr<Subscription>(new Subscription(std::move(callback)));
+
+	//If statd isn't running, we'll have to read the statistics ourselves
+	auto conn_res = River::BusConnection::connect(SERVICE_NAME);
+	if(conn_res.is_error())
+		return ret;
+
+	auto endpoint_res = conn_res.value()->get_endpoint(SERVICE_NAME);
+	if(endpoint_res.is_error())
+		return ret;
+
+	auto* self = ret.get();
+	auto handler_res = endpoint_res.value()->set_message_handler<Sample>("sample", [self](Sample sample) {
+		self->m_callback(sample.cpu(), sample.mem());
+	});
+	if(handler_res.is_error()) {
+		Duck::Log::warnf("libsys: Couldn't subscribe to statd: {}", River::error_str(handler_res.code()));
+		return ret;
+	}
+
+	ret->m_endpoint = endpoint_res.value();
+	return ret;
+}
+
+Subscription::Subscription(Callback callback): m_callback(std::move(callback)) {}
+
+int Subscription::fd() const {
+	return m_endpoint ? m_endpoint->bus()->file_descriptor() : -1;
+}
+
+void Subscription::receive() {
+	if(m_endpoint)
+		m_endpoint->bus()->read_and_handle_packets(false);
+}
+
+Result Subscription::poll() {
+	if(!m_cpu_stream.is_open()) {
+		auto res = m_cpu_stream.open("/proc/cpuinfo");
+		if(res.is_error())
+			return res;
+	}
+	if(!m_mem_stream.is_open()) {
+		auto res = m_mem_stream.open("/proc/meminfo");
+		if(res.is_error())
+			return res;
+	}
+	auto cpu = TRY(CPU::get_info(m_cpu_stream));
+	auto mem = TRY(Mem::get_info(m_mem_stream));
+	m_callback(cpu, mem);
+	return Result::SUCCESS;
+}
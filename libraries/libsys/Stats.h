@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include "CPU.h"
+#include "Memory.h"
+#include <libduck/Object.h>
+#include <libduck/FileStream.h>
+#include <functional>
+#include <memory>
+
+namespace River {
+	class Endpoint;
+}
+
+namespace Sys::Stats {
+	/// The name of statd's bus and endpoint.
+	constexpr const char* SERVICE_NAME = "statd";
+	/// How often statd samples the system's statistics, in milliseconds.
+	constexpr int INTERVAL = 1000;
+
+	/// A sample of the CPU and memory statistics, in the form statd sends it to subscribers.
+	struct Sample {
+		double cpu_utilization;
+		size_t mem_usable;
+		size_t mem_used;
+		size_t mem_reserved;
+		size_t kernel_virt;
+		size_t kernel_phys;
+		size_t kernel_heap;
+		size_t kernel_disk_cache;
+		size_t swap_total;
+		size_t swap_used;
+
+		static Sample make(const CPU::Info& cpu, const Mem::Info& mem);
+		CPU::Info cpu() const;
+		Mem::Info mem() const;
+	};
+
+	/**
+	 * Receives samples of the system's statistics from statd, so that many programs can keep track of them without each
+	 * reading and parsing /proc themselves. If statd isn't running, fd() is -1 and the owner should call poll() on a
+	 * timer instead, which reads the statistics from /proc.
+	 */
+	class Subscription {
+	public:
+		using Callback = std::function<void(const CPU::Info&, const Mem::Info&)>;
+
+		static Duck::Ptr<Subscription> subscribe(Callback callback);
+
+		/// The file descriptor that becomes readable when statd sends us a sample, or -1 if we aren't connected to it.
+		[[nodiscard]] int fd() const;
+		/// Handles the samples statd has sent us, calling the callback for each one.
+		void receive();
+		/// Reads the statistics from /proc and calls the callback with them.
+		Duck::Result poll();
+
+	private:
+		explicit Subscription(Callback callback);
+
+		Callback m_callback;
+		std::shared_ptr<River::Endpoint> m_endpoint;
+		Duck::FileInputStream m_cpu_stream;
+		Duck::FileInputStream m_mem_stream;
+	};
+}
@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Syscalls.h"
+#include <libduck/FileStream.h>
+#include <stdlib.h>
+
+using namespace Sys;
+using Duck::Result, Duck::ResultRet;
+
+double Syscalls::Stats::average_us() const {
+	return calls ? (double) total_us / calls : 0;
+}
+
+uint64_t Syscalls::Stats::percentile_us(double fraction) const {
+	uint64_t target = (uint64_t) (calls * fraction);
+	uint64_t count = 0;
+	for(size_t i = 0; i < buckets.size(); i++) {
+		count += buckets[i];
+		if(count >= target)
+			return 1ull << i;
+	}
+	return 1ull << buckets.size();
+}
+
+ResultRet<std::vector<Syscalls::Stats>> Syscalls::get_stats(Duck::InputStream& stream) {
+	stream.seek(0, Duck::SET);
+
+	// Each line is "name calls errors total_us" followed by the count in each bucket
+	std::vector<Stats> ret;
+	std::string line;
+	while(!stream.eof()) {
+		stream >> line;
+		if(line.empty() || line[0] == '#')
+			continue;
+
+		auto space = line.find(' ');
+		if(space == std::string::npos)
+			return Result::FAILURE;
+
+		Stats stats;
+		stats.name = line.substr(0, space);
+		char* cur = line.data() + space;
+		stats.calls = strtoul(cur, &cur, 10);
+		stats.errors = strtoul(cur, &cur, 10);
+		stats.total_us = strtoull(cur, &cur, 10);
+		while(*cur) {
+			char* end;
+			auto count = strtoul(cur, &end, 10);
+			if(end == cur)
+				break;
+			stats.buckets.push_back(count);
+			cur = end;
+		}
+		ret.push_back(stats);
+	}
+
+	return ret;
+}
+
+ResultRet<std::vector<Syscalls::Stats>> Syscalls::get_stats(pid_t pid) {
+	auto path = pid ? "/proc/" + std::to_string(pid) + "/syscalls" : std::string("/proc/syscalls");
+	auto file = Duck::File::open(path, "r");
+	if(file.is_error())
+		return file.result();
+
+	auto stream = Duck::FileInputStream(file.value());
+	return get_stats(stream);
+}
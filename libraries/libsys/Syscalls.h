@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <libduck/Result.h>
+#include <libduck/Stream.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+namespace Sys::Syscalls {
+	class Stats {
+	public:
+		std::string name;
+		uint32_t calls;
+		uint32_t errors;
+		uint64_t total_us;
+		/** Bucket n counts calls that took from 2^(n-1) up to 2^n microseconds, and the last one counts the rest. **/
+		std::vector<uint32_t> buckets;
+
+		[[nodiscard]] double average_us() const;
+		/** An upper bound on how long the given fraction of calls took, in microseconds. **/
+		[[nodiscard]] uint64_t percentile_us(double fraction) const;
+	};
+
+	Duck::ResultRet<std::vector<Stats>> get_stats(Duck::InputStream& stream);
+	/** Gets the system-wide stats, or the stats of one process if a pid is given. **/
+	Duck::ResultRet<std::vector<Stats>> get_stats(pid_t pid = 0);
+}
@@ -32,13 +32,15 @@
 using namespace Term;
 using namespace Keyboard;
 
-Terminal::Terminal(const Size& dimensions, Listener& listener):
+Terminal::Terminal(const Size& dimensions, Listener& listener, int max_scrollback):
 dimensions(dimensions),
 cursor_position({0,0}),
 current_attribute({TERM_DEFAULT_FOREGROUND, TERM_DEFAULT_BACKGROUND}),
+max_scrollback(max_scrollback),
 listener(listener)
 {
 	screen.resize(dimensions.lines);
+	dirty.resize(dimensions.lines);
 	for(int y = 0; y < dimensions.lines; y++)
 		screen[y].resize(dimensions.cols);
 }
@@ -47,13 +49,22 @@ void Terminal::set_dimensions(const Term::Size& new_size) {
 	if(new_size.lines <= 0 || new_size.cols <= 0)
 		return;
 
-	if(new_size.lines < dimensions.lines) {
-		for(int y = 0; y < new_size.lines; y++) {
-			screen[y] = screen[y + (dimensions.lines - new_size.lines)];
-		}
-	}
+	//Report anything pending first, since the positions won't mean the same thing afterwards
+	if(batch_depth)
+		flush_batch();
+
+	//Put the lines back in order from the top of the screen, keeping the bottom ones if there are fewer of them now
+	int drop_lines = dimensions.lines > new_size.lines ? dimensions.lines - new_size.lines : 0;
+	for(int y = 0; y < drop_lines; y++)
+		push_scrollback(screen_line(y));
+	Vector<Line> new_screen;
+	new_screen.resize(new_size.lines);
+	for(int y = 0; y < new_size.lines && y + drop_lines < dimensions.lines; y++)
+		_TERM_SWAP(new_screen[y], screen_line(y + drop_lines));
+	_TERM_SWAP(screen, new_screen);
+	screen_head = 0;
+	dirty.resize(new_size.lines);
 
-	screen.resize(new_size.lines);
 	for(int y = 0; y < new_size.lines; y++)
 		screen[y].resize(new_size.cols);
 
@@ -74,7 +85,8 @@ Term::Size Terminal::get_dimensions() {
 void Terminal::set_cursor(const Term::Position& position) {
 	auto old_pos = cursor_position;
 	cursor_position = position;
-	if(old_pos.col >= 0 && old_pos.col < dimensions.cols && old_pos.line >= 0 && old_pos.line < dimensions.lines)
+	//In a batch, the cursor is only drawn where it was when the batch started, which is redrawn when it ends anyway
+	if(!batch_depth && old_pos.col >= 0 && old_pos.col < dimensions.cols && old_pos.line >= 0 && old_pos.line < dimensions.lines)
 		listener.on_cursor_change(old_pos);
 }
 
@@ -159,12 +171,6 @@ void Terminal::emit_str(const char* str) {
 }
 
 void Terminal::write_char(char c_signed) {
-	static uint32_t utf8_buffer = 0;
-	static int utf8_index = 0;
-	static int utf8_char_length = 1;
-	static uint8_t utf8_remaining_bits = 0;
-	static uint8_t utf8_first_char_mask = 0;
-
 	char c = (unsigned char) c_signed;
 
 	if(utf8_index == 0) {
@@ -255,66 +261,209 @@ void Terminal::write_codepoint(uint32_t codepoint) {
 }
 
 void Terminal::write_chars(const char* buffer, size_t length) {
-	for(size_t i = 0; i < length; i++)
-		write_char(buffer[i]);
+	begin_batch();
+	size_t i = 0;
+	while(i < length) {
+		//Write runs of plain ASCII straight into the screen, and only go through write_char for everything else
+		if(!escape_mode && !utf8_index) {
+			size_t run = printable_run(buffer + i, length - i);
+			if(run) {
+				write_printable(buffer + i, run);
+				i += run;
+				continue;
+			}
+		}
+		write_char(buffer[i++]);
+	}
+	end_batch();
+}
+
+size_t Terminal::printable_run(const char* buffer, size_t length) {
+	//Check four bytes at a time for anything below a space or above a tilde, and then find which one it was
+	size_t i = 0;
+	for(; i + 4 <= length; i += 4) {
+		uint32_t word;
+		memcpy(&word, buffer + i, 4);
+		uint32_t below_space = (word - 0x20202020u) & ~word;
+		uint32_t above_tilde = (word + 0x01010101u) | word;
+		if((below_space | above_tilde) & 0x80808080u)
+			break;
+	}
+	for(; i < length; i++) {
+		auto c = (unsigned char) buffer[i];
+		if(c < ' ' || c > '~')
+			break;
+	}
+	return i;
+}
+
+void Terminal::write_printable(const char* buffer, size_t length) {
+	while(length) {
+		auto& line = screen_line(cursor_position.line);
+		int count = dimensions.cols - cursor_position.col;
+		if((size_t) count > length)
+			count = length;
+		for(int i = 0; i < count; i++)
+			line[cursor_position.col + i] = {(uint32_t) buffer[i], current_attribute};
+		if(count) {
+			mark_dirty(cursor_position);
+			mark_dirty({cursor_position.col + count - 1, cursor_position.line});
+		}
+		buffer += count;
+		length -= count;
+
+		//Wrap and scroll the same way write_codepoint does
+		Position new_cursor_pos = {cursor_position.col + count, cursor_position.line};
+		if(new_cursor_pos.col >= dimensions.cols) {
+			new_cursor_pos.line++;
+			new_cursor_pos.col = 0;
+		}
+		if(new_cursor_pos.line >= dimensions.lines) {
+			scroll(new_cursor_pos.line + 1 - dimensions.lines);
+			new_cursor_pos.line = dimensions.lines - 1;
+		}
+		set_cursor(new_cursor_pos);
+	}
 }
 
 void Terminal::write_codepoints(const uint32_t* buffer, size_t length) {
+	begin_batch();
 	for(size_t i = 0; i < length; i++)
 		write_codepoint(buffer[i]);
+	end_batch();
 }
 
 Term::Character Terminal::get_character(const Term::Position& pos) {
 	if(pos.col >= dimensions.cols || pos.col < 0 || pos.line >= dimensions.lines || pos.line < 0)
 		return {};
-	return screen[pos.line][pos.col];
+	return screen_line(pos.line)[pos.col];
 }
 
 void Terminal::set_character(const Position& pos, const Character& character) {
 	if(pos.col >= dimensions.cols || pos.col < 0 || pos.line >= dimensions.lines || pos.line < 0)
 		return;
-	screen[pos.line][pos.col] = character;
-	listener.on_character_change(pos, character);
+	screen_line(pos.line)[pos.col] = character;
+	if(batch_depth)
+		mark_dirty(pos);
+	else
+		listener.on_character_change(pos, character);
 }
 
 void Terminal::scroll(int lines) {
+	if(lines <= 0)
+		return;
 	if(lines >= dimensions.lines) {
+		for(int y = 0; y < dimensions.lines; y++)
+			push_scrollback(screen_line(y));
 		clear();
 		return;
 	}
 
-	int clear_start_line = dimensions.lines - lines;
+	//Instead of moving every line up, move the top of the screen down and reuse the lines that scrolled off of it
+	begin_batch();
+	for(int i = 0; i < lines; i++) {
+		auto& line = screen[screen_head];
+		push_scrollback(line);
+		line.clear(current_attribute);
+		dirty[screen_head] = {};
+		screen_head = (screen_head + 1) % dimensions.lines;
+	}
+
+	batch_scroll += lines;
+	end_batch();
+}
+
+void Terminal::begin_batch() {
+	//Wherever the cursor is drawn now will need to be redrawn, after being scrolled along with its line
+	if(!batch_depth++ && cursor_position.col >= 0 && cursor_position.col < dimensions.cols && cursor_position.line >= 0 && cursor_position.line < dimensions.lines)
+		mark_dirty(cursor_position);
+}
+
+void Terminal::end_batch() {
+	if(!batch_depth || --batch_depth)
+		return;
+	flush_batch();
+}
+
+void Terminal::flush_batch() {
+	if(batch_scroll >= dimensions.lines)
+		listener.on_clear();
+	else if(batch_scroll)
+		listener.on_scroll(batch_scroll);
+	batch_scroll = 0;
+
 	for(int y = 0; y < dimensions.lines; y++) {
-		for(int x = 0; x < dimensions.cols; x++) {
-			if(y >= clear_start_line) {
-				screen[y][x] = {0, current_attribute};
-			} else {
-				screen[y][x] = screen[y + lines][x];
-			}
-		}
+		auto& span = dirty[slot(y)];
+		auto& line = screen_line(y);
+		for(int x = span.start; x <= span.end; x++)
+			listener.on_character_change({x, y}, line[x]);
+		span = {};
 	}
+}
+
+int Terminal::scrollback_lines() {
+	return scrollback.size();
+}
 
-	listener.on_scroll(lines);
+Line& Terminal::get_scrollback_line(int index) {
+	return scrollback[(scrollback_head + index) % scrollback.size()];
 }
 
 void Terminal::clear() {
 	set_cursor({0,0});
-	for(int y = 0; y < dimensions.lines; y++) {
-		auto& line = screen[y];
-		for(int x = 0; x < dimensions.cols; x++) {
-			line[x] = {0, current_attribute};
-		}
-	}
+	for(int y = 0; y < dimensions.lines; y++)
+		screen[y].clear(current_attribute);
+
+	//Clearing redraws everything, so anything pending in a batch doesn't matter anymore
+	batch_scroll = 0;
+	for(int y = 0; y < dimensions.lines; y++)
+		dirty[y] = {};
 	listener.on_clear();
 }
 
 void Terminal::clear_line(int line) {
 	if(line < 0 || line >= dimensions.lines)
 		return;
-	auto& line_vec = screen[line];
-	for(int x = 0; x < dimensions.cols; x++)
-		line_vec[x] = {0, current_attribute};
-	listener.on_clear_line(line);
+	screen_line(line).clear(current_attribute);
+	if(batch_depth) {
+		mark_dirty({0, line});
+		mark_dirty({dimensions.cols - 1, line});
+	} else {
+		listener.on_clear_line(line);
+	}
+}
+
+int Terminal::slot(int line) {
+	return (screen_head + line) % dimensions.lines;
+}
+
+Line& Terminal::screen_line(int line) {
+	return screen[slot(line)];
+}
+
+void Terminal::mark_dirty(const Position& pos) {
+	auto& span = dirty[slot(pos.line)];
+	if(span.start > span.end) {
+		span = {pos.col, pos.col};
+	} else {
+		if(pos.col < span.start)
+			span.start = pos.col;
+		if(pos.col > span.end)
+			span.end = pos.col;
+	}
+}
+
+void Terminal::push_scrollback(Line& line) {
+	if(!max_scrollback)
+		return;
+	if((int) scrollback.size() < max_scrollback) {
+		scrollback.push_back(line);
+	} else {
+		//Swap the line with the oldest one so the caller can reuse its memory
+		_TERM_SWAP(scrollback[scrollback_head], line);
+		line.resize(dimensions.cols);
+		scrollback_head = (scrollback_head + 1) % max_scrollback;
+	}
 }
 
 void Terminal::set_current_attribute(const Attribute& attribute) {
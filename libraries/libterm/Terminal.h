@@ -28,7 +28,13 @@ namespace Term {
 	class Terminal {
 	public:
 		Terminal() = delete;
-		Terminal(const Size& dimensions, Listener& listener);
+		/**
+		 * Creates a terminal.
+		 * @param dimensions The size of the screen.
+		 * @param listener The listener to tell about changes to the screen.
+		 * @param max_scrollback The number of lines that scroll off the top of the screen to keep.
+		 */
+		Terminal(const Size& dimensions, Listener& listener, int max_scrollback = 0);
 
 		void set_dimensions(const Size& new_size);
 		Size get_dimensions();
@@ -46,6 +52,18 @@ namespace Term {
 		Character get_character(const Position& position);
 		void set_character(const Position& position, const Character& character);
 		void scroll(int lines);
+		/**
+		 * Starts a batch of changes. Until the batch ends, the listener isn't told about each change as it happens.
+		 * Instead, when it ends, it's told to scroll once by however many lines the batch scrolled (or to clear if that's
+		 * the whole screen), and then about each character that changed on the lines that are still on the screen.
+		 * Batches can be nested, in which case only the outermost one counts.
+		 */
+		void begin_batch();
+		void end_batch();
+		/// The number of lines that have scrolled off the top of the screen and are still kept.
+		int scrollback_lines();
+		/// Gets a line that scrolled off the top of the screen, where 0 is the oldest one still kept.
+		Line& get_scrollback_line(int index);
 		void clear();
 		void clear_line(int line);
 		void set_current_attribute(const Attribute& attribute);
@@ -61,12 +79,34 @@ namespace Term {
 			Beginning, Value
 		};
 
+		/// The columns of a line that changed during a batch, which are empty if start is past end.
+		struct DirtySpan {
+			int start = 1;
+			int end = 0;
+		};
+
+		int slot(int line);
+		Line& screen_line(int line);
+		void mark_dirty(const Position& position);
+		void push_scrollback(Line& line);
+		void flush_batch();
+		static size_t printable_run(const char* buffer, size_t length);
+		void write_printable(const char* buffer, size_t length);
+
 		Attribute current_attribute = {TERM_DEFAULT_FOREGROUND, TERM_DEFAULT_BACKGROUND};
 		Position cursor_position = {0, 0};
 		Size dimensions = {0, 0};
-		Vector<Line> screen;
+		Vector<Line> screen; ///< A ring of lines, where the top of the screen is at screen_head
+		int screen_head = 0;
+		Vector<Line> scrollback; ///< A ring of lines, where the oldest one is at scrollback_head once it's full
+		int scrollback_head = 0;
+		int max_scrollback;
 		Listener& listener;
 
+		int batch_depth = 0;
+		int batch_scroll = 0; ///< The number of lines scrolled in the current batch
+		Vector<DirtySpan> dirty; ///< What changed in the current batch, indexed the same way as screen
+
 		bool escape_mode = false;
 		EscapeStatus escape_status = Beginning;
 		char escape_parameters[10][10];
@@ -74,6 +114,11 @@ namespace Term {
 		size_t escape_parameter_index = 0;
 		size_t escape_parameter_char_index = 0;
 		uint32_t current_escape_codepoint = 0;
+
+		uint32_t utf8_buffer = 0;
+		int utf8_index = 0;
+		int utf8_char_length = 1;
+		uint8_t utf8_remaining_bits = 0;
 	};
 }
 
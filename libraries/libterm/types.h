@@ -22,11 +22,15 @@
 #ifdef DUCKOS_KERNEL
 #include <kernel/kstd/types.h>
 #include <kernel/kstd/vector.hpp>
+#include <kernel/kstd/utility.h>
 #define _TERM_VECTOR_TYPE kstd::vector
+#define _TERM_SWAP kstd::swap
 #else
 #include <cstddef>
 #include <vector>
+#include <utility>
 #define _TERM_VECTOR_TYPE std::vector
+#define _TERM_SWAP std::swap
 #endif
 
 #define TERM_COLOR_BLACK 0
@@ -3,6 +3,10 @@
 
 #include "LineEditor.h"
 #include <unistd.h>
+#include <cstring>
+#include <cstdio>
+
+#define LINE_EDITOR_INITIAL_SIZE 128
 
 using namespace TUI;
 
@@ -11,7 +15,9 @@ int main() {
 	while(true) {
 		printf("Type: ");
 		fflush(stdout);
-		printf("You typed: '%s'\n", editor.get_line().c_str());
+		auto line = editor.get_line();
+		printf("You typed: '%s'\n", line.c_str());
+		editor.add_history(line);
 	}
 }
 
@@ -19,6 +25,8 @@ LineEditor::LineEditor() {
 	// Get the termios and set it up, we want to turn off canonical mode and echoing
 	tcgetattr(STDIN_FILENO, &m_termios);
 	m_termios.c_lflag &= ~(ICANON | ECHO);
+	m_text.resize(LINE_EDITOR_INITIAL_SIZE);
+	m_output.reserve(LINE_EDITOR_INITIAL_SIZE);
 }
 
 std::string LineEditor::get_line() {
@@ -27,81 +35,218 @@ std::string LineEditor::get_line() {
 	tcgetattr(STDIN_FILENO, &old_termios);
 	tcsetattr(STDIN_FILENO, TCSANOW, &m_termios);
 
-	m_buffer.clear();
-	m_cursor = m_buffer.size();
+	// We write to stdout directly, so anything printed before this (like a prompt) needs to go out first
+	fflush(stdout);
+
+	reset_line();
+	m_recall_position = m_next_history;
 	m_state = REGULAR;
 
 	while(m_state != DONE) {
-		char ch = std::getchar();
+		int ch = std::getchar();
+		if(ch == EOF)
+			break;
 
 		switch(m_state) {
 			case REGULAR:
-				handle_regular_char(ch);
+				handle_regular_char((char) ch);
 				break;
 			case ESCAPE_START:
 				m_state = ch == '[' ? ESCAPE : REGULAR;
 				break;
 			case ESCAPE:
-				handle_escape_char(ch);
+				handle_escape_char((char) ch);
 				break;
 			case DONE:
 				break; // Shouldn't happen
 		}
 	}
 
-	printf("\n");
+	out("\n", 1);
+	flush();
 
 	// Restore our old termios
 	tcsetattr(STDIN_FILENO, TCSANOW, &old_termios);
 
-	return m_buffer;
+	return buffer();
+}
+
+std::string LineEditor::buffer() const {
+	std::string ret;
+	ret.reserve(length());
+	ret.append(m_text.data(), m_gap_start);
+	ret.append(suffix(), suffix_length());
+	return ret;
 }
 
 void LineEditor::set_line(const std::string& line) {
-	clear_line();
-	m_buffer = line;
-	reprint_line();
-	move_cursor(line.size());
+	// Find out how much of the line is staying the same, since we don't need to redraw that
+	size_t old_length = length();
+	size_t common = 0;
+	while(common < old_length && common < line.size()) {
+		char old_char = common < m_gap_start ? m_text[common] : m_text[common + m_gap_end - m_gap_start];
+		if(old_char != line[common])
+			break;
+		common++;
+	}
+
+	// Then replace everything after that and erase whatever's left of the old line
+	move_cursor((int) common - (int) m_gap_start);
+	m_gap_end = m_text.size();
+	for(size_t i = common; i < line.size(); i++)
+		insert_char(line[i]);
+	out(line.data() + common, line.size() - common);
+	if(old_length > line.size())
+		out("\033[K", 3);
+	flush();
+}
+
+void LineEditor::add_history(const std::string& line) {
+	if(line.empty())
+		return;
+	auto existing = m_history_index.find(line);
+	if(existing != m_history_index.end()) {
+		m_history.erase(existing->second);
+		existing->second = m_next_history;
+	} else {
+		m_history_index[line] = m_next_history;
+	}
+	m_history[m_next_history++] = line;
+	trim_history();
 }
 
-void LineEditor::clear_line() {
-	m_buffer = "";
-	reprint_line();
-	m_cursor = m_buffer.size();
+void LineEditor::set_history_limit(size_t limit) {
+	m_history_limit = limit;
+	trim_history();
 }
 
-void LineEditor::reprint_line() {
-	// Clear line
-	printf("\033[%dD", m_cursor);
-	printf("\033[K");
+void LineEditor::reset_line() {
+	m_gap_start = 0;
+	m_gap_end = m_text.size();
+}
 
-	// Reprint line
-	if(!m_buffer.empty())
-		printf("%s", m_buffer.c_str());
+void LineEditor::move_gap(size_t position) {
+	auto* text = m_text.data();
+	if(position < m_gap_start) {
+		size_t amount = m_gap_start - position;
+		memmove(text + m_gap_end - amount, text + position, amount);
+		m_gap_start -= amount;
+		m_gap_end -= amount;
+	} else if(position > m_gap_start) {
+		size_t amount = position - m_gap_start;
+		memmove(text + m_gap_start, text + m_gap_end, amount);
+		m_gap_start += amount;
+		m_gap_end += amount;
+	}
+}
 
-	// Move cursor back to where it was
-	if(m_buffer.size() - m_cursor)
-		printf("\033[%dD", m_buffer.size() - m_cursor);
+void LineEditor::insert_char(char ch) {
+	// If the gap is full, double the size of the buffer and move what's after the gap to the end
+	if(m_gap_start == m_gap_end) {
+		size_t old_size = m_text.size();
+		size_t after = old_size - m_gap_end;
+		m_text.resize(old_size * 2);
+		memmove(m_text.data() + m_text.size() - after, m_text.data() + m_gap_end, after);
+		m_gap_end = m_text.size() - after;
+	}
+	m_text[m_gap_start++] = ch;
+}
 
-	fflush(stdout);
+void LineEditor::erase_char() {
+	if(m_gap_start)
+		m_gap_start--;
 }
 
 void LineEditor::move_cursor(int amount) {
+	int position = (int) m_gap_start + amount;
+	if(position < 0)
+		position = 0;
+	else if(position > (int) length())
+		position = (int) length();
+	out_move(position - (int) m_gap_start);
+	move_gap(position);
+}
+
+void LineEditor::out(const char* str, size_t length) {
+	m_output.append(str, length);
+}
+
+void LineEditor::out_move(int amount) {
 	if(!amount)
 		return;
-	m_cursor += amount;
-	if(m_cursor < 0)
-		m_cursor = 0;
-	else if(m_cursor > m_buffer.size())
-		m_cursor = m_buffer.size();
-	else {
-		char control_char = 'C';
-		if(amount < 0) {
-			control_char = 'D';
-			amount *= -1;
+	char control_char = 'C';
+	if(amount < 0) {
+		control_char = 'D';
+		amount *= -1;
+	}
+	char escape[16];
+	int length = snprintf(escape, sizeof(escape), "\033[%d%c", amount, control_char);
+	out(escape, length);
+}
+
+void LineEditor::flush() {
+	size_t written = 0;
+	while(written < m_output.size()) {
+		ssize_t res = write(STDOUT_FILENO, m_output.data() + written, m_output.size() - written);
+		if(res <= 0)
+			break;
+		written += res;
+	}
+	m_output.clear();
+}
+
+void LineEditor::recall(bool older) {
+	if(m_recall_position == m_next_history)
+		m_recall_prefix = buffer();
+
+	// Find the closest line in the direction we're going that starts with what was typed
+	bool found = false;
+	uint64_t position = m_next_history;
+	if(m_recall_prefix.empty()) {
+		if(older) {
+			auto it = m_history.lower_bound(m_recall_position);
+			if(it != m_history.begin()) {
+				found = true;
+				position = (--it)->first;
+			}
+		} else {
+			auto it = m_history.upper_bound(m_recall_position);
+			if(it != m_history.end()) {
+				found = true;
+				position = it->first;
+			}
 		}
-		printf("\033[%d%c", amount, control_char);
-		fflush(stdout);
+	} else {
+		// The lines starting with the prefix are all next to each other in the index, so we only look at those
+		auto& prefix = m_recall_prefix;
+		for(auto it = m_history_index.lower_bound(prefix); it != m_history_index.end(); it++) {
+			if(it->first.compare(0, prefix.size(), prefix) != 0)
+				break;
+			auto candidate = it->second;
+			if(older ? (candidate < m_recall_position && (!found || candidate > position))
+					 : (candidate > m_recall_position && (!found || candidate < position)))
+			{
+				found = true;
+				position = candidate;
+			}
+		}
+	}
+
+	if(found) {
+		m_recall_position = position;
+		set_line(m_history[position]);
+	} else if(!older) {
+		// We went past the newest line, so go back to what was typed
+		m_recall_position = m_next_history;
+		set_line(m_recall_prefix);
+	}
+}
+
+void LineEditor::trim_history() {
+	while(m_history.size() > m_history_limit) {
+		auto oldest = m_history.begin();
+		m_history_index.erase(oldest->second);
+		m_history.erase(oldest);
 	}
 }
 
@@ -112,10 +257,16 @@ void LineEditor::handle_regular_char(char ch) {
 	}
 
 	if(ch == '\b' || ch == 0x7f) {
-		move_cursor(-1);
-		if(!m_buffer.empty())
-			m_buffer.erase(m_cursor);
-		reprint_line();
+		if(!m_gap_start)
+			return;
+		// Move back, then redraw whatever was after the deleted character and put the cursor back
+		erase_char();
+		m_recall_position = m_next_history;
+		out_move(-1);
+		out(suffix(), suffix_length());
+		out("\033[K", 3);
+		out_move(-(int) suffix_length());
+		flush();
 		return;
 	}
 
@@ -130,9 +281,15 @@ void LineEditor::handle_regular_char(char ch) {
 		return;
 	}
 
-	m_buffer.insert(m_buffer.begin() + m_cursor, ch);
-	move_cursor(1);
-	reprint_line();
+	// Draw the new character, and if we're in the middle of the line, redraw what comes after it too
+	insert_char(ch);
+	m_recall_position = m_next_history;
+	out(&ch, 1);
+	if(suffix_length()) {
+		out(suffix(), suffix_length());
+		out_move(-(int) suffix_length());
+	}
+	flush();
 }
 
 void LineEditor::handle_escape_char(char ch) {
@@ -141,20 +298,24 @@ void LineEditor::handle_escape_char(char ch) {
 			m_state = REGULAR;
 			if(up_pressed)
 				up_pressed();
+			else
+				recall(true);
 			break;
 		case 'B': // Down Arrow
 			m_state = REGULAR;
 			if(down_pressed)
 				down_pressed();
+			else
+				recall(false);
 			break;
 		case 'C': // Right arrow
-			if(m_cursor < m_buffer.size())
-				move_cursor(1);
+			move_cursor(1);
+			flush();
 			m_state = REGULAR;
 			break;
 		case 'D': // Left arrow
-			if(m_cursor >= 0)
-				move_cursor(-1);
+			move_cursor(-1);
+			flush();
 			m_state = REGULAR;
 			break;
 		default:
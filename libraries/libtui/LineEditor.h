@@ -6,7 +6,9 @@
 #include <termios.h>
 #include <string>
 #include <vector>
+#include <map>
 #include <functional>
+#include <cstdint>
 
 namespace TUI {
 	class LineEditor {
@@ -14,10 +16,20 @@ namespace TUI {
 		LineEditor();
 
 		std::string get_line();
-		std::string buffer() const { return m_buffer; }
+		std::string buffer() const;
 
 		void set_line(const std::string& line);
 
+		/**
+		 * Adds a line to the history, which can be recalled with the up and down arrows. If the line is already in the
+		 * history, it's moved to the end instead of being added again.
+		 */
+		void add_history(const std::string& line);
+
+		/// Sets the maximum number of lines kept in the history.
+		void set_history_limit(size_t limit);
+
+		/// If set, these are called instead of recalling a line from the history.
 		std::function<void(void)> up_pressed = nullptr;
 		std::function<void(void)> down_pressed = nullptr;
 		std::function<void(void)> tab_pressed = nullptr;
@@ -31,16 +43,41 @@ namespace TUI {
 			DONE
 		};
 
-		void clear_line();
-		void reprint_line();
+		// Editing. The line is kept in a gap buffer with the gap at the cursor, so typing and deleting don't move the
+		// rest of the line around and the part after the cursor can be written straight out of it.
+		size_t length() const { return m_text.size() - (m_gap_end - m_gap_start); }
+		size_t suffix_length() const { return m_text.size() - m_gap_end; }
+		const char* suffix() const { return m_text.data() + m_gap_end; }
+		void reset_line();
+		void move_gap(size_t position);
+		void insert_char(char ch);
+		void erase_char();
 		void move_cursor(int amount);
 
+		// Output. Escape codes and text are collected and written at once, only redrawing what actually changed.
+		void out(const char* str, size_t length);
+		void out_move(int amount);
+		void flush();
+
+		// History
+		void recall(bool older);
+		void trim_history();
+
 		void handle_regular_char(char ch);
 		void handle_escape_char(char ch);
 
-		std::string m_buffer;
-		int m_cursor;
+		std::vector<char> m_text;
+		size_t m_gap_start = 0; ///< Where the gap (and the cursor) is in m_text
+		size_t m_gap_end = 0; ///< Where the gap ends in m_text
+		std::string m_output;
 		State m_state;
+
+		std::map<uint64_t, std::string> m_history; ///< The lines in the history, by when they were added
+		std::map<std::string, uint64_t> m_history_index; ///< When each line in the history was added, sorted by line
+		uint64_t m_next_history = 0; ///< The number the next line added to the history will get
+		size_t m_history_limit = 100;
+		uint64_t m_recall_position = 0; ///< The number of the line being recalled, or m_next_history if there isn't one
+		std::string m_recall_prefix; ///< What was typed before recalling, which recalled lines have to start with
 	};
 
-}
\ No newline at end of file
+}
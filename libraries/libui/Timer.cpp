@@ -35,7 +35,8 @@ Timer::~Timer() {
 }
 
 void Timer::calculate_trigger_time() {
-	m_trigger_time = Duck::Time::now() + Duck::Time::millis(m_delay);
+	m_trigger_time = Duck::Time::monotonic() + Duck::Time::millis(m_delay);
+	UI::__schedule_timer(m_id, m_trigger_time);
 }
 
 [[nodiscard]] bool Timer::ready() const {
@@ -43,7 +44,7 @@ void Timer::calculate_trigger_time() {
 }
 
 [[nodiscard]] long Timer::millis_until_ready() const {
-	return (m_trigger_time - Duck::Time::now()).millis();
+	return (m_trigger_time - Duck::Time::monotonic()).millis();
 }
 
 void Timer::stop() {
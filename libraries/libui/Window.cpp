@@ -142,10 +142,22 @@ void Window::repaint() {
 	_needs_repaint = true;
 }
 
+void Window::repaint(Gfx::Rect area) {
+	//Anything outside of the contents is drawn with the frame, so it needs a full repaint
+	if(!area.inside(contents_rect()))
+		_needs_repaint = true;
+	else if(area.width > 0 && area.height > 0)
+		_dirty_region.add(area);
+}
+
 void Window::repaint_now() {
-	if(!_needs_repaint)
+	if(!_needs_repaint) {
+		if(!_dirty_region.empty())
+			repaint_dirty();
 		return;
+	}
 	_needs_repaint = false;
+	_dirty_region.clear();
 
 	//Next, draw the window frame
 	auto framebuffer = _window->framebuffer();
@@ -199,6 +211,31 @@ void Window::repaint_now() {
 	if(_titlebar_accessory)
 		blit_widget(_titlebar_accessory);
 	_window->invalidate();
+
+	//The buffer we draw into next still has the last frame in it, so all of it is out of date now
+	_stale_region = Gfx::Region({0, 0, framebuffer.width, framebuffer.height});
+}
+
+void Window::repaint_dirty() {
+	auto framebuffer = _window->framebuffer();
+	auto dirty = _dirty_region.intersected(Gfx::Region(contents_rect()));
+	_dirty_region.clear();
+	if(dirty.empty())
+		return;
+
+	//Catch the buffer up with the one being displayed, since it's a frame behind. Then we only need to draw what's dirty.
+	auto displayed = _window->displayed_framebuffer();
+	for(auto& rect : _stale_region.subtracted(dirty).rects())
+		framebuffer.copy_noalpha(displayed, rect, rect.position());
+
+	for(auto& rect : dirty.rects()) {
+		framebuffer.fill(rect, _decorated ? Theme::window() : RGBA(0, 0, 0, 0));
+		if(_contents)
+			blit_widget(_contents, rect);
+	}
+
+	_window->invalidate_area(dirty.bounds());
+	_stale_region = dirty;
 }
 
 void Window::close() {
@@ -419,6 +456,26 @@ void Window::blit_widget(Duck::PtrRef<Widget> widget) {
 		blit_widget(child);
 }
 
+void Window::blit_widget(Duck::PtrRef<Widget> widget, Gfx::Rect clip) {
+	if(widget->_hidden)
+		return;
+
+	Gfx::Point widget_pos = widget->_absolute_rect.position() + widget->_visible_rect.position();
+	Gfx::Rect area = clip.overlapping_area({widget_pos, widget->_visible_rect.dimensions()});
+	if(area.width <= 0 || area.height <= 0)
+		return;
+
+	widget->repaint_now();
+	Gfx::Rect src_area = area.transform(widget->_absolute_rect.position() * -1);
+	if(widget->_uses_alpha)
+		_window->framebuffer().copy_blitting(widget->_framebuffer, src_area, area.position());
+	else
+		_window->framebuffer().copy(widget->_framebuffer, src_area, area.position());
+
+	for(auto& child : widget->children)
+		blit_widget(child, clip);
+}
+
 void Window::open_menu(Duck::Ptr<Menu> menu) {
 	open_menu(menu, _mouse);
 }
@@ -55,6 +55,7 @@ namespace UI {
 		///Window management
 		void bring_to_front();
 		void repaint();
+		void repaint(Gfx::Rect area);
 		void repaint_now();
 		void close();
 		void show();
@@ -89,7 +90,9 @@ namespace UI {
 
 	private:
 		void initialize() override;
+		void repaint_dirty();
 		void blit_widget(Duck::PtrRef<Widget> widget);
+		void blit_widget(Duck::PtrRef<Widget> widget, Gfx::Rect clip);
 		void set_focused_widget(Duck::PtrRef<Widget> widget);
 
 		friend class Widget;
@@ -105,6 +108,8 @@ namespace UI {
 		bool _uses_alpha = false;
 		bool _resizable = false;
 		bool _needs_repaint = false;
+		Gfx::Region _dirty_region;
+		Gfx::Region _stale_region;
 		bool _focused = false;
 		bool _closed = false;
 		bool _center_on_show = true;
@@ -20,29 +20,111 @@
 #include "libui.h"
 #include "Theme.h"
 #include "UIException.h"
-#include <poll.h>
+#include <sys/epoll.h>
 #include <map>
 #include <utility>
 #include <libduck/Config.h>
+#include <libduck/Mutex.h>
+#include <libduck/EventLoop.h>
+#include <unistd.h>
 #include <climits>
+#include <queue>
+#include <deque>
+#include <algorithm>
+
+//Timers due within this many milliseconds of each other are fired in the same wakeup, instead of waking up for each
+#define TIMER_SLACK 2
 
 using namespace UI;
 
 Pond::Context* UI::pond_context = nullptr;
-std::vector<pollfd> pollfds;
-std::map<int, Poll> polls;
+int epoll_fd = -1;
+//Polls never move once added, and epoll gives us back their index, so events are dispatched without any lookups
+std::deque<Poll> polls;
+std::map<int, size_t> poll_indices;
 std::map<int, std::shared_ptr<Window>> windows;
 int cur_timeout = 0;
 std::map<int, Timer*> timers;
+
+//When each timer is next due, soonest first. Entries aren't removed when their timer is stopped, removed or
+//rescheduled; they're just skipped when they come up, since they no longer match their timer's trigger time.
+struct TimerDeadline {
+	Duck::Time time;
+	int id;
+	bool operator>(const TimerDeadline& other) const { return time > other.time; }
+};
+std::priority_queue<TimerDeadline, std::vector<TimerDeadline>, std::greater<>> timer_deadlines;
 int num_windows = 0;
 bool should_exit = false;
 App::Info _app_info;
 
+//Functions queued by run_on_main_thread(). A byte is written to the pipe to wake up the event loop when they start piling up.
+Duck::Mutex main_thread_lock;
+std::vector<std::function<void()>> main_thread_funcs;
+int main_thread_pipe[2] = {-1, -1};
+
 void handle_pond_events();
+void handle_main_thread_funcs();
+
+//Lets Duck::Task and anything else using Duck::EventLoop run on our event loop
+class UIEventLoop: public Duck::EventLoop {
+public:
+	void watch(int fd, bool write, std::function<void()> callback) override {
+		auto& watch = m_watches[fd];
+		(write ? watch.on_write : watch.on_read).push_back(std::move(callback));
+		update_poll(fd);
+	}
+
+	void call_later(long millis, std::function<void()> callback) override {
+		UI::set_timeout(std::move(callback), (int) millis);
+	}
+
+	void post(std::function<void()> callback) override {
+		UI::set_timeout(std::move(callback), 0);
+	}
+
+	void run_while(const std::function<bool()>& predicate) override {
+		UI::run_while(predicate);
+	}
+
+private:
+	struct Watch {
+		std::vector<std::function<void()>> on_read;
+		std::vector<std::function<void()>> on_write;
+	};
+
+	void update_poll(int fd) {
+		auto& watch = m_watches[fd];
+		if(watch.on_read.empty() && watch.on_write.empty()) {
+			m_watches.erase(fd);
+			UI::remove_poll(fd);
+			return;
+		}
+
+		Poll poll = {fd};
+		if(!watch.on_read.empty())
+			poll.on_ready_to_read = [this, fd] { fire(fd, false); };
+		if(!watch.on_write.empty())
+			poll.on_ready_to_write = [this, fd] { fire(fd, true); };
+		UI::add_poll(poll);
+	}
+
+	void fire(int fd, bool write) {
+		auto& watch = m_watches[fd];
+		auto callbacks = std::move(write ? watch.on_write : watch.on_read);
+		(write ? watch.on_write : watch.on_read).clear();
+		update_poll(fd);
+		for(auto& callback : callbacks)
+			callback();
+	}
+
+	std::map<int, Watch> m_watches;
+};
+UIEventLoop ui_event_loop;
 
 void UI::init(char** argv, char** envp) {
 	pond_context = Pond::Context::init();
-	pollfds.clear();
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
 
 	auto app_res = App::Info::from_current_app();
 	if(app_res.has_value()) {
@@ -54,6 +136,10 @@ void UI::init(char** argv, char** envp) {
 	pond_poll.on_ready_to_read = handle_pond_events;
 	add_poll(pond_poll);
 
+	if(pipe(main_thread_pipe) == 0)
+		add_poll({main_thread_pipe[0], handle_main_thread_funcs});
+	Duck::EventLoop::set_current(&ui_event_loop);
+
 	auto cfg_res = Duck::Config::read_from("/etc/libui.conf");
 	if(!cfg_res.is_error()) {
 		auto& cfg = cfg_res.value();
@@ -143,50 +229,50 @@ void handle_pond_events() {
 	}
 }
 
+static Timer* deadline_timer(const TimerDeadline& deadline) {
+	auto timer_it = timers.find(deadline.id);
+	if(timer_it == timers.end() || !timer_it->second->enabled() || !(timer_it->second->trigger_time() == deadline.time))
+		return nullptr;
+	return timer_it->second;
+}
+
 void UI::run_while(std::function<bool()> predicate) {
 	while (!should_exit && predicate()) {
-		//Trigger needed timers
-		long shortest_timeout = LONG_MAX;
-		bool have_timeout = false;
-		auto timer_it = timers.begin();
-		while(timer_it != timers.end()) {
-			auto* timer = timer_it->second;
+		//Take out the timers that are due. They're fired after, so ones that get rescheduled to go off right away don't
+		//keep us from getting to everything else.
+		auto fire_before = Duck::Time::monotonic() + Duck::Time::millis(TIMER_SLACK);
+		std::vector<int> due;
+		while(!timer_deadlines.empty() && timer_deadlines.top().time <= fire_before) {
+			if(deadline_timer(timer_deadlines.top()))
+				due.push_back(timer_deadlines.top().id);
+			timer_deadlines.pop();
+		}
 
-			//If the timer in question isn't enabled, skip it
-			if(!timer->enabled()) {
-				timer_it++;
+		for(auto id : due) {
+			//An earlier timer's callback might've removed this one
+			auto timer_it = timers.find(id);
+			if(timer_it == timers.end())
 				continue;
-			}
-
-			long millis = timer->millis_until_ready();
-
-			//First, check if the timer is ready to fire
-			if(millis <= 0) {
-				//Call the timer
+			auto* timer = timer_it->second;
+			if(timer->is_interval()) {
+				//Reschedule it first, so the callback can stop or restart it
+				timer->calculate_trigger_time();
 				timer->call()();
-				if(!timer->is_interval()) {
-					//Delete the timer if it's just a one-time timer (ie setTimeout)
-					timer_it = timers.erase(timer_it);
-					delete timer;
-					continue;
-				} else {
-					//Reschedule the timer if it's an interval
-					timers[timer_it->first]->calculate_trigger_time();
-					millis = timer_it->second->delay();
-				}
-			}
-
-			//Then, determine if this timer is the next one that will fire
-			if(millis > 0 && millis < shortest_timeout) {
-				shortest_timeout = millis;
-				have_timeout = true;
+			} else {
+				//Delete the timer if it's just a one-time timer (ie setTimeout)
+				timers.erase(timer_it);
+				timer->call()();
+				delete timer;
 			}
-
-			timer_it++;
 		}
 
-		//Update with a timeout of -1 (infinite), or until the next timer is ready to fire
-		update(have_timeout ? shortest_timeout : -1);
+		//Sleep until the next timer is due, or forever if there aren't any
+		while(!timer_deadlines.empty() && !deadline_timer(timer_deadlines.top()))
+			timer_deadlines.pop();
+		int timeout = -1;
+		if(!timer_deadlines.empty())
+			timeout = (int) std::clamp((timer_deadlines.top().time - Duck::Time::monotonic()).millis(), 0L, (long) INT_MAX);
+		update(timeout);
 	}
 }
 
@@ -202,15 +288,15 @@ void UI::update(int timeout) {
 	}
 
 	//Read and process events
-	poll(pollfds.data(), pollfds.size(), timeout);
-	for(auto& pollfd : pollfds) {
-		if(pollfd.revents) {
-			auto& poll = polls[pollfd.fd];
-			if(poll.on_ready_to_read && pollfd.revents & POLLIN)
-				poll.on_ready_to_read();
-			if(poll.on_ready_to_write && pollfd.revents & POLLOUT)
-				poll.on_ready_to_write();
-		}
+	epoll_event events[16];
+	int num_events = epoll_wait(epoll_fd, events, 16, timeout);
+	for(int i = 0; i < num_events; i++) {
+		//Copy the poll, since its callbacks may replace or remove it
+		auto poll = polls[events[i].data.u32];
+		if(poll.on_ready_to_read && events[i].events & EPOLLIN)
+			poll.on_ready_to_read();
+		if(poll.on_ready_to_write && events[i].events & EPOLLOUT)
+			poll.on_ready_to_write();
 	}
 }
 
@@ -233,6 +319,10 @@ void UI::remove_timer(int id) {
 	timers.erase(id);
 }
 
+void UI::__schedule_timer(int id, Duck::Time time) {
+	timer_deadlines.push({time, id});
+}
+
 bool UI::set_app_name(const std::string& app_name) {
 	auto app_res = App::Info::from_app_name(app_name);
 	if(!app_res.is_error()) {
@@ -249,13 +339,63 @@ App::Info& UI::app_info() {
 void UI::add_poll(const Poll& poll) {
 	if(!poll.on_ready_to_read && !poll.on_ready_to_write)
 		return;
-	pollfd pfd = {.fd = poll.fd, .events = 0, .revents = 0};
+	epoll_event event = {.events = 0, .data = {.u32 = 0}};
 	if(poll.on_ready_to_read)
-		pfd.events |= POLLIN;
+		event.events |= EPOLLIN;
 	if(poll.on_ready_to_write)
-		pfd.events |= POLLOUT;
-	polls[poll.fd] = poll;
-	pollfds.push_back(pfd);
+		event.events |= EPOLLOUT;
+
+	//Adding a poll for an fd that already has one replaces it
+	auto index_it = poll_indices.find(poll.fd);
+	if(index_it != poll_indices.end()) {
+		event.data.u32 = index_it->second;
+		polls[index_it->second] = poll;
+		epoll_ctl(epoll_fd, EPOLL_CTL_MOD, poll.fd, &event);
+		return;
+	}
+
+	event.data.u32 = polls.size();
+	poll_indices[poll.fd] = polls.size();
+	polls.push_back(poll);
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, poll.fd, &event);
+}
+
+void handle_main_thread_funcs() {
+	char buf[64];
+	read(main_thread_pipe[0], buf, sizeof(buf));
+
+	std::vector<std::function<void()>> funcs;
+	{
+		LOCK(main_thread_lock);
+		funcs.swap(main_thread_funcs);
+	}
+	for(auto& func : funcs)
+		func();
+}
+
+void UI::run_on_main_thread(std::function<void()> func) {
+	bool was_empty;
+	{
+		LOCK(main_thread_lock);
+		was_empty = main_thread_funcs.empty();
+		main_thread_funcs.push_back(std::move(func));
+	}
+
+	//The event loop takes everything that's queued at once, so it only needs waking up for the first one
+	if(was_empty) {
+		char c = 0;
+		write(main_thread_pipe[1], &c, 1);
+	}
+}
+
+void UI::remove_poll(int fd) {
+	auto index_it = poll_indices.find(fd);
+	if(index_it == poll_indices.end())
+		return;
+	//The poll stays where it is so the others' indices don't change, but it won't be called anymore
+	polls[index_it->second] = {-1};
+	poll_indices.erase(index_it);
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
 }
 
 Duck::Ptr<const Gfx::Image> UI::icon(Duck::Path path) {
@@ -29,6 +29,8 @@
 #include "Theme.h"
 #include "DrawContext.h"
 #include <libapp/App.h>
+#include <libduck/ThreadPool.h>
+#include <memory>
 
 namespace UI {
 	extern Pond::Context* pond_context;
@@ -42,11 +44,27 @@ namespace UI {
 	void set_timeout(std::function<void()> func, int interval);
 	Duck::Ptr<Timer> set_interval(std::function<void()> func, int interval);
 	void remove_timer(int id);
+	void __schedule_timer(int id, Duck::Time time);
 
 	bool set_app_name(const std::string& app_name);
 	App::Info& app_info();
 
 	void add_poll(const Poll& poll);
+	void remove_poll(int fd);
+
+	/** Queues a function to be called from the event loop. Can be called from any thread. **/
+	void run_on_main_thread(std::function<void()> func);
+
+	/** Runs a function on the global thread pool, and then calls on_done with its result from the event loop. **/
+	template<typename T>
+	void run_in_background(std::function<T()> work, std::function<void(T)> on_done) {
+		Duck::ThreadPool::global().submit([work = std::move(work), on_done = std::move(on_done)] {
+			auto result = std::make_shared<T>(work());
+			run_on_main_thread([on_done, result] {
+				on_done(std::move(*result));
+			});
+		});
+	}
 
 	Duck::Ptr<const Gfx::Image> icon(Duck::Path path);
 
@@ -19,6 +19,9 @@
 
 #include "ListView.h"
 
+//The number of rows past the edges of the view to keep entries for, so scrolling a bit doesn't need new ones
+#define UI_LISTVIEW_OVERSCAN 2
+
 using namespace UI;
 
 void ListView::calculate_layout() {
@@ -50,20 +53,14 @@ void ListView::update_item(int index) {
 		return;
 
 	//If it is, update it
-	if(_items[index]) {
-		remove_child(_items[index]);
-		_items.erase(index);
-	}
-
+	release_entry(index);
 	_items[index] = setup_entry(index);
+	_recycled.clear();
 }
 
 void ListView::update_data() {
-	for(auto& item_pair : _items) {
-		if(item_pair.second)
-			remove_child(item_pair.second);
-	}
-	_items.clear();
+	while(!_items.empty())
+		release_entry(_items.begin()->first);
 	do_update(false);
 	recalculate_scrollbar();
 }
@@ -82,8 +79,11 @@ void ListView::do_update(bool dimensions_changed) {
 	int first = scroll_position().y / _item_dims.height;
 	int last = (scroll_position().y + current_size().height) / _item_dims.height;
 
+	first -= UI_LISTVIEW_OVERSCAN;
+	last += UI_LISTVIEW_OVERSCAN;
+
 	if(_layout == GRID) {
-		_num_per_row = (current_size().width - 12) / _item_dims.width;
+		_num_per_row = std::max((current_size().width - 12) / _item_dims.width, 1);
 		first *= _num_per_row;
 		last = last * _num_per_row + _num_per_row - 1;
 	}
@@ -94,18 +94,11 @@ void ListView::do_update(bool dimensions_changed) {
 	if(last >= num)
 		last = num - 1;
 
-	//Remove old, unused items
-	for(int i = _prev_first_visible; i < first; i++) {
-		if(_items[i]) {
-			remove_child(_items[i]);
-			_items.erase(i);
-		}
-	}
-	for(int i = _prev_last_visible; i > last; i--) {
-		if(_items[i]) {
-			remove_child(_items[i]);
-			_items.erase(i);
-		}
+	//Set aside items that aren't in view anymore so they can be reused
+	for(auto it = _items.begin(); it != _items.end();) {
+		auto index = (it++)->first;
+		if(index < first || index > last)
+			release_entry(index);
 	}
 
 	_prev_first_visible = first;
@@ -114,25 +107,52 @@ void ListView::do_update(bool dimensions_changed) {
 	//Create new items and move items around
 	for(int i = first; i <= last; i++) {
 		auto rect = item_rect(i);
-		if(!_items[i])
+		auto item = _items.find(i);
+		if(item == _items.end() || !item->second)
 			_items[i] = setup_entry(i);
 		else if(dimensions_changed)
-			_items[i]->set_layout_bounds(rect);
+			item->second->set_layout_bounds(rect);
 		else
-			_items[i]->set_position_nolayout(rect.position());
+			item->second->set_position_nolayout(rect.position());
 	}
+
+	//Whatever didn't get reused isn't needed anymore
+	_recycled.clear();
 }
 
 Duck::Ptr<Widget> ListView::setup_entry(int index) {
 	if(delegate.expired())
 		return nullptr;
 	auto locked_delegate = this->delegate.lock();
-	auto widget = locked_delegate->lv_create_entry(index);
+
+	Duck::Ptr<Widget> widget = nullptr;
+	if(!_recycled.empty()) {
+		auto entry = _recycled.back();
+		_recycled.pop_back();
+		if(locked_delegate->lv_update_entry(index, entry))
+			widget = entry;
+	}
+	if(!widget)
+		widget = locked_delegate->lv_create_entry(index);
+	if(!widget)
+		return nullptr;
+
 	add_child(widget);
 	widget->set_layout_bounds(item_rect(index));
 	return widget;
 }
 
+void ListView::release_entry(int index) {
+	auto item = _items.find(index);
+	if(item == _items.end())
+		return;
+	if(item->second) {
+		remove_child(item->second);
+		_recycled.push_back(item->second);
+	}
+	_items.erase(item);
+}
+
 Gfx::Rect ListView::item_rect(int index) {
 	return {
 		Gfx::Point {(index % _num_per_row) * _item_dims.width, (index / _num_per_row) * _item_dims.height} - scroll_position(),
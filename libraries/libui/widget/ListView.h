@@ -25,6 +25,8 @@ namespace UI {
 	class ListViewDelegate {
 	public:
 		virtual Duck::Ptr<Widget> lv_create_entry(int index) = 0;
+		//Reuses an entry that's out of view for another index. If this returns false, a new one is made with lv_create_entry.
+		virtual bool lv_update_entry(int index, Duck::PtrRef<Widget> entry) { return false; }
 		virtual Gfx::Dimensions lv_preferred_item_dimensions() = 0;
 		virtual int lv_num_items() = 0;
 	};
@@ -57,9 +59,11 @@ namespace UI {
 
 		void do_update(bool dimensions_changed);
 		Duck::Ptr<Widget> setup_entry(int index);
+		void release_entry(int index);
 		Gfx::Rect item_rect(int index);
 
 		std::map<int, Duck::Ptr<Widget>> _items;
+		std::vector<Duck::Ptr<Widget>> _recycled;
 		int _prev_first_visible = 0;
 		int _prev_last_visible = 0;
 		Gfx::Dimensions _item_dims = {-1, -1};
@@ -149,6 +149,7 @@ bool ScrollView::on_mouse_button(Pond::MouseButtonEvent evt) {
 
 void ScrollView::on_layout_change(const Gfx::Rect& old_rect) {
 	recalculate_scrollbar();
+	repaint();
 }
 
 bool ScrollView::needs_layout_on_child_change() {
@@ -18,15 +18,47 @@ public:
 		ctx.fill(ctx.rect(), m_color);
 	}
 
+	void set_color(Gfx::Color color) {
+		m_color = color;
+		repaint();
+	}
+
+	Duck::PtrRef<Widget> widget() {
+		return m_widget;
+	}
+
+	void set_widget(Duck::Ptr<Widget> widget) {
+		remove_child(m_widget);
+		m_widget = std::move(widget);
+		m_widget->set_sizing_mode(UI::FILL);
+		add_child(m_widget);
+	}
+
 private:
-	TableViewCell(Gfx::Dimensions size, Gfx::Color color, Duck::Ptr<Widget> widget): m_preferred_size(size), m_color(color) {
+	TableViewCell(Gfx::Dimensions size, Gfx::Color color, Duck::Ptr<Widget> widget): m_preferred_size(size), m_color(color), m_widget(std::move(widget)) {
 		set_uses_alpha(true);
-		widget->set_sizing_mode(UI::FILL);
-		add_child(widget);
+		m_widget->set_sizing_mode(UI::FILL);
+		add_child(m_widget);
 	}
 
 	Gfx::Dimensions m_preferred_size;
 	Gfx::Color m_color;
+	Duck::Ptr<Widget> m_widget;
+};
+
+class TableViewRow: public BoxLayout {
+public:
+	WIDGET_DEF(TableViewRow)
+
+	void add_cell(Duck::Ptr<TableViewCell> cell) {
+		add_child(cell);
+		cells.push_back(std::move(cell));
+	}
+
+	std::vector<Duck::Ptr<TableViewCell>> cells;
+
+private:
+	TableViewRow(): BoxLayout(BoxLayout::HORIZONTAL) {}
 };
 
 TableView::TableView(int num_cols): m_num_cols(num_cols) {
@@ -56,14 +88,35 @@ Duck::Ptr<Widget> TableView::lv_create_entry(int index) {
 	if(m_delegate.expired())
 		return nullptr;
 	auto delegate = m_delegate.lock();
-	auto layout = BoxLayout::make(BoxLayout::HORIZONTAL);
+	auto row = TableViewRow::make();
 	auto widths = calculate_column_widths();
 
 	for(int i = 0; i < m_num_cols; i++) {
 		auto color = index % 2 == 0 ? Theme::shadow_1() : Theme::shadow_2();
-		layout->add_child(TableViewCell::make(Gfx::Dimensions{widths[i], m_row_height}, color, delegate->tv_create_entry(index, i)));
+		row->add_cell(TableViewCell::make(Gfx::Dimensions{widths[i], m_row_height}, color, delegate->tv_create_entry(index, i)));
+	}
+	return row;
+}
+
+bool TableView::lv_update_entry(int index, Duck::PtrRef<Widget> entry) {
+	if(m_delegate.expired())
+		return false;
+	auto delegate = m_delegate.lock();
+	auto row = std::static_pointer_cast<TableViewRow>(entry);
+
+	//Column widths change with the size of the table, so rows from before a resize can't be reused
+	auto widths = calculate_column_widths();
+	for(int i = 0; i < m_num_cols; i++)
+		if(row->cells[i]->preferred_size() != Gfx::Dimensions{widths[i], m_row_height})
+			return false;
+
+	for(int i = 0; i < m_num_cols; i++) {
+		auto& cell = row->cells[i];
+		cell->set_color(index % 2 == 0 ? Theme::shadow_1() : Theme::shadow_2());
+		if(!delegate->tv_update_entry(index, i, cell->widget()))
+			cell->set_widget(delegate->tv_create_entry(index, i));
 	}
-	return layout;
+	return true;
 }
 
 Gfx::Dimensions TableView::lv_preferred_item_dimensions() {
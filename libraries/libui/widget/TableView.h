@@ -11,6 +11,8 @@ namespace UI {
 	class TableViewDelegate {
 	public:
 		virtual Duck::Ptr<Widget> tv_create_entry(int row, int col) = 0;
+		//Reuses a cell's widget for another row. If this returns false, a new one is made with tv_create_entry.
+		virtual bool tv_update_entry(int row, int col, Duck::PtrRef<Widget> entry) { return false; }
 		virtual std::string tv_column_name(int col) = 0;
 		virtual int tv_num_entries() = 0;
 		virtual int tv_row_height() = 0;
@@ -29,6 +31,7 @@ namespace UI {
 	protected:
 		// ListViewDelegate
 		Duck::Ptr<Widget> lv_create_entry(int index) override;
+		bool lv_update_entry(int index, Duck::PtrRef<Widget> entry) override;
 		Gfx::Dimensions lv_preferred_item_dimensions() override;
 		int lv_num_items() override;
 
@@ -79,8 +79,16 @@ void Widget::set_sizing_mode(SizingMode mode) {
 
 void Widget::repaint() {
 	_dirty = true;	
-	if(_root_window)
-		_root_window->repaint();
+	if(_root_window && !_hidden)
+		_root_window->repaint({_absolute_rect.position() + _visible_rect.position(), _visible_rect.dimensions()});
+}
+
+void Widget::repaint(Gfx::Rect area) {
+	_dirty = true;
+	if(_root_window && !_hidden) {
+		auto visible = area.overlapping_area(_visible_rect);
+		_root_window->repaint({_absolute_rect.position() + visible.position(), visible.dimensions()});
+	}
 }
 
 void Widget::repaint_now() {
@@ -170,10 +178,14 @@ Gfx::Point Widget::position() {
 
 void Widget::hide() {
 	_hidden = true;
+	if(_root_window)
+		_root_window->repaint();
 }
 
 void Widget::show() {
 	_hidden = false;
+	if(_root_window)
+		_root_window->repaint();
 }
 
 void Widget::set_layout_bounds(Gfx::Rect new_bounds) {
@@ -186,12 +198,18 @@ void Widget::set_layout_bounds(Gfx::Rect new_bounds) {
 	Gfx::Rect old_rect = _rect;
 	_rect = new_bounds;
 	_initialized_size = true;
-	if(Gfx::Dimensions{_framebuffer.width, _framebuffer.height} != _rect.dimensions())
+	bool resized = Gfx::Dimensions{_framebuffer.width, _framebuffer.height} != _rect.dimensions();
+	if(resized)
 		_framebuffer = {new_bounds.width, new_bounds.height};
 	recalculate_rects();
 	calculate_layout();
 	on_layout_change(old_rect);
-	repaint();
+	//If the widget moved or changed size, whatever was under it before needs to be drawn again too
+	if(_root_window && (old_rect.position() != _rect.position() || old_rect.dimensions() != _rect.dimensions()))
+		_root_window->repaint();
+	//The framebuffer keeps what was drawn in it last, so it only needs to be drawn again if it's new or out of date
+	if(resized || !_first_layout_done || _dirty)
+		repaint();
 	if(!_first_layout_done) {
 		_first_layout_done = true;
 		repaint_now();
@@ -241,8 +259,23 @@ void Widget::remove_parent() {
 }
 
 void Widget::update_layout() {
-	//TODO: Find a better way of doing this that doesn't involve re-layouting everything everytime anything is updated
-	if(_root_window)
+	//Whatever changed probably changed how we look, too
+	repaint();
+	if(!_root_window)
+		return;
+
+	auto preferred = preferred_size();
+	auto minimum = minimum_size();
+	if(_first_layout_done && preferred == _layout_preferred_size && minimum == _layout_minimum_size) {
+		calculate_layout();
+		return;
+	}
+
+	_layout_preferred_size = preferred;
+	_layout_minimum_size = minimum;
+	if(_parent)
+		_parent->update_layout();
+	else
 		_root_window->calculate_layout();
 }
 
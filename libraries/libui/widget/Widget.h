@@ -101,6 +101,13 @@ namespace UI {
 		 */
 		void repaint();
 
+		/**
+		 * This function is called to schedule a repaint of the widget when only part of it has changed. The widget is
+		 * still fully redrawn with do_repaint, but only the given area is drawn to the window.
+		 * @param area The area of the widget that changed.
+		 */
+		void repaint(Gfx::Rect area);
+
 		/**
 		 * This function immediately repaints the contents of the widget if needed.
 		 */
@@ -250,6 +257,8 @@ namespace UI {
 
 		/**
 		 * Moves and resizes the widget according to the sizing mode, positioning mode, and parent's specifications.
+		 * If the widget's preferred and minimum sizes haven't changed since the last time, its parent would lay it out the
+		 * same way, so only the widget's own children are laid out again. Otherwise, this goes up to the parent.
 		 */
 		void update_layout();
 
@@ -338,6 +347,8 @@ namespace UI {
 		Gfx::Rect _absolute_rect = {0, 0, 0, 0};
 		Gfx::Rect _visible_rect = {0, 0, 0, 0};
 		Gfx::Point _absolute_position = {0, 0};
+		Gfx::Dimensions _layout_preferred_size = {-1, -1};
+		Gfx::Dimensions _layout_minimum_size = {-1, -1};
 		Gfx::Point _mouse_pos = {0, 0};
 		unsigned int _mouse_buttons = 0;
 		bool _initialized_size = false;
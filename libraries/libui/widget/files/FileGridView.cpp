@@ -2,6 +2,7 @@
 /* Copyright © 2016-2022 Byteduck */
 
 #include "FileGridView.h"
+#include "Thumbnails.h"
 #include "../Button.h"
 #include "../Image.h"
 #include "../../libui.h"
@@ -28,19 +29,24 @@ private:
 		Duck::Ptr<const Gfx::Image> image;
 		auto path = entry.path();
 
-		if(path.extension() == "icon" || path.extension() == "png")
-			image = Gfx::Image::load(entry.path()).value_or(nullptr);
-
-		if(!image) {
-			auto app = App::app_for_file(path);
-			if(app.has_value())
-				image = app.value().icon();
-			else
-				image = UI::icon(entry.is_directory() ? "/filetypes/folder" : "/filetypes/default");
-		}
+		//Show the file type's icon until the thumbnail (if there is one) is loaded
+		auto app = App::app_for_file(path);
+		if(app.has_value())
+			image = app.value().icon();
+		else
+			image = UI::icon(entry.is_directory() ? "/filetypes/folder" : "/filetypes/default");
 
 		auto ui_image = UI::Image::make(image);
-		ui_image->set_preferred_size({32, 32});
+		ui_image->set_preferred_size({Thumbnails::SIZE, Thumbnails::SIZE});
+
+		if(Thumbnails::has_thumbnail(entry)) {
+			Duck::WeakPtr<UI::Image> weak_image = ui_image;
+			Thumbnails::load(entry, [weak_image](Duck::Ptr<const Gfx::Image> thumbnail) {
+				auto ui_image = weak_image.lock();
+				if(thumbnail && ui_image)
+					ui_image->set_image(thumbnail);
+			});
+		}
 
 		add_child(Cell::make(ui_image));
 
@@ -0,0 +1,165 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Thumbnails.h"
+#include "../../libui.h"
+#include <libgraphics/PNG.h>
+#include <sys/thread.h>
+#include <unistd.h>
+#include <map>
+#include <optional>
+#include <tuple>
+
+using namespace UI;
+using Duck::Ptr;
+
+#define THUMBNAIL_MAGIC 0x424d4854 //"THMB"
+#define THUMBNAIL_READ_SIZE (16 * 1024)
+
+namespace {
+	using Key = std::tuple<ino_t, time_t, size_t>;
+
+	struct ThumbnailHeader {
+		uint32_t magic;
+		uint32_t width;
+		uint32_t height;
+		uint32_t premultiplied;
+	};
+
+	//Only touched from the event loop
+	std::map<Key, Ptr<const Gfx::Image>> s_thumbnails;
+	std::map<Key, std::vector<std::function<void(Ptr<const Gfx::Image>)>>> s_waiting;
+}
+
+static std::string cache_path(const Key& key) {
+	return std::string(Thumbnails::CACHE_DIR) + "/" + std::to_string(std::get<0>(key)) + "-" +
+		std::to_string(std::get<1>(key)) + "-" + std::to_string(std::get<2>(key));
+}
+
+static Gfx::Framebuffer* read_cached(const Key& key) {
+	FILE* file = fopen(cache_path(key).c_str(), "r");
+	if(!file)
+		return nullptr;
+	ThumbnailHeader header;
+	Gfx::Framebuffer* ret = nullptr;
+	if(fread(&header, sizeof(header), 1, file) == 1 && header.magic == THUMBNAIL_MAGIC &&
+		header.width && header.height && header.width <= Thumbnails::SIZE && header.height <= Thumbnails::SIZE)
+	{
+		ret = new Gfx::Framebuffer(header.width, header.height);
+		ret->premultiplied = header.premultiplied;
+		if(fread(ret->data, sizeof(Gfx::Color), header.width * header.height, file) != header.width * header.height) {
+			delete ret;
+			ret = nullptr;
+		}
+	}
+	fclose(file);
+	return ret;
+}
+
+static void write_cached(const Key& key, const Gfx::Framebuffer& framebuffer) {
+	//Write to a temporary file first, so nobody reads a thumbnail that's only partly written
+	auto path = cache_path(key);
+	auto temp_path = path + ".tmp" + std::to_string(getpid()) + "-" + std::to_string(gettid());
+	FILE* file = fopen(temp_path.c_str(), "w");
+	if(!file)
+		return;
+	ThumbnailHeader header = {THUMBNAIL_MAGIC, (uint32_t) framebuffer.width, (uint32_t) framebuffer.height, framebuffer.premultiplied};
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(framebuffer.data, sizeof(Gfx::Color), framebuffer.width * framebuffer.height, file) == (size_t) (framebuffer.width * framebuffer.height);
+	fclose(file);
+	if(!success || rename(temp_path.c_str(), path.c_str()))
+		unlink(temp_path.c_str());
+}
+
+//Picks the PNG in an icon that'll make the best thumbnail: the smallest one at least as big as a thumbnail, or the
+//biggest one if they're all smaller.
+static std::optional<Duck::Path> best_icon_png(const Duck::Path& icon) {
+	auto entries_res = icon.get_directory_entries();
+	if(entries_res.is_error())
+		return std::nullopt;
+	std::optional<Duck::Path> best;
+	int best_width = 0;
+	for(auto& entry : entries_res.value()) {
+		int width, height;
+		if(sscanf(entry.path().basename().c_str(), "%dx%d", &width, &height) != 2)
+			continue;
+		bool better = best_width < Thumbnails::SIZE ? width > best_width : (width >= Thumbnails::SIZE && width < best_width);
+		if(better) {
+			best = entry.path();
+			best_width = width;
+		}
+	}
+	return best;
+}
+
+static Gfx::Framebuffer* decode(const Duck::Path& path) {
+	FILE* file = fopen(path.string().c_str(), "r");
+	if(!file)
+		return nullptr;
+	Gfx::PNGDecoder decoder;
+	decoder.set_max_size({Thumbnails::SIZE, Thumbnails::SIZE});
+	uint8_t buffer[THUMBNAIL_READ_SIZE];
+	size_t nread;
+	while(!decoder.done() && (nread = fread(buffer, 1, sizeof(buffer), file))) {
+		if(!decoder.feed(buffer, nread))
+			break;
+	}
+	fclose(file);
+	return decoder.done() ? decoder.take_image() : nullptr;
+}
+
+//Runs on the thread pool, so several thumbnails can be made at once
+static Gfx::Framebuffer* make_thumbnail(const Key& key, const Duck::Path& path, bool is_icon) {
+	auto* framebuffer = read_cached(key);
+	if(!framebuffer) {
+		auto png = is_icon ? best_icon_png(path) : std::optional(path);
+		framebuffer = png ? decode(*png) : nullptr;
+		if(framebuffer)
+			write_cached(key, *framebuffer);
+	}
+	return framebuffer;
+}
+
+static void handle_result(const Key& key, Gfx::Framebuffer* framebuffer) {
+	Ptr<const Gfx::Image> image = framebuffer ? Gfx::Image::take(framebuffer) : nullptr;
+	s_thumbnails[key] = image;
+	auto callbacks = std::move(s_waiting[key]);
+	s_waiting.erase(key);
+	for(auto& callback : callbacks)
+		callback(image);
+}
+
+bool Thumbnails::has_thumbnail(const Duck::DirectoryEntry& entry) {
+	auto extension = entry.path().extension();
+	return extension == "png" || extension == "icon";
+}
+
+void Thumbnails::load(const Duck::DirectoryEntry& entry, std::function<void(Ptr<const Gfx::Image>)> callback) {
+	if(!has_thumbnail(entry)) {
+		callback(nullptr);
+		return;
+	}
+
+	Key key = {entry.inode(), entry.mtime(), entry.size()};
+	auto thumb_it = s_thumbnails.find(key);
+	if(thumb_it != s_thumbnails.end()) {
+		callback(thumb_it->second);
+		return;
+	}
+
+	//If it's already being loaded, just wait for that
+	auto waiting_it = s_waiting.find(key);
+	if(waiting_it != s_waiting.end()) {
+		waiting_it->second.push_back(std::move(callback));
+		return;
+	}
+
+	s_waiting[key].push_back(std::move(callback));
+	auto path = entry.path();
+	bool is_icon = path.extension() == "icon";
+	UI::run_in_background<Gfx::Framebuffer*>([key, path, is_icon] {
+		return make_thumbnail(key, path, is_icon);
+	}, [key](Gfx::Framebuffer* framebuffer) {
+		handle_result(key, framebuffer);
+	});
+}
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <libduck/DirectoryEntry.h>
+#include <libgraphics/Image.h>
+#include <functional>
+
+namespace UI::Thumbnails {
+	/// The largest a thumbnail can be in either dimension.
+	constexpr int SIZE = 32;
+	/// Where decoded thumbnails are kept between runs, named after the inode, modification time and size of their file.
+	constexpr const char* CACHE_DIR = "/var/cache/thumbnails";
+
+	/// Whether a thumbnail can be made for the given file (a PNG or an icon).
+	bool has_thumbnail(const Duck::DirectoryEntry& entry);
+
+	/**
+	 * Gets the thumbnail for a file. Thumbnails are decoded on the thread pool (or read from the cache on disk, if the
+	 * file hasn't changed since it was last decoded), so the callback is called later from the event loop. If the
+	 * thumbnail has already been loaded by this process, the callback is called right away.
+	 * @param entry The file to get the thumbnail of.
+	 * @param callback Called with the thumbnail, or nullptr if one couldn't be made.
+	 */
+	void load(const Duck::DirectoryEntry& entry, std::function<void(Duck::Ptr<const Gfx::Image>)> callback);
+}
@@ -18,164 +18,288 @@
 */
 
 #include "4inarow.h"
-#include <stdio.h>
+#include <libduck/Time.h>
 #include <algorithm>
 
-void reset_board(Board board) {
-	for(int i = 0; i < ROWS; i++) {
-		for(int j = 0; j < COLUMNS; j++) {
-			board[i][j] = 0;
-		}
-	}
+#define BOTTOM_ROW_MASK (bottom_row_mask())
+#define BOARD_MASK (BOTTOM_ROW_MASK * ((1ull << ROWS) - 1))
+#define CENTER_COLUMN_MASK (column_mask(COLUMNS / 2))
+//The score of a win on the first move. Wins that take more moves score one less for each move.
+#define WIN_SCORE 10000
+#define INFINITE_SCORE (WIN_SCORE + 1)
+
+static constexpr uint64_t bottom_row_mask() {
+	uint64_t mask = 0;
+	for(int col = 0; col < COLUMNS; col++)
+		mask |= 1ull << (col * COLUMN_HEIGHT);
+	return mask;
 }
 
-void print_board(Board board) {
-	for(int i = 0; i < ROWS; i++) {
-		for(int j = 0; j < COLUMNS; j++) {
-			auto& space = board[i][j];
-			printf("%c ", space == 0 ? ' ' : space == 1 ? 'X' : 'O');
-		}
-		printf("\n");
-	}
+static constexpr uint64_t bottom_mask(int col) {
+	return 1ull << (col * COLUMN_HEIGHT);
+}
 
-	for(int i = 0; i < COLUMNS; i++) {
-		printf("%d ", i + 1);
-	}
-	printf("\n");
-}
-
-bool is_valid_move(Board board, int move) {
-	return move >= 0 && move < COLUMNS && board[0][move] == 0;
-}
-
-int player_pick_move(Board board, int player) {
-	int move;
-	do {
-		printf("Player %d pick a move: ", player);
-		fflush(stdout);
-		scanf("%d", &move);
-		move--;
-	} while(!is_valid_move(board, move));
-	return move;
-}
-
-MoveScore score_move(Board board, int move, int player, int cur_player, int depth) {
-	MoveScore ret {0, 0, 0};
-	if(is_valid_move(board, move)) {
-		ret.num_moves++;
-		Board new_board;
-		std::copy(&board[0][0], &board[0][0]+ROWS*COLUMNS,&new_board[0][0]);
-		add_piece(new_board, move, cur_player);
-		if(check_win(new_board)) {
-			if(cur_player == player)
-				ret.num_win++;
-			else
-				ret.num_lose++;
-		} else {
-			if(depth < MAX_DEPTH) {
-				for(int i = 0; i < COLUMNS; i++) {
-					if(is_valid_move(board, i)) {
-						auto prob = score_move(new_board, i, player, cur_player == 1 ? 2 : 1, depth + 1);
-						ret.num_win += prob.num_win;
-						ret.num_lose += prob.num_lose;
-						ret.num_moves += prob.num_moves;
-					}
-				}
-			}
-		}
-	}
-	return ret;
-}
-
-int computer_pick_move(Board board, int player) {
-	int best_move = 0;
-	double best_prob = -1.0;
-	for(int i = 0; i < COLUMNS; i++) {
-		MoveScore prob = score_move(board, i, player, player, 0);
-		double p = ((double) prob.num_win / prob.num_moves) - ((double) prob.num_lose / prob.num_moves);
-		if(p > best_prob) {
-			best_move = i;
-			best_prob = p;
-		}
+static constexpr uint64_t top_mask(int col) {
+	return 1ull << (ROWS - 1 + col * COLUMN_HEIGHT);
+}
+
+static constexpr uint64_t column_mask(int col) {
+	return ((1ull << ROWS) - 1) << (col * COLUMN_HEIGHT);
+}
+
+/**
+ * The empty cells that would make four in a row for a bitmask of pieces, whether or not they can be played yet.
+ */
+static uint64_t winning_cells(uint64_t pieces, uint64_t mask) {
+	//Vertical
+	uint64_t cells = (pieces << 1) & (pieces << 2) & (pieces << 3);
+
+	//Horizontal, then both diagonals
+	for(int shift : {COLUMN_HEIGHT, COLUMN_HEIGHT - 1, COLUMN_HEIGHT + 1}) {
+		uint64_t pair = (pieces << shift) & (pieces << (2 * shift));
+		cells |= pair & (pieces << (3 * shift));
+		cells |= pair & (pieces >> shift);
+		pair = (pieces >> shift) & (pieces >> (2 * shift));
+		cells |= pair & (pieces << shift);
+		cells |= pair & (pieces >> (3 * shift));
 	}
-	return best_move;
+
+	return cells & (BOARD_MASK ^ mask);
 }
 
-bool add_piece(Board board, int move, int player) {
-	if(!is_valid_move(board, move))
+/**
+ * The cells that can be played in next, one per column that isn't full.
+ */
+static uint64_t playable_cells(uint64_t mask) {
+	return (mask + BOTTOM_ROW_MASK) & BOARD_MASK;
+}
+
+/**
+ * Guesses how good a position is for the player moving, by the number of cells each player could win with and how
+ * many pieces they have in the center column.
+ */
+static int evaluate(uint64_t current, uint64_t mask) {
+	uint64_t opponent = current ^ mask;
+	int threats = __builtin_popcountll(winning_cells(current, mask)) - __builtin_popcountll(winning_cells(opponent, mask));
+	int center = __builtin_popcountll(current & CENTER_COLUMN_MASK) - __builtin_popcountll(opponent & CENTER_COLUMN_MASK);
+	return threats * 4 + center;
+}
+
+/**
+ * The n-th column to try when searching, starting from the center since those moves are usually best.
+ */
+static int move_order(int n) {
+	return COLUMNS / 2 + (n % 2 ? -1 : 1) * ((n + 1) / 2);
+}
+
+/*
+ * Board
+ */
+
+void Board::reset() {
+	m_pieces[0] = 0;
+	m_pieces[1] = 0;
+	m_mask = 0;
+	m_moves = 0;
+}
+
+int Board::at(int row, int col) const {
+	uint64_t cell = 1ull << (col * COLUMN_HEIGHT + ROWS - 1 - row);
+	if(m_pieces[0] & cell)
+		return 1;
+	if(m_pieces[1] & cell)
+		return 2;
+	return 0;
+}
+
+int Board::landing_row(int col) const {
+	if(col < 0 || col >= COLUMNS || (m_mask & top_mask(col)))
+		return -1;
+	return ROWS - 1 - __builtin_popcountll(m_mask & column_mask(col));
+}
+
+bool Board::can_play(int col) const {
+	return landing_row(col) != -1;
+}
+
+bool Board::play(int col, int player) {
+	if(!can_play(col))
 		return false;
+	uint64_t cell = (m_mask + bottom_mask(col)) & column_mask(col);
+	m_pieces[player - 1] |= cell;
+	m_mask |= cell;
+	m_moves++;
+	return true;
+}
+
+bool Board::has_win() const {
+	return has_four(m_pieces[0]) || has_four(m_pieces[1]);
+}
 
-	for(int i = ROWS - 1; i >= 0; i--) {
-		if(board[i][move] == 0) {
-			board[i][move] = player;
+bool Board::has_four(uint64_t pieces) {
+	for(int shift : {1, COLUMN_HEIGHT, COLUMN_HEIGHT - 1, COLUMN_HEIGHT + 1}) {
+		uint64_t pairs = pieces & (pieces >> shift);
+		if(pairs & (pairs >> (2 * shift)))
 			return true;
-		}
 	}
-
 	return false;
 }
 
-bool check_win(Board board) {
-	for(int i = 0; i < ROWS; i++) {
-		for(int j = 0; j < COLUMNS; j++) {
-			int firstpiece = board[i][j];
-			bool not_win = false;
+/*
+ * Engine
+ */
 
-			if(firstpiece == 0)
-				continue;
+Engine::Engine():
+	m_table(TRANSPOSITION_TABLE_SIZE, Entry {0, 0, 0, -1, EMPTY})
+{}
 
-			//Check vertical
-			if(i >= INAROW - 1) {
-				for(int row = 0; row < INAROW; row++) {
-					if(board[i - row][j] != firstpiece) {
-						not_win = true;
-						break;
-					}
-				}
-				if(!not_win)
-					return true;
-			}
+Engine::Result Engine::search(const Board& board, int player, int max_depth, uint64_t time_limit_ms) {
+	Result result;
+	uint64_t start = Duck::Time::monotonic_nanos();
+	m_nodes = 0;
+	m_aborted = false;
+	m_deadline = time_limit_ms ? start + time_limit_ms * 1000000 : 0;
 
-			//Check horizontal
-			if(j <= COLUMNS - INAROW) {
-				not_win = false;
-				for(int col = 0; col < INAROW; col++) {
-					if(board[i][j + col] != firstpiece) {
-						not_win = true;
-						break;
-					}
-				}
-				if(!not_win)
-					return true;
-			}
+	uint64_t current = board.pieces(player);
+	uint64_t mask = board.mask();
+	uint64_t playable = playable_cells(mask);
+	uint64_t wins = winning_cells(current, mask) & playable;
+	max_depth = std::min(max_depth, ROWS * COLUMNS - board.num_moves());
 
-			//Check diagonal up & to right
-			if(i >= INAROW - 1 && j <= COLUMNS - INAROW) {
-				not_win = false;
-				for(int space = 0; space < INAROW; space++) {
-					if(board[i - space][j + space] != firstpiece) {
-						not_win = true;
-						break;
-					}
-				}
-				if(!not_win)
-					return true;
-			}
+	//Fall back to the first move in order, in case we run out of time before the first search finishes
+	for(int i = 0; i < COLUMNS && result.move == -1; i++) {
+		int col = move_order(i);
+		if((wins ? wins : playable) & column_mask(col))
+			result.move = col;
+	}
+
+	if(wins) {
+		result.score = WIN_SCORE - (board.num_moves() + 1);
+		result.depth = 1;
+		max_depth = 0;
+	}
 
-			//Check diagonal down & to right
-			if(i <= ROWS - INAROW && j <= COLUMNS - INAROW) {
-				not_win = false;
-				for(int space = 0; space < INAROW; space++) {
-					if(board[i + space][j + space] != firstpiece) {
-						not_win = true;
-						break;
-					}
-				}
-				if(!not_win)
-					return true;
+	//Search one move deeper each time, starting with the best move from the last search
+	for(int depth = 1; depth <= max_depth; depth++) {
+		int alpha = -INFINITE_SCORE;
+		int best_move = -1;
+		for(int i = -1; i < COLUMNS; i++) {
+			int col = i < 0 ? result.move : move_order(i);
+			if((i >= 0 && col == result.move) || !(playable & column_mask(col)))
+				continue;
+			int score = -negamax(current ^ mask, mask | (mask + bottom_mask(col)), depth - 1, -INFINITE_SCORE, -alpha);
+			if(m_aborted)
+				break;
+			if(score > alpha) {
+				alpha = score;
+				best_move = col;
 			}
 		}
+
+		if(m_aborted)
+			break;
+		result.move = best_move;
+		result.score = alpha;
+		result.depth = depth;
+
+		//Stop once one of the players is sure to win
+		if(alpha >= WIN_SCORE - ROWS * COLUMNS || alpha <= -(WIN_SCORE - ROWS * COLUMNS))
+			break;
 	}
 
-	return false;
-}
\ No newline at end of file
+	result.nodes = m_nodes;
+	result.nanos = Duck::Time::monotonic_nanos() - start;
+	return result;
+}
+
+void Engine::clear() {
+	for(auto& slot : m_table)
+		slot.bound = EMPTY;
+}
+
+int Engine::negamax(uint64_t current, uint64_t mask, int depth, int alpha, int beta) {
+	//Only check the time every so often, since it's a syscall
+	if(m_deadline && !(m_nodes & 0xfff) && Duck::Time::monotonic_nanos() > m_deadline)
+		m_aborted = true;
+	if(m_aborted)
+		return 0;
+	m_nodes++;
+
+	int moves = __builtin_popcountll(mask);
+	if(moves == ROWS * COLUMNS)
+		return 0;
+
+	uint64_t playable = playable_cells(mask);
+	if(winning_cells(current, mask) & playable)
+		return WIN_SCORE - (moves + 1);
+
+	//If the opponent could win next move we have to block them, and we lose if there's more than one place to block
+	uint64_t opponent_wins = winning_cells(current ^ mask, mask);
+	uint64_t forced = playable & opponent_wins;
+	if(forced) {
+		if(forced & (forced - 1))
+			return -(WIN_SCORE - (moves + 2));
+		playable = forced;
+	}
+	//Playing right under a cell the opponent could win with lets them win there
+	playable &= ~(opponent_wins >> 1);
+	if(!playable)
+		return -(WIN_SCORE - (moves + 2));
+
+	if(depth <= 0)
+		return evaluate(current, mask);
+
+	//The pieces plus the mask is unique for each position, since it sets the bit above the top piece in each column
+	uint64_t key = current + mask;
+	auto& slot = entry(key);
+	int table_move = -1;
+	if(slot.bound != EMPTY && slot.key == key) {
+		table_move = slot.move;
+		if(slot.depth >= depth) {
+			if(slot.bound == EXACT)
+				return slot.score;
+			if(slot.bound == LOWER)
+				alpha = std::max(alpha, (int) slot.score);
+			else
+				beta = std::min(beta, (int) slot.score);
+			if(alpha >= beta)
+				return slot.score;
+		}
+	}
+
+	int original_alpha = alpha;
+	int best_score = -INFINITE_SCORE;
+	int best_move = -1;
+	for(int i = -1; i < COLUMNS; i++) {
+		int col = i < 0 ? table_move : move_order(i);
+		if(col < 0 || (i >= 0 && col == table_move) || !(playable & column_mask(col)))
+			continue;
+		int score = -negamax(current ^ mask, mask | (mask + bottom_mask(col)), depth - 1, -beta, -alpha);
+		if(m_aborted)
+			return 0;
+		if(score > best_score) {
+			best_score = score;
+			best_move = col;
+		}
+		alpha = std::max(alpha, score);
+		if(alpha >= beta)
+			break;
+	}
+
+	Bound bound = EXACT;
+	if(best_score <= original_alpha)
+		bound = UPPER;
+	else if(best_score >= beta)
+		bound = LOWER;
+	slot = {key, (int16_t) best_score, (int8_t) depth, (int8_t) best_move, bound};
+	return best_score;
+}
+
+Engine::Entry& Engine::entry(uint64_t key) {
+	return m_table[((key * 0x9E3779B97F4A7C15ull) >> 32) & (TRANSPOSITION_TABLE_SIZE - 1)];
+}
+
+int computer_pick_move(const Board& board, int player) {
+	static Engine engine;
+	return engine.search(board, player, ROWS * COLUMNS, THINK_TIME_MS).move;
+}
@@ -19,25 +19,99 @@
 
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #define ROWS 6
 #define COLUMNS 7
-#define INAROW 4
-#define MAX_DEPTH 5
-
-struct MoveScore {
-	int num_moves = 0;
-	int num_win = 0;
-	int num_lose = 0;
-} __attribute__((aligned(16)));
-
-typedef int Board[ROWS][COLUMNS];
-
-void reset_board(Board board);
-void print_board(Board board);
-bool is_valid_move(Board board, int move);
-int player_pick_move(Board board, int player);
-MoveScore score_move(Board board, int move, int player, int cur_player, int depth);
-int computer_pick_move(Board board, int player);
-bool add_piece(Board board, int move, int player);
-bool check_win(Board board);
+//Each column gets an extra bit on top, so that pieces in one column can't run over into the next when shifted
+#define COLUMN_HEIGHT (ROWS + 1)
+//How many positions the engine remembers. Must be a power of two.
+#define TRANSPOSITION_TABLE_SIZE (1 << 18)
+//How long the computer thinks about each move, in milliseconds
+#define THINK_TIME_MS 500
+
+/**
+ * A board, stored as one bitmask of pieces for each player. Each column takes up COLUMN_HEIGHT bits going up from the
+ * bottom of the board, so that the pieces next to each other in any direction are a fixed shift apart.
+ */
+class Board {
+public:
+	Board() = default;
+
+	void reset();
+	/** The player with a piece at a cell (with row 0 at the top), or 0 if it's empty. **/
+	int at(int row, int col) const;
+	/** The row a piece dropped in a column would land in, or -1 if the column is full. **/
+	int landing_row(int col) const;
+	bool can_play(int col) const;
+	/** Drops a piece for a player in a column. Returns false if it can't go there. **/
+	bool play(int col, int player);
+	/** Whether either player has four in a row. **/
+	bool has_win() const;
+	bool is_full() const { return m_moves == ROWS * COLUMNS; }
+	int num_moves() const { return m_moves; }
+
+	/** The pieces belonging to a player. **/
+	uint64_t pieces(int player) const { return m_pieces[player - 1]; }
+	/** Every piece on the board. **/
+	uint64_t mask() const { return m_mask; }
+
+	/** Whether there are four in a row in a bitmask of pieces. **/
+	static bool has_four(uint64_t pieces);
+
+private:
+	uint64_t m_pieces[2] = {0, 0};
+	uint64_t m_mask = 0;
+	int m_moves = 0;
+};
+
+/**
+ * Picks moves with an iterative-deepening alpha-beta search. Positions it's seen are kept in a transposition table
+ * between searches, and the best move found for a position is tried first the next time it's searched.
+ */
+class Engine {
+public:
+	struct Result {
+		int move = -1;
+		int score = 0; ///Positive if the player moving is winning.
+		int depth = 0; ///The deepest search that finished.
+		uint64_t nodes = 0;
+		uint64_t nanos = 0;
+		uint64_t nodes_per_second() const { return nanos ? nodes * 1000000000 / nanos : 0; }
+	};
+
+	Engine();
+
+	/**
+	 * Searches for the best move for a player, going one move deeper each time until it runs out of time.
+	 * @param max_depth The deepest the search will go.
+	 * @param time_limit_ms How long to search for, or 0 to always search to max_depth.
+	 */
+	Result search(const Board& board, int player, int max_depth, uint64_t time_limit_ms);
+
+	/** Forgets every position in the transposition table. **/
+	void clear();
+
+private:
+	enum Bound : uint8_t { EMPTY, EXACT, LOWER, UPPER };
+
+	struct Entry {
+		uint64_t key;
+		int16_t score;
+		int8_t depth;
+		int8_t move;
+		Bound bound;
+	};
+
+	int negamax(uint64_t current, uint64_t mask, int depth, int alpha, int beta);
+	Entry& entry(uint64_t key);
+
+	std::vector<Entry> m_table;
+	uint64_t m_nodes = 0;
+	uint64_t m_deadline = 0;
+	bool m_aborted = false;
+};
 
+/** Picks a move for a player, spending up to THINK_TIME_MS on it. **/
+int computer_pick_move(const Board& board, int player);
@@ -21,12 +21,10 @@
 #include <libgraphics/Font.h>
 #include <libui/libui.h>
 
-GameWidget::GameWidget() {
-	reset_board(board);
-}
+GameWidget::GameWidget() = default;
 
 void GameWidget::reset(bool vs_cpu) {
-	reset_board(board);
+	board.reset();
 	was_win = false;
 	current_player = 1;
 	status = "Player 1 choose";
@@ -37,14 +35,7 @@ void GameWidget::reset(bool vs_cpu) {
 
 void GameWidget::show_hint() {
 	int col = computer_pick_move(board, current_player);
-	int row = ROWS;
-	for(int i = ROWS - 1; i >= 0; i--) {
-		if(board[i][col] == 0) {
-			row = i;
-			break;
-		}
-	}
-	hint_cell = {col, row};
+	hint_cell = {col, board.landing_row(col)};
 	repaint();
 }
 
@@ -61,7 +52,7 @@ void GameWidget::do_repaint(const UI::DrawContext& ctx) {
 			if(!was_win && (hovered_cell == Gfx::Point {col, row} || hint_cell == Gfx::Point {col, row})) {
 				color = current_player == 1 ? HOVER1_COLOR : HOVER2_COLOR;
 			} else {
-				switch(board[row][col]) {
+				switch(board.at(row, col)) {
 					case 0:
 						color = EMPTY_COLOR;
 						break;
@@ -84,14 +75,7 @@ void GameWidget::do_repaint(const UI::DrawContext& ctx) {
 bool GameWidget::on_mouse_move(Pond::MouseMoveEvent evt) {
 	int new_hovered_cell = evt.new_pos.x / CELL_SIZE;
 	if(new_hovered_cell != hovered_cell.x) {
-		int row = ROWS;
-		for(int i = ROWS - 1; i >= 0; i--) {
-			if(board[i][new_hovered_cell] == 0) {
-				row = i;
-				break;
-			}
-		}
-		hovered_cell = {new_hovered_cell, row};
+		hovered_cell = {new_hovered_cell, board.landing_row(new_hovered_cell)};
 		repaint();
 	}
 	return true;
@@ -99,20 +83,20 @@ bool GameWidget::on_mouse_move(Pond::MouseMoveEvent evt) {
 
 bool GameWidget::on_mouse_button(Pond::MouseButtonEvent evt) {
 	if((evt.new_buttons & POND_MOUSE1) && !(evt.old_buttons & POND_MOUSE1)) {
-		if(!was_win && is_valid_move(board, hovered_cell.x)) {
-			add_piece(board, hovered_cell.x, current_player);
+		if(!was_win && board.can_play(hovered_cell.x)) {
+			board.play(hovered_cell.x, current_player);
 			hovered_cell = {-1, -1};
 			hint_cell = {-1, -1};
 
 			std::string player_text = current_player == 1 ? "1" : "2";
 
-			if(check_win(board)) {
+			if(board.has_win()) {
 				status = "Player " + player_text + " wins!";
 				was_win = true;
 			} else {
 				if(player2_computer) {
-					add_piece(board, computer_pick_move(board, 2), 2);
-					if(check_win(board)) {
+					board.play(computer_pick_move(board, 2), 2);
+					if(board.has_win()) {
 						status = "Computer wins!";
 						was_win = true;
 					}
@@ -23,8 +23,59 @@
 #include <libui/widget/Button.h>
 #include <libui/widget/Checkbox.h>
 #include <libui/widget/Cell.h>
+#include <libduck/Args.h>
+#include <libduck/ThreadPool.h>
+#include <libduck/Time.h>
+#include <cstdio>
+
+//How deep the benchmark searches from an empty board
+#define BENCH_DEPTH 18
+
+/**
+ * Searches from an empty board to a fixed depth on each of a number of threads at once, each with its own engine, and
+ * prints how fast each one and all of them together went. Returns the exit code.
+ */
+static int run_benchmark(int depth, int jobs) {
+	if(jobs <= 0)
+		jobs = Duck::ThreadPool::num_processors();
+
+	std::vector<Engine::Result> results(jobs);
+	uint64_t start = Duck::Time::monotonic_nanos();
+	{
+		Duck::ThreadPool pool(jobs);
+		pool.run_chunks(jobs, [&](size_t job) {
+			Engine engine;
+			results[job] = engine.search(Board(), 1, depth, 0);
+		});
+	}
+	uint64_t elapsed = Duck::Time::monotonic_nanos() - start;
+
+	uint64_t total_nodes = 0;
+	for(size_t job = 0; job < results.size(); job++) {
+		auto& result = results[job];
+		printf("[%zu] depth %d: %llu nodes in %llu ms, %llu nodes/s\n", job, result.depth,
+			   (unsigned long long) result.nodes, (unsigned long long) (result.nanos / 1000000),
+			   (unsigned long long) result.nodes_per_second());
+		total_nodes += result.nodes;
+	}
+	printf("Total: %llu nodes in %llu ms, %llu nodes/s\n", (unsigned long long) total_nodes,
+		   (unsigned long long) (elapsed / 1000000),
+		   (unsigned long long) (elapsed ? total_nodes * 1000000000 / elapsed : 0));
+	return 0;
+}
 
 int main(int argc, char** argv, char** envp) {
+	bool bench = false;
+	int depth = BENCH_DEPTH;
+	int jobs = 1;
+	Duck::Args args;
+	args.add_flag(bench, "b", "bench", "Benchmark the computer player instead of playing.");
+	args.add_named(depth, "d", "depth", "How deep to search when benchmarking.");
+	args.add_named(jobs, "j", "jobs", "How many threads to benchmark with at once, or 0 for one per processor.");
+	args.parse(argc, argv);
+	if(bench)
+		return run_benchmark(depth, jobs);
+
 	//Init LibUI
 	UI::init(argv, envp);
 
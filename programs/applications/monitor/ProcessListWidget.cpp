@@ -21,19 +21,43 @@
 #include <libui/widget/layout/FlexLayout.h>
 #include <libui/widget/Image.h>
 #include <libui/widget/Label.h>
+#include <algorithm>
 
 void ProcessListWidget::update() {
-	auto old_procs = _processes;
-	_processes.resize(0);
-	auto procs = Sys::Process::get_all();
-	int i = 0;
-	for(auto& proc : procs) {
-		_processes.push_back(proc.second);
-		if(i >= old_procs.size() || old_procs[i].pid() != proc.second.pid())
-			_table_view->update_row(i);
-		i++;
+	auto changes = _table.update();
+	for(auto pid : changes.removed)
+		_app_infos.erase(pid);
+
+	//If processes came or went, the rows have moved around and all of them need to be redone
+	if(!changes.added.empty() || !changes.removed.empty()) {
+		_processes.clear();
+		for(auto& proc : _table.processes())
+			_processes.push_back(proc.second);
+		_table_view->update_data();
+		return;
+	}
+
+	//Otherwise, only the rows of processes that changed need to be updated
+	auto& procs = _table.processes();
+	for(auto pid : changes.changed) {
+		auto it = std::lower_bound(_processes.begin(), _processes.end(), pid, [](const Sys::Process& proc, pid_t pid) {
+			return proc.pid() < pid;
+		});
+		if(it == _processes.end() || it->pid() != pid)
+			continue;
+		*it = procs.at(pid);
+		_table_view->update_row(it - _processes.begin());
 	}
-	_table_view->update_data();
+}
+
+const std::optional<App::Info>& ProcessListWidget::app_info(const Sys::Process& proc) {
+	auto& cached = _app_infos[proc.pid()];
+	if(cached.process_name != proc.name()) {
+		cached.process_name = proc.name();
+		auto info = proc.app_info();
+		cached.info = info.has_value() ? std::optional<App::Info>(info.value()) : std::nullopt;
+	}
+	return cached.info;
 }
 
 void ProcessListWidget::initialize() {
@@ -47,11 +71,11 @@ ProcessListWidget::ProcessListWidget() {
 
 Duck::Ptr<UI::Widget> ProcessListWidget::tv_create_entry(int row, int col) {
 	auto& proc = _processes[row];
-	auto app_info = proc.app_info();
+	auto& app_info = this->app_info(proc);
 	switch(col) {
 	case 0: // Icon
-		if(app_info.has_value())
-			return UI::Image::make(app_info.value().icon());
+		if(app_info)
+			return UI::Image::make(app_info->icon());
 		else
 			return UI::Label::make("");
 
@@ -59,8 +83,8 @@ Duck::Ptr<UI::Widget> ProcessListWidget::tv_create_entry(int row, int col) {
 		return UI::Label::make(std::to_string(proc.pid()), UI::CENTER);
 
 	case 2: // Name
-		if(app_info.has_value())
-			return UI::Label::make(app_info.value().name(), UI::BEGINNING);
+		if(app_info)
+			return UI::Label::make(app_info->name(), UI::BEGINNING);
 		else
 			return UI::Label::make(proc.name(), UI::BEGINNING);
 
@@ -75,11 +99,54 @@ Duck::Ptr<UI::Widget> ProcessListWidget::tv_create_entry(int row, int col) {
 
 	case 6: // State
 		return UI::Label::make(proc.state_name(), UI::BEGINNING);
+
+	case 7: // CPU
+		return UI::Label::make(std::to_string((int) _table.cpu_percent(proc.pid())) + "%", UI::BEGINNING);
 	}
 
 	return nullptr;
 }
 
+bool ProcessListWidget::tv_update_entry(int row, int col, Duck::PtrRef<UI::Widget> entry) {
+	auto& proc = _processes[row];
+	auto label = std::static_pointer_cast<UI::Label>(entry);
+	switch(col) {
+	case 1: // PID
+		label->set_label(std::to_string(proc.pid()));
+		return true;
+
+	case 2: // Name
+		if(auto& info = app_info(proc))
+			label->set_label(info->name());
+		else
+			label->set_label(proc.name());
+		return true;
+
+	case 3: // Virtual
+		label->set_label(proc.virtual_mem().readable());
+		return true;
+
+	case 4: // Physical
+		label->set_label(proc.physical_mem().readable());
+		return true;
+
+	case 5: // Shared
+		label->set_label(proc.shared_mem().readable());
+		return true;
+
+	case 6: // State
+		label->set_label(proc.state_name());
+		return true;
+
+	case 7: // CPU
+		label->set_label(std::to_string((int) _table.cpu_percent(proc.pid())) + "%");
+		return true;
+	}
+
+	// The icon column could be an image or a label, so just make it again
+	return false;
+}
+
 std::string ProcessListWidget::tv_column_name(int col) {
 	switch(col) {
 		case 0:
@@ -96,6 +163,8 @@ std::string ProcessListWidget::tv_column_name(int col) {
 			return "Shared";
 		case 6:
 			return "State";
+		case 7:
+			return "CPU";
 	}
 	return "";
 }
@@ -124,6 +193,8 @@ int ProcessListWidget::tv_column_width(int col) {
 			return 75;
 		case 6:
 			return 60;
+		case 7:
+			return 40;
 	}
 	return 0;
 }
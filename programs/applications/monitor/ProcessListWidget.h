@@ -21,6 +21,7 @@
 
 #include <libui/widget/TableView.h>
 #include <libsys/Process.h>
+#include <optional>
 
 class ProcessListWidget: public UI::Widget, public UI::TableViewDelegate {
 public:
@@ -30,6 +31,7 @@ public:
 protected:
 	// ListViewDelegate
 	Duck::Ptr<Widget> tv_create_entry(int row, int col) override;
+	bool tv_update_entry(int row, int col, Duck::PtrRef<Widget> entry) override;
 	std::string tv_column_name(int col) override;
 	int tv_num_entries() override;
 	int tv_row_height() override;
@@ -40,7 +42,18 @@ protected:
 
 private:
 	ProcessListWidget();
-	std::vector<Sys::Process> _processes;
-	Duck::Ptr<UI::TableView> _table_view = UI::TableView::make(7);
+
+	struct CachedAppInfo {
+		std::string process_name;
+		std::optional<App::Info> info;
+	};
+
+	/// Gets the app info of a process. It's only looked up again if the process starts running something else.
+	const std::optional<App::Info>& app_info(const Sys::Process& proc);
+
+	Sys::ProcessTable _table;
+	std::vector<Sys::Process> _processes; ///< Sorted by pid, the same as the rows
+	std::map<pid_t, CachedAppInfo> _app_infos;
+	Duck::Ptr<UI::TableView> _table_view = UI::TableView::make(8);
 };
 
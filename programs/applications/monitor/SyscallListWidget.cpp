@@ -0,0 +1,101 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "SyscallListWidget.h"
+#include <libui/widget/Label.h>
+#include <algorithm>
+
+static std::string readable_us(uint64_t us) {
+	if(us >= 1000000)
+		return std::to_string(us / 1000000) + "s";
+	if(us >= 1000)
+		return std::to_string(us / 1000) + "ms";
+	return std::to_string(us) + "us";
+}
+
+void SyscallListWidget::update() {
+	auto res = Sys::Syscalls::get_stats();
+	if(res.is_error())
+		return;
+
+	// Show the syscalls made the most first
+	_syscalls = res.value();
+	std::sort(_syscalls.begin(), _syscalls.end(), [](auto& a, auto& b) { return a.calls > b.calls; });
+	for(int i = 0; i < (int) _syscalls.size(); i++)
+		_table_view->update_row(i);
+	_table_view->update_data();
+}
+
+void SyscallListWidget::initialize() {
+	set_sizing_mode(UI::FILL);
+	_table_view->set_delegate(self());
+	add_child(_table_view);
+}
+
+SyscallListWidget::SyscallListWidget() {
+}
+
+Duck::Ptr<UI::Widget> SyscallListWidget::tv_create_entry(int row, int col) {
+	auto& syscall = _syscalls[row];
+	switch(col) {
+	case 0: // Name
+		return UI::Label::make(syscall.name, UI::BEGINNING);
+
+	case 1: // Calls
+		return UI::Label::make(std::to_string(syscall.calls), UI::BEGINNING);
+
+	case 2: // Errors
+		return UI::Label::make(std::to_string(syscall.errors), UI::BEGINNING);
+
+	case 3: // Average
+		return UI::Label::make(readable_us((uint64_t) syscall.average_us()), UI::BEGINNING);
+
+	case 4: // 99th percentile
+		return UI::Label::make("<" + readable_us(syscall.percentile_us(0.99)), UI::BEGINNING);
+
+	case 5: // Total
+		return UI::Label::make(readable_us(syscall.total_us), UI::BEGINNING);
+	}
+
+	return nullptr;
+}
+
+std::string SyscallListWidget::tv_column_name(int col) {
+	switch(col) {
+		case 0:
+			return "Syscall";
+		case 1:
+			return "Calls";
+		case 2:
+			return "Errors";
+		case 3:
+			return "Average";
+		case 4:
+			return "99%";
+		case 5:
+			return "Total";
+	}
+	return "";
+}
+
+int SyscallListWidget::tv_num_entries() {
+	return _syscalls.size();
+}
+
+int SyscallListWidget::tv_row_height() {
+	return 18;
+}
+
+int SyscallListWidget::tv_column_width(int col) {
+	switch(col) {
+		case 0:
+			return -1;
+		case 1:
+		case 2:
+		case 3:
+		case 4:
+		case 5:
+			return 60;
+	}
+	return 0;
+}
@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <libui/widget/TableView.h>
+#include <libsys/Syscalls.h>
+
+class SyscallListWidget: public UI::Widget, public UI::TableViewDelegate {
+public:
+	WIDGET_DEF(SyscallListWidget);
+	void update();
+
+protected:
+	// TableViewDelegate
+	Duck::Ptr<Widget> tv_create_entry(int row, int col) override;
+	std::string tv_column_name(int col) override;
+	int tv_num_entries() override;
+	int tv_row_height() override;
+	int tv_column_width(int col) override;
+
+	// Object
+	void initialize() override;
+
+private:
+	SyscallListWidget();
+	std::vector<Sys::Syscalls::Stats> _syscalls;
+	Duck::Ptr<UI::TableView> _table_view = UI::TableView::make(6);
+};
@@ -22,12 +22,12 @@
 #include <libui/widget/Label.h>
 #include <libui/widget/layout/BoxLayout.h>
 #include <sys/time.h>
-#include <libsys/Memory.h>
-#include <libsys/CPU.h>
+#include <libsys/Stats.h>
 #include "ProcessListWidget.h"
 #include "MemoryUsageWidget.h"
+#include "SyscallListWidget.h"
+#include <libui/widget/Button.h>
 #include <libui/widget/Cell.h>
-#include <libduck/FileStream.h>
 
 #define UPDATE_FREQ 1000
 
@@ -37,12 +37,23 @@ Duck::Ptr<UI::ProgressBar> cpu_bar;
 Duck::Ptr<MemoryUsageWidget> mem_widget;
 Duck::Ptr<UI::Label> mem_label;
 Duck::Ptr<ProcessListWidget> proc_list;
+Duck::Ptr<SyscallListWidget> syscall_list;
+Duck::Ptr<UI::BoxLayout> tab_layout;
+Duck::Ptr<UI::Widget> current_tab;
 
-Duck::FileInputStream cpu_stream;
-Duck::FileInputStream mem_stream;
+Duck::Ptr<Stats::Subscription> stats;
 
-CPU::Info cpu_info;
-Mem::Info mem_info;
+void update_stats(const CPU::Info& cpu_info, const Mem::Info& mem_info) {
+	mem_widget->update(mem_info);
+
+	std::string mem_text = "Kernel: " + Mem::Amount {mem_info.kernel_phys - mem_info.kernel_disk_cache}.readable();
+	mem_text += " / Disk Cache: " + mem_info.kernel_disk_cache.readable();
+	mem_text += " / User: " + Mem::Amount {mem_info.used - mem_info.kernel_virt}.readable();
+	mem_label->set_label(mem_text);
+
+	cpu_bar->set_progress(cpu_info.utilization / 100.0);
+	cpu_bar->set_label("CPU: " + std::to_string(cpu_info.utilization) + "%");
+}
 
 Duck::Result update() {
 	static timeval last_update = {0, 0};
@@ -55,40 +66,22 @@ Duck::Result update() {
 		return Duck::Result::SUCCESS;
 	last_update = tv;
 
-	// Update
-	cpu_info = TRY(CPU::get_info(cpu_stream));
-	mem_info = TRY(Mem::get_info(mem_stream));
-
-	mem_widget->update(mem_info);
-
-	std::string mem_text = "Kernel: " + Mem::Amount {mem_info.kernel_phys - mem_info.kernel_disk_cache}.readable();
-	mem_text += " / Disk Cache: " + mem_info.kernel_disk_cache.readable();
-	mem_text += " / User: " + Mem::Amount {mem_info.used - mem_info.kernel_virt}.readable();
-	mem_label->set_label(mem_text);
-
-	cpu_bar->set_progress(cpu_info.utilization / 100.0);
-	cpu_bar->set_label("CPU: " + std::to_string(cpu_info.utilization) + "%");
+	// Update (CPU and memory statistics come from statd, unless it isn't running)
+	if(stats->fd() == -1) {
+		auto res = stats->poll();
+		if(res.is_error())
+			return res;
+	}
 
-	proc_list->update();
+	if(current_tab == proc_list)
+		proc_list->update();
+	else
+		syscall_list->update();
 
 	return Duck::Result::SUCCESS;
 }
 
 int main(int argc, char** argv, char** envp) {
-	// Open cpuinfo
-	auto res = cpu_stream.open("/proc/cpuinfo");
-	if(res.is_error()) {
-		perror("Failed to open cpuinfo");
-		return res.code();
-	}
-
-	// Open meminfo
-	res = mem_stream.open("/proc/meminfo");
-	if(res.is_error()) {
-		Duck::Log::err("Failed to open meminfo");
-		exit(res.code());
-	}
-
 	//Init libUI
 	UI::init(argv, envp);
 
@@ -108,7 +101,41 @@ int main(int argc, char** argv, char** envp) {
 	layout->add_child(UI::Cell::make(mem_label));
 
 	proc_list = ProcessListWidget::make();
-	layout->add_child(proc_list);
+	syscall_list = SyscallListWidget::make();
+
+	//Make tabs for switching between the process list and syscall stats
+	auto show_tab = [](Duck::Ptr<UI::Widget> tab) {
+		if(tab == current_tab)
+			return;
+		tab_layout->remove_child(current_tab);
+		current_tab = tab;
+		tab_layout->add_child(current_tab);
+		if(tab == proc_list)
+			proc_list->update();
+		else
+			syscall_list->update();
+	};
+	auto tab_buttons = UI::BoxLayout::make(UI::BoxLayout::HORIZONTAL, 4);
+	auto proc_button = UI::Button::make("Processes");
+	proc_button->on_pressed = [show_tab] { show_tab(proc_list); };
+	auto syscall_button = UI::Button::make("Syscalls");
+	syscall_button->on_pressed = [show_tab] { show_tab(syscall_list); };
+	tab_buttons->add_child(proc_button);
+	tab_buttons->add_child(syscall_button);
+	layout->add_child(UI::Cell::make(tab_buttons));
+
+	tab_layout = UI::BoxLayout::make(UI::BoxLayout::VERTICAL, 0);
+	tab_layout->set_sizing_mode(UI::FILL);
+	current_tab = proc_list;
+	tab_layout->add_child(current_tab);
+	layout->add_child(tab_layout);
+
+	//Get CPU and memory statistics. We read them ourselves once so there's something to show until statd sends some.
+	stats = Stats::Subscription::subscribe(update_stats);
+	if(stats->fd() != -1) {
+		UI::add_poll({stats->fd(), [] { stats->receive(); }});
+		stats->poll();
+	}
 
 	//Show window
 	update();
@@ -37,9 +37,19 @@ SandbarWidget::SandbarWidget(Duck::Ptr<AppMenu> app_menu):
 	add_module(CPUModule::make());
 	add_module(TimeModule::make());
 
+	//Get statistics from statd if it's running, and read them ourselves every second otherwise
+	m_stats = Sys::Stats::Subscription::subscribe([&](const Sys::CPU::Info& cpu, const Sys::Mem::Info& mem) {
+		for(auto& module : m_modules)
+			module->update_stats(cpu, mem);
+	});
+	if(m_stats->fd() != -1)
+		UI::add_poll({m_stats->fd(), [&] { m_stats->receive(); }});
+
 	m_module_timer = UI::set_interval([&]() {
 		for(auto& module : m_modules)
 			module->update();
+		if(m_stats->fd() == -1)
+			m_stats->poll();
 	}, 1000);
 }
 
@@ -8,6 +8,7 @@
 #include "AppMenu.h"
 #include "modules/Module.h"
 #include <libui/Timer.h>
+#include <libsys/Stats.h>
 
 class SandbarWidget: public UI::Widget {
 public:
@@ -25,4 +26,5 @@ private:
 	Duck::Ptr<AppMenu> m_app_menu;
 	std::vector<Duck::Ptr<Module>> m_modules;
 	Duck::Ptr<UI::Timer> m_module_timer;
+	Duck::Ptr<Sys::Stats::Subscription> m_stats;
 };
@@ -10,11 +10,9 @@ public:
 	WIDGET_DEF(CPUModule);
 
 protected:
-	float plot_value() override;
+	float plot_value(const Sys::CPU::Info& cpu, const Sys::Mem::Info& mem) override;
 	Gfx::Color graph_color() const override { return Gfx::Color(255, 50, 50); };
 
 private:
-	CPUModule();
-
-	Duck::FileInputStream m_stream;
+	CPUModule() = default;
 };
@@ -4,10 +4,10 @@
 #include "GraphModule.h"
 #include "../Sandbar.h"
 
-void GraphModule::update() {
+void GraphModule::update_stats(const Sys::CPU::Info& cpu, const Sys::Mem::Info& mem) {
 	if(!m_values.empty())
 		m_values.erase(m_values.end() - 1);
-	m_values.insert(m_values.begin(), plot_value());
+	m_values.insert(m_values.begin(), plot_value(cpu, mem));
 	repaint();
 }
 
@@ -9,10 +9,10 @@
 
 class GraphModule: public Module {
 public:
-	void update() override;
+	void update_stats(const Sys::CPU::Info& cpu, const Sys::Mem::Info& mem) override;
 
 protected:
-	virtual float plot_value() = 0;
+	virtual float plot_value(const Sys::CPU::Info& cpu, const Sys::Mem::Info& mem) = 0;
 	virtual Gfx::Color graph_color() const = 0;
 
 	void do_repaint(const UI::DrawContext& ctx) override;
@@ -3,13 +3,6 @@
 
 #include "MemoryModule.h"
 
-MemoryModule::MemoryModule() {
-	m_stream = Duck::FileInputStream("/proc/meminfo");
-}
-
-float MemoryModule::plot_value() {
-	auto val = Sys::Mem::get_info(m_stream);
-	if(val.has_value())
-		return val.value().used_frac();
-	return 0.0;
+float MemoryModule::plot_value(const Sys::CPU::Info& cpu, const Sys::Mem::Info& mem) {
+	return mem.used_frac();
 }
\ No newline at end of file
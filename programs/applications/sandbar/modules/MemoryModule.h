@@ -10,11 +10,9 @@ public:
 	WIDGET_DEF(MemoryModule);
 
 protected:
-	float plot_value() override;
+	float plot_value(const Sys::CPU::Info& cpu, const Sys::Mem::Info& mem) override;
 	Gfx::Color graph_color() const override { return UI::Theme::accent(); };
 
 private:
-	MemoryModule();
-
-	Duck::FileInputStream m_stream;
+	MemoryModule() = default;
 };
\ No newline at end of file
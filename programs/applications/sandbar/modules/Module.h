@@ -4,8 +4,13 @@
 #pragma once
 
 #include <libui/widget/Widget.h>
+#include <libsys/CPU.h>
+#include <libsys/Memory.h>
 
 class Module: public UI::Widget {
 public:
-	virtual void update() = 0;
+	/// Called once every second.
+	virtual void update() {};
+	/// Called whenever new CPU and memory statistics come in.
+	virtual void update_stats(const Sys::CPU::Info& cpu, const Sys::Mem::Info& mem) {};
 };
@@ -46,7 +46,8 @@ static const uint32_t color_palette[] = {
 
 TerminalWidget::TerminalWidget() {
 	font = UI::Theme::font_mono();
-	term = new Term::Terminal({1, 1}, *this);
+	term = new Term::Terminal({1, 1}, *this, TERMINAL_SCROLLBACK);
+	dirty_lines.resize(1, true);
 
 	//Setup PTY
 	pty_fd = posix_openpt(O_RDWR | O_CLOEXEC);
@@ -56,11 +57,18 @@ TerminalWidget::TerminalWidget() {
 	//Set up pty poll
 	UI::Poll pty_poll = {pty_fd};
 	pty_poll.on_ready_to_read = [&]{
-		char buf[128];
-		size_t nread;
-		while((nread = read(pty_fd, buf, 128))) {
+		static char buf[TERMINAL_READ_SIZE];
+		ssize_t nread;
+		//Batch everything that's been written so far, so that it only scrolls once. If the output doesn't stop coming,
+		//stop after a frame's worth of time so that it still gets drawn.
+		auto start = Duck::Time::monotonic();
+		term->begin_batch();
+		while((nread = read(pty_fd, buf, TERMINAL_READ_SIZE)) > 0) {
 			term->write_chars(buf, nread);
+			if((Duck::Time::monotonic() - start).millis() >= TERMINAL_FRAME_MILLIS)
+				break;
 		}
+		term->end_batch();
 		handle_term_events();
 	};
 	UI::add_poll(pty_poll);
@@ -70,6 +78,13 @@ TerminalWidget::TerminalWidget() {
 		blink_on = !blink_on;
 		repaint();
 	}, 500);
+
+	//Set up the timer for repainting output that comes in too quickly to repaint right away
+	frame_timer = UI::set_interval([&] {
+		frame_timer->stop();
+		repaint();
+	}, TERMINAL_FRAME_MILLIS);
+	frame_timer->stop();
 }
 
 TerminalWidget::~TerminalWidget() {
@@ -85,65 +100,51 @@ void TerminalWidget::do_repaint(const UI::DrawContext& ctx) {
 	if(!term)
 		return;
 
-	//If we need a full repaint, do so
+	last_paint = Duck::Time::monotonic();
+	frame_timer->stop();
+	needs_paint = false;
+
+	auto dims = term->get_dimensions();
+	auto& framebuffer = ctx.framebuffer();
+	if((int) dirty_lines.size() != dims.lines)
+		needs_full_repaint = true;
+
 	if(needs_full_repaint) {
+		//Repaint everything, including whatever's past the last line and column
 		needs_full_repaint = false;
-		auto dims = term->get_dimensions();
-		for(int x = 0; x < dims.cols; x++) {
-			for(int y = 0; y < dims.lines; y++) {
-				auto character = term->get_character({x, y});
-				Gfx::Point pos = {(int) x * font->bounding_box().width, (int) y * font->size()};
-				ctx.fill({pos.x, pos.y, font->bounding_box().width, font->size()}, color_palette[character.attr.bg]);
-				ctx.draw_glyph(font, character.codepoint, pos, color_palette[character.attr.fg]);
-			}
-		}
+		pending_scroll = 0;
+		dirty_lines.assign(dims.lines, true);
+		ctx.fill({0, 0, ctx.width(), ctx.height()}, color_palette[term->get_current_attribute().bg]);
+	} else if(pending_scroll) {
+		//Scroll everything that's still on the screen at once. Whatever scrolled in is marked dirty already.
+		framebuffer.copy(framebuffer, {
+			0,
+			pending_scroll * font->size(),
+			framebuffer.width,
+			(dims.lines - pending_scroll) * font->size()
+		}, {0, 0});
+		pending_scroll = 0;
 	}
 
-	//Go through pending events and paint them
-	for(auto evt : events) {
-		switch(evt.type) {
-			case TerminalEvent::CHARACTER: {
-				auto& data = evt.data.character;
-				Gfx::Point pos = {(int) data.pos.col * font->bounding_box().width, (int) data.pos.line * font->size()};
-				ctx.fill({pos.x, pos.y, font->bounding_box().width, font->size()}, color_palette[data.character.attr.bg]);
-				ctx.draw_glyph(font, data.character.codepoint, pos, color_palette[data.character.attr.fg]);
-				break;
-			}
-
-			case TerminalEvent::CLEAR: {
-				ctx.fill({0, 0, ctx.width(), ctx.height()}, color_palette[evt.data.clear.attribute.bg]);
-				break;
-			}
-
-			case TerminalEvent::CLEAR_LINE: {
-				auto& data = evt.data.clear_line;
-				ctx.fill({0, (int) data.line * font->size(), ctx.width(), font->size()}, color_palette[data.attribute.bg]);
-				break;
-			}
-
-			case TerminalEvent::SCROLL: {
-				auto& data = evt.data.scroll;
-				auto& framebuffer = ctx.framebuffer();
-				framebuffer.copy(framebuffer, {
-					0,
-					(int) data.lines * font->size(),
-					framebuffer.width,
-					framebuffer.height - ((int) data.lines * font->size())
-				}, {0, 0});
-				ctx.fill({0, framebuffer.height - ((int) data.lines * font->size()), framebuffer.width, (int) data.lines * font->size()}, color_palette[data.attribute.bg]);
-			}
+	//Redraw the lines that changed from the terminal
+	for(int y = 0; y < dims.lines; y++) {
+		if(dirty_lines[y]) {
+			paint_line(ctx, y);
+			dirty_lines[y] = false;
 		}
 	}
-	events.clear();
+
+	// Redraw the character where the cursor was drawn last, if it's still on the screen
+	if(drawn_cursor.line >= 0 && drawn_cursor.line < dims.lines)
+		paint_character(ctx, drawn_cursor);
 
 	// Get cursor position
 	auto cursor = term->get_cursor();
 	Gfx::Point pos = {(int) cursor.col * font->bounding_box().width, (int) cursor.line * font->size()};
 
 	// Draw character under cursor
-	auto character = term->get_character(cursor);
-	ctx.fill({pos.x, pos.y, font->bounding_box().width, font->size()}, color_palette[character.attr.bg]);
-	ctx.draw_glyph(font, character.codepoint, pos, color_palette[character.attr.fg]);
+	paint_character(ctx, cursor);
+	drawn_cursor = cursor;
 
 	// Draw the cursor
 	if(blink_on) {
@@ -161,6 +162,34 @@ void TerminalWidget::do_repaint(const UI::DrawContext& ctx) {
 	}
 }
 
+void TerminalWidget::paint_line(const UI::DrawContext& ctx, int line) {
+	auto dims = term->get_dimensions();
+	int cell_width = font->bounding_box().width;
+
+	//Fill each run of cells with the same background at once, and then draw the glyphs over them
+	int run_start = 0;
+	uint8_t run_bg = term->get_character({0, line}).attr.bg;
+	for(int x = 1; x <= dims.cols; x++) {
+		uint8_t bg = x < dims.cols ? term->get_character({x, line}).attr.bg : run_bg;
+		if(x < dims.cols && bg == run_bg)
+			continue;
+		ctx.fill({run_start * cell_width, line * font->size(), (x - run_start) * cell_width, font->size()}, color_palette[run_bg]);
+		run_start = x;
+		run_bg = bg;
+	}
+	for(int x = 0; x < dims.cols; x++) {
+		auto character = term->get_character({x, line});
+		ctx.draw_glyph(font, character.codepoint, {x * cell_width, line * font->size()}, color_palette[character.attr.fg]);
+	}
+}
+
+void TerminalWidget::paint_character(const UI::DrawContext& ctx, const Term::Position& position) {
+	auto character = term->get_character(position);
+	Gfx::Point pos = {(int) position.col * font->bounding_box().width, (int) position.line * font->size()};
+	ctx.fill({pos.x, pos.y, font->bounding_box().width, font->size()}, color_palette[character.attr.bg]);
+	ctx.draw_glyph(font, character.codepoint, pos, color_palette[character.attr.fg]);
+}
+
 bool TerminalWidget::on_keyboard(Pond::KeyEvent event) {
 	if(KBD_ISPRESSED(event))
 		term->handle_keypress(event.scancode, event.character, event.modifiers);
@@ -216,8 +245,14 @@ bool TerminalWidget::on_mouse_button(Pond::MouseButtonEvent evt) {
 }
 
 void TerminalWidget::handle_term_events() {
-	if(!events.empty())
+	if(!needs_paint)
+		return;
+
+	//Repaint at most once a frame, so that output that comes in quickly only gets drawn as often as it can be seen
+	if((Duck::Time::monotonic() - last_paint).millis() >= TERMINAL_FRAME_MILLIS)
 		repaint();
+	else if(!frame_timer->enabled())
+		frame_timer->start();
 }
 
 void TerminalWidget::run(const char* command) {
@@ -280,11 +315,12 @@ void TerminalWidget::run(const char* command) {
 }
 
 void TerminalWidget::on_character_change(const Term::Position& position, const Term::Character& character) {
-	events.push_back({TerminalEvent::CHARACTER, {.character = {position, character}}});
+	mark_dirty(position.line);
 }
 
 void TerminalWidget::on_cursor_change(const Term::Position& old_position) {
-	events.push_back({TerminalEvent::CHARACTER, {.character = {old_position, term->get_character(old_position)}}});
+	//The character under the cursor is redrawn every repaint anyway
+	needs_paint = true;
 }
 
 void TerminalWidget::on_backspace(const Term::Position& position) {
@@ -292,25 +328,38 @@ void TerminalWidget::on_backspace(const Term::Position& position) {
 }
 
 void TerminalWidget::on_clear() {
-	events.clear();
-	//We are sent a clear event before the terminal is set, so handle that case
-	if(term)
-		events.push_back({TerminalEvent::CLEAR, {.clear = {term->get_current_attribute()}}});
-	else
-		events.push_back({TerminalEvent::CLEAR, {.clear = {{TERM_DEFAULT_FOREGROUND, TERM_DEFAULT_BACKGROUND}}}});
+	needs_full_repaint = true;
+	needs_paint = true;
 }
 
 void TerminalWidget::on_clear_line(int line) {
-	events.push_back({TerminalEvent::CLEAR_LINE, {.clear_line = {term->get_current_attribute(), line}}});
+	mark_dirty(line);
 }
 
 void TerminalWidget::on_scroll(int lines) {
-	//Redraw the cursor character, as we don't want to include it in the scroll
-	events.push_back({TerminalEvent::CHARACTER, {.character = {term->get_cursor(), term->get_character(term->get_cursor())}}});
-	events.push_back({TerminalEvent::SCROLL, {.scroll = {term->get_current_attribute(), lines}}});
+	//Move the dirty lines along with everything else, and mark the lines that scrolled in as dirty
+	int num_lines = dirty_lines.size();
+	if(pending_scroll + lines >= num_lines) {
+		on_clear();
+		return;
+	}
+	for(int y = 0; y < num_lines; y++)
+		dirty_lines[y] = y + lines < num_lines ? dirty_lines[y + lines] : true;
+	pending_scroll += lines;
+	drawn_cursor.line -= lines;
+	needs_paint = true;
+}
+
+void TerminalWidget::mark_dirty(int line) {
+	if(line >= 0 && line < (int) dirty_lines.size())
+		dirty_lines[line] = true;
+	needs_paint = true;
 }
 
 void TerminalWidget::on_resize(const Term::Size& old_size, const Term::Size& new_size) {
+	dirty_lines.assign(new_size.lines, true);
+	needs_full_repaint = true;
+	needs_paint = true;
 	winsize winsz = {
 			(unsigned short) new_size.lines,
 			(unsigned short) new_size.cols
@@ -22,6 +22,10 @@
 #include <libui/libui.h>
 #include <libterm/Terminal.h>
 
+#define TERMINAL_SCROLLBACK 1000
+#define TERMINAL_READ_SIZE 16384
+#define TERMINAL_FRAME_MILLIS 16
+
 class TerminalWidget: public UI::Widget, public Term::Listener, public UI::WindowDelegate {
 public:
 	WIDGET_DEF(TerminalWidget)
@@ -62,6 +66,10 @@ public:
 private:
 	TerminalWidget();
 
+	void paint_line(const UI::DrawContext& ctx, int line);
+	void paint_character(const UI::DrawContext& ctx, const Term::Position& position);
+	void mark_dirty(int line);
+
 	Gfx::Font* font = nullptr;
 	Term::Terminal* term;
 	int pty_fd = -1;
@@ -70,28 +78,12 @@ private:
 	Duck::Ptr<UI::Timer> blink_timer;
 	bool blink_on = false;
 
-	struct TerminalEvent {
-		enum type {CHARACTER, CLEAR, CLEAR_LINE, SCROLL} type;
-		union event {
-			struct {
-				Term::Position pos;
-				Term::Character character;
-			} character;
-			struct {
-				Term::Attribute attribute;
-			} clear;
-			struct {
-				Term::Attribute attribute;
-				int line;
-			} clear_line;
-			struct {
-				Term::Attribute attribute;
-				int lines;
-			} scroll;
-		} data;
-	};
-
-	std::vector<TerminalEvent> events;
+	Duck::Ptr<UI::Timer> frame_timer;
+	Duck::Time last_paint;
+	bool needs_paint = false; ///< Whether anything changed since the last repaint
+	std::vector<bool> dirty_lines; ///< Which lines need to be redrawn from the terminal next repaint
+	int pending_scroll = 0; ///< How many lines to scroll what's already drawn by before redrawing the dirty lines
+	Term::Position drawn_cursor = {-1, -1}; ///< Where the cursor was drawn last repaint
 	CursorStyle cursor_style = CursorStyle::Block;
 };
 
@@ -0,0 +1,43 @@
+/*
+    This file is part of duckOS.
+    
+    duckOS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    duckOS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with duckOS.  If not, see <https://www.gnu.org/licenses/>.
+    
+    Copyright (c) Byteduck 2016-2022. All rights reserved.
+*/
+
+
+#include "ScreenWidget.h"
+
+ScreenWidget::ScreenWidget(Uxn& uxn): m_uxn(uxn), m_screen(uxn.screen()) {}
+
+void ScreenWidget::frame() {
+	m_uxn.eval(m_screen->vector());
+	if(m_screen->dirty_rect().width > 0)
+		repaint(m_screen->dirty_rect());
+}
+
+Gfx::Dimensions ScreenWidget::preferred_size() {
+	return m_screen->dimensions();
+}
+
+void ScreenWidget::do_repaint(const UI::DrawContext& ctx) {
+	//Our framebuffer still has the last frame in it, so only what the ROM drew since then needs to be composited
+	m_screen->composite(ctx.framebuffer());
+}
+
+void ScreenWidget::on_layout_change(const Gfx::Rect& old_rect) {
+	//We may have a new framebuffer, so all of it needs to be drawn
+	m_screen->invalidate();
+}
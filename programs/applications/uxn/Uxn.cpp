@@ -20,11 +20,12 @@
 #include "Uxn.h"
 #include "devices/Device.h"
 #include "devices/ConsoleDevice.h"
+#include "devices/ScreenDevice.h"
 #include <libduck/File.h>
 #include <libduck/Log.h>
 
-const bool debug = false;
-
+// Define UXN_DEBUG to log every instruction as it runs
+#ifdef UXN_DEBUG
 const char* opcode_names[] = {
 		"LIT", "INC", "POP", "DUP", "NIP",
 		"SWP", "OVR", "ROT", "EQU", "NEQ",
@@ -34,200 +35,317 @@ const char* opcode_names[] = {
 		"SUB", "MUL", "DIV", "AND", "ORA",
 		"EOR", "SFT"
 };
+#endif
+
+//The result of the binary operations, where a is the value on top of the stack and b is the one under it
+template<Uxn::Opcode Op>
+constexpr uint16_t Uxn::alu(uint16_t b, uint16_t a) {
+	if constexpr(Op == EQU) return a == b ? 1 : 0;
+	else if constexpr(Op == NEQ) return a != b ? 1 : 0;
+	else if constexpr(Op == GTH) return b > a ? 1 : 0;
+	else if constexpr(Op == LTH) return b < a ? 1 : 0;
+	else if constexpr(Op == ADD) return b + a;
+	else if constexpr(Op == SUB) return b - a;
+	else if constexpr(Op == MUL) return (uint32_t) b * a;
+	else if constexpr(Op == DIV) return a ? b / a : 0;
+	else if constexpr(Op == AND) return b & a;
+	else if constexpr(Op == ORA) return b | a;
+	else if constexpr(Op == EOR) return b ^ a;
+	else if constexpr(Op == SFT) return b >> (a & 0x0f) << ((a & 0xf0) >> 4);
+	else return 0;
+}
+
+template<size_t... Instrs>
+constexpr std::array<Uxn::Handler, 256> Uxn::make_handlers(std::index_sequence<Instrs...>) {
+	return {{&Uxn::execute<Instrs>...}};
+}
+
+const std::array<Uxn::Handler, 256> Uxn::s_handlers = Uxn::make_handlers(std::make_index_sequence<256>());
 
 Uxn::Uxn() {
-	m_memory.resize(64000); //64kb
+	m_memory.resize(0x10000); //64kb
+	m_code.resize(0x10000, &decode);
+	m_screen = std::make_shared<ScreenDevice>(*this);
 	m_devices[1] = std::make_shared<ConsoleDevice>();
+	m_devices[2] = m_screen;
 }
 
 bool Uxn::step() {
+	return m_code[m_pc++](*this);
+}
+
+void Uxn::run() {
+	auto* code = m_code.data();
+	while(code[m_pc++](*this)) {}
+}
+
+bool Uxn::eval(uint16_t vector) {
+	if(!vector)
+		return false;
+	m_pc = vector;
+	run();
+	return true;
+}
+
+template<uint8_t Instr>
+bool Uxn::execute(Uxn& vm) {
 	//First 3 bits are mode, last 5 are opcode
-	auto operation = *((Operation*) &m_memory[m_pc++]);
-
-	//Stack in use depends on mode
-	Stack& src = operation.ret ? m_return_stack : m_working_stack;
-	Stack& dst = operation.ret ? m_working_stack : m_return_stack;
-
-	//If we do an operation with keep, we need to keep track of the old stack pointer
-	uint8_t* src_ptr_raw = &src.ptr;
-	uint8_t tmp_ptr;
-	if(operation.keep) {
-		tmp_ptr = src.ptr;
-		src_ptr_raw = &tmp_ptr;
-	}
-	uint8_t& src_ptr = *src_ptr_raw;
+	constexpr auto opcode = (Opcode) (Instr & 0x1fu);
+	constexpr bool shrt = Instr & SHORT;
+	constexpr bool ret = Instr & RETURN;
+	constexpr bool keep = (Instr & KEEP) && opcode != LIT; // LIT always has keep set, and doesn't pop anything anyway
 
-	if(operation.opcode == LIT) {
-		if(!operation.keep)
-			return false;
-		operation.keep = false;
-	}
+	//LIT without keep is BRK
+	if constexpr(opcode == LIT && !(Instr & KEEP)) {
+		return false;
+	} else {
+#ifdef UXN_DEBUG
+		Duck::Log::dbgf("[{x}] {}{}{}{}", vm.m_pc - 1, opcode_names[opcode], shrt ? "2" : "", keep ? "k" : "", ret ? "r" : "");
+#endif
 
-	if(debug)
-		Duck::Log::dbgf("[{x}] {}{}{}{}", m_pc - 1, opcode_names[operation.opcode], operation.shrt ? "2" : "", operation.keep ? "k" : "", operation.ret ? "r" : "");
-
-	auto push8 = [&] (Stack& stack, uint8_t val) {
-		stack.mem[stack.ptr++] = val;
-		if(debug)
-			Duck::Log::dbgf("PUSH8 {x}", (int) val);
-	};
-
-	auto push16 = [&] (Stack& stack, uint16_t val) {
-		stack.mem[stack.ptr] = (uint8_t) (val >> 8);
-		stack.mem[stack.ptr + 1] = (uint8_t) val;
-		stack.ptr += 2;
-		if(debug)
-			Duck::Log::dbg("PUSH16 {x}", val);
-	};
-
-	auto push = [&] (Stack& stack, uint16_t val) {
-		if(operation.shrt)
-			push16(stack, val);
-		else
-			push8(stack, val);
-	};
-
-	auto pop8 = [&] () -> uint8_t {
-		src_ptr--;
-		if(debug)
-			Duck::Log::dbgf("POP8 {x}", (int) src.mem[src_ptr]);
-		return src.mem[src_ptr];
-	};
-
-	auto pop16 = [&] () -> uint16_t {
-		src_ptr -= 2;
-		if(debug)
-			Duck::Log::dbgf("POP16 {x}", ((uint16_t) src.mem[src_ptr] << 8) + src.mem[src_ptr + 1]);
-		return ((uint16_t) src.mem[src_ptr] << 8) + src.mem[src_ptr + 1];
-	};
-
-	auto pop = [&] () -> uint16_t {
-		if(operation.shrt)
-			return pop16();
-		else
-			return pop8();
-	};
-
-	auto peek = [&] (uint16_t addr) -> uint16_t {
-		if(operation.shrt) {
-			if(debug)
-				Duck::Log::dbgf("PEEK16 {x} = {x}", addr, ((uint16_t) m_memory[addr] << 8) + m_memory[addr + 1]);
-			return ((uint16_t) m_memory[addr] << 8) + m_memory[addr + 1];
-		} else {
-			if(debug)
-				Duck::Log::dbgf("PEEK8 {x} = {x}", addr, (int) m_memory[addr]);
-			return m_memory[addr];
-		}
-	};
-
-	auto poke = [&] (uint16_t addr, uint16_t val) {
-		if(operation.shrt) {
-			m_memory[addr] = (uint8_t) (val >> 8);
-			m_memory[addr + 1] = (uint8_t) val;
-			if(debug)
-				Duck::Log::dbgf("POKE16 {x} = {x}", addr, val);
-		} else {
-			m_memory[addr] = (uint8_t) val;
-			if(debug)
-				Duck::Log::dbgf("POKE8 {x} = {x}", addr, val);
-		}
-	};
+		//Stack in use depends on mode
+		Stack& src = ret ? vm.m_return_stack : vm.m_working_stack;
+		Stack& dst = ret ? vm.m_working_stack : vm.m_return_stack;
+		uint8_t* memory = vm.m_memory.data();
+		uint16_t& pc = vm.m_pc;
 
-	auto jmp = [&] (uint16_t val) {
-		if(operation.shrt) {
-			if(debug)
-				Duck::Log::dbgf("JMP {x}", val);
-			m_pc = val;
-		} else {
-			if(debug)
-				Duck::Log::dbgf("JMP REL {x}", (int) val);
-			m_pc += (int8_t) val;
-		}
-	};
+		//Pops move a copy of the stack pointer, which is only stored back once we're done popping if we aren't in keep mode
+		uint8_t src_ptr = src.ptr;
+		auto popped = [&] {
+			if constexpr(!keep)
+				src.ptr = src_ptr;
+		};
+
+		auto pop8 = [&] () -> uint8_t {
+			return src.mem[--src_ptr];
+		};
+
+		auto pop16 = [&] () -> uint16_t {
+			src_ptr -= 2;
+			return ((uint16_t) src.mem[src_ptr] << 8) | src.mem[(uint8_t) (src_ptr + 1)];
+		};
+
+		auto pop = [&] () -> uint16_t {
+			if constexpr(shrt)
+				return pop16();
+			else
+				return pop8();
+		};
+
+		auto push8 = [&] (Stack& stack, uint8_t val) {
+			stack.mem[stack.ptr++] = val;
+		};
+
+		auto push16 = [&] (Stack& stack, uint16_t val) {
+			stack.mem[stack.ptr++] = (uint8_t) (val >> 8);
+			stack.mem[stack.ptr++] = (uint8_t) val;
+		};
+
+		auto push = [&] (Stack& stack, uint16_t val) {
+			if constexpr(shrt)
+				push16(stack, val);
+			else
+				push8(stack, val);
+		};
+
+		auto peek = [&] (uint16_t addr) -> uint16_t {
+			if constexpr(shrt)
+				return ((uint16_t) memory[addr] << 8) | memory[(uint16_t) (addr + 1)];
+			else
+				return memory[addr];
+		};
 
-	uint16_t a, b, c; //General use variables
+		auto poke = [&] (uint16_t addr, uint16_t val) {
+			vm.invalidate(addr, shrt ? 2 : 1);
+			if constexpr(shrt) {
+				memory[addr] = (uint8_t) (val >> 8);
+				memory[(uint16_t) (addr + 1)] = (uint8_t) val;
+			} else {
+				memory[addr] = (uint8_t) val;
+			}
+		};
 
-	//For reference on opcodes, see https://wiki.xxiivv.com/site/uxntal_reference.html
-	switch(operation.opcode) {
+		auto jmp = [&] (uint16_t val) {
+			if constexpr(shrt)
+				pc = val;
+			else
+				pc += (int8_t) val;
+		};
+
+		uint16_t a, b, c; //General use variables
+
+		//For reference on opcodes, see https://wiki.xxiivv.com/site/uxntal_reference.html
 		//Stack operations
-		case LIT:
-			push(src, peek(m_pc));
-			m_pc += operation.shrt ? 2 : 1;
-			break;
-		case INC: push(src, pop() + 1); break;
-		case POP: pop(); break;
-		case DUP: a = pop(); push(src, a); push(src, a); break;
-		case NIP: a = pop(); pop(); push(src, a); break;
-		case SWP: a = pop(); b = pop(); push(src, a); push(src, b); break;
-		case OVR:
-			a = pop(); b = pop();
+		if constexpr(opcode == LIT) {
+			push(src, peek(pc));
+			pc += shrt ? 2 : 1;
+		} else if constexpr(opcode == INC) {
+			a = pop(); popped(); push(src, a + 1);
+		} else if constexpr(opcode == POP) {
+			pop(); popped();
+		} else if constexpr(opcode == DUP) {
+			a = pop(); popped(); push(src, a); push(src, a);
+		} else if constexpr(opcode == NIP) {
+			a = pop(); pop(); popped(); push(src, a);
+		} else if constexpr(opcode == SWP) {
+			a = pop(); b = pop(); popped(); push(src, a); push(src, b);
+		} else if constexpr(opcode == OVR) {
+			a = pop(); b = pop(); popped();
 			push(src, b); push(src, a); push(src, b);
-			break;
-		case ROT:
-			a = pop(); b = pop(); c = pop();
+		} else if constexpr(opcode == ROT) {
+			a = pop(); b = pop(); c = pop(); popped();
 			push(src, b); push(src, a); push(src, c);
-			break;
+		}
 
 		//Comparison
-		case EQU: a = pop(); b = pop(); push8(src, a == b ? 1 : 0); break;
-		case NEQ: a = pop(); b = pop(); push8(src, a != b ? 1 : 0); break;
-		case GTH: a = pop(); b = pop(); push8(src, b > a ? 1 : 0); break;
-		case LTH: a = pop(); b = pop(); push8(src, b < a ? 1 : 0); break;
+		else if constexpr(opcode >= EQU && opcode <= LTH) {
+			a = pop(); b = pop(); popped(); push8(src, alu<opcode>(b, a));
+		}
 
 		//Control flow
-		case JMP: jmp(pop()); break;
-		case JCN: a = pop(); if(pop8()) jmp(a); break;
-		case JSR: push16(dst, m_pc); jmp(pop()); break;
-		case STH: push(dst, pop()); break;
+		else if constexpr(opcode == JMP) {
+			a = pop(); popped(); jmp(a);
+		} else if constexpr(opcode == JCN) {
+			a = pop(); b = pop8(); popped();
+			if(b)
+				jmp(a);
+		} else if constexpr(opcode == JSR) {
+			a = pop(); popped(); push16(dst, pc); jmp(a);
+		} else if constexpr(opcode == STH) {
+			a = pop(); popped(); push(dst, a);
+		}
 
 		//Memory
-		case LDZ: push(src, peek(pop8())); break;
-		case STZ: a = pop8(); poke(a, pop()); break;
-		case LDR: push(src, peek(m_pc + (int8_t) pop8())); break;
-		case STR: a = pop8(); poke(m_pc + (int8_t) a, pop()); break;
-		case LDA: push(src, peek(pop16())); break;
-		case STA: a = pop16(); poke(a, pop()); break;
+		else if constexpr(opcode == LDZ) {
+			a = pop8(); popped(); push(src, peek(a));
+		} else if constexpr(opcode == STZ) {
+			a = pop8(); b = pop(); popped(); poke(a, b);
+		} else if constexpr(opcode == LDR) {
+			a = pop8(); popped(); push(src, peek(pc + (int8_t) a));
+		} else if constexpr(opcode == STR) {
+			a = pop8(); b = pop(); popped(); poke(pc + (int8_t) a, b);
+		} else if constexpr(opcode == LDA) {
+			a = pop16(); popped(); push(src, peek(a));
+		} else if constexpr(opcode == STA) {
+			a = pop16(); b = pop(); popped(); poke(a, b);
+		}
 
 		//Device
-		case DEI:
-			a = pop8();
+		else if constexpr(opcode == DEI) {
+			a = pop8(); popped();
 			b = a >> 4; //Device number
 			c = a & 0xfu; //Byte
-			if(m_devices[b])
-				push(src, m_devices[b]->read(c, operation.shrt));
-			else
-				push(src, 0);
-			break;
+			push(src, vm.m_devices[b] ? vm.m_devices[b]->read(c, shrt) : 0);
+		} else if constexpr(opcode == DEO) {
+			a = pop8(); b = pop(); popped();
+			c = a >> 4; //Device number
+			if(vm.m_devices[c])
+				vm.m_devices[c]->write(a & 0xfu, b, shrt);
+		}
 
-		case DEO:
-			a = pop8();
-			b = a >> 4; //Device number
-			c = a & 0xfu; //Byte
-			if(m_devices[b])
-				m_devices[b]->write(c, pop(), operation.shrt);
-			else
-				pop();
-			break;
-
-		//Arithmetic
-		case ADD: a = pop(); b = pop(); push(src, b + a); break;
-		case SUB: a = pop(); b = pop(); push(src, b - a); break;
-		case MUL: a = pop(); b = pop(); push(src, (uint32_t) b * a); break;
-		case DIV: a = pop(); b = pop(); push(src, b / a); break; //TODO: Divide by zero?
-
-		//Bitwise
-		case AND: a = pop(); b = pop(); push(src, b & a); break;
-		case ORA: a = pop(); b = pop(); push(src, b | a); break;
-		case EOR: a = pop(); b = pop(); push(src, b ^ a); break;
-		case SFT:
-			a = pop8(); b = pop();
-			push(src, b >> (a & 0x0f) << ((a & 0xf0) >> 4));
-			break;
+		//Arithmetic and bitwise
+		else if constexpr(opcode == SFT) {
+			a = pop8(); b = pop(); popped(); push(src, alu<opcode>(b, a));
+		} else {
+			a = pop(); b = pop(); popped(); push(src, alu<opcode>(b, a));
+		}
+
+		return true;
 	}
+}
+
+template<Uxn::Opcode Op>
+bool Uxn::execute_lit(Uxn& vm) {
+	//LIT x followed by Op (in byte mode, without keep or return), so we can use x directly instead of pushing and popping it
+	auto& stack = vm.m_working_stack;
+	uint8_t* memory = vm.m_memory.data();
+	uint8_t lit = memory[vm.m_pc];
+	vm.m_pc += 2;
 
+	if constexpr(Op == JMP) {
+		vm.m_pc += (int8_t) lit;
+	} else if constexpr(Op == JCN) {
+		if(stack.mem[--stack.ptr])
+			vm.m_pc += (int8_t) lit;
+	} else if constexpr(Op == JSR) {
+		auto& ret = vm.m_return_stack;
+		ret.mem[ret.ptr++] = (uint8_t) (vm.m_pc >> 8);
+		ret.mem[ret.ptr++] = (uint8_t) vm.m_pc;
+		vm.m_pc += (int8_t) lit;
+	} else {
+		uint8_t& top = stack.mem[(uint8_t) (stack.ptr - 1)];
+		top = (uint8_t) alu<Op>(top, lit);
+	}
+	return true;
+}
+
+template<Uxn::Opcode Op>
+bool Uxn::execute_lit2(Uxn& vm) {
+	//LIT2 xxxx followed by a JMP2, JCN2 or JSR2 (without keep or return), so the jump target is known ahead of time
+	uint8_t* memory = vm.m_memory.data();
+	uint16_t target = ((uint16_t) memory[vm.m_pc] << 8) | memory[(uint16_t) (vm.m_pc + 1)];
+	vm.m_pc += 3;
+
+	if constexpr(Op == JMP) {
+		vm.m_pc = target;
+	} else if constexpr(Op == JCN) {
+		auto& stack = vm.m_working_stack;
+		if(stack.mem[--stack.ptr])
+			vm.m_pc = target;
+	} else if constexpr(Op == JSR) {
+		auto& ret = vm.m_return_stack;
+		ret.mem[ret.ptr++] = (uint8_t) (vm.m_pc >> 8);
+		ret.mem[ret.ptr++] = (uint8_t) vm.m_pc;
+		vm.m_pc = target;
+	}
 	return true;
 }
 
+bool Uxn::decode(Uxn& vm) {
+	uint16_t addr = vm.m_pc - 1;
+	uint8_t* memory = vm.m_memory.data();
+	uint8_t instr = memory[addr];
+	Handler handler = s_handlers[instr];
+
+	//See if this is the start of a sequence we can fuse into one instruction
+	if(instr == (LIT | KEEP)) {
+		switch(memory[(uint16_t) (addr + 2)]) {
+			case JMP: handler = &execute_lit<JMP>; break;
+			case JCN: handler = &execute_lit<JCN>; break;
+			case JSR: handler = &execute_lit<JSR>; break;
+			case EQU: handler = &execute_lit<EQU>; break;
+			case NEQ: handler = &execute_lit<NEQ>; break;
+			case GTH: handler = &execute_lit<GTH>; break;
+			case LTH: handler = &execute_lit<LTH>; break;
+			case ADD: handler = &execute_lit<ADD>; break;
+			case SUB: handler = &execute_lit<SUB>; break;
+			case MUL: handler = &execute_lit<MUL>; break;
+			case DIV: handler = &execute_lit<DIV>; break;
+			case AND: handler = &execute_lit<AND>; break;
+			case ORA: handler = &execute_lit<ORA>; break;
+			case EOR: handler = &execute_lit<EOR>; break;
+			case SFT: handler = &execute_lit<SFT>; break;
+			default: break;
+		}
+	} else if(instr == (LIT | KEEP | SHORT)) {
+		switch(memory[(uint16_t) (addr + 3)]) {
+			case JMP | SHORT: handler = &execute_lit2<JMP>; break;
+			case JCN | SHORT: handler = &execute_lit2<JCN>; break;
+			case JSR | SHORT: handler = &execute_lit2<JSR>; break;
+			default: break;
+		}
+	}
+
+	vm.m_code[addr] = handler;
+	return handler(vm);
+}
+
+void Uxn::invalidate(uint16_t addr, uint16_t length) {
+	//Anything decoded from up to MAX_FUSED_LENGTH - 1 bytes before the write could have included it
+	for(uint16_t i = 0; i < length + MAX_FUSED_LENGTH - 1; i++)
+		m_code[(uint16_t) (addr - (MAX_FUSED_LENGTH - 1) + i)] = &decode;
+}
+
 Duck::Result Uxn::load_rom(const Duck::Path& rom) {
 	auto file_res = Duck::File::open(rom, "r");
 	if(file_res.is_error())
@@ -235,8 +353,9 @@ Duck::Result Uxn::load_rom(const Duck::Path& rom) {
 	auto& file = file_res.value();
 
 	off_t size = file.stat().st_size;
-	if(size > m_memory.size())
+	if(size > m_memory.size() - 0x0100)
 		return {ENOSPC, "ROM too big!"};
 
+	std::fill(m_code.begin(), m_code.end(), &decode);
 	return file.read(m_memory.data() + 0x0100, size).result();
 }
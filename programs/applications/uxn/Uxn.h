@@ -22,10 +22,12 @@
 #include <cstdint>
 #include <vector>
 #include <memory>
+#include <array>
 #include <libduck/Result.h>
 #include <libduck/Path.h>
 
 class Device;
+class ScreenDevice;
 class Uxn {
 public:
 
@@ -57,14 +59,69 @@ public:
 
 	Uxn();
 
+	/**
+	 * Runs a single instruction.
+	 * @return False if the instruction was BRK.
+	 */
 	bool step();
+
+	/// Runs instructions until a BRK.
+	void run();
+
+	/**
+	 * Runs the code at a vector until a BRK.
+	 * @return False if the vector is zero, meaning the ROM didn't set it.
+	 */
+	bool eval(uint16_t vector);
+
 	Duck::Result load_rom(const Duck::Path& rom);
 
+	const uint8_t* memory() const { return m_memory.data(); }
+	const std::shared_ptr<ScreenDevice>& screen() const { return m_screen; }
+
 private:
+	using Handler = bool (*)(Uxn& vm);
+
+	/**
+	 * Runs an instruction. There's one of these for every possible instruction byte, so the opcode and modes are all
+	 * known at compile time and each one only does the work its instruction needs. When called, pc points just past the
+	 * instruction byte.
+	 */
+	template<uint8_t Instr>
+	static bool execute(Uxn& vm);
+
+	/**
+	 * Runs a LIT or LIT2 along with the instruction after it, for sequences common enough to be worth doing in one go.
+	 */
+	template<Opcode Op>
+	static bool execute_lit(Uxn& vm);
+	template<Opcode Op>
+	static bool execute_lit2(Uxn& vm);
+
+	/**
+	 * The handler for code that hasn't been run yet. It picks the handler for the instruction at pc - 1 (fusing it with
+	 * the ones after it if it can), saves it in m_code so it's used from then on, and runs it.
+	 */
+	static bool decode(Uxn& vm);
+
+	/// Forgets the handlers for any instructions that include the given bytes of memory, since they were written to.
+	void invalidate(uint16_t addr, uint16_t length);
+
+	template<Opcode Op>
+	static constexpr uint16_t alu(uint16_t b, uint16_t a);
+
+	template<size_t... Instrs>
+	static constexpr std::array<Handler, 256> make_handlers(std::index_sequence<Instrs...>);
+
+	static const std::array<Handler, 256> s_handlers;
+	static constexpr uint16_t MAX_FUSED_LENGTH = 4; ///< The number of bytes in the longest fused instruction (LIT2 xxxx JSR2)
+
 	std::vector<uint8_t> m_memory;
+	std::vector<Handler> m_code; ///< The handler to run for the instruction at each address in memory
 	Stack m_working_stack, m_return_stack;
 	uint16_t m_pc = 0x0100; //Program counter
 	std::shared_ptr<Device> m_devices[16];
+	std::shared_ptr<ScreenDevice> m_screen;
 };
 
 
@@ -16,12 +16,178 @@
     
     Copyright (c) Byteduck 2016-2022. All rights reserved.
 */
+
 #include "ScreenDevice.h"
+#include "../Uxn.h"
+
+//The color to draw each pixel of a sprite with, indexed by the pixel's value and the low nibble of the sprite byte
+static constexpr uint8_t blending[4][16] = {
+		{0, 0, 0, 0, 1, 0, 1, 1, 2, 2, 0, 2, 3, 3, 3, 0},
+		{0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3},
+		{1, 2, 3, 1, 1, 2, 3, 1, 1, 2, 3, 1, 1, 2, 3, 1},
+		{2, 3, 1, 2, 2, 3, 1, 2, 2, 3, 1, 2, 2, 3, 1, 2}
+};
+
+//Whether pixels with a value of zero are drawn, indexed by the low nibble of the sprite byte
+static constexpr bool opaque[16] = {
+		false, true, true, true, true, false, true, true,
+		true, true, false, true, true, true, true, false
+};
+
+ScreenDevice::ScreenDevice(Uxn& uxn): m_uxn(uxn) {
+	m_palette[0] = RGB(0xff, 0xff, 0xff);
+	m_palette[1] = RGB(0x00, 0x00, 0x00);
+	m_palette[2] = RGB(0x77, 0xdd, 0xbb);
+	m_palette[3] = RGB(0xff, 0x66, 0x22);
+
+	//A foreground pixel of color 0 is transparent, so the background shows through
+	for(int fg = 0; fg < 4; fg++)
+		for(int bg = 0; bg < 4; bg++)
+			m_colors[(fg << FOREGROUND) | bg] = m_palette[fg ? fg : bg];
+
+	resize(512, 320);
+}
 
 uint16_t ScreenDevice::read(uint8_t addr, bool is_short) {
-	return 0;
+	if(is_short)
+		return port16(addr);
+	return m_ports[addr & 0xfu];
 }
 
 void ScreenDevice::write(uint8_t addr, uint16_t val, bool is_short) {
+	if(is_short)
+		set_port16(addr, val);
+	else
+		m_ports[addr & 0xfu] = val;
+
+	//Act on the last byte written, so writing a short to the width or height only resizes once
+	uint8_t auto_mode = m_ports[0x6];
+	switch((addr + (is_short ? 1 : 0)) & 0xfu) {
+		case 0x3:
+		case 0x5:
+			resize(port16(0x2), port16(0x4));
+			break;
+
+		case 0xe: {
+			uint16_t x = port16(0x8), y = port16(0xa);
+			uint8_t pixel = m_ports[0xe];
+			draw_pixel(pixel & 0x40 ? FOREGROUND : BACKGROUND, x, y, pixel & 0x3u);
+			if(auto_mode & 0x1)
+				set_port16(0x8, x + 1);
+			if(auto_mode & 0x2)
+				set_port16(0xa, y + 1);
+			break;
+		}
+
+		case 0xf: {
+			uint16_t x = port16(0x8), y = port16(0xa), sprite_addr = port16(0xc);
+			uint8_t sprite = m_ports[0xf];
+			bool two_bpp = sprite & 0x80;
+			Layer layer = sprite & 0x40 ? FOREGROUND : BACKGROUND;
+			uint16_t dx = (auto_mode & 0x1) << 3, dy = (auto_mode & 0x2) << 2;
+			uint16_t addr_incr = (auto_mode & 0x4) << (1 + two_bpp);
+
+			//The high nibble of the auto byte is how many more sprites to draw, each one moved along the other axis
+			for(int i = 0; i <= auto_mode >> 4; i++) {
+				draw_sprite(layer, x + dy * i, y + dx * i, sprite_addr, sprite & 0xfu, sprite & 0x10, sprite & 0x20, two_bpp);
+				sprite_addr += addr_incr;
+			}
+
+			if(auto_mode & 0x1)
+				set_port16(0x8, x + dx);
+			if(auto_mode & 0x2)
+				set_port16(0xa, y + dy);
+			if(auto_mode & 0x4)
+				set_port16(0xc, sprite_addr);
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+Gfx::Rect ScreenDevice::composite(const Gfx::Framebuffer& framebuffer) {
+	auto area = m_dirty.overlapping_area({0, 0, framebuffer.width, framebuffer.height});
+	m_dirty = {0, 0, 0, 0};
+	if(area.width <= 0 || area.height <= 0)
+		return {0, 0, 0, 0};
+
+	for(int y = area.y; y < area.y + area.height; y++) {
+		const uint8_t* src = &m_pixels[y * m_width + area.x];
+		Gfx::Color* dst = &framebuffer.data[y * framebuffer.width + area.x];
+		for(int x = 0; x < area.width; x++)
+			dst[x] = m_colors[src[x]];
+	}
+
+	return area;
+}
+
+void ScreenDevice::invalidate() {
+	m_dirty = {0, 0, m_width, m_height};
+}
+
+void ScreenDevice::resize(int width, int height) {
+	if(width == m_width && height == m_height)
+		return;
+	m_width = width;
+	m_height = height;
+	m_pixels.assign(width * height, 0);
+	set_port16(0x2, width);
+	set_port16(0x4, height);
+	invalidate();
+}
+
+void ScreenDevice::draw_pixel(Layer layer, uint16_t x, uint16_t y, uint8_t color) {
+	if(x >= m_width || y >= m_height)
+		return;
+	auto& pixel = m_pixels[y * m_width + x];
+	pixel = (pixel & ~(0x3u << layer)) | (color << layer);
+	mark_dirty({x, y, 1, 1});
+}
+
+void ScreenDevice::draw_sprite(Layer layer, uint16_t x, uint16_t y, uint16_t addr, uint8_t color, bool flip_x, bool flip_y, bool two_bpp) {
+	const uint8_t* memory = m_uxn.memory();
+	bool draw_zero = opaque[color];
+	uint8_t mask = ~(0x3u << layer);
+
+	for(int v = 0; v < 8; v++) {
+		uint16_t py = y + (flip_y ? 7 - v : v);
+		if(py >= m_height)
+			continue;
+
+		//The low bit of each pixel is in the first 8 bytes of a sprite and the high bit (for 2bpp) is in the next 8
+		uint8_t low = memory[(uint16_t) (addr + v)];
+		uint8_t high = two_bpp ? memory[(uint16_t) (addr + v + 8)] : 0;
+		uint8_t* row = &m_pixels[py * m_width];
+		for(int h = 0; h < 8; h++) {
+			uint16_t px = x + (flip_x ? h : 7 - h);
+			uint8_t value = ((low >> h) & 1) | (((high >> h) & 1) << 1);
+			if(px >= m_width || (!value && !draw_zero))
+				continue;
+			row[px] = (row[px] & mask) | (blending[value][color] << layer);
+		}
+	}
+
+	//Sprites past the edge wrap around to the other side, so treat the position as signed
+	mark_dirty({(int16_t) x, (int16_t) y, 8, 8});
+}
+
+void ScreenDevice::mark_dirty(Gfx::Rect area) {
+	area = area.overlapping_area({0, 0, m_width, m_height});
+	if(area.width <= 0 || area.height <= 0)
+		return;
+	if(m_dirty.width <= 0 || m_dirty.height <= 0)
+		m_dirty = area;
+	else
+		m_dirty = m_dirty.combine(area);
+}
+
+uint16_t ScreenDevice::port16(uint8_t addr) const {
+	return ((uint16_t) m_ports[addr & 0xfu] << 8) | m_ports[(addr + 1) & 0xfu];
+}
 
+void ScreenDevice::set_port16(uint8_t addr, uint16_t val) {
+	m_ports[addr & 0xfu] = (uint8_t) (val >> 8);
+	m_ports[(addr + 1) & 0xfu] = (uint8_t) val;
 }
@@ -17,17 +17,59 @@
     Copyright (c) Byteduck 2016-2022. All rights reserved.
 */
 
+
 #pragma once
 
 #include "Device.h"
+#include <vector>
+#include <libgraphics/Framebuffer.h>
 
+class Uxn;
 class ScreenDevice: public Device {
 public:
-	ScreenDevice() = default;
+	explicit ScreenDevice(Uxn& uxn);
 	~ScreenDevice() override = default;
 
 	uint16_t read(uint8_t addr, bool is_short) override;
 	void write(uint8_t addr, uint16_t val, bool is_short) override;
-};
 
+	/// The address of the code to run every frame, or zero if the ROM didn't set one.
+	uint16_t vector() const { return port16(0x0); }
+	Gfx::Dimensions dimensions() const { return {m_width, m_height}; }
+
+	/// The area that has been drawn to since the last call to composite().
+	Gfx::Rect dirty_rect() const { return m_dirty; }
+
+	/**
+	 * Draws the area that changed since the last call into a framebuffer the size of the screen. The rest of the
+	 * framebuffer is left alone, so it should still contain the previous frame.
+	 * @return The area that was drawn.
+	 */
+	Gfx::Rect composite(const Gfx::Framebuffer& framebuffer);
+
+	/// Marks the whole screen as changed, for when the framebuffer it's composited into no longer has the last frame.
+	void invalidate();
+
+private:
+	/// Each layer's value is the shift of its bits in m_pixels.
+	enum Layer {
+		BACKGROUND = 0, FOREGROUND = 2
+	};
+
+	void resize(int width, int height);
+	void draw_pixel(Layer layer, uint16_t x, uint16_t y, uint8_t color);
+	void draw_sprite(Layer layer, uint16_t x, uint16_t y, uint16_t addr, uint8_t color, bool flip_x, bool flip_y, bool two_bpp);
+	void mark_dirty(Gfx::Rect area);
+
+	uint16_t port16(uint8_t addr) const;
+	void set_port16(uint8_t addr, uint16_t val);
+
+	Uxn& m_uxn;
+	uint8_t m_ports[16] = {0};
+	int m_width = 0, m_height = 0;
+	std::vector<uint8_t> m_pixels; ///< Both layers, with the foreground in bits 2-3 and the background in bits 0-1
+	Gfx::Color m_palette[4];
+	Gfx::Color m_colors[16]; ///< The color shown for every value in m_pixels, so compositing is a single lookup
+	Gfx::Rect m_dirty = {0, 0, 0, 0};
+};
 
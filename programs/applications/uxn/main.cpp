@@ -18,8 +18,10 @@
 */
 
 #include "Uxn.h"
+#include "ScreenWidget.h"
 #include <libduck/Args.h>
 #include <libduck/Stream.h>
+#include <libui/libui.h>
 
 Duck::Args args;
 std::string filename;
@@ -31,7 +33,32 @@ int main(int argc, char** argv, char** envp) {
 	auto res = machine.load_rom(filename);
 	if(res.is_error())
 		Duck::Stream::std_err << "Couldn't load rom " << filename << ": " << res.message() << "\n";
-	while(machine.step()) {}
+	machine.run();
 	fflush(stdout);
+
+	//If the ROM set a screen vector, it wants to draw, so give it a window and run the vector every frame
+	auto& screen = machine.screen();
+	if(!screen->vector())
+		return 0;
+
+	UI::init(argv, envp);
+	auto window = UI::Window::make();
+	window->set_title(Duck::Path(filename).basename());
+	auto screen_widget = ScreenWidget::make(machine);
+	window->set_contents(screen_widget);
+	window->set_resizable(false);
+	window->show();
+
+	auto dimensions = screen->dimensions();
+	auto frame_timer = UI::set_interval([&] {
+		screen_widget->frame();
+		fflush(stdout);
+		if(screen->dimensions() != dimensions) {
+			dimensions = screen->dimensions();
+			window->resize_to_contents();
+		}
+	}, 16);
+
+	UI::run();
 	return 0;
 }
\ No newline at end of file
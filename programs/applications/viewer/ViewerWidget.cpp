@@ -2,6 +2,25 @@
 /* Copyright © 2016-2022 Byteduck */
 
 #include "ViewerWidget.h"
+#include <libui/libui.h>
+#include <cstring>
+
+//Moves the pixels of a framebuffer by an offset in place, going through the rows in whichever order doesn't overwrite
+//ones that haven't been moved yet.
+static void scroll_pixels(const Gfx::Framebuffer& framebuffer, Gfx::Point delta) {
+	int width = framebuffer.width - std::abs(delta.x);
+	int height = framebuffer.height - std::abs(delta.y);
+	if(width <= 0 || height <= 0)
+		return;
+	int src_x = std::max(-delta.x, 0), dst_x = std::max(delta.x, 0);
+	int src_y = std::max(-delta.y, 0), dst_y = std::max(delta.y, 0);
+	for(int i = 0; i < height; i++) {
+		int y = delta.y > 0 ? height - 1 - i : i;
+		memmove(&framebuffer.data[dst_x + (dst_y + y) * framebuffer.width],
+				&framebuffer.data[src_x + (src_y + y) * framebuffer.width],
+				width * sizeof(Gfx::Color));
+	}
+}
 
 ViewerWidget::ViewerWidget(const Duck::Ptr<Gfx::Image>& image):
 	m_image(image),
@@ -9,22 +28,85 @@ ViewerWidget::ViewerWidget(const Duck::Ptr<Gfx::Image>& image):
 	{}
 
 void ViewerWidget::do_repaint(const UI::DrawContext& ctx) {
-	ctx.fill(ctx.rect(), UI::Theme::bg());
-	ctx.draw_image(m_image, m_image_rect.scaled(m_scale_factor));
+	auto& framebuffer = ctx.framebuffer();
+	auto rect = display_rect();
+
+	if(!m_canvas_valid) {
+		draw_area(framebuffer, ctx.rect());
+	} else if(rect.dimensions() != m_drawn_rect.dimensions()) {
+		//We zoomed, so the tiles have to be drawn again. Until they are, what was there before is stretched into place.
+		Gfx::Framebuffer old(framebuffer.width, framebuffer.height);
+		old.copy(framebuffer, ctx.rect(), {0, 0});
+		double factor = (double) rect.width / m_drawn_rect.width;
+		Gfx::Rect old_rect = {
+			rect.x - (int) (m_drawn_rect.x * factor),
+			rect.y - (int) (m_drawn_rect.y * factor),
+			(int) (framebuffer.width * factor),
+			(int) (framebuffer.height * factor)
+		};
+		framebuffer.fill(ctx.rect(), UI::Theme::bg());
+		framebuffer.draw_image_scaled(old, old_rect);
+		draw_area(framebuffer, ctx.rect(), false);
+	} else if(rect.position() != m_drawn_rect.position()) {
+		//We panned, so move what's already there and draw what was uncovered
+		auto delta = rect.position() - m_drawn_rect.position();
+		if(std::abs(delta.x) >= framebuffer.width || std::abs(delta.y) >= framebuffer.height) {
+			draw_area(framebuffer, ctx.rect());
+		} else {
+			scroll_pixels(framebuffer, delta);
+			if(delta.x > 0)
+				draw_area(framebuffer, {0, 0, delta.x, framebuffer.height});
+			else if(delta.x < 0)
+				draw_area(framebuffer, {framebuffer.width + delta.x, 0, -delta.x, framebuffer.height});
+			if(delta.y > 0)
+				draw_area(framebuffer, {0, 0, framebuffer.width, delta.y});
+			else if(delta.y < 0)
+				draw_area(framebuffer, {0, framebuffer.height + delta.y, framebuffer.width, -delta.y});
+		}
+	}
+
+	//If the image changed, its tiles have to be drawn again. Until they are, what was there before is left in place.
+	if(m_redraw_tiles && m_canvas_valid)
+		draw_area(framebuffer, ctx.rect(), false);
+
+	//Copy in the tiles that were filled in since last time
+	if(m_canvas_valid) {
+		for(auto& key : m_finished_tiles)
+			draw_area(framebuffer, tile_rect(key).overlapping_area(ctx.rect()));
+	}
+	m_finished_tiles.clear();
+
+	m_redraw_tiles = false;
+	m_canvas_valid = true;
+	m_drawn_rect = rect;
 }
 
 void ViewerWidget::on_layout_change(const Gfx::Rect& old_rect) {
 	auto centered_rect = m_image_rect.centered_on(Gfx::Rect {0, 0, current_size()}.center());
 	m_image_rect.set_position(centered_rect.position());
+	m_canvas_valid = false;
 }
 
 Gfx::Dimensions ViewerWidget::preferred_size() {
 	return m_image_rect.dimensions() * m_scale_factor;
 }
 
+void ViewerWidget::set_image(const Duck::Ptr<Gfx::Image>& image) {
+	m_image = image;
+	m_image_rect.set_dimensions(image->size());
+	image_changed();
+}
+
+void ViewerWidget::image_changed() {
+	invalidate_tiles();
+	m_redraw_tiles = true;
+	repaint();
+}
+
 bool ViewerWidget::on_mouse_scroll(Pond::MouseScrollEvent evt) {
 	m_scale_factor -= evt.scroll * m_scale_factor * 0.1;
 	m_scale_factor = std::clamp(m_scale_factor, 0.01, 100.0);
+	invalidate_tiles();
 	repaint();
 	return true;
 }
@@ -36,3 +118,100 @@ bool ViewerWidget::on_mouse_move(Pond::MouseMoveEvent evt) {
 	}
 	return true;
 }
+
+Gfx::Rect ViewerWidget::display_rect() const {
+	return m_image_rect.scaled(m_scale_factor);
+}
+
+Gfx::Rect ViewerWidget::tile_rect(TileKey key) const {
+	auto rect = display_rect();
+	return {rect.x + key.first * TILE_SIZE, rect.y + key.second * TILE_SIZE, TILE_SIZE, TILE_SIZE};
+}
+
+void ViewerWidget::draw_area(const Gfx::Framebuffer& framebuffer, Gfx::Rect area, bool clear) {
+	if(clear)
+		framebuffer.fill(area, UI::Theme::bg());
+
+	auto rect = display_rect();
+	auto image_area = area.overlapping_area(rect);
+	if(image_area.width <= 0 || image_area.height <= 0)
+		return;
+
+	int first_x = (image_area.x - rect.x) / TILE_SIZE;
+	int first_y = (image_area.y - rect.y) / TILE_SIZE;
+	int last_x = (image_area.x + image_area.width - 1 - rect.x) / TILE_SIZE;
+	int last_y = (image_area.y + image_area.height - 1 - rect.y) / TILE_SIZE;
+	for(int y = first_y; y <= last_y; y++) {
+		for(int x = first_x; x <= last_x; x++) {
+			auto tile_it = m_tiles.find({x, y});
+			if(tile_it == m_tiles.end()) {
+				m_missing_tiles.insert({x, y});
+				continue;
+			}
+			auto& tile = tile_it->second;
+			tile.last_used = ++m_tile_clock;
+			auto tile_area = tile_rect({x, y});
+			auto copy_area = tile_area.overlapping_area(area);
+			framebuffer.copy(tile.framebuffer, {copy_area.position() - tile_area.position(), copy_area.dimensions()}, copy_area.position());
+		}
+	}
+
+	if(!m_missing_tiles.empty())
+		schedule_fill();
+}
+
+void ViewerWidget::render_tile(TileKey key) {
+	//Make room for it if we have to by getting rid of whichever tile was used the longest ago
+	if(m_tiles.size() >= MAX_TILES) {
+		auto oldest = m_tiles.begin();
+		for(auto it = m_tiles.begin(); it != m_tiles.end(); it++) {
+			if(it->second.last_used < oldest->second.last_used)
+				oldest = it;
+		}
+		m_tiles.erase(oldest);
+	}
+
+	//The tile includes the background, so it can be copied straight onto the screen
+	Gfx::Framebuffer framebuffer(TILE_SIZE, TILE_SIZE);
+	framebuffer.fill({0, 0, TILE_SIZE, TILE_SIZE}, UI::Theme::bg());
+	m_image->draw(framebuffer, {-key.first * TILE_SIZE, -key.second * TILE_SIZE, display_rect().dimensions()});
+	m_tiles[key] = {std::move(framebuffer), ++m_tile_clock};
+}
+
+void ViewerWidget::fill_next_tile() {
+	m_fill_scheduled = false;
+
+	//Draw the next tile that's still on screen, and then come back for the rest
+	Gfx::Rect visible = {0, 0, current_size()};
+	while(!m_missing_tiles.empty()) {
+		auto key = *m_missing_tiles.begin();
+		m_missing_tiles.erase(m_missing_tiles.begin());
+		auto rect = tile_rect(key);
+		if(m_tiles.count(key) || !rect.collides(visible))
+			continue;
+		render_tile(key);
+		m_finished_tiles.push_back(key);
+		repaint(rect);
+		break;
+	}
+
+	if(!m_missing_tiles.empty())
+		schedule_fill();
+}
+
+void ViewerWidget::schedule_fill() {
+	if(m_fill_scheduled)
+		return;
+	m_fill_scheduled = true;
+	Duck::WeakPtr<ViewerWidget> weak_self = self();
+	UI::set_timeout([weak_self] {
+		if(auto viewer = weak_self.lock())
+			viewer->fill_next_tile();
+	}, 0);
+}
+
+void ViewerWidget::invalidate_tiles() {
+	m_tiles.clear();
+	m_missing_tiles.clear();
+	m_finished_tiles.clear();
+}
@@ -5,11 +5,21 @@
 
 #include <libui/widget/Widget.h>
 #include <libui/widget/Image.h>
+#include <map>
+#include <set>
 
+/**
+ * Shows an image that can be panned and zoomed. The image is drawn at the current zoom level in tiles, which are kept
+ * around so panning only needs to copy them (and when it can, just moves the pixels already on screen). Tiles that
+ * aren't drawn yet are filled in a few at a time from the event loop, so zooming doesn't hold anything up.
+ */
 class ViewerWidget: public UI::Widget {
 public:
 	WIDGET_DEF(ViewerWidget)
 
+	static constexpr int TILE_SIZE = 256;
+	static constexpr size_t MAX_TILES = 48; ///< How many tiles to keep around at most (about 12MiB of them).
+
 	void do_repaint(const UI::DrawContext& ctx) override;
 	void on_layout_change(const Gfx::Rect& old_rect) override;
 
@@ -18,10 +28,47 @@ public:
 	bool on_mouse_scroll(Pond::MouseScrollEvent evt) override;
 	bool on_mouse_move(Pond::MouseMoveEvent evt) override;
 
+	void set_image(const Duck::Ptr<Gfx::Image>& image);
+	/// Should be called when the pixels of the image change (like when more of it is decoded), so it's drawn again.
+	void image_changed();
+
 private:
+	using TileKey = std::pair<int, int>;
+
+	struct Tile {
+		Gfx::Framebuffer framebuffer;
+		size_t last_used;
+	};
+
 	ViewerWidget(const Duck::Ptr<Gfx::Image>& image);
 
+	/// Where the image is drawn in the widget, at the current zoom level.
+	Gfx::Rect display_rect() const;
+	Gfx::Rect tile_rect(TileKey key) const;
+
+	/**
+	 * Draws the tiles in an area of the widget, and notes down the ones that haven't been drawn yet so they're filled
+	 * in later.
+	 * @param clear Whether to clear the area first. Otherwise, whatever is already there is left as a placeholder for
+	 *              any missing tiles.
+	 */
+	void draw_area(const Gfx::Framebuffer& framebuffer, Gfx::Rect area, bool clear = true);
+	void render_tile(TileKey key);
+	void fill_next_tile();
+	void schedule_fill();
+	void invalidate_tiles();
+
 	Duck::Ptr<Gfx::Image> m_image;
 	Gfx::Rect m_image_rect;
 	double m_scale_factor = 1.0;
+
+	std::map<TileKey, Tile> m_tiles;
+	std::set<TileKey> m_missing_tiles; ///< Tiles that were needed on screen but haven't been drawn yet.
+	std::vector<TileKey> m_finished_tiles; ///< Tiles that were drawn since the last repaint, which need to be copied.
+	size_t m_tile_clock = 0;
+	bool m_fill_scheduled = false;
+
+	bool m_canvas_valid = false; ///< Whether the pixels in our framebuffer are what was drawn at m_drawn_rect.
+	bool m_redraw_tiles = false; ///< Whether the tiles were thrown out since the last repaint, and need to be drawn again.
+	Gfx::Rect m_drawn_rect;
 };
@@ -4,10 +4,54 @@
 #include <libui/widget/Label.h>
 #include <libui/widget/Image.h>
 #include <libui/bits/FilePicker.h>
+#include <libgraphics/PNG.h>
 #include "ViewerWidget.h"
 
 using namespace Duck;
 
+#define LOAD_CHUNK_SIZE (64 * 1024)
+
+static FILE* png_file = nullptr;
+static Gfx::PNGDecoder* png_decoder = nullptr;
+static bool png_rows_changed = false;
+static std::vector<uint8_t> png_buffer(LOAD_CHUNK_SIZE);
+
+//Feeds the next part of the file to the decoder. Returns false once there's nothing more to decode.
+static bool read_png() {
+	size_t nread = fread(png_buffer.data(), 1, png_buffer.size(), png_file);
+	return nread && png_decoder->feed(png_buffer.data(), nread) && !png_decoder->done();
+}
+
+//Opens a PNG and decodes just enough of it to know how big it is, so it can be shown while the rest is decoded.
+static Ptr<Gfx::Image> start_png(const Duck::Path& path) {
+	png_file = fopen(path.string().c_str(), "r");
+	if(!png_file)
+		return nullptr;
+	png_decoder = new Gfx::PNGDecoder();
+	png_decoder->on_rows = [](int first_row, int num_rows) { png_rows_changed = true; };
+	while(!png_decoder->image() && read_png());
+	if(!png_decoder->image()) {
+		delete png_decoder;
+		fclose(png_file);
+		return nullptr;
+	}
+	return Gfx::Image::take(new Gfx::Framebuffer(*png_decoder->image()));
+}
+
+//Decodes a bit more of the PNG each time through the event loop, and repaints the rows that came out of it.
+static void continue_png(const Ptr<ViewerWidget>& viewer) {
+	if(read_png()) {
+		if(png_rows_changed)
+			viewer->image_changed();
+		png_rows_changed = false;
+		UI::set_timeout([viewer] { continue_png(viewer); }, 0);
+		return;
+	}
+	viewer->set_image(Gfx::Image::take(png_decoder->take_image()));
+	delete png_decoder;
+	fclose(png_file);
+}
+
 int main(int argc, char** argv, char** envp) {
 	UI::init(argv, envp);
 
@@ -22,16 +66,17 @@ int main(int argc, char** argv, char** envp) {
 	}
 
 	auto window = UI::Window::make();
-	auto image = Gfx::Image::load(image_path);
+	auto partial_image = image_path.extension() == "png" ? start_png(image_path) : nullptr;
+	auto image = partial_image ? ResultRet<Ptr<Gfx::Image>>(partial_image) : Gfx::Image::load(image_path);
 
 	if(image.is_error()) {
 		window->set_contents(UI::Label::make(image.message()));
 	} else {
-		window->set_contents(({
-			auto img = ViewerWidget::make(image.value());
-			img->set_sizing_mode(UI::FILL);
-			img;
-		}));
+		auto viewer = ViewerWidget::make(image.value());
+		viewer->set_sizing_mode(UI::FILL);
+		window->set_contents(viewer);
+		if(partial_image)
+			UI::set_timeout([viewer] { continue_png(viewer); }, 0);
 	}
 
 	window->set_title("Viewer: " + std::string(image.has_value() ? image_path : "No Image"));
@@ -0,0 +1,83 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+// The file benchmarks work on a file in /tmp, which is on the root ext2 filesystem. Reads will mostly come from the page
+// cache, since the file was just written, so these measure the filesystem's overhead more than the disk's.
+
+#include "Benchmark.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+#define FILE_BENCH_PATH "/tmp/benchmark-file"
+#define FILE_BENCH_SIZE (8 * 1024 * 1024)
+#define FILE_SEQ_CHUNK_SIZE (64 * 1024)
+#define FILE_RANDOM_CHUNK_SIZE 4096
+
+static char s_buffer[FILE_SEQ_CHUNK_SIZE];
+
+/// Makes the file the benchmarks read from, returning an fd for it or -1 if it couldn't be made.
+static int create_file() {
+	int fd = open(FILE_BENCH_PATH, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0)
+		return -1;
+	for(size_t i = 0; i < FILE_BENCH_SIZE / sizeof(s_buffer); i++) {
+		if(write(fd, s_buffer, sizeof(s_buffer)) != sizeof(s_buffer)) {
+			close(fd);
+			return -1;
+		}
+	}
+	fsync(fd);
+	return fd;
+}
+
+BENCHMARK(file_seq_write) {
+	int fd = open(FILE_BENCH_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0) {
+		bench.skip("Couldn't create " FILE_BENCH_PATH);
+		return;
+	}
+
+	bench.set_iterations(FILE_BENCH_SIZE / FILE_SEQ_CHUNK_SIZE);
+	bench.set_bytes_per_iteration(FILE_SEQ_CHUNK_SIZE);
+	while(bench.iterate())
+		write(fd, s_buffer, FILE_SEQ_CHUNK_SIZE);
+
+	close(fd);
+	unlink(FILE_BENCH_PATH);
+}
+
+BENCHMARK(file_seq_read) {
+	int fd = create_file();
+	if(fd < 0) {
+		bench.skip("Couldn't create " FILE_BENCH_PATH);
+		return;
+	}
+
+	bench.set_iterations(FILE_BENCH_SIZE / FILE_SEQ_CHUNK_SIZE);
+	bench.set_bytes_per_iteration(FILE_SEQ_CHUNK_SIZE);
+	lseek(fd, 0, SEEK_SET);
+	while(bench.iterate())
+		read(fd, s_buffer, FILE_SEQ_CHUNK_SIZE);
+
+	close(fd);
+	unlink(FILE_BENCH_PATH);
+}
+
+BENCHMARK(file_random_read) {
+	int fd = create_file();
+	if(fd < 0) {
+		bench.skip("Couldn't create " FILE_BENCH_PATH);
+		return;
+	}
+
+	bench.set_bytes_per_iteration(FILE_RANDOM_CHUNK_SIZE);
+	uint32_t seed = 12345;
+	while(bench.iterate()) {
+		seed = seed * 1103515245 + 12345;
+		off_t offset = (off_t) ((seed >> 8) % (FILE_BENCH_SIZE / FILE_RANDOM_CHUNK_SIZE)) * FILE_RANDOM_CHUNK_SIZE;
+		pread(fd, s_buffer, FILE_RANDOM_CHUNK_SIZE, offset);
+	}
+
+	close(fd);
+	unlink(FILE_BENCH_PATH);
+}
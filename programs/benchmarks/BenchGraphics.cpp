@@ -0,0 +1,156 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Benchmark.h"
+#include <libgraphics/Framebuffer.h>
+#include <libgraphics/Font.h>
+#include <libgraphics/PNG.h>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+// The size of the framebuffers drawn to, which is about what a big window would be
+#define GFX_WIDTH 640
+#define GFX_HEIGHT 480
+// The size of a whole screen, which is big enough for fills to be written around the cache
+#define GFX_SCREEN_WIDTH 1920
+#define GFX_SCREEN_HEIGHT 1080
+#define GFX_FONT_PATH "/usr/share/fonts/gohufont-14.font"
+#define GFX_PNG_PATH "/usr/share/wallpapers/duck.png"
+
+using namespace Gfx;
+
+/// Fails the benchmark if any pixel in a framebuffer isn't what the plain per-pixel version would have drawn.
+static void check_pixels(Benchmark& bench, const Framebuffer& buffer, const std::function<Color(int, int)>& expected) {
+	for(int y = 0; y < buffer.height; y++) {
+		for(int x = 0; x < buffer.width; x++) {
+			if(buffer.data[x + y * buffer.width].value != expected(x, y).value) {
+				bench.fail("Wrong pixel at " + std::to_string(x) + ", " + std::to_string(y));
+				return;
+			}
+		}
+	}
+}
+
+BENCHMARK(gfx_fill) {
+	Framebuffer dest(GFX_WIDTH, GFX_HEIGHT);
+	bench.set_bytes_per_iteration(GFX_WIDTH * GFX_HEIGHT * sizeof(Color));
+	while(bench.iterate())
+		dest.fill({0, 0, GFX_WIDTH, GFX_HEIGHT}, RGB(30, 60, 90));
+	check_pixels(bench, dest, [](int, int) { return RGB(30, 60, 90); });
+}
+
+BENCHMARK(gfx_fill_screen) {
+	Framebuffer dest(GFX_SCREEN_WIDTH, GFX_SCREEN_HEIGHT);
+	bench.set_iterations(100);
+	bench.set_bytes_per_iteration(GFX_SCREEN_WIDTH * GFX_SCREEN_HEIGHT * sizeof(Color));
+	while(bench.iterate())
+		dest.fill({0, 0, GFX_SCREEN_WIDTH, GFX_SCREEN_HEIGHT}, RGB(30, 60, 90));
+	check_pixels(bench, dest, [](int, int) { return RGB(30, 60, 90); });
+}
+
+BENCHMARK(gfx_gradient_h) {
+	Framebuffer dest(GFX_WIDTH, GFX_HEIGHT);
+	auto color_a = RGB(30, 60, 90);
+	auto color_b = RGB(200, 150, 100);
+	bench.set_bytes_per_iteration(GFX_WIDTH * GFX_HEIGHT * sizeof(Color));
+	while(bench.iterate())
+		dest.fill_gradient_h({0, 0, GFX_WIDTH, GFX_HEIGHT}, color_a, color_b);
+	check_pixels(bench, dest, [&](int x, int) { return color_a.mixed(color_b, (float) x / GFX_WIDTH); });
+}
+
+BENCHMARK(gfx_gradient_v) {
+	Framebuffer dest(GFX_WIDTH, GFX_HEIGHT);
+	auto color_a = RGB(30, 60, 90);
+	auto color_b = RGB(200, 150, 100);
+	bench.set_bytes_per_iteration(GFX_WIDTH * GFX_HEIGHT * sizeof(Color));
+	while(bench.iterate())
+		dest.fill_gradient_v({0, 0, GFX_WIDTH, GFX_HEIGHT}, color_a, color_b);
+	check_pixels(bench, dest, [&](int, int y) { return color_a.mixed(color_b, (float) y / GFX_HEIGHT); });
+}
+
+BENCHMARK(gfx_multiply) {
+	Framebuffer dest(GFX_WIDTH, GFX_HEIGHT);
+	Framebuffer original(GFX_WIDTH, GFX_HEIGHT);
+	for(int i = 0; i < GFX_WIDTH * GFX_HEIGHT; i++)
+		original.data[i] = RGBA(i, i >> 3, i >> 6, 255 - i);
+	memcpy(dest.data, original.data, GFX_WIDTH * GFX_HEIGHT * sizeof(Color));
+
+	// Check one multiply first, since the pixels keep getting darker with every iteration
+	auto color = RGBA(200, 150, 100, 180);
+	dest.multiply(color);
+	check_pixels(bench, dest, [&](int x, int y) { return original.data[x + y * GFX_WIDTH] * color; });
+
+	bench.set_bytes_per_iteration(GFX_WIDTH * GFX_HEIGHT * sizeof(Color));
+	while(bench.iterate())
+		dest.multiply(color);
+}
+
+BENCHMARK(gfx_fill_blend) {
+	Framebuffer dest(GFX_WIDTH, GFX_HEIGHT);
+	bench.set_bytes_per_iteration(GFX_WIDTH * GFX_HEIGHT * sizeof(Color));
+	while(bench.iterate())
+		dest.fill_blitting({0, 0, GFX_WIDTH, GFX_HEIGHT}, RGBA(30, 60, 90, 128));
+}
+
+BENCHMARK(gfx_copy) {
+	Framebuffer src(GFX_WIDTH, GFX_HEIGHT);
+	Framebuffer dest(GFX_WIDTH, GFX_HEIGHT);
+	src.fill({0, 0, GFX_WIDTH, GFX_HEIGHT}, RGB(30, 60, 90));
+	bench.set_bytes_per_iteration(GFX_WIDTH * GFX_HEIGHT * sizeof(Color));
+	while(bench.iterate())
+		dest.copy_noalpha(src, {0, 0, GFX_WIDTH, GFX_HEIGHT}, {0, 0});
+}
+
+BENCHMARK(gfx_blend) {
+	Framebuffer src(GFX_WIDTH, GFX_HEIGHT);
+	Framebuffer dest(GFX_WIDTH, GFX_HEIGHT);
+	// A gradient of alpha, so the blend can't take the shortcuts for fully opaque or transparent pixels everywhere
+	for(int y = 0; y < GFX_HEIGHT; y++)
+		src.fill({0, y, GFX_WIDTH, 1}, RGBA(200, 100, 50, y * 255 / GFX_HEIGHT));
+	bench.set_bytes_per_iteration(GFX_WIDTH * GFX_HEIGHT * sizeof(Color));
+	while(bench.iterate())
+		dest.copy_blitting(src, {0, 0, GFX_WIDTH, GFX_HEIGHT}, {0, 0});
+}
+
+BENCHMARK(gfx_text) {
+	auto* font = Font::load_shm(GFX_FONT_PATH);
+	if(!font) {
+		bench.skip("Couldn't load " GFX_FONT_PATH);
+		return;
+	}
+
+	Framebuffer dest(GFX_WIDTH, GFX_HEIGHT);
+	static const char* line = "The quick brown fox jumps over the lazy duck. 0123456789";
+	bench.set_bytes_per_iteration(strlen(line));
+	while(bench.iterate())
+		dest.draw_text(line, {4, 4}, font, RGB(255, 255, 255));
+	// Fonts can't be freed, but the shm they're in goes away when we exit
+}
+
+BENCHMARK(png_decode) {
+	FILE* file = fopen(GFX_PNG_PATH, "rb");
+	if(!file) {
+		bench.skip("Couldn't open " GFX_PNG_PATH);
+		return;
+	}
+	std::vector<uint8_t> data;
+	uint8_t buf[4096];
+	size_t nread;
+	while((nread = fread(buf, 1, sizeof(buf), file)) > 0)
+		data.insert(data.end(), buf, buf + nread);
+	fclose(file);
+
+	bench.set_iterations(20);
+	bench.set_bytes_per_iteration(data.size());
+	while(bench.iterate()) {
+		auto* image = load_png_from_memory(data.data(), data.size());
+		if(!image) {
+			bench.skip("Couldn't decode " GFX_PNG_PATH);
+			return;
+		}
+		bench.pause();
+		delete image;
+		bench.resume();
+	}
+}
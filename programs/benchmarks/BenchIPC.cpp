@@ -0,0 +1,169 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Benchmark.h"
+#include <libriver/river.h>
+#include <libpond/pond.h>
+#include <sys/socketfs.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cstdlib>
+
+#define IPC_MESSAGE_SIZE 64
+
+// Sends a message over a SocketFS socket to another process, which sends it straight back
+BENCHMARK(socketfs_roundtrip) {
+	auto path = "/sock/benchmark-" + std::to_string(getpid());
+	int host_fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC);
+	if(host_fd < 0) {
+		bench.skip("Couldn't create a socket");
+		return;
+	}
+
+	pid_t child = fork();
+	if(child < 0) {
+		bench.skip("Couldn't fork");
+		return;
+	} else if(child == 0) {
+		int fd = open(path.c_str(), O_RDWR);
+		if(fd < 0)
+			_exit(1);
+		while(auto* packet = read_packet(fd)) {
+			write_packet_to_host(fd, packet->length, packet->data);
+			free(packet);
+		}
+		_exit(0);
+	}
+
+	// Wait for the child to connect so we know who to send to
+	sockid_t client = 0;
+	while(auto* packet = read_packet(host_fd)) {
+		bool connected = packet->type == SOCKETFS_TYPE_MSG_CONNECT;
+		client = packet->connected_id;
+		free(packet);
+		if(connected)
+			break;
+	}
+
+	uint8_t message[IPC_MESSAGE_SIZE] = {};
+	while(bench.iterate()) {
+		write_packet(host_fd, client, sizeof(message), message);
+		free(read_packet(host_fd));
+	}
+
+	kill(child, SIGKILL);
+	waitpid(child, nullptr, 0);
+	close(host_fd);
+}
+
+/**
+ * Calls a libriver function that's hosted by another process. The other process runs its own bus server, so that
+ * the call goes from us to the server and on to the function in one hop like calls to pond and the other services do.
+ */
+static void bench_river_call(Benchmark& bench, bool use_ring) {
+	auto name = "benchmark-" + std::to_string(getpid());
+	int ready[2];
+	if(pipe(ready) < 0) {
+		bench.skip("Couldn't create a pipe");
+		return;
+	}
+
+	pid_t child = fork();
+	if(child < 0) {
+		bench.skip("Couldn't fork");
+		return;
+	} else if(child == 0) {
+		close(ready[0]);
+		auto server_res = River::BusServer::create(name);
+		if(server_res.is_error())
+			_exit(1);
+		auto connection = server_res.value()->connect_local();
+		auto endpoint_res = connection->register_endpoint(name);
+		if(endpoint_res.is_error())
+			_exit(1);
+		auto func_res = endpoint_res.value()->register_function<int, int>("echo", [](sockid_t, int value) {
+			return value;
+		});
+		if(func_res.is_error())
+			_exit(1);
+		write(ready[1], "", 1);
+		close(ready[1]);
+		while(true)
+			connection->read_and_handle_packets(true);
+	}
+
+	close(ready[1]);
+	char c;
+	bool started = read(ready[0], &c, 1) == 1;
+	close(ready[0]);
+	if(!started) {
+		bench.skip("Couldn't start the bus server");
+		waitpid(child, nullptr, 0);
+		return;
+	}
+
+	auto run = [&] {
+		auto connection_res = River::BusConnection::connect(name);
+		if(connection_res.is_error())
+			return bench.skip("Couldn't connect to the bus server");
+		auto connection = connection_res.value();
+		if(use_ring && connection->use_shared_ring().is_error())
+			return bench.skip("Couldn't set up a shared ring");
+		auto endpoint_res = connection->get_endpoint(name);
+		if(endpoint_res.is_error())
+			return bench.skip("Couldn't get the endpoint");
+		auto func_res = endpoint_res.value()->get_function<int, int>("echo");
+		if(func_res.is_error())
+			return bench.skip("Couldn't get the function");
+		auto echo = func_res.value();
+
+		int value = 0;
+		while(bench.iterate())
+			value = echo(value + 1);
+	};
+	run();
+
+	kill(child, SIGKILL);
+	waitpid(child, nullptr, 0);
+}
+
+BENCHMARK(river_call) {
+	bench_river_call(bench, false);
+}
+
+BENCHMARK(river_call_ring) {
+	bench_river_call(bench, true);
+}
+
+/**
+ * Invalidates a window and then makes a call to pond that has to be answered, which it only gets to once it's taken
+ * the window's new buffer. Pond doesn't tell clients when a buffer has actually made it to the screen, so this is the
+ * closest thing to invalidate-to-flip latency that can be measured from a client.
+ */
+BENCHMARK(pond_invalidate) {
+	auto* context = Pond::Context::init();
+	if(!context) {
+		bench.skip("Couldn't connect to pond");
+		return;
+	}
+
+	auto* window = context->create_window(nullptr, {0, 0, 128, 128}, false);
+	if(!window) {
+		bench.skip("Couldn't create a window");
+		return;
+	}
+	window->set_title("Benchmark");
+
+	int frame = 0;
+	while(bench.iterate()) {
+		bench.pause();
+		window->framebuffer().fill({0, 0, 128, 128}, RGB(frame++ & 0xFF, 0, 0));
+		bench.resume();
+		window->invalidate();
+		context->get_display_dimensions();
+	}
+
+	window->destroy();
+}
@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Benchmark.h"
+#include <cstdlib>
+
+// How many allocations are kept alive at once, and how many are swapped out for new ones each iteration
+#define MALLOC_LIVE_ALLOCATIONS 1024
+#define MALLOC_ALLOCATIONS_PER_ITERATION 256
+
+// Frees and allocates blocks of mixed sizes while others stay alive, like a program building and throwing away strings
+// and containers would
+BENCHMARK(malloc_churn) {
+	void* live[MALLOC_LIVE_ALLOCATIONS] = {};
+	uint32_t seed = 12345;
+	auto next_random = [&] {
+		seed = seed * 1103515245 + 12345;
+		return seed >> 16;
+	};
+
+	while(bench.iterate()) {
+		for(int i = 0; i < MALLOC_ALLOCATIONS_PER_ITERATION; i++) {
+			auto slot = next_random() % MALLOC_LIVE_ALLOCATIONS;
+			free(live[slot]);
+			// Mostly small allocations, with the occasional bigger one
+			size_t size = (next_random() % 8) ? 8 + next_random() % 256 : 4096 + next_random() % 32768;
+			live[slot] = malloc(size);
+			*(volatile char*) live[slot] = 0;
+		}
+	}
+
+	for(auto allocation : live)
+		free(allocation);
+}
+
+BENCHMARK(malloc_small) {
+	while(bench.iterate()) {
+		void* allocation = malloc(32);
+		*(volatile char*) allocation = 0;
+		free(allocation);
+	}
+}
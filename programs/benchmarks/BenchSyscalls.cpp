@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Benchmark.h"
+#include <unistd.h>
+#include <sys/wait.h>
+#include <cstdlib>
+
+#define PIPE_CHUNK_SIZE (64 * 1024)
+
+BENCHMARK(syscall_getpid) {
+	while(bench.iterate())
+		getpid();
+}
+
+// Writes to a pipe that another process is reading everything out of
+BENCHMARK(pipe_throughput) {
+	int fds[2];
+	if(pipe(fds) < 0) {
+		bench.skip("Couldn't create a pipe");
+		return;
+	}
+
+	pid_t reader = fork();
+	if(reader < 0) {
+		bench.skip("Couldn't fork");
+		return;
+	} else if(reader == 0) {
+		close(fds[1]);
+		static char buf[PIPE_CHUNK_SIZE];
+		while(read(fds[0], buf, sizeof(buf)) > 0);
+		_exit(0);
+	}
+
+	close(fds[0]);
+	static char buf[PIPE_CHUNK_SIZE];
+	bench.set_bytes_per_iteration(sizeof(buf));
+	while(bench.iterate()) {
+		size_t written = 0;
+		while(written < sizeof(buf)) {
+			auto res = write(fds[1], buf + written, sizeof(buf) - written);
+			if(res <= 0)
+				break;
+			written += res;
+		}
+	}
+
+	close(fds[1]);
+	waitpid(reader, nullptr, 0);
+}
+
+// Writes a byte to a pipe and waits for another process to send it back, which is mostly the cost of switching to it
+BENCHMARK(pipe_roundtrip) {
+	int to_child[2], from_child[2];
+	if(pipe(to_child) < 0 || pipe(from_child) < 0) {
+		bench.skip("Couldn't create a pipe");
+		return;
+	}
+
+	pid_t child = fork();
+	if(child < 0) {
+		bench.skip("Couldn't fork");
+		return;
+	} else if(child == 0) {
+		close(to_child[1]);
+		close(from_child[0]);
+		char c;
+		while(read(to_child[0], &c, 1) > 0)
+			write(from_child[1], &c, 1);
+		_exit(0);
+	}
+
+	close(to_child[0]);
+	close(from_child[1]);
+	char c = 'q';
+	while(bench.iterate()) {
+		write(to_child[1], &c, 1);
+		read(from_child[0], &c, 1);
+	}
+
+	close(to_child[1]);
+	close(from_child[0]);
+	waitpid(child, nullptr, 0);
+}
@@ -0,0 +1,157 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Benchmark.h"
+#include <libduck/Time.h>
+#include <algorithm>
+#include <cstdio>
+
+BenchmarkRegistry& BenchmarkRegistry::inst() {
+	static BenchmarkRegistry registry;
+	return registry;
+}
+
+bool BenchmarkRegistry::register_bench(const BenchmarkEntry& bench) {
+	m_benchmarks.push_back(bench);
+	return true;
+}
+
+void BenchmarkRegistry::list() {
+	for(auto& benchmark : m_benchmarks)
+		printf("%s\n", benchmark.name);
+}
+
+static void print_json_string(const char* str) {
+	putchar('"');
+	for(; *str; str++) {
+		if(*str == '"' || *str == '\\')
+			putchar('\\');
+		if((unsigned char) *str < ' ')
+			continue;
+		putchar(*str);
+	}
+	putchar('"');
+}
+
+int BenchmarkRegistry::run(const std::string& filter, size_t iterations) {
+	// Time an empty loop first, so the cost of timing each iteration can be taken out of the results
+	Benchmark empty(BENCH_ITERATIONS);
+	while(empty.iterate());
+	auto overhead = empty.fastest();
+
+	int num_run = 0;
+	for(auto& benchmark : m_benchmarks) {
+		if(!filter.empty() && std::string(benchmark.name).rfind(filter, 0) != 0)
+			continue;
+
+		Benchmark bench(BENCH_ITERATIONS);
+		if(iterations)
+			bench.set_iterations(iterations);
+		benchmark.func(bench);
+		num_run++;
+
+		printf("{\"name\": ");
+		print_json_string(benchmark.name);
+		if(!bench.skip_reason().empty() || !bench.num_samples()) {
+			printf(", \"skipped\": ");
+			print_json_string(bench.skip_reason().empty() ? "No iterations were run" : bench.skip_reason().c_str());
+			printf("}\n");
+			fflush(stdout);
+			continue;
+		}
+
+		bench.subtract_overhead(overhead);
+		printf(", \"iterations\": %lu, \"min_cycles\": %llu, \"median_cycles\": %llu, \"p99_cycles\": %llu, \"mean_ns\": %llu",
+			   (unsigned long) bench.num_samples(), bench.fastest(), bench.median(), bench.p99(), bench.mean_nanos());
+		if(bench.bytes_per_second())
+			printf(", \"bytes_per_sec\": %llu", bench.bytes_per_second());
+		if(!bench.fail_reason().empty()) {
+			printf(", \"failed\": ");
+			print_json_string(bench.fail_reason().c_str());
+			m_num_failed++;
+		}
+		printf("}\n");
+		fflush(stdout);
+	}
+
+	return num_run;
+}
+
+static inline uint64_t read_tsc() {
+	uint32_t low, high;
+	asm volatile("rdtsc" : "=a"(low), "=d"(high));
+	return ((uint64_t) high << 32) | low;
+}
+
+Benchmark::Benchmark(size_t iterations): m_iterations(iterations) {
+	m_samples.reserve(iterations);
+}
+
+bool Benchmark::iterate() {
+	auto now = read_tsc();
+	if(m_running) {
+		m_samples.push_back(now - m_start);
+	} else {
+		m_start_nanos = Duck::Time::monotonic_nanos();
+	}
+	m_running = m_samples.size() < m_iterations;
+	if(!m_running)
+		m_elapsed_nanos += Duck::Time::monotonic_nanos() - m_start_nanos;
+	// Read the TSC again so that storing the sample isn't counted
+	m_start = read_tsc();
+	return m_running;
+}
+
+void Benchmark::pause() {
+	m_paused_at = read_tsc();
+	m_paused_at_nanos = Duck::Time::monotonic_nanos();
+}
+
+void Benchmark::resume() {
+	m_start_nanos += Duck::Time::monotonic_nanos() - m_paused_at_nanos;
+	m_start += read_tsc() - m_paused_at;
+}
+
+void Benchmark::set_iterations(size_t iterations) {
+	if(!m_samples.empty())
+		return;
+	m_iterations = iterations;
+	m_samples.reserve(iterations);
+}
+
+uint64_t Benchmark::fastest() {
+	sort();
+	return m_samples.empty() ? 0 : m_samples[0];
+}
+
+uint64_t Benchmark::median() {
+	sort();
+	return m_samples.empty() ? 0 : m_samples[m_samples.size() / 2];
+}
+
+uint64_t Benchmark::p99() {
+	sort();
+	return m_samples.empty() ? 0 : m_samples[(m_samples.size() * 99) / 100];
+}
+
+uint64_t Benchmark::mean_nanos() const {
+	return m_samples.empty() ? 0 : m_elapsed_nanos / m_samples.size();
+}
+
+uint64_t Benchmark::bytes_per_second() const {
+	if(!m_bytes_per_iteration || !m_elapsed_nanos)
+		return 0;
+	return (uint64_t) ((double) m_bytes_per_iteration * m_samples.size() * 1000000000.0 / m_elapsed_nanos);
+}
+
+void Benchmark::subtract_overhead(uint64_t cycles) {
+	for(auto& sample : m_samples)
+		sample = sample > cycles ? sample - cycles : 0;
+}
+
+void Benchmark::sort() {
+	if(m_sorted)
+		return;
+	m_sorted = true;
+	std::sort(m_samples.begin(), m_samples.end());
+}
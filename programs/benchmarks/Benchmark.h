@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// How many times a benchmark's loop runs, unless it picks a different number or one is given on the command line
+#define BENCH_ITERATIONS 1000
+
+/**
+ * Defines a benchmark, like KERNEL_BENCH does for the kernel. The body loops on bench.iterate(), and every pass through
+ * the loop is timed separately:
+ *
+ *     BENCHMARK(thing) {
+ *         while(bench.iterate())
+ *             do_thing();
+ *     }
+ *
+ * Names start with the area being measured (like gfx_fill), so that --filter gfx runs all of the graphics benchmarks.
+ */
+#define BENCHMARK(name) \
+	void __bench_##name(Benchmark& bench); \
+	static bool __didRegister_bench##name = BenchmarkRegistry::inst().register_bench({#name, __bench_##name}); \
+	void __bench_##name(Benchmark& bench)
+
+/** Times the iterations of a benchmark in TSC cycles, and the whole run in nanoseconds. **/
+class Benchmark {
+public:
+	explicit Benchmark(size_t iterations);
+
+	/// Finishes timing the last iteration and starts timing the next one. Returns false once they've all run.
+	bool iterate();
+	/// Stops the clock for work in an iteration that shouldn't be counted, like setting up the next one.
+	void pause();
+	void resume();
+	/// Changes how many iterations are run. Must be called before the first call to iterate().
+	void set_iterations(size_t iterations);
+	/// Sets how many bytes each iteration processes, so that the throughput can be reported.
+	void set_bytes_per_iteration(size_t bytes) { m_bytes_per_iteration = bytes; }
+	/// Marks the benchmark as not having been run, like when a service it needs isn't running.
+	void skip(const std::string& reason) { m_skip_reason = reason; }
+	/// Marks the benchmark as having given the wrong result. It's still timed, since the timings may explain why.
+	void fail(const std::string& reason) { m_fail_reason = reason; }
+
+	/// The fastest, median, and 99th percentile iteration, in cycles.
+	uint64_t fastest();
+	uint64_t median();
+	uint64_t p99();
+	/// How long the iterations took on average, not counting time spent paused.
+	uint64_t mean_nanos() const;
+	/// How many bytes were processed per second, or 0 if the benchmark didn't say how many bytes an iteration is.
+	uint64_t bytes_per_second() const;
+	size_t num_samples() const { return m_samples.size(); }
+	const std::string& skip_reason() const { return m_skip_reason; }
+	const std::string& fail_reason() const { return m_fail_reason; }
+	/// Takes a number of cycles off of every sample, for the overhead of timing them.
+	void subtract_overhead(uint64_t cycles);
+
+private:
+	void sort();
+
+	std::vector<uint64_t> m_samples;
+	size_t m_iterations;
+	uint64_t m_start = 0;
+	uint64_t m_paused_at = 0;
+	uint64_t m_start_nanos = 0;
+	uint64_t m_paused_at_nanos = 0;
+	uint64_t m_elapsed_nanos = 0;
+	size_t m_bytes_per_iteration = 0;
+	std::string m_skip_reason;
+	std::string m_fail_reason;
+	bool m_running = false;
+	bool m_sorted = false;
+};
+
+typedef void (*BenchFunc)(Benchmark& bench);
+struct BenchmarkEntry {
+	const char* name;
+	BenchFunc func;
+};
+
+class BenchmarkRegistry {
+public:
+	static BenchmarkRegistry& inst();
+	bool register_bench(const BenchmarkEntry& bench);
+
+	/// Lists the names of the benchmarks, one per line.
+	void list();
+	/**
+	 * Runs the benchmarks and prints a line of JSON for each one to stdout, so that results can be compared between
+	 * runs by a script.
+	 * @param filter If not empty, only benchmarks with names starting with this are run.
+	 * @param iterations If not 0, how many iterations to run every benchmark for instead of its own number.
+	 * @return How many benchmarks were run.
+	 */
+	int run(const std::string& filter, size_t iterations);
+
+	/// How many of the benchmarks that were run gave the wrong result.
+	int num_failed() const { return m_num_failed; }
+
+private:
+	std::vector<BenchmarkEntry> m_benchmarks;
+	int m_num_failed = 0;
+};
@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+// A program that runs microbenchmarks of the kernel, IPC, and graphics, and prints the results as lines of JSON so that
+// they can be compared between builds.
+
+#include "Benchmark.h"
+#include <libduck/Args.h>
+#include <cstdio>
+
+int main(int argc, char** argv) {
+	std::string filter;
+	int iterations = 0;
+	bool list = false;
+	Duck::Args args;
+	args.add_named(filter, "f", "filter", "Only run benchmarks with names starting with this.");
+	args.add_named(iterations, "i", "iterations", "How many iterations to run each benchmark for.");
+	args.add_flag(list, "l", "list", "List the benchmarks instead of running them.");
+	args.parse(argc, argv);
+
+	if(list) {
+		BenchmarkRegistry::inst().list();
+		return 0;
+	}
+
+	if(!BenchmarkRegistry::inst().run(filter, iterations > 0 ? iterations : 0)) {
+		fprintf(stderr, "benchmarks: No benchmarks match %s\n", filter.c_str());
+		return 1;
+	}
+	if(BenchmarkRegistry::inst().num_failed()) {
+		fprintf(stderr, "benchmarks: %d benchmark(s) gave the wrong result\n", BenchmarkRegistry::inst().num_failed());
+		return 1;
+	}
+	return 0;
+}
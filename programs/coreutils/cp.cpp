@@ -17,61 +17,200 @@
 	Copyright (c) Byteduck 2016-2021. All rights reserved.
 */
 
-//A program that copies a file.
+//A program that copies files and directories.
 
 #include <stdio.h>
 #include <errno.h>
 #include <sys/stat.h>
+#include <sys/thread.h>
 #include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <dirent.h>
 #include <sys/types.h>
+#include <string>
+#include <vector>
 
-int main(int argc, char** argv) {
-	if(argc < 3) {
-		printf("Missing operands\nUsage: cp FILE NEWFILE\n");
-		return 1;
-	}
+// How much to ask the kernel to copy at once
+#define COPY_CHUNK_SIZE (1024 * 1024)
 
-	int from_fd = open(argv[1], O_RDONLY);
-	if(from_fd == -1) {
-		perror("cp");
-		return errno;
-	}
+// The smallest buffer to copy through when the kernel can't copy by itself
+#define MIN_BUFFER_SIZE (128 * 1024)
 
-	struct stat from_st;
-	if(stat(argv[1], &from_st) < 0) {
-		perror("cp");
-		return errno;
+// How many subdirectories to copy at once with -r
+#define MAX_COPY_THREADS 4
+
+int copy_path(const std::string& from, const std::string& to, bool parallel);
+
+// Copies a file through a buffer, for files that the kernel can't copy between by itself.
+ssize_t copy_by_reading(int from_fd, int to_fd, size_t buf_size) {
+	auto* buf = (char*) malloc(buf_size);
+	if(!buf)
+		return -1;
+	ssize_t nread;
+	while((nread = read(from_fd, buf, buf_size)) > 0) {
+		ssize_t nwrote = 0;
+		while(nwrote < nread) {
+			ssize_t res = write(to_fd, buf + nwrote, nread - nwrote);
+			if(res <= 0) {
+				free(buf);
+				return -1;
+			}
+			nwrote += res;
+		}
 	}
+	free(buf);
+	return nread;
+}
+
+int print_error(const std::string& path) {
+	int err = errno ? errno : 1;
+	fprintf(stderr, "cp: %s: %s\n", path.c_str(), strerror(err));
+	return err;
+}
 
-	int to_fd = open(argv[2], O_WRONLY | O_CREAT, from_st.st_mode);
+int copy_file(const std::string& from, const std::string& to, const struct stat& from_st) {
+	int from_fd = open(from.c_str(), O_RDONLY);
+	if(from_fd == -1)
+		return print_error(from);
+
+	int to_fd = open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC, from_st.st_mode);
 	if(to_fd == -1) {
-		perror("cp");
-		return errno;
+		close(from_fd);
+		return print_error(to);
 	}
 
 	errno = 0;
 
-	ssize_t nread;
-	auto* buf = (char*) malloc(1024);
-	while((nread = read(from_fd, buf, 1024))) {
-		ssize_t nwrote;
-		nwrote = write(to_fd, buf, nread);
-		if(nwrote <= 0) {
-			if(errno) {
-				perror("cp");
-				return errno;
-			}
-			perror("cp");
-			return 1;
-		}
+	//Let the kernel copy the file without it coming through here if it can
+	ssize_t ncopied;
+	while((ncopied = copy_file_range(from_fd, NULL, to_fd, NULL, COPY_CHUNK_SIZE, 0)) > 0);
+	if(ncopied < 0 && errno == EINVAL) {
+		size_t buf_size = from_st.st_blksize > MIN_BUFFER_SIZE ? from_st.st_blksize : MIN_BUFFER_SIZE;
+		errno = 0;
+		ncopied = copy_by_reading(from_fd, to_fd, buf_size);
 	}
 
+	int ret = ncopied < 0 ? print_error(from) : 0;
 	close(to_fd);
 	close(from_fd);
-	free(buf);
+	return ret;
+}
+
+struct CopyJob {
+	std::string from;
+	std::string to;
+	int result;
+	tid_t thread;
+};
+
+void* copy_job_thread(void* arg) {
+	auto* job = (CopyJob*) arg;
+	job->result = copy_path(job->from, job->to, false);
+	return nullptr;
+}
+
+int copy_directory(const std::string& from, const std::string& to, const struct stat& from_st, bool parallel) {
+	if(mkdir(to.c_str(), from_st.st_mode & 07777) < 0 && errno != EEXIST)
+		return print_error(to);
+
+	DIR* dir = opendir(from.c_str());
+	if(!dir)
+		return print_error(from);
+
+	std::vector<std::string> names;
+	struct dirent* entry;
+	while((entry = readdir(dir))) {
+		if(strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+			names.emplace_back(entry->d_name);
+	}
+	closedir(dir);
+
+	//Copy subdirectories on their own threads, since they don't depend on each other. Files are copied here meanwhile.
+	int ret = 0;
+	std::vector<CopyJob*> jobs;
+	auto finish_job = [&] (CopyJob* job) {
+		thread_join(job->thread, nullptr);
+		if(job->result)
+			ret = job->result;
+		delete job;
+	};
+
+	for(auto& name : names) {
+		std::string child_from = from + "/" + name;
+		std::string child_to = to + "/" + name;
+
+		struct stat child_st;
+		if(parallel && stat(child_from.c_str(), &child_st) == 0 && S_ISDIR(child_st.st_mode)) {
+			if(jobs.size() == MAX_COPY_THREADS) {
+				finish_job(jobs.front());
+				jobs.erase(jobs.begin());
+			}
+
+			auto* job = new CopyJob {child_from, child_to, 0, 0};
+			job->thread = thread_create(copy_job_thread, job);
+			if(job->thread < 0) {
+				delete job;
+			} else {
+				jobs.push_back(job);
+				continue;
+			}
+		}
+
+		int res = copy_path(child_from, child_to, false);
+		if(res)
+			ret = res;
+	}
+
+	for(auto* job : jobs)
+		finish_job(job);
+
+	return ret;
+}
+
+int copy_path(const std::string& from, const std::string& to, bool parallel) {
+	struct stat from_st;
+	if(stat(from.c_str(), &from_st) < 0)
+		return print_error(from);
+	if(S_ISDIR(from_st.st_mode))
+		return copy_directory(from, to, from_st, parallel);
+	return copy_file(from, to, from_st);
+}
+
+int main(int argc, char** argv) {
+	bool recursive = false;
+	int argi = 1;
+	if(argi < argc && strcmp(argv[argi], "-r") == 0) {
+		recursive = true;
+		argi++;
+	}
+
+	if(argc - argi < 2) {
+		printf("Missing operands\nUsage: cp [-r] SOURCE DEST\n");
+		return 1;
+	}
+
+	std::string from = argv[argi];
+	std::string to = argv[argi + 1];
+
+	struct stat from_st;
+	if(stat(from.c_str(), &from_st) < 0)
+		return print_error(from);
+	if(S_ISDIR(from_st.st_mode) && !recursive) {
+		fprintf(stderr, "cp: %s: Is a directory (use -r to copy it)\n", from.c_str());
+		return EISDIR;
+	}
+
+	//Copying into an existing directory puts the source inside of it
+	struct stat to_st;
+	if(stat(to.c_str(), &to_st) == 0 && S_ISDIR(to_st.st_mode)) {
+		auto slash = from.find_last_of('/', from.length() > 1 ? from.length() - 2 : 0);
+		std::string name = slash == std::string::npos ? from : from.substr(slash + 1);
+		while(name.length() > 1 && name.back() == '/')
+			name.pop_back();
+		to += "/" + name;
+	}
 
-	return 0;
+	return copy_path(from, to, true);
 }
@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+// A program that converts BDF fonts to the binary font format pond loads.
+
+#include <stdio.h>
+#include <libgraphics/Font.h>
+
+int main(int argc, char** argv) {
+	if(argc < 3) {
+		printf("Missing operands\nUsage: fontc FONT.bdf OUTPUT.font\n");
+		return 1;
+	}
+
+	std::vector<uint8_t> font_data;
+	if(!Gfx::Font::compile_bdf(argv[1], font_data))
+		return 1;
+
+	FILE* file = fopen(argv[2], "w");
+	if(!file) {
+		perror("fontc");
+		return 1;
+	}
+	if(fwrite(font_data.data(), 1, font_data.size(), file) != font_data.size()) {
+		perror("fontc");
+		fclose(file);
+		return 1;
+	}
+	fclose(file);
+	return 0;
+}
@@ -46,6 +46,8 @@ int main(int argc, char** argv, char** envp) {
 		printf("Used: %s (%.2f%%)\n", info.used.readable().c_str(), info.used_frac() * 100.0);
 		printf("Free: %s (%.2f%%)\n", info.free().readable().c_str(), info.free_frac() * 100.0);
 		printf("Available: %s (%.2f%%)\n", info.available().readable().c_str(), info.available_frac() * 100.0);
+		printf("Swap total: %s\n", info.swap_total.readable().c_str());
+		printf("Swap used: %s\n", info.swap_used.readable().c_str());
 		if(kernel_memory) {
 			printf("Kernel physical: %s\n", info.kernel_phys.readable().c_str());
 			printf("Kernel virtual: %s\n", info.kernel_virt.readable().c_str());
@@ -57,6 +59,8 @@ int main(int argc, char** argv, char** envp) {
 		printf("Used: %lu (%.2f%%)\n", info.used.bytes, info.used_frac() * 100.0);
 		printf("Free: %lu (%.2f%%)\n", info.free().bytes, info.free_frac() * 100.0);
 		printf("Available: %lu (%.2f%%)\n", info.available().bytes, info.available_frac() * 100.0);
+		printf("Swap total: %lu\n", info.swap_total.bytes);
+		printf("Swap used: %lu\n", info.swap_used.bytes);
 		if(kernel_memory) {
 			printf("Kernel physical: %lu\n", info.kernel_phys.bytes);
 			printf("Kernel virtual: %lu\n", info.kernel_virt.bytes);
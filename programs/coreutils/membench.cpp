@@ -0,0 +1,184 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+// A program that measures how fast libc's memory and string routines are, compared to simple byte-at-a-time versions.
+
+#include <libduck/Args.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <string>
+
+// How many bytes each routine gets run over for each size
+#define BYTES_PER_SIZE (64 * 1024 * 1024)
+
+const size_t sizes[] = {16, 64, 256, 4096, 65536, 1024 * 1024};
+
+/*
+ * The byte-at-a-time versions that libc used to have. These are kept from being turned into calls to the libc routines
+ * they're being compared to.
+ */
+#define NAIVE __attribute__((noinline, optimize("no-tree-loop-distribute-patterns")))
+
+NAIVE void* naive_memcpy(void* dest, const void* src, size_t n) {
+	void* odest = dest;
+	asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(n) :: "memory");
+	return odest;
+}
+
+NAIVE void* naive_memmove(void* dest, const void* src, size_t n) {
+	if(dest < src)
+		return naive_memcpy(dest, src, n);
+	auto* dest8 = (uint8_t*) dest + n;
+	auto* src8 = (const uint8_t*) src + n;
+	while(n--)
+		*--dest8 = *--src8;
+	return dest;
+}
+
+NAIVE void* naive_memset(void* dest, int c, size_t n) {
+	void* odest = dest;
+	asm volatile("rep stosb" : "+D"(dest), "+c"(n) : "a"(c) : "memory");
+	return odest;
+}
+
+NAIVE void* naive_memchr(const void* s, int c, size_t n) {
+	auto* sc = (const char*) s;
+	for(size_t i = 0; i < n; i++) {
+		if(sc[i] == (char) c)
+			return (void*) &sc[i];
+	}
+	return nullptr;
+}
+
+NAIVE size_t naive_strlen(const char* str) {
+	const char* s = str;
+	while(*s)
+		s++;
+	return s - str;
+}
+
+NAIVE char* naive_strchr(const char* s, int c) {
+	for(;;) {
+		if(*s == (char) c)
+			return (char*) s;
+		if(!*s)
+			return nullptr;
+		s++;
+	}
+}
+
+// The routines are called through these, so the compiler can't swap in its own builtins for the libc ones
+typedef void (*BenchFunc)(uint8_t* dest, uint8_t* src, size_t size);
+
+struct Benchmark {
+	const char* name;
+	BenchFunc naive;
+	BenchFunc libc;
+};
+
+template<void* (*func)(void*, const void*, size_t)>
+void bench_copy(uint8_t* dest, uint8_t* src, size_t size) {
+	func(dest, src, size);
+}
+
+template<void* (*func)(void*, const void*, size_t)>
+void bench_move(uint8_t* dest, uint8_t* src, size_t size) {
+	// Overlapping, with the destination above the source so it has to be copied backwards
+	func(src + 3, src, size);
+}
+
+template<void* (*func)(void*, int, size_t)>
+void bench_set(uint8_t* dest, uint8_t* src, size_t size) {
+	func(dest, 0x55, size);
+}
+
+template<void* (*func)(const void*, int, size_t)>
+void bench_chr(uint8_t* dest, uint8_t* src, size_t size) {
+	func(src, 0, size);
+}
+
+template<size_t (*func)(const char*)>
+void bench_strlen(uint8_t* dest, uint8_t* src, size_t size) {
+	func((const char*) src);
+}
+
+template<char* (*func)(const char*, int)>
+void bench_strchr(uint8_t* dest, uint8_t* src, size_t size) {
+	func((const char*) src, 0xFF);
+}
+
+void* libc_memcpy(void* dest, const void* src, size_t n) { return memcpy(dest, src, n); }
+void* libc_memmove(void* dest, const void* src, size_t n) { return memmove(dest, src, n); }
+void* libc_memset(void* dest, int c, size_t n) { return memset(dest, c, n); }
+void* libc_memchr(const void* s, int c, size_t n) { return (void*) memchr(s, c, n); }
+size_t libc_strlen(const char* s) { return strlen(s); }
+char* libc_strchr(const char* s, int c) { return (char*) strchr(s, c); }
+
+const Benchmark benchmarks[] = {
+	{"memcpy", bench_copy<naive_memcpy>, bench_copy<libc_memcpy>},
+	{"memmove", bench_move<naive_memmove>, bench_move<libc_memmove>},
+	{"memset", bench_set<naive_memset>, bench_set<libc_memset>},
+	{"memchr", bench_chr<naive_memchr>, bench_chr<libc_memchr>},
+	{"strlen", bench_strlen<naive_strlen>, bench_strlen<libc_strlen>},
+	{"strchr", bench_strchr<naive_strchr>, bench_strchr<libc_strchr>},
+};
+
+uint64_t now_us() {
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t) time.tv_sec * 1000000 + time.tv_nsec / 1000;
+}
+
+/** Runs a routine over BYTES_PER_SIZE bytes in chunks of size, and returns how many MiB/s it managed. **/
+uint64_t measure(BenchFunc func, uint8_t* dest, uint8_t* src, size_t size) {
+	// The string routines need a terminator at the end of the buffer, and nothing they would stop at before it
+	memset(src, 0x11, size + 4);
+	src[size] = '\0';
+
+	size_t iterations = BYTES_PER_SIZE / size;
+	func(dest, src, size);
+	uint64_t start = now_us();
+	for(size_t i = 0; i < iterations; i++)
+		func(dest, src, size);
+	uint64_t elapsed = now_us() - start;
+	if(!elapsed)
+		elapsed = 1;
+	return ((uint64_t) BYTES_PER_SIZE * 1000000 / elapsed) / (1024 * 1024);
+}
+
+int main(int argc, char** argv) {
+	std::string only;
+	int offset = 0;
+	Duck::Args args;
+	args.add_named(only, "f", "function", "Only measure this routine.");
+	args.add_named(offset, "o", "offset", "How many bytes to misalign the buffers by.");
+	args.parse(argc, argv);
+
+	size_t buffer_size = sizes[sizeof(sizes) / sizeof(size_t) - 1] + 64;
+	auto* dest = (uint8_t*) malloc(buffer_size);
+	auto* src = (uint8_t*) malloc(buffer_size);
+	if(!dest || !src) {
+		perror("membench");
+		return 1;
+	}
+
+	printf("%-8s %10s %12s %12s %8s\n", "Routine", "Size", "Naive MiB/s", "libc MiB/s", "Speedup");
+	for(auto& benchmark : benchmarks) {
+		if(!only.empty() && only != benchmark.name)
+			continue;
+		for(auto size : sizes) {
+			uint64_t naive = measure(benchmark.naive, dest + offset, src + offset, size);
+			uint64_t libc = measure(benchmark.libc, dest + offset, src + offset, size);
+			uint64_t speedup = naive ? libc * 100 / naive : 0;
+			printf("%-8s %10lu %12llu %12llu %5llu.%02llux\n", benchmark.name, (unsigned long) size, naive, libc,
+				   speedup / 100, speedup % 100);
+		}
+	}
+
+	free(dest);
+	free(src);
+	return 0;
+}
@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+// A program that runs a command with an adjusted nice value, or prints the current nice value.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+int main(int argc, char** argv) {
+	int adjustment = 10;
+	int arg = 1;
+
+	// Arguments are parsed by hand so that options meant for the command aren't taken as ours
+	if(arg < argc && !strcmp(argv[arg], "-n")) {
+		if(arg + 1 >= argc) {
+			fprintf(stderr, "nice: Missing adjustment\nUsage: nice [-n ADJUSTMENT] [COMMAND [ARGS...]]\n");
+			return EXIT_FAILURE;
+		}
+		char* endptr;
+		adjustment = (int) strtol(argv[arg + 1], &endptr, 10);
+		if(endptr == argv[arg + 1] || *endptr) {
+			fprintf(stderr, "nice: Invalid adjustment '%s'\n", argv[arg + 1]);
+			return EXIT_FAILURE;
+		}
+		arg += 2;
+	}
+
+	if(arg >= argc) {
+		errno = 0;
+		int cur = nice(0);
+		if(cur == -1 && errno) {
+			perror("nice");
+			return EXIT_FAILURE;
+		}
+		printf("%d\n", cur);
+		return EXIT_SUCCESS;
+	}
+
+	errno = 0;
+	if(nice(adjustment) == -1 && errno)
+		perror("nice");
+
+	execvp(argv[arg], argv + arg);
+	perror(argv[arg]);
+	return errno == ENOENT ? 127 : 126;
+}
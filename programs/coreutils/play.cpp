@@ -41,6 +41,8 @@ int main(int argc, char** argv) {
 		return wav_res.code();
 	}
 	auto& wav = wav_res.value();
+	if(wav.start_read_ahead().is_error())
+		Duck::printerrln("play: Couldn't start reading ahead, playback may stutter");
 
 	auto conn_res = Sound::Connection::create();
 	if(conn_res.is_error()) {
@@ -0,0 +1,121 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+// A program that records which pages of files a program uses while it starts, and reads them in ahead of time later
+// using /dev/prefetch.
+
+#include <libduck/Args.h>
+#include <kernel/api/prefetch.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <string>
+
+int seconds = 5;
+std::string action;
+std::string list_path;
+std::vector<std::string> command;
+
+int record() {
+	if(command.empty()) {
+		fprintf(stderr, "prefetch: No command to record was given\n");
+		return 1;
+	}
+
+	int fd = open("/dev/prefetch", O_RDONLY | O_CLOEXEC);
+	if(fd < 0) {
+		perror("prefetch: Couldn't open /dev/prefetch");
+		return 1;
+	}
+
+	// The command records itself before it runs, so that none of its startup is missed
+	pid_t pid = fork();
+	if(!pid) {
+		if(ioctl(fd, PREFETCH_RECORD_START, getpid()) < 0) {
+			perror("prefetch: Couldn't start recording");
+			exit(1);
+		}
+		std::vector<char*> c_args;
+		for(auto& arg : command)
+			c_args.push_back((char*) arg.c_str());
+		c_args.push_back(nullptr);
+		execvp(c_args[0], c_args.data());
+		perror("prefetch: Couldn't run the command");
+		exit(1);
+	}
+
+	// Record until the command exits or the time is up, whichever comes first
+	timespec start, now;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	do {
+		if(waitpid(pid, nullptr, WNOHANG) == pid)
+			break;
+		usleep(100000);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+	} while(now.tv_sec - start.tv_sec < seconds);
+	ioctl(fd, PREFETCH_RECORD_STOP, 0);
+
+	FILE* file = fopen(list_path.c_str(), "w");
+	if(!file) {
+		perror("prefetch: Couldn't open the list");
+		return 1;
+	}
+	prefetch_entry buf[64];
+	ssize_t nread;
+	size_t num_entries = 0;
+	while((nread = read(fd, buf, sizeof(buf))) > 0) {
+		fwrite(buf, 1, nread, file);
+		num_entries += nread / sizeof(prefetch_entry);
+	}
+	fclose(file);
+	close(fd);
+	printf("Recorded %zu pages to %s\n", num_entries, list_path.c_str());
+	return 0;
+}
+
+int replay() {
+	FILE* file = fopen(list_path.c_str(), "r");
+	if(!file) {
+		perror("prefetch: Couldn't open the list");
+		return 1;
+	}
+	std::vector<prefetch_entry> entries;
+	prefetch_entry entry;
+	while(fread(&entry, sizeof(entry), 1, file) == 1)
+		entries.push_back(entry);
+	fclose(file);
+
+	int fd = open("/dev/prefetch", O_WRONLY);
+	if(fd < 0) {
+		perror("prefetch: Couldn't open /dev/prefetch");
+		return 1;
+	}
+	if(write(fd, entries.data(), entries.size() * sizeof(prefetch_entry)) < 0) {
+		perror("prefetch: Couldn't replay the list");
+		return 1;
+	}
+	close(fd);
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	Duck::Args args;
+	args.add_named(seconds, "t", "time", "The most seconds to record for (default 5).");
+	args.add_positional(action, true, "ACTION", "'record' to record COMMAND starting up to LIST, or 'replay' to read in the pages in LIST.");
+	args.add_positional(list_path, true, "LIST", "The file to keep the list of pages in.");
+	args.add_positional(command, false, "COMMAND", "The command to record.");
+	args.parse(argc, argv);
+
+	if(action == "record")
+		return record();
+	if(action == "replay")
+		return replay();
+	fprintf(stderr, "prefetch: Unknown action '%s'\n", action.c_str());
+	return 1;
+}
@@ -0,0 +1,233 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+// A program that samples where the CPU spends its time using /dev/profile, and prints a report of it.
+
+#include <libduck/Args.h>
+#include <kernel/api/profile.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#define SHT_SYMTAB 2
+#define STT_FUNC 2
+
+struct Elf32Header {
+	unsigned char e_ident[16];
+	uint16_t e_type, e_machine;
+	uint32_t e_version, e_entry, e_phoff, e_shoff, e_flags;
+	uint16_t e_ehsize, e_phentsize, e_phnum, e_shentsize, e_shnum, e_shstrndx;
+};
+
+struct Elf32SectionHeader {
+	uint32_t sh_name, sh_type, sh_flags, sh_addr, sh_offset, sh_size, sh_link, sh_info, sh_addralign, sh_entsize;
+};
+
+struct Elf32Symbol {
+	uint32_t st_name, st_value, st_size;
+	unsigned char st_info, st_other;
+	uint16_t st_shndx;
+};
+
+struct Symbol {
+	uint32_t address;
+	std::string name;
+};
+
+// The symbols of a program or the kernel, sorted by address
+typedef std::vector<Symbol> SymbolTable;
+
+int seconds = 5;
+int pid = 0;
+bool call_graph = false;
+int max_lines = 30;
+
+SymbolTable kernel_symbols;
+std::map<pid_t, SymbolTable> process_symbols;
+
+SymbolTable load_kernel_map() {
+	SymbolTable table;
+	FILE* file = fopen("/boot/kernel.map", "r");
+	if(!file)
+		return table;
+	char line[512];
+	while(fgets(line, sizeof(line), file)) {
+		// Each line looks like "c0100000 T name"
+		if(strlen(line) < 12)
+			continue;
+		line[strcspn(line, "\n")] = '\0';
+		table.push_back({(uint32_t) strtoul(line, nullptr, 16), std::string(line + 11)});
+	}
+	fclose(file);
+	std::sort(table.begin(), table.end(), [](auto& a, auto& b) { return a.address < b.address; });
+	return table;
+}
+
+SymbolTable load_elf_symbols(const std::string& path) {
+	SymbolTable table;
+	FILE* file = fopen(path.c_str(), "r");
+	if(!file)
+		return table;
+
+	auto read_at = [&](uint32_t offset, void* buf, size_t size) {
+		return !fseek(file, offset, SEEK_SET) && fread(buf, 1, size, file) == size;
+	};
+
+	Elf32Header header;
+	if(!read_at(0, &header, sizeof(header)) || memcmp(header.e_ident, "\x7f" "ELF", 4)) {
+		fclose(file);
+		return table;
+	}
+
+	std::vector<Elf32SectionHeader> sections(header.e_shnum);
+	if(!read_at(header.e_shoff, sections.data(), sections.size() * sizeof(Elf32SectionHeader))) {
+		fclose(file);
+		return table;
+	}
+
+	for(auto& section : sections) {
+		if(section.sh_type != SHT_SYMTAB || section.sh_link >= sections.size())
+			continue;
+		auto& strtab_section = sections[section.sh_link];
+		std::vector<Elf32Symbol> symbols(section.sh_size / sizeof(Elf32Symbol));
+		std::vector<char> strtab(strtab_section.sh_size + 1);
+		if(!read_at(section.sh_offset, symbols.data(), symbols.size() * sizeof(Elf32Symbol)) ||
+		   !read_at(strtab_section.sh_offset, strtab.data(), strtab_section.sh_size))
+			continue;
+		for(auto& symbol : symbols) {
+			if((symbol.st_info & 0xf) != STT_FUNC || !symbol.st_value || symbol.st_name >= strtab_section.sh_size)
+				continue;
+			table.push_back({symbol.st_value, std::string(&strtab[symbol.st_name])});
+		}
+	}
+
+	fclose(file);
+	std::sort(table.begin(), table.end(), [](auto& a, auto& b) { return a.address < b.address; });
+	return table;
+}
+
+SymbolTable& symbols_for(pid_t sample_pid) {
+	auto it = process_symbols.find(sample_pid);
+	if(it != process_symbols.end())
+		return it->second;
+
+	// This only works while the process is still around, and only for the executable itself, not its libraries
+	char link_path[32], exe_path[512];
+	snprintf(link_path, sizeof(link_path), "/proc/%d/exe", sample_pid);
+	ssize_t len = readlink(link_path, exe_path, sizeof(exe_path) - 1);
+	SymbolTable table;
+	if(len > 0) {
+		exe_path[len] = '\0';
+		table = load_elf_symbols(exe_path);
+	}
+	return process_symbols[sample_pid] = std::move(table);
+}
+
+std::string symbolize(uint32_t address, bool kernel, pid_t sample_pid) {
+	auto& table = kernel ? kernel_symbols : symbols_for(sample_pid);
+	auto it = std::upper_bound(table.begin(), table.end(), address, [](uint32_t addr, auto& sym) { return addr < sym.address; });
+	if(it != table.begin())
+		return (--it)->name;
+	char buf[16];
+	snprintf(buf, sizeof(buf), "0x%x", address);
+	return buf;
+}
+
+void print_counts(const std::map<std::string, size_t>& counts, size_t total, const char* indent, int limit) {
+	std::vector<std::pair<std::string, size_t>> sorted(counts.begin(), counts.end());
+	std::sort(sorted.begin(), sorted.end(), [](auto& a, auto& b) { return a.second > b.second; });
+	for(int i = 0; i < (int) sorted.size() && i < limit; i++)
+		printf("%s%6.2f%% %6zu  %s\n", indent, sorted[i].second * 100.0 / total, sorted[i].second, sorted[i].first.c_str());
+}
+
+int main(int argc, char** argv) {
+	Duck::Args args;
+	args.add_named(pid, "p", "pid", "Only sample the process with this pid.");
+	args.add_flag(call_graph, "g", "call-graph", "Print which functions each function was called from.");
+	args.add_named(max_lines, "n", "lines", "The most functions to print.");
+	args.add_positional(seconds, false, "SECONDS", "How many seconds to sample for (default 5).");
+	args.parse(argc, argv);
+
+	int fd = open("/dev/profile", O_RDONLY);
+	if(fd < 0) {
+		perror("profile: Couldn't open /dev/profile");
+		return 1;
+	}
+
+	timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	uint64_t start_us = (uint64_t) start.tv_sec * 1000000 + start.tv_nsec / 1000;
+	if(ioctl(fd, PROFILE_START, pid) < 0) {
+		perror("profile: Couldn't start profiling");
+		return 1;
+	}
+	sleep(seconds);
+	ioctl(fd, PROFILE_STOP, 0);
+
+	// Read every sample from the start of the stream, and keep the ones taken since we started
+	std::vector<profile_sample> samples;
+	profile_sample buf[64];
+	ssize_t nread;
+	while((nread = read(fd, buf, sizeof(buf))) > 0) {
+		for(size_t i = 0; i < nread / sizeof(profile_sample); i++) {
+			if(buf[i].flags & PROFILE_SAMPLE_LOST)
+				continue;
+			if(buf[i].time >= start_us)
+				samples.push_back(buf[i]);
+		}
+	}
+	close(fd);
+
+	if(samples.empty()) {
+		printf("No samples were taken.\n");
+		return 0;
+	}
+
+	kernel_symbols = load_kernel_map();
+
+	// Count how often each function was running (self), and how often it was anywhere on the stack (total)
+	std::map<std::string, size_t> self_counts, total_counts;
+	std::map<std::string, std::map<std::string, size_t>> callers;
+	for(auto& sample : samples) {
+		bool kernel = sample.flags & PROFILE_SAMPLE_KERNEL;
+		std::vector<std::string> names;
+		for(uint32_t i = 0; i < sample.num_frames && i < PROFILE_MAX_FRAMES; i++)
+			names.push_back(symbolize(sample.frames[i], kernel, sample.pid));
+
+		self_counts[names[0]]++;
+		std::set<std::string> seen;
+		for(size_t i = 0; i < names.size(); i++) {
+			if(seen.insert(names[i]).second)
+				total_counts[names[i]]++;
+			if(i + 1 < names.size())
+				callers[names[i]][names[i + 1]]++;
+		}
+	}
+
+	printf("%zu samples\n\n   Self  Samples  Function\n", samples.size());
+	print_counts(self_counts, samples.size(), "", max_lines);
+
+	if(call_graph) {
+		printf("\n  Total  Samples  Function\n");
+		std::vector<std::pair<std::string, size_t>> sorted(total_counts.begin(), total_counts.end());
+		std::sort(sorted.begin(), sorted.end(), [](auto& a, auto& b) { return a.second > b.second; });
+		for(int i = 0; i < (int) sorted.size() && i < max_lines; i++) {
+			auto& [name, count] = sorted[i];
+			printf("%6.2f%% %6zu  %s\n", count * 100.0 / samples.size(), count, name.c_str());
+			auto caller = callers.find(name);
+			if(caller != callers.end())
+				print_counts(caller->second, count, "    called from: ", 5);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,23 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+// A program that starts swapping memory to a file.
+
+#include <libduck/Args.h>
+#include <sys/swap.h>
+#include <stdio.h>
+
+std::string filename;
+
+int main(int argc, char** argv) {
+	Duck::Args args;
+	args.add_positional(filename, true, "FILE", "The file to swap to. Its size determines the amount of swap space.");
+	args.parse(argc, argv);
+
+	if(swapon(filename.c_str())) {
+		perror("swapon");
+		return 1;
+	}
+
+	return 0;
+}
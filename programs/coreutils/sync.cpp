@@ -0,0 +1,11 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+// A program that writes everything cached in memory out to disk.
+
+#include <unistd.h>
+
+int main(int argc, char** argv) {
+	sync();
+	return 0;
+}
@@ -22,8 +22,13 @@
 #include <unistd.h>
 #include <sys/wait.h>
 #include <cstring>
+#include <spawn.h>
+#include <cstdlib>
 #include "Command.h"
 
+std::unordered_map<std::string, std::string> Command::s_path_cache;
+std::string Command::s_cached_path;
+
 Command::Command(std::string command): cmd(std::move(command)) {
 
 }
@@ -45,30 +50,41 @@ void Command::evaluate(pid_t pgid) {
 		return;
 	}
 
-	//If it's not a built-in, fork and evaluate
-	_pid = fork();
-	if(!_pid) {
-		//Replace all of the FDs we need to
-		for(auto& fd : fds) {
-			dup2(fd.second, fd.first);
-		}
-
-		//Create a c-string array of the arguments
-		const char* c_args[args.size() + 2];
-		c_args[0] = cmd.c_str();
-		for(int i = 0; i < args.size(); i++) {
-			c_args[i + 1] = args[i].c_str();
-		}
-		c_args[args.size() + 1] = NULL;
-		execvp(cmd.c_str(), (char* const*) c_args);
-		fprintf(stderr, "Could not execute %s: %s\n", c_args[0], strerror(errno));
-		exit(errno);
+	//If it's not a built-in, spawn it with the FDs we need to replace and in the right process group
+	posix_spawn_file_actions_t file_actions;
+	posix_spawn_file_actions_init(&file_actions);
+	for(auto& fd : fds)
+		posix_spawn_file_actions_adddup2(&file_actions, fd.second, fd.first);
+
+	posix_spawnattr_t attr;
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+	posix_spawnattr_setpgroup(&attr, pgid);
+
+	//Create a c-string array of the arguments
+	const char* c_args[args.size() + 2];
+	c_args[0] = cmd.c_str();
+	for(int i = 0; i < args.size(); i++) {
+		c_args[i + 1] = args[i].c_str();
 	}
-
-	//Set the pgid appropriately
-	if(setpgid(_pid, pgid) < 0) {
-		perror("setpgid");
-		exit(errno);
+	c_args[args.size() + 1] = NULL;
+
+	//Spawn it from wherever we found it last time. If that doesn't work anymore, it might have moved, so look again.
+	auto path = find_executable(cmd);
+	int res = path.empty() ? ENOENT : posix_spawn(&_pid, path.c_str(), &file_actions, &attr, (char* const*) c_args, environ);
+	if(res == ENOENT && !path.empty() && path != cmd) {
+		forget_executable(cmd);
+		path = find_executable(cmd);
+		if(!path.empty())
+			res = posix_spawn(&_pid, path.c_str(), &file_actions, &attr, (char* const*) c_args, environ);
+	}
+	posix_spawn_file_actions_destroy(&file_actions);
+	posix_spawnattr_destroy(&attr);
+	if(res) {
+		fprintf(stderr, "Could not execute %s: %s\n", c_args[0], strerror(res));
+		_pid = 0;
+		return_status = res;
+		return;
 	}
 
 	//Set the controlling process of the terminal if this is the first process in the chain
@@ -99,7 +115,13 @@ pid_t Command::pid() {
 int Command::wait() {
 	if(!_pid || waited)
 		return return_status;
+	//We wait for one child at a time, so whatever the children's CPU time grows by is the time this one used
+	rusage before, after;
+	getrusage(RUSAGE_CHILDREN, &before);
 	waitpid(_pid, &return_status, 0);
+	getrusage(RUSAGE_CHILDREN, &after);
+	timersub(&after.ru_utime, &before.ru_utime, &_usage.ru_utime);
+	timersub(&after.ru_stime, &before.ru_stime, &_usage.ru_stime);
 	waited = true;
 	return return_status;
 }
@@ -108,6 +130,57 @@ int Command::status() {
 	return return_status;
 }
 
+const std::string& Command::name() {
+	return cmd;
+}
+
+const rusage& Command::usage() {
+	return _usage;
+}
+
+std::string Command::find_executable(const std::string& command) {
+	//If there's a slash, it's not something we look for in PATH
+	if(command.find('/') != std::string::npos)
+		return command;
+
+	//If PATH changed, everything we found before might be wrong
+	const char* path_cstr = getenv("PATH");
+	std::string path = path_cstr ? path_cstr : DEFAULT_PATH;
+	if(path != s_cached_path) {
+		s_path_cache.clear();
+		s_cached_path = path;
+	}
+
+	auto cached = s_path_cache.find(command);
+	if(cached != s_path_cache.end())
+		return cached->second;
+
+	size_t start = 0;
+	while(start <= path.length()) {
+		size_t end = path.find(':', start);
+		if(end == std::string::npos)
+			end = path.length();
+		if(end > start) {
+			auto full_path = path.substr(start, end - start) + "/" + command;
+			if(!access(full_path.c_str(), X_OK)) {
+				s_path_cache[command] = full_path;
+				return full_path;
+			}
+		}
+		start = end + 1;
+	}
+	return "";
+}
+
+void Command::forget_executable(const std::string& command) {
+	s_path_cache.erase(command);
+}
+
+int Command::out_fd() {
+	auto fd = fds.find(STDOUT_FILENO);
+	return fd == fds.end() ? STDOUT_FILENO : fd->second;
+}
+
 bool Command::evaluate_builtin() {
 	if(cmd == "exit") {
 		exit(EXIT_SUCCESS);
@@ -124,6 +197,50 @@ bool Command::evaluate_builtin() {
 		printf("\033[2J");
 		fflush(stdout);
 		return true;
+	} else if(cmd == "true") {
+		return_status = EXIT_SUCCESS;
+		return true;
+	} else if(cmd == "false") {
+		return_status = EXIT_FAILURE;
+		return true;
+	} else if(cmd == "echo") {
+		//Build the whole line first so that it's written all at once
+		bool newline = args.empty() || args[0] != "-n";
+		std::string line;
+		for(size_t i = newline ? 0 : 1; i < args.size(); i++) {
+			if(!line.empty())
+				line += ' ';
+			line += args[i];
+		}
+		if(newline)
+			line += '\n';
+		fflush(stdout);
+		return_status = write(out_fd(), line.c_str(), line.length()) < 0 ? errno : EXIT_SUCCESS;
+		return true;
+	} else if(cmd == "pwd") {
+		char cwd[4096];
+		if(!getcwd(cwd, sizeof(cwd))) {
+			perror("pwd");
+			return_status = errno;
+			return true;
+		}
+		std::string line = std::string(cwd) + "\n";
+		fflush(stdout);
+		return_status = write(out_fd(), line.c_str(), line.length()) < 0 ? errno : EXIT_SUCCESS;
+		return true;
+	} else if(cmd == "hash") {
+		//Like in other shells, -r forgets every command we found, and otherwise we list them
+		if(!args.empty() && args[0] == "-r") {
+			s_path_cache.clear();
+		} else {
+			std::string list;
+			for(auto& entry : s_path_cache)
+				list += entry.first + "\t" + entry.second + "\n";
+			fflush(stdout);
+			write(out_fd(), list.c_str(), list.length());
+		}
+		return_status = EXIT_SUCCESS;
+		return true;
 	}
 	return false;
 }
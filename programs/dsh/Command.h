@@ -22,7 +22,10 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
 
 class Command {
 public:
@@ -34,9 +37,27 @@ public:
 	pid_t pid();
 	int wait();
 	int status();
+	const std::string& name();
+
+	/// The CPU time used by the command, which is known once it's been waited for.
+	const rusage& usage();
+
+	/**
+	 * Finds the full path of an executable in PATH, using the cache of previous lookups if we can.
+	 * @param command The name of the executable.
+	 * @return The full path of the executable, or an empty string if it couldn't be found.
+	 */
+	static std::string find_executable(const std::string& command);
+
+	/// Forgets where a command was found, so that the next lookup searches PATH again.
+	static void forget_executable(const std::string& command);
 
 private:
 	bool evaluate_builtin();
+	int out_fd();
+
+	static std::unordered_map<std::string, std::string> s_path_cache; ///< Where commands were found in PATH
+	static std::string s_cached_path; ///< The PATH that s_path_cache was built with
 
 	std::string cmd;
 	std::vector<std::string> args;
@@ -44,5 +65,6 @@ private:
 	int return_status = EXIT_SUCCESS;
 	pid_t _pid = 0;
 	bool waited = false;
+	rusage _usage = {};
 };
 
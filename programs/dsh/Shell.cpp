@@ -27,7 +27,11 @@
 #include <iostream>
 #include <cstring>
 #include <queue>
+#include <fcntl.h>
+#include <ctime>
+#include <sys/time.h>
 #define MAX_COMMAND_HISTORY 100
+#define DSH_PIPE_SIZE (256 * 1024) // Pipelines move a lot of data, so ask for pipes bigger than the default
 
 Shell::Shell(int argc, char** argv, char** envp) {
 
@@ -48,22 +52,7 @@ int Shell::run() {
 	setenv("PATH", path.c_str(), true);
 
 	TUI::LineEditor editor;
-	std::vector<std::string> command_history;
-	std::vector<std::string>::iterator recall_index;
-
-	editor.up_pressed = [&] {
-		recall_index = std::max(recall_index - 1, command_history.begin());
-		if(!command_history.empty())
-			editor.set_line(*recall_index);
-	};
-
-	editor.down_pressed = [&] {
-		recall_index = std::min(recall_index + 1, command_history.end());
-		if(recall_index == command_history.end())
-			editor.set_line("");
-		else if(!command_history.empty())
-			editor.set_line(*recall_index);
-	};
+	editor.set_history_limit(MAX_COMMAND_HISTORY);
 
 	while(!should_exit) {
 		getcwd(cwd, 4096);
@@ -76,12 +65,9 @@ int Shell::run() {
 		}
 
 		//Read the command and trim and evaluate it
-		recall_index = command_history.end();
 		auto command = editor.get_line();
 		result = evaluate(command);
-		command_history.push_back(command);
-		if(command_history.size() > MAX_COMMAND_HISTORY)
-			command_history.erase(command_history.begin());
+		editor.add_history(command);
 		if(std::cin.eof())
 			break;
 	}
@@ -94,6 +80,15 @@ int Shell::evaluate(const std::string& input) {
 	if(tokens.empty())
 		return EXIT_SUCCESS;
 
+	//If the command starts with "time", time how long the whole pipeline (and each stage of it) took
+	bool timed = false;
+	timespec start_time;
+	if(tokens[0] == "time" && tokens.size() > 1) {
+		timed = true;
+		tokens.erase(tokens.begin());
+		clock_gettime(CLOCK_MONOTONIC, &start_time);
+	}
+
 	std::vector<Command> commands;
 	std::vector<int> opened_fds;
 	bool last_was_operation = false;
@@ -130,6 +125,9 @@ int Shell::evaluate(const std::string& input) {
 			opened_fds.push_back(last_pipe[0]);
 			opened_fds.push_back(last_pipe[1]);
 
+			//Try to make it bigger so the stages on either end don't have to take turns as often
+			fcntl(last_pipe[1], F_SETPIPE_SZ, DSH_PIPE_SIZE);
+
 			//Set the stdout in the current command to the pipe
 			cmd.set_fd(STDOUT_FILENO, last_pipe[1]);
 		} else if(token == ">" || token == ">>") {
@@ -178,6 +176,9 @@ int Shell::evaluate(const std::string& input) {
 
 	cleanup();
 
+	if(timed)
+		print_times(commands, start_time);
+
 	//Return control of the terminal back to the shell
 	int pgid = getpgid(0);
 	if(isatty(STDOUT_FILENO)) {
@@ -196,6 +197,27 @@ int Shell::evaluate(const std::string& input) {
 	return commands.back().status();
 }
 
+void Shell::print_times(std::vector<Command>& commands, const timespec& start_time) {
+	timespec end_time;
+	clock_gettime(CLOCK_MONOTONIC, &end_time);
+	double real = (double) (end_time.tv_sec - start_time.tv_sec) + (double) (end_time.tv_nsec - start_time.tv_nsec) / 1000000000.0;
+
+	auto seconds = [](const timeval& time) {
+		return (double) time.tv_sec + (double) time.tv_usec / 1000000.0;
+	};
+
+	timeval total_user = {0, 0};
+	timeval total_sys = {0, 0};
+	for(auto& command : commands) {
+		auto& usage = command.usage();
+		if(commands.size() > 1)
+			fprintf(stderr, "%-12s user %.3fs  sys %.3fs\n", command.name().c_str(), seconds(usage.ru_utime), seconds(usage.ru_stime));
+		timeradd(&total_user, &usage.ru_utime, &total_user);
+		timeradd(&total_sys, &usage.ru_stime, &total_sys);
+	}
+	fprintf(stderr, "real %.3fs  user %.3fs  sys %.3fs\n", real, seconds(total_user), seconds(total_sys));
+}
+
 std::vector<std::string> Shell::tokenize(const std::string& input) {
 	size_t pos = 0;
 	std::vector<std::string> tokens;
@@ -21,6 +21,8 @@
 
 #include <string>
 #include <vector>
+#include <ctime>
+#include "Command.h"
 
 class Shell {
 public:
@@ -35,6 +37,13 @@ private:
 	 */
 	int evaluate(const std::string& input);
 
+	/**
+	 * Prints how long a timed pipeline took, along with the CPU time each of its commands used.
+	 * @param commands The commands in the pipeline, which should have been waited for.
+	 * @param start_time When the pipeline was started, from CLOCK_MONOTONIC.
+	 */
+	void print_times(std::vector<Command>& commands, const timespec& start_time);
+
 	/**
 	 * Splits a shell command into individual tokens (counting strings as a single token).
 	 * @param input The shell command to split.
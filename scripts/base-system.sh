@@ -31,10 +31,14 @@ mknod "$FS_DIR"/dev/random c 1 8
 mknod "$FS_DIR"/dev/null c 1 3
 mknod "$FS_DIR"/dev/zero c 1 5
 mknod "$FS_DIR"/dev/klog c 1 16
+mknod "$FS_DIR"/dev/profile c 1 17
+mknod "$FS_DIR"/dev/prefetch c 1 18
 mknod "$FS_DIR"/dev/fb0 b 29 0
+mknod "$FS_DIR"/dev/zram0 b 252 0
 mkdir -p "$FS_DIR"/dev/input
 mknod "$FS_DIR"/dev/input/keyboard c 13 0
 mknod "$FS_DIR"/dev/input/mouse c 13 1
+mknod "$FS_DIR"/dev/input/events c 13 2
 mknod "$FS_DIR"/dev/ptmx c 5 2
 mknod "$FS_DIR"/dev/snd0 c 69 2
 mkdir -p "$FS_DIR"/dev/pts
@@ -49,6 +53,17 @@ msg "Setting up /sock/..."
 mkdir -p "$FS_DIR"/sock
 chmod 777 "$FS_DIR"/sock
 
+msg "Setting up /tmp/..."
+mkdir -p "$FS_DIR"/tmp
+chmod 1777 "$FS_DIR"/tmp
+
+msg "Setting up /var/cache/..."
+mkdir -p "$FS_DIR"/var/cache/thumbnails
+chmod 1777 "$FS_DIR"/var/cache/thumbnails
+mkdir -p "$FS_DIR"/var/cache/apps
+chmod 1777 "$FS_DIR"/var/cache/apps
+mkdir -p "$FS_DIR"/var/prefetch/apps
+
 msg "Setting up /etc/..."
 chown -R 0:0 "$FS_DIR"/etc
 
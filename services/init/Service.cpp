@@ -21,6 +21,8 @@
 #include <libduck/Config.h>
 #include <libduck/StringStream.h>
 #include <unistd.h>
+#include <libduck/Service.h>
+#include <spawn.h>
 
 Duck::ResultRet<Service> Service::load_service(Duck::Path path) {
 	auto config_res = Duck::Config::read_from(path);
@@ -33,7 +35,23 @@ Duck::ResultRet<Service> Service::load_service(Duck::Path path) {
 
 	auto& service = config["service"];
 
-	return Service(service["name"], service["exec"], service["after"]);
+	//Dependencies are separated by commas or spaces
+	auto split = [](const std::string& str) {
+		std::vector<std::string> ret;
+		std::string cur;
+		for(char c : str + ",") {
+			if(c == ',' || c == ' ') {
+				if(!cur.empty())
+					ret.push_back(cur);
+				cur.clear();
+			} else {
+				cur += c;
+			}
+		}
+		return ret;
+	};
+
+	return Service(service["name"], service["exec"], split(service["after"]), split(service["requires"]), service["notify"] == "true");
 }
 
 std::vector<Service> Service::get_all_services() {
@@ -66,40 +84,58 @@ const std::string& Service::exec() const {
 	return m_exec;
 }
 
-const std::string& Service::after() const {
+const std::vector<std::string>& Service::after() const {
 	return m_after;
 }
 
-void Service::execute() const {
-	Duck::Log::info("Starting service ", m_name, "...");
-	pid_t pid = fork();
-
-	if(pid == 0) {
-		Duck::StringInputStream exec_stream(m_exec);
-		exec_stream.set_delimeter(' ');
-
-		//Split arguments from exec command
-		std::vector<std::string> args;
-		std::string arg;
-		while(!exec_stream.eof()) {
-			exec_stream >> arg;
-			args.push_back(arg);
-		}
+const std::vector<std::string>& Service::required() const {
+	return m_required;
+}
 
-		//Convert c++ string vector into cstring array
-		const char* c_args[args.size() + 1];
-		for(auto i = 0; i < args.size(); i++)
-			c_args[i] = args[i].c_str();
-		c_args[args.size()] = NULL;
+bool Service::notify() const {
+	return m_notify;
+}
 
-		char* env[] = {NULL};
+Duck::ResultRet<pid_t> Service::execute(int notify_fd) const {
+	Duck::Log::info("Starting service ", m_name, "...");
+	Duck::StringInputStream exec_stream(m_exec);
+	exec_stream.set_delimeter(' ');
+
+	//Split arguments from exec command
+	std::vector<std::string> args;
+	std::string arg;
+	while(!exec_stream.eof()) {
+		exec_stream >> arg;
+		args.push_back(arg);
+	}
 
-		//Execute the command
-		execvpe(c_args[0], (char* const*) c_args, env);
-		Duck::Log::err("Failed to execute ", m_exec, ": ", strerror(errno));
-		exit(-1);
+	//Convert c++ string vector into cstring array
+	const char* c_args[args.size() + 1];
+	for(auto i = 0; i < args.size(); i++)
+		c_args[i] = args[i].c_str();
+	c_args[args.size()] = NULL;
+
+	//Give the service the pipe to notify us on, and tell it where it is
+	posix_spawn_file_actions_t file_actions;
+	posix_spawn_file_actions_init(&file_actions);
+	std::string notify_env = INIT_NOTIFY_FD_ENV "=" + std::to_string(SERVICE_NOTIFY_FD);
+	std::vector<char*> env;
+	if(m_notify && notify_fd >= 0) {
+		posix_spawn_file_actions_adddup2(&file_actions, notify_fd, SERVICE_NOTIFY_FD);
+		env.push_back(notify_env.data());
+	}
+	env.push_back(NULL);
+
+	//Spawn the command
+	pid_t pid;
+	int res = posix_spawnp(&pid, c_args[0], &file_actions, nullptr, (char* const*) c_args, env.data());
+	posix_spawn_file_actions_destroy(&file_actions);
+	if(res) {
+		Duck::Log::err("Failed to execute ", m_exec, ": ", strerror(res));
+		return Duck::Result(res);
 	}
+	return pid;
 }
 
-Service::Service(std::string name, std::string exec, std::string after):
-	m_name(std::move(name)), m_exec(std::move(exec)), m_after(std::move(after)) {}
+Service::Service(std::string name, std::string exec, std::vector<std::string> after, std::vector<std::string> required, bool notify):
+	m_name(std::move(name)), m_exec(std::move(exec)), m_after(std::move(after)), m_required(std::move(required)), m_notify(notify) {}
@@ -21,6 +21,9 @@
 #include <libduck/Path.h>
 #include <libduck/Result.h>
 
+// The file descriptor that services with notify=true get to notify init on
+#define SERVICE_NOTIFY_FD 3
+
 class Service {
 public:
 	static Duck::ResultRet<Service> load_service(Duck::Path path);
@@ -28,14 +31,26 @@ public:
 
 	const std::string& name() const;
 	const std::string& exec() const;
-	const std::string& after() const;
-
-	void execute() const;
+	/** The services that should be ready before this one starts. "boot" means it doesn't have to wait for anything. **/
+	const std::vector<std::string>& after() const;
+	/** Like after(), except this service won't be started at all if one of these fails. **/
+	const std::vector<std::string>& required() const;
+	/** Whether the service tells init when it's ready, rather than being ready as soon as it's started. **/
+	bool notify() const;
+
+	/**
+	 * Starts the service.
+	 * @param notify_fd The write end of a pipe that the service will notify init on, given to it as SERVICE_NOTIFY_FD.
+	 * Only used if the service has notify=true.
+	 */
+	Duck::ResultRet<pid_t> execute(int notify_fd = -1) const;
 
 private:
-	Service(std::string name, std::string exec, std::string after);
+	Service(std::string name, std::string exec, std::vector<std::string> after, std::vector<std::string> required, bool notify);
 
-	std::string m_name, m_exec, m_after;
+	std::string m_name, m_exec;
+	std::vector<std::string> m_after, m_required;
+	bool m_notify;
 };
 
 
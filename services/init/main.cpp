@@ -2,6 +2,8 @@
 #include <cstdio>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <string.h>
+#include <stdlib.h>
 #include <cerrno>
 #include <cstring>
 #include <cstdlib>
@@ -31,10 +33,253 @@
 // The init system for duckOS.
 
 #include <libduck/Log.h>
+#include <libduck/Time.h>
 #include "Service.h"
+#include <kernel/api/prefetch.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <algorithm>
+
+// How long to wait for a service to say it's ready before starting the ones after it anyway
+#define SERVICE_READY_TIMEOUT_US 10000000
+// Where the pages of files used while booting are kept. Deleting it makes the next boot record them again.
+#define BOOT_PREFETCH_LIST "/var/prefetch/boot"
 
 using Duck::Log, Duck::Config;
 
+struct BootService {
+	enum State {
+		WAITING, STARTING, READY, FAILED
+	};
+
+	Service service;
+	State state = WAITING;
+	int notify_fd = -1;
+	int64_t start_us = 0;
+	int64_t ready_us = 0;
+};
+
+struct TimelineEvent {
+	int64_t time_us;
+	std::string description;
+};
+
+std::vector<BootService> boot_services;
+std::vector<TimelineEvent> timeline;
+int prefetch_fd = -1;
+
+int64_t now_us() {
+	return (int64_t) (Duck::Time::monotonic_nanos() / 1000);
+}
+
+BootService* find_service(const std::string& name) {
+	for(auto& boot_service : boot_services)
+		if(boot_service.service.name() == name)
+			return &boot_service;
+	return nullptr;
+}
+
+void set_ready(BootService& boot_service) {
+	boot_service.state = BootService::READY;
+	boot_service.ready_us = now_us();
+	timeline.push_back({boot_service.ready_us, boot_service.service.name() + " ready"});
+	if(boot_service.notify_fd >= 0) {
+		close(boot_service.notify_fd);
+		boot_service.notify_fd = -1;
+	}
+}
+
+void set_failed(BootService& boot_service, const std::string& reason) {
+	Log::err("Service ", boot_service.service.name(), " failed: ", reason);
+	boot_service.state = BootService::FAILED;
+	timeline.push_back({now_us(), boot_service.service.name() + " failed"});
+	if(boot_service.notify_fd >= 0) {
+		close(boot_service.notify_fd);
+		boot_service.notify_fd = -1;
+	}
+}
+
+/** Checks whether a service can start yet. If a service it requires failed, it's marked as failed too. **/
+bool can_start(BootService& boot_service) {
+	auto check = [&](const std::string& name, bool required) {
+		if(name == "boot")
+			return true;
+		auto* dependency = find_service(name);
+		if(!dependency) {
+			if(required)
+				set_failed(boot_service, "requires " + name + ", which doesn't exist");
+			return !required;
+		}
+		if(dependency->state == BootService::FAILED && required) {
+			set_failed(boot_service, "requires " + name + ", which failed");
+			return false;
+		}
+		return dependency->state == BootService::READY || dependency->state == BootService::FAILED;
+	};
+
+	for(auto& name : boot_service.service.required())
+		if(!check(name, true))
+			return false;
+	for(auto& name : boot_service.service.after())
+		if(!check(name, false))
+			return false;
+	return true;
+}
+
+void start_service(BootService& boot_service) {
+	int notify_pipe[2] = {-1, -1};
+	if(boot_service.service.notify() && pipe2(notify_pipe, O_CLOEXEC) < 0)
+		Log::warn("Couldn't make a pipe for ", boot_service.service.name(), " to notify on: ", strerror(errno));
+
+	boot_service.start_us = now_us();
+	timeline.push_back({boot_service.start_us, boot_service.service.name() + " started"});
+	auto res = boot_service.service.execute(notify_pipe[1]);
+	if(notify_pipe[1] >= 0)
+		close(notify_pipe[1]);
+	boot_service.notify_fd = notify_pipe[0];
+
+	if(res.is_error())
+		set_failed(boot_service, res.strerror());
+	else if(boot_service.notify_fd < 0)
+		set_ready(boot_service);
+	else
+		boot_service.state = BootService::STARTING;
+}
+
+/** Starts every service as soon as the services it comes after are ready, so independent ones start in parallel. **/
+void boot() {
+	while(true) {
+		//Start everything we can. Starting or failing a service can let others start, so keep going until nothing changes
+		bool changed = true;
+		while(changed) {
+			changed = false;
+			for(auto& boot_service : boot_services) {
+				if(boot_service.state != BootService::WAITING)
+					continue;
+				if(can_start(boot_service))
+					start_service(boot_service);
+				changed |= boot_service.state != BootService::WAITING;
+			}
+		}
+
+		//Wait for the services that are starting to be ready
+		std::vector<pollfd> pollfds;
+		std::vector<BootService*> starting;
+		for(auto& boot_service : boot_services) {
+			if(boot_service.state != BootService::STARTING)
+				continue;
+			pollfds.push_back({boot_service.notify_fd, POLLIN, 0});
+			starting.push_back(&boot_service);
+		}
+		if(starting.empty())
+			break;
+
+		int64_t timeout_us = SERVICE_READY_TIMEOUT_US;
+		for(auto* boot_service : starting)
+			timeout_us = std::min(timeout_us, boot_service->start_us + SERVICE_READY_TIMEOUT_US - now_us());
+		poll(pollfds.data(), pollfds.size(), (int) std::max(timeout_us / 1000, (int64_t) 0));
+
+		for(size_t i = 0; i < starting.size(); i++) {
+			auto& boot_service = *starting[i];
+			if(pollfds[i].revents) {
+				//The service closing the pipe without writing anything means it exited before it was ready
+				char buf;
+				if(read(boot_service.notify_fd, &buf, 1) > 0)
+					set_ready(boot_service);
+				else
+					set_failed(boot_service, "exited before it was ready");
+			} else if(now_us() - boot_service.start_us >= SERVICE_READY_TIMEOUT_US) {
+				Log::warn("Service ", boot_service.service.name(), " took too long to be ready, starting the services after it anyway");
+				set_ready(boot_service);
+			}
+		}
+	}
+
+	//Anything still waiting depends on itself somehow
+	for(auto& boot_service : boot_services)
+		if(boot_service.state == BootService::WAITING)
+			set_failed(boot_service, "its dependencies never finished starting (is there a cycle?)");
+}
+
+/** Writes the kernel's boot phases and when each service started and was ready to /tmp/boot-timeline. **/
+void write_timeline() {
+	FILE* kernel_file = fopen("/proc/boot", "r");
+	if(kernel_file) {
+		char line[128];
+		while(fgets(line, sizeof(line), kernel_file)) {
+			line[strcspn(line, "\n")] = '\0';
+			char* name;
+			int64_t time = strtoll(line, &name, 10);
+			timeline.push_back({time, std::string("kernel: ") + (*name ? name + 1 : name)});
+		}
+		fclose(kernel_file);
+	}
+
+	std::stable_sort(timeline.begin(), timeline.end(), [](auto& a, auto& b) { return a.time_us < b.time_us; });
+	if(timeline.empty())
+		return;
+
+	FILE* file = fopen("/tmp/boot-timeline", "w");
+	if(!file)
+		return;
+	auto start = timeline[0].time_us;
+	for(auto& event : timeline)
+		fprintf(file, "%10.3fms %s\n", (event.time_us - start) / 1000.0, event.description.c_str());
+	fclose(file);
+	Log::info("Booted in ", std::to_string((timeline.back().time_us - start) / 1000), "ms. The timeline is in /tmp/boot-timeline.");
+}
+
+/**
+ * Reads in the pages of files that were used during the last boot, so services don't have to wait on the disk for
+ * them one fault at a time. If they haven't been recorded yet, records them during this boot instead.
+ **/
+void start_prefetch() {
+	int fd = open("/dev/prefetch", O_RDWR | O_CLOEXEC);
+	if(fd < 0)
+		return;
+
+	FILE* list = fopen(BOOT_PREFETCH_LIST, "r");
+	if(list) {
+		std::vector<prefetch_entry> entries(PREFETCH_MAX_ENTRIES);
+		size_t num_entries = fread(entries.data(), sizeof(prefetch_entry), entries.size(), list);
+		fclose(list);
+		if(write(fd, entries.data(), num_entries * sizeof(prefetch_entry)) < 0)
+			Log::warn("Couldn't prefetch the pages used while booting: ", strerror(errno));
+		close(fd);
+		return;
+	}
+
+	if(ioctl(fd, PREFETCH_RECORD_START, getpid()) < 0) {
+		close(fd);
+		return;
+	}
+	prefetch_fd = fd;
+}
+
+/** Saves the pages of files used while booting if they were being recorded. **/
+void finish_prefetch() {
+	if(prefetch_fd < 0)
+		return;
+	ioctl(prefetch_fd, PREFETCH_RECORD_STOP, 0);
+
+	mkdir("/var/prefetch", 0755);
+	FILE* list = fopen(BOOT_PREFETCH_LIST, "w");
+	if(list) {
+		prefetch_entry buf[64];
+		ssize_t nread;
+		while((nread = read(prefetch_fd, buf, sizeof(buf))) > 0)
+			fwrite(buf, 1, nread, list);
+		fclose(list);
+	} else {
+		Log::warn("Couldn't save the pages used while booting: ", strerror(errno));
+	}
+	close(prefetch_fd);
+	prefetch_fd = -1;
+}
+
 int main(int argc, char** argv, char** envp) {
 	if(getpid() != 1) {
 		printf("pid != 1. Exiting.\n");
@@ -47,11 +292,13 @@ int main(int argc, char** argv, char** envp) {
 	//Load services
 	auto services = Service::get_all_services();
 
-	//Start boot services
-	for(auto& service : services) {
-		if(service.after() == "boot")
-			service.execute();
-	}
+	//Start services
+	for(auto& service : services)
+		boot_services.push_back({service});
+	start_prefetch();
+	boot();
+	finish_prefetch();
+	write_timeline();
 
 	//Wait for all child processes
 	while(1) {
@@ -21,6 +21,7 @@
 #include "Display.h"
 #include "Server.h"
 #include "FontManager.h"
+#include "ImageCache.h"
 #include <libduck/Log.h>
 #include <libpond/packet.h>
 
@@ -54,21 +55,59 @@ Client::~Client() {
 }
 
 void Client::mouse_moved(Window* window, Gfx::Point delta, Gfx::Point relative_pos, Gfx::Point absolute_pos) {
-	SEND_MESSAGE("mouse_moved", (MouseMovePkt {window->id(), delta, relative_pos, absolute_pos}));
+	//Movement is held back until the batch of input is done, and anything that's already out of date gets dropped
+	auto pending = pending_motion.find(window->id());
+	if(pending != pending_motion.end()) {
+		pending->second.delta = pending->second.delta + delta;
+		pending->second.relative = relative_pos;
+		pending->second.absolute = absolute_pos;
+	} else {
+		pending_motion[window->id()] = {window->id(), delta, relative_pos, absolute_pos};
+	}
 }
 
 void Client::mouse_buttons_changed(Window* window, uint8_t new_buttons) {
+	//Other mouse events have to come after the movement that led up to them
+	send_motion(window->id(), true);
 	SEND_MESSAGE("mouse_button", (MouseButtonPkt {window->id(), new_buttons}));
 }
 
 void Client::mouse_scrolled(Window* window, int scroll) {
+	send_motion(window->id(), true);
 	SEND_MESSAGE("mouse_scrolled", (MouseScrollPkt {window->id(), scroll}));
 }
 
 void Client::mouse_left(Window* window) {
+	send_motion(window->id(), true);
 	SEND_MESSAGE("mouse_left", (MouseLeavePkt {window->id()}));
 }
 
+void Client::flush_input() {
+	for(auto it = pending_motion.begin(); it != pending_motion.end();) {
+		int window_id = (it++)->first;
+		send_motion(window_id, false);
+	}
+}
+
+void Client::send_motion(int window_id, bool force) {
+	auto pending = pending_motion.find(window_id);
+	if(pending == pending_motion.end())
+		return;
+
+	//A window with a motion hint only gets more movement once it's taken the last of it off of its queue
+	auto window = windows.find(window_id);
+	bool motion_hint = window != windows.end() && window->second->motion_hint();
+	if(motion_hint && !force && unhandled_motion.count(window_id))
+		return;
+
+	if(window != windows.end()) {
+		SEND_MESSAGE("mouse_moved", pending->second);
+		if(motion_hint)
+			unhandled_motion.insert(window_id);
+	}
+	pending_motion.erase(pending);
+}
+
 void Client::keyboard_event(Window* window, const KeyboardEvent& event) {
 	SEND_MESSAGE("key_event", (KeyEventPkt {window->id(), event.scancode, event.key, event.character, event.modifiers}));
 }
@@ -171,6 +210,15 @@ FontResponsePkt Client::get_font(GetFontPkt& params) {
 	return {font ? font->shm_id() : -1};
 }
 
+ImageResponsePkt Client::get_image(GetImagePkt& params) {
+	auto* image = ImageCache::inst().get_image(params.path.str());
+	if(!image)
+		return {-1, {0, 0}};
+
+	image->buffer->allow(pid, true, false);
+	return {image->buffer->id(), image->dimensions};
+}
+
 void Client::set_title(SetTitlePkt& params) {
 	auto* window = windows[params.window_id];
 	if(window)
@@ -213,6 +261,10 @@ void Client::focus_window(Pond::WindowFocusPkt& pkt) {
 		window->focus();
 }
 
+void Client::mouse_motion_handled(Pond::MouseMotionHandledPkt& pkt) {
+	unhandled_motion.erase(pkt.window_id);
+}
+
 void Client::set_minimum_size(Pond::WindowMinSizePkt& pkt) {
 	auto* window = windows[pkt.window_id];
 	if(window)
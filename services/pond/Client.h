@@ -21,6 +21,7 @@
 
 #include <sys/types.h>
 #include <map>
+#include <set>
 #include <sys/socketfs.h>
 #include "Window.h"
 #include <libapp/App.h>
@@ -44,12 +45,19 @@ public:
 	void window_resized(Window* window);
 	void window_focused(Window* window, bool focused);
 
+	/**
+	 * Sends the mouse movement that's been held back since the last time. The event loop calls this once it's handled
+	 * everything it read, so a window gets at most one movement event per batch of input.
+	 */
+	void flush_input();
+
 	Pond::WindowOpenedPkt open_window(Pond::OpenWindowPkt& packet);
 	void destroy_window(Pond::WindowDestroyPkt& packet);
 	void move_window(Pond::WindowMovePkt& packet);
 	Pond::WindowResizedPkt resize_window(Pond::WindowResizePkt& packet);
 	void invalidate_window(Pond::WindowInvalidatePkt& packet);
 	Pond::FontResponsePkt get_font(Pond::GetFontPkt& packet);
+	Pond::ImageResponsePkt get_image(Pond::GetImagePkt& packet);
 	void set_title(Pond::SetTitlePkt& packet);
 	void reparent(Pond::WindowReparentPkt& packet);
 	void set_hint(Pond::SetHintPkt& packet);
@@ -59,6 +67,7 @@ public:
 	const App::Info& get_app_info();
 	void focus_window(Pond::WindowFocusPkt& pkt);
 	void set_minimum_size(Pond::WindowMinSizePkt& pkt);
+	void mouse_motion_handled(Pond::MouseMotionHandledPkt& pkt);
 
 private:
 	Server* server;
@@ -67,6 +76,10 @@ private:
 	std::map<int, Window*> windows;
 	bool disconnected = false;
 	App::Info app_info;
+	std::map<int, Pond::MouseMovePkt> pending_motion; ///< Mouse movement not sent yet, combined into one event per window.
+	std::set<int> unhandled_motion; ///< Windows with a motion hint that haven't taken their last movement event yet.
+
+	void send_motion(int window_id, bool force);
 };
 
 
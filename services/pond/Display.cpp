@@ -20,6 +20,7 @@
 
 #include "Display.h"
 #include "FontManager.h"
+#include "Shadow.h"
 #include <libgraphics/Image.h>
 #include <libgraphics/PNG.h>
 #include <libduck/Log.h>
@@ -29,7 +30,15 @@
 #include <sys/ioctl.h>
 #include <kernel/device/VGADevice.h>
 #include <sys/input.h>
-#include <libgraphics/Memory.h>
+#include <sys/thread.h>
+#include <time.h>
+#include <algorithm>
+
+#define DISPLAY_FRAME_NANOS (1000000000LL / 60)
+//How many buffers of video memory to flip between, if the video device can pan through that many
+#define DISPLAY_VIDEO_BUFFERS 3
+//The size of the squares the display is split into for finding which window the mouse is over
+#define DISPLAY_HIT_GRID_CELL_SIZE 64
 
 using namespace Gfx;
 using Duck::Log, Duck::Config, Duck::ResultRet;
@@ -54,6 +63,11 @@ Display::Display(): _dimensions({0, 0, 0, 0}) {
 		return;
 	}
 
+	//Ask for enough video memory to flip between several buffers. The rows may be padded, so find out how far apart they are.
+	video_mode mode = {_dimensions.width, _dimensions.height, _dimensions.height * DISPLAY_VIDEO_BUFFERS, 0};
+	if(ioctl(framebuffer_fd, IO_VIDEO_SET_MODE, &mode) < 0 && ioctl(framebuffer_fd, IO_VIDEO_GET_MODE, &mode) < 0)
+		mode = {_dimensions.width, _dimensions.height, _dimensions.height, (int) (_dimensions.width * sizeof(Gfx::Color))};
+
 	Gfx::Color* buffer;
 
 	if(ioctl(framebuffer_fd, IO_VIDEO_MAP, &buffer) < 0) {
@@ -65,18 +79,22 @@ Display::Display(): _dimensions({0, 0, 0, 0}) {
 	ioctl(STDOUT_FILENO, TIOSGFX, nullptr);
 
 	//If we can set the offset into video memory, that means we can flip the display buffer and write directly to it
-	if(!ioctl(framebuffer_fd, IO_VIDEO_OFFSET, 0))
-		_buffer_mode = BufferMode::DoubleFlip;
+	_num_video_buffers = std::min(mode.virtual_height / mode.height, DISPLAY_VIDEO_BUFFERS);
+	if(_num_video_buffers > 1 && !ioctl(framebuffer_fd, IO_VIDEO_OFFSET, 0))
+		_buffer_mode = BufferMode::Flip;
 	else
 		_buffer_mode = BufferMode::Double;
 
-	_framebuffer = {buffer, _dimensions.width, _dimensions.height};
-	Log::info("Display opened and mapped (", _dimensions.width, " x ", _dimensions.height, ")");
-
-	if((_keyboard_fd = open("/dev/input/keyboard", O_RDONLY | O_CLOEXEC)) < 0)
-		perror("Failed to open keyboard");
+	//Padding at the end of each row is treated as part of the framebuffer, which nothing ever draws to
+	_framebuffer = {buffer, mode.pitch / (int) sizeof(Gfx::Color), _dimensions.height};
+	Log::info("Display opened and mapped (", _dimensions.width, " x ", _dimensions.height, ", ",
+			  _buffer_mode == BufferMode::Flip ? _num_video_buffers : 1, " video buffer(s))");
 
-	gettimeofday(&paint_time, NULL);
+	//Movement that piles up while we're busy is merged by the kernel, since we'd only handle it as one move anyway
+	if((_input_fd = open("/dev/input/events", O_RDONLY | O_CLOEXEC)) < 0)
+		perror("Failed to open input events");
+	else
+		ioctl(_input_fd, INPUT_SET_COALESCE, 1);
 }
 
 Gfx::Rect Display::dimensions() {
@@ -88,10 +106,7 @@ Framebuffer& Display::framebuffer() {
 }
 
 void Display::clear(uint32_t color) {
-	size_t framebuffer_size = _dimensions.area();
-	for(size_t i = 0; i < framebuffer_size; i++) {
-		_framebuffer.data[i] = color;
-	}
+	_framebuffer.fill(_dimensions, color);
 }
 
 Duck::Result Display::load_config() {
@@ -137,7 +152,8 @@ Mouse* Display::mouse_window() {
 }
 
 void Display::add_window(Window* window) {
-	_windows.push_back(window);
+	window->_z_position = _windows.insert(_windows.end(), window);
+	_hit_grid_dirty = true;
 }
 
 void Display::remove_window(Window* window) {
@@ -151,17 +167,100 @@ void Display::remove_window(Window* window) {
 		_resize_window = nullptr;
 	if(window == _mousedown_window)
 		_mousedown_window = nullptr;
-	for(size_t i = 0; i < _windows.size(); i++) {
-		if(_windows[i] == window) {
-			_windows.erase(_windows.begin() + i);
+	//The root window isn't in the z-order
+	if(window == _root_window)
+		return;
+	_windows.erase(window->_z_position);
+	_hit_grid_dirty = true;
+}
+
+void Display::invalidate(const Gfx::Rect& rect) {
+	if(rect.empty())
+		return;
+	//The compositor only needs waking up if it's waiting for something to draw
+	bool was_empty = invalid_region.empty();
+	invalid_region.add(rect);
+	if(was_empty)
+		pthread_cond_signal(&_damage_cond);
+}
+
+void Display::cursor_changed(bool image_changed) {
+	if(image_changed) {
+		auto& cursor_buffer = _mouse_window->framebuffer();
+		video_cursor cursor = {cursor_buffer.data, cursor_buffer.width, cursor_buffer.height};
+		_hardware_cursor = ioctl(framebuffer_fd, IO_VIDEO_SET_CURSOR, &cursor) == 0;
+	}
+
+	if(_hardware_cursor) {
+		auto position = _mouse_window->absolute_rect().position();
+		video_cursor_position cursor_position = {position.x, position.y};
+		ioctl(framebuffer_fd, IO_VIDEO_MOVE_CURSOR, &cursor_position);
+		//A software cursor might still need taking off of the display buffer
+		if(!image_changed)
 			return;
-		}
 	}
+
+	bool was_idle = !_cursor_dirty && invalid_region.empty();
+	_cursor_dirty = true;
+	if(was_idle)
+		pthread_cond_signal(&_damage_cond);
 }
 
-void Display::invalidate(const Gfx::Rect& rect) {
-	if(!rect.empty())
-		invalid_areas.push_back(rect);
+void Display::start_compositor() {
+	//Nothing would ever get drawn without it, so there's no point carrying on
+	if(thread_create(compositor_thread, this) < 0) {
+		perror("Failed to start compositor thread");
+		exit(-1);
+	}
+}
+
+void Display::lock() {
+	pthread_mutex_lock(&_lock);
+}
+
+void Display::unlock() {
+	pthread_mutex_unlock(&_lock);
+}
+
+void* Display::compositor_thread(void* display) {
+	((Display*) display)->run_compositor();
+	return nullptr;
+}
+
+static int64_t timespec_nanos(const timespec& time) {
+	return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+void Display::run_compositor() {
+	int64_t next_frame = 0;
+	lock();
+	while(true) {
+		//Sleep until something's been invalidated
+		while(invalid_region.empty() && !_cursor_dirty)
+			pthread_cond_wait(&_damage_cond, &_lock);
+
+		/*
+		 * Frames are drawn on a steady grid of 1/60 second intervals, so however the damage arrives it gets drawn at an
+		 * even pace. Waiting lets go of the lock, so the event loop keeps handling input and adding damage for the frame.
+		 */
+		timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		//If nothing's been drawn for a while, the grid starts over from now instead of rushing out frames to catch up
+		if(timespec_nanos(now) - next_frame > DISPLAY_FRAME_NANOS)
+			next_frame = timespec_nanos(now);
+		while(timespec_nanos(now) < next_frame) {
+			timespec deadline = {(time_t) (next_frame / 1000000000LL), (long) (next_frame % 1000000000LL)};
+			pthread_cond_timedwait(&_frame_cond, &_lock, &deadline);
+			clock_gettime(CLOCK_REALTIME, &now);
+		}
+		next_frame += DISPLAY_FRAME_NANOS;
+
+		//Composing needs the windows to stay put, but flipping only touches the display buffers
+		repaint();
+		unlock();
+		flip_buffers();
+		lock();
+	}
 }
 
 //#define DEBUG_REPAINT_PERF
@@ -171,94 +270,86 @@ void Display::repaint() {
 	gettimeofday(&t0, nullptr);
 #endif
 
-	if(!invalid_areas.empty())
-		display_buffer_dirty = true;
-	else
+	if(invalid_region.empty() && !_cursor_dirty)
 		return;
+	display_buffer_dirty = true;
 
-	//If it hasn't been 1/60 of a second since the last repaint, don't bother
-	if(millis_until_next_flip())
-		return;
-	gettimeofday(&paint_time, NULL);
-
-	auto& fb = _buffer_mode == BufferMode::Single ? _framebuffer : _root_window->framebuffer();
-
-	//Combine areas that overlap
-	auto it = invalid_areas.begin();
-	while(it != invalid_areas.end()) {
-		bool remove_area = false;
-		for(auto & other_area : invalid_areas) {
-			if(&*it != &other_area && it->collides(other_area)) {
-				other_area = it->combine(other_area);
-				remove_area = true;
-				break;
-			}
-		}
-		if(remove_area)
-			invalid_areas.erase(it);
-		else
-			it++;
-	}
+	auto& buffer = _buffer_mode == BufferMode::Single ? _framebuffer : _root_window->framebuffer();
 
-	//If double buffering, combine the invalid areas together to calculate the portion of the framebuffer to be redrawn
-	if(_buffer_mode == BufferMode::Double) {
-		//If the invalid buffer area is empty (has an x of -1), initialize it to the first invalid area
-		if(_invalid_buffer_area.x == -1)
-			_invalid_buffer_area = invalid_areas[0];
-		for(auto& area : invalid_areas)
-			_invalid_buffer_area = _invalid_buffer_area.combine(area);
+	//When double buffering, everything is drawn through a tracked copy of the buffer so the next flip knows what changed
+	Gfx::Framebuffer fb = {buffer.data, buffer.width, buffer.height};
+	if(_buffer_mode != BufferMode::Single) {
+		if(_buffer_damage.dimensions() != Gfx::Dimensions {buffer.width, buffer.height})
+			_buffer_damage.resize({buffer.width, buffer.height});
+		fb.damage = &_buffer_damage;
 	}
 
-	for(auto& area : invalid_areas) {
-		// Fill the invalid area with the background.
-		fb.copy(_background_framebuffer, area, area.position());
+	//Take the cursor off of the display buffer first, so everything else gets drawn underneath it
+	if(_cursor_drawn_rect.width > 0)
+		fb.copy(_cursor_under, {0, 0, _cursor_drawn_rect.width, _cursor_drawn_rect.height}, _cursor_drawn_rect.position());
+	_cursor_drawn_rect = {0, 0, 0, 0};
+	_cursor_dirty = false;
+
+	//Draws the part of a window (and its shadow) inside of an area
+	auto draw_window = [&](Window* window, const Gfx::Rect& area) {
+		Gfx::Rect window_abs = window->absolute_rect();
+		Gfx::Rect overlap_abs = area.overlapping_area(window_abs);
+		auto transformed_overlap = overlap_abs.transform({-window_abs.x, -window_abs.y});
+		if(window->uses_alpha())
+			fb.copy_blitting(window->visible_framebuffer(), transformed_overlap, overlap_abs.position());
+		else
+			fb.copy(window->visible_framebuffer(), transformed_overlap, overlap_abs.position());
 
-		// See if each window overlaps the invalid area.
-		for(auto window : _windows) {
-			//Don't bother with the mouse window or hidden windows, we draw it separately so it's always on top
-			if(window == _mouse_window || window->hidden())
-				continue;
-
-			auto window_old_rect = window->old_absolute_shadow_rect();
-			auto window_shabs = window->absolute_shadow_rect();
-			auto window_collision_rect = window_old_rect.empty() ? window_shabs : window_old_rect;
-			if(window_collision_rect.collides(area)) {
-				//If it does, redraw the intersection of the window in question and the invalid area
-				Gfx::Rect window_abs = window->absolute_rect();
-				Gfx::Rect overlap_abs = area.overlapping_area(window_abs);
-				auto transformed_overlap = overlap_abs.transform({-window_abs.x, -window_abs.y});
-				if(window->uses_alpha())
-					fb.copy_blitting(window->framebuffer(), transformed_overlap, overlap_abs.position());
-				else
-					fb.copy(window->framebuffer(), transformed_overlap, overlap_abs.position());
-
-				// Draw the shadow
-				if(window->has_shadow()) {
-					auto draw_shadow = [&](Gfx::Framebuffer& shadow_buffer, Rect rect) {
-						Gfx::Rect shadow_abs = area.overlapping_area(rect);
-						if(shadow_abs.empty())
-							return;
-						fb.copy_blitting(shadow_buffer, shadow_abs.transform(rect.position() * -1), shadow_abs.position());
-					};
-
-					auto shadow_size = window_abs.x - window_shabs.x;
-					draw_shadow(window->shadow_buffers()[0], window_shabs.inset(0, 0, window_shabs.height - shadow_size, 0));
-					draw_shadow(window->shadow_buffers()[1], window_shabs.inset(window_shabs.height - shadow_size, 0, 0, 0));
-					draw_shadow(window->shadow_buffers()[2], window_shabs.inset(shadow_size, window_shabs.width - shadow_size, shadow_size, 0));
-					draw_shadow(window->shadow_buffers()[3], window_shabs.inset(shadow_size, 0, shadow_size, window_shabs.width - shadow_size));
-				}
-			}
-		}
+		// Draw the shadow
+		if(window->has_shadow())
+			Shadow::draw(fb, window_abs, area);
+	};
+
+	/*
+	 * Go through the windows front to back, keeping track of the part of the invalid region that isn't covered by an
+	 * opaque window yet. Each window only needs to draw where it overlaps that, and once everything is covered nothing
+	 * below needs drawing at all. Windows with alpha or a resize in progress don't cover anything, but their shadows get
+	 * drawn over whatever's below them since that's drawn first.
+	 */
+	Gfx::Region uncovered = std::move(invalid_region);
+	invalid_region.clear();
+	_visible_parts.clear();
+	for(auto it = _windows.rbegin(); it != _windows.rend() && !uncovered.empty(); it++) {
+		auto window = *it;
+		//Don't bother with the mouse window or hidden windows, we draw it separately so it's always on top
+		if(window == _mouse_window || window->hidden())
+			continue;
+
+		auto window_old_rect = window->old_absolute_shadow_rect();
+		auto window_collision_rect = window_old_rect.empty() ? window->absolute_shadow_rect() : window_old_rect;
+		if(!uncovered.collides(window_collision_rect))
+			continue;
+		for(auto& area : uncovered.intersected(window_collision_rect).rects())
+			_visible_parts.push_back({window, area});
+		if(!window->uses_alpha() && window_old_rect.empty())
+			uncovered.subtract(window->absolute_rect());
 	}
-	invalid_areas.resize(0);
+
+	// Fill whatever's left uncovered with the background, and then draw the visible parts of windows back to front.
+	for(auto& area : uncovered.rects())
+		fb.copy(_background_framebuffer, area, area.position());
+	for(auto part = _visible_parts.rbegin(); part != _visible_parts.rend(); part++)
+		draw_window(part->window, part->area);
 
 	//If we're resizing a window, draw the outline
 	if(_resize_window)
 		fb.outline(_resize_rect, RGB(255, 255, 255));
 
-	//Draw the mouse.
-	fb.draw_image(_mouse_window->framebuffer(), {0, 0, _mouse_window->rect().width, _mouse_window->rect().height},
-				  _mouse_window->absolute_rect().position());
+	//Then put the cursor back on top, keeping what's underneath it so it can be moved without repainting anything
+	Gfx::Rect cursor_abs = _mouse_window->absolute_rect();
+	Gfx::Rect cursor_rect = cursor_abs.overlapping_area({0, 0, fb.width, fb.height});
+	if(!_hardware_cursor && cursor_rect.width > 0 && cursor_rect.height > 0) {
+		if(_cursor_under.width < cursor_rect.width || _cursor_under.height < cursor_rect.height)
+			_cursor_under = Gfx::Framebuffer(cursor_abs.width, cursor_abs.height);
+		_cursor_under.copy(fb, cursor_rect, {0, 0});
+		fb.draw_image(_mouse_window->framebuffer(), cursor_rect.transform(cursor_abs.position() * -1), cursor_rect.position());
+		_cursor_drawn_rect = cursor_rect;
+	}
 
 #ifdef DEBUG_REPAINT_PERF
 	gettimeofday(&t1, nullptr);
@@ -273,46 +364,49 @@ void Display::repaint() {
 	fb.fill({0, 0, 50, 14}, RGB(0, 0, 0));
 	fb.draw_text(buf, {0, 0}, FontManager::inst().get_font("gohu-14"), RGB(255, 255, 255));
 #endif
-
-	//Flip the display buffers.
-	flip_buffers();
 }
 
-bool flipped = false;
 void Display::flip_buffers() {
 	//If the screen buffer isn't dirty, don't bother
 	if(!display_buffer_dirty)
 		return;
 
-	if(_buffer_mode == BufferMode::DoubleFlip) {
-		auto* video_buf = &_framebuffer.data[flipped ? _framebuffer.height * _framebuffer.width : 0];
-		memcpy_uint32((uint32_t*) video_buf, (uint32_t*) _root_window->framebuffer().data, _framebuffer.width * _framebuffer.height);
-		ioctl(framebuffer_fd, IO_VIDEO_OFFSET, flipped ? _framebuffer.height : 0);
-		flipped = !flipped;
+	if(_buffer_mode == BufferMode::Flip) {
+		//Draw to the buffer after the one being displayed. With more than two, the one that was just flipped away from
+		//can still be scanned out while we draw, so there's never a wait for it.
+		int next_buffer = (_video_buffer + 1) % _num_video_buffers;
+		auto* video_buf = &_framebuffer.data[next_buffer * _framebuffer.height * _framebuffer.width];
+		Gfx::Framebuffer video_fb = {video_buf, _framebuffer.width, _framebuffer.height};
+
+		//The buffer being drawn to was last drawn to before the previous flips, so it's missing their damage too
+		auto damage = _buffer_damage.regions();
+		for(auto& flip_damage : _flip_damage)
+			for(auto& area : flip_damage)
+				_buffer_damage.add(area);
+		for(auto& area : _buffer_damage.regions())
+			video_fb.copy(_root_window->framebuffer(), area, area.position());
+		_flip_damage.push_back(std::move(damage));
+		if((int) _flip_damage.size() >= _num_video_buffers)
+			_flip_damage.pop_front();
+		_buffer_damage.clear();
+		ioctl(framebuffer_fd, IO_VIDEO_OFFSET, next_buffer * _framebuffer.height);
+		_video_buffer = next_buffer;
 	} else if(_buffer_mode == BufferMode::Double) {
-		_framebuffer.copy(_root_window->framebuffer(), _invalid_buffer_area, _invalid_buffer_area.position());
-		_invalid_buffer_area.x = -1;
+		//Only the tiles that were drawn to get copied, so changes on opposite sides of the screen don't copy everything between
+		for(auto& area : _buffer_damage.regions())
+			_framebuffer.copy(_root_window->framebuffer(), area, area.position());
+		_buffer_damage.clear();
 	}
 
 	display_buffer_dirty = false;
 }
 
-int Display::millis_until_next_flip() const {
-	timeval new_time = {0, 0};
-	gettimeofday(&new_time, NULL);
-	int diff = (int) (((new_time.tv_sec - paint_time.tv_sec) * 1000000) + (new_time.tv_usec - paint_time.tv_usec))/1000;
-	return diff >= 16 ? 0 : 16 - diff;
-}
-
 void Display::move_to_front(Window* window) {
-	for (auto it = _windows.begin(); it != _windows.end(); it++) {
-		if(*it == window) {
-			_windows.erase(it);
-			_windows.push_back(window);
-			window->invalidate();
-			return;
-		}
-	}
+	if(window == _root_window)
+		return;
+	_windows.splice(_windows.end(), _windows, window->_z_position);
+	_hit_grid_dirty = true;
+	window->invalidate();
 }
 
 void Display::focus(Window* window) {
@@ -385,16 +479,14 @@ void Display::create_mouse_events(int delta_x, int delta_y, int scroll, uint8_t
 		return;
 	}
 
+	//Only the windows in the hit-test grid cell the mouse is in could be under it
 	Window* event_window = nullptr;
-	for (auto it = _windows.rbegin(); it != _windows.rend(); it++) {
-		auto* window = *it;
-		if(window == _mouse_window || window == _root_window || window->hidden())
-			continue;
-
+	static bool was_near_border = false;
+	bool near_border = false;
+	for(auto* window : windows_at(mouse)) {
 		//If it's near the border, see if we can resize it
-		static bool was_near_border = false;
 		if(!_resize_window && window->resizable() && mouse.near_border(window->absolute_rect(), WINDOW_RESIZE_BORDER)) {
-			was_near_border = true;
+			near_border = true;
 			_resize_mode = get_resize_mode(window->absolute_rect(), mouse);
 			switch(_resize_mode) {
 				case NORTH:
@@ -424,9 +516,6 @@ void Display::create_mouse_events(int delta_x, int delta_y, int scroll, uint8_t
 				window->move_to_front();
 			}
 			break;
-		} else if(was_near_border && !_resize_window) {
-			was_near_border = false;
-			_mouse_window->set_cursor(Pond::NORMAL);
 		}
 
 		//Otherwise, if it's in the window, create the appropriate events
@@ -455,6 +544,11 @@ void Display::create_mouse_events(int delta_x, int delta_y, int scroll, uint8_t
 		}
 	}
 
+	//If the mouse just left a resize border, put the cursor back
+	if(was_near_border && !near_border && !_resize_window)
+		_mouse_window->set_cursor(Pond::NORMAL);
+	was_near_border = near_border;
+
 	// If the mouse was previously in a different window, update the mouse position in that window
 	if(event_window != _prev_mouse_window && _prev_mouse_window != nullptr && !_prev_mouse_window->gets_global_mouse()) {
 		Gfx::Dimensions window_dims = _prev_mouse_window->rect().dimensions();
@@ -469,25 +563,33 @@ void Display::create_mouse_events(int delta_x, int delta_y, int scroll, uint8_t
 	prev_mouse_buttons = buttons;
 }
 
-bool Display::buffer_is_dirty() {
-	return display_buffer_dirty;
-}
-
-bool Display::update_keyboard() {
-	KeyboardEvent events[32];
-	ssize_t nread = read(_keyboard_fd, &events, sizeof(KeyboardEvent) * 32);
-	if(!nread) return false;
-	int num_events = (int) nread / sizeof(KeyboardEvent);
-	if(_focused_window) {
-		for(int i = 0; i < num_events; i++) {
-			_focused_window->handle_keyboard_event(events[i]);
+bool Display::update_input() {
+	InputEvent events[64];
+	ssize_t nread = read(_input_fd, &events, sizeof(events));
+	if(nread <= 0) return false;
+	int num_events = (int) nread / sizeof(InputEvent);
+
+	//Runs of mouse events are handed to the mouse together, so it can handle plain movement as one move
+	MouseEvent mouse_events[64];
+	int num_mouse_events = 0;
+	for(int i = 0; i < num_events; i++) {
+		if(events[i].type == INPUT_EVENT_MOUSE) {
+			mouse_events[num_mouse_events++] = events[i].mouse;
+			continue;
 		}
+		if(num_mouse_events && _mouse_window)
+			_mouse_window->handle_events(mouse_events, num_mouse_events);
+		num_mouse_events = 0;
+		if(events[i].type == INPUT_EVENT_KEYBOARD && _focused_window)
+			_focused_window->handle_keyboard_event(events[i].keyboard);
 	}
+	if(num_mouse_events && _mouse_window)
+		_mouse_window->handle_events(mouse_events, num_mouse_events);
 	return true;
 }
 
-int Display::keyboard_fd() {
-	return _keyboard_fd;
+int Display::input_fd() {
+	return _input_fd;
 }
 
 void Display::window_hidden(Window* window) {
@@ -501,6 +603,53 @@ void Display::window_hidden(Window* window) {
 		_resize_window = nullptr;
 	if(_mousedown_window && _mousedown_window->hidden())
 		_mousedown_window = nullptr;
+	_hit_grid_dirty = true;
+}
+
+void Display::window_rect_changed(Window* window) {
+	//The mouse moves all the time and can't be moused over, so it doesn't matter where it is
+	if(window != _mouse_window)
+		_hit_grid_dirty = true;
+}
+
+const std::vector<Window*>& Display::windows_at(Gfx::Point point) {
+	static const std::vector<Window*> no_windows;
+	update_hit_grid();
+	if(point.x < 0 || point.y < 0 || point.x >= _dimensions.width || point.y >= _dimensions.height)
+		return no_windows;
+	return _hit_grid[(point.y / DISPLAY_HIT_GRID_CELL_SIZE) * _hit_grid_columns + point.x / DISPLAY_HIT_GRID_CELL_SIZE];
+}
+
+void Display::update_hit_grid() {
+	if(!_hit_grid_dirty)
+		return;
+	_hit_grid_dirty = false;
+
+	_hit_grid_columns = (_dimensions.width + DISPLAY_HIT_GRID_CELL_SIZE - 1) / DISPLAY_HIT_GRID_CELL_SIZE;
+	int rows = (_dimensions.height + DISPLAY_HIT_GRID_CELL_SIZE - 1) / DISPLAY_HIT_GRID_CELL_SIZE;
+	_hit_grid.resize(_hit_grid_columns * rows);
+	for(auto& cell : _hit_grid)
+		cell.clear();
+
+	//Windows are added front to back, so each cell ends up in the order the mouse should find them in
+	for(auto it = _windows.rbegin(); it != _windows.rend(); it++) {
+		auto* window = *it;
+		if(window == _mouse_window || window == _root_window || window->hidden())
+			continue;
+
+		//Shadows can't be clicked, but the resize border just outside of the window can
+		auto rect = window->absolute_rect().inset(-WINDOW_RESIZE_BORDER).overlapping_area(_dimensions);
+		if(rect.empty())
+			continue;
+		//Point::in() counts the right and bottom edges as inside, so those need to be included too
+		int first_col = rect.x / DISPLAY_HIT_GRID_CELL_SIZE;
+		int last_col = std::min(rect.x + rect.width, _dimensions.width - 1) / DISPLAY_HIT_GRID_CELL_SIZE;
+		int first_row = rect.y / DISPLAY_HIT_GRID_CELL_SIZE;
+		int last_row = std::min(rect.y + rect.height, _dimensions.height - 1) / DISPLAY_HIT_GRID_CELL_SIZE;
+		for(int row = first_row; row <= last_row; row++)
+			for(int col = first_col; col <= last_col; col++)
+				_hit_grid[row * _hit_grid_columns + col].push_back(window);
+	}
 }
 
 Display& Display::inst() {
@@ -26,6 +26,9 @@
 #include "Mouse.h"
 #include <libgraphics/Image.h>
 #include <sys/time.h>
+#include <pthread.h>
+#include <deque>
+#include <list>
 
 class Window;
 class Mouse;
@@ -89,10 +92,25 @@ public:
 	void flip_buffers();
 
 	/**
-	 * Calculates the number of milliseconds until the next buffer flip should occur.
-	 * @return The number of milliseconds until the next buffer flip should occur.
+	 * Starts the compositor thread, which repaints and flips the display at up to 60 frames a second whenever something
+	 * has been invalidated. From then on, anything that touches the display or its windows has to hold the lock.
 	 */
-	int millis_until_next_flip() const;
+	void start_compositor();
+
+	/**
+	 * Locks the display and its windows, so the compositor doesn't draw them while they're being changed. The event loop
+	 * holds this while it handles each batch of events, and the compositor holds it while it repaints.
+	 */
+	void lock();
+	void unlock();
+
+	/**
+	 * Called by the mouse whenever it moves or changes cursors. The cursor is drawn by the video device if it can, and
+	 * otherwise on top of everything else at the end of each frame, keeping what was under it so moving it doesn't need
+	 * anything else to be repainted.
+	 * @param image_changed Whether the cursor's image changed too.
+	 */
+	void cursor_changed(bool image_changed);
 
 	/**
 	 * Moves a window to the front.
@@ -110,20 +128,15 @@ public:
 	void create_mouse_events(int delta_x, int delta_y, int scroll, uint8_t buttons);
 
 	/**
-	 * Whether or not the display buffer is dirty.
+	 * Handles mouse and keyboard events if there are any, in the order they came in.
+	 * @return Whether or not there were any events.
 	 */
-	bool buffer_is_dirty();
+	bool update_input();
 
 	/**
-	 * Handles keyboard events if there are any.
-	 * @return Whether or not there were any keyboard events.
+	 * Returns the file descriptor that mouse and keyboard events are read from.
 	 */
-	bool update_keyboard();
-
-	/**
-	 * Returns the file descriptor for the keyboard.
-	 */
-	int keyboard_fd();
+	int input_fd();
 
 	/**
 	 * Called when a window is hidden.
@@ -131,12 +144,23 @@ public:
 	 */
 	void window_hidden(Window* window);
 
+	/**
+	 * Called when a window is moved or resized, so that mouse events find it where it is now.
+	 * @param window The window that was moved or resized.
+	 */
+	void window_rect_changed(Window* window);
+
 	static Display& inst();
 
 
 private:
 	enum class BufferMode {
-		Single, Double, DoubleFlip
+		Single, Double, Flip
+	};
+
+	struct VisiblePart {
+		Window* window;
+		Gfx::Rect area;
 	};
 
 	/**
@@ -149,6 +173,20 @@ private:
 	 */
 	Gfx::Rect calculate_resize_rect();
 
+	/**
+	 * The windows that the mouse could be over at a point, front to back. These are the ones whose rects (plus their
+	 * resize borders, but not their shadows) overlap the cell of the hit-test grid the point is in.
+	 */
+	const std::vector<Window*>& windows_at(Gfx::Point point);
+
+	/**
+	 * Rebuilds the hit-test grid if any windows have moved, changed order, or been shown or hidden since it was built.
+	 */
+	void update_hit_grid();
+
+	static void* compositor_thread(void* display);
+	void run_compositor();
+
 	int framebuffer_fd = 0; ///The file descriptor of the framebuffer.
 	Gfx::Framebuffer _framebuffer; ///The display framebuffer.
 	Gfx::Framebuffer _background_framebuffer; ///The framebuffer for the background.
@@ -156,8 +194,11 @@ private:
 	Gfx::Color _background_a = RGB(0,0,0); /// The first color of the wallpaper gradient.
 	Gfx::Color _background_b = RGB(0,0,0); /// The second color of the wallpaper gradient.
 	Gfx::Rect _dimensions; ///The dimensions of the display.
-	std::vector<Gfx::Rect> invalid_areas; ///The invalidated areas that need to be redrawn.
-	std::vector<Window*> _windows; ///The windows on the display.
+	Gfx::Region invalid_region; ///The invalidated area that needs to be redrawn.
+	std::list<Window*> _windows; ///The windows on the display, back to front.
+	std::vector<std::vector<Window*>> _hit_grid; ///The windows that can be moused over in each cell of the display, front to back.
+	int _hit_grid_columns = 0; ///The number of columns of cells in the hit-test grid.
+	bool _hit_grid_dirty = true; ///Whether the hit-test grid needs to be rebuilt before it's used.
 	Mouse* _mouse_window = nullptr; ///The window representing the mouse cursor.
 	Window* _prev_mouse_window = nullptr; ///The previous window that the mouse cursor was in.
 	Window* _drag_window = nullptr; ///The current window being dragged.
@@ -167,12 +208,22 @@ private:
 	Gfx::Rect _resize_rect; ///The rect representing the new size of the resized window.
 	ResizeMode _resize_mode = NONE; ///The current resize mode.
 	Window* _root_window = nullptr; ///The root window of the display.
-	timeval paint_time = {0, 0}; ///The last time that the display was painted.
 	bool display_buffer_dirty = true; ///Whether or not the buffer is dirty and needs to be flipped.
-	int _keyboard_fd; ///The file descriptor of the keyboard.
+	int _input_fd; ///The file descriptor of the input event stream.
 	Window* _focused_window = nullptr; ///The currently focused window.
-	BufferMode _buffer_mode = BufferMode::Single; ///Whether to use single or double buffering, or a flippable display buffer.
-	Gfx::Rect _invalid_buffer_area = {-1, -1, -1, -1}; ///The invalid area of the display buffer that needs to be redrawn next flip
+	BufferMode _buffer_mode = BufferMode::Single; ///Whether to use single or double buffering, or flippable display buffers.
+	Gfx::DamageTracker _buffer_damage; ///The tiles of the display buffer that have been drawn to and need to be copied next flip
+	std::vector<VisiblePart> _visible_parts; ///The parts of windows visible in the region being repainted, front to back.
+	pthread_mutex_t _lock = PTHREAD_MUTEX_INITIALIZER; ///Held by whichever of the event loop and compositor is using the display.
+	pthread_cond_t _damage_cond = PTHREAD_COND_INITIALIZER; ///Signalled when something is invalidated and there was nothing to draw.
+	pthread_cond_t _frame_cond = PTHREAD_COND_INITIALIZER; ///Waited on (and never signalled) to sleep until the next frame.
+	bool _hardware_cursor = false; ///Whether the video device draws the cursor for us.
+	bool _cursor_dirty = false; ///Whether the cursor needs to be drawn again.
+	Gfx::Rect _cursor_drawn_rect = {0, 0, 0, 0}; ///Where the cursor is currently drawn in the display buffer.
+	Gfx::Framebuffer _cursor_under; ///What was in the display buffer underneath the cursor before it was drawn.
+	std::deque<std::vector<Gfx::Rect>> _flip_damage; ///The damage copied by the last few flips, which the next video buffer doesn't have yet
+	int _num_video_buffers = 1; ///How many buffers of video memory there are to flip between.
+	int _video_buffer = 0; ///The video buffer that's being displayed.
 
 	static Display* _inst; ///The main instance of the display.
 };
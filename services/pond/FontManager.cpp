@@ -18,6 +18,7 @@
 */
 
 #include "FontManager.h"
+#include <unistd.h>
 
 using namespace Gfx;
 
@@ -25,8 +26,8 @@ FontManager* instance;
 
 FontManager::FontManager() {
 	instance = this;
-	load_font("gohu-14", "/usr/share/fonts/gohufont-14.bdf");
-	load_font("gohu-11", "/usr/share/fonts/gohufont-11.bdf");
+	load_font("gohu-14", "/usr/share/fonts/gohufont-14");
+	load_font("gohu-11", "/usr/share/fonts/gohufont-11");
 }
 
 FontManager& FontManager::inst() {
@@ -38,7 +39,13 @@ Font* FontManager::get_font(const std::string& name) {
 }
 
 bool FontManager::load_font(const char* name, const char* path) {
-	auto* font = Font::load_bdf_shm(path);
+	//Fonts that have been converted with fontc can be read straight into shared memory, otherwise they're parsed as BDF
+	std::string binary_path = std::string(path) + ".font";
+	Font* font = nullptr;
+	if(access(binary_path.c_str(), R_OK) == 0)
+		font = Font::load_shm(binary_path.c_str());
+	if(!font)
+		font = Font::load_bdf_shm((std::string(path) + ".bdf").c_str());
 	if(!font)
 		return false;
 	fonts[name] = font;
@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "ImageCache.h"
+#include <libgraphics/PNG.h>
+#include <libduck/Log.h>
+#include <sys/stat.h>
+#include <cstring>
+
+using namespace Gfx;
+using Duck::Log, Duck::SharedBuffer;
+
+//Only images from these places are cached, since any app can ask for them (and pond can read files they can't)
+static const char* cached_locations[] = {"/usr/share/", "/apps/"};
+
+//Anything bigger than this probably isn't an icon and isn't worth keeping around
+#define IMAGE_CACHE_MAX_PIXELS (512 * 512)
+
+ImageCache* image_cache_instance;
+
+ImageCache::ImageCache() {
+	image_cache_instance = this;
+}
+
+ImageCache& ImageCache::inst() {
+	return *image_cache_instance;
+}
+
+const ImageCache::Image* ImageCache::get_image(const std::string& path) {
+	bool cacheable = false;
+	for(auto* location : cached_locations) {
+		if(!strncmp(path.c_str(), location, strlen(location)) && path.find("/..") == std::string::npos)
+			cacheable = true;
+	}
+	if(!cacheable)
+		return nullptr;
+
+	struct stat st;
+	if(stat(path.c_str(), &st) < 0 || !S_ISREG(st.st_mode))
+		return nullptr;
+
+	auto it = images.find(path);
+	if(it != images.end() && it->second.mtime == st.st_mtime)
+		return &it->second;
+
+	auto* framebuffer = load_png(path);
+	if(!framebuffer)
+		return nullptr;
+	if(framebuffer->width * framebuffer->height > IMAGE_CACHE_MAX_PIXELS) {
+		delete framebuffer;
+		return nullptr;
+	}
+
+	size_t size = framebuffer->width * framebuffer->height * sizeof(Color);
+	auto buffer_res = SharedBuffer::alloc(size);
+	if(buffer_res.is_error()) {
+		Log::warnf("Couldn't allocate shared memory for cached image {}: {}", path, buffer_res.result());
+		delete framebuffer;
+		return nullptr;
+	}
+	memcpy(buffer_res.value()->ptr(), framebuffer->data, size);
+
+	auto& image = images[path];
+	image = {buffer_res.value(), {framebuffer->width, framebuffer->height}, st.st_mtime};
+	delete framebuffer;
+	return &image;
+}
@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <libgraphics/Geometry.h>
+#include <libduck/SharedBuffer.h>
+#include <ctime>
+#include <map>
+#include <string>
+
+/**
+ * Keeps decoded copies of the PNGs that every app loads (icons, theme images, and so on) in shared memory, so each one
+ * only gets decoded and stored once. Images are looked up by path, and decoded again if the file has been modified.
+ */
+class ImageCache {
+public:
+	struct Image {
+		Duck::Ptr<Duck::SharedBuffer> buffer;
+		Gfx::Dimensions dimensions;
+		time_t mtime;
+	};
+
+	ImageCache();
+	static ImageCache& inst();
+
+	/**
+	 * Gets an image from the cache, decoding it first if needed.
+	 * @param path The path of the PNG to get.
+	 * @return The image, or nullptr if it isn't one that gets cached or couldn't be decoded.
+	 */
+	const Image* get_image(const std::string& path);
+
+private:
+	std::map<std::string, Image> images;
+};
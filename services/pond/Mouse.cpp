@@ -28,12 +28,6 @@ using namespace Gfx;
 Mouse::Mouse(Window* parent): Window(parent, {0, 0, 1, 1}, false) {
 	display()->set_mouse_window(this);
 
-	mouse_fd = open("/dev/input/mouse", O_RDONLY | O_CLOEXEC);
-	if(mouse_fd < 0) {
-		perror("Failed to open mouse");
-		return;
-	}
-
 	load_cursor(cursor_normal, "cursor.png");
 	load_cursor(cursor_resize_v, "resize_v.png");
 	load_cursor(cursor_resize_h, "resize_h.png");
@@ -42,16 +36,8 @@ Mouse::Mouse(Window* parent): Window(parent, {0, 0, 1, 1}, false) {
 	set_cursor(Pond::NORMAL);
 }
 
-int Mouse::fd() {
-	return mouse_fd;
-}
-
-bool Mouse::update() {
-	MouseEvent events[32];
-	ssize_t nread = read(mouse_fd, &events, sizeof(MouseEvent) * 32);
-	if(!nread) return false;
-	int num_events = (int) nread / sizeof(MouseEvent);
-
+void Mouse::handle_events(const MouseEvent* events, int num_events) {
+	Gfx::Point batch_start = rect().position();
 	for(int i = 0; i < num_events; i++) {
 		Gfx::Point new_pos = rect().position();
 		if(events[i].absolute) {
@@ -64,13 +50,22 @@ bool Mouse::update() {
 			new_pos.y -= events[i].y;
 		}
 		new_pos = new_pos.constrain(parent()->rect());
-		Gfx::Point delta_pos = new_pos - rect().position();
-		set_position(new_pos);
+
+		//The display draws the cursor over everything else, so moving it doesn't need to invalidate anything
+		_rect = {new_pos, _rect.width, _rect.height};
+		recalculate_rects();
+
+		//Runs of plain movement are handled as one move, up until the buttons change or the wheel scrolls
+		bool last = i == num_events - 1;
+		if(!last && !events[i].z && events[i].buttons == _mouse_buttons && events[i + 1].buttons == _mouse_buttons && !events[i + 1].z)
+			continue;
+		Gfx::Point delta_pos = new_pos - batch_start;
+		batch_start = new_pos;
 		_mouse_buttons = events[i].buttons;
 		Display::inst().create_mouse_events(delta_pos.x, delta_pos.y, events[i].z, _mouse_buttons);
 	}
-
-	return true;
+	if(num_events > 0)
+		display()->cursor_changed(false);
 }
 
 void Mouse::set_cursor(Pond::CursorType cursor) {
@@ -100,6 +95,8 @@ void Mouse::set_cursor(Pond::CursorType cursor) {
 
 	set_dimensions(cursor_image->size());
 	cursor_image->draw(_framebuffer, {0, 0});
+	_framebuffer.premultiply();
+	display()->cursor_changed(true);
 }
 
 Duck::Result Mouse::load_cursor(Duck::Ptr<Gfx::Image>& storage, const std::string& filename) {
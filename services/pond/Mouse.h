@@ -35,12 +35,10 @@
 class Mouse: public Window {
 public:
 	Mouse(Window* parent);
-	int fd();
-	bool update();
+	void handle_events(const MouseEvent* events, int num_events);
 	void set_cursor(Pond::CursorType cursor);
 
 private:
-	int mouse_fd;
 	Duck::Ptr<Gfx::Image> cursor_normal = nullptr;
 	Duck::Ptr<Gfx::Image> cursor_resize_v = nullptr;
 	Duck::Ptr<Gfx::Image> cursor_resize_h = nullptr;
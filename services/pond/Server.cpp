@@ -57,14 +57,9 @@ Server::Server() {
 		exit(server_res.code());
 	}
 	_server = server_res.value();
-	_server->spawn_thread();
 
-	auto conn_res = BusConnection::connect("pond", true);
-	if(conn_res.is_error()) {
-		Log::crit("Couldn't create BusConnection: ", River::error_str(conn_res.code()));
-		exit(conn_res.code());
-	}
-	_connection = conn_res.value();
+	//Talk to the bus directly instead of through its socket, so calls from clients come straight to us
+	_connection = _server->connect_local();
 
 	auto end_res = _connection->register_endpoint("pond_server");
 	if(end_res.is_error()) {
@@ -96,6 +91,7 @@ Server::Server() {
 	REGISTER_FUNC(resize_window, WindowResizedPkt, WindowResizePkt, resize_window);
 	REGISTER_FUNC(invalidate_window, void, WindowInvalidatePkt, invalidate_window);
 	REGISTER_FUNC(get_font, FontResponsePkt, GetFontPkt, get_font);
+	REGISTER_FUNC(get_image, ImageResponsePkt, GetImagePkt, get_image);
 	REGISTER_FUNC(set_title, void, SetTitlePkt, set_title);
 	REGISTER_FUNC(reparent, void, WindowReparentPkt, reparent);
 	REGISTER_FUNC(set_hint, void, SetHintPkt, set_hint);
@@ -104,6 +100,7 @@ Server::Server() {
 	REGISTER_FUNC(set_app_info, void, App::Info, set_app_info);
 	REGISTER_FUNC(focus_window, void, WindowFocusPkt, focus_window);
 	REGISTER_FUNC(set_minimum_size, void, WindowMinSizePkt, set_minimum_size);
+	REGISTER_FUNC(mouse_motion_handled, void, MouseMotionHandledPkt, mouse_motion_handled);
 
 	/** Messages (server --> client) **/
 	REGISTER_MSG(window_moved, WindowMovePkt);
@@ -125,6 +122,21 @@ void Server::handle_packets() {
 	_connection->read_and_handle_packets(false);
 }
 
+void Server::begin_batch() {
+	_server->begin_batch();
+}
+
+void Server::end_batch() {
+	_server->end_batch();
+}
+
+void Server::flush_input() {
+	for(auto& client : clients) {
+		if(client.second)
+			client.second->flush_input();
+	}
+}
+
 const std::shared_ptr<River::Endpoint>& Server::endpoint() {
 	return _endpoint;
 }
@@ -30,6 +30,10 @@ public:
 
 	int fd();
 	void handle_packets();
+	void flush_input();
+	/** Holds on to the packets sent to clients until end_batch, so they can all be written at once. **/
+	void begin_batch();
+	void end_batch();
 	const std::shared_ptr<River::Endpoint>& endpoint();
 
 private:
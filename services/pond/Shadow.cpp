@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "Shadow.h"
+#include <algorithm>
+
+using namespace Gfx;
+
+//How much each sampled point inside of the window adds to the shadow's alpha
+#define SHADOW_ALPHA (400 / (Shadow::size * Shadow::size * 4))
+//Windows at least this big along an axis use the shared tile, since the ends of their shadow don't affect each other
+#define SHADOW_TILE_WINDOW_SIZE (Shadow::size * 2)
+//How far the shadow changes along each axis from its start and end. Everything in between is the same.
+#define SHADOW_HEAD (Shadow::size * 2 - 1)
+#define SHADOW_TAIL (Shadow::size * 2 - 3)
+
+std::map<std::pair<int, int>, Framebuffer> Shadow::s_tiles;
+
+/**
+ * A run of pixels along one axis of a shadow, and where they come from in the tile.
+ */
+struct ShadowSpan {
+	int start; ///Where the span starts, relative to the shadow.
+	int length; ///The length of the span.
+	int tile_start; ///Where the span's pixels start in the tile.
+	bool repeats; ///Whether the span is the pixel at tile_start repeated, instead of a run of pixels.
+};
+
+/**
+ * Splits the part of a shadow between start and end along one axis into the spans it's drawn with.
+ * @return The number of spans, which is at most three.
+ */
+static int split_spans(int start, int end, int length, int tile_length, ShadowSpan* spans) {
+	int count = 0;
+	auto add = [&](int span_start, int span_end, int tile_offset, bool repeats) {
+		span_start = std::max(span_start, start);
+		span_end = std::min(span_end, end);
+		if(span_start < span_end)
+			spans[count++] = {span_start, span_end - span_start, repeats ? tile_offset : span_start + tile_offset, repeats};
+	};
+
+	if(length == tile_length) {
+		add(0, length, 0, false);
+	} else {
+		add(0, SHADOW_HEAD, 0, false);
+		add(SHADOW_HEAD, length - SHADOW_TAIL, SHADOW_HEAD, true);
+		add(length - SHADOW_TAIL, length, tile_length - length, false);
+	}
+	return count;
+}
+
+/**
+ * How many of the points sampled for the shadow at a position along one axis are inside of a window of a given length.
+ * The alpha of each pixel is proportional to the number of points in a square around it inside of the window, which is
+ * the product of this along each axis.
+ */
+static int shadow_coverage(int pos, int window_length) {
+	int first = std::max(pos - Shadow::size + 1, Shadow::size);
+	int last = std::min(pos + Shadow::size - 2, Shadow::size + window_length);
+	return std::max(last - first + 1, 0);
+}
+
+void Shadow::draw(const Framebuffer& fb, const Rect& window_rect, const Rect& area) {
+	auto& shadow_tile = tile(window_rect.dimensions());
+	Point origin = window_rect.position() - Point {size, size};
+	int width = window_rect.width + size * 2;
+	int height = window_rect.height + size * 2;
+	Rect sides[] = {
+		{0, 0, width, size}, // Top
+		{0, height - size, width, size}, // Bottom
+		{0, size, size, window_rect.height}, // Left
+		{width - size, size, size, window_rect.height} // Right
+	};
+
+	for(auto& side : sides) {
+		Rect part = side.transform(origin).overlapping_area(area).transform(origin * -1);
+		if(part.empty())
+			continue;
+
+		ShadowSpan columns[3];
+		ShadowSpan rows[3];
+		int num_columns = split_spans(part.x, part.x + part.width, width, shadow_tile.width, columns);
+		int num_rows = split_spans(part.y, part.y + part.height, height, shadow_tile.height, rows);
+		for(int row_index = 0; row_index < num_rows; row_index++) {
+			auto& row = rows[row_index];
+			for(int column_index = 0; column_index < num_columns; column_index++) {
+				auto& column = columns[column_index];
+				Point pos = origin + Point {column.start, row.start};
+				if(!column.repeats && !row.repeats) {
+					fb.copy_blitting(shadow_tile, {column.tile_start, row.tile_start, column.length, row.length}, pos);
+				} else if(!row.repeats) {
+					//Each row is one color all the way along, so it can be filled instead of copied
+					for(int y = 0; y < row.length; y++)
+						fb.fill_blitting({pos.x, pos.y + y, column.length, 1}, *shadow_tile.at({column.tile_start, row.tile_start + y}));
+				} else if(!column.repeats) {
+					//Every row is the same, so the same row of the tile is drawn for each
+					for(int y = 0; y < row.length; y++)
+						fb.copy_blitting(shadow_tile, {column.tile_start, row.tile_start, column.length, 1}, {pos.x, pos.y + y});
+				}
+			}
+		}
+	}
+}
+
+const Framebuffer& Shadow::tile(Dimensions window_dimensions) {
+	int window_width = std::min(window_dimensions.width, SHADOW_TILE_WINDOW_SIZE);
+	int window_height = std::min(window_dimensions.height, SHADOW_TILE_WINDOW_SIZE);
+	auto& tile = s_tiles[{window_width, window_height}];
+	if(tile.data)
+		return tile;
+
+	// Poor man's box-shadow :)
+	tile = Framebuffer(window_width + size * 2, window_height + size * 2);
+	for(int y = 0; y < tile.height; y++)
+		for(int x = 0; x < tile.width; x++)
+			*tile.at({x, y}) = RGBA(0, 0, 0, SHADOW_ALPHA * shadow_coverage(x, window_width) * shadow_coverage(y, window_height));
+	//Black is the same premultiplied or not, so this lets the shadows be blended the cheaper way
+	tile.premultiplied = true;
+	return tile;
+}
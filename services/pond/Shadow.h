@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <libgraphics/Framebuffer.h>
+#include <map>
+#include <utility>
+
+/**
+ * Draws the drop shadows around windows. Each one is put together from a pre-blurred tile shared by every window: the
+ * corners of the shadow are copied straight from the tile, and the edges between them look the same all the way along,
+ * so they're drawn by repeating a single row or column of it. Windows that are too small for that to work out exactly
+ * get a tile of their own size, which is just as small as they are.
+ */
+class Shadow {
+public:
+	/** How far the shadow extends past each side of a window. **/
+	static constexpr int size = 6;
+
+	/**
+	 * Draws the part of a window's shadow inside of an area.
+	 * @param fb The framebuffer to draw onto.
+	 * @param window_rect The absolute rect of the window.
+	 * @param area The absolute area to draw inside of.
+	 */
+	static void draw(const Gfx::Framebuffer& fb, const Gfx::Rect& window_rect, const Gfx::Rect& area);
+
+private:
+	/**
+	 * Gets the tile to draw the shadow of a window with, making it first if needed.
+	 */
+	static const Gfx::Framebuffer& tile(Gfx::Dimensions window_dimensions);
+
+	static std::map<std::pair<int, int>, Gfx::Framebuffer> s_tiles; ///The tiles made so far, by the size of window they're the shadow of.
+};
@@ -20,6 +20,7 @@
 #include "Window.h"
 #include <cstdio>
 #include "Display.h"
+#include "Shadow.h"
 #include <libgraphics/Image.h>
 #include <libduck/Log.h>
 #include <memory.h>
@@ -29,8 +30,8 @@ using namespace Gfx;
 
 int Window::current_id = 0;
 
-#define SHADOW_SIZE 6
-static int SHADOW_ALPH = 400 / (double) (SHADOW_SIZE * SHADOW_SIZE * 4);
+//Window framebuffers are made big enough for sizes rounded up to this many pixels, so small resizes can reuse them
+#define FRAMEBUFFER_GRANULARITY 64
 
 Window::Window(Window* parent, const Gfx::Rect& rect, bool hidden): _parent(parent), _rect(rect), _display(parent->_display), _id(++current_id), _hidden(hidden) {
 	if(_rect.width < 1)
@@ -38,7 +39,6 @@ Window::Window(Window* parent, const Gfx::Rect& rect, bool hidden): _parent(pare
 	if(_rect.height < 1)
 		_rect.height = 1;
 	alloc_framebuffer();
-	alloc_shadow_buffers();
 	_parent->_children.push_back(this);
 	_display->add_window(this);
 	recalculate_rects();
@@ -47,7 +47,6 @@ Window::Window(Window* parent, const Gfx::Rect& rect, bool hidden): _parent(pare
 
 Window::Window(Display* display): _parent(nullptr), _rect(display->dimensions()), _display(display), _id(++current_id) {
 	alloc_framebuffer();
-	alloc_shadow_buffers();
 	_display->set_root_window(this);
 	recalculate_rects();
 	invalidate();
@@ -122,6 +121,10 @@ const Framebuffer& Window::framebuffer() const {
 	return _framebuffer;
 }
 
+const Framebuffer& Window::visible_framebuffer() const {
+	return _resize_preview.data ? _resize_preview : _framebuffer;
+}
+
 Display* Window::display() const {
 	return _display;
 }
@@ -299,6 +302,7 @@ Gfx::Rect Window::calculate_absolute_rect(const Gfx::Rect& rect) {
 }
 
 void Window::set_flipped(bool flipped) {
+	_resize_preview = Gfx::Framebuffer();
 	_framebuffer = {
 			(Gfx::Color*) _framebuffer_shm.ptr + (flipped ? _rect.width * _rect.height : 0),
 			_rect.width,
@@ -307,9 +311,20 @@ void Window::set_flipped(bool flipped) {
 }
 
 void Window::alloc_framebuffer() {
+	// Until the client draws at the new size, show what it drew last stretched to fit instead of an empty window
+	if(_client && _framebuffer.data && _framebuffer.width > 0 && _framebuffer.height > 0 && _rect.width > 0 && _rect.height > 0) {
+		Gfx::Framebuffer preview(_rect.width, _rect.height);
+		preview.fill({0, 0, _rect.width, _rect.height}, RGBA(0, 0, 0, 0));
+		preview.draw_image_scaled(_resize_preview.data ? _resize_preview : _framebuffer, {0, 0, _rect.width, _rect.height});
+		_resize_preview = std::move(preview);
+	}
+
 	// Only reallocate if we need more space in the buffer
-	auto new_buffer_size = IMGSIZE(_rect.width, _rect.height) * 2;
-	if(!_framebuffer.data || new_buffer_size > _framebuffer_shm.size) {
+	auto used_size = IMGSIZE(_rect.width, _rect.height) * 2;
+	if(!_framebuffer.data || used_size > _framebuffer_shm.size) {
+		auto round_up = [](int size) { return ((size + FRAMEBUFFER_GRANULARITY - 1) / FRAMEBUFFER_GRANULARITY) * FRAMEBUFFER_GRANULARITY; };
+		auto new_buffer_size = IMGSIZE(round_up(_rect.width), round_up(_rect.height)) * 2;
+
 		//Deallocate the old framebuffer if there is one
 		if(_framebuffer.data && shmdetach(_framebuffer_shm.id) < 0) {
 			perror("Failed to deallocate framebuffer for window");
@@ -322,45 +337,17 @@ void Window::alloc_framebuffer() {
 			return;
 		}
 	} else {
-		// Clear out the old framebuffer
-		memset(_framebuffer_shm.ptr, 0, _framebuffer_shm.size);
+		// Clear out the part of the old framebuffer we're using
+		memset(_framebuffer_shm.ptr, 0, used_size);
 	}
 
 	_framebuffer = {(Gfx::Color*) _framebuffer_shm.ptr, _rect.width, _rect.height};
-
-	alloc_shadow_buffers();
-}
-
-void Window::alloc_shadow_buffers() {
-	_shadow_buffers[0] = Gfx::Framebuffer(_rect.width + SHADOW_SIZE * 2, SHADOW_SIZE); // Top
-	_shadow_buffers[1] = Gfx::Framebuffer(_rect.width + SHADOW_SIZE * 2, SHADOW_SIZE); // Bottom
-	_shadow_buffers[2] = Gfx::Framebuffer(SHADOW_SIZE, _rect.height); // Left
-	_shadow_buffers[3] = Gfx::Framebuffer(SHADOW_SIZE, _rect.height); // Right
-
-	// Poor man's box-shadow :)
-	auto make_shadow_buffer = [&](Gfx::Framebuffer& buffer, Gfx::Rect window_rect) {
-		for(int y = 0; y < buffer.height; y++) {
-			for(int x = 0; x < buffer.width; x++) {
-				auto sample_rect = Rect {x - SHADOW_SIZE + 1, y - SHADOW_SIZE + 1, SHADOW_SIZE * 2 - 2, SHADOW_SIZE * 2 - 2};
-				int alph = 0;
-				for(int sample_y = sample_rect.y; sample_y < sample_rect.height + sample_rect.y; sample_y++)
-					for(int sample_x = sample_rect.x; sample_x < sample_rect.width + sample_rect.x; sample_x++)
-						if(Point {sample_x, sample_y}.in(window_rect))
-							alph += SHADOW_ALPH;
-				*buffer.at({x, y}) = RGBA(0,0,0,alph);
-			}
-		}
-	};
-
-	make_shadow_buffer(_shadow_buffers[0], { SHADOW_SIZE, SHADOW_SIZE, _rect.width, _rect.height });
-	make_shadow_buffer(_shadow_buffers[1], { SHADOW_SIZE, -_rect.height, _rect.width, _rect.height });
-	make_shadow_buffer(_shadow_buffers[2], { SHADOW_SIZE, 0, _rect.width, _rect.height });
-	make_shadow_buffer(_shadow_buffers[3], { -_rect.width, 0, _rect.width, _rect.height });
 }
 
 void Window::recalculate_rects() {
 	_absolute_rect = calculate_absolute_rect(_rect);
-	_absolute_shadow_rect = _absolute_rect.inset(_draws_shadow ? -SHADOW_SIZE : 0);
+	_absolute_shadow_rect = _absolute_rect.inset(_draws_shadow ? -Shadow::size : 0);
+	_display->window_rect_changed(this);
 	for(auto child : _children)
 		child->recalculate_rects();
 }
@@ -412,6 +399,9 @@ void Window::set_hint(int hint, int value) {
 		case PWINDOW_HINT_SHADOW:
 			set_has_shadow(value);
 			break;
+		case PWINDOW_HINT_MOTIONHINT:
+			_motion_hint = value;
+			break;
 		default:
 			Duck::Log::warn("Unknown window hint ", hint);
 	}
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <vector>
+#include <list>
 #include <libgraphics/Geometry.h>
 #include <libgraphics/Graphics.h>
 #include "Client.h"
@@ -57,6 +58,12 @@ public:
 	void set_client(Client* client);
 	int id() const;
 	const Gfx::Framebuffer& framebuffer() const;
+
+	/**
+	 * The framebuffer to draw the window with. After a resize, this is what the client drew before stretched to fit
+	 * until it draws something at the new size.
+	 */
+	const Gfx::Framebuffer& visible_framebuffer() const;
 	Display* display() const;
 
 	/**
@@ -200,6 +207,11 @@ public:
 	 */
 	bool uses_alpha();
 
+	/**
+	 * Whether the client only wants the mouse's latest position, and not every movement it makes.
+	 */
+	bool motion_hint() const { return _motion_hint; }
+
 	/**
 	 * Handles a number of keyboard events for this window.
 	 * @param event The event to handle.
@@ -264,10 +276,6 @@ public:
 	 */
 	void set_has_shadow(bool shadow);
 
-	/**
-	 * Gets the shadow framebuffers for drawing shadows.
-	 */
-	Gfx::Framebuffer* shadow_buffers() { return _shadow_buffers; }
 
 	/** Sets the minimum size of the window. */
 	void set_minimum_size(Gfx::Dimensions minimum);
@@ -278,13 +286,15 @@ public:
 
 private:
 	friend class Mouse;
+	friend class Display;
 	void alloc_framebuffer();
-	void alloc_shadow_buffers();
 	void recalculate_rects();
 	void finalize_resize();
 
 	Gfx::Framebuffer _framebuffer = {nullptr, 0, 0};
 	shm _framebuffer_shm;
+	// A stretched copy of what the window looked like before it was resized, until the client draws at the new size
+	Gfx::Framebuffer _resize_preview;
 	Gfx::Rect _rect;
 	Gfx::Rect _absolute_rect;
 	Gfx::Rect _absolute_shadow_rect;
@@ -293,6 +303,7 @@ private:
 	Window* _parent;
 	Display* _display;
 	std::vector<Window*> _children;
+	std::list<Window*>::iterator _z_position; ///Where the window is in the display's z-order, so it can be moved without searching for it.
 	Client* _client = nullptr;
 	int _id;
 	uint8_t _mouse_buttons;
@@ -303,10 +314,10 @@ private:
 	char* _title = nullptr;
 	bool _hidden = true;
 	bool _uses_alpha = false;
+	bool _motion_hint = false;
 	bool _destructing = false;
 	bool _draws_shadow = true;
 	Pond::WindowType _type = Pond::DEFAULT;
-	Gfx::Framebuffer _shadow_buffers[4];
 	Gfx::Dimensions _minimum_size = {WINDOW_RESIZE_BORDER * 2, WINDOW_RESIZE_BORDER * 2};
 
 	static int current_id;
@@ -22,9 +22,11 @@
 #include "Server.h"
 #include "Window.h"
 #include "FontManager.h"
+#include "ImageCache.h"
 #include <libduck/Log.h>
+#include <libduck/Service.h>
 #include <string.h>
-#include <poll.h>
+#include <sys/epoll.h>
 #include <unistd.h>
 
 int main(int argc, char** argv, char** envp) {
@@ -32,16 +34,19 @@ int main(int argc, char** argv, char** envp) {
 	auto* server = new Server;
 	auto* main_window = new Window(display);
 	main_window->set_hidden(false);
-	auto* mouse = new Mouse(main_window);
+	new Mouse(main_window);
 	auto* font_manager = new FontManager();
+	auto* image_cache = new ImageCache();
 
-	struct pollfd polls[3];
-	polls[0].fd = mouse->fd();
-	polls[0].events = POLLIN;
-	polls[1].fd = server->fd();
-	polls[1].events = POLLIN;
-	polls[2].fd = display->keyboard_fd();
-	polls[2].events = POLLIN;
+	int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	for(int fd : {server->fd(), display->input_fd()}) {
+		struct epoll_event event = {.events = EPOLLIN, .data = {.fd = fd}};
+		epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+	}
+	struct epoll_event events[2];
+
+	//Let init know we're ready before starting sandbar, so it doesn't end up with the pipe to init
+	Duck::Service::notify_ready();
 
 	if(!fork()) {
 		char* argv[] = {NULL};
@@ -54,12 +59,17 @@ int main(int argc, char** argv, char** envp) {
 
 #pragma clang diagnostic push
 #pragma ide diagnostic ignored "EndlessLoop"
+	//Repainting happens on the compositor thread, so all this loop does is handle events (with the display locked)
+	display->start_compositor();
 	while(true) {
-		poll(polls, 3, display->buffer_is_dirty() ? display->millis_until_next_flip() : -1);
-		mouse->update();
-		display->update_keyboard();
+		epoll_wait(epoll_fd, events, 2, -1);
+		display->lock();
+		server->begin_batch();
+		display->update_input();
 		server->handle_packets();
-		display->repaint();
+		server->flush_input();
+		server->end_batch();
+		display->unlock();
 	}
 #pragma clang diagnostic pop
 
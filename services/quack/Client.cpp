@@ -18,6 +18,10 @@
 */
 
 #include "Client.h"
+#include <libsound/Mix.h>
+
+//How many samples are taken out of a client's queue at a time to be mixed
+#define CLIENT_MIX_CHUNK 256
 
 using namespace Sound;
 
@@ -36,11 +40,16 @@ sockid_t Client::id() const {
 }
 
 bool Client::mix_samples(Sound::Sample buffer[], size_t max_samples) {
-	if(m_buffer.empty())
-		return false;
-	for(size_t i = 0; i < max_samples; i++)
-		buffer[i] += m_buffer.pop().value_or(Sample{});
-	return true;
+	Sample samples[CLIENT_MIX_CHUNK];
+	size_t num_mixed = 0;
+	while(num_mixed < max_samples) {
+		auto count = m_buffer.pop(samples, std::min(max_samples - num_mixed, (size_t) CLIENT_MIX_CHUNK));
+		if(!count)
+			break;
+		Sound::mix_samples(buffer + num_mixed, samples, m_volume, count);
+		num_mixed += count;
+	}
+	return num_mixed;
 }
 
 float Client::volume() const {
@@ -20,7 +20,11 @@
 #include "SoundServer.h"
 #include <libduck/Log.h>
 #include <libsound/Sample.h>
+#include <libsound/Mix.h>
 #include <sys/thread.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <kernel/api/sound.h>
 
 using Duck::Log, Duck::SharedBuffer, Duck::File, Sound::Sample;
 
@@ -32,6 +36,10 @@ SoundServer::SoundServer() {
 	else
 		m_soundcard = sound_res.value();
 
+	//Keep only a few buffers queued on the card, so that sounds start playing soon after they're queued
+	if(m_soundcard.is_open() && ioctl(m_soundcard.fd(), SOUND_SET_BUFFERS, (void*) QUACK_CARD_BUFFERS) < 0)
+		Log::warn("Couldn't set sound card buffers: ", strerror(errno));
+
 	//Create bus
 	auto bus_res = River::BusServer::create("quack");
 	if(bus_res.is_error()) {
@@ -39,15 +47,9 @@ SoundServer::SoundServer() {
 		exit(errno);
 	}
 	m_bus = bus_res.value();
-	m_bus->spawn_thread();
 
-	//Create connection
-	auto conn_res = River::BusConnection::connect("quack", true);
-	if(conn_res.is_error()) {
-		Log::err("Couldn't connect to audio bus: ", bus_res.strerror());
-		exit(errno);
-	}
-	m_connection = conn_res.value();
+	//Create connection (a local one, so calls from clients come straight to us instead of through the bus's socket)
+	m_connection = m_bus->connect_local();
 
 	//Register stuff
 	auto endpoint_res = m_connection->register_endpoint("quack");
@@ -75,20 +77,34 @@ void SoundServer::pump() {
 		m_connection->read_and_handle_packets(true);
 		return;
 	}
+
+	// Samples go straight into shared memory, so nothing wakes us up when a client queues some. If nobody has any, we
+	// check back every so often instead of wasting buffers on silence.
+	bool has_samples = false;
+	for (auto& client: m_clients)
+		has_samples |= !client.second->sample_buffer().empty();
+
+	// Otherwise, wait until the card finishes playing a buffer (or a client talks to us)
+	struct pollfd pfds[2] = {
+		{m_soundcard.fd(), POLLOUT, 0},
+		{m_connection->file_descriptor(), POLLIN, 0}
+	};
+	if(has_samples)
+		poll(pfds, 2, -1);
+	else
+		poll(&pfds[1], 1, QUACK_IDLE_POLL_INTERVAL);
 	m_connection->read_and_handle_packets(false);
+	if(!(pfds[0].revents & POLLOUT))
+		return;
 
 	// Mix samples together from client queues
 	Sound::Sample mixed_samples[SOUNDCARD_BUFFER_SIZE];
-	bool did_mix = false;
 	for (auto& client: m_clients)
-		did_mix |= client.second->mix_samples(mixed_samples, SOUNDCARD_BUFFER_SIZE);
-	if(!did_mix)
-		usleep(100);
+		client.second->mix_samples(mixed_samples, SOUNDCARD_BUFFER_SIZE);
 
 	// Write PCM samples to card
 	uint32_t pcm_samples[SOUNDCARD_BUFFER_SIZE];
-	for (int i = 0; i < SOUNDCARD_BUFFER_SIZE; i++)
-		pcm_samples[i] = mixed_samples[i].as_16bit_lpcm();
+	Sound::samples_to_16bit_lpcm(pcm_samples, mixed_samples, SOUNDCARD_BUFFER_SIZE);
 	m_soundcard.write(pcm_samples, SOUNDCARD_BUFFER_SIZE * sizeof(uint32_t));
 }
 
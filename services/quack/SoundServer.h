@@ -25,6 +25,8 @@
 #include <libduck/File.h>
 
 #define SOUNDCARD_BUFFER_SIZE 512
+#define QUACK_CARD_BUFFERS 8 //How many buffers of SOUNDCARD_BUFFER_SIZE samples to keep queued on the card (about 85ms)
+#define QUACK_IDLE_POLL_INTERVAL 5 //How often (in ms) to check for samples when none of the clients have any queued
 
 class SoundServer {
 public:
@@ -18,9 +18,11 @@
 */
 
 #include "SoundServer.h"
+#include <libduck/Service.h>
 
 int main(int argc, char** argv) {
 	SoundServer server;
+	Duck::Service::notify_ready();
 	while(true)
 		server.pump();
 }
\ No newline at end of file
@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "StatsServer.h"
+#include <libsys/Stats.h>
+#include <libduck/Log.h>
+#include <poll.h>
+#include <ctime>
+
+using Duck::Log;
+using namespace Sys;
+
+StatsServer::StatsServer() {
+	auto res = m_cpu_stream.open("/proc/cpuinfo");
+	if(res.is_error())
+		Log::warn("Couldn't open cpuinfo: ", res.strerror());
+	res = m_mem_stream.open("/proc/meminfo");
+	if(res.is_error())
+		Log::warn("Couldn't open meminfo: ", res.strerror());
+
+	//Create bus
+	auto bus_res = River::BusServer::create(Stats::SERVICE_NAME);
+	if(bus_res.is_error()) {
+		Log::err("Couldn't open stats bus: ", bus_res.strerror());
+		exit(errno);
+	}
+	m_bus = bus_res.value();
+	m_connection = m_bus->connect_local();
+
+	//Register stuff
+	auto endpoint_res = m_connection->register_endpoint(Stats::SERVICE_NAME);
+	if(endpoint_res.is_error()) {
+		Log::err("Couldn't create endpoint: ", endpoint_res.strerror());
+		exit(errno);
+	}
+	m_endpoint = endpoint_res.value();
+
+	m_endpoint->on_client_connect = [&](sockid_t sockid, pid_t pid) {
+		m_clients.insert(sockid);
+	};
+
+	m_endpoint->on_client_disconnect = [&](sockid_t sockid, pid_t pid) {
+		m_clients.erase(sockid);
+	};
+
+	auto msg_res = m_endpoint->register_message<Stats::Sample>("sample");
+	if(msg_res.is_error()) {
+		Log::err("Couldn't register sample message: ", msg_res.strerror());
+		exit(errno);
+	}
+}
+
+void StatsServer::pump() {
+	//With nobody to send samples to, there's no point in taking them
+	if(m_clients.empty()) {
+		m_connection->read_and_handle_packets(true);
+		return;
+	}
+
+	//Otherwise, wait until it's time for the next sample (or a client connects or disconnects)
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	long wait = (m_next_sample.tv_sec - now.tv_sec) * 1000 + (m_next_sample.tv_nsec - now.tv_nsec) / 1000000;
+	if(wait > 0) {
+		struct pollfd pfd = {m_connection->file_descriptor(), POLLIN, 0};
+		if(poll(&pfd, 1, (int) wait) > 0) {
+			m_connection->read_and_handle_packets(false);
+			return;
+		}
+	}
+
+	sample();
+	clock_gettime(CLOCK_MONOTONIC, &m_next_sample);
+	m_next_sample.tv_sec += Stats::INTERVAL / 1000;
+	m_next_sample.tv_nsec += (Stats::INTERVAL % 1000) * 1000000;
+	if(m_next_sample.tv_nsec >= 1000000000) {
+		m_next_sample.tv_sec++;
+		m_next_sample.tv_nsec -= 1000000000;
+	}
+}
+
+void StatsServer::sample() {
+	auto cpu_res = CPU::get_info(m_cpu_stream);
+	auto mem_res = Mem::get_info(m_mem_stream);
+	if(cpu_res.is_error() || mem_res.is_error())
+		return;
+
+	auto sample = Stats::Sample::make(cpu_res.value(), mem_res.value());
+	for(auto client : m_clients)
+		m_endpoint->send_message("sample", client, sample);
+}
@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#pragma once
+
+#include <libriver/river.h>
+#include <libduck/FileStream.h>
+#include <set>
+
+/**
+ * Samples the system's CPU and memory statistics once every Sys::Stats::INTERVAL and sends them to every connected
+ * client, so that programs showing them don't each have to read and parse /proc on their own timers.
+ */
+class StatsServer {
+public:
+	StatsServer();
+	void pump();
+
+private:
+	void sample();
+
+	River::BusServer* m_bus;
+	std::shared_ptr<River::BusConnection> m_connection;
+	std::shared_ptr<River::Endpoint> m_endpoint;
+	std::set<sockid_t> m_clients;
+	Duck::FileInputStream m_cpu_stream;
+	Duck::FileInputStream m_mem_stream;
+	timespec m_next_sample = {0, 0};
+};
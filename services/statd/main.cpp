@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright © 2016-2023 Byteduck */
+
+#include "StatsServer.h"
+#include <libduck/Service.h>
+
+int main(int argc, char** argv) {
+	StatsServer server;
+	Duck::Service::notify_ready();
+	while(true)
+		server.pump();
+}